@@ -52,6 +52,12 @@ try:
 except ImportError:
     CLIENT_SUPPORTS_PANDAS = False
 
+try:
+    import pyarrow
+    CLIENT_SUPPORTS_ARROW = True
+except ImportError:
+    CLIENT_SUPPORTS_ARROW = False
+
 # Replica selection enums
 LEADER_ONLY = ReplicaSelection_Leader
 CLOSEST_REPLICA = ReplicaSelection_Closest
@@ -1621,6 +1627,111 @@ cdef class RowBatch:
         return row
 
 
+def _arrow_type(ColumnSchema column):
+    import pyarrow as pa
+    name = column.type.name
+    if name == 'int8':
+        return pa.int8()
+    elif name == 'int16':
+        return pa.int16()
+    elif name == 'int32':
+        return pa.int32()
+    elif name == 'int64':
+        return pa.int64()
+    elif name == 'float':
+        return pa.float32()
+    elif name == 'double':
+        return pa.float64()
+    elif name == 'bool':
+        return pa.bool_()
+    elif name == 'string':
+        return pa.string()
+    elif name == 'binary':
+        return pa.binary()
+    elif name == 'unixtime_micros':
+        return pa.timestamp('us', tz='UTC')
+    elif name == 'decimal':
+        attrs = column.type_attributes
+        return pa.decimal128(attrs.precision, attrs.scale)
+    raise TypeError('Cannot convert column {0} of type {1} to Arrow'
+                    .format(column.name, name))
+
+
+cdef class ColumnarBatch:
+    """
+    Class holding a batch of rows from a Scanner, in columnar layout.
+    """
+    # This class owns the KuduColumnarScanBatch data
+    cdef:
+        KuduColumnarScanBatch batch
+        Schema schema
+
+    def __len__(self):
+        return self.batch.NumRows()
+
+    cdef _buffer(self, Slice slice):
+        import pyarrow as pa
+        # The buffer references this batch, so that the data it points to
+        # stays valid for as long as the buffer is in use.
+        return pa.foreign_buffer(<uintptr_t> slice.data(), slice.size(), self)
+
+    cdef _to_arrow_array(self, int i):
+        import pyarrow as pa
+        cdef:
+            ColumnSchema column = self.schema.at(i)
+            int n = self.batch.NumRows()
+            Slice data
+            Slice offsets
+            Slice non_null_bitmap
+
+        arrow_type = _arrow_type(column)
+        validity = None
+        if column.nullable:
+            check_status(self.batch.GetNonNullBitmapForColumn(i, &non_null_bitmap))
+            validity = self._buffer(non_null_bitmap)
+
+        if column.type.name in ('string', 'binary'):
+            check_status(self.batch.GetVariableLengthColumn(i, &offsets, &data))
+            return pa.Array.from_buffers(
+                arrow_type, n, [validity, self._buffer(offsets), self._buffer(data)])
+
+        check_status(self.batch.GetFixedLengthColumn(i, &data))
+        if column.type.name == 'bool':
+            # Arrow packs booleans into bits, Kudu stores one byte per cell.
+            import numpy as np
+            values = np.frombuffer(self._buffer(data), dtype=np.bool_)
+            mask = None
+            if validity is not None:
+                mask = np.unpackbits(np.frombuffer(validity, dtype=np.uint8),
+                                     bitorder='little')[:n] == 0
+            return pa.array(values, type=arrow_type, mask=mask)
+        if column.type.name == 'decimal' and n > 0 and data.size() != n * 16:
+            # Arrow only has 128-bit decimals: sign-extend the narrower cells.
+            import numpy as np
+            dtype = np.int32 if data.size() == n * 4 else np.int64
+            low = np.frombuffer(self._buffer(data), dtype=dtype).astype(np.int64)
+            wide = np.empty((n, 2), dtype=np.int64)
+            wide[:, 0] = low
+            wide[:, 1] = low >> 63
+            return pa.Array.from_buffers(arrow_type, n, [validity, pa.py_buffer(wide)])
+        return pa.Array.from_buffers(arrow_type, n, [validity, self._buffer(data)])
+
+    def to_arrow(self):
+        """
+        Return the batch as an Arrow RecordBatch. Most columns reference the
+        batch's data without copying it.
+
+        This is only available if PyArrow is installed.
+
+        Returns
+        -------
+        batch : pyarrow.RecordBatch
+        """
+        import pyarrow as pa
+        arrays = [self._to_arrow_array(i) for i in range(len(self.schema))]
+        return pa.RecordBatch.from_arrays(arrays, self.schema.names)
+
+
 cdef class Scanner:
     """
     A class for defining a selection of data we wish to scan out of a Kudu
@@ -2146,6 +2257,50 @@ cdef class Scanner:
 
         return df
 
+    def xarrow_batches(self):
+        """
+        This method acts as a generator of the scan's rows as Arrow
+        RecordBatches, which are built from the columnar layout of the scan
+        results mostly without copying them.
+
+        This is only available if PyArrow is installed, and must be called
+        before the scanner is opened.
+        """
+        if self.is_open:
+            raise RuntimeError('Arrow batches require the columnar layout, '
+                               'which must be set before the scanner is opened')
+        check_status(self.scanner.SetRowFormatFlags(RowFormatFlags_ColumnarLayout))
+        self.open()
+
+        cdef ColumnarBatch batch
+        schema = self.get_projection_schema()
+        while self.has_more_rows():
+            batch = ColumnarBatch()
+            batch.schema = schema
+            check_status(self.scanner.NextBatch(&batch.batch))
+            if len(batch) != 0:
+                yield batch.to_arrow()
+
+    def to_arrow(self):
+        """
+        Returns the contents of this Scanner as an Arrow Table.
+
+        This is only available if PyArrow is installed, and must be called
+        before the scanner is opened.
+
+        Note: This should only be used if the results from the scanner are expected
+        to be small, as the entire contents are loaded into memory.
+
+        Returns
+        -------
+        table : pyarrow.Table
+        """
+        import pyarrow as pa
+        arrow_schema = pa.schema([pa.field(column.name, _arrow_type(column),
+                                           column.nullable)
+                                  for column in self.get_projection_schema()])
+        return pa.Table.from_batches(list(self.xarrow_batches()), arrow_schema)
+
 
 
 
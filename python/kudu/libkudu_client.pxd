@@ -133,6 +133,7 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
         EncodingType_BIT_SHUFFLE " kudu::client::KuduColumnStorageAttributes::BIT_SHUFFLE"
         EncodingType_RLE " kudu::client::KuduColumnStorageAttributes::RLE"
         EncodingType_DICT " kudu::client::KuduColumnStorageAttributes::DICT_ENCODING"
+        EncodingType_FRAME_OF_REFERENCE " kudu::client::KuduColumnStorageAttributes::FRAME_OF_REFERENCE"
 
     enum CompressionType" kudu::client::KuduColumnStorageAttributes::CompressionType":
         CompressionType_DEFAULT " kudu::client::KuduColumnStorageAttributes::DEFAULT_COMPRESSION"
@@ -140,6 +141,7 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
         CompressionType_SNAPPY " kudu::client::KuduColumnStorageAttributes::SNAPPY"
         CompressionType_LZ4 " kudu::client::KuduColumnStorageAttributes::LZ4"
         CompressionType_ZLIB " kudu::client::KuduColumnStorageAttributes::ZLIB"
+        CompressionType_ZSTD " kudu::client::KuduColumnStorageAttributes::ZSTD"
 
     cdef struct KuduColumnStorageAttributes:
         KuduColumnStorageAttributes()
@@ -214,6 +216,14 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
 
         Status Build(KuduSchema* schema)
 
+cdef extern from "kudu/client/columnar_scan_batch.h" namespace "kudu::client" nogil:
+
+    cdef cppclass KuduColumnarScanBatch:
+        int NumRows() const;
+        Status GetFixedLengthColumn(int idx, Slice* data) const;
+        Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
+        Status GetNonNullBitmapForColumn(int idx, Slice* non_null_bitmap) const;
+
 cdef extern from "kudu/client/scan_batch.h" namespace "kudu::client" nogil:
 
     cdef cppclass KuduScanBatch:
@@ -501,6 +511,8 @@ cdef extern from "kudu/client/client.h" namespace "kudu::client" nogil:
         ReadMode_Snapshot " kudu::client::KuduScanner::READ_AT_SNAPSHOT"
         ReadMode_ReadYourWrites " kudu::client::KuduScanner::READ_YOUR_WRITES"
 
+    uint64_t RowFormatFlags_ColumnarLayout " kudu::client::KuduScanner::COLUMNAR_LAYOUT"
+
     enum RangePartitionBound" kudu::client::KuduTableCreator::RangePartitionBound":
         PartitionType_Exclusive " kudu::client::KuduTableCreator::EXCLUSIVE_BOUND"
         PartitionType_Inclusive " kudu::client::KuduTableCreator::INCLUSIVE_BOUND"
@@ -676,7 +688,9 @@ cdef extern from "kudu/client/client.h" namespace "kudu::client" nogil:
 
         c_bool HasMoreRows()
         Status NextBatch(KuduScanBatch* batch)
+        Status NextBatch(KuduColumnarScanBatch* batch)
         Status SetBatchSizeBytes(uint32_t batch_size)
+        Status SetRowFormatFlags(uint64_t flags)
         Status SetSelection(ReplicaSelection selection)
         Status SetCacheBlocks(c_bool cache_blocks)
         Status SetReadMode(ReadMode read_mode)
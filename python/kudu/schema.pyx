@@ -59,6 +59,7 @@ COMPRESSION_NONE = CompressionType_NONE
 COMPRESSION_SNAPPY = CompressionType_SNAPPY
 COMPRESSION_LZ4 = CompressionType_LZ4
 COMPRESSION_ZLIB = CompressionType_ZLIB
+COMPRESSION_ZSTD = CompressionType_ZSTD
 
 cdef dict _compression_types = {
     'default': COMPRESSION_DEFAULT,
@@ -66,6 +67,7 @@ cdef dict _compression_types = {
     'snappy': COMPRESSION_SNAPPY,
     'lz4': COMPRESSION_LZ4,
     'zlib': COMPRESSION_ZLIB,
+    'zstd': COMPRESSION_ZSTD,
 }
 
 cdef dict _compression_type_to_name = _reverse_dict(_compression_types)
@@ -78,6 +80,7 @@ ENCODING_PREFIX = EncodingType_PREFIX
 ENCODING_BIT_SHUFFLE = EncodingType_BIT_SHUFFLE
 ENCODING_RLE = EncodingType_RLE
 ENCODING_DICT = EncodingType_DICT
+ENCODING_FRAME_OF_REFERENCE = EncodingType_FRAME_OF_REFERENCE
 
 cdef dict _encoding_types = {
     'auto': ENCODING_AUTO,
@@ -86,6 +89,7 @@ cdef dict _encoding_types = {
     'bitshuffle': ENCODING_BIT_SHUFFLE,
     'rle': ENCODING_RLE,
     'dict': ENCODING_DICT,
+    'frame_of_reference': ENCODING_FRAME_OF_REFERENCE,
 }
 
 cdef dict _encoding_type_to_name = _reverse_dict(_encoding_types)
@@ -290,7 +294,7 @@ cdef class ColumnSpec:
         Parameters
         ----------
         compression : string or int
-          One of {'default', 'none', 'snappy', 'lz4', 'zlib'}
+          One of {'default', 'none', 'snappy', 'lz4', 'zlib', 'zstd'}
           Or see kudu.COMPRESSION_* constants
 
         Returns
@@ -487,7 +491,7 @@ cdef class SchemaBuilder:
           New columns are nullable by default. Set boolean value for explicit
           nullable / not-nullable
         compression : string or int
-          One of {'default', 'none', 'snappy', 'lz4', 'zlib'}
+          One of {'default', 'none', 'snappy', 'lz4', 'zlib', 'zstd'}
           Or see kudu.COMPRESSION_* constants
         encoding : string or int
           One of {'auto', 'plain', 'prefix', 'bitshuffle', 'rle', 'dict'}
@@ -328,6 +328,53 @@ class TestScanner(TestScanBase):
             self.assertEqual(sorted(scanner.read_all_tuples()),
                              sorted(self.tuples))
 
+    @pytest.mark.skipif(not (kudu.CLIENT_SUPPORTS_ARROW),
+                        reason="PyArrow required to run this test.")
+    def test_scanner_to_arrow(self):
+        """
+        This test confirms that the scanned rows are converted to Arrow.
+        """
+        scanner = self.table.scanner()
+        table = scanner.to_arrow()
+        self.assertEqual(table.num_rows, self.nrows)
+        self.assertEqual(table.schema.names, scanner.get_projection_schema().names)
+
+        columns = [table.column(i).to_pylist() for i in range(table.num_columns)]
+        rows = sorted(zip(*columns))
+        for row, expected in zip(rows, sorted(self.tuples)):
+            self.assertEqual(row[:3], expected[:3])
+            self.assertEqual(row[3].replace(tzinfo=None),
+                             expected[3].replace(tzinfo=None))
+
+        # The columnar layout must be requested before the scanner is opened.
+        scanner = self.table.scanner().open()
+        with self.assertRaises(RuntimeError):
+            scanner.to_arrow()
+
+    @pytest.mark.skipif(not (kudu.CLIENT_SUPPORTS_ARROW),
+                        reason="PyArrow required to run this test.")
+    def test_scanner_to_arrow_types(self):
+        """
+        This test confirms that data types are converted as expected to Arrow.
+        """
+        import pyarrow as pa
+        table = self.type_table.scanner().to_arrow()
+        self.assertEqual(table.num_rows, len(self.type_test_rows))
+        types = dict((field.name, field.type) for field in table.schema)
+        self.assertEqual(types['key'], pa.int64())
+        self.assertEqual(types['unixtime_micros_val'], pa.timestamp('us', tz='UTC'))
+        self.assertEqual(types['string_val'], pa.string())
+        self.assertEqual(types['bool_val'], pa.bool_())
+        self.assertEqual(types['double_val'], pa.float64())
+        self.assertEqual(types['int8_val'], pa.int8())
+        self.assertEqual(types['binary_val'], pa.binary())
+        self.assertEqual(types['float_val'], pa.float32())
+        if kudu.CLIENT_SUPPORTS_DECIMAL:
+            self.assertEqual(types['decimal_val'], pa.decimal128(5, 2))
+            self.assertEqual(sorted(table.column('decimal_val').to_pylist()),
+                             sorted(row[2] for row in self.type_test_rows))
+        self.assertEqual(sorted(table.column('bool_val').to_pylist()), [False, True])
+
     @pytest.mark.skipif(not (kudu.CLIENT_SUPPORTS_PANDAS),
                         reason="Pandas required to run this test.")
     def test_scanner_to_pandas_types(self):
@@ -0,0 +1,617 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Micro benchmark for the CFile encodings and compression codecs. Writes each
+// data set into a CFile with every encoding its type supports and every
+// compression codec, then measures:
+//
+// - the encoding throughput, including the compression of the blocks;
+// - the compression ratio, i.e. the raw size of the values over the size of
+//   the file;
+// - the throughput of scans whose blocks miss the block cache, broken down
+//   into decompression and decoding;
+// - the decoding throughput of scans whose blocks are in the block cache;
+// - the throughput of scans evaluating a range predicate in the decoders
+//   (BlockDecoder::CopyNextAndEval());
+// - the latency of seeking to a random row and reading it.
+//
+// The data sets are either synthetic (see --cfile_encoding_datasets) or read
+// from a file with one value per line (see --cfile_encoding_input_file).
+// Each combination is reported on stdout as a JSON object on its own line, so
+// that the results can be tracked over time.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+
+DEFINE_int32(cfile_encoding_num_rows, 1000000,
+             "Number of values in each synthetic data set");
+DEFINE_string(cfile_encoding_datasets,
+              "int32_random,int64_sequential,int64_timestamps,int64_low_cardinality,"
+              "double_random,string_low_cardinality,string_urls,string_random",
+              "Comma-separated list of the synthetic data sets to run the "
+              "benchmark on. Empty to only run it on --cfile_encoding_input_file");
+DEFINE_string(cfile_encoding_input_file, "",
+              "File holding a data set to run the benchmark on, with one value "
+              "per line, e.g. a column exported from a table");
+DEFINE_string(cfile_encoding_input_type, "string",
+              "Type of the values of --cfile_encoding_input_file: int32, "
+              "int64, double or string");
+DEFINE_string(cfile_encoding_encodings, "",
+              "Comma-separated list of the encodings to run, e.g. "
+              "'PLAIN_ENCODING,BIT_SHUFFLE'. Empty for all the encodings "
+              "supported by the type of each data set");
+DEFINE_string(cfile_encoding_compressions,
+              "NO_COMPRESSION,SNAPPY,LZ4,ZLIB,ZSTD",
+              "Comma-separated list of the compression codecs to run");
+DEFINE_int32(cfile_encoding_block_size, 256 * 1024,
+             "Size of the data blocks of the CFiles, before compression");
+DEFINE_double(cfile_encoding_predicate_selectivity, 0.1,
+              "Approximate fraction of the values selected by the range "
+              "predicate evaluated in the decoders");
+DEFINE_int32(cfile_encoding_num_seeks, 1000,
+             "Number of random seeks to measure the seek latency with");
+DEFINE_string(cfile_encoding_fs_root, "",
+              "Directory to write the CFiles into. Defaults to a new "
+              "directory in the test directory of the environment, which is "
+              "deleted once the benchmark completes");
+
+using kudu::cfile::CFileIterator;
+using kudu::cfile::CFileReader;
+using kudu::cfile::CFileWriter;
+using kudu::cfile::ReaderOptions;
+using kudu::cfile::TypeEncodingInfo;
+using kudu::cfile::WriterOptions;
+using kudu::fs::BlockDeletionTransaction;
+using kudu::fs::ReadableBlock;
+using kudu::fs::WritableBlock;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+// The number of rows the benchmark reads at a time, as a scan does.
+const size_t kBatchRows = 1024;
+
+// A column of values to write into CFiles.
+struct DataSet {
+  string name;
+  const TypeInfo* type_info;
+
+  // The cells of the values, back to back. For strings, the slices point into
+  // 'strings'.
+  vector<uint8_t> cells;
+  vector<string> strings;
+  size_t num_rows = 0;
+
+  // The size of the values, without any overhead.
+  size_t raw_bytes = 0;
+
+  const void* cell(size_t idx) const {
+    return &cells[idx * type_info->size()];
+  }
+};
+
+template<typename T>
+void AppendCell(DataSet* data, T value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  data->cells.insert(data->cells.end(), bytes, bytes + sizeof(T));
+  data->raw_bytes += sizeof(T);
+  data->num_rows++;
+}
+
+void AppendString(DataSet* data, string value) {
+  data->raw_bytes += value.size();
+  data->strings.emplace_back(std::move(value));
+  data->num_rows++;
+}
+
+// Points the cells of a string data set to its strings, once they're all
+// appended.
+void FinishStrings(DataSet* data) {
+  data->cells.resize(data->strings.size() * sizeof(Slice));
+  Slice* slices = reinterpret_cast<Slice*>(data->cells.data());
+  for (size_t i = 0; i < data->strings.size(); i++) {
+    slices[i] = Slice(data->strings[i]);
+  }
+}
+
+string RandomString(Random* rng, int min_len, int max_len) {
+  string s(min_len + rng->Uniform(max_len - min_len + 1), '\0');
+  for (auto& c : s) {
+    c = static_cast<char>('a' + rng->Uniform(26));
+  }
+  return s;
+}
+
+Status MakeSyntheticDataSet(const string& name, DataSet* data) {
+  const int n = FLAGS_cfile_encoding_num_rows;
+  Random rng(n);
+  data->name = name;
+  if (name == "int32_random") {
+    data->type_info = GetTypeInfo(INT32);
+    for (int i = 0; i < n; i++) {
+      AppendCell<int32_t>(data, static_cast<int32_t>(rng.Next32()));
+    }
+  } else if (name == "int64_sequential") {
+    data->type_info = GetTypeInfo(INT64);
+    for (int i = 0; i < n; i++) {
+      AppendCell<int64_t>(data, i);
+    }
+  } else if (name == "int64_timestamps") {
+    // One event roughly every millisecond, arriving up to 10ms out of order.
+    data->type_info = GetTypeInfo(INT64);
+    const int64_t kBase = 1546300800000000L;
+    for (int i = 0; i < n; i++) {
+      AppendCell<int64_t>(data, kBase + i * 1000L + rng.Uniform(10000));
+    }
+  } else if (name == "int64_low_cardinality") {
+    // Runs of a few repeated values, e.g. a status column.
+    data->type_info = GetTypeInfo(INT64);
+    int64_t value = 0;
+    for (int i = 0; i < n; i++) {
+      if (rng.OneIn(20)) {
+        value = rng.Uniform(16);
+      }
+      AppendCell<int64_t>(data, value);
+    }
+  } else if (name == "double_random") {
+    data->type_info = GetTypeInfo(DOUBLE);
+    for (int i = 0; i < n; i++) {
+      AppendCell<double>(data, rng.NextDoubleFraction() * 1000);
+    }
+  } else if (name == "string_low_cardinality") {
+    data->type_info = GetTypeInfo(STRING);
+    vector<string> words;
+    for (int i = 0; i < 100; i++) {
+      words.emplace_back(RandomString(&rng, 4, 12));
+    }
+    for (int i = 0; i < n; i++) {
+      AppendString(data, words[rng.Uniform(words.size())]);
+    }
+    FinishStrings(data);
+  } else if (name == "string_urls") {
+    // Values sharing long prefixes, in sorted order as in a key column.
+    data->type_info = GetTypeInfo(STRING);
+    for (int i = 0; i < n; i++) {
+      AppendString(data, Substitute("https://www.example.com/catalog/item/$0", 10000000 + i));
+    }
+    FinishStrings(data);
+  } else if (name == "string_random") {
+    data->type_info = GetTypeInfo(STRING);
+    for (int i = 0; i < n; i++) {
+      AppendString(data, RandomString(&rng, 8, 32));
+    }
+    FinishStrings(data);
+  } else {
+    return Status::InvalidArgument("unknown data set", name);
+  }
+  return Status::OK();
+}
+
+Status LoadDataSet(const string& path, const string& type, DataSet* data) {
+  faststring contents;
+  RETURN_NOT_OK(ReadFileToString(Env::Default(), path, &contents));
+  data->name = path;
+  for (StringPiece line : strings::Split(contents.ToString(), "\n", strings::SkipEmpty())) {
+    const string value = line.ToString();
+    bool ok = true;
+    if (type == "int32") {
+      int32_t v;
+      ok = safe_strto32(value, &v);
+      AppendCell(data, v);
+    } else if (type == "int64") {
+      int64_t v;
+      ok = safe_strto64(value, &v);
+      AppendCell(data, v);
+    } else if (type == "double") {
+      double v;
+      ok = safe_strtod(value, &v);
+      AppendCell(data, v);
+    } else if (type == "string") {
+      AppendString(data, value);
+    } else {
+      return Status::InvalidArgument("unknown input type", type);
+    }
+    if (!ok) {
+      return Status::Corruption(Substitute("invalid $0 value in $1", type, path), value);
+    }
+  }
+  if (type == "string") {
+    data->type_info = GetTypeInfo(STRING);
+    FinishStrings(data);
+  } else {
+    data->type_info = GetTypeInfo(type == "int32" ? INT32 : type == "int64" ? INT64 : DOUBLE);
+  }
+  if (data->num_rows == 0) {
+    return Status::InvalidArgument("no values in input file", path);
+  }
+  return Status::OK();
+}
+
+// The bounds of a range predicate selecting about 'selectivity' of the values
+// of 'data', which point into its cells.
+void FindPredicateBounds(const DataSet& data, double selectivity,
+                         const void** lower, const void** upper) {
+  vector<size_t> order(data.num_rows);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return data.type_info->Compare(data.cell(a), data.cell(b)) < 0;
+  });
+  const size_t upper_idx = std::min<size_t>(data.num_rows * selectivity, data.num_rows - 1);
+  *lower = data.cell(order[0]);
+  *upper = data.cell(order[upper_idx]);
+}
+
+// The measurements of a data set written with an encoding and a compression
+// codec.
+struct Result {
+  uint64_t file_bytes = 0;
+  double encode_sec = 0;
+  double cold_scan_sec = 0;
+  int64_t cold_decompress_nanos = 0;
+  int64_t cold_decode_nanos = 0;
+  double warm_scan_sec = 0;
+  double eval_scan_sec = 0;
+  uint64_t eval_selected_rows = 0;
+  double seek_usec = 0;
+};
+
+class CFileEncodingBenchmark {
+ public:
+  explicit CFileEncodingBenchmark(FsManager* fs_manager)
+      : fs_manager_(fs_manager) {
+  }
+
+  Status Run(const DataSet& data, EncodingType encoding, CompressionType compression,
+             Result* result) {
+    BlockId block_id;
+    RETURN_NOT_OK(Write(data, encoding, compression, &block_id, result));
+    RETURN_NOT_OK(Scan(block_id, data, CFileReader::DONT_CACHE_BLOCK, nullptr,
+                       &result->cold_scan_sec, nullptr, result));
+    // Read the blocks into the cache, then decode them from the cache.
+    RETURN_NOT_OK(Scan(block_id, data, CFileReader::CACHE_BLOCK, nullptr,
+                       &result->warm_scan_sec, nullptr, nullptr));
+    RETURN_NOT_OK(Scan(block_id, data, CFileReader::CACHE_BLOCK, nullptr,
+                       &result->warm_scan_sec, nullptr, nullptr));
+
+    const void* lower;
+    const void* upper;
+    FindPredicateBounds(data, FLAGS_cfile_encoding_predicate_selectivity, &lower, &upper);
+    ColumnSchema col("c", data.type_info->type());
+    ColumnPredicate pred = ColumnPredicate::Range(col, lower, upper);
+    if (pred.predicate_type() == PredicateType::None) {
+      // Too many values are the same as the smallest one.
+      pred = ColumnPredicate::Equality(col, lower);
+    }
+    RETURN_NOT_OK(Scan(block_id, data, CFileReader::CACHE_BLOCK, &pred,
+                       &result->eval_scan_sec, &result->eval_selected_rows, nullptr));
+    RETURN_NOT_OK(Seek(block_id, data, &result->seek_usec));
+    shared_ptr<BlockDeletionTransaction> deletion =
+        fs_manager_->block_manager()->NewDeletionTransaction();
+    deletion->AddDeletedBlock(block_id);
+    vector<BlockId> deleted;
+    return deletion->CommitDeletedBlocks(&deleted);
+  }
+
+ private:
+  Status Write(const DataSet& data, EncodingType encoding, CompressionType compression,
+               BlockId* block_id, Result* result) {
+    unique_ptr<WritableBlock> sink;
+    RETURN_NOT_OK(fs_manager_->CreateNewBlock({}, &sink));
+    *block_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.storage_attributes.encoding = encoding;
+    opts.storage_attributes.compression = compression;
+    opts.storage_attributes.cfile_block_size = FLAGS_cfile_encoding_block_size;
+    CFileWriter writer(opts, data.type_info, false, std::move(sink));
+
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(writer.Start());
+    for (size_t i = 0; i < data.num_rows; i += kBatchRows) {
+      RETURN_NOT_OK(writer.AppendEntries(data.cell(i), std::min(kBatchRows, data.num_rows - i)));
+    }
+    RETURN_NOT_OK(writer.Finish());
+    sw.stop();
+    result->encode_sec = sw.elapsed().wall_seconds();
+
+    unique_ptr<ReadableBlock> source;
+    RETURN_NOT_OK(fs_manager_->OpenBlock(*block_id, &source));
+    return source->Size(&result->file_bytes);
+  }
+
+  Status OpenIterator(const BlockId& block_id, CFileReader::CacheControl cache_control,
+                      unique_ptr<CFileReader>* reader, gscoped_ptr<CFileIterator>* iter) {
+    unique_ptr<ReadableBlock> source;
+    RETURN_NOT_OK(fs_manager_->OpenBlock(block_id, &source));
+    RETURN_NOT_OK(CFileReader::Open(std::move(source), ReaderOptions(), reader));
+    return (*reader)->NewIterator(iter, cache_control, nullptr);
+  }
+
+  // Reads all the rows of the CFile, evaluating 'pred' in the decoders if it
+  // is not null, and sets 'sec' to the time it took. If not null,
+  // 'selected_rows' is set to the number of rows selected by the predicate,
+  // and the decompression and decoding times are set in 'result'.
+  Status Scan(const BlockId& block_id, const DataSet& data,
+              CFileReader::CacheControl cache_control, const ColumnPredicate* pred,
+              double* sec, uint64_t* selected_rows, Result* result) {
+    unique_ptr<CFileReader> reader;
+    gscoped_ptr<CFileIterator> iter;
+    RETURN_NOT_OK(OpenIterator(block_id, cache_control, &reader, &iter));
+
+    Arena arena(32 * 1024);
+    vector<uint8_t> cells(kBatchRows * data.type_info->size());
+    ColumnBlock block(data.type_info, nullptr, cells.data(), kBatchRows, &arena);
+    SelectionVector sel(kBatchRows);
+    uint64_t selected = 0;
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(iter->SeekToOrdinal(0));
+    while (iter->HasNext()) {
+      size_t n = kBatchRows;
+      sel.SetAllTrue();
+      ColumnMaterializationContext ctx(0, pred, &block, &sel);
+      if (!pred) {
+        ctx.SetDecoderEvalNotSupported();
+      }
+      RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+      if (pred) {
+        if (ctx.DecoderEvalNotSupported()) {
+          // The encoding can't evaluate predicates as it decodes, so the
+          // scan evaluates it once the cells are decoded.
+          ColumnBlock decoded(data.type_info, nullptr, cells.data(), n, &arena);
+          SelectionVector decoded_sel(&sel, n);
+          pred->Evaluate(decoded, &decoded_sel);
+        }
+        selected += SelectionVector(&sel, n).CountSelected();
+      }
+      arena.Reset();
+    }
+    sw.stop();
+    *sec = sw.elapsed().wall_seconds();
+    if (selected_rows) {
+      *selected_rows = selected;
+    }
+    if (result) {
+      result->cold_decompress_nanos = iter->io_statistics().decompress_nanos;
+      result->cold_decode_nanos = iter->io_statistics().decode_nanos;
+    }
+    return Status::OK();
+  }
+
+  // Sets 'usec' to the average time to seek to a random row and read it,
+  // from blocks which are in the block cache.
+  Status Seek(const BlockId& block_id, const DataSet& data, double* usec) {
+    unique_ptr<CFileReader> reader;
+    gscoped_ptr<CFileIterator> iter;
+    RETURN_NOT_OK(OpenIterator(block_id, CFileReader::CACHE_BLOCK, &reader, &iter));
+
+    Arena arena(1024);
+    vector<uint8_t> cell(data.type_info->size());
+    ColumnBlock block(data.type_info, nullptr, cell.data(), 1, &arena);
+    SelectionVector sel(1);
+    Random rng(data.num_rows);
+    const int num_seeks = std::max(FLAGS_cfile_encoding_num_seeks, 1);
+    Stopwatch sw;
+    sw.start();
+    for (int i = 0; i < num_seeks; i++) {
+      RETURN_NOT_OK(iter->SeekToOrdinal(rng.Uniform(data.num_rows)));
+      size_t n = 1;
+      ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+      ctx.SetDecoderEvalNotSupported();
+      RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+      arena.Reset();
+    }
+    sw.stop();
+    *usec = sw.elapsed().wall_seconds() * 1000000 / num_seeks;
+    return Status::OK();
+  }
+
+  FsManager* const fs_manager_;
+};
+
+// Prints 'result' as a line of JSON.
+void PrintResult(const DataSet& data, EncodingType encoding, CompressionType compression,
+                 const Result& result) {
+  const double mb = static_cast<double>(data.raw_bytes) / (1024 * 1024);
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("dataset");
+  jw.String(data.name);
+  jw.String("type");
+  jw.String(data.type_info->name());
+  jw.String("encoding");
+  jw.String(EncodingType_Name(encoding));
+  jw.String("compression");
+  jw.String(CompressionType_Name(compression));
+  jw.String("rows");
+  jw.Uint64(data.num_rows);
+  jw.String("raw_bytes");
+  jw.Uint64(data.raw_bytes);
+  jw.String("file_bytes");
+  jw.Uint64(result.file_bytes);
+  jw.String("compression_ratio");
+  jw.Double(static_cast<double>(data.raw_bytes) / result.file_bytes);
+  jw.String("encode_mb_per_sec");
+  jw.Double(mb / result.encode_sec);
+  jw.String("cold_scan_mb_per_sec");
+  jw.Double(mb / result.cold_scan_sec);
+  jw.String("cold_scan_decompress_ms");
+  jw.Double(result.cold_decompress_nanos / 1e6);
+  jw.String("cold_scan_decode_ms");
+  jw.Double(result.cold_decode_nanos / 1e6);
+  jw.String("decode_mb_per_sec");
+  jw.Double(mb / result.warm_scan_sec);
+  jw.String("decode_rows_per_sec");
+  jw.Double(data.num_rows / result.warm_scan_sec);
+  jw.String("eval_rows_per_sec");
+  jw.Double(data.num_rows / result.eval_scan_sec);
+  jw.String("eval_selected_rows");
+  jw.Uint64(result.eval_selected_rows);
+  jw.String("seek_usec");
+  jw.Double(result.seek_usec);
+  jw.EndObject();
+  std::cout << out.str() << std::endl;
+}
+
+template<typename EnumType>
+Status ParseEnumList(const string& list,
+                     bool (*parse)(const string&, EnumType*),
+                     vector<EnumType>* values) {
+  vector<string> names = strings::Split(list, ",", strings::SkipEmpty());
+  for (const string& name : names) {
+    EnumType value;
+    if (!parse(name, &value)) {
+      return Status::InvalidArgument("unknown value", name);
+    }
+    values->push_back(value);
+  }
+  return Status::OK();
+}
+
+Status RunBenchmark() {
+  vector<DataSet> data_sets;
+  vector<string> names = strings::Split(FLAGS_cfile_encoding_datasets, ",",
+                                        strings::SkipEmpty());
+  for (const string& name : names) {
+    data_sets.emplace_back();
+    RETURN_NOT_OK(MakeSyntheticDataSet(name, &data_sets.back()));
+  }
+  if (!FLAGS_cfile_encoding_input_file.empty()) {
+    data_sets.emplace_back();
+    RETURN_NOT_OK(LoadDataSet(FLAGS_cfile_encoding_input_file,
+                              FLAGS_cfile_encoding_input_type, &data_sets.back()));
+  }
+
+  vector<EncodingType> encodings;
+  if (FLAGS_cfile_encoding_encodings.empty()) {
+    for (int e = EncodingType_MIN; e <= EncodingType_MAX; e++) {
+      if (EncodingType_IsValid(e) && e != AUTO_ENCODING && e != UNKNOWN_ENCODING) {
+        encodings.push_back(static_cast<EncodingType>(e));
+      }
+    }
+  } else {
+    RETURN_NOT_OK(ParseEnumList(FLAGS_cfile_encoding_encodings, &EncodingType_Parse,
+                                &encodings));
+  }
+  vector<CompressionType> compressions;
+  RETURN_NOT_OK(ParseEnumList(FLAGS_cfile_encoding_compressions, &CompressionType_Parse,
+                              &compressions));
+
+  Env* env = Env::Default();
+  string fs_root = FLAGS_cfile_encoding_fs_root;
+  const bool delete_fs_root = fs_root.empty();
+  if (delete_fs_root) {
+    RETURN_NOT_OK(env->GetTestDirectory(&fs_root));
+    fs_root = JoinPathSegments(fs_root, Substitute("cfile_encoding-$0", getpid()));
+  }
+  FsManager fs_manager(env, fs_root);
+  RETURN_NOT_OK(fs_manager.CreateInitialFileSystemLayout());
+  RETURN_NOT_OK(fs_manager.Open());
+
+  CFileEncodingBenchmark benchmark(&fs_manager);
+  for (const auto& data : data_sets) {
+    for (EncodingType encoding : encodings) {
+      const TypeEncodingInfo* info;
+      if (!TypeEncodingInfo::Get(data.type_info, encoding, &info).ok()) {
+        // The type doesn't support this encoding.
+        continue;
+      }
+      for (CompressionType compression : compressions) {
+        Result result;
+        RETURN_NOT_OK_PREPEND(benchmark.Run(data, encoding, compression, &result),
+                              Substitute("failed to benchmark $0 with $1 and $2", data.name,
+                                         EncodingType_Name(encoding),
+                                         CompressionType_Name(compression)));
+        PrintResult(data, encoding, compression, result);
+      }
+    }
+  }
+
+  if (delete_fs_root) {
+    WARN_NOT_OK(env->DeleteRecursively(fs_root), "could not delete the benchmark files");
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  FLAGS_logtostderr = 1;
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::Status s = kudu::RunBenchmark();
+  if (!s.ok()) {
+    LOG(ERROR) << s.ToString();
+    return 1;
+  }
+  return 0;
+}
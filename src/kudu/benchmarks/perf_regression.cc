@@ -0,0 +1,786 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Harness to catch performance regressions. It starts an external mini
+// cluster and runs a fixed suite of benchmarks against it:
+//  - insert: 'kudu perf loadgen' inserting rows into a table.
+//  - upsert: 'kudu perf loadgen' upserting the same rows again.
+//  - point_lookup: scans for single rows picked at random by primary key.
+//  - full_scan: scans of all the rows of the table.
+//  - bootstrap: restarting a tablet server until all its tablets are running.
+//  - tablet_copy: 'kudu local_replica copy_from_remote' of all the tablets of
+//    the table into a new tablet server.
+//  - tpch_q1: TPC-H Q1 over the lineitem table, which is loaded from
+//    --perf_regression_tpch_lineitem_file. Skipped if no file is given.
+//  - compaction: compacting a table whose rows were written in random order
+//    while rowset compactions were disabled.
+//
+// The suite runs --perf_regression_num_iterations times, each time on a new
+// cluster, and the results are written as JSON:
+//
+//   {
+//     "schema_version": 1,
+//     "kudu_version": "1.9.0-SNAPSHOT",
+//     "start_time_unix_sec": 1546300800,
+//     "results": [
+//       {
+//         "benchmark": "insert",
+//         "metric": "rows_per_sec",
+//         "higher_is_better": true,
+//         "samples": [101234.5, 99876.5, 100321.0],
+//         "median": 100321.0,
+//         "stddev": 686.1
+//       },
+//       ...
+//     ]
+//   }
+//
+// If --perf_regression_baseline_file points to the results of an earlier run,
+// the medians are compared against it. A metric regressed if its median got
+// worse by more than the larger of --perf_regression_max_regression_pct
+// percent of the baseline and --perf_regression_noise_stddevs standard
+// deviations of the samples, in which case the harness exits with status 2.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <rapidjson/document.h>
+
+#include "kudu/benchmarks/tpch/line_item_tsv_importer.h"
+#include "kudu/benchmarks/tpch/rpc_line_item_dao.h"
+#include "kudu/client/client.h"
+#include "kudu/client/row_result.h"
+#include "kudu/client/scan_batch.h"
+#include "kudu/client/scan_predicate.h"
+#include "kudu/client/schema.h"
+#include "kudu/client/shared_ptr.h"
+#include "kudu/client/value.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/integration-tests/cluster_itest_util.h"
+#include "kudu/mini-cluster/external_mini_cluster.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/jsonreader.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/subprocess.h"
+#include "kudu/util/version_info.h"
+
+DEFINE_string(perf_regression_benchmarks,
+              "insert,upsert,point_lookup,full_scan,bootstrap,tablet_copy,tpch_q1,compaction",
+              "Comma-separated list of the benchmarks to run");
+DEFINE_int32(perf_regression_num_iterations, 3,
+             "Number of times to run the suite, each time on a new cluster. "
+             "More iterations make the comparison against the baseline less "
+             "sensitive to noise");
+DEFINE_int32(perf_regression_num_tablet_servers, 3,
+             "Number of tablet servers of the cluster");
+DEFINE_int32(perf_regression_num_tablets, 6,
+             "Number of hash partitions of the tables the benchmarks write to");
+DEFINE_int64(perf_regression_num_rows, 1000000,
+             "Number of rows written by the insert and upsert benchmarks");
+DEFINE_int32(perf_regression_num_writer_threads, 4,
+             "Number of threads writing rows with 'kudu perf loadgen'");
+DEFINE_int32(perf_regression_num_lookups, 10000,
+             "Number of rows looked up by the point_lookup benchmark");
+DEFINE_int64(perf_regression_compaction_num_rows, 500000,
+             "Number of rows written for the compaction benchmark");
+DEFINE_int32(perf_regression_compaction_quiet_period_sec, 5,
+             "Compactions are considered done once none ran for this long");
+DEFINE_string(perf_regression_tpch_lineitem_file, "",
+              "Path to a lineitem.tbl file generated by TPC-H's dbgen, to "
+              "load for the tpch_q1 benchmark");
+DEFINE_int32(perf_regression_timeout_sec, 600,
+             "Timeout for each wait of the benchmarks, e.g. for the tablets "
+             "of a restarted tablet server to bootstrap");
+DEFINE_string(perf_regression_cluster_root, "/tmp/perf_regression",
+              "Directory for the data of the mini clusters. Deleted before "
+              "each iteration");
+DEFINE_string(perf_regression_output_file, "",
+              "File to write the results to. Defaults to the standard output");
+DEFINE_string(perf_regression_baseline_file, "",
+              "Results of an earlier run to compare the results against");
+DEFINE_double(perf_regression_max_regression_pct, 5.0,
+              "Smallest change of a median, in percent of the baseline, "
+              "reported as a regression");
+DEFINE_double(perf_regression_noise_stddevs, 2.0,
+              "Smallest change of a median, in standard deviations of the "
+              "samples of the results or of the baseline (whichever is "
+              "larger), reported as a regression");
+
+METRIC_DECLARE_entity(server);
+METRIC_DECLARE_entity(tablet);
+METRIC_DECLARE_counter(tablet_copy_bytes_sent);
+METRIC_DECLARE_gauge_uint32(compact_rs_running);
+METRIC_DECLARE_histogram(compact_rs_duration);
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+
+using client::KuduClient;
+using client::KuduColumnSchema;
+using client::KuduPredicate;
+using client::KuduRowResult;
+using client::KuduScanBatch;
+using client::KuduScanToken;
+using client::KuduScanTokenBuilder;
+using client::KuduScanner;
+using client::KuduSchema;
+using client::KuduSchemaBuilder;
+using client::KuduTable;
+using client::KuduTableCreator;
+using client::KuduValue;
+using cluster::ExternalMiniCluster;
+using cluster::ExternalMiniClusterOptions;
+using cluster::ExternalTabletServer;
+using itest::GetInt64Metric;
+using strings::Substitute;
+
+namespace {
+
+const int kSchemaVersion = 1;
+const char* const kTableName = "perf_regression";
+const char* const kCompactionTableName = "perf_regression_compaction";
+const char* const kKeyColumn = "key";
+
+// The samples of a metric of a benchmark, one per iteration.
+struct Metric {
+  string benchmark;
+  string name;
+  bool higher_is_better;
+  vector<double> samples;
+
+  double Median() const {
+    vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    return n % 2 == 1 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+  }
+
+  double Stddev() const {
+    if (samples.size() < 2) {
+      return 0;
+    }
+    double mean = 0;
+    for (double s : samples) {
+      mean += s;
+    }
+    mean /= samples.size();
+    double sum_squares = 0;
+    for (double s : samples) {
+      sum_squares += (s - mean) * (s - mean);
+    }
+    return sqrt(sum_squares / (samples.size() - 1));
+  }
+};
+
+// A replica of a tablet and the tablet server hosting it.
+struct ReplicaLocation {
+  string tablet_id;
+  ExternalTabletServer* ts;
+};
+
+class PerfRegressionHarness {
+ public:
+  PerfRegressionHarness() {
+    vector<string> names = strings::Split(FLAGS_perf_regression_benchmarks, ",",
+                                          strings::SkipEmpty());
+    benchmarks_.insert(names.begin(), names.end());
+  }
+
+  // Runs all the iterations of the suite.
+  Status Run() {
+    if (FLAGS_perf_regression_num_iterations < 1) {
+      return Status::InvalidArgument("--perf_regression_num_iterations must be positive");
+    }
+    for (int i = 0; i < FLAGS_perf_regression_num_iterations; i++) {
+      LOG(INFO) << "Running iteration " << i + 1 << " of "
+                << FLAGS_perf_regression_num_iterations;
+      RETURN_NOT_OK_PREPEND(RunIteration(), Substitute("iteration $0 failed", i + 1));
+    }
+    return Status::OK();
+  }
+
+  const vector<Metric>& metrics() const {
+    return metrics_;
+  }
+
+ private:
+  bool Enabled(const string& benchmark) const {
+    return ContainsKey(benchmarks_, benchmark);
+  }
+
+  Status RunIteration() {
+    Env* env = Env::Default();
+    const string& root = FLAGS_perf_regression_cluster_root;
+    if (env->FileExists(root)) {
+      RETURN_NOT_OK(env->DeleteRecursively(root));
+    }
+    RETURN_NOT_OK(env->CreateDir(root));
+
+    ExternalMiniClusterOptions opts;
+    opts.num_tablet_servers = FLAGS_perf_regression_num_tablet_servers;
+    opts.cluster_root = root;
+    cluster_.reset(new ExternalMiniCluster(std::move(opts)));
+    RETURN_NOT_OK(cluster_->Start());
+    master_address_ = cluster_->master()->bound_rpc_addr().ToString();
+    RETURN_NOT_OK(cluster_->CreateClient(nullptr, &client_));
+
+    // All the benchmarks but tpch_q1 and compaction need the rows written by
+    // the insert benchmark, so they're written even if it's disabled.
+    static const vector<string> kBenchmarksOnTable = {
+      "insert", "upsert", "point_lookup", "full_scan", "bootstrap", "tablet_copy"
+    };
+    if (std::any_of(kBenchmarksOnTable.begin(), kBenchmarksOnTable.end(),
+                    [&](const string& b) { return Enabled(b); })) {
+      RETURN_NOT_OK(CreateTable(kTableName));
+      RETURN_NOT_OK_PREPEND(RunWriteBenchmark("insert", false /* upsert */),
+                            "insert benchmark failed");
+    }
+    if (Enabled("upsert")) {
+      RETURN_NOT_OK_PREPEND(RunWriteBenchmark("upsert", true /* upsert */),
+                            "upsert benchmark failed");
+    }
+    if (Enabled("point_lookup")) {
+      RETURN_NOT_OK_PREPEND(RunPointLookupBenchmark(), "point_lookup benchmark failed");
+    }
+    if (Enabled("full_scan")) {
+      RETURN_NOT_OK_PREPEND(RunFullScanBenchmark(), "full_scan benchmark failed");
+    }
+    if (Enabled("bootstrap")) {
+      RETURN_NOT_OK_PREPEND(RunBootstrapBenchmark(), "bootstrap benchmark failed");
+    }
+    if (Enabled("tablet_copy")) {
+      RETURN_NOT_OK_PREPEND(RunTabletCopyBenchmark(), "tablet_copy benchmark failed");
+    }
+    if (Enabled("tpch_q1")) {
+      if (FLAGS_perf_regression_tpch_lineitem_file.empty()) {
+        LOG(WARNING) << "Skipping the tpch_q1 benchmark: "
+                     << "--perf_regression_tpch_lineitem_file is not set";
+      } else {
+        RETURN_NOT_OK_PREPEND(RunTpchQ1Benchmark(), "tpch_q1 benchmark failed");
+      }
+    }
+    // The compaction benchmark lowers the flush threshold of the tablet
+    // servers, so it runs last.
+    if (Enabled("compaction")) {
+      RETURN_NOT_OK_PREPEND(RunCompactionBenchmark(), "compaction benchmark failed");
+    }
+
+    client_.reset();
+    cluster_->Shutdown();
+    cluster_.reset();
+    return Status::OK();
+  }
+
+  // Adds a sample of the metric 'name' of 'benchmark' for this iteration.
+  void AddSample(const string& benchmark, const string& name, bool higher_is_better,
+                 double value) {
+    LOG(INFO) << Substitute("$0.$1: $2", benchmark, name, value);
+    for (auto& m : metrics_) {
+      if (m.benchmark == benchmark && m.name == name) {
+        m.samples.push_back(value);
+        return;
+      }
+    }
+    metrics_.push_back({ benchmark, name, higher_is_better, { value } });
+  }
+
+  Status CreateTable(const string& table_name) {
+    KuduSchema schema;
+    KuduSchemaBuilder b;
+    b.AddColumn(kKeyColumn)->Type(KuduColumnSchema::INT64)->NotNull()->PrimaryKey();
+    b.AddColumn("int_val")->Type(KuduColumnSchema::INT32)->NotNull();
+    b.AddColumn("double_val")->Type(KuduColumnSchema::DOUBLE)->NotNull();
+    b.AddColumn("string_val")->Type(KuduColumnSchema::STRING)->NotNull();
+    RETURN_NOT_OK(b.Build(&schema));
+    unique_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+    return table_creator->table_name(table_name)
+        .schema(&schema)
+        .add_hash_partitions({ kKeyColumn }, FLAGS_perf_regression_num_tablets)
+        .num_replicas(std::min(3, FLAGS_perf_regression_num_tablet_servers))
+        .Create();
+  }
+
+  // Writes 'num_rows' rows into 'table_name' with 'kudu perf loadgen',
+  // setting 'sec' to the time it took.
+  Status RunLoadgen(const string& table_name, int64_t num_rows, bool upsert, bool random,
+                    double* sec) {
+    const int num_threads = FLAGS_perf_regression_num_writer_threads;
+    vector<string> argv = {
+      cluster_->GetBinaryPath("kudu"),
+      "perf",
+      "loadgen",
+      master_address_,
+      "--table_name=" + table_name,
+      Substitute("--num_threads=$0", num_threads),
+      Substitute("--num_rows_per_thread=$0", (num_rows + num_threads - 1) / num_threads),
+    };
+    if (upsert) {
+      argv.emplace_back("--use_upsert");
+    }
+    if (random) {
+      argv.emplace_back("--use_random");
+    }
+    string out;
+    string err;
+    Stopwatch sw;
+    sw.start();
+    Status s = Subprocess::Call(argv, "", &out, &err);
+    sw.stop();
+    RETURN_NOT_OK_PREPEND(s, Substitute("loadgen failed: $0", err));
+    *sec = sw.elapsed().wall_seconds();
+    return Status::OK();
+  }
+
+  Status RunWriteBenchmark(const string& benchmark, bool upsert) {
+    double sec;
+    RETURN_NOT_OK(RunLoadgen(kTableName, FLAGS_perf_regression_num_rows, upsert,
+                             false /* random */, &sec));
+    if (Enabled(benchmark)) {
+      AddSample(benchmark, "rows_per_sec", true, FLAGS_perf_regression_num_rows / sec);
+    }
+    return Status::OK();
+  }
+
+  Status RunPointLookupBenchmark() {
+    client::sp::shared_ptr<KuduTable> table;
+    RETURN_NOT_OK(client_->OpenTable(kTableName, &table));
+
+    // Pick the keys to look up from the keys of the table.
+    vector<int64_t> keys;
+    {
+      KuduScanner scanner(table.get());
+      RETURN_NOT_OK(scanner.SetProjectedColumnNames({ kKeyColumn }));
+      RETURN_NOT_OK(scanner.Open());
+      KuduScanBatch batch;
+      while (scanner.HasMoreRows()) {
+        RETURN_NOT_OK(scanner.NextBatch(&batch));
+        for (const auto& row : batch) {
+          int64_t key;
+          RETURN_NOT_OK(row.GetInt64(0, &key));
+          keys.push_back(key);
+        }
+      }
+    }
+    if (keys.empty()) {
+      return Status::IllegalState("no rows to look up");
+    }
+
+    Random rng(FLAGS_perf_regression_num_lookups);
+    HdrHistogram latency_us(60 * 1000 * 1000, 2);
+    Stopwatch sw;
+    sw.start();
+    for (int i = 0; i < FLAGS_perf_regression_num_lookups; i++) {
+      const int64_t key = keys[rng.Uniform(keys.size())];
+      MonoTime start = MonoTime::Now();
+      KuduScanner scanner(table.get());
+      RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+          kKeyColumn, KuduPredicate::EQUAL, KuduValue::FromInt(key))));
+      RETURN_NOT_OK(scanner.Open());
+      int num_rows = 0;
+      KuduScanBatch batch;
+      while (scanner.HasMoreRows()) {
+        RETURN_NOT_OK(scanner.NextBatch(&batch));
+        num_rows += batch.NumRows();
+      }
+      if (num_rows != 1) {
+        return Status::Corruption(Substitute("found $0 rows with key $1", num_rows, key));
+      }
+      latency_us.Increment((MonoTime::Now() - start).ToMicroseconds());
+    }
+    sw.stop();
+    AddSample("point_lookup", "lookups_per_sec", true,
+              FLAGS_perf_regression_num_lookups / sw.elapsed().wall_seconds());
+    AddSample("point_lookup", "p99_latency_usec", false, latency_us.ValueAtPercentile(99));
+    return Status::OK();
+  }
+
+  Status RunFullScanBenchmark() {
+    client::sp::shared_ptr<KuduTable> table;
+    RETURN_NOT_OK(client_->OpenTable(kTableName, &table));
+    int64_t num_rows = 0;
+    Stopwatch sw;
+    sw.start();
+    KuduScanner scanner(table.get());
+    RETURN_NOT_OK(scanner.Open());
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      RETURN_NOT_OK(scanner.NextBatch(&batch));
+      num_rows += batch.NumRows();
+    }
+    sw.stop();
+    AddSample("full_scan", "rows_per_sec", true, num_rows / sw.elapsed().wall_seconds());
+    return Status::OK();
+  }
+
+  Status GetReplicas(const string& table_name, vector<ReplicaLocation>* replicas) {
+    client::sp::shared_ptr<KuduTable> table;
+    RETURN_NOT_OK(client_->OpenTable(table_name, &table));
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    RETURN_NOT_OK(builder.Build(&tokens));
+    for (const KuduScanToken* token : tokens) {
+      for (const auto* replica : token->tablet().replicas()) {
+        ExternalTabletServer* ts = cluster_->tablet_server_by_uuid(replica->ts().uuid());
+        if (ts == nullptr) {
+          return Status::NotFound("unknown tablet server", replica->ts().uuid());
+        }
+        replicas->push_back({ token->tablet().id(), ts });
+      }
+    }
+    return Status::OK();
+  }
+
+  Status RunBootstrapBenchmark() {
+    vector<ReplicaLocation> replicas;
+    RETURN_NOT_OK(GetReplicas(kTableName, &replicas));
+    ExternalTabletServer* ts = cluster_->tablet_server(0);
+    const int num_tablets = std::count_if(replicas.begin(), replicas.end(),
+                                          [&](const ReplicaLocation& r) { return r.ts == ts; });
+    ts->Shutdown();
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(ts->Restart());
+    RETURN_NOT_OK(cluster_->WaitForTabletsRunning(
+        ts, num_tablets, MonoDelta::FromSeconds(FLAGS_perf_regression_timeout_sec)));
+    sw.stop();
+    AddSample("bootstrap", "sec", false, sw.elapsed().wall_seconds());
+    return Status::OK();
+  }
+
+  Status GetTabletCopyBytesSent(ExternalTabletServer* ts, int64_t* bytes) {
+    return GetInt64Metric(ts->bound_http_hostport(), &METRIC_ENTITY_server, "kudu.tabletserver",
+                          &METRIC_tablet_copy_bytes_sent, "value", bytes);
+  }
+
+  Status RunTabletCopyBenchmark() {
+    vector<ReplicaLocation> replicas;
+    RETURN_NOT_OK(GetReplicas(kTableName, &replicas));
+
+    // Copy the tablets into a new tablet server, which is shut down so that
+    // the tablets can be copied into its file system.
+    RETURN_NOT_OK(cluster_->AddTabletServer());
+    ExternalTabletServer* dst = cluster_->tablet_server(cluster_->num_tablet_servers() - 1);
+    dst->Shutdown();
+
+    map<ExternalTabletServer*, int64_t> bytes_sent_before;
+    for (const auto& r : replicas) {
+      RETURN_NOT_OK(GetTabletCopyBytesSent(r.ts, &bytes_sent_before[r.ts]));
+    }
+    set<string> copied_tablets;
+    Stopwatch sw;
+    sw.start();
+    for (const auto& r : replicas) {
+      if (!InsertIfNotPresent(&copied_tablets, r.tablet_id)) {
+        continue;
+      }
+      vector<string> argv = {
+        cluster_->GetBinaryPath("kudu"),
+        "local_replica",
+        "copy_from_remote",
+        "--fs_wal_dir=" + dst->wal_dir(),
+        "--fs_data_dirs=" + JoinStrings(dst->data_dirs(), ","),
+        r.tablet_id,
+        r.ts->bound_rpc_hostport().ToString(),
+      };
+      string err;
+      RETURN_NOT_OK_PREPEND(Subprocess::Call(argv, "", nullptr, &err),
+                            Substitute("copy of tablet $0 failed: $1", r.tablet_id, err));
+    }
+    sw.stop();
+
+    int64_t bytes_sent = 0;
+    for (const auto& entry : bytes_sent_before) {
+      int64_t bytes;
+      RETURN_NOT_OK(GetTabletCopyBytesSent(entry.first, &bytes));
+      bytes_sent += bytes - entry.second;
+    }
+    const double sec = sw.elapsed().wall_seconds();
+    AddSample("tablet_copy", "sec", false, sec);
+    AddSample("tablet_copy", "mb_per_sec", true, bytes_sent / (1024.0 * 1024.0) / sec);
+    return Status::OK();
+  }
+
+  Status RunTpchQ1Benchmark() {
+    RpcLineItemDAO dao(master_address_, "lineitem", 1000 /* batch_op_num_max */,
+                       FLAGS_perf_regression_timeout_sec * 1000, RpcLineItemDAO::HASH,
+                       FLAGS_perf_regression_num_tablets);
+    dao.Init();
+    LineItemTsvImporter importer(FLAGS_perf_regression_tpch_lineitem_file);
+    boost::function<void(KuduPartialRow*)> f =
+        boost::bind(&LineItemTsvImporter::GetNextLine, &importer, _1);
+    while (importer.HasNextLine()) {
+      dao.WriteLine(f);
+    }
+    dao.FinishWriting();
+
+    Stopwatch sw;
+    sw.start();
+    gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
+    dao.OpenTpch1Scanner(&scanner);
+    vector<KuduRowResult> rows;
+    while (scanner->HasMore()) {
+      scanner->GetNext(&rows);
+    }
+    sw.stop();
+    AddSample("tpch_q1", "query_sec", false, sw.elapsed().wall_seconds());
+    return Status::OK();
+  }
+
+  // Sets the flag 'flag' to 'value' on all the tablet servers.
+  Status SetTabletServerFlag(const string& flag, const string& value) {
+    for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+      ExternalTabletServer* ts = cluster_->tablet_server(i);
+      if (ts->IsProcessAlive()) {
+        RETURN_NOT_OK(cluster_->SetFlag(ts, flag, value));
+      }
+    }
+    return Status::OK();
+  }
+
+  Status RunCompactionBenchmark() {
+    // Flush often while compactions are disabled, so that the tablets end up
+    // with many rowsets whose key ranges overlap.
+    RETURN_NOT_OK(SetTabletServerFlag("enable_rowset_compaction", "false"));
+    RETURN_NOT_OK(SetTabletServerFlag("flush_threshold_mb", "1"));
+    RETURN_NOT_OK(CreateTable(kCompactionTableName));
+    double write_sec;
+    RETURN_NOT_OK(RunLoadgen(kCompactionTableName, FLAGS_perf_regression_compaction_num_rows,
+                             false /* upsert */, true /* random */, &write_sec));
+    vector<ReplicaLocation> replicas;
+    RETURN_NOT_OK(GetReplicas(kCompactionTableName, &replicas));
+
+    // Compactions are done once none is running and none completed for the
+    // quiet period. The quiet period itself isn't part of the measured time.
+    RETURN_NOT_OK(SetTabletServerFlag("enable_rowset_compaction", "true"));
+    const MonoTime start = MonoTime::Now();
+    const MonoTime deadline = start + MonoDelta::FromSeconds(FLAGS_perf_regression_timeout_sec);
+    const MonoDelta quiet_period =
+        MonoDelta::FromSeconds(FLAGS_perf_regression_compaction_quiet_period_sec);
+    MonoTime last_completed = start;
+    int64_t last_num_completed = 0;
+    while (true) {
+      int64_t num_completed = 0;
+      int64_t num_running = 0;
+      for (const auto& r : replicas) {
+        int64_t value;
+        RETURN_NOT_OK(GetInt64Metric(r.ts->bound_http_hostport(), &METRIC_ENTITY_tablet,
+                                     r.tablet_id.c_str(), &METRIC_compact_rs_duration,
+                                     "total_count", &value));
+        num_completed += value;
+        RETURN_NOT_OK(GetInt64Metric(r.ts->bound_http_hostport(), &METRIC_ENTITY_tablet,
+                                     r.tablet_id.c_str(), &METRIC_compact_rs_running,
+                                     "value", &value));
+        num_running += value;
+      }
+      const MonoTime now = MonoTime::Now();
+      if (num_completed != last_num_completed) {
+        last_num_completed = num_completed;
+        last_completed = now;
+      }
+      if (num_running == 0 && now - last_completed > quiet_period) {
+        break;
+      }
+      if (now > deadline) {
+        return Status::TimedOut("timed out waiting for compactions to complete");
+      }
+      SleepFor(MonoDelta::FromMilliseconds(100));
+    }
+    if (last_num_completed == 0) {
+      return Status::IllegalState("no compactions ran");
+    }
+    const double sec = (last_completed - start).ToSeconds();
+    AddSample("compaction", "sec", false, sec);
+    AddSample("compaction", "rows_per_sec", true,
+              FLAGS_perf_regression_compaction_num_rows / sec);
+    return Status::OK();
+  }
+
+  set<string> benchmarks_;
+  unique_ptr<ExternalMiniCluster> cluster_;
+  string master_address_;
+  client::sp::shared_ptr<KuduClient> client_;
+  vector<Metric> metrics_;
+};
+
+string ResultsToJson(const vector<Metric>& metrics, int64_t start_time) {
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::PRETTY);
+  jw.StartObject();
+  jw.String("schema_version");
+  jw.Int(kSchemaVersion);
+  jw.String("kudu_version");
+  jw.String(VersionInfo::GetShortVersionInfo());
+  jw.String("start_time_unix_sec");
+  jw.Int64(start_time);
+  jw.String("results");
+  jw.StartArray();
+  for (const auto& m : metrics) {
+    jw.StartObject();
+    jw.String("benchmark");
+    jw.String(m.benchmark);
+    jw.String("metric");
+    jw.String(m.name);
+    jw.String("higher_is_better");
+    jw.Bool(m.higher_is_better);
+    jw.String("samples");
+    jw.StartArray();
+    for (double s : m.samples) {
+      jw.Double(s);
+    }
+    jw.EndArray();
+    jw.String("median");
+    jw.Double(m.Median());
+    jw.String("stddev");
+    jw.Double(m.Stddev());
+    jw.EndObject();
+  }
+  jw.EndArray();
+  jw.EndObject();
+  out << std::endl;
+  return out.str();
+}
+
+// Compares the medians of 'metrics' against those of the baseline at
+// 'baseline_path', setting 'regressed' if any of them regressed.
+Status CompareToBaseline(const vector<Metric>& metrics, const string& baseline_path,
+                         bool* regressed) {
+  faststring contents;
+  RETURN_NOT_OK(ReadFileToString(Env::Default(), baseline_path, &contents));
+  JsonReader reader(contents.ToString());
+  RETURN_NOT_OK_PREPEND(reader.Init(), "could not parse the baseline");
+  int32_t schema_version;
+  RETURN_NOT_OK(reader.ExtractInt32(reader.root(), "schema_version", &schema_version));
+  if (schema_version != kSchemaVersion) {
+    return Status::NotSupported(Substitute("baseline has schema version $0, expected $1",
+                                           schema_version, kSchemaVersion));
+  }
+  vector<const rapidjson::Value*> results;
+  RETURN_NOT_OK(reader.ExtractObjectArray(reader.root(), "results", &results));
+  map<pair<string, string>, pair<double, double>> baseline;
+  for (const auto* result : results) {
+    string benchmark;
+    string metric;
+    double median;
+    double stddev;
+    RETURN_NOT_OK(reader.ExtractString(result, "benchmark", &benchmark));
+    RETURN_NOT_OK(reader.ExtractString(result, "metric", &metric));
+    RETURN_NOT_OK(reader.ExtractDouble(result, "median", &median));
+    RETURN_NOT_OK(reader.ExtractDouble(result, "stddev", &stddev));
+    baseline[{ benchmark, metric }] = { median, stddev };
+  }
+
+  *regressed = false;
+  for (const auto& m : metrics) {
+    const auto* base = FindOrNull(baseline, std::make_pair(m.benchmark, m.name));
+    if (base == nullptr) {
+      LOG(INFO) << Substitute("$0.$1: not in the baseline", m.benchmark, m.name);
+      continue;
+    }
+    const double base_median = base->first;
+    const double median = m.Median();
+    const double tolerance =
+        std::max(FLAGS_perf_regression_max_regression_pct / 100 * fabs(base_median),
+                 FLAGS_perf_regression_noise_stddevs * std::max(base->second, m.Stddev()));
+    const double worse_by = m.higher_is_better ? base_median - median : median - base_median;
+    const string msg = Substitute("$0.$1: median $2 vs. $3 in the baseline "
+                                  "($4% change, tolerance $5%)",
+                                  m.benchmark, m.name, median, base_median,
+                                  (median - base_median) / base_median * 100,
+                                  tolerance / fabs(base_median) * 100);
+    if (worse_by > tolerance) {
+      LOG(ERROR) << "REGRESSION: " << msg;
+      *regressed = true;
+    } else {
+      LOG(INFO) << msg;
+    }
+  }
+  return Status::OK();
+}
+
+Status RunHarness(bool* regressed) {
+  const int64_t start_time = time(nullptr);
+  PerfRegressionHarness harness;
+  RETURN_NOT_OK(harness.Run());
+
+  const string json = ResultsToJson(harness.metrics(), start_time);
+  if (FLAGS_perf_regression_output_file.empty()) {
+    std::cout << json;
+  } else {
+    RETURN_NOT_OK(WriteStringToFile(Env::Default(), json, FLAGS_perf_regression_output_file));
+  }
+
+  *regressed = false;
+  if (!FLAGS_perf_regression_baseline_file.empty()) {
+    RETURN_NOT_OK_PREPEND(CompareToBaseline(harness.metrics(),
+                                            FLAGS_perf_regression_baseline_file, regressed),
+                          "could not compare against the baseline");
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+} // namespace kudu
+
+int main(int argc, char* argv[]) {
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  bool regressed;
+  kudu::Status s = kudu::RunHarness(&regressed);
+  if (!s.ok()) {
+    std::cerr << "Performance regression harness failed: " << s.ToString() << std::endl;
+    return 1;
+  }
+  return regressed ? 2 : 0;
+}
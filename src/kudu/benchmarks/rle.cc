@@ -16,12 +16,15 @@
 // under the License.
 //
 // Micro benchmark for writing/reading bit streams and Kudu specific
-// run-length encoding (RLE) APIs. Currently only covers booleans and
-// the most performance sensitive APIs. NB: Impala contains a RLE
+// run-length encoding (RLE) APIs. Currently only covers booleans,
+// bit-packed integers and the most performance sensitive APIs. NB: Impala contains a RLE
 // micro benchmark (rle-benchmark.cc).
 //
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <ostream>
 
 #include <gflags/gflags.h>
@@ -38,6 +41,9 @@
 
 DEFINE_int32(bitstream_num_bytes, 1 * 1024 * 1024,
              "Number of bytes worth of bits to write and read from the bitstream");
+DEFINE_int32(rle_num_values, 16 * 1024 * 1024,
+             "Number of bit-packed values to encode and decode for the RLE "
+             "integer benchmarks");
 
 namespace kudu {
 
@@ -101,6 +107,55 @@ void BooleanRLE() {
   }
 }
 
+// Measure decoding of RLE-encoded values of the given bit width, both one
+// value at a time and in batches, and report the throughput of each. The
+// values are low-cardinality and rarely repeat, so most of them end up in
+// bit-packed literal runs.
+template<typename T>
+void IntegerRLE(int bit_width) {
+  const int num_values = FLAGS_rle_num_values;
+  const uint64_t cardinality = std::min<uint64_t>(16, 1ULL << bit_width);
+
+  faststring buffer;
+  RleEncoder<T> encoder(&buffer, bit_width);
+  for (int i = 0; i < num_values; i++) {
+    encoder.Put(static_cast<T>((i * 7 + i / 3) % cardinality));
+  }
+  encoder.Flush();
+  LOG(INFO) << "Wrote " << encoder.len() << " bytes for " << num_values
+            << " values of width " << bit_width;
+
+  // Not a vector, since std::vector<bool> is bit-packed.
+  std::unique_ptr<T[]> decoded(new T[num_values]);
+  Stopwatch scalar_sw;
+  scalar_sw.start();
+  {
+    RleDecoder<T> decoder(buffer.data(), encoder.len(), bit_width);
+    for (int i = 0; i < num_values; i++) {
+      ignore_result(decoder.Get(&decoded[i]));
+    }
+  }
+  scalar_sw.stop();
+  LOG(INFO) << "Width " << bit_width << ", one value at a time: "
+            << static_cast<int64_t>(num_values / scalar_sw.elapsed().wall_seconds())
+            << " values/sec";
+
+  // Decode in batches of the size that CFile iterators typically request.
+  const int kBatchSize = 1024;
+  Stopwatch batch_sw;
+  batch_sw.start();
+  {
+    RleDecoder<T> decoder(buffer.data(), encoder.len(), bit_width);
+    for (int i = 0; i < num_values; i += kBatchSize) {
+      ignore_result(decoder.GetBatch(&decoded[i], std::min(kBatchSize, num_values - i)));
+    }
+  }
+  batch_sw.stop();
+  LOG(INFO) << "Width " << bit_width << ", batched: "
+            << static_cast<int64_t>(num_values / batch_sw.elapsed().wall_seconds())
+            << " values/sec";
+}
+
 } // namespace kudu
 
 int main(int argc, char **argv) {
@@ -116,5 +171,11 @@ int main(int argc, char **argv) {
     kudu::BooleanRLE();
   }
 
+  kudu::IntegerRLE<bool>(1);
+  kudu::IntegerRLE<uint8_t>(3);
+  kudu::IntegerRLE<uint8_t>(8);
+  kudu::IntegerRLE<uint16_t>(16);
+  kudu::IntegerRLE<uint32_t>(32);
+
   return 0;
 }
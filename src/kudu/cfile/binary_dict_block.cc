@@ -205,7 +205,27 @@ BinaryDictBlockDecoder::BinaryDictBlockDecoder(Slice slice, CFileIterator* iter)
     : data_(slice),
       parsed_(false),
       dict_decoder_(iter->GetDictDecoder()),
-      parent_cfile_iter_(iter) {
+      parent_cfile_iter_(iter),
+      zero_copy_(false) {
+}
+
+inline void BinaryDictBlockDecoder::OutputString(uint32_t codeword, Slice* out,
+                                                 Arena* out_arena) const {
+  Slice elem = dict_decoder_->string_at_index(codeword);
+  if (zero_copy_) {
+    *out = elem;
+  } else {
+    CHECK(out_arena->RelocateSlice(elem, out));
+  }
+}
+
+bool BinaryDictBlockDecoder::EnableZeroCopy() {
+  DCHECK(parsed_);
+  if (mode_ == kPlainBinaryMode) {
+    return data_decoder_->EnableZeroCopy();
+  }
+  zero_copy_ = true;
+  return true;
 }
 
 Status BinaryDictBlockDecoder::ParseHeader() {
@@ -311,7 +331,7 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
     if (BitmapTest(codewords_matching_pred->bitmap(), codeword)) {
       // Row is included in predicate, copy data to block.
-      CHECK(out_arena->RelocateSlice(dict_decoder_->string_at_index(codeword), out));
+      OutputString(codeword, out, out_arena);
     } else {
       // Mark that the row will not be returned.
       sel->ClearBit(i);
@@ -338,8 +358,7 @@ Status BinaryDictBlockDecoder::CopyNextDecodeStrings(size_t* n, ColumnDataView*
 
   for (int i = 0; i < *n; i++) {
     uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
-    Slice elem = dict_decoder_->string_at_index(codeword);
-    CHECK(out_arena->RelocateSlice(elem, out));
+    OutputString(codeword, out, out_arena);
     out++;
   }
   return Status::OK();
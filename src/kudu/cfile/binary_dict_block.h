@@ -167,11 +167,19 @@ class BinaryDictBlockDecoder final : public BlockDecoder {
     return data_decoder_->GetFirstRowId();
   }
 
+  // In codeword mode, the output cells reference the dictionary block's data,
+  // which must then be kept alive along with this block's.
+  virtual bool EnableZeroCopy() OVERRIDE;
+
   static const size_t kMinHeaderSize = sizeof(uint32_t) * 1;
 
  private:
   Status CopyNextDecodeStrings(size_t* n, ColumnDataView* dst);
 
+  // Sets '*out' to the string of codeword 'codeword', either referencing the
+  // dictionary block's data or copied into 'out_arena'.
+  void OutputString(uint32_t codeword, Slice* out, Arena* out_arena) const;
+
   Slice data_;
   bool parsed_;
 
@@ -189,6 +197,10 @@ class BinaryDictBlockDecoder final : public BlockDecoder {
   // buffer to hold the codewords, needed by CopyNextDecodeStrings()
   faststring codeword_buf_;
 
+  // Whether the output cells reference the dictionary block's data (see
+  // EnableZeroCopy()).
+  bool zero_copy_;
+
 };
 
 } // namespace cfile
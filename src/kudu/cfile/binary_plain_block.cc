@@ -163,7 +163,8 @@ BinaryPlainBlockDecoder::BinaryPlainBlockDecoder(Slice slice)
       parsed_(false),
       num_elems_(0),
       ordinal_pos_base_(0),
-      cur_idx_(0) {
+      cur_idx_(0),
+      zero_copy_(false) {
 }
 
 Status BinaryPlainBlockDecoder::ParseHeader() {
@@ -284,6 +285,15 @@ Status BinaryPlainBlockDecoder::SeekAtOrAfterValue(const void *value_void, bool
   return Status::OK();
 }
 
+inline void BinaryPlainBlockDecoder::OutputCell(const Slice& elem, Slice* out,
+                                                Arena* out_arena) const {
+  if (zero_copy_) {
+    *out = elem;
+  } else {
+    CHECK(out_arena->RelocateSlice(elem, out));
+  }
+}
+
 template <typename CellHandler>
 Status BinaryPlainBlockDecoder::HandleBatch(size_t* n, ColumnDataView* dst, CellHandler c) {
   DCHECK(parsed_);
@@ -308,7 +318,7 @@ Status BinaryPlainBlockDecoder::HandleBatch(size_t* n, ColumnDataView* dst, Cell
 
 Status BinaryPlainBlockDecoder::CopyNextValues(size_t* n, ColumnDataView* dst) {
   return HandleBatch(n, dst, [&](size_t i, Slice elem, Slice* out, Arena* out_arena) {
-    CHECK(out_arena->RelocateSlice(elem, out));
+    OutputCell(elem, out, out_arena);
   });
 }
 
@@ -321,7 +331,7 @@ Status BinaryPlainBlockDecoder::CopyNextAndEval(size_t* n,
     if (!sel->TestBit(i)) {
       return;
     } else if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void*>(&elem))) {
-      CHECK(out_arena->RelocateSlice(elem, out));
+      OutputCell(elem, out, out_arena);
     } else {
       sel->ClearBit(i);
     }
@@ -42,6 +42,7 @@
 #include "kudu/common/rowid.h"
 #include "kudu/gutil/port.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -137,6 +138,12 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
     return ordinal_pos_base_;
   }
 
+  virtual bool EnableZeroCopy() OVERRIDE {
+    DCHECK(parsed_);
+    zero_copy_ = true;
+    return true;
+  }
+
   Slice string_at_index(size_t idx) const {
     const uint32_t str_offset = offset(idx);
     uint32_t len = offset(idx + 1) - str_offset;
@@ -155,6 +162,10 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
   template <typename CellHandler>
   Status HandleBatch(size_t* n, ColumnDataView* dst, CellHandler c);
 
+  // Sets '*out' to the cell 'elem', either referencing the block's data or
+  // copied into 'out_arena', depending on whether zero-copy is enabled.
+  void OutputCell(const Slice& elem, Slice* out, Arena* out_arena) const;
+
   // Return the offset within 'data_' where the string value with index 'idx'
   // can be found.
   uint32_t offset(int idx) const {
@@ -183,6 +194,10 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
 
   // Index of the currently seeked element in the block.
   uint32_t cur_idx_;
+
+  // Whether the output cells reference the block's data (see
+  // EnableZeroCopy()).
+  bool zero_copy_;
 };
 
 } // namespace cfile
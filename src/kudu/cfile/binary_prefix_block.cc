@@ -30,6 +30,7 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/bits.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/fastmem.h"
@@ -344,42 +345,105 @@ void BinaryPrefixBlockDecoder::SeekToRestartPoint(uint32_t idx) {
   CHECK_OK(ParseNextValue()); // TODO: handle corrupted blocks
 }
 
-Status BinaryPrefixBlockDecoder::SeekAtOrAfterValue(const void *value_void,
-                                              bool *exact_match) {
-  DCHECK(value_void != nullptr);
+namespace {
 
-  const Slice &target = *reinterpret_cast<const Slice *>(value_void);
+// Returns the length of the common prefix of the 'n' bytes at 'a' and 'b',
+// comparing eight bytes at a time.
+size_t CommonPrefixLength(const uint8_t* a, const uint8_t* b, size_t n) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+    uint64_t diff = UNALIGNED_LOAD64(a + i) ^ UNALIGNED_LOAD64(b + i);
+    if (diff != 0) {
+      // The first differing byte is the least significant one on
+      // little-endian machines.
+      return i + Bits::FindLSBSetNonZero64(diff) / 8;
+    }
+  }
+  while (i < n && a[i] == b[i]) {
+    i++;
+  }
+  return i;
+}
 
-  // Binary search in restart array to find the first restart point
-  // with a key >= target
-  int32_t left = 0;
-  int32_t right = num_restarts_;
-  while (left < right) {
-    uint32_t mid = (left + right + 1) / 2;
-    const uint8_t *entry = GetRestartPoint(mid);
+// Compares 'a' with 'b', given that their first 'match' bytes are equal and
+// that either of them ends there or they differ at byte 'match'.
+int CompareAfterCommonPrefix(const Slice& a, const Slice& b, size_t match) {
+  if (match == a.size() || match == b.size()) {
+    return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+  }
+  return a[match] < b[match] ? -1 : 1;
+}
+
+} // anonymous namespace
+
+Status BinaryPrefixBlockDecoder::DecodeRestartKeys() {
+  if (!restart_keys_.empty()) {
+    return Status::OK();
+  }
+  restart_keys_.reserve(num_restarts_ + 1);
+  for (uint32_t idx = 0; idx <= num_restarts_; idx++) {
+    const uint8_t *entry = GetRestartPoint(idx);
     uint32_t shared, non_shared;
     const uint8_t *key_ptr = DecodeEntryLengths(entry, &shared, &non_shared);
     if (key_ptr == nullptr || (shared != 0)) {
       string err =
-        StringPrintf("bad entry restart=%d shared=%d\n", mid, shared) +
+        StringPrintf("bad entry restart=%d shared=%d\n", idx, shared) +
         HexDump(Slice(entry, 16));
+      restart_keys_.clear();
       return Status::Corruption(err);
     }
-    Slice mid_key(key_ptr, non_shared);
-    if (mid_key.compare(target) < 0) {
-      // Key at "mid" is smaller than "target".  Therefore all
-      // blocks before "mid" are uninteresting.
-      left = mid;
+    restart_keys_.emplace_back(key_ptr, non_shared);
+  }
+  return Status::OK();
+}
+
+Status BinaryPrefixBlockDecoder::SeekAtOrAfterValue(const void *value_void,
+                                              bool *exact_match) {
+  DCHECK(value_void != nullptr);
+
+  const Slice &target = *reinterpret_cast<const Slice *>(value_void);
+  if (PREDICT_FALSE(num_elems_ == 0)) {
+    return Status::NotFound("no values in block");
+  }
+  RETURN_NOT_OK(DecodeRestartKeys());
+
+  // When seeking forward, e.g. to sorted keys one after another, the restart
+  // points before the current value can't hold the target.
+  bool seeking_forward = cur_idx_ < num_elems_ && Slice(cur_val_).compare(target) <= 0;
+  uint32_t cur_restart = cur_idx_ / restart_interval_;
+
+  // Binary search in restart array to find the first restart point
+  // with a key >= target
+  uint32_t left = seeking_forward ? cur_restart : 0;
+  uint32_t right = num_restarts_ + 1;
+  while (left < right) {
+    uint32_t mid = left + (right - left) / 2;
+    if (restart_keys_[mid].compare(target) < 0) {
+      left = mid + 1;
     } else {
-      // Key at "mid" is >= "target".  Therefore all blocks at or
-      // after "mid" are uninteresting.
-      right = mid - 1;
+      right = mid;
     }
   }
+  if (left <= num_restarts_ && restart_keys_[left] == target) {
+    SeekToRestartPoint(left);
+    *exact_match = true;
+    return Status::OK();
+  }
 
-  // Linear search (within restart block) for first key >= target
-  SeekToRestartPoint(left);
+  // The target comes after the key of the previous restart point, if any:
+  // search linearly from there, or from the current value if it's in the same
+  // restart interval.
+  uint32_t start = left > 0 ? left - 1 : 0;
+  if (!seeking_forward || start != cur_restart) {
+    SeekToRestartPoint(start);
+  }
 
+  // Compare the values with the target incrementally: while a value is
+  // smaller than the target, 'match' is the length of their common prefix.
+  // A following value which shares more than 'match' bytes with it differs
+  // from the target at the same byte, so it's smaller too.
+  size_t match = CommonPrefixLength(cur_val_.data(), target.data(),
+                                    std::min(cur_val_.size(), target.size()));
   while (true) {
 #ifndef NDEBUG
     VLOG(3) << "loop iter:\n"
@@ -387,13 +451,20 @@ Status BinaryPrefixBlockDecoder::SeekAtOrAfterValue(const void *value_void,
             << "target  =" << KUDU_REDACT(target.ToDebugString()) << "\n"
             << "cur_val_=" << KUDU_REDACT(Slice(cur_val_).ToDebugString());
 #endif
-    int cmp = Slice(cur_val_).compare(target);
+    int cmp = CompareAfterCommonPrefix(Slice(cur_val_), target, match);
+    DCHECK_EQ(cmp < 0, Slice(cur_val_).compare(target) < 0);
     if (cmp >= 0) {
       *exact_match = (cmp == 0);
       return Status::OK();
     }
-    RETURN_NOT_OK(ParseNextValue());
+    uint32_t shared;
+    RETURN_NOT_OK(ParseNextValue(&shared));
     cur_idx_++;
+    if (shared <= match) {
+      match = shared + CommonPrefixLength(
+          cur_val_.data() + shared, target.data() + shared,
+          std::min(cur_val_.size(), target.size()) - shared);
+    }
   }
 }
 
@@ -529,7 +600,9 @@ inline Status BinaryPrefixBlockDecoder::ParseNextIntoArena(Slice prev_val,
 // Parses the data pointed to by next_ptr_ and stores it in cur_val_
 // Advances next_ptr_ to point to the following values.
 // Does not modify cur_idx_
-inline Status BinaryPrefixBlockDecoder::ParseNextValue() {
+// If 'shared' isn't null, sets it to the number of bytes the new value shares
+// with the previous one.
+inline Status BinaryPrefixBlockDecoder::ParseNextValue(uint32_t* shared_out) {
   RETURN_NOT_OK(CheckNextPtr());
 
   uint32_t shared, non_shared;
@@ -551,6 +624,9 @@ inline Status BinaryPrefixBlockDecoder::ParseNextValue() {
   DCHECK_EQ(cur_val_.size(), shared + non_shared);
 
   next_ptr_ = val_delta + non_shared;
+  if (shared_out) {
+    *shared_out = shared;
+  }
   return Status::OK();
 }
 
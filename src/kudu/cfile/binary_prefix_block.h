@@ -129,7 +129,7 @@ class BinaryPrefixBlockDecoder final : public BlockDecoder {
  private:
   Status SkipForward(int n);
   Status CheckNextPtr();
-  Status ParseNextValue();
+  Status ParseNextValue(uint32_t* shared = nullptr);
   Status ParseNextIntoArena(Slice prev_val, Arena *dst, Slice *copied);
 
   const uint8_t *DecodeEntryLengths(const uint8_t *ptr,
@@ -139,6 +139,10 @@ class BinaryPrefixBlockDecoder final : public BlockDecoder {
   const uint8_t *GetRestartPoint(uint32_t idx) const;
   void SeekToRestartPoint(uint32_t idx);
 
+  // Decodes the keys at the restart points into 'restart_keys_', if not
+  // done yet.
+  Status DecodeRestartKeys();
+
   void SeekToStart();
 
   Slice data_;
@@ -152,6 +156,12 @@ class BinaryPrefixBlockDecoder final : public BlockDecoder {
   const uint32_t *restarts_;
   uint32_t restart_interval_;
 
+  // The key at each restart point, pointing into the block's data. Restart
+  // keys are stored in full, so they can be compared without decoding the
+  // entries before them. Decoded by the first seek by value, since scans
+  // never need them.
+  std::vector<Slice> restart_keys_;
+
   const uint8_t *data_start_;
 
   // Index of the next row to be returned by CopyNextValues, relative to
@@ -20,16 +20,23 @@
 #include <cstring>
 #include <memory>
 #include <ostream>
+#include <vector>
 
-#include <gflags/gflags_declare.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/util/cache.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
 
 DECLARE_double(cache_memtracker_approximation_ratio);
+DECLARE_int32(block_cache_compressed_percentage);
+DECLARE_int32(block_cache_priority_percentage);
+DECLARE_string(block_cache_secondary_path);
+DECLARE_string(block_cache_table_reservations);
 
 namespace kudu {
 namespace cfile {
@@ -85,6 +92,162 @@ TEST(TestBlockCache, TestBasics) {
   ASSERT_FALSE(cache.Lookup(key1, Cache::EXPECT_IN_CACHE, &retrieved_handle));
 }
 
+// Inserts an entry for 'key' with the given priority.
+static void InsertEntry(BlockCache* cache, const BlockCache::CacheKey& key,
+                        BlockCache::Priority priority) {
+  size_t data_size = strlen(DATA_TO_CACHE) + 1;
+  BlockCache::PendingEntry data = cache->Allocate(key, data_size, priority);
+  ASSERT_TRUE(data.valid());
+  memcpy(data.val_ptr(), DATA_TO_CACHE, data_size);
+  BlockCacheHandle inserted_handle;
+  cache->Insert(&data, &inserted_handle);
+  ASSERT_TRUE(inserted_handle.valid());
+}
+
+TEST(TestBlockCache, TestPriorityPartition) {
+  BlockCache cache(512 * 1024 * 1024);
+  BlockCache::FileId id(1234);
+  BlockCache::CacheKey data_key(id, 1);
+  BlockCache::CacheKey index_key(id, 2);
+  NO_FATALS(InsertEntry(&cache, data_key, BlockCache::NORMAL_PRIORITY));
+  NO_FATALS(InsertEntry(&cache, index_key, BlockCache::HIGH_PRIORITY));
+
+  // Each block is only found in its own partition.
+  BlockCacheHandle handle;
+  ASSERT_TRUE(cache.Lookup(data_key, Cache::EXPECT_IN_CACHE, &handle,
+                           BlockCache::NORMAL_PRIORITY));
+  ASSERT_FALSE(cache.Lookup(data_key, Cache::EXPECT_IN_CACHE, &handle,
+                            BlockCache::HIGH_PRIORITY));
+  ASSERT_TRUE(cache.Lookup(index_key, Cache::EXPECT_IN_CACHE, &handle,
+                           BlockCache::HIGH_PRIORITY));
+  ASSERT_EQ(0, memcmp(handle.data().data(), DATA_TO_CACHE, strlen(DATA_TO_CACHE) + 1));
+  ASSERT_FALSE(cache.Lookup(index_key, Cache::EXPECT_IN_CACHE, &handle,
+                            BlockCache::NORMAL_PRIORITY));
+}
+
+TEST(TestBlockCache, TestTablePartition) {
+  google::FlagSaver saver;
+  FLAGS_cache_memtracker_approximation_ratio = 0;
+  FLAGS_block_cache_table_reservations = "lookups:1";
+  BlockCache cache(512 * 1024 * 1024);
+  Cache* partition = cache.GetTablePartition("lookups");
+  ASSERT_NE(nullptr, partition);
+  ASSERT_EQ(nullptr, cache.GetTablePartition("other"));
+  if (BlockCache::GetConfiguredCacheTypeOrDie() == DRAM_CACHE) {
+    std::shared_ptr<MemTracker> mem_tracker;
+    ASSERT_TRUE(MemTracker::FindTracker("block_cache_table:lookups-sharded_lru_cache",
+                                        &mem_tracker));
+  }
+
+  // The blocks of a table with a reservation are only found in its partition,
+  // whatever their priority.
+  BlockCache::FileId id(1234);
+  BlockCache::CacheKey key(id, 1);
+  const size_t kBlockSize = 1024;
+  {
+    BlockCache::PendingEntry data = cache.Allocate(key, kBlockSize, BlockCache::HIGH_PRIORITY,
+                                                   0, partition);
+    ASSERT_TRUE(data.valid());
+    BlockCacheHandle handle;
+    cache.Insert(&data, &handle);
+  }
+  BlockCacheHandle handle;
+  ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle,
+                           BlockCache::NORMAL_PRIORITY, partition));
+  ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle,
+                            BlockCache::HIGH_PRIORITY));
+  handle.Release();
+
+  // The table can't use more than its reservation.
+  for (int i = 2; i < 2 + 2 * 1024 * 1024 / kBlockSize; i++) {
+    BlockCache::PendingEntry data = cache.Allocate(BlockCache::CacheKey(id, i), kBlockSize,
+                                                   BlockCache::NORMAL_PRIORITY, 0, partition);
+    ASSERT_TRUE(data.valid());
+    BlockCacheHandle inserted;
+    cache.Insert(&data, &inserted);
+  }
+  ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle,
+                            BlockCache::NORMAL_PRIORITY, partition));
+}
+
+TEST(TestBlockCache, TestNoPriorityPartition) {
+  google::FlagSaver saver;
+  FLAGS_block_cache_priority_percentage = 0;
+  BlockCache cache(512 * 1024 * 1024);
+  BlockCache::FileId id(1234);
+  BlockCache::CacheKey key(id, 1);
+  NO_FATALS(InsertEntry(&cache, key, BlockCache::HIGH_PRIORITY));
+
+  // Without a high-priority partition, all blocks share the same cache.
+  BlockCacheHandle handle;
+  ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle,
+                           BlockCache::NORMAL_PRIORITY));
+  ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle,
+                           BlockCache::HIGH_PRIORITY));
+}
+
+TEST(TestBlockCache, TestCompressedTier) {
+  google::FlagSaver saver;
+  FLAGS_block_cache_compressed_percentage = 20;
+  BlockCache cache(512 * 1024 * 1024);
+  ASSERT_TRUE(cache.has_compressed_tier());
+  BlockCache::FileId id(1234);
+  BlockCache::CacheKey key(id, 1);
+
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache.LookupCompressed(key, &handle));
+  size_t data_size = strlen(DATA_TO_CACHE) + 1;
+  BlockCache::PendingEntry data = cache.AllocateCompressed(key, data_size, data_size);
+  ASSERT_TRUE(data.valid());
+  memcpy(data.val_ptr(), DATA_TO_CACHE, data_size);
+  cache.Insert(&data, &handle);
+  ASSERT_TRUE(handle.valid());
+
+  // The block is only found in the compressed tier, and isn't reported as a
+  // cached block.
+  BlockCacheHandle retrieved_handle;
+  ASSERT_TRUE(cache.LookupCompressed(key, &retrieved_handle));
+  ASSERT_EQ(0, memcmp(retrieved_handle.data().data(), DATA_TO_CACHE, data_size));
+  ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &retrieved_handle));
+  std::vector<BlockCache::CachedBlock> blocks;
+  cache.GetCachedBlocks(10, &blocks);
+  ASSERT_TRUE(blocks.empty());
+}
+
+TEST(TestBlockCache, TestNoCompressedTier) {
+  BlockCache cache(512 * 1024 * 1024);
+  ASSERT_FALSE(cache.has_compressed_tier());
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache.LookupCompressed(BlockCache::CacheKey(BlockCache::FileId(1234), 1),
+                                      &handle));
+}
+
+class TestBlockCacheWithSecondary : public KuduTest {
+};
+
+TEST_F(TestBlockCacheWithSecondary, TestEvictedBlocksAreFoundInSecondaryCache) {
+  // With no capacity, blocks are evicted from the DRAM cache as soon as they
+  // are released.
+  FLAGS_block_cache_priority_percentage = 0;
+  FLAGS_block_cache_secondary_path = GetTestPath("secondary_cache");
+  BlockCache cache(0);
+  ASSERT_TRUE(cache.has_secondary_cache());
+  BlockCache::FileId id(1234);
+  BlockCache::CacheKey key(id, 1);
+  BlockCache::CacheKey missing_key(id, 2);
+  NO_FATALS(InsertEntry(&cache, key, BlockCache::NORMAL_PRIORITY));
+
+  // The lookups are served by the secondary cache, and each time the block is
+  // evicted from the DRAM cache again it goes back to the secondary cache.
+  for (int i = 0; i < 3; i++) {
+    BlockCacheHandle handle;
+    ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle));
+    ASSERT_EQ(0, memcmp(handle.data().data(), DATA_TO_CACHE, strlen(DATA_TO_CACHE) + 1));
+    ASSERT_EQ(strlen(DATA_TO_CACHE) + 1, handle.data().size());
+  }
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache.Lookup(missing_key, Cache::EXPECT_IN_CACHE, &handle));
+}
 
 } // namespace cfile
 } // namespace kudu
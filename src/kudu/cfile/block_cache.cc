@@ -19,20 +19,35 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/cache_metrics.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/env.h"
+#include "kudu/util/file_backed_cache.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/flag_validators.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/string_case.h"
 
 DEFINE_int64(block_cache_capacity_mb, 512, "block cache capacity in MB");
@@ -54,23 +69,288 @@ DEFINE_string(block_cache_type, "DRAM",
               "in a memory-mapped file using the NVML library.");
 TAG_FLAG(block_cache_type, experimental);
 
+DEFINE_string(block_cache_eviction_policy, "LRU",
+              "Which policy the block cache uses to evict blocks. Valid choices "
+              "are 'LRU', 'SLRU' or 'CLOCK'. LRU, the default, evicts the least "
+              "recently used block. SLRU (segmented LRU) evicts blocks which have "
+              "been read only once before any block which has been read again, so "
+              "that large scans don't evict the working set of other workloads. "
+              "CLOCK approximates LRU with lookups which don't contend with each "
+              "other, which scales better with many concurrent scanners. SLRU and "
+              "CLOCK are only supported by the DRAM block cache.");
+TAG_FLAG(block_cache_eviction_policy, experimental);
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
-template <class T> class scoped_refptr;
+DEFINE_int32(block_cache_priority_percentage, 10,
+             "Percentage of the block cache capacity which is reserved for "
+             "CFile index, dictionary and bloom filter blocks. Those blocks "
+             "are cached separately from data blocks so that large scans "
+             "can't evict them. If 0, all blocks share a single cache.");
+TAG_FLAG(block_cache_priority_percentage, experimental);
 
-namespace kudu {
+static bool ValidatePercentage(const char* flagname, int32_t value) {
+  if (value >= 0 && value <= 100) {
+    return true;
+  }
+  LOG(ERROR) << Substitute("$0 must be a percentage, value $1 is invalid",
+                           flagname, value);
+  return false;
+}
+DEFINE_validator(block_cache_priority_percentage, &ValidatePercentage);
+
+DEFINE_int32(block_cache_compressed_percentage, 0,
+             "Percentage of the block cache capacity which is reserved for "
+             "caching compressed CFile blocks as they are stored on disk. "
+             "A block whose decompressed form was evicted from the cache is "
+             "decompressed from this tier rather than read from disk again. "
+             "If 0, compressed blocks are not cached.");
+TAG_FLAG(block_cache_compressed_percentage, experimental);
+DEFINE_validator(block_cache_compressed_percentage, &ValidatePercentage);
+
+static bool ValidateReservedPercentages() {
+  if (FLAGS_block_cache_priority_percentage +
+      FLAGS_block_cache_compressed_percentage > 100) {
+    LOG(ERROR) << Substitute("--block_cache_priority_percentage ($0) and "
+                             "--block_cache_compressed_percentage ($1) must not "
+                             "add up to more than 100",
+                             FLAGS_block_cache_priority_percentage,
+                             FLAGS_block_cache_compressed_percentage);
+    return false;
+  }
+  return true;
+}
+GROUP_FLAG_VALIDATOR(block_cache_reserved_percentages, ValidateReservedPercentages);
+
+DEFINE_string(block_cache_secondary_path, "",
+              "Path of a file, ideally on a local SSD, in which blocks evicted "
+              "from the block cache are kept. Lookups which miss the block "
+              "cache read blocks from this file rather than from the data "
+              "directories. The file is recreated on startup. If empty, there "
+              "is no secondary block cache.");
+TAG_FLAG(block_cache_secondary_path, experimental);
+
+DEFINE_int64(block_cache_secondary_capacity_mb, 10 * 1024,
+             "Capacity in MB of the secondary block cache file. Only used if "
+             "--block_cache_secondary_path is set.");
+TAG_FLAG(block_cache_secondary_capacity_mb, experimental);
+
+DEFINE_string(block_cache_table_reservations, "",
+              "Comma-separated list of 'table_id:capacity_mb' pairs, each giving "
+              "a table a partition of the block cache of its own. The partition "
+              "caches all the blocks of the table, which other tables thus can't "
+              "evict, and the table can't use more of the cache than that. The "
+              "reserved capacity is carved out of the capacity left after the "
+              "high-priority and compressed partitions.");
+TAG_FLAG(block_cache_table_reservations, experimental);
+
+METRIC_DEFINE_counter(server, block_cache_priority_inserts,
+                      "Block Cache Priority Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of index, dictionary and bloom filter blocks "
+                      "inserted in the high-priority block cache");
+METRIC_DEFINE_counter(server, block_cache_priority_lookups,
+                      "Block Cache Priority Lookups", kudu::MetricUnit::kBlocks,
+                      "Number of blocks looked up from the high-priority block cache");
+METRIC_DEFINE_counter(server, block_cache_priority_evictions,
+                      "Block Cache Priority Evictions", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from the high-priority block cache");
+METRIC_DEFINE_counter(server, block_cache_priority_misses,
+                      "Block Cache Priority Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the high-priority block cache that "
+                      "didn't yield a block");
+METRIC_DEFINE_counter(server, block_cache_priority_misses_caching,
+                      "Block Cache Priority Misses (Caching)", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the high-priority block cache that "
+                      "were expecting a block that didn't yield one");
+METRIC_DEFINE_counter(server, block_cache_priority_hits,
+                      "Block Cache Priority Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the high-priority block cache that "
+                      "found a block");
+METRIC_DEFINE_counter(server, block_cache_priority_hits_caching,
+                      "Block Cache Priority Hits (Caching)", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the high-priority block cache that "
+                      "were expecting a block that found one");
+
+METRIC_DEFINE_gauge_uint64(server, block_cache_priority_usage,
+                           "Block Cache Priority Memory Usage",
+                           kudu::MetricUnit::kBytes,
+                           "Memory consumed by the high-priority block cache");
+
+METRIC_DEFINE_gauge_double(server, block_cache_priority_hit_ratio,
+                           "Block Cache Priority Hit Ratio",
+                           kudu::MetricUnit::kUnits,
+                           "Fraction of the lookups expecting to find a block in "
+                           "the high-priority block cache which found one");
+
+METRIC_DEFINE_counter(server, block_cache_compressed_inserts,
+                      "Block Cache Compressed Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of compressed blocks inserted in the compressed "
+                      "tier of the block cache");
+METRIC_DEFINE_counter(server, block_cache_compressed_lookups,
+                      "Block Cache Compressed Lookups", kudu::MetricUnit::kBlocks,
+                      "Number of blocks looked up from the compressed tier of "
+                      "the block cache");
+METRIC_DEFINE_counter(server, block_cache_compressed_evictions,
+                      "Block Cache Compressed Evictions", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from the compressed tier of the "
+                      "block cache");
+METRIC_DEFINE_counter(server, block_cache_compressed_misses,
+                      "Block Cache Compressed Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the compressed tier of the block "
+                      "cache that didn't yield a block");
+METRIC_DEFINE_counter(server, block_cache_compressed_misses_caching,
+                      "Block Cache Compressed Misses (Caching)", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the compressed tier of the block "
+                      "cache that were expecting a block that didn't yield one");
+METRIC_DEFINE_counter(server, block_cache_compressed_hits,
+                      "Block Cache Compressed Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the compressed tier of the block "
+                      "cache that found a block");
+METRIC_DEFINE_counter(server, block_cache_compressed_hits_caching,
+                      "Block Cache Compressed Hits (Caching)", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the compressed tier of the block "
+                      "cache that were expecting a block that found one");
+
+METRIC_DEFINE_gauge_uint64(server, block_cache_compressed_usage,
+                           "Block Cache Compressed Memory Usage",
+                           kudu::MetricUnit::kBytes,
+                           "Memory consumed by the compressed tier of the block cache");
+
+METRIC_DEFINE_gauge_double(server, block_cache_compressed_hit_ratio,
+                           "Block Cache Compressed Hit Ratio",
+                           kudu::MetricUnit::kUnits,
+                           "Fraction of the lookups expecting to find a block in "
+                           "the compressed tier of the block cache which found one");
+
+METRIC_DEFINE_counter(server, block_cache_secondary_inserts,
+                      "Block Cache Secondary Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from the block cache which were "
+                      "inserted in the secondary block cache");
+METRIC_DEFINE_counter(server, block_cache_secondary_lookups,
+                      "Block Cache Secondary Lookups", kudu::MetricUnit::kBlocks,
+                      "Number of blocks looked up from the secondary block cache");
+METRIC_DEFINE_counter(server, block_cache_secondary_evictions,
+                      "Block Cache Secondary Evictions", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from the secondary block cache");
+METRIC_DEFINE_counter(server, block_cache_secondary_misses,
+                      "Block Cache Secondary Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the secondary block cache that "
+                      "didn't yield a block");
+METRIC_DEFINE_counter(server, block_cache_secondary_misses_caching,
+                      "Block Cache Secondary Misses (Caching)", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the secondary block cache that "
+                      "were expecting a block that didn't yield one");
+METRIC_DEFINE_counter(server, block_cache_secondary_hits,
+                      "Block Cache Secondary Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the secondary block cache that "
+                      "found a block");
+METRIC_DEFINE_counter(server, block_cache_secondary_hits_caching,
+                      "Block Cache Secondary Hits (Caching)", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the secondary block cache that "
+                      "were expecting a block that found one");
 
-class MetricEntity;
+METRIC_DEFINE_gauge_uint64(server, block_cache_secondary_usage,
+                           "Block Cache Secondary Usage",
+                           kudu::MetricUnit::kBytes,
+                           "Bytes of the secondary block cache file holding blocks");
+
+METRIC_DEFINE_gauge_double(server, block_cache_secondary_hit_ratio,
+                           "Block Cache Secondary Hit Ratio",
+                           kudu::MetricUnit::kUnits,
+                           "Fraction of the lookups expecting to find a block in "
+                           "the secondary block cache which found one");
+
+namespace kudu {
 
 namespace cfile {
 
 namespace {
 
-Cache* CreateCache(int64_t capacity) {
+Cache* CreateCache(int64_t capacity, const char* id) {
   CacheType t = BlockCache::GetConfiguredCacheTypeOrDie();
-  return NewLRUCache(t, capacity, "block_cache");
+  ToUpperCase(FLAGS_block_cache_eviction_policy, &FLAGS_block_cache_eviction_policy);
+  if (FLAGS_block_cache_eviction_policy == "SLRU" ||
+      FLAGS_block_cache_eviction_policy == "CLOCK") {
+    if (t != DRAM_CACHE) {
+      LOG(FATAL) << "The " << FLAGS_block_cache_eviction_policy
+                 << " eviction policy is only supported by the DRAM block cache";
+    }
+    return FLAGS_block_cache_eviction_policy == "SLRU" ?
+        NewSLRUCache(t, capacity, id) : NewClockCache(t, capacity, id);
+  }
+  if (FLAGS_block_cache_eviction_policy != "LRU") {
+    LOG(FATAL) << "Unknown block cache eviction policy: '"
+               << FLAGS_block_cache_eviction_policy
+               << "' (expected 'LRU', 'SLRU' or 'CLOCK')";
+  }
+  return NewLRUCache(t, capacity, id);
 }
 
+// Returns the part of 'capacity' which is reserved for high-priority blocks.
+size_t PriorityCapacity(size_t capacity) {
+  return capacity / 100 * FLAGS_block_cache_priority_percentage;
+}
+
+// Returns the part of 'capacity' which is reserved for compressed blocks.
+size_t CompressedCapacity(size_t capacity) {
+  return capacity / 100 * FLAGS_block_cache_compressed_percentage;
+}
+
+#define MINIT(member, x) member = METRIC_##x.Instantiate(entity)
+#define GINIT(member, x) member = METRIC_##x.Instantiate(entity, 0)
+struct PriorityBlockCacheMetrics : public CacheMetrics {
+  explicit PriorityBlockCacheMetrics(const scoped_refptr<MetricEntity>& entity) {
+    MINIT(inserts, block_cache_priority_inserts);
+    MINIT(lookups, block_cache_priority_lookups);
+    MINIT(evictions, block_cache_priority_evictions);
+    MINIT(cache_hits, block_cache_priority_hits);
+    MINIT(cache_hits_caching, block_cache_priority_hits_caching);
+    MINIT(cache_misses, block_cache_priority_misses);
+    MINIT(cache_misses_caching, block_cache_priority_misses_caching);
+    GINIT(cache_usage, block_cache_priority_usage);
+    METRIC_block_cache_priority_hit_ratio.InstantiateFunctionGauge(
+        entity, Bind(&CacheMetrics::HitRatio, Unretained(this)))
+        ->AutoDetach(&metric_detacher_);
+  }
+};
+
+struct CompressedBlockCacheMetrics : public CacheMetrics {
+  explicit CompressedBlockCacheMetrics(const scoped_refptr<MetricEntity>& entity) {
+    MINIT(inserts, block_cache_compressed_inserts);
+    MINIT(lookups, block_cache_compressed_lookups);
+    MINIT(evictions, block_cache_compressed_evictions);
+    MINIT(cache_hits, block_cache_compressed_hits);
+    MINIT(cache_hits_caching, block_cache_compressed_hits_caching);
+    MINIT(cache_misses, block_cache_compressed_misses);
+    MINIT(cache_misses_caching, block_cache_compressed_misses_caching);
+    GINIT(cache_usage, block_cache_compressed_usage);
+    METRIC_block_cache_compressed_hit_ratio.InstantiateFunctionGauge(
+        entity, Bind(&CacheMetrics::HitRatio, Unretained(this)))
+        ->AutoDetach(&metric_detacher_);
+  }
+};
+
+struct SecondaryBlockCacheMetrics : public CacheMetrics {
+  explicit SecondaryBlockCacheMetrics(const scoped_refptr<MetricEntity>& entity) {
+    MINIT(inserts, block_cache_secondary_inserts);
+    MINIT(lookups, block_cache_secondary_lookups);
+    MINIT(evictions, block_cache_secondary_evictions);
+    MINIT(cache_hits, block_cache_secondary_hits);
+    MINIT(cache_hits_caching, block_cache_secondary_hits_caching);
+    MINIT(cache_misses, block_cache_secondary_misses);
+    MINIT(cache_misses_caching, block_cache_secondary_misses_caching);
+    GINIT(cache_usage, block_cache_secondary_usage);
+    METRIC_block_cache_secondary_hit_ratio.InstantiateFunctionGauge(
+        entity, Bind(&CacheMetrics::HitRatio, Unretained(this)))
+        ->AutoDetach(&metric_detacher_);
+  }
+};
+#undef MINIT
+#undef GINIT
+
 // Validates the block cache capacity won't permit the cache to grow large enough
 // to cause pernicious flushing behavior. See KUDU-2318.
 bool ValidateBlockCacheCapacity() {
@@ -103,6 +383,37 @@ bool ValidateBlockCacheCapacity() {
 
 GROUP_FLAG_VALIDATOR(block_cache_capacity_mb, ValidateBlockCacheCapacity);
 
+const size_t BlockCache::kTrailerSize;
+
+class BlockCache::SecondaryCacheSpiller : public Cache::EvictionCallback {
+ public:
+  explicit SecondaryCacheSpiller(Cache* secondary_cache)
+      : secondary_cache_(secondary_cache) {
+  }
+
+  virtual void EvictedEntry(Slice key, Slice value) OVERRIDE {
+    if (secondary_cache_ == nullptr) {
+      return;
+    }
+    Cache::PendingHandle* ph = secondary_cache_->Allocate(key, value.size());
+    if (PREDICT_FALSE(ph == nullptr)) {
+      return;
+    }
+    memcpy(secondary_cache_->MutableValue(ph), value.data(), value.size());
+    secondary_cache_->Release(secondary_cache_->Insert(ph, /* eviction_callback= */ nullptr));
+  }
+
+  // Stops copying evicted blocks into the secondary cache.
+  void Stop() {
+    secondary_cache_ = nullptr;
+  }
+
+ private:
+  Cache* secondary_cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(SecondaryCacheSpiller);
+};
+
 CacheType BlockCache::GetConfiguredCacheTypeOrDie() {
     ToUpperCase(FLAGS_block_cache_type, &FLAGS_block_cache_type);
   if (FLAGS_block_cache_type == "NVM") {
@@ -121,33 +432,191 @@ BlockCache::BlockCache()
   : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024) {
 }
 
-BlockCache::BlockCache(size_t capacity)
-  : cache_(CreateCache(capacity)) {
+BlockCache::BlockCache(size_t capacity) {
+  const size_t priority_capacity = PriorityCapacity(capacity);
+  const size_t compressed_capacity = CompressedCapacity(capacity);
+  size_t shared_capacity = capacity - priority_capacity - compressed_capacity;
+  for (StringPiece reservation : strings::Split(FLAGS_block_cache_table_reservations, ",",
+                                                strings::SkipWhitespace())) {
+    vector<string> parts = strings::Split(reservation, ":");
+    int64_t capacity_mb;
+    if (parts.size() != 2 || parts[0].empty() ||
+        !safe_strto64(parts[1], &capacity_mb) || capacity_mb <= 0) {
+      LOG(FATAL) << "Invalid block cache table reservation: '" << reservation.ToString()
+                 << "' (expected 'table_id:capacity_mb')";
+    }
+    const size_t table_capacity = capacity_mb * 1024 * 1024;
+    if (table_capacity > shared_capacity) {
+      LOG(FATAL) << Substitute("The block cache table reservations don't fit in the "
+                               "$0 bytes of the block cache left for them",
+                               capacity - priority_capacity - compressed_capacity);
+    }
+    string id = Substitute("block_cache_table:$0", parts[0]);
+    if (!EmplaceIfNotPresent(&table_caches_, parts[0],
+                             unique_ptr<Cache>(CreateCache(table_capacity, id.c_str())))) {
+      LOG(FATAL) << "Duplicate block cache reservation for table " << parts[0];
+    }
+    shared_capacity -= table_capacity;
+  }
+  cache_.reset(CreateCache(shared_capacity, "block_cache"));
+  if (priority_capacity > 0) {
+    priority_cache_.reset(CreateCache(priority_capacity, "block_cache_priority"));
+  }
+  if (compressed_capacity > 0) {
+    compressed_cache_.reset(CreateCache(compressed_capacity, "block_cache_compressed"));
+  }
+  if (!FLAGS_block_cache_secondary_path.empty()) {
+    unique_ptr<Cache> secondary_cache;
+    Status s = NewFileBackedCache(Env::Default(), FLAGS_block_cache_secondary_path,
+                                  FLAGS_block_cache_secondary_capacity_mb * 1024 * 1024,
+                                  &secondary_cache);
+    if (s.ok()) {
+      secondary_cache_.reset(secondary_cache.release());
+      spiller_.reset(new SecondaryCacheSpiller(secondary_cache_.get()));
+    } else {
+      LOG(WARNING) << "Unable to create the secondary block cache, continuing "
+                   << "without it: " << s.ToString();
+    }
+  }
+}
+
+BlockCache::~BlockCache() {
+  // The primary partitions refer to the spiller. The blocks they still hold
+  // needn't be copied since the secondary cache goes away as well.
+  if (spiller_) {
+    spiller_->Stop();
+  }
+  cache_.reset();
+  priority_cache_.reset();
+  table_caches_.clear();
+}
+
+Cache* BlockCache::GetTablePartition(const string& table_id) const {
+  if (table_caches_.empty()) {
+    return nullptr;
+  }
+  const unique_ptr<Cache>* cache = FindOrNull(table_caches_, table_id);
+  return cache ? cache->get() : nullptr;
+}
+
+BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t block_size,
+                                              Priority priority, uint32_t stored_size,
+                                              Cache* table_partition) {
+  Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  Cache* cache = table_partition ? table_partition : cache_for(priority);
+  PendingEntry entry(cache, cache->Allocate(key_slice, block_size + kTrailerSize));
+  if (entry.valid()) {
+    EncodeFixed32(entry.val_ptr() + block_size, stored_size);
+  }
+  return entry;
 }
 
-BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t block_size) {
+BlockCache::PendingEntry BlockCache::AllocateCompressed(const CacheKey& key,
+                                                        size_t block_size,
+                                                        uint32_t stored_size) {
+  DCHECK(compressed_cache_);
   Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
-  return PendingEntry(cache_.get(), cache_->Allocate(key_slice, block_size));
+  Cache* cache = compressed_cache_.get();
+  PendingEntry entry(cache, cache->Allocate(key_slice, block_size + kTrailerSize));
+  if (entry.valid()) {
+    EncodeFixed32(entry.val_ptr() + block_size, stored_size);
+  }
+  return entry;
 }
 
 bool BlockCache::Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-                        BlockCacheHandle *handle) {
-  Cache::Handle *h = cache_->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
-                                          sizeof(key)), behavior);
+                        BlockCacheHandle *handle, Priority priority,
+                        Cache* table_partition) {
+  Cache* cache = table_partition ? table_partition : cache_for(priority);
+  Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  Cache::Handle *h = cache->Lookup(key_slice, behavior);
   if (h != nullptr) {
-    handle->SetHandle(cache_.get(), h);
+    handle->SetHandle(cache, h);
+    return true;
+  }
+  return secondary_cache_ && LookupSecondary(cache, key_slice, behavior, handle);
+}
+
+bool BlockCache::LookupSecondary(Cache* cache, const Slice& key,
+                                 Cache::CacheBehavior behavior,
+                                 BlockCacheHandle* handle) {
+  Cache::Handle* h = secondary_cache_->Lookup(key, behavior);
+  if (h == nullptr) {
+    return false;
+  }
+  Slice value = secondary_cache_->Value(h);
+  PendingEntry entry(cache, cache->Allocate(key, value.size()));
+  if (PREDICT_FALSE(!entry.valid())) {
+    // There's no space in the primary partition: use the block straight out
+    // of the secondary cache.
+    handle->SetHandle(secondary_cache_.get(), h);
+    return true;
+  }
+  memcpy(entry.val_ptr(), value.data(), value.size());
+  secondary_cache_->Release(h);
+  // The block is copied to the secondary cache again when it's next evicted.
+  secondary_cache_->Erase(key);
+  Insert(&entry, handle);
+  return true;
+}
+
+bool BlockCache::LookupCompressed(const CacheKey& key, BlockCacheHandle* handle) {
+  if (!compressed_cache_) {
+    return false;
+  }
+  Cache* cache = compressed_cache_.get();
+  Cache::Handle* h = cache->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
+                                         sizeof(key)), Cache::EXPECT_IN_CACHE);
+  if (h != nullptr) {
+    handle->SetHandle(cache, h);
   }
   return h != nullptr;
 }
 
 void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
-  Cache::Handle *h = cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr);
+  Cache* cache = DCHECK_NOTNULL(entry->cache_);
+  // Blocks evicted from the compressed tier aren't copied to the secondary
+  // cache, which holds decompressed blocks.
+  Cache::EvictionCallback* callback =
+      cache == compressed_cache_.get() ? nullptr : spiller_.get();
+  Cache::Handle *h = cache->Insert(entry->handle_, callback);
+  entry->cache_ = nullptr;
   entry->handle_ = nullptr;
-  inserted->SetHandle(cache_.get(), h);
+  inserted->SetHandle(cache, h);
+}
+
+void BlockCache::GetCachedBlocks(size_t max_blocks, vector<CachedBlock>* blocks) const {
+  for (Priority priority : { NORMAL_PRIORITY, HIGH_PRIORITY }) {
+    if (priority == HIGH_PRIORITY && !priority_cache_) {
+      continue;
+    }
+    cache_for(priority)->VisitEntries(max_blocks, [&](const Slice& key, const Slice& value) {
+      if (PREDICT_FALSE(key.size() != sizeof(CacheKey) || value.size() < kTrailerSize)) {
+        return;
+      }
+      CacheKey cache_key(BlockId(), 0);
+      memcpy(&cache_key, key.data(), sizeof(cache_key));
+      blocks->push_back({ BlockId(cache_key.file_id_), cache_key.offset_,
+                          DecodeFixed32(value.data() + value.size() - kTrailerSize),
+                          priority });
+    });
+  }
 }
 
 void BlockCache::StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity) {
   cache_->SetMetrics(metric_entity);
+  if (priority_cache_) {
+    priority_cache_->SetMetrics(unique_ptr<CacheMetrics>(
+        new PriorityBlockCacheMetrics(metric_entity)));
+  }
+  if (compressed_cache_) {
+    compressed_cache_->SetMetrics(unique_ptr<CacheMetrics>(
+        new CompressedBlockCacheMetrics(metric_entity)));
+  }
+  if (secondary_cache_) {
+    secondary_cache_->SetMetrics(unique_ptr<CacheMetrics>(
+        new SecondaryBlockCacheMetrics(metric_entity)));
+  }
 }
 
 } // namespace cfile
@@ -19,7 +19,11 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
@@ -46,8 +50,39 @@ class BlockCacheHandle;
 
 // Wrapper around kudu::Cache specifically for caching blocks of CFiles.
 // Provides a singleton and LRU cache for CFile blocks.
+//
+// A portion of the capacity (see --block_cache_priority_percentage) is set
+// aside as a separate high-priority LRU for the blocks that every lookup
+// needs: index, dictionary and bloom filter blocks. Data blocks pulled in by
+// large scans are cached in the other partition and can't evict them.
+//
+// Another portion (see --block_cache_compressed_percentage) may be set aside
+// as a compressed tier which holds the on-disk bytes of compressed blocks.
+// Since compressed blocks are typically several times smaller than their
+// decompressed form, this tier keeps many more blocks in memory, and a block
+// which was evicted from the other partitions can be decompressed from it
+// rather than read from disk again.
+//
+// Finally, blocks evicted from the DRAM (or NVM) tiers may be caught by a
+// file-backed secondary cache on a local SSD (see --block_cache_secondary_path).
+// A lookup which misses the primary tiers checks the secondary cache and
+// promotes the block back to the primary tier.
+//
+// Tables may also be given partitions of their own (see
+// --block_cache_table_reservations), which cache all of their blocks, of
+// either priority. The capacity of such a partition is both reserved for the
+// table, so that other tables can't evict its blocks, and the most the table
+// may use. The usage of each table partition is tracked by its own
+// MemTracker.
 class BlockCache {
  public:
+  // The partition of the cache that a block belongs to. A given block must
+  // always be looked up and inserted with the same priority.
+  enum Priority {
+    NORMAL_PRIORITY,
+    HIGH_PRIORITY
+  };
+
   // Parse the gflag which configures the block cache. FATALs if the flag is
   // invalid.
   static CacheType GetConfiguredCacheTypeOrDie();
@@ -76,6 +111,17 @@ class BlockCache {
     uint64_t offset_;
   } PACKED;
 
+  // A block which is in the cache, with enough information to read it into
+  // the cache again, e.g. after a restart.
+  struct CachedBlock {
+    BlockId block_id;
+    uint64_t offset;
+    // The size of the block on disk, which may differ from the size of the
+    // cached data if the block is compressed. 0 if unknown.
+    uint32_t stored_size;
+    Priority priority;
+  };
+
   // An entry that is in the process of being inserted into the block
   // cache. See the documentation above 'Allocate' below on the block
   // cache insertion path.
@@ -123,6 +169,8 @@ class BlockCache {
 
   explicit BlockCache(size_t capacity);
 
+  ~BlockCache();
+
   // Lookup the given block in the cache.
   //
   // If the entry is found, then sets *handle to refer to the entry.
@@ -130,10 +178,40 @@ class BlockCache {
   // Alternatively,  handle->Release() may be used to explicitly release it.
   //
   // Returns true to indicate that the entry was found, false otherwise.
+  //
+  // If the entry isn't in the partition for 'priority' but in the secondary
+  // cache, it's moved back to that partition.
+  //
+  // 'table_partition' is the partition reserved for the block's table, as
+  // returned by GetTablePartition(), or null if the table has none.
   bool Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-              BlockCacheHandle* handle);
+              BlockCacheHandle* handle, Priority priority = NORMAL_PRIORITY,
+              Cache* table_partition = nullptr);
+
+  // Lookup the on-disk bytes of the given compressed block in the compressed
+  // tier. The semantics are the same as those of Lookup(). Always returns
+  // false if there is no compressed tier.
+  bool LookupCompressed(const CacheKey& key, BlockCacheHandle* handle);
+
+  // Returns the partition of the cache reserved for the blocks of the table
+  // with ID 'table_id', or null if the table has no reservation.
+  Cache* GetTablePartition(const std::string& table_id) const;
+
+  // Returns true if compressed blocks may be cached in the compressed tier.
+  bool has_compressed_tier() const {
+    return compressed_cache_ != nullptr;
+  }
 
-  // Pass a metric entity to the cache to start recording metrics.
+  // Returns true if blocks evicted from the primary tiers are cached in a
+  // secondary file-backed cache.
+  bool has_secondary_cache() const {
+    return secondary_cache_ != nullptr;
+  }
+
+  // Pass a metric entity to the cache to start recording metrics. The
+  // high-priority partition, the compressed tier and the secondary cache
+  // report their own 'block_cache_priority_*', 'block_cache_compressed_*' and
+  // 'block_cache_secondary_*' metrics.
   // This should be called before the block cache starts serving blocks.
   // Not calling StartInstrumentation will simply result in no block cache-related metrics.
   // Calling StartInstrumentation multiple times will reset the metrics each time.
@@ -157,20 +235,71 @@ class BlockCache {
   //   BlockCacheHandle bch;
   //   cache->Insert(&entry, &bch);
 
-  // Allocate a new entry to be inserted into the cache.
-  PendingEntry Allocate(const CacheKey& key, size_t block_size);
+  // Allocate a new entry to be inserted into the cache. 'stored_size' is the
+  // size of the block on disk, which is remembered with the entry so that
+  // the block can be read back by a later process (see GetCachedBlocks()).
+  //
+  // 'table_partition' is as in Lookup().
+  PendingEntry Allocate(const CacheKey& key, size_t block_size,
+                        Priority priority = NORMAL_PRIORITY,
+                        uint32_t stored_size = 0,
+                        Cache* table_partition = nullptr);
+
+  // Allocate a new entry to be inserted into the compressed tier, which must
+  // exist. 'block_size' is the size of the compressed data to be cached.
+  PendingEntry AllocateCompressed(const CacheKey& key, size_t block_size,
+                                  uint32_t stored_size);
 
   // Insert the given block into the cache. 'inserted' is set to refer to the
   // entry in the cache.
   void Insert(PendingEntry* entry, BlockCacheHandle* inserted);
 
+  // Appends up to 'max_blocks' of the most recently used blocks of each
+  // partition of the cache to 'blocks', hottest first. The compressed tier
+  // and the table partitions aren't visited.
+  void GetCachedBlocks(size_t max_blocks, std::vector<CachedBlock>* blocks) const;
+
+  // The number of bytes appended to each cached block to record its
+  // stored size.
+  static const size_t kTrailerSize = sizeof(uint32_t);
+
  private:
   friend class Singleton<BlockCache>;
   BlockCache();
 
   DISALLOW_COPY_AND_ASSIGN(BlockCache);
 
+  // Eviction callback which copies blocks evicted from a primary partition
+  // into the secondary cache.
+  class SecondaryCacheSpiller;
+
+  // Looks up the given block in the secondary cache. If found, moves it to
+  // 'cache' and sets 'handle' to refer to it.
+  bool LookupSecondary(Cache* cache, const Slice& key, Cache::CacheBehavior behavior,
+                       BlockCacheHandle* handle);
+
+  // Returns the partition which caches blocks of the given priority, for
+  // tables without a partition of their own.
+  Cache* cache_for(Priority priority) const {
+    return priority == HIGH_PRIORITY && priority_cache_ ?
+        priority_cache_.get() : cache_.get();
+  }
+
   gscoped_ptr<Cache> cache_;
+
+  // The high-priority partition, or NULL if it was configured with no
+  // capacity, in which case all blocks are cached in 'cache_'.
+  gscoped_ptr<Cache> priority_cache_;
+
+  // The compressed tier, or NULL if it was configured with no capacity.
+  gscoped_ptr<Cache> compressed_cache_;
+
+  // The partitions reserved for tables, keyed by table ID.
+  std::unordered_map<std::string, std::unique_ptr<Cache>> table_caches_;
+
+  // The file-backed secondary cache, or NULL if it isn't configured.
+  gscoped_ptr<Cache> secondary_cache_;
+  gscoped_ptr<SecondaryCacheSpiller> spiller_;
 };
 
 // Scoped reference to a block from the block cache.
@@ -204,7 +333,8 @@ class BlockCacheHandle {
   // NOTE: this slice is only valid until the block cache handle is
   // destructed or explicitly Released().
   Slice data() const {
-    return cache_->Value(handle_);
+    Slice value = cache_->Value(handle_);
+    return Slice(value.data(), value.size() - BlockCache::kTrailerSize);
   }
 
   bool valid() const {
@@ -0,0 +1,193 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/block_cache_persister.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile-test-base.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/index_btree.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/env.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+DECLARE_int32(block_cache_warm_up_rate_mb);
+
+using kudu::fs::ReadableBlock;
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+
+namespace kudu {
+namespace cfile {
+
+class BlockCachePersisterTest : public CFileTestBase {
+ protected:
+  // Writes a CFile with several data blocks and returns its id.
+  void WriteFile(BlockId* block_id) {
+    UInt32DataGenerator<false> generator;
+    NO_FATALS(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000,
+                            SMALL_BLOCKSIZE, block_id));
+  }
+
+  // Returns the pointers to the data blocks of the given CFile.
+  void GetDataBlockPointers(const BlockId& block_id, vector<BlockPointer>* ptrs) {
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<IndexTreeIterator> iter(
+        IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+    ASSERT_OK(iter->SeekToFirst());
+    while (true) {
+      ptrs->push_back(iter->GetCurrentBlockPointer());
+      if (!iter->HasNext()) {
+        break;
+      }
+      ASSERT_OK(iter->Next());
+    }
+    ASSERT_GT(ptrs->size(), 1);
+  }
+
+  // Reads the given blocks of a CFile, caching them.
+  void ReadBlocks(const BlockId& block_id, const vector<BlockPointer>& ptrs) {
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    for (const auto& ptr : ptrs) {
+      BlockHandle handle;
+      ASSERT_OK(reader->ReadBlock(nullptr, ptr, CFileReader::CACHE_BLOCK, &handle));
+    }
+  }
+
+  string HotSetPath() const {
+    return JoinPathSegments(fs_manager_->GetDataRootDirs()[0],
+                            BlockCachePersister::kHotSetFileName);
+  }
+};
+
+// Tests that the locations of cached blocks, including their sizes on disk,
+// are persisted.
+TEST_F(BlockCachePersisterTest, TestPersist) {
+  BlockId block_id;
+  NO_FATALS(WriteFile(&block_id));
+  vector<BlockPointer> ptrs;
+  NO_FATALS(GetDataBlockPointers(block_id, &ptrs));
+  NO_FATALS(ReadBlocks(block_id, ptrs));
+
+  BlockCachePersister persister(fs_manager_.get(), BlockCache::GetSingleton());
+  ASSERT_OK(persister.Persist());
+
+  BlockCacheHotSetPB pb;
+  ASSERT_OK(pb_util::ReadPBContainerFromPath(env_, HotSetPath(), &pb));
+  unordered_map<uint64_t, uint32_t> sizes_by_offset;
+  for (const auto& entry : pb.entries()) {
+    if (entry.block_id() == block_id.id() && !entry.high_priority()) {
+      sizes_by_offset[entry.block_ptr().offset()] = entry.block_ptr().size();
+    }
+  }
+  for (const auto& ptr : ptrs) {
+    SCOPED_TRACE(ptr.ToString());
+    ASSERT_EQ(1, sizes_by_offset.count(ptr.offset()));
+    ASSERT_EQ(ptr.size(), sizes_by_offset[ptr.offset()]);
+  }
+}
+
+// Tests that blocks listed in a hot set are read into the cache, and that
+// stale entries are skipped.
+TEST_F(BlockCachePersisterTest, TestWarmUp) {
+  BlockId block_id;
+  NO_FATALS(WriteFile(&block_id));
+  vector<BlockPointer> ptrs;
+  NO_FATALS(GetDataBlockPointers(block_id, &ptrs));
+
+  // The blocks of the file haven't been read, so they aren't cached.
+  BlockCache* cache = BlockCache::GetSingleton();
+  for (const auto& ptr : ptrs) {
+    BlockCacheHandle handle;
+    ASSERT_FALSE(cache->Lookup(BlockCache::CacheKey(block_id, ptr.offset()),
+                               Cache::NO_EXPECT_IN_CACHE, &handle));
+  }
+
+  // Write a hot set which lists them, along with a block which doesn't exist
+  // and a pointer which is past the end of the file, which is skipped rather
+  // than failing the warm-up.
+  BlockCacheHotSetPB pb;
+  for (const auto& ptr : ptrs) {
+    auto* entry = pb.add_entries();
+    entry->set_block_id(block_id.id());
+    entry->set_tablet_id("tablet");
+    ptr.CopyToPB(entry->mutable_block_ptr());
+  }
+  auto* missing = pb.add_entries();
+  missing->set_block_id(block_id.id() + 1000);
+  ptrs[0].CopyToPB(missing->mutable_block_ptr());
+  auto* bad_ptr = pb.add_entries();
+  bad_ptr->set_block_id(block_id.id());
+  BlockPointer(1ULL << 40, 100).CopyToPB(bad_ptr->mutable_block_ptr());
+  ASSERT_OK(pb_util::WritePBContainerToPath(env_, HotSetPath(), pb,
+                                            pb_util::OVERWRITE, pb_util::NO_SYNC));
+
+  // Don't slow the test down.
+  FLAGS_block_cache_warm_up_rate_mb = 1024;
+  BlockCachePersister persister(fs_manager_.get(), cache);
+  int64_t blocks_read;
+  ASSERT_OK(persister.WarmUp(&blocks_read));
+  ASSERT_EQ(ptrs.size(), static_cast<size_t>(blocks_read));
+  for (const auto& ptr : ptrs) {
+    BlockCacheHandle handle;
+    ASSERT_TRUE(cache->Lookup(BlockCache::CacheKey(block_id, ptr.offset()),
+                              Cache::NO_EXPECT_IN_CACHE, &handle));
+  }
+}
+
+// Tests that warming up without a hot set returns NotFound.
+TEST_F(BlockCachePersisterTest, TestWarmUpWithoutHotSet) {
+  BlockCachePersister persister(fs_manager_.get(), BlockCache::GetSingleton());
+  int64_t blocks_read;
+  Status s = persister.WarmUp(&blocks_read);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+  ASSERT_EQ(0, blocks_read);
+}
+
+} // namespace cfile
+} // namespace kudu
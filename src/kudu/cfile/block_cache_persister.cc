@@ -0,0 +1,310 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/block_cache_persister.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/thread.h"
+
+DEFINE_int32(block_cache_persist_interval_secs, 0,
+             "How often to persist the locations of the hottest blocks of the "
+             "block cache to the data directories, so that the cache can be "
+             "warmed up when the server restarts. The cache is also persisted "
+             "when the server shuts down cleanly. If not positive, the cache "
+             "is neither persisted nor warmed up.");
+TAG_FLAG(block_cache_persist_interval_secs, experimental);
+
+DEFINE_int32(block_cache_persist_max_blocks, 100000,
+             "Maximum number of blocks of each partition of the block cache "
+             "whose locations are persisted.");
+TAG_FLAG(block_cache_persist_max_blocks, experimental);
+
+DEFINE_int32(block_cache_warm_up_rate_mb, 20,
+             "Maximum rate, in MB per second, at which the blocks persisted "
+             "by a previous run of the server are read into the block cache "
+             "on startup. If not positive, the cache is not warmed up.");
+TAG_FLAG(block_cache_warm_up_rate_mb, experimental);
+TAG_FLAG(block_cache_warm_up_rate_mb, runtime);
+
+using kudu::fs::DataDir;
+using kudu::fs::ReadableBlock;
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+const char* const BlockCachePersister::kHotSetFileName = "block_cache_hot_set";
+
+BlockCachePersister::BlockCachePersister(FsManager* fs_manager, BlockCache* cache,
+                                         BlockTabletsFn block_tablets)
+    : fs_manager_(fs_manager),
+      cache_(cache),
+      block_tablets_(std::move(block_tablets)),
+      shutdown_latch_(1),
+      warmed_up_(false) {
+}
+
+BlockCachePersister::~BlockCachePersister() {
+  Shutdown();
+}
+
+Status BlockCachePersister::Start() {
+  if (FLAGS_block_cache_persist_interval_secs <= 0) {
+    return Status::OK();
+  }
+  return Thread::Create("cfile", "block-cache-persister",
+                        &BlockCachePersister::Run, this, &thread_);
+}
+
+void BlockCachePersister::Shutdown() {
+  if (!thread_) {
+    return;
+  }
+  shutdown_latch_.CountDown();
+  CHECK_OK(ThreadJoiner(thread_.get()).Join());
+  thread_.reset();
+
+  // Don't replace the hot set of the previous run with that of a cache which
+  // was only partially warmed up.
+  if (warmed_up_) {
+    WARN_NOT_OK(Persist(), "Unable to persist the block cache");
+  }
+}
+
+void BlockCachePersister::Run() {
+  int64_t blocks_read;
+  Status s = WarmUp(&blocks_read);
+  if (s.IsNotFound()) {
+    VLOG(1) << "Not warming up the block cache: " << s.ToString();
+  } else {
+    WARN_NOT_OK(s, "Unable to warm up the block cache");
+  }
+  if (shutdown_latch_.count() == 0) {
+    return;
+  }
+  warmed_up_ = true;
+
+  const MonoDelta interval = MonoDelta::FromSeconds(FLAGS_block_cache_persist_interval_secs);
+  while (!shutdown_latch_.WaitFor(interval)) {
+    WARN_NOT_OK(Persist(), "Unable to persist the block cache");
+  }
+}
+
+Status BlockCachePersister::Persist() {
+  vector<BlockCache::CachedBlock> blocks;
+  cache_->GetCachedBlocks(FLAGS_block_cache_persist_max_blocks, &blocks);
+  unordered_map<uint64_t, string> block_tablets;
+  if (block_tablets_) {
+    block_tablets_(&block_tablets);
+  }
+  BlockCacheHotSetPB pb;
+  for (const auto& block : blocks) {
+    if (block.stored_size == 0) {
+      continue;
+    }
+    BlockCacheHotSetPB::EntryPB* entry = pb.add_entries();
+    entry->set_block_id(block.block_id.id());
+    const string* tablet_id = FindOrNull(block_tablets, block.block_id.id());
+    if (tablet_id) {
+      entry->set_tablet_id(*tablet_id);
+    }
+    BlockPointer(block.offset, block.stored_size).CopyToPB(entry->mutable_block_ptr());
+    if (block.priority == BlockCache::HIGH_PRIORITY) {
+      entry->set_high_priority(true);
+    }
+  }
+
+  // Every data directory gets a copy, so that the cache can still be warmed
+  // up if some of them fail.
+  fs::DataDirManager* dd_manager = fs_manager_->dd_manager();
+  Status first_error;
+  int written = 0;
+  for (const auto& dd : dd_manager->data_dirs()) {
+    int uuid_idx;
+    if (!dd_manager->FindUuidIndexByDataDir(dd.get(), &uuid_idx) ||
+        dd_manager->IsDataDirFailed(uuid_idx)) {
+      continue;
+    }
+    string path = JoinPathSegments(dd->dir(), kHotSetFileName);
+    Status s = pb_util::WritePBContainerToPath(fs_manager_->env(), path, pb,
+                                               pb_util::OVERWRITE, pb_util::NO_SYNC);
+    if (s.ok()) {
+      written++;
+    } else if (first_error.ok()) {
+      first_error = s.CloneAndPrepend(Substitute("could not write $0", path));
+    }
+  }
+  if (written == 0 && !first_error.ok()) {
+    return first_error;
+  }
+  VLOG(1) << Substitute("Persisted the locations of $0 cached blocks to $1 data directories",
+                        pb.entries_size(), written);
+  return Status::OK();
+}
+
+Status BlockCachePersister::ReadHotSet(BlockCacheHotSetPB* pb) const {
+  fs::DataDirManager* dd_manager = fs_manager_->dd_manager();
+  for (const auto& dd : dd_manager->data_dirs()) {
+    int uuid_idx;
+    if (!dd_manager->FindUuidIndexByDataDir(dd.get(), &uuid_idx) ||
+        dd_manager->IsDataDirFailed(uuid_idx)) {
+      continue;
+    }
+    string path = JoinPathSegments(dd->dir(), kHotSetFileName);
+    if (!fs_manager_->env()->FileExists(path)) {
+      continue;
+    }
+    Status s = pb_util::ReadPBContainerFromPath(fs_manager_->env(), path, pb);
+    if (s.ok()) {
+      return Status::OK();
+    }
+    LOG(WARNING) << Substitute("Unable to read $0: $1", path, s.ToString());
+  }
+  return Status::NotFound("no block cache hot set found in the data directories");
+}
+
+Status BlockCachePersister::WarmUp(int64_t* blocks_read) {
+  *blocks_read = 0;
+  if (FLAGS_block_cache_warm_up_rate_mb <= 0) {
+    return Status::OK();
+  }
+  BlockCacheHotSetPB pb;
+  RETURN_NOT_OK(ReadHotSet(&pb));
+
+  // Read the blocks of each CFile together and in order, so that each CFile
+  // is only opened once and is read sequentially. CFiles are read in the
+  // order in which their hottest block appears.
+  vector<uint64_t> block_ids;
+  unordered_map<uint64_t, vector<const BlockCacheHotSetPB::EntryPB*>> entries_by_block_id;
+  for (const auto& entry : pb.entries()) {
+    auto& entries = entries_by_block_id[entry.block_id()];
+    if (entries.empty()) {
+      block_ids.push_back(entry.block_id());
+    }
+    entries.push_back(&entry);
+  }
+
+  const MonoTime start = MonoTime::Now();
+  int64_t bytes_read = 0;
+  for (uint64_t id : block_ids) {
+    BlockId block_id(id);
+    unique_ptr<ReadableBlock> block;
+    Status s = fs_manager_->OpenBlock(block_id, &block);
+    if (s.IsNotFound()) {
+      // The block was deleted, e.g. by a compaction.
+      continue;
+    }
+    if (!s.ok()) {
+      LOG(WARNING) << Substitute("Unable to open block $0 to warm up the block cache: $1",
+                                 block_id.ToString(), s.ToString());
+      continue;
+    }
+    auto& entries = entries_by_block_id[id];
+    // Corruption found while reading the block fails its tablet, if known.
+    const fs::IOContext io_context({ entries.front()->tablet_id() });
+    ReaderOptions opts;
+    opts.io_context = &io_context;
+    unique_ptr<CFileReader> reader;
+    s = CFileReader::Open(std::move(block), std::move(opts), &reader);
+    if (!s.ok()) {
+      LOG(WARNING) << Substitute("Unable to open CFile $0 to warm up the block cache: $1",
+                                 block_id.ToString(), s.ToString());
+      continue;
+    }
+    // The cfiles of a shared block can't be located without the rowset
+    // metadata, so the block is left cold.
+    string group;
+    if (reader->GetMetadataEntry(kSharedBlockMetaEntryName, &group)) {
+      VLOG(1) << Substitute("Not warming up shared block $0", block_id.ToString());
+      continue;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const BlockCacheHotSetPB::EntryPB* a, const BlockCacheHotSetPB::EntryPB* b) {
+                return a->block_ptr().offset() < b->block_ptr().offset();
+              });
+    for (const auto* entry : entries) {
+      BlockPointer ptr(entry->block_ptr());
+      if (ptr.offset() == 0 || ptr.offset() + ptr.size() >= reader->file_size()) {
+        // Not a block of this CFile; the hot set must be corrupt.
+        continue;
+      }
+      BlockHandle handle;
+      s = reader->ReadBlock(&io_context, ptr, CFileReader::CACHE_BLOCK, &handle,
+                            entry->high_priority() ?
+                            BlockCache::HIGH_PRIORITY :
+                            BlockCache::NORMAL_PRIORITY);
+      if (!s.ok()) {
+        LOG(WARNING) << Substitute("Unable to read block $0 of $1 to warm up the block cache: $2",
+                                   ptr.ToString(), block_id.ToString(), s.ToString());
+        continue;
+      }
+      (*blocks_read)++;
+      bytes_read += ptr.size();
+
+      // Throttle the warm-up to the configured rate.
+      const double expected_secs = static_cast<double>(bytes_read) /
+          (FLAGS_block_cache_warm_up_rate_mb * 1024LL * 1024);
+      const double ahead_secs = expected_secs - (MonoTime::Now() - start).ToSeconds();
+      if (ahead_secs > 0) {
+        shutdown_latch_.WaitFor(MonoDelta::FromSeconds(ahead_secs));
+      }
+      if (shutdown_latch_.count() == 0) {
+        return Status::OK();
+      }
+    }
+  }
+  LOG(INFO) << Substitute("Warmed up the block cache with $0 blocks ($1 bytes) in $2",
+                          *blocks_read, bytes_read, (MonoTime::Now() - start).ToString());
+  return Status::OK();
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,111 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CFILE_BLOCK_CACHE_PERSISTER_H
+#define KUDU_CFILE_BLOCK_CACHE_PERSISTER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class FsManager;
+class Thread;
+
+namespace cfile {
+
+class BlockCache;
+class BlockCacheHotSetPB;
+
+// Persists which blocks are in the block cache, so that a restarted server
+// can warm up its cache instead of waiting for its workload to do so.
+//
+// Only the locations of the hottest blocks (see
+// --block_cache_persist_max_blocks) are persisted, to a file in every data
+// directory. On startup, the blocks listed in the file are read back into
+// the cache in the background, at a bounded rate so that the warm-up doesn't
+// compete too much with the workload.
+class BlockCachePersister {
+ public:
+  // Fills in the id of the tablet of each live block, by block id.
+  typedef std::function<void(std::unordered_map<uint64_t, std::string>*)> BlockTabletsFn;
+
+  // If set, 'block_tablets' is used to persist the tablet of each block, so
+  // that corruption found while warming up the cache is reported for the
+  // right tablet.
+  BlockCachePersister(FsManager* fs_manager, BlockCache* cache,
+                      BlockTabletsFn block_tablets = nullptr);
+  ~BlockCachePersister();
+
+  // Starts a thread which warms up the cache and then persists it every
+  // --block_cache_persist_interval_secs. Does nothing if persisting the
+  // cache is disabled.
+  //
+  // Must be called after the block manager has been opened.
+  Status Start();
+
+  // Stops the thread started by Start(), if any, persisting the cache one
+  // last time.
+  void Shutdown();
+
+  // Writes the hottest blocks of the cache to every healthy data directory.
+  // Returns an error if it could not be written to any of them.
+  Status Persist();
+
+  // Reads the blocks listed in the file written by Persist() into the cache,
+  // at most at --block_cache_warm_up_rate_mb MB per second. Blocks which no
+  // longer exist or can't be read are skipped. Returns early if Shutdown() is
+  // called.
+  //
+  // Sets 'blocks_read' to the number of blocks read into the cache.
+  Status WarmUp(int64_t* blocks_read);
+
+  // The name of the file in each data directory.
+  static const char* const kHotSetFileName;
+
+ private:
+  void Run();
+
+  // Reads the first valid hot set file found in the data directories.
+  Status ReadHotSet(BlockCacheHotSetPB* pb) const;
+
+  FsManager* const fs_manager_;
+  BlockCache* const cache_;
+  const BlockTabletsFn block_tablets_;
+
+  // Counts down when Shutdown() is called.
+  CountDownLatch shutdown_latch_;
+
+  // Whether the warm-up finished, i.e. the cache can be persisted again.
+  // Only accessed by the thread until it is joined.
+  bool warmed_up_;
+
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockCachePersister);
+};
+
+} // namespace cfile
+} // namespace kudu
+
+#endif
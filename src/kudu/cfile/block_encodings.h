@@ -171,6 +171,17 @@ class BlockDecoder {
     return Status::OK();
   }
 
+  // Makes CopyNextValues() and CopyNextAndEval() output slices which point
+  // into the block's data rather than into copies of it in the dst block's
+  // arena. Must be called after ParseHeader(). Returns false if the decoder
+  // doesn't support it, in which case it keeps copying.
+  //
+  // The caller must keep the block's data alive for as long as the values
+  // are referenced, e.g. by retaining it in the dst block's arena.
+  virtual bool EnableZeroCopy() {
+    return false;
+  }
+
   // Return true if there are more values remaining to be iterated.
   // (i.e that the next call to CopyNextValues will return at least 1
   // element)
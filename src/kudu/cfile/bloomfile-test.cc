@@ -20,12 +20,16 @@
 #include <memory>
 #include <ostream>
 #include <utility>
+#include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/bloomfile-test-base.h"
 #include "kudu/cfile/bloomfile.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs-test-util.h"
@@ -36,7 +40,10 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(bloomfile_write_split_block_filters);
+
 using std::shared_ptr;
+using std::vector;
 
 namespace kudu {
 namespace cfile {
@@ -74,9 +81,41 @@ class BloomFileTest : public BloomFileTestBase {
 
     double fp_rate = static_cast<double>(positive_count) / FLAGS_n_keys;
     LOG(INFO) << "fp_rate: " << fp_rate << "(" << positive_count << "/" << FLAGS_n_keys << ")";
-    ASSERT_LT(fp_rate, FLAGS_fp_rate + FLAGS_fp_rate * 0.20f)
-      << "Should be no more than 1.2x the expected FP rate";
+    ASSERT_LT(fp_rate, FLAGS_fp_rate * max_fp_rate_ratio_)
+      << "Should be no more than " << max_fp_rate_ratio_ << "x the expected FP rate";
+  }
+
+  // Check that probing a sorted batch of keys, half of which were inserted,
+  // gives the same results as probing each of the keys.
+  void VerifyBatchProbes() {
+    vector<uint64_t> keys;
+    for (uint64_t i = 0; i < FLAGS_n_keys; i++) {
+      keys.push_back(BigEndian::FromHost64(i << kKeyShift));
+      keys.push_back(BigEndian::FromHost64((i << kKeyShift) | 1));
+    }
+    vector<BloomKeyProbe> probes;
+    vector<const BloomKeyProbe*> probe_ptrs;
+    probes.reserve(keys.size());
+    for (const auto& key : keys) {
+      probes.emplace_back(Slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key)));
+      probe_ptrs.push_back(&probes.back());
+    }
+    unique_ptr<bool[]> present(new bool[keys.size()]);
+    ASSERT_OK(bfr_->CheckKeysPresent(probe_ptrs.data(), probes.size(), nullptr,
+                                     present.get()));
+    for (size_t i = 0; i < probes.size(); i++) {
+      bool single_present = false;
+      ASSERT_OK_FAST(bfr_->CheckKeyPresent(probes[i], nullptr, &single_present));
+      ASSERT_EQ(single_present, present[i]) << "key " << i;
+      if (i % 2 == 0) {
+        ASSERT_TRUE(present[i]) << "key " << i;
+      }
+    }
   }
+
+  // The split-block layout has a somewhat higher false positive rate than
+  // the classic layout for the same size.
+  double max_fp_rate_ratio_ = 1.2;
 };
 
 
@@ -84,6 +123,25 @@ TEST_F(BloomFileTest, TestWriteAndRead) {
   ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
   ASSERT_OK(OpenBloomFile());
   VerifyBloomFile();
+  NO_FATALS(VerifyBatchProbes());
+}
+
+TEST_F(BloomFileTest, TestWriteAndReadSplitBlock) {
+  FLAGS_bloomfile_write_split_block_filters = true;
+  max_fp_rate_ratio_ = 2;
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+  VerifyBloomFile();
+  NO_FATALS(VerifyBatchProbes());
+
+  // The files are marked so that versions which don't know about the
+  // layout refuse to read them.
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id_, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->footer().incompatible_features() &
+              IncompatibleFeatures::SPLIT_BLOCK_BLOOM);
 }
 
 #ifdef NDEBUG
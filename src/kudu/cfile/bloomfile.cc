@@ -22,9 +22,10 @@
 #include <utility>
 #include <vector>
 
-#include <gflags/gflags_declare.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/cfile.pb.h"
@@ -40,6 +41,7 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
@@ -48,6 +50,14 @@
 
 DECLARE_bool(cfile_lazy_open);
 
+DEFINE_bool(bloomfile_write_split_block_filters, false,
+            "Whether to write the blocks of bloom files with the split-block "
+            "layout, in which each key is checked by reading a single cache "
+            "line. Such files can't be read by versions which don't support "
+            "the layout.");
+TAG_FLAG(bloomfile_write_split_block_filters, experimental);
+TAG_FLAG(bloomfile_write_split_block_filters, runtime);
+
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -97,10 +107,14 @@ using BloomCacheTLC = ThreadLocalCache<uint64_t, BloomCacheItem>;
 
 BloomFileWriter::BloomFileWriter(unique_ptr<WritableBlock> block,
                                  const BloomFilterSizing &sizing)
-  : bloom_builder_(sizing) {
+  : bloom_builder_(sizing, FLAGS_bloomfile_write_split_block_filters ?
+                   BloomFilterLayout::kSplitBlock : BloomFilterLayout::kClassic) {
   cfile::WriterOptions opts;
   opts.write_posidx = false;
   opts.write_validx = true;
+  if (bloom_builder_.layout() == BloomFilterLayout::kSplitBlock) {
+    opts.incompatible_features |= IncompatibleFeatures::SPLIT_BLOCK_BLOOM;
+  }
   // Never use compression, regardless of the default settings, since
   // bloom filters are high-entropy data structures by their nature.
   opts.storage_attributes.encoding  = PLAIN_ENCODING;
@@ -169,6 +183,9 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   // Encode the header.
   BloomBlockHeaderPB hdr;
   hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+  if (bloom_builder_.layout() == BloomFilterLayout::kSplitBlock) {
+    hdr.set_layout(BloomBlockHeaderPB::SPLIT_BLOCK);
+  }
   faststring hdr_str;
   PutFixed32(&hdr_str, hdr.ByteSize());
   pb_util::AppendToString(hdr, &hdr_str);
@@ -281,6 +298,17 @@ Status BloomFileReader::ParseBlockHeader(const Slice& block,
   }
 
   data.remove_prefix(header_len);
+  if (hdr->layout() == BloomBlockHeaderPB::SPLIT_BLOCK &&
+      PREDICT_FALSE(data.size() % bloom_internal::kSplitBlockBucketBytes != 0)) {
+    return Status::Corruption(
+      StringPrintf("Split-block bloom filter of size %ld is not a whole number of buckets",
+                   data.size()));
+  }
+  if (PREDICT_FALSE(hdr->layout() != BloomBlockHeaderPB::CLASSIC &&
+                    hdr->layout() != BloomBlockHeaderPB::SPLIT_BLOCK)) {
+    return Status::NotSupported(
+      StringPrintf("Unknown bloom filter layout %d", hdr->layout()));
+  }
   *bloom_data = data;
   return Status::OK();
 }
@@ -288,6 +316,14 @@ Status BloomFileReader::ParseBlockHeader(const Slice& block,
 Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
                                         const IOContext* io_context,
                                         bool *maybe_present) {
+  const BloomKeyProbe* probes[] = { &probe };
+  return CheckKeysPresent(probes, 1, io_context, maybe_present);
+}
+
+Status BloomFileReader::CheckKeysPresent(const BloomKeyProbe* const* probes,
+                                         size_t n,
+                                         const IOContext* io_context,
+                                         bool* maybe_present) {
   DCHECK(init_once_.init_succeeded());
 
   // Since we frequently will access the same BloomFile many times in a row
@@ -306,38 +342,65 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
       << "Cached index reader does not match expected instance";
 
   IndexTreeIterator* index_iter = &bci->index_iter;
-  Status s = index_iter->SeekAtOrBefore(probe.key());
-  if (PREDICT_FALSE(s.IsNotFound())) {
-    // Seek to before the first entry in the file.
-    *maybe_present = false;
-    return Status::OK();
-  }
-  RETURN_NOT_OK(s);
-
-  // Successfully found the pointer to the bloom block.
-  BlockPointer bblk_ptr = index_iter->GetCurrentBlockPointer();
-
-  // If the previous lookup from this bloom on this thread seeked to a different
-  // block in the BloomFile, we need to read the correct block and re-hydrate the
-  // BloomFilter instance.
-  if (!bci->cur_block_pointer.Equals(bblk_ptr)) {
-    BlockHandle dblk_data;
-    RETURN_NOT_OK(reader_->ReadBlock(io_context, bblk_ptr,
-                                     CFileReader::CACHE_BLOCK, &dblk_data));
-
-    // Parse the header in the block.
-    BloomBlockHeaderPB hdr;
-    Slice bloom_data;
-    RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
-
-    // Save the data back into our threadlocal cache.
-    bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions());
-    bci->cur_block_pointer = bblk_ptr;
-    bci->cur_block_handle = std::move(dblk_data);
-  }
+  faststring next_block_key;
+  size_t i = 0;
+  while (i < n) {
+    Status s = index_iter->SeekAtOrBefore(probes[i]->key());
+    if (PREDICT_FALSE(s.IsNotFound())) {
+      // Seek to before the first entry in the file.
+      maybe_present[i++] = false;
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    // Successfully found the pointer to the bloom block.
+    BlockPointer bblk_ptr = index_iter->GetCurrentBlockPointer();
+
+    // If the previous lookup from this bloom on this thread seeked to a different
+    // block in the BloomFile, we need to read the correct block and re-hydrate the
+    // BloomFilter instance.
+    if (!bci->cur_block_pointer.Equals(bblk_ptr)) {
+      BlockHandle dblk_data;
+      RETURN_NOT_OK(reader_->ReadBlock(io_context, bblk_ptr,
+                                       CFileReader::CACHE_BLOCK, &dblk_data,
+                                       BlockCache::HIGH_PRIORITY));
+
+      // Parse the header in the block.
+      BloomBlockHeaderPB hdr;
+      Slice bloom_data;
+      RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
+
+      // Save the data back into our threadlocal cache.
+      bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions(),
+                                   hdr.layout() == BloomBlockHeaderPB::SPLIT_BLOCK ?
+                                   BloomFilterLayout::kSplitBlock :
+                                   BloomFilterLayout::kClassic);
+      bci->cur_block_pointer = bblk_ptr;
+      bci->cur_block_handle = std::move(dblk_data);
+    }
 
-  // Actually check the bloom filter.
-  *maybe_present = bci->cur_bloom.MayContainKey(probe);
+    // The following keys which are covered by the same block are checked
+    // in one batch, up to the first key of the next block.
+    size_t run_end = i + 1;
+    if (run_end < n) {
+      if (index_iter->HasNext()) {
+        RETURN_NOT_OK(index_iter->Next());
+        next_block_key.assign_copy(index_iter->GetCurrentKey().data(),
+                                   index_iter->GetCurrentKey().size());
+        while (run_end < n && probes[run_end]->key().compare(Slice(next_block_key)) < 0) {
+          DCHECK_GE(probes[run_end]->key().compare(probes[run_end - 1]->key()), 0)
+              << "keys must be sorted";
+          run_end++;
+        }
+      } else {
+        run_end = n;
+      }
+    }
+
+    // Actually check the bloom filter.
+    bci->cur_bloom.MayContainKeys(probes + i, run_end - i, maybe_present + i);
+    i = run_end;
+  }
   return Status::OK();
 }
 
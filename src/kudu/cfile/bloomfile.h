@@ -117,6 +117,16 @@ class BloomFileReader {
                          const fs::IOContext* io_context,
                          bool* maybe_present);
 
+  // Check if each of the 'n' keys of 'probes', which must be sorted, may be
+  // present in the file, setting 'maybe_present[i]' for the key of 'probes[i]'.
+  //
+  // Each bloom block is only looked up once for all the keys it covers, and
+  // the keys are checked against it in one batch.
+  Status CheckKeysPresent(const BloomKeyProbe* const* probes,
+                          size_t n,
+                          const fs::IOContext* io_context,
+                          bool* maybe_present);
+
   // Can be called before Init().
   uint64_t FileSize() const {
     return reader_->file_size();
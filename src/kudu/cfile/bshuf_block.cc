@@ -17,13 +17,291 @@
 #include "kudu/cfile/bshuf_block.h"
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
+#include <type_traits>
+#include <vector>
 
+#include "kudu/common/column_predicate.h"
+#include "kudu/gutil/cpu.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/int128.h"
+
+using base::CPU;
 
 namespace kudu {
 namespace cfile {
 
+namespace {
+
+// Whether the AVX2 versions of the predicate evaluation kernels may be used.
+// Like the bitshuffle function selection in bitshuffle_arch_wrapper.cc, this
+// is determined once when the translation unit is initialized to keep the
+// 'cpuid' call out of the hot path.
+bool g_eval_use_avx2 = false;
+
+__attribute__((constructor))
+void SelectPredicateEvalKernels() {
+#if defined(__x86_64__) && !defined(__APPLE__)
+  g_eval_use_avx2 = CPU().has_avx2();
+#endif
+}
+
+// The number of cells evaluated by a kernel in one go. The per-cell match
+// flags for a batch are kept on the stack.
+constexpr size_t kEvalBatchSize = 256;
+
+// IN lists longer than this are evaluated by binary search on each cell
+// instead of comparing every cell against every value in the list.
+constexpr size_t kMaxKernelInListSize = 16;
+
+enum class EvalKernel {
+  kRange,
+  kLowerBound,
+  kUpperBound,
+  kEquality,
+  kInList,
+};
+
+template<typename T>
+struct EvalParams {
+  T lower;
+  T upper;
+  std::vector<T> values;
+};
+
+// Set 'matches[i]' to 1 if 'cells[i]' matches the predicate described by
+// 'params', or to 0 otherwise. The loops are kept free of branches on the
+// cell values so that the compiler vectorizes them.
+template<EvalKernel Kernel, typename T>
+ATTRIBUTE_ALWAYS_INLINE inline void FindMatches(const EvalParams<T>& params,
+                                                const T* __restrict__ cells,
+                                                size_t n,
+                                                uint8_t* __restrict__ matches) {
+  const T lower = params.lower;
+  const T upper = params.upper;
+  switch (Kernel) {
+    case EvalKernel::kRange:
+      for (size_t i = 0; i < n; i++) {
+        matches[i] = (cells[i] >= lower) & (cells[i] < upper);
+      }
+      break;
+    case EvalKernel::kLowerBound:
+      for (size_t i = 0; i < n; i++) {
+        matches[i] = cells[i] >= lower;
+      }
+      break;
+    case EvalKernel::kUpperBound:
+      for (size_t i = 0; i < n; i++) {
+        matches[i] = cells[i] < upper;
+      }
+      break;
+    case EvalKernel::kEquality:
+      for (size_t i = 0; i < n; i++) {
+        matches[i] = cells[i] == lower;
+      }
+      break;
+    case EvalKernel::kInList:
+      memset(matches, 0, n);
+      for (const T& value : params.values) {
+        for (size_t i = 0; i < n; i++) {
+          matches[i] |= cells[i] == value;
+        }
+      }
+      break;
+  }
+}
+
+// A 128-bit integer split into its 64-bit halves.
+struct Int128Halves {
+  explicit Int128Halves(int128_t v)
+      : high(static_cast<int64_t>(v >> 64)),
+        low(static_cast<uint64_t>(v)) {
+  }
+  int64_t high;
+  uint64_t low;
+};
+
+// Whether the 128-bit integer made of 'high' and 'low' is less than 'v'.
+ATTRIBUTE_ALWAYS_INLINE inline uint8_t LessThan(int64_t high, uint64_t low,
+                                                const Int128Halves& v) {
+  return (high < v.high) | ((high == v.high) & (low < v.low));
+}
+
+ATTRIBUTE_ALWAYS_INLINE inline uint8_t EqualTo(int64_t high, uint64_t low,
+                                               const Int128Halves& v) {
+  return (high == v.high) & (low == v.low);
+}
+
+// Like the above, for 128-bit integers such as DECIMAL128 values. Compilers
+// don't vectorize comparisons of __int128, so the cells are compared as pairs
+// of 64-bit halves instead, which they do. This relies on the cells being
+// stored little-endian, i.e. with the low half first.
+template<EvalKernel Kernel>
+ATTRIBUTE_ALWAYS_INLINE inline void FindMatches(const EvalParams<int128_t>& params,
+                                                const int128_t* __restrict__ cells,
+                                                size_t n,
+                                                uint8_t* __restrict__ matches) {
+  const uint64_t* __restrict__ words = reinterpret_cast<const uint64_t*>(cells);
+  const Int128Halves lower(params.lower);
+  const Int128Halves upper(params.upper);
+  switch (Kernel) {
+    case EvalKernel::kRange:
+      for (size_t i = 0; i < n; i++) {
+        int64_t high = static_cast<int64_t>(words[2 * i + 1]);
+        uint64_t low = words[2 * i];
+        matches[i] = (LessThan(high, low, lower) ^ 1) & LessThan(high, low, upper);
+      }
+      break;
+    case EvalKernel::kLowerBound:
+      for (size_t i = 0; i < n; i++) {
+        matches[i] = LessThan(static_cast<int64_t>(words[2 * i + 1]), words[2 * i], lower) ^ 1;
+      }
+      break;
+    case EvalKernel::kUpperBound:
+      for (size_t i = 0; i < n; i++) {
+        matches[i] = LessThan(static_cast<int64_t>(words[2 * i + 1]), words[2 * i], upper);
+      }
+      break;
+    case EvalKernel::kEquality:
+      for (size_t i = 0; i < n; i++) {
+        matches[i] = EqualTo(static_cast<int64_t>(words[2 * i + 1]), words[2 * i], lower);
+      }
+      break;
+    case EvalKernel::kInList:
+      memset(matches, 0, n);
+      for (const int128_t& value : params.values) {
+        const Int128Halves v(value);
+        for (size_t i = 0; i < n; i++) {
+          matches[i] |= EqualTo(static_cast<int64_t>(words[2 * i + 1]), words[2 * i], v);
+        }
+      }
+      break;
+  }
+}
+
+template<typename T, EvalKernel Kernel>
+void FindMatchesDefault(const EvalParams<T>& params, const T* cells, size_t n, uint8_t* matches) {
+  FindMatches<Kernel>(params, cells, n, matches);
+}
+
+#if defined(__x86_64__)
+template<typename T, EvalKernel Kernel>
+__attribute__((target("avx2")))
+void FindMatchesAvx2(const EvalParams<T>& params, const T* cells, size_t n, uint8_t* matches) {
+  FindMatches<Kernel>(params, cells, n, matches);
+}
+#endif
+
+template<typename T, EvalKernel Kernel>
+void EvaluateWithKernel(const EvalParams<T>& params,
+                        const T* cells,
+                        size_t n,
+                        SelectionVectorView* sel) {
+  uint8_t matches[kEvalBatchSize];
+  for (size_t offset = 0; offset < n; offset += kEvalBatchSize) {
+    size_t batch = std::min(kEvalBatchSize, n - offset);
+#if defined(__x86_64__)
+    if (g_eval_use_avx2) {
+      FindMatchesAvx2<T, Kernel>(params, cells + offset, batch, matches);
+    } else {
+      FindMatchesDefault<T, Kernel>(params, cells + offset, batch, matches);
+    }
+#else
+    FindMatchesDefault<T, Kernel>(params, cells + offset, batch, matches);
+#endif
+    for (size_t i = 0; i < batch; i++) {
+      if (!matches[i]) {
+        sel->ClearBit(offset + i);
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
+template<DataType Type>
+void EvaluatePredicateOnCells(const ColumnPredicate& pred,
+                              const uint8_t* cells,
+                              size_t n,
+                              SelectionVectorView* sel) {
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  const CppType* typed_cells = reinterpret_cast<const CppType*>(cells);
+
+  // Floating point comparisons in DataTypeTraits treat NaN as equal to any
+  // value, which the kernels below do not replicate.
+  if (!std::is_floating_point<CppType>::value) {
+    EvalParams<CppType> params;
+    switch (pred.predicate_type()) {
+      case PredicateType::None:
+        sel->ClearBits(n);
+        return;
+      case PredicateType::IsNotNull:
+        return;
+      case PredicateType::Range:
+        if (pred.raw_lower() != nullptr) {
+          params.lower = UnalignedLoad<CppType>(pred.raw_lower());
+        }
+        if (pred.raw_upper() != nullptr) {
+          params.upper = UnalignedLoad<CppType>(pred.raw_upper());
+        }
+        if (pred.raw_lower() == nullptr) {
+          EvaluateWithKernel<CppType, EvalKernel::kUpperBound>(params, typed_cells, n, sel);
+        } else if (pred.raw_upper() == nullptr) {
+          EvaluateWithKernel<CppType, EvalKernel::kLowerBound>(params, typed_cells, n, sel);
+        } else {
+          EvaluateWithKernel<CppType, EvalKernel::kRange>(params, typed_cells, n, sel);
+        }
+        return;
+      case PredicateType::Equality:
+        params.lower = UnalignedLoad<CppType>(pred.raw_lower());
+        EvaluateWithKernel<CppType, EvalKernel::kEquality>(params, typed_cells, n, sel);
+        return;
+      case PredicateType::InList:
+        if (pred.raw_values().size() > kMaxKernelInListSize) {
+          break;
+        }
+        params.values.reserve(pred.raw_values().size());
+        for (const void* value : pred.raw_values()) {
+          params.values.push_back(UnalignedLoad<CppType>(value));
+        }
+        EvaluateWithKernel<CppType, EvalKernel::kInList>(params, typed_cells, n, sel);
+        return;
+      default:
+        break;
+    }
+  }
+
+  for (size_t i = 0; i < n; i++, cells += sizeof(CppType)) {
+    if (sel->TestBit(i) && !pred.EvaluateCell<Type>(cells)) {
+      sel->ClearBit(i);
+    }
+  }
+}
+
+template void EvaluatePredicateOnCells<UINT8>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<INT8>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<UINT16>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<INT16>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<UINT32>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<INT32>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<UINT64>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<INT64>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<INT128>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<FLOAT>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+template void EvaluatePredicateOnCells<DOUBLE>(
+    const ColumnPredicate&, const uint8_t*, size_t, SelectionVectorView*);
+
 void AbortWithBitShuffleError(int64_t val) {
   switch (val) {
     case -1:
@@ -35,8 +35,10 @@
 #include "kudu/cfile/bitshuffle_arch_wrapper.h"
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/column_materialization_context.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
@@ -50,12 +52,29 @@
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+class ColumnPredicate;
+
 namespace cfile {
 
 
 // Log a FATAL error message and exit.
 void AbortWithBitShuffleError(int64_t val) ATTRIBUTE_NORETURN;
 
+// Evaluate 'pred' against 'n' contiguous cells of physical type 'Type'
+// starting at 'cells', clearing the bit in 'sel' for each cell that does not
+// match. Cells whose bit is already cleared may or may not be evaluated.
+//
+// Range, Equality and short InList predicates on non-floating-point types are
+// evaluated with branch-free kernels which are built for both the baseline
+// and the AVX2 instruction sets, picking one at runtime. Other predicates
+// fall back to ColumnPredicate::EvaluateCell().
+template<DataType Type>
+void EvaluatePredicateOnCells(const ColumnPredicate& pred,
+                              const uint8_t* cells,
+                              size_t n,
+                              SelectionVectorView* sel);
+
 // BshufBlockBuilder bitshuffles and compresses the bits of fixed
 // size type blocks with lz4.
 //
@@ -328,6 +347,19 @@ class BShufBlockDecoder final : public BlockDecoder {
     return CopyNextValuesToArray(n, dst->data());
   }
 
+  // Copy the next values into 'dst' and evaluate the predicate over them
+  // while they are still hot in the cache, rather than leaving evaluation
+  // to a separate pass over the materialized column.
+  Status CopyNextAndEval(size_t* n,
+                         ColumnMaterializationContext* ctx,
+                         SelectionVectorView* sel,
+                         ColumnDataView* dst) override {
+    ctx->SetDecoderEvalSupported();
+    RETURN_NOT_OK(CopyNextValues(n, dst));
+    EvaluatePredicateOnCells<Type>(*ctx->pred(), dst->data(), *n, sel);
+    return Status::OK();
+  }
+
   // Copy the codewords to a temporary buffer.
   // This API provides a more convenient way for the dictionary decoder to copy out
   // integer codewords and then look up the strings. If we use the CopyNextValuesToArray()
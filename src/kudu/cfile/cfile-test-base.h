@@ -387,8 +387,8 @@ class CFileTestBase : public KuduTest {
     ASSERT_OK(w.Start());
 
     // Append given number of values to the test tree. We use 100 to match
-    // the output block size of compaction (kCompactionOutputBlockNumRows in
-    // compaction.cc, unfortunately not linkable from the cfile/ module)
+    // the default output block size of compaction
+    // (--compaction_output_block_rows in compaction.cc)
     const size_t kBufferSize = 100;
     size_t i = 0;
     while (i < num_entries) {
@@ -42,6 +42,7 @@
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
@@ -76,15 +77,26 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(cfile_adaptive_block_size);
 DECLARE_bool(cfile_write_checksums);
 DECLARE_bool(cfile_verify_checksums);
+DECLARE_bool(cfile_direct_io_for_uncached_reads);
+DECLARE_bool(cfile_read_ahead_prefetch);
+DECLARE_bool(cfile_prefix_compress_index_blocks);
+DECLARE_bool(cfile_zero_copy_strings);
+DECLARE_int32(cfile_read_ahead_blocks);
+DECLARE_int32(block_cache_compressed_percentage);
+DECLARE_int32(block_cache_priority_percentage);
 
 #if defined(__linux__)
 DECLARE_string(nvm_cache_path);
 DECLARE_bool(nvm_cache_simulate_allocation_failure);
 #endif
 
+METRIC_DECLARE_counter(block_cache_compressed_hits_caching);
+METRIC_DECLARE_counter(block_cache_compressed_inserts);
 METRIC_DECLARE_counter(block_cache_hits_caching);
+METRIC_DECLARE_counter(block_cache_priority_hits_caching);
 
 METRIC_DECLARE_entity(server);
 
@@ -254,6 +266,51 @@ class TestCFile : public CFileTestBase {
     TimeSeekAndReadFileWithNulls(generator, block_id, n);
   }
 
+  // Scans the whole file with a selection vector which deselects long and
+  // short runs of rows, and verifies the values of the selected rows, which
+  // exercises skipping over the deselected ones without decoding them.
+  template <class DataGeneratorType>
+  void TestScanWithDeselectedRows(DataGeneratorType* generator, EncodingType encoding) {
+    const size_t kNumRows = 10000;
+    BlockId block_id;
+    WriteTestFile(generator, encoding, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE, &block_id);
+
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+    ASSERT_OK(iter->SeekToFirst());
+
+    ScopedColumnBlock<DataGeneratorType::kDataType> cb(1000);
+    SelectionVector sel(cb.nrows());
+    size_t fetched = 0;
+    while (iter->HasNext()) {
+      size_t n = std::min(cb.nrows(), kNumRows - fetched);
+      for (size_t i = 0; i < n; i++) {
+        size_t row = fetched + i;
+        BitmapChange(sel.mutable_bitmap(), i, row % 100 < 10 || row % 37 == 0);
+      }
+      ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+      ASSERT_OK_FAST(iter->CopyNextValues(&n, &ctx));
+
+      generator->Build(fetched, n);
+      for (size_t i = 0; i < n; i++) {
+        if (!sel.IsRowSelected(i)) {
+          continue;
+        }
+        bool expected_null = generator->TestValueShouldBeNull(fetched + i);
+        ASSERT_EQ(expected_null, cb.is_null(i));
+        if (!expected_null) {
+          ASSERT_EQ((*generator)[i], cb[i]);
+        }
+      }
+      fetched += n;
+    }
+    ASSERT_EQ(kNumRows, fetched);
+  }
+
   void TestReadWriteRawBlocks(CompressionType compression, int num_entries) {
     // Test Write
     unique_ptr<WritableBlock> sink;
@@ -721,11 +778,56 @@ TEST_P(TestCFileBothCacheTypes, TestReadWriteStringsPrefixEncoding) {
   TestReadWriteStrings(PREFIX_ENCODING);
 }
 
+// Test that files whose index blocks are prefix-compressed are read like the
+// others.
+TEST_P(TestCFileBothCacheTypes, TestReadWriteStringsPrefixCompressedIndex) {
+  FLAGS_cfile_prefix_compress_index_blocks = true;
+  TestReadWriteStrings(PREFIX_ENCODING);
+}
+
 // Read/Write test for dictionary encoded blocks
 TEST_P(TestCFileBothCacheTypes, TestReadWriteStringsDictEncoding) {
   TestReadWriteStrings(DICT_ENCODING);
 }
 
+// Test that the cells of zero-copy string scans reference the blocks they were
+// read from, which stay alive along with the cells even after the iterator is
+// gone.
+TEST_P(TestCFileBothCacheTypes, TestZeroCopyStrings) {
+  FLAGS_cfile_zero_copy_strings = true;
+  const int kNumRows = 10000;
+  auto formatter = [](size_t x) { return Substitute("hello $0", x); };
+  for (auto encoding : { PLAIN_ENCODING, DICT_ENCODING }) {
+    BlockId block_id;
+    StringDataGenerator<false> generator(formatter);
+    WriteTestFile(&generator, encoding, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE, &block_id);
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+    for (auto cache_control : { CFileReader::CACHE_BLOCK, CFileReader::DONT_CACHE_BLOCK }) {
+      SCOPED_TRACE(Substitute("encoding=$0, cache_control=$1", encoding, cache_control));
+      ScopedColumnBlock<STRING> out(kNumRows);
+      SelectionVector sel(out.nrows());
+      {
+        gscoped_ptr<CFileIterator> iter;
+        ASSERT_OK(reader->NewIterator(&iter, cache_control, nullptr));
+        ASSERT_OK(iter->SeekToFirst());
+        size_t n = kNumRows;
+        ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&out, &sel);
+        ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+        ASSERT_EQ(kNumRows, n);
+      }
+      // The strings weren't copied into the arena, yet are still readable.
+      ASSERT_LT(out.arena()->memory_footprint(), kNumRows);
+      for (int i = 0; i < kNumRows; i++) {
+        ASSERT_EQ(formatter(i), out[i].ToString());
+      }
+    }
+  }
+}
+
 // Regression test for properly handling cells that are larger
 // than the index block and/or data block size.
 //
@@ -791,6 +893,319 @@ TEST_P(TestCFileBothCacheTypes, TestMetadata) {
   }
 }
 
+TEST_P(TestCFileBothCacheTypes, TestZoneMaps) {
+  const int kNumRows = 10000;
+  const int kNumNullRows = 1000;
+  BlockId block_id;
+
+  // Write a nullable file whose first rows are all NULL, followed by
+  // increasing values, using small blocks so the file has many of them.
+  {
+    unique_ptr<WritableBlock> sink;
+    ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
+    block_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.write_zone_map = true;
+    opts.storage_attributes.cfile_block_size = 1024;
+    CFileWriter w(opts, GetTypeInfo(INT32), true, std::move(sink));
+    ASSERT_OK(w.Start());
+
+    int32_t data[kNumRows];
+    uint8_t null_bitmap[BitmapSize(kNumRows)];
+    for (int i = 0; i < kNumRows; i++) {
+      data[i] = i;
+      BitmapChange(null_bitmap, i, i >= kNumNullRows);
+    }
+    ASSERT_OK(w.AppendNullableEntries(null_bitmap, data, kNumRows));
+    ASSERT_OK(w.Finish());
+
+    // The summary of the zone map covers the whole file.
+    ZoneMapEntryPB summary;
+    ASSERT_TRUE(w.GetZoneMapSummary(&summary));
+    EXPECT_EQ(0, summary.first_ordinal());
+    EXPECT_EQ(kNumRows, summary.num_rows());
+    EXPECT_EQ(kNumNullRows, summary.null_count());
+    int32_t min_value;
+    int32_t max_value;
+    ASSERT_EQ(sizeof(min_value), summary.min_value().size());
+    ASSERT_EQ(sizeof(max_value), summary.max_value().size());
+    memcpy(&min_value, summary.min_value().data(), sizeof(min_value));
+    memcpy(&max_value, summary.max_value().data(), sizeof(max_value));
+    EXPECT_EQ(kNumNullRows, min_value);
+    EXPECT_EQ(kNumRows - 1, max_value);
+  }
+
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->has_zone_map());
+  ASSERT_TRUE(reader->footer().compatible_features() & CompatibleFeatures::ZONE_MAP);
+  const ZoneMapPB* zone_map;
+  ASSERT_OK(reader->GetZoneMap(nullptr, &zone_map));
+  ASSERT_GT(zone_map->entries_size(), 1);
+
+  gscoped_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+
+  ColumnSchema col("c", INT32, true);
+  auto may_match = [&](const ColumnPredicate& pred, rowid_t ord_idx, size_t n) {
+    bool ret;
+    CHECK_OK(iter->RowsMayMatch(ord_idx, n, pred, &ret));
+    return ret;
+  };
+
+  int32_t value = 5000;
+  ColumnPredicate eq = ColumnPredicate::Equality(col, &value);
+  EXPECT_FALSE(may_match(eq, 0, 100));
+  EXPECT_FALSE(may_match(eq, 2000, 1000));
+  EXPECT_TRUE(may_match(eq, 4990, 20));
+  EXPECT_TRUE(may_match(eq, 0, kNumRows));
+
+  int32_t lower = 20000;
+  int32_t upper = 30000;
+  ColumnPredicate range = ColumnPredicate::Range(col, &lower, &upper);
+  EXPECT_FALSE(may_match(range, 0, kNumRows));
+
+  lower = 9990;
+  ColumnPredicate lower_bound = ColumnPredicate::Range(col, &lower, nullptr);
+  EXPECT_FALSE(may_match(lower_bound, 5000, 1000));
+  EXPECT_TRUE(may_match(lower_bound, kNumRows - 100, 100));
+
+  ColumnPredicate is_null = ColumnPredicate::IsNull(col);
+  EXPECT_TRUE(may_match(is_null, 0, 100));
+  EXPECT_FALSE(may_match(is_null, 5000, 100));
+
+  ColumnPredicate is_not_null = ColumnPredicate::IsNotNull(col);
+  EXPECT_TRUE(may_match(is_not_null, 0, kNumRows));
+
+  // Rows past the end of the file are not covered by the zone map.
+  EXPECT_TRUE(may_match(range, kNumRows - 10, 20));
+}
+
+TEST_P(TestCFileBothCacheTypes, TestBloomFilters) {
+  const int kNumRows = 10000;
+  const int kRowsPerCheck = 100;
+  BlockId block_id;
+
+  // Write even values in a scattered order, so that the min/max of every
+  // block spans most of the value range and only the bloom filters can rule
+  // blocks out.
+  vector<int64_t> data(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    data[i] = 2 * ((i * 7919L) % kNumRows);
+  }
+  {
+    unique_ptr<WritableBlock> sink;
+    ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
+    block_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.write_bloom_filter = true;
+    opts.storage_attributes.cfile_block_size = 4096;
+    CFileWriter w(opts, GetTypeInfo(INT64), false, std::move(sink));
+    ASSERT_OK(w.Start());
+    ASSERT_OK(w.AppendEntries(data.data(), kNumRows));
+    ASSERT_OK(w.Finish());
+  }
+
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->has_zone_map());
+  gscoped_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+
+  ColumnSchema col("c", INT64);
+  int num_checks = 0;
+  int num_false_positives = 0;
+  for (int start = 0; start < kNumRows; start += kRowsPerCheck) {
+    // A value present in these rows must always be found.
+    ColumnPredicate present = ColumnPredicate::Equality(col, &data[start]);
+    bool may_match;
+    ASSERT_OK(iter->RowsMayMatch(start, kRowsPerCheck, present, &may_match));
+    ASSERT_TRUE(may_match);
+
+    // An odd value is never present.
+    int64_t absent_value = data[start] + 1;
+    int64_t other_absent_value = data[start] + 3;
+    ColumnPredicate absent = ColumnPredicate::Equality(col, &absent_value);
+    ASSERT_OK(iter->RowsMayMatch(start, kRowsPerCheck, absent, &may_match));
+    num_checks++;
+    num_false_positives += may_match;
+
+    vector<const void*> values = { &absent_value, &other_absent_value };
+    ColumnPredicate absent_list = ColumnPredicate::InList(col, &values);
+    ASSERT_OK(iter->RowsMayMatch(start, kRowsPerCheck, absent_list, &may_match));
+    num_checks++;
+    num_false_positives += may_match;
+  }
+  LOG(INFO) << num_false_positives << "/" << num_checks << " false positives";
+  ASSERT_LT(num_false_positives, num_checks / 10);
+}
+
+// Test that sequential scans which read data blocks ahead return the same
+// data as regular scans, stay within their budget, and release it when done.
+TEST_P(TestCFileBothCacheTypes, TestReadAhead) {
+  const int kNumRows = 100000;
+  FLAGS_cfile_read_ahead_blocks = 4;
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE,
+                &block_id);
+
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+  // Read ahead on the read-ahead threads, then with kernel prefetches.
+  for (bool prefetch : { false, true }) {
+    FLAGS_cfile_read_ahead_prefetch = prefetch;
+    for (auto cache_control : { CFileReader::CACHE_BLOCK, CFileReader::DONT_CACHE_BLOCK }) {
+      // A budget smaller than a block disables read-ahead entirely.
+      for (int64_t budget_bytes : { 1024 * 1024, 2048, 1 }) {
+        SCOPED_TRACE(Substitute("prefetch=$0, cache_control=$1, budget=$2",
+                                prefetch, cache_control, budget_bytes));
+        fs::ReadAheadBudget budget(budget_bytes);
+        const fs::IOContext io_context({ "read-ahead-tablet", &budget });
+        {
+          gscoped_ptr<CFileIterator> iter;
+          ASSERT_OK(reader->NewIterator(&iter, cache_control, &io_context));
+          ASSERT_OK(iter->SeekToFirst());
+          if (budget_bytes > 1) {
+            ASSERT_GT(budget.used_bytes(), 0);
+          }
+
+          ScopedColumnBlock<UINT32> out(1000);
+          SelectionVector sel(out.nrows());
+          int64_t max_used_bytes = 0;
+          size_t fetched = 0;
+          bool rewound = false;
+          while (iter->HasNext()) {
+            // Jump back to the start halfway through, which discards any
+            // read-ahead.
+            if (!rewound && fetched == kNumRows / 2) {
+              ASSERT_OK(iter->SeekToOrdinal(0));
+              fetched = 0;
+              rewound = true;
+            }
+            size_t n = std::min<size_t>(out.nrows(), kNumRows - fetched);
+            ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&out, &sel);
+            ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+            for (size_t i = 0; i < n; i++) {
+              ASSERT_EQ(generator.BuildTestValue(0, fetched + i), out[i]);
+            }
+            fetched += n;
+            max_used_bytes = std::max(max_used_bytes, budget.used_bytes());
+          }
+          ASSERT_EQ(kNumRows, fetched);
+          ASSERT_LE(max_used_bytes, budget_bytes);
+        }
+        ASSERT_EQ(0, budget.used_bytes());
+      }
+    }
+  }
+}
+
+// Test that scans which don't fill the block cache read the same data with
+// direct I/O.
+TEST_P(TestCFileBothCacheTypes, TestDirectIOForUncachedReads) {
+  const int kNumRows = 10000;
+  FLAGS_cfile_direct_io_for_uncached_reads = true;
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE,
+                &block_id);
+
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+  for (auto cache_control : { CFileReader::CACHE_BLOCK, CFileReader::DONT_CACHE_BLOCK }) {
+    SCOPED_TRACE(cache_control);
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, cache_control, nullptr));
+    ASSERT_OK(iter->SeekToFirst());
+
+    ScopedColumnBlock<UINT32> out(1000);
+    SelectionVector sel(out.nrows());
+    size_t fetched = 0;
+    while (iter->HasNext()) {
+      size_t n = out.nrows();
+      ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&out, &sel);
+      ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+      for (size_t i = 0; i < n; i++) {
+        ASSERT_EQ(generator.BuildTestValue(0, fetched + i), out[i]);
+      }
+      fetched += n;
+    }
+    ASSERT_EQ(kNumRows, fetched);
+  }
+}
+
+// Test that with adaptive block sizes, the data blocks of a well compressed
+// column are fewer, and still read back.
+TEST_P(TestCFileBothCacheTypes, TestAdaptiveBlockSize) {
+  const int kNumRows = 100000;
+  vector<int32_t> data(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    data[i] = i / 1000;
+  }
+
+  // Writes the rows and returns the number of data blocks of the file.
+  auto write_file = [&](bool adaptive, int* num_blocks) {
+    FLAGS_cfile_adaptive_block_size = adaptive;
+    unique_ptr<WritableBlock> sink;
+    ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
+    BlockId block_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.write_zone_map = true;
+    opts.storage_attributes.encoding = PLAIN_ENCODING;
+    opts.storage_attributes.compression = LZ4;
+    opts.storage_attributes.cfile_block_size = 4096;
+    CFileWriter w(opts, GetTypeInfo(INT32), false, std::move(sink));
+    ASSERT_OK(w.Start());
+    ASSERT_OK(w.AppendEntries(data.data(), kNumRows));
+    ASSERT_OK(w.Finish());
+
+    unique_ptr<ReadableBlock> source;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+    const ZoneMapPB* zone_map;
+    ASSERT_OK(reader->GetZoneMap(nullptr, &zone_map));
+    *num_blocks = zone_map->entries_size();
+
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+    ASSERT_OK(iter->SeekToFirst());
+    ScopedColumnBlock<INT32> out(1000);
+    SelectionVector sel(out.nrows());
+    int fetched = 0;
+    while (iter->HasNext()) {
+      size_t n = out.nrows();
+      ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&out, &sel);
+      ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+      for (size_t i = 0; i < n; i++) {
+        ASSERT_EQ(data[fetched + i], out[i]);
+      }
+      fetched += n;
+    }
+    ASSERT_EQ(kNumRows, fetched);
+  };
+
+  int fixed_blocks;
+  NO_FATALS(write_file(false, &fixed_blocks));
+  int adaptive_blocks;
+  NO_FATALS(write_file(true, &adaptive_blocks));
+  ASSERT_LT(adaptive_blocks, fixed_blocks);
+}
+
 TEST_P(TestCFileBothCacheTypes, TestDefaultColumnIter) {
   const int kNumItems = 64;
   uint8_t null_bitmap[BitmapSize(kNumItems)];
@@ -930,6 +1345,21 @@ TEST_P(TestCFileBothCacheTypes, TestNullDictStrings) {
   TestNullTypes(&generator, DICT_ENCODING, LZ4);
 }
 
+TEST_P(TestCFileBothCacheTypes, TestScanWithDeselectedRows) {
+  for (auto encoding : { PLAIN_ENCODING, BIT_SHUFFLE, RLE }) {
+    SCOPED_TRACE(encoding);
+    UInt32DataGenerator<false> generator;
+    NO_FATALS(TestScanWithDeselectedRows(&generator, encoding));
+    UInt32DataGenerator<true> nullable_generator;
+    NO_FATALS(TestScanWithDeselectedRows(&nullable_generator, encoding));
+  }
+  for (auto encoding : { PLAIN_ENCODING, PREFIX_ENCODING, DICT_ENCODING }) {
+    SCOPED_TRACE(encoding);
+    StringDataGenerator<true> generator("hello %zu");
+    NO_FATALS(TestScanWithDeselectedRows(&generator, encoding));
+  }
+}
+
 TEST_P(TestCFileBothCacheTypes, TestReleaseBlock) {
   unique_ptr<WritableBlock> sink;
   ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
@@ -1028,10 +1458,60 @@ TEST_P(TestCFileBothCacheTypes, TestCacheKeysAreStable) {
 
     // The first time through, we miss in the seek and in the ReadBlock().
     // But the second time through, both are hits, because we've got the same
-    // cache keys as before.
-    ASSERT_EQ(i * 2, down_cast<Counter*>(
+    // cache keys as before. The index block is cached in the high-priority
+    // partition and the data block in the normal one.
+    ASSERT_EQ(i, down_cast<Counter*>(
+        entity->FindOrNull(METRIC_block_cache_priority_hits_caching).get())->value());
+    ASSERT_EQ(i, down_cast<Counter*>(
+        entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value());
+  }
+}
+
+TEST_P(TestCFileBothCacheTypes, TestCompressedTier) {
+  // An NVM cache can't be created without capacity.
+  if (GetParam() != DRAM_CACHE) return;
+
+  // Give all of the capacity to the compressed tier, so that decompressed
+  // blocks are evicted as soon as they are no longer referenced.
+  FLAGS_block_cache_priority_percentage = 0;
+  FLAGS_block_cache_compressed_percentage = 100;
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache* cache = BlockCache::GetSingleton();
+  ASSERT_TRUE(cache->has_compressed_tier());
+  cache->StartInstrumentation(entity);
+
+  BlockId block_id;
+  {
+    const int nrows = 1000;
+    StringDataGenerator<false> generator("hello %04d");
+    WriteTestFile(&generator, PLAIN_ENCODING, LZ4, nrows, SMALL_BLOCKSIZE, &block_id);
+  }
+
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+  gscoped_ptr<IndexTreeIterator> iter;
+  iter.reset(IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+  ASSERT_OK(iter->SeekToFirst());
+  const int64_t inserts = down_cast<Counter*>(
+      entity->FindOrNull(METRIC_block_cache_compressed_inserts).get())->value();
+
+  // The first read of the data block misses and caches its compressed form,
+  // which the second read decompresses.
+  for (int i = 0; i < 2; i++) {
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(nullptr, iter->GetCurrentBlockPointer(),
+                                CFileReader::CACHE_BLOCK, &bh));
+    ASSERT_FALSE(bh.data().empty());
+    ASSERT_EQ(0, down_cast<Counter*>(
         entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value());
+    ASSERT_EQ(inserts + 1, down_cast<Counter*>(
+        entity->FindOrNull(METRIC_block_cache_compressed_inserts).get())->value());
   }
+  ASSERT_EQ(1, down_cast<Counter*>(
+      entity->FindOrNull(METRIC_block_cache_compressed_hits_caching).get())->value());
 }
 
 #if defined(HAVE_LIB_VMEM)
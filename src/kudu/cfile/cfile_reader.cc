@@ -36,11 +36,13 @@
 #include "kudu/cfile/cfile_writer.h" // for kMagicString
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
+#include "kudu/common/iterator_stats.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/types.h"
@@ -52,9 +54,11 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
@@ -63,11 +67,14 @@
 #include "kudu/util/malloc.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/memory/overwrite.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/rle-encoding.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_bool(cfile_lazy_open, true,
@@ -83,11 +90,53 @@ DEFINE_double(cfile_inject_corruption, 0,
               "with a corruption status");
 TAG_FLAG(cfile_inject_corruption, hidden);
 
+DEFINE_int32(cfile_read_ahead_blocks, 0,
+             "Number of data blocks past the current one that sequential CFile "
+             "scans read in the background, subject to the scan's read-ahead "
+             "budget (see --scan_read_ahead_budget_bytes). 0 disables read-ahead.");
+TAG_FLAG(cfile_read_ahead_blocks, experimental);
+TAG_FLAG(cfile_read_ahead_blocks, runtime);
+
+DEFINE_int32(cfile_read_ahead_threads, 8,
+             "Maximum number of threads used to read CFile data blocks ahead of "
+             "scans. Only relevant if --cfile_read_ahead_blocks is positive.");
+TAG_FLAG(cfile_read_ahead_threads, experimental);
+
+DEFINE_bool(cfile_read_ahead_prefetch, false,
+            "If true, CFile read-ahead has the kernel read data blocks into the "
+            "page cache in the background instead of reading them on the "
+            "read-ahead threads. Many reads may then be in flight at once "
+            "without a thread for each; the scan copies the blocks from the "
+            "page cache when it reaches them.");
+TAG_FLAG(cfile_read_ahead_prefetch, experimental);
+TAG_FLAG(cfile_read_ahead_prefetch, runtime);
+
+DEFINE_bool(cfile_direct_io_for_uncached_reads, false,
+            "If true, CFile data blocks read by scans which don't fill the block "
+            "cache are read with direct I/O where the filesystem supports it, "
+            "so that large one-off scans don't evict frequently read data from "
+            "the OS page cache.");
+TAG_FLAG(cfile_direct_io_for_uncached_reads, experimental);
+TAG_FLAG(cfile_direct_io_for_uncached_reads, runtime);
+
+DEFINE_bool(cfile_zero_copy_strings, false,
+            "If true, scans of plain and dictionary-encoded BINARY and STRING "
+            "columns output cells which point straight into the CFile blocks "
+            "they were read from, rather than copying every cell into the "
+            "scan's arena. The blocks stay pinned in the block cache until the "
+            "batch of rows referencing them is released, so that the only copy "
+            "of a cell is into the scan response.");
+TAG_FLAG(cfile_zero_copy_strings, advanced);
+TAG_FLAG(cfile_zero_copy_strings, experimental);
+TAG_FLAG(cfile_zero_copy_strings, runtime);
+
 using kudu::fault_injection::MaybeTrue;
 using kudu::fs::ErrorHandlerType;
 using kudu::fs::IOContext;
+using kudu::fs::ReadAheadBudget;
 using kudu::fs::ReadableBlock;
 using kudu::pb_util::SecureDebugString;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -135,7 +184,10 @@ CFileReader::CFileReader(ReaderOptions options,
                          uint64_t file_size,
                          unique_ptr<ReadableBlock> block) :
   block_(std::move(block)),
+  block_offset_(options.block_offset),
   file_size_(file_size),
+  cache_partition_(options.table_id.empty() ? nullptr :
+                   BlockCache::GetSingleton()->GetTablePartition(options.table_id)),
   codec_(nullptr),
   mem_consumption_(std::move(options.parent_mem_tracker),
                    memory_footprint()) {
@@ -160,9 +212,18 @@ Status CFileReader::OpenNoInit(unique_ptr<ReadableBlock> block,
                                unique_ptr<CFileReader>* reader) {
   uint64_t block_size;
   RETURN_NOT_OK(block->Size(&block_size));
+  uint64_t file_size = block_size;
+  if (options.block_length != 0) {
+    if (options.block_offset + options.block_length > block_size) {
+      return Status::Corruption(Substitute(
+          "CFile range $0+$1 is past the end of block $2 of size $3",
+          options.block_offset, options.block_length, block->id().ToString(), block_size));
+    }
+    file_size = options.block_length;
+  }
   const IOContext* io_context = options.io_context;
   unique_ptr<CFileReader> reader_local(
-      new CFileReader(std::move(options), block_size, std::move(block)));
+      new CFileReader(std::move(options), file_size, std::move(block)));
   if (!FLAGS_cfile_lazy_open) {
     RETURN_NOT_OK(reader_local->Init(io_context));
   }
@@ -221,7 +282,7 @@ Status CFileReader::ReadAndParseHeader() {
   // proper protobuf header.
   uint8_t mal_scratch[kMagicAndLengthSize];
   Slice mal(mal_scratch, kMagicAndLengthSize);
-  RETURN_NOT_OK_PREPEND(block_->Read(0, mal),
+  RETURN_NOT_OK_PREPEND(block_->Read(block_offset_, mal),
                         "failed to read CFile pre-header");
   uint32_t header_size;
   RETURN_NOT_OK_PREPEND(ParseMagicAndLength(mal, &cfile_version_, &header_size),
@@ -244,7 +305,7 @@ Status CFileReader::ReadAndParseHeader() {
   if (has_checksums() && FLAGS_cfile_verify_checksums) {
     results.push_back(checksum);
   }
-  RETURN_NOT_OK(block_->ReadV(off, results));
+  RETURN_NOT_OK(block_->ReadV(block_offset_ + off, results));
 
   if (has_checksums() && FLAGS_cfile_verify_checksums) {
     Slice slices[] = { mal, header };
@@ -274,7 +335,7 @@ Status CFileReader::ReadAndParseFooter() {
   // and the length of the actual protobuf footer.
   uint8_t mal_scratch[kMagicAndLengthSize];
   Slice mal(mal_scratch, kMagicAndLengthSize);
-  RETURN_NOT_OK(block_->Read(file_size_ - kMagicAndLengthSize, mal));
+  RETURN_NOT_OK(block_->Read(block_offset_ + file_size_ - kMagicAndLengthSize, mal));
   uint32_t footer_size;
   RETURN_NOT_OK(ParseMagicAndLength(mal, &cfile_version_, &footer_size));
 
@@ -296,7 +357,7 @@ Status CFileReader::ReadAndParseFooter() {
   // This is done to avoid the need for a follow up read call.
   Slice results[2] = {checksum, footer};
   uint64_t off = file_size_ - kMagicAndLengthSize - footer_size - kChecksumSize;
-  RETURN_NOT_OK(block_->ReadV(off, results));
+  RETURN_NOT_OK(block_->ReadV(block_offset_ + off, results));
 
   // Parse the protobuf footer.
   // This needs to be done before validating the checksum since the
@@ -372,9 +433,11 @@ class ScratchMemory {
   // no capacity and cannot evict to make room, this will fall back
   // to allocating from the heap. In that case, IsFromCache() will
   // return false.
-  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size) {
+  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size,
+                            BlockCache::Priority priority, uint32_t stored_size,
+                            Cache* table_partition) {
     DCHECK(!ptr_);
-    from_cache_ = cache->Allocate(key, size);
+    from_cache_ = cache->Allocate(key, size, priority, stored_size, table_partition);
     if (!from_cache_.valid()) {
       AllocateFromHeap(size);
       return;
@@ -384,6 +447,20 @@ class ScratchMemory {
     size_ = size;
   }
 
+  // Like TryAllocateFromCache(), but allocates from the compressed tier of
+  // the cache.
+  void TryAllocateCompressedFromCache(BlockCache* cache, const BlockCache::CacheKey& key,
+                                      int size, uint32_t stored_size) {
+    DCHECK(!ptr_);
+    from_cache_ = cache->AllocateCompressed(key, size, stored_size);
+    if (!from_cache_.valid()) {
+      AllocateFromHeap(size);
+      return;
+    }
+    ptr_ = from_cache_.val_ptr();
+    size_ = size;
+  }
+
   void AllocateFromHeap(int size) {
     DCHECK(!ptr_);
     from_cache_.reset();
@@ -430,8 +507,30 @@ class ScratchMemory {
 };
 } // anonymous namespace
 
+Status CFileReader::PrefetchBlock(const BlockPointer& ptr, CacheControl cache_control,
+                                  BlockHandle* ret, bool* cached) const {
+  DCHECK(init_once_.init_succeeded());
+  *cached = false;
+  BlockCacheHandle bc_handle;
+  Cache::CacheBehavior cache_behavior = cache_control == CACHE_BLOCK ?
+      Cache::EXPECT_IN_CACHE : Cache::NO_EXPECT_IN_CACHE;
+  BlockCache::CacheKey key(block_->id(), block_offset_ + ptr.offset());
+  if (BlockCache::GetSingleton()->Lookup(key, cache_behavior, &bc_handle,
+                                         BlockCache::NORMAL_PRIORITY, cache_partition_)) {
+    TRACE_COUNTER_INCREMENT("cfile_cache_hit", 1);
+    TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
+    *ret = BlockHandle::WithDataFromCache(&bc_handle);
+    *cached = true;
+    return Status::OK();
+  }
+  TRACE_COUNTER_INCREMENT("cfile_prefetched_blocks", 1);
+  return block_->Prefetch(block_offset_ + ptr.offset(), ptr.size());
+}
+
 Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &ptr,
-                              CacheControl cache_control, BlockHandle *ret) const {
+                              CacheControl cache_control, BlockHandle *ret,
+                              BlockCache::Priority priority,
+                              IteratorStats* stats) const {
   DCHECK(init_once_.init_succeeded());
   CHECK(ptr.offset() > 0 &&
         ptr.offset() + ptr.size() < file_size_) <<
@@ -441,8 +540,8 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
   Cache::CacheBehavior cache_behavior = cache_control == CACHE_BLOCK ?
       Cache::EXPECT_IN_CACHE : Cache::NO_EXPECT_IN_CACHE;
   BlockCache* cache = BlockCache::GetSingleton();
-  BlockCache::CacheKey key(block_->id(), ptr.offset());
-  if (cache->Lookup(key, cache_behavior, &bc_handle)) {
+  BlockCache::CacheKey key(block_->id(), block_offset_ + ptr.offset());
+  if (cache->Lookup(key, cache_behavior, &bc_handle, priority, cache_partition_)) {
     TRACE_COUNTER_INCREMENT("cfile_cache_hit", 1);
     TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
@@ -450,58 +549,90 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
     return Status::OK();
   }
 
-  // Cache miss: need to read ourselves.
-  // We issue trace events only in the cache miss case since we expect the
-  // tracing overhead to be small compared to the IO (even if it's a memcpy
-  // from the Linux cache).
-  TRACE_EVENT1("io", "CFileReader::ReadBlock(cache miss)",
-               "cfile", ToString());
-  TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
-  TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
-
-  uint32_t data_size = ptr.size();
-  if (has_checksums()) {
-    if (PREDICT_FALSE(kChecksumSize > data_size)) {
-      return Status::Corruption("invalid data size for block pointer",
-                                ptr.ToString());
-    }
-    data_size -= kChecksumSize;
-  }
-
+  // A compressed block which is going to be cached may still be in the
+  // compressed tier of the cache, sparing us the IO.
+  const bool use_compressed_tier = codec_ != nullptr && cache_control == CACHE_BLOCK &&
+      cache->has_compressed_tier();
+  BlockCacheHandle compressed_handle;
   ScratchMemory scratch;
-  // If we are reading uncompressed data and plan to cache the result,
-  // then we should allocate our scratch memory directly from the cache.
-  // This avoids an extra memory copy in the case of an NVM cache.
-  if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
-    scratch.TryAllocateFromCache(cache, key, data_size);
+  Slice block;
+  if (use_compressed_tier && cache->LookupCompressed(key, &compressed_handle)) {
+    TRACE_COUNTER_INCREMENT("cfile_compressed_cache_hit", 1);
+    block = compressed_handle.data();
   } else {
-    scratch.AllocateFromHeap(data_size);
-  }
-  uint8_t* buf = scratch.get();
-  Slice block(buf, data_size);
-  uint8_t checksum_scratch[kChecksumSize];
-  Slice checksum(checksum_scratch, kChecksumSize);
+    // Cache miss: need to read ourselves.
+    // We issue trace events only in the cache miss case since we expect the
+    // tracing overhead to be small compared to the IO (even if it's a memcpy
+    // from the Linux cache).
+    TRACE_EVENT1("io", "CFileReader::ReadBlock(cache miss)",
+                 "cfile", ToString());
+    TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
+    TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
+
+    uint32_t data_size = ptr.size();
+    if (has_checksums()) {
+      if (PREDICT_FALSE(kChecksumSize > data_size)) {
+        return Status::Corruption("invalid data size for block pointer",
+                                  ptr.ToString());
+      }
+      data_size -= kChecksumSize;
+    }
+
+    // If we are reading uncompressed data and plan to cache the result,
+    // then we should allocate our scratch memory directly from the cache.
+    // This avoids an extra memory copy in the case of an NVM cache. The same
+    // goes for compressed data which is going to be cached in the compressed
+    // tier.
+    if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
+      scratch.TryAllocateFromCache(cache, key, data_size, priority, ptr.size(),
+                                   cache_partition_);
+    } else if (use_compressed_tier) {
+      scratch.TryAllocateCompressedFromCache(cache, key, data_size, ptr.size());
+    } else {
+      scratch.AllocateFromHeap(data_size);
+    }
+    block = Slice(scratch.get(), data_size);
+    uint8_t checksum_scratch[kChecksumSize];
+    Slice checksum(checksum_scratch, kChecksumSize);
+
+    // Read the data and checksum if needed.
+    Slice results_backing[] = { block, checksum };
+    bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
+    ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
+    const bool direct = cache_control == DONT_CACHE_BLOCK &&
+        FLAGS_cfile_direct_io_for_uncached_reads;
+    const uint64_t offset = block_offset_ + ptr.offset();
+    const MonoTime read_start = stats ? MonoTime::Now() : MonoTime();
+    RETURN_NOT_OK_PREPEND(direct ? block_->ReadVDirect(offset, results) :
+                                   block_->ReadV(offset, results),
+                          Substitute("failed to read CFile block $0 at $1",
+                                     block_id().ToString(), ptr.ToString()));
+    if (stats) {
+      stats->io_nanos += (MonoTime::Now() - read_start).ToNanoseconds();
+    }
 
-  // Read the data and checksum if needed.
-  Slice results_backing[] = { block, checksum };
-  bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
-  ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
-  RETURN_NOT_OK_PREPEND(block_->ReadV(ptr.offset(), results),
-                        Substitute("failed to read CFile block $0 at $1",
-                                   block_id().ToString(), ptr.ToString()));
+    if (has_checksums() && FLAGS_cfile_verify_checksums) {
+      Status s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
+      if (!s.ok()) {
+        RETURN_NOT_OK_HANDLE_CORRUPTION(
+            s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
+                                         block_id().ToString(), ptr.ToString())),
+            HandleCorruption(io_context));
+      }
+    }
 
-  if (has_checksums() && FLAGS_cfile_verify_checksums) {
-    Status s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
-    if (!s.ok()) {
-      RETURN_NOT_OK_HANDLE_CORRUPTION(
-          s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
-                                       block_id().ToString(), ptr.ToString())),
-          HandleCorruption(io_context));
+    // Keep the compressed block in the compressed tier for when the
+    // decompressed block is evicted.
+    if (use_compressed_tier && scratch.IsFromCache()) {
+      cache->Insert(scratch.mutable_pending_entry(), &compressed_handle);
+      ignore_result(scratch.release());
+      block = compressed_handle.data();
     }
   }
 
   // Decompress the block
   if (codec_ != nullptr) {
+    const MonoTime decompress_start = stats ? MonoTime::Now() : MonoTime();
     // Init the decompressor and get the size required for the uncompressed buffer.
     CompressedBlockDecoder uncompressor(codec_, cfile_version_, block);
     Status s = uncompressor.Init();
@@ -517,7 +648,8 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
     // decompress directly into the cache's memory (to avoid a memcpy for NVM).
     ScratchMemory decompressed_scratch;
     if (cache_control == CACHE_BLOCK) {
-      decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size);
+      decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size, priority,
+                                                ptr.size(), cache_partition_);
     } else {
       decompressed_scratch.AllocateFromHeap(uncompressed_size);
     }
@@ -535,7 +667,11 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
     scratch.Swap(&decompressed_scratch);
 
     // Set the result block to our decompressed data.
-    block = Slice(buf, uncompressed_size);
+    block = Slice(scratch.get(), uncompressed_size);
+    if (stats) {
+      stats->decompress_nanos += (MonoTime::Now() - decompress_start).ToNanoseconds();
+      stats->bytes_decompressed += uncompressed_size;
+    }
   } else {
     // Some of the File implementations from LevelDB attempt to be tricky
     // and just return a Slice into an mmapped region (or in-memory region).
@@ -556,7 +692,7 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
     // if the entry could not be allocated from the block cache.
     // Since we allocate memory to include the key for the cache entry
     // we must reset the block.
-    DCHECK_EQ(block.data(), buf);
+    DCHECK_EQ(block.data(), scratch.get());
     DCHECK(!scratch.IsFromCache());
     *ret = BlockHandle::WithOwnedData(scratch.as_slice());
   }
@@ -602,10 +738,40 @@ Status CFileReader::NewIterator(CFileIterator** iter, CacheControl cache_control
   return Status::OK();
 }
 
+Status CFileReader::GetZoneMap(const IOContext* io_context, const ZoneMapPB** zone_map) {
+  DCHECK(has_zone_map());
+  RETURN_NOT_OK_PREPEND(
+      zone_map_once_.Init([this, io_context] { return ReadZoneMapOnce(io_context); }),
+      Substitute("failed to read zone map of CFile block $0", block_id().ToString()));
+  *zone_map = zone_map_.get();
+  return Status::OK();
+}
+
+Status CFileReader::ReadZoneMapOnce(const IOContext* io_context) {
+  BlockPointer ptr(footer().zone_map_block_ptr());
+  BlockHandle handle;
+  RETURN_NOT_OK(ReadBlock(io_context, ptr, DONT_CACHE_BLOCK, &handle));
+
+  gscoped_ptr<ZoneMapPB> zone_map(new ZoneMapPB());
+  Slice data = handle.data();
+  if (!zone_map->ParseFromArray(data.data(), data.size())) {
+    RETURN_NOT_OK_HANDLE_CORRUPTION(
+        Status::Corruption(Substitute("invalid zone map in CFile block $0 at $1",
+                                      block_id().ToString(), ptr.ToString())),
+        HandleCorruption(io_context));
+  }
+  zone_map_.swap(zone_map);
+
+  // The zone map has been allocated; memory consumption has changed.
+  mem_consumption_.Reset(memory_footprint());
+  return Status::OK();
+}
+
 size_t CFileReader::memory_footprint() const {
   size_t size = kudu_malloc_usable_size(this);
   size += block_->memory_footprint();
   size += init_once_.memory_footprint_excluding_this();
+  size += zone_map_once_.memory_footprint_excluding_this();
 
   // SpaceUsed() uses sizeof() instead of malloc_usable_size() to account for
   // the size of base objects (recursively too), thus not accounting for
@@ -616,6 +782,9 @@ size_t CFileReader::memory_footprint() const {
   if (footer_) {
     size += footer_->SpaceUsed();
   }
+  if (zone_map_) {
+    size += zone_map_->SpaceUsed();
+  }
   return size;
 }
 
@@ -649,19 +818,29 @@ Status DefaultColumnValueIterator::Scan(ColumnMaterializationContext* ctx) {
       sel_view.ClearBits(dst->nrows());
       return Status::OK();
     }
+    const size_t nrows = dst->nrows();
+    if (nrows == 0) {
+      return Status::OK();
+    }
     if (typeinfo_->physical_type() == BINARY) {
       const Slice *src_slice = reinterpret_cast<const Slice *>(value_);
       Slice dst_slice;
       if (PREDICT_FALSE(!dst->arena()->RelocateSlice(*src_slice, &dst_slice))) {
         return Status::IOError("out of memory copying slice", src_slice->ToString());
       }
-      for (size_t i = 0; i < dst->nrows(); ++i) {
-        dst->SetCellValue(i, &dst_slice);
-      }
+      dst->SetCellValue(0, &dst_slice);
     } else {
-      for (size_t i = 0; i < dst->nrows(); ++i) {
-        dst->SetCellValue(i, value_);
-      }
+      dst->SetCellValue(0, value_);
+    }
+    // Fill the rest of the block by doubling the filled prefix, rather than
+    // copying the value cell by cell.
+    const size_t stride = dst->stride();
+    uint8_t* data = dst->data();
+    size_t filled = 1;
+    while (filled < nrows) {
+      size_t n = std::min(filled, nrows - filled);
+      memcpy(data + filled * stride, data, n * stride);
+      filled += n;
     }
   } else {
     if (ctx->DecoderEvalNotDisabled() && !ctx->EvaluatingIsNull()) {
@@ -680,6 +859,100 @@ Status DefaultColumnValueIterator::FinishBatch() {
 ////////////////////////////////////////////////////////////
 // Iterator
 ////////////////////////////////////////////////////////////
+namespace {
+
+// Returns the thread pool, shared by all CFile iterators, on which data
+// blocks are read ahead.
+ThreadPool* ReadAheadPool() {
+  static ThreadPool* pool = [] {
+    gscoped_ptr<ThreadPool> pool;
+    CHECK_OK(ThreadPoolBuilder("cfile-read-ahead")
+             .set_max_threads(FLAGS_cfile_read_ahead_threads)
+             .Build(&pool));
+    return pool.release();
+  }();
+  return pool;
+}
+
+// Runs of at least this many rows which aren't selected are skipped over by
+// CopyNextSelectedValues() rather than decoded. Shorter runs are cheaper to
+// decode along with the selected rows around them.
+const size_t kMinSkippedRun = 16;
+
+// Like BlockDecoder::CopyNextValues(), but seeks 'dblk' forward over the runs
+// of rows which aren't selected in 'sel' instead of decoding them. The cells
+// of the skipped rows in 'dst' are left unset.
+Status CopyNextSelectedValues(BlockDecoder* dblk, size_t* n,
+                              SelectionVectorView sel, ColumnDataView dst) {
+  const size_t count = std::min(*n, dblk->Count() - dblk->GetCurrentIndex());
+  size_t done = 0;
+  while (done < count) {
+    // Skip the run of deselected rows at the current position if it's long
+    // enough.
+    size_t run_end = done;
+    while (run_end < count && !sel.TestBit(run_end)) {
+      run_end++;
+    }
+    if (run_end - done >= kMinSkippedRun) {
+      int nskip = run_end - done;
+      dblk->SeekForward(&nskip);
+      DCHECK_EQ(run_end - done, nskip);
+#ifndef NDEBUG
+      kudu::OverwriteWithPattern(reinterpret_cast<char *>(dst.data()),
+                                 dst.stride() * nskip,
+                                 "SKIPPEDSKIPPEDSKIPPED");
+#endif
+      dst.Advance(nskip);
+      done = run_end;
+      continue;
+    }
+
+    // Otherwise, decode up to the next long enough run of deselected rows.
+    while (run_end < count) {
+      if (sel.TestBit(run_end)) {
+        run_end++;
+        continue;
+      }
+      size_t gap_end = run_end;
+      while (gap_end < count && !sel.TestBit(gap_end)) {
+        gap_end++;
+      }
+      if (gap_end - run_end >= kMinSkippedRun) {
+        break;
+      }
+      run_end = gap_end;
+    }
+    size_t ncopy = run_end - done;
+    RETURN_NOT_OK(dblk->CopyNextValues(&ncopy, &dst));
+    DCHECK_EQ(run_end - done, ncopy);
+    dst.Advance(ncopy);
+    done = run_end;
+  }
+  *n = done;
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+struct CFileIterator::ReadAheadBlock {
+  explicit ReadAheadBlock(const BlockPointer& ptr)
+      : ptr(ptr),
+        done(1) {
+  }
+
+  const BlockPointer ptr;
+
+  // Counted down once the read has completed. 'status' and 'data' must not
+  // be accessed before then.
+  CountDownLatch done;
+  Status status;
+  BlockHandle data;
+
+  // Whether the block was only prefetched into the page cache, in which case
+  // 'data' is unset and the block must still be read.
+  bool prefetched = false;
+};
+
 CFileIterator::CFileIterator(CFileReader* reader,
                              CFileReader::CacheControl cache_control,
                              const IOContext* io_context)
@@ -689,10 +962,15 @@ CFileIterator::CFileIterator(CFileReader* reader,
     cache_control_(cache_control),
     last_prepare_idx_(-1),
     last_prepare_count_(-1),
-    io_context_(io_context) {
+    io_context_(io_context),
+    read_ahead_positioned_(false),
+    read_ahead_pending_(false) {
 }
 
 CFileIterator::~CFileIterator() {
+  // Background reads refer to this iterator's reader and IO context, so they
+  // must complete first.
+  ResetReadAhead();
 }
 
 Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
@@ -750,6 +1028,7 @@ Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
   last_prepare_idx_ = ord_idx;
   last_prepare_count_ = 0;
   seeked_ = posidx_iter_.get();
+  IssueReadAhead();
 
   CHECK_EQ(ord_idx, GetCurrentOrdinal());
   return Status::OK();
@@ -804,6 +1083,7 @@ Status CFileIterator::SeekToFirst() {
   prepared_blocks_.push_back(b.release());
 
   seeked_ = idx_iter;
+  IssueReadAhead();
   return Status::OK();
 }
 
@@ -892,11 +1172,13 @@ Status CFileIterator::PrepareForNewSeek() {
     BlockPointer bp(reader_->footer().dict_block_ptr());
 
     // Cache the dictionary for performance
+    dict_block_handle_ = std::make_shared<BlockHandle>();
     RETURN_NOT_OK_PREPEND(
-        reader_->ReadBlock(io_context_, bp, CFileReader::CACHE_BLOCK, &dict_block_handle_),
+        reader_->ReadBlock(io_context_, bp, CFileReader::CACHE_BLOCK, dict_block_handle_.get(),
+                           BlockCache::HIGH_PRIORITY),
         "couldn't read dictionary block");
 
-    dict_decoder_.reset(new BinaryPlainBlockDecoder(dict_block_handle_.data()));
+    dict_decoder_.reset(new BinaryPlainBlockDecoder(dict_block_handle_->data()));
     RETURN_NOT_OK_PREPEND(dict_decoder_->ParseHeader(),
                           Substitute("couldn't parse dictionary block header in block $0 ($1)",
                                      reader_->block_id().ToString(),
@@ -908,6 +1190,7 @@ Status CFileIterator::PrepareForNewSeek() {
     prepared_block_pool_.Destroy(pb);
   }
   prepared_blocks_.clear();
+  ResetReadAhead();
 
   return Status::OK();
 }
@@ -943,11 +1226,18 @@ Status DecodeNullInfo(Slice *data_block, uint32_t *num_rows_in_block, Slice *nul
 Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                                            PreparedBlock *prep_block) {
   prep_block->dblk_ptr_ = idx_iter.GetCurrentBlockPointer();
-  RETURN_NOT_OK(reader_->ReadBlock(io_context_, prep_block->dblk_ptr_,
-                                   cache_control_, &prep_block->dblk_data_));
+  prep_block->dblk_data_ = std::make_shared<BlockHandle>();
+  bool read_ahead;
+  RETURN_NOT_OK(TakeReadAheadBlock(prep_block->dblk_ptr_, prep_block->dblk_data_.get(),
+                                   &read_ahead));
+  if (!read_ahead) {
+    RETURN_NOT_OK(reader_->ReadBlock(io_context_, prep_block->dblk_ptr_,
+                                     cache_control_, prep_block->dblk_data_.get(),
+                                     BlockCache::NORMAL_PRIORITY, &io_stats_));
+  }
 
   uint32_t num_rows_in_block = 0;
-  Slice data_block = prep_block->dblk_data_.data();
+  Slice data_block = prep_block->dblk_data_->data();
   if (reader_->is_nullable()) {
     RETURN_NOT_OK(DecodeNullInfo(&data_block, &num_rows_in_block, &(prep_block->rle_bitmap)));
     prep_block->rle_decoder_ = RleDecoder<bool>(prep_block->rle_bitmap.data(),
@@ -961,6 +1251,7 @@ Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                         Substitute("unable to decode data block header in block $0 ($1)",
                                    reader_->block_id().ToString(),
                                    prep_block->dblk_ptr_.ToString()));
+  prep_block->zero_copy_ = FLAGS_cfile_zero_copy_strings && prep_block->dblk_->EnableZeroCopy();
 
   // For nullable blocks, we filled in the row count from the null information above,
   // since the data block decoder only knows about the non-null values.
@@ -990,6 +1281,190 @@ Status CFileIterator::QueueCurrentDataBlock(const IndexTreeIterator &idx_iter) {
   return Status::OK();
 }
 
+void CFileIterator::IssueReadAhead() {
+  if (FLAGS_cfile_read_ahead_blocks <= 0 ||
+      io_context_ == nullptr ||
+      io_context_->read_ahead_budget == nullptr ||
+      seeked_ == nullptr ||
+      seeked_ != posidx_iter_.get() ||
+      prepared_blocks_.empty()) {
+    return;
+  }
+  ReadAheadBudget* budget = io_context_->read_ahead_budget;
+
+  if (!read_ahead_positioned_) {
+    if (!read_ahead_iter_) {
+      read_ahead_iter_.reset(IndexTreeIterator::Create(io_context_, reader_,
+                                                       reader_->posidx_root()));
+    }
+    faststring key;
+    KeyEncoderTraits<UINT32, faststring>::Encode(prepared_blocks_.back()->first_row_idx(),
+                                                 &key);
+    Status s = read_ahead_iter_->SeekAtOrBefore(Slice(key));
+    if (PREDICT_FALSE(!s.ok())) {
+      VLOG(1) << "Unable to seek read-ahead index iterator: " << s.ToString();
+      return;
+    }
+    read_ahead_positioned_ = true;
+    read_ahead_pending_ = false;
+  }
+
+  while (read_ahead_blocks_.size() < static_cast<size_t>(FLAGS_cfile_read_ahead_blocks)) {
+    if (!read_ahead_pending_) {
+      if (!read_ahead_iter_->HasNext()) {
+        return;
+      }
+      Status s = read_ahead_iter_->Next();
+      if (PREDICT_FALSE(!s.ok())) {
+        VLOG(1) << "Unable to advance read-ahead index iterator: " << s.ToString();
+        read_ahead_positioned_ = false;
+        return;
+      }
+      read_ahead_pending_ = true;
+    }
+
+    BlockPointer ptr = read_ahead_iter_->GetCurrentBlockPointer();
+    if (!budget->TryReserve(ptr.size())) {
+      // Try again once the scan has consumed some of the blocks it read ahead.
+      return;
+    }
+    auto block = std::make_shared<ReadAheadBlock>(ptr);
+    if (FLAGS_cfile_read_ahead_prefetch) {
+      // The block isn't held in memory by the scan, but still counts against
+      // the budget so that it bounds how far ahead of the scan we read.
+      bool cached;
+      block->status = reader_->PrefetchBlock(ptr, cache_control_, &block->data, &cached);
+      block->prefetched = !cached;
+      block->done.CountDown();
+    } else {
+      CFileReader* reader = reader_;
+      const IOContext* io_context = io_context_;
+      CFileReader::CacheControl cache_control = cache_control_;
+      scoped_refptr<Trace> trace(Trace::CurrentTrace());
+      Status s = ReadAheadPool()->SubmitFunc([reader, io_context, cache_control, block, trace]() {
+        ADOPT_TRACE(trace.get());
+        block->status = reader->ReadBlock(io_context, block->ptr, cache_control, &block->data);
+        block->done.CountDown();
+      });
+      if (PREDICT_FALSE(!s.ok())) {
+        VLOG(1) << "Unable to submit read-ahead: " << s.ToString();
+        budget->Release(ptr.size());
+        return;
+      }
+    }
+    read_ahead_pending_ = false;
+    read_ahead_blocks_.emplace_back(std::move(block));
+    TRACE_COUNTER_INCREMENT("cfile_read_ahead_blocks", 1);
+  }
+}
+
+Status CFileIterator::TakeReadAheadBlock(const BlockPointer& ptr,
+                                         BlockHandle* handle,
+                                         bool* found) {
+  *found = false;
+  if (read_ahead_blocks_.empty()) {
+    return Status::OK();
+  }
+  if (read_ahead_blocks_.front()->ptr.offset() != ptr.offset()) {
+    ResetReadAhead();
+    return Status::OK();
+  }
+  shared_ptr<ReadAheadBlock> block = std::move(read_ahead_blocks_.front());
+  read_ahead_blocks_.pop_front();
+  const MonoTime wait_start = MonoTime::Now();
+  block->done.Wait();
+  io_stats_.io_nanos += (MonoTime::Now() - wait_start).ToNanoseconds();
+  io_context_->read_ahead_budget->Release(block->ptr.size());
+  if (PREDICT_FALSE(!block->status.ok())) {
+    // The caller reads the block again, which surfaces the error if it
+    // wasn't transient.
+    VLOG(1) << "Read-ahead of block " << ptr.ToString() << " failed: "
+            << block->status.ToString();
+    return Status::OK();
+  }
+  if (block->prefetched) {
+    return Status::OK();
+  }
+  *handle = std::move(block->data);
+  *found = true;
+  return Status::OK();
+}
+
+void CFileIterator::ResetReadAhead() {
+  for (const auto& block : read_ahead_blocks_) {
+    block->done.Wait();
+    io_context_->read_ahead_budget->Release(block->ptr.size());
+  }
+  read_ahead_blocks_.clear();
+  read_ahead_positioned_ = false;
+  read_ahead_pending_ = false;
+}
+
+Status CFileIterator::RowsMayMatch(rowid_t ord_idx, size_t n,
+                                   const ColumnPredicate& pred,
+                                   bool* may_match) {
+  *may_match = true;
+  RETURN_NOT_OK(reader_->Init(io_context_));
+  if (!reader_->has_zone_map() || n == 0) {
+    return Status::OK();
+  }
+  const ZoneMapPB* zone_map;
+  RETURN_NOT_OK(reader_->GetZoneMap(io_context_, &zone_map));
+
+  // Find the last data block starting at or before 'ord_idx', then check
+  // each block overlapping the requested range. Any row not covered by the
+  // zone map is assumed to match.
+  const auto& entries = zone_map->entries();
+  auto it = std::upper_bound(entries.begin(), entries.end(), ord_idx,
+                             [](rowid_t ord, const ZoneMapEntryPB& entry) {
+                               return ord < entry.first_ordinal();
+                             });
+  if (it == entries.begin()) {
+    return Status::OK();
+  }
+  --it;
+  const rowid_t end_idx = ord_idx + n;
+  rowid_t next_idx = ord_idx;
+  for (; it != entries.end() && next_idx < end_idx; ++it) {
+    if (it->first_ordinal() > next_idx) {
+      return Status::OK();
+    }
+    if (ZoneMayMatch(reader_->type_info(), *it, pred)) {
+      if (!it->has_bloom_block_ptr() || !PredicateUsesBloomFilter(pred)) {
+        return Status::OK();
+      }
+      bool bloom_may_match;
+      RETURN_NOT_OK(BloomFilterMayMatch(*it, pred, &bloom_may_match));
+      if (bloom_may_match) {
+        return Status::OK();
+      }
+    }
+    next_idx = std::max<rowid_t>(next_idx, it->first_ordinal() + it->num_rows());
+  }
+  *may_match = next_idx < end_idx;
+  return Status::OK();
+}
+
+Status CFileIterator::BloomFilterMayMatch(const ZoneMapEntryPB& entry,
+                                          const ColumnPredicate& pred,
+                                          bool* may_match) {
+  BlockPointer ptr(entry.bloom_block_ptr());
+  BlockHandle bloom_block;
+  RETURN_NOT_OK(reader_->ReadBlock(io_context_, ptr, cache_control_, &bloom_block,
+                                   BlockCache::HIGH_PRIORITY));
+  io_stats_.blocks_read++;
+  io_stats_.bytes_read += bloom_block.data().size();
+
+  BloomFilter bloom;
+  RETURN_NOT_OK_HANDLE_CORRUPTION(
+      ParseBloomFilterBlock(bloom_block.data(), &bloom).CloneAndPrepend(
+          Substitute("bad bloom filter block $0 in CFile block $1",
+                     ptr.ToString(), reader_->block_id().ToString())),
+      reader_->HandleCorruption(io_context_));
+  *may_match = BloomMayMatch(reader_->type_info(), bloom, pred);
+  return Status::OK();
+}
+
 bool CFileIterator::HasNext() const {
   CHECK(seeked_) << "not seeked";
   CHECK(!prepared_) << "Cannot call HasNext() mid-batch";
@@ -1018,6 +1493,7 @@ Status CFileIterator::PrepareBatch(size_t *n) {
     }
     RETURN_NOT_OK(QueueCurrentDataBlock(*seeked_));
   }
+  IssueReadAhead();
 
   // Seek the first block in the queue such that the first value to be read
   // corresponds to start_idx
@@ -1092,6 +1568,10 @@ Status CFileIterator::FinishBatch() {
 
 Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   CHECK(seeked_) << "not seeked";
+  const MonoTime decode_start = MonoTime::Now();
+  SCOPED_CLEANUP({
+    io_stats_.decode_nanos += (MonoTime::Now() - decode_start).ToNanoseconds();
+  });
 
   // Use views to advance the block and selection vector as we read into them.
   ColumnDataView remaining_dst(ctx->block());
@@ -1114,7 +1594,24 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
       }
     }
   }
+
+  // Unless the column is being evaluated against a predicate as it's decoded,
+  // the rows which are already deselected (e.g. deleted rows, or rows which
+  // didn't pass a predicate on another column) don't need to be decoded.
+  const bool skip_deselected = !ctx->DecoderEvalNotDisabled() && ctx->sel() != nullptr &&
+      ctx->sel()->CountSelected() < ctx->sel()->nrows();
+
   for (PreparedBlock *pb : prepared_blocks_) {
+    if (pb->zero_copy_) {
+      // The cells will reference the block's data, and for a
+      // dictionary-encoded block the dictionary's, so keep them alive for as
+      // long as the cells.
+      Arena* arena = DCHECK_NOTNULL(ctx->block()->arena());
+      arena->Retain(pb->dblk_data_);
+      if (dict_block_handle_) {
+        arena->Retain(dict_block_handle_);
+      }
+    }
     if (pb->needs_rewind_) {
       // Seek back to the saved position.
       SeekToPositionInBlock(pb, pb->rewind_idx_);
@@ -1144,6 +1641,9 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
                                                      ctx,
                                                      &remaining_sel,
                                                      &remaining_dst));
+          } else if (skip_deselected) {
+            RETURN_NOT_OK(CopyNextSelectedValues(pb->dblk_.get(), &this_batch,
+                                                 remaining_sel, remaining_dst));
           } else {
             RETURN_NOT_OK(pb->dblk_->CopyNextValues(&this_batch, &remaining_dst));
           }
@@ -1175,6 +1675,9 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
 
       if (ctx->DecoderEvalNotDisabled()) {
         RETURN_NOT_OK(pb->dblk_->CopyNextAndEval(&this_batch, ctx, &remaining_sel, &remaining_dst));
+      } else if (skip_deselected) {
+        RETURN_NOT_OK(CopyNextSelectedValues(pb->dblk_.get(), &this_batch,
+                                             remaining_sel, remaining_dst));
       } else {
         RETURN_NOT_OK(pb->dblk_->CopyNextValues(&this_batch, &remaining_dst));
       }
@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -27,6 +28,7 @@
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/block_pointer.h"
@@ -50,6 +52,7 @@
 namespace kudu {
 
 class ColumnMaterializationContext;
+class ColumnPredicate;
 class CompressionCodec;
 class EncodedKey;
 class SelectionVector;
@@ -115,8 +118,25 @@ class CFileReader {
   // Reads the data block pointed to by `ptr`. Will pull the data block from
   // the block cache if it exists, and reads from the filesystem block
   // otherwise.
+  //
+  // Index, dictionary and bloom filter blocks should be read with
+  // HIGH_PRIORITY so that they are cached apart from ordinary data blocks.
+  //
+  // If 'stats' is not null, the time spent reading and decompressing the
+  // block is added to its io_nanos and decompress_nanos, and the size of the
+  // decompressed block to its bytes_decompressed.
   Status ReadBlock(const fs::IOContext* io_context, const BlockPointer& ptr,
-                   CacheControl cache_control, BlockHandle* ret) const;
+                   CacheControl cache_control, BlockHandle* ret,
+                   BlockCache::Priority priority = BlockCache::NORMAL_PRIORITY,
+                   IteratorStats* stats = nullptr) const;
+
+  // Looks up the data block pointed to by 'ptr' in the block cache. On a hit,
+  // sets 'ret' to it and '*cached' to true. Otherwise, starts reading the
+  // block into the OS page cache in the background (see
+  // ReadableBlock::Prefetch()), so that a later ReadBlock() of it is likely
+  // not to wait for the disk.
+  Status PrefetchBlock(const BlockPointer& ptr, CacheControl cache_control,
+                       BlockHandle* ret, bool* cached) const;
 
   // Return the number of rows in this cfile.
   // This is assumed to be reasonably fast (i.e does not scan
@@ -189,6 +209,15 @@ class CFileReader {
   // Returns true if the file has checksums on the header, footer, and data blocks.
   bool has_checksums() const;
 
+  // Return true if there are per-data-block statistics in this file.
+  bool has_zone_map() const { return footer().has_zone_map_block_ptr(); }
+
+  // Reads and parses the zone map of this file the first time it is called,
+  // and sets '*zone_map' to it. The zone map remains owned by the reader.
+  //
+  // Must only be called if has_zone_map() is true.
+  Status GetZoneMap(const fs::IOContext* io_context, const ZoneMapPB** zone_map);
+
   // Can be called before Init().
   std::string ToString() const { return block_->id().ToString(); }
 
@@ -210,6 +239,9 @@ class CFileReader {
   Status ReadAndParseFooter();
   Status VerifyChecksum(ArrayView<const Slice> data, const Slice& checksum) const;
 
+  // Callback used in 'zone_map_once_' to read the zone map block.
+  Status ReadZoneMapOnce(const fs::IOContext* io_context);
+
   // Returns the memory usage of the object including the object itself.
   size_t memory_footprint() const;
 
@@ -217,8 +249,16 @@ class CFileReader {
   __attribute__((__unused__))
 #endif
   const std::unique_ptr<fs::ReadableBlock> block_;
+
+  // The offset of the cfile in 'block_', and its size. The cfile takes up
+  // the whole block unless it shares it (see ReaderOptions).
+  const uint64_t block_offset_;
   const uint64_t file_size_;
 
+  // The partition of the block cache reserved for the blocks of the cfile's
+  // table, or null if there is none.
+  Cache* const cache_partition_;
+
   uint8_t cfile_version_;
 
   gscoped_ptr<CFileHeaderPB> header_;
@@ -229,6 +269,9 @@ class CFileReader {
 
   KuduOnceLambda init_once_;
 
+  gscoped_ptr<ZoneMapPB> zone_map_;
+  KuduOnceLambda zone_map_once_;
+
   ScopedTrackedConsumption mem_consumption_;
 };
 
@@ -285,6 +328,19 @@ class ColumnIterator {
   // batch left off.
   virtual Status FinishBatch() = 0;
 
+  // Determine whether any of the 'n' rows starting at ordinal 'ord_idx' may
+  // satisfy 'pred', using whatever summary statistics are available without
+  // reading the data itself. Sets '*may_match' to false only if none of the
+  // rows can match.
+  //
+  // This does not change the position of the iterator.
+  virtual Status RowsMayMatch(rowid_t /*ord_idx*/, size_t /*n*/,
+                              const ColumnPredicate& /*pred*/,
+                              bool* may_match) {
+    *may_match = true;
+    return Status::OK();
+  }
+
   virtual const IteratorStats& io_statistics() const = 0;
 };
 
@@ -389,6 +445,12 @@ class CFileIterator : public ColumnIterator {
   // batch left off.
   Status FinishBatch() OVERRIDE;
 
+  // Uses the file's zone map, if it has one, to determine whether any of
+  // the 'n' rows starting at 'ord_idx' may satisfy 'pred'.
+  Status RowsMayMatch(rowid_t ord_idx, size_t n,
+                      const ColumnPredicate& pred,
+                      bool* may_match) override;
+
   // Return true if the next call to PrepareBatch will return at least one row.
   bool HasNext() const;
 
@@ -416,9 +478,15 @@ class CFileIterator : public ColumnIterator {
 
   struct PreparedBlock {
     BlockPointer dblk_ptr_;
-    BlockHandle dblk_data_;
+    // Shared with the arenas of the blocks scanned from it when the decoder
+    // outputs cells which reference the block's data (see zero_copy_).
+    std::shared_ptr<BlockHandle> dblk_data_;
     gscoped_ptr<BlockDecoder> dblk_;
 
+    // Whether the decoder outputs cells which reference the block's data,
+    // rather than copies of it (see --cfile_zero_copy_strings).
+    bool zero_copy_;
+
     // The rowid of the first row in this block.
     rowid_t first_row_idx() const {
       return dblk_->GetFirstRowId();
@@ -464,10 +532,36 @@ class CFileIterator : public ColumnIterator {
   Status ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                               PreparedBlock *prep_block);
 
+  // Checks the bloom filter referenced by the zone map 'entry' to determine
+  // whether its data block may hold a value matching 'pred'.
+  Status BloomFilterMayMatch(const ZoneMapEntryPB& entry,
+                             const ColumnPredicate& pred,
+                             bool* may_match);
+
   // Read the data block currently pointed to by idx_iter_, and enqueue
   // it onto the end of the prepared_blocks_ deque.
   Status QueueCurrentDataBlock(const IndexTreeIterator &idx_iter);
 
+  // A data block whose read was issued in the background.
+  struct ReadAheadBlock;
+
+  // If the iterator is scanning sequentially through the positional index,
+  // issues background reads for the data blocks following the last prepared
+  // block, so that up to --cfile_read_ahead_blocks of them are in flight or
+  // ready, within the scan's read-ahead budget.
+  //
+  // Read-ahead is best-effort: errors are left to be discovered when the
+  // blocks are actually read.
+  void IssueReadAhead();
+
+  // If the oldest block read ahead is the one at 'ptr', waits for its read
+  // to complete, moves it into 'handle' and sets '*found' to true. Otherwise,
+  // discards any read-ahead, since the scan is no longer sequential.
+  Status TakeReadAheadBlock(const BlockPointer& ptr, BlockHandle* handle, bool* found);
+
+  // Waits for all outstanding background reads and discards their results.
+  void ResetReadAhead();
+
   // Fully initialize the underlying cfile reader if needed, and clear any
   // seek-related state.
   Status PrepareForNewSeek();
@@ -479,7 +573,7 @@ class CFileIterator : public ColumnIterator {
 
   // Decoder for the dictionary block.
   gscoped_ptr<BinaryPlainBlockDecoder> dict_decoder_;
-  BlockHandle dict_block_handle_;
+  std::shared_ptr<BlockHandle> dict_block_handle_;
 
   // Set containing the codewords that match the predicate in a dictionary.
   std::unique_ptr<SelectionVector> codewords_matching_pred_;
@@ -516,6 +610,17 @@ class CFileIterator : public ColumnIterator {
 
   // a temporary buffer for encoding
   faststring tmp_buf_;
+
+  // Positional index iterator used to find the blocks to read ahead. When
+  // read_ahead_positioned_ is true, it points at the last block that was
+  // prepared or read ahead, or at the next one to read ahead if
+  // read_ahead_pending_ is also true.
+  gscoped_ptr<IndexTreeIterator> read_ahead_iter_;
+  bool read_ahead_positioned_;
+  bool read_ahead_pending_;
+
+  // Blocks being read ahead, in the order they will be needed.
+  std::deque<std::shared_ptr<ReadAheadBlock>> read_ahead_blocks_;
 };
 
 } // namespace cfile
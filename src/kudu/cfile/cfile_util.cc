@@ -47,6 +47,11 @@ WriterOptions::WriterOptions()
     write_posidx(false),
     write_validx(false),
     optimize_index_keys(true),
+    prefix_compress_index_blocks(false),
+    write_zone_map(false),
+    write_bloom_filter(false),
+    bloom_filter_fp_rate(0.01),
+    incompatible_features(IncompatibleFeatures::NONE),
     validx_key_encoder(boost::none) {
 }
 
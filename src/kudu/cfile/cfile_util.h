@@ -18,9 +18,11 @@
 #define CFILE_UTIL_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <string>
 
 #include <boost/optional/optional.hpp>
 
@@ -49,7 +51,21 @@ enum IncompatibleFeatures {
   // Write a crc32 checksum at the end of each cfile block
   CHECKSUM = 1 << 0,
 
-  SUPPORTED = NONE | CHECKSUM
+  // The blocks of a bloom file may use the split-block bloom filter layout.
+  SPLIT_BLOCK_BLOOM = 1 << 1,
+
+  // The keys of the index blocks may be prefix-compressed.
+  PREFIX_COMPRESSED_INDEX = 1 << 2,
+
+  SUPPORTED = NONE | CHECKSUM | SPLIT_BLOCK_BLOOM | PREFIX_COMPRESSED_INDEX
+};
+
+// Used to set the CFileFooterPB bitset tracking compatible features
+enum CompatibleFeatures {
+  COMPATIBLE_NONE = 0,
+
+  // Write a zone map block with per-data-block min/max and null counts
+  ZONE_MAP = 1 << 0
 };
 
 typedef std::function<void(const void*, faststring*)> ValidxKeyEncoder;
@@ -79,6 +95,39 @@ struct WriterOptions {
   // instead of entire keys.
   bool optimize_index_keys;
 
+  // Whether to prefix-compress the keys of the index blocks, which fits more
+  // entries in each index block. Files written this way can't be read by
+  // versions of Kudu which don't support it.
+  //
+  // Default: false
+  bool prefix_compress_index_blocks;
+
+  // Whether the file needs a zone map (per-data-block min/max and null
+  // counts), which lets predicates skip data blocks at scan time.
+  //
+  // Default: false
+  bool write_zone_map;
+
+  // Whether to write a bloom filter over the values of each data block,
+  // referenced from the zone map, which lets equality and IN-list
+  // predicates skip data blocks at scan time. Implies a zone map.
+  //
+  // Default: false
+  bool write_bloom_filter;
+
+  // The target false positive rate of the per-data-block bloom filters.
+  //
+  // Default: 0.01
+  double bloom_filter_fp_rate;
+
+  // IncompatibleFeatures bits which describe the contents of the file's
+  // blocks and which the writer can't infer on its own, e.g. the layout of
+  // the blocks of a bloom file. They are set in the footer in addition to
+  // the features of the file format itself.
+  //
+  // Default: NONE
+  uint32_t incompatible_features;
+
   // Column storage attributes.
   //
   // Default: all default values as specified in the constructor in
@@ -89,6 +138,12 @@ struct WriterOptions {
   // encodes the entire value.
   boost::optional<ValidxKeyEncoder> validx_key_encoder;
 
+  // The ID of the table the cfile belongs to, which picks the default block
+  // size of the cfile (see --cfile_point_lookup_tables).
+  //
+  // Default: empty, for a cfile of a table which is mostly scanned.
+  std::string table_id;
+
   WriterOptions();
 };
 
@@ -104,6 +159,21 @@ struct ReaderOptions {
   //
   // Default: the root tracker.
   std::shared_ptr<MemTracker> parent_mem_tracker;
+
+  // The range of the block which holds the cfile, for a cfile which shares
+  // its block with others, e.g. the cfile of a column in a column group.
+  // The offsets within the cfile are relative to 'block_offset'. If
+  // 'block_length' is 0, the cfile takes up the whole block.
+  //
+  // Default: 0 and 0
+  uint64_t block_offset = 0;
+  uint64_t block_length = 0;
+
+  // The ID of the table the cfile belongs to, whose blocks may have a
+  // partition of the block cache of their own (see BlockCache).
+  //
+  // Default: empty, for a cfile cached with the blocks of all other tables.
+  std::string table_id;
 };
 
 // Dumps the contents of a cfile to 'out'; 'reader' and 'iterator'
@@ -17,6 +17,8 @@
 
 #include "kudu/cfile/cfile_writer.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <numeric>
 #include <ostream>
@@ -33,11 +35,13 @@
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/util/array_view.h" // IWYU pragma: keep
 #include "kudu/util/coding-inl.h"
 #include "kudu/util/coding.h"
@@ -52,6 +56,31 @@
 DEFINE_int32(cfile_default_block_size, 256*1024, "The default block size to use in cfiles");
 TAG_FLAG(cfile_default_block_size, advanced);
 
+DEFINE_string(cfile_point_lookup_tables, "",
+              "Comma-separated list of the IDs of the tables which are mostly "
+              "read by key lookups rather than scans. Their cfiles default to "
+              "blocks of --cfile_point_lookup_block_size bytes rather than "
+              "--cfile_default_block_size, so that a lookup reads less data "
+              "it doesn't need.");
+TAG_FLAG(cfile_point_lookup_tables, experimental);
+
+DEFINE_int32(cfile_point_lookup_block_size, 32*1024,
+             "The default block size to use in the cfiles of the tables listed "
+             "in --cfile_point_lookup_tables.");
+TAG_FLAG(cfile_point_lookup_block_size, experimental);
+
+DEFINE_bool(cfile_adaptive_block_size, false,
+            "Whether the block size of cfiles is the size the data blocks "
+            "should take up on disk, after encoding and compression, rather "
+            "than the size the encoders fill them up to. The writer then "
+            "scales the size it encodes the blocks to by the ratio it saw in "
+            "the blocks written so far, so that narrow and well compressed "
+            "columns don't get tiny blocks.");
+TAG_FLAG(cfile_adaptive_block_size, experimental);
+TAG_FLAG(cfile_adaptive_block_size, runtime);
+
+DECLARE_int64(max_cfile_block_size);
+
 DEFINE_string(cfile_default_compression_codec, "none",
               "Default cfile block compression codec.");
 TAG_FLAG(cfile_default_compression_codec, advanced);
@@ -60,6 +89,19 @@ DEFINE_bool(cfile_write_checksums, true,
             "Write CRC32 checksums for each block");
 TAG_FLAG(cfile_write_checksums, evolving);
 
+DEFINE_bool(cfile_write_zone_maps, true,
+            "Write per-block min/max and null count statistics (zone maps) "
+            "for cfiles which request them, allowing scans to skip blocks "
+            "which cannot match a predicate");
+TAG_FLAG(cfile_write_zone_maps, experimental);
+
+DEFINE_bool(cfile_prefix_compress_index_blocks, false,
+            "Prefix-compress the keys of the index blocks of new cfiles, which "
+            "makes their indexes smaller and shallower. Cfiles written this "
+            "way can't be read by versions of Kudu which don't support it, "
+            "so this shouldn't be enabled before all servers are upgraded");
+TAG_FLAG(cfile_prefix_compress_index_blocks, experimental);
+
 using google::protobuf::RepeatedPtrField;
 using kudu::fs::BlockCreationTransaction;
 using kudu::fs::BlockManager;
@@ -77,9 +119,27 @@ const char kMagicStringV1[] = "kuducfil";
 const char kMagicStringV2[] = "kuducfl2";
 const int kMagicLength = 8;
 const size_t kChecksumSize = sizeof(uint32_t);
+const char kSharedBlockMetaEntryName[] = "kudu.shared_block";
 
 static const size_t kMinBlockSize = 512;
 
+// With --cfile_adaptive_block_size, the most the block size that the
+// encoders fill the blocks to may be scaled up by.
+static const int kMaxAdaptiveBlockSizeScale = 8;
+
+static bool IsPointLookupTable(const string& table_id) {
+  if (table_id.empty() || FLAGS_cfile_point_lookup_tables.empty()) {
+    return false;
+  }
+  for (StringPiece id : strings::Split(FLAGS_cfile_point_lookup_tables, ",",
+                                       strings::SkipWhitespace())) {
+    if (id == table_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static CompressionType GetDefaultCompressionCodec() {
   return GetCompressionCodecType(FLAGS_cfile_default_compression_codec);
 }
@@ -96,6 +156,9 @@ CFileWriter::CFileWriter(WriterOptions options,
   : block_(std::move(block)),
     off_(0),
     value_count_(0),
+    target_block_size_(0),
+    built_block_bytes_(0),
+    written_block_bytes_(0),
     options_(std::move(options)),
     is_nullable_(is_nullable),
     typeinfo_(typeinfo),
@@ -118,7 +181,8 @@ CFileWriter::CFileWriter(WriterOptions options,
   }
 
   if (options_.storage_attributes.cfile_block_size <= 0) {
-    options_.storage_attributes.cfile_block_size = FLAGS_cfile_default_block_size;
+    options_.storage_attributes.cfile_block_size = IsPointLookupTable(options_.table_id) ?
+        FLAGS_cfile_point_lookup_block_size : FLAGS_cfile_default_block_size;
   }
   if (options_.storage_attributes.cfile_block_size < kMinBlockSize) {
     LOG(WARNING) << "Configured block size " << options_.storage_attributes.cfile_block_size
@@ -126,7 +190,13 @@ CFileWriter::CFileWriter(WriterOptions options,
                  << ": using minimum.";
     options_.storage_attributes.cfile_block_size = kMinBlockSize;
   }
+  if (FLAGS_cfile_adaptive_block_size) {
+    target_block_size_ = options_.storage_attributes.cfile_block_size;
+  }
 
+  if (FLAGS_cfile_prefix_compress_index_blocks) {
+    options_.prefix_compress_index_blocks = true;
+  }
   if (options_.write_posidx) {
     posidx_builder_.reset(new IndexTreeBuilder(&options_, this));
   }
@@ -141,6 +211,12 @@ CFileWriter::CFileWriter(WriterOptions options,
 
     validx_builder_.reset(new IndexTreeBuilder(&options_, this));
   }
+
+  if ((options_.write_zone_map && FLAGS_cfile_write_zone_maps) ||
+      options_.write_bloom_filter) {
+    double bloom_fp_rate = options_.write_bloom_filter ? options_.bloom_filter_fp_rate : 0;
+    zone_map_builder_.reset(new ZoneMapBuilder(typeinfo_, bloom_fp_rate));
+  }
 }
 
 CFileWriter::~CFileWriter() {
@@ -206,6 +282,13 @@ Status CFileWriter::Finish() {
 }
 
 Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction) {
+  unique_ptr<WritableBlock> block;
+  RETURN_NOT_OK(FinishAndReleaseBlock(&block));
+  transaction->AddCreatedBlock(std::move(block));
+  return Status::OK();
+}
+
+Status CFileWriter::FinishAndReleaseBlock(unique_ptr<WritableBlock>* block) {
   TRACE_EVENT0("cfile", "CFileWriter::FinishAndReleaseBlock");
   CHECK(state_ == kWriterWriting) <<
     "Bad state for Finish(): " << state_;
@@ -215,10 +298,15 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
 
   state_ = kWriterFinished;
 
-  uint32_t incompatible_features = 0;
+  uint32_t incompatible_features = options_.incompatible_features;
   if (FLAGS_cfile_write_checksums) {
     incompatible_features |= IncompatibleFeatures::CHECKSUM;
   }
+  if (options_.prefix_compress_index_blocks &&
+      (options_.write_posidx || options_.write_validx)) {
+    incompatible_features |= IncompatibleFeatures::PREFIX_COMPRESSED_INDEX;
+  }
+  uint32_t compatible_features = 0;
 
   // Start preparing the footer.
   CFileFooterPB footer;
@@ -243,6 +331,19 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
     footer.mutable_validx_info()->CopyFrom(validx_info);
   }
 
+  if (zone_map_builder_ != nullptr) {
+    faststring zone_map_str;
+    pb_util::SerializeToString(zone_map_builder_->zone_map(), &zone_map_str);
+    BlockPointer zone_map_ptr;
+    RETURN_NOT_OK_PREPEND(AddBlock({ Slice(zone_map_str) }, &zone_map_ptr, "zone map block"),
+                          "Couldn't write zone map");
+    zone_map_ptr.CopyToPB(footer.mutable_zone_map_block_ptr());
+    compatible_features |= CompatibleFeatures::ZONE_MAP;
+  }
+  if (compatible_features != 0) {
+    footer.set_compatible_features(compatible_features);
+  }
+
   // Optionally append extra information to the end of cfile.
   // Example: dictionary block for dictionary encoding
   RETURN_NOT_OK(data_block_->AppendExtraInfo(this, &footer));
@@ -270,7 +371,7 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
 
   // Done with this block.
   RETURN_NOT_OK(block_->Finalize());
-  transaction->AddCreatedBlock(std::move(block_));
+  *block = std::move(block_);
   return Status::OK();
 }
 
@@ -290,6 +391,15 @@ string CFileWriter::GetMetaValueOrDie(Slice key) const {
   LOG(FATAL) << "Missing metadata entry: " << KUDU_REDACT(key.ToDebugString());
 }
 
+bool CFileWriter::GetZoneMapSummary(ZoneMapEntryPB* summary) const {
+  CHECK_EQ(state_, kWriterFinished);
+  if (zone_map_builder_ == nullptr) {
+    return false;
+  }
+  zone_map_builder_->GetSummary(summary);
+  return true;
+}
+
 void CFileWriter::FlushMetadataToPB(RepeatedPtrField<FileMetadataPairPB> *field) {
   typedef pair<string, string> ss_pair;
   for (const ss_pair &entry : unflushed_metadata_) {
@@ -311,6 +421,9 @@ Status CFileWriter::AppendEntries(const void *entries, size_t count) {
     int n = data_block_->Add(ptr, rem);
     DCHECK_GE(n, 0);
 
+    if (zone_map_builder_ != nullptr) {
+      zone_map_builder_->AddCells(ptr, n);
+    }
     ptr += typeinfo_->size() * n;
     rem -= n;
     value_count_ += n;
@@ -342,6 +455,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
         DCHECK_GE(n, 0);
 
         null_bitmap_builder_->AddRun(true, n);
+        if (zone_map_builder_ != nullptr) {
+          zone_map_builder_->AddCells(ptr, n);
+        }
         ptr += n * typeinfo_->size();
         value_count_ += n;
         rem -= n;
@@ -353,6 +469,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
       } while (rem > 0);
     } else {
       null_bitmap_builder_->AddRun(false, nblock);
+      if (zone_map_builder_ != nullptr) {
+        zone_map_builder_->AddNulls(nblock);
+      }
       ptr += nblock * typeinfo_->size();
       value_count_ += nblock;
     }
@@ -399,15 +518,32 @@ Status CFileWriter::FinishCurDataBlock() {
     v.push_back(null_bitmap);
   }
   v.push_back(data);
+  const uint64_t block_start = off_;
   Status s = AppendRawBlock(v, first_elem_ord,
                             reinterpret_cast<const void *>(key_tmp_space),
                             Slice(last_key_),
                             "data block");
+  if (target_block_size_ > 0 && s.ok()) {
+    RetargetBlockSize(off_ - block_start);
+  }
 
   if (is_nullable_) {
     null_bitmap_builder_->Reset();
   }
 
+  if (zone_map_builder_ != nullptr && s.ok()) {
+    if (zone_map_builder_->has_bloom_filters()) {
+      faststring bloom_block;
+      zone_map_builder_->FinishBloomFilter(&bloom_block);
+      BlockPointer bloom_ptr;
+      RETURN_NOT_OK_PREPEND(AddBlock({ Slice(bloom_block) }, &bloom_ptr, "bloom block"),
+                            "Couldn't write bloom filter");
+      zone_map_builder_->FinishBlock(first_elem_ord, &bloom_ptr);
+    } else {
+      zone_map_builder_->FinishBlock(first_elem_ord);
+    }
+  }
+
   if (validx_builder_ != nullptr) {
     RETURN_NOT_OK(data_block_->GetLastKey(key_tmp_space));
     (*options_.validx_key_encoder)(key_tmp_space, &last_key_);
@@ -417,6 +553,24 @@ Status CFileWriter::FinishCurDataBlock() {
   return s;
 }
 
+void CFileWriter::RetargetBlockSize(uint64_t written_bytes) {
+  built_block_bytes_ += options_.storage_attributes.cfile_block_size;
+  written_block_bytes_ += written_bytes;
+  if (written_block_bytes_ == 0) {
+    return;
+  }
+  // Never build blocks smaller than the target, e.g. for the blocks which
+  // don't compress, nor so large that they'd hit the limit on block sizes.
+  const int64_t max_size = std::min<int64_t>(
+      static_cast<int64_t>(target_block_size_) * kMaxAdaptiveBlockSizeScale,
+      FLAGS_max_cfile_block_size / 2);
+  int64_t size = static_cast<int64_t>(
+      static_cast<double>(target_block_size_) * built_block_bytes_ / written_block_bytes_);
+  size = std::max<int64_t>(target_block_size_, std::min(size, max_size));
+  VLOG(2) << "Building the next data block up to " << size << " bytes";
+  options_.storage_attributes.cfile_block_size = size;
+}
+
 Status CFileWriter::AppendRawBlock(const vector<Slice>& data_slices,
                                    size_t ordinal_pos,
                                    const void *validx_curr,
@@ -59,6 +59,8 @@ class CompressedBlockBuilder;
 class FileMetadataPairPB;
 class IndexTreeBuilder;
 class TypeEncodingInfo;
+class ZoneMapBuilder;
+class ZoneMapEntryPB;
 
 // Magic used in header/footer
 extern const char kMagicStringV1[];
@@ -66,6 +68,11 @@ extern const char kMagicStringV2[];
 extern const int kMagicLength;
 extern const size_t kChecksumSize;
 
+// The metadata entry of the cfiles which share their block with other
+// cfiles, e.g. the cfiles of a column group. Its value is the name of the
+// group. Such a block can't be read as a single cfile.
+extern const char kSharedBlockMetaEntryName[];
+
 class NullBitmapBuilder {
  public:
   explicit NullBitmapBuilder(size_t initial_row_capacity)
@@ -119,6 +126,10 @@ class CFileWriter {
   // it to 'transaction'.
   Status FinishAndReleaseBlock(fs::BlockCreationTransaction* transaction);
 
+  // Like above, but hands the finalized block back to the caller rather
+  // than releasing it to a transaction.
+  Status FinishAndReleaseBlock(std::unique_ptr<fs::WritableBlock>* block);
+
   bool finished() {
     return state_ == kWriterFinished;
   }
@@ -175,6 +186,13 @@ class CFileWriter {
     return value_count_;
   }
 
+  // Summarize the zone map of the file into 'summary', covering all of its
+  // cells. Returns false, leaving 'summary' untouched, if the file doesn't
+  // keep a zone map.
+  //
+  // REQUIRES: Finish() or FinishAndReleaseBlock() already called.
+  bool GetZoneMapSummary(ZoneMapEntryPB* summary) const;
+
   std::string ToString() const { return block_->id().ToString(); }
 
   fs::WritableBlock* block() const { return block_.get(); }
@@ -202,6 +220,11 @@ class CFileWriter {
 
   Status FinishCurDataBlock();
 
+  // Accounts for a data block built up to the current block size which took
+  // up 'written_bytes' on disk, and scales the size the next data blocks are
+  // built up to so that they take up about 'target_block_size_'.
+  void RetargetBlockSize(uint64_t written_bytes);
+
   // Flush the current unflushed_metadata_ entries into the given protobuf
   // field, clearing the buffer.
   void FlushMetadataToPB(google::protobuf::RepeatedPtrField<FileMetadataPairPB> *field);
@@ -215,6 +238,17 @@ class CFileWriter {
   // Current number of values that have been appended.
   rowid_t value_count_;
 
+  // If --cfile_adaptive_block_size was set, the size the data blocks should
+  // take up on disk, after encoding and compression, or 0 otherwise. The
+  // block size in the storage attributes of 'options_' is then re-targeted
+  // after each data block.
+  int32_t target_block_size_;
+
+  // The sum of the block sizes the data blocks written so far were built
+  // with, and of the sizes they took up on disk.
+  uint64_t built_block_bytes_;
+  uint64_t written_block_bytes_;
+
   WriterOptions options_;
 
   // Type of data being written
@@ -238,6 +272,7 @@ class CFileWriter {
   gscoped_ptr<IndexTreeBuilder> validx_builder_;
   gscoped_ptr<NullBitmapBuilder> null_bitmap_builder_;
   gscoped_ptr<CompressedBlockBuilder> block_compressor_;
+  gscoped_ptr<ZoneMapBuilder> zone_map_builder_;
 
   enum State {
     kWriterInitialized,
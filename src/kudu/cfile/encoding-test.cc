@@ -37,11 +37,15 @@
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/bshuf_block.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/for_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -753,6 +757,196 @@ TEST_F(TestEncoding, TestBShufDoubleBlockEncoder) {
                                     BShufBlockDecoder<DOUBLE> >(doubles.get(), kSize);
 }
 
+// Test that evaluating predicates in the bitshuffle decoder yields the same
+// results as evaluating them cell by cell.
+TEST_F(TestEncoding, TestBShufInt64CopyNextAndEval) {
+  const size_t kSize = 10000;
+  Random rng(SeedRandom());
+  vector<int64_t> to_insert(kSize);
+  for (int i = 0; i < kSize; i++) {
+    to_insert[i] = rng.Uniform(1000) - 500;
+  }
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  BShufBlockBuilder<INT64> bb(opts.get());
+  ASSERT_EQ(kSize, bb.Add(reinterpret_cast<const uint8_t*>(to_insert.data()), kSize));
+  Slice s = bb.Finish(0);
+
+  ColumnSchema col("c", INT64);
+  int64_t lower = -100;
+  int64_t upper = 250;
+  vector<int64_t> short_list = { -400, -3, 0, 17, 499 };
+  vector<int64_t> long_list;
+  for (int64_t v = -500; v < 500; v += 7) {
+    long_list.push_back(v);
+  }
+  vector<const void*> short_ptrs;
+  for (const auto& v : short_list) short_ptrs.push_back(&v);
+  vector<const void*> long_ptrs;
+  for (const auto& v : long_list) long_ptrs.push_back(&v);
+
+  vector<ColumnPredicate> preds = {
+    ColumnPredicate::Range(col, &lower, &upper),
+    ColumnPredicate::Range(col, &lower, nullptr),
+    ColumnPredicate::Range(col, nullptr, &upper),
+    ColumnPredicate::Equality(col, &lower),
+    ColumnPredicate::InList(col, &short_ptrs),
+    ColumnPredicate::InList(col, &long_ptrs),
+    ColumnPredicate::IsNotNull(col),
+  };
+  for (const auto& pred : preds) {
+    SCOPED_TRACE(pred.ToString());
+    BShufBlockDecoder<INT64> bd(s);
+    ASSERT_OK(bd.ParseHeader());
+
+    vector<int64_t> decoded(kSize);
+    ColumnBlock dst_block(GetTypeInfo(INT64), nullptr, decoded.data(), kSize, &arena_);
+    SelectionVector sel(kSize);
+    sel.SetAllTrue();
+    ColumnMaterializationContext ctx(0, &pred, &dst_block, &sel);
+    SelectionVectorView sel_view(&sel);
+    size_t dec_count = 0;
+    while (bd.HasNext()) {
+      size_t n = std::min<size_t>(kSize - dec_count, rng.Uniform(600) + 1);
+      ColumnDataView dst_data(&dst_block, dec_count);
+      ASSERT_OK(bd.CopyNextAndEval(&n, &ctx, &sel_view, &dst_data));
+      sel_view.Advance(n);
+      dec_count += n;
+    }
+    ASSERT_EQ(kSize, dec_count);
+    ASSERT_FALSE(ctx.DecoderEvalNotSupported());
+
+    for (size_t i = 0; i < kSize; i++) {
+      bool expected = pred.EvaluateCell<INT64>(&to_insert[i]);
+      ASSERT_EQ(expected, sel.IsRowSelected(i)) << "row " << i << ": " << to_insert[i];
+      if (expected) {
+        ASSERT_EQ(to_insert[i], decoded[i]);
+      }
+    }
+  }
+}
+
+// Test that frame-of-reference encoding packs almost-sorted timestamps into
+// a fraction of their width and that seeks outside of the block's range are
+// answered from the header.
+TEST_F(TestEncoding, TestFrameOfReferenceAlmostSortedTimestamps) {
+  const uint32_t kSize = 10000;
+  const int64_t kBase = 1546300800000000L;
+  Random rng(SeedRandom());
+  vector<int64_t> to_insert(kSize);
+  for (int i = 0; i < kSize; i++) {
+    // One event roughly every millisecond, arriving up to 10ms out of order.
+    to_insert[i] = kBase + i * 1000L + rng.Uniform(10000);
+  }
+  TestEncodeDecodeTemplateBlockEncoder<INT64, FrameOfReferenceBlockBuilder<INT64>,
+      FrameOfReferenceBlockDecoder<INT64>>(to_insert.data(), kSize);
+
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  FrameOfReferenceBlockBuilder<INT64> fbb(opts.get());
+  ASSERT_EQ(kSize, fbb.Add(reinterpret_cast<const uint8_t*>(to_insert.data()), kSize));
+  Slice s = fbb.Finish(0);
+  // The values in the block span less than 2^24, so each one takes 3 bytes
+  // rather than 8.
+  ASSERT_LT(s.size(), kSize * 3 + FrameOfReferenceBlockBuilder<INT64>::kHeaderSize +
+                      FrameOfReferenceBlockBuilder<INT64>::kPaddingBytes);
+
+  FrameOfReferenceBlockDecoder<INT64> fbd(s);
+  ASSERT_OK(fbd.ParseHeader());
+  bool exact;
+  int64_t before = kBase - 1;
+  ASSERT_OK(fbd.SeekAtOrAfterValue(&before, &exact));
+  ASSERT_FALSE(exact);
+  ASSERT_EQ(0, fbd.GetCurrentIndex());
+  int64_t after = kBase + kSize * 1000L + 10000;
+  ASSERT_TRUE(fbd.SeekAtOrAfterValue(&after, &exact).IsNotFound());
+  ASSERT_FALSE(fbd.HasNext());
+}
+
+// Test that the 128-bit predicate evaluation kernels, which compare the
+// halves of the values separately, agree with evaluating the predicates cell
+// by cell, including for values which differ only in their high or low half.
+TEST_F(TestEncoding, TestBShufInt128CopyNextAndEval) {
+  const size_t kSize = 10000;
+  const int128_t kHigh = static_cast<int128_t>(1) << 64;
+  Random rng(SeedRandom());
+  vector<int128_t> to_insert(kSize);
+  for (int i = 0; i < kSize; i++) {
+    to_insert[i] = (static_cast<int128_t>(rng.Uniform(5)) - 2) * kHigh +
+                   (static_cast<int128_t>(rng.Uniform(1000)) << 54);
+  }
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  BShufBlockBuilder<INT128> bb(opts.get());
+  ASSERT_EQ(kSize, bb.Add(reinterpret_cast<const uint8_t*>(to_insert.data()), kSize));
+  Slice s = bb.Finish(0);
+
+  ColumnSchema col("c", INT128);
+  int128_t lower = -kHigh + (static_cast<int128_t>(100) << 54);
+  int128_t upper = kHigh + (static_cast<int128_t>(900) << 54);
+  vector<int128_t> list = { -2 * kHigh, -1, 0, kHigh + (static_cast<int128_t>(7) << 54) };
+  vector<const void*> list_ptrs;
+  for (const auto& v : list) list_ptrs.push_back(&v);
+
+  vector<ColumnPredicate> preds = {
+    ColumnPredicate::Range(col, &lower, &upper),
+    ColumnPredicate::Range(col, &lower, nullptr),
+    ColumnPredicate::Range(col, nullptr, &upper),
+    ColumnPredicate::Equality(col, &lower),
+    ColumnPredicate::InList(col, &list_ptrs),
+  };
+  for (const auto& pred : preds) {
+    SCOPED_TRACE(pred.ToString());
+    BShufBlockDecoder<INT128> bd(s);
+    ASSERT_OK(bd.ParseHeader());
+
+    vector<int128_t> decoded(kSize);
+    ColumnBlock dst_block(GetTypeInfo(INT128), nullptr, decoded.data(), kSize, &arena_);
+    SelectionVector sel(kSize);
+    sel.SetAllTrue();
+    ColumnMaterializationContext ctx(0, &pred, &dst_block, &sel);
+    SelectionVectorView sel_view(&sel);
+    size_t dec_count = 0;
+    while (bd.HasNext()) {
+      size_t n = std::min<size_t>(kSize - dec_count, rng.Uniform(600) + 1);
+      ColumnDataView dst_data(&dst_block, dec_count);
+      ASSERT_OK(bd.CopyNextAndEval(&n, &ctx, &sel_view, &dst_data));
+      sel_view.Advance(n);
+      dec_count += n;
+    }
+    ASSERT_EQ(kSize, dec_count);
+
+    for (size_t i = 0; i < kSize; i++) {
+      bool expected = pred.EvaluateCell<INT128>(&to_insert[i]);
+      ASSERT_EQ(expected, sel.IsRowSelected(i)) << "row " << i;
+    }
+  }
+}
+
+// Test that frame-of-reference encoding packs DECIMAL128-like values which
+// are close to each other into 64 bits or less, and stores values whose
+// range doesn't fit in 64 bits as they are.
+TEST_F(TestEncoding, TestFrameOfReferenceInt128) {
+  const uint32_t kSize = 10000;
+  const int128_t kBase = static_cast<int128_t>(123456789) << 64;
+  Random rng(SeedRandom());
+  vector<int128_t> close(kSize);
+  vector<int128_t> spread(kSize);
+  for (int i = 0; i < kSize; i++) {
+    close[i] = kBase + rng.Uniform(1000000) - 500000;
+    spread[i] = (i % 2 == 0 ? -kBase : kBase) + rng.Uniform(1000);
+  }
+  TestEncodeDecodeTemplateBlockEncoder<INT128, FrameOfReferenceBlockBuilder<INT128>,
+      FrameOfReferenceBlockDecoder<INT128>>(close.data(), kSize);
+  TestEncodeDecodeTemplateBlockEncoder<INT128, FrameOfReferenceBlockBuilder<INT128>,
+      FrameOfReferenceBlockDecoder<INT128>>(spread.data(), kSize);
+
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  FrameOfReferenceBlockBuilder<INT128> fbb(opts.get());
+  ASSERT_EQ(kSize, fbb.Add(reinterpret_cast<const uint8_t*>(close.data()), kSize));
+  Slice s = fbb.Finish(0);
+  // The values span less than 2^20, so each one takes 20 bits rather than 128.
+  ASSERT_LT(s.size(), kSize * 20 / 8 + FrameOfReferenceBlockBuilder<INT128>::kHeaderSize +
+                      FrameOfReferenceBlockBuilder<INT128>::kPaddingBytes + 1);
+}
+
 TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   unique_ptr<WriterOptions> opts(NewWriterOptions());
   RleIntBlockBuilder<UINT32> ibb(opts.get());
@@ -775,6 +969,69 @@ TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   ASSERT_EQ(14UL, s.size());
 }
 
+// Test that evaluating predicates in the RLE decoder, which evaluates each
+// repeated run once, yields the same results as evaluating them cell by cell.
+TEST_F(TestEncoding, TestRleInt16CopyNextAndEval) {
+  const size_t kSize = 10000;
+  Random rng(SeedRandom());
+  vector<int16_t> to_insert;
+  while (to_insert.size() < kSize) {
+    // Mix short runs, which are bit-packed, with long repeated runs.
+    size_t run_length = rng.OneIn(3) ? rng.Uniform(100) + 8 : rng.Uniform(3) + 1;
+    run_length = std::min(run_length, kSize - to_insert.size());
+    to_insert.insert(to_insert.end(), run_length, static_cast<int16_t>(rng.Uniform(20)) - 10);
+  }
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  RleIntBlockBuilder<INT16> bb(opts.get());
+  ASSERT_EQ(kSize, bb.Add(reinterpret_cast<const uint8_t*>(to_insert.data()), kSize));
+  Slice s = bb.Finish(0);
+
+  ColumnSchema col("c", INT16);
+  int16_t lower = -3;
+  int16_t upper = 5;
+  vector<int16_t> list = { -8, 0, 7 };
+  vector<const void*> list_ptrs;
+  for (const auto& v : list) list_ptrs.push_back(&v);
+
+  vector<ColumnPredicate> preds = {
+    ColumnPredicate::Range(col, &lower, &upper),
+    ColumnPredicate::Range(col, nullptr, &upper),
+    ColumnPredicate::Equality(col, &lower),
+    ColumnPredicate::InList(col, &list_ptrs),
+    ColumnPredicate::IsNotNull(col),
+  };
+  for (const auto& pred : preds) {
+    SCOPED_TRACE(pred.ToString());
+    RleIntBlockDecoder<INT16> bd(s);
+    ASSERT_OK(bd.ParseHeader());
+
+    vector<int16_t> decoded(kSize);
+    ColumnBlock dst_block(GetTypeInfo(INT16), nullptr, decoded.data(), kSize, &arena_);
+    SelectionVector sel(kSize);
+    sel.SetAllTrue();
+    ColumnMaterializationContext ctx(0, &pred, &dst_block, &sel);
+    SelectionVectorView sel_view(&sel);
+    size_t dec_count = 0;
+    while (bd.HasNext()) {
+      size_t n = std::min<size_t>(kSize - dec_count, rng.Uniform(600) + 1);
+      ColumnDataView dst_data(&dst_block, dec_count);
+      ASSERT_OK(bd.CopyNextAndEval(&n, &ctx, &sel_view, &dst_data));
+      sel_view.Advance(n);
+      dec_count += n;
+    }
+    ASSERT_EQ(kSize, dec_count);
+    ASSERT_FALSE(ctx.DecoderEvalNotSupported());
+
+    for (size_t i = 0; i < kSize; i++) {
+      bool expected = pred.EvaluateCell<INT16>(&to_insert[i]);
+      ASSERT_EQ(expected, sel.IsRowSelected(i)) << "row " << i << ": " << to_insert[i];
+      if (expected) {
+        ASSERT_EQ(to_insert[i], decoded[i]);
+      }
+    }
+  }
+}
+
 TEST_F(TestEncoding, TestPlainBitMapRoundTrip) {
   TestBoolBlockRoundTrip<PlainBitMapBlockBuilder, PlainBitMapBlockDecoder>();
 }
@@ -790,6 +1047,53 @@ TEST_F(TestEncoding, TestBinaryPrefixBlockBuilderSeekByValueSmallBlock) {
   TestBinarySeekByValueSmallBlock<BinaryPrefixBlockBuilder, BinaryPrefixBlockDecoder>();
 }
 
+// Test seeking in a prefix-encoded block of keys which share long prefixes,
+// as composite keys do, both in random order and in sorted order.
+TEST_F(TestEncoding, TestBinaryPrefixBlockSeekWithLongSharedPrefixes) {
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  BinaryPrefixBlockBuilder sbb(opts.get());
+  const int kCount = 1000;
+  const string kPrefix(40, 'p');
+  const auto& key = [&](int i) {
+    return kPrefix + StringPrintf("%06d/", i / 5) + string(i % 5, 'z');
+  };
+  vector<string> keys;
+  for (int i = 0; i < kCount; i++) {
+    keys.push_back(key(i));
+  }
+  Slice s = CreateBinaryBlock(&sbb, kCount, key);
+  BinaryPrefixBlockDecoder sbd(s);
+  ASSERT_OK(sbd.ParseHeader());
+
+  // Seek to each key, and to a value between it and the next key.
+  vector<string> targets;
+  for (int i = 0; i < kCount; i++) {
+    targets.push_back(keys[i]);
+    targets.push_back(keys[i] + "a");
+  }
+  targets.push_back(kPrefix);
+  const auto& check_seeks = [&]() {
+    for (const string& t : targets) {
+      SCOPED_TRACE(t);
+      Slice q(t);
+      bool exact;
+      auto it = std::lower_bound(keys.begin(), keys.end(), t);
+      Status s = sbd.SeekAtOrAfterValue(&q, &exact);
+      if (it == keys.end()) {
+        ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+        continue;
+      }
+      ASSERT_OK(s);
+      ASSERT_EQ(it - keys.begin(), sbd.GetCurrentIndex());
+      ASSERT_EQ(*it == t, exact);
+    }
+  };
+  std::random_shuffle(targets.begin(), targets.end());
+  NO_FATALS(check_seeks());
+  std::sort(targets.begin(), targets.end());
+  NO_FATALS(check_seeks());
+}
+
 TEST_F(TestEncoding, TestBinaryPlainBlockBuilderSeekByValueSmallBlock) {
   TestBinarySeekByValueSmallBlock<BinaryPlainBlockBuilder, BinaryPlainBlockDecoder>();
 }
@@ -859,7 +1163,15 @@ struct BitshuffleTestTraits {
     typedef BShufBlockDecoder<type> decoder_type;
   };
 };
-typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits> MyTestFixtures;
+struct FrameOfReferenceTestTraits {
+  template<DataType type>
+  struct Classes {
+    typedef FrameOfReferenceBlockBuilder<type> encoder_type;
+    typedef FrameOfReferenceBlockDecoder<type> decoder_type;
+  };
+};
+typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits,
+                       FrameOfReferenceTestTraits> MyTestFixtures;
 TYPED_TEST_CASE(IntEncodingTest, MyTestFixtures);
 
 template<class TestTraits>
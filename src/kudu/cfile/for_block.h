@@ -0,0 +1,418 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Frame-of-reference encoding for fixed size integer types, such as
+// UINT8, INT8, UINT16, INT16, UINT32, INT32, UINT64, INT64, INT128.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowid.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/int128.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace cfile {
+
+// The unsigned counterpart of a frame-of-reference encoded type.
+// std::make_unsigned doesn't support __int128 in strict C++11 mode.
+template<typename T>
+struct ForUnsignedType {
+  typedef typename std::make_unsigned<T>::type type;
+};
+
+template<>
+struct ForUnsignedType<int128_t> {
+  typedef uint128_t type;
+};
+
+// FrameOfReferenceBlockBuilder stores each value of a block as its
+// difference from the smallest value in the block, bit-packed using the
+// minimum number of bits needed to represent the largest difference. This
+// works well for columns whose values are close to each other within a
+// block, such as event timestamps or sequence numbers, which are almost
+// sorted and would otherwise take the full width of the type.
+//
+// The block format is as follows:
+//
+// 1. Header:
+//
+//    <num_elements> [32-bit]
+//      The number of elements encoded in the block.
+//
+//    <first_ordinal> [32-bit]
+//      The ordinal offset of the first element in the block.
+//
+//    <bit_width> [32-bit]
+//      The number of bits used to store each packed difference, between 0
+//      and 64. For INT128, this may also be 128, see below.
+//
+//    <min_value> [size of type]
+//      The smallest value in the block, which is the frame of reference.
+//
+//    <max_value> [size of type]
+//      The largest value in the block.
+//
+//   NOTE: all on-disk ints are encoded little-endian
+//
+// 2. Element data
+//
+//    The differences from <min_value>, packed back to back starting at the
+//    least significant bit of each byte, followed by kPaddingBytes of zero
+//    padding so that any packed value may be read with unaligned 64-bit
+//    loads.
+//
+//    The differences are packed into at most 64 bits. In a block of INT128
+//    values whose range doesn't fit in 64 bits, such as DECIMAL128 values of
+//    very different magnitudes, <bit_width> is 128 and the element data
+//    holds the values themselves instead.
+//
+// Since the header records the range of values in the block, seeks to a
+// value outside of [min_value, max_value] complete without touching the
+// element data, and any element can be decoded without decoding the ones
+// preceding it.
+template<DataType Type>
+class FrameOfReferenceBlockBuilder final : public BlockBuilder {
+ public:
+  explicit FrameOfReferenceBlockBuilder(const WriterOptions* options)
+      : options_(options) {
+    Reset();
+  }
+
+  void Reset() override {
+    auto block_size = options_->storage_attributes.cfile_block_size;
+    count_ = 0;
+    data_.clear();
+    data_.reserve(block_size);
+    buffer_.clear();
+    finished_ = false;
+    rem_elem_capacity_ = block_size / kSizeOfType;
+  }
+
+  bool IsBlockFull() const override {
+    return rem_elem_capacity_ == 0;
+  }
+
+  int Add(const uint8_t* vals_void, size_t count) override {
+    DCHECK(!finished_);
+    int to_add = std::min<int>(rem_elem_capacity_, count);
+    data_.append(vals_void, to_add * kSizeOfType);
+    count_ += to_add;
+    rem_elem_capacity_ -= to_add;
+    return to_add;
+  }
+
+  size_t Count() const override {
+    return count_;
+  }
+
+  Status GetFirstKey(void* key) const override {
+    DCHECK(finished_);
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    UnalignedStore(key, cell(0));
+    return Status::OK();
+  }
+
+  Status GetLastKey(void* key) const override {
+    DCHECK(finished_);
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    UnalignedStore(key, cell(count_ - 1));
+    return Status::OK();
+  }
+
+  Slice Finish(rowid_t ordinal_pos) override {
+    CppType min_value = 0;
+    CppType max_value = 0;
+    if (count_ > 0) {
+      min_value = cell(0);
+      max_value = cell(0);
+      for (uint32_t i = 1; i < count_; i++) {
+        CppType v = cell(i);
+        min_value = std::min(min_value, v);
+        max_value = std::max(max_value, v);
+      }
+    }
+    const UnsignedType range =
+        static_cast<UnsignedType>(max_value) - static_cast<UnsignedType>(min_value);
+    int bit_width;
+    if (sizeof(UnsignedType) > sizeof(uint64_t) && range > std::numeric_limits<uint64_t>::max()) {
+      bit_width = kSizeOfType * 8;
+    } else {
+      bit_width = range == 0 ? 0 : Bits::FindMSBSetNonZero64(static_cast<uint64_t>(range)) + 1;
+    }
+    const size_t packed_bytes = (static_cast<uint64_t>(count_) * bit_width + 7) / 8;
+
+    buffer_.clear();
+    buffer_.resize(kHeaderSize + packed_bytes + kPaddingBytes);
+    memset(buffer_.data(), 0, buffer_.size());
+    InlineEncodeFixed32(&buffer_[0], count_);
+    InlineEncodeFixed32(&buffer_[4], ordinal_pos);
+    InlineEncodeFixed32(&buffer_[8], bit_width);
+    memcpy(&buffer_[12], &min_value, kSizeOfType);
+    memcpy(&buffer_[12 + kSizeOfType], &max_value, kSizeOfType);
+
+    if (bit_width > 64) {
+      memcpy(&buffer_[kHeaderSize], data_.data(), count_ * kSizeOfType);
+    } else if (bit_width > 0) {
+      uint8_t* packed = &buffer_[kHeaderSize];
+      size_t bit_pos = 0;
+      for (uint32_t i = 0; i < count_; i++, bit_pos += bit_width) {
+        uint64_t delta = static_cast<UnsignedType>(
+            static_cast<UnsignedType>(cell(i)) - static_cast<UnsignedType>(min_value));
+        uint8_t* p = packed + bit_pos / 8;
+        int shift = bit_pos % 8;
+        UNALIGNED_STORE64(p, UNALIGNED_LOAD64(p) | (delta << shift));
+        if (shift + bit_width > 64) {
+          p[8] |= static_cast<uint8_t>(delta >> (64 - shift));
+        }
+      }
+    }
+    finished_ = true;
+    return Slice(buffer_);
+  }
+
+  // Length of the header.
+  static const size_t kHeaderSize = sizeof(uint32_t) * 3 + TypeTraits<Type>::size * 2;
+
+  // Trailing padding, which allows a packed value to be read with one
+  // unaligned 64-bit load plus at most one extra byte.
+  static const size_t kPaddingBytes = sizeof(uint64_t) + 1;
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename ForUnsignedType<CppType>::type UnsignedType;
+  static_assert((std::is_integral<CppType>::value && sizeof(CppType) <= sizeof(uint64_t)) ||
+                std::is_same<CppType, int128_t>::value,
+                "frame-of-reference encoding supports integers up to 64 bits and INT128");
+  enum {
+    kSizeOfType = TypeTraits<Type>::size
+  };
+
+  CppType cell(int idx) const {
+    DCHECK_GE(idx, 0);
+    return UnalignedLoad<CppType>(&data_[idx * kSizeOfType]);
+  }
+
+  faststring data_;
+  faststring buffer_;
+  uint32_t count_;
+  int rem_elem_capacity_;
+  bool finished_;
+  const WriterOptions* options_;
+};
+
+template<DataType Type>
+class FrameOfReferenceBlockDecoder final : public BlockDecoder {
+ public:
+  explicit FrameOfReferenceBlockDecoder(Slice slice)
+      : data_(slice),
+        parsed_(false),
+        num_elems_(0),
+        ordinal_pos_base_(0),
+        bit_width_(0),
+        mask_(0),
+        min_value_(0),
+        max_value_(0),
+        packed_(nullptr),
+        cur_idx_(0) {
+  }
+
+  Status ParseHeader() override {
+    CHECK(!parsed_);
+    if (data_.size() < kHeaderSize) {
+      return Status::Corruption(
+          strings::Substitute("not enough bytes for header: frame-of-reference block "
+                              "size ($0) less than expected header length ($1)",
+                              data_.size(), kHeaderSize));
+    }
+    num_elems_ = DecodeFixed32(&data_[0]);
+    ordinal_pos_base_ = DecodeFixed32(&data_[4]);
+    bit_width_ = DecodeFixed32(&data_[8]);
+    if (bit_width_ > kSizeOfType * 8 || (bit_width_ > 64 && bit_width_ != kSizeOfType * 8)) {
+      return Status::Corruption(strings::Substitute("invalid bit width: $0", bit_width_));
+    }
+    min_value_ = UnalignedLoad<CppType>(&data_[12]);
+    max_value_ = UnalignedLoad<CppType>(&data_[12 + kSizeOfType]);
+
+    size_t packed_bytes = (static_cast<uint64_t>(num_elems_) * bit_width_ + 7) / 8;
+    if (data_.size() != kHeaderSize + packed_bytes + kPaddingBytes) {
+      return Status::Corruption(
+          strings::Substitute("unexpected frame-of-reference block size: $0 (expected $1)",
+                              data_.size(), kHeaderSize + packed_bytes + kPaddingBytes));
+    }
+    packed_ = &data_[kHeaderSize];
+    mask_ = bit_width_ >= 64 ? ~0ULL : (1ULL << bit_width_) - 1;
+    parsed_ = true;
+    cur_idx_ = 0;
+    return Status::OK();
+  }
+
+  void SeekToPositionInBlock(uint pos) override {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    if (PREDICT_FALSE(num_elems_ == 0)) {
+      DCHECK_EQ(0, pos);
+      return;
+    }
+    DCHECK_LE(pos, num_elems_);
+    cur_idx_ = pos;
+  }
+
+  Status SeekAtOrAfterValue(const void* value_void, bool* exact) override {
+    DCHECK(parsed_);
+    CppType target = UnalignedLoad<CppType>(value_void);
+    *exact = false;
+
+    // Use the block's range to avoid looking at the element data when the
+    // target falls outside of it.
+    if (num_elems_ == 0 || target > max_value_) {
+      cur_idx_ = num_elems_;
+      return Status::NotFound("after last key in block");
+    }
+    if (target <= min_value_) {
+      cur_idx_ = 0;
+      *exact = target == min_value_;
+      return Status::OK();
+    }
+
+    uint32_t left = 0;
+    uint32_t right = num_elems_;
+    while (left != right) {
+      uint32_t mid = (left + right) / 2;
+      CppType mid_key = ValueAt(mid);
+      if (mid_key == target) {
+        cur_idx_ = mid;
+        *exact = true;
+        return Status::OK();
+      } else if (mid_key > target) {
+        right = mid;
+      } else {
+        left = mid + 1;
+      }
+    }
+
+    cur_idx_ = left;
+    if (cur_idx_ == num_elems_) {
+      return Status::NotFound("after last key in block");
+    }
+    return Status::OK();
+  }
+
+  Status CopyNextValues(size_t* n, ColumnDataView* dst) override {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    uint8_t* out = dst->data();
+    if (bit_width_ == 0) {
+      for (size_t i = 0; i < max_fetch; i++, out += kSizeOfType) {
+        UnalignedStore(out, min_value_);
+      }
+    } else {
+      for (size_t i = 0; i < max_fetch; i++, out += kSizeOfType) {
+        UnalignedStore(out, ValueAt(cur_idx_ + i));
+      }
+    }
+    cur_idx_ += max_fetch;
+    *n = max_fetch;
+    return Status::OK();
+  }
+
+  size_t GetCurrentIndex() const override {
+    DCHECK(parsed_) << "must parse header first";
+    return cur_idx_;
+  }
+
+  rowid_t GetFirstRowId() const override {
+    return ordinal_pos_base_;
+  }
+
+  size_t Count() const override {
+    return num_elems_;
+  }
+
+  bool HasNext() const override {
+    return cur_idx_ < num_elems_;
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename ForUnsignedType<CppType>::type UnsignedType;
+  enum {
+    kSizeOfType = TypeTraits<Type>::size
+  };
+  static const size_t kHeaderSize = FrameOfReferenceBlockBuilder<Type>::kHeaderSize;
+  static const size_t kPaddingBytes = FrameOfReferenceBlockBuilder<Type>::kPaddingBytes;
+
+  // Decode the element at 'idx' without decoding any other element.
+  CppType ValueAt(size_t idx) const {
+    if (sizeof(CppType) > sizeof(uint64_t) && bit_width_ > 64) {
+      return UnalignedLoad<CppType>(packed_ + idx * kSizeOfType);
+    }
+    size_t bit_pos = idx * bit_width_;
+    const uint8_t* p = packed_ + bit_pos / 8;
+    int shift = bit_pos % 8;
+    uint64_t delta = UNALIGNED_LOAD64(p) >> shift;
+    if (shift + bit_width_ > 64) {
+      delta |= static_cast<uint64_t>(p[8]) << (64 - shift);
+    }
+    delta &= mask_;
+    return static_cast<CppType>(static_cast<UnsignedType>(min_value_) +
+                                static_cast<UnsignedType>(delta));
+  }
+
+  Slice data_;
+  bool parsed_;
+
+  uint32_t num_elems_;
+  rowid_t ordinal_pos_base_;
+  uint32_t bit_width_;
+  uint64_t mask_;
+  CppType min_value_;
+  CppType max_value_;
+  const uint8_t* packed_;
+
+  size_t cur_idx_;
+};
+
+} // namespace cfile
+} // namespace kudu
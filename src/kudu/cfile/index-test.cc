@@ -30,6 +30,7 @@
 #include "kudu/common/key_encoder.h"
 #include "kudu/gutil/endian.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/slice.h"
@@ -336,6 +337,65 @@ TEST(TestIndexBlock, TestIterator) {
   ASSERT_TRUE(iter->HasNext());
 }
 
+// Test prefix-compressed index blocks, which should take less space than the
+// others for keys which share prefixes, and be searched and iterated alike.
+TEST(TestIndexBlock, TestPrefixCompressedBlock) {
+  const int kNumEntries = 1000;
+  const auto& key = [](int i) {
+    return StringPrintf("composite-key-prefix/%06d", i * 10);
+  };
+  WriterOptions opts;
+  IndexBlockBuilder idx(&opts, true);
+  WriterOptions compressed_opts;
+  compressed_opts.prefix_compress_index_blocks = true;
+  IndexBlockBuilder compressed_idx(&compressed_opts, true);
+  for (int i = 0; i < kNumEntries; i++) {
+    idx.Add(key(i), BlockPointer(100000 + i, 64 * 1024));
+    compressed_idx.Add(key(i), BlockPointer(100000 + i, 64 * 1024));
+  }
+  Slice first_key;
+  ASSERT_OK(compressed_idx.GetFirstKey(&first_key));
+  ASSERT_EQ(key(0), first_key.ToString());
+
+  size_t est_size = compressed_idx.EstimateEncodedSize();
+  Slice s = compressed_idx.Finish();
+  EXPECT_LT(s.size(), est_size);
+  EXPECT_GT(s.size(), est_size * 3 / 4);
+  EXPECT_LT(s.size(), idx.Finish().size() / 2);
+
+  IndexBlockReader reader;
+  ASSERT_OK(reader.Parse(s));
+  ASSERT_TRUE(reader.IsPrefixCompressed());
+  ASSERT_EQ(kNumEntries, reader.Count());
+  gscoped_ptr<IndexBlockIterator> iter(reader.NewIterator());
+
+  // Search for each key, and for a key between it and the next one.
+  for (int i = 0; i < kNumEntries; i++) {
+    SCOPED_TRACE(i);
+    ASSERT_OK(iter->SeekAtOrBefore(key(i)));
+    ASSERT_EQ(key(i), iter->GetCurrentKey().ToString());
+    ASSERT_EQ(100000 + i, iter->GetCurrentBlockPointer().offset());
+    ASSERT_OK(iter->SeekAtOrBefore(key(i) + "x"));
+    ASSERT_EQ(key(i), iter->GetCurrentKey().ToString());
+    ASSERT_EQ(100000 + i, iter->GetCurrentBlockPointer().offset());
+  }
+  ASSERT_TRUE(iter->SeekAtOrBefore("composite").IsNotFound());
+
+  // Iterate from an entry in the middle of a restart interval to the end.
+  ASSERT_OK(iter->SeekToIndex(37));
+  for (int i = 37; i < kNumEntries; i++) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(key(i), iter->GetCurrentKey().ToString());
+    ASSERT_EQ(100000 + i, iter->GetCurrentBlockPointer().offset());
+    ASSERT_EQ(i + 1 < kNumEntries, iter->HasNext());
+    if (iter->HasNext()) {
+      ASSERT_OK(iter->Next());
+    }
+  }
+  ASSERT_TRUE(iter->Next().IsNotFound());
+  ASSERT_TRUE(iter->SeekToIndex(kNumEntries).IsNotFound());
+}
+
 TEST(TestIndexKeys, TestGetSeparatingKey) {
   // Test example cases
   Slice left = "";
@@ -17,12 +17,14 @@
 
 #include "kudu/cfile/index_block.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <ostream>
 #include <string>
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/cfile_util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/coding-inl.h"
@@ -61,7 +63,9 @@ IndexBlockBuilder::IndexBlockBuilder(
   bool is_leaf)
   : options_(options),
     finished_(false),
-    is_leaf_(is_leaf) {
+    is_leaf_(is_leaf),
+    prefix_compressed_(options->prefix_compress_index_blocks) {
+  DCHECK_GT(options_->block_restart_interval, 0);
 }
 
 
@@ -71,22 +75,47 @@ void IndexBlockBuilder::Add(const Slice &keyptr,
     "Must Reset() after Finish() before more Add()";
 
   size_t entry_offset = buffer_.size();
-  SliceEncode(keyptr, &buffer_);
+  if (prefix_compressed_) {
+    // At 'entry_offset', data is encoded as follows:
+    // <shared length> <non-shared length> <non-shared bytes> <block pointer>
+    size_t shared = 0;
+    if (entry_offsets_.size() % options_->block_restart_interval != 0) {
+      shared = CommonPrefixLength(Slice(last_key_), keyptr);
+    }
+    InlinePutVarint32(&buffer_, shared);
+    InlinePutVarint32(&buffer_, keyptr.size() - shared);
+    buffer_.append(keyptr.data() + shared, keyptr.size() - shared);
+    last_key_.assign_copy(keyptr.data(), keyptr.size());
+  } else {
+    SliceEncode(keyptr, &buffer_);
+  }
   ptr.EncodeTo(&buffer_);
   entry_offsets_.push_back(entry_offset);
 }
 
+size_t IndexBlockBuilder::num_stored_offsets() const {
+  if (!prefix_compressed_) {
+    return entry_offsets_.size();
+  }
+  const size_t interval = options_->block_restart_interval;
+  return (entry_offsets_.size() + interval - 1) / interval;
+}
+
 Slice IndexBlockBuilder::Finish() {
   CHECK(!finished_) << "already called Finish()";
 
-  for (uint32_t off : entry_offsets_) {
-    InlinePutFixed32(&buffer_, off);
+  const size_t offsets_stride = prefix_compressed_ ? options_->block_restart_interval : 1;
+  for (size_t i = 0; i < entry_offsets_.size(); i += offsets_stride) {
+    InlinePutFixed32(&buffer_, entry_offsets_[i]);
   }
 
   IndexBlockTrailerPB trailer;
   trailer.set_num_entries(entry_offsets_.size());
   trailer.set_type(
     is_leaf_ ? IndexBlockTrailerPB::LEAF : IndexBlockTrailerPB::INTERNAL);
+  if (prefix_compressed_) {
+    trailer.set_restart_interval(options_->block_restart_interval);
+  }
   AppendPBToString(trailer, &buffer_);
 
   InlinePutFixed32(&buffer_, trailer.GetCachedSize());
@@ -105,7 +134,18 @@ Status IndexBlockBuilder::GetFirstKey(Slice *key) const {
     return Status::NotFound("no keys in builder");
   }
 
-  bool success = nullptr != SliceDecode(buffer_.data(),buffer_.data() + buffer_.size(),key);
+  const uint8_t *ptr = buffer_.data();
+  const uint8_t *limit = buffer_.data() + buffer_.size();
+  if (prefix_compressed_) {
+    // The first key is stored in full: skip its zero shared length.
+    uint32_t shared;
+    ptr = GetVarint32Ptr(ptr, limit, &shared);
+    DCHECK(ptr == nullptr || shared == 0);
+    if (ptr == nullptr) {
+      return Status::Corruption("Unable to decode first key");
+    }
+  }
+  bool success = nullptr != SliceDecode(ptr, limit, key);
 
   if (success) {
     return Status::OK();
@@ -119,7 +159,7 @@ size_t IndexBlockBuilder::EstimateEncodedSize() const {
   int size = buffer_.size();
 
   // entry offsets
-  size += sizeof(uint32_t) * entry_offsets_.size();
+  size += sizeof(uint32_t) * num_stored_offsets();
 
   // estimate trailer cheaply -- not worth actually constructing
   // a trailer to determine the size.
@@ -169,8 +209,19 @@ Status IndexBlockReader::Parse(const Slice &data) {
       trailer_.InitializationErrorString());
   }
 
-  key_offsets_ = trailer_ptr - sizeof(uint32_t) * trailer_.num_entries();
-  CHECK(trailer_ptr >= data_.data());
+  if (PREDICT_FALSE(trailer_.num_entries() < 0 ||
+                    (trailer_.has_restart_interval() && trailer_.restart_interval() == 0))) {
+    return Status::Corruption("invalid index block trailer",
+                              pb_util::SecureShortDebugString(trailer_));
+  }
+  size_t num_offsets = IsPrefixCompressed() ? num_restarts() : trailer_.num_entries();
+  if (PREDICT_FALSE(sizeof(uint32_t) * num_offsets >
+                    static_cast<size_t>(trailer_ptr - data_.data()))) {
+    return Status::Corruption(strings::Substitute(
+        "index block of $0 entries too small: $1 bytes",
+        trailer_.num_entries(), data_.size()));
+  }
+  key_offsets_ = trailer_ptr - sizeof(uint32_t) * num_offsets;
 
   VLOG(2) << "Parsed index trailer: " << pb_util::SecureDebugString(trailer_);
 
@@ -192,6 +243,60 @@ bool IndexBlockReader::IsLeaf() {
   return trailer_.type() == IndexBlockTrailerPB::LEAF;
 }
 
+size_t IndexBlockReader::num_restarts() const {
+  DCHECK(IsPrefixCompressed());
+  return (trailer_.num_entries() + trailer_.restart_interval() - 1) / trailer_.restart_interval();
+}
+
+Status IndexBlockReader::DecodeCompressedEntry(const uint8_t *ptr, faststring *key,
+                                               BlockPointer *block_ptr,
+                                               const uint8_t **next) const {
+  // The entries end where the restart offsets begin.
+  const uint8_t *limit = key_offsets_;
+  uint32_t shared;
+  uint32_t non_shared;
+  ptr = GetVarint32Ptr(ptr, limit, &shared);
+  if (ptr != nullptr) {
+    ptr = GetVarint32Ptr(ptr, limit, &non_shared);
+  }
+  if (PREDICT_FALSE(ptr == nullptr || shared > key->size() ||
+                    non_shared > static_cast<size_t>(limit - ptr))) {
+    return Status::Corruption("Invalid key in index");
+  }
+  key->resize(shared);
+  key->append(ptr, non_shared);
+  ptr += non_shared;
+
+  uint64_t offset;
+  uint32_t size;
+  ptr = GetVarint64Ptr(ptr, limit, &offset);
+  if (ptr != nullptr) {
+    ptr = GetVarint32Ptr(ptr, limit, &size);
+  }
+  if (PREDICT_FALSE(ptr == nullptr)) {
+    return Status::Corruption("bad block pointer");
+  }
+  *block_ptr = BlockPointer(offset, size);
+  *next = ptr;
+  return Status::OK();
+}
+
+Status IndexBlockReader::GetRestartKey(size_t restart_idx, Slice *key) const {
+  DCHECK_LT(restart_idx, num_restarts());
+  const uint8_t *ptr = data_.data() + DecodeFixed32(&key_offsets_[restart_idx * sizeof(uint32_t)]);
+  const uint8_t *limit = key_offsets_;
+  uint32_t shared;
+  if (PREDICT_FALSE(ptr >= limit)) {
+    return Status::Corruption("Invalid key offset in index");
+  }
+  ptr = GetVarint32Ptr(ptr, limit, &shared);
+  if (PREDICT_FALSE(ptr == nullptr || shared != 0 ||
+                    SliceDecode(ptr, limit, key) == nullptr)) {
+    return Status::Corruption("Invalid restart key in index");
+  }
+  return Status::OK();
+}
+
 int IndexBlockReader::CompareKey(int idx_in_block,
                                  const Slice &search_key) const {
   const uint8_t *key_ptr, *limit;
@@ -254,15 +359,58 @@ void IndexBlockBuilder::Reset() {
 IndexBlockIterator::IndexBlockIterator(const IndexBlockReader *reader)
   : reader_(reader),
     cur_idx_(-1),
-    seeked_(false) {
+    seeked_(false),
+    next_entry_(nullptr) {
 }
 
 void IndexBlockIterator::Reset() {
   seeked_ = false;
   cur_idx_ = -1;
+  next_entry_ = nullptr;
 }
 
 Status IndexBlockIterator::SeekAtOrBefore(const Slice &search_key) {
+  if (reader_->IsPrefixCompressed()) {
+    // Find the last restart entry with a key <= the search key...
+    size_t left = 0;
+    size_t right = reader_->num_restarts();
+    while (left < right) {
+      size_t mid = left + (right - left) / 2;
+      Slice mid_key;
+      RETURN_NOT_OK(reader_->GetRestartKey(mid, &mid_key));
+      if (mid_key.compare(search_key) <= 0) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    if (left == 0) {
+      return Status::NotFound("key not present");
+    }
+
+    // ... and the last entry with a key <= the search key from there, which
+    // comes before the next restart entry.
+    const size_t interval = reader_->trailer_.restart_interval();
+    RETURN_NOT_OK(SeekToCompressedIndex((left - 1) * interval));
+    const size_t end_idx = std::min<size_t>(left * interval, reader_->Count());
+    while (cur_idx_ + 1 < end_idx) {
+      scratch_key_.assign_copy(cur_key_buf_.data(), cur_key_buf_.size());
+      BlockPointer next_ptr;
+      const uint8_t *next_next_entry;
+      RETURN_NOT_OK(reader_->DecodeCompressedEntry(next_entry_, &scratch_key_, &next_ptr,
+                                                   &next_next_entry));
+      if (Slice(scratch_key_).compare(search_key) > 0) {
+        break;
+      }
+      cur_key_buf_.assign_copy(scratch_key_.data(), scratch_key_.size());
+      cur_key_ = Slice(cur_key_buf_);
+      cur_ptr_ = next_ptr;
+      next_entry_ = next_next_entry;
+      cur_idx_++;
+    }
+    return Status::OK();
+  }
+
   size_t left = 0;
   size_t right = reader_->Count() - 1;
   while (left < right) {
@@ -292,17 +440,63 @@ Status IndexBlockIterator::SeekAtOrBefore(const Slice &search_key) {
 }
 
 Status IndexBlockIterator::SeekToIndex(size_t idx) {
+  if (reader_->IsPrefixCompressed()) {
+    return SeekToCompressedIndex(idx);
+  }
   cur_idx_ = idx;
   Status s = reader_->ReadEntry(idx, &cur_key_, &cur_ptr_);
   seeked_ = s.ok();
   return s;
 }
 
+Status IndexBlockIterator::SeekToCompressedIndex(size_t idx) {
+  seeked_ = false;
+  if (idx >= reader_->Count()) {
+    return Status::NotFound("Invalid index");
+  }
+  // Decode forward from the closest restart entry.
+  const size_t interval = reader_->trailer_.restart_interval();
+  const size_t restart_idx = idx / interval;
+  cur_idx_ = restart_idx * interval;
+  next_entry_ = reader_->data_.data() +
+      DecodeFixed32(&reader_->key_offsets_[restart_idx * sizeof(uint32_t)]);
+  if (PREDICT_FALSE(next_entry_ >= reader_->key_offsets_)) {
+    return Status::Corruption("Invalid key offset in index");
+  }
+  cur_key_buf_.clear();
+  RETURN_NOT_OK(reader_->DecodeCompressedEntry(next_entry_, &cur_key_buf_, &cur_ptr_,
+                                               &next_entry_));
+  while (cur_idx_ < idx) {
+    RETURN_NOT_OK(reader_->DecodeCompressedEntry(next_entry_, &cur_key_buf_, &cur_ptr_,
+                                                 &next_entry_));
+    cur_idx_++;
+  }
+  cur_key_ = Slice(cur_key_buf_);
+  seeked_ = true;
+  return Status::OK();
+}
+
+Status IndexBlockIterator::NextCompressed() {
+  if (!seeked_ || cur_idx_ + 1 >= reader_->Count()) {
+    return SeekToCompressedIndex(cur_idx_ + 1);
+  }
+  seeked_ = false;
+  RETURN_NOT_OK(reader_->DecodeCompressedEntry(next_entry_, &cur_key_buf_, &cur_ptr_,
+                                               &next_entry_));
+  cur_idx_++;
+  cur_key_ = Slice(cur_key_buf_);
+  seeked_ = true;
+  return Status::OK();
+}
+
 bool IndexBlockIterator::HasNext() const {
   return cur_idx_ + 1 < reader_->Count();
 }
 
 Status IndexBlockIterator::Next() {
+  if (reader_->IsPrefixCompressed()) {
+    return NextCompressed();
+  }
   return SeekToIndex(cur_idx_ + 1);
 }
 
@@ -41,6 +41,13 @@ struct WriterOptions;
 // This works like the rest of the builders in the cfile package.
 // After repeatedly calling Add(), call Finish() to encode it
 // into a Slice, then you may Reset to re-use buffers.
+//
+// If WriterOptions::prefix_compress_index_blocks is set, each key is stored
+// as the length of the prefix it shares with the previous key and the rest
+// of it, except for every 'block_restart_interval'-th key, which is stored in
+// full so that readers can binary search these "restart" keys. Only the
+// offsets of the restart entries are stored. Otherwise, each key is stored
+// in full along with its offset.
 class IndexBlockBuilder {
  public:
   explicit IndexBlockBuilder(const WriterOptions *options,
@@ -78,9 +85,9 @@ class IndexBlockBuilder {
  private:
   DISALLOW_COPY_AND_ASSIGN(IndexBlockBuilder);
 
-#ifdef __clang__
-  __attribute__((__unused__))
-#endif
+  // Returns the number of offsets stored in the block.
+  size_t num_stored_offsets() const;
+
   const WriterOptions *options_;
 
   // Is the builder currently between Finish() and Reset()
@@ -89,8 +96,14 @@ class IndexBlockBuilder {
   // Is this a leaf block?
   bool is_leaf_;
 
+  // Are the keys prefix-compressed?
+  const bool prefix_compressed_;
+
   faststring buffer_;
   std::vector<uint32_t> entry_offsets_;
+
+  // The last key added, when prefix-compressing the keys.
+  faststring last_key_;
 };
 
 class IndexBlockReader {
@@ -106,6 +119,9 @@ class IndexBlockReader {
   //
   // Note: this does not copy the data, so the slice must
   // remain valid for the lifetime of the reader (or until the next Parse call)
+  //
+  // Blocks with prefix-compressed keys and blocks with full keys are both
+  // supported.
   Status Parse(const Slice &data);
 
   size_t Count() const;
@@ -114,6 +130,11 @@ class IndexBlockReader {
 
   bool IsLeaf();
 
+  // Whether the keys of the block are prefix-compressed.
+  bool IsPrefixCompressed() const {
+    return trailer_.has_restart_interval();
+  }
+
  private:
   friend class IndexBlockIterator;
 
@@ -121,6 +142,19 @@ class IndexBlockReader {
 
   Status ReadEntry(size_t idx, Slice *key, BlockPointer *block_ptr) const;
 
+  // Returns the number of restart entries of a prefix-compressed block.
+  size_t num_restarts() const;
+
+  // Decodes the prefix-compressed entry at 'ptr', whose key shares a prefix
+  // with 'key', the key of the previous entry. Replaces 'key' with the
+  // entry's key, and sets '*next' to the beginning of the following entry.
+  Status DecodeCompressedEntry(const uint8_t *ptr, faststring *key,
+                               BlockPointer *block_ptr, const uint8_t **next) const;
+
+  // Returns the key of restart entry 'restart_idx' of a prefix-compressed
+  // block, pointing into the block's data.
+  Status GetRestartKey(size_t restart_idx, Slice *key) const;
+
   // Set *ptr to the beginning of the index data for the given index
   // entry.
   // Set *limit to the 'limit' pointer for that entry (i.e a pointer
@@ -167,15 +201,31 @@ class IndexBlockIterator {
 
   const BlockPointer &GetCurrentBlockPointer() const;
 
+  // Returns the key of the current entry. If the block is prefix-compressed,
+  // the key is only valid until the iterator moves.
   const Slice GetCurrentKey() const;
 
  private:
+  // Seeks to entry 'idx' of a prefix-compressed block.
+  Status SeekToCompressedIndex(size_t idx);
+
+  // Seeks to the following entry of a prefix-compressed block.
+  Status NextCompressed();
+
   const IndexBlockReader *reader_;
   size_t cur_idx_;
   Slice cur_key_;
   BlockPointer cur_ptr_;
   bool seeked_;
 
+  // The current key of a prefix-compressed block, which 'cur_key_' points
+  // to, and the beginning of the following entry.
+  faststring cur_key_buf_;
+  const uint8_t *next_entry_;
+
+  // Scratch space for the keys decoded when seeking by key.
+  faststring scratch_key_;
+
   DISALLOW_COPY_AND_ASSIGN(IndexBlockIterator);
 };
 
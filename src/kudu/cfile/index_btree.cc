@@ -23,6 +23,7 @@
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/cfile.pb.h"
@@ -286,7 +287,8 @@ Status IndexTreeIterator::LoadBlock(const BlockPointer &block,
   }
 
   RETURN_NOT_OK(reader_->ReadBlock(io_context_, block,
-                                   CFileReader::CACHE_BLOCK, &seeked->data));
+                                   CFileReader::CACHE_BLOCK, &seeked->data,
+                                   BlockCache::HIGH_PRIORITY));
   seeked->block_ptr = block;
 
   // Parse the new block.
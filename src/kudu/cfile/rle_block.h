@@ -23,8 +23,12 @@
 
 #include "kudu/gutil/port.h"
 #include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/bshuf_block.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/coding-inl.h"
 #include "kudu/util/hexdump.h"
@@ -176,15 +180,8 @@ class RleBitMapBlockDecoder final : public BlockDecoder {
     }
 
     size_t bits_to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
-    size_t remaining = bits_to_fetch;
-    uint8_t* data_ptr = dst->data();
-    // TODO : do this a word/byte at a time as opposed bit at a time
-    while (remaining > 0) {
-      bool result = rle_decoder_.Get(reinterpret_cast<bool*>(data_ptr));
-      DCHECK(result);
-      remaining--;
-      data_ptr++;
-    }
+    size_t fetched = rle_decoder_.GetBatch(reinterpret_cast<bool*>(dst->data()), bits_to_fetch);
+    DCHECK_EQ(bits_to_fetch, fetched);
 
     cur_idx_ += bits_to_fetch;
     *n = bits_to_fetch;
@@ -409,13 +406,50 @@ class RleIntBlockDecoder final : public BlockDecoder {
     }
 
     size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
-    size_t remaining = to_fetch;
-    uint8_t* data_ptr = dst->data();
-    while (remaining > 0) {
-      bool result = rle_decoder_.Get(reinterpret_cast<CppType*>(data_ptr));
-      DCHECK(result);
-      remaining--;
-      data_ptr += kCppTypeSize;
+    size_t fetched = rle_decoder_.GetBatch(reinterpret_cast<CppType*>(dst->data()), to_fetch);
+    DCHECK_EQ(to_fetch, fetched);
+
+    cur_idx_ += to_fetch;
+    *n = to_fetch;
+    return Status::OK();
+  }
+
+  // Copy the next values into 'dst' and evaluate the predicate over them.
+  // A repeated run is evaluated only once for all of its values, and literal
+  // runs are evaluated in batches as they are unpacked.
+  Status CopyNextAndEval(size_t* n,
+                         ColumnMaterializationContext* ctx,
+                         SelectionVectorView* sel,
+                         ColumnDataView* dst) override {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+    ctx->SetDecoderEvalSupported();
+
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    const ColumnPredicate& pred = *ctx->pred();
+    size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    CppType* out = reinterpret_cast<CppType*>(dst->data());
+    SelectionVectorView batch_sel(*sel);
+    size_t fetched = 0;
+    while (fetched < to_fetch) {
+      bool is_repeated;
+      size_t count = rle_decoder_.GetNextBatch(out + fetched, to_fetch - fetched, &is_repeated);
+      DCHECK_GT(count, 0);
+      if (is_repeated) {
+        if (!pred.EvaluateCell<IntType>(out + fetched)) {
+          batch_sel.ClearBits(count);
+        }
+      } else {
+        EvaluatePredicateOnCells<IntType>(
+            pred, reinterpret_cast<const uint8_t*>(out + fetched), count, &batch_sel);
+      }
+      batch_sel.Advance(count);
+      fetched += count;
     }
 
     cur_idx_ += to_fetch;
@@ -0,0 +1,365 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/zone_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
+
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+// BINARY bounds larger than this are not recorded, to keep the zone map
+// (which is held in memory by readers) small.
+static const size_t kMaxBinaryBoundSize = 128;
+
+namespace {
+
+// Returns a pointer to the cell held in 'bytes', or nullptr if 'bytes' is
+// not a valid cell of the given type. For BINARY types the cell is a Slice
+// stored in 'slice_buf' that refers to 'bytes'.
+const void* CellFromBytes(const TypeInfo* typeinfo, const Slice& bytes, Slice* slice_buf) {
+  if (typeinfo->physical_type() == BINARY) {
+    *slice_buf = bytes;
+    return slice_buf;
+  }
+  if (PREDICT_FALSE(bytes.size() != typeinfo->size())) {
+    return nullptr;
+  }
+  return bytes.data();
+}
+
+// Returns the bytes of 'cell' which are summarized by zone maps and bloom
+// filters: the slice contents for BINARY types, or the cell itself.
+Slice CellContents(const TypeInfo* typeinfo, const void* cell) {
+  if (typeinfo->physical_type() == BINARY) {
+    return *reinterpret_cast<const Slice*>(cell);
+  }
+  return Slice(reinterpret_cast<const uint8_t*>(cell), typeinfo->size());
+}
+
+// Copies the contents of 'cell' into 'dst'.
+void CopyCellContents(const TypeInfo* typeinfo, const void* cell, faststring* dst) {
+  Slice contents = CellContents(typeinfo, cell);
+  dst->assign_copy(contents.data(), contents.size());
+}
+
+// Returns true if no bounds may be recorded for a block containing 'cell'.
+bool IsUnboundedCell(const TypeInfo* typeinfo, const void* cell) {
+  switch (typeinfo->physical_type()) {
+    case FLOAT:
+      return std::isnan(UnalignedLoad<float>(cell));
+    case DOUBLE:
+      return std::isnan(UnalignedLoad<double>(cell));
+    case BINARY:
+      return reinterpret_cast<const Slice*>(cell)->size() > kMaxBinaryBoundSize;
+    default:
+      return false;
+  }
+}
+
+} // anonymous namespace
+
+ZoneMapBuilder::ZoneMapBuilder(const TypeInfo* typeinfo, double bloom_fp_rate)
+    : typeinfo_(typeinfo),
+      bloom_fp_rate_(bloom_fp_rate) {
+  DCHECK_LT(bloom_fp_rate, 1);
+  Reset();
+}
+
+void ZoneMapBuilder::Reset() {
+  num_rows_ = 0;
+  null_count_ = 0;
+  has_bounds_ = false;
+  bounds_valid_ = true;
+  bloom_probes_.clear();
+}
+
+void ZoneMapBuilder::AddCells(const uint8_t* cells, size_t count) {
+  num_rows_ += count;
+  const size_t cell_size = typeinfo_->size();
+  if (has_bloom_filters()) {
+    for (size_t i = 0; i < count; i++) {
+      bloom_probes_.emplace_back(CellContents(typeinfo_, cells + i * cell_size));
+    }
+  }
+  if (!bounds_valid_) {
+    return;
+  }
+
+  Slice min_buf;
+  Slice max_buf;
+  for (size_t i = 0; i < count; i++) {
+    const void* cell = cells + i * cell_size;
+    if (PREDICT_FALSE(IsUnboundedCell(typeinfo_, cell))) {
+      bounds_valid_ = false;
+      has_bounds_ = false;
+      return;
+    }
+    if (PREDICT_FALSE(!has_bounds_)) {
+      CopyCellContents(typeinfo_, cell, &min_);
+      CopyCellContents(typeinfo_, cell, &max_);
+      has_bounds_ = true;
+      continue;
+    }
+    if (typeinfo_->Compare(cell, CellFromBytes(typeinfo_, Slice(min_), &min_buf)) < 0) {
+      CopyCellContents(typeinfo_, cell, &min_);
+    } else if (typeinfo_->Compare(cell, CellFromBytes(typeinfo_, Slice(max_), &max_buf)) > 0) {
+      CopyCellContents(typeinfo_, cell, &max_);
+    }
+  }
+}
+
+void ZoneMapBuilder::AddNulls(size_t count) {
+  num_rows_ += count;
+  null_count_ += count;
+}
+
+void ZoneMapBuilder::FinishBloomFilter(faststring* dst) {
+  DCHECK(has_bloom_filters());
+  BloomFilterBuilder bloom(BloomFilterSizing::ByCountAndFPRate(
+      std::max<size_t>(bloom_probes_.size(), 1), bloom_fp_rate_));
+  for (const auto& probe : bloom_probes_) {
+    bloom.AddKey(probe);
+  }
+
+  BloomBlockHeaderPB hdr;
+  hdr.set_num_hash_functions(bloom.n_hashes());
+  dst->clear();
+  PutFixed32(dst, hdr.ByteSize());
+  pb_util::AppendToString(hdr, dst);
+  dst->append(bloom.slice().data(), bloom.slice().size());
+}
+
+void ZoneMapBuilder::FinishBlock(rowid_t first_ordinal, const BlockPointer* bloom_ptr) {
+  ZoneMapEntryPB* entry = zone_map_.add_entries();
+  entry->set_first_ordinal(first_ordinal);
+  entry->set_num_rows(num_rows_);
+  if (null_count_ > 0) {
+    entry->set_null_count(null_count_);
+  }
+  if (has_bounds_) {
+    entry->set_min_value(min_.data(), min_.size());
+    entry->set_max_value(max_.data(), max_.size());
+  }
+  if (bloom_ptr != nullptr) {
+    bloom_ptr->CopyToPB(entry->mutable_bloom_block_ptr());
+  }
+  Reset();
+}
+
+void ZoneMapBuilder::GetSummary(ZoneMapEntryPB* summary) const {
+  summary->Clear();
+  summary->set_first_ordinal(0);
+  summary->set_num_rows(0);
+  for (const auto& entry : zone_map_.entries()) {
+    MergeZoneMapEntry(typeinfo_, entry, summary);
+  }
+}
+
+void MergeZoneMapEntry(const TypeInfo* typeinfo,
+                       const ZoneMapEntryPB& src,
+                       ZoneMapEntryPB* dst) {
+  const uint32_t src_non_null_count = src.num_rows() - src.null_count();
+  const uint32_t dst_non_null_count = dst->num_rows() - dst->null_count();
+  dst->set_num_rows(dst->num_rows() + src.num_rows());
+  if (src.null_count() > 0) {
+    dst->set_null_count(dst->null_count() + src.null_count());
+  }
+  if (src_non_null_count == 0) {
+    return;
+  }
+
+  // A side with non-null cells but no bounds could not record them, so
+  // neither can the merged entry.
+  if (dst_non_null_count == 0) {
+    if (src.has_min_value() && src.has_max_value()) {
+      dst->set_min_value(src.min_value());
+      dst->set_max_value(src.max_value());
+    }
+    return;
+  }
+  if (!dst->has_min_value() || !dst->has_max_value()) {
+    return;
+  }
+  if (!src.has_min_value() || !src.has_max_value()) {
+    dst->clear_min_value();
+    dst->clear_max_value();
+    return;
+  }
+
+  Slice src_buf;
+  Slice dst_buf;
+  const void* src_min = CellFromBytes(typeinfo, src.min_value(), &src_buf);
+  const void* dst_min = CellFromBytes(typeinfo, dst->min_value(), &dst_buf);
+  if (PREDICT_FALSE(src_min == nullptr || dst_min == nullptr)) {
+    dst->clear_min_value();
+    dst->clear_max_value();
+    return;
+  }
+  if (typeinfo->Compare(src_min, dst_min) < 0) {
+    dst->set_min_value(src.min_value());
+  }
+  const void* src_max = CellFromBytes(typeinfo, src.max_value(), &src_buf);
+  const void* dst_max = CellFromBytes(typeinfo, dst->max_value(), &dst_buf);
+  if (PREDICT_FALSE(src_max == nullptr || dst_max == nullptr)) {
+    dst->clear_min_value();
+    dst->clear_max_value();
+    return;
+  }
+  if (typeinfo->Compare(src_max, dst_max) > 0) {
+    dst->set_max_value(src.max_value());
+  }
+}
+
+bool ZoneMayMatch(const TypeInfo* typeinfo,
+                  const ZoneMapEntryPB& entry,
+                  const ColumnPredicate& pred) {
+  DCHECK_LE(entry.null_count(), entry.num_rows());
+  const uint32_t non_null_count = entry.num_rows() - entry.null_count();
+
+  switch (pred.predicate_type()) {
+    case PredicateType::None:
+      return false;
+    case PredicateType::IsNull:
+      return entry.null_count() > 0;
+    case PredicateType::IsNotNull:
+      return non_null_count > 0;
+    default:
+      break;
+  }
+
+  // The remaining predicate types can only be satisfied by non-null cells.
+  if (non_null_count == 0) {
+    return false;
+  }
+  if (!entry.has_min_value() || !entry.has_max_value()) {
+    return true;
+  }
+  Slice min_buf;
+  Slice max_buf;
+  const void* min = CellFromBytes(typeinfo, entry.min_value(), &min_buf);
+  const void* max = CellFromBytes(typeinfo, entry.max_value(), &max_buf);
+  if (PREDICT_FALSE(min == nullptr || max == nullptr)) {
+    return true;
+  }
+
+  switch (pred.predicate_type()) {
+    case PredicateType::Equality:
+      return typeinfo->Compare(pred.raw_lower(), min) >= 0 &&
+             typeinfo->Compare(pred.raw_lower(), max) <= 0;
+    case PredicateType::Range:
+      if (pred.raw_lower() != nullptr && typeinfo->Compare(max, pred.raw_lower()) < 0) {
+        return false;
+      }
+      if (pred.raw_upper() != nullptr && typeinfo->Compare(min, pred.raw_upper()) >= 0) {
+        return false;
+      }
+      return true;
+    case PredicateType::InList: {
+      // The values are sorted, so look for the first one that is >= min.
+      const std::vector<const void*>& values = pred.raw_values();
+      auto it = std::lower_bound(values.begin(), values.end(), min,
+                                 [&](const void* value, const void* bound) {
+                                   return typeinfo->Compare(value, bound) < 0;
+                                 });
+      return it != values.end() && typeinfo->Compare(*it, max) <= 0;
+    }
+    case PredicateType::InBloomFilter:
+    case PredicateType::Like:
+      // If every non-null cell of the block holds the same value, the block
+      // matches exactly when that value does. Otherwise only the optional
+      // bounds can rule the block out. Floating point cells are excluded
+      // since equal values (0.0 and -0.0) may hash differently.
+      if (typeinfo->physical_type() != FLOAT && typeinfo->physical_type() != DOUBLE &&
+          typeinfo->Compare(min, max) == 0) {
+        return pred.EvaluateCell(typeinfo->physical_type(), min);
+      }
+      if (pred.raw_lower() != nullptr && typeinfo->Compare(max, pred.raw_lower()) < 0) {
+        return false;
+      }
+      if (pred.raw_upper() != nullptr && typeinfo->Compare(min, pred.raw_upper()) >= 0) {
+        return false;
+      }
+      return true;
+    default:
+      return true;
+  }
+}
+
+bool PredicateUsesBloomFilter(const ColumnPredicate& pred) {
+  return pred.predicate_type() == PredicateType::Equality ||
+         pred.predicate_type() == PredicateType::InList;
+}
+
+Status ParseBloomFilterBlock(const Slice& block, BloomFilter* bloom) {
+  Slice data(block);
+  if (PREDICT_FALSE(data.size() < sizeof(uint32_t))) {
+    return Status::Corruption("invalid bloom filter block: not enough bytes");
+  }
+  uint32_t header_len = DecodeFixed32(data.data());
+  data.remove_prefix(sizeof(header_len));
+  if (PREDICT_FALSE(header_len > data.size())) {
+    return Status::Corruption(Substitute(
+        "bloom filter header length $0 doesn't fit in block of size $1",
+        header_len, data.size()));
+  }
+  BloomBlockHeaderPB hdr;
+  if (PREDICT_FALSE(!hdr.ParseFromArray(data.data(), header_len))) {
+    return Status::Corruption("invalid bloom filter block header",
+                              hdr.InitializationErrorString());
+  }
+  data.remove_prefix(header_len);
+  if (PREDICT_FALSE(data.empty())) {
+    return Status::Corruption("empty bloom filter block");
+  }
+  *bloom = BloomFilter(data, hdr.num_hash_functions());
+  return Status::OK();
+}
+
+bool BloomMayMatch(const TypeInfo* typeinfo,
+                   const BloomFilter& bloom,
+                   const ColumnPredicate& pred) {
+  DCHECK(PredicateUsesBloomFilter(pred));
+  if (pred.predicate_type() == PredicateType::Equality) {
+    return bloom.MayContainKey(BloomKeyProbe(CellContents(typeinfo, pred.raw_lower())));
+  }
+  for (const void* value : pred.raw_values()) {
+    if (bloom.MayContainKey(BloomKeyProbe(CellContents(typeinfo, value)))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace cfile
+} // namespace kudu
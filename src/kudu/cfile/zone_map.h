@@ -0,0 +1,144 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef KUDU_CFILE_ZONE_MAP_H
+#define KUDU_CFILE_ZONE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnPredicate;
+class Slice;
+class TypeInfo;
+
+namespace cfile {
+
+class BlockPointer;
+
+// Accumulates the per-data-block statistics of a cfile as it is written.
+//
+// Cells are added as they are appended to the current data block, and
+// FinishBlock() is called whenever that data block is flushed.
+//
+// If 'bloom_fp_rate' is positive, a bloom filter over the non-null values
+// of each data block is also built, targeting that false positive rate.
+class ZoneMapBuilder {
+ public:
+  explicit ZoneMapBuilder(const TypeInfo* typeinfo, double bloom_fp_rate = 0);
+
+  // Add 'count' consecutive non-null cells starting at 'cells'.
+  void AddCells(const uint8_t* cells, size_t count);
+
+  // Add 'count' null cells.
+  void AddNulls(size_t count);
+
+  // Whether a bloom filter is built for each data block.
+  bool has_bloom_filters() const { return bloom_fp_rate_ > 0; }
+
+  // Encode the bloom filter of the current data block into 'dst', in the
+  // same format as the blocks of a BloomFile. Must be called before
+  // FinishBlock(), and only if has_bloom_filters() is true.
+  void FinishBloomFilter(faststring* dst);
+
+  // Record an entry for the current data block, whose first row has the
+  // ordinal 'first_ordinal', and reset the statistics for the next block.
+  //
+  // 'bloom_ptr' points to the block's bloom filter, if one was written.
+  void FinishBlock(rowid_t first_ordinal, const BlockPointer* bloom_ptr = nullptr);
+
+  const ZoneMapPB& zone_map() const { return zone_map_; }
+
+  // Summarize all of the finished data blocks into a single entry, whose
+  // 'first_ordinal' is 0.
+  void GetSummary(ZoneMapEntryPB* summary) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZoneMapBuilder);
+
+  void Reset();
+
+  const TypeInfo* typeinfo_;
+
+  uint32_t num_rows_;
+  uint32_t null_count_;
+
+  // Whether 'min_' and 'max_' hold bounds for the non-null cells seen so far.
+  bool has_bounds_;
+
+  // Whether bounds may still be recorded for the current block.
+  bool bounds_valid_;
+
+  // Raw cell contents (or slice contents for BINARY types) of the current
+  // block's bounds.
+  faststring min_;
+  faststring max_;
+
+  const double bloom_fp_rate_;
+
+  // Probes for the non-null values of the current block. These only hold
+  // onto the computed hashes; the keys they refer to need not outlive them.
+  std::vector<BloomKeyProbe> bloom_probes_;
+
+  ZoneMapPB zone_map_;
+};
+
+// Returns false if no cell of the data block summarized by 'entry' can
+// satisfy 'pred'. Returns true otherwise, including when 'entry' does not
+// hold enough information to rule the block out.
+//
+// 'typeinfo' is the type of the cfile the entry was written for.
+bool ZoneMayMatch(const TypeInfo* typeinfo,
+                  const ZoneMapEntryPB& entry,
+                  const ColumnPredicate& pred);
+
+// Merges the statistics of 'src' into 'dst', as if the rows summarized by
+// 'src' were appended to those summarized by 'dst'. The 'first_ordinal' and
+// 'bloom_block_ptr' of 'dst' are left untouched.
+//
+// 'typeinfo' is the type of the cfile the entries were written for.
+void MergeZoneMapEntry(const TypeInfo* typeinfo,
+                       const ZoneMapEntryPB& src,
+                       ZoneMapEntryPB* dst);
+
+// Returns true if 'pred' is a predicate type for which per-block bloom
+// filters are useful.
+bool PredicateUsesBloomFilter(const ColumnPredicate& pred);
+
+// Parses a bloom filter block, as written by ZoneMapBuilder, into 'bloom'.
+// 'bloom' refers to the memory of 'block'.
+Status ParseBloomFilterBlock(const Slice& block, BloomFilter* bloom);
+
+// Returns false if none of the values referenced by 'pred' (which must
+// satisfy PredicateUsesBloomFilter()) are present in 'bloom'.
+bool BloomMayMatch(const TypeInfo* typeinfo,
+                   const BloomFilter& bloom,
+                   const ColumnPredicate& pred);
+
+} // namespace cfile
+} // namespace kudu
+
+#endif
@@ -28,6 +28,7 @@
 #include <utility>
 #include <vector>
 
+#include <boost/bind.hpp>
 #include <glog/logging.h>
 
 #include "kudu/client/callbacks.h"
@@ -42,6 +43,7 @@
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/row.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
@@ -50,9 +52,9 @@
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
-#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/connection.h"
+#include "kudu/rpc/request_tracker.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/retriable_rpc.h"
 #include "kudu/rpc/rpc.h"
@@ -60,6 +62,7 @@
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/pb_util.h"
 
@@ -79,7 +82,6 @@ class Schema;
 
 namespace rpc {
 class Messenger;
-class RequestTracker;
 }
 
 using pb_util::SecureDebugString;
@@ -102,6 +104,10 @@ namespace client {
 
 namespace internal {
 
+// The initial size of the arena the InFlightOps of each batch are allocated
+// from, enough for a few dozen ops.
+static const size_t kInitialOpArenaSize = 4 * 1024;
+
 // About lock ordering in this file:
 // ------------------------------
 // The locks must be acquired in the following order:
@@ -209,6 +215,15 @@ struct InFlightOp {
   }
 };
 
+// Destroys the given ops, which were allocated from their batcher's arena.
+// The memory itself is only freed along with the batcher.
+static void DestroyInFlightOps(vector<InFlightOp*>* ops) {
+  for (InFlightOp* op : *ops) {
+    op->~InFlightOp();
+  }
+  ops->clear();
+}
+
 // A Write RPC which is in-flight to a tablet. Initially, the RPC is sent
 // to the leader replica, but it may be retried with another replica if the
 // leader fails.
@@ -236,6 +251,14 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   const WriteResponsePB& resp() const { return resp_; }
   const string& tablet_id() const { return tablet_id_; }
 
+  // Fills in 'req' to write 'ops' to the tablet 'tablet_id', and moves the
+  // ops to the kRequestSent state.
+  static void BuildRequest(KuduSession::ExternalConsistencyMode consistency_mode,
+                           const vector<InFlightOp*>& ops,
+                           const string& tablet_id,
+                           uint64_t propagated_timestamp,
+                           WriteRequestPB* req);
+
  protected:
   void Try(RemoteTabletServer* replica, const ResponseCallback& callback) override;
   RetriableRpcStatus AnalyzeResponse(const Status& rpc_cb_status) override;
@@ -255,50 +278,58 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   string tablet_id_;
 };
 
-WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
-                   const scoped_refptr<MetaCacheServerPicker>& replica_picker,
-                   const scoped_refptr<RequestTracker>& request_tracker,
-                   vector<InFlightOp*> ops,
-                   const MonoTime& deadline,
-                   shared_ptr<Messenger> messenger,
-                   const string& tablet_id,
-                   uint64_t propagated_timestamp)
-    : RetriableRpc(replica_picker, request_tracker, deadline, std::move(messenger)),
-      batcher_(batcher),
-      ops_(std::move(ops)),
-      tablet_id_(tablet_id) {
-  const Schema* schema = table()->schema().schema_;
-
-  req_.set_tablet_id(tablet_id_);
-  switch (batcher->external_consistency_mode()) {
+void WriteRpc::BuildRequest(KuduSession::ExternalConsistencyMode consistency_mode,
+                            const vector<InFlightOp*>& ops,
+                            const string& tablet_id,
+                            uint64_t propagated_timestamp,
+                            WriteRequestPB* req) {
+  // All of the ops for a given tablet obviously correspond to the same table,
+  // so we'll just grab the table from the first.
+  const KuduTable* table = ops[0]->write_op->table();
+  const Schema* schema = table->schema().schema_;
+
+  req->set_tablet_id(tablet_id);
+  switch (consistency_mode) {
     case kudu::client::KuduSession::CLIENT_PROPAGATED:
-      req_.set_external_consistency_mode(kudu::CLIENT_PROPAGATED);
+      req->set_external_consistency_mode(kudu::CLIENT_PROPAGATED);
       break;
     case kudu::client::KuduSession::COMMIT_WAIT:
-      req_.set_external_consistency_mode(kudu::COMMIT_WAIT);
+      req->set_external_consistency_mode(kudu::COMMIT_WAIT);
       break;
     default:
-      LOG(FATAL) << "Unsupported consistency mode: " << batcher->external_consistency_mode();
+      LOG(FATAL) << "Unsupported consistency mode: " << consistency_mode;
 
   }
   // If set, propagate the latest observed timestamp.
   if (PREDICT_TRUE(propagated_timestamp != KuduClient::kNoTimestamp)) {
-    req_.set_propagated_timestamp(propagated_timestamp);
+    req->set_propagated_timestamp(propagated_timestamp);
   }
 
   // Set up schema
-  CHECK_OK(SchemaToPB(*schema, req_.mutable_schema(),
+  CHECK_OK(SchemaToPB(*schema, req->mutable_schema(),
                       SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
 
-  RowOperationsPB* requested = req_.mutable_row_operations();
+  RowOperationsPB* requested = req->mutable_row_operations();
+
+  // Reserve room for all of the rows up front, so that encoding them doesn't
+  // repeatedly grow the buffer. The sizes of the ops in the session buffer
+  // bound the size of their encoded rows, and the encoder transiently needs
+  // room for the largest possible row past the end.
+  int64_t rows_size = 1 + schema->byte_size() +
+      2 * ContiguousRowHelper::null_bitmap_size(*schema) +
+      BitmapSize(schema->num_columns());
+  for (const InFlightOp* op : ops) {
+    rows_size += op->write_op->SizeInBuffer();
+  }
+  requested->mutable_rows()->reserve(rows_size);
 
   // Add the rows
   int ctr = 0;
   RowOperationsPBEncoder enc(requested);
-  for (InFlightOp* op : ops_) {
+  for (InFlightOp* op : ops) {
 #ifndef NDEBUG
     const Partition& partition = op->tablet->partition();
-    const PartitionSchema& partition_schema = table()->partition_schema();
+    const PartitionSchema& partition_schema = table->partition_schema();
     const KuduPartialRow& row = op->write_op->row();
     bool partition_contains_row;
     CHECK(partition_schema.PartitionContainsRow(partition, row, &partition_contains_row).ok());
@@ -318,12 +349,28 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
   }
 
   if (VLOG_IS_ON(3)) {
-    VLOG(3) << "Created batch for " << tablet_id << ":\n" << SecureShortDebugString(req_);
+    VLOG(3) << "Created batch for " << tablet_id << ":\n" << SecureShortDebugString(*req);
   }
 }
 
+WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
+                   const scoped_refptr<MetaCacheServerPicker>& replica_picker,
+                   const scoped_refptr<RequestTracker>& request_tracker,
+                   vector<InFlightOp*> ops,
+                   const MonoTime& deadline,
+                   shared_ptr<Messenger> messenger,
+                   const string& tablet_id,
+                   uint64_t propagated_timestamp)
+    : RetriableRpc(replica_picker, request_tracker, deadline, std::move(messenger)),
+      batcher_(batcher),
+      ops_(std::move(ops)),
+      tablet_id_(tablet_id) {
+  BuildRequest(batcher->external_consistency_mode(), ops_, tablet_id_,
+               propagated_timestamp, &req_);
+}
+
 WriteRpc::~WriteRpc() {
-  STLDeleteElements(&ops_);
+  DestroyInFlightOps(&ops_);
 }
 
 string WriteRpc::ToString() const {
@@ -347,7 +394,7 @@ void WriteRpc::Finish(const Status& status) {
                    ops_.size(), tablet_id_, num_attempts()));
     KLOG_EVERY_N_SECS(WARNING, 1) << final_status.ToString();
   }
-  batcher_->ProcessWriteResponse(*this, final_status);
+  batcher_->ProcessWriteResponse(ops_, tablet_id_, resp_, final_status);
 }
 
 RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
@@ -452,6 +499,121 @@ bool WriteRpc::GetNewAuthnTokenAndRetry() {
   return true;
 }
 
+// A write RPC carrying the ops of several tablets whose leader replicas are
+// hosted by the same tablet server. See KuduSession::SetMultiTabletWritesEnabled().
+//
+// The RPC is sent only once: the ops of every tablet whose write fails, or
+// all of them if the RPC itself fails, are resent with a WriteRpc per tablet,
+// which takes care of retries and of finding new leaders.
+//
+// Keeps a reference on the owning batcher while alive.
+class MultiTabletWriteRpc {
+ public:
+  MultiTabletWriteRpc(const scoped_refptr<Batcher>& batcher,
+                      RemoteTabletServer* ts,
+                      vector<pair<RemoteTablet*, vector<InFlightOp*>>> tablet_ops,
+                      const MonoTime& deadline,
+                      uint64_t propagated_timestamp);
+  ~MultiTabletWriteRpc();
+
+  // Sends the RPC. The RPC deletes itself once its response is handled.
+  void SendRpc();
+
+ private:
+  void SendRpcCb();
+
+  // Pointer back to the batcher. Processes the write responses when the RPC
+  // completes.
+  scoped_refptr<Batcher> batcher_;
+
+  RemoteTabletServer* const ts_;
+
+  // The tablets written to, along with their ops, in the order of the writes
+  // in 'req_'. The ops are in kRequestSent state.
+  vector<pair<RemoteTablet*, vector<InFlightOp*>>> tablet_ops_;
+
+  // The sequence number of each write, with which the server tracks it for
+  // exactly-once semantics. The write RPC resending a failed write takes over
+  // its sequence number, so the write isn't applied twice.
+  const scoped_refptr<RequestTracker> request_tracker_;
+  vector<RequestTracker::SequenceNumber> seq_nos_;
+
+  tserver::MultiTabletWriteRequestPB req_;
+  tserver::MultiTabletWriteResponsePB resp_;
+  RpcController controller_;
+};
+
+MultiTabletWriteRpc::MultiTabletWriteRpc(
+    const scoped_refptr<Batcher>& batcher,
+    RemoteTabletServer* ts,
+    vector<pair<RemoteTablet*, vector<InFlightOp*>>> tablet_ops,
+    const MonoTime& deadline,
+    uint64_t propagated_timestamp)
+    : batcher_(batcher),
+      ts_(ts),
+      tablet_ops_(std::move(tablet_ops)),
+      request_tracker_(batcher->client_->data_->request_tracker_) {
+  for (const auto& e : tablet_ops_) {
+    WriteRpc::BuildRequest(batcher->external_consistency_mode(), e.second,
+                           e.first->tablet_id(), propagated_timestamp, req_.add_writes());
+    RequestTracker::SequenceNumber seq_no;
+    CHECK_OK(request_tracker_->NewSeqNo(&seq_no));
+    seq_nos_.push_back(seq_no);
+  }
+  for (RequestTracker::SequenceNumber seq_no : seq_nos_) {
+    rpc::RequestIdPB* request_id = req_.add_request_ids();
+    request_id->set_client_id(request_tracker_->client_id());
+    request_id->set_seq_no(seq_no);
+    request_id->set_first_incomplete_seq_no(request_tracker_->FirstIncomplete());
+    request_id->set_attempt_no(0);
+  }
+  controller_.set_deadline(deadline);
+  controller_.RequireServerFeature(tserver::TabletServerFeatures::MULTI_TABLET_WRITE);
+}
+
+MultiTabletWriteRpc::~MultiTabletWriteRpc() {
+  for (auto& e : tablet_ops_) {
+    DestroyInFlightOps(&e.second);
+  }
+}
+
+void MultiTabletWriteRpc::SendRpc() {
+  VLOG(2) << "Writing batches for " << tablet_ops_.size() << " tablets to "
+          << ts_->ToString();
+  ts_->proxy()->MultiTabletWriteAsync(req_, &resp_, &controller_,
+                                      boost::bind(&MultiTabletWriteRpc::SendRpcCb, this));
+}
+
+void MultiTabletWriteRpc::SendRpcCb() {
+  unique_ptr<MultiTabletWriteRpc> this_instance(this);
+  const Status& s = controller_.status();
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 1) << Substitute(
+        "Failed to write batches for $0 tablets to $1, writing them separately: $2",
+        tablet_ops_.size(), ts_->ToString(), s.ToString());
+  }
+  for (int i = 0; i < tablet_ops_.size(); i++) {
+    RemoteTablet* tablet = tablet_ops_[i].first;
+    vector<InFlightOp*>* ops = &tablet_ops_[i].second;
+    const bool has_response = s.ok() && i < resp_.responses_size();
+    if (has_response && !resp_.responses(i).has_error()) {
+      request_tracker_->RpcCompleted(seq_nos_[i]);
+      batcher_->ProcessWriteResponse(*ops, tablet->tablet_id(), resp_.responses(i),
+                                     Status::OK());
+      DestroyInFlightOps(ops);
+    } else {
+      if (has_response) {
+        VLOG(2) << "Failed to write batch to tablet " << tablet->tablet_id()
+                << ", writing it separately: "
+                << SecureShortDebugString(resp_.responses(i).error());
+      }
+      // The WriteRpc takes ownership of the ops and of the sequence number.
+      batcher_->FlushBuffer(tablet, *ops, seq_nos_[i]);
+      ops->clear();
+    }
+  }
+}
+
 Batcher::Batcher(KuduClient* client,
                  scoped_refptr<ErrorCollector> error_collector,
                  sp::weak_ptr<KuduSession> session,
@@ -465,8 +627,10 @@ Batcher::Batcher(KuduClient* client,
     flush_callback_(nullptr),
     next_op_sequence_number_(0),
     timeout_(client->default_rpc_timeout()),
+    multi_tablet_writes_enabled_(false),
     outstanding_lookups_(0),
-    buffer_bytes_used_(0) {
+    buffer_bytes_used_(0),
+    op_arena_(kInitialOpArenaSize) {
 }
 
 void Batcher::Abort() {
@@ -508,6 +672,11 @@ void Batcher::SetTimeout(const MonoDelta& timeout) {
   timeout_ = timeout;
 }
 
+void Batcher::SetMultiTabletWritesEnabled(bool enabled) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  multi_tablet_writes_enabled_ = enabled;
+}
+
 
 bool Batcher::HasPendingOperations() const {
   std::lock_guard<simple_spinlock> l(lock_);
@@ -582,13 +751,15 @@ void Batcher::FlushAsync(KuduStatusCallback* cb) {
 Status Batcher::Add(KuduWriteOperation* write_op) {
   // As soon as we get the op, start looking up where it belongs,
   // so that when the user calls Flush, we are ready to go.
-  gscoped_ptr<InFlightOp> op(new InFlightOp());
   string partition_key;
   RETURN_NOT_OK(write_op->table_->partition_schema().EncodeKey(write_op->row(), &partition_key));
+  // The batch's ops are allocated from its arena rather than individually,
+  // since at high write rates the allocations are a significant cost.
+  InFlightOp* op = op_arena_.NewObject<InFlightOp>();
   op->write_op.reset(write_op);
   op->state = InFlightOp::kLookingUpTablet;
 
-  AddInFlightOp(op.get());
+  AddInFlightOp(op);
   VLOG(3) << "Looking up tablet for " << op->ToString();
   // Increment our reference count for the outstanding callback.
   //
@@ -602,8 +773,7 @@ Status Batcher::Add(KuduWriteOperation* write_op) {
       deadline,
       MetaCache::LookupType::kPoint,
       &op->tablet,
-      Bind(&Batcher::TabletLookupFinished, this, op.get()));
-  IgnoreResult(op.release());
+      Bind(&Batcher::TabletLookupFinished, this, op));
 
   buffer_bytes_used_.IncrementBy(write_op->SizeInBuffer());
 
@@ -643,7 +813,7 @@ void Batcher::MarkInFlightOpFailedUnlocked(InFlightOp* op, const Status& s) {
     << "Could not remove op " << op->ToString() << " from in-flight list";
   error_collector_->AddError(unique_ptr<KuduError>(new KuduError(op->write_op.release(), s)));
   had_errors_ = true;
-  delete op;
+  op->~InFlightOp();
 }
 
 void Batcher::TabletLookupFinished(InFlightOp* op, const Status& s) {
@@ -717,6 +887,7 @@ void Batcher::TabletLookupFinished(InFlightOp* op, const Status& s) {
 
 void Batcher::FlushBuffersIfReady() {
   unordered_map<RemoteTablet*, vector<InFlightOp*> > ops_copy;
+  bool multi_tablet_writes_enabled;
 
   // We're only ready to flush if:
   // 1. The batcher is in the flushing state (i.e. FlushAsync was called).
@@ -736,9 +907,42 @@ void Batcher::FlushBuffersIfReady() {
     }
     // Take ownership of the ops while we're under the lock.
     ops_copy.swap(per_tablet_ops_);
+    multi_tablet_writes_enabled = multi_tablet_writes_enabled_;
   }
 
-  // Now flush the ops for each tablet.
+  // Group the tablets by the tablet server hosting their leader, if known, to
+  // write to several tablets of a server with a single RPC. Only servers to
+  // which there is a proxy already are considered, to avoid waiting for the
+  // proxy's DNS resolution here.
+  unordered_map<RemoteTabletServer*, vector<pair<RemoteTablet*, vector<InFlightOp*>>>> per_ts_ops;
+  if (multi_tablet_writes_enabled) {
+    for (auto it = ops_copy.begin(); it != ops_copy.end();) {
+      RemoteTabletServer* leader = it->first->LeaderTServer();
+      if (leader && leader->HasProxy()) {
+        per_ts_ops[leader].emplace_back(it->first, std::move(it->second));
+        it = ops_copy.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  for (auto& e : per_ts_ops) {
+    auto& tablet_ops = e.second;
+    if (tablet_ops.size() == 1) {
+      ops_copy.emplace(tablet_ops[0].first, std::move(tablet_ops[0].second));
+      continue;
+    }
+    VLOG(3) << "FlushBuffersIfReady: already in flushing state, immediately flushing "
+            << tablet_ops.size() << " tablets to " << e.first->ToString();
+    // The RPC object takes ownership of the ops; it's freed when its callback
+    // completes.
+    MultiTabletWriteRpc* rpc = new MultiTabletWriteRpc(
+        this, e.first, std::move(tablet_ops), deadline_,
+        client_->data_->GetLatestObservedTimestamp());
+    rpc->SendRpc();
+  }
+
+  // Now flush the ops for each remaining tablet.
   for (const OpsMap::value_type& e : ops_copy) {
     RemoteTablet* tablet = e.first;
     const vector<InFlightOp*>& ops = e.second;
@@ -749,7 +953,8 @@ void Batcher::FlushBuffersIfReady() {
   }
 }
 
-void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops) {
+void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops,
+                          RequestTracker::SequenceNumber seq_no) {
   CHECK(!ops.empty());
 
   // Create and send an RPC that aggregates the ops. The RPC is freed when
@@ -772,10 +977,15 @@ void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops)
                                client_->data_->messenger_,
                                tablet->tablet_id(),
                                client_->data_->GetLatestObservedTimestamp());
+  if (seq_no != RequestTracker::kNoSeqNo) {
+    rpc->AdoptSequenceNumber(seq_no);
+  }
   rpc->SendRpc();
 }
 
-void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
+void Batcher::ProcessWriteResponse(const vector<InFlightOp*>& ops,
+                                   const string& tablet_id,
+                                   const WriteResponsePB& resp,
                                    const Status& s) {
   // TODO: there is a potential race here -- if the Batcher gets destructed while
   // RPCs are in-flight, then accessing state_ will crash. We probably need to keep
@@ -784,12 +994,12 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   CHECK_EQ(state_, kFlushing);
 
   if (s.ok()) {
-    if (rpc.resp().has_timestamp()) {
-      client_->data_->UpdateLatestObservedTimestamp(rpc.resp().timestamp());
+    if (resp.has_timestamp()) {
+      client_->data_->UpdateLatestObservedTimestamp(resp.timestamp());
     }
   } else {
     // Mark each of the rows in the write op as failed, since the whole RPC failed.
-    for (InFlightOp* op : rpc.ops()) {
+    for (InFlightOp* op : ops) {
       unique_ptr<KuduError> error(new KuduError(op->write_op.release(), s));
       error_collector_->AddError(std::move(error));
     }
@@ -798,19 +1008,19 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   }
 
   // Check individual row errors.
-  for (const WriteResponsePB_PerRowErrorPB& err_pb : rpc.resp().per_row_errors()) {
+  for (const WriteResponsePB_PerRowErrorPB& err_pb : resp.per_row_errors()) {
     // TODO(todd): handle case where we get one of the more specific TS errors
     // like the tablet not being hosted?
 
-    if (err_pb.row_index() >= rpc.ops().size()) {
+    if (err_pb.row_index() >= ops.size()) {
       LOG(ERROR) << "Received a per_row_error for an out-of-bound op index "
                  << err_pb.row_index() << " (sent only "
-                 << rpc.ops().size() << " ops)";
-      LOG(ERROR) << "Response from tablet " << rpc.tablet_id() << ":\n"
-                 << SecureDebugString(rpc.resp());
+                 << ops.size() << " ops)";
+      LOG(ERROR) << "Response from tablet " << tablet_id << ":\n"
+                 << SecureDebugString(resp);
       continue;
     }
-    gscoped_ptr<KuduWriteOperation> op = std::move(rpc.ops()[err_pb.row_index()]->write_op);
+    gscoped_ptr<KuduWriteOperation> op = std::move(ops[err_pb.row_index()]->write_op);
     VLOG(2) << "Error on op " << op->ToString() << ": "
             << SecureShortDebugString(err_pb.error());
     Status op_status = StatusFromPB(err_pb.error());
@@ -840,7 +1050,7 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   //     from which the Flush() is being called.
   {
     std::lock_guard<simple_spinlock> l(lock_);
-    for (InFlightOp* op : rpc.ops()) {
+    for (InFlightOp* op : ops) {
       CHECK_EQ(1, ops_.erase(op))
             << "Could not remove op " << op->ToString()
             << " from in-flight list";
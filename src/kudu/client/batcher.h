@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -30,12 +31,19 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/rpc/request_tracker.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+namespace tserver {
+class WriteResponsePB;
+} // namespace tserver
+
 namespace client {
 
 class KuduStatusCallback;
@@ -45,6 +53,7 @@ namespace internal {
 struct InFlightOp;
 
 class ErrorCollector;
+class MultiTabletWriteRpc;
 class RemoteTablet;
 class WriteRpc;
 
@@ -83,6 +92,11 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // may time out before even sending an op). TODO: implement that
   void SetTimeout(const MonoDelta& timeout);
 
+  // Set whether the ops of several tablets whose leaders are hosted by the
+  // same tablet server may be written with a single RPC.
+  // See KuduSession::SetMultiTabletWritesEnabled().
+  void SetMultiTabletWritesEnabled(bool enabled);
+
   // Add a new operation to the batch. Requires that the batch has not yet been flushed.
   //
   // NOTE: If this returns not-OK, does not take ownership of 'write_op'.
@@ -131,6 +145,7 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
  private:
   friend class RefCountedThreadSafe<Batcher>;
+  friend class MultiTabletWriteRpc;
   friend class WriteRpc;
 
   ~Batcher();
@@ -148,7 +163,7 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // the flush callback will get a bad Status.
   void MarkHadErrors();
 
-  // Remove an op from the in-flight op list, and delete the op itself.
+  // Remove an op from the in-flight op list, and destroy the op itself.
   // The operation is reported to the ErrorReporter as having failed with the
   // given status.
   void MarkInFlightOpFailed(InFlightOp* op, const Status& s);
@@ -156,11 +171,17 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
   void CheckForFinishedFlush();
   void FlushBuffersIfReady();
-  void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
-
-  // Cleans up an RPC response, scooping out any errors and passing them up
-  // to the batcher.
-  void ProcessWriteResponse(const WriteRpc& rpc, const Status& s);
+  // Sends 'ops' to 'tablet' with a write RPC. If 'seq_no' is set, the RPC
+  // resends a write first sent under that sequence number.
+  void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops,
+                   rpc::RequestTracker::SequenceNumber seq_no = rpc::RequestTracker::kNoSeqNo);
+
+  // Cleans up the response to the write of 'ops' to the tablet 'tablet_id',
+  // scooping out any errors and passing them up to the batcher.
+  void ProcessWriteResponse(const std::vector<InFlightOp*>& ops,
+                            const std::string& tablet_id,
+                            const tserver::WriteResponsePB& resp,
+                            const Status& s);
 
   // Async Callbacks.
   void TabletLookupFinished(InFlightOp* op, const Status& s);
@@ -219,6 +240,9 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // Set by SetTimeout().
   MonoDelta timeout_;
 
+  // Set by SetMultiTabletWritesEnabled().
+  bool multi_tablet_writes_enabled_;
+
   // After flushing, the absolute deadline for all in-flight ops.
   MonoTime deadline_;
 
@@ -230,6 +254,11 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // The number of bytes used in the buffer for pending operations.
   AtomicInt<int64_t> buffer_bytes_used_;
 
+  // The arena the InFlightOps of the batch are allocated from. Only used by
+  // Add(), which isn't called concurrently since sessions aren't thread-safe.
+  // The ops are destroyed in place once they're done with.
+  Arena op_arena_;
+
   DISALLOW_COPY_AND_ASSIGN(Batcher);
 };
 
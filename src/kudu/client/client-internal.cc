@@ -61,6 +61,7 @@
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/thread_restrictions.h"
 
 using std::pair;
@@ -347,7 +348,8 @@ Status KuduClient::Data::SyncLeaderMasterRpc(
     vector<uint32_t> required_feature_flags);
 
 KuduClient::Data::Data()
-    : hive_metastore_sasl_enabled_(false),
+    : prefetch_tablet_locations_(false),
+      hive_metastore_sasl_enabled_(false),
       latest_observed_timestamp_(KuduClient::kNoTimestamp) {
 }
 
@@ -359,6 +361,9 @@ KuduClient::Data::~Data() {
   // fix urgently, because typically once a client is shutting down, latency
   // jitter on the reactor is not a big deal (and DNS resolutions are not in flight).
   ThreadRestrictions::ScopedAllowWait allow_wait;
+  if (scan_pool_) {
+    scan_pool_->Shutdown();
+  }
   dns_resolver_.reset();
 }
 
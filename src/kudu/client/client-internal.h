@@ -51,6 +51,7 @@ namespace kudu {
 class DnsResolver;
 class PartitionSchema;
 class Sockaddr;
+class ThreadPool;
 
 namespace master {
 class AlterTableRequestPB;
@@ -253,6 +254,11 @@ class KuduClient::Data {
 
   std::shared_ptr<rpc::Messenger> messenger_;
   gscoped_ptr<DnsResolver> dns_resolver_;
+
+  // Runs the blocking parts of KuduScanner::NextBatchAsync(), such as
+  // opening the next tablet and retrying after errors, for all the client's
+  // scanners.
+  gscoped_ptr<ThreadPool> scan_pool_;
   scoped_refptr<internal::MetaCache> meta_cache_;
 
   // Set of hostnames and IPs on the local host.
@@ -263,6 +269,7 @@ class KuduClient::Data {
   std::vector<std::string> master_server_addrs_;
   MonoDelta default_admin_operation_timeout_;
   MonoDelta default_rpc_timeout_;
+  bool prefetch_tablet_locations_;
 
   // The host port of the leader master. This is set in
   // ConnectedToClusterCb, which is invoked as a callback by
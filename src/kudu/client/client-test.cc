@@ -45,6 +45,8 @@
 #include "kudu/client/client-test-util.h"
 #include "kudu/client/client.h"
 #include "kudu/client/client.pb.h"
+#include "kudu/client/columnar_scan_batch.h"
+#include "kudu/client/columnar_write_batch.h"
 #include "kudu/client/error_collector.h"
 #include "kudu/client/meta_cache.h"
 #include "kudu/client/resource_metrics.h"
@@ -95,6 +97,7 @@
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"  // IWYU pragma: keep
 #include "kudu/util/metrics.h"
@@ -139,6 +142,7 @@ METRIC_DECLARE_counter(rpcs_queue_overflow);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetMasterRegistration);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTableLocations);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTabletLocations);
+METRIC_DECLARE_histogram(handler_latency_kudu_tserver_TabletServerService_MultiTabletWrite);
 METRIC_DECLARE_histogram(handler_latency_kudu_tserver_TabletServerService_Scan);
 
 using std::bind;
@@ -417,7 +421,33 @@ class ClientTest : public KuduTest {
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_miss_bytes"));
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_hit_bytes"));
       ASSERT_GT(metrics["cfile_cache_miss_bytes"] + metrics["cfile_cache_hit_bytes"], 0);
+      ASSERT_GT(metrics["decode_nanos"], 0);
+      ASSERT_GT(metrics["total_duration_nanos"], 0);
+      ASSERT_GT(metrics["queue_nanos"], 0);
+      ASSERT_GT(metrics["blocks_read"], 0);
+      ASSERT_GT(metrics["rows_scanned"], 0);
+      ASSERT_EQ(metrics["rows_scanned"], metrics["rows_returned"]);
+      ASSERT_EQ(0, metrics["delta_updates_applied"]);
+      ASSERT_FALSE(ContainsKey(metrics, "column.key.cells_read"));
     }
+
+    // The time spent reading each column is only reported on request.
+    KuduScanner column_scanner(client_table_.get());
+    ASSERT_OK(column_scanner.SetProjectedColumns({ "key", "int_val" }));
+    ASSERT_OK(column_scanner.SetReportColumnMetrics(true));
+    ASSERT_OK(column_scanner.Open());
+    KuduScanBatch batch;
+    while (column_scanner.HasMoreRows()) {
+      ASSERT_OK(column_scanner.NextBatch(&batch));
+    }
+    std::map<std::string, int64_t> metrics = column_scanner.GetResourceMetrics().Get();
+    for (const auto& col : { "key", "int_val" }) {
+      ASSERT_GT(metrics[Substitute("column.$0.cells_read", col)], 0);
+      ASSERT_GT(metrics[Substitute("column.$0.decode_nanos", col)], 0);
+    }
+    ASSERT_EQ(metrics["decode_nanos"],
+              metrics["column.key.decode_nanos"] + metrics["column.int_val.decode_nanos"]);
+    ASSERT_TRUE(column_scanner.SetReportColumnMetrics(false).IsIllegalState());
   }
 
   // Compares rows as obtained through a KuduScanBatch::RowPtr and through the
@@ -904,6 +934,36 @@ TEST_F(ClientTest, TestScan) {
   DoTestScanWithKeyPredicate();
 }
 
+// Test that the resource metrics of a scan profile the rows it filtered out
+// and the updates it applied from the delta stores.
+TEST_F(ClientTest, TestScanResourceProfile) {
+  const int kNumRows = 1000;
+  const int kNumUpdatedRows = 100;
+  NO_FATALS(InsertTestRows(client_table_.get(), kNumRows));
+  FlushTablet(GetFirstTabletId(client_table_.get()));
+  NO_FATALS(UpdateTestRows(client_table_.get(), 0, kNumUpdatedRows));
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumns({ "key", "int_val" }));
+  ASSERT_OK(scanner.AddConjunctPredicate(
+      client_table_->NewComparisonPredicate("int_val", KuduPredicate::LESS,
+                                            KuduValue::FromInt(kNumRows))));
+  ASSERT_OK(scanner.Open());
+  int64_t num_rows = 0;
+  KuduScanBatch batch;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    num_rows += batch.NumRows();
+  }
+  std::map<std::string, int64_t> metrics = scanner.GetResourceMetrics().Get();
+  ASSERT_EQ(kNumRows, metrics["rows_scanned"]);
+  ASSERT_EQ(num_rows, metrics["rows_returned"]);
+  ASSERT_LT(metrics["rows_returned"], metrics["rows_scanned"]);
+  ASSERT_EQ(kNumUpdatedRows, metrics["delta_updates_applied"]);
+  ASSERT_GT(metrics["blocks_read"], 0);
+  ASSERT_GT(metrics["queue_nanos"], 0);
+}
+
 TEST_F(ClientTest, TestScanAtSnapshot) {
   int half_the_rows = FLAGS_test_scan_num_rows / 2;
 
@@ -1144,6 +1204,489 @@ TEST_F(ClientTest, TestScanEmptyProjection) {
   }
 }
 
+TEST_F(ClientTest, TestScanWithAggregates) {
+  const int kNumRows = FLAGS_test_scan_num_rows;
+  ASSERT_GT(kNumRows, 10);
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumnNames({}));
+  ASSERT_OK(scanner.AddConjunctPredicate(client_table_->NewComparisonPredicate(
+      "key", KuduPredicate::GREATER_EQUAL, KuduValue::FromInt(10))));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::COUNT));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::SUM, "int_val"));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::MIN, "non_null_with_default"));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::MAX, "key"));
+  Status s = scanner.AddAggregate(KuduScanner::SUM, "string_val");
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = scanner.AddAggregate(KuduScanner::MIN);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  ASSERT_OK(scanner.Open());
+  KuduScanBatch batch;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    ASSERT_EQ(0, batch.NumRows());
+  }
+
+  int64_t val;
+  ASSERT_OK(scanner.GetAggregateInt64(0, &val));
+  ASSERT_EQ(kNumRows - 10, val);
+  ASSERT_OK(scanner.GetAggregateInt64(1, &val));
+  ASSERT_EQ(static_cast<int64_t>(kNumRows) * (kNumRows - 1) - 10 * 9, val);
+  ASSERT_OK(scanner.GetAggregateInt64(2, &val));
+  ASSERT_EQ(30, val);
+  ASSERT_OK(scanner.GetAggregateInt64(3, &val));
+  ASSERT_EQ(kNumRows - 1, val);
+
+  double double_val;
+  s = scanner.GetAggregateDouble(0, &double_val);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = scanner.GetAggregateInt64(4, &val);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(ClientTest, TestScanWithPrefetch) {
+  const int kNumRows = FLAGS_test_scan_num_rows;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  for (bool fault_tolerant : { false, true }) {
+    SCOPED_TRACE(fault_tolerant);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetPrefetchEnabled(true));
+    // Small batches so that each tablet takes several of them.
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    if (fault_tolerant) {
+      ASSERT_OK(scanner.SetFaultTolerant());
+    }
+    ASSERT_OK(scanner.Open());
+    Status s = scanner.SetPrefetchEnabled(false);
+    ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+    vector<bool> seen(kNumRows, false);
+    int num_rows = 0;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      for (const KuduScanBatch::RowPtr& row : batch) {
+        int32_t key;
+        ASSERT_OK(row.GetInt32(0, &key));
+        ASSERT_FALSE(seen[key]);
+        seen[key] = true;
+        num_rows++;
+      }
+    }
+    ASSERT_EQ(kNumRows, num_rows);
+  }
+
+  // Closing a scanner with a prefetch in flight waits for it.
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetPrefetchEnabled(true));
+  ASSERT_OK(scanner.SetBatchSizeBytes(100));
+  ASSERT_OK(scanner.Open());
+  KuduScanBatch batch;
+  ASSERT_OK(scanner.NextBatch(&batch));
+  ASSERT_OK(scanner.NextBatch(&batch));
+  scanner.Close();
+}
+
+// Test that adaptive batch sizing shrinks the batches of a scan which takes
+// longer than the target per batch, grows those of a scan which is faster,
+// and never requests more than the tablet servers' maximum.
+TEST_F(ClientTest, TestScanWithAdaptiveBatchSizing) {
+  const int kNumRows = 20000;
+  const uint32_t kInitialBatchSizeBytes = 64 * 1024;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  // Scans all rows of the table with the given target time per batch and
+  // returns the batch size the scanner ended up with.
+  auto scan = [&](int target_batch_time_ms, uint32_t* batch_size_bytes) {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(kInitialBatchSizeBytes));
+    ASSERT_OK(scanner.SetAdaptiveBatchSizing(target_batch_time_ms));
+    ASSERT_OK(scanner.Open());
+    Status s = scanner.SetAdaptiveBatchSizing(0);
+    ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+    int num_rows = 0;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      num_rows += batch.NumRows();
+    }
+    ASSERT_EQ(kNumRows, num_rows);
+    *batch_size_bytes = scanner.data_->batch_sizer_.batch_size_bytes();
+  };
+
+  KuduScanner scanner(client_table_.get());
+  Status s = scanner.SetAdaptiveBatchSizing(-1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  uint32_t batch_size_bytes;
+  {
+    google::FlagSaver saver;
+    FLAGS_scanner_inject_latency_on_each_batch_ms = 20;
+    NO_FATALS(scan(1, &batch_size_bytes));
+    ASSERT_LT(batch_size_bytes, kInitialBatchSizeBytes);
+  }
+  {
+    google::FlagSaver saver;
+    FLAGS_scanner_max_batch_size_bytes = 2 * kInitialBatchSizeBytes;
+    NO_FATALS(scan(60 * 1000, &batch_size_bytes));
+    ASSERT_EQ(2 * kInitialBatchSizeBytes, batch_size_bytes);
+  }
+}
+
+// Drives a scan from the callbacks of KuduScanner::NextBatchAsync(), fetching
+// the next batch from the callback of the previous one.
+class AsyncScanDriver : public KuduStatusCallback {
+ public:
+  explicit AsyncScanDriver(KuduScanner* scanner)
+      : scanner_(scanner),
+        num_rows_(0),
+        done_(1) {
+  }
+
+  void Start() {
+    scanner_->NextBatchAsync(&batch_, this);
+  }
+
+  void Run(const Status& s) override {
+    if (!s.ok()) {
+      status_ = s;
+      done_.CountDown();
+      return;
+    }
+    num_rows_ += batch_.NumRows();
+    if (scanner_->HasMoreRows()) {
+      scanner_->NextBatchAsync(&batch_, this);
+      return;
+    }
+    done_.CountDown();
+  }
+
+  Status Wait(int* num_rows) {
+    done_.Wait();
+    *num_rows = num_rows_;
+    return status_;
+  }
+
+ private:
+  KuduScanner* scanner_;
+  KuduScanBatch batch_;
+  int num_rows_;
+  Status status_;
+  CountDownLatch done_;
+};
+
+TEST_F(ClientTest, TestScanAsync) {
+  const int kNumRows = 10000;
+  const int kNumScanners = 8;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  for (bool prefetch : { false, true }) {
+    SCOPED_TRACE(prefetch);
+    // Run several scans at once, all of them driven by the reactor threads.
+    vector<unique_ptr<KuduScanner>> scanners;
+    vector<unique_ptr<AsyncScanDriver>> drivers;
+    for (int i = 0; i < kNumScanners; i++) {
+      scanners.emplace_back(new KuduScanner(client_table_.get()));
+      ASSERT_OK(scanners.back()->SetBatchSizeBytes(1024));
+      ASSERT_OK(scanners.back()->SetPrefetchEnabled(prefetch));
+      ASSERT_OK(scanners.back()->Open());
+      drivers.emplace_back(new AsyncScanDriver(scanners.back().get()));
+    }
+    for (const auto& driver : drivers) {
+      driver->Start();
+    }
+    for (const auto& driver : drivers) {
+      int num_rows;
+      ASSERT_OK(driver->Wait(&num_rows));
+      ASSERT_EQ(kNumRows, num_rows);
+    }
+  }
+
+  // Scanners which scan several tablets at once don't support it.
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetTabletParallelism(2, false));
+  ASSERT_OK(scanner.Open());
+  AsyncScanDriver driver(&scanner);
+  driver.Start();
+  int num_rows;
+  Status s = driver.Wait(&num_rows);
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+}
+
+TEST_F(ClientTest, TestScanTabletsConcurrently) {
+  const int kNumRows = FLAGS_test_scan_num_rows;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  for (bool preserve_tablet_order : { false, true }) {
+    SCOPED_TRACE(preserve_tablet_order);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetTabletParallelism(2, preserve_tablet_order));
+    // Small batches so that each tablet takes several of them.
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+    ASSERT_OK(scanner.Open());
+    Status s = scanner.SetTabletParallelism(1);
+    ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+    s = scanner.KeepAlive();
+    ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+
+    vector<bool> seen(kNumRows, false);
+    int num_rows = 0;
+    bool seen_second_tablet = false;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      for (const KuduScanBatch::RowPtr& row : batch) {
+        int32_t key;
+        ASSERT_OK(row.GetInt32(0, &key));
+        ASSERT_FALSE(seen[key]);
+        seen[key] = true;
+        num_rows++;
+        // The table is split at key 9.
+        if (preserve_tablet_order) {
+          ASSERT_FALSE(seen_second_tablet && key < 9) << key;
+        }
+        seen_second_tablet |= key >= 9;
+      }
+    }
+    ASSERT_EQ(kNumRows, num_rows);
+  }
+
+  // The columnar layout is supported too.
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetProjectedColumnNames({ "key" }));
+    ASSERT_OK(scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT));
+    ASSERT_OK(scanner.SetTabletParallelism(2));
+    ASSERT_OK(scanner.Open());
+    int num_rows = 0;
+    KuduColumnarScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      num_rows += batch.NumRows();
+    }
+    ASSERT_EQ(kNumRows, num_rows);
+  }
+
+  // Closing a scanner with workers blocked on full buffers joins them.
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetTabletParallelism(2));
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.Open());
+    KuduScanBatch batch;
+    ASSERT_OK(scanner.NextBatch(&batch));
+    scanner.Close();
+  }
+
+  // Row limits can't be applied across the tablets' scanners.
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetTabletParallelism(2));
+    ASSERT_OK(scanner.SetLimit(10));
+    Status s = scanner.Open();
+    ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+  }
+
+  KuduScanner scanner(client_table_.get());
+  Status s = scanner.SetTabletParallelism(0);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(ClientTest, TestColumnarScan) {
+  const int kNumRows = FLAGS_test_scan_num_rows;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumnNames({ "string_val", "key" }));
+  ASSERT_OK(scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT));
+  ASSERT_OK(scanner.Open());
+
+  KuduScanBatch row_batch;
+  Status s = scanner.NextBatch(&row_batch);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+  KuduColumnarScanBatch batch;
+  vector<bool> seen(kNumRows, false);
+  int num_rows = 0;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    Slice keys;
+    ASSERT_OK(batch.GetFixedLengthColumn(1, &keys));
+    ASSERT_EQ(batch.NumRows() * sizeof(int32_t), keys.size());
+    Slice offsets;
+    Slice strings;
+    ASSERT_OK(batch.GetVariableLengthColumn(0, &offsets, &strings));
+    ASSERT_EQ((batch.NumRows() + 1) * sizeof(uint32_t), offsets.size());
+    Slice non_null_bitmap;
+    ASSERT_OK(batch.GetNonNullBitmapForColumn(0, &non_null_bitmap));
+
+    s = batch.GetFixedLengthColumn(0, &keys);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    s = batch.GetNonNullBitmapForColumn(1, &non_null_bitmap);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    s = batch.GetFixedLengthColumn(2, &keys);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+    const int32_t* key_cells = reinterpret_cast<const int32_t*>(keys.data());
+    const uint32_t* string_offsets = reinterpret_cast<const uint32_t*>(offsets.data());
+    for (int i = 0; i < batch.NumRows(); i++) {
+      int32_t key = key_cells[i];
+      ASSERT_GE(key, 0);
+      ASSERT_LT(key, kNumRows);
+      ASSERT_FALSE(seen[key]);
+      seen[key] = true;
+      ASSERT_TRUE(BitmapTest(non_null_bitmap.data(), i));
+      Slice str(strings.data() + string_offsets[i],
+                string_offsets[i + 1] - string_offsets[i]);
+      ASSERT_EQ(StringPrintf("hello %d", key), str.ToString());
+    }
+    num_rows += batch.NumRows();
+  }
+  ASSERT_EQ(kNumRows, num_rows);
+
+  // The layout can't be combined with timestamp padding.
+  KuduScanner padded_scanner(client_table_.get());
+  s = padded_scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT |
+                                       KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(ClientTest, TestApplyColumnarBatch) {
+  const int kNumRows = 4;
+  const int32_t keys[] = { 0, 1, 2, 3 };
+  const int32_t int_vals[] = { 0, 10, 20, 30 };
+  const uint32_t string_offsets[] = { 0, 1, 1, 4, 4 };
+  const char strings[] = "accc";
+  const uint8_t string_non_null_bitmap[] = { 0x7 };
+
+  KuduColumnarWriteBatch batch(client_table_, KuduWriteOperation::INSERT, kNumRows);
+  ASSERT_EQ(kNumRows, batch.NumRows());
+  ASSERT_OK(batch.SetFixedLengthColumn(0, Slice(reinterpret_cast<const uint8_t*>(keys),
+                                                sizeof(keys))));
+  ASSERT_OK(batch.SetFixedLengthColumn(1, Slice(reinterpret_cast<const uint8_t*>(int_vals),
+                                                sizeof(int_vals))));
+  ASSERT_OK(batch.SetVariableLengthColumn(
+      2, Slice(reinterpret_cast<const uint8_t*>(string_offsets), sizeof(string_offsets)),
+      Slice(strings, 4)));
+  ASSERT_OK(batch.SetNonNullBitmapForColumn(2, Slice(string_non_null_bitmap, 1)));
+
+  // Malformed columns are rejected.
+  Status s = batch.SetFixedLengthColumn(2, Slice(strings, 4));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = batch.SetFixedLengthColumn(1, Slice(reinterpret_cast<const uint8_t*>(int_vals), 3));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = batch.SetVariableLengthColumn(
+      2, Slice(reinterpret_cast<const uint8_t*>(string_offsets), sizeof(string_offsets)),
+      Slice(strings, 3));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = batch.SetNonNullBitmapForColumn(0, Slice(string_non_null_bitmap, 1));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = batch.SetFixedLengthColumn(4, Slice());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  int num_applied;
+  ASSERT_OK(session->ApplyColumnarBatch(batch, &num_applied));
+  ASSERT_EQ(kNumRows, num_applied);
+  FlushSessionOrDie(session);
+
+  vector<string> rows;
+  ScanTableToStrings(client_table_.get(), &rows);
+  std::sort(rows.begin(), rows.end());
+  ASSERT_EQ(vector<string>({
+      R"((int32 key=0, int32 int_val=0, string string_val="a", )"
+      "int32 non_null_with_default=12345)",
+      R"((int32 key=1, int32 int_val=10, string string_val="", )"
+      "int32 non_null_with_default=12345)",
+      R"((int32 key=2, int32 int_val=20, string string_val="ccc", )"
+      "int32 non_null_with_default=12345)",
+      R"((int32 key=3, int32 int_val=30, string string_val=NULL, )"
+      "int32 non_null_with_default=12345)" }), rows);
+
+  // Applying the batch again fails on every row, since the keys exist.
+  ASSERT_OK(session->ApplyColumnarBatch(batch, &num_applied));
+  ASSERT_EQ(kNumRows, num_applied);
+  ASSERT_FALSE(session->Flush().ok());
+  vector<KuduError*> errors;
+  ElementDeleter d(&errors);
+  session->GetPendingErrors(&errors, nullptr);
+  ASSERT_EQ(kNumRows, errors.size());
+  for (const KuduError* error : errors) {
+    ASSERT_TRUE(error->status().IsAlreadyPresent()) << error->status().ToString();
+  }
+}
+
+TEST_F(ClientTest, TestColumnarScanWithDictionaryEncoding) {
+  const int kNumRows = FLAGS_test_scan_num_rows;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumnNames({ "string_val", "key" }));
+  ASSERT_OK(scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT |
+                                      KuduScanner::COLUMNAR_DICTIONARY_ENCODING));
+  // Keep the batches small, so that they're dictionary-encoded even though
+  // the strings don't repeat.
+  ASSERT_OK(scanner.SetBatchSizeBytes(1024));
+  ASSERT_OK(scanner.Open());
+
+  KuduColumnarScanBatch batch;
+  int num_rows = 0;
+  int num_dictionary_encoded_batches = 0;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    if (batch.NumRows() == 0) continue;
+    Slice keys;
+    ASSERT_OK(batch.GetFixedLengthColumn(1, &keys));
+    ASSERT_FALSE(batch.IsDictionaryEncodedColumn(1));
+    const int32_t* key_cells = reinterpret_cast<const int32_t*>(keys.data());
+
+    if (batch.IsDictionaryEncodedColumn(0)) {
+      num_dictionary_encoded_batches++;
+      Slice codes;
+      Slice dict_offsets;
+      Slice dict_data;
+      ASSERT_OK(batch.GetDictionaryEncodedColumn(0, &codes, &dict_offsets, &dict_data));
+      ASSERT_EQ(batch.NumRows() * sizeof(uint32_t), codes.size());
+      const uint32_t* code_cells = reinterpret_cast<const uint32_t*>(codes.data());
+      const uint32_t* entry_offsets = reinterpret_cast<const uint32_t*>(dict_offsets.data());
+      for (int i = 0; i < batch.NumRows(); i++) {
+        uint32_t code = code_cells[i];
+        ASSERT_LT(code, dict_offsets.size() / sizeof(uint32_t) - 1);
+        Slice str(dict_data.data() + entry_offsets[code],
+                  entry_offsets[code + 1] - entry_offsets[code]);
+        ASSERT_EQ(StringPrintf("hello %d", key_cells[i]), str.ToString());
+      }
+    }
+
+    // Whether dictionary-encoded or not, the column can be fetched as a
+    // plain variable-length column.
+    Slice offsets;
+    Slice strings;
+    ASSERT_OK(batch.GetVariableLengthColumn(0, &offsets, &strings));
+    ASSERT_EQ((batch.NumRows() + 1) * sizeof(uint32_t), offsets.size());
+    const uint32_t* string_offsets = reinterpret_cast<const uint32_t*>(offsets.data());
+    for (int i = 0; i < batch.NumRows(); i++) {
+      Slice str(strings.data() + string_offsets[i],
+                string_offsets[i + 1] - string_offsets[i]);
+      ASSERT_EQ(StringPrintf("hello %d", key_cells[i]), str.ToString());
+    }
+    num_rows += batch.NumRows();
+  }
+  ASSERT_EQ(kNumRows, num_rows);
+  ASSERT_GT(num_dictionary_encoded_batches, 0);
+
+  // Dictionary encoding requires the columnar layout.
+  KuduScanner row_scanner(client_table_.get());
+  Status s = row_scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_DICTIONARY_ENCODING);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 TEST_F(ClientTest, TestProjectInvalidColumn) {
   KuduScanner scanner(client_table_.get());
   Status s = scanner.SetProjectedColumns({ "column-doesnt-exist" });
@@ -1964,6 +2507,31 @@ TEST_F(ClientTest, TestMetaCacheExpiry) {
   ASSERT_FALSE(entry.stale());
 }
 
+// Test that a client built with prefetch_tablet_locations() caches the
+// locations of every tablet when opening a table, so that writes spanning all
+// the tablets don't need any further master lookups.
+TEST_F(ClientTest, TestPrefetchTabletLocations) {
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .prefetch_tablet_locations(true)
+      .Build(&client));
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client->OpenTable(kTableName, &table));
+
+  // Every tablet is in the cache, including the last one.
+  internal::MetaCacheEntry entry;
+  ASSERT_TRUE(client->data_->meta_cache_->LookupEntryByKeyFastPath(table.get(), "", &entry));
+  while (!entry.upper_bound_partition_key().empty()) {
+    ASSERT_TRUE(client->data_->meta_cache_->LookupEntryByKeyFastPath(
+        table.get(), entry.upper_bound_partition_key(), &entry));
+  }
+
+  int master_rpcs_before = CountMasterLookupRPCs();
+  NO_FATALS(InsertTestRows(client.get(), table.get(), FLAGS_test_scan_num_rows));
+  ASSERT_EQ(master_rpcs_before, CountMasterLookupRPCs());
+}
+
 TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   shared_ptr<KuduTable> table;
   ASSERT_NO_FATAL_FAILURE(CreateTable("blacklist",
@@ -2366,6 +2934,58 @@ TEST_F(ClientTest, TestInsertSingleRowManualBatch) {
   FlushSessionOrDie(session);
 }
 
+TEST_F(ClientTest, TestMultiTabletWrites) {
+  const string kTableName = "TestMultiTabletWrites";
+  const int kNumRowsPerFlush = 100;
+  unique_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+  ASSERT_OK(table_creator->table_name(kTableName)
+                          .schema(&schema_)
+                          .num_replicas(1)
+                          .add_hash_partitions({ "key" }, 8)
+                          .timeout(MonoDelta::FromSeconds(60))
+                          .Create());
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client_->OpenTable(kTableName, &table));
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  ASSERT_OK(session->SetMultiTabletWritesEnabled(true));
+
+  // The first flush writes to each tablet separately, since there is no proxy
+  // to the tablet servers yet. The second one combines the writes to the
+  // tablets of each tablet server.
+  for (int flush = 0; flush < 2; flush++) {
+    for (int i = 0; i < kNumRowsPerFlush; i++) {
+      ASSERT_OK(session->Apply(
+          BuildTestRow(table.get(), flush * kNumRowsPerFlush + i).release()));
+    }
+    FlushSessionOrDie(session);
+  }
+  ASSERT_EQ(2 * kNumRowsPerFlush, CountRowsFromClient(table.get()));
+
+  int64_t num_multi_tablet_writes = 0;
+  for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+    num_multi_tablet_writes +=
+        METRIC_handler_latency_kudu_tserver_TabletServerService_MultiTabletWrite.Instantiate(
+            cluster_->mini_tablet_server(i)->server()->metric_entity())->TotalCount();
+  }
+  ASSERT_GT(num_multi_tablet_writes, 0);
+
+  // Row errors in a combined write are reported like those of any other write.
+  ASSERT_OK(session->Apply(BuildTestRow(table.get(), 0).release()));
+  ASSERT_OK(session->Apply(BuildTestRow(table.get(), 2 * kNumRowsPerFlush).release()));
+
+  // The mode can't be changed while writes are buffered.
+  Status s = session->SetMultiTabletWritesEnabled(false);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+  s = session->Flush();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  unique_ptr<KuduError> error = GetSingleErrorFromSession(session.get());
+  ASSERT_TRUE(error->status().IsAlreadyPresent()) << error->status().ToString();
+  ASSERT_EQ(2 * kNumRowsPerFlush + 1, CountRowsFromClient(table.get()));
+}
+
 TEST_F(ClientTest, TestInsertAutoFlushSync) {
   shared_ptr<KuduSession> session = client_->NewSession();
   ASSERT_FALSE(session->HasPendingOperations());
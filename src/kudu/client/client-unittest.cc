@@ -29,6 +29,7 @@
 
 #include "kudu/client/client-internal.h"
 #include "kudu/client/error_collector.h"
+#include "kudu/client/scanner-internal.h"
 #include "kudu/client/schema.h"
 #include "kudu/client/value.h"
 #include "kudu/common/common.pb.h"
@@ -42,6 +43,7 @@
 using std::string;
 using std::vector;
 using strings::Substitute;
+using kudu::client::internal::AdaptiveBatchSizer;
 using kudu::client::internal::ErrorCollector;
 
 namespace kudu {
@@ -192,6 +194,50 @@ TEST(ClientUnitTest, TestRetryFunc) {
   ASSERT_LT(counter, 20);
 }
 
+TEST(ClientUnitTest, TestAdaptiveBatchSizer) {
+  const MonoDelta kTarget = MonoDelta::FromMilliseconds(100);
+  const uint32_t kMax = 8 * 1024 * 1024;
+  auto ms = [](int64_t millis) { return MonoDelta::FromMilliseconds(millis); };
+
+  AdaptiveBatchSizer sizer;
+  ASSERT_FALSE(sizer.enabled());
+  sizer.Enable(kTarget, 0);
+  ASSERT_TRUE(sizer.enabled());
+  ASSERT_EQ(AdaptiveBatchSizer::kDefaultBatchSizeBytes, sizer.batch_size_bytes());
+
+  // On target: the size is kept.
+  sizer.Enable(kTarget, 1024 * 1024);
+  sizer.RecordBatch(ms(60), ms(40), false, kMax);
+  ASSERT_EQ(1024 * 1024U, sizer.batch_size_bytes());
+
+  // Overlapped fetching and consuming only count the longer of the two.
+  sizer.RecordBatch(ms(60), ms(50), true, kMax);
+  ASSERT_GT(sizer.batch_size_bytes(), 1024 * 1024);
+
+  // Too slow: the size shrinks, by at most half per batch.
+  sizer.Enable(kTarget, 1024 * 1024);
+  sizer.RecordBatch(ms(150), ms(50), false, kMax);
+  ASSERT_EQ(512 * 1024U, sizer.batch_size_bytes());
+  sizer.RecordBatch(ms(10000), ms(0), false, kMax);
+  ASSERT_EQ(256 * 1024U, sizer.batch_size_bytes());
+  for (int i = 0; i < 10; i++) {
+    sizer.RecordBatch(ms(10000), ms(0), false, kMax);
+  }
+  ASSERT_EQ(AdaptiveBatchSizer::kMinBatchSizeBytes, sizer.batch_size_bytes());
+
+  // Too fast: the size grows, by at most double per batch, up to the
+  // server's maximum.
+  sizer.Enable(kTarget, 1024 * 1024);
+  sizer.RecordBatch(ms(0), ms(0), false, kMax);
+  ASSERT_EQ(2 * 1024 * 1024U, sizer.batch_size_bytes());
+  sizer.RecordBatch(ms(1), ms(1), false, 3 * 1024 * 1024);
+  ASSERT_EQ(3 * 1024 * 1024U, sizer.batch_size_bytes());
+
+  // A smaller server maximum caps the size right away.
+  sizer.RecordBatch(ms(60), ms(40), false, 1024 * 1024);
+  ASSERT_EQ(1024 * 1024U, sizer.batch_size_bytes());
+}
+
 TEST(ClientUnitTest, TestErrorCollector) {
   {
     scoped_refptr<ErrorCollector> ec(new ErrorCollector);
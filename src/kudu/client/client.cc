@@ -34,9 +34,13 @@
 #include "kudu/client/client-internal.h"
 #include "kudu/client/client.pb.h"
 #include "kudu/client/client_builder-internal.h"
+#include "kudu/client/columnar_scan_batch.h"
+#include "kudu/client/columnar_write_batch.h"
 #include "kudu/client/error-internal.h"
 #include "kudu/client/error_collector.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/multi_get-internal.h"
+#include "kudu/client/parallel_scanner.h"
 #include "kudu/client/partitioner-internal.h"
 #include "kudu/client/replica-internal.h"
 #include "kudu/client/row_result.h"
@@ -72,6 +76,7 @@
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
 #include "kudu/rpc/messenger.h"
@@ -95,6 +100,7 @@
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/version_info.h"
 
 using kudu::master::AlterTableRequestPB;
@@ -297,6 +303,11 @@ KuduClientBuilder& KuduClientBuilder::num_reactors(int num_reactors) {
   return *this;
 }
 
+KuduClientBuilder& KuduClientBuilder::prefetch_tablet_locations(bool prefetch) {
+  data_->prefetch_tablet_locations_ = prefetch;
+  return *this;
+}
+
 namespace {
 Status ImportAuthnCreds(const string& authn_creds,
                         Messenger* messenger,
@@ -356,6 +367,7 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
   c->data_->master_server_addrs_ = data_->master_server_addrs_;
   c->data_->default_admin_operation_timeout_ = data_->default_admin_operation_timeout_;
   c->data_->default_rpc_timeout_ = data_->default_rpc_timeout_;
+  c->data_->prefetch_tablet_locations_ = data_->prefetch_tablet_locations_;
 
   // Let's allow for plenty of time for discovering the master the first
   // time around.
@@ -365,6 +377,11 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
 
   c->data_->meta_cache_.reset(new MetaCache(c.get(), data_->replica_visibility_));
   c->data_->dns_resolver_.reset(new DnsResolver);
+  RETURN_NOT_OK_PREPEND(ThreadPoolBuilder("client-scan")
+                        .set_min_threads(0)
+                        .set_max_threads(base::NumCPUs())
+                        .Build(&c->data_->scan_pool_),
+                        "Could not create the scan thread pool");
 
   // Init local host names used for locality decisions.
   RETURN_NOT_OK_PREPEND(c->data_->InitLocalHostNames(),
@@ -530,6 +547,17 @@ Status KuduClient::OpenTable(const string& table_name,
   // current range partitions of a table for up to the ttl.
   data_->meta_cache_->ClearNonCoveredRangeEntries(table_id);
 
+  if (data_->prefetch_tablet_locations_) {
+    // Tablets whose locations are already cached are served by the fast
+    // path, so re-opening a table only costs master round trips for the
+    // tablets the cache has lost track of.
+    Status s = data_->meta_cache_->PrefetchTableLocations(table->get(), deadline);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 1) << "Unable to prefetch the tablet locations of table "
+                                    << table_name << ": " << s.ToString();
+    }
+  }
+
   return Status::OK();
 }
 
@@ -931,6 +959,20 @@ KuduPredicate* KuduTable::NewIsNullPredicate(const Slice& col_name) {
   });
 }
 
+KuduPredicate* KuduTable::NewPrefixPredicate(const Slice& col_name, const Slice& prefix) {
+  return data_->MakePredicate(col_name, [&](const ColumnSchema& col_schema) {
+    return new KuduPredicate(new StringMatchPredicateData(
+        col_schema, StringMatchPredicateData::MatchType::kPrefix, prefix.ToString()));
+  });
+}
+
+KuduPredicate* KuduTable::NewLikePredicate(const Slice& col_name, const Slice& pattern) {
+  return data_->MakePredicate(col_name, [&](const ColumnSchema& col_schema) {
+    return new KuduPredicate(new StringMatchPredicateData(
+        col_schema, StringMatchPredicateData::MatchType::kLike, pattern.ToString()));
+  });
+}
+
 // The strategy for retrieving the partitions from the metacache is adapted
 // from KuduScanTokenBuilder::Data::Build.
 Status KuduTable::ListPartitions(vector<Partition>* partitions) {
@@ -1029,6 +1071,10 @@ Status KuduSession::SetExternalConsistencyMode(ExternalConsistencyMode m) {
   return data_->SetExternalConsistencyMode(m);
 }
 
+Status KuduSession::SetMultiTabletWritesEnabled(bool enabled) {
+  return data_->SetMultiTabletWritesEnabled(enabled);
+}
+
 Status KuduSession::SetMutationBufferSpace(size_t size) {
   return data_->SetBufferBytesLimit(size);
 }
@@ -1073,6 +1119,26 @@ Status KuduSession::Apply(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
+Status KuduSession::ApplyColumnarBatch(const KuduColumnarWriteBatch& batch,
+                                       int* num_applied) {
+  if (num_applied) {
+    *num_applied = 0;
+  }
+  vector<KuduWriteOperation*> ops;
+  RETURN_NOT_OK(batch.NewOperations(&ops));
+  ElementDeleter deleter(&ops);
+  for (int i = 0; i < ops.size(); i++) {
+    // Apply() takes ownership of the op whether or not it succeeds.
+    KuduWriteOperation* op = ops[i];
+    ops[i] = nullptr;
+    RETURN_NOT_OK_PREPEND(Apply(op), Substitute("unable to apply the operation of row $0", i));
+    if (num_applied) {
+      (*num_applied)++;
+    }
+  }
+  return Status::OK();
+}
+
 int KuduSession::CountBufferedOperations() const {
   return data_->CountBufferedOperations();
 }
@@ -1293,6 +1359,41 @@ Status KuduScanner::SetBatchSizeBytes(uint32_t batch_size) {
   return data_->mutable_configuration()->SetBatchSizeBytes(batch_size);
 }
 
+Status KuduScanner::SetPrefetchEnabled(bool enabled) {
+  if (data_->open_) {
+    return Status::IllegalState("Prefetching must be set before Open()");
+  }
+  data_->prefetch_enabled_ = enabled;
+  return Status::OK();
+}
+
+Status KuduScanner::SetAdaptiveBatchSizing(int target_batch_time_ms) {
+  if (data_->open_) {
+    return Status::IllegalState("Adaptive batch sizing must be set before Open()");
+  }
+  if (target_batch_time_ms < 0) {
+    return Status::InvalidArgument(Substitute(
+        "invalid target batch time: $0 ms", target_batch_time_ms));
+  }
+  data_->target_batch_time_ = target_batch_time_ms == 0 ? MonoDelta() :
+      MonoDelta::FromMilliseconds(target_batch_time_ms);
+  return Status::OK();
+}
+
+Status KuduScanner::SetTabletParallelism(int max_concurrent_tablets,
+                                         bool preserve_tablet_order) {
+  if (data_->open_) {
+    return Status::IllegalState("Tablet parallelism must be set before Open()");
+  }
+  if (max_concurrent_tablets < 1) {
+    return Status::InvalidArgument(Substitute(
+        "invalid number of concurrent tablets: $0", max_concurrent_tablets));
+  }
+  data_->max_concurrent_tablets_ = max_concurrent_tablets;
+  data_->preserve_tablet_order_ = preserve_tablet_order;
+  return Status::OK();
+}
+
 Status KuduScanner::SetReadMode(ReadMode read_mode) {
   if (data_->open_) {
     return Status::IllegalState("Read mode must be set before Open()");
@@ -1402,6 +1503,8 @@ Status KuduScanner::SetRowFormatFlags(uint64_t flags) {
   switch (flags) {
     case NO_FLAGS:
     case PAD_UNIXTIME_MICROS_TO_16_BYTES:
+    case COLUMNAR_LAYOUT:
+    case COLUMNAR_LAYOUT | COLUMNAR_DICTIONARY_ENCODING:
       break;
     default:
       return Status::InvalidArgument(Substitute("Invalid row format flags: $0", flags));
@@ -1420,6 +1523,63 @@ Status KuduScanner::SetLimit(int64_t limit) {
   return data_->mutable_configuration()->SetLimit(limit);
 }
 
+Status KuduScanner::AddAggregate(AggregateFunction function, const string& col_name) {
+  if (data_->open_) {
+    return Status::IllegalState("Aggregates must be added before Open()");
+  }
+  return data_->mutable_configuration()->AddAggregate(function, col_name);
+}
+
+Status KuduScanner::SetTopN(const string& col_name, int64_t n, bool descending) {
+  if (data_->open_) {
+    return Status::IllegalState("Top-N must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetTopN(col_name, n, descending);
+}
+
+Status KuduScanner::SetDiffScan(uint64_t start_timestamp, uint64_t end_timestamp) {
+  if (data_->open_) {
+    return Status::IllegalState("Diff scan must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetDiffScan(start_timestamp, end_timestamp);
+}
+
+Status KuduScanner::SetReportColumnMetrics(bool report) {
+  if (data_->open_) {
+    return Status::IllegalState("Column metrics must be requested before Open()");
+  }
+  data_->mutable_configuration()->SetReportColumnMetrics(report);
+  return Status::OK();
+}
+
+Status KuduScanner::GetAggregateInt64(int idx, int64_t* val) const {
+  const tserver::AggregateResultPB* result;
+  RETURN_NOT_OK(data_->GetAggregateResult(idx, &result));
+  if (result->has_double_value() || data_->AggregateIsFloating(idx)) {
+    return Status::InvalidArgument(
+        Substitute("Aggregate $0 is not an integer", idx));
+  }
+  if (!result->has_int_value()) {
+    return Status::NotFound(Substitute("Aggregate $0 has no value", idx));
+  }
+  *val = result->int_value();
+  return Status::OK();
+}
+
+Status KuduScanner::GetAggregateDouble(int idx, double* val) const {
+  const tserver::AggregateResultPB* result;
+  RETURN_NOT_OK(data_->GetAggregateResult(idx, &result));
+  if (result->has_int_value() || !data_->AggregateIsFloating(idx)) {
+    return Status::InvalidArgument(
+        Substitute("Aggregate $0 is not a floating point value", idx));
+  }
+  if (!result->has_double_value()) {
+    return Status::NotFound(Substitute("Aggregate $0 has no value", idx));
+  }
+  *val = result->double_value();
+  return Status::OK();
+}
+
 const ResourceMetrics& KuduScanner::GetResourceMetrics() const {
   return data_->resource_metrics_;
 }
@@ -1453,6 +1613,7 @@ string KuduScanner::ToString() const {
 Status KuduScanner::Open() {
   CHECK(!data_->open_) << "Scanner already open";
 
+  data_->ResetAggregateResults();
   data_->mutable_configuration()->OptimizeScanSpec();
   data_->partition_pruner_.Init(*data_->table_->schema().schema_,
                                 data_->table_->partition_schema(),
@@ -1480,6 +1641,18 @@ Status KuduScanner::Open() {
                                    "for READ_AT_SNAPSHOT scan mode.");
   }
 
+  if (data_->target_batch_time_.Initialized()) {
+    data_->batch_sizer_.Enable(data_->target_batch_time_,
+                               data_->configuration().has_batch_size_bytes() ?
+                                   data_->configuration().batch_size_bytes() : 0);
+  }
+
+  if (data_->max_concurrent_tablets_ > 1) {
+    RETURN_NOT_OK(data_->OpenParallel());
+    data_->open_ = true;
+    return Status::OK();
+  }
+
   VLOG(2) << "Beginning " << data_->DebugString();
 
   MonoTime deadline = MonoTime::Now() + data_->configuration().timeout();
@@ -1500,11 +1673,20 @@ void KuduScanner::Close() {
 
   VLOG(2) << "Ending " << data_->DebugString();
 
+  if (data_->parallel_scanner_) {
+    data_->parallel_scanner_->Shutdown();
+    data_->open_ = false;
+    return;
+  }
+
   // Close the scanner on the server-side, if necessary.
   //
   // If the scan did not match any rows, the tserver will not assign a scanner ID.
   // This is reflected in the Open() response. In this case, there is no server-side state
   // to clean up.
+  // The scanner's requests must reach the server in sequence.
+  data_->DiscardPrefetch();
+
   if (!data_->next_req_.scanner_id().empty()) {
     CHECK(data_->proxy_);
     gscoped_ptr<CloseCallback> closer(new CloseCallback);
@@ -1523,6 +1705,9 @@ void KuduScanner::Close() {
 
 bool KuduScanner::HasMoreRows() const {
   CHECK(data_->open_);
+  if (data_->parallel_scanner_) {
+    return data_->parallel_scanner_->HasMoreRows();
+  }
   return !data_->short_circuit_ &&                 // The scan is not short circuited
       (data_->data_in_open_ ||                     // more data in hand
        data_->last_response_.has_more_results() || // more data in this tablet
@@ -1541,29 +1726,161 @@ Status KuduScanner::NextBatch(vector<KuduRowResult>* rows) {
 }
 
 Status KuduScanner::NextBatch(KuduScanBatch* batch) {
-  // TODO: do some double-buffering here -- when we return this batch
-  // we should already have fired off the RPC for the next batch, but
-  // need to do some swapping of the response objects around to avoid
-  // stomping on the memory the user is looking at.
+  if (PREDICT_FALSE(data_->configuration().row_format_flags() & COLUMNAR_LAYOUT)) {
+    return Status::IllegalState(
+        "Cannot fetch rows in row layout from a scanner with the COLUMNAR_LAYOUT flag");
+  }
+  if (data_->parallel_scanner_) {
+    CHECK(data_->open_);
+    unique_ptr<KuduScanBatch> next;
+    RETURN_NOT_OK(data_->parallel_scanner_->NextBatch(&next));
+    batch->data_->Clear();
+    if (next) {
+      std::swap(batch->data_, next->data_);
+    }
+    return Status::OK();
+  }
+  return NextBatchInternal(batch->data_);
+}
+
+Status KuduScanner::NextBatch(KuduColumnarScanBatch* batch) {
+  if (PREDICT_FALSE(!(data_->configuration().row_format_flags() & COLUMNAR_LAYOUT))) {
+    return Status::IllegalState(
+        "Cannot fetch rows in columnar layout from a scanner without the COLUMNAR_LAYOUT flag");
+  }
+  if (data_->parallel_scanner_) {
+    CHECK(data_->open_);
+    unique_ptr<KuduColumnarScanBatch> next;
+    RETURN_NOT_OK(data_->parallel_scanner_->NextBatch(&next));
+    batch->data_->Clear();
+    if (next) {
+      std::swap(batch->data_, next->data_);
+    }
+    return Status::OK();
+  }
+  return NextBatchInternal(batch->data_);
+}
+
+void KuduScanner::NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb) {
+  if (PREDICT_FALSE(data_->configuration().row_format_flags() & COLUMNAR_LAYOUT)) {
+    cb->Run(Status::IllegalState(
+        "Cannot fetch rows in row layout from a scanner with the COLUMNAR_LAYOUT flag"));
+    return;
+  }
+  NextBatchAsyncInternal(batch->data_, cb);
+}
+
+void KuduScanner::NextBatchAsync(KuduColumnarScanBatch* batch, KuduStatusCallback* cb) {
+  if (PREDICT_FALSE(!(data_->configuration().row_format_flags() & COLUMNAR_LAYOUT))) {
+    cb->Run(Status::IllegalState(
+        "Cannot fetch rows in columnar layout from a scanner without the COLUMNAR_LAYOUT flag"));
+    return;
+  }
+  NextBatchAsyncInternal(batch->data_, cb);
+}
+
+void KuduScanner::NextBatchAsyncInternal(internal::ScanBatchDataInterface* batch_data,
+                                         KuduStatusCallback* cb) {
+  CHECK(data_->open_);
+  if (data_->parallel_scanner_) {
+    cb->Run(Status::NotSupported("asynchronous batches are not supported when scanning "
+                                 "tablets concurrently"));
+    return;
+  }
+
+  // The batch is either at hand, or there is none left.
+  if (data_->short_circuit_ ||
+      data_->data_in_open_ ||
+      (!data_->last_response_.has_more_results() && !data_->MoreTablets())) {
+    cb->Run(NextBatchInternal(batch_data));
+    return;
+  }
+
+  ThreadPool* pool = data_->table_->client()->data_->scan_pool_.get();
+  if (!data_->last_response_.has_more_results()) {
+    // Opening the next tablet may look up its locations and retry on other
+    // replicas, so it's done on the scan pool. The first batch of the tablet
+    // usually arrives in the response opening it.
+    Status s = pool->SubmitFunc([this, batch_data, cb]() {
+      Status s = NextBatchInternal(batch_data);
+      if (s.ok() && data_->data_in_open_) {
+        s = NextBatchInternal(batch_data);
+      }
+      cb->Run(s);
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      cb->Run(s);
+    }
+    return;
+  }
+
+  // More data is available in this tablet. The continuation request is sent
+  // as a prefetch, unless one is already in flight, and its response handled
+  // on the reactor thread completing it.
+  VLOG(2) << "Continuing asynchronously " << data_->DebugString();
+  const MonoTime call_time = MonoTime::Now();
+  const MonoTime batch_deadline = call_time + data_->configuration().timeout();
+  const bool overlapped = data_->prefetch_in_flight_;
+  if (!overlapped) {
+    data_->StartPrefetch();
+  }
+  data_->OnPrefetchComplete([this, batch_data, cb, call_time, batch_deadline, overlapped]() {
+    ScanRpcStatus result = data_->TakePrefetchResponse(batch_deadline);
+    MonoDelta fetch_time = data_->prefetch_completed_time_ - data_->prefetch_sent_time_;
+    bool retry;
+    if (result.result == ScanRpcStatus::OK) {
+      cb->Run(data_->FinishContinue(result, fetch_time, overlapped, call_time,
+                                    batch_deadline, batch_data, &retry));
+      return;
+    }
+
+    // Handling the error may back off or reopen the tablet elsewhere, so it
+    // is done on the scan pool, from where the request is retried as
+    // NextBatch() would.
+    ThreadPool* pool = data_->table_->client()->data_->scan_pool_.get();
+    Status s = pool->SubmitFunc([this, batch_data, cb, call_time, batch_deadline,
+                                 result, fetch_time, overlapped]() {
+      bool retry;
+      Status s = data_->FinishContinue(result, fetch_time, overlapped, call_time,
+                                       batch_deadline, batch_data, &retry);
+      while (retry) {
+        const MonoTime rpc_start = MonoTime::Now();
+        ScanRpcStatus retry_result = data_->SendScanRpc(
+            batch_deadline, data_->configuration().is_fault_tolerant());
+        s = data_->FinishContinue(retry_result, MonoTime::Now() - rpc_start, false, call_time,
+                                  batch_deadline, batch_data, &retry);
+      }
+      cb->Run(s);
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      cb->Run(s);
+    }
+  });
+}
+
+Status KuduScanner::NextBatchInternal(internal::ScanBatchDataInterface* batch_data) {
   CHECK(data_->open_);
   CHECK(data_->proxy_);
 
-  batch->data_->Clear();
+  batch_data->Clear();
 
   if (data_->short_circuit_) {
     return Status::OK();
   }
 
+  const MonoTime call_time = MonoTime::Now();
   if (data_->data_in_open_) {
     // We have data from a previous scan.
     VLOG(2) << "Extracting data from " << data_->DebugString();
     data_->data_in_open_ = false;
-    return batch->data_->Reset(&data_->controller_,
-                               data_->configuration().projection(),
-                               data_->configuration().client_projection(),
-                               data_->configuration().row_format_flags(),
-                               unique_ptr<RowwiseRowBlockPB>(
-                                   data_->last_response_.release_data()));
+    RETURN_NOT_OK(batch_data->Reset(&data_->controller_,
+                                    data_->configuration().projection(),
+                                    data_->configuration().client_projection(),
+                                    data_->configuration().row_format_flags(),
+                                    &data_->last_response_));
+    data_->MaybeStartPrefetch();
+    data_->batch_returned_time_ = MonoTime::Now();
+    return Status::OK();
   }
 
   if (data_->last_response_.has_more_results()) {
@@ -1571,51 +1888,30 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     VLOG(2) << "Continuing " << data_->DebugString();
 
     MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
-    data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    // If the batch was prefetched, its request is already prepared and sent.
+    bool prefetched = data_->prefetch_in_flight_;
+    if (!prefetched) {
+      data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    }
 
     while (true) {
       bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
-      ScanRpcStatus result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
-
-      // Success case.
-      if (result.result == ScanRpcStatus::OK) {
-        if (data_->last_response_.has_last_primary_key()) {
-          data_->last_primary_key_ = data_->last_response_.last_primary_key();
-        }
-        data_->scan_attempts_ = 0;
-        return batch->data_->Reset(&data_->controller_,
-                                   data_->configuration().projection(),
-                                   data_->configuration().client_projection(),
-                                   data_->configuration().row_format_flags(),
-                                   unique_ptr<RowwiseRowBlockPB>(
-                                       data_->last_response_.release_data()));
-      }
-
-      data_->scan_attempts_++;
-
-      // Error handling.
-      set<string> blacklist;
-      bool needs_reopen = false;
-      Status s = data_->HandleError(result, batch_deadline, &blacklist, &needs_reopen);
-      if (!s.ok()) {
-        LOG(WARNING) << "Scan on tablet server " << data_->ts_->ToString() << " with "
-                     << data_->DebugString() << " failed: " << result.status.ToString();
+      const MonoTime rpc_start = MonoTime::Now();
+      ScanRpcStatus result = prefetched ?
+          data_->FinishPrefetch(batch_deadline) :
+          data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      MonoDelta fetch_time = prefetched ?
+          data_->prefetch_completed_time_ - data_->prefetch_sent_time_ :
+          MonoTime::Now() - rpc_start;
+      bool overlapped = prefetched;
+      prefetched = false;
+
+      bool retry;
+      Status s = data_->FinishContinue(result, fetch_time, overlapped, call_time,
+                                       batch_deadline, batch_data, &retry);
+      if (!retry) {
         return s;
       }
-
-      if (data_->configuration().is_fault_tolerant()) {
-        LOG(WARNING) << "Attempting to retry " << data_->DebugString()
-                     << " elsewhere.";
-        return data_->ReopenCurrentTablet(batch_deadline, &blacklist);
-      }
-
-      if (blacklist.empty() && !needs_reopen) {
-        // If we didn't blacklist the current server, we can just retry again.
-        continue;
-      }
-      // If we blacklisted the current server, and it's not fault-tolerant, we can't
-      // retry anywhere, so just propagate the error.
-      return result.status;
     }
   } else if (data_->MoreTablets()) {
     // More data may be available in other tablets.
@@ -1623,6 +1919,7 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     // server closed it for us.
     VLOG(2) << "Scanning next tablet " << data_->DebugString();
     data_->last_primary_key_.clear();
+    data_->batch_returned_time_ = MonoTime();
     MonoTime deadline = MonoTime::Now() + data_->configuration().timeout();
     set<string> blacklist;
 
@@ -1637,6 +1934,10 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
 
 Status KuduScanner::GetCurrentServer(KuduTabletServer** server) {
   CHECK(data_->open_);
+  if (data_->parallel_scanner_) {
+    return Status::NotSupported("there is no single current server when scanning tablets "
+                                "concurrently");
+  }
   internal::RemoteTabletServer* rts = data_->ts_;
   CHECK(rts);
   vector<HostPort> host_ports;
@@ -1754,6 +2055,11 @@ Status KuduScanTokenBuilder::SetCacheBlocks(bool cache_blocks) {
   return data_->mutable_configuration()->SetCacheBlocks(cache_blocks);
 }
 
+Status KuduScanTokenBuilder::SetSplitSizeBytes(uint64_t split_size_bytes) {
+  data_->set_split_size_bytes(split_size_bytes);
+  return Status::OK();
+}
+
 Status KuduScanTokenBuilder::Build(vector<KuduScanToken*>* tokens) {
   return data_->Build(tokens);
 }
@@ -1826,6 +2132,78 @@ const string& KuduTabletServer::location() const {
   return data_->location_;
 }
 
+////////////////////////////////////////////////////////////
+// KuduMultiGet
+////////////////////////////////////////////////////////////
+KuduMultiGet::KuduMultiGet(KuduTable* table)
+    : data_(new Data(table)) {
+}
+
+KuduMultiGet::~KuduMultiGet() {
+  delete data_;
+}
+
+Status KuduMultiGet::SetProjectedColumnNames(const vector<string>& col_names) {
+  if (data_->open_) {
+    return Status::IllegalState("Projection must be set before Open()");
+  }
+  return data_->configuration_.SetProjectedColumnNames(col_names);
+}
+
+Status KuduMultiGet::SetSelection(KuduClient::ReplicaSelection selection) {
+  if (data_->open_) {
+    return Status::IllegalState("Replica selection must be set before Open()");
+  }
+  return data_->configuration_.SetSelection(selection);
+}
+
+Status KuduMultiGet::SetTimeoutMillis(int millis) {
+  if (millis <= 0) {
+    return Status::InvalidArgument(Substitute("invalid timeout: $0 ms", millis));
+  }
+  data_->configuration_.SetTimeoutMillis(millis);
+  return Status::OK();
+}
+
+Status KuduMultiGet::AddKey(KuduPartialRow* key) {
+  unique_ptr<KuduPartialRow> k(key);
+  if (data_->open_) {
+    return Status::IllegalState("Keys must be added before Open()");
+  }
+  return data_->AddKey(*k);
+}
+
+Status KuduMultiGet::Open() {
+  if (data_->open_) {
+    return Status::IllegalState("MultiGet already open");
+  }
+  RETURN_NOT_OK(data_->Open());
+  data_->open_ = true;
+  return Status::OK();
+}
+
+bool KuduMultiGet::HasMoreRows() const {
+  CHECK(data_->open_);
+  return data_->HasMoreRows();
+}
+
+Status KuduMultiGet::NextBatch(KuduScanBatch* batch, vector<int>* key_indexes) {
+  CHECK(data_->open_);
+  batch->data_->Clear();
+  key_indexes->clear();
+  if (!data_->HasMoreRows()) {
+    return Status::OK();
+  }
+  RpcController controller;
+  tserver::MultiGetResponsePB resp;
+  RETURN_NOT_OK(data_->LookupNextTablet(&controller, &resp, key_indexes));
+  return batch->data_->Reset(&controller,
+                             data_->configuration_.projection(),
+                             data_->configuration_.client_projection(),
+                             KuduScanner::NO_FLAGS,
+                             resp.has_data() ? resp.mutable_data() : nullptr);
+}
+
 ////////////////////////////////////////////////////////////
 // KuduPartitionerBuilder
 ////////////////////////////////////////////////////////////
@@ -67,6 +67,8 @@ class LeaderMasterProxy;
 
 namespace client {
 
+class KuduColumnarScanBatch;
+class KuduColumnarWriteBatch;
 class KuduDelete;
 class KuduInsert;
 class KuduLoggingCallback;
@@ -90,9 +92,11 @@ class ErrorCollector;
 class GetTableSchemaRpc;
 class LookupRpc;
 class MetaCache;
+class ParallelScanner;
 class RemoteTablet;
 class RemoteTabletServer;
 class ReplicaController;
+class ScanBatchDataInterface;
 class WriteRpc;
 } // namespace internal
 
@@ -262,6 +266,20 @@ class KUDU_EXPORT KuduClientBuilder {
   /// @return Reference to the updated object.
   KuduClientBuilder& num_reactors(int num_reactors);
 
+  /// @brief Fetch the locations of all tablets of a table when opening it.
+  ///
+  /// By default, tablet locations are looked up lazily, a batch at a time,
+  /// as operations reach tablets which aren't in the client's cache yet. With
+  /// this option set, KuduClient::OpenTable() looks up the locations of all
+  /// the tablets of the table up front, so the first writes and scans of the
+  /// table don't wait on the master. A failure to prefetch the locations is
+  /// not an error: the locations are then looked up lazily as usual.
+  ///
+  /// @param [in] prefetch
+  ///   Whether to prefetch tablet locations when opening a table.
+  /// @return Reference to the updated object.
+  KuduClientBuilder& prefetch_tablet_locations(bool prefetch);
+
   /// Create a client object.
   ///
   /// @note KuduClients objects are shared amongst multiple threads and,
@@ -593,6 +611,7 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   friend class ClientTest;
   friend class ConnectToClusterBaseTest;
   friend class KuduClientBuilder;
+  friend class KuduMultiGet;
   friend class KuduPartitionerBuilder;
   friend class KuduScanToken;
   friend class KuduScanTokenBuilder;
@@ -618,6 +637,7 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   FRIEND_TEST(ClientTest, TestMasterLookupPermits);
   FRIEND_TEST(ClientTest, TestMetaCacheExpiry);
   FRIEND_TEST(ClientTest, TestNonCoveringRangePartitions);
+  FRIEND_TEST(ClientTest, TestPrefetchTabletLocations);
   FRIEND_TEST(ClientTest, TestReplicatedTabletWritesWithLeaderElection);
   FRIEND_TEST(ClientTest, TestScanFaultTolerance);
   FRIEND_TEST(ClientTest, TestScanTimeout);
@@ -1068,6 +1088,47 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   ///   to add this predicate to a KuduScanner.
   KuduPredicate* NewIsNullPredicate(const Slice& col_name);
 
+  /// Create a new prefix predicate which can be used for scanners on this
+  /// table.
+  ///
+  /// The prefix predicate matches the values of a STRING or BINARY column
+  /// which start with the given bytes. On a primary key column it narrows the
+  /// primary key range of the scan.
+  ///
+  /// @param [in] col_name
+  ///   Name of the column to which the predicate applies.
+  /// @param [in] prefix
+  ///   The prefix to match. It is copied.
+  /// @return Raw pointer to a prefix predicate. The caller owns the
+  ///   predicate until it is passed into KuduScanner::AddConjunctPredicate().
+  ///   In the case of an error (e.g. an invalid column name, or a column
+  ///   which isn't a STRING or BINARY column), a non-NULL value is still
+  ///   returned. The error will be returned when attempting to add this
+  ///   predicate to a KuduScanner.
+  KuduPredicate* NewPrefixPredicate(const Slice& col_name, const Slice& prefix);
+
+  /// Create a new LIKE predicate which can be used for scanners on this
+  /// table.
+  ///
+  /// The LIKE predicate matches the values of a STRING or BINARY column
+  /// against a SQL LIKE pattern, in which '%' matches any sequence of bytes,
+  /// '_' matches exactly one byte, and '\' escapes the byte which follows
+  /// it. A pattern which only has a trailing '%' is evaluated as a prefix
+  /// predicate. Scans using LIKE predicates require tablet servers which
+  /// support them.
+  ///
+  /// @param [in] col_name
+  ///   Name of the column to which the predicate applies.
+  /// @param [in] pattern
+  ///   The pattern to match. It is copied.
+  /// @return Raw pointer to a LIKE predicate. The caller owns the
+  ///   predicate until it is passed into KuduScanner::AddConjunctPredicate().
+  ///   In the case of an error (e.g. an invalid column name, or a column
+  ///   which isn't a STRING or BINARY column), a non-NULL value is still
+  ///   returned. The error will be returned when attempting to add this
+  ///   predicate to a KuduScanner.
+  KuduPredicate* NewLikePredicate(const Slice& col_name, const Slice& pattern);
+
   /// @return The KuduClient object associated with the table. The caller
   ///   should not free the returned pointer.
   KuduClient* client() const;
@@ -1511,6 +1572,24 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   Status SetExternalConsistencyMode(ExternalConsistencyMode m)
     WARN_UNUSED_RESULT;
 
+  /// Enable or disable writing to several tablets with a single RPC.
+  ///
+  /// When enabled, the operations flushed to tablets whose leader replicas
+  /// are hosted by the same tablet server are sent to that server in a single
+  /// RPC, which it applies as a separate write per tablet. This reduces the
+  /// number of RPCs for tables with many small partitions. The writes of any
+  /// tablet which fail in such an RPC are retried with a write RPC of their
+  /// own. Each write keeps the exactly-once semantics of regular write RPCs:
+  /// a write which the server applied before the combined RPC failed, e.g.
+  /// because it timed out, isn't applied again when it's retried.
+  ///
+  /// Multi-tablet writes are disabled by default.
+  ///
+  /// @param [in] enabled
+  ///   Whether to write to several tablets with a single RPC.
+  /// @return Operation result status.
+  Status SetMultiTabletWritesEnabled(bool enabled) WARN_UNUSED_RESULT;
+
   /// Set the amount of buffer space used by this session for outbound writes.
   ///
   /// The effect of the buffer size varies based on the flush mode of
@@ -1641,6 +1720,22 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status Apply(KuduWriteOperation* write_op) WARN_UNUSED_RESULT;
 
+  /// Apply the write operations of all of the rows of a columnar batch.
+  ///
+  /// This is equivalent to applying one operation per row of the batch with
+  /// Apply(), in order, but doesn't require setting the cells of each row
+  /// one by one.
+  ///
+  /// @param [in] batch
+  ///   The rows to write.
+  /// @param [out] num_applied
+  ///   The number of rows whose operations were applied, starting from the
+  ///   first one. If the batch is malformed, none are applied. May be NULL.
+  /// @return Operation result status. If it's not OK, no more than
+  ///   @c num_applied of the batch's operations were applied.
+  Status ApplyColumnarBatch(const KuduColumnarWriteBatch& batch,
+                            int* num_applied) WARN_UNUSED_RESULT;
+
   /// Flush any pending writes.
   ///
   /// This method initiates flushing of the current batch of buffered
@@ -2068,6 +2163,58 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status NextBatch(KuduScanBatch* batch);
 
+  /// Fetch the next batch of results for this scanner, in columnar layout.
+  ///
+  /// This requires the COLUMNAR_LAYOUT row format flag to be set, see
+  /// SetRowFormatFlags(). A single KuduColumnarScanBatch object may be
+  /// reused. Each subsequent call replaces the data from the previous call.
+  /// @param [out] batch
+  ///   Placeholder for the result.
+  /// @return Operation result status.
+  Status NextBatch(KuduColumnarScanBatch* batch);
+
+  /// Fetch the next batch of results for this scanner asynchronously.
+  ///
+  /// This is the non-blocking counterpart of NextBatch(KuduScanBatch*): the
+  /// call returns right away, and the callback is run once @c batch holds
+  /// the next batch of results, or once fetching it failed. Fetching the
+  /// following batches of a tablet is driven entirely by the client's RPC
+  /// reactor threads, so a process may drive many concurrent scans without a
+  /// thread for each of them. Moving on to the next tablet, and retrying
+  /// after errors, are done on a small pool of threads shared by all the
+  /// scanners of the client.
+  ///
+  /// @note The callback may be run on the calling thread, if the batch is
+  ///   already at hand, or on one of the client's reactor threads. It must
+  ///   not block, but it may call NextBatchAsync() again. Until the callback
+  ///   is run, no other method of the scanner may be called, and neither the
+  ///   scanner nor @c batch may be destroyed.
+  ///
+  /// @note Asynchronous batches are not supported by scanners which scan
+  ///   several tablets concurrently (see SetTabletParallelism()); the
+  ///   callback is run with Status::NotSupported() in that case.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result.
+  /// @param [in] cb
+  ///   Callback to report on the outcome. The caller retains ownership of
+  ///   the callback, which must remain valid until it is run.
+  void NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb);
+
+  /// Fetch the next batch of results for this scanner asynchronously, in
+  /// columnar layout.
+  ///
+  /// This requires the COLUMNAR_LAYOUT row format flag to be set, see
+  /// SetRowFormatFlags(). Otherwise, it behaves like
+  /// NextBatchAsync(KuduScanBatch*, KuduStatusCallback*).
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result.
+  /// @param [in] cb
+  ///   Callback to report on the outcome. The caller retains ownership of
+  ///   the callback, which must remain valid until it is run.
+  void NextBatchAsync(KuduColumnarScanBatch* batch, KuduStatusCallback* cb);
+
   /// Get the KuduTabletServer that is currently handling the scan.
   ///
   /// More concretely, this is the server that handled the most recent
@@ -2078,6 +2225,13 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status GetCurrentServer(KuduTabletServer** server);
 
+  /// Besides the block cache usage, the metrics profile the work of the
+  /// servers: @c rows_scanned and @c rows_returned compare the rows read to
+  /// those which passed the predicates, @c blocks_read,
+  /// @c bytes_decompressed and @c delta_updates_applied count the blocks,
+  /// decompressed bytes and delta store updates processed, and
+  /// @c queue_nanos is the time the requests waited before being handled.
+  ///
   /// @return Cumulative resource metrics since the scan was started.
   const ResourceMetrics& GetResourceMetrics() const;
 
@@ -2176,6 +2330,19 @@ class KUDU_EXPORT KuduScanner {
   ///   results and might even cause the client to crash.
   static const uint64_t PAD_UNIXTIME_MICROS_TO_16_BYTES = 1 << 0;
 
+  /// Makes the server return rows in columnar layout, which is cheaper for
+  /// both the server to produce and the client to process in bulk. If this
+  /// flag is enabled, the results must be fetched with
+  /// NextBatch(KuduColumnarScanBatch*). It may not be combined with
+  /// PAD_UNIXTIME_MICROS_TO_16_BYTES.
+  static const uint64_t COLUMNAR_LAYOUT = 1 << 1;
+
+  /// Along with COLUMNAR_LAYOUT, allows the server to send the STRING and
+  /// BINARY columns whose values repeat a lot as per-batch dictionaries and
+  /// codes, which saves network bandwidth and lets the caller work on the
+  /// codes. See KuduColumnarScanBatch::GetDictionaryEncodedColumn().
+  static const uint64_t COLUMNAR_DICTIONARY_ENCODING = 1 << 2;
+
   /// Optionally set row format modifier flags.
   ///
   /// If flags is RowFormatFlags::NO_FLAGS, then no modifications will be made to the row
@@ -2206,6 +2373,70 @@ class KUDU_EXPORT KuduScanner {
   Status SetRowFormatFlags(uint64_t flags);
   ///@}
 
+  /// Enable or disable prefetching of the scan's results.
+  ///
+  /// With prefetching enabled, NextBatch() sends the request for the
+  /// following batch of the tablet being scanned before returning, so that
+  /// the tablet server produces it while the application processes the
+  /// returned batch. This holds up to one extra batch in memory (see
+  /// SetBatchSizeBytes()). Prefetching doesn't cross tablet boundaries.
+  ///
+  /// Prefetching is disabled by default.
+  ///
+  /// @param [in] enabled
+  ///   Whether the scanner should prefetch results.
+  /// @return Operation result status.
+  Status SetPrefetchEnabled(bool enabled) WARN_UNUSED_RESULT;
+
+  /// Let the scanner adapt the size of the batches it requests.
+  ///
+  /// With adaptive batch sizing, the scanner starts with the batch size set
+  /// with SetBatchSizeBytes(), or the tablet servers' default if none is set,
+  /// and after each batch grows or shrinks the size of the following
+  /// requests so that a batch takes about @c target_batch_time_ms to go
+  /// through: the time the tablet server takes to return it plus the time the
+  /// application takes before asking for the next one, or the longer of the
+  /// two with prefetching (see SetPrefetchEnabled()). The size changes by at
+  /// most a factor of two per batch, is carried over from one tablet to the
+  /// next, and never exceeds the tablet server's maximum batch size. This
+  /// lets scans tune themselves to the width of the rows and the speed of the
+  /// application.
+  ///
+  /// Adaptive batch sizing is disabled by default.
+  ///
+  /// @param [in] target_batch_time_ms
+  ///   The target time per batch, in milliseconds. Must not be negative; 0
+  ///   disables adaptive batch sizing.
+  /// @return Operation result status.
+  Status SetAdaptiveBatchSizing(int target_batch_time_ms) WARN_UNUSED_RESULT;
+
+  /// Scan up to the given number of tablets concurrently.
+  ///
+  /// In this mode, Open() plans the scan as one scan token per tablet (see
+  /// KuduScanTokenBuilder) and scans up to @c max_concurrent_tablets of the
+  /// tablets at a time from background threads, each buffering a few batches
+  /// ahead of the application. NextBatch() then returns the batches in the
+  /// order they arrive from the tablet servers; the batches of any one tablet
+  /// are still returned in that tablet's scan order. With
+  /// @c preserve_tablet_order, all batches of a tablet are returned before
+  /// those of the next tablet, in the order a serial scan would return them,
+  /// while the following tablets are already being scanned.
+  ///
+  /// A READ_AT_SNAPSHOT scan without a snapshot timestamp scans all tablets
+  /// at the snapshot timestamp chosen for the first tablet. Row limits,
+  /// aggregates, KeepAlive() and GetCurrentServer() are not supported in this
+  /// mode. Setting @c max_concurrent_tablets to 1, the default, scans the
+  /// tablets one after another from the calling thread.
+  ///
+  /// @param [in] max_concurrent_tablets
+  ///   The maximum number of tablets to scan concurrently. Must be positive.
+  /// @param [in] preserve_tablet_order
+  ///   Whether to return the tablets' batches in tablet order rather than
+  ///   in arrival order.
+  /// @return Operation result status.
+  Status SetTabletParallelism(int max_concurrent_tablets,
+                              bool preserve_tablet_order = false) WARN_UNUSED_RESULT;
+
   /// Set the maximum number of rows the scanner should return.
   ///
   /// @param [in] limit
@@ -2213,6 +2444,164 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetLimit(int64_t limit) WARN_UNUSED_RESULT;
 
+  /// Aggregate functions which may be computed by the tablet servers.
+  enum AggregateFunction {
+    /// The number of rows, or of non-null values of a column.
+    COUNT,
+    /// The sum of the non-null values of an integer or floating point
+    /// column. Integer sums wrap around on overflow.
+    SUM,
+    /// The minimum non-null value of an integer or floating point column.
+    MIN,
+    /// The maximum non-null value of an integer or floating point column.
+    MAX
+  };
+
+  /// Add an aggregate to compute over the scanned rows.
+  ///
+  /// If any aggregates are added, the tablet servers compute them over the
+  /// rows matching the scan's predicates instead of returning the rows: the
+  /// batches returned by NextBatch() are empty, and the results are available
+  /// through GetAggregateInt64() and GetAggregateDouble() once the scan is
+  /// complete. The aggregated columns need not be projected, so the
+  /// projection should usually be empty.
+  ///
+  /// Example usage (without error handling, for brevity):
+  /// @code
+  ///   KuduScanner scanner(...);
+  ///   scanner.SetProjectedColumnNames({});
+  ///   scanner.AddAggregate(KuduScanner::COUNT);
+  ///   scanner.AddAggregate(KuduScanner::MAX, "int_val");
+  ///   scanner.Open();
+  ///   while (scanner.HasMoreRows()) {
+  ///     KuduScanBatch batch;
+  ///     scanner.NextBatch(&batch);
+  ///   }
+  ///   int64_t count, max;
+  ///   scanner.GetAggregateInt64(0, &count);
+  ///   scanner.GetAggregateInt64(1, &max);
+  /// @endcode
+  ///
+  /// Aggregates are not carried by scan tokens, and require server-side
+  /// support, thus the caller should be prepared to handle a NotSupported
+  /// status in Open() and NextBatch().
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [in] function
+  ///   The aggregate function.
+  /// @param [in] col_name
+  ///   The aggregated column. May be empty only for COUNT, in which case
+  ///   the rows are counted.
+  /// @return Operation result status.
+  Status AddAggregate(AggregateFunction function,
+                      const std::string& col_name = "") WARN_UNUSED_RESULT;
+
+  /// Get the result of an integer aggregate.
+  ///
+  /// @param [in] idx
+  ///   The index of the aggregate, in the order of the calls to AddAggregate().
+  /// @param [out] val
+  ///   The result of the aggregate over the rows scanned so far.
+  /// @return Operation result status. Returns NotFound if no non-null value
+  ///   was aggregated by the SUM, MIN or MAX aggregate, and InvalidArgument
+  ///   if the aggregate is not an integer, i.e. it is the SUM, MIN or MAX of
+  ///   a floating point column.
+  Status GetAggregateInt64(int idx, int64_t* val) const WARN_UNUSED_RESULT;
+
+  /// Get the result of a floating point aggregate.
+  ///
+  /// @param [in] idx
+  ///   The index of the aggregate, in the order of the calls to AddAggregate().
+  /// @param [out] val
+  ///   The result of the aggregate over the rows scanned so far.
+  /// @return Operation result status. Returns NotFound if no non-null value
+  ///   was aggregated, and InvalidArgument if the aggregate is not the SUM,
+  ///   MIN or MAX of a floating point column.
+  Status GetAggregateDouble(int idx, double* val) const WARN_UNUSED_RESULT;
+
+  /// Ask each tablet for only its best rows by the values of a column.
+  ///
+  /// Each tablet server returns the @c n rows of its tablet with the
+  /// smallest values of the column (or the largest ones, if @c descending),
+  /// ordered by the column, with rows whose value is null last. The rows of
+  /// a tablet are all returned in the last batch of the tablet, after the
+  /// tablet server has scanned it, so that the batches before it are empty.
+  /// The caller is responsible for merging the rows of the tablets to find
+  /// the best rows of the table. The column need not be projected.
+  ///
+  /// The tablet servers skip the rowsets whose column statistics show that
+  /// none of their rows can beat the rows already found.
+  ///
+  /// Top-N scans cannot be combined with SetLimit(), aggregates or
+  /// fault-tolerant scans, are not carried by scan tokens, and require
+  /// server-side support, thus the caller should be prepared to handle a
+  /// NotSupported status in Open() and NextBatch().
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [in] col_name
+  ///   The column to order the rows by.
+  /// @param [in] n
+  ///   The number of rows to return per tablet. Must be positive.
+  /// @param [in] descending
+  ///   Whether to return the rows with the largest values rather than the
+  ///   smallest.
+  /// @return Operation result status.
+  Status SetTopN(const std::string& col_name, int64_t n,
+                 bool descending = false) WARN_UNUSED_RESULT;
+
+  /// Make this a diff scan, which returns only the rows that were inserted
+  /// or updated between a snapshot at @c start_timestamp and one at
+  /// @c end_timestamp, with their values as of @c end_timestamp.
+  ///
+  /// The timestamps are HybridTime timestamps, as for SetSnapshotRaw(), and
+  /// the scan reads at @c end_timestamp in READ_AT_SNAPSHOT mode. The tablet
+  /// servers skip the rowsets and delta files without changes in the window.
+  ///
+  /// Rows deleted in the window are not returned. A row whose key was
+  /// deleted and then inserted again in a different rowset may be returned
+  /// twice, once per rowset; fault-tolerant diff scans return it once.
+  /// @c start_timestamp must not be older than the tablets' ancient history
+  /// mark (see --tablet_history_max_age_sec).
+  ///
+  /// Diff scans cannot be combined with top-N scans, are not carried by scan
+  /// tokens, and require server-side support, thus the caller should be
+  /// prepared to handle a NotSupported status in Open() and NextBatch().
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [in] start_timestamp
+  ///   The timestamp of the snapshot the changes are relative to. Must be
+  ///   bigger than 0.
+  /// @param [in] end_timestamp
+  ///   The timestamp of the snapshot to read the changed rows at. Must not be
+  ///   smaller than @c start_timestamp.
+  /// @return Operation result status.
+  Status SetDiffScan(uint64_t start_timestamp, uint64_t end_timestamp) WARN_UNUSED_RESULT;
+
+  /// Make the tablet servers break down the time spent reading the rows by
+  /// column.
+  ///
+  /// The resource metrics of the scan (see GetResourceMetrics()) then
+  /// include, for each column read by the servers, the metrics
+  /// @c column.<name>.cells_read, @c column.<name>.bytes_read and
+  /// @c column.<name>.<phase>_nanos, where the phases are the same as those
+  /// summed over the columns in the @c io_nanos, @c decompress_nanos,
+  /// @c decode_nanos, @c delta_apply_nanos and @c predicate_eval_nanos
+  /// metrics. Servers which don't support it only report the sums.
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [in] report
+  ///   Whether to report the metrics of each column.
+  /// @return Operation result status.
+  Status SetReportColumnMetrics(bool report) WARN_UNUSED_RESULT;
+
   /// @return String representation of this scan.
   ///
   /// @internal
@@ -2223,11 +2612,22 @@ class KUDU_EXPORT KuduScanner {
  private:
   class KUDU_NO_EXPORT Data;
 
+  // Fetches the next batch of results into 'batch_data', for either layout
+  // of the results.
+  Status NextBatchInternal(internal::ScanBatchDataInterface* batch_data);
+
+  // Asynchronously fetches the next batch of results into 'batch_data', for
+  // either layout of the results, and runs 'cb' once done.
+  void NextBatchAsyncInternal(internal::ScanBatchDataInterface* batch_data,
+                              KuduStatusCallback* cb);
+
   friend class KuduScanToken;
+  friend class internal::ParallelScanner;
   FRIEND_TEST(ClientTest, TestScanCloseProxy);
   FRIEND_TEST(ClientTest, TestScanFaultTolerance);
   FRIEND_TEST(ClientTest, TestScanNoBlockCaching);
   FRIEND_TEST(ClientTest, TestScanTimeout);
+  FRIEND_TEST(ClientTest, TestScanWithAdaptiveBatchSizing);
   FRIEND_TEST(ClientTest, TestReadAtSnapshotNoTimestampSet);
   FRIEND_TEST(ConsistencyITest, TestSnapshotScanTimestampReuse);
   FRIEND_TEST(ScanTokenTest, TestScanTokens);
@@ -2398,6 +2798,25 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @copydoc KuduScanner::SetTimeoutMillis
   Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
 
+  /// Split the tablets into several tokens of about the given size.
+  ///
+  /// By default, Build() creates one token per tablet. With a split size,
+  /// Build() asks the tablet servers to split the primary key range of each
+  /// tablet into chunks holding about @c split_size_bytes of the projected
+  /// columns, according to the sizes and key bounds of the tablets' rowsets,
+  /// and creates one token per chunk. This evens out the work of the tasks
+  /// of parallel query engines, which otherwise wait on the largest tablets.
+  /// The chunks are estimates and may be smaller or larger than asked.
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [in] split_size_bytes
+  ///   The approximate number of bytes each token should scan, or 0 for one
+  ///   token per tablet.
+  /// @return Operation result status.
+  Status SetSplitSizeBytes(uint64_t split_size_bytes) WARN_UNUSED_RESULT;
+
   /// Build the set of scan tokens.
   ///
   /// The builder may be reused after this call.
@@ -2411,12 +2830,103 @@ class KUDU_EXPORT KuduScanTokenBuilder {
  private:
   class KUDU_NO_EXPORT Data;
 
+  friend class KuduScanner;
+
   // Owned.
   Data* data_;
 
   DISALLOW_COPY_AND_ASSIGN(KuduScanTokenBuilder);
 };
 
+/// @brief Looks up many rows of a table by their primary keys.
+///
+/// The keys are grouped by tablet, and the rows of each tablet are looked up
+/// with a single RPC, which tablet servers answer by probing each rowset for
+/// all the keys it may hold at once. This is much cheaper than a scanner per
+/// key when looking up many scattered rows.
+///
+/// The rows are read in READ_LATEST mode, and are returned one batch per
+/// tablet, in no particular order: each row comes with the index of its key,
+/// in the order the keys were added. The rows of keys which don't exist are
+/// not returned.
+///
+/// @note This class is experimental and will either disappear or change in
+///   a future release. It requires server-side support, thus the caller
+///   should be prepared to handle a NotSupported status in NextBatch().
+///
+/// @warning This class is not thread-safe.
+class KUDU_EXPORT KuduMultiGet {
+ public:
+  /// Constructor for KuduMultiGet.
+  ///
+  /// @param [in] table
+  ///   The table to look up the rows of. The given object must remain valid
+  ///   for the lifetime of this object.
+  explicit KuduMultiGet(KuduTable* table);
+  ~KuduMultiGet();
+
+  /// Set the projection for the lookups. The default is all the columns.
+  ///
+  /// @param [in] col_names
+  ///   Column names to use for the projection.
+  /// @return Operation result status.
+  Status SetProjectedColumnNames(const std::vector<std::string>& col_names)
+      WARN_UNUSED_RESULT;
+
+  /// Set the replica selection policy, as for KuduScanner::SetSelection().
+  ///
+  /// @param [in] selection
+  ///   The policy to set.
+  /// @return Operation result status.
+  Status SetSelection(KuduClient::ReplicaSelection selection) WARN_UNUSED_RESULT;
+
+  /// Set the timeout of each tablet's lookup, and of finding the tablets of
+  /// the keys in Open(). The default is KuduScanner::kScanTimeoutMillis.
+  ///
+  /// @param [in] millis
+  ///   Timeout to set (in milliseconds). Must be greater than 0.
+  /// @return Operation result status.
+  Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
+
+  /// Add the primary key of a row to look up. Keys may only be added before
+  /// Open().
+  ///
+  /// @param [in] key
+  ///   A row with all the primary key columns set. This object takes
+  ///   ownership of it, even if a bad status is returned.
+  /// @return Operation result status.
+  Status AddKey(KuduPartialRow* key) WARN_UNUSED_RESULT;
+
+  /// Find the tablets of the keys added so far.
+  ///
+  /// Keys which fall in no tablet, e.g. in a non-covered range, are dropped.
+  ///
+  /// @return Operation result status.
+  Status Open() WARN_UNUSED_RESULT;
+
+  /// @return @c true if some tablets haven't been looked up yet.
+  bool HasMoreRows() const;
+
+  /// Look up the rows of the next tablet.
+  ///
+  /// @param [out] batch
+  ///   The rows found in the tablet, which may be none.
+  /// @param [out] key_indexes
+  ///   The index of the key of each row of @c batch, in the order the keys
+  ///   were added with AddKey().
+  /// @return Operation result status.
+  Status NextBatch(KuduScanBatch* batch, std::vector<int>* key_indexes)
+      WARN_UNUSED_RESULT;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduMultiGet);
+};
+
 /// @brief Builder for Partitioner instances.
 class KUDU_EXPORT KuduPartitionerBuilder {
  public:
@@ -42,6 +42,7 @@ class KuduClientBuilder::Data {
   std::string authn_creds_;
   internal::ReplicaController::Visibility replica_visibility_;
   boost::optional<int> num_reactors_;
+  bool prefetch_tablet_locations_;
 
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
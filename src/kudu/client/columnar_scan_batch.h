@@ -0,0 +1,142 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CLIENT_COLUMNAR_SCAN_BATCH_H
+#define KUDU_CLIENT_COLUMNAR_SCAN_BATCH_H
+
+#ifdef KUDU_HEADERS_NO_STUBS
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#else
+#include "kudu/client/stubs.h"
+#endif
+
+#include "kudu/util/kudu_export.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace client {
+
+/// @brief A batch of rows returned by a scan in columnar layout.
+///
+/// Scans return batches of this type when the KuduScanner::COLUMNAR_LAYOUT
+/// row format flag is set. Every call to
+/// KuduScanner::NextBatch(KuduColumnarScanBatch*) returns a batch of zero or
+/// more rows, whose cells are laid out one column after another:
+///
+/// @li Cells of fixed-length types are stored back to back, in the same
+///   format as the cells of KuduScanBatch::direct_data(). The cell of a
+///   NULL value is zeroed.
+/// @li Cells of variable-length types (STRING and BINARY) are stored back to
+///   back in a data buffer, with NumRows() + 1 little-endian uint32_t offsets
+///   into it: the cell of row 'i' spans from offset 'i' to offset 'i + 1'.
+/// @li Nullable columns also have a bitmap with one bit per row, least
+///   significant bit first, which is set if the row's cell is not NULL.
+///
+/// When the KuduScanner::COLUMNAR_DICTIONARY_ENCODING row format flag is also
+/// set, the server may send variable-length columns whose values repeat a
+/// lot as a dictionary of their distinct values and one little-endian
+/// uint32_t code per row, the index of the row's value in the dictionary.
+/// Such columns can be fetched as they are with GetDictionaryEncodedColumn(),
+/// or expanded with GetVariableLengthColumn().
+///
+/// Apart from BOOL cells, which take one byte each, and DECIMAL cells of
+/// precision up to 18, which take 4 or 8 bytes, the buffers are laid out like
+/// the buffers of Apache Arrow arrays of the matching types, so that they can
+/// be wrapped into Arrow arrays without copying them.
+///
+/// @note The Slices returned by this class are only valid for the lifetime of
+///   the KuduColumnarScanBatch, and until it is used for another NextBatch()
+///   call.
+class KUDU_EXPORT KuduColumnarScanBatch {
+ public:
+  KuduColumnarScanBatch();
+  ~KuduColumnarScanBatch();
+
+  /// @return The number of rows in this batch.
+  int NumRows() const;
+
+  /// Get the cells of a fixed-length column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the scan's projection.
+  /// @param [out] data
+  ///   The column's cells.
+  /// @return Operation result status. Returns InvalidArgument if there is no
+  ///   such column or if it is of a variable-length type.
+  Status GetFixedLengthColumn(int idx, Slice* data) const;
+
+  /// Get the cells of a variable-length column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the scan's projection.
+  /// @param [out] offsets
+  ///   The offsets of the column's cells in @c data.
+  /// @param [out] data
+  ///   The column's cells.
+  /// @return Operation result status. Returns InvalidArgument if there is no
+  ///   such column or if it is of a fixed-length type.
+  ///
+  /// @note A dictionary-encoded column is expanded the first time it is
+  ///   fetched with this method, which costs a copy of its cells.
+  Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
+
+  /// Get the non-null bitmap of a column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the scan's projection.
+  /// @param [out] non_null_bitmap
+  ///   The column's non-null bitmap.
+  /// @return Operation result status. Returns InvalidArgument if there is no
+  ///   such column or if it is not nullable.
+  Status GetNonNullBitmapForColumn(int idx, Slice* non_null_bitmap) const;
+
+  /// @param [in] idx
+  ///   The index of the column in the scan's projection.
+  /// @return Whether the column was sent dictionary-encoded in this batch.
+  ///   Whether a column is dictionary-encoded may differ between batches.
+  bool IsDictionaryEncodedColumn(int idx) const;
+
+  /// Get the cells of a dictionary-encoded column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the scan's projection.
+  /// @param [out] codes
+  ///   One little-endian uint32_t code per row. The code of a NULL cell is
+  ///   meaningless.
+  /// @param [out] dictionary_offsets
+  ///   The offsets of the dictionary's entries in @c dictionary_data: entry
+  ///   'i' spans from offset 'i' to offset 'i + 1'.
+  /// @param [out] dictionary_data
+  ///   The dictionary's entries.
+  /// @return Operation result status. Returns InvalidArgument if there is no
+  ///   such column or if it is not dictionary-encoded in this batch.
+  Status GetDictionaryEncodedColumn(int idx, Slice* codes, Slice* dictionary_offsets,
+                                    Slice* dictionary_data) const;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+  friend class KuduScanner;
+
+  Data* data_;
+  DISALLOW_COPY_AND_ASSIGN(KuduColumnarScanBatch);
+};
+
+} // namespace client
+} // namespace kudu
+
+#endif
@@ -0,0 +1,298 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/client/columnar_write_batch.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "kudu/client/client.h"
+#include "kudu/client/schema.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/row.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
+
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace client {
+
+namespace {
+
+// The buffers of one column of a batch.
+struct ColumnBuffers {
+  bool is_set = false;
+  Slice data;
+  Slice offsets;
+
+  // Empty if all of the column's cells are non-NULL.
+  Slice non_null_bitmap;
+};
+
+typedef vector<unique_ptr<KuduWriteOperation>> OpsVector;
+
+// The buffers of a KuduPartialRow which the cells are written into.
+struct RowBuffers {
+  uint8_t* row_data;
+  uint8_t* isset_bitmap;
+};
+
+// Writes the cells of column 'idx' from 'col' into 'rows', and marks them as
+// set. 'write_cell(row, dst)' writes the cell of row 'row' to 'dst', the
+// location of the cell in the row; it isn't called for NULL cells.
+//
+// The rows must be newly created: they must not own any of their cells.
+template<typename CellWriter>
+void WriteCells(const Schema& schema, int idx, const ColumnBuffers& col,
+                const vector<RowBuffers>& rows, const CellWriter& write_cell) {
+  const size_t offset = schema.column_offset(idx);
+  const bool nullable = schema.column(idx).is_nullable();
+  const uint8_t* non_null_bitmap =
+      col.non_null_bitmap.empty() ? nullptr : col.non_null_bitmap.data();
+  for (int row = 0; row < rows.size(); row++) {
+    uint8_t* row_data = rows[row].row_data;
+    BitmapSet(rows[row].isset_bitmap, idx);
+    if (nullable) {
+      const bool is_null = non_null_bitmap && !BitmapTest(non_null_bitmap, row);
+      ContiguousRowHelper::SetCellIsNull(schema, row_data, idx, is_null);
+      if (is_null) {
+        continue;
+      }
+    }
+    write_cell(row, row_data + offset);
+  }
+}
+
+// Writes the cells of a fixed-length column whose cells are 'kSize' bytes.
+template<size_t kSize>
+void WriteFixedLengthCells(const Schema& schema, int idx, const ColumnBuffers& col,
+                           const vector<RowBuffers>& rows) {
+  const uint8_t* cells = col.data.data();
+  WriteCells(schema, idx, col, rows, [&](int row, uint8_t* dst) {
+      memcpy(dst, cells + row * kSize, kSize);
+    });
+}
+
+// Writes the cells of column 'idx' into 'rows'. The column's type and the
+// size of its buffers were checked when it was set, so the type is only
+// dispatched on here, once for all of the rows.
+Status WriteColumn(const Schema& schema, int idx, const ColumnBuffers& col,
+                   const vector<RowBuffers>& rows) {
+  const ColumnSchema& col_schema = schema.column(idx);
+  const TypeInfo* type_info = col_schema.type_info();
+  if (type_info->type() == BOOL) {
+    // Any non-zero byte is true, but the row must hold a proper bool.
+    const uint8_t* cells = col.data.data();
+    WriteCells(schema, idx, col, rows, [&](int row, uint8_t* dst) {
+        bool val = cells[row] != 0;
+        memcpy(dst, &val, sizeof(val));
+      });
+    return Status::OK();
+  }
+  if (type_info->physical_type() == BINARY) {
+    // The cells aren't copied, as with KuduPartialRow::SetStringNoCopy().
+    const uint8_t* offsets = col.offsets.data();
+    const uint8_t* data = col.data.data();
+    WriteCells(schema, idx, col, rows, [&](int row, uint8_t* dst) {
+        uint32_t start = UnalignedLoad<uint32_t>(offsets + row * sizeof(uint32_t));
+        uint32_t end = UnalignedLoad<uint32_t>(offsets + (row + 1) * sizeof(uint32_t));
+        Slice val(data + start, end - start);
+        memcpy(dst, &val, sizeof(val));
+      });
+    return Status::OK();
+  }
+  switch (type_info->size()) {
+    case 1: WriteFixedLengthCells<1>(schema, idx, col, rows); break;
+    case 2: WriteFixedLengthCells<2>(schema, idx, col, rows); break;
+    case 4: WriteFixedLengthCells<4>(schema, idx, col, rows); break;
+    case 8: WriteFixedLengthCells<8>(schema, idx, col, rows); break;
+    case 16: WriteFixedLengthCells<16>(schema, idx, col, rows); break;
+    default:
+      return Status::NotSupported(Substitute("unsupported type for column '$0'",
+                                             col_schema.name()));
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+class KuduColumnarWriteBatch::Data {
+ public:
+  Data(sp::shared_ptr<KuduTable> table, const Schema* schema,
+       KuduWriteOperation::Type type, int num_rows)
+      : table(std::move(table)),
+        schema(schema),
+        type(type),
+        num_rows(num_rows),
+        columns(schema->num_columns()) {
+  }
+
+  // Returns the schema of column 'idx', or an error if there is no such
+  // column.
+  Status FindColumn(int idx, const ColumnSchema** col_schema) const {
+    if (idx < 0 || idx >= schema->num_columns()) {
+      return Status::InvalidArgument(Substitute("no column with index $0", idx));
+    }
+    *col_schema = &schema->column(idx);
+    return Status::OK();
+  }
+
+  const sp::shared_ptr<KuduTable> table;
+  const Schema* const schema;
+  const KuduWriteOperation::Type type;
+  const int num_rows;
+  vector<ColumnBuffers> columns;
+};
+
+KuduColumnarWriteBatch::KuduColumnarWriteBatch(const sp::shared_ptr<KuduTable>& table,
+                                               KuduWriteOperation::Type type,
+                                               int num_rows)
+    : data_(new Data(table, table->schema().schema_, type, num_rows)) {
+}
+
+KuduColumnarWriteBatch::~KuduColumnarWriteBatch() {
+  delete data_;
+}
+
+int KuduColumnarWriteBatch::NumRows() const {
+  return data_->num_rows;
+}
+
+Status KuduColumnarWriteBatch::SetFixedLengthColumn(int idx, Slice data) {
+  const ColumnSchema* col_schema;
+  RETURN_NOT_OK(data_->FindColumn(idx, &col_schema));
+  const TypeInfo* type_info = col_schema->type_info();
+  if (type_info->physical_type() == BINARY) {
+    return Status::InvalidArgument(Substitute("column '$0' is variable-length",
+                                              col_schema->name()));
+  }
+  if (data.size() != static_cast<size_t>(data_->num_rows) * type_info->size()) {
+    return Status::InvalidArgument(
+        Substitute("column '$0' has $1 bytes of cells, expected $2",
+                   col_schema->name(), data.size(), data_->num_rows * type_info->size()));
+  }
+  ColumnBuffers* col = &data_->columns[idx];
+  col->is_set = true;
+  col->data = data;
+  return Status::OK();
+}
+
+Status KuduColumnarWriteBatch::SetVariableLengthColumn(int idx, Slice offsets, Slice data) {
+  const ColumnSchema* col_schema;
+  RETURN_NOT_OK(data_->FindColumn(idx, &col_schema));
+  if (col_schema->type_info()->physical_type() != BINARY) {
+    return Status::InvalidArgument(Substitute("column '$0' is fixed-length",
+                                              col_schema->name()));
+  }
+  if (offsets.size() != (data_->num_rows + 1) * sizeof(uint32_t)) {
+    return Status::InvalidArgument(
+        Substitute("column '$0' has $1 bytes of offsets, expected $2",
+                   col_schema->name(), offsets.size(), (data_->num_rows + 1) * sizeof(uint32_t)));
+  }
+  uint32_t prev = UnalignedLoad<uint32_t>(offsets.data());
+  for (int row = 1; row <= data_->num_rows; row++) {
+    uint32_t offset = UnalignedLoad<uint32_t>(offsets.data() + row * sizeof(uint32_t));
+    if (offset < prev) {
+      return Status::InvalidArgument(Substitute("column '$0' has decreasing offsets",
+                                                col_schema->name()));
+    }
+    prev = offset;
+  }
+  if (prev > data.size()) {
+    return Status::InvalidArgument(
+        Substitute("column '$0' has offsets past the end of its $1 bytes of cells",
+                   col_schema->name(), data.size()));
+  }
+  ColumnBuffers* col = &data_->columns[idx];
+  col->is_set = true;
+  col->offsets = offsets;
+  col->data = data;
+  return Status::OK();
+}
+
+Status KuduColumnarWriteBatch::SetNonNullBitmapForColumn(int idx, Slice non_null_bitmap) {
+  const ColumnSchema* col_schema;
+  RETURN_NOT_OK(data_->FindColumn(idx, &col_schema));
+  if (!col_schema->is_nullable()) {
+    return Status::InvalidArgument(Substitute("column '$0' is not nullable",
+                                              col_schema->name()));
+  }
+  if (non_null_bitmap.size() < BitmapSize(data_->num_rows)) {
+    return Status::InvalidArgument(
+        Substitute("column '$0' has a non-null bitmap of $1 bytes, expected $2",
+                   col_schema->name(), non_null_bitmap.size(), BitmapSize(data_->num_rows)));
+  }
+  data_->columns[idx].non_null_bitmap = non_null_bitmap;
+  return Status::OK();
+}
+
+Status KuduColumnarWriteBatch::NewOperations(vector<KuduWriteOperation*>* ops) const {
+  KuduTable* table = data_->table.get();
+  OpsVector new_ops;
+  new_ops.reserve(data_->num_rows);
+  for (int row = 0; row < data_->num_rows; row++) {
+    switch (data_->type) {
+      case KuduWriteOperation::INSERT:
+        new_ops.emplace_back(table->NewInsert());
+        break;
+      case KuduWriteOperation::UPSERT:
+        new_ops.emplace_back(table->NewUpsert());
+        break;
+      case KuduWriteOperation::UPDATE:
+        new_ops.emplace_back(table->NewUpdate());
+        break;
+      case KuduWriteOperation::DELETE:
+        new_ops.emplace_back(table->NewDelete());
+        break;
+      default:
+        return Status::InvalidArgument(Substitute("unknown operation type $0", data_->type));
+    }
+  }
+
+  // Write the cells column by column, straight into the rows.
+  vector<RowBuffers> rows;
+  rows.reserve(new_ops.size());
+  for (const auto& op : new_ops) {
+    KuduPartialRow* row = op->mutable_row();
+    rows.push_back({ row->row_data_, row->isset_bitmap_ });
+  }
+  for (int idx = 0; idx < data_->columns.size(); idx++) {
+    const ColumnBuffers& col = data_->columns[idx];
+    if (col.is_set) {
+      RETURN_NOT_OK(WriteColumn(*data_->schema, idx, col, rows));
+    }
+  }
+
+  ops->reserve(ops->size() + new_ops.size());
+  for (auto& op : new_ops) {
+    ops->push_back(op.release());
+  }
+  return Status::OK();
+}
+
+} // namespace client
+} // namespace kudu
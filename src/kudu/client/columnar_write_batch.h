@@ -0,0 +1,130 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CLIENT_COLUMNAR_WRITE_BATCH_H
+#define KUDU_CLIENT_COLUMNAR_WRITE_BATCH_H
+
+#include <vector>
+
+#ifdef KUDU_HEADERS_NO_STUBS
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#else
+#include "kudu/client/stubs.h"
+#endif
+
+#include "kudu/client/shared_ptr.h"
+#include "kudu/client/write_op.h"
+#include "kudu/util/kudu_export.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace client {
+
+class KuduTable;
+
+/// @brief A batch of rows to write to a table, given in columnar layout.
+///
+/// The rows of a batch are written with KuduSession::ApplyColumnarBatch(),
+/// without having to set their cells one by one with KuduPartialRow. The
+/// columns use the same layout as the columns of a KuduColumnarScanBatch:
+///
+/// @li Cells of fixed-length types are stored back to back, in the same
+///   format as the cells of KuduScanBatch::direct_data().
+/// @li Cells of variable-length types (STRING and BINARY) are stored back to
+///   back in a data buffer, with NumRows() + 1 little-endian uint32_t offsets
+///   into it: the cell of row 'i' spans from offset 'i' to offset 'i + 1'.
+/// @li Nullable columns may also have a bitmap with one bit per row, least
+///   significant bit first, which is set if the row's cell is not NULL.
+///
+/// The columns which aren't set are left unset in all of the rows, as if
+/// KuduPartialRow::Unset() had been called on them.
+///
+/// @note The buffers of fixed-length columns and the non-null bitmaps are
+///   copied by KuduSession::ApplyColumnarBatch(). The data buffers of
+///   variable-length columns are not: they must remain valid until the
+///   operations of the batch have been flushed, and for as long as any of
+///   its failed operations are in use.
+class KUDU_EXPORT KuduColumnarWriteBatch {
+ public:
+  /// Create a batch of rows to write to a table.
+  ///
+  /// @param [in] table
+  ///   The table to write the rows to.
+  /// @param [in] type
+  ///   The type of the operations to write the rows with.
+  /// @param [in] num_rows
+  ///   The number of rows of the batch.
+  KuduColumnarWriteBatch(const sp::shared_ptr<KuduTable>& table,
+                         KuduWriteOperation::Type type,
+                         int num_rows);
+  ~KuduColumnarWriteBatch();
+
+  /// @return The number of rows in this batch.
+  int NumRows() const;
+
+  /// Set the cells of a fixed-length column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the table's schema.
+  /// @param [in] data
+  ///   The column's cells, NumRows() times the size of the column's type.
+  /// @return Operation result status. Returns InvalidArgument if there is no
+  ///   such column, if it is of a variable-length type, or if @c data has
+  ///   the wrong size.
+  Status SetFixedLengthColumn(int idx, Slice data) WARN_UNUSED_RESULT;
+
+  /// Set the cells of a variable-length column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the table's schema.
+  /// @param [in] offsets
+  ///   The offsets of the column's cells in @c data.
+  /// @param [in] data
+  ///   The column's cells.
+  /// @return Operation result status. Returns InvalidArgument if there is no
+  ///   such column, if it is of a fixed-length type, or if the offsets
+  ///   don't fit @c data.
+  Status SetVariableLengthColumn(int idx, Slice offsets, Slice data) WARN_UNUSED_RESULT;
+
+  /// Set the non-null bitmap of a column. The cells of a column without
+  /// one are all non-NULL.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the table's schema.
+  /// @param [in] non_null_bitmap
+  ///   The column's non-null bitmap.
+  /// @return Operation result status. Returns InvalidArgument if there is no
+  ///   such column, if it is not nullable, or if the bitmap is too short.
+  Status SetNonNullBitmapForColumn(int idx, Slice non_null_bitmap) WARN_UNUSED_RESULT;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+  friend class KuduSession;
+
+  // Creates one write operation per row of the batch, and appends them to
+  // 'ops'. The caller takes ownership of the operations.
+  Status NewOperations(std::vector<KuduWriteOperation*>* ops) const;
+
+  Data* data_;
+  DISALLOW_COPY_AND_ASSIGN(KuduColumnarWriteBatch);
+};
+
+} // namespace client
+} // namespace kudu
+
+#endif
@@ -49,6 +49,7 @@
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/async_util.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
@@ -172,6 +173,11 @@ shared_ptr<TabletServerServiceProxy> RemoteTabletServer::proxy() const {
   return proxy_;
 }
 
+bool RemoteTabletServer::HasProxy() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return proxy_ != nullptr;
+}
+
 string RemoteTabletServer::ToString() const {
   string ret = uuid_;
   std::lock_guard<simple_spinlock> l(lock_);
@@ -509,6 +515,7 @@ void MetaCacheServerPicker::InitProxyCb(const ServerPickedCallback& callback,
 MetaCache::MetaCache(KuduClient* client,
                      ReplicaController::Visibility replica_visibility)
     : client_(client),
+      tablets_by_table_and_key_(std::make_shared<const TableTabletMaps>()),
       master_lookup_sem_(50),
       replica_visibility_(replica_visibility) {
 }
@@ -824,8 +831,7 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
       MonoDelta::FromMilliseconds(rpc.resp().ttl_millis());
 
   std::lock_guard<percpu_rwlock> l(lock_);
-  TabletMap& tablets_by_key = LookupOrInsert(&tablets_by_table_and_key_,
-                                             rpc.table_id(), TabletMap());
+  TabletMap tablets_by_key = CopyTabletMap(rpc.table_id());
 
   const auto& tablet_locations = rpc.resp().tablet_locations();
 
@@ -958,20 +964,42 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
     *cache_entry = FindFloorOrDie(tablets_by_key, cache_entry->upper_bound_partition_key());
     DCHECK(!cache_entry->is_non_covered_range());
   }
+  PublishTabletMap(rpc.table_id(), std::move(tablets_by_key));
   return Status::OK();
 }
 
+MetaCache::TabletMap MetaCache::CopyTabletMap(const string& table_id) const {
+  DCHECK(lock_.is_write_locked());
+  // Writers are serialized by lock_, so the snapshot can't change under us.
+  const auto* tablets = FindOrNull(*tablets_by_table_and_key_, table_id);
+  return tablets ? **tablets : TabletMap();
+}
+
+void MetaCache::PublishTabletMap(const string& table_id, TabletMap tablets) {
+  DCHECK(lock_.is_write_locked());
+  // Copying the outer map only copies a shared pointer per table; the tablet
+  // maps of the other tables are shared with the previous snapshot.
+  shared_ptr<TableTabletMaps> tables =
+      std::make_shared<TableTabletMaps>(*tablets_by_table_and_key_);
+  (*tables)[table_id] = std::make_shared<const TabletMap>(std::move(tablets));
+  std::atomic_store(&tablets_by_table_and_key_,
+                    shared_ptr<const TableTabletMaps>(std::move(tables)));
+}
+
 bool MetaCache::LookupEntryByKeyFastPath(const KuduTable* table,
                                          const string& partition_key,
                                          MetaCacheEntry* entry) {
-  shared_lock<rw_spinlock> l(lock_.get_lock());
-  const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
+  // The snapshot keeps the maps alive even if a writer replaces them
+  // concurrently; see the comment on 'tablets_by_table_and_key_'.
+  const shared_ptr<const TableTabletMaps> tables =
+      std::atomic_load(&tablets_by_table_and_key_);
+  const auto* tablets = FindOrNull(*tables, table->id());
   if (PREDICT_FALSE(!tablets)) {
     // No cache available for this table.
     return false;
   }
 
-  const MetaCacheEntry* e = FindFloorOrNull(*tablets, partition_key);
+  const MetaCacheEntry* e = FindFloorOrNull(**tablets, partition_key);
   if (PREDICT_FALSE(!e)) {
     // No tablets with a start partition key lower than 'partition_key'.
     return false;
@@ -1018,19 +1046,20 @@ void MetaCache::ClearNonCoveredRangeEntries(const std::string& table_id) {
   VLOG(3) << "Clearing non-covered range entries of table " << table_id;
   std::lock_guard<percpu_rwlock> l(lock_);
 
-  TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table_id);
-  if (PREDICT_FALSE(!tablets)) {
+  if (PREDICT_FALSE(!ContainsKey(*tablets_by_table_and_key_, table_id))) {
     // No cache available for this table.
     return;
   }
 
-  for (auto it = tablets->begin(); it != tablets->end();) {
+  TabletMap tablets = CopyTabletMap(table_id);
+  for (auto it = tablets.begin(); it != tablets.end();) {
     if (it->second.is_non_covered_range()) {
-      it = tablets->erase(it);
+      it = tablets.erase(it);
     } else {
       it++;
     }
   }
+  PublishTabletMap(table_id, std::move(tablets));
 }
 
 void MetaCache::ClearCache() {
@@ -1038,7 +1067,32 @@ void MetaCache::ClearCache() {
   std::lock_guard<percpu_rwlock> l(lock_);
   STLDeleteValues(&ts_cache_);
   tablets_by_id_.clear();
-  tablets_by_table_and_key_.clear();
+  std::atomic_store(&tablets_by_table_and_key_,
+                    std::make_shared<const TableTabletMaps>());
+}
+
+Status MetaCache::PrefetchTableLocations(const KuduTable* table,
+                                         const MonoTime& deadline) {
+  // Walk the table one tablet at a time. Every master round trip caches up to
+  // kFetchTabletsPerRangeLookup tablets, so all but one lookup per batch are
+  // served by the fast path.
+  string partition_key;
+  while (true) {
+    scoped_refptr<RemoteTablet> tablet;
+    Synchronizer sync;
+    LookupTabletByKey(table, partition_key, deadline, LookupType::kLowerBound,
+                      &tablet, sync.AsStatusCallback());
+    Status s = sync.Wait();
+    if (s.IsNotFound()) {
+      // Only non-covered ranges remain past 'partition_key'.
+      return Status::OK();
+    }
+    RETURN_NOT_OK(s);
+    partition_key = tablet->partition().partition_key_end();
+    if (partition_key.empty()) {
+      return Status::OK();
+    }
+  }
 }
 
 void MetaCache::LookupTabletByKey(const KuduTable* table,
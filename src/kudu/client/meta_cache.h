@@ -61,6 +61,7 @@ namespace client {
 
 class ClientTest_TestMasterLookupPermits_Test;
 class ClientTest_TestMetaCacheExpiry_Test;
+class ClientTest_TestPrefetchTabletLocations_Test;
 class KuduClient;
 class KuduTable;
 
@@ -99,6 +100,9 @@ class RemoteTabletServer {
   // be called prior to this.
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy() const;
 
+  // Returns whether InitProxy() has set up the proxy to this tablet server.
+  bool HasProxy() const;
+
   std::string ToString() const;
 
   void GetHostPorts(std::vector<HostPort>* host_ports) const;
@@ -405,6 +409,11 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
                          scoped_refptr<RemoteTablet>* remote_tablet,
                          const StatusCallback& callback);
 
+  // Looks up the locations of every tablet of 'table', so that subsequent
+  // lookups for the table are served from the cache. Tablets are fetched from
+  // the master in batches of kFetchTabletsPerRangeLookup.
+  Status PrefetchTableLocations(const KuduTable* table, const MonoTime& deadline);
+
   // Clears the non-covered range entries from a table's meta cache.
   void ClearNonCoveredRangeEntries(const std::string& table_id);
 
@@ -431,6 +440,7 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
 
   FRIEND_TEST(client::ClientTest, TestMasterLookupPermits);
   FRIEND_TEST(client::ClientTest, TestMetaCacheExpiry);
+  FRIEND_TEST(client::ClientTest, TestPrefetchTabletLocations);
 
   // Called on the slow LookupTablet path when the master responds. Populates
   // the tablet caches and returns a reference to the first one.
@@ -464,6 +474,23 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   // NOTE: Must be called with lock_ held.
   void UpdateTabletServer(const master::TSInfoPB& pb);
 
+  // Cache of tablets, keyed by partition key.
+  typedef std::map<std::string, MetaCacheEntry> TabletMap;
+
+  // Tablet caches, keyed by table id.
+  typedef std::unordered_map<std::string, std::shared_ptr<const TabletMap>> TableTabletMaps;
+
+  // Returns a copy of the cached tablets of 'table_id', or an empty map if
+  // nothing is cached for the table yet.
+  //
+  // NOTE: Must be called with lock_ held.
+  TabletMap CopyTabletMap(const std::string& table_id) const;
+
+  // Replaces the cached tablets of 'table_id' with 'tablets'.
+  //
+  // NOTE: Must be called with lock_ held.
+  void PublishTabletMap(const std::string& table_id, TabletMap tablets);
+
   KuduClient* client_;
 
   percpu_rwlock lock_;
@@ -477,15 +504,14 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   // Protected by lock_.
   TabletServerMap ts_cache_;
 
-  // Cache of tablets, keyed by partition key.
-  //
-  // Protected by lock_.
-  typedef std::map<std::string, MetaCacheEntry> TabletMap;
-
   // Cache of tablets and non-covered ranges, keyed by table id.
   //
-  // Protected by lock_.
-  std::unordered_map<std::string, TabletMap> tablets_by_table_and_key_;
+  // Both the outer and the per-table maps are immutable once published, so
+  // the fast lookup path reads them without taking lock_: it loads the current
+  // snapshot with std::atomic_load() and keeps it alive for the duration of
+  // the lookup. Writers serialize on lock_, build modified copies and install
+  // them with std::atomic_store().
+  std::shared_ptr<const TableTabletMaps> tablets_by_table_and_key_;
 
   // Cache of tablets, keyed by tablet ID.
   //
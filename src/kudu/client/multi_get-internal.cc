@@ -0,0 +1,218 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/client/multi_get-internal.h"
+
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/client/client-internal.h"
+#include "kudu/client/meta_cache.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/partition.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/async_util.h"
+#include "kudu/util/monotime.h"
+
+using std::set;
+using std::string;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+using rpc::RpcController;
+using tserver::MultiGetRequestPB;
+using tserver::MultiGetResponsePB;
+using tserver::TabletServerErrorPB;
+using tserver::TabletServerFeatures;
+
+namespace client {
+
+using internal::MetaCache;
+using internal::RemoteTabletServer;
+
+namespace {
+
+// The maximum number of keys looked up by a single request. The keys of a
+// tablet are split into requests of at most this many keys, which keeps each
+// response to a bounded size, well under the tablet servers' own limit.
+const size_t kMaxKeysPerRequest = 1000;
+
+} // anonymous namespace
+
+KuduMultiGet::Data::Data(KuduTable* table)
+    : configuration_(table),
+      open_(false),
+      next_tablet_(0) {
+}
+
+KuduMultiGet::Data::~Data() {
+}
+
+Status KuduMultiGet::Data::AddKey(const KuduPartialRow& key) {
+  Key k;
+  RETURN_NOT_OK(key.EncodeRowKey(&k.encoded_key));
+  RETURN_NOT_OK(configuration_.table().partition_schema().EncodeKey(key, &k.partition_key));
+  keys_.emplace_back(std::move(k));
+  return Status::OK();
+}
+
+Status KuduMultiGet::Data::Open() {
+  KuduClient* client = configuration_.table().client();
+  const MonoTime deadline = MonoTime::Now() + configuration_.timeout();
+  unordered_map<string, int> tablet_idx_by_id;
+  for (int i = 0; i < keys_.size(); i++) {
+    scoped_refptr<internal::RemoteTablet> tablet;
+    Synchronizer sync;
+    client->data_->meta_cache_->LookupTabletByKey(&configuration_.table(),
+                                                  keys_[i].partition_key,
+                                                  deadline,
+                                                  MetaCache::LookupType::kPoint,
+                                                  &tablet,
+                                                  sync.AsStatusCallback());
+    Status s = sync.Wait();
+    if (s.IsNotFound()) {
+      // The key is in a non-covered range, thus its row doesn't exist.
+      continue;
+    }
+    RETURN_NOT_OK(s);
+    // The keys go to the last request of their tablet, or to a new one once
+    // it's full.
+    auto ins = tablet_idx_by_id.emplace(tablet->tablet_id(), tablets_.size());
+    bool new_request = ins.second;
+    if (!new_request &&
+        tablets_[ins.first->second].encoded_keys.size() >= kMaxKeysPerRequest) {
+      ins.first->second = tablets_.size();
+      new_request = true;
+    }
+    if (new_request) {
+      tablets_.emplace_back();
+      tablets_.back().tablet = tablet;
+    }
+    TabletKeys* tablet_keys = &tablets_[ins.first->second];
+    tablet_keys->encoded_keys.emplace_back(std::move(keys_[i].encoded_key));
+    tablet_keys->key_indexes.push_back(i);
+  }
+  keys_.clear();
+  return Status::OK();
+}
+
+Status KuduMultiGet::Data::LookupNextTablet(RpcController* controller,
+                                            MultiGetResponsePB* resp,
+                                            vector<int>* key_indexes) {
+  DCHECK(HasMoreRows());
+  const TabletKeys& tablet_keys = tablets_[next_tablet_];
+  KuduClient* client = configuration_.table().client();
+  const MonoTime deadline = MonoTime::Now() + configuration_.timeout();
+
+  MultiGetRequestPB req;
+  req.set_tablet_id(tablet_keys.tablet->tablet_id());
+  for (const string& key : tablet_keys.encoded_keys) {
+    req.add_encoded_keys(key);
+  }
+  RETURN_NOT_OK(SchemaToColumnPBs(*configuration_.projection(), req.mutable_projected_columns(),
+                                  SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
+
+  set<string> blacklist;
+  for (int attempt = 1;; attempt++) {
+    RemoteTabletServer* ts;
+    vector<RemoteTabletServer*> candidates;
+    Status s = client->data_->GetTabletServer(client, tablet_keys.tablet,
+                                              configuration_.selection(), blacklist,
+                                              &candidates, &ts);
+    if (s.IsServiceUnavailable() && MonoTime::Now() < deadline) {
+      // All the replicas were tried: go over them again after a while, as
+      // for scans.
+      blacklist.clear();
+      SleepFor(MonoDelta::FromMilliseconds(attempt * 100));
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    controller->Reset();
+    controller->set_deadline(deadline);
+    controller->RequireServerFeature(TabletServerFeatures::MULTI_GET);
+    resp->Clear();
+    s = ts->proxy()->MultiGet(req, resp, controller);
+    if (s.ok() && !resp->has_error()) {
+      break;
+    }
+
+    bool retry = false;
+    if (!s.ok()) {
+      const rpc::ErrorStatusPB* err = controller->error_response();
+      if (s.IsRemoteError() && err && err->unsupported_feature_flags_size() > 0) {
+        return Status::NotSupported("tablet server does not support multi-get lookups",
+                                    s.ToString());
+      }
+      if (s.IsNetworkError()) {
+        client->data_->meta_cache_->MarkTSFailed(ts, s);
+        retry = true;
+      } else if (s.IsRemoteError() && err &&
+                 (err->code() == rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY ||
+                  err->code() == rpc::ErrorStatusPB::ERROR_UNAVAILABLE)) {
+        retry = true;
+      }
+    } else {
+      s = StatusFromPB(resp->error().status());
+      switch (resp->error().code()) {
+        case TabletServerErrorPB::TABLET_FAILED: // fall-through
+        case TabletServerErrorPB::TABLET_NOT_FOUND:
+          tablet_keys.tablet->MarkStale();
+          retry = true;
+          break;
+        case TabletServerErrorPB::TABLET_NOT_RUNNING:
+          retry = true;
+          break;
+        default:
+          break;
+      }
+    }
+    if (!retry || MonoTime::Now() >= deadline) {
+      return s.CloneAndPrepend(Substitute("multi-get of tablet $0 on $1 failed",
+                                          tablet_keys.tablet->tablet_id(), ts->ToString()));
+    }
+    VLOG(1) << Substitute("Retrying multi-get of tablet $0 on another replica: $1",
+                          tablet_keys.tablet->tablet_id(), s.ToString());
+    blacklist.insert(ts->permanent_uuid());
+  }
+
+  if (resp->has_propagated_timestamp()) {
+    client->data_->UpdateLatestObservedTimestamp(resp->propagated_timestamp());
+  }
+  for (uint32_t idx : resp->key_indexes()) {
+    if (PREDICT_FALSE(idx >= tablet_keys.key_indexes.size())) {
+      return Status::Corruption(Substitute("server returned the row of unknown key $0", idx));
+    }
+    key_indexes->push_back(tablet_keys.key_indexes[idx]);
+  }
+  next_tablet_++;
+  return Status::OK();
+}
+
+} // namespace client
+} // namespace kudu
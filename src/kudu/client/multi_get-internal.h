@@ -0,0 +1,95 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/client/scan_configuration.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+namespace rpc {
+class RpcController;
+} // namespace rpc
+
+namespace tserver {
+class MultiGetResponsePB;
+} // namespace tserver
+
+namespace client {
+
+namespace internal {
+class RemoteTablet;
+} // namespace internal
+
+class KuduMultiGet::Data {
+ public:
+  explicit Data(KuduTable* table);
+  ~Data();
+
+  // Encodes 'key' and queues it up for Open().
+  Status AddKey(const KuduPartialRow& key);
+
+  // Groups the keys by tablet.
+  Status Open();
+
+  bool HasMoreRows() const {
+    return next_tablet_ < tablets_.size();
+  }
+
+  // Looks up the keys of the next tablet, retrying on other replicas if
+  // needed. On success, the sidecars of '*resp' are held by 'controller', and
+  // the index of the key of each of its rows, as passed to AddKey(), is
+  // appended to 'key_indexes'.
+  Status LookupNextTablet(rpc::RpcController* controller,
+                          tserver::MultiGetResponsePB* resp,
+                          std::vector<int>* key_indexes);
+
+  ScanConfiguration configuration_;
+  bool open_;
+
+ private:
+  // A key added with AddKey().
+  struct Key {
+    std::string partition_key;
+    std::string encoded_key;
+  };
+
+  // The keys of a tablet looked up by one request. A tablet with many keys
+  // has several of these.
+  struct TabletKeys {
+    scoped_refptr<internal::RemoteTablet> tablet;
+    std::vector<std::string> encoded_keys;
+
+    // The index of each key in 'keys_'.
+    std::vector<int> key_indexes;
+  };
+
+  std::vector<Key> keys_;
+  std::vector<TabletKeys> tablets_;
+  size_t next_tablet_;
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+} // namespace client
+} // namespace kudu
@@ -0,0 +1,262 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/parallel_scanner.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/client/resource_metrics.h"
+#include "kudu/client/scan_configuration.h"
+#include "kudu/client/scanner-internal.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/thread.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace client {
+namespace internal {
+
+ParallelScanner::ParallelScanner(vector<unique_ptr<KuduScanToken>> tokens,
+                                 int max_concurrent_tablets,
+                                 bool preserve_tablet_order,
+                                 uint64_t row_format_flags,
+                                 bool prefetch_enabled,
+                                 const MonoDelta& target_batch_time,
+                                 ResourceMetrics* resource_metrics)
+    : max_concurrent_tablets_(max_concurrent_tablets),
+      preserve_tablet_order_(preserve_tablet_order),
+      row_format_flags_(row_format_flags),
+      prefetch_enabled_(prefetch_enabled),
+      target_batch_time_(target_batch_time),
+      resource_metrics_(resource_metrics),
+      has_snapshot_timestamp_(false),
+      snapshot_timestamp_(0),
+      cond_(&lock_),
+      tablets_(tokens.size()),
+      next_tablet_idx_(0),
+      current_tablet_idx_(0),
+      num_tablets_done_(0),
+      num_buffered_batches_(0),
+      shutdown_(false) {
+  for (size_t i = 0; i < tokens.size(); i++) {
+    tablets_[i].token = std::move(tokens[i]);
+  }
+}
+
+ParallelScanner::~ParallelScanner() {
+  Shutdown();
+}
+
+Status ParallelScanner::Open() {
+  if (tablets_.empty()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(OpenTabletScanner(0));
+  const ScanConfiguration& first_config = tablets_[0].scanner->data_->configuration();
+  if (first_config.read_mode() == KuduScanner::READ_AT_SNAPSHOT &&
+      first_config.has_snapshot_timestamp()) {
+    has_snapshot_timestamp_ = true;
+    snapshot_timestamp_ = first_config.snapshot_timestamp();
+  }
+
+  int num_workers = std::min<size_t>(max_concurrent_tablets_, tablets_.size());
+  for (int i = 0; i < num_workers; i++) {
+    scoped_refptr<Thread> worker;
+    Status s = Thread::Create("client", Substitute("parallel-scan-$0", i),
+                              &ParallelScanner::RunWorker, this, &worker);
+    if (PREDICT_FALSE(!s.ok())) {
+      Shutdown();
+      return s;
+    }
+    workers_.emplace_back(std::move(worker));
+  }
+  return Status::OK();
+}
+
+bool ParallelScanner::HasMoreRows() const {
+  MutexLock l(lock_);
+  return !status_.ok() ||
+      num_tablets_done_ < tablets_.size() ||
+      num_buffered_batches_ > 0;
+}
+
+Status ParallelScanner::NextBatch(unique_ptr<KuduScanBatch>* batch) {
+  Batch next;
+  RETURN_NOT_OK(NextBatchInternal(&next));
+  DCHECK(!next.columns);
+  *batch = std::move(next.rows);
+  return Status::OK();
+}
+
+Status ParallelScanner::NextBatch(unique_ptr<KuduColumnarScanBatch>* batch) {
+  Batch next;
+  RETURN_NOT_OK(NextBatchInternal(&next));
+  DCHECK(!next.rows);
+  *batch = std::move(next.columns);
+  return Status::OK();
+}
+
+void ParallelScanner::Shutdown() {
+  {
+    MutexLock l(lock_);
+    shutdown_ = true;
+    cond_.Broadcast();
+  }
+  for (const auto& worker : workers_) {
+    worker->Join();
+  }
+  workers_.clear();
+  for (auto& tablet : tablets_) {
+    if (tablet.scanner) {
+      tablet.scanner->Close();
+    }
+  }
+}
+
+Status ParallelScanner::OpenTabletScanner(size_t idx) {
+  TabletScan* tablet = &tablets_[idx];
+  KuduScanner* scanner;
+  RETURN_NOT_OK(tablet->token->IntoKuduScanner(&scanner));
+  tablet->scanner.reset(scanner);
+  if (row_format_flags_ != KuduScanner::NO_FLAGS) {
+    RETURN_NOT_OK(scanner->SetRowFormatFlags(row_format_flags_));
+  }
+  RETURN_NOT_OK(scanner->SetPrefetchEnabled(prefetch_enabled_));
+  if (target_batch_time_.Initialized()) {
+    RETURN_NOT_OK(scanner->SetAdaptiveBatchSizing(target_batch_time_.ToMilliseconds()));
+  }
+  if (has_snapshot_timestamp_) {
+    RETURN_NOT_OK(scanner->SetSnapshotRaw(snapshot_timestamp_));
+  }
+  return scanner->Open();
+}
+
+void ParallelScanner::RunWorker() {
+  while (true) {
+    size_t idx;
+    {
+      MutexLock l(lock_);
+      if (shutdown_ || !status_.ok() || next_tablet_idx_ == tablets_.size()) {
+        return;
+      }
+      idx = next_tablet_idx_++;
+    }
+
+    Status s = ScanTablet(idx);
+    if (tablets_[idx].scanner) {
+      for (const auto& metric : tablets_[idx].scanner->GetResourceMetrics().Get()) {
+        resource_metrics_->Increment(metric.first, metric.second);
+      }
+    }
+
+    MutexLock l(lock_);
+    if (PREDICT_FALSE(!s.ok()) && status_.ok()) {
+      status_ = s.CloneAndPrepend(Substitute(
+          "unable to scan tablet $0", tablets_[idx].token->tablet().id()));
+    }
+    tablets_[idx].done = true;
+    num_tablets_done_++;
+    cond_.Broadcast();
+  }
+}
+
+Status ParallelScanner::ScanTablet(size_t idx) {
+  TabletScan* tablet = &tablets_[idx];
+  if (!tablet->scanner) {
+    RETURN_NOT_OK(OpenTabletScanner(idx));
+  }
+  KuduScanner* scanner = tablet->scanner.get();
+  const bool columnar = row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT;
+  while (scanner->HasMoreRows()) {
+    Batch batch;
+    if (columnar) {
+      batch.columns.reset(new KuduColumnarScanBatch);
+      RETURN_NOT_OK(scanner->NextBatch(batch.columns.get()));
+      if (batch.columns->NumRows() == 0) continue;
+    } else {
+      batch.rows.reset(new KuduScanBatch);
+      RETURN_NOT_OK(scanner->NextBatch(batch.rows.get()));
+      if (batch.rows->NumRows() == 0) continue;
+    }
+
+    MutexLock l(lock_);
+    while (!shutdown_ && tablet->batches.size() >= kMaxBufferedBatchesPerTablet) {
+      cond_.Wait();
+    }
+    if (shutdown_) {
+      return Status::OK();
+    }
+    tablet->batches.emplace_back(std::move(batch));
+    if (!preserve_tablet_order_) {
+      arrivals_.push_back(idx);
+    }
+    num_buffered_batches_++;
+    cond_.Broadcast();
+  }
+  return Status::OK();
+}
+
+Status ParallelScanner::NextBatchInternal(Batch* batch) {
+  MutexLock l(lock_);
+  while (true) {
+    RETURN_NOT_OK(status_);
+    size_t idx;
+    if (preserve_tablet_order_) {
+      while (current_tablet_idx_ < tablets_.size() &&
+             tablets_[current_tablet_idx_].done &&
+             tablets_[current_tablet_idx_].batches.empty()) {
+        current_tablet_idx_++;
+      }
+      if (current_tablet_idx_ == tablets_.size()) {
+        return Status::OK();
+      }
+      idx = current_tablet_idx_;
+    } else {
+      if (arrivals_.empty() && num_tablets_done_ == tablets_.size()) {
+        return Status::OK();
+      }
+      idx = arrivals_.empty() ? tablets_.size() : arrivals_.front();
+    }
+
+    if (idx < tablets_.size() && !tablets_[idx].batches.empty()) {
+      if (!preserve_tablet_order_) {
+        arrivals_.pop_front();
+      }
+      *batch = std::move(tablets_[idx].batches.front());
+      tablets_[idx].batches.pop_front();
+      num_buffered_batches_--;
+      // Wake up the tablet's worker if it's waiting for buffer space.
+      cond_.Broadcast();
+      return Status::OK();
+    }
+    cond_.Wait();
+  }
+}
+
+} // namespace internal
+} // namespace client
+} // namespace kudu
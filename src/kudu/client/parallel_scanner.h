@@ -0,0 +1,177 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/client/columnar_scan_batch.h"
+#include "kudu/client/scan_batch.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+
+namespace client {
+
+class ResourceMetrics;
+
+namespace internal {
+
+// Scans several tablets concurrently on behalf of a KuduScanner. See
+// KuduScanner::SetTabletParallelism().
+//
+// Each tablet is scanned by its own KuduScanner, built from the tablet's scan
+// token and driven by one of up to 'max_concurrent_tablets' worker threads.
+// The workers buffer a bounded number of batches per tablet ahead of the
+// application, which takes them either in the order they arrive or, if
+// 'preserve_tablet_order' is set, tablet by tablet in token order. Batches of
+// a single tablet are always returned in the order the tablet produced them.
+//
+// This class is thread-safe.
+class ParallelScanner {
+ public:
+  // 'tokens' are the tokens of the tablets to scan, in scan order. The
+  // scanners built from them are configured with 'row_format_flags',
+  // 'prefetch_enabled' and, if initialized, 'target_batch_time', which scan
+  // tokens don't carry. The resource metrics of each tablet's scan are added
+  // to 'resource_metrics' once the tablet has been scanned.
+  ParallelScanner(std::vector<std::unique_ptr<KuduScanToken>> tokens,
+                  int max_concurrent_tablets,
+                  bool preserve_tablet_order,
+                  uint64_t row_format_flags,
+                  bool prefetch_enabled,
+                  const MonoDelta& target_batch_time,
+                  ResourceMetrics* resource_metrics);
+
+  // Calls Shutdown().
+  ~ParallelScanner();
+
+  // Opens the scanner of the first tablet and starts the worker threads.
+  //
+  // The first tablet is opened before any other: if the scan is at a snapshot
+  // chosen by the server, the other tablets are scanned at the snapshot
+  // timestamp the first tablet's server chose.
+  Status Open();
+
+  // Returns whether any tablet may still return rows, or an error is pending.
+  bool HasMoreRows() const;
+
+  // Waits for the next batch and sets '*batch' to it. '*batch' is reset if
+  // there are no more rows. Returns the first error encountered by any of the
+  // tablets' scans, if any.
+  //
+  // Only the method matching the scan's row format flags may be called.
+  Status NextBatch(std::unique_ptr<KuduScanBatch>* batch);
+  Status NextBatch(std::unique_ptr<KuduColumnarScanBatch>* batch);
+
+  // Stops and joins the worker threads and closes the tablets' scanners. The
+  // scanners themselves are kept alive since the returned batches reference
+  // their projections.
+  void Shutdown();
+
+ private:
+  // Maximum number of batches buffered for each tablet.
+  static const size_t kMaxBufferedBatchesPerTablet = 2;
+
+  // A batch in either layout; exactly one of the members is set.
+  struct Batch {
+    std::unique_ptr<KuduScanBatch> rows;
+    std::unique_ptr<KuduColumnarScanBatch> columns;
+  };
+
+  struct TabletScan {
+    // Only accessed by the worker scanning the tablet, or by Open() and
+    // Shutdown() while no worker runs.
+    std::unique_ptr<KuduScanToken> token;
+    std::unique_ptr<KuduScanner> scanner;
+
+    // Protected by 'lock_'.
+    std::deque<Batch> batches;
+    bool done = false;
+  };
+
+  // Builds and opens the scanner of the tablet at 'idx'.
+  Status OpenTabletScanner(size_t idx);
+
+  // Body of the worker threads: scans tablets until there are none left.
+  void RunWorker();
+
+  // Scans the tablet at 'idx', buffering its batches.
+  Status ScanTablet(size_t idx);
+
+  // Waits for the next batch to return and moves it to '*batch', leaving
+  // '*batch' empty if there are no more rows.
+  Status NextBatchInternal(Batch* batch);
+
+  const int max_concurrent_tablets_;
+  const bool preserve_tablet_order_;
+  const uint64_t row_format_flags_;
+  const bool prefetch_enabled_;
+  const MonoDelta target_batch_time_;
+  ResourceMetrics* const resource_metrics_;
+
+  // The snapshot timestamp chosen for the first tablet, if the scan is at a
+  // snapshot chosen by the server.
+  bool has_snapshot_timestamp_;
+  uint64_t snapshot_timestamp_;
+
+  std::vector<scoped_refptr<Thread>> workers_;
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // The tablets, in scan order. The vector itself isn't modified after
+  // construction.
+  std::vector<TabletScan> tablets_;
+
+  // The following are protected by 'lock_'.
+
+  // The index of the next tablet to hand to a worker.
+  size_t next_tablet_idx_;
+
+  // The index of the tablet whose batches are returned next, when preserving
+  // the tablet order.
+  size_t current_tablet_idx_;
+
+  // The tablets which buffered a batch, in arrival order, when not preserving
+  // the tablet order. A tablet has one entry per buffered batch.
+  std::deque<size_t> arrivals_;
+
+  size_t num_tablets_done_;
+  size_t num_buffered_batches_;
+  bool shutdown_;
+
+  // The first error encountered by any tablet's scan.
+  Status status_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScanner);
+};
+
+} // namespace internal
+} // namespace client
+} // namespace kudu
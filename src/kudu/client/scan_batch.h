@@ -148,6 +148,7 @@ class KUDU_EXPORT KuduScanBatch {
 
  private:
   class KUDU_NO_EXPORT Data;
+  friend class KuduMultiGet;
   friend class KuduScanner;
   friend class tools::ReplicaDumper;
 
@@ -26,9 +26,11 @@
 #include "kudu/client/scan_predicate-internal.h"
 #include "kudu/client/scan_predicate.h"
 #include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/strings/substitute.h"
 
@@ -55,7 +57,9 @@ ScanConfiguration::ScanConfiguration(KuduTable* table)
       lower_bound_propagation_timestamp_(kNoTimestamp),
       timeout_(MonoDelta::FromMilliseconds(KuduScanner::kScanTimeoutMillis)),
       arena_(256),
-      row_format_flags_(KuduScanner::NO_FLAGS) {
+      row_format_flags_(KuduScanner::NO_FLAGS),
+      diff_scan_start_timestamp_(kNoTimestamp),
+      report_column_metrics_(false) {
 }
 
 Status ScanConfiguration::SetProjectedColumnNames(const vector<string>& col_names) {
@@ -202,6 +206,89 @@ Status ScanConfiguration::SetLimit(int64_t limit) {
   return Status::OK();
 }
 
+Status ScanConfiguration::AddAggregate(KuduScanner::AggregateFunction function,
+                                       const string& col_name) {
+  tserver::AggregatePB pb;
+  switch (function) {
+    case KuduScanner::COUNT:
+      pb.set_function(tserver::AggregatePB::COUNT);
+      break;
+    case KuduScanner::SUM:
+      pb.set_function(tserver::AggregatePB::SUM);
+      break;
+    case KuduScanner::MIN:
+      pb.set_function(tserver::AggregatePB::MIN);
+      break;
+    case KuduScanner::MAX:
+      pb.set_function(tserver::AggregatePB::MAX);
+      break;
+    default:
+      return Status::InvalidArgument(
+          strings::Substitute("Invalid aggregate function: $0", function));
+  }
+
+  if (col_name.empty()) {
+    if (function != KuduScanner::COUNT) {
+      return Status::InvalidArgument("Only COUNT may be computed without a column");
+    }
+  } else {
+    const Schema& schema = *table().schema().schema_;
+    int idx = schema.find_column(col_name);
+    if (idx == Schema::kColumnNotFound) {
+      return Status::NotFound(strings::Substitute(
+            "Column: \"$0\" was not found in the table schema.", col_name));
+    }
+    if (function != KuduScanner::COUNT) {
+      switch (schema.column(idx).type_info()->type()) {
+        case INT8:
+        case INT16:
+        case INT32:
+        case INT64:
+        case UNIXTIME_MICROS:
+        case FLOAT:
+        case DOUBLE:
+          break;
+        default:
+          return Status::InvalidArgument(strings::Substitute(
+              "Cannot aggregate column \"$0\" of type $1", col_name,
+              schema.column(idx).type_info()->name()));
+      }
+    }
+    pb.set_column(col_name);
+  }
+  aggregates_.push_back(std::move(pb));
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetTopN(const string& col_name, int64_t n, bool descending) {
+  if (table().schema().schema_->find_column(col_name) == Schema::kColumnNotFound) {
+    return Status::NotFound(strings::Substitute(
+          "Column: \"$0\" was not found in the table schema.", col_name));
+  }
+  if (n <= 0) {
+    return Status::InvalidArgument("Top-N scans must ask for a positive number of rows");
+  }
+  top_n_.set_column(col_name);
+  top_n_.set_limit(n);
+  top_n_.set_descending(descending);
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetDiffScan(uint64_t start_timestamp, uint64_t end_timestamp) {
+  if (start_timestamp == 0) {
+    return Status::InvalidArgument("Diff scan start timestamp must be bigger than 0");
+  }
+  if (start_timestamp > end_timestamp) {
+    return Status::InvalidArgument(strings::Substitute(
+        "Diff scan start timestamp $0 is later than its end timestamp $1",
+        start_timestamp, end_timestamp));
+  }
+  RETURN_NOT_OK(SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+  SetSnapshotRaw(end_timestamp);
+  diff_scan_start_timestamp_ = start_timestamp;
+  return Status::OK();
+}
+
 void ScanConfiguration::OptimizeScanSpec() {
   spec_.OptimizeScan(*table_->schema().schema_,
                      &arena_,
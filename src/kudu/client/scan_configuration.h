@@ -27,6 +27,7 @@
 #include "kudu/client/schema.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/gutil/port.h"
+#include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/auto_release_pool.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
@@ -100,6 +101,19 @@ class ScanConfiguration {
 
   Status SetLimit(int64_t limit);
 
+  Status AddAggregate(KuduScanner::AggregateFunction function,
+                      const std::string& col_name) WARN_UNUSED_RESULT;
+
+  Status SetTopN(const std::string& col_name, int64_t n, bool descending) WARN_UNUSED_RESULT;
+
+  // Sets the READ_AT_SNAPSHOT mode, and the snapshot timestamp to
+  // 'end_timestamp'.
+  Status SetDiffScan(uint64_t start_timestamp, uint64_t end_timestamp) WARN_UNUSED_RESULT;
+
+  void SetReportColumnMetrics(bool report) {
+    report_column_metrics_ = report;
+  }
+
   void OptimizeScanSpec();
 
   const KuduTable& table() {
@@ -171,6 +185,31 @@ class ScanConfiguration {
     return row_format_flags_;
   }
 
+  const std::vector<tserver::AggregatePB>& aggregates() const {
+    return aggregates_;
+  }
+
+  bool has_top_n() const {
+    return top_n_.has_column();
+  }
+
+  const tserver::TopNPB& top_n() const {
+    return top_n_;
+  }
+
+  bool has_diff_scan_start_timestamp() const {
+    return diff_scan_start_timestamp_ != kNoTimestamp;
+  }
+
+  uint64_t diff_scan_start_timestamp() const {
+    CHECK(has_diff_scan_start_timestamp());
+    return diff_scan_start_timestamp_;
+  }
+
+  bool report_column_metrics() const {
+    return report_column_metrics_;
+  }
+
   Arena* arena() {
     return &arena_;
   }
@@ -215,6 +254,17 @@ class ScanConfiguration {
   AutoReleasePool pool_;
 
   uint64_t row_format_flags_;
+
+  std::vector<tserver::AggregatePB> aggregates_;
+
+  // Set if the scan is a top-N scan.
+  tserver::TopNPB top_n_;
+
+  // Set if the scan is a diff scan.
+  uint64_t diff_scan_start_timestamp_;
+
+  // Whether the servers report the resource metrics of each column.
+  bool report_column_metrics_;
 };
 
 } // namespace client
@@ -17,6 +17,7 @@
 #ifndef KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 #define KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -161,6 +162,35 @@ class IsNullPredicateData : public KuduPredicate::Data {
   ColumnSchema col_;
 };
 
+class StringMatchPredicateData : public KuduPredicate::Data {
+ public:
+  enum class MatchType {
+    kPrefix,
+    kLike,
+  };
+
+  StringMatchPredicateData(ColumnSchema col, MatchType type, std::string pattern)
+      : col_(std::move(col)),
+        type_(type),
+        pattern_(std::move(pattern)) {
+  }
+
+  Status AddToScanSpec(ScanSpec* spec, Arena* arena) override;
+
+  StringMatchPredicateData* Clone() const override {
+    return new StringMatchPredicateData(col_, type_, pattern_);
+  }
+
+ private:
+  friend class KuduScanner;
+
+  ColumnSchema col_;
+  MatchType type_;
+
+  // The prefix or the LIKE pattern.
+  std::string pattern_;
+};
+
 } // namespace client
 } // namespace kudu
 #endif /* KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H */
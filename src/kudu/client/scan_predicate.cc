@@ -148,5 +148,20 @@ Status InListPredicateData::AddToScanSpec(ScanSpec* spec, Arena* /*arena*/) {
   return Status::OK();
 }
 
+Status StringMatchPredicateData::AddToScanSpec(ScanSpec* spec, Arena* arena) {
+  const char* op = type_ == MatchType::kPrefix ? "prefix" : "LIKE";
+  if (col_.type_info()->physical_type() != BINARY) {
+    return Status::InvalidArgument(
+        Substitute("can't use a $0 predicate on non-string column $1 of type $2",
+                   op, col_.name(), col_.type_info()->name()));
+  }
+  if (type_ == MatchType::kPrefix) {
+    spec->AddPredicate(ColumnPredicate::Prefix(col_, pattern_, arena));
+  } else {
+    spec->AddPredicate(ColumnPredicate::Like(col_, pattern_, arena));
+  }
+  return Status::OK();
+}
+
 } // namespace client
 } // namespace kudu
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -48,21 +49,31 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+using std::set;
 using std::string;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
 namespace kudu {
+
+using rpc::RpcController;
+using tserver::SplitKeyRangeRequestPB;
+using tserver::SplitKeyRangeResponsePB;
+
 namespace client {
 
 using internal::MetaCache;
+using internal::RemoteTabletServer;
 
 KuduScanToken::Data::Data(KuduTable* table,
                           ScanTokenPB message,
@@ -210,61 +221,101 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
 }
 
 KuduScanTokenBuilder::Data::Data(KuduTable* table)
-    : configuration_(table) {
+    : configuration_(table),
+      split_size_bytes_(0) {
 }
 
 Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
-  KuduTable* table = configuration_.table_;
+  return BuildTokens(&configuration_, split_size_bytes_, tokens);
+}
+
+namespace {
+
+// Asks the tablet server 'ts' to split the primary key range of the token
+// 'pb' of tablet 'tablet_id' into chunks of about 'split_size_bytes' of its
+// projected columns.
+Status SplitTabletKeyRange(RemoteTabletServer* ts,
+                           const string& tablet_id,
+                           const ScanTokenPB& pb,
+                           uint64_t split_size_bytes,
+                           const MonoTime& deadline,
+                           SplitKeyRangeResponsePB* resp) {
+  SplitKeyRangeRequestPB req;
+  req.set_tablet_id(tablet_id);
+  if (pb.has_lower_bound_primary_key()) {
+    req.set_start_primary_key(pb.lower_bound_primary_key());
+  }
+  if (pb.has_upper_bound_primary_key()) {
+    req.set_stop_primary_key(pb.upper_bound_primary_key());
+  }
+  req.set_target_chunk_size_bytes(split_size_bytes);
+  *req.mutable_columns() = pb.projected_columns();
+
+  RpcController rpc;
+  rpc.set_deadline(deadline);
+  RETURN_NOT_OK(ts->proxy()->SplitKeyRange(req, resp, &rpc));
+  if (resp->has_error()) {
+    return StatusFromPB(resp->error().status());
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status KuduScanTokenBuilder::Data::BuildTokens(ScanConfiguration* configuration,
+                                               uint64_t split_size_bytes,
+                                               vector<KuduScanToken*>* tokens) {
+  KuduTable* table = configuration->table_;
   KuduClient* client = table->client();
-  configuration_.OptimizeScanSpec();
+  configuration->OptimizeScanSpec();
 
-  if (configuration_.spec().CanShortCircuit()) {
+  if (configuration->spec().CanShortCircuit()) {
     return Status::OK();
   }
 
   ScanTokenPB pb;
 
   pb.set_table_name(table->name());
-  RETURN_NOT_OK(SchemaToColumnPBs(*configuration_.projection(), pb.mutable_projected_columns(),
+  RETURN_NOT_OK(SchemaToColumnPBs(*configuration->projection(), pb.mutable_projected_columns(),
                                   SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
 
-  if (configuration_.spec().lower_bound_key()) {
+  if (configuration->spec().lower_bound_key()) {
     pb.mutable_lower_bound_primary_key()->assign(
-      reinterpret_cast<const char*>(configuration_.spec().lower_bound_key()->encoded_key().data()),
-      configuration_.spec().lower_bound_key()->encoded_key().size());
+      reinterpret_cast<const char*>(configuration->spec().lower_bound_key()->encoded_key().data()),
+      configuration->spec().lower_bound_key()->encoded_key().size());
   } else {
     pb.clear_lower_bound_primary_key();
   }
-  if (configuration_.spec().exclusive_upper_bound_key()) {
+  if (configuration->spec().exclusive_upper_bound_key()) {
     pb.mutable_upper_bound_primary_key()->assign(reinterpret_cast<const char*>(
-          configuration_.spec().exclusive_upper_bound_key()->encoded_key().data()),
-      configuration_.spec().exclusive_upper_bound_key()->encoded_key().size());
+          configuration->spec().exclusive_upper_bound_key()->encoded_key().data()),
+      configuration->spec().exclusive_upper_bound_key()->encoded_key().size());
   } else {
     pb.clear_upper_bound_primary_key();
   }
 
-  for (const auto& predicate_pair : configuration_.spec().predicates()) {
+  for (const auto& predicate_pair : configuration->spec().predicates()) {
     ColumnPredicateToPB(predicate_pair.second, pb.add_column_predicates());
   }
 
-  const KuduScanner::ReadMode read_mode = configuration_.read_mode();
+  const KuduScanner::ReadMode read_mode = configuration->read_mode();
   switch (read_mode) {
     case KuduScanner::READ_LATEST:
       pb.set_read_mode(kudu::READ_LATEST);
-      if (configuration_.has_snapshot_timestamp()) {
+      if (configuration->has_snapshot_timestamp()) {
         return Status::InvalidArgument("Snapshot timestamp should only be configured "
                                        "for READ_AT_SNAPSHOT scan mode.");
       }
       break;
     case KuduScanner::READ_AT_SNAPSHOT:
       pb.set_read_mode(kudu::READ_AT_SNAPSHOT);
-      if (configuration_.has_snapshot_timestamp()) {
-        pb.set_snap_timestamp(configuration_.snapshot_timestamp());
+      if (configuration->has_snapshot_timestamp()) {
+        pb.set_snap_timestamp(configuration->snapshot_timestamp());
       }
       break;
     case KuduScanner::READ_YOUR_WRITES:
       pb.set_read_mode(kudu::READ_YOUR_WRITES);
-      if (configuration_.has_snapshot_timestamp()) {
+      if (configuration->has_snapshot_timestamp()) {
         return Status::InvalidArgument("Snapshot timestamp should only be configured "
                                        "for READ_AT_SNAPSHOT scan mode.");
       }
@@ -273,19 +324,19 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
       LOG(FATAL) << Substitute("$0: unexpected read mode", read_mode);
   }
 
-  pb.set_cache_blocks(configuration_.spec().cache_blocks());
-  pb.set_fault_tolerant(configuration_.is_fault_tolerant());
+  pb.set_cache_blocks(configuration->spec().cache_blocks());
+  pb.set_fault_tolerant(configuration->is_fault_tolerant());
   pb.set_propagated_timestamp(client->GetLatestObservedTimestamp());
-  pb.set_scan_request_timeout_ms(configuration_.timeout().ToMilliseconds());
+  pb.set_scan_request_timeout_ms(configuration->timeout().ToMilliseconds());
 
-  if (configuration_.has_batch_size_bytes()) {
-    pb.set_batch_size_bytes(configuration_.batch_size_bytes());
+  if (configuration->has_batch_size_bytes()) {
+    pb.set_batch_size_bytes(configuration->batch_size_bytes());
   }
 
   MonoTime deadline = MonoTime::Now() + client->default_admin_operation_timeout();
 
   PartitionPruner pruner;
-  pruner.Init(*table->schema().schema_, table->partition_schema(), configuration_.spec());
+  pruner.Init(*table->schema().schema_, table->partition_schema(), configuration->spec());
   while (pruner.HasMorePartitionKeyRanges()) {
     scoped_refptr<internal::RemoteTablet> tablet;
     Synchronizer sync;
@@ -317,34 +368,35 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
     vector<internal::RemoteReplica> replicas;
     tablet->GetRemoteReplicas(&replicas);
 
-    vector<const KuduReplica*> client_replicas;
-    ElementDeleter deleter(&client_replicas);
-
-    // Convert the replicas from their internal format to something appropriate
-    // for clients.
-    for (const auto& r : replicas) {
-      vector<HostPort> host_ports;
-      r.ts->GetHostPorts(&host_ports);
-      if (host_ports.empty()) {
-        return Status::IllegalState(Substitute(
-            "No host found for tablet server $0", r.ts->ToString()));
+    // Converts the replicas from their internal format to something
+    // appropriate for clients. Each token owns its own copy.
+    auto new_client_tablet = [&](unique_ptr<KuduTablet>* client_tablet) -> Status {
+      vector<const KuduReplica*> client_replicas;
+      ElementDeleter deleter(&client_replicas);
+      for (const auto& r : replicas) {
+        vector<HostPort> host_ports;
+        r.ts->GetHostPorts(&host_ports);
+        if (host_ports.empty()) {
+          return Status::IllegalState(Substitute(
+              "No host found for tablet server $0", r.ts->ToString()));
+        }
+        unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
+        client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
+                                                      host_ports[0],
+                                                      r.ts->location());
+        bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
+        bool is_voter = is_leader || r.role == consensus::RaftPeerPB::FOLLOWER;
+        unique_ptr<KuduReplica> client_replica(new KuduReplica);
+        client_replica->data_ = new KuduReplica::Data(is_leader, is_voter,
+                                                      std::move(client_ts));
+        client_replicas.push_back(client_replica.release());
       }
-      unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
-      client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
-                                                    host_ports[0],
-                                                    r.ts->location());
-      bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
-      bool is_voter = is_leader || r.role == consensus::RaftPeerPB::FOLLOWER;
-      unique_ptr<KuduReplica> client_replica(new KuduReplica);
-      client_replica->data_ = new KuduReplica::Data(is_leader, is_voter,
-                                                    std::move(client_ts));
-      client_replicas.push_back(client_replica.release());
-    }
-
-    unique_ptr<KuduTablet> client_tablet(new KuduTablet);
-    client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
-                                                std::move(client_replicas));
-    client_replicas.clear();
+      client_tablet->reset(new KuduTablet);
+      (*client_tablet)->data_ = new KuduTablet::Data(tablet->tablet_id(),
+                                                     std::move(client_replicas));
+      client_replicas.clear();
+      return Status::OK();
+    };
 
     // Create the scan token itself.
     ScanTokenPB message;
@@ -353,12 +405,47 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
         tablet->partition().partition_key_start());
     message.set_upper_bound_partition_key(
         tablet->partition().partition_key_end());
-    unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
-    client_scan_token->data_ =
-        new KuduScanToken::Data(table,
-                                std::move(message),
-                                std::move(client_tablet));
-    tokens->push_back(client_scan_token.release());
+
+    // Split large tablets into one token per chunk of their key range, so
+    // that each token scans about the same amount of data.
+    vector<ScanTokenPB> messages;
+    if (split_size_bytes > 0) {
+      RemoteTabletServer* ts;
+      vector<RemoteTabletServer*> candidates;
+      SplitKeyRangeResponsePB resp;
+      Status s = client->data_->GetTabletServer(client, tablet, configuration->selection(),
+                                                set<string>(), &candidates, &ts);
+      if (s.ok()) {
+        s = SplitTabletKeyRange(ts, tablet->tablet_id(), message, split_size_bytes,
+                                deadline, &resp);
+      }
+      RETURN_NOT_OK_PREPEND(s, Substitute("Unable to split the key range of tablet $0",
+                                          tablet->tablet_id()));
+      for (const auto& range : resp.ranges()) {
+        ScanTokenPB range_message(message);
+        if (!range.start_primary_key().empty()) {
+          range_message.set_lower_bound_primary_key(range.start_primary_key());
+        }
+        if (!range.stop_primary_key().empty()) {
+          range_message.set_upper_bound_primary_key(range.stop_primary_key());
+        }
+        messages.emplace_back(std::move(range_message));
+      }
+    }
+    if (messages.empty()) {
+      messages.emplace_back(std::move(message));
+    }
+
+    for (auto& m : messages) {
+      unique_ptr<KuduTablet> client_tablet;
+      RETURN_NOT_OK(new_client_tablet(&client_tablet));
+      unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
+      client_scan_token->data_ =
+          new KuduScanToken::Data(table,
+                                  std::move(m),
+                                  std::move(client_tablet));
+      tokens->push_back(client_scan_token.release());
+    }
     pruner.RemovePartitionKeyRange(tablet->partition().partition_key_end());
   }
   return Status::OK();
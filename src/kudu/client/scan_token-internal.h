@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -64,6 +65,21 @@ class KuduScanTokenBuilder::Data {
 
   Status Build(std::vector<KuduScanToken*>* tokens);
 
+  // Builds one token per tablet scanned by 'configuration', optimizing its
+  // scan spec as a side effect. Used by Build() and by scanners which scan
+  // several tablets concurrently.
+  //
+  // If 'split_size_bytes' is not 0, the tablets' primary key ranges are
+  // split into chunks of about that many bytes of the projected columns, as
+  // estimated by the tablet servers, with one token per chunk.
+  static Status BuildTokens(ScanConfiguration* configuration,
+                            uint64_t split_size_bytes,
+                            std::vector<KuduScanToken*>* tokens);
+
+  void set_split_size_bytes(uint64_t split_size_bytes) {
+    split_size_bytes_ = split_size_bytes;
+  }
+
   const ScanConfiguration& configuration() const {
     return configuration_;
   }
@@ -74,6 +90,8 @@ class KuduScanTokenBuilder::Data {
 
  private:
   ScanConfiguration configuration_;
+
+  uint64_t split_size_bytes_;
 };
 
 } // namespace client
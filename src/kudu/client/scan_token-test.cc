@@ -43,8 +43,12 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/mini-cluster/internal_mini_cluster.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
@@ -64,6 +68,7 @@ using std::thread;
 using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
+using tablet::TabletReplica;
 using tserver::MiniTabletServer;
 
 class ScanTokenTest : public KuduTest {
@@ -138,6 +143,13 @@ class ScanTokenTest : public KuduTest {
     ASSERT_EQ(tokens.size(), tablet_ids.size());
   }
 
+  void FlushTablet(const string& tablet_id) {
+    scoped_refptr<TabletReplica> tablet_replica;
+    ASSERT_TRUE(cluster_->mini_tablet_server(0)->server()->tablet_manager()->LookupTablet(
+        tablet_id, &tablet_replica));
+    ASSERT_OK(tablet_replica->tablet()->Flush());
+  }
+
   shared_ptr<KuduClient> client_;
   gscoped_ptr<InternalMiniCluster> cluster_;
 };
@@ -552,6 +564,77 @@ TEST_P(TimestampPropagationParamTest, Test) {
 INSTANTIATE_TEST_CASE_P(Params, TimestampPropagationParamTest,
                         testing::ValuesIn(read_modes));
 
+// Tests that a split size splits a tablet into several tokens, which together
+// scan all of its rows.
+TEST_F(ScanTokenTest, TestScanTokensWithSplitSize) {
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("key")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    builder.AddColumn("val")->NotNull()->Type(KuduColumnSchema::STRING);
+    ASSERT_OK(builder.Build(&schema));
+  }
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("split-table")
+                            .schema(&schema)
+                            .set_range_partition_columns({ "key" })
+                            .num_replicas(1)
+                            .Create());
+    ASSERT_OK(client_->OpenTable("split-table", &table));
+  }
+
+  // Write the rows in several flushes, so that the tablet has several
+  // rowsets with disjoint key ranges.
+  shared_ptr<KuduSession> session = client_->NewSession();
+  session->SetTimeoutMillis(10000);
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  const int kNumFlushes = 5;
+  const int kRowsPerFlush = 100;
+  string tablet_id;
+  for (int f = 0; f < kNumFlushes; f++) {
+    for (int i = f * kRowsPerFlush; i < (f + 1) * kRowsPerFlush; i++) {
+      unique_ptr<KuduInsert> insert(table->NewInsert());
+      ASSERT_OK(insert->mutable_row()->SetInt64("key", i));
+      ASSERT_OK(insert->mutable_row()->SetStringCopy("val", string(100, 'x')));
+      ASSERT_OK(session->Apply(insert.release()));
+    }
+    ASSERT_OK(session->Flush());
+    if (tablet_id.empty()) {
+      vector<KuduScanToken*> tokens;
+      ElementDeleter deleter(&tokens);
+      ASSERT_OK(KuduScanTokenBuilder(table.get()).Build(&tokens));
+      ASSERT_EQ(1, tokens.size());
+      tablet_id = tokens[0]->tablet().id();
+    }
+    NO_FATALS(FlushTablet(tablet_id));
+  }
+
+  {
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetSplitSizeBytes(1));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_GT(tokens.size(), 1);
+    for (const auto* token : tokens) {
+      ASSERT_EQ(tablet_id, token->tablet().id());
+    }
+    ASSERT_EQ(kNumFlushes * kRowsPerFlush, CountRows(tokens));
+  }
+
+  { // A split size larger than the tablet keeps one token.
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetSplitSizeBytes(1024 * 1024 * 1024));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_EQ(1, tokens.size());
+    ASSERT_EQ(kNumFlushes * kRowsPerFlush, CountRows(tokens));
+  }
+}
+
 // Tests the results of creating scan tokens, altering the columns being
 // scanned, and then executing the scan tokens.
 TEST_F(ScanTokenTest, TestConcurrentAlterTable) {
@@ -19,6 +19,8 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -30,14 +32,19 @@
 
 #include "kudu/client/client-internal.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/parallel_scanner.h"
+#include "kudu/client/scan_token-internal.h"
 #include "kudu/client/schema.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/rpc_controller.h"
@@ -61,6 +68,8 @@ namespace kudu {
 using rpc::CredentialsPolicy;
 using rpc::RpcController;
 using strings::Substitute;
+using tserver::AggregatePB;
+using tserver::AggregateResultPB;
 using tserver::NewScanRequestPB;
 using tserver::TabletServerFeatures;
 
@@ -73,12 +82,19 @@ KuduScanner::Data::Data(KuduTable* table)
     open_(false),
     data_in_open_(false),
     short_circuit_(false),
+    prefetch_enabled_(false),
+    prefetch_in_flight_(false),
+    max_concurrent_tablets_(1),
+    preserve_tablet_order_(false),
+    prefetch_latch_(0),
+    prefetch_done_(true),
     table_(DCHECK_NOTNULL(table)->shared_from_this()),
     scan_attempts_(0),
     num_rows_returned_(0) {
 }
 
 KuduScanner::Data::~Data() {
+  DiscardPrefetch();
 }
 
 Status KuduScanner::Data::EnrichStatusMessage(Status s) const {
@@ -213,6 +229,17 @@ void KuduScanner::Data::UpdateResourceMetrics() {
       }
     }
   }
+  for (const auto& column_stats : last_response_.column_stats()) {
+    const string prefix = Substitute("column.$0.", column_stats.column_name());
+    resource_metrics_.Increment(prefix + "cells_read", column_stats.cells_read());
+    resource_metrics_.Increment(prefix + "bytes_read", column_stats.bytes_read());
+    resource_metrics_.Increment(prefix + "io_nanos", column_stats.io_nanos());
+    resource_metrics_.Increment(prefix + "decompress_nanos", column_stats.decompress_nanos());
+    resource_metrics_.Increment(prefix + "decode_nanos", column_stats.decode_nanos());
+    resource_metrics_.Increment(prefix + "delta_apply_nanos", column_stats.delta_apply_nanos());
+    resource_metrics_.Increment(prefix + "predicate_eval_nanos",
+                                column_stats.predicate_eval_nanos());
+  }
 }
 
 string KuduScanner::Data::DebugString() const {
@@ -316,24 +343,290 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
 
   controller_.Reset();
   controller_.set_deadline(rpc_deadline);
+  SetRequiredServerFeatures(&controller_);
+  return HandleScanResponse(proxy_->Scan(next_req_, &last_response_, &controller_),
+                            rpc_deadline, overall_deadline);
+}
+
+void KuduScanner::Data::SetRequiredServerFeatures(RpcController* controller) const {
   if (!configuration_.spec().predicates().empty()) {
-    controller_.RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+    controller->RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+  }
+  for (const auto& predicate : configuration_.spec().predicates()) {
+    if (predicate.second.predicate_type() == PredicateType::Like) {
+      controller->RequireServerFeature(TabletServerFeatures::LIKE_PREDICATES);
+      break;
+    }
   }
   if (configuration().row_format_flags() & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) {
-    controller_.RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
+    controller->RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
+  }
+  if (configuration().row_format_flags() & KuduScanner::COLUMNAR_LAYOUT) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE);
+  }
+  if (configuration().row_format_flags() & KuduScanner::COLUMNAR_DICTIONARY_ENCODING) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMNAR_DICTIONARY_ENCODING_FEATURE);
+  }
+  if (!configuration().aggregates().empty()) {
+    controller->RequireServerFeature(TabletServerFeatures::AGGREGATES);
+  }
+  if (configuration().has_top_n()) {
+    controller->RequireServerFeature(TabletServerFeatures::TOP_N);
+  }
+  if (configuration().has_diff_scan_start_timestamp()) {
+    controller->RequireServerFeature(TabletServerFeatures::DIFF_SCAN);
   }
-  ScanRpcStatus scan_status = AnalyzeResponse(
-      proxy_->Scan(next_req_,
-                   &last_response_,
-                   &controller_),
-      rpc_deadline, overall_deadline);
+}
+
+ScanRpcStatus KuduScanner::Data::HandleScanResponse(const Status& rpc_status,
+                                                    const MonoTime& rpc_deadline,
+                                                    const MonoTime& overall_deadline) {
+  ScanRpcStatus scan_status = AnalyzeResponse(rpc_status, rpc_deadline, overall_deadline);
   if (scan_status.result == ScanRpcStatus::OK) {
     UpdateResourceMetrics();
-    num_rows_returned_ += last_response_.data().num_rows();
+    num_rows_returned_ += NumRowsInLastResponse();
+    MergeAggregateResults();
   }
   return scan_status;
 }
 
+void KuduScanner::Data::MaybeStartPrefetch() {
+  DCHECK(!prefetch_in_flight_);
+  if (!prefetch_enabled_ || !last_response_.has_more_results()) {
+    return;
+  }
+  StartPrefetch();
+}
+
+void KuduScanner::Data::StartPrefetch() {
+  DCHECK(!prefetch_in_flight_);
+  DCHECK(last_response_.has_more_results());
+  // The request is the one the next batch would be fetched with anyway. As
+  // the tablet server requires the requests of a scanner to arrive in
+  // sequence, only one of them may be in flight.
+  PrepareRequest(KuduScanner::Data::CONTINUE);
+  prefetch_deadline_ = MonoTime::Now() + configuration_.timeout();
+  prefetch_controller_.Reset();
+  prefetch_controller_.set_deadline(prefetch_deadline_);
+  SetRequiredServerFeatures(&prefetch_controller_);
+  prefetch_latch_.Reset(1);
+  {
+    std::lock_guard<simple_spinlock> l(prefetch_lock_);
+    prefetch_done_ = false;
+  }
+  prefetch_in_flight_ = true;
+  prefetch_sent_time_ = MonoTime::Now();
+  proxy_->ScanAsync(next_req_, &prefetch_response_, &prefetch_controller_,
+                    [this]() {
+                      prefetch_completed_time_ = MonoTime::Now();
+                      std::function<void()> waiter;
+                      {
+                        std::lock_guard<simple_spinlock> l(prefetch_lock_);
+                        prefetch_done_ = true;
+                        waiter.swap(prefetch_waiter_);
+                      }
+                      prefetch_latch_.CountDown();
+                      // The scanner may be reused, or even destroyed, by
+                      // the waiter, so it must run last.
+                      if (waiter) {
+                        waiter();
+                      }
+                    });
+}
+
+void KuduScanner::Data::OnPrefetchComplete(std::function<void()> callback) {
+  DCHECK(prefetch_in_flight_);
+  {
+    std::lock_guard<simple_spinlock> l(prefetch_lock_);
+    if (!prefetch_done_) {
+      DCHECK(!prefetch_waiter_);
+      prefetch_waiter_ = std::move(callback);
+      return;
+    }
+  }
+  callback();
+}
+
+ScanRpcStatus KuduScanner::Data::FinishPrefetch(const MonoTime& overall_deadline) {
+  DCHECK(prefetch_in_flight_);
+  prefetch_latch_.Wait();
+  return TakePrefetchResponse(overall_deadline);
+}
+
+ScanRpcStatus KuduScanner::Data::TakePrefetchResponse(const MonoTime& overall_deadline) {
+  DCHECK(prefetch_in_flight_);
+  prefetch_in_flight_ = false;
+  last_response_.Swap(&prefetch_response_);
+  controller_.Swap(&prefetch_controller_);
+  return HandleScanResponse(controller_.status(), prefetch_deadline_, overall_deadline);
+}
+
+void KuduScanner::Data::DiscardPrefetch() {
+  if (prefetch_in_flight_) {
+    prefetch_latch_.Wait();
+    prefetch_in_flight_ = false;
+    prefetch_response_.Clear();
+    prefetch_controller_.Reset();
+  }
+}
+
+void KuduScanner::Data::MaybeResizeBatches(const MonoDelta& fetch_time, bool overlapped,
+                                           const MonoTime& call_time) {
+  // The last batch of a tablet may be partial, so its timing says little
+  // about how long a full batch takes.
+  if (!batch_sizer_.enabled() || !last_response_.has_more_results()) {
+    return;
+  }
+  MonoDelta consume_time = batch_returned_time_.Initialized() ?
+      call_time - batch_returned_time_ : MonoDelta::FromMicroseconds(0);
+  uint32_t max_batch_size_bytes = last_response_.has_max_batch_size_bytes() ?
+      last_response_.max_batch_size_bytes() :
+      internal::AdaptiveBatchSizer::kDefaultMaxBatchSizeBytes;
+  uint32_t old_size = batch_sizer_.batch_size_bytes();
+  batch_sizer_.RecordBatch(fetch_time, consume_time, overlapped, max_batch_size_bytes);
+  VLOG(3) << "Batch of " << old_size << " bytes took " << fetch_time.ToString()
+          << " to fetch and the previous one " << consume_time.ToString()
+          << " to consume; next batch size: " << batch_sizer_.batch_size_bytes();
+}
+
+Status KuduScanner::Data::FinishContinue(const ScanRpcStatus& result,
+                                         const MonoDelta& fetch_time,
+                                         bool overlapped,
+                                         const MonoTime& call_time,
+                                         const MonoTime& batch_deadline,
+                                         internal::ScanBatchDataInterface* batch_data,
+                                         bool* retry) {
+  *retry = false;
+
+  // Success case.
+  if (result.result == ScanRpcStatus::OK) {
+    if (last_response_.has_last_primary_key()) {
+      last_primary_key_ = last_response_.last_primary_key();
+    }
+    scan_attempts_ = 0;
+    MaybeResizeBatches(fetch_time, overlapped, call_time);
+    RETURN_NOT_OK(batch_data->Reset(&controller_,
+                                    configuration().projection(),
+                                    configuration().client_projection(),
+                                    configuration().row_format_flags(),
+                                    &last_response_));
+    MaybeStartPrefetch();
+    batch_returned_time_ = MonoTime::Now();
+    return Status::OK();
+  }
+
+  scan_attempts_++;
+
+  // Error handling.
+  set<string> blacklist;
+  bool needs_reopen = false;
+  Status s = HandleError(result, batch_deadline, &blacklist, &needs_reopen);
+  if (!s.ok()) {
+    LOG(WARNING) << "Scan on tablet server " << ts_->ToString() << " with "
+                 << DebugString() << " failed: " << result.status.ToString();
+    return s;
+  }
+
+  if (configuration().is_fault_tolerant()) {
+    LOG(WARNING) << "Attempting to retry " << DebugString() << " elsewhere.";
+    return ReopenCurrentTablet(batch_deadline, &blacklist);
+  }
+
+  if (blacklist.empty() && !needs_reopen) {
+    // If we didn't blacklist the current server, we can just retry again.
+    *retry = true;
+    return Status::OK();
+  }
+  // If we blacklisted the current server, and it's not fault-tolerant, we can't
+  // retry anywhere, so just propagate the error.
+  return result.status;
+}
+
+int64_t KuduScanner::Data::NumRowsInLastResponse() const {
+  if (last_response_.has_columnar_data()) {
+    return last_response_.columnar_data().num_rows();
+  }
+  return last_response_.data().num_rows();
+}
+
+void KuduScanner::Data::ResetAggregateResults() {
+  aggregate_results_.clear();
+  for (const auto& aggregate : configuration_.aggregates()) {
+    AggregateResultPB result;
+    if (aggregate.function() == AggregatePB::COUNT) {
+      result.set_int_value(0);
+    }
+    aggregate_results_.push_back(std::move(result));
+  }
+}
+
+void KuduScanner::Data::MergeAggregateResults() {
+  const auto& partials = last_response_.aggregate_results();
+  if (partials.empty()) {
+    return;
+  }
+  DCHECK_EQ(partials.size(), aggregate_results_.size());
+  for (int i = 0; i < partials.size() && i < aggregate_results_.size(); i++) {
+    const AggregateResultPB& partial = partials.Get(i);
+    AggregateResultPB* result = &aggregate_results_[i];
+    const bool has_value = result->has_int_value() || result->has_double_value();
+    switch (configuration_.aggregates()[i].function()) {
+      case AggregatePB::COUNT:
+      case AggregatePB::SUM:
+        if (partial.has_int_value()) {
+          // Integer sums wrap around on overflow, as on the server.
+          result->set_int_value(static_cast<int64_t>(
+              static_cast<uint64_t>(result->int_value()) +
+              static_cast<uint64_t>(partial.int_value())));
+        } else if (partial.has_double_value()) {
+          result->set_double_value(result->double_value() + partial.double_value());
+        }
+        break;
+      case AggregatePB::MIN:
+        if (partial.has_int_value()) {
+          result->set_int_value(has_value ? std::min(result->int_value(), partial.int_value())
+                                          : partial.int_value());
+        } else if (partial.has_double_value()) {
+          result->set_double_value(
+              has_value ? std::min(result->double_value(), partial.double_value())
+                        : partial.double_value());
+        }
+        break;
+      case AggregatePB::MAX:
+        if (partial.has_int_value()) {
+          result->set_int_value(has_value ? std::max(result->int_value(), partial.int_value())
+                                          : partial.int_value());
+        } else if (partial.has_double_value()) {
+          result->set_double_value(
+              has_value ? std::max(result->double_value(), partial.double_value())
+                        : partial.double_value());
+        }
+        break;
+      default:
+        LOG(FATAL) << "unexpected aggregate function: "
+                   << configuration_.aggregates()[i].function();
+    }
+  }
+}
+
+Status KuduScanner::Data::GetAggregateResult(int idx, const AggregateResultPB** result) const {
+  if (idx < 0 || idx >= aggregate_results_.size()) {
+    return Status::InvalidArgument(Substitute("Invalid aggregate index: $0", idx));
+  }
+  *result = &aggregate_results_[idx];
+  return Status::OK();
+}
+
+bool KuduScanner::Data::AggregateIsFloating(int idx) const {
+  const AggregatePB& aggregate = configuration_.aggregates()[idx];
+  if (aggregate.function() == AggregatePB::COUNT) {
+    return false;
+  }
+  const Schema& schema = *table_->schema().schema_;
+  DataType type = schema.column(schema.find_column(aggregate.column())).type_info()->type();
+  return type == FLOAT || type == DOUBLE;
+}
+
 Status KuduScanner::Data::OpenTablet(const string& partition_key,
                                      const MonoTime& deadline,
                                      set<string>* blacklist) {
@@ -389,6 +682,7 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
   }
 
   scan->set_cache_blocks(configuration_.spec().cache_blocks());
+  scan->set_report_column_stats(configuration_.report_column_metrics());
 
   // For consistent operations, propagate the timestamp among all operations
   // performed the context of the same client. For READ_YOUR_WRITES scan, use
@@ -411,6 +705,23 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
     ColumnPredicateToPB(col_pred.second, scan->add_column_predicates());
   }
 
+  scan->clear_aggregates();
+  for (const auto& aggregate : configuration_.aggregates()) {
+    *scan->add_aggregates() = aggregate;
+  }
+
+  if (configuration_.has_top_n()) {
+    *scan->mutable_top_n() = configuration_.top_n();
+  } else {
+    scan->clear_top_n();
+  }
+
+  if (configuration_.has_diff_scan_start_timestamp()) {
+    scan->set_snap_start_timestamp(configuration_.diff_scan_start_timestamp());
+  } else {
+    scan->clear_snap_start_timestamp();
+  }
+
   if (configuration_.spec().lower_bound_key()) {
     scan->mutable_start_primary_key()->assign(
       reinterpret_cast<const char*>(configuration_.spec().lower_bound_key()->encoded_key().data()),
@@ -501,12 +812,12 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
   partition_pruner_.RemovePartitionKeyRange(remote_->partition().partition_key_end());
 
   next_req_.clear_new_scan_request();
-  data_in_open_ = last_response_.has_data() && last_response_.data().num_rows() > 0;
+  data_in_open_ = NumRowsInLastResponse() > 0;
   if (last_response_.has_more_results()) {
     next_req_.set_scanner_id(last_response_.scanner_id());
     VLOG(2) << "Opened tablet " << remote_->tablet_id()
             << ", scanner ID " << last_response_.scanner_id();
-  } else if (last_response_.has_data()) {
+  } else if (last_response_.has_data() || last_response_.has_columnar_data()) {
     VLOG(2) << "Opened tablet " << remote_->tablet_id() << ", no scanner ID assigned";
   } else {
     VLOG(2) << "Opened tablet " << remote_->tablet_id() << " (no rows), no scanner ID assigned";
@@ -547,6 +858,9 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
 
 Status KuduScanner::Data::KeepAlive() {
   if (!open_) return Status::IllegalState("Scanner was not open.");
+  if (parallel_scanner_) {
+    return Status::NotSupported("keep-alive is not supported when scanning tablets concurrently");
+  }
   // If there is no scanner to keep alive, we still return Status::OK().
   if (!last_response_.IsInitialized() || !last_response_.has_more_results() ||
       !next_req_.has_scanner_id()) {
@@ -565,6 +879,37 @@ Status KuduScanner::Data::KeepAlive() {
   return Status::OK();
 }
 
+Status KuduScanner::Data::OpenParallel() {
+  // The tablets' scanners can't coordinate a row limit, and each would
+  // return aggregates over its own tablet only.
+  if (configuration_.spec().has_limit()) {
+    return Status::NotSupported("row limits are not supported when scanning tablets concurrently");
+  }
+  if (!configuration_.aggregates().empty()) {
+    return Status::NotSupported("aggregates are not supported when scanning tablets concurrently");
+  }
+
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  RETURN_NOT_OK(KuduScanTokenBuilder::Data::BuildTokens(&configuration_, 0, &tokens));
+  vector<unique_ptr<KuduScanToken>> owned_tokens;
+  for (KuduScanToken* token : tokens) {
+    owned_tokens.emplace_back(token);
+  }
+  tokens.clear();
+
+  VLOG(2) << "Scanning " << owned_tokens.size() << " tablets with up to "
+          << max_concurrent_tablets_ << " concurrent scanners: " << DebugString();
+  parallel_scanner_.reset(new internal::ParallelScanner(std::move(owned_tokens),
+                                                        max_concurrent_tablets_,
+                                                        preserve_tablet_order_,
+                                                        configuration_.row_format_flags(),
+                                                        prefetch_enabled_,
+                                                        target_batch_time_,
+                                                        &resource_metrics_));
+  return parallel_scanner_->Open();
+}
+
 bool KuduScanner::Data::MoreTablets() const {
   CHECK(open_);
   // TODO(KUDU-565): add a test which has a scan end on a tablet boundary
@@ -574,6 +919,8 @@ bool KuduScanner::Data::MoreTablets() const {
 void KuduScanner::Data::PrepareRequest(RequestType state) {
   if (state == KuduScanner::Data::CLOSE) {
     next_req_.set_batch_size_bytes(0);
+  } else if (state == KuduScanner::Data::CONTINUE && batch_sizer_.enabled()) {
+    next_req_.set_batch_size_bytes(batch_sizer_.batch_size_bytes());
   } else if (configuration_.has_batch_size_bytes()) {
     next_req_.set_batch_size_bytes(configuration_.batch_size_bytes());
   } else {
@@ -610,22 +957,31 @@ Status KuduScanBatch::Data::Reset(RpcController* controller,
                                   const Schema* projection,
                                   const KuduSchema* client_projection,
                                   uint64_t row_format_flags,
-                                  unique_ptr<RowwiseRowBlockPB> resp_data) {
+                                  tserver::ScanResponsePB* response) {
+  return Reset(controller, projection, client_projection, row_format_flags,
+               response->has_data() ? response->mutable_data() : nullptr);
+}
+
+Status KuduScanBatch::Data::Reset(RpcController* controller,
+                                  const Schema* projection,
+                                  const KuduSchema* client_projection,
+                                  uint64_t row_format_flags,
+                                  RowwiseRowBlockPB* data) {
   CHECK(controller->finished());
   controller_.Swap(controller);
   projection_ = projection;
   projected_row_size_ = CalculateProjectedRowSize(*projection_);
   client_projection_ = client_projection;
   row_format_flags_ = row_format_flags;
-  if (!resp_data) {
+  if (!data) {
     // No new data; just clear out the old stuff.
     resp_data_.Clear();
     return Status::OK();
   }
 
   // There's new data. Swap it in and process it.
-  resp_data_.Swap(resp_data.get());
-  resp_data.reset(); // no longer valid.
+  resp_data_.Swap(data);
+  data->Clear();
 
   // First, rewrite the relative addresses into absolute ones.
   if (PREDICT_FALSE(!resp_data_.has_rows_sidecar())) {
@@ -688,5 +1044,282 @@ void KuduScanBatch::Data::Clear() {
   controller_.Reset();
 }
 
+////////////////////////////////////////////////////////////
+// KuduColumnarScanBatch
+////////////////////////////////////////////////////////////
+
+KuduColumnarScanBatch::Data::Data() : projection_(nullptr) {}
+
+KuduColumnarScanBatch::Data::~Data() {}
+
+Status KuduColumnarScanBatch::Data::Reset(RpcController* controller,
+                                          const Schema* projection,
+                                          const KuduSchema* /* client_projection */,
+                                          uint64_t /* row_format_flags */,
+                                          tserver::ScanResponsePB* response) {
+  CHECK(controller->finished());
+  controller_.Swap(controller);
+  projection_ = projection;
+  columns_.clear();
+  resp_data_.Clear();
+  if (!response->has_columnar_data()) {
+    // No new data.
+    return Status::OK();
+  }
+  resp_data_.Swap(response->mutable_columnar_data());
+  response->clear_columnar_data();
+  if (resp_data_.num_rows() == 0) {
+    // The server sends no columns along with an empty batch.
+    return Status::OK();
+  }
+
+  if (PREDICT_FALSE(resp_data_.columns_size() != projection_->num_columns())) {
+    return Status::Corruption(Substitute(
+        "Server sent invalid response: $0 columns for a projection of $1 columns",
+        resp_data_.columns_size(), projection_->num_columns()));
+  }
+  auto get_sidecar = [&](bool has_idx, int idx, Slice* sidecar) {
+    if (!has_idx) {
+      *sidecar = Slice();
+      return Status::OK();
+    }
+    Status s = controller_.GetInboundSidecar(idx, sidecar);
+    if (PREDICT_FALSE(!s.ok())) {
+      return Status::Corruption("Server sent invalid response: "
+          "column sidecar index corrupt", s.ToString());
+    }
+    return Status::OK();
+  };
+  columns_.resize(resp_data_.columns_size());
+  for (int i = 0; i < resp_data_.columns_size(); i++) {
+    const ColumnarRowBlockPB::Column& col_pb = resp_data_.columns(i);
+    Column* col = &columns_[i];
+    RETURN_NOT_OK(get_sidecar(col_pb.has_data_sidecar(), col_pb.data_sidecar(),
+                              &col->data));
+    RETURN_NOT_OK(get_sidecar(col_pb.has_varlen_data_sidecar(), col_pb.varlen_data_sidecar(),
+                              &col->varlen_data));
+    RETURN_NOT_OK(get_sidecar(col_pb.has_non_null_bitmap_sidecar(),
+                              col_pb.non_null_bitmap_sidecar(), &col->non_null_bitmap));
+    col->dictionary_encoded = col_pb.has_dictionary_offsets_sidecar();
+    RETURN_NOT_OK(get_sidecar(col->dictionary_encoded, col_pb.dictionary_offsets_sidecar(),
+                              &col->dictionary_offsets));
+  }
+  return CheckColumnSizes();
+}
+
+Status KuduColumnarScanBatch::Data::CheckColumnSizes() const {
+  size_t num_rows = resp_data_.num_rows();
+  for (int i = 0; i < columns_.size(); i++) {
+    const ColumnSchema& col_schema = projection_->column(i);
+    const Column& col = columns_[i];
+    bool ok;
+    if (col.dictionary_encoded) {
+      size_t dict_offsets_size = col.dictionary_offsets.size();
+      ok = col_schema.type_info()->physical_type() == BINARY &&
+          col.data.size() == num_rows * sizeof(uint32_t) &&
+          dict_offsets_size >= sizeof(uint32_t) &&
+          dict_offsets_size % sizeof(uint32_t) == 0 &&
+          UnalignedLoad<uint32_t>(col.dictionary_offsets.data() + dict_offsets_size -
+                                  sizeof(uint32_t)) == col.varlen_data.size();
+    } else if (col_schema.type_info()->physical_type() == BINARY) {
+      ok = col.data.size() == (num_rows + 1) * sizeof(uint32_t) &&
+          UnalignedLoad<uint32_t>(col.data.data() + num_rows * sizeof(uint32_t)) ==
+              col.varlen_data.size();
+    } else {
+      ok = col.data.size() == num_rows * col_schema.type_info()->size();
+    }
+    if (col_schema.is_nullable()) {
+      ok = ok && col.non_null_bitmap.size() == BitmapSize(num_rows);
+    }
+    if (PREDICT_FALSE(!ok)) {
+      return Status::Corruption(Substitute(
+          "Server sent invalid response: bad size of the data of column $0",
+          col_schema.name()));
+    }
+    if (col.dictionary_encoded) {
+      RETURN_NOT_OK(CheckDictionaryCodes(i));
+    }
+  }
+  return Status::OK();
+}
+
+Status KuduColumnarScanBatch::Data::CheckDictionaryCodes(int idx) const {
+  const Column& col = columns_[idx];
+  const uint8_t* non_null_bitmap = col.non_null_bitmap.empty() ? nullptr :
+      col.non_null_bitmap.data();
+  size_t num_entries = col.dictionary_offsets.size() / sizeof(uint32_t) - 1;
+  uint32_t prev_offset = 0;
+  for (size_t i = 0; i <= num_entries; i++) {
+    uint32_t offset = UnalignedLoad<uint32_t>(col.dictionary_offsets.data() +
+                                              i * sizeof(uint32_t));
+    if (PREDICT_FALSE(offset < prev_offset)) {
+      return Status::Corruption(Substitute(
+          "Server sent invalid response: bad dictionary of column $0",
+          projection_->column(idx).name()));
+    }
+    prev_offset = offset;
+  }
+  for (int row = 0; row < resp_data_.num_rows(); row++) {
+    if (non_null_bitmap && !BitmapTest(non_null_bitmap, row)) {
+      continue;
+    }
+    uint32_t code = UnalignedLoad<uint32_t>(col.data.data() + row * sizeof(uint32_t));
+    if (PREDICT_FALSE(code >= num_entries)) {
+      return Status::Corruption(Substitute(
+          "Server sent invalid response: bad dictionary code $0 in column $1",
+          code, projection_->column(idx).name()));
+    }
+  }
+  return Status::OK();
+}
+
+Status KuduColumnarScanBatch::Data::CheckColumnIndex(int idx) const {
+  if (PREDICT_FALSE(projection_ == nullptr || idx < 0 || idx >= projection_->num_columns())) {
+    return Status::InvalidArgument(Substitute("bad column index: $0", idx));
+  }
+  return Status::OK();
+}
+
+Status KuduColumnarScanBatch::Data::GetFixedLengthColumn(int idx, Slice* data) const {
+  RETURN_NOT_OK(CheckColumnIndex(idx));
+  const ColumnSchema& col_schema = projection_->column(idx);
+  if (PREDICT_FALSE(col_schema.type_info()->physical_type() == BINARY)) {
+    return Status::InvalidArgument(Substitute(
+        "column $0 is of variable-length type $1", col_schema.name(),
+        col_schema.type_info()->name()));
+  }
+  *data = columns_.empty() ? Slice() : columns_[idx].data;
+  return Status::OK();
+}
+
+Status KuduColumnarScanBatch::Data::GetVariableLengthColumn(int idx, Slice* offsets,
+                                                            Slice* data) const {
+  RETURN_NOT_OK(CheckColumnIndex(idx));
+  const ColumnSchema& col_schema = projection_->column(idx);
+  if (PREDICT_FALSE(col_schema.type_info()->physical_type() != BINARY)) {
+    return Status::InvalidArgument(Substitute(
+        "column $0 is of fixed-length type $1", col_schema.name(),
+        col_schema.type_info()->name()));
+  }
+  if (columns_.empty()) {
+    // An empty batch still has the offset of the end of its only cell.
+    static const uint32_t kNoCellsOffsets[] = { 0 };
+    *offsets = Slice(reinterpret_cast<const uint8_t*>(kNoCellsOffsets), sizeof(uint32_t));
+    *data = Slice();
+  } else if (columns_[idx].dictionary_encoded) {
+    const Column& col = columns_[idx];
+    if (!col.expanded_offsets) {
+      // Expand the codes into the cells they stand for. The codes were
+      // checked to be in range in CheckDictionaryCodes().
+      unique_ptr<faststring> expanded_offsets(new faststring());
+      unique_ptr<faststring> expanded_data(new faststring());
+      int num_rows = resp_data_.num_rows();
+      expanded_offsets->resize((num_rows + 1) * sizeof(uint32_t));
+      uint8_t* offset_ptr = expanded_offsets->data();
+      uint32_t offset = 0;
+      UnalignedStore<uint32_t>(offset_ptr, offset);
+      for (int row = 0; row < num_rows; row++) {
+        offset_ptr += sizeof(uint32_t);
+        if (col.non_null_bitmap.empty() || BitmapTest(col.non_null_bitmap.data(), row)) {
+          const uint8_t* entry_offsets = col.dictionary_offsets.data() +
+              UnalignedLoad<uint32_t>(col.data.data() + row * sizeof(uint32_t)) *
+              sizeof(uint32_t);
+          uint32_t begin = UnalignedLoad<uint32_t>(entry_offsets);
+          uint32_t end = UnalignedLoad<uint32_t>(entry_offsets + sizeof(uint32_t));
+          expanded_data->append(col.varlen_data.data() + begin, end - begin);
+          offset += end - begin;
+        }
+        UnalignedStore<uint32_t>(offset_ptr, offset);
+      }
+      col.expanded_offsets = std::move(expanded_offsets);
+      col.expanded_data = std::move(expanded_data);
+    }
+    *offsets = Slice(*col.expanded_offsets);
+    *data = Slice(*col.expanded_data);
+  } else {
+    *offsets = columns_[idx].data;
+    *data = columns_[idx].varlen_data;
+  }
+  return Status::OK();
+}
+
+bool KuduColumnarScanBatch::Data::IsDictionaryEncodedColumn(int idx) const {
+  return CheckColumnIndex(idx).ok() && !columns_.empty() && columns_[idx].dictionary_encoded;
+}
+
+Status KuduColumnarScanBatch::Data::GetDictionaryEncodedColumn(int idx, Slice* codes,
+                                                               Slice* dictionary_offsets,
+                                                               Slice* dictionary_data) const {
+  RETURN_NOT_OK(CheckColumnIndex(idx));
+  if (PREDICT_FALSE(!IsDictionaryEncodedColumn(idx))) {
+    return Status::InvalidArgument(Substitute("column $0 is not dictionary-encoded",
+                                              projection_->column(idx).name()));
+  }
+  const Column& col = columns_[idx];
+  *codes = col.data;
+  *dictionary_offsets = col.dictionary_offsets;
+  *dictionary_data = col.varlen_data;
+  return Status::OK();
+}
+
+Status KuduColumnarScanBatch::Data::GetNonNullBitmapForColumn(int idx,
+                                                              Slice* non_null_bitmap) const {
+  RETURN_NOT_OK(CheckColumnIndex(idx));
+  const ColumnSchema& col_schema = projection_->column(idx);
+  if (PREDICT_FALSE(!col_schema.is_nullable())) {
+    return Status::InvalidArgument(Substitute("column $0 is not nullable", col_schema.name()));
+  }
+  *non_null_bitmap = columns_.empty() ? Slice() : columns_[idx].non_null_bitmap;
+  return Status::OK();
+}
+
+void KuduColumnarScanBatch::Data::Clear() {
+  resp_data_.Clear();
+  columns_.clear();
+  controller_.Reset();
+}
+
+namespace internal {
+
+const uint32_t AdaptiveBatchSizer::kMinBatchSizeBytes;
+const uint32_t AdaptiveBatchSizer::kDefaultBatchSizeBytes;
+const uint32_t AdaptiveBatchSizer::kDefaultMaxBatchSizeBytes;
+
+AdaptiveBatchSizer::AdaptiveBatchSizer()
+    : batch_size_bytes_(0) {
+}
+
+void AdaptiveBatchSizer::Enable(const MonoDelta& target_batch_time,
+                                uint32_t initial_batch_size_bytes) {
+  DCHECK(target_batch_time.Initialized());
+  target_batch_time_ = target_batch_time;
+  batch_size_bytes_ = std::max(initial_batch_size_bytes == 0 ?
+                                   kDefaultBatchSizeBytes : initial_batch_size_bytes,
+                               kMinBatchSizeBytes);
+}
+
+void AdaptiveBatchSizer::RecordBatch(const MonoDelta& fetch_time,
+                                     const MonoDelta& consume_time,
+                                     bool overlapped,
+                                     uint32_t max_batch_size_bytes) {
+  DCHECK(enabled());
+  int64_t batch_time_us = overlapped ?
+      std::max(fetch_time.ToMicroseconds(), consume_time.ToMicroseconds()) :
+      fetch_time.ToMicroseconds() + consume_time.ToMicroseconds();
+  double ratio = batch_time_us <= 0 ? 2.0 :
+      static_cast<double>(target_batch_time_.ToMicroseconds()) / batch_time_us;
+  ratio = std::min(std::max(ratio, 0.5), 2.0);
+
+  // The server serves requests for more than its maximum with batches of the
+  // maximum size, so the measured times are those of batches of at most that
+  // size.
+  uint64_t max_bytes = std::max(max_batch_size_bytes, kMinBatchSizeBytes);
+  uint64_t size = std::min<uint64_t>(batch_size_bytes_, max_bytes) * ratio;
+  batch_size_bytes_ = static_cast<uint32_t>(
+      std::min(std::max<uint64_t>(size, kMinBatchSizeBytes), max_bytes));
+}
+
+} // namespace internal
+
 } // namespace client
 } // namespace kudu
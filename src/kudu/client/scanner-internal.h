@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <set>
@@ -28,6 +29,7 @@
 #include <glog/logging.h>
 
 #include "kudu/client/client.h"
+#include "kudu/client/columnar_scan_batch.h"
 #include "kudu/client/resource_metrics.h"
 #include "kudu/client/row_result.h"
 #include "kudu/client/scan_batch.h"
@@ -39,12 +41,15 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
-class MonoTime;
 class Schema;
 
 namespace tserver {
@@ -56,8 +61,61 @@ namespace client {
 class KuduSchema;
 
 namespace internal {
+class ParallelScanner;
 class RemoteTablet;
 class RemoteTabletServer;
+class ScanBatchDataInterface;
+
+// Chooses the batch size of a scan's continuation requests so that each batch
+// takes about a target time to fetch and consume. See
+// KuduScanner::SetAdaptiveBatchSizing().
+//
+// The size is scaled by the ratio between the target time and the time the
+// last batch took, by at most a factor of two per batch, and kept within
+// [kMinBatchSizeBytes, the tablet server's maximum batch size].
+class AdaptiveBatchSizer {
+ public:
+  // The smallest batch size requested.
+  static const uint32_t kMinBatchSizeBytes = 16 * 1024;
+
+  // The initial batch size if none was set, matching the tablet server's
+  // default; and the maximum batch size assumed for servers which don't
+  // report theirs.
+  static const uint32_t kDefaultBatchSizeBytes = 1024 * 1024;
+  static const uint32_t kDefaultMaxBatchSizeBytes = 8 * 1024 * 1024;
+
+  // Creates a disabled sizer.
+  AdaptiveBatchSizer();
+
+  // Enables the sizer, starting at 'initial_batch_size_bytes', or at
+  // kDefaultBatchSizeBytes if it is 0.
+  void Enable(const MonoDelta& target_batch_time, uint32_t initial_batch_size_bytes);
+
+  bool enabled() const {
+    return target_batch_time_.Initialized();
+  }
+
+  uint32_t batch_size_bytes() const {
+    DCHECK(enabled());
+    return batch_size_bytes_;
+  }
+
+  // Adjusts the batch size after a full batch of the current size took
+  // 'fetch_time' to arrive from the tablet server and the application took
+  // 'consume_time' to process the previous batch. If 'overlapped' is set,
+  // the batch was prefetched while the previous one was being processed, so
+  // that only the longer of the two times counts. 'max_batch_size_bytes' is
+  // the largest batch size the tablet server accepts.
+  void RecordBatch(const MonoDelta& fetch_time,
+                   const MonoDelta& consume_time,
+                   bool overlapped,
+                   uint32_t max_batch_size_bytes);
+
+ private:
+  MonoDelta target_batch_time_;
+  uint32_t batch_size_bytes_;
+};
+
 } // namespace internal
 
 // The result of KuduScanner::Data::AnalyzeResponse.
@@ -125,6 +183,54 @@ class KuduScanner::Data {
   // The RPC and TS proxy should already have been prepared in next_req_, proxy_, etc.
   ScanRpcStatus SendScanRpc(const MonoTime& overall_deadline, bool allow_time_for_failover);
 
+  // Sends the continuation RPC for the next batch of the current tablet if
+  // prefetching is enabled and the tablet has more results, without waiting
+  // for its response. See KuduScanner::SetPrefetchEnabled().
+  void MaybeStartPrefetch();
+
+  // Sends the continuation RPC for the next batch of the current tablet
+  // without waiting for its response, which is then handled like that of a
+  // prefetch. No prefetch may be in flight.
+  void StartPrefetch();
+
+  // Runs 'callback' once the in-flight prefetch RPC has completed: right
+  // away if it already has, or else on the reactor thread completing it.
+  void OnPrefetchComplete(std::function<void()> callback);
+
+  // Waits for the in-flight prefetch RPC and handles its response like
+  // SendScanRpc() would, with 'overall_deadline' being the deadline of the
+  // batch the prefetched response is for.
+  ScanRpcStatus FinishPrefetch(const MonoTime& overall_deadline);
+
+  // Like FinishPrefetch(), for a prefetch RPC known to have completed. Doesn't
+  // wait, so may be called from the reactor thread which completed it.
+  ScanRpcStatus TakePrefetchResponse(const MonoTime& overall_deadline);
+
+  // Waits for the in-flight prefetch RPC, if any, and discards its response.
+  void DiscardPrefetch();
+
+  // Adjusts the batch size of the following requests after the batch in
+  // 'last_response_' took 'fetch_time' to arrive, if adaptive batch sizing
+  // is enabled. 'call_time' is when the application asked for the batch.
+  void MaybeResizeBatches(const MonoDelta& fetch_time, bool overlapped,
+                          const MonoTime& call_time);
+
+  // Handles the outcome 'result' of fetching the next batch of the current
+  // tablet, which took 'fetch_time' and was requested at 'call_time'. On
+  // success, the batch is reset into 'batch_data'. Otherwise, the error is
+  // handled, possibly backing off or reopening the tablet elsewhere, and
+  // '*retry' is set if the request should be sent again; the returned status
+  // is only meaningful if it isn't set.
+  //
+  // Only the success case is guaranteed not to block.
+  Status FinishContinue(const ScanRpcStatus& result,
+                        const MonoDelta& fetch_time,
+                        bool overlapped,
+                        const MonoTime& call_time,
+                        const MonoTime& batch_deadline,
+                        internal::ScanBatchDataInterface* batch_data,
+                        bool* retry);
+
   // Called when KuduScanner::NextBatch or KuduScanner::Data::OpenTablet result in an RPC or
   // server error.
   //
@@ -160,6 +266,10 @@ class KuduScanner::Data {
 
   Status KeepAlive();
 
+  // Plans the scan as one scan token per tablet and starts scanning the
+  // tablets concurrently with 'parallel_scanner_'.
+  Status OpenParallel();
+
   // Returns whether there may exist more tablets to scan.
   //
   // This method does not take into account any non-covered range partitions
@@ -185,6 +295,34 @@ class KuduScanner::Data {
   // Modifies fields in 'next_req_' in preparation for a new request.
   void PrepareRequest(RequestType state);
 
+  // Whether to prefetch the next batch of the current tablet. See
+  // KuduScanner::SetPrefetchEnabled().
+  bool prefetch_enabled_;
+
+  // Whether a prefetch RPC has been sent but not yet handled.
+  bool prefetch_in_flight_;
+
+  // The target time per batch if adaptive batch sizing is enabled, and the
+  // sizer of the continuation requests, enabled by Open() in that case. See
+  // KuduScanner::SetAdaptiveBatchSizing().
+  MonoDelta target_batch_time_;
+  internal::AdaptiveBatchSizer batch_sizer_;
+
+  // When the last batch was returned to the application, if it is being
+  // processed; used to measure how long the application takes per batch.
+  MonoTime batch_returned_time_;
+
+  // The maximum number of tablets to scan concurrently, and whether to
+  // return their batches in tablet order. See
+  // KuduScanner::SetTabletParallelism().
+  int max_concurrent_tablets_;
+  bool preserve_tablet_order_;
+
+  // Scans the tablets if more than one may be scanned concurrently. Set by
+  // OpenParallel() and kept until destruction, since the returned batches
+  // reference the projections of its per-tablet scanners.
+  std::unique_ptr<internal::ParallelScanner> parallel_scanner_;
+
   // Update 'last_error_' if need be. Should be invoked whenever a
   // non-fatal (i.e. retriable) scan error is encountered.
   void UpdateLastError(const Status& error);
@@ -226,6 +364,27 @@ class KuduScanner::Data {
   // RPC controller for the last in-flight RPC.
   rpc::RpcController controller_;
 
+  // The response to, controller of, deadline of, and latch counted down on
+  // completion of the in-flight prefetch RPC, if any. They are swapped into
+  // 'last_response_' and 'controller_' once the prefetched batch is needed.
+  tserver::ScanResponsePB prefetch_response_;
+  rpc::RpcController prefetch_controller_;
+  MonoTime prefetch_deadline_;
+  CountDownLatch prefetch_latch_;
+
+  // When the in-flight prefetch RPC was sent and when its response arrived.
+  // The latter is written from the reactor thread before 'prefetch_latch_'
+  // is counted down.
+  MonoTime prefetch_sent_time_;
+  MonoTime prefetch_completed_time_;
+
+  // Whether the in-flight prefetch RPC has completed, and the callback to run
+  // once it does, as registered by OnPrefetchComplete(). Protected by
+  // 'prefetch_lock_', since the RPC completes on a reactor thread.
+  simple_spinlock prefetch_lock_;
+  bool prefetch_done_;
+  std::function<void()> prefetch_waiter_;
+
   // The table we're scanning.
   sp::shared_ptr<KuduTable> table_;
 
@@ -240,6 +399,11 @@ class KuduScanner::Data {
   // Number of rows already returned.
   int64_t num_rows_returned_;
 
+  // The results of the scan's aggregates over the rows scanned so far, merged
+  // from the partial results of each scan response. See
+  // KuduScanner::AddAggregate().
+  std::vector<tserver::AggregateResultPB> aggregate_results_;
+
   // The deprecated "NextBatch(vector<KuduRowResult>*) API requires some local
   // storage for the actual row data. If that API is used, this member keeps the
   // actual storage for the batch that is returned.
@@ -261,7 +425,23 @@ class KuduScanner::Data {
   // suitable for use in client-side logging (as opposed to Scanner::ToString).
   std::string DebugString() const;
 
+  // Returns the number of rows in 'last_response_', in either layout.
+  int64_t NumRowsInLastResponse() const;
+
+  // Resets 'aggregate_results_' to the results of the aggregates over no rows.
+  void ResetAggregateResults();
+
+  // Sets '*result' to the result of the aggregate at index 'idx'. Returns
+  // InvalidArgument if there is no such aggregate.
+  Status GetAggregateResult(int idx, const tserver::AggregateResultPB** result) const;
+
+  // Returns true if the aggregate at index 'idx' is a floating point value.
+  bool AggregateIsFloating(int idx) const;
+
  private:
+  // Merges the aggregate results in 'last_response_' into 'aggregate_results_'.
+  void MergeAggregateResults();
+
   // Analyze the response of the last Scan RPC made by this scanner.
   //
   // The error handling of a scan RPC is fairly complex, since we have to handle
@@ -284,10 +464,41 @@ class KuduScanner::Data {
 
   void UpdateResourceMetrics();
 
+  // Sets the server features 'controller' requires for scan RPCs.
+  void SetRequiredServerFeatures(rpc::RpcController* controller) const;
+
+  // Handles the response in 'last_response_' to the RPC sent by
+  // 'controller_', which completed with 'rpc_status'.
+  ScanRpcStatus HandleScanResponse(const Status& rpc_status,
+                                   const MonoTime& rpc_deadline,
+                                   const MonoTime& overall_deadline);
+
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
 
-class KuduScanBatch::Data {
+namespace internal {
+
+// The data of a batch returned by KuduScanner::NextBatch(), in one of the
+// layouts the scanner may return rows in.
+class ScanBatchDataInterface {
+ public:
+  virtual ~ScanBatchDataInterface() {}
+
+  // Takes the rows of 'response', whose sidecars were received by
+  // 'controller'.
+  virtual Status Reset(rpc::RpcController* controller,
+                       const Schema* projection,
+                       const KuduSchema* client_projection,
+                       uint64_t row_format_flags,
+                       tserver::ScanResponsePB* response) = 0;
+
+  // Drops the rows of the batch.
+  virtual void Clear() = 0;
+};
+
+} // namespace internal
+
+class KuduScanBatch::Data : public internal::ScanBatchDataInterface {
  public:
   Data();
   ~Data();
@@ -296,7 +507,15 @@ class KuduScanBatch::Data {
                const Schema* projection,
                const KuduSchema* client_projection,
                uint64_t row_format_flags,
-               std::unique_ptr<RowwiseRowBlockPB> resp_data);
+               tserver::ScanResponsePB* response) override;
+
+  // Like above, but takes the rows of 'data', which may be nullptr if no row
+  // was returned.
+  Status Reset(rpc::RpcController* controller,
+               const Schema* projection,
+               const KuduSchema* client_projection,
+               uint64_t row_format_flags,
+               RowwiseRowBlockPB* data);
 
   int num_rows() const {
     return resp_data_.num_rows();
@@ -314,7 +533,7 @@ class KuduScanBatch::Data {
 
   void ExtractRows(std::vector<KuduScanBatch::RowPtr>* rows);
 
-  void Clear();
+  void Clear() override;
 
   // Returns the size of a row for the given projection 'proj'.
   static size_t CalculateProjectedRowSize(const Schema& proj);
@@ -344,6 +563,71 @@ class KuduScanBatch::Data {
   size_t projected_row_size_;
 };
 
+class KuduColumnarScanBatch::Data : public internal::ScanBatchDataInterface {
+ public:
+  Data();
+  ~Data();
+
+  Status Reset(rpc::RpcController* controller,
+               const Schema* projection,
+               const KuduSchema* client_projection,
+               uint64_t row_format_flags,
+               tserver::ScanResponsePB* response) override;
+
+  void Clear() override;
+
+  int num_rows() const {
+    return resp_data_.num_rows();
+  }
+
+  Status GetFixedLengthColumn(int idx, Slice* data) const;
+  Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
+  Status GetNonNullBitmapForColumn(int idx, Slice* non_null_bitmap) const;
+  bool IsDictionaryEncodedColumn(int idx) const;
+  Status GetDictionaryEncodedColumn(int idx, Slice* codes, Slice* dictionary_offsets,
+                                    Slice* dictionary_data) const;
+
+ private:
+  // Returns InvalidArgument if 'idx' is not a column of the projection.
+  Status CheckColumnIndex(int idx) const;
+
+  // Checks that the sidecars of each column hold exactly 'num_rows()' cells.
+  Status CheckColumnSizes() const;
+
+  // Checks that the non-NULL cells of dictionary-encoded column 'col' only
+  // hold codes of entries of its dictionary.
+  Status CheckDictionaryCodes(int idx) const;
+
+  // The RPC controller for the RPC which returned this batch. Holding on to
+  // it ensures we hold on to the sidecars which contain the columns.
+  rpc::RpcController controller_;
+
+  // The PB which describes the columns' sidecars.
+  ColumnarRowBlockPB resp_data_;
+
+  // The projection being scanned.
+  const Schema* projection_;
+
+  // The buffers of each column, whose lifetime is ensured by 'controller_'.
+  // Buffers which the column doesn't have, or which the server didn't send
+  // because they were empty, are empty.
+  //
+  // For a dictionary-encoded column, 'data' holds the codes, 'varlen_data'
+  // the dictionary's entries and 'dictionary_offsets' their offsets. The
+  // column is expanded into 'expanded_offsets' and 'expanded_data' the first
+  // time it is fetched as a plain variable-length column.
+  struct Column {
+    Slice data;
+    Slice varlen_data;
+    Slice non_null_bitmap;
+    Slice dictionary_offsets;
+    bool dictionary_encoded = false;
+    mutable std::unique_ptr<faststring> expanded_offsets;
+    mutable std::unique_ptr<faststring> expanded_data;
+  };
+  std::vector<Column> columns_;
+};
+
 } // namespace client
 } // namespace kudu
 
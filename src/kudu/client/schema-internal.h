@@ -66,6 +66,9 @@ class KuduColumnSpec::Data {
         has_encoding(false),
         has_compression(false),
         has_block_size(false),
+        has_bloom_filter(false),
+        has_secondary_index(false),
+        has_column_group(false),
         has_nullable(false),
         primary_key(false),
         has_default(false),
@@ -98,6 +101,15 @@ class KuduColumnSpec::Data {
   bool has_block_size;
   int32_t block_size;
 
+  bool has_bloom_filter;
+  bool bloom_filter;
+
+  bool has_secondary_index;
+  bool secondary_index;
+
+  bool has_column_group;
+  std::string column_group;
+
   bool has_nullable;
   bool nullable;
 
@@ -48,7 +48,7 @@ MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::EncodingType,
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::CompressionType,
                  kudu::client::KuduColumnStorageAttributes::DEFAULT_COMPRESSION,
-                 kudu::client::KuduColumnStorageAttributes::ZLIB);
+                 kudu::client::KuduColumnStorageAttributes::ZSTD);
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnSchema::DataType,
                  kudu::client::KuduColumnSchema::INT8,
@@ -71,6 +71,7 @@ kudu::EncodingType ToInternalEncodingType(KuduColumnStorageAttributes::EncodingT
     case KuduColumnStorageAttributes::GROUP_VARINT: return kudu::GROUP_VARINT;
     case KuduColumnStorageAttributes::RLE: return kudu::RLE;
     case KuduColumnStorageAttributes::BIT_SHUFFLE: return kudu::BIT_SHUFFLE;
+    case KuduColumnStorageAttributes::FRAME_OF_REFERENCE: return kudu::FRAME_OF_REFERENCE;
     default: LOG(FATAL) << "Unexpected encoding type: " << type;
   }
 }
@@ -84,6 +85,7 @@ KuduColumnStorageAttributes::EncodingType FromInternalEncodingType(kudu::Encodin
     case kudu::GROUP_VARINT: return KuduColumnStorageAttributes::GROUP_VARINT;
     case kudu::RLE: return KuduColumnStorageAttributes::RLE;
     case kudu::BIT_SHUFFLE: return KuduColumnStorageAttributes::BIT_SHUFFLE;
+    case kudu::FRAME_OF_REFERENCE: return KuduColumnStorageAttributes::FRAME_OF_REFERENCE;
     default: LOG(FATAL) << "Unexpected internal encoding type: " << type;
   }
 }
@@ -95,6 +97,7 @@ kudu::CompressionType ToInternalCompressionType(KuduColumnStorageAttributes::Com
     case KuduColumnStorageAttributes::SNAPPY: return kudu::SNAPPY;
     case KuduColumnStorageAttributes::LZ4: return kudu::LZ4;
     case KuduColumnStorageAttributes::ZLIB: return kudu::ZLIB;
+    case KuduColumnStorageAttributes::ZSTD: return kudu::ZSTD;
     default: LOG(FATAL) << "Unexpected compression type" << type;
   }
 }
@@ -107,6 +110,7 @@ KuduColumnStorageAttributes::CompressionType FromInternalCompressionType(
     case kudu::SNAPPY: return KuduColumnStorageAttributes::SNAPPY;
     case kudu::LZ4: return KuduColumnStorageAttributes::LZ4;
     case kudu::ZLIB: return KuduColumnStorageAttributes::ZLIB;
+    case kudu::ZSTD: return KuduColumnStorageAttributes::ZSTD;
     default: LOG(FATAL) << "Unexpected internal compression type: " << type;
   }
 }
@@ -244,6 +248,24 @@ KuduColumnSpec* KuduColumnSpec::BlockSize(int32_t block_size) {
   return this;
 }
 
+KuduColumnSpec* KuduColumnSpec::BloomFilter(bool enabled) {
+  data_->has_bloom_filter = true;
+  data_->bloom_filter = enabled;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::SecondaryIndex(bool enabled) {
+  data_->has_secondary_index = true;
+  data_->secondary_index = enabled;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::ColumnGroup(const std::string& group) {
+  data_->has_column_group = true;
+  data_->column_group = group;
+  return this;
+}
+
 KuduColumnSpec* KuduColumnSpec::Precision(int8_t precision) {
   data_->has_precision = true;
   data_->precision = precision;
@@ -372,6 +394,23 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
                           KuduColumnStorageAttributes(encoding, compression, block_size),
                           type_attrs);
 
+  // The bloom filter, secondary index and column group attributes aren't
+  // part of KuduColumnStorageAttributes, to keep that class ABI-compatible;
+  // set them on the internal schema directly.
+  if (data_->has_bloom_filter || data_->has_secondary_index || data_->has_column_group) {
+    ColumnSchemaDelta delta(data_->name);
+    if (data_->has_bloom_filter) {
+      delta.bloom_filter = boost::optional<bool>(data_->bloom_filter);
+    }
+    if (data_->has_secondary_index) {
+      delta.secondary_index = boost::optional<bool>(data_->secondary_index);
+    }
+    if (data_->has_column_group) {
+      delta.column_group = boost::optional<string>(data_->column_group);
+    }
+    RETURN_NOT_OK(col->col_->ApplyDelta(delta));
+  }
+
   return Status::OK();
 }
 
@@ -385,6 +424,10 @@ Status KuduColumnSpec::ToColumnSchemaDelta(ColumnSchemaDelta* col_delta) const {
   if (data_->primary_key) {
     return Status::InvalidArgument("primary key set for column schema delta", data_->name);
   }
+  if (data_->has_column_group) {
+    return Status::InvalidArgument("column group provided for column schema delta",
+                                   data_->name);
+  }
 
   if (data_->has_rename_to) {
     col_delta->new_name = boost::optional<string>(std::move(data_->rename_to));
@@ -416,6 +459,14 @@ Status KuduColumnSpec::ToColumnSchemaDelta(ColumnSchemaDelta* col_delta) const {
     col_delta->cfile_block_size = boost::optional<int32_t>(data_->block_size);
   }
 
+  if (data_->has_bloom_filter) {
+    col_delta->bloom_filter = boost::optional<bool>(data_->bloom_filter);
+  }
+
+  if (data_->has_secondary_index) {
+    col_delta->secondary_index = boost::optional<bool>(data_->secondary_index);
+  }
+
   return Status::OK();
 }
 
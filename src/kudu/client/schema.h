@@ -115,6 +115,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     RLE = 4,
     DICT_ENCODING = 5,
     BIT_SHUFFLE = 6,
+    FRAME_OF_REFERENCE = 7,
 
     /// @deprecated GROUP_VARINT is not supported for valid types, and
     /// will fall back to another encoding on the server side.
@@ -128,6 +129,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     SNAPPY = 2,
     LZ4 = 3,
     ZLIB = 4,
+    ZSTD = 5,
   };
 
 
@@ -323,6 +325,53 @@ class KUDU_EXPORT KuduColumnSpec {
   /// @return Pointer to the modified object.
   KuduColumnSpec* BlockSize(int32_t block_size);
 
+  /// Set whether to keep per-block bloom filters for the column.
+  ///
+  /// Bloom filters let scans with equality or IN-list predicates on the
+  /// column skip blocks which cannot contain any of the requested values.
+  /// They are most useful for high-cardinality columns which are frequently
+  /// looked up by value, at the cost of some extra space on disk.
+  ///
+  /// @note Bloom filters are only written for non-key columns, and only
+  ///   for data flushed or compacted after this attribute is set.
+  ///
+  /// @param [in] enabled
+  ///   Whether bloom filters should be written for the column.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* BloomFilter(bool enabled);
+
+  /// Set whether to keep a secondary index on the column.
+  ///
+  /// Each rowset written with the index maps the column's values to the
+  /// rows holding them, so that scans with equality or IN-list predicates
+  /// on the column only read the matching rows rather than the whole
+  /// tablet. This suits lookups by a unique or nearly unique attribute,
+  /// such as an e-mail address or an external identifier.
+  ///
+  /// @note Secondary indexes are only written for non-key columns, and only
+  ///   for data flushed or compacted after this attribute is set.
+  ///
+  /// @param [in] enabled
+  ///   Whether a secondary index should be written for the column.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* SecondaryIndex(bool enabled);
+
+  /// Set the column group of the column.
+  ///
+  /// The non-key columns of a group are stored together, in a single block
+  /// of each rowset, so that scans reading many of them open and read fewer
+  /// blocks. This suits sets of small columns which are usually read
+  /// together, in tables with many columns.
+  ///
+  /// @note The group of a column can only be set when the column is created,
+  ///   and is ignored for key columns.
+  ///
+  /// @param [in] group
+  ///   The name of the group. Columns with the same group name are stored
+  ///   together.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* ColumnGroup(const std::string& group);
+
   /// @name Operations only relevant for decimal columns.
   ///
   ///@{
@@ -599,6 +648,7 @@ class KUDU_EXPORT KuduSchema {
  private:
   friend class ClientTest;
   friend class KuduClient;
+  friend class KuduColumnarWriteBatch;
   friend class KuduScanner;
   friend class KuduScanToken;
   friend class KuduScanTokenBuilder;
@@ -57,6 +57,7 @@ KuduSession::Data::Data(shared_ptr<KuduClient> client,
       messenger_(std::move(messenger)),
       error_collector_(new ErrorCollector()),
       external_consistency_mode_(CLIENT_PROPAGATED),
+      multi_tablet_writes_enabled_(false),
       flush_interval_(MonoDelta::FromMilliseconds(1000)),
       flush_task_active_(false),
       flush_mode_(AUTO_FLUSH_SYNC),
@@ -120,6 +121,17 @@ Status KuduSession::Data::SetExternalConsistencyMode(
   return Status::OK();
 }
 
+Status KuduSession::Data::SetMultiTabletWritesEnabled(bool enabled) {
+  std::lock_guard<Mutex> l(mutex_);
+  if (HasPendingOperationsUnlocked()) {
+    // NOTE: this is an artificial restriction.
+    return Status::IllegalState(
+        "Cannot change multi-tablet writes mode when writes are buffered");
+  }
+  multi_tablet_writes_enabled_ = enabled;
+  return Status::OK();
+}
+
 Status KuduSession::Data::SetFlushMode(FlushMode mode) {
   {
     std::lock_guard<Mutex> l(mutex_);
@@ -431,6 +443,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       if (timeout_.Initialized()) {
         batcher->SetTimeout(timeout_);
       }
+      batcher->SetMultiTabletWritesEnabled(multi_tablet_writes_enabled_);
       batcher.swap(batcher_);
       ++batchers_num_;
     }
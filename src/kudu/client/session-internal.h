@@ -81,6 +81,10 @@ class KuduSession::Data {
   // Set external consistency mode for the session.
   Status SetExternalConsistencyMode(KuduSession::ExternalConsistencyMode m);
 
+  // Set whether to write to several tablets of a tablet server with a single
+  // RPC.
+  Status SetMultiTabletWritesEnabled(bool enabled);
+
   // Set limit on buffer space consumed by buffered write operations.
   Status SetBufferBytesLimit(size_t size);
 
@@ -180,6 +184,9 @@ class KuduSession::Data {
 
   kudu::client::KuduSession::ExternalConsistencyMode external_consistency_mode_;
 
+  // Whether batchers may write to several tablets with a single RPC.
+  bool multi_tablet_writes_enabled_;
+
   // Timeout for the next batch.
   MonoDelta timeout_;
 
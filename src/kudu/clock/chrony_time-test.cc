@@ -0,0 +1,132 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/clock/chrony_time.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/endian.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::vector;
+
+namespace kudu {
+namespace clock {
+
+namespace {
+
+// Encode coef * 2^(exp - 25) in chronyd's 32-bit floating point format.
+uint32_t EncodeFloat(int32_t coef, int32_t exp) {
+  return (static_cast<uint32_t>(exp) & 0x7f) << 25 |
+         (static_cast<uint32_t>(coef) & 0x1ffffff);
+}
+
+// Build a tracking reply to the given request, as chronyd would send it.
+vector<uint8_t> MakeReply(const vector<uint8_t>& request, uint16_t leap_status,
+                          uint32_t correction, uint32_t root_delay,
+                          uint32_t root_dispersion) {
+  vector<uint8_t> reply(request.size(), 0);
+  uint8_t* p = reply.data();
+  p[0] = request[0];
+  p[1] = 2; // reply
+  BigEndian::Store16(p + 4, BigEndian::Load16(request.data() + 4));
+  BigEndian::Store16(p + 6, 5); // tracking reply
+  BigEndian::Store32(p + 16, BigEndian::Load32(request.data() + 8));
+  BigEndian::Store16(p + 28 + 26, leap_status);
+  BigEndian::Store32(p + 28 + 40, correction);
+  BigEndian::Store32(p + 28 + 64, root_delay);
+  BigEndian::Store32(p + 28 + 68, root_dispersion);
+  return reply;
+}
+
+} // anonymous namespace
+
+class ChronyTimeTest : public KuduTest {};
+
+TEST_F(ChronyTimeTest, TestDecodeFloat) {
+  EXPECT_EQ(0, ChronyTime::DecodeFloat(0));
+  EXPECT_EQ(1.0, ChronyTime::DecodeFloat(EncodeFloat(1, 25)));
+  EXPECT_EQ(-1.0, ChronyTime::DecodeFloat(EncodeFloat(-1, 25)));
+  EXPECT_EQ(0.25, ChronyTime::DecodeFloat(EncodeFloat(1 << 23, 0)));
+  EXPECT_EQ(-0.25, ChronyTime::DecodeFloat(EncodeFloat(-(1 << 23), 0)));
+  // Negative exponents.
+  EXPECT_EQ(1.0 / (1 << 20), ChronyTime::DecodeFloat(EncodeFloat(1 << 20, -15)));
+  EXPECT_EQ(3 * 1e0 / (1 << 30), ChronyTime::DecodeFloat(EncodeFloat(3, -5)));
+}
+
+TEST_F(ChronyTimeTest, TestParseTrackingReply) {
+  vector<uint8_t> request;
+  ChronyTime::BuildTrackingRequest(42, &request);
+  // Requests are padded to the size of their replies.
+  ASSERT_EQ(104, request.size());
+  ASSERT_EQ(6, request[0]);
+  ASSERT_EQ(1, request[1]);
+  ASSERT_EQ(33, BigEndian::Load16(request.data() + 4));
+  ASSERT_EQ(42, BigEndian::Load32(request.data() + 8));
+
+  // 2^-13 s of correction, 2^-12 s of root delay and 2^-14 s of dispersion.
+  const uint32_t correction = EncodeFloat(1 << 20, -8);
+  const uint32_t root_delay = EncodeFloat(1 << 21, -8);
+  const uint32_t root_dispersion = EncodeFloat(1 << 19, -8);
+  vector<uint8_t> reply = MakeReply(request, 0, correction, root_delay, root_dispersion);
+
+  ChronyTime::TrackingReport report;
+  ASSERT_OK(ChronyTime::ParseTrackingReply(reply.data(), reply.size(), 42, &report));
+  EXPECT_TRUE(report.synchronized);
+  EXPECT_EQ(1.0 / 8192, report.current_correction);
+  EXPECT_EQ(1.0 / 4096, report.root_delay);
+  EXPECT_EQ(1.0 / 16384, report.root_dispersion);
+
+  // Replies to other requests, truncated replies and replies with errors are
+  // rejected.
+  Status s = ChronyTime::ParseTrackingReply(reply.data(), reply.size(), 43, &report);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  s = ChronyTime::ParseTrackingReply(reply.data(), reply.size() - 1, 42, &report);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  vector<uint8_t> failed = reply;
+  BigEndian::Store16(failed.data() + 8, 2);
+  s = ChronyTime::ParseTrackingReply(failed.data(), failed.size(), 42, &report);
+  ASSERT_TRUE(s.IsRemoteError()) << s.ToString();
+
+  // An unsynchronized leap status is reported.
+  reply = MakeReply(request, 3, correction, root_delay, root_dispersion);
+  ASSERT_OK(ChronyTime::ParseTrackingReply(reply.data(), reply.size(), 42, &report));
+  EXPECT_FALSE(report.synchronized);
+}
+
+TEST_F(ChronyTimeTest, TestErrorBound) {
+  ChronyTime::TrackingReport report;
+  report.synchronized = true;
+  report.current_correction = -0.0001;
+  report.root_delay = 0.0002;
+  report.root_dispersion = 0.00005;
+  // 100us + 200us / 2 + 50us, rounded up.
+  uint64_t bound = ChronyTime::ErrorBoundMicros(report);
+  EXPECT_GE(bound, 250);
+  EXPECT_LE(bound, 251);
+
+  report = ChronyTime::TrackingReport();
+  EXPECT_EQ(0, ChronyTime::ErrorBoundMicros(report));
+}
+
+} // namespace clock
+} // namespace kudu
@@ -0,0 +1,317 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/clock/chrony_time.h"
+
+#include <sys/socket.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/endian.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/net/sockaddr.h"
+#include "kudu/util/net/socket.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/subprocess.h"
+#include "kudu/util/thread.h"
+
+DECLARE_int32(ntp_initial_sync_wait_secs);
+
+DEFINE_int32(chrony_command_port, 323,
+             "The UDP port on the local host on which chronyd accepts commands. "
+             "Used with --time_source=chrony.");
+TAG_FLAG(chrony_command_port, advanced);
+TAG_FLAG(chrony_command_port, experimental);
+
+DEFINE_int32(chrony_tracking_refresh_ms, 1000,
+             "How often, in milliseconds, to request the tracking report of "
+             "chronyd which bounds the clock error. The report is requested "
+             "in the background. Used with --time_source=chrony.");
+TAG_FLAG(chrony_tracking_refresh_ms, advanced);
+TAG_FLAG(chrony_tracking_refresh_ms, experimental);
+
+DEFINE_int32(chrony_max_skew_ppm, 100,
+             "The maximum frequency error, in PPM, of the system clock between "
+             "two tracking reports of chronyd. The clock error bound grows by "
+             "this rate after each report. Used with --time_source=chrony.");
+TAG_FLAG(chrony_max_skew_ppm, advanced);
+TAG_FLAG(chrony_max_skew_ppm, experimental);
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace clock {
+
+namespace {
+
+// Constants of chronyd's command protocol (see candm.h in chrony's source).
+constexpr uint8_t kProtocolVersion = 6;
+constexpr uint8_t kPacketTypeRequest = 1;
+constexpr uint8_t kPacketTypeReply = 2;
+constexpr uint16_t kRequestTracking = 33;
+constexpr uint16_t kReplyTracking = 5;
+constexpr uint16_t kStatusSuccess = 0;
+constexpr uint16_t kLeapUnsynchronized = 3;
+
+// The sizes of the headers of requests and replies, and of the body of a
+// tracking reply. A request must be padded to the size of its reply.
+constexpr size_t kRequestHeaderSize = 20;
+constexpr size_t kReplyHeaderSize = 28;
+constexpr size_t kTrackingReplySize = kReplyHeaderSize + 76;
+
+// Offsets of the fields of a tracking reply used here.
+constexpr size_t kReplyCommandOffset = 4;
+constexpr size_t kReplyTypeOffset = 6;
+constexpr size_t kReplyStatusOffset = 8;
+constexpr size_t kReplySequenceOffset = 16;
+constexpr size_t kLeapStatusOffset = kReplyHeaderSize + 26;
+constexpr size_t kCurrentCorrectionOffset = kReplyHeaderSize + 40;
+constexpr size_t kRootDelayOffset = kReplyHeaderSize + 64;
+constexpr size_t kRootDispersionOffset = kReplyHeaderSize + 68;
+
+// How long to wait for a reply from chronyd.
+constexpr int kReplyTimeoutMs = 100;
+
+const uint64_t kMicrosPerSec = 1000000;
+
+} // anonymous namespace
+
+double ChronyTime::DecodeFloat(uint32_t value) {
+  // The 7 most significant bits hold the exponent, and the others the
+  // coefficient, both in two's complement.
+  constexpr int kExpBits = 7;
+  constexpr int kCoefBits = 32 - kExpBits;
+  int32_t exp = value >> kCoefBits;
+  if (exp >= 1 << (kExpBits - 1)) {
+    exp -= 1 << kExpBits;
+  }
+  exp -= kCoefBits;
+  int32_t coef = value % (1U << kCoefBits);
+  if (coef >= 1 << (kCoefBits - 1)) {
+    coef -= 1 << kCoefBits;
+  }
+  return coef * std::pow(2.0, exp);
+}
+
+void ChronyTime::BuildTrackingRequest(uint32_t sequence, vector<uint8_t>* packet) {
+  packet->assign(kTrackingReplySize, 0);
+  uint8_t* p = packet->data();
+  p[0] = kProtocolVersion;
+  p[1] = kPacketTypeRequest;
+  BigEndian::Store16(p + 4, kRequestTracking);
+  BigEndian::Store32(p + 8, sequence);
+  static_assert(kRequestHeaderSize <= kTrackingReplySize, "request larger than reply");
+}
+
+Status ChronyTime::ParseTrackingReply(const uint8_t* data, size_t len, uint32_t sequence,
+                                      TrackingReport* report) {
+  if (len < kTrackingReplySize) {
+    return Status::Corruption(Substitute("tracking reply too short: $0 bytes", len));
+  }
+  if (data[0] != kProtocolVersion || data[1] != kPacketTypeReply) {
+    return Status::NotSupported(Substitute("unexpected reply version $0 or type $1",
+                                           data[0], data[1]));
+  }
+  if (BigEndian::Load32(data + kReplySequenceOffset) != sequence) {
+    return Status::Corruption("reply to another request");
+  }
+  uint16_t status = BigEndian::Load16(data + kReplyStatusOffset);
+  if (status != kStatusSuccess) {
+    return Status::RemoteError(Substitute("chronyd failed the request with status $0",
+                                          status));
+  }
+  if (BigEndian::Load16(data + kReplyCommandOffset) != kRequestTracking ||
+      BigEndian::Load16(data + kReplyTypeOffset) != kReplyTracking) {
+    return Status::Corruption("not a tracking reply");
+  }
+  report->synchronized = BigEndian::Load16(data + kLeapStatusOffset) != kLeapUnsynchronized;
+  report->current_correction = DecodeFloat(BigEndian::Load32(data + kCurrentCorrectionOffset));
+  report->root_delay = DecodeFloat(BigEndian::Load32(data + kRootDelayOffset));
+  report->root_dispersion = DecodeFloat(BigEndian::Load32(data + kRootDispersionOffset));
+  return Status::OK();
+}
+
+uint64_t ChronyTime::ErrorBoundMicros(const TrackingReport& report) {
+  // The system clock is off from chronyd's estimate by the correction it has
+  // yet to apply, and the estimate is off from the reference by at most half
+  // the round trip to the reference plus its dispersion.
+  double error_secs = std::fabs(report.current_correction) +
+                      std::fabs(report.root_delay) / 2 +
+                      std::fabs(report.root_dispersion);
+  return static_cast<uint64_t>(std::ceil(error_secs * kMicrosPerSec));
+}
+
+Status ChronyTime::RequestTracking(TrackingReport* report) {
+  int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    int err = errno;
+    return Status::NetworkError("error opening socket", ErrnoToString(err), err);
+  }
+  Socket sock(fd);
+  RETURN_NOT_OK(sock.SetRecvTimeout(MonoDelta::FromMilliseconds(kReplyTimeoutMs)));
+  Sockaddr addr;
+  RETURN_NOT_OK(addr.ParseString("127.0.0.1", FLAGS_chrony_command_port));
+  RETURN_NOT_OK(sock.Connect(addr));
+
+  uint32_t sequence = ++sequence_;
+  vector<uint8_t> request;
+  BuildTrackingRequest(sequence, &request);
+  int32_t nwritten;
+  RETURN_NOT_OK(sock.Write(request.data(), request.size(), &nwritten));
+
+  uint8_t reply[kTrackingReplySize * 2];
+  int32_t nread;
+  RETURN_NOT_OK(sock.Recv(reply, sizeof(reply), &nread));
+  return ParseTrackingReply(reply, nread, sequence, report);
+}
+
+ChronyTime::ChronyTime()
+    : stop_latch_(1) {
+}
+
+ChronyTime::~ChronyTime() {
+  stop_latch_.CountDown();
+  if (refresh_thread_) {
+    refresh_thread_->Join();
+  }
+}
+
+Status ChronyTime::RefreshErrorBound() {
+  TrackingReport report;
+  RETURN_NOT_OK_PREPEND(RequestTracking(&report),
+                        "unable to get the tracking report of chronyd");
+  if (!report.synchronized) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    synchronized_ = false;
+    return Status::ServiceUnavailable("chronyd reports the clock as unsynchronized");
+  }
+  uint64_t error_usec = ErrorBoundMicros(report);
+  std::lock_guard<simple_spinlock> l(lock_);
+  synchronized_ = true;
+  last_refresh_ = MonoTime::Now();
+  last_error_usec_ = error_usec;
+  return Status::OK();
+}
+
+void ChronyTime::RefreshThread() {
+  while (!stop_latch_.WaitFor(MonoDelta::FromMilliseconds(FLAGS_chrony_tracking_refresh_ms))) {
+    // If chronyd can't be reached, e.g. while it restarts, the last bound
+    // keeps being extended.
+    Status s = RefreshErrorBound();
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 10) << s.ToString();
+    }
+  }
+}
+
+Status ChronyTime::Init() {
+  const MonoTime deadline = MonoTime::Now() +
+      MonoDelta::FromSeconds(std::max(FLAGS_ntp_initial_sync_wait_secs, 0));
+  Status s;
+  while (!(s = RefreshErrorBound()).ok() && MonoTime::Now() < deadline) {
+    KLOG_EVERY_N_SECS(INFO, 10) << "Waiting for chronyd to synchronize the clock: "
+                                << s.ToString();
+    SleepFor(MonoDelta::FromSeconds(1));
+  }
+  if (!s.ok()) {
+    DumpDiagnostics(/* log= */nullptr);
+    return s;
+  }
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    LOG(INFO) << "chronyd time source initialized."
+              << " Max skew: " << skew_ppm() << "ppm"
+              << " Current error: " << last_error_usec_ << "us";
+  }
+
+  // The tracking report is refreshed in the background, so that reading the
+  // clock never waits for chronyd.
+  return Thread::Create("clock", "chrony-refresh", &ChronyTime::RefreshThread, this,
+                        &refresh_thread_);
+}
+
+Status ChronyTime::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) {
+  timespec ts;
+  if (PREDICT_FALSE(clock_gettime(CLOCK_REALTIME, &ts) != 0)) {
+    int err = errno;
+    return Status::IOError("Error reading clock", ErrnoToString(err), err);
+  }
+  // Read the bound after the clock, so that the time since the report isn't
+  // underestimated.
+  MonoTime last_refresh;
+  uint64_t last_error_usec;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (PREDICT_FALSE(!synchronized_)) {
+      return Status::ServiceUnavailable("Error reading clock. chronyd reports the clock as "
+                                        "unsynchronized");
+    }
+    last_refresh = last_refresh_;
+    last_error_usec = last_error_usec_;
+  }
+  int64_t since_refresh_usec = std::max<int64_t>(
+      (MonoTime::Now() - last_refresh).ToMicroseconds(), 0);
+  *now_usec = ts.tv_sec * kMicrosPerSec + ts.tv_nsec / 1000;
+  *error_usec = last_error_usec +
+      (since_refresh_usec * skew_ppm() + kMicrosPerSec - 1) / kMicrosPerSec;
+  return Status::OK();
+}
+
+int64_t ChronyTime::skew_ppm() const {
+  return FLAGS_chrony_max_skew_ppm;
+}
+
+void ChronyTime::DumpDiagnostics(vector<string>* log) const {
+  LOG_STRING(ERROR, log) << "Dumping chronyd diagnostics";
+  for (const vector<string>& cmd : vector<vector<string>>{
+           {"chronyc", "-n", "tracking"},
+           {"chronyc", "-n", "sources"} }) {
+    string exe, out, err;
+    Status s = FindExecutable(cmd[0], {"/sbin", "/usr/sbin/", "/usr/bin"}, &exe);
+    if (!s.ok()) {
+      LOG_STRING(WARNING, log) << "could not find executable: " << cmd[0];
+      return;
+    }
+    vector<string> argv = cmd;
+    argv[0] = exe;
+    s = Subprocess::Call(argv, "", &out, &err);
+    LOG_STRING(ERROR, log) << "chronyc " << cmd.back() << ": " << s.ToString()
+                           << (!out.empty() ? Substitute("\nstdout:\n$0", out) : "")
+                           << (!err.empty() ? Substitute("\nstderr:\n$0", err) : "");
+  }
+}
+
+} // namespace clock
+} // namespace kudu
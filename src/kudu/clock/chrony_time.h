@@ -0,0 +1,132 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kudu/clock/time_service.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+
+namespace clock {
+
+// TimeService implementation which reads the system clock, and bounds its
+// error using the tracking report of the chronyd running on the local host.
+// The report is requested over chronyd's command port.
+//
+// The maximum error that ntp_adjtime() reports (see SystemNtp) grows by 500us
+// every second between two updates of the kernel, and is often hundreds of
+// milliseconds. chronyd's report accounts for the actual accuracy of its
+// sources instead. With a PTP hardware clock as its reference clock
+// ('refclock PHC' in chrony.conf), or with nearby NTP servers using hardware
+// timestamping, the bound is typically well under a millisecond. This makes
+// COMMIT_WAIT and waiting for snapshot scan timestamps much shorter.
+//
+// The report is requested again every --chrony_tracking_refresh_ms by a
+// background thread, so that reading the clock never waits for chronyd. In
+// between, the bound grows by --chrony_max_skew_ppm.
+class ChronyTime : public TimeService {
+ public:
+  // The parts of chronyd's tracking report used to bound the clock error.
+  struct TrackingReport {
+    // Whether chronyd considers the clock synchronized.
+    bool synchronized = false;
+
+    // The offset of the system clock that chronyd is still correcting, in
+    // seconds.
+    double current_correction = 0;
+
+    // The round-trip delay to and the dispersion of the stratum-1 reference,
+    // in seconds.
+    double root_delay = 0;
+    double root_dispersion = 0;
+  };
+
+  ChronyTime();
+  virtual ~ChronyTime();
+
+  // Request a tracking report from chronyd, waiting up to
+  // --ntp_initial_sync_wait_secs for it to synchronize the clock.
+  virtual Status Init() override;
+
+  virtual Status WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) override;
+
+  virtual int64_t skew_ppm() const override;
+
+  virtual void DumpDiagnostics(std::vector<std::string>* log) const override;
+
+  // Returns the bound, in microseconds, of the error of a clock as of the
+  // given tracking report.
+  static uint64_t ErrorBoundMicros(const TrackingReport& report);
+
+  // Set 'packet' to a tracking request of chronyd's command protocol, with
+  // the given sequence number.
+  static void BuildTrackingRequest(uint32_t sequence, std::vector<uint8_t>* packet);
+
+  // Parse the reply to the tracking request with the given sequence number.
+  static Status ParseTrackingReply(const uint8_t* data, size_t len, uint32_t sequence,
+                                   TrackingReport* report);
+
+  // Decode a number in chronyd's 32-bit floating point format, after it was
+  // converted to host byte order.
+  static double DecodeFloat(uint32_t value);
+
+ private:
+  // Request a tracking report from chronyd.
+  Status RequestTracking(TrackingReport* report);
+
+  // Request a tracking report and update the error bound with it.
+  Status RefreshErrorBound();
+
+  // Refreshes the error bound every --chrony_tracking_refresh_ms until
+  // 'stop_latch_' is counted down.
+  void RefreshThread();
+
+  CountDownLatch stop_latch_;
+  scoped_refptr<Thread> refresh_thread_;
+
+  // Protects the fields below.
+  mutable simple_spinlock lock_;
+
+  // Whether chronyd considered the clock synchronized in its last report.
+  bool synchronized_ = false;
+
+  // When the last tracking report of a synchronized clock was received, and
+  // the error bound as of it.
+  MonoTime last_refresh_;
+  uint64_t last_error_usec_ = 0;
+
+  // The sequence number of the last request. Only used by the thread
+  // refreshing the report.
+  uint32_t sequence_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ChronyTime);
+};
+
+} // namespace clock
+} // namespace kudu
@@ -44,6 +44,7 @@
 
 
 DECLARE_bool(inject_unsync_time_errors);
+DECLARE_int32(hybrid_clock_walltime_refresh_usec);
 DECLARE_string(time_source);
 
 using std::string;
@@ -305,6 +306,59 @@ TEST_F(HybridClockTest, TestClockDoesntGoBackwardsWithUpdates) {
   }
 }
 
+// Thread which reads the clock in a tight loop, recording the timestamps.
+void ReaderThread(HybridClock* clock, int num_reads, vector<uint64_t>* timestamps) {
+  for (int i = 0; i < num_reads; i++) {
+    timestamps->push_back(clock->Now().value());
+  }
+}
+
+// Test that threads reading the clock concurrently never get the same
+// timestamp, and each sees the clock move strictly forwards.
+TEST_F(HybridClockTest, TestConcurrentNowIsUnique) {
+  const int kNumThreads = 4;
+  const int kNumReads = 10000;
+  vector<vector<uint64_t>> timestamps(kNumThreads);
+  vector<scoped_refptr<Thread>> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    scoped_refptr<Thread> thread;
+    ASSERT_OK(Thread::Create("test", "reader",
+                             &ReaderThread, clock_.get(), kNumReads, &timestamps[i],
+                             &thread));
+    threads.push_back(thread);
+  }
+  for (const auto& t : threads) {
+    t->Join();
+  }
+
+  vector<uint64_t> all;
+  for (const auto& thread_timestamps : timestamps) {
+    ASSERT_TRUE(std::is_sorted(thread_timestamps.begin(), thread_timestamps.end()));
+    all.insert(all.end(), thread_timestamps.begin(), thread_timestamps.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+
+// Test that readings extrapolated from a recent reading of the time source
+// keep moving forward along with the time source, and that their error grows.
+TEST_F(HybridClockTest, TestExtrapolatedReads) {
+  FLAGS_hybrid_clock_walltime_refresh_usec = 10 * 1000 * 1000;
+  Timestamp first_ts;
+  uint64_t first_error;
+  clock_->NowWithError(&first_ts, &first_error);
+
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  Timestamp second_ts;
+  uint64_t second_error;
+  clock_->NowWithError(&second_ts, &second_error);
+
+  // The second reading was extrapolated from the first.
+  MonoDelta phys_diff = clock_->GetPhysicalComponentDifference(second_ts, first_ts);
+  ASSERT_GE(phys_diff.ToMilliseconds(), 100);
+  ASSERT_GE(second_error, first_error);
+}
+
 TEST_F(HybridClockTest, TestGetPhysicalComponentDifference) {
   Timestamp now1 = HybridClock::TimestampFromMicrosecondsAndLogicalValue(100, 100);
   SleepFor(MonoDelta::FromMilliseconds(1));
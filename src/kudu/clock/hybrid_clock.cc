@@ -18,6 +18,7 @@
 #include "kudu/clock/hybrid_clock.h"
 
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <ostream>
 #include <string>
@@ -26,6 +27,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/clock/chrony_time.h"
 #include "kudu/clock/mock_ntp.h"
 #include "kudu/clock/system_ntp.h"
 #include "kudu/gutil/bind.h"
@@ -53,6 +55,17 @@ DEFINE_int32(max_clock_sync_error_usec, 10 * 1000 * 1000, // 10 secs
 TAG_FLAG(max_clock_sync_error_usec, advanced);
 TAG_FLAG(max_clock_sync_error_usec, runtime);
 
+DEFINE_int32(hybrid_clock_walltime_refresh_usec, 1000,
+             "Maximum age, in microseconds, of a reading from the time source that "
+             "HybridClock may extrapolate the current time from, using the monotonic "
+             "clock, instead of asking the time source again. The extrapolated "
+             "error bound grows by the time source's maximum skew. A value of zero "
+             "makes every clock reading ask the time source. Not used with the "
+             "'mock' time source.");
+TAG_FLAG(hybrid_clock_walltime_refresh_usec, advanced);
+TAG_FLAG(hybrid_clock_walltime_refresh_usec, experimental);
+TAG_FLAG(hybrid_clock_walltime_refresh_usec, runtime);
+
 DEFINE_bool(use_hybrid_clock, true,
             "Whether HybridClock should be used as the default clock"
             " implementation. This should be disabled for testing purposes only.");
@@ -60,15 +73,20 @@ TAG_FLAG(use_hybrid_clock, hidden);
 
 DEFINE_string(time_source, "system",
               "The clock source that HybridClock should use. Must be one of "
-              "'system' or 'mock' (for tests only)");
+              "'system', 'chrony' or 'mock' (for tests only). 'chrony' reads the "
+              "system clock like 'system', but bounds its error with the tracking "
+              "report of the local chronyd rather than with the kernel's maximum "
+              "error, which is usually much tighter, e.g. with a PTP hardware "
+              "clock as chronyd's reference clock.");
 TAG_FLAG(time_source, experimental);
 DEFINE_validator(time_source, [](const char* /* flag_name */, const string& value) {
     if (boost::iequals(value, "system") ||
+        boost::iequals(value, "chrony") ||
         boost::iequals(value, "mock")) {
       return true;
     }
     LOG(ERROR) << "unknown value for 'time_source': '" << value << "'"
-               << " (expected one of 'system' or 'mock')";
+               << " (expected one of 'system', 'chrony' or 'mock')";
     return false;
   });
 
@@ -111,6 +129,11 @@ const uint64_t HybridClock::kLogicalBitMask = (1 << kBitsToShift) - 1;
 
 HybridClock::HybridClock()
     : next_timestamp_(0),
+      last_clock_read_seq_(0),
+      last_clock_read_time_nanos_(0),
+      last_clock_read_physical_(0),
+      last_clock_read_error_(0),
+      extrapolate_reads_(false),
       state_(kNotInitialized) {
 }
 
@@ -122,11 +145,20 @@ Status HybridClock::Init() {
     time_service_.reset(new clock::SystemNtp());
 #else
     time_service_.reset(new clock::SystemUnsyncTime());
+#endif
+  } else if (boost::iequals(FLAGS_time_source, "chrony")) {
+#ifndef __APPLE__
+    time_service_.reset(new clock::ChronyTime());
+#else
+    return Status::NotSupported("the chrony time source is not supported on macOS");
 #endif
   } else {
     return Status::InvalidArgument("invalid NTP source", FLAGS_time_source);
   }
   RETURN_NOT_OK(time_service_->Init());
+  // Tests move the mock time source by hand, and expect every reading to
+  // see it.
+  extrapolate_reads_ = !boost::iequals(FLAGS_time_source, "mock");
 
   state_ = kInitialized;
 
@@ -136,8 +168,6 @@ Status HybridClock::Init() {
 Timestamp HybridClock::Now() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return now;
 }
@@ -146,10 +176,7 @@ Timestamp HybridClock::NowLatest() {
   Timestamp now;
   uint64_t error;
 
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   uint64_t now_latest = GetPhysicalValueMicros(now) + error;
   uint64_t now_logical = GetLogicalValue(now);
@@ -174,18 +201,30 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   WalltimeWithErrorOrDie(&now_usec, &error_usec);
 
   // If the physical time from the system clock is higher than our last-returned
-  // time, we should use the physical timestamp.
+  // time, we should use the physical timestamp. Otherwise, hand out the next
+  // logical value. Either way, the timestamp is claimed by advancing
+  // 'next_timestamp_' with a compare-and-swap, so concurrent callers never
+  // get the same timestamp and never see the clock go backwards.
   uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
-  if (PREDICT_TRUE(candidate_phys_timestamp > next_timestamp_)) {
-    next_timestamp_ = candidate_phys_timestamp;
-    *timestamp = Timestamp(next_timestamp_++);
-    *max_error_usec = error_usec;
-    if (PREDICT_FALSE(VLOG_IS_ON(2))) {
-      VLOG(2) << "Current clock is higher than the last one. Resetting logical values."
-          << " Physical Value: " << now_usec << " usec Logical Value: 0  Error: "
-          << error_usec;
+  uint64_t next = next_timestamp_.load(std::memory_order_relaxed);
+  while (true) {
+    if (PREDICT_TRUE(candidate_phys_timestamp > next)) {
+      if (next_timestamp_.compare_exchange_weak(next, candidate_phys_timestamp + 1,
+                                               std::memory_order_relaxed)) {
+        *timestamp = Timestamp(candidate_phys_timestamp);
+        *max_error_usec = error_usec;
+        if (PREDICT_FALSE(VLOG_IS_ON(2))) {
+          VLOG(2) << "Current clock is higher than the last one. Resetting logical values."
+              << " Physical Value: " << now_usec << " usec Logical Value: 0  Error: "
+              << error_usec;
+        }
+        return;
+      }
+    } else if (next_timestamp_.compare_exchange_weak(next, next + 1,
+                                                     std::memory_order_relaxed)) {
+      break;
     }
-    return;
+    // Another thread claimed a timestamp first; 'next' now holds its update.
   }
 
   // We don't have the last time read max error since it might have originated
@@ -206,8 +245,8 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   // This broadens the error interval for both cases but always returns
   // a correct error interval.
 
-  *max_error_usec = (next_timestamp_ >> kBitsToShift) - (now_usec - error_usec);
-  *timestamp = Timestamp(next_timestamp_++);
+  *max_error_usec = (next >> kBitsToShift) - (now_usec - error_usec);
+  *timestamp = Timestamp(next);
   if (PREDICT_FALSE(VLOG_IS_ON(2))) {
     VLOG(2) << "Current clock is lower than the last one. Returning last read and incrementing"
         " logical values. Clock: " + Stringify(*timestamp) << " Error: " << *max_error_usec;
@@ -215,7 +254,6 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
 }
 
 Status HybridClock::Update(const Timestamp& to_update) {
-  std::lock_guard<simple_spinlock> lock(lock_);
   Timestamp now;
   uint64_t error_ignored;
   NowWithError(&now, &error_ignored);
@@ -237,8 +275,12 @@ Status HybridClock::Update(const Timestamp& to_update) {
   }
 
   // Our next timestamp must be higher than the one that we are updating
-  // from.
-  next_timestamp_ = to_update.value() + 1;
+  // from. A concurrent caller may have moved it past that already.
+  uint64_t next = next_timestamp_.load(std::memory_order_relaxed);
+  while (next <= to_update.value() &&
+         !next_timestamp_.compare_exchange_weak(next, to_update.value() + 1,
+                                                std::memory_order_relaxed)) {
+  }
   return Status::OK();
 }
 
@@ -260,10 +302,7 @@ Status HybridClock::WaitUntilAfter(const Timestamp& then,
   TRACE_EVENT0("clock", "HybridClock::WaitUntilAfter");
   Timestamp now;
   uint64_t error;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   // "unshift" the timestamps so that we can measure actual time
   uint64_t now_usec = GetPhysicalValueMicros(now);
@@ -301,10 +340,7 @@ Status HybridClock::WaitUntilAfterLocally(const Timestamp& then,
                                           const MonoTime& deadline) {
   Timestamp now;
   uint64_t error;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
   if (now > then) {
     return Status::OK();
   }
@@ -325,11 +361,8 @@ bool HybridClock::IsAfter(Timestamp t) {
   uint64_t error_usec;
   WalltimeWithErrorOrDie(&now_usec, &error_usec);
 
-  Timestamp now;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    now = Timestamp(std::max(next_timestamp_, now_usec << kBitsToShift));
-  }
+  Timestamp now(std::max(next_timestamp_.load(std::memory_order_relaxed),
+                         now_usec << kBitsToShift));
   return t.value() < now.value();
 }
 
@@ -341,9 +374,71 @@ void HybridClock::WalltimeWithErrorOrDie(uint64_t* now_usec, uint64_t* error_use
   }
 }
 
+bool HybridClock::GetLastClockRead(MonoTime* read_time,
+                                   uint64_t* physical,
+                                   uint64_t* error) const {
+  uint64_t seq = last_clock_read_seq_.load(std::memory_order_acquire);
+  if (seq & 1) {
+    // A write is in progress.
+    return false;
+  }
+  int64_t read_time_nanos = last_clock_read_time_nanos_.load(std::memory_order_relaxed);
+  *physical = last_clock_read_physical_.load(std::memory_order_relaxed);
+  *error = last_clock_read_error_.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (read_time_nanos == 0 || last_clock_read_seq_.load(std::memory_order_relaxed) != seq) {
+    return false;
+  }
+  *read_time = MonoTime::Min() + MonoDelta::FromNanoseconds(read_time_nanos);
+  return true;
+}
+
+void HybridClock::SetLastClockRead(MonoTime read_time, uint64_t physical, uint64_t error) {
+  DCHECK(last_clock_read_lock_.is_locked());
+  uint64_t seq = last_clock_read_seq_.load(std::memory_order_relaxed);
+  last_clock_read_seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  last_clock_read_time_nanos_.store((read_time - MonoTime::Min()).ToNanoseconds(),
+                                    std::memory_order_relaxed);
+  last_clock_read_physical_.store(physical, std::memory_order_relaxed);
+  last_clock_read_error_.store(error, std::memory_order_relaxed);
+  last_clock_read_seq_.store(seq + 2, std::memory_order_release);
+}
+
+bool HybridClock::ExtrapolateFromLastClockRead(MonoTime now,
+                                               int64_t max_age_usec,
+                                               uint64_t* now_usec,
+                                               uint64_t* error_usec) const {
+  MonoTime read_time;
+  uint64_t physical;
+  uint64_t error;
+  if (!GetLastClockRead(&read_time, &physical, &error)) {
+    return false;
+  }
+  int64_t micros_since_last_read = (now - read_time).ToMicroseconds();
+  if (micros_since_last_read < 0 || micros_since_last_read >= max_age_usec) {
+    return false;
+  }
+  // The monotonic clock may have drifted from the true time by up to the
+  // time source's maximum skew since the reading; round that up.
+  int64_t accum_error_us = (micros_since_last_read * time_service_->skew_ppm() + 999999) / 1000000;
+  *now_usec = physical + micros_since_last_read;
+  *error_usec = error + accum_error_us;
+  return true;
+}
+
 Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) {
   bool is_extrapolated = false;
   auto read_time_before = MonoTime::Now();
+
+  // Fast path: extrapolate from a sufficiently recent reading, which takes
+  // neither a lock nor a call into the time source.
+  int32_t refresh_usec = FLAGS_hybrid_clock_walltime_refresh_usec;
+  if (extrapolate_reads_ && refresh_usec > 0 &&
+      ExtrapolateFromLastClockRead(read_time_before, refresh_usec, now_usec, error_usec)) {
+    return CheckClockError(*error_usec, /*is_extrapolated=*/false);
+  }
+
   Status s = time_service_->WalltimeWithError(now_usec, error_usec);
   auto read_time_after = MonoTime::Now();
 
@@ -371,39 +466,51 @@ Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec)
     MonoTime read_time_max_likelihood = read_time_before +
         MonoDelta::FromMicroseconds(read_time_error_us);
 
-    std::unique_lock<simple_spinlock> l(last_clock_read_lock_);
-    if (!last_clock_read_time_.Initialized() ||
-        last_clock_read_time_ < read_time_max_likelihood) {
-      last_clock_read_time_ = read_time_max_likelihood;
-      last_clock_read_physical_ = *now_usec;
-      last_clock_read_error_ = *error_usec + read_time_error_us;
+    // If another thread is already recording its reading, which is about as
+    // recent as this one, don't wait for it.
+    std::unique_lock<simple_spinlock> l(last_clock_read_lock_, std::try_to_lock);
+    if (l.owns_lock()) {
+      MonoTime last_read_time;
+      uint64_t last_physical;
+      uint64_t last_error;
+      if (!GetLastClockRead(&last_read_time, &last_physical, &last_error) ||
+          last_read_time < read_time_max_likelihood) {
+        SetLastClockRead(read_time_max_likelihood, *now_usec,
+                         *error_usec + read_time_error_us);
+      }
     }
   } else {
     // We failed to read the clock. Extrapolate the new time based on our
     // last successful read.
-    std::unique_lock<simple_spinlock> l(last_clock_read_lock_);
-    if (!last_clock_read_time_.Initialized()) {
-      RETURN_NOT_OK_PREPEND(s, "could not read system time source");
+    MonoTime last_read_time;
+    uint64_t last_physical;
+    uint64_t last_error;
+    {
+      std::lock_guard<simple_spinlock> l(last_clock_read_lock_);
+      if (!GetLastClockRead(&last_read_time, &last_physical, &last_error)) {
+        RETURN_NOT_OK_PREPEND(s, "could not read system time source");
+      }
     }
-    MonoDelta time_since_last_read = read_time_after - last_clock_read_time_;
+    MonoDelta time_since_last_read = read_time_after - last_read_time;
     int64_t micros_since_last_read = time_since_last_read.ToMicroseconds();
     int64_t accum_error_us = (micros_since_last_read * time_service_->skew_ppm()) / 1000000;
-    *now_usec = last_clock_read_physical_ + micros_since_last_read;
-    *error_usec = last_clock_read_error_ + accum_error_us;
+    *now_usec = last_physical + micros_since_last_read;
+    *error_usec = last_error + accum_error_us;
     is_extrapolated = true;
-    l.unlock();
-    // Log after unlocking to minimize the lock hold time.
     KLOG_EVERY_N_SECS(ERROR, 1) << "Unable to read clock for last "
                                 << time_since_last_read.ToString() << ": " << s.ToString();
 
   }
+  return CheckClockError(*error_usec, is_extrapolated);
+}
 
+Status HybridClock::CheckClockError(uint64_t error_usec, bool is_extrapolated) {
   // If the clock is synchronized but has max_error beyond max_clock_sync_error_usec
   // we also return a non-ok status.
-  if (*error_usec > FLAGS_max_clock_sync_error_usec) {
+  if (error_usec > FLAGS_max_clock_sync_error_usec) {
     return Status::ServiceUnavailable(Substitute(
         "clock error estimate ($0us) too high (clock considered $1 by the kernel)",
-        *error_usec,
+        error_usec,
         is_extrapolated ? "unsynchronized" : "synchronized"));
   }
   return kudu::Status::OK();
@@ -419,8 +526,6 @@ uint64_t HybridClock::NowForMetrics() {
 uint64_t HybridClock::ErrorForMetrics() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return error;
 }
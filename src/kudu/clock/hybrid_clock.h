@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -169,6 +170,25 @@ class HybridClock : public Clock {
   // Same as above, but exits with a FATAL if there is an error.
   void WalltimeWithErrorOrDie(uint64_t* now_usec, uint64_t* error_usec);
 
+  // Returns a non-OK status if 'error_usec' exceeds --max_clock_sync_error_usec.
+  static Status CheckClockError(uint64_t error_usec, bool is_extrapolated);
+
+  // Reads the last valid clock reading without taking a lock. Returns false
+  // if there is none, or if it's being written concurrently.
+  bool GetLastClockRead(MonoTime* read_time, uint64_t* physical, uint64_t* error) const;
+
+  // Records the last valid clock reading.
+  //
+  // REQUIRES: 'last_clock_read_lock_' is held.
+  void SetLastClockRead(MonoTime read_time, uint64_t physical, uint64_t error);
+
+  // If the last valid clock reading was taken less than 'max_age_usec' before
+  // 'now', extrapolates the current time and error from it and returns true.
+  bool ExtrapolateFromLastClockRead(MonoTime now,
+                                    int64_t max_age_usec,
+                                    uint64_t* now_usec,
+                                    uint64_t* error_usec) const;
+
   // Used to get the timestamp for metrics.
   uint64_t NowForMetrics();
 
@@ -179,18 +199,27 @@ class HybridClock : public Clock {
   // service.
   std::unique_ptr<clock::TimeService> time_service_;
 
-  mutable simple_spinlock lock_;
-
   // The next timestamp to be generated from this clock, assuming that
   // the physical clock hasn't advanced beyond the value stored here.
-  uint64_t next_timestamp_;
+  // Timestamps are claimed by advancing it with compare-and-swap.
+  std::atomic<uint64_t> next_timestamp_;
 
   // The last valid clock reading we got from the time source, along
-  // with the monotime that we took that reading.
-  mutable simple_spinlock last_clock_read_lock_;
-  MonoTime last_clock_read_time_;
-  uint64_t last_clock_read_physical_;
-  uint64_t last_clock_read_error_;
+  // with the monotime that we took that reading (in nanoseconds since
+  // MonoTime::Min(), or 0 if there was none yet).
+  //
+  // Writers hold 'last_clock_read_lock_'. Readers don't take it: the fields
+  // are guarded by 'last_clock_read_seq_' as a sequence lock, which is odd
+  // while a write is in progress.
+  simple_spinlock last_clock_read_lock_;
+  std::atomic<uint64_t> last_clock_read_seq_;
+  std::atomic<int64_t> last_clock_read_time_nanos_;
+  std::atomic<uint64_t> last_clock_read_physical_;
+  std::atomic<uint64_t> last_clock_read_error_;
+
+  // Whether clock readings may be extrapolated from a recent reading; see
+  // --hybrid_clock_walltime_refresh_usec.
+  bool extrapolate_reads_;
 
   // How many bits to left shift a microseconds clock read. The remainder
   // of the timestamp will be reserved for logical values.
@@ -18,6 +18,8 @@
 #ifndef KUDU_CODEGEN_CODE_GENERATOR_H
 #define KUDU_CODEGEN_CODE_GENERATOR_H
 
+#include <vector>
+
 #include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
 
@@ -26,10 +28,12 @@ class scoped_refptr;
 
 namespace kudu {
 
+class ColumnPredicate;
 class Schema;
 
 namespace codegen {
 
+class PredicateEvaluatorFunctions;
 class RowProjectorFunctions;
 
 // CodeGenerator is a top-level class that manages a per-module
@@ -67,6 +71,13 @@ class CodeGenerator {
   Status CompileRowProjector(const Schema& base, const Schema& proj,
                              scoped_refptr<RowProjectorFunctions>* out);
 
+  // Attempts to initialize predicate evaluator functions by compiling code
+  // for the conjunction of the parameter predicates over rows of 'schema'.
+  // Writes to 'out' upon success.
+  Status CompilePredicateEvaluator(const Schema& schema,
+                                   const std::vector<ColumnPredicate>& predicates,
+                                   scoped_refptr<PredicateEvaluatorFunctions>* out);
+
  private:
   static void GlobalInit();
 
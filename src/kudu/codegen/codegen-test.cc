@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -30,7 +31,11 @@
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/object_cache.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
@@ -38,8 +43,12 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/singleton.h"
+#include "kudu/gutil/strings/util.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/logging_test_util.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/slice.h"
@@ -52,6 +61,8 @@ using std::vector;
 
 DECLARE_bool(codegen_dump_mc);
 DECLARE_int32(codegen_cache_capacity);
+DECLARE_int32(codegen_cache_dir_max_entries);
+DECLARE_string(codegen_cache_dir);
 
 namespace kudu {
 
@@ -59,6 +70,8 @@ typedef RowProjector NoCodegenRP;
 typedef codegen::RowProjector CodegenRP;
 
 using codegen::CompilationManager;
+using codegen::PredicateEvaluator;
+using codegen::PredicateEvaluatorFunctions;
 
 class CodegenTest : public KuduTest {
  public:
@@ -135,6 +148,9 @@ class CodegenTest : public KuduTest {
   Status CreatePartialSchema(const vector<size_t>& col_indexes,
                              Schema* out);
 
+  codegen::CodeGenerator generator_;
+  Random random_;
+
  private:
   // Projects the test rows into parameter rowblock using projector and
   // member projections_arena_ (should be Reset() manually).
@@ -149,8 +165,6 @@ class CodegenTest : public KuduTest {
   typedef const void* DefaultValueType;
   static const DefaultValueType kI32R, kI32W, kStrR, kStrW;
 
-  codegen::CodeGenerator generator_;
-  Random random_;
   gscoped_ptr<ConstContiguousRow> test_rows_[kNumTestRows];
   Arena projections_arena_;
   gscoped_ptr<Arena> test_rows_arena_;
@@ -424,4 +438,285 @@ TEST_F(CodegenTest, TestCodeCache) {
   }
 }
 
+// Test that the full schema and the recently recorded projections of a table
+// are compiled ahead of time, and that recorded projections which no longer
+// fit the schema are skipped.
+TEST_F(CodegenTest, TestPrecompileRowProjectors) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+
+  Schema projection({ base_.column(kI32Col), base_.column(kStrCol) }, 0);
+  Schema dropped({ ColumnSchema("dropped", INT32) }, 0);
+  cm->RecordProjection("table", projection);
+  cm->RecordProjection("table", dropped);
+  cm->PrecompileRowProjectors("table", base_);
+  cm->Wait();
+
+  gscoped_ptr<CodegenRP> projector;
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &base_, &projector));
+  Schema mapped;
+  ASSERT_OK(base_.GetMappedReadProjection(projection, &mapped));
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &mapped, &projector));
+
+  // The projections of other tables aren't compiled.
+  Schema other({ base_.column(kI32NullCol) }, 0);
+  ASSERT_OK(base_.GetMappedReadProjection(other, &mapped));
+  cm->RecordProjection("other-table", other);
+  cm->PrecompileRowProjectors("table", base_);
+  cm->Wait();
+  ASSERT_FALSE(cm->RequestRowProjector(&base_, &mapped, &projector));
+}
+
+namespace {
+
+const int kNumPredicateTestRows = 1000;
+
+Schema PredicateTestSchema() {
+  return Schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("int64-null", INT64, true),
+                  ColumnSchema("uint8", UINT8),
+                  ColumnSchema("double", DOUBLE),
+                  ColumnSchema("str-null", STRING, true) }, 1);
+}
+
+// Fills 'block', which must have the schema returned by PredicateTestSchema(),
+// with random rows. The string cells point into 'strs'.
+void FillPredicateTestBlock(Random* random, const vector<string>& strs, RowBlock* block) {
+  for (int i = 0; i < block->nrows(); i++) {
+    RowBlockRow row = block->row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+    row.cell(1).set_null(random->OneIn(5));
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(1)) =
+        static_cast<int64_t>(random->Uniform(100)) - 50;
+    *reinterpret_cast<uint8_t*>(row.mutable_cell_ptr(2)) = random->Uniform(256);
+    *reinterpret_cast<double*>(row.mutable_cell_ptr(3)) = random->OneIn(7) ?
+        std::numeric_limits<double>::quiet_NaN() : random->NextDoubleFraction();
+    row.cell(4).set_null(random->OneIn(3));
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(4)) = strs[random->Uniform(strs.size())];
+  }
+}
+
+// Checks that 'evaluator' unselects exactly the rows of 'block' that
+// evaluating each of its predicates in turn does. Some rows are unselected
+// beforehand, to check that those stay unselected.
+void CheckPredicateEvaluator(const RowBlock& block, PredicateEvaluator* evaluator) {
+  SelectionVector expected(block.nrows());
+  SelectionVector actual(block.nrows());
+  expected.SetAllTrue();
+  actual.SetAllTrue();
+  for (int i = 0; i < block.nrows(); i += 11) {
+    expected.SetRowUnselected(i);
+    actual.SetRowUnselected(i);
+  }
+
+  for (const ColumnPredicate& pred : evaluator->predicates()) {
+    int col_idx = block.schema().find_column(pred.column().name());
+    pred.Evaluate(block.column_block(col_idx), &expected);
+  }
+  evaluator->Evaluate(block, &actual);
+
+  for (int i = 0; i < block.nrows(); i++) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(expected.IsRowSelected(i), actual.IsRowSelected(i));
+  }
+}
+
+} // anonymous namespace
+
+// Test that compiled code is persisted and loaded by later compilation
+// managers, as if the process had been restarted.
+TEST_F(CodegenTest, TestPersistentObjectCache) {
+  FLAGS_codegen_cache_dir = GetTestPath("codegen-cache");
+  Schema ints;
+  vector<size_t> part_cols = { kI32Col, kI32NullValCol, kI32NullCol };
+  ASSERT_OK(CreatePartialSchema(part_cols, &ints));
+  faststring key;
+  ASSERT_OK(codegen::RowProjectorFunctions::EncodeKey(base_, ints, &key));
+  ASSERT_FALSE(codegen::PersistentObjectCache::IsLoadable(key));
+
+  // Code persisted by another build is deleted once code is written.
+  const string stale_dir = JoinPathSegments(FLAGS_codegen_cache_dir, "stale");
+  ASSERT_OK(env_->CreateDir(FLAGS_codegen_cache_dir));
+  ASSERT_OK(env_->CreateDir(stale_dir));
+  ASSERT_OK(WriteStringToFile(env_, "code", JoinPathSegments(stale_dir, "0.o")));
+
+  // Returns the persisted object files.
+  auto object_files = [&]() {
+    vector<string> files;
+    vector<string> dirs;
+    CHECK_OK(env_->GetChildren(FLAGS_codegen_cache_dir, &dirs));
+    for (const string& dir : dirs) {
+      vector<string> children;
+      if (dir == "." || dir == ".." ||
+          !env_->GetChildren(JoinPathSegments(FLAGS_codegen_cache_dir, dir), &children).ok()) {
+        continue;
+      }
+      for (const string& child : children) {
+        if (HasSuffixString(child, ".o")) {
+          files.push_back(JoinPathSegments(JoinPathSegments(FLAGS_codegen_cache_dir, dir),
+                                           child));
+        }
+      }
+    }
+    return files;
+  };
+
+  Singleton<CompilationManager>::UnsafeReset();
+  gscoped_ptr<CodegenRP> projector;
+  ASSERT_FALSE(CompilationManager::GetSingleton()->RequestRowProjector(
+      &base_, &ints, &projector));
+  CompilationManager::GetSingleton()->Wait();
+  ASSERT_TRUE(codegen::PersistentObjectCache::IsLoadable(key));
+  ASSERT_FALSE(env_->FileExists(stale_dir));
+  vector<string> files = object_files();
+  ASSERT_EQ(1, files.size());
+
+  // A new compilation manager serves the projector right away, and the
+  // loaded code behaves like freshly compiled code.
+  Singleton<CompilationManager>::UnsafeReset();
+  ASSERT_TRUE(CompilationManager::GetSingleton()->RequestRowProjector(
+      &base_, &ints, &projector));
+  codegen::PersistentObjectCache cache(key);
+  ASSERT_TRUE(cache.Load());
+  TestProjection<true>(&ints);
+  TestProjection<false>(&ints);
+
+  // Corrupt files are ignored: the code is compiled by the compilation pool
+  // rather than in the requesting thread, and the file is replaced.
+  ASSERT_OK(WriteStringToFile(env_, "garbage", files[0]));
+  ASSERT_FALSE(cache.Load());
+  ASSERT_FALSE(codegen::PersistentObjectCache::IsLoadable(key));
+  Singleton<CompilationManager>::UnsafeReset();
+  ASSERT_FALSE(CompilationManager::GetSingleton()->RequestRowProjector(
+      &base_, &ints, &projector));
+  CompilationManager::GetSingleton()->Wait();
+  ASSERT_TRUE(cache.Load());
+
+  // Projections with defaults embed addresses of this process and are
+  // never persisted.
+  Schema with_defaults;
+  part_cols = { kI32Col, kI32RCol, kStrRWCol };
+  ASSERT_OK(CreatePartialSchema(part_cols, &with_defaults));
+  key.clear();
+  ASSERT_OK(codegen::RowProjectorFunctions::EncodeKey(base_, with_defaults, &key));
+  TestProjection<true>(&with_defaults);
+  ASSERT_FALSE(codegen::PersistentObjectCache::IsLoadable(key));
+
+  // The number of persisted functions is bounded.
+  FLAGS_codegen_cache_dir_max_entries = 1;
+  Schema other_ints;
+  part_cols = { kI32Col, kI32NullCol };
+  ASSERT_OK(CreatePartialSchema(part_cols, &other_ints));
+  TestProjection<true>(&other_ints);
+  ASSERT_EQ(1, object_files().size());
+  Singleton<CompilationManager>::UnsafeReset();
+}
+
+TEST_F(CodegenTest, TestPredicateEvaluator) {
+  const Schema schema = PredicateTestSchema();
+  const vector<string> strs = { "", "a", "b", "bb", "c", "d" };
+  Arena arena(1024);
+  RowBlock block(schema, kNumPredicateTestRows, &arena);
+  FillPredicateTestBlock(&random_, strs, &block);
+
+  int32_t key_lower = 100;
+  int32_t key_upper = 900;
+  int64_t int64_lower = -20;
+  int64_t int64_value = 7;
+  uint8_t uint8_upper = 200;
+  uint8_t uint8_value = 100;
+  double double_lower = 0.25;
+  Slice str_lower("b");
+  Slice str_upper("d");
+  Slice str_value("bb");
+
+  const vector<vector<ColumnPredicate>> predicate_sets = {
+    {},
+    { ColumnPredicate::Range(schema.column(0), &key_lower, &key_upper),
+      ColumnPredicate::Range(schema.column(1), &int64_lower, nullptr),
+      ColumnPredicate::Range(schema.column(2), nullptr, &uint8_upper),
+      ColumnPredicate::Range(schema.column(3), &double_lower, nullptr),
+      ColumnPredicate::Range(schema.column(4), &str_lower, &str_upper) },
+    { ColumnPredicate::Equality(schema.column(4), &str_value),
+      ColumnPredicate::IsNull(schema.column(1)) },
+    { ColumnPredicate::IsNotNull(schema.column(4)),
+      ColumnPredicate::Equality(schema.column(2), &uint8_value),
+      ColumnPredicate::Range(schema.column(3), nullptr, &double_lower) },
+    { ColumnPredicate::Equality(schema.column(1), &int64_value),
+      ColumnPredicate::IsNotNull(schema.column(0)) },
+    { ColumnPredicate::None(schema.column(0)) },
+  };
+
+  for (const vector<ColumnPredicate>& predicates : predicate_sets) {
+    scoped_refptr<PredicateEvaluatorFunctions> functions;
+    ASSERT_OK(generator_.CompilePredicateEvaluator(schema, predicates, &functions));
+    PredicateEvaluator evaluator(&schema, predicates, functions);
+    ASSERT_OK(evaluator.Init());
+    NO_FATALS(CheckPredicateEvaluator(block, &evaluator));
+  }
+
+  // Predicates that can't be code generated are rejected.
+  vector<const void*> values = { &key_lower, &key_upper };
+  vector<ColumnPredicate> in_list = {
+    ColumnPredicate::InList(schema.column(0), &values)
+  };
+  scoped_refptr<PredicateEvaluatorFunctions> functions;
+  Status s = generator_.CompilePredicateEvaluator(schema, in_list, &functions);
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+}
+
+// Checks that compiled predicate evaluators are cached by the shape of
+// the predicates, independently of their values.
+TEST_F(CodegenTest, TestPredicateEvaluatorCache) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+
+  const Schema schema = PredicateTestSchema();
+  const vector<string> strs = { "a", "b", "c" };
+  Arena arena(1024);
+  RowBlock block(schema, kNumPredicateTestRows, &arena);
+  FillPredicateTestBlock(&random_, strs, &block);
+
+  int32_t key_lower = 10;
+  int32_t key_upper = 500;
+  Slice str_value("b");
+  vector<ColumnPredicate> predicates = {
+    ColumnPredicate::Range(schema.column(0), &key_lower, &key_upper),
+    ColumnPredicate::Equality(schema.column(4), &str_value),
+  };
+
+  gscoped_ptr<PredicateEvaluator> evaluator;
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&schema, predicates, &evaluator));
+  cm->Wait();
+  ASSERT_TRUE(cm->RequestPredicateEvaluator(&schema, predicates, &evaluator));
+  NO_FATALS(CheckPredicateEvaluator(block, evaluator.get()));
+
+  // Different values of the same shape hit the cache too.
+  int32_t other_key_lower = 300;
+  int32_t other_key_upper = 301;
+  Slice other_str_value("c");
+  vector<ColumnPredicate> other_predicates = {
+    ColumnPredicate::Range(schema.column(0), &other_key_lower, &other_key_upper),
+    ColumnPredicate::Equality(schema.column(4), &other_str_value),
+  };
+  ASSERT_TRUE(cm->RequestPredicateEvaluator(&schema, other_predicates, &evaluator));
+  NO_FATALS(CheckPredicateEvaluator(block, evaluator.get()));
+
+  // A different shape does not.
+  vector<ColumnPredicate> upper_only = {
+    ColumnPredicate::Range(schema.column(0), nullptr, &key_upper),
+  };
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&schema, upper_only, &evaluator));
+  cm->Wait();
+
+  // Predicates that cannot be code generated are never compiled.
+  vector<const void*> values = { &key_lower, &key_upper };
+  vector<ColumnPredicate> in_list = {
+    ColumnPredicate::InList(schema.column(0), &values)
+  };
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&schema, in_list, &evaluator));
+  cm->Wait();
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&schema, in_list, &evaluator));
+}
+
 } // namespace kudu
@@ -17,10 +17,14 @@
 
 #include "kudu/codegen/compilation_manager.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -28,24 +32,31 @@
 #include "kudu/codegen/code_cache.h"
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/object_cache.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/threadpool.h"
 
 using std::shared_ptr;
+using std::string;
+using std::vector;
 
 DEFINE_bool(codegen_time_compilation, false, "Whether to print time that each code "
             "generation request took.");
@@ -56,6 +67,14 @@ DEFINE_int32(codegen_cache_capacity, 100, "Number of entries which may be stored
              "code generation cache.");
 TAG_FLAG(codegen_cache_capacity, experimental);
 
+DEFINE_int32(codegen_recent_projections_per_table, 8,
+             "Number of the projections recently scanned from each table whose "
+             "row projectors are compiled ahead of time when a tablet of the "
+             "table is opened or its schema is altered. The projector to the "
+             "full schema is always compiled then. If 0, only that one is.");
+TAG_FLAG(codegen_recent_projections_per_table, experimental);
+TAG_FLAG(codegen_recent_projections_per_table, runtime);
+
 METRIC_DEFINE_gauge_int64(server, code_cache_hits, "Codegen Cache Hits",
                           kudu::MetricUnit::kCacheHits,
                           "Number of codegen cache hits since start",
@@ -70,18 +89,61 @@ namespace codegen {
 
 namespace {
 
+// Compiles a row projector and adds it to 'cache', unless it is there already.
+Status CompileRowProjector(const Schema& base, const Schema& proj,
+                           CodeCache* cache, Mutex* cache_lock,
+                           CodeGenerator* generator) {
+  faststring key;
+  RETURN_NOT_OK(RowProjectorFunctions::EncodeKey(base, proj, &key));
+
+  // Check again to make sure we didn't compile it already.
+  // This can occur if we request the same schema pair while the
+  // first one's compiling.
+  if (cache->Lookup(key)) return Status::OK();
+
+  scoped_refptr<RowProjectorFunctions> functions;
+  LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating row projector") {
+    RETURN_NOT_OK(generator->CompileRowProjector(base, proj, &functions));
+  }
+
+  MutexLock l(*cache_lock);
+  return cache->AddEntry(functions);
+}
+
+// Compiles a predicate evaluator and adds it to 'cache', unless it is there
+// already.
+Status CompilePredicateEvaluator(const Schema& schema,
+                                 const vector<ColumnPredicate>& predicates,
+                                 CodeCache* cache, Mutex* cache_lock,
+                                 CodeGenerator* generator) {
+  faststring key;
+  RETURN_NOT_OK(PredicateEvaluatorFunctions::EncodeKey(schema, predicates, &key));
+
+  // Check again to make sure we didn't compile it already.
+  if (cache->Lookup(key)) return Status::OK();
+
+  scoped_refptr<PredicateEvaluatorFunctions> functions;
+  LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating predicate evaluator") {
+    RETURN_NOT_OK(generator->CompilePredicateEvaluator(schema, predicates, &functions));
+  }
+
+  MutexLock l(*cache_lock);
+  return cache->AddEntry(functions);
+}
+
 // A CompilationTask is a ThreadPool's Runnable which, given a
 // pair of schemas and a cache to refer to, will generate code pertaining
 // to the two schemas and store it in the cache when run.
 class CompilationTask : public Runnable {
  public:
-  // Requires that the cache and generator are valid for the lifetime
-  // of this object.
+  // Requires that the cache, its lock and generator are valid for the
+  // lifetime of this object.
   CompilationTask(const Schema& base, const Schema& proj, CodeCache* cache,
-                  CodeGenerator* generator)
+                  Mutex* cache_lock, CodeGenerator* generator)
     : base_(base),
       proj_(proj),
       cache_(cache),
+      cache_lock_(cache_lock),
       generator_(generator) {}
 
   // Can only be run once.
@@ -89,37 +151,56 @@ class CompilationTask : public Runnable {
     // We need to fail softly because the user could have just given
     // a malformed projection schema pair, but could be long gone by
     // now so there's nowhere to return the status to.
-    WARN_NOT_OK(RunWithStatus(),
+    WARN_NOT_OK(CompileRowProjector(base_, proj_, cache_, cache_lock_, generator_),
                 "Failed compilation of row projector from base schema " +
                 base_.ToString() + " to projection schema " +
                 proj_.ToString());
   }
 
  private:
-  Status RunWithStatus() {
-    faststring key;
-    RETURN_NOT_OK(RowProjectorFunctions::EncodeKey(base_, proj_, &key));
+  Schema base_;
+  Schema proj_;
+  CodeCache* const cache_;
+  Mutex* const cache_lock_;
+  CodeGenerator* const generator_;
 
-    // Check again to make sure we didn't compile it already.
-    // This can occur if we request the same schema pair while the
-    // first one's compiling.
-    if (cache_->Lookup(key)) return Status::OK();
+  DISALLOW_COPY_AND_ASSIGN(CompilationTask);
+};
 
-    scoped_refptr<RowProjectorFunctions> functions;
-    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating row projector") {
-      RETURN_NOT_OK(generator_->CompileRowProjector(base_, proj_, &functions));
-    }
+// A PredicateCompilationTask is the CompilationTask counterpart for
+// predicate evaluators: it generates the evaluation code for a set of
+// predicates over a schema and stores it in the cache when run.
+class PredicateCompilationTask : public Runnable {
+ public:
+  // Requires that the cache, its lock and generator are valid for the
+  // lifetime of this object. Only the shape of the predicates is used, so
+  // the values they refer to need not outlive the request that created
+  // this task.
+  PredicateCompilationTask(const Schema& schema, vector<ColumnPredicate> predicates,
+                           CodeCache* cache, Mutex* cache_lock,
+                           CodeGenerator* generator)
+    : schema_(schema),
+      predicates_(std::move(predicates)),
+      cache_(cache),
+      cache_lock_(cache_lock),
+      generator_(generator) {}
 
-    RETURN_NOT_OK(cache_->AddEntry(functions));
-    return Status::OK();
+  // Can only be run once.
+  void Run() override {
+    WARN_NOT_OK(CompilePredicateEvaluator(schema_, predicates_, cache_, cache_lock_,
+                                          generator_),
+                "Failed compilation of predicate evaluator for schema " +
+                schema_.ToString());
   }
 
-  Schema base_;
-  Schema proj_;
+ private:
+  Schema schema_;
+  vector<ColumnPredicate> predicates_;
   CodeCache* const cache_;
+  Mutex* const cache_lock_;
   CodeGenerator* const generator_;
 
-  DISALLOW_COPY_AND_ASSIGN(CompilationTask);
+  DISALLOW_COPY_AND_ASSIGN(PredicateCompilationTask);
 };
 
 } // anonymous namespace
@@ -184,10 +265,21 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   scoped_refptr<RowProjectorFunctions> cached(
     down_cast<RowProjectorFunctions*>(cache_.Lookup(key).get()));
 
+  // Persisted code is cheap to load, so it is loaded right away rather than
+  // having the request wait for the compilation pool. Only code which was
+  // read and validated is loaded in this thread: anything else would
+  // compile here.
+  if (!cached && PersistentObjectCache::IsLoadable(key)) {
+    WARN_NOT_OK(CompileRowProjector(*base_schema, *projection, &cache_, &cache_lock_,
+                                    &generator_),
+                "Failed loading persisted row projector");
+    cached = down_cast<RowProjectorFunctions*>(cache_.Lookup(key).get());
+  }
+
   // If not cached, add a request to compilation pool
   if (!cached) {
     shared_ptr<Runnable> task(
-      new CompilationTask(*base_schema, *projection, &cache_, &generator_));
+      new CompilationTask(*base_schema, *projection, &cache_, &cache_lock_, &generator_));
     WARN_NOT_OK(pool_->Submit(task),
                 "RowProjector compilation request failed");
     return false;
@@ -199,5 +291,102 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   return true;
 }
 
+void CompilationManager::RecordProjection(const string& table_id, const Schema& projection) {
+  const size_t max_projections = std::max(FLAGS_codegen_recent_projections_per_table, 0);
+  if (max_projections == 0) {
+    return;
+  }
+  std::lock_guard<simple_spinlock> l(projections_lock_);
+  std::deque<Schema>& projections = recent_projections_[table_id];
+  for (auto it = projections.begin(); it != projections.end(); ++it) {
+    if (it->Equals(projection)) {
+      if (it != projections.begin()) {
+        Schema seen = std::move(*it);
+        projections.erase(it);
+        projections.emplace_front(std::move(seen));
+      }
+      return;
+    }
+  }
+  projections.emplace_front(projection);
+  while (projections.size() > max_projections) {
+    projections.pop_back();
+  }
+}
+
+void CompilationManager::PrecompileRowProjectors(const string& table_id,
+                                                 const Schema& base_schema) {
+  vector<Schema> recent;
+  {
+    std::lock_guard<simple_spinlock> l(projections_lock_);
+    const std::deque<Schema>* projections = FindOrNull(recent_projections_, table_id);
+    if (projections) {
+      recent.assign(projections->begin(), projections->end());
+    }
+  }
+
+  auto precompile = [&](const Schema& projection) {
+    faststring key;
+    if (!RowProjectorFunctions::EncodeKey(base_schema, projection, &key).ok() ||
+        cache_.Lookup(key)) {
+      return;
+    }
+    shared_ptr<Runnable> task(
+      new CompilationTask(base_schema, projection, &cache_, &cache_lock_, &generator_));
+    WARN_NOT_OK(pool_->Submit(task), "RowProjector precompilation request failed");
+  };
+  precompile(base_schema);
+  for (const Schema& projection : recent) {
+    // The columns of a recorded projection may have been dropped or altered
+    // since it was recorded.
+    Schema mapped;
+    if (base_schema.GetMappedReadProjection(projection, &mapped).ok()) {
+      precompile(mapped);
+    }
+  }
+}
+
+bool CompilationManager::RequestPredicateEvaluator(const Schema* schema,
+                                                   const vector<ColumnPredicate>& predicates,
+                                                   gscoped_ptr<PredicateEvaluator>* out) {
+  faststring key;
+  Status s = PredicateEvaluatorFunctions::EncodeKey(*schema, predicates, &key);
+  // Unsupported predicate types are expected, so they aren't worth a warning.
+  if (s.IsNotSupported()) return false;
+  WARN_NOT_OK(s, "PredicateEvaluator compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<PredicateEvaluatorFunctions> cached(
+    down_cast<PredicateEvaluatorFunctions*>(cache_.Lookup(key).get()));
+
+  if (!cached && PersistentObjectCache::IsLoadable(key)) {
+    WARN_NOT_OK(CompilePredicateEvaluator(*schema, predicates, &cache_, &cache_lock_,
+                                          &generator_),
+                "Failed loading persisted predicate evaluator");
+    cached = down_cast<PredicateEvaluatorFunctions*>(cache_.Lookup(key).get());
+  }
+
+  // If not cached, add a request to compilation pool
+  if (!cached) {
+    shared_ptr<Runnable> task(
+      new PredicateCompilationTask(*schema, predicates, &cache_, &cache_lock_,
+                                   &generator_));
+    WARN_NOT_OK(pool_->Submit(task),
+                "PredicateEvaluator compilation request failed");
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  gscoped_ptr<PredicateEvaluator> evaluator(
+      new PredicateEvaluator(schema, predicates, cached));
+  s = evaluator->Init();
+  WARN_NOT_OK(s, "PredicateEvaluator initialization failed");
+  if (!s.ok()) return false;
+  *out = std::move(evaluator);
+  return true;
+}
+
 } // namespace codegen
 } // namespace kudu
@@ -19,6 +19,10 @@
 #define KUDU_CODEGEN_COMPILATION_MANAGER_H
 
 #include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/code_cache.h"
@@ -27,16 +31,20 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+class ColumnPredicate;
 class MetricEntity;
 class Schema;
 class ThreadPool;
 
 namespace codegen {
 
+class PredicateEvaluator;
 class RowProjector;
 
 // The compilation manager is a top-level class which manages the actual
@@ -72,12 +80,43 @@ class CompilationManager {
   // then it is written to 'out' and true is returned.
   // Otherwise, this enqueues a compilation task for the parameter
   // schemas in the CompilationManager's thread pool and returns
-  // false. Upon any failure, false is returned.
+  // false. If the projector's code was persisted to --codegen_cache_dir
+  // by an earlier process, it is instead loaded synchronously and served
+  // right away. Upon any failure, false is returned.
   // Does not write to 'out' if false is returned.
   bool RequestRowProjector(const Schema* base_schema,
                            const Schema* projection,
                            gscoped_ptr<RowProjector>* out);
 
+  // If a codegenned evaluator for predicates of the same shape (see
+  // codegen::PredicateEvaluatorFunctions) is ready, then an evaluator
+  // for 'predicates' over rows of 'schema' is written to 'out' and true
+  // is returned. Otherwise, this enqueues a compilation task for the
+  // predicates' shape in the CompilationManager's thread pool and returns
+  // false, unless the code was persisted as for RequestRowProjector().
+  // Predicate sets which cannot be code generated (for instance,
+  // ones containing InList predicates) are never compiled, and upon any
+  // failure, false is returned.
+  // Does not write to 'out' if false is returned.
+  bool RequestPredicateEvaluator(const Schema* schema,
+                                 const std::vector<ColumnPredicate>& predicates,
+                                 gscoped_ptr<PredicateEvaluator>* out);
+
+  // Remembers that a scan of the table with ID 'table_id' asked for the user
+  // projection 'projection', so that PrecompileRowProjectors() compiles it
+  // ahead of the next scans. Up to --codegen_recent_projections_per_table
+  // projections are remembered per table, the least recently seen being
+  // forgotten first.
+  void RecordProjection(const std::string& table_id, const Schema& projection);
+
+  // Enqueues the compilation of the row projectors from 'base_schema', the
+  // schema of a tablet of the table with ID 'table_id' which was just opened
+  // or altered, to itself and to the projections recently recorded for the
+  // table which are still valid over it. Scans of the tablet then find
+  // compiled code rather than falling back to the interpreted path while
+  // their request is compiled.
+  void PrecompileRowProjectors(const std::string& table_id, const Schema& base_schema);
+
   // Waits for all asynchronous compilation tasks to finish.
   void Wait();
 
@@ -95,8 +134,15 @@ class CompilationManager {
 
   CodeGenerator generator_;
   CodeCache cache_;
+  // Serializes writes to cache_, which only supports a single writer.
+  Mutex cache_lock_;
   gscoped_ptr<ThreadPool> pool_;
 
+  // The user projections recently recorded for each table, the most recent
+  // first.
+  simple_spinlock projections_lock_;
+  std::unordered_map<std::string, std::deque<Schema>> recent_projections_;
+
   AtomicInt<int64_t> hit_counter_;
   AtomicInt<int64_t> query_counter_;
 
@@ -55,6 +55,7 @@
 #include <llvm/Transforms/IPO/AlwaysInliner.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 
+#include "kudu/codegen/object_cache.h"
 #include "kudu/codegen/precompiled.ll.h"
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/map-util.h"
@@ -317,7 +318,8 @@ vector<string> GetHostCPUAttrs() {
 
 } // anonymous namespace
 
-Status ModuleBuilder::Compile(unique_ptr<ExecutionEngine>* out) {
+Status ModuleBuilder::Compile(unique_ptr<ExecutionEngine>* out,
+                              const string& object_cache_key) {
   CHECK_EQ(state_, kBuilding);
 
   // Attempt to generate the engine
@@ -342,11 +344,23 @@ Status ModuleBuilder::Compile(unique_ptr<ExecutionEngine>* out) {
   }
   module->setDataLayout(target_->createDataLayout());
 
-  DoOptimizations(module, GetFunctionNames());
-  SetFunctionAttributes(module);
+  // If the object code was persisted by an earlier process, LLVM loads it
+  // rather than optimizing and compiling the module.
+  unique_ptr<PersistentObjectCache> object_cache;
+  bool loaded = false;
+  if (!object_cache_key.empty() && PersistentObjectCache::Enabled()) {
+    object_cache.reset(new PersistentObjectCache(object_cache_key));
+    loaded = object_cache->Load();
+    local_engine->setObjectCache(object_cache.get());
+  }
+  if (!loaded) {
+    DoOptimizations(module, GetFunctionNames());
+    SetFunctionAttributes(module);
+  }
 
   // Compile the module
   local_engine->finalizeObject();
+  local_engine->setObjectCache(nullptr);
 
   // Satisfy the promises
   for (JITFuture& fut : futures_) {
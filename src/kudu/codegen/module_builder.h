@@ -110,7 +110,13 @@ class ModuleBuilder {
   // After this method has been called, the jit-compiled code may be
   // called as long as 'out' remains alive. Once 'out' destructs,
   // the code will be freed.
-  Status Compile(std::unique_ptr<llvm::ExecutionEngine>* out);
+  //
+  // If 'object_cache_key' is non-empty, the object code is persisted
+  // under that key, or loaded if it was persisted before (see
+  // PersistentObjectCache). Callers must only pass a key if the module
+  // does not embed addresses of this process.
+  Status Compile(std::unique_ptr<llvm::ExecutionEngine>* out,
+                 const std::string& object_cache_key = "");
 
   // Retrieves the TargetMachine that the engine builder guessed was
   // the native target. Requires compilation is complete.
@@ -0,0 +1,269 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/codegen/object_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Host.h>
+
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/env.h"
+#include "kudu/util/env_util.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/hash_util.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/status.h"
+#include "kudu/util/version_info.h"
+
+DEFINE_string(codegen_cache_dir, "",
+              "Directory in which to persist the object code of generated "
+              "functions, so that it can be loaded instead of recompiled after "
+              "a restart. If empty, compiled code is not persisted.");
+TAG_FLAG(codegen_cache_dir, experimental);
+
+DEFINE_int32(codegen_cache_dir_max_entries, 1000,
+             "Maximum number of compiled functions persisted in "
+             "--codegen_cache_dir. When exceeded, the least recently written "
+             "ones are deleted.");
+TAG_FLAG(codegen_cache_dir_max_entries, experimental);
+TAG_FLAG(codegen_cache_dir_max_entries, runtime);
+
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Returns a description of everything besides the JIT key which the
+// validity of object code depends on.
+const string& CompilationEnvironment() {
+  static const string* env = [] {
+    string* ret = new string(Substitute("$0\nllvm $1\ncpu $2\n",
+                                        VersionInfo::GetAllVersionInfo(),
+                                        LLVM_VERSION_STRING,
+                                        llvm::sys::getHostCPUName().str()));
+    llvm::StringMap<bool> cpu_features;
+    llvm::sys::getHostCPUFeatures(cpu_features);
+    for (const auto& entry : cpu_features) {
+      ret->append(entry.second ? "+" : "-");
+      ret->append(entry.first().data(), entry.first().size());
+    }
+    return ret;
+  }();
+  return *env;
+}
+
+string FullKey(const Slice& jit_key) {
+  string key = CompilationEnvironment();
+  key.push_back('\0');
+  key.append(jit_key.ToString());
+  return key;
+}
+
+string HashToString(const string& s) {
+  char buf[kFastToBufferSize];
+  return FastHex64ToBuffer(HashUtil::MurmurHash2_64(s.data(), s.size(), 0), buf);
+}
+
+// Returns the subdirectory of --codegen_cache_dir holding the code compiled
+// in the environment of this process. Code of other builds or hosts lives in
+// other subdirectories, and is deleted by CleanUpCacheDir().
+string EnvironmentDir() {
+  return JoinPathSegments(FLAGS_codegen_cache_dir, HashToString(CompilationEnvironment()));
+}
+
+string PathForKey(const string& key) {
+  return JoinPathSegments(EnvironmentDir(), HashToString(key) + ".o");
+}
+
+// Deletes the code persisted by other builds or on other hosts, which this
+// process can never load, and the least recently written code past
+// --codegen_cache_dir_max_entries. Failures are only logged: another process
+// sharing the directory may be cleaning it up at the same time.
+void CleanUpCacheDir() {
+  Env* env = Env::Default();
+  const string env_dir = EnvironmentDir();
+  vector<string> children;
+  Status s = env->GetChildren(FLAGS_codegen_cache_dir, &children);
+  if (!s.ok()) {
+    LOG(WARNING) << "Could not list " << FLAGS_codegen_cache_dir << ": " << s.ToString();
+    return;
+  }
+  for (const string& child : children) {
+    string path = JoinPathSegments(FLAGS_codegen_cache_dir, child);
+    bool is_dir;
+    if (child == "." || child == ".." || path == env_dir ||
+        !env->IsDirectory(path, &is_dir).ok() || !is_dir) {
+      continue;
+    }
+    VLOG(1) << "Deleting code persisted by another build or host in " << path;
+    WARN_NOT_OK(env->DeleteRecursively(path),
+                Substitute("Could not delete stale persisted code in $0", path));
+  }
+
+  children.clear();
+  s = env->GetChildren(env_dir, &children);
+  if (!s.ok()) {
+    LOG(WARNING) << "Could not list " << env_dir << ": " << s.ToString();
+    return;
+  }
+  vector<pair<int64_t, string>> files;
+  for (const string& child : children) {
+    if (!HasSuffixString(child, ".o")) {
+      continue;
+    }
+    string path = JoinPathSegments(env_dir, child);
+    int64_t mtime;
+    if (env->GetFileModifiedTime(path, &mtime).ok()) {
+      files.emplace_back(mtime, std::move(path));
+    }
+  }
+  const size_t max_entries = std::max(FLAGS_codegen_cache_dir_max_entries, 1);
+  if (files.size() <= max_entries) {
+    return;
+  }
+  std::sort(files.begin(), files.end());
+  for (size_t i = 0; i < files.size() - max_entries; i++) {
+    VLOG(1) << "Deleting persisted code in " << files[i].second;
+    WARN_NOT_OK(env->DeleteFile(files[i].second),
+                Substitute("Could not delete persisted code in $0", files[i].second));
+  }
+}
+
+// Writes 'contents' to 'path', replacing any existing file atomically.
+Status WriteFileAtomically(const string& path, const Slice& contents) {
+  Env* env = Env::Default();
+  RETURN_NOT_OK(env_util::CreateDirsRecursively(env, DirName(path)));
+  string tmp_path;
+  unique_ptr<WritableFile> file;
+  RETURN_NOT_OK(env->NewTempWritableFile(WritableFileOptions(),
+                                         Substitute("$0$1.XXXXXX", path, kTmpInfix),
+                                         &tmp_path, &file));
+  Status s = file->Append(contents);
+  if (s.ok()) s = file->Close();
+  if (s.ok()) s = env->RenameFile(tmp_path, path);
+  if (!s.ok()) {
+    WARN_NOT_OK(env->DeleteFile(tmp_path), "could not delete temporary file");
+  }
+  return s;
+}
+
+} // anonymous namespace
+
+bool PersistentObjectCache::Enabled() {
+  return !FLAGS_codegen_cache_dir.empty();
+}
+
+bool PersistentObjectCache::IsLoadable(const Slice& jit_key) {
+  if (!Enabled()) {
+    return false;
+  }
+  PersistentObjectCache cache(jit_key);
+  return cache.Load();
+}
+
+PersistentObjectCache::PersistentObjectCache(const Slice& jit_key)
+  : key_(FullKey(jit_key)),
+    path_(PathForKey(key_)) {}
+
+PersistentObjectCache::~PersistentObjectCache() {}
+
+// The file format is, in sequence:
+//
+// (4 bytes) length of the full key
+// (variable) the full key
+// (remainder) the object code
+bool PersistentObjectCache::Load() {
+  contents_.clear();
+  object_.clear();
+  if (!Env::Default()->FileExists(path_)) {
+    return false;
+  }
+  Status s = ReadFileToString(Env::Default(), path_, &contents_);
+  if (!s.ok()) {
+    LOG(WARNING) << "Could not read persisted code from " << path_ << ": " << s.ToString();
+    return false;
+  }
+  if (contents_.size() < sizeof(uint32_t)) {
+    LOG(WARNING) << "Ignoring truncated persisted code in " << path_;
+    return false;
+  }
+  uint32_t key_len = DecodeFixed32(contents_.data());
+  Slice stored(contents_.data() + sizeof(uint32_t), contents_.size() - sizeof(uint32_t));
+  if (stored.size() < key_len || Slice(stored.data(), key_len) != Slice(key_)) {
+    VLOG(1) << "Persisted code in " << path_ << " is for a different key";
+    return false;
+  }
+  stored.remove_prefix(key_len);
+  if (stored.empty()) {
+    LOG(WARNING) << "Ignoring persisted code without object code in " << path_;
+    return false;
+  }
+  object_ = stored;
+  VLOG(1) << "Loaded " << object_.size() << " bytes of persisted code from " << path_;
+  return true;
+}
+
+void PersistentObjectCache::notifyObjectCompiled(const llvm::Module* module,
+                                                 llvm::MemoryBufferRef obj) {
+  if (!object_.empty()) {
+    // We handed this object to LLVM ourselves.
+    return;
+  }
+  faststring contents;
+  PutFixed32(&contents, key_.size());
+  contents.append(key_);
+  contents.append(obj.getBufferStart(), obj.getBufferSize());
+  Status s = WriteFileAtomically(path_, Slice(contents));
+  WARN_NOT_OK(s, Substitute("Could not persist compiled code to $0", path_));
+  if (s.ok()) {
+    // Code is only compiled on misses of the in-memory code cache, so this
+    // is rare enough to be done on every write.
+    CleanUpCacheDir();
+  }
+}
+
+unique_ptr<llvm::MemoryBuffer> PersistentObjectCache::getObject(const llvm::Module* module) {
+  if (object_.empty()) {
+    return nullptr;
+  }
+  // LLVM takes ownership of the returned buffer, but not of the data, which
+  // must stay valid while the object is loaded: it is copied.
+  return llvm::MemoryBuffer::getMemBufferCopy(
+      llvm::StringRef(reinterpret_cast<const char*>(object_.data()), object_.size()));
+}
+
+} // namespace codegen
+} // namespace kudu
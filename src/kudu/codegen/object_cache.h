@@ -0,0 +1,95 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CODEGEN_OBJECT_CACHE_H
+#define KUDU_CODEGEN_OBJECT_CACHE_H
+
+#include <memory>
+#include <string>
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+
+namespace llvm {
+class Module;
+} // namespace llvm
+
+namespace kudu {
+namespace codegen {
+
+// An llvm::ObjectCache which persists the object code compiled for a module
+// in the directory given by --codegen_cache_dir, so that later processes can
+// load it instead of running the LLVM optimizer and code generator again.
+//
+// Entries are identified by the code cache key of the compiled code (see
+// JITWrapper::EncodeOwnKey()) combined with the Kudu build, the LLVM version
+// and the host CPU, since object code is only valid for the exact binary
+// and target it was generated for. Code which embeds addresses of the
+// process that compiled it must not be persisted.
+//
+// Each entry is stored in a file named after a hash of the full key, in a
+// subdirectory named after a hash of the build, LLVM version and CPU. The
+// full key is also stored in the file and compared on load, so that a hash
+// collision can never load the wrong code. Files are written atomically;
+// unreadable or mismatched files are ignored and overwritten. Every write
+// deletes the subdirectories of other builds or hosts, and the least
+// recently written files past --codegen_cache_dir_max_entries.
+//
+// An instance serves the compilation of a single module.
+class PersistentObjectCache : public llvm::ObjectCache {
+ public:
+  // Returns whether compiled code should be persisted at all.
+  static bool Enabled();
+
+  // Returns whether valid code for 'jit_key' was persisted by this or an
+  // earlier process, i.e. whether Load() would succeed. This reads the file.
+  static bool IsLoadable(const Slice& jit_key);
+
+  explicit PersistentObjectCache(const Slice& jit_key);
+  ~PersistentObjectCache();
+
+  // Reads the persisted code, if there is any. Returns true if valid code
+  // was found, in which case getObject() will hand it to LLVM rather than
+  // having the module compiled.
+  bool Load();
+
+  void notifyObjectCompiled(const llvm::Module* module,
+                            llvm::MemoryBufferRef obj) OVERRIDE;
+
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) OVERRIDE;
+
+ private:
+  // The key identifying the code, see above.
+  const std::string key_;
+  // The path of the file holding the code.
+  const std::string path_;
+
+  // The contents of the file read by Load(), and the object code within.
+  faststring contents_;
+  Slice object_;
+
+  DISALLOW_COPY_AND_ASSIGN(PersistentObjectCache);
+};
+
+} // namespace codegen
+} // namespace kudu
+
+#endif
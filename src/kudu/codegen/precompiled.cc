@@ -40,6 +40,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
 
 // Even though this file is only needed for IR purposes, we need to check for
 // IR_BUILD because we use a fake static library target to workaround a cmake
@@ -65,8 +66,6 @@ extern "C" void *__dso_handle __attribute__((__visibility__("hidden"))) = NULL;
 
 namespace kudu {
 
-class Slice;
-
 // Returns whether copy was successful (fails iff slice relocation fails,
 // which can only occur if is_string is true).
 // If arena is NULL, then no relocation occurs.
@@ -163,5 +162,29 @@ IR_ALWAYS_INLINE void _PrecompiledCopyCellToRowBlockSetNull(
   dst->cell(col).set_null(is_null);
 }
 
+// declare i1 @_PrecompiledBitmapTest(i8* bitmap, i64 idx)
+//
+//   Returns whether bit 'idx' of 'bitmap' is set. Used by predicate
+//   evaluation to check both selection vectors and column null bitmaps
+//   (where a set bit indicates a non-null cell).
+IR_ALWAYS_INLINE bool _PrecompiledBitmapTest(const uint8_t* bitmap, uint64_t idx) {
+  return BitmapTest(bitmap, idx);
+}
+
+// declare void @_PrecompiledBitmapClear(i8* bitmap, i64 idx)
+//
+//   Clears bit 'idx' of 'bitmap'.
+IR_ALWAYS_INLINE void _PrecompiledBitmapClear(uint8_t* bitmap, uint64_t idx) {
+  BitmapClear(bitmap, idx);
+}
+
+// declare i32 @_PrecompiledCompareSlices(i8* lhs, i8* rhs)
+//
+//   Compares the Slices pointed to by 'lhs' and 'rhs', returning a value
+//   less than, equal to, or greater than zero in the manner of memcmp().
+IR_ALWAYS_INLINE int _PrecompiledCompareSlices(const uint8_t* lhs, const uint8_t* rhs) {
+  return reinterpret_cast<const Slice*>(lhs)->compare(*reinterpret_cast<const Slice*>(rhs));
+}
+
 } // extern "C"
 } // namespace kudu
@@ -0,0 +1,552 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/codegen/predicate_evaluator.h"
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class LLVMContext;
+} // namespace llvm
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::LLVMContext;
+using llvm::PHINode;
+using llvm::PointerType;
+using llvm::Type;
+using llvm::Value;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// The properties of a predicate which the generated code depends on. The
+// predicate's bound values are not among them: they are passed to the
+// generated function as parameters.
+struct PredicateShape {
+  DataType physical_type;
+  bool nullable;
+  PredicateType predicate_type;
+  bool has_lower;
+  bool has_upper;
+};
+
+// Computes the shape of each of 'predicates', using the column types and
+// nullability of 'schema'.
+Status GetPredicateShapes(const Schema& schema,
+                          const vector<ColumnPredicate>& predicates,
+                          vector<PredicateShape>* shapes) {
+  shapes->clear();
+  shapes->reserve(predicates.size());
+  for (const ColumnPredicate& pred : predicates) {
+    int col_idx = schema.find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("Unknown column in predicate", pred.ToString());
+    }
+    const ColumnSchema& col = schema.column(col_idx);
+    if (!col.EqualsPhysicalType(pred.column())) {
+      return Status::InvalidArgument("Predicate column type does not match schema",
+                                     pred.ToString());
+    }
+    switch (pred.predicate_type()) {
+      case PredicateType::Equality:
+      case PredicateType::Range:
+      case PredicateType::IsNotNull:
+      case PredicateType::IsNull:
+      case PredicateType::None:
+        break;
+      default:
+        return Status::NotSupported("Predicate cannot be code generated", pred.ToString());
+    }
+    shapes->push_back({ col.type_info()->physical_type(),
+                        col.is_nullable(),
+                        pred.predicate_type(),
+                        pred.raw_lower() != nullptr,
+                        pred.raw_upper() != nullptr });
+  }
+  return Status::OK();
+}
+
+// Returns the LLVM type of a cell of the given physical type, or NULL for
+// BINARY cells, which are compared through a precompiled function.
+Type* GetCellType(LLVMContext& context, DataType physical_type) {
+  switch (physical_type) {
+    case BOOL:
+    case INT8:
+    case UINT8: return Type::getInt8Ty(context);
+    case INT16:
+    case UINT16: return Type::getInt16Ty(context);
+    case INT32:
+    case UINT32: return Type::getInt32Ty(context);
+    case INT64:
+    case UINT64: return Type::getInt64Ty(context);
+    case INT128: return Type::getIntNTy(context, 128);
+    case FLOAT: return Type::getFloatTy(context);
+    case DOUBLE: return Type::getDoubleTy(context);
+    case BINARY: return nullptr;
+    default: LOG(FATAL) << "unexpected physical type: " << DataType_Name(physical_type);
+  }
+  return nullptr;
+}
+
+bool IsSigned(DataType physical_type) {
+  switch (physical_type) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+    case INT128: return true;
+    default: return false;
+  }
+}
+
+// The cell-to-bound comparisons which the predicates are made of.
+enum class Comparison {
+  kGE, // cell >= bound
+  kLT, // cell < bound
+  kEQ  // cell == bound
+};
+
+// Emits the comparison 'op' of the cell pointed to by 'cell_ptr' against
+// 'bound', returning the resulting i1. 'bound' is the loaded bound value,
+// or for BINARY cells, a pointer to the bound Slice.
+//
+// The comparisons match DataTypeTraits<>::Compare(): in particular, since a
+// NaN float compares as equal to any value, the floating point comparisons
+// for kGE and kEQ are unordered.
+Value* MakeComparison(ModuleBuilder* mbuilder, const PredicateShape& shape,
+                      Value* cell_ptr, Value* bound, Comparison op,
+                      Function* compare_slices) {
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  if (shape.physical_type == BINARY) {
+    Value* cmp = builder->CreateCall(compare_slices, { cell_ptr, bound });
+    Value* zero = builder->getInt32(0);
+    switch (op) {
+      case Comparison::kGE: return builder->CreateICmpSGE(cmp, zero);
+      case Comparison::kLT: return builder->CreateICmpSLT(cmp, zero);
+      case Comparison::kEQ: return builder->CreateICmpEQ(cmp, zero);
+    }
+  }
+
+  Type* cell_type = GetCellType(builder->getContext(), shape.physical_type);
+  Value* cell = builder->CreateLoad(
+      builder->CreateBitCast(cell_ptr, PointerType::getUnqual(cell_type)));
+  if (cell_type->isFloatingPointTy()) {
+    switch (op) {
+      case Comparison::kGE: return builder->CreateFCmpUGE(cell, bound);
+      case Comparison::kLT: return builder->CreateFCmpOLT(cell, bound);
+      case Comparison::kEQ: return builder->CreateFCmpUEQ(cell, bound);
+    }
+  }
+  bool is_signed = IsSigned(shape.physical_type);
+  switch (op) {
+    case Comparison::kGE:
+      return is_signed ? builder->CreateICmpSGE(cell, bound) : builder->CreateICmpUGE(cell, bound);
+    case Comparison::kLT:
+      return is_signed ? builder->CreateICmpSLT(cell, bound) : builder->CreateICmpULT(cell, bound);
+    case Comparison::kEQ:
+      return builder->CreateICmpEQ(cell, bound);
+  }
+  LOG(FATAL) << "unknown comparison";
+  return nullptr;
+}
+
+// Generates a predicate evaluation function of the form:
+// void(i8** col_data, i8** null_bitmaps, i8** bounds, i64 nrows, i8* sel)
+// See PredicateEvaluatorFunctions::EvaluationFunction for the semantics.
+llvm::Function* MakeEvaluation(const string& name,
+                               ModuleBuilder* mbuilder,
+                               const vector<PredicateShape>& shapes) {
+  // Get the IRBuilder
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  // Create the function after providing a declaration
+  Type* byte_ptr = Type::getInt8PtrTy(context);
+  Type* byte_ptr_ptr = PointerType::getUnqual(byte_ptr);
+  vector<Type*> argtypes = { byte_ptr_ptr, byte_ptr_ptr, byte_ptr_ptr,
+                             Type::getInt64Ty(context), byte_ptr };
+  FunctionType* fty =
+    FunctionType::get(Type::getVoidTy(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  // Get the function's Arguments
+  Function::arg_iterator it = f->arg_begin();
+  Argument* col_data = &*it++;
+  Argument* null_bitmaps = &*it++;
+  Argument* bounds = &*it++;
+  Argument* nrows = &*it++;
+  Argument* sel = &*it++;
+  DCHECK(it == f->arg_end());
+
+  // Give names to the arguments for debugging IR.
+  col_data->setName("col_data");
+  null_bitmaps->setName("null_bitmaps");
+  bounds->setName("bounds");
+  nrows->setName("nrows");
+  sel->setName("sel");
+
+  // Evaluation function in IR (note: values in angle brackets are
+  // constants whose values are determined right now, at JIT time).
+  //
+  // define void @name(i8** %col_data, i8** %null_bitmaps, i8** %bounds,
+  //                   i64 %nrows, i8* %sel)
+  // entry:
+  //   <for each predicate j>
+  //     %data_j = load col_data[j]
+  //     %nulls_j = load null_bitmaps[j]            (nullable columns only)
+  //     %lower_j = load (<cell type>*) bounds[2j]  (if a lower bound is present)
+  //     %upper_j = load (<cell type>*) bounds[2j+1] (if an upper bound is present)
+  //   <end implicit for each>
+  //   br %loop
+  // loop:
+  //   %idx = phi [0, %entry], [%idx_next, %next]
+  //   br (%idx < %nrows), %body, %exit
+  // body:
+  //   br (@_PrecompiledBitmapTest(%sel, %idx)), %pred0, %next
+  // <for each predicate j>
+  //   predj:
+  //     <if nullable and not an IsNull/IsNotNull predicate>
+  //       br (@_PrecompiledBitmapTest(%nulls_j, %idx)), %cmpj, %reject
+  //     cmpj:
+  //     <end implicit if>
+  //     %cell = getelementptr i8* %data_j, i64 (%idx * <type size>)
+  //     %match = <comparisons of %cell against %lower_j and %upper_j>
+  //     br %match, %pred(j+1) (or %next if last), %reject
+  // <end implicit for each>
+  // reject:
+  //   call void @_PrecompiledBitmapClear(%sel, %idx)
+  //   br %next
+  // next:
+  //   %idx_next = add %idx, 1
+  //   br %loop
+  // exit:
+  //   ret void
+  //
+  // BINARY cells are not loaded; instead, the comparisons call
+  // @_PrecompiledCompareSlices on the cell and the bound Slice pointers.
+  // The predicates are evaluated in the given order and the evaluation of a
+  // row stops at the first predicate it fails.
+
+  // Retrieve appropriate precompiled functions
+  Function* bitmap_test = mbuilder->GetFunction("_PrecompiledBitmapTest");
+  Function* bitmap_clear = mbuilder->GetFunction("_PrecompiledBitmapClear");
+  Function* compare_slices = mbuilder->GetFunction("_PrecompiledCompareSlices");
+
+  BasicBlock* entry = BasicBlock::Create(context, "entry", f);
+  BasicBlock* loop = BasicBlock::Create(context, "loop", f);
+  BasicBlock* body = BasicBlock::Create(context, "body", f);
+  vector<BasicBlock*> pred_blocks;
+  for (int j = 0; j < shapes.size(); j++) {
+    pred_blocks.push_back(BasicBlock::Create(context, StrCat("pred", j), f));
+  }
+  BasicBlock* reject = BasicBlock::Create(context, "reject", f);
+  BasicBlock* next = BasicBlock::Create(context, "next", f);
+  BasicBlock* exit = BasicBlock::Create(context, "exit", f);
+
+  // Load the column pointers and the bound values once, up front.
+  builder->SetInsertPoint(entry);
+  vector<Value*> data(shapes.size(), nullptr);
+  vector<Value*> nulls(shapes.size(), nullptr);
+  vector<Value*> lowers(shapes.size(), nullptr);
+  vector<Value*> uppers(shapes.size(), nullptr);
+  auto load_bound = [&](const PredicateShape& shape, int bound_idx) -> Value* {
+    Value* bound = builder->CreateLoad(builder->CreateConstGEP1_64(bounds, bound_idx));
+    if (shape.physical_type == BINARY) {
+      return bound;
+    }
+    Type* cell_type = GetCellType(context, shape.physical_type);
+    // The bounds carry no alignment guarantee.
+    return builder->CreateAlignedLoad(
+        builder->CreateBitCast(bound, PointerType::getUnqual(cell_type)), 1);
+  };
+  for (int j = 0; j < shapes.size(); j++) {
+    const PredicateShape& shape = shapes[j];
+    data[j] = builder->CreateLoad(builder->CreateConstGEP1_64(col_data, j));
+    data[j]->setName(StrCat("data", j));
+    if (shape.nullable) {
+      nulls[j] = builder->CreateLoad(builder->CreateConstGEP1_64(null_bitmaps, j));
+      nulls[j]->setName(StrCat("nulls", j));
+    }
+    if (shape.has_lower) {
+      lowers[j] = load_bound(shape, 2 * j);
+      lowers[j]->setName(StrCat("lower", j));
+    }
+    if (shape.has_upper) {
+      uppers[j] = load_bound(shape, 2 * j + 1);
+      uppers[j]->setName(StrCat("upper", j));
+    }
+  }
+  builder->CreateBr(loop);
+
+  // Loop over the rows.
+  builder->SetInsertPoint(loop);
+  PHINode* idx = builder->CreatePHI(Type::getInt64Ty(context), 2, "idx");
+  idx->addIncoming(builder->getInt64(0), entry);
+  builder->CreateCondBr(builder->CreateICmpULT(idx, nrows), body, exit);
+
+  // Skip rows which are already unselected.
+  builder->SetInsertPoint(body);
+  Value* selected = builder->CreateCall(bitmap_test, { sel, idx });
+  builder->CreateCondBr(selected, pred_blocks.empty() ? next : pred_blocks[0], next);
+
+  for (int j = 0; j < shapes.size(); j++) {
+    const PredicateShape& shape = shapes[j];
+    BasicBlock* pass = j + 1 < shapes.size() ? pred_blocks[j + 1] : next;
+    builder->SetInsertPoint(pred_blocks[j]);
+
+    switch (shape.predicate_type) {
+      case PredicateType::None:
+        builder->CreateBr(reject);
+        continue;
+      case PredicateType::IsNotNull:
+      case PredicateType::IsNull: {
+        bool want_null = shape.predicate_type == PredicateType::IsNull;
+        if (!shape.nullable) {
+          builder->CreateBr(want_null ? reject : pass);
+          continue;
+        }
+        Value* not_null = builder->CreateCall(bitmap_test, { nulls[j], idx });
+        builder->CreateCondBr(not_null, want_null ? reject : pass, want_null ? pass : reject);
+        continue;
+      }
+      default:
+        break;
+    }
+
+    // Null cells never match a comparison predicate.
+    if (shape.nullable) {
+      BasicBlock* cmp = BasicBlock::Create(context, StrCat("cmp", j), f, reject);
+      Value* not_null = builder->CreateCall(bitmap_test, { nulls[j], idx });
+      builder->CreateCondBr(not_null, cmp, reject);
+      builder->SetInsertPoint(cmp);
+    }
+
+    size_t cell_size = GetTypeInfo(shape.physical_type)->size();
+    Value* cell_ptr = builder->CreateGEP(
+        data[j], builder->CreateMul(idx, builder->getInt64(cell_size)));
+    cell_ptr->setName(StrCat("cell", j));
+
+    Value* match;
+    if (shape.predicate_type == PredicateType::Equality) {
+      match = MakeComparison(mbuilder, shape, cell_ptr, lowers[j], Comparison::kEQ,
+                             compare_slices);
+    } else {
+      DCHECK_EQ(PredicateType::Range, shape.predicate_type);
+      match = builder->getInt1(true);
+      if (shape.has_lower) {
+        match = builder->CreateAnd(match, MakeComparison(mbuilder, shape, cell_ptr, lowers[j],
+                                                         Comparison::kGE, compare_slices));
+      }
+      if (shape.has_upper) {
+        match = builder->CreateAnd(match, MakeComparison(mbuilder, shape, cell_ptr, uppers[j],
+                                                         Comparison::kLT, compare_slices));
+      }
+    }
+    match->setName(StrCat("match", j));
+    builder->CreateCondBr(match, pass, reject);
+  }
+
+  // Unselect the rows which failed a predicate.
+  builder->SetInsertPoint(reject);
+  builder->CreateCall(bitmap_clear, { sel, idx });
+  builder->CreateBr(next);
+
+  builder->SetInsertPoint(next);
+  Value* idx_next = builder->CreateAdd(idx, builder->getInt64(1), "idx_next");
+  idx->addIncoming(idx_next, next);
+  builder->CreateBr(loop);
+
+  // Return
+  builder->SetInsertPoint(exit);
+  builder->CreateRetVoid();
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping predicate evaluation:";
+    f->print(llvm::errs(), nullptr);
+  }
+
+  return f;
+}
+
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+
+} // anonymous namespace
+
+PredicateEvaluatorFunctions::PredicateEvaluatorFunctions(string key,
+                                                         EvaluationFunction evaluate_f,
+                                                         unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    key_(std::move(key)),
+    evaluate_f_(evaluate_f) {
+  CHECK(evaluate_f != nullptr)
+    << "Promise to compile evaluation function not fulfilled by ModuleBuilder";
+}
+
+Status PredicateEvaluatorFunctions::Create(const Schema& schema,
+                                           const vector<ColumnPredicate>& predicates,
+                                           scoped_refptr<PredicateEvaluatorFunctions>* out,
+                                           llvm::TargetMachine** tm) {
+  vector<PredicateShape> shapes;
+  RETURN_NOT_OK(GetPredicateShapes(schema, predicates, &shapes));
+  faststring key;
+  RETURN_NOT_OK(EncodeKey(schema, predicates, &key));
+
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* evaluate = MakeEvaluation("PredEval", &builder, shapes);
+
+  // Have the ModuleBuilder accept promises to compile the function
+  EvaluationFunction evaluate_f;
+  builder.AddJITPromise(evaluate, &evaluate_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner, key.ToString()));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new PredicateEvaluatorFunctions(key.ToString(), evaluate_f, std::move(owner)));
+  return Status::OK();
+}
+
+// Generates a key for a set of predicates over a schema. The key is unique
+// according to the criteria defined in the CodeCache class' block comment.
+// The predicates' bound values are deliberately left out: they are
+// parameters of the generated code. The key is encoded as follows, in
+// sequence.
+//
+// (4 bytes) unique type identifier for PredicateEvaluatorFunctions
+// (8 bytes) number, as unsigned long, of predicates
+// (11 bytes each) predicate shapes, in order
+//   4 bytes for the column's physical type
+//   1 byte for the column's nullability
+//   4 bytes for the predicate type
+//   1 byte for the presence of the lower bound
+//   1 byte for the presence of the upper bound
+//
+// Writes to 'out' upon success.
+Status PredicateEvaluatorFunctions::EncodeKey(const Schema& schema,
+                                              const vector<ColumnPredicate>& predicates,
+                                              faststring* out) {
+  vector<PredicateShape> shapes;
+  RETURN_NOT_OK(GetPredicateShapes(schema, predicates, &shapes));
+
+  AddNext(out, JITWrapper::PREDICATE_EVALUATOR);
+  AddNext(out, shapes.size());
+  for (const PredicateShape& shape : shapes) {
+    AddNext(out, shape.physical_type);
+    AddNext(out, shape.nullable);
+    AddNext(out, shape.predicate_type);
+    AddNext(out, shape.has_lower);
+    AddNext(out, shape.has_upper);
+  }
+  return Status::OK();
+}
+
+PredicateEvaluator::PredicateEvaluator(const Schema* schema,
+                                       vector<ColumnPredicate> predicates,
+                                       scoped_refptr<PredicateEvaluatorFunctions> functions)
+  : schema_(schema),
+    predicates_(std::move(predicates)),
+    functions_(std::move(functions)) {}
+
+Status PredicateEvaluator::Init() {
+  col_idxs_.clear();
+  bounds_.clear();
+  for (const ColumnPredicate& pred : predicates_) {
+    int col_idx = schema_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("Unknown column in predicate", pred.ToString());
+    }
+    col_idxs_.push_back(col_idx);
+    bounds_.push_back(pred.raw_lower());
+    bounds_.push_back(pred.raw_upper());
+  }
+  col_data_.resize(predicates_.size());
+  null_bitmaps_.resize(predicates_.size());
+
+#ifndef NDEBUG
+  // Two sets of predicates share code exactly when their keys are equal.
+  faststring key, functions_key;
+  RETURN_NOT_OK(PredicateEvaluatorFunctions::EncodeKey(*schema_, predicates_, &key));
+  RETURN_NOT_OK(functions_->EncodeOwnKey(&functions_key));
+  if (Slice(key) != Slice(functions_key)) {
+    return Status::IllegalState(
+        "Codegenned predicate evaluator's predicates incompatible with its "
+        "functions' predicates. Schema: ", schema_->ToString());
+  }
+#endif
+  return Status::OK();
+}
+
+void PredicateEvaluator::Evaluate(const RowBlock& block, SelectionVector* sel) {
+  DCHECK_SCHEMA_EQ(*schema_, block.schema());
+  DCHECK_EQ(col_idxs_.size(), predicates_.size()) << "Init() must be called first";
+  for (int j = 0; j < col_idxs_.size(); j++) {
+    ColumnBlock col_block = block.column_block(col_idxs_[j]);
+    col_data_[j] = col_block.data();
+    null_bitmaps_[j] = col_block.null_bitmap();
+  }
+  functions_->evaluate()(col_data_.data(), null_bitmaps_.data(), bounds_.data(),
+                         block.nrows(), sel->mutable_bitmap());
+}
+
+} // namespace codegen
+} // namespace kudu
@@ -0,0 +1,140 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CODEGEN_PREDICATE_EVALUATOR_H
+#define KUDU_CODEGEN_PREDICATE_EVALUATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+
+class RowBlock;
+class Schema;
+class SelectionVector;
+
+namespace codegen {
+
+// The JITWrapper for codegen::PredicateEvaluator functions. Contains the
+// compiled kernel which evaluates a conjunction of column predicates, as
+// well as the key describing the predicates' shape.
+//
+// The kernel is specialized only on the shape of the predicates: for each
+// predicate, the physical type and nullability of its column, the predicate
+// type, and which bounds are present. The column data and the predicates'
+// bound values are passed in at call time, so predicates which differ only
+// in their constants share the same compiled code.
+class PredicateEvaluatorFunctions : public JITWrapper {
+ public:
+  // Compiles the evaluation kernel for 'predicates' over rows of 'schema'.
+  // Only Equality, Range, IsNotNull, IsNull and None predicates are
+  // supported; returns Status::NotSupported for any other predicate type.
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the functions to 'out' upon success.
+  static Status Create(const Schema& schema,
+                       const std::vector<ColumnPredicate>& predicates,
+                       scoped_refptr<PredicateEvaluatorFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  // The kernel clears bit 'i' of the selection bitmap 'sel' for every row
+  // 'i' in [0, nrows) which does not satisfy all of the predicates. Rows
+  // which are already unselected are not evaluated. For the j-th predicate,
+  // 'col_data[j]' and 'null_bitmaps[j]' are the data and the null bitmap of
+  // the predicate's column block, and 'bounds[2 * j]' and 'bounds[2 * j + 1]'
+  // are its lower and upper bounds.
+  typedef void(*EvaluationFunction)(const uint8_t* const* col_data,
+                                    const uint8_t* const* null_bitmaps,
+                                    const void* const* bounds,
+                                    uint64_t nrows,
+                                    uint8_t* sel);
+  EvaluationFunction evaluate() const { return evaluate_f_; }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    out->append(key_);
+    return Status::OK();
+  }
+
+  static Status EncodeKey(const Schema& schema,
+                          const std::vector<ColumnPredicate>& predicates,
+                          faststring* out);
+
+ private:
+  PredicateEvaluatorFunctions(std::string key, EvaluationFunction evaluate_f,
+                              std::unique_ptr<JITCodeOwner> owner);
+
+  const std::string key_;
+  const EvaluationFunction evaluate_f_;
+};
+
+// Evaluates a conjunction of column predicates on row blocks using a
+// codegenned kernel. The result is the same as evaluating each of the
+// predicates in turn with ColumnPredicate::Evaluate().
+class PredicateEvaluator {
+ public:
+  // Requires that 'schema' and the values referred to by the predicates
+  // remain valid for the lifetime of this object. Also requires that the
+  // schema and predicates are compatible with the ones used to create
+  // 'functions'.
+  PredicateEvaluator(const Schema* schema,
+                     std::vector<ColumnPredicate> predicates,
+                     scoped_refptr<PredicateEvaluatorFunctions> functions);
+
+  Status Init();
+
+  // Evaluates the predicates on every row of 'block', as an 'AND' with the
+  // current contents of '*sel'. 'block' must have the schema this evaluator
+  // was created with.
+  void Evaluate(const RowBlock& block, SelectionVector* sel);
+
+  const Schema* schema() const { return schema_; }
+  const std::vector<ColumnPredicate>& predicates() const { return predicates_; }
+
+ private:
+  const Schema* const schema_;
+  const std::vector<ColumnPredicate> predicates_;
+  scoped_refptr<PredicateEvaluatorFunctions> functions_;
+
+  // The index in 'schema_' of each predicate's column.
+  std::vector<size_t> col_idxs_;
+  // The lower and upper bound of each predicate, in order.
+  std::vector<const void*> bounds_;
+
+  // Scratch space for the kernel's column arguments.
+  std::vector<const uint8_t*> col_data_;
+  std::vector<const uint8_t*> null_bitmaps_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredicateEvaluator);
+};
+
+} // namespace codegen
+} // namespace kudu
+
+#endif
@@ -39,6 +39,7 @@
 
 #include "kudu/codegen/jit_wrapper.h"
 #include "kudu/codegen/module_builder.h"
+#include "kudu/codegen/object_cache.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row.h"
 #include "kudu/common/schema.h"
@@ -293,8 +294,17 @@ Status RowProjectorFunctions::Create(const Schema& base_schema,
   builder.AddJITPromise(read, &read_f);
   builder.AddJITPromise(write, &write_f);
 
+  // Default values are embedded into the generated code as addresses of
+  // this process, so such projections cannot be persisted.
+  string object_cache_key;
+  if (no_codegen.projection_defaults().empty() && PersistentObjectCache::Enabled()) {
+    faststring key;
+    RETURN_NOT_OK(EncodeKey(base_schema, projection, &key));
+    object_cache_key = key.ToString();
+  }
+
   unique_ptr<JITCodeOwner> owner;
-  RETURN_NOT_OK(builder.Compile(&owner));
+  RETURN_NOT_OK(builder.Compile(&owner, object_cache_key));
 
   if (tm) {
     *tm = builder.GetTargetMachine();
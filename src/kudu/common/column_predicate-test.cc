@@ -26,7 +26,10 @@
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/like_pattern.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -37,6 +40,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/test_util.h"
 
+using std::string;
 using std::vector;
 
 namespace kudu {
@@ -1298,6 +1302,53 @@ TEST_F(TestColumnPredicate, TestInList) {
   }
 }
 
+// Test that in-list predicates with enough values to be evaluated through a
+// hash set match exactly the values in the list.
+TEST_F(TestColumnPredicate, TestLargeInList) {
+  {
+    ColumnSchema column("c", INT64);
+    vector<int64_t> list = { INT64_MIN, -1000, -1, 0, 1, 1000, INT64_MAX };
+    for (int64_t i = 0; i < 100; i++) {
+      list.push_back(i * 7919 + 3);
+    }
+    vector<const void*> values;
+    for (const int64_t& v : list) {
+      values.push_back(&v);
+    }
+    ColumnPredicate predicate = ColumnPredicate::InList(column, &values);
+    ASSERT_EQ(PredicateType::InList, predicate.predicate_type());
+
+    for (int64_t v : list) {
+      ASSERT_TRUE(predicate.EvaluateCell(INT64, &v)) << v;
+    }
+    for (int64_t v : { INT64_MIN + 1, int64_t{-2}, int64_t{2}, int64_t{999}, INT64_MAX - 1 }) {
+      ASSERT_FALSE(predicate.EvaluateCell(INT64, &v)) << v;
+    }
+    for (int64_t i = 0; i < 100; i++) {
+      int64_t v = i * 7919 + 4;
+      ASSERT_FALSE(predicate.EvaluateCell(INT64, &v)) << v;
+    }
+  }
+  {
+    ColumnSchema column("c", INT8);
+    vector<int8_t> list;
+    for (int i = INT8_MIN; i <= INT8_MAX; i += 3) {
+      list.push_back(static_cast<int8_t>(i));
+    }
+    vector<const void*> values;
+    for (const int8_t& v : list) {
+      values.push_back(&v);
+    }
+    ColumnPredicate predicate = ColumnPredicate::InList(column, &values);
+    ASSERT_EQ(PredicateType::InList, predicate.predicate_type());
+
+    for (int i = INT8_MIN; i <= INT8_MAX; i++) {
+      int8_t v = static_cast<int8_t>(i);
+      ASSERT_EQ((i - INT8_MIN) % 3 == 0, predicate.EvaluateCell(INT8, &v)) << i;
+    }
+  }
+}
+
 // Test that column predicate comparison works correctly: ordered by predicate
 // type first, then size of the column type.
 TEST_F(TestColumnPredicate, TestSelectivity) {
@@ -1448,4 +1499,273 @@ TEST_F(TestColumnPredicate, TestBloomFilterMerge) {
   TestMergeBloomFilterCombinations(ColumnSchema("c", STRING, true), &bfs, binary_keys);
 }
 
+// Test that evaluating a bloom filter predicate over a whole column block
+// agrees with evaluating it cell by cell, for both bloom filter layouts.
+TEST_F(TestColumnPredicate, TestEvaluateBloomFilterBlock) {
+  const int kNumRows = 1000;
+  for (BloomFilterLayout layout : { BloomFilterLayout::kClassic,
+                                    BloomFilterLayout::kSplitBlock }) {
+    SCOPED_TRACE(layout == BloomFilterLayout::kClassic ? "classic" : "split-block");
+
+    // The first filter holds the even values, the second one the multiples
+    // of three, hashed with a different algorithm.
+    BloomFilterBuilder bfb1(BloomFilterSizing::ByCountAndFPRate(kNumRows, 0.01), layout);
+    BloomFilterBuilder bfb2(BloomFilterSizing::ByCountAndFPRate(kNumRows, 0.01), layout);
+    for (uint64_t v = 0; v < kNumRows; v++) {
+      Slice key(reinterpret_cast<const uint8_t*>(&v), sizeof(v));
+      if (v % 2 == 0) {
+        bfb1.AddKey(BloomKeyProbe(key, CITY_HASH));
+      }
+      if (v % 3 == 0) {
+        bfb2.AddKey(BloomKeyProbe(key, MURMUR_HASH_2));
+      }
+    }
+    vector<ColumnPredicate::BloomFilterInner> bfs;
+    bfs.emplace_back(bfb1.slice(), bfb1.n_hashes(), CITY_HASH, layout);
+    bfs.emplace_back(bfb2.slice(), bfb2.n_hashes(), MURMUR_HASH_2, layout);
+    uint64_t lower = 100;
+    ColumnPredicate predicate = ColumnPredicate::InBloomFilter(
+        ColumnSchema("c", UINT64, true), &bfs, &lower, nullptr);
+    ASSERT_EQ(PredicateType::InBloomFilter, predicate.predicate_type());
+
+    // Every seventh row is null.
+    ScopedColumnBlock<UINT64> block(kNumRows);
+    for (int i = 0; i < kNumRows; i++) {
+      block[i] = i;
+      block.SetCellIsNull(i, i % 7 == 0);
+    }
+    SelectionVector sel(kNumRows);
+    sel.SetAllTrue();
+    predicate.Evaluate(block, &sel);
+
+    for (int i = 0; i < kNumRows; i++) {
+      uint64_t v = i;
+      bool expected = i % 7 != 0 && predicate.EvaluateCell(UINT64, &v);
+      ASSERT_EQ(expected, sel.IsRowSelected(i)) << i;
+      if (i % 7 != 0 && i % 6 == 0 && v >= lower) {
+        ASSERT_TRUE(sel.IsRowSelected(i)) << i;
+      }
+      if (v < lower) {
+        ASSERT_FALSE(sel.IsRowSelected(i)) << i;
+      }
+    }
+  }
+}
+
+// Test that the prefix constructor creates a range up to the successor of
+// the prefix.
+TEST_F(TestColumnPredicate, TestPrefix) {
+  Arena arena(1024);
+  ColumnSchema column("c", STRING, true);
+  {
+    Slice lower("abc");
+    Slice upper("abd");
+    ASSERT_EQ(ColumnPredicate::Range(column, &lower, &upper),
+              ColumnPredicate::Prefix(column, "abc", &arena));
+  }
+  {
+    // Trailing 0xff bytes are dropped before incrementing.
+    Slice lower("a\xff\xff");
+    Slice upper("b");
+    ASSERT_EQ(ColumnPredicate::Range(column, &lower, &upper),
+              ColumnPredicate::Prefix(column, lower, &arena));
+  }
+  {
+    // A prefix of 0xff bytes has no successor.
+    Slice lower("\xff\xff");
+    ASSERT_EQ(ColumnPredicate::Range(column, &lower, nullptr),
+              ColumnPredicate::Prefix(column, lower, &arena));
+  }
+  // Every value starts with the empty prefix.
+  ASSERT_EQ(ColumnPredicate::IsNotNull(column),
+            ColumnPredicate::Prefix(column, "", &arena));
+
+  ColumnPredicate pred = ColumnPredicate::Prefix(column, "ab", &arena);
+  for (const char* value : { "ab", "abc", "ab\xff" }) {
+    Slice cell(value);
+    ASSERT_TRUE(pred.EvaluateCell(BINARY, &cell)) << value;
+  }
+  for (const char* value : { "a", "aa\xff", "ac", "b" }) {
+    Slice cell(value);
+    ASSERT_FALSE(pred.EvaluateCell(BINARY, &cell)) << value;
+  }
+}
+
+TEST_F(TestColumnPredicate, TestLikePatternMatching) {
+  struct {
+    const char* pattern;
+    const char* value;
+    bool matches;
+  } cases[] = {
+    { "", "", true },
+    { "", "a", false },
+    { "%", "", true },
+    { "%", "abc", true },
+    { "abc", "abc", true },
+    { "abc", "abcd", false },
+    { "a_c", "abc", true },
+    { "a_c", "ac", false },
+    { "___", "abc", true },
+    { "___", "abcd", false },
+    { "abc%", "abcdef", true },
+    { "%def", "abcdef", true },
+    { "%def", "abcdefg", false },
+    { "%cd%", "abcdef", true },
+    { "%dc%", "abcdef", false },
+    { "a%c%e", "abcde", true },
+    { "a%c%e", "aec", false },
+    { "a%ab%b", "aab", false },
+    { "a%ab%b", "aabb", true },
+    { "%a_c%", "xxabcxx", true },
+    { "%a_c%", "xxacxx", false },
+    { "%aa%aa%", "aaa", false },
+    { "%aa%aa%", "aaaa", true },
+    { "100\\%", "100%", true },
+    { "100\\%", "1000", false },
+    { "a\\_c", "a_c", true },
+    { "a\\_c", "abc", false },
+    { "a\\\\", "a\\", true },
+    { "a\\", "a\\", true },
+    // Long enough values and needles to take the vectorized search.
+    { "%needle in a haystack%", "a haystack, with a needle in a haystack in it", true },
+    { "%needle in a haystack%", "a haystack, with a needle in a haystac", false },
+    { "%xy%", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxy", true },
+    { "%xy%", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", false },
+  };
+  for (const auto& c : cases) {
+    LikePattern pattern(c.pattern);
+    ASSERT_EQ(c.matches, pattern.Matches(c.value)) << c.pattern << " LIKE " << c.value;
+  }
+
+  // Compare the vectorized search with a naive one on random values.
+  const string alphabet = "ab";
+  for (int i = 0; i < 1000; i++) {
+    string needle;
+    for (int j = 0, len = 1 + rand_.Uniform(4); j < len; j++) {
+      needle.push_back(alphabet[rand_.Uniform(alphabet.size())]);
+    }
+    string value;
+    for (int j = 0, len = rand_.Uniform(64); j < len; j++) {
+      value.push_back(alphabet[rand_.Uniform(alphabet.size())]);
+    }
+    LikePattern pattern("%" + needle + "%");
+    ASSERT_EQ(value.find(needle) != string::npos, pattern.Matches(value))
+        << needle << " in " << value;
+  }
+}
+
+// Test that LIKE predicates are simplified and merged with other predicates.
+TEST_F(TestColumnPredicate, TestLike) {
+  Arena arena(1024);
+  ColumnSchema column("c", STRING, true);
+
+  Slice abc("abc");
+  ASSERT_EQ(ColumnPredicate::Equality(column, &abc),
+            ColumnPredicate::Like(column, "abc", &arena));
+  ASSERT_EQ(ColumnPredicate::Prefix(column, "abc", &arena),
+            ColumnPredicate::Like(column, "abc%%", &arena));
+  ASSERT_EQ(ColumnPredicate::IsNotNull(column),
+            ColumnPredicate::Like(column, "%", &arena));
+
+  // A pattern with a literal prefix is bounded by it.
+  ColumnPredicate like = ColumnPredicate::Like(column, "ab%d", &arena);
+  ASSERT_EQ(PredicateType::Like, like.predicate_type());
+  ColumnPredicate prefix = ColumnPredicate::Prefix(column, "ab", &arena);
+  ASSERT_EQ(0, column.type_info()->Compare(prefix.raw_lower(), like.raw_lower()));
+  ASSERT_EQ(0, column.type_info()->Compare(prefix.raw_upper(), like.raw_upper()));
+  ASSERT_EQ("c LIKE 'ab%d'", like.ToString());
+
+  ColumnPredicate unbounded = ColumnPredicate::Like(column, "%b_d", &arena);
+  ASSERT_EQ(PredicateType::Like, unbounded.predicate_type());
+  ASSERT_EQ(nullptr, unbounded.raw_lower());
+  ASSERT_EQ(nullptr, unbounded.raw_upper());
+
+  // Merging with Like and Range predicates keeps every constraint.
+  {
+    ColumnPredicate merged = like;
+    merged.Merge(unbounded);
+    ASSERT_EQ(PredicateType::Like, merged.predicate_type());
+    ASSERT_EQ(2, merged.like_patterns().size());
+    ASSERT_EQ("c LIKE 'ab%d' AND c LIKE '%b_d'", merged.ToString());
+    for (const char* value : { "abcd", "abbd", "ab_d" }) {
+      Slice cell(value);
+      ASSERT_TRUE(merged.EvaluateCell(BINARY, &cell)) << value;
+    }
+    for (const char* value : { "abd", "abcde", "xbcd" }) {
+      Slice cell(value);
+      ASSERT_FALSE(merged.EvaluateCell(BINARY, &cell)) << value;
+    }
+  }
+  {
+    Slice lower("abc");
+    ColumnPredicate range = ColumnPredicate::Range(column, &lower, nullptr);
+    ColumnPredicate merged = range;
+    merged.Merge(like);
+    ColumnPredicate reverse = like;
+    reverse.Merge(range);
+    ASSERT_EQ(merged, reverse);
+    ASSERT_EQ(PredicateType::Like, merged.predicate_type());
+    ASSERT_EQ(0, column.type_info()->Compare(&lower, merged.raw_lower()));
+    Slice abbd("abbd");
+    ASSERT_FALSE(merged.EvaluateCell(BINARY, &abbd));
+    Slice abcd("abcd");
+    ASSERT_TRUE(merged.EvaluateCell(BINARY, &abcd));
+  }
+
+  // Merging with values checks them against the patterns.
+  Slice abcd("abcd");
+  Slice abce("abce");
+  Slice xbcd("xbcd");
+  TestMerge(like,
+            ColumnPredicate::Equality(column, &abcd),
+            ColumnPredicate::Equality(column, &abcd),
+            PredicateType::Equality);
+  TestMerge(like,
+            ColumnPredicate::Equality(column, &abce),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+  {
+    vector<const void*> values = { &abcd, &abce, &xbcd };
+    vector<const void*> matching_values = { &abcd, &xbcd };
+    TestMerge(unbounded,
+              ColumnPredicate::InList(column, &values),
+              ColumnPredicate::InList(column, &matching_values),
+              PredicateType::InList);
+  }
+  TestMerge(like,
+            ColumnPredicate::IsNotNull(column),
+            like,
+            PredicateType::Like);
+  TestMerge(like,
+            ColumnPredicate::IsNull(column),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+}
+
+TEST_F(TestColumnPredicate, TestEvaluateLikeBlock) {
+  const int kNumRows = 1000;
+  Arena arena(1024);
+  vector<string> values;
+  for (int i = 0; i < kNumRows; i++) {
+    values.push_back(strings::Substitute("row-$0-of-$1", i, kNumRows));
+  }
+  ScopedColumnBlock<STRING> block(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    block[i] = Slice(values[i]);
+    // Every seventh row is null.
+    block.SetCellIsNull(i, i % 7 == 0);
+  }
+
+  ColumnPredicate predicate = ColumnPredicate::Like(ColumnSchema("c", STRING, true),
+                                                    "row-%9-of%", &arena);
+  ASSERT_EQ(PredicateType::Like, predicate.predicate_type());
+  SelectionVector sel(kNumRows);
+  sel.SetAllTrue();
+  predicate.Evaluate(block, &sel);
+  for (int i = 0; i < kNumRows; i++) {
+    bool expected = i % 7 != 0 && i % 10 == 9;
+    ASSERT_EQ(expected, sel.IsRowSelected(i)) << i;
+  }
+}
+
 } // namespace kudu
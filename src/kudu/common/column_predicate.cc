@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cstring>
 #include <iterator>
+#include <memory>
 
 #include <boost/optional/optional.hpp>
 
@@ -32,15 +33,44 @@
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
 
 using std::move;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
 namespace kudu {
 
+const size_t InListHashSet::kMinValues;
+const uint64_t InListHashSet::kEmptySlot;
+
+InListHashSet::InListHashSet(const vector<uint64_t>& keys)
+    : contains_empty_slot_key_(false) {
+  // Keep the table at most half full so that probe sequences stay short.
+  int log_slots = 1;
+  while ((1ULL << log_slots) < keys.size() * 2) {
+    log_slots++;
+  }
+  slots_.resize(1ULL << log_slots, kEmptySlot);
+  mask_ = slots_.size() - 1;
+  shift_ = 64 - log_slots;
+  for (uint64_t key : keys) {
+    if (key == kEmptySlot) {
+      contains_empty_slot_key_ = true;
+      continue;
+    }
+    size_t i = SlotOf(key);
+    while (slots_[i] != kEmptySlot && slots_[i] != key) {
+      i = (i + 1) & mask_;
+    }
+    slots_[i] = key;
+  }
+}
+
 ColumnPredicate::ColumnPredicate(PredicateType predicate_type,
                                  ColumnSchema column,
                                  const void* lower,
@@ -73,6 +103,16 @@ ColumnPredicate::ColumnPredicate(PredicateType predicate_type,
   bloom_filters_.swap(*bfs);
 }
 
+ColumnPredicate::ColumnPredicate(PredicateType predicate_type,
+                                 ColumnSchema column,
+                                 vector<shared_ptr<const LikePattern>>* patterns)
+    : predicate_type_(predicate_type),
+      column_(move(column)),
+      lower_(nullptr),
+      upper_(nullptr) {
+  like_patterns_.swap(*patterns);
+}
+
 ColumnPredicate ColumnPredicate::Equality(ColumnSchema column, const void* value) {
   CHECK(value != nullptr);
   return ColumnPredicate(PredicateType::Equality, move(column), value, nullptr);
@@ -172,6 +212,57 @@ ColumnPredicate ColumnPredicate::ExclusiveRange(ColumnSchema column,
   return ColumnPredicate::Range(move(column), lower, upper);
 }
 
+namespace {
+// Returns a Slice cell holding a copy of 'value', allocated in 'arena'.
+const Slice* CopySliceCell(const Slice& value, Arena* arena) {
+  Slice* cell = CHECK_NOTNULL(arena->NewObject<Slice>());
+  CHECK(arena->RelocateSlice(value, cell));
+  return cell;
+}
+} // anonymous namespace
+
+ColumnPredicate ColumnPredicate::Prefix(ColumnSchema column, const Slice& prefix, Arena* arena) {
+  CHECK_EQ(BINARY, column.type_info()->physical_type());
+  const Slice* lower = CopySliceCell(prefix, arena);
+
+  // The successor of the prefix is the smallest value greater than every
+  // value which starts with it: the prefix without its trailing 0xff bytes,
+  // with the last remaining byte incremented. A prefix of only 0xff bytes has
+  // no successor.
+  size_t len = prefix.size();
+  while (len > 0 && prefix[len - 1] == 0xff) {
+    len--;
+  }
+  const Slice* upper = nullptr;
+  if (len > 0) {
+    uint8_t* buf = static_cast<uint8_t*>(CHECK_NOTNULL(arena->AllocateBytes(len)));
+    memcpy(buf, prefix.data(), len);
+    buf[len - 1]++;
+    upper = CHECK_NOTNULL(arena->NewObject<Slice>(buf, len));
+  }
+  return ColumnPredicate::Range(move(column), lower, upper);
+}
+
+ColumnPredicate ColumnPredicate::Like(ColumnSchema column, const Slice& pattern, Arena* arena) {
+  CHECK_EQ(BINARY, column.type_info()->physical_type());
+  auto like = std::make_shared<const LikePattern>(pattern);
+  if (like->is_literal()) {
+    return ColumnPredicate::Equality(move(column), CopySliceCell(like->literal_prefix(), arena));
+  }
+  if (like->is_prefix()) {
+    return ColumnPredicate::Prefix(move(column), like->literal_prefix(), arena);
+  }
+  ColumnPredicate prefix = ColumnPredicate::Prefix(column, like->literal_prefix(), arena);
+  vector<shared_ptr<const LikePattern>> patterns = { std::move(like) };
+  ColumnPredicate pred(PredicateType::Like, move(column), &patterns);
+  // Bound the values by the literal prefix of the pattern, so that the
+  // predicate can be pushed into primary key bounds and checked against zone
+  // maps. An empty prefix gives an IS NOT NULL predicate, which doesn't
+  // constrain the value.
+  pred.MergeIntoLike(prefix);
+  return pred;
+}
+
 ColumnPredicate ColumnPredicate::IsNotNull(ColumnSchema column) {
   return ColumnPredicate(PredicateType::IsNotNull, move(column), nullptr, nullptr);
 }
@@ -190,6 +281,42 @@ void ColumnPredicate::SetToNone() {
   predicate_type_ = PredicateType::None;
   lower_ = nullptr;
   upper_ = nullptr;
+  in_list_hash_set_.reset();
+  bloom_filters_.clear();
+  like_patterns_.clear();
+}
+
+namespace {
+template <DataType PhysicalType>
+shared_ptr<const InListHashSet> BuildInListHashSet(const vector<const void*>& values) {
+  typedef typename DataTypeTraits<PhysicalType>::cpp_type cpp_type;
+  vector<uint64_t> keys;
+  keys.reserve(values.size());
+  for (const void* value : values) {
+    keys.push_back(InListHashSet::KeyOf(*static_cast<const cpp_type*>(value)));
+  }
+  return std::make_shared<const InListHashSet>(keys);
+}
+} // anonymous namespace
+
+void ColumnPredicate::MaybeBuildInListHashSet() {
+  in_list_hash_set_.reset();
+  if (predicate_type_ != PredicateType::InList || values_.size() < InListHashSet::kMinValues) {
+    return;
+  }
+  switch (column_.type_info()->physical_type()) {
+    case INT8: in_list_hash_set_ = BuildInListHashSet<INT8>(values_); return;
+    case INT16: in_list_hash_set_ = BuildInListHashSet<INT16>(values_); return;
+    case INT32: in_list_hash_set_ = BuildInListHashSet<INT32>(values_); return;
+    case INT64: in_list_hash_set_ = BuildInListHashSet<INT64>(values_); return;
+    case UINT8: in_list_hash_set_ = BuildInListHashSet<UINT8>(values_); return;
+    case UINT16: in_list_hash_set_ = BuildInListHashSet<UINT16>(values_); return;
+    case UINT32: in_list_hash_set_ = BuildInListHashSet<UINT32>(values_); return;
+    case UINT64: in_list_hash_set_ = BuildInListHashSet<UINT64>(values_); return;
+    // Floating point values equal as numbers may differ in their bits, and
+    // strings and 128-bit integers don't fit a key; those are binary searched.
+    default: return;
+  }
 }
 
 // TODO(granthenke): For decimal columns, use column_.type_attributes().precision
@@ -248,9 +375,11 @@ void ColumnPredicate::Simplify() {
         upper_ = nullptr;
         values_.clear();
       }
+      MaybeBuildInListHashSet();
       return;
     };
-    case PredicateType::InBloomFilter: {
+    case PredicateType::InBloomFilter:
+    case PredicateType::Like: {
       if (lower_ == nullptr && upper_ == nullptr) {
         return;
       }
@@ -264,6 +393,7 @@ void ColumnPredicate::Simplify() {
             predicate_type_ = PredicateType::Equality;
             upper_ = nullptr;
             bloom_filters_.clear();
+            like_patterns_.clear();
           } else {
             SetToNone();
           }
@@ -275,6 +405,7 @@ void ColumnPredicate::Simplify() {
           if (CheckValueInBloomFilter(lower_)) {
             predicate_type_ = PredicateType::Equality;
             bloom_filters_.clear();
+            like_patterns_.clear();
           } else {
             SetToNone();
           }
@@ -318,6 +449,10 @@ void ColumnPredicate::Merge(const ColumnPredicate& other) {
       MergeIntoBloomFilter(other);
       return;
     };
+    case PredicateType::Like: {
+      MergeIntoLike(other);
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -330,6 +465,10 @@ void ColumnPredicate::MergeIntoRange(const ColumnPredicate& other) {
       SetToNone();
       return;
     };
+    case PredicateType::Like: {
+      MergeIntoOtherLike(other);
+      return;
+    };
     case PredicateType::InBloomFilter: {
       bloom_filters_ = other.bloom_filters_;
       predicate_type_ = PredicateType::InBloomFilter;
@@ -424,7 +563,8 @@ void ColumnPredicate::MergeIntoEquality(const ColumnPredicate& other) {
       }
       return;
     };
-    case PredicateType::InBloomFilter: {
+    case PredicateType::InBloomFilter:
+    case PredicateType::Like: {
       if (!other.CheckValueInBloomFilter(lower_)) {
         SetToNone();
       }
@@ -449,6 +589,7 @@ void ColumnPredicate::MergeIntoIsNotNull(const ColumnPredicate &other) {
       upper_ = other.upper_;
       values_ = other.values_;
       bloom_filters_ = other.bloom_filters_;
+      like_patterns_ = other.like_patterns_;
       return;
     }
   }
@@ -570,7 +711,8 @@ void ColumnPredicate::MergeIntoInList(const ColumnPredicate &other) {
       Simplify();
       return;
     };
-    case PredicateType::InBloomFilter: {
+    case PredicateType::InBloomFilter:
+    case PredicateType::Like: {
       std::vector<const void*> new_values;
       std::copy_if(values_.begin(), values_.end(), std::back_inserter(new_values),
                    [&] (const void* value) {
@@ -593,6 +735,10 @@ void ColumnPredicate::MergeIntoBloomFilter(const ColumnPredicate &other) {
       SetToNone();
       return;
     };
+    case PredicateType::Like: {
+      MergeIntoOtherLike(other);
+      return;
+    };
     case PredicateType::InBloomFilter: {
       bloom_filters_.insert(bloom_filters_.end(), other.bloom_filters().begin(),
                             other.bloom_filters().end());
@@ -645,24 +791,175 @@ void ColumnPredicate::MergeIntoBloomFilter(const ColumnPredicate &other) {
   LOG(FATAL) << "unknown predicate type";
 }
 
+void ColumnPredicate::MergeIntoLike(const ColumnPredicate& other) {
+  CHECK(predicate_type_ == PredicateType::Like);
+  DCHECK(!like_patterns_.empty());
+
+  switch (other.predicate_type()) {
+    case PredicateType::None: {
+      SetToNone();
+      return;
+    };
+    case PredicateType::Like: {
+      like_patterns_.insert(like_patterns_.end(), other.like_patterns_.begin(),
+                            other.like_patterns_.end());
+      FALLTHROUGH_INTENDED;
+    }
+    case PredicateType::InBloomFilter: {
+      bloom_filters_.insert(bloom_filters_.end(), other.bloom_filters_.begin(),
+                            other.bloom_filters_.end());
+      FALLTHROUGH_INTENDED;
+    }
+    case PredicateType::Range: {
+      // Merge the optional lower and upper bound.
+      if (other.lower_ != nullptr &&
+          (lower_ == nullptr || column_.type_info()->Compare(lower_, other.lower_) < 0)) {
+        lower_ = other.lower_;
+      }
+      if (other.upper_ != nullptr &&
+          (upper_ == nullptr || column_.type_info()->Compare(upper_, other.upper_) > 0)) {
+        upper_ = other.upper_;
+      }
+      Simplify();
+      return;
+    }
+    case PredicateType::Equality: {
+      if (EvaluateCell(column_.type_info()->physical_type(), other.lower_)) {
+        predicate_type_ = PredicateType::Equality;
+        lower_ = other.lower_;
+        upper_ = nullptr;
+        bloom_filters_.clear();
+        like_patterns_.clear();
+      } else {
+        SetToNone();
+      }
+      return;
+    }
+    case PredicateType::IsNotNull: return;
+    case PredicateType::IsNull: {
+      SetToNone();
+      return;
+    }
+    case PredicateType::InList: {
+      DCHECK(other.values_.size() > 1);
+      std::vector<const void*> new_values;
+      std::copy_if(other.values_.begin(), other.values_.end(), std::back_inserter(new_values),
+                   [&] (const void* value) {
+                     return EvaluateCell(column_.type_info()->physical_type(), value);
+                   });
+      predicate_type_ = PredicateType::InList;
+      lower_ = nullptr;
+      upper_ = nullptr;
+      values_.swap(new_values);
+      bloom_filters_.clear();
+      like_patterns_.clear();
+      Simplify();
+      return;
+    }
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
+void ColumnPredicate::MergeIntoOtherLike(const ColumnPredicate& like) {
+  DCHECK(like.predicate_type() == PredicateType::Like);
+  ColumnPredicate merged(like);
+  merged.MergeIntoLike(*this);
+  *this = std::move(merged);
+}
+
 namespace {
 template <typename P>
 void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
+  uint8_t* bitmap = sel->mutable_bitmap();
+  // Only the rows which are still selected need to be evaluated, and earlier
+  // predicates have often unselected most of them.
   if (block.is_nullable()) {
-    for (size_t i = 0; i < block.nrows(); i++) {
-      if (!sel->IsRowSelected(i)) continue;
+    BitmapForEachSetBit(bitmap, block.nrows(), [&](size_t i) {
       const void* cell = block.nullable_cell_ptr(i);
       if (cell == nullptr || !p(cell)) {
-        BitmapClear(sel->mutable_bitmap(), i);
+        BitmapClear(bitmap, i);
       }
-    }
+    });
   } else {
-    for (size_t i = 0; i < block.nrows(); i++) {
-      if (!sel->IsRowSelected(i)) continue;
+    BitmapForEachSetBit(bitmap, block.nrows(), [&](size_t i) {
       const void* cell = block.cell_ptr(i);
       if (!p(cell)) {
+        BitmapClear(bitmap, i);
+      }
+    });
+  }
+}
+
+// Clears the selected rows of 'block' whose cells are null or are not present
+// in every one of 'bfs'.
+//
+// Rather than checking each cell against each filter in turn, the rows are
+// handled in batches: the hashes of the batch's cells are computed once, and
+// then each filter is probed with the whole batch, so that split-block
+// filters can prefetch their buckets and vectorize the bit tests. Only the
+// rows which pass a filter are probed against the next one.
+template <DataType PhysicalType>
+void ApplyBloomFilters(const vector<ColumnPredicate::BloomFilterInner>& bfs,
+                       const ColumnBlock& block,
+                       SelectionVector* sel) {
+  static constexpr size_t kBatchSize = 128;
+  BloomKeyProbe probes[kBatchSize];
+  const BloomKeyProbe* probe_ptrs[kBatchSize];
+  size_t rows[kBatchSize];
+  bool may_contain[kBatchSize];
+
+  auto cell_slice = [] (const void* cell) {
+    if (PhysicalType == BINARY) {
+      return *reinterpret_cast<const Slice*>(cell);
+    }
+    return Slice(reinterpret_cast<const uint8_t*>(cell),
+                 sizeof(typename DataTypeTraits<PhysicalType>::cpp_type));
+  };
+
+  for (size_t start = 0; start < block.nrows(); start += kBatchSize) {
+    const size_t end = std::min(block.nrows(), start + kBatchSize);
+
+    // Gather the selected non-null rows of the batch.
+    size_t n = 0;
+    for (size_t i = start; i < end; i++) {
+      if (!sel->IsRowSelected(i)) continue;
+      const void* cell = block.is_nullable() ? block.nullable_cell_ptr(i) : block.cell_ptr(i);
+      if (cell == nullptr) {
         BitmapClear(sel->mutable_bitmap(), i);
+        continue;
+      }
+      probes[n] = BloomKeyProbe(cell_slice(cell), bfs.front().hash_algorithm());
+      probe_ptrs[n] = &probes[n];
+      rows[n] = i;
+      n++;
+    }
+
+    HashAlgorithm hash_algorithm = bfs.front().hash_algorithm();
+    for (const auto& bf : bfs) {
+      if (n == 0) {
+        break;
+      }
+      if (bf.hash_algorithm() != hash_algorithm) {
+        hash_algorithm = bf.hash_algorithm();
+        for (size_t k = 0; k < n; k++) {
+          probes[k] = BloomKeyProbe(probes[k].key(), hash_algorithm);
+        }
+      }
+      BloomFilter(bf.bloom_data(), bf.nhash(), bf.layout())
+          .MayContainKeys(probe_ptrs, n, may_contain);
+
+      // Deselect the rows which failed, and keep the others for the next filter.
+      size_t remaining = 0;
+      for (size_t k = 0; k < n; k++) {
+        if (!may_contain[k]) {
+          BitmapClear(sel->mutable_bitmap(), rows[k]);
+          continue;
+        }
+        probes[remaining] = probes[k];
+        rows[remaining] = rows[k];
+        remaining++;
       }
+      n = remaining;
     }
   }
 }
@@ -721,6 +1018,13 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       return;
     }
     case PredicateType::InList: {
+      if (in_list_hash_set_) {
+        const InListHashSet* set = in_list_hash_set_.get();
+        ApplyPredicate(block, sel, [set] (const void* cell) {
+          return set->Contains(InListHashKey<PhysicalType>(cell));
+        });
+        return;
+      }
       ApplyPredicate(block, sel, [this] (const void* cell) {
         return std::binary_search(values_.begin(), values_.end(), cell,
                                   [] (const void* lhs, const void* rhs) {
@@ -731,8 +1035,36 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
     };
     case PredicateType::None: LOG(FATAL) << "NONE predicate evaluation";
     case PredicateType::InBloomFilter: {
+      ApplyBloomFilters<PhysicalType>(bloom_filters_, block, sel);
+      if (lower_ == nullptr && upper_ == nullptr) {
+        return;
+      }
+      ApplyPredicate(block, sel, [this] (const void* cell) {
+        return (lower_ == nullptr ||
+                DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) >= 0) &&
+               (upper_ == nullptr ||
+                DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0);
+      });
+      return;
+    };
+    case PredicateType::Like: {
+      if (!bloom_filters_.empty()) {
+        ApplyBloomFilters<PhysicalType>(bloom_filters_, block, sel);
+      }
       ApplyPredicate(block, sel, [this] (const void* cell) {
-          return EvaluateCell<PhysicalType>(cell);
+        if ((lower_ != nullptr &&
+             DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) < 0) ||
+            (upper_ != nullptr &&
+             DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) >= 0)) {
+          return false;
+        }
+        const Slice* value = reinterpret_cast<const Slice*>(cell);
+        for (const auto& pattern : like_patterns_) {
+          if (!pattern->Matches(*value)) {
+            return false;
+          }
+        }
+        return true;
       });
       return;
     };
@@ -817,6 +1149,14 @@ string ColumnPredicate::ToString() const {
     case PredicateType::InBloomFilter: {
       return strings::Substitute("`$0` IS InBloomFilter", column_.name());
     };
+    case PredicateType::Like: {
+      return JoinMapped(like_patterns_,
+                        [&] (const shared_ptr<const LikePattern>& pattern) {
+                          return strings::Substitute("$0 LIKE '$1'", column_.name(),
+                                                     KUDU_REDACT(pattern->pattern()));
+                        },
+                        " AND ");
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -828,6 +1168,13 @@ bool ColumnPredicate::operator==(const ColumnPredicate& other) const {
   }
   switch (predicate_type_) {
     case PredicateType::Equality: return column_.type_info()->Compare(lower_, other.lower_) == 0;
+    case PredicateType::Like: {
+      if (like_patterns_.size() != other.like_patterns_.size()) return false;
+      for (int i = 0; i < like_patterns_.size(); i++) {
+        if (like_patterns_[i]->pattern() != other.like_patterns_[i]->pattern()) return false;
+      }
+      FALLTHROUGH_INTENDED;
+    };
     case PredicateType::InBloomFilter: {
       if (bloom_filters_ != other.bloom_filters()) {
         return false;
@@ -881,8 +1228,9 @@ int SelectivityRank(const ColumnPredicate& predicate) {
     case PredicateType::Equality: rank = 2; break;
     case PredicateType::InList: rank = 3; break;
     case PredicateType::Range: rank = 4; break;
-    case PredicateType::InBloomFilter: rank = 5; break;
-    case PredicateType::IsNotNull: rank = 6; break;
+    case PredicateType::Like: rank = 5; break;
+    case PredicateType::InBloomFilter: rank = 6; break;
+    case PredicateType::IsNotNull: rank = 7; break;
     default: LOG(FATAL) << "unknown predicate type";
   }
   return rank * (kLargestTypeSize + 1) + predicate.column().type_info()->size();
@@ -21,16 +21,20 @@
 #include <cstdint>
 
 #include <algorithm>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
 
 #include "kudu/common/common.pb.h"
+#include "kudu/common/like_pattern.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/slice.h"
 
@@ -65,6 +69,72 @@ enum class PredicateType {
   // A predicate which evaluates to true if the column value is present in
   // a bloom filter.
   InBloomFilter,
+
+  // A predicate which evaluates to true if the column value matches every one
+  // of a list of SQL LIKE patterns. Like InBloomFilter, the value must also
+  // fall within optional range bounds and be present in optional bloom
+  // filters.
+  Like,
+};
+
+// An immutable hash set of the values of an InList predicate over an integer
+// column, so that evaluating the predicate on a cell takes constant time
+// rather than a binary search over the values.
+//
+// Values are mapped to 64-bit keys by InListHashSet::KeyOf() and stored with
+// open addressing and linear probing in a table at most half full.
+class InListHashSet {
+ public:
+  // The smallest number of values for which an InList predicate is evaluated
+  // with a hash set. Binary searching a few values is as fast.
+  static const size_t kMinValues = 32;
+
+  explicit InListHashSet(const std::vector<uint64_t>& keys);
+
+  // Returns whether 'key' is in the set.
+  bool Contains(uint64_t key) const {
+    if (PREDICT_FALSE(key == kEmptySlot)) {
+      return contains_empty_slot_key_;
+    }
+    for (size_t i = SlotOf(key); ; i = (i + 1) & mask_) {
+      uint64_t slot = slots_[i];
+      if (slot == key) return true;
+      if (slot == kEmptySlot) return false;
+    }
+  }
+
+  // Returns the key of an integer value of up to 64 bits.
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value && sizeof(T) <= sizeof(uint64_t),
+                                 uint64_t>::type
+  KeyOf(T value) {
+    return static_cast<uint64_t>(value);
+  }
+
+  // Values of other types aren't hashed; see ColumnPredicate::Simplify().
+  template<typename T>
+  static typename std::enable_if<!(std::is_integral<T>::value &&
+                                   sizeof(T) <= sizeof(uint64_t)),
+                                 uint64_t>::type
+  KeyOf(const T& /*value*/) {
+    LOG(FATAL) << "hashed InList predicate on a non-integer column";
+    return 0;
+  }
+
+ private:
+  // Marks an empty slot. Whether the key itself is in the set is tracked
+  // separately.
+  static const uint64_t kEmptySlot = 0;
+
+  // Fibonacci hashing: the top bits of the key times 2^64 / phi.
+  size_t SlotOf(uint64_t key) const {
+    return (key * 0x9E3779B97F4A7C15ULL) >> shift_;
+  }
+
+  std::vector<uint64_t> slots_;
+  size_t mask_;
+  int shift_;
+  bool contains_empty_slot_key_;
 };
 
 // A predicate which can be evaluated over a block of column values.
@@ -147,6 +217,25 @@ class ColumnPredicate {
   static ColumnPredicate InBloomFilter(ColumnSchema column, std::vector<BloomFilterInner>* bfs,
                                        const void* lower, const void* upper);
 
+  // Creates a new predicate which matches the values of a string or binary
+  // column which start with 'prefix'.
+  //
+  // The predicate is a Range from the prefix to its successor, so that it can
+  // be pushed into primary key bounds and checked against zone maps. The
+  // prefix and the successor are copied into the arena, which must outlive
+  // the returned predicate.
+  static ColumnPredicate Prefix(ColumnSchema column, const Slice& prefix, Arena* arena);
+
+  // Creates a new predicate which matches the values of a string or binary
+  // column which match the SQL LIKE 'pattern'. See LikePattern for the syntax.
+  //
+  // A pattern without wildcards is simplified into an Equality predicate, and
+  // one which is a literal followed only by '%' into a Prefix predicate.
+  // Otherwise the predicate is bounded by the pattern's literal prefix, if it
+  // has one. The arena is used for allocating those values and must outlive
+  // the returned predicate; the pattern itself is copied.
+  static ColumnPredicate Like(ColumnSchema column, const Slice& pattern, Arena* arena);
+
   // Creates a new predicate which matches no values.
   static ColumnPredicate None(ColumnSchema column);
 
@@ -209,6 +298,9 @@ class ColumnPredicate {
         return false;
       };
       case PredicateType::InList: {
+        if (in_list_hash_set_) {
+          return in_list_hash_set_->Contains(InListHashKey<PhysicalType>(cell));
+        }
         return std::binary_search(values_.begin(), values_.end(), cell,
                                   [] (const void* lhs, const void* rhs) {
                                     return DataTypeTraits<PhysicalType>::Compare(lhs, rhs) < 0;
@@ -217,6 +309,9 @@ class ColumnPredicate {
       case PredicateType::InBloomFilter: {
         return EvaluateCellForBloomFilter<PhysicalType>(cell);
       };
+      case PredicateType::Like: {
+        return EvaluateCellForLike<PhysicalType>(cell);
+      };
     }
     LOG(FATAL) << "unknown predicate type";
   }
@@ -259,17 +354,28 @@ class ColumnPredicate {
     return bloom_filters_;
   }
 
+  // Returns the patterns if this is a Like predicate.
+  const std::vector<std::shared_ptr<const LikePattern>>& like_patterns() const {
+    return like_patterns_;
+  }
+
   // This class represents the bloom filter used in predicate.
   class BloomFilterInner {
    public:
 
-    BloomFilterInner(Slice bloom_data, size_t nhash, HashAlgorithm hash_algorithm) :
+    BloomFilterInner(Slice bloom_data, size_t nhash, HashAlgorithm hash_algorithm,
+                     BloomFilterLayout layout = BloomFilterLayout::kClassic) :
             bloom_data_(bloom_data),
             nhash_(nhash),
-            hash_algorithm_(hash_algorithm) {
+            hash_algorithm_(hash_algorithm),
+            layout_(layout) {
     }
 
-    BloomFilterInner() : nhash_(0), hash_algorithm_(CITY_HASH) {}
+    BloomFilterInner()
+        : nhash_(0),
+          hash_algorithm_(CITY_HASH),
+          layout_(BloomFilterLayout::kClassic) {
+    }
 
     const Slice& bloom_data() const {
       return bloom_data_;
@@ -283,6 +389,10 @@ class ColumnPredicate {
       return hash_algorithm_;
     }
 
+    BloomFilterLayout layout() const {
+      return layout_;
+    }
+
     void set_nhash(size_t nhash) {
       nhash_ = nhash;
     }
@@ -295,10 +405,15 @@ class ColumnPredicate {
       hash_algorithm_ = hash_algorithm;
     }
 
+    void set_layout(BloomFilterLayout layout) {
+      layout_ = layout;
+    }
+
     bool operator==(const BloomFilterInner& other) const {
       return (bloom_data_ == other.bloom_data() &&
               nhash_ == other.nhash() &&
-              hash_algorithm_ == other.hash_algorithm());
+              hash_algorithm_ == other.hash_algorithm() &&
+              layout_ == other.layout());
     }
 
    private:
@@ -311,6 +426,9 @@ class ColumnPredicate {
 
     // The hash algorithm used in bloom filter.
     HashAlgorithm hash_algorithm_;
+
+    // The layout of the bits of the bloom filter.
+    BloomFilterLayout layout_;
   };
 
  private:
@@ -335,6 +453,11 @@ class ColumnPredicate {
                   const void* lower,
                   const void* upper);
 
+  // Creates a new Like column predicate.
+  ColumnPredicate(PredicateType predicate_type,
+                  ColumnSchema column,
+                  std::vector<std::shared_ptr<const LikePattern>>* patterns);
+
   // Transition to a None predicate type.
   void SetToNone();
 
@@ -359,6 +482,13 @@ class ColumnPredicate {
   // Merge another predicate into this InList predicate.
   void MergeIntoInList(const ColumnPredicate& other);
 
+  // Merge another predicate into this Like predicate.
+  void MergeIntoLike(const ColumnPredicate& other);
+
+  // Replace this predicate with the merge of it into the Like predicate
+  // 'like', which is equivalent since merging is commutative.
+  void MergeIntoOtherLike(const ColumnPredicate& like);
+
   // Templated evaluation to inline the dispatch of comparator. Templating this
   // allows dispatch to occur only once per batch.
   template <DataType PhysicalType>
@@ -379,7 +509,7 @@ class ColumnPredicate {
     Slice cell_slice(reinterpret_cast<const uint8_t*>(data), size);
     for (const auto& bf : bloom_filters_) {
       BloomKeyProbe probe(cell_slice, bf.hash_algorithm());
-      if (!BloomFilter(bf.bloom_data(), bf.nhash()).MayContainKey(probe)) {
+      if (!BloomFilter(bf.bloom_data(), bf.nhash(), bf.layout()).MayContainKey(probe)) {
         return false;
       }
     }
@@ -397,6 +527,23 @@ class ColumnPredicate {
     return true;
   }
 
+  // Evaluate the patterns, bounds and bloom filters of a Like predicate on a
+  // single cell.
+  template <DataType PhysicalType>
+  bool EvaluateCellForLike(const void* cell) const {
+    DCHECK_EQ(BINARY, PhysicalType);
+    if (!EvaluateCellForBloomFilter<PhysicalType>(cell)) {
+      return false;
+    }
+    const Slice* value = reinterpret_cast<const Slice*>(cell);
+    for (const auto& pattern : like_patterns_) {
+      if (!pattern->Matches(*value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   // For a Range type predicate, this helper function checks
   // whether a given value is in the range.
   bool CheckValueInRange(const void* value) const;
@@ -405,10 +552,22 @@ class ColumnPredicate {
   // whether a given value is in the list.
   bool CheckValueInList(const void* value) const;
 
-  // For an BloomFilter type predicate, this helper function checks
-  // whether a given value is in the BloomFilter.
+  // For an BloomFilter or Like type predicate, this helper function checks
+  // whether a given value is in the BloomFilter and matches the patterns.
   bool CheckValueInBloomFilter(const void* value) const;
 
+  // Returns the InListHashSet key of a cell of the given type.
+  template <DataType PhysicalType>
+  static uint64_t InListHashKey(const void* cell) {
+    return InListHashSet::KeyOf(
+        *static_cast<const typename DataTypeTraits<PhysicalType>::cpp_type*>(cell));
+  }
+
+  // For an InList type predicate over an integer column with at least
+  // InListHashSet::kMinValues values, builds 'in_list_hash_set_'; otherwise
+  // resets it.
+  void MaybeBuildInListHashSet();
+
   // The type of this predicate.
   PredicateType predicate_type_;
 
@@ -425,8 +584,16 @@ class ColumnPredicate {
   // The list of values to check column against if this is an InList predicate.
   std::vector<const void*> values_;
 
+  // The values as a hash set, if this is an InList predicate which is
+  // evaluated with one. Immutable, and so shared by copies of the predicate.
+  std::shared_ptr<const InListHashSet> in_list_hash_set_;
+
   // The list of bloom filter in this predicate.
   std::vector<BloomFilterInner> bloom_filters_;
+
+  // The LIKE patterns to match if this is a Like predicate. Immutable, and so
+  // shared by copies of the predicate.
+  std::vector<std::shared_ptr<const LikePattern>> like_patterns_;
 };
 
 // Compares predicates according to selectivity. Predicates that match fewer
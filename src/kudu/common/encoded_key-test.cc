@@ -19,12 +19,14 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "kudu/common/schema.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
+#include "kudu/common/row.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/strings/substitute.h" // IWYU pragma: keep
 #include "kudu/util/faststring.h"
@@ -38,6 +40,7 @@
 #include "kudu/util/test_macros.h"
 
 using std::string;
+using std::vector;
 
 namespace kudu {
 
@@ -266,6 +269,67 @@ TEST_F(EncodedKeyTest, TestConstructFromEncodedString) {
   }
 }
 
+// Test that the ways of encoding a row's key agree with encoding it column
+// by column, for schemas with both fixed-size and variable-size keys.
+TEST_F(EncodedKeyTest, TestEncodeRowKeys) {
+  Random r(SeedRandom());
+  const vector<Schema> schemas = {
+    Schema({ ColumnSchema("key0", INT16),
+             ColumnSchema("key1", UINT32),
+             ColumnSchema("key2", INT64) }, 3),
+    Schema({ ColumnSchema("key0", INT32),
+             ColumnSchema("key1", STRING),
+             ColumnSchema("key2", STRING) }, 3),
+  };
+  Arena arena(1024);
+  char buf[40];
+  for (const Schema& schema : schemas) {
+    SCOPED_TRACE(schema.ToString());
+    for (int i = 0; i < 1000; i++) {
+      RowBuilder rb(schema);
+      for (int col = 0; col < schema.num_columns(); col++) {
+        switch (schema.column(col).type_info()->type()) {
+          case INT16: rb.AddInt16(r.Next32()); break;
+          case UINT32: rb.AddUint32(r.Next32()); break;
+          case INT32: rb.AddInt32(r.Next32()); break;
+          case INT64: rb.AddInt64(r.Next64()); break;
+          case STRING: {
+            // Include '\0' bytes, which composite keys must escape.
+            int len = r.Uniform(sizeof(buf));
+            for (int j = 0; j < len; j++) {
+              buf[j] = r.OneIn(8) ? '\0' : 'a' + r.Uniform(26);
+            }
+            rb.AddString(Slice(buf, len));
+            break;
+          }
+          default: FAIL() << "unexpected type";
+        }
+      }
+      ConstContiguousRow row = rb.row();
+
+      EncodedKeyBuilder builder(&schema);
+      for (int col = 0; col < schema.num_key_columns(); col++) {
+        builder.AddColumnKey(row.cell_ptr(col));
+      }
+      gscoped_ptr<EncodedKey> expected(builder.BuildEncodedKey());
+
+      faststring encoded;
+      ASSERT_EQ(expected->encoded_key(), schema.EncodeComparableKey(row, &encoded));
+
+      Slice arena_encoded;
+      ASSERT_OK(schema.EncodeComparableKey(row, &arena, &arena_encoded));
+      ASSERT_EQ(expected->encoded_key(), arena_encoded);
+
+      gscoped_ptr<EncodedKey> from_row;
+      ASSERT_OK(EncodedKey::FromContiguousRow(row, &arena, &from_row));
+      ASSERT_EQ(expected->encoded_key(), from_row->encoded_key());
+      ASSERT_EQ(schema.num_key_columns(), from_row->raw_keys().size());
+      ASSERT_EQ(expected->encoded_key(), from_row->Copy()->encoded_key());
+      ASSERT_EQ(expected->encoded_key(), EncodedKey::FromContiguousRow(row)->encoded_key());
+    }
+  }
+}
+
 // Test encoding random strings and ensure that the decoded string
 // matches the input.
 TEST_F(EncodedKeyTest, TestRandomStringEncoding) {
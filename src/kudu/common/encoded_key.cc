@@ -50,13 +50,54 @@ EncodedKey::EncodedKey(faststring* data,
   raw_keys_.swap(*raw_keys);
 }
 
+EncodedKey::EncodedKey(const Slice& data,
+                       vector<const void *> *raw_keys,
+                       size_t num_key_cols)
+  : num_key_cols_(num_key_cols),
+    encoded_key_(data) {
+  DCHECK_LE(raw_keys->size(), num_key_cols);
+
+  raw_keys_.swap(*raw_keys);
+}
+
+namespace {
+vector<const void*> RawKeys(const ConstContiguousRow& row) {
+  vector<const void*> raw_keys(row.schema()->num_key_columns());
+  for (int i = 0; i < raw_keys.size(); i++) {
+    raw_keys[i] = row.cell_ptr(i);
+  }
+  return raw_keys;
+}
+} // anonymous namespace
+
 gscoped_ptr<EncodedKey> EncodedKey::FromContiguousRow(const ConstContiguousRow& row) {
-  EncodedKeyBuilder kb(row.schema());
-  for (int i = 0; i < row.schema()->num_key_columns(); i++) {
-    kb.AddColumnKey(row.cell_ptr(i));
+  const Schema* schema = row.schema();
+  if (schema->num_key_columns() == 0) {
+    return gscoped_ptr<EncodedKey>();
   }
-  return make_gscoped_ptr(kb.BuildEncodedKey());
+  faststring buf(schema->key_byte_size());
+  schema->EncodeComparableKey(row, &buf);
+  vector<const void*> raw_keys = RawKeys(row);
+  return gscoped_ptr<EncodedKey>(new EncodedKey(&buf, &raw_keys, schema->num_key_columns()));
+}
+
+Status EncodedKey::FromContiguousRow(const ConstContiguousRow& row,
+                                     Arena* arena,
+                                     gscoped_ptr<EncodedKey>* result) {
+  const Schema* schema = row.schema();
+  DCHECK_GT(schema->num_key_columns(), 0);
+  Slice encoded;
+  RETURN_NOT_OK(schema->EncodeComparableKey(row, arena, &encoded));
+  vector<const void*> raw_keys = RawKeys(row);
+  result->reset(new EncodedKey(encoded, &raw_keys, schema->num_key_columns()));
+  return Status::OK();
+}
 
+gscoped_ptr<EncodedKey> EncodedKey::Copy() const {
+  faststring data;
+  data.assign_copy(encoded_key_.data(), encoded_key_.size());
+  vector<const void*> raw_keys(raw_keys_);
+  return gscoped_ptr<EncodedKey>(new EncodedKey(&data, &raw_keys, num_key_cols_));
 }
 
 Status EncodedKey::DecodeEncodedString(const Schema& schema,
@@ -46,8 +46,25 @@ class EncodedKey {
              std::vector<const void *> *raw_keys,
              size_t num_key_cols);
 
+  // Like the above, but refers to the encoded key in 'data' rather than
+  // taking it over. 'data' must remain valid for the lifetime of this
+  // object.
+  EncodedKey(const Slice& data,
+             std::vector<const void *> *raw_keys,
+             size_t num_key_cols);
+
   static gscoped_ptr<EncodedKey> FromContiguousRow(const ConstContiguousRow& row);
 
+  // Like the above, but encodes the key into memory allocated from 'arena',
+  // which must outlive the returned key.
+  static Status FromContiguousRow(const ConstContiguousRow& row,
+                                  Arena* arena,
+                                  gscoped_ptr<EncodedKey>* result);
+
+  // Returns a copy of this key which owns its encoded data. The raw keys
+  // still refer to the same memory as this key's.
+  gscoped_ptr<EncodedKey> Copy() const;
+
   // Decode the encoded key specified in 'encoded', which must correspond to the
   // provided schema.
   // The returned row data is allocated from 'arena' and returned in '*result'.
@@ -40,12 +40,14 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/port.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(num_lists, 3, "Number of lists to merge");
 DEFINE_int32(num_rows, 1000, "Number of entries per list");
@@ -247,6 +249,101 @@ TEST(TestMergeIterator, TestMergePredicate2) {
   TestMerge(predicate);
 }
 
+// Test merging inputs made of runs of consecutive keys, which exercises the
+// paths copying runs and whole blocks of rows without merging them row by row.
+TEST(TestMergeIterator, TestMergeRuns) {
+  const int kNumLists = 5;
+  const int kRunLength = 25;
+  const uint32_t kNumRows = 5000;
+  vector<vector<uint32_t>> lists(kNumLists);
+  for (uint32_t i = 0; i < kNumRows; i++) {
+    lists[(i / kRunLength) % kNumLists].push_back(i);
+  }
+  vector<shared_ptr<RowwiseIterator>> to_merge;
+  for (const auto& ints : lists) {
+    shared_ptr<VectorIterator> it(new VectorIterator(ints));
+    // Blocks don't line up with the runs.
+    it->set_block_size(10);
+    to_merge.emplace_back(new MaterializingIterator(it));
+  }
+
+  MergeIterator merger(kIntSchema, to_merge);
+  ASSERT_OK(merger.Init(nullptr));
+  RowBlock dst(kIntSchema, 64, nullptr);
+  uint32_t expected = 0;
+  while (merger.HasNext()) {
+    ASSERT_OK(merger.NextBlock(&dst));
+    ASSERT_GT(dst.nrows(), 0);
+    for (int i = 0; i < dst.nrows(); i++) {
+      ASSERT_EQ(expected++, *kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+    }
+  }
+  ASSERT_EQ(kNumRows, expected);
+}
+
+// Test that a parallel union returns every row of its inputs which passes the
+// predicate exactly once, with a queue small enough that the workers stop and
+// resume reading, and blocks which are consumed in several calls.
+TEST(TestParallelUnionIterator, TestParallelUnion) {
+  gscoped_ptr<ThreadPool> pool;
+  ASSERT_OK(ThreadPoolBuilder("scan").set_max_threads(4).Build(&pool));
+
+  const int kNumLists = 8;
+  const uint32_t kRowsPerList = 5000;
+  TestIntRangePredicate predicate(kRowsPerList, MathLimits<uint32_t>::kMax);
+  ScanSpec spec;
+  spec.AddPredicate(predicate.pred_);
+
+  vector<shared_ptr<RowwiseIterator>> to_union;
+  vector<uint32_t> expected;
+  for (int i = 0; i < kNumLists; i++) {
+    vector<uint32_t> ints;
+    for (uint32_t j = 0; j < kRowsPerList; j++) {
+      ints.push_back(i * kRowsPerList + j);
+    }
+    if (i > 0) {
+      expected.insert(expected.end(), ints.begin(), ints.end());
+    }
+    shared_ptr<VectorIterator> it(new VectorIterator(std::move(ints)));
+    it->set_block_size(1000);
+    to_union.emplace_back(new MaterializingIterator(it));
+  }
+
+  ParallelUnionIterator iter(to_union, pool.get(), 3, 2);
+  ASSERT_OK(iter.Init(&spec));
+  ASSERT_TRUE(spec.predicates().empty());
+  RowBlock dst(kIntSchema, 100, nullptr);
+  vector<uint32_t> results;
+  while (iter.HasNext()) {
+    ASSERT_OK(iter.NextBlock(&dst));
+    ASSERT_GT(dst.nrows(), 0);
+    for (int i = 0; i < dst.nrows(); i++) {
+      results.push_back(*kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+    }
+  }
+  std::sort(results.begin(), results.end());
+  ASSERT_EQ(expected, results);
+}
+
+// Test that a parallel union can be destroyed before it's been fully consumed.
+TEST(TestParallelUnionIterator, TestDestroyWhileReading) {
+  gscoped_ptr<ThreadPool> pool;
+  ASSERT_OK(ThreadPoolBuilder("scan").set_max_threads(4).Build(&pool));
+
+  vector<shared_ptr<RowwiseIterator>> to_union;
+  for (int i = 0; i < 4; i++) {
+    shared_ptr<VectorIterator> it(new VectorIterator(vector<uint32_t>(10000, i)));
+    it->set_block_size(100);
+    to_union.emplace_back(new MaterializingIterator(it));
+  }
+  ParallelUnionIterator iter(to_union, pool.get(), 4, 1);
+  ASSERT_OK(iter.Init(nullptr));
+  RowBlock dst(kIntSchema, 10, nullptr);
+  ASSERT_TRUE(iter.HasNext());
+  ASSERT_OK(iter.NextBlock(&dst));
+  ASSERT_EQ(10, dst.nrows());
+}
+
 // Test that the MaterializingIterator properly evaluates predicates when they apply
 // to single columns.
 TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
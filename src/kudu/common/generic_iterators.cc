@@ -36,12 +36,16 @@
 #include "kudu/common/iterator_stats.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/threadpool.h"
 
 using std::get;
 using std::move;
@@ -95,11 +99,17 @@ class MergeIterState {
       num_valid_(0)
   {}
 
-  const RowBlockRow& next_row() {
+  const RowBlockRow& next_row() const {
     DCHECK_LT(num_advanced_, num_valid_);
     return next_row_;
   }
 
+  // The last selected row of the current block.
+  const RowBlockRow& last_row() const {
+    DCHECK_LT(num_advanced_, num_valid_);
+    return last_row_;
+  }
+
   Status Advance() {
     num_advanced_++;
     if (IsBlockExhausted()) {
@@ -108,13 +118,10 @@ class MergeIterState {
     } else {
       // Seek to the next selected row.
       SelectionVector *selection = read_block_.selection_vector();
-      for (++next_row_idx_; next_row_idx_ < read_block_.nrows(); next_row_idx_++) {
-        if (selection->IsRowSelected(next_row_idx_)) {
-          next_row_.Reset(&read_block_, next_row_idx_);
-          break;
-        }
-      }
-      DCHECK_NE(next_row_idx_, read_block_.nrows()+1) << "No selected rows found!";
+      bool found = BitmapFindFirstSet(selection->bitmap(), next_row_idx_ + 1,
+                                      read_block_.nrows(), &next_row_idx_);
+      DCHECK(found) << "No selected rows found!";
+      next_row_.Reset(&read_block_, next_row_idx_);
       return Status::OK();
     }
   }
@@ -140,12 +147,16 @@ class MergeIterState {
       DCHECK_LE(selection->CountSelected(), read_block_.nrows());
       num_valid_ = selection->CountSelected();
       VLOG(2) << selection->CountSelected() << "/" << read_block_.nrows() << " rows selected";
-      // Seek next_row_ to the first selected row.
-      for (next_row_idx_ = 0; next_row_idx_ < read_block_.nrows(); next_row_idx_++) {
-        if (selection->IsRowSelected(next_row_idx_)) {
-          next_row_.Reset(&read_block_, next_row_idx_);
-          return Status::OK();
+      // Seek next_row_ to the first selected row, and last_row_ to the last.
+      if (BitmapFindFirstSet(selection->bitmap(), 0, read_block_.nrows(), &next_row_idx_)) {
+        next_row_.Reset(&read_block_, next_row_idx_);
+        for (size_t i = read_block_.nrows(); i-- > next_row_idx_;) {
+          if (selection->IsRowSelected(i)) {
+            last_row_.Reset(&read_block_, i);
+            break;
+          }
         }
+        return Status::OK();
       }
       // The block may have had no selected rows, in which case we need to continue
       // to the next block.
@@ -170,6 +181,8 @@ class MergeIterState {
   RowBlock read_block_;
   // The row currently pointed to by the iterator.
   RowBlockRow next_row_;
+  // The last selected row of read_block_.
+  RowBlockRow last_row_;
   // Row index of next_row_ in read_block_.
   size_t next_row_idx_;
   // Number of rows we've advanced past in the current RowBlock.
@@ -178,6 +191,26 @@ class MergeIterState {
   size_t num_valid_;
 };
 
+namespace {
+
+// Orders MergeIterStates by their next row, such that the std heap functions
+// keep the MergeIterState with the smallest next row at the front.
+class MergeIterStateGreater {
+ public:
+  explicit MergeIterStateGreater(const Schema& schema)
+      : schema_(schema) {
+  }
+
+  bool operator()(const MergeIterState* a, const MergeIterState* b) const {
+    return schema_.Compare(a->next_row(), b->next_row()) > 0;
+  }
+
+ private:
+  const Schema& schema_;
+};
+
+} // anonymous namespace
+
 
 MergeIterator::MergeIterator(
     const Schema& schema,
@@ -212,6 +245,11 @@ Status MergeIterator::Init(ScanSpec *spec) {
       }),
       iters_.end());
 
+  for (const unique_ptr<MergeIterState>& state : iters_) {
+    heap_.push_back(state.get());
+  }
+  std::make_heap(heap_.begin(), heap_.end(), MergeIterStateGreater(schema_));
+
   initted_ = true;
   return Status::OK();
 }
@@ -270,38 +308,45 @@ Status MergeIterator::MaterializeBlock(RowBlock *dst) {
   // Initialize the selection vector.
   // MergeIterState only returns selected rows.
   dst->selection_vector()->SetAllTrue();
-  for (size_t dst_row_idx = 0; dst_row_idx < dst->nrows(); dst_row_idx++) {
-    RowBlockRow dst_row = dst->row(dst_row_idx);
-
-    // Find the sub-iterator which is currently smallest
-    MergeIterState *smallest = nullptr;
-    ssize_t smallest_idx = -1;
-
-    // Typically the number of iters_ is not that large, so using a priority
-    // queue is not worth it
-    for (size_t i = 0; i < iters_.size(); i++) {
-      unique_ptr<MergeIterState> &state = iters_[i];
-
-      if (smallest == nullptr ||
-          schema_.Compare(state->next_row(), smallest->next_row()) < 0) {
-        smallest = state.get();
-        smallest_idx = i;
-      }
-    }
-
-    // If no iterators had any row left, then we're done iterating.
-    if (PREDICT_FALSE(smallest == nullptr)) break;
-
-    // Otherwise, copy the row from the smallest one, and advance it
-    RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
-    RETURN_NOT_OK(smallest->Advance());
+  const MergeIterStateGreater greater(schema_);
+  size_t dst_row_idx = 0;
+  while (dst_row_idx < dst->nrows() && !heap_.empty()) {
+    // Take the sub-iterator which is currently smallest out of the heap.
+    std::pop_heap(heap_.begin(), heap_.end(), greater);
+    MergeIterState* smallest = heap_.back();
+    heap_.pop_back();
+    const MergeIterState* runner_up = heap_.empty() ? nullptr : heap_.front();
+
+    // Copy the run of rows of the smallest sub-iterator which sort before
+    // the next row of every other sub-iterator. When that's the case of the
+    // whole remainder of its block, which is common with few overlapping
+    // sub-iterators, the rows are copied without any comparison.
+    const bool whole_block = runner_up == nullptr ||
+        schema_.Compare(smallest->last_row(), runner_up->next_row()) < 0;
+    bool block_exhausted;
+    do {
+      RowBlockRow dst_row = dst->row(dst_row_idx++);
+      RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
+      // Rows of the next block need to be compared again.
+      block_exhausted = smallest->remaining_in_block() == 1;
+      RETURN_NOT_OK(smallest->Advance());
+    } while (!block_exhausted && dst_row_idx < dst->nrows() &&
+             (whole_block || schema_.Compare(smallest->next_row(),
+                                             runner_up->next_row()) < 0));
 
     if (smallest->IsFullyExhausted()) {
       std::lock_guard<rw_spinlock> l(iters_lock_);
       AddIterStats(*smallest->iter(), &finished_iter_stats_by_col_);
-      iters_.erase(iters_.begin() + smallest_idx);
+      iters_.erase(std::find_if(iters_.begin(), iters_.end(),
+                                [&](const unique_ptr<MergeIterState>& state) {
+                                  return state.get() == smallest;
+                                }));
+    } else {
+      heap_.push_back(smallest);
+      std::push_heap(heap_.begin(), heap_.end(), greater);
     }
   }
+  DCHECK_EQ(dst_row_idx, dst->nrows());
 
   return Status::OK();
 }
@@ -442,6 +487,252 @@ void UnionIterator::GetIteratorStats(std::vector<IteratorStats>* stats) const {
   }
 }
 
+////////////////////////////////////////////////////////////
+// Parallel union iterator
+////////////////////////////////////////////////////////////
+
+namespace {
+// The number of rows of each block read by a ParallelUnionIterator worker.
+const size_t kParallelUnionRowsPerBlock = 1024;
+} // anonymous namespace
+
+struct ParallelUnionIterator::Batch {
+  explicit Batch(const Schema& schema)
+      : arena(32 * 1024),
+        block(schema, kParallelUnionRowsPerBlock, &arena) {
+  }
+
+  Arena arena;
+  RowBlock block;
+};
+
+ParallelUnionIterator::ParallelUnionIterator(vector<shared_ptr<RowwiseIterator>> iters,
+                                             ThreadPool* pool,
+                                             int parallelism,
+                                             int max_queued_blocks)
+  : parallelism_(parallelism),
+    max_queued_blocks_(max_queued_blocks),
+    pool_(CHECK_NOTNULL(pool)),
+    initted_(false),
+    iters_(std::move(iters)),
+    cond_(&lock_),
+    num_running_workers_(0),
+    stopped_(false),
+    current_row_idx_(0) {
+  CHECK_GT(iters_.size(), 0);
+  CHECK_GT(parallelism_, 0);
+  CHECK_GT(max_queued_blocks_, 0);
+}
+
+ParallelUnionIterator::~ParallelUnionIterator() {
+  MutexLock l(lock_);
+  stopped_ = true;
+  while (num_running_workers_ > 0) {
+    cond_.Wait();
+  }
+}
+
+Status ParallelUnionIterator::Init(ScanSpec *spec) {
+  CHECK(!initted_);
+
+  for (shared_ptr<RowwiseIterator> &iter : iters_) {
+    ScanSpec *spec_copy = spec != nullptr ? scan_spec_copies_.Construct(*spec) : nullptr;
+    RETURN_NOT_OK(PredicateEvaluatingIterator::InitAndMaybeWrap(&iter, spec_copy));
+  }
+  // Since we handle predicates in all the wrapped iterators, we can clear
+  // them here.
+  if (spec != nullptr) {
+    spec->RemovePredicates();
+  }
+
+  schema_.reset(new Schema(iters_.front()->schema()));
+  for (const shared_ptr<RowwiseIterator> &iter : iters_) {
+    if (!iter->schema().Equals(*schema_)) {
+      return Status::InvalidArgument(
+        string("Schemas do not match: ") + schema_->ToString()
+        + " vs " + iter->schema().ToString());
+    }
+  }
+  finished_iter_stats_by_col_.resize(schema_->num_columns());
+  initted_ = true;
+
+  // Start reading right away, so that the first blocks are ready by the time
+  // they're asked for.
+  MutexLock l(lock_);
+  for (size_t i = 0; i < iters_.size(); i++) {
+    pending_iters_.push_back(i);
+  }
+  ScheduleWorkersUnlocked();
+  return status_;
+}
+
+void ParallelUnionIterator::ScheduleWorkersUnlocked() {
+  for (size_t i = 0;
+       i < pending_iters_.size() && num_running_workers_ < parallelism_ &&
+       queue_.size() < max_queued_blocks_ && status_.ok();
+       i++) {
+    Status s = pool_->SubmitFunc([this]() { this->RunWorker(); });
+    if (PREDICT_FALSE(!s.ok())) {
+      status_ = s.CloneAndPrepend("unable to schedule scan of sub-iterator");
+      return;
+    }
+    num_running_workers_++;
+  }
+}
+
+void ParallelUnionIterator::RunWorker() {
+  shared_ptr<RowwiseIterator> iter;
+  size_t iter_idx = 0;
+  MutexLock l(lock_);
+  while (true) {
+    bool should_stop = stopped_ || !status_.ok() || queue_.size() >= max_queued_blocks_;
+    if (!iter) {
+      if (should_stop || pending_iters_.empty()) {
+        break;
+      }
+      iter_idx = pending_iters_.front();
+      pending_iters_.pop_front();
+      iter = iters_[iter_idx];
+    } else if (should_stop) {
+      // Leave the rest of the sub-iterator to a worker scheduled once the
+      // queue has been drained.
+      pending_iters_.push_front(iter_idx);
+      break;
+    }
+
+    // Read the next block outside of the lock.
+    unique_ptr<Batch> batch;
+    Status s;
+    l.Unlock();
+    bool has_next = iter->HasNext();
+    if (has_next) {
+      batch.reset(new Batch(*schema_));
+      s = iter->NextBlock(&batch->block);
+    }
+    l.Lock();
+
+    if (PREDICT_FALSE(!s.ok())) {
+      if (status_.ok()) {
+        status_ = s;
+      }
+      break;
+    }
+    if (!has_next) {
+      AddIterStats(*iter, &finished_iter_stats_by_col_);
+      iters_[iter_idx].reset();
+      iter.reset();
+      continue;
+    }
+    if (batch->block.selection_vector()->AnySelected()) {
+      queue_.push_back(std::move(batch));
+      cond_.Signal();
+    }
+  }
+  iter.reset();
+  num_running_workers_--;
+  cond_.Signal();
+}
+
+Status ParallelUnionIterator::FetchBatch() {
+  current_.reset();
+  current_row_idx_ = 0;
+
+  MutexLock l(lock_);
+  while (queue_.empty()) {
+    RETURN_NOT_OK(status_);
+    ScheduleWorkersUnlocked();
+    if (num_running_workers_ == 0) {
+      // Either every sub-iterator has been consumed, or no worker could be
+      // scheduled to read the remaining ones.
+      RETURN_NOT_OK(status_);
+      DCHECK(pending_iters_.empty());
+      return Status::OK();
+    }
+    cond_.Wait();
+  }
+  current_ = std::move(queue_.front());
+  queue_.pop_front();
+
+  // Resume reading if the workers stopped because the queue was full.
+  ScheduleWorkersUnlocked();
+  return Status::OK();
+}
+
+bool ParallelUnionIterator::HasNext() const {
+  CHECK(initted_);
+  if (current_ || !deferred_status_.ok()) {
+    return true;
+  }
+  // Whether there's a next row is only known once the next block has been
+  // read, so look ahead at it.
+  ParallelUnionIterator* self = const_cast<ParallelUnionIterator*>(this);
+  Status s = self->FetchBatch();
+  if (PREDICT_FALSE(!s.ok())) {
+    // Let the next call to NextBlock() return the error.
+    self->deferred_status_ = s;
+    return true;
+  }
+  return current_ != nullptr;
+}
+
+Status ParallelUnionIterator::NextBlock(RowBlock* dst) {
+  CHECK(initted_);
+  if (dst->arena()) {
+    dst->arena()->Reset();
+  }
+  RETURN_NOT_OK(deferred_status_);
+  if (!current_) {
+    RETURN_NOT_OK(FetchBatch());
+    if (!current_) {
+      dst->Resize(0);
+      return Status::OK();
+    }
+  }
+
+  // Copy the selected rows of the current block, as many as fit.
+  const RowBlock& src = current_->block;
+  const SelectionVector* src_sel = src.selection_vector();
+  dst->Resize(dst->row_capacity());
+  size_t dst_row_idx = 0;
+  size_t src_row_idx;
+  while (dst_row_idx < dst->nrows() &&
+         BitmapFindFirstSet(src_sel->bitmap(), current_row_idx_, src.nrows(), &src_row_idx)) {
+    RowBlockRow dst_row = dst->row(dst_row_idx++);
+    RETURN_NOT_OK(CopyRow(src.row(src_row_idx), &dst_row, dst->arena()));
+    current_row_idx_ = src_row_idx + 1;
+  }
+  dst->Resize(dst_row_idx);
+  dst->selection_vector()->SetAllTrue();
+
+  // Skip any trailing unselected rows, so that HasNext() doesn't return true
+  // for a block with no rows left to return.
+  if (!BitmapFindFirstSet(src_sel->bitmap(), current_row_idx_, src.nrows(), &src_row_idx)) {
+    current_row_idx_ = src.nrows();
+  } else {
+    current_row_idx_ = src_row_idx;
+  }
+  if (current_row_idx_ == src.nrows()) {
+    current_.reset();
+  }
+  return Status::OK();
+}
+
+string ParallelUnionIterator::ToString() const {
+  return strings::Substitute("ParallelUnion($0 iters, parallelism $1)",
+                             iters_.size(), parallelism_);
+}
+
+void ParallelUnionIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  CHECK(initted_);
+  MutexLock l(lock_);
+  *stats = finished_iter_stats_by_col_;
+  for (const shared_ptr<RowwiseIterator>& iter : iters_) {
+    if (iter) {
+      AddIterStats(*iter, stats);
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////
 // Materializing iterator
 ////////////////////////////////////////////////////////////
@@ -458,6 +749,7 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
   int32_t num_columns = schema().num_columns();
   col_idx_predicates_.clear();
   non_predicate_column_indexes_.clear();
+  predicate_eval_nanos_.assign(num_columns, 0);
 
   if (spec != nullptr && !disallow_pushdown_for_tests_) {
     col_idx_predicates_.reserve(spec->predicates().size());
@@ -505,6 +797,15 @@ bool MaterializingIterator::HasNext() const {
   return iter_->HasNext();
 }
 
+void MaterializingIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  iter_->GetIteratorStats(stats);
+  ANNOTATE_IGNORE_READS_BEGIN();
+  for (int i = 0; i < predicate_eval_nanos_.size(); i++) {
+    (*stats)[i].predicate_eval_nanos += predicate_eval_nanos_[i];
+  }
+  ANNOTATE_IGNORE_READS_END();
+}
+
 Status MaterializingIterator::NextBlock(RowBlock* dst) {
   size_t n = dst->row_capacity();
   if (dst->arena()) {
@@ -545,7 +846,10 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
     }
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
     if (ctx.DecoderEvalNotSupported()) {
+      const MonoTime eval_start = MonoTime::Now();
       get<1>(col_pred).Evaluate(dst_col, dst->selection_vector());
+      predicate_eval_nanos_[get<0>(col_pred)] +=
+          (MonoTime::Now() - eval_start).ToNanoseconds();
     }
 
     // If after evaluating this predicate the entire row block has been filtered
@@ -610,6 +914,7 @@ Status PredicateEvaluatingIterator::Init(ScanSpec *spec) {
     col_predicates_.emplace_back(predicate.second);
   }
   spec->RemovePredicates();
+  predicate_eval_nanos_.assign(schema().num_columns(), 0);
 
   // Sort the predicates by selectivity so that the most selective are evaluated
   // earlier, with ties broken by the column index.
@@ -628,6 +933,15 @@ bool PredicateEvaluatingIterator::HasNext() const {
   return base_iter_->HasNext();
 }
 
+void PredicateEvaluatingIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  base_iter_->GetIteratorStats(stats);
+  ANNOTATE_IGNORE_READS_BEGIN();
+  for (int i = 0; i < predicate_eval_nanos_.size(); i++) {
+    (*stats)[i].predicate_eval_nanos += predicate_eval_nanos_[i];
+  }
+  ANNOTATE_IGNORE_READS_END();
+}
+
 Status PredicateEvaluatingIterator::NextBlock(RowBlock *dst) {
   RETURN_NOT_OK(base_iter_->NextBlock(dst));
 
@@ -636,7 +950,9 @@ Status PredicateEvaluatingIterator::NextBlock(RowBlock *dst) {
     if (col_idx == Schema::kColumnNotFound) {
       return Status::InvalidArgument("Unknown column in predicate", predicate.ToString());
     }
+    const MonoTime eval_start = MonoTime::Now();
     predicate.Evaluate(dst->column_block(col_idx), dst->selection_vector());
+    predicate_eval_nanos_[col_idx] += (MonoTime::Now() - eval_start).ToNanoseconds();
 
     // If after evaluating this predicate, the entire row block has now been
     // filtered out, we don't need to evaluate any further predicates.
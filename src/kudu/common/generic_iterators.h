@@ -36,7 +36,9 @@
 #include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/status.h"
 
@@ -44,9 +46,15 @@ namespace kudu {
 
 class MergeIterState;
 class RowBlock;
+class ThreadPool;
 
 // An iterator which merges the results of other iterators, comparing
 // based on keys.
+//
+// The sub-iterators are kept in a heap ordered by their next row, so each
+// output row costs O(log n) comparisons. Runs of rows of one sub-iterator
+// which sort before the next row of all the others are copied with a single
+// comparison per row, or none if they extend to the end of its current block.
 class MergeIterator : public RowwiseIterator {
  public:
   // TODO: clarify whether schema is just the projection, or must include the merge
@@ -87,6 +95,9 @@ class MergeIterator : public RowwiseIterator {
   mutable rw_spinlock iters_lock_;
   std::vector<std::unique_ptr<MergeIterState>> iters_;
 
+  // The sub-iterators in 'iters_', arranged as a min-heap on their next row.
+  std::vector<MergeIterState*> heap_;
+
   // Statistics (keyed by projection column index) accumulated so far by any
   // fully-consumed sub-iterators.
   std::vector<IteratorStats> finished_iter_stats_by_col_;
@@ -168,6 +179,113 @@ class UnionIterator : public RowwiseIterator {
   ObjectPool<ScanSpec> scan_spec_copies_;
 };
 
+// An iterator which unions the results of other iterators, like UnionIterator,
+// but reads from up to 'parallelism' of them at a time on a thread pool. The
+// blocks read by the pool threads are buffered in a queue of at most
+// 'max_queued_blocks' blocks, which NextBlock() drains. The order of the
+// results is unspecified, even between rows of the same sub-iterator.
+//
+// A pool thread stops reading, rather than waiting, when the queue is full, so
+// that a scan which isn't being drained (e.g. a scanner which is waiting for
+// the client's next RPC) doesn't hold any pool thread. The consumer resumes
+// reading when it takes a block from the queue.
+class ParallelUnionIterator : public RowwiseIterator {
+ public:
+  // Construct a parallel union iterator of the given iterators, with the same
+  // requirements as UnionIterator. 'pool' must outlive this iterator.
+  ParallelUnionIterator(std::vector<std::shared_ptr<RowwiseIterator>> iters,
+                        ThreadPool* pool,
+                        int parallelism,
+                        int max_queued_blocks);
+
+  // Waits for the blocks being read by the pool threads.
+  virtual ~ParallelUnionIterator();
+
+  Status Init(ScanSpec *spec) OVERRIDE;
+
+  // May block until a pool thread has read the next block.
+  bool HasNext() const OVERRIDE;
+
+  std::string ToString() const OVERRIDE;
+
+  const Schema &schema() const OVERRIDE {
+    CHECK(initted_);
+    return *CHECK_NOTNULL(schema_.get());
+  }
+
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
+
+  virtual Status NextBlock(RowBlock* dst) OVERRIDE;
+
+ private:
+  struct Batch;
+
+  // Reads blocks from the pending sub-iterators until there are none left,
+  // the queue is full, or the iterator is being destroyed. Runs on 'pool_'.
+  void RunWorker();
+
+  // Submits workers to 'pool_' until 'parallelism_' of them are running, or
+  // there aren't enough pending sub-iterators. 'lock_' must be held.
+  void ScheduleWorkersUnlocked();
+
+  // Makes the next queued block the current one, waiting for it to be read
+  // if necessary. Leaves 'current_' null if all the sub-iterators have been
+  // consumed.
+  Status FetchBatch();
+
+  const int parallelism_;
+  const size_t max_queued_blocks_;
+  ThreadPool* const pool_;
+
+  // Schema: initialized during Init()
+  gscoped_ptr<Schema> schema_;
+  bool initted_;
+
+  // Until Init() is called, the passed-in iterators. Afterwards, the
+  // initialized iterators, each of which is reset once it has been fully
+  // consumed.
+  std::vector<std::shared_ptr<RowwiseIterator>> iters_;
+
+  // Protects the members below, as well as 'iters_' once Init() has returned.
+  mutable Mutex lock_;
+
+  // Signaled when a block is queued or a worker exits.
+  ConditionVariable cond_;
+
+  // The indexes in 'iters_' of the sub-iterators which aren't being read by a
+  // worker and haven't been fully consumed.
+  std::deque<size_t> pending_iters_;
+
+  // The blocks read by the workers which haven't been consumed yet.
+  std::deque<std::unique_ptr<Batch>> queue_;
+
+  // The number of workers which have been submitted to 'pool_' and haven't
+  // exited yet.
+  int num_running_workers_;
+
+  // Set when the iterator is being destroyed, to stop the workers.
+  bool stopped_;
+
+  // The first error hit by a worker or when submitting a worker.
+  Status status_;
+
+  // Statistics (keyed by projection column index) accumulated so far by any
+  // fully-consumed sub-iterators.
+  std::vector<IteratorStats> finished_iter_stats_by_col_;
+
+  // The block being consumed by NextBlock(), only accessed by the consumer
+  // thread, and the position of the next row of it to consume.
+  std::unique_ptr<Batch> current_;
+  size_t current_row_idx_;
+
+  // The first error returned by FetchBatch() from HasNext(), to be returned
+  // by the next call to NextBlock().
+  Status deferred_status_;
+
+  // See UnionIterator::scan_spec_copies_.
+  ObjectPool<ScanSpec> scan_spec_copies_;
+};
+
 // An iterator which wraps a ColumnwiseIterator, materializing it into full rows.
 //
 // Column predicates are pushed down into this iterator. While materializing a
@@ -189,9 +307,7 @@ class MaterializingIterator : public RowwiseIterator {
     return iter_->schema();
   }
 
-  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE {
-    iter_->GetIteratorStats(stats);
-  }
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
   virtual Status NextBlock(RowBlock* dst) OVERRIDE;
 
@@ -210,6 +326,10 @@ class MaterializingIterator : public RowwiseIterator {
   // List of column indexes without predicates to materialize.
   std::vector<int32_t> non_predicate_column_indexes_;
 
+  // The time spent evaluating the predicates of each column which couldn't
+  // be evaluated by the decoders, indexed by column.
+  std::vector<int64_t> predicate_eval_nanos_;
+
   // Set only by test code to disallow pushdown.
   bool disallow_pushdown_for_tests_;
   bool disallow_decoder_eval_;
@@ -244,9 +364,7 @@ class PredicateEvaluatingIterator : public RowwiseIterator {
     return base_iter_->schema();
   }
 
-  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE {
-    base_iter_->GetIteratorStats(stats);
-  }
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
  private:
 
@@ -263,6 +381,10 @@ class PredicateEvaluatingIterator : public RowwiseIterator {
   // List of predicates in order of most to least selective, with
   // ties broken by the column index.
   std::vector<ColumnPredicate> col_predicates_;
+
+  // The time spent evaluating the predicates of each column, indexed by
+  // column.
+  std::vector<int64_t> predicate_eval_nanos_;
 };
 
 } // namespace kudu
@@ -29,18 +29,36 @@ using strings::Substitute;
 IteratorStats::IteratorStats()
     : cells_read(0),
       bytes_read(0),
-      blocks_read(0) {
+      blocks_read(0),
+      bytes_decompressed(0),
+      delta_updates_applied(0),
+      io_nanos(0),
+      decompress_nanos(0),
+      decode_nanos(0),
+      delta_apply_nanos(0),
+      predicate_eval_nanos(0) {
 }
 
 string IteratorStats::ToString() const {
-  return Substitute("cells_read=$0 bytes_read=$1 blocks_read=$2",
-                    cells_read, bytes_read, blocks_read);
+  return Substitute("cells_read=$0 bytes_read=$1 blocks_read=$2 bytes_decompressed=$3 "
+                    "delta_updates_applied=$4 io_nanos=$5 decompress_nanos=$6 "
+                    "decode_nanos=$7 delta_apply_nanos=$8 predicate_eval_nanos=$9",
+                    cells_read, bytes_read, blocks_read, bytes_decompressed,
+                    delta_updates_applied, io_nanos, decompress_nanos, decode_nanos,
+                    delta_apply_nanos, predicate_eval_nanos);
 }
 
 IteratorStats& IteratorStats::operator+=(const IteratorStats& other) {
   cells_read += other.cells_read;
   bytes_read += other.bytes_read;
   blocks_read += other.blocks_read;
+  bytes_decompressed += other.bytes_decompressed;
+  delta_updates_applied += other.delta_updates_applied;
+  io_nanos += other.io_nanos;
+  decompress_nanos += other.decompress_nanos;
+  decode_nanos += other.decode_nanos;
+  delta_apply_nanos += other.delta_apply_nanos;
+  predicate_eval_nanos += other.predicate_eval_nanos;
   DCheckNonNegative();
   return *this;
 }
@@ -49,6 +67,13 @@ IteratorStats& IteratorStats::operator-=(const IteratorStats& other) {
   cells_read -= other.cells_read;
   bytes_read -= other.bytes_read;
   blocks_read -= other.blocks_read;
+  bytes_decompressed -= other.bytes_decompressed;
+  delta_updates_applied -= other.delta_updates_applied;
+  io_nanos -= other.io_nanos;
+  decompress_nanos -= other.decompress_nanos;
+  decode_nanos -= other.decode_nanos;
+  delta_apply_nanos -= other.delta_apply_nanos;
+  predicate_eval_nanos -= other.predicate_eval_nanos;
   DCheckNonNegative();
   return *this;
 }
@@ -69,5 +94,12 @@ void IteratorStats::DCheckNonNegative() const {
   DCHECK_GE(cells_read, 0);
   DCHECK_GE(bytes_read, 0);
   DCHECK_GE(blocks_read, 0);
+  DCHECK_GE(bytes_decompressed, 0);
+  DCHECK_GE(delta_updates_applied, 0);
+  DCHECK_GE(io_nanos, 0);
+  DCHECK_GE(decompress_nanos, 0);
+  DCHECK_GE(decode_nanos, 0);
+  DCHECK_GE(delta_apply_nanos, 0);
+  DCHECK_GE(predicate_eval_nanos, 0);
 }
 } // namespace kudu
@@ -37,6 +37,27 @@ struct IteratorStats {
   // The number of CFile data blocks read from disk (or cache) by the iterator.
   int64_t blocks_read;
 
+  // The number of bytes the iterator decompressed from compressed blocks.
+  int64_t bytes_decompressed;
+
+  // The number of cell updates applied to the column from delta stores.
+  int64_t delta_updates_applied;
+
+  // The wall time, in nanoseconds, spent in each phase of reading the column:
+  //
+  // - io_nanos: reading blocks which missed the block cache, including the
+  //   waits for blocks being read ahead.
+  // - decompress_nanos: decompressing the blocks.
+  // - decode_nanos: decoding the cells of the blocks, including the
+  //   evaluation of the predicates which could be pushed into the decoders.
+  // - delta_apply_nanos: applying the updates of the delta stores.
+  // - predicate_eval_nanos: evaluating the predicates on the decoded cells.
+  int64_t io_nanos;
+  int64_t decompress_nanos;
+  int64_t decode_nanos;
+  int64_t delta_apply_nanos;
+  int64_t predicate_eval_nanos;
+
   // Add statistics contained 'other' to this object (for each field
   // in this object, increment it by the value of the equivalent field
   // in 'other').
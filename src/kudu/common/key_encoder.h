@@ -22,6 +22,7 @@
 #include <smmintrin.h>
 
 #include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <ostream>
@@ -65,6 +66,12 @@ struct KeyEncoderTraits<Type,
 
  private:
   typedef typename DataTypeTraits<Type>::cpp_type cpp_type;
+
+ public:
+  // The size of every encoded value.
+  static const size_t kFixedEncodedSize = sizeof(cpp_type);
+
+ private:
   typedef typename MathLimits<cpp_type>::UnsignedType unsigned_cpp_type;
 
   static unsigned_cpp_type SwapEndian(unsigned_cpp_type x) {
@@ -85,14 +92,7 @@ struct KeyEncoderTraits<Type,
   }
 
   static void Encode(const void* key_ptr, Buffer* dst) {
-    unsigned_cpp_type key_unsigned;
-    memcpy(&key_unsigned, key_ptr, sizeof(key_unsigned));
-
-    // To encode signed integers, swap the MSB.
-    if (MathLimits<cpp_type>::kIsSigned) {
-      key_unsigned ^= static_cast<unsigned_cpp_type>(1) << (sizeof(key_unsigned) * CHAR_BIT - 1);
-    }
-    key_unsigned = SwapEndian(key_unsigned);
+    unsigned_cpp_type key_unsigned = EncodedValue(key_ptr);
     dst->append(reinterpret_cast<const char*>(&key_unsigned), sizeof(key_unsigned));
   }
 
@@ -100,6 +100,16 @@ struct KeyEncoderTraits<Type,
     Encode(key, dst);
   }
 
+  static size_t MaxEncodedSize(const void* /*key*/, bool /*is_last*/) {
+    return sizeof(cpp_type);
+  }
+
+  static uint8_t* EncodeToBuffer(const void* key, bool /*is_last*/, uint8_t* dst) {
+    unsigned_cpp_type key_unsigned = EncodedValue(key);
+    memcpy(dst, &key_unsigned, sizeof(key_unsigned));
+    return dst + sizeof(key_unsigned);
+  }
+
   static Status DecodeKeyPortion(Slice* encoded_key,
                                  bool /*is_last*/,
                                  Arena* /*arena*/,
@@ -118,6 +128,19 @@ struct KeyEncoderTraits<Type,
     encoded_key->remove_prefix(sizeof(cpp_type));
     return Status::OK();
   }
+
+ private:
+  // Returns the big-endian, sign-flipped representation of '*key_ptr'.
+  static unsigned_cpp_type EncodedValue(const void* key_ptr) {
+    unsigned_cpp_type key_unsigned;
+    memcpy(&key_unsigned, key_ptr, sizeof(key_unsigned));
+
+    // To encode signed integers, swap the MSB.
+    if (MathLimits<cpp_type>::kIsSigned) {
+      key_unsigned ^= static_cast<unsigned_cpp_type>(1) << (sizeof(key_unsigned) * CHAR_BIT - 1);
+    }
+    return SwapEndian(key_unsigned);
+  }
 };
 
 template<typename Buffer>
@@ -125,6 +148,9 @@ struct KeyEncoderTraits<BINARY, Buffer> {
 
   static const DataType key_type = BINARY;
 
+  // Encoded values vary in size.
+  static const size_t kFixedEncodedSize = 0;
+
   static void Encode(const void* key, Buffer* dst) {
     Encode(*reinterpret_cast<const Slice*>(key), dst);
   }
@@ -147,54 +173,75 @@ struct KeyEncoderTraits<BINARY, Buffer> {
     if (is_last) {
       dst->append(reinterpret_cast<const char*>(s.data()), s.size());
     } else {
-      // If we're a middle component of a composite key, we need to add a \x00
-      // at the end in order to separate this component from the next one. However,
-      // if we just did that, we'd have issues where a key that actually has
-      // \x00 in it would compare wrong, so we have to instead add \x00\x00, and
-      // encode \x00 as \x00\x01.
       int old_size = dst->size();
-      dst->resize(old_size + s.size() * 2 + 2);
-
-      const uint8_t* srcp = s.data();
-      uint8_t* dstp = reinterpret_cast<uint8_t*>(&(*dst)[old_size]);
-      int len = s.size();
-      int rem = len;
-
-      while (rem >= 16) {
-        if (!SSEEncodeChunk<16>(&srcp, &dstp)) {
-          goto slow_path;
-        }
-        rem -= 16;
+      dst->resize(old_size + MaxEncodedSize(s, is_last));
+      uint8_t* dstp = EncodeToBuffer(s, is_last, reinterpret_cast<uint8_t*>(&(*dst)[old_size]));
+      dst->resize(dstp - reinterpret_cast<uint8_t*>(&(*dst)[0]));
+    }
+  }
+
+  static size_t MaxEncodedSize(const void* key, bool is_last) {
+    return MaxEncodedSize(*reinterpret_cast<const Slice*>(key), is_last);
+  }
+
+  inline static size_t MaxEncodedSize(const Slice& s, bool is_last) {
+    return is_last ? s.size() : s.size() * 2 + 2;
+  }
+
+  static uint8_t* EncodeToBuffer(const void* key, bool is_last, uint8_t* dst) {
+    return EncodeToBuffer(*reinterpret_cast<const Slice*>(key), is_last, dst);
+  }
+
+  // Encodes 's' into 'dstp', which must have room for MaxEncodedSize(s, is_last)
+  // bytes, and returns the end of the encoded value.
+  inline static uint8_t* EncodeToBuffer(const Slice& s, bool is_last, uint8_t* dstp) {
+    if (is_last) {
+      memcpy(dstp, s.data(), s.size());
+      return dstp + s.size();
+    }
+    // If we're a middle component of a composite key, we need to add a \x00
+    // at the end in order to separate this component from the next one. However,
+    // if we just did that, we'd have issues where a key that actually has
+    // \x00 in it would compare wrong, so we have to instead add \x00\x00, and
+    // encode \x00 as \x00\x01.
+    const uint8_t* srcp = s.data();
+    int len = s.size();
+    int rem = len;
+
+    while (rem >= 16) {
+      if (!SSEEncodeChunk<16>(&srcp, &dstp)) {
+        goto slow_path;
       }
-      while (rem >= 8) {
-        if (!SSEEncodeChunk<8>(&srcp, &dstp)) {
-          goto slow_path;
-        }
-        rem -= 8;
+      rem -= 16;
+    }
+    while (rem >= 8) {
+      if (!SSEEncodeChunk<8>(&srcp, &dstp)) {
+        goto slow_path;
       }
-      // Roll back to operate in 8 bytes at a time.
-      if (len > 8 && rem > 0) {
-        dstp -= 8 - rem;
-        srcp -= 8 - rem;
-        if (!SSEEncodeChunk<8>(&srcp, &dstp)) {
-          // TODO: optimize for the case where the input slice has '\0'
-          // bytes. (e.g. move the pointer to the first zero byte.)
-          dstp += 8 - rem;
-          srcp += 8 - rem;
-          goto slow_path;
-        }
-        rem = 0;
-        goto done;
+      rem -= 8;
+    }
+    // Roll back to operate in 8 bytes at a time.
+    if (len > 8 && rem > 0) {
+      dstp -= 8 - rem;
+      srcp -= 8 - rem;
+      if (!SSEEncodeChunk<8>(&srcp, &dstp)) {
+        // TODO: optimize for the case where the input slice has '\0'
+        // bytes. (e.g. move the pointer to the first zero byte.)
+        dstp += 8 - rem;
+        srcp += 8 - rem;
+        goto slow_path;
       }
+      rem = 0;
+      goto done;
+    }
 
-      slow_path:
-      EncodeChunkLoop(&srcp, &dstp, rem);
+    slow_path:
+    EncodeChunkLoop(&srcp, &dstp, rem);
 
-      done:
-      *dstp++ = 0;
-      *dstp++ = 0;
-      dst->resize(dstp - reinterpret_cast<uint8_t*>(&(*dst)[0]));
-    }
+    done:
+    *dstp++ = 0;
+    *dstp++ = 0;
+    return dstp;
   }
 
   static Status DecodeKeyPortion(Slice* encoded_key,
@@ -325,6 +372,24 @@ class KeyEncoder {
     Encode(key, dst);
   }
 
+  // Returns the number of bytes EncodeToBuffer() may write for 'key'.
+  size_t MaxEncodedSize(const void* key, bool is_last) const {
+    return fixed_encoded_size_ ? fixed_encoded_size_ : max_encoded_size_func_(key, is_last);
+  }
+
+  // Like Encode(key, is_last, dst), but writes into 'dst' which must have
+  // room for MaxEncodedSize(key, is_last) bytes. Returns the end of the
+  // encoded value.
+  uint8_t* EncodeToBuffer(const void* key, bool is_last, uint8_t* dst) const {
+    return encode_to_buffer_func_(key, is_last, dst);
+  }
+
+  // Returns the size of every encoded value if it is the same for all
+  // values of the type, or 0 otherwise.
+  size_t fixed_encoded_size() const {
+    return fixed_encoded_size_;
+  }
+
   // Decode the next component out of the composite key pointed to by '*encoded_key'
   // into *cell_ptr.
   // After decoding encoded_key is advanced forward such that it contains the remainder
@@ -345,18 +410,27 @@ class KeyEncoder {
   explicit KeyEncoder(EncoderTraitsClass t)
     : encode_func_(EncoderTraitsClass::Encode),
       encode_with_separators_func_(EncoderTraitsClass::EncodeWithSeparators),
-      decode_key_portion_func_(EncoderTraitsClass::DecodeKeyPortion) {
+      max_encoded_size_func_(EncoderTraitsClass::MaxEncodedSize),
+      encode_to_buffer_func_(EncoderTraitsClass::EncodeToBuffer),
+      decode_key_portion_func_(EncoderTraitsClass::DecodeKeyPortion),
+      fixed_encoded_size_(EncoderTraitsClass::kFixedEncodedSize) {
   }
 
   typedef void (*EncodeFunc)(const void* key, Buffer* dst);
   const EncodeFunc encode_func_;
   typedef void (*EncodeWithSeparatorsFunc)(const void* key, bool is_last, Buffer* dst);
   const EncodeWithSeparatorsFunc encode_with_separators_func_;
+  typedef size_t (*MaxEncodedSizeFunc)(const void* key, bool is_last);
+  const MaxEncodedSizeFunc max_encoded_size_func_;
+  typedef uint8_t* (*EncodeToBufferFunc)(const void* key, bool is_last, uint8_t* dst);
+  const EncodeToBufferFunc encode_to_buffer_func_;
 
   typedef Status (*DecodeKeyPortionFunc)(Slice* enc_key, bool is_last,
                                        Arena* arena, uint8_t* cell_ptr);
   const DecodeKeyPortionFunc decode_key_portion_func_;
 
+  const size_t fixed_encoded_size_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(KeyEncoder);
 };
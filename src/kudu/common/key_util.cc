@@ -232,6 +232,7 @@ int PushUpperBoundKeyPredicates(ColIdxIter first,
         pushed_predicates++;
         break;
       case PredicateType::InBloomFilter:  // Upper in InBloomFilter processed as upper in Range.
+      case PredicateType::Like:           // Likewise for the upper bound of a Like.
       case PredicateType::Range:
         if (predicate->raw_upper() != nullptr) {
           memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_upper(), size);
@@ -299,6 +300,7 @@ int PushLowerBoundKeyPredicates(ColIdxIter first,
 
     switch (predicate->predicate_type()) {
       case PredicateType::InBloomFilter: // Lower in InBloomFilter processed as lower in Range.
+      case PredicateType::Like:          // Likewise for the lower bound of a Like.
       case PredicateType::Range:
         if (predicate->raw_lower() == nullptr) {
           break_loop = true;
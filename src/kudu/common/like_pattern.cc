@@ -0,0 +1,174 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/like_pattern.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+
+using std::string;
+
+namespace kudu {
+
+LikePattern::LikePattern(const Slice& pattern)
+    : pattern_(pattern.ToString()),
+      min_length_(0) {
+  segments_.emplace_back();
+  bool in_prefix = true;
+  for (size_t i = 0; i < pattern.size(); i++) {
+    char c = static_cast<char>(pattern[i]);
+    if (c == '%') {
+      segments_.emplace_back();
+      in_prefix = false;
+      continue;
+    }
+    Segment* segment = &segments_.back();
+    min_length_++;
+    if (c == '_') {
+      segment->text.push_back('\0');
+      segment->any.push_back(true);
+      segment->has_any = true;
+      in_prefix = false;
+      continue;
+    }
+    if (c == '\\' && i + 1 < pattern.size()) {
+      c = static_cast<char>(pattern[++i]);
+    }
+    segment->text.push_back(c);
+    segment->any.push_back(false);
+    if (in_prefix) {
+      literal_prefix_.push_back(c);
+    }
+  }
+}
+
+bool LikePattern::is_prefix() const {
+  if (segments_.size() < 2 || segments_.front().has_any) {
+    return false;
+  }
+  for (size_t i = 1; i < segments_.size(); i++) {
+    if (!segments_[i].text.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LikePattern::Matches(const Slice& value) const {
+  const size_t size = value.size();
+  if (size < min_length_) {
+    return false;
+  }
+  const uint8_t* data = value.data();
+  if (segments_.size() == 1) {
+    return size == min_length_ && MatchesAt(segments_.front(), data, 0);
+  }
+
+  // Anchor the first and last segments; min_length_ guarantees that they
+  // don't overlap.
+  const Segment& first = segments_.front();
+  const Segment& last = segments_.back();
+  if (!MatchesAt(first, data, 0) || !MatchesAt(last, data, size - last.text.size())) {
+    return false;
+  }
+
+  // Matching each middle segment at its leftmost position leaves the most room
+  // for the segments after it.
+  size_t pos = first.text.size();
+  const size_t end = size - last.text.size();
+  for (size_t i = 1; i + 1 < segments_.size(); i++) {
+    const Segment& segment = segments_[i];
+    if (segment.text.empty()) {
+      continue;
+    }
+    size_t found = Find(segment, data, pos, end);
+    if (found == string::npos) {
+      return false;
+    }
+    pos = found + segment.text.size();
+  }
+  return true;
+}
+
+bool LikePattern::MatchesAt(const Segment& segment, const uint8_t* value, size_t pos) {
+  const size_t len = segment.text.size();
+  if (!segment.has_any) {
+    return memcmp(value + pos, segment.text.data(), len) == 0;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (!segment.any[i] && value[pos + i] != static_cast<uint8_t>(segment.text[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t LikePattern::Find(const Segment& segment, const uint8_t* value, size_t start, size_t end) {
+  const size_t len = segment.text.size();
+  if (start + len > end) {
+    return string::npos;
+  }
+  if (segment.has_any) {
+    for (size_t pos = start; pos + len <= end; pos++) {
+      if (MatchesAt(segment, value, pos)) {
+        return pos;
+      }
+    }
+    return string::npos;
+  }
+
+  const uint8_t* needle = reinterpret_cast<const uint8_t*>(segment.text.data());
+  if (len == 1) {
+    const void* found = memchr(value + start, needle[0], end - start);
+    return found == nullptr ? string::npos : static_cast<const uint8_t*>(found) - value;
+  }
+
+  size_t pos = start;
+#if defined(__SSE2__)
+  // Compare sixteen candidate positions at once against the first and the
+  // last byte of the needle, and only compare the bytes in between at the
+  // positions where both match.
+  const __m128i first = _mm_set1_epi8(static_cast<char>(needle[0]));
+  const __m128i last = _mm_set1_epi8(static_cast<char>(needle[len - 1]));
+  for (; pos + len - 1 + 16 <= end; pos += 16) {
+    const __m128i block_first =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + pos));
+    const __m128i block_last =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + pos + len - 1));
+    uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                    _mm_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      const size_t candidate = pos + __builtin_ctz(mask);
+      if (memcmp(value + candidate + 1, needle + 1, len - 2) == 0) {
+        return candidate;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; pos + len <= end; pos++) {
+    if (value[pos] == needle[0] && memcmp(value + pos + 1, needle + 1, len - 1) == 0) {
+      return pos;
+    }
+  }
+  return string::npos;
+}
+
+} // namespace kudu
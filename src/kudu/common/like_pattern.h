@@ -0,0 +1,98 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+// A compiled SQL LIKE pattern.
+//
+// In a pattern, '%' matches any sequence of bytes (including the empty one),
+// '_' matches exactly one byte, and '\' makes the byte which follows it match
+// literally. A trailing '\' matches itself. Matching is done on bytes, so '_'
+// matches a single byte of a multi-byte UTF-8 character.
+//
+// The pattern is split at each '%' into segments. The first segment must match
+// at the start of the value and the last at its end; the segments in between
+// are matched at their leftmost position after the previous one. Segments
+// without '_' are searched for with a vectorized substring search.
+class LikePattern {
+ public:
+  explicit LikePattern(const Slice& pattern);
+
+  // Returns whether 'value' matches the pattern.
+  bool Matches(const Slice& value) const;
+
+  // Returns the pattern as it was given.
+  const std::string& pattern() const {
+    return pattern_;
+  }
+
+  // Returns the bytes that every matching value starts with: the unescaped
+  // literal bytes before the first wildcard.
+  const std::string& literal_prefix() const {
+    return literal_prefix_;
+  }
+
+  // Returns true if the pattern has no wildcards, and so only matches the
+  // value literal_prefix().
+  bool is_literal() const {
+    return segments_.size() == 1 && !segments_[0].has_any;
+  }
+
+  // Returns true if the pattern matches exactly the values starting with
+  // literal_prefix(), i.e. the pattern is a literal followed only by '%'s.
+  bool is_prefix() const;
+
+ private:
+  struct Segment {
+    // The unescaped bytes of the segment. The bytes at positions where 'any'
+    // is set are placeholders for '_'.
+    std::string text;
+    std::vector<bool> any;
+    bool has_any = false;
+  };
+
+  // Returns whether 'segment' matches 'value' at offset 'pos'. The value must
+  // have at least 'pos + segment.text.size()' bytes.
+  static bool MatchesAt(const Segment& segment, const uint8_t* value, size_t pos);
+
+  // Returns the leftmost offset in [start, end) of 'value' at which 'segment'
+  // matches without extending past 'end', or std::string::npos.
+  static size_t Find(const Segment& segment, const uint8_t* value, size_t start, size_t end);
+
+  std::string pattern_;
+  std::string literal_prefix_;
+
+  // The segments between the '%' wildcards. There is one more segment than
+  // there are '%'s, so a pattern starting or ending with '%' has an empty
+  // first or last segment.
+  std::vector<Segment> segments_;
+
+  // The shortest length of a matching value: the total length of the
+  // segments.
+  size_t min_length_;
+};
+
+} // namespace kudu
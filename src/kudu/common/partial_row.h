@@ -42,6 +42,7 @@
 namespace kudu {
 class ColumnSchema;
 namespace client {
+class KuduColumnarWriteBatch;
 class KuduWriteOperation;
 template<typename KeyTypeWrapper> struct SliceKeysTestSetup;// IWYU pragma: keep
 template<typename KeyTypeWrapper> struct IntKeysTestSetup;  // IWYU pragma: keep
@@ -491,6 +492,7 @@ class KUDU_EXPORT KuduPartialRow {
   const Schema* schema() const { return schema_; }
 
  private:
+  friend class client::KuduColumnarWriteBatch; // for row_data_ and isset_bitmap_.
   friend class client::KuduWriteOperation;   // for row_data_.
   friend class KeyUtilTest;
   friend class PartitionSchema;
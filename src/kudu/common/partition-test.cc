@@ -30,6 +30,7 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/row.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/util/slice.h"
@@ -40,6 +41,7 @@
 using boost::optional;
 using std::pair;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 namespace kudu {
@@ -657,6 +659,56 @@ TEST_F(PartitionTest, TestCreatePartitions) {
             partition_schema.PartitionDebugString(partitions[11], schema));
 }
 
+// Tests that checking a batch of rows against the partitions agrees with
+// checking each row on its own, for both fixed-size and variable-length hash
+// columns.
+TEST_F(PartitionTest, TestPartitionContainsRows) {
+  // CREATE TABLE t (a INT32, b VARCHAR, PRIMARY KEY (a, b))
+  // PARITITION BY [HASH BUCKET (a), HASH BUCKET (b), RANGE (a)];
+  Schema schema({ ColumnSchema("a", INT32),
+                  ColumnSchema("b", STRING) },
+                { ColumnId(0), ColumnId(1) }, 2);
+
+  PartitionSchemaPB schema_builder;
+  AddHashBucketComponent(&schema_builder, { "a" }, 4, 1);
+  AddHashBucketComponent(&schema_builder, { "b" }, 3, 2);
+  SetRangePartitionComponent(&schema_builder, { "a" });
+  PartitionSchema partition_schema;
+  ASSERT_OK(PartitionSchema::FromPB(schema_builder, schema, &partition_schema));
+
+  KuduPartialRow split(&schema);
+  ASSERT_OK(split.SetInt32("a", 50));
+  vector<Partition> partitions;
+  ASSERT_OK(partition_schema.CreatePartitions({ split }, {}, schema, &partitions));
+  ASSERT_EQ(24, partitions.size());
+
+  // Enough rows to exercise both the interleaved and the leftover hashing.
+  const int kNumRows = 103;
+  vector<unique_ptr<RowBuilder>> builders;
+  vector<ConstContiguousRow> rows;
+  for (int i = 0; i < kNumRows; i++) {
+    builders.emplace_back(new RowBuilder(schema));
+    builders.back()->AddInt32(i);
+    builders.back()->AddString(string(i % 7, 'x'));
+    rows.push_back(builders.back()->row());
+  }
+
+  int num_contained = 0;
+  for (const Partition& partition : partitions) {
+    unique_ptr<bool[]> contains(new bool[kNumRows]);
+    ASSERT_OK(partition_schema.PartitionContainsRows(partition, rows.data(), rows.size(),
+                                                     contains.get()));
+    for (int i = 0; i < kNumRows; i++) {
+      bool expected;
+      ASSERT_OK(partition_schema.PartitionContainsRow(partition, rows[i], &expected));
+      ASSERT_EQ(expected, contains[i]) << "row " << i;
+      num_contained += contains[i];
+    }
+  }
+  // Every row belongs to exactly one partition.
+  ASSERT_EQ(kNumRows, num_contained);
+}
+
 TEST_F(PartitionTest, TestIncrementRangePartitionBounds) {
   // CREATE TABLE t (a INT8, b INT8, c INT8, PRIMARY KEY (a, b, c))
   // PARITITION BY RANGE (a, b, c);
@@ -496,6 +496,38 @@ Status PartitionSchema::PartitionContainsRow(const Partition& partition,
   return PartitionContainsRowImpl(partition, row, contains);
 }
 
+Status PartitionSchema::PartitionContainsRows(const Partition& partition,
+                                              const ConstContiguousRow* rows,
+                                              size_t num_rows,
+                                              bool* contains) const {
+  CHECK_EQ(partition.hash_buckets().size(), hash_bucket_schemas_.size());
+  std::fill(contains, contains + num_rows, true);
+
+  vector<int32_t> buckets(num_rows);
+  for (int i = 0; i < hash_bucket_schemas_.size(); i++) {
+    BucketsForRows(rows, num_rows, hash_bucket_schemas_[i], buckets.data());
+    for (size_t row_idx = 0; row_idx < num_rows; row_idx++) {
+      if (buckets[row_idx] != partition.hash_buckets()[i]) {
+        contains[row_idx] = false;
+      }
+    }
+  }
+
+  string range_partition_key;
+  for (size_t row_idx = 0; row_idx < num_rows; row_idx++) {
+    if (!contains[row_idx]) {
+      continue;
+    }
+    range_partition_key.clear();
+    RETURN_NOT_OK(EncodeColumns(rows[row_idx], range_schema_.column_ids, &range_partition_key));
+    contains[row_idx] =
+        (Slice(range_partition_key).compare(partition.range_key_start()) >= 0)
+        && (partition.range_key_end().empty()
+            || Slice(range_partition_key).compare(partition.range_key_end()) < 0);
+  }
+  return Status::OK();
+}
+
 
 Status PartitionSchema::DecodeRangeKey(Slice* encoded_key,
                                        KuduPartialRow* row,
@@ -936,6 +968,57 @@ Status PartitionSchema::BucketForRow(const Row& row,
   return Status::OK();
 }
 
+void PartitionSchema::BucketsForRows(const ConstContiguousRow* rows,
+                                     size_t num_rows,
+                                     const HashBucketSchema& hash_bucket_schema,
+                                     int32_t* buckets) {
+  if (num_rows == 0) {
+    return;
+  }
+  const Schema* schema = rows[0].schema();
+  const vector<ColumnId>& column_ids = hash_bucket_schema.column_ids;
+
+  // Resolve the columns and their encoders once for the whole batch.
+  vector<int32_t> column_idxs(column_ids.size());
+  vector<const KeyEncoder<string>*> encoders(column_ids.size());
+  bool fixed_size = true;
+  for (int i = 0; i < column_ids.size(); i++) {
+    column_idxs[i] = schema->find_column_by_id(column_ids[i]);
+    CHECK(column_idxs[i] != Schema::kColumnNotFound);
+    const TypeInfo* type = schema->column(column_idxs[i]).type_info();
+    encoders[i] = &GetKeyEncoder<string>(type);
+    fixed_size &= type->physical_type() != BINARY;
+  }
+
+  // Encode the keys back-to-back into a single buffer.
+  string buf;
+  vector<size_t> key_offsets(num_rows + 1);
+  for (size_t row_idx = 0; row_idx < num_rows; row_idx++) {
+    DCHECK_EQ(schema, rows[row_idx].schema());
+    key_offsets[row_idx] = buf.size();
+    for (int i = 0; i < column_idxs.size(); i++) {
+      encoders[i]->Encode(rows[row_idx].cell_ptr(column_idxs[i]), i + 1 == column_idxs.size(),
+                          &buf);
+    }
+  }
+  key_offsets[num_rows] = buf.size();
+
+  vector<uint64_t> hashes(num_rows);
+  if (fixed_size) {
+    HashUtil::MurmurHash2_64Batch(buf.data(), key_offsets[1], num_rows,
+                                  hash_bucket_schema.seed, hashes.data());
+  } else {
+    for (size_t row_idx = 0; row_idx < num_rows; row_idx++) {
+      hashes[row_idx] = HashUtil::MurmurHash2_64(buf.data() + key_offsets[row_idx],
+                                                 key_offsets[row_idx + 1] - key_offsets[row_idx],
+                                                 hash_bucket_schema.seed);
+    }
+  }
+  for (size_t row_idx = 0; row_idx < num_rows; row_idx++) {
+    buckets[row_idx] = hashes[row_idx] % static_cast<uint64_t>(hash_bucket_schema.num_buckets);
+  }
+}
+
 //------------------------------------------------------------
 // Template instantiations: We instantiate all possible templates to avoid linker issues.
 // see: https://isocpp.org/wiki/faq/templates#separate-template-fn-defn-from-decl
@@ -17,6 +17,7 @@
 #ifndef KUDU_COMMON_PARTITION_H
 #define KUDU_COMMON_PARTITION_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -173,6 +174,15 @@ class PartitionSchema {
                               const ConstContiguousRow& row,
                               bool* contains) const WARN_UNUSED_RESULT;
 
+  // Tests if the partition contains each of the 'num_rows' rows, which must
+  // all have the same schema, setting 'contains[i]' for the i-th row. The
+  // hash buckets of the whole batch are computed at once, which is cheaper
+  // than calling PartitionContainsRow() for each row.
+  Status PartitionContainsRows(const Partition& partition,
+                               const ConstContiguousRow* rows,
+                               size_t num_rows,
+                               bool* contains) const WARN_UNUSED_RESULT;
+
   // Returns a text description of the partition suitable for debug printing.
   //
   // Partitions are considered metadata, so no redaction will happen on the hash
@@ -277,6 +287,15 @@ class PartitionSchema {
                              const HashBucketSchema& hash_bucket_schema,
                              int32_t* bucket);
 
+  // Assigns each of the 'num_rows' rows, which must all have the same
+  // schema, to a hash bucket according to the hash schema. The columns and
+  // their encoders are resolved once for the batch, and when the hash columns
+  // are all fixed-size the encoded keys are hashed several at a time.
+  static void BucketsForRows(const ConstContiguousRow* rows,
+                             size_t num_rows,
+                             const HashBucketSchema& hash_bucket_schema,
+                             int32_t* buckets);
+
   // PartitionKeyDebugString implementation for row types.
   template<typename Row>
   std::string PartitionKeyDebugStringImpl(const Row& row) const;
@@ -48,6 +48,7 @@
 
 using boost::optional;
 using std::count_if;
+using std::find_if;
 using std::get;
 using std::make_tuple;
 using std::move;
@@ -991,6 +992,104 @@ TEST_F(PartitionPrunerTest, TestPruning) {
         string("\0\0\0\1", 4), "", 1, 1);
 }
 
+TEST_F(PartitionPrunerTest, TestInListRangePruning) {
+  // CREATE TABLE t
+  // (a INT8, b INT8, PRIMARY KEY (a, b))
+  // DISTRIBUTE BY RANGE(a)
+  // SPLIT ROWS [(0), (10), (20)]
+  Schema schema({ ColumnSchema("a", INT8),
+                  ColumnSchema("b", INT8) },
+                { ColumnId(0), ColumnId(1) },
+                2);
+
+  PartitionSchema partition_schema;
+  auto pb = PartitionSchemaPB();
+  pb.mutable_range_schema()->add_columns()->set_name("a");
+  ASSERT_OK(PartitionSchema::FromPB(pb, schema, &partition_schema));
+
+  KuduPartialRow split1(&schema);
+  ASSERT_OK(split1.SetInt8("a", 0));
+  KuduPartialRow split2(&schema);
+  ASSERT_OK(split2.SetInt8("a", 10));
+  KuduPartialRow split3(&schema);
+  ASSERT_OK(split3.SetInt8("a", 20));
+
+  vector<Partition> partitions;
+  ASSERT_OK(partition_schema.CreatePartitions({ split1, split2, split3 }, {}, schema,
+                                              &partitions));
+  ASSERT_EQ(4, partitions.size());
+
+  // Applies the specified predicates to a scan and checks that the expected
+  // number of partitions are pruned, and that a scan walking the remaining
+  // partition key ranges visits only the unpruned partitions.
+  auto Check = [&] (const vector<ColumnPredicate>& predicates,
+                    size_t remaining_tablets) {
+    ScanSpec spec;
+    for (const auto& pred : predicates) {
+      spec.AddPredicate(pred);
+    }
+    CheckPrunedPartitions(schema, partition_schema, partitions, spec,
+                          remaining_tablets, remaining_tablets == 0 ? 0 : 1);
+
+    ScanSpec opt_spec(spec);
+    AutoReleasePool p;
+    Arena arena(256);
+    opt_spec.OptimizeScan(schema, &arena, &p, false);
+    PartitionPruner pruner;
+    pruner.Init(schema, partition_schema, opt_spec);
+
+    size_t visited_tablets = 0;
+    while (pruner.HasMorePartitionKeyRanges()) {
+      const string& key = pruner.NextPartitionKey();
+      auto partition = find_if(partitions.begin(), partitions.end(),
+                               [&] (const Partition& partition) {
+                                 return partition.partition_key_start() <= key &&
+                                        (partition.partition_key_end().empty() ||
+                                         key < partition.partition_key_end());
+                               });
+      ASSERT_TRUE(partition != partitions.end());
+      ASSERT_FALSE(pruner.ShouldPrune(*partition));
+      visited_tablets++;
+      if (partition->partition_key_end().empty()) {
+        break;
+      }
+      pruner.RemovePartitionKeyRange(partition->partition_key_end());
+    }
+    ASSERT_EQ(remaining_tablets, visited_tablets);
+  };
+
+  int8_t neg_five = -5;
+  int8_t one = 1;
+  int8_t five = 5;
+  int8_t fifteen = 15;
+  int8_t twenty_five = 25;
+
+  vector<const void*> a_values;
+
+  // a IN (1, 5)
+  a_values = { &one, &five };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 1);
+
+  // a IN (-5, 15)
+  a_values = { &neg_five, &fifteen };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 2);
+
+  // a IN (-5, 15, 25)
+  a_values = { &neg_five, &fifteen, &twenty_five };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 3);
+
+  // a IN (-5, 1, 25)
+  a_values = { &neg_five, &one, &twenty_five };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 3);
+
+  // a IN (-5, 25)
+  // b = 1
+  a_values = { &neg_five, &twenty_five };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values),
+          ColumnPredicate::Equality(schema.column(1), &one) },
+        2);
+}
+
 TEST_F(PartitionPrunerTest, TestKudu2173) {
   // CREATE TABLE t
   // (a INT8, b INT8, PRIMARY KEY (a, b))
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <numeric>
@@ -189,9 +190,11 @@ vector<bool> PartitionPruner::PruneHashComponent(
     const Schema& schema,
     const ScanSpec& scan_spec) {
   vector<bool> hash_bucket_bitset(hash_bucket_schema.num_buckets, false);
-  vector<string> encoded_strings(1, "");
-  for (size_t col_offset = 0; col_offset < hash_bucket_schema.column_ids.size(); ++col_offset) {
-    vector<string> new_encoded_strings;
+
+  // Encode the values of each column once.
+  const size_t num_columns = hash_bucket_schema.column_ids.size();
+  vector<vector<string>> encoded_values(num_columns);
+  for (size_t col_offset = 0; col_offset < num_columns; ++col_offset) {
     const ColumnSchema& column = schema.column_by_id(hash_bucket_schema.column_ids[col_offset]);
     const ColumnPredicate& predicate = FindOrDie(scan_spec.predicates(), column.name());
     const KeyEncoder<string>& encoder = GetKeyEncoder<string>(column.type_info());
@@ -205,23 +208,41 @@ vector<bool> PartitionPruner::PruneHashComponent(
                               predicate.raw_values().begin(),
                               predicate.raw_values().end());
     }
-    // For each of the encoded string, replicate it by the number of values in
-    // equality and in-list predicate.
-    for (const string& encoded_string : encoded_strings) {
-      for (const void* predicate_value : predicate_values) {
-        string new_encoded_string = encoded_string;
-        encoder.Encode(predicate_value,
-                       col_offset + 1 == hash_bucket_schema.column_ids.size(),
-                       &new_encoded_string);
-        new_encoded_strings.emplace_back(new_encoded_string);
-      }
+    encoded_values[col_offset].reserve(predicate_values.size());
+    for (const void* predicate_value : predicate_values) {
+      string encoded_value;
+      encoder.Encode(predicate_value, col_offset + 1 == num_columns, &encoded_value);
+      encoded_values[col_offset].emplace_back(std::move(encoded_value));
     }
-    encoded_strings.swap(new_encoded_strings);
-  }
-  for (const string& encoded_string : encoded_strings) {
-    uint32_t hash = partition_schema.BucketForEncodedColumns(encoded_string, hash_bucket_schema);
-    hash_bucket_bitset[hash] = true;
   }
+
+  // Hash every combination of the values, depth first so that the
+  // combinations never need to be materialized at once. Large in-lists
+  // usually hit every bucket long before all combinations are hashed, so stop
+  // as soon as no bucket is left to mark.
+  int32_t num_unmarked = hash_bucket_schema.num_buckets;
+  string encoded_columns;
+  std::function<void(size_t)> mark_buckets = [&](size_t col_offset) {
+    const size_t prefix_size = encoded_columns.size();
+    for (const string& encoded_value : encoded_values[col_offset]) {
+      if (num_unmarked == 0) {
+        return;
+      }
+      encoded_columns.append(encoded_value);
+      if (col_offset + 1 == num_columns) {
+        uint32_t hash = partition_schema.BucketForEncodedColumns(encoded_columns,
+                                                                 hash_bucket_schema);
+        if (!hash_bucket_bitset[hash]) {
+          hash_bucket_bitset[hash] = true;
+          num_unmarked--;
+        }
+      } else {
+        mark_buckets(col_offset + 1);
+      }
+      encoded_columns.resize(prefix_size);
+    }
+  };
+  mark_buckets(0);
   return hash_bucket_bitset;
 }
 
@@ -427,9 +448,33 @@ void PartitionPruner::Init(const Schema& schema,
   partition_key_ranges_.resize(partition_key_ranges.size());
   move(partition_key_ranges.rbegin(), partition_key_ranges.rend(), partition_key_ranges_.begin());
 
-  // Step 6: Remove all partition key ranges before the scan spec's lower bound partition key.
+  // Step 6: Collect the in-list values of the range partition column, if the
+  // table is range partitioned on a single column. Tablets are ordered by
+  // their range keys within each combination of hash buckets, so pruning can
+  // then walk the sorted values in step with the tablets, skipping over the
+  // stretches of range keys between values.
+  range_in_list_keys_.clear();
+  hash_prefix_size_ = partition_schema.hash_bucket_schemas_.size() * sizeof(uint32_t);
+  if (range_columns.size() == 1) {
+    const ColumnSchema& column = schema.column_by_id(range_columns[0]);
+    const ColumnPredicate* predicate = FindOrNull(scan_spec.predicates(), column.name());
+    if (predicate != nullptr && predicate->predicate_type() == PredicateType::InList) {
+      // The values are sorted, and their encodings sort the same way.
+      const KeyEncoder<string>& encoder = GetKeyEncoder<string>(column.type_info());
+      range_in_list_keys_.reserve(predicate->raw_values().size());
+      for (const void* value : predicate->raw_values()) {
+        string key;
+        encoder.Encode(value, true, &key);
+        range_in_list_keys_.emplace_back(move(key));
+      }
+    }
+  }
+
+  // Step 7: Remove all partition key ranges before the scan spec's lower bound partition key.
   if (!scan_spec.lower_bound_partition_key().empty()) {
     RemovePartitionKeyRange(scan_spec.lower_bound_partition_key());
+  } else {
+    SkipToNextInListKey();
   }
 }
 
@@ -458,6 +503,56 @@ void PartitionPruner::RemovePartitionKeyRange(const string& upper_bound) {
       partition_key_ranges_.pop_back();
     }
   }
+  SkipToNextInListKey();
+}
+
+bool PartitionPruner::RangeContainsInListKey(Slice range_key_start, Slice range_key_end) const {
+  auto key = lower_bound(range_in_list_keys_.begin(), range_in_list_keys_.end(), range_key_start,
+                         [] (const string& key, const Slice& bound) {
+                           return Slice(key).compare(bound) < 0;
+                         });
+  return key != range_in_list_keys_.end() &&
+         (range_key_end.empty() || Slice(*key).compare(range_key_end) < 0);
+}
+
+void PartitionPruner::SkipToNextInListKey() {
+  if (range_in_list_keys_.empty()) {
+    return;
+  }
+  while (!partition_key_ranges_.empty()) {
+    string& lower = get<0>(partition_key_ranges_.back());
+    const string& upper = get<1>(partition_key_ranges_.back());
+    if (lower.size() < hash_prefix_size_) {
+      // The range component of the lower bound isn't known yet.
+      return;
+    }
+    Slice range_key(lower.data() + hash_prefix_size_, lower.size() - hash_prefix_size_);
+    auto key = lower_bound(range_in_list_keys_.begin(), range_in_list_keys_.end(), range_key,
+                           [] (const string& key, const Slice& bound) {
+                             return Slice(key).compare(bound) < 0;
+                           });
+    bool upper_has_same_hash_buckets =
+        upper.size() >= hash_prefix_size_ &&
+        upper.compare(0, hash_prefix_size_, lower, 0, hash_prefix_size_) == 0;
+    if (key == range_in_list_keys_.end()) {
+      // No value is left within these hash buckets. Drop the range if it
+      // doesn't extend past them.
+      if (upper_has_same_hash_buckets) {
+        partition_key_ranges_.pop_back();
+        continue;
+      }
+      return;
+    }
+    string next = lower.substr(0, hash_prefix_size_);
+    next.append(*key);
+    if (!upper.empty() && next >= upper) {
+      // The range holds no value.
+      partition_key_ranges_.pop_back();
+      continue;
+    }
+    lower = move(next);
+    return;
+  }
 }
 
 bool PartitionPruner::ShouldPrune(const Partition& partition) const {
@@ -470,9 +565,13 @@ bool PartitionPruner::ShouldPrune(const Partition& partition) const {
       return !scan_upper.empty() && scan_upper <= partition.partition_key_start();
     });
 
-  return range == partition_key_ranges_.rend() ||
-         (!partition.partition_key_end().empty() &&
-          partition.partition_key_end() <= get<0>(*range));
+  if (range == partition_key_ranges_.rend() ||
+      (!partition.partition_key_end().empty() &&
+       partition.partition_key_end() <= get<0>(*range))) {
+    return true;
+  }
+  return !range_in_list_keys_.empty() &&
+         !RangeContainsInListKey(partition.range_key_start(), partition.range_key_end());
 }
 
 string PartitionPruner::ToString(const Schema& schema,
@@ -24,6 +24,7 @@
 
 #include "kudu/gutil/macros.h"
 #include "kudu/common/partition.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 
@@ -40,7 +41,7 @@ class Schema;
 class PartitionPruner {
  public:
 
-  PartitionPruner() = default;
+  PartitionPruner() : hash_prefix_size_(0) {}
 
   // Initializes the partition pruner for a new scan. The scan spec should
   // already be optimized by the ScanSpec::Optimize method.
@@ -78,10 +79,29 @@ class PartitionPruner {
       const Schema& schema,
       const ScanSpec& scan_spec);
 
+  // Returns whether any of 'range_in_list_keys_' falls within the given range
+  // key bounds; an empty upper bound is unbounded.
+  bool RangeContainsInListKey(Slice range_key_start, Slice range_key_end) const;
+
+  // Moves the lower bound of the next partition key range forward to the
+  // next partition key whose range component is one of 'range_in_list_keys_',
+  // dropping the ranges which contain no such key.
+  void SkipToNextInListKey();
+
   // The reverse sorted set of partition key ranges. Each range has an inclusive
   // lower and exclusive upper bound.
   std::vector<std::tuple<std::string, std::string>> partition_key_ranges_;
 
+  // If the table is range partitioned on a single column which the scan
+  // constrains with an InList predicate, the encoded range keys of the
+  // predicate's values, in sorted order. Tablets and stretches of partition
+  // keys whose range components hold none of the values are pruned by
+  // walking the values in step with them.
+  std::vector<std::string> range_in_list_keys_;
+
+  // The length of the hash bucket components at the start of partition keys.
+  size_t hash_prefix_size_;
+
   DISALLOW_COPY_AND_ASSIGN(PartitionPruner);
 };
 
@@ -190,6 +190,32 @@ TEST_F(TestRowChangeList, TestReinserts) {
             RowChangeList(Slice(buf2)).ToString(schema_));
 }
 
+// Test that a REINSERT sizes its buffer once for the whole row.
+TEST_F(TestRowChangeList, TestReinsertPresizesBuffer) {
+  const string kLongValue(100, 'x');
+  RowBuilder rb(schema_);
+  rb.AddString(Slice("hello"));
+  rb.AddString(Slice(kLongValue));
+  rb.AddUint32(12345);
+  rb.AddNull();
+  ConstContiguousRow row = rb.row();
+
+  size_t size_bound = 1;
+  for (int i = schema_.num_key_columns(); i < schema_.num_columns(); i++) {
+    const ColumnSchema& col = schema_.column(i);
+    size_bound += RowChangeListEncoder::ColumnMutationSizeUpperBound(
+        col, col.is_nullable() && row.is_null(i) ? nullptr : row.cell_ptr(i));
+  }
+
+  faststring buf;
+  RowChangeListEncoder enc(&buf);
+  enc.SetToReinsert(row);
+  ASSERT_LE(buf.size(), size_bound);
+  ASSERT_EQ(size_bound, buf.capacity());
+  EXPECT_EQ(Substitute(R"(REINSERT col2="$0", col3=12345, col4=NULL)", kLongValue),
+            RowChangeList(Slice(buf)).ToString(schema_));
+}
+
 TEST_F(TestRowChangeList, TestInvalid_EmptySlice) {
   RowChangeListDecoder decoder((RowChangeList(Slice())));
   ASSERT_STR_CONTAINS(decoder.Init().ToString(),
@@ -264,10 +264,8 @@ Status RowChangeListDecoder::ApplyToOneColumn(size_t row_idx, ColumnBlock* dst_c
       continue;
     }
 
-    int junk_col_idx;
     const void* new_val;
-    RETURN_NOT_OK(dec.Validate(dst_schema, &junk_col_idx, &new_val));
-    DCHECK_EQ(junk_col_idx, col_idx);
+    RETURN_NOT_OK(dec.ValidateColumn(col_schema, &new_val));
 
     SimpleConstCell src(&col_schema, new_val);
     ColumnBlock::Cell dst_cell = dst_col->cell(row_idx);
@@ -344,8 +342,11 @@ Status RowChangeListDecoder::DecodedUpdate::Validate(const Schema& schema,
   }
 
   // It's a valid column - validate it.
-  const ColumnSchema& col = schema.column(*col_idx);
+  return ValidateColumn(schema.column(*col_idx), value);
+}
 
+Status RowChangeListDecoder::DecodedUpdate::ValidateColumn(const ColumnSchema& col,
+                                                           const void** value) const {
   if (null) {
     if (!col.is_nullable()) {
       return Status::Corruption("decoded set-to-NULL for non-nullable column",
@@ -27,7 +27,9 @@
 #include <glog/logging.h>
 #include <gtest/gtest_prod.h>
 
+#include "kudu/common/common.pb.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/faststring.h"
@@ -210,6 +212,21 @@ class RowChangeListEncoder {
                             int col_id,
                             const void* cell_ptr);
 
+  // Returns an upper bound on the number of bytes EncodeColumnMutation()
+  // appends for the given cell, so that the buffer can be sized up front
+  // instead of being grown repeatedly while encoding.
+  static size_t ColumnMutationSizeUpperBound(const ColumnSchema& col_schema,
+                                             const void* cell_ptr) {
+    // The column ID and the value size are both varint32s.
+    const size_t kMaxVarint32Size = 5;
+    if (cell_ptr == nullptr) {
+      return kMaxVarint32Size + 1;
+    }
+    size_t val_size = col_schema.type_info()->physical_type() == BINARY ?
+        reinterpret_cast<const Slice*>(cell_ptr)->size() : col_schema.type_info()->size();
+    return kMaxVarint32Size * 2 + val_size;
+  }
+
  private:
   FRIEND_TEST(TestRowChangeList, TestInvalid_SetNullForNonNullableColumn);
   FRIEND_TEST(TestRowChangeList, TestInvalid_SetWrongSizeForIntColumn);
@@ -246,8 +263,19 @@ class RowChangeListEncoder {
 template<class RowType>
 void RowChangeListEncoder::SetToReinsert(const RowType& src_row) {
   DCHECK_EQ(RowChangeList::kUninitialized, type_);
-  SetType(RowChangeList::kReinsert);
   const Schema* schema = src_row.schema();
+
+  // Size the buffer for the whole row at once.
+  size_t size_bound = 1;
+  for (int i = schema->num_key_columns(); i < schema->num_columns(); ++i) {
+    const ColumnSchema& col_schema = schema->column(i);
+    const void* cell_ptr = col_schema.is_nullable() && src_row.is_null(i) ?
+        nullptr : src_row.cell_ptr(i);
+    size_bound += ColumnMutationSizeUpperBound(col_schema, cell_ptr);
+  }
+  dst_->reserve(dst_->size() + size_bound);
+
+  SetType(RowChangeList::kReinsert);
   for (int i = 0; i < schema->num_columns(); ++i) {
     // Reinserts don't need to store the keys.
     if (schema->is_key_column(i)) continue;
@@ -406,6 +434,11 @@ class RowChangeListDecoder {
     Status Validate(const Schema& s,
                     int* col_idx,
                     const void** valid_value) const;
+
+    // Like Validate(), but for when the caller has already resolved the
+    // updated column to 'col', saving the lookup by column ID.
+    Status ValidateColumn(const ColumnSchema& col,
+                          const void** valid_value) const;
   };
 
   // Decode the next updated column into '*update'.
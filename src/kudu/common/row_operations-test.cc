@@ -35,6 +35,7 @@
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
@@ -465,6 +466,50 @@ TEST_F(RowOperationsTest, ProjectionTestWithDefaults) {
   }
 }
 
+// Test decoding a batch whose rows don't all set the same columns, so that
+// the decoder has to switch between several ways of laying out the rows.
+TEST_F(RowOperationsTest, TestDecodeBatchWithMixedColumns) {
+  Schema client_schema({ ColumnSchema("key", INT32),
+                         ColumnSchema("int_val", INT32),
+                         ColumnSchema("string_val", STRING, true) },
+                       1);
+  RowOperationsPB pb;
+  RowOperationsPBEncoder enc(&pb);
+  vector<string> expected;
+  for (int i = 0; i < 10; i++) {
+    KuduPartialRow row(&client_schema);
+    CHECK_OK(row.SetInt32("key", i));
+    CHECK_OK(row.SetInt32("int_val", i * 10));
+    switch (i % 4) {
+      case 0:
+        expected.push_back(Substitute(
+            "INSERT (int32 key=$0, int32 int_val=$1, string string_val=NULL)", i, i * 10));
+        break;
+      case 1:
+        CHECK_OK(row.SetNull("string_val"));
+        expected.push_back(Substitute(
+            "INSERT (int32 key=$0, int32 int_val=$1, string string_val=NULL)", i, i * 10));
+        break;
+      default:
+        CHECK_OK(row.SetStringCopy("string_val", Substitute("s$0", i)));
+        expected.push_back(Substitute(
+            R"(INSERT (int32 key=$0, int32 int_val=$1, string string_val="s$0"))", i, i * 10));
+        break;
+    }
+    enc.Add(RowOperationsPB::INSERT, row);
+  }
+
+  Arena arena(1024);
+  vector<DecodedRowOperation> ops;
+  RowOperationsPBDecoder dec(&pb, &client_schema, &schema_, &arena);
+  ASSERT_OK(dec.DecodeOperations(&ops));
+  ASSERT_EQ(expected.size(), ops.size());
+  for (int i = 0; i < ops.size(); i++) {
+    EXPECT_EQ(expected[i], ops[i].ToString(schema_));
+    EXPECT_TRUE(BitmapTest(ops[i].isset_bitmap, 2) == (i % 4 != 0));
+  }
+}
+
 // Test cases where the client only has a subset of the fields
 // of the table, but where the missing columns have defaults
 // or are NULLable.
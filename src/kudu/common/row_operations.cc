@@ -18,8 +18,11 @@
 #include "kudu/common/row_operations.h"
 
 #include <cstring>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -30,6 +33,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/fastmem.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/faststring.h"
@@ -39,6 +43,7 @@
 #include "kudu/util/slice.h"
 
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -191,6 +196,21 @@ Status RowOperationsPBDecoder::ReadNullBitmap(const uint8_t** null_bm) {
   return Status::OK();
 }
 
+Status RowOperationsPBDecoder::ResolveIndirectSlice(const uint8_t* src, Slice* slice) const {
+  // The Slice in the protobuf has a pointer relative to the indirect data,
+  // not a real pointer. Need to fix that.
+  const Slice* ptr_slice = reinterpret_cast<const Slice*>(src);
+  size_t offset_in_indirect = reinterpret_cast<uintptr_t>(ptr_slice->data());
+  bool overflowed = false;
+  size_t max_offset = AddWithOverflowCheck(offset_in_indirect, ptr_slice->size(), &overflowed);
+  if (PREDICT_FALSE(overflowed || max_offset > pb_->indirect_data().size())) {
+    return Status::Corruption("Bad indirect slice");
+  }
+
+  *slice = Slice(&pb_->indirect_data()[offset_in_indirect], ptr_slice->size());
+  return Status::OK();
+}
+
 Status RowOperationsPBDecoder::GetColumnSlice(const ColumnSchema& col, Slice* slice) {
   int size = col.type_info()->size();
   if (PREDICT_FALSE(src_.size() < size)) {
@@ -198,17 +218,7 @@ Status RowOperationsPBDecoder::GetColumnSlice(const ColumnSchema& col, Slice* sl
   }
   // Find the data
   if (col.type_info()->physical_type() == BINARY) {
-    // The Slice in the protobuf has a pointer relative to the indirect data,
-    // not a real pointer. Need to fix that.
-    const Slice* ptr_slice = reinterpret_cast<const Slice*>(src_.data());
-    size_t offset_in_indirect = reinterpret_cast<uintptr_t>(ptr_slice->data());
-    bool overflowed = false;
-    size_t max_offset = AddWithOverflowCheck(offset_in_indirect, ptr_slice->size(), &overflowed);
-    if (PREDICT_FALSE(overflowed || max_offset > pb_->indirect_data().size())) {
-      return Status::Corruption("Bad indirect slice");
-    }
-
-    *slice = Slice(&pb_->indirect_data()[offset_in_indirect], ptr_slice->size());
+    RETURN_NOT_OK(ResolveIndirectSlice(src_.data(), slice));
   } else {
     *slice = Slice(src_.data(), size);
   }
@@ -326,34 +336,66 @@ class ClientServerMapping {
 };
 
 
-Status RowOperationsPBDecoder::DecodeInsertOrUpsert(const uint8_t* prototype_row_storage,
-                                                    const ClientServerMapping& mapping,
-                                                    DecodedRowOperation* op) {
-  const uint8_t* client_isset_map;
-  const uint8_t* client_null_map;
+// How to decode INSERT and UPSERT rows with a particular pair of client
+// isset and null bitmaps. With the bitmaps fixed, the encoded row is just
+// the values of the same columns every time, at the same offsets.
+class InsertDecodePlan {
+ public:
+  // A column whose value is present in the encoded row.
+  struct Column {
+    const ColumnSchema* col;
+    // Offset of the cell in the tablet row.
+    size_t dst_offset;
+    int size;
+    bool is_binary;
+  };
+
+  // Returns true if the plan decodes rows with these bitmaps.
+  bool Matches(const uint8_t* client_isset_map, const uint8_t* client_null_map) const {
+    return memcmp(client_isset_map, client_isset_map_.data(), client_isset_map_.size()) == 0 &&
+        (client_null_map == nullptr ||
+         memcmp(client_null_map, client_null_map_.data(), client_null_map_.size()) == 0);
+  }
 
-  // Read the null and isset bitmaps for the client-provided row.
-  RETURN_NOT_OK(ReadIssetBitmap(&client_isset_map));
-  if (client_schema_->has_nullables()) {
-    RETURN_NOT_OK(ReadNullBitmap(&client_null_map));
+  faststring client_isset_map_;
+  faststring client_null_map_;
+
+  // The prototype row, with the null bits set as the client bitmaps require.
+  std::unique_ptr<uint8_t[]> prototype_row_;
+
+  // The tablet isset bitmap, shared by all the rows decoded with this plan.
+  const uint8_t* tablet_isset_bitmap_ = nullptr;
+
+  // The columns present in the encoded row, in order.
+  vector<Column> columns_;
+
+  // The total size of the encoded values.
+  size_t values_size_ = 0;
+};
+
+Status RowOperationsPBDecoder::PrepareInsertPlan(const uint8_t* prototype_row_storage,
+                                                 const ClientServerMapping& mapping,
+                                                 const uint8_t* client_isset_map,
+                                                 const uint8_t* client_null_map) {
+  unique_ptr<InsertDecodePlan> plan(new InsertDecodePlan);
+  plan->client_isset_map_.assign_copy(client_isset_map, bm_size_);
+  if (client_null_map) {
+    plan->client_null_map_.assign_copy(client_null_map, bm_size_);
   }
 
-  // Allocate a row with the tablet's layout.
-  uint8_t* tablet_row_storage = reinterpret_cast<uint8_t*>(
-      dst_arena_->AllocateBytesAligned(tablet_row_size_, 8));
+  // Start from the 'prototype' row which has been set with all of the
+  // server-side default values.
+  plan->prototype_row_.reset(new uint8_t[tablet_row_size_]);
+  memcpy(plan->prototype_row_.get(), prototype_row_storage, tablet_row_size_);
+  ContiguousRow tablet_row(tablet_schema_, plan->prototype_row_.get());
+
+  size_t isset_size = BitmapSize(tablet_schema_->num_columns());
   uint8_t* tablet_isset_bitmap = reinterpret_cast<uint8_t*>(
-      dst_arena_->AllocateBytes(BitmapSize(tablet_schema_->num_columns())));
-  if (PREDICT_FALSE(!tablet_row_storage || !tablet_isset_bitmap)) {
+      dst_arena_->AllocateBytes(isset_size));
+  if (PREDICT_FALSE(!tablet_isset_bitmap)) {
     return Status::RuntimeError("Out of memory");
   }
-
-  // Initialize the new row from the 'prototype' row which has been set
-  // with all of the server-side default values. This copy may be entirely
-  // overwritten in the case that all columns are specified, but this is
-  // still likely faster (and simpler) than looping through all the server-side
-  // columns to initialize defaults where non-set on every row.
-  memcpy(tablet_row_storage, prototype_row_storage, tablet_row_size_);
-  ContiguousRow tablet_row(tablet_schema_, tablet_row_storage);
+  memset(tablet_isset_bitmap, 0, isset_size);
 
   // Now handle each of the columns passed by the user, replacing the defaults
   // from the prototype.
@@ -368,17 +410,21 @@ Status RowOperationsPBDecoder::DecodeInsertOrUpsert(const uint8_t* prototype_row
     bool isset = BitmapTest(client_isset_map, client_col_idx);
     BitmapChange(tablet_isset_bitmap, tablet_col_idx, isset);
     if (isset) {
-      // If the client provided a value for this column, copy it.
+      // If the client provided a value for this column, it's copied for each
+      // row.
 
       // Copy null-ness, if the server side column is nullable.
-      bool client_set_to_null = col.is_nullable() &&
+      bool client_set_to_null = col.is_nullable() && client_null_map &&
         BitmapTest(client_null_map, client_col_idx);
       if (col.is_nullable()) {
         tablet_row.set_null(tablet_col_idx, client_set_to_null);
       }
       // Copy the value if it's not null
       if (!client_set_to_null) {
-        RETURN_NOT_OK(ReadColumn(col, tablet_row.mutable_cell_ptr(tablet_col_idx)));
+        int size = col.type_info()->size();
+        plan->columns_.push_back({ &col, tablet_schema_->column_offset(tablet_col_idx), size,
+                                   col.type_info()->physical_type() == BINARY });
+        plan->values_size_ += size;
       }
     } else {
       // If the client didn't provide a value, then the column must either be nullable or
@@ -393,8 +439,70 @@ Status RowOperationsPBDecoder::DecodeInsertOrUpsert(const uint8_t* prototype_row
     }
   }
 
+  plan->tablet_isset_bitmap_ = tablet_isset_bitmap;
+  insert_plan_ = std::move(plan);
+  return Status::OK();
+}
+
+Status RowOperationsPBDecoder::DecodeInsertOrUpsert(const uint8_t* prototype_row_storage,
+                                                    const ClientServerMapping& mapping,
+                                                    DecodedRowOperation* op) {
+  const uint8_t* client_isset_map;
+  const uint8_t* client_null_map = nullptr;
+
+  // Read the null and isset bitmaps for the client-provided row.
+  RETURN_NOT_OK(ReadIssetBitmap(&client_isset_map));
+  if (client_schema_->has_nullables()) {
+    RETURN_NOT_OK(ReadNullBitmap(&client_null_map));
+  }
+  if (!insert_plan_ || !insert_plan_->Matches(client_isset_map, client_null_map)) {
+    RETURN_NOT_OK(PrepareInsertPlan(prototype_row_storage, mapping,
+                                    client_isset_map, client_null_map));
+  }
+  const InsertDecodePlan& plan = *insert_plan_;
+
+  if (PREDICT_FALSE(src_.size() < plan.values_size_)) {
+    // Find the column that's cut short.
+    for (const auto& column : plan.columns_) {
+      if (src_.size() < column.size) {
+        return Status::Corruption("Not enough data for column", column.col->ToString());
+      }
+      src_.remove_prefix(column.size);
+    }
+    return Status::Corruption("Not enough data for row");
+  }
+
+  // Allocate a row with the tablet's layout.
+  uint8_t* tablet_row_storage = reinterpret_cast<uint8_t*>(
+      dst_arena_->AllocateBytesAligned(tablet_row_size_, 8));
+  if (PREDICT_FALSE(!tablet_row_storage)) {
+    return Status::RuntimeError("Out of memory");
+  }
+
+  // Initialize the new row from the plan's prototype row, which has the
+  // defaults and null bits in place. This copy may be entirely overwritten in
+  // the case that all columns are specified, but this is still likely faster
+  // (and simpler) than looping through all the server-side columns to
+  // initialize defaults where non-set on every row.
+  memcpy(tablet_row_storage, plan.prototype_row_.get(), tablet_row_size_);
+
+  // Now copy the values passed by the user.
+  const uint8_t* src = src_.data();
+  for (const auto& column : plan.columns_) {
+    uint8_t* dst = tablet_row_storage + column.dst_offset;
+    if (column.is_binary) {
+      Slice slice;
+      RETURN_NOT_OK(ResolveIndirectSlice(src, &slice));
+      memcpy(dst, &slice, sizeof(slice));
+    } else {
+      strings::memcpy_inlined(dst, src, column.size);
+    }
+    src += column.size;
+  }
+  src_.remove_prefix(plan.values_size_);
+
   op->row_data = tablet_row_storage;
-  op->isset_bitmap = tablet_isset_bitmap;
+  op->isset_bitmap = plan.tablet_isset_bitmap_;
   return Status::OK();
 }
 
@@ -455,8 +563,9 @@ Status RowOperationsPBDecoder::DecodeUpdateOrDelete(const ClientServerMapping& m
   // update to perform.
   // For DELETE, we expect no other columns to be set (and we verify that).
   if (op->type == RowOperationsPB::UPDATE) {
-    faststring buf;
+    faststring& buf = rcl_buf_;
     RowChangeListEncoder rcl_encoder(&buf);
+    rcl_encoder.Reset();
 
     // Now process the rest of columns as updates.
     for (; client_col_idx < client_schema_->num_columns(); client_col_idx++) {
@@ -25,6 +25,7 @@
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -36,6 +37,7 @@ class KuduPartialRow;
 class Schema;
 
 class ClientServerMapping;
+class InsertDecodePlan;
 
 class RowOperationsPBEncoder {
  public:
@@ -91,9 +93,21 @@ class RowOperationsPBDecoder {
   Status ReadColumn(const ColumnSchema& col, uint8_t* dst);
   bool HasNext() const;
 
+  // Decode the next encoded operation, which must be INSERT or UPSERT.
   Status DecodeInsertOrUpsert(const uint8_t* prototype_row_storage,
                               const ClientServerMapping& mapping,
                               DecodedRowOperation* op);
+
+  // Validate the columns of INSERT and UPSERT rows with the given client
+  // isset and null bitmaps, and set 'insert_plan_' to decode such rows.
+  Status PrepareInsertPlan(const uint8_t* prototype_row_storage,
+                           const ClientServerMapping& mapping,
+                           const uint8_t* client_isset_map,
+                           const uint8_t* client_null_map);
+
+  // Resolve the encoded Slice at 'src', whose pointer is an offset into the
+  // indirect data, into 'slice'.
+  Status ResolveIndirectSlice(const uint8_t* src, Slice* slice) const;
   //------------------------------------------------------------
   // Serialization/deserialization support
   //------------------------------------------------------------
@@ -115,6 +129,16 @@ class RowOperationsPBDecoder {
   const int tablet_row_size_;
   Slice src_;
 
+  // The plan for decoding INSERT and UPSERT rows whose bitmaps match the
+  // previous such row. Clients nearly always set the same columns in every
+  // row of a batch, so the validation and the column layout are worked out
+  // once per batch rather than once per row.
+  std::unique_ptr<InsertDecodePlan> insert_plan_;
+
+  // Scratch space for encoding the changelists of UPDATE rows, reused for
+  // every row so that it only needs to grow a few times per batch.
+  faststring rcl_buf_;
+
 
   DISALLOW_COPY_AND_ASSIGN(RowOperationsPBDecoder);
 };
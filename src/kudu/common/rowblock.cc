@@ -18,7 +18,6 @@
 
 #include <glog/logging.h>
 
-#include "kudu/gutil/bits.h"
 #include "kudu/util/bitmap.h"
 
 namespace kudu {
@@ -69,30 +68,16 @@ void SelectionVector::ClearToSelectAtMost(size_t max_rows) {
 }
 
 size_t SelectionVector::CountSelected() const {
-  return Bits::Count(&bitmap_[0], n_bytes_);
+  return BitmapCountSet(&bitmap_[0], n_rows_);
 }
 
 bool SelectionVector::AnySelected() const {
-  size_t rem = n_bytes_;
-  const uint32_t *p32 = reinterpret_cast<const uint32_t *>(
-    &bitmap_[0]);
-  while (rem >= 4) {
-    if (*p32 != 0) {
+  size_t n_words = (n_rows_ + 63) / 64;
+  for (size_t w = 0; w < n_words; w++) {
+    if (BitmapLoadWord(&bitmap_[0], n_rows_, w) != 0) {
       return true;
     }
-    p32++;
-    rem -= 4;
   }
-
-  const uint8_t *p8 = reinterpret_cast<const uint8_t *>(p32);
-  while (rem > 0) {
-    if (*p8 != 0) {
-      return true;
-    }
-    p8++;
-    rem--;
-  }
-
   return false;
 }
 
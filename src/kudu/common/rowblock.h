@@ -91,6 +91,16 @@ class SelectionVector {
     BitmapClear(&bitmap_[0], row);
   }
 
+  // Call 'func(row)' for each selected row, in increasing order. This skips
+  // over unselected rows a word at a time, so it's much faster than testing
+  // each row when few are selected.
+  //
+  // 'func' may unselect the row it's called with.
+  template<class F>
+  void ForEachSelectedRow(const F& func) const {
+    BitmapForEachSetBit(&bitmap_[0], n_rows_, func);
+  }
+
   uint8_t *mutable_bitmap() {
     return &bitmap_[0];
   }
@@ -0,0 +1,164 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/rowblock_checksum.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/int128.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+class RowBlockChecksumTest : public KuduTest {
+ public:
+  RowBlockChecksumTest()
+      : rand_(SeedRandom()),
+        schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("bool", BOOL, true /* nullable */),
+                  ColumnSchema("int16", INT16),
+                  ColumnSchema("int64", INT64, true /* nullable */),
+                  ColumnSchema("int128", INT128),
+                  ColumnSchema("double", DOUBLE, true /* nullable */),
+                  ColumnSchema("string", STRING, true /* nullable */),
+                  ColumnSchema("binary", BINARY) }, 1),
+        arena_(1024) {
+  }
+
+ protected:
+  // Fills 'block' with random rows, of which roughly half are selected.
+  void FillBlock(RowBlock* block) {
+    strs_.clear();
+    for (size_t i = 0; i < block->nrows(); i++) {
+      strs_.emplace_back(rand_.Uniform(40), 'a' + rand_.Uniform(26));
+    }
+    for (size_t i = 0; i < block->nrows(); i++) {
+      RowBlockRow row = block->row(i);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = rand_.Next();
+      *reinterpret_cast<bool*>(row.mutable_cell_ptr(1)) = rand_.OneIn(2);
+      row.cell(1).set_null(rand_.OneIn(3));
+      *reinterpret_cast<int16_t*>(row.mutable_cell_ptr(2)) = rand_.Next();
+      *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(3)) = rand_.Next64();
+      row.cell(3).set_null(rand_.OneIn(3));
+      *reinterpret_cast<int128_t*>(row.mutable_cell_ptr(4)) =
+          static_cast<int128_t>(rand_.Next64()) << 64 | rand_.Next64();
+      *reinterpret_cast<double*>(row.mutable_cell_ptr(5)) = rand_.NextDoubleFraction();
+      row.cell(5).set_null(rand_.OneIn(3));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(6)) = Slice(strs_[i]);
+      row.cell(6).set_null(rand_.OneIn(3));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(7)) = Slice(strs_[block->nrows() - 1 - i]);
+      if (rand_.OneIn(2)) {
+        block->selection_vector()->SetRowSelected(i);
+      } else {
+        block->selection_vector()->SetRowUnselected(i);
+      }
+    }
+  }
+
+  // The checksum of the selected rows of 'block', computed a row at a time
+  // by copying each row into a buffer.
+  static uint64_t RowwiseChecksum(const RowBlock& block, size_t num_columns) {
+    uint64_t agg_checksum = 0;
+    faststring buf;
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if (!block.selection_vector()->IsRowSelected(i)) continue;
+      RowBlockRow row = block.row(i);
+      buf.clear();
+      for (size_t j = 0; j < num_columns; j++) {
+        uint32_t col_index = static_cast<uint32_t>(j);
+        buf.append(&col_index, sizeof(col_index));
+        ColumnBlockCell cell = row.cell(j);
+        if (cell.is_nullable()) {
+          uint8_t is_defined = cell.is_null() ? 0 : 1;
+          buf.append(&is_defined, sizeof(is_defined));
+          if (!is_defined) continue;
+        }
+        if (cell.typeinfo()->physical_type() == BINARY) {
+          const Slice* data = reinterpret_cast<const Slice*>(cell.ptr());
+          buf.append(data->data(), data->size());
+        } else {
+          buf.append(cell.ptr(), cell.size());
+        }
+      }
+      uint64_t row_crc = 0;
+      crc::GetCrc32cInstance()->Compute(buf.data(), buf.size(), &row_crc, nullptr);
+      agg_checksum += static_cast<uint32_t>(row_crc);
+    }
+    return agg_checksum;
+  }
+
+  Random rand_;
+  const Schema schema_;
+  Arena arena_;
+  vector<string> strs_;
+};
+
+// Checksumming a column at a time must give the same results as checksumming
+// a row at a time, so that servers using either can be compared.
+TEST_F(RowBlockChecksumTest, TestMatchesRowwiseChecksum) {
+  RowBlockChecksummer checksummer;
+  RowBlock block(schema_, 1000, &arena_);
+  for (int trial = 0; trial < 10; trial++) {
+    FillBlock(&block);
+    for (size_t num_columns = 0; num_columns <= schema_.num_columns(); num_columns++) {
+      SCOPED_TRACE(num_columns);
+      uint64_t agg_checksum = 0;
+      int64_t rows = checksummer.Checksum(block, num_columns, &agg_checksum);
+      ASSERT_EQ(block.selection_vector()->CountSelected(), rows);
+      ASSERT_EQ(RowwiseChecksum(block, num_columns), agg_checksum);
+    }
+  }
+}
+
+// The checksums of several blocks accumulate, and blocks with no selected
+// rows contribute nothing.
+TEST_F(RowBlockChecksumTest, TestAccumulatesAcrossBlocks) {
+  RowBlockChecksummer checksummer;
+  RowBlock block(schema_, 100, &arena_);
+  uint64_t expected = 0;
+  uint64_t agg_checksum = 0;
+  for (int i = 0; i < 3; i++) {
+    FillBlock(&block);
+    expected += RowwiseChecksum(block, schema_.num_columns());
+    checksummer.Checksum(block, schema_.num_columns(), &agg_checksum);
+  }
+  ASSERT_EQ(expected, agg_checksum);
+
+  block.selection_vector()->SetAllFalse();
+  ASSERT_EQ(0, checksummer.Checksum(block, schema_.num_columns(), &agg_checksum));
+  ASSERT_EQ(expected, agg_checksum);
+}
+
+} // namespace kudu
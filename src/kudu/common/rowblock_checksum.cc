@@ -0,0 +1,209 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/rowblock_checksum.h"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+namespace {
+
+// The CRC registers hold the raw CRC32C state, which is the CRC value of the
+// bytes fed so far with its final inversion undone.
+constexpr uint32_t kCrcInversion = 0xffffffff;
+
+// Feeds 'length' bytes at 'data' into the CRC register 'crc'.
+inline uint32_t ExtendBytes(uint32_t crc, const uint8_t* data, size_t length) {
+#if defined(__SSE4_2__)
+  uint64_t crc64 = crc;
+  while (length >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += 8;
+    length -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+  while (length > 0) {
+    crc = _mm_crc32_u8(crc, *data++);
+    length--;
+  }
+  return crc;
+#else
+  return crc::Crc32c(data, length, crc ^ kCrcInversion) ^ kCrcInversion;
+#endif
+}
+
+// Feeds the 'size' bytes at 'data' into the CRC register 'crc', where 'size'
+// is known at compile time.
+template<size_t size>
+inline uint32_t ExtendFixed(uint32_t crc, const uint8_t* data) {
+  return ExtendBytes(crc, data, size);
+}
+
+#if defined(__SSE4_2__)
+template<>
+inline uint32_t ExtendFixed<1>(uint32_t crc, const uint8_t* data) {
+  return _mm_crc32_u8(crc, *data);
+}
+
+template<>
+inline uint32_t ExtendFixed<2>(uint32_t crc, const uint8_t* data) {
+  uint16_t v;
+  memcpy(&v, data, sizeof(v));
+  return _mm_crc32_u16(crc, v);
+}
+
+template<>
+inline uint32_t ExtendFixed<4>(uint32_t crc, const uint8_t* data) {
+  uint32_t v;
+  memcpy(&v, data, sizeof(v));
+  return _mm_crc32_u32(crc, v);
+}
+
+template<>
+inline uint32_t ExtendFixed<8>(uint32_t crc, const uint8_t* data) {
+  uint64_t v;
+  memcpy(&v, data, sizeof(v));
+  return static_cast<uint32_t>(_mm_crc32_u64(crc, v));
+}
+
+template<>
+inline uint32_t ExtendFixed<16>(uint32_t crc, const uint8_t* data) {
+  uint64_t lo;
+  uint64_t hi;
+  memcpy(&lo, data, sizeof(lo));
+  memcpy(&hi, data + sizeof(lo), sizeof(hi));
+  return static_cast<uint32_t>(_mm_crc32_u64(_mm_crc32_u64(crc, lo), hi));
+}
+#endif // defined(__SSE4_2__)
+
+// Feeds the column index and, for nullable columns, the is-defined byte of
+// the cell in row 'row' of 'col' into 'crc'. Returns false if the cell is null,
+// in which case it has no contents to feed.
+inline bool ExtendPrefix(const ColumnBlock& col, uint32_t col_index, size_t row,
+                         uint32_t* crc) {
+  *crc = ExtendFixed<sizeof(col_index)>(*crc, reinterpret_cast<const uint8_t*>(&col_index));
+  if (!col.is_nullable()) {
+    return true;
+  }
+  uint8_t is_defined = col.is_null(row) ? 0 : 1;
+  *crc = ExtendFixed<sizeof(is_defined)>(*crc, &is_defined);
+  return is_defined;
+}
+
+// Feeds column 'col_index' of the 'num_rows' rows in 'rows' into their
+// registers in 'crcs', for a column whose cells are 'size' bytes long.
+template<size_t size>
+void ExtendFixedColumn(const ColumnBlock& col, uint32_t col_index,
+                       const uint32_t* rows, size_t num_rows, uint32_t* crcs) {
+  for (size_t i = 0; i < num_rows; i++) {
+    if (ExtendPrefix(col, col_index, rows[i], &crcs[i])) {
+      crcs[i] = ExtendFixed<size>(crcs[i], col.cell_ptr(rows[i]));
+    }
+  }
+}
+
+// Like ExtendFixedColumn(), for a column of any cell size.
+void ExtendColumn(const ColumnBlock& col, uint32_t col_index,
+                  const uint32_t* rows, size_t num_rows, uint32_t* crcs) {
+  const size_t size = col.stride();
+  for (size_t i = 0; i < num_rows; i++) {
+    if (ExtendPrefix(col, col_index, rows[i], &crcs[i])) {
+      crcs[i] = ExtendBytes(crcs[i], col.cell_ptr(rows[i]), size);
+    }
+  }
+}
+
+// Like ExtendFixedColumn(), for a column of string or binary cells.
+void ExtendBinaryColumn(const ColumnBlock& col, uint32_t col_index,
+                        const uint32_t* rows, size_t num_rows, uint32_t* crcs) {
+  for (size_t i = 0; i < num_rows; i++) {
+    if (ExtendPrefix(col, col_index, rows[i], &crcs[i])) {
+      const Slice* data = reinterpret_cast<const Slice*>(col.cell_ptr(rows[i]));
+      crcs[i] = ExtendBytes(crcs[i], data->data(), data->size());
+    }
+  }
+}
+
+} // anonymous namespace
+
+int64_t RowBlockChecksummer::Checksum(const RowBlock& block, size_t num_columns,
+                                      uint64_t* agg_checksum) {
+  DCHECK_LE(num_columns, block.schema().num_columns());
+  rows_.clear();
+  block.selection_vector()->ForEachSelectedRow([&](size_t row) {
+    rows_.push_back(static_cast<uint32_t>(row));
+  });
+  const size_t num_rows = rows_.size();
+  if (num_rows == 0) {
+    return 0;
+  }
+  crcs_.assign(num_rows, kCrcInversion);
+
+  for (size_t j = 0; j < num_columns; j++) {
+    const ColumnBlock col = block.column_block(j);
+    const uint32_t col_index = static_cast<uint32_t>(j);
+    if (col.type_info()->physical_type() == BINARY) {
+      ExtendBinaryColumn(col, col_index, rows_.data(), num_rows, crcs_.data());
+      continue;
+    }
+    switch (col.stride()) {
+      case 1:
+        ExtendFixedColumn<1>(col, col_index, rows_.data(), num_rows, crcs_.data());
+        break;
+      case 2:
+        ExtendFixedColumn<2>(col, col_index, rows_.data(), num_rows, crcs_.data());
+        break;
+      case 4:
+        ExtendFixedColumn<4>(col, col_index, rows_.data(), num_rows, crcs_.data());
+        break;
+      case 8:
+        ExtendFixedColumn<8>(col, col_index, rows_.data(), num_rows, crcs_.data());
+        break;
+      case 16:
+        ExtendFixedColumn<16>(col, col_index, rows_.data(), num_rows, crcs_.data());
+        break;
+      default:
+        ExtendColumn(col, col_index, rows_.data(), num_rows, crcs_.data());
+        break;
+    }
+  }
+
+  uint64_t sum = 0;
+  for (uint32_t crc : crcs_) {
+    sum += crc ^ kCrcInversion;
+  }
+  *agg_checksum += sum;
+  return num_rows;
+}
+
+} // namespace kudu
@@ -0,0 +1,66 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+
+namespace kudu {
+
+class RowBlock;
+
+// Computes the checksums reported by checksum scans for the rows of RowBlocks.
+//
+// The checksum of a row is the CRC32C of the concatenation, over the columns
+// of the projection, of the index of the column as a uint32_t, then for
+// nullable columns a byte which is 1 if the cell is non-null and 0 otherwise,
+// then the contents of the cell unless it is null (for string and binary
+// cells, the contents of the slice). The checksum of a set of rows is the sum
+// of their row checksums, which doesn't depend on the order of the rows.
+//
+// Rather than copying each row into a buffer and checksumming the buffer, the
+// rows are checksummed a column at a time: a CRC register is kept for every
+// selected row, and the cells of each column are fed into the registers by a
+// loop specialized for the size of the column's cells. The results are the
+// same as checksumming the rows one at a time, so servers which checksum
+// either way can be compared with each other.
+//
+// This class is not thread-safe.
+class RowBlockChecksummer {
+ public:
+  RowBlockChecksummer() = default;
+
+  // Adds the checksums of the selected rows of 'block', projected to its first
+  // 'num_columns' columns, to 'agg_checksum'. Returns the number of rows which
+  // were checksummed.
+  int64_t Checksum(const RowBlock& block, size_t num_columns, uint64_t* agg_checksum);
+
+ private:
+  // The indexes of the selected rows of the block being checksummed.
+  std::vector<uint32_t> rows_;
+
+  // The CRC registers of the rows in 'rows_'.
+  std::vector<uint32_t> crcs_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowBlockChecksummer);
+};
+
+} // namespace kudu
@@ -197,6 +197,9 @@ void ScanSpec::PushPredicatesIntoPrimaryKeyBounds(const Schema& schema,
         // InBloomFilter predicates should not be removed as the full constraints imposed by bloom
         // filters cannot be translated into only a single set of lower and upper bound primary keys
         break;
+      } else if (type == PredicateType::Like) {
+        // Neither can the LIKE patterns, which only bound the keys by their literal prefixes.
+        break;
       } else {
         LOG(FATAL) << "Can not remove unknown predicate type";
       }
@@ -17,8 +17,10 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
@@ -32,6 +34,7 @@ class AutoReleasePool;
 class Arena;
 class EncodedKey;
 class Schema;
+class TopNThreshold;
 
 class ScanSpec {
  public:
@@ -133,6 +136,18 @@ class ScanSpec {
     return *limit_;
   }
 
+  // Sets the threshold of a top-N scan, which the scan raises as it finds
+  // better rows. The iterators of the rowsets whose remaining rows can't beat
+  // it stop early.
+  void set_top_n_threshold(std::shared_ptr<TopNThreshold> threshold) {
+    top_n_threshold_ = std::move(threshold);
+  }
+
+  // Returns the threshold of a top-N scan, or nullptr if this isn't one.
+  const std::shared_ptr<TopNThreshold>& top_n_threshold() const {
+    return top_n_threshold_;
+  }
+
   std::string ToString(const Schema& schema) const;
 
  private:
@@ -164,6 +179,7 @@ class ScanSpec {
   std::string exclusive_upper_bound_partition_key_;
   bool cache_blocks_;
   boost::optional<int64_t> limit_;
+  std::shared_ptr<TopNThreshold> top_n_threshold_;
 };
 
 } // namespace kudu
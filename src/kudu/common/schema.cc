@@ -75,10 +75,15 @@ string ColumnTypeAttributes::ToStringForType(DataType type) const {
 string ColumnStorageAttributes::ToString() const {
   const string cfile_block_size_str =
       cfile_block_size == 0 ? "" : Substitute(" $0", cfile_block_size);
-  return Substitute("$0 $1$2",
+  const string column_group_str =
+      column_group.empty() ? "" : Substitute(" GROUP($0)", column_group);
+  return Substitute("$0 $1$2$3$4$5",
                     EncodingType_Name(encoding),
                     CompressionType_Name(compression),
-                    cfile_block_size_str);
+                    cfile_block_size_str,
+                    bloom_filter ? " BLOOM_FILTER" : "",
+                    secondary_index ? " SECONDARY_INDEX" : "",
+                    column_group_str);
 }
 
 Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
@@ -115,6 +120,15 @@ Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
   if (col_delta.cfile_block_size) {
     attributes_.cfile_block_size = *col_delta.cfile_block_size;
   }
+  if (col_delta.bloom_filter) {
+    attributes_.bloom_filter = *col_delta.bloom_filter;
+  }
+  if (col_delta.secondary_index) {
+    attributes_.secondary_index = *col_delta.secondary_index;
+  }
+  if (col_delta.column_group) {
+    attributes_.column_group = *col_delta.column_group;
+  }
   return Status::OK();
 }
 
@@ -175,6 +189,8 @@ void Schema::CopyFrom(const Schema& other) {
   }
 
   has_nullables_ = other.has_nullables_;
+  key_encoders_ = other.key_encoders_;
+  fixed_encoded_key_size_ = other.fixed_encoded_key_size_;
 }
 
 Schema::Schema(Schema&& other) noexcept
@@ -188,7 +204,9 @@ Schema::Schema(Schema&& other) noexcept
                      NameToIndexMap::key_equal(),
                      NameToIndexMapAllocator(&name_to_index_bytes_)),
       id_to_index_(std::move(other.id_to_index_)),
-      has_nullables_(other.has_nullables_) {
+      has_nullables_(other.has_nullables_),
+      key_encoders_(std::move(other.key_encoders_)),
+      fixed_encoded_key_size_(other.fixed_encoded_key_size_) {
   // 'name_to_index_' uses a customer allocator which holds a pointer to
   // 'name_to_index_bytes_'. swap() will swap the contents but not the
   // allocators; std::move will move the allocator[1], which will mean the moved
@@ -210,6 +228,8 @@ Schema& Schema::operator=(Schema&& other) noexcept {
     col_offsets_ = std::move(other.col_offsets_);
     id_to_index_ = std::move(other.id_to_index_);
     has_nullables_ = other.has_nullables_;
+    key_encoders_ = std::move(other.key_encoders_);
+    fixed_encoded_key_size_ = other.fixed_encoded_key_size_;
 
     // See the comment in the move constructor implementation for why we swap.
     std::swap(name_to_index_bytes_, other.name_to_index_bytes_);
@@ -287,9 +307,32 @@ Status Schema::Reset(const vector<ColumnSchema>& cols,
     }
   }
 
+  InitKeyEncoders();
   return Status::OK();
 }
 
+void Schema::InitKeyEncoders() {
+  key_encoders_.clear();
+  key_encoders_.reserve(num_key_columns_);
+  fixed_encoded_key_size_ = 0;
+  bool all_fixed = true;
+  for (size_t i = 0; i < num_key_columns_; i++) {
+    const TypeInfo* ti = cols_[i].type_info();
+    if (!IsTypeAllowableInKey(ti)) {
+      key_encoders_.push_back(nullptr);
+      all_fixed = false;
+      continue;
+    }
+    const KeyEncoder<faststring>* encoder = &GetKeyEncoder<faststring>(ti);
+    key_encoders_.push_back(encoder);
+    all_fixed &= encoder->fixed_encoded_size() > 0;
+    fixed_encoded_key_size_ += encoder->fixed_encoded_size();
+  }
+  if (!all_fixed) {
+    fixed_encoded_key_size_ = 0;
+  }
+}
+
 Status Schema::CreateProjectionByNames(const std::vector<StringPiece>& col_names,
                                        Schema* out) const {
   vector<ColumnId> ids;
@@ -345,6 +388,15 @@ Status Schema::VerifyProjectionCompatibility(const Schema& projection) const {
 
   vector<string> missing_columns;
   for (const ColumnSchema& pcol : projection.columns()) {
+    if (pcol.type_info()->type() == IS_DELETED) {
+      // Virtual columns aren't in the schema, and are materialized from their
+      // read default where the iterators don't fill them in.
+      if (pcol.is_nullable() || !pcol.has_read_default()) {
+        return Status::InvalidArgument("The virtual column '" + pcol.name() +
+                                       "' must be non-nullable and have a read default");
+      }
+      continue;
+    }
     int index = find_column(pcol.name());
     if (index < 0) {
       missing_columns.push_back(pcol.name());
@@ -380,7 +432,14 @@ Status Schema::GetMappedReadProjection(const Schema& projection,
   mapped_cols.reserve(projection.num_columns());
   mapped_ids.reserve(projection.num_columns());
 
+  // Virtual columns get ids which no column of the schema has.
+  int32_t next_virtual_col_id = max_col_id() + 1;
   for (const ColumnSchema& col : projection.columns()) {
+    if (col.type_info()->type() == IS_DELETED) {
+      mapped_cols.push_back(col);
+      mapped_ids.emplace_back(next_virtual_col_id++);
+      continue;
+    }
     int index = find_column(col.name());
     DCHECK_GE(index, 0) << col.name();
     mapped_cols.push_back(cols_[index]);
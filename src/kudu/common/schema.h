@@ -43,6 +43,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -63,8 +64,6 @@
 
 namespace kudu {
 
-class Arena;
-
 // The ID of a column. Each column in a table has a unique ID.
 struct ColumnId {
   explicit ColumnId(int32_t t) : t_(t) {}
@@ -126,13 +125,17 @@ struct ColumnStorageAttributes {
   ColumnStorageAttributes()
     : encoding(AUTO_ENCODING),
       compression(DEFAULT_COMPRESSION),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      bloom_filter(false),
+      secondary_index(false) {
   }
 
   ColumnStorageAttributes(EncodingType enc, CompressionType cmp)
     : encoding(enc),
       compression(cmp),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      bloom_filter(false),
+      secondary_index(false) {
   }
 
   std::string ToString() const;
@@ -143,6 +146,19 @@ struct ColumnStorageAttributes {
   // The preferred block size for cfile blocks. If 0, uses the
   // server-wide default.
   int32_t cfile_block_size;
+
+  // Whether to write a bloom filter over the values of each cfile block.
+  // Ignored for key columns.
+  bool bloom_filter;
+
+  // Whether to write a secondary index from the values of the column to
+  // their row ordinals along with each rowset. Ignored for key columns.
+  bool secondary_index;
+
+  // The column group of the column, or empty if the column is stored on its
+  // own. The cfiles of the non-key columns of a group are stored back to
+  // back in a single block of each rowset. Ignored for key columns.
+  std::string column_group;
 };
 
 // A struct representing changes to a ColumnSchema.
@@ -174,6 +190,12 @@ public:
   boost::optional<EncodingType> encoding;
   boost::optional<CompressionType> compression;
   boost::optional<int32_t> cfile_block_size;
+  boost::optional<bool> bloom_filter;
+  boost::optional<bool> secondary_index;
+
+  // Not part of ColumnSchemaDeltaPB: the group of an existing column can't be
+  // altered. Only used to build new columns.
+  boost::optional<std::string> column_group;
 };
 
 // The schema for a given column.
@@ -419,7 +441,8 @@ class Schema {
                      NameToIndexMap::hasher(),
                      NameToIndexMap::key_equal(),
                      NameToIndexMapAllocator(&name_to_index_bytes_)),
-      has_nullables_(false) {
+      has_nullables_(false),
+      fixed_encoded_key_size_(0) {
   }
 
   Schema(const Schema& other);
@@ -712,17 +735,54 @@ class Schema {
   template <class RowType>
   Slice EncodeComparableKey(const RowType& row, faststring *dst) const {
     DCHECK_KEY_PROJECTION_SCHEMA_EQ(*this, *row.schema());
+    DCHECK_EQ(key_encoders_.size(), num_key_columns_);
+
+    if (fixed_encoded_key_size_ > 0) {
+      // The size of the encoded key is known up front, so the columns are
+      // encoded straight into the buffer.
+      dst->resize(fixed_encoded_key_size_);
+      uint8_t* end = EncodeKeyColumnsToBuffer(row, dst->data());
+      DCHECK_EQ(end, dst->data() + dst->size());
+      return Slice(*dst);
+    }
 
     dst->clear();
     for (size_t i = 0; i < num_key_columns_; i++) {
-      DCHECK(!cols_[i].is_nullable());
-      const TypeInfo* ti = cols_[i].type_info();
+      DCHECK(key_encoders_[i]);
       bool is_last = i == num_key_columns_ - 1;
-      GetKeyEncoder<faststring>(ti).Encode(row.cell_ptr(i), is_last, dst);
+      key_encoders_[i]->Encode(row.cell_ptr(i), is_last, dst);
     }
     return Slice(*dst);
   }
 
+  // Like the above, but encodes the key into memory allocated from 'arena',
+  // and points 'encoded' at it. Keys with string columns may leave some of
+  // the allocated memory unused.
+  //
+  // Returns a bad Status if the allocation fails.
+  template <class RowType>
+  Status EncodeComparableKey(const RowType& row, Arena* arena, Slice* encoded) const {
+    DCHECK_KEY_PROJECTION_SCHEMA_EQ(*this, *row.schema());
+    DCHECK_EQ(key_encoders_.size(), num_key_columns_);
+
+    size_t max_size = fixed_encoded_key_size_;
+    if (max_size == 0) {
+      for (size_t i = 0; i < num_key_columns_; i++) {
+        DCHECK(key_encoders_[i]);
+        bool is_last = i == num_key_columns_ - 1;
+        max_size += key_encoders_[i]->MaxEncodedSize(row.cell_ptr(i), is_last);
+      }
+    }
+    uint8_t* buf = static_cast<uint8_t*>(arena->AllocateBytes(max_size));
+    if (PREDICT_FALSE(buf == nullptr && max_size > 0)) {
+      return Status::RuntimeError("OOM while encoding key");
+    }
+    uint8_t* end = EncodeKeyColumnsToBuffer(row, buf);
+    DCHECK_LE(end - buf, max_size);
+    *encoded = Slice(buf, end - buf);
+    return Status::OK();
+  }
+
   // Enum to configure how a Schema is stringified.
   enum class ToStringMode {
     // Include column ids if this instance has them.
@@ -881,6 +941,22 @@ class Schema {
     return ret;
   }
 
+  // Encodes the key columns of 'row' into 'dst', which must have room for
+  // the encoded key, and returns the end of the encoded key.
+  template<class RowType>
+  uint8_t* EncodeKeyColumnsToBuffer(const RowType& row, uint8_t* dst) const {
+    for (size_t i = 0; i < num_key_columns_; i++) {
+      DCHECK(key_encoders_[i]);
+      bool is_last = i == num_key_columns_ - 1;
+      dst = key_encoders_[i]->EncodeToBuffer(row.cell_ptr(i), is_last, dst);
+    }
+    return dst;
+  }
+
+  // Resolves the key encoders of the key columns. Called whenever the
+  // columns change.
+  void InitKeyEncoders();
+
   friend class SchemaBuilder;
 
   std::vector<ColumnSchema> cols_;
@@ -911,6 +987,14 @@ class Schema {
   // Cached indicator whether any columns are nullable.
   bool has_nullables_;
 
+  // The encoders of the key columns, resolved once rather than for every
+  // encoded key. An entry is null if its type is not allowed in keys.
+  std::vector<const KeyEncoder<faststring>*> key_encoders_;
+
+  // The size of every encoded key if all key columns have fixed-size
+  // encodings, or 0 otherwise.
+  size_t fixed_encoded_key_size_;
+
   // NOTE: if you add more members, make sure to add the appropriate code to
   // CopyFrom() and the move constructor and assignment operator as well, to
   // prevent subtle bugs.
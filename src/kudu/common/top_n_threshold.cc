@@ -0,0 +1,71 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/top_n_threshold.h"
+
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include "kudu/util/slice.h"
+
+using std::string;
+
+namespace kudu {
+
+TopNThreshold::TopNThreshold(ColumnSchema column, bool descending)
+    : column_(std::move(column)),
+      descending_(descending),
+      version_(0) {
+}
+
+void TopNThreshold::Update(const void* value) {
+  const TypeInfo* type_info = column_.type_info();
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (type_info->physical_type() == BINARY) {
+    const Slice* slice = static_cast<const Slice*>(value);
+    value_.assign(reinterpret_cast<const char*>(slice->data()), slice->size());
+  } else {
+    value_.assign(static_cast<const char*>(value), type_info->size());
+  }
+  version_.fetch_add(1, std::memory_order_release);
+}
+
+boost::optional<ColumnPredicate> TopNThreshold::BeatingValuesPredicate(Bound* bound) const {
+  const TypeInfo* type_info = column_.type_info();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (version_.load(std::memory_order_relaxed) == 0) {
+      return boost::none;
+    }
+    bound->data = value_;
+  }
+  if (type_info->physical_type() == BINARY) {
+    Slice slice(bound->data);
+    memcpy(bound->cell, &slice, sizeof(slice));
+  } else {
+    memcpy(bound->cell, bound->data.data(), type_info->size());
+  }
+  // Values up to (or, for descending scans, from) the threshold. The range is
+  // inclusive of the threshold for descending scans, which is conservative.
+  if (descending_) {
+    return ColumnPredicate::Range(column_, bound->cell, nullptr);
+  }
+  return ColumnPredicate::Range(column_, nullptr, bound->cell);
+}
+
+} // namespace kudu
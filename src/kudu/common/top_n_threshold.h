@@ -0,0 +1,93 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <boost/optional/optional.hpp>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/util/locks.h"
+
+namespace kudu {
+
+// The worst value a row needs in a column to be among the N rows a top-N scan
+// keeps: the value of the N-th best row seen so far, where a row is better
+// than another if its value is smaller (or, for descending scans, larger).
+// Rows whose value is null are worse than all others.
+//
+// The scan updates the threshold as it finds better rows, while the iterators
+// of the rowsets read it to stop early once none of their remaining rows can
+// beat it. See ScanSpec::set_top_n_threshold().
+//
+// This class is thread-safe.
+class TopNThreshold {
+ public:
+  TopNThreshold(ColumnSchema column, bool descending);
+
+  const ColumnSchema& column() const {
+    return column_;
+  }
+
+  bool descending() const {
+    return descending_;
+  }
+
+  // Sets the threshold to the non-null cell 'value' of the column, which is
+  // copied. The threshold must only ever get better.
+  void Update(const void* value);
+
+  // Returns how many times the threshold was updated, so that readers may
+  // skip re-evaluating an unchanged threshold.
+  int64_t version() const {
+    return version_.load(std::memory_order_acquire);
+  }
+
+  // Storage for the bound of a predicate returned by BeatingValuesPredicate().
+  struct Bound {
+    // The cell, which for string and binary columns is a slice of 'data'.
+    alignas(16) uint8_t cell[kLargestTypeSize];
+    std::string data;
+  };
+
+  // Returns a predicate whose values include all the values which beat the
+  // threshold, or boost::none if there is no threshold yet. The bound of the
+  // predicate is copied into 'bound', which must outlive it.
+  //
+  // The predicate may also match values equal to the threshold, which is
+  // harmless since it is only used to rule out rows.
+  boost::optional<ColumnPredicate> BeatingValuesPredicate(Bound* bound) const;
+
+ private:
+  const ColumnSchema column_;
+  const bool descending_;
+
+  mutable simple_spinlock lock_;
+
+  // The raw cell contents of the threshold, or for string and binary columns
+  // the contents of the slice. Empty if 'version_' is 0.
+  std::string value_;
+
+  std::atomic<int64_t> version_;
+};
+
+} // namespace kudu
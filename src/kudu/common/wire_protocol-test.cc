@@ -34,6 +34,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/faststring.h"
@@ -49,6 +50,7 @@
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 
@@ -337,6 +339,177 @@ TEST_F(WireProtocolTest, TestColumnarRowBlockToPBWithPadding) {
   }
 }
 
+// Test serializing the selected rows of several row blocks in columnar layout.
+TEST_F(WireProtocolTest, TestColumnarSerializedBatch) {
+  const int kNumRows = 10;
+  const int kNumBlocks = 2;
+  Arena arena(1024);
+  Schema tablet_schema({ ColumnSchema("key", INT32),
+                         ColumnSchema("str", STRING, true /* nullable */),
+                         ColumnSchema("val", INT64, true /* nullable */) }, 1);
+  RowBlock block(tablet_schema, kNumRows, &arena);
+  block.selection_vector()->SetAllTrue();
+  // Deselect a row so that the rows of the second block don't start on a
+  // byte boundary of the bitmaps.
+  block.selection_vector()->SetRowUnselected(3);
+  vector<string> strs;
+  for (int i = 0; i < kNumRows; i++) {
+    strs.emplace_back(i, 'x');
+  }
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = Slice(strs[i]);
+    row.cell(1).set_null(i % 3 == 0);
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = i * 10;
+    row.cell(2).set_null(i % 2 == 0);
+  }
+
+  // The projection has the columns in a different order from the block.
+  Schema proj_schema({ ColumnSchema("val", INT64, true /* nullable */),
+                       ColumnSchema("str", STRING, true /* nullable */),
+                       ColumnSchema("key", INT32) }, 0);
+  ColumnarSerializedBatch batch(proj_schema);
+  for (int i = 0; i < kNumBlocks; i++) {
+    batch.AddRowBlock(block);
+  }
+  const int kNumSelected = kNumRows - 1;
+  ASSERT_EQ(kNumSelected * kNumBlocks, batch.num_rows());
+
+  const auto& cols = *batch.mutable_columns();
+  ASSERT_EQ(3, cols.size());
+  const auto& val_col = cols[0];
+  const auto& str_col = cols[1];
+  const auto& key_col = cols[2];
+  ASSERT_EQ(batch.num_rows() * sizeof(int64_t), val_col.data->size());
+  ASSERT_EQ(BitmapSize(batch.num_rows()), val_col.non_null_bitmap->size());
+  ASSERT_FALSE(val_col.varlen_data);
+  ASSERT_EQ((batch.num_rows() + 1) * sizeof(uint32_t), str_col.data->size());
+  ASSERT_EQ(BitmapSize(batch.num_rows()), str_col.non_null_bitmap->size());
+  ASSERT_EQ(batch.num_rows() * sizeof(int32_t), key_col.data->size());
+  ASSERT_FALSE(key_col.non_null_bitmap);
+  ASSERT_FALSE(key_col.varlen_data);
+
+  const int64_t* vals = reinterpret_cast<const int64_t*>(val_col.data->data());
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(str_col.data->data());
+  const int32_t* keys = reinterpret_cast<const int32_t*>(key_col.data->data());
+  EXPECT_EQ(0, offsets[0]);
+  int dst_idx = 0;
+  for (int b = 0; b < kNumBlocks; b++) {
+    for (int i = 0; i < kNumRows; i++) {
+      if (i == 3) continue;
+      SCOPED_TRACE(dst_idx);
+      EXPECT_EQ(i, keys[dst_idx]);
+
+      bool val_is_null = i % 2 == 0;
+      EXPECT_EQ(!val_is_null, BitmapTest(val_col.non_null_bitmap->data(), dst_idx));
+      EXPECT_EQ(val_is_null ? 0 : i * 10, vals[dst_idx]);
+
+      bool str_is_null = i % 3 == 0;
+      EXPECT_EQ(!str_is_null, BitmapTest(str_col.non_null_bitmap->data(), dst_idx));
+      Slice str(str_col.varlen_data->data() + offsets[dst_idx],
+                offsets[dst_idx + 1] - offsets[dst_idx]);
+      EXPECT_EQ(str_is_null ? "" : strs[i], str.ToString());
+      dst_idx++;
+    }
+  }
+  EXPECT_EQ(str_col.varlen_data->size(), offsets[batch.num_rows()]);
+  EXPECT_EQ(batch.TotalSizeBytes(),
+            val_col.data->size() + val_col.non_null_bitmap->size() +
+            str_col.data->size() + str_col.varlen_data->size() +
+            str_col.non_null_bitmap->size() + key_col.data->size());
+}
+
+// Test serializing variable-length columns as dictionaries and codes, and
+// falling back to the plain layout when the values don't repeat.
+TEST_F(WireProtocolTest, TestColumnarSerializedBatchDictionaryEncoding) {
+  const int kNumRows = 10;
+  Arena arena(1024);
+  Schema schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("str", STRING, true /* nullable */) }, 1);
+  const vector<string> kValues = { "foo", "bar", "baz" };
+  RowBlock block(schema, kNumRows, &arena);
+  block.selection_vector()->SetAllTrue();
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = Slice(kValues[i % kValues.size()]);
+    row.cell(1).set_null(i % 4 == 0);
+  }
+
+  ColumnarSerializedBatch batch(schema, true /* dictionary_encode */);
+  batch.AddRowBlock(block);
+  batch.AddRowBlock(block);
+  ASSERT_EQ(kNumRows * 2, batch.num_rows());
+  const auto& cols = *batch.mutable_columns();
+  ASSERT_FALSE(cols[0].dictionary_offsets);
+  const auto& str_col = cols[1];
+  ASSERT_TRUE(str_col.dictionary_offsets);
+  ASSERT_EQ(batch.num_rows() * sizeof(uint32_t), str_col.data->size());
+
+  // The dictionary holds each non-NULL value once, in order of appearance.
+  ASSERT_EQ((kValues.size() + 1) * sizeof(uint32_t), str_col.dictionary_offsets->size());
+  const uint32_t* dict_offsets = reinterpret_cast<const uint32_t*>(
+      str_col.dictionary_offsets->data());
+  EXPECT_EQ(str_col.varlen_data->size(), dict_offsets[kValues.size()]);
+  const uint32_t* codes = reinterpret_cast<const uint32_t*>(str_col.data->data());
+  for (int row = 0; row < batch.num_rows(); row++) {
+    SCOPED_TRACE(row);
+    int i = row % kNumRows;
+    bool is_null = i % 4 == 0;
+    ASSERT_EQ(!is_null, BitmapTest(str_col.non_null_bitmap->data(), row));
+    if (is_null) {
+      EXPECT_EQ(0, codes[row]);
+      continue;
+    }
+    uint32_t code = codes[row];
+    ASSERT_LT(code, kValues.size());
+    Slice value(str_col.varlen_data->data() + dict_offsets[code],
+                dict_offsets[code + 1] - dict_offsets[code]);
+    EXPECT_EQ(kValues[i % kValues.size()], value.ToString());
+  }
+  EXPECT_EQ(batch.TotalSizeBytes(),
+            cols[0].data->size() + str_col.data->size() + str_col.varlen_data->size() +
+            str_col.non_null_bitmap->size() + str_col.dictionary_offsets->size());
+
+  // Add a block of distinct values, large enough for the column to fall back
+  // to the plain layout.
+  const int kNumDistinctRows = 1024;
+  RowBlock distinct_block(schema, kNumDistinctRows, &arena);
+  distinct_block.selection_vector()->SetAllTrue();
+  vector<string> distinct_values;
+  for (int i = 0; i < kNumDistinctRows; i++) {
+    distinct_values.emplace_back(Substitute("value $0", i));
+  }
+  for (int i = 0; i < kNumDistinctRows; i++) {
+    RowBlockRow row = distinct_block.row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = Slice(distinct_values[i]);
+    row.cell(1).set_null(false);
+  }
+  batch.AddRowBlock(distinct_block);
+  ASSERT_EQ(kNumRows * 2 + kNumDistinctRows, batch.num_rows());
+  ASSERT_FALSE(str_col.dictionary_offsets);
+  ASSERT_EQ((batch.num_rows() + 1) * sizeof(uint32_t), str_col.data->size());
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(str_col.data->data());
+  EXPECT_EQ(0, offsets[0]);
+  for (int row = 0; row < batch.num_rows(); row++) {
+    SCOPED_TRACE(row);
+    string expected;
+    if (row < kNumRows * 2) {
+      int i = row % kNumRows;
+      if (i % 4 != 0) {
+        expected = kValues[i % kValues.size()];
+      }
+    } else {
+      expected = distinct_values[row - kNumRows * 2];
+    }
+    Slice value(str_col.varlen_data->data() + offsets[row], offsets[row + 1] - offsets[row]);
+    EXPECT_EQ(expected, value.ToString());
+  }
+  EXPECT_EQ(str_col.varlen_data->size(), offsets[batch.num_rows()]);
+}
+
 #ifdef NDEBUG
 TEST_F(WireProtocolTest, TestColumnarRowBlockToPBBenchmark) {
   Arena arena(1024);
@@ -447,6 +620,57 @@ TEST_F(WireProtocolTest, TestColumnDefaultValue) {
   ASSERT_EQ(write_default_u32, *static_cast<const uint32_t *>(col5fpb.write_default_value()));
 }
 
+TEST_F(WireProtocolTest, TestColumnBloomFilterAttribute) {
+  ColumnSchemaPB pb;
+  ColumnSchema col1("col1", INT64);
+  ColumnSchemaToPB(col1, &pb);
+  ASSERT_FALSE(pb.has_bloom_filter());
+  ASSERT_FALSE(ColumnSchemaFromPB(pb).attributes().bloom_filter);
+
+  ColumnStorageAttributes attrs;
+  attrs.bloom_filter = true;
+  ColumnSchema col2("col2", INT64, false, nullptr, nullptr, attrs);
+  ColumnSchemaToPB(col2, &pb);
+  ASSERT_TRUE(ColumnSchemaFromPB(pb).attributes().bloom_filter);
+
+  ColumnSchemaDelta delta("col1");
+  delta.bloom_filter = true;
+  ColumnSchemaDeltaPB delta_pb;
+  ColumnSchemaDeltaToPB(delta, &delta_pb);
+  ASSERT_OK(col1.ApplyDelta(ColumnSchemaDeltaFromPB(delta_pb)));
+  ASSERT_TRUE(col1.attributes().bloom_filter);
+  ASSERT_FALSE(col1.attributes().secondary_index);
+
+  attrs.secondary_index = true;
+  ColumnSchema col3("col3", STRING, false, nullptr, nullptr, attrs);
+  ColumnSchemaToPB(col3, &pb);
+  ASSERT_TRUE(pb.secondary_index());
+  ASSERT_TRUE(ColumnSchemaFromPB(pb).attributes().secondary_index);
+  delta.secondary_index = true;
+  ColumnSchemaDeltaToPB(delta, &delta_pb);
+  ASSERT_OK(col1.ApplyDelta(ColumnSchemaDeltaFromPB(delta_pb)));
+  ASSERT_TRUE(col1.attributes().secondary_index);
+}
+
+TEST_F(WireProtocolTest, TestColumnGroupAttribute) {
+  ColumnSchemaPB pb;
+  ColumnSchema col1("col1", INT64);
+  ColumnSchemaToPB(col1, &pb);
+  ASSERT_FALSE(pb.has_column_group());
+  ASSERT_TRUE(ColumnSchemaFromPB(pb).attributes().column_group.empty());
+
+  ColumnStorageAttributes attrs;
+  attrs.column_group = "g";
+  ColumnSchema col2("col2", INT64, false, nullptr, nullptr, attrs);
+  ColumnSchemaToPB(col2, &pb);
+  ASSERT_EQ("g", pb.column_group());
+  ASSERT_EQ("g", ColumnSchemaFromPB(pb).attributes().column_group);
+
+  // The group is a storage attribute.
+  ColumnSchemaToPB(col2, &pb, SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES);
+  ASSERT_FALSE(pb.has_column_group());
+}
+
 TEST_F(WireProtocolTest, TestColumnPredicateInList) {
   ColumnSchema col1("col1", INT32);
   vector<ColumnSchema> cols = { col1 };
@@ -505,6 +729,46 @@ TEST_F(WireProtocolTest, TestColumnPredicateInList) {
   }
 }
 
+TEST_F(WireProtocolTest, TestColumnPredicateLike) {
+  ColumnSchema col1("col1", INT32);
+  ColumnSchema col2("col2", STRING);
+  vector<ColumnSchema> cols = { col1, col2 };
+  Schema schema(cols, 1);
+  Arena arena(1024);
+  boost::optional<ColumnPredicate> predicate;
+
+  { // col2 LIKE 'ab%c' AND col2 LIKE '%b_c' AND col2 >= 'abb'
+    ColumnPredicate cp = ColumnPredicate::Like(col2, "ab%c", &arena);
+    cp.Merge(ColumnPredicate::Like(col2, "%b_c", &arena));
+    Slice lower("abb");
+    cp.Merge(ColumnPredicate::Range(col2, &lower, nullptr));
+    ASSERT_EQ(PredicateType::Like, cp.predicate_type());
+
+    ColumnPredicatePB pb;
+    ASSERT_NO_FATAL_FAILURE(ColumnPredicateToPB(cp, &pb));
+    ASSERT_EQ(2, pb.like().patterns_size());
+    ASSERT_TRUE(pb.like().has_lower());
+    ASSERT_TRUE(pb.like().has_upper());
+
+    ASSERT_OK(ColumnPredicateFromPB(schema, &arena, pb, &predicate));
+    ASSERT_EQ(cp, *predicate);
+  }
+
+  { // LIKE on a non-string column
+    ColumnPredicatePB pb;
+    pb.set_column("col1");
+    pb.mutable_like()->add_patterns("1%");
+    ASSERT_TRUE(ColumnPredicateFromPB(schema, &arena, pb, &predicate).IsInvalidArgument());
+  }
+
+  { // LIKE without patterns
+    ColumnPredicatePB pb;
+    pb.set_column("col2");
+    pb.mutable_like();
+    ASSERT_TRUE(ColumnPredicateFromPB(schema, &arena, pb, &predicate).IsInvalidArgument());
+  }
+}
+
 class BFWireProtocolTest : public KuduTest {
  public:
   BFWireProtocolTest()
@@ -569,6 +833,44 @@ TEST_F(BFWireProtocolTest, TestColumnPredicateBloomFilter) {
   }
 }
 
+TEST_F(BFWireProtocolTest, TestColumnPredicateSplitBlockBloomFilter) {
+  boost::optional<ColumnPredicate> predicate;
+  ColumnSchema col1 = schema_.column(0);
+  BloomFilterBuilder bfb(BloomFilterSizing::ByCountAndFPRate(n_keys_, 0.01),
+                         BloomFilterLayout::kSplitBlock);
+  for (int i = 0; i < n_keys_; ++i) {
+    Slice key_slice(reinterpret_cast<const uint8_t*>(&i), sizeof(i));
+    bfb.AddKey(BloomKeyProbe(key_slice, MURMUR_HASH_2));
+  }
+  { // The layout survives the round trip.
+    vector<kudu::ColumnPredicate::BloomFilterInner> bfs;
+    bfs.emplace_back(bfb.slice(), bfb.n_hashes(), MURMUR_HASH_2, BloomFilterLayout::kSplitBlock);
+    bfs.emplace_back(bfb1()->slice(), bfb1()->n_hashes(), MURMUR_HASH_2);
+    kudu::ColumnPredicate ibf = kudu::ColumnPredicate::InBloomFilter(col1, &bfs, nullptr, nullptr);
+    ColumnPredicatePB pb;
+    NO_FATALS(ColumnPredicateToPB(ibf, &pb));
+    ASSERT_EQ(ColumnPredicatePB::BloomFilter::SPLIT_BLOCK,
+              pb.in_bloom_filter().bloom_filters(0).layout());
+    ASSERT_EQ(ColumnPredicatePB::BloomFilter::CLASSIC,
+              pb.in_bloom_filter().bloom_filters(1).layout());
+    ASSERT_OK(ColumnPredicateFromPB(schema_, &arena_, pb, &predicate));
+    ASSERT_EQ(predicate->predicate_type(), PredicateType::InBloomFilter);
+    ASSERT_EQ(BloomFilterLayout::kSplitBlock, predicate->bloom_filters()[0].layout());
+    ASSERT_EQ(BloomFilterLayout::kClassic, predicate->bloom_filters()[1].layout());
+    ASSERT_EQ(predicate, ibf);
+  }
+
+  { // A split-block filter must be made of whole buckets.
+    vector<kudu::ColumnPredicate::BloomFilterInner> bfs;
+    bfs.emplace_back(bfb.slice(), bfb.n_hashes(), MURMUR_HASH_2, BloomFilterLayout::kSplitBlock);
+    kudu::ColumnPredicate ibf = kudu::ColumnPredicate::InBloomFilter(col1, &bfs, nullptr, nullptr);
+    ColumnPredicatePB pb;
+    NO_FATALS(ColumnPredicateToPB(ibf, &pb));
+    pb.mutable_in_bloom_filter()->mutable_bloom_filters(0)->mutable_bloom_data()->pop_back();
+    ASSERT_TRUE(ColumnPredicateFromPB(schema_, &arena_, pb, &predicate).IsInvalidArgument());
+  }
+}
+
 TEST_F(BFWireProtocolTest, TestColumnPredicateBloomFilterWithBound) {
   boost::optional<ColumnPredicate> predicate;
   ColumnSchema col1 = schema_.column(0);
@@ -19,12 +19,15 @@
 
 #include <cstdint>
 #include <cstring>
+#include <limits>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
+#include <sparsehash/dense_hash_map>
 
 #include "kudu/common/columnblock.h"
 #include "kudu/common/column_predicate.h"
@@ -36,10 +39,13 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/gutil/fixedarray.h"
+#include "kudu/gutil/hash/hash.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/fastmem.h"
+#include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
@@ -53,6 +59,7 @@ using google::protobuf::RepeatedPtrField;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -223,6 +230,15 @@ void ColumnSchemaToPB(const ColumnSchema& col_schema, ColumnSchemaPB *pb, int fl
     pb->set_encoding(col_schema.attributes().encoding);
     pb->set_compression(col_schema.attributes().compression);
     pb->set_cfile_block_size(col_schema.attributes().cfile_block_size);
+    if (col_schema.attributes().bloom_filter) {
+      pb->set_bloom_filter(true);
+    }
+    if (col_schema.attributes().secondary_index) {
+      pb->set_secondary_index(true);
+    }
+    if (!col_schema.attributes().column_group.empty()) {
+      pb->set_column_group(col_schema.attributes().column_group);
+    }
   }
   if (col_schema.has_read_default()) {
     if (col_schema.type_info()->physical_type() == BINARY) {
@@ -288,6 +304,15 @@ ColumnSchema ColumnSchemaFromPB(const ColumnSchemaPB& pb) {
   if (pb.has_cfile_block_size()) {
     attributes.cfile_block_size = pb.cfile_block_size();
   }
+  if (pb.has_bloom_filter()) {
+    attributes.bloom_filter = pb.bloom_filter();
+  }
+  if (pb.has_secondary_index()) {
+    attributes.secondary_index = pb.secondary_index();
+  }
+  if (pb.has_column_group()) {
+    attributes.column_group = pb.column_group();
+  }
   return ColumnSchema(pb.name(), pb.type(), pb.is_nullable(),
                       read_default_ptr, write_default_ptr,
                       attributes, type_attributes);
@@ -315,6 +340,12 @@ void ColumnSchemaDeltaToPB(const ColumnSchemaDelta& col_delta, ColumnSchemaDelta
   if (col_delta.cfile_block_size) {
     pb->set_block_size(*col_delta.cfile_block_size);
   }
+  if (col_delta.bloom_filter) {
+    pb->set_bloom_filter(*col_delta.bloom_filter);
+  }
+  if (col_delta.secondary_index) {
+    pb->set_secondary_index(*col_delta.secondary_index);
+  }
 }
 
 ColumnSchemaDelta ColumnSchemaDeltaFromPB(const ColumnSchemaDeltaPB& pb) {
@@ -337,6 +368,12 @@ ColumnSchemaDelta ColumnSchemaDeltaFromPB(const ColumnSchemaDeltaPB& pb) {
   if (pb.has_block_size()) {
     col_delta.cfile_block_size = boost::optional<int32_t>(pb.block_size());
   }
+  if (pb.has_bloom_filter()) {
+    col_delta.bloom_filter = boost::optional<bool>(pb.bloom_filter());
+  }
+  if (pb.has_secondary_index()) {
+    col_delta.secondary_index = boost::optional<bool>(pb.secondary_index());
+  }
   return col_delta;
 }
 
@@ -417,6 +454,9 @@ void CopyPredicateBloomFilterToPB(const ColumnPredicate::BloomFilterInner& bf_sr
   size_t size = bf_src.bloom_data().size();
   bf_dst->mutable_bloom_data()->assign(reinterpret_cast<const char*>(src), size);
   bf_dst->set_hash_algorithm(bf_src.hash_algorithm());
+  if (bf_src.layout() == BloomFilterLayout::kSplitBlock) {
+    bf_dst->set_layout(ColumnPredicatePB::BloomFilter::SPLIT_BLOCK);
+  }
 }
 
 // Extract a void* pointer suitable for use in a ColumnRangePredicate from the
@@ -455,6 +495,17 @@ Status CopyPredicateBloomFilterFromPB(const ColumnPredicatePB::BloomFilter& bf_s
                                       ColumnPredicate::BloomFilterInner* dst_src,
                                       Arena* arena) {
   size_t bloom_data_size = bf_src.bloom_data().size();
+  if (bf_src.layout() == ColumnPredicatePB::BloomFilter::SPLIT_BLOCK) {
+    if (bloom_data_size == 0 || bloom_data_size % bloom_internal::kSplitBlockBucketBytes != 0) {
+      return Status::InvalidArgument(
+          strings::Substitute("Invalid split-block bloom filter of $0 bytes: size must be "
+                              "a positive multiple of $1 bytes",
+                              bloom_data_size, bloom_internal::kSplitBlockBucketBytes));
+    }
+    dst_src->set_layout(BloomFilterLayout::kSplitBlock);
+  } else {
+    dst_src->set_layout(BloomFilterLayout::kClassic);
+  }
   dst_src->set_nhash(bf_src.nhash());
   // Copy the data from the protobuf into the Arena.
   uint8_t* data_copy = static_cast<uint8_t*>(arena->AllocateBytes(bloom_data_size));
@@ -525,6 +576,26 @@ void ColumnPredicateToPB(const ColumnPredicate& predicate,
       }
       return;
     }
+    case PredicateType::Like: {
+      auto* like_pred = pb->mutable_like();
+      for (const auto& pattern : predicate.like_patterns()) {
+        like_pred->add_patterns(pattern->pattern());
+      }
+      for (const auto& bf : predicate.bloom_filters()) {
+        CopyPredicateBloomFilterToPB(bf, like_pred->add_bloom_filters());
+      }
+      if (predicate.raw_lower() != nullptr) {
+        CopyPredicateBoundToPB(predicate.column(),
+                               predicate.raw_lower(),
+                               like_pred->mutable_lower());
+      }
+      if (predicate.raw_upper() != nullptr) {
+        CopyPredicateBoundToPB(predicate.column(),
+                               predicate.raw_upper(),
+                               like_pred->mutable_upper());
+      }
+      return;
+    }
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -624,6 +695,50 @@ Status ColumnPredicateFromPB(const Schema& schema,
       *predicate = ColumnPredicate::InBloomFilter(col, &bloom_filters, lower, upper);
       break;
     };
+    case ColumnPredicatePB::kLike: {
+      const auto& like = pb.like();
+      if (col.type_info()->physical_type() != BINARY) {
+        return Status::InvalidArgument("Invalid like predicate on column: "
+                                       "not a string or binary column", col.name());
+      }
+      if (like.patterns_size() == 0) {
+        return Status::InvalidArgument("Invalid like predicate on column: no patterns",
+                                       col.name());
+      }
+      ColumnPredicate pred = ColumnPredicate::Like(col, like.patterns(0), arena);
+      for (int i = 1; i < like.patterns_size(); i++) {
+        pred.Merge(ColumnPredicate::Like(col, like.patterns(i), arena));
+      }
+      if (like.bloom_filters_size() > 0) {
+        vector<ColumnPredicate::BloomFilterInner> bloom_filters;
+        for (const auto& bf : like.bloom_filters()) {
+          if (!bf.has_nhash()
+              || !bf.has_bloom_data()
+              || !bf.has_hash_algorithm()
+              || bf.hash_algorithm() == UNKNOWN_HASH) {
+            return Status::InvalidArgument("Invalid like predicate on column: "
+                                           "missing bloom filter details", col.name());
+          }
+          ColumnPredicate::BloomFilterInner bloom_filter;
+          RETURN_NOT_OK(CopyPredicateBloomFilterFromPB(bf, &bloom_filter, arena));
+          bloom_filters.emplace_back(bloom_filter);
+        }
+        pred.Merge(ColumnPredicate::InBloomFilter(col, &bloom_filters, nullptr, nullptr));
+      }
+      const void* lower = nullptr;
+      const void* upper = nullptr;
+      if (like.has_lower()) {
+        RETURN_NOT_OK(CopyPredicateBoundFromPB(col, like.lower(), arena, &lower));
+      }
+      if (like.has_upper()) {
+        RETURN_NOT_OK(CopyPredicateBoundFromPB(col, like.upper(), arena, &upper));
+      }
+      if (lower != nullptr || upper != nullptr) {
+        pred.Merge(ColumnPredicate::Range(col, lower, upper));
+      }
+      *predicate = std::move(pred);
+      break;
+    };
     default: return Status::InvalidArgument("Unknown predicate type for column", col.name());
   }
   return Status::OK();
@@ -824,43 +939,31 @@ static void CopyColumn(const RowBlock& block, int col_idx, int dst_col_idx, uint
   size_t offset_to_null_bitmap = schema_byte_size - column_offset;
 
   size_t cell_size = column_block.stride();
-  const uint8_t* src = column_block.cell_ptr(0);
-
-  BitmapIterator selected_row_iter(block.selection_vector()->bitmap(), block.nrows());
-  int run_size;
-  bool selected;
-  int row_idx = 0;
-  while ((run_size = selected_row_iter.Next(&selected))) {
-    if (!selected) {
-      src += run_size * cell_size;
-      row_idx += run_size;
-      continue;
-    }
-    for (int i = 0; i < run_size; i++) {
-      if (IS_NULLABLE && column_block.is_null(row_idx)) {
-        BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, true);
-      } else if (IS_VARLEN) {
-        const Slice *slice = reinterpret_cast<const Slice *>(src);
-        size_t offset_in_indirect = indirect_data->size();
-        indirect_data->append(reinterpret_cast<const char*>(slice->data()), slice->size());
-
-        Slice *dst_slice = reinterpret_cast<Slice *>(dst);
-        *dst_slice = Slice(reinterpret_cast<const uint8_t*>(offset_in_indirect),
-                           slice->size());
-        if (IS_NULLABLE) {
-          BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
-        }
-      } else { // non-string, non-null
-        strings::memcpy_inlined(dst, src, cell_size);
-        if (IS_NULLABLE) {
-          BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
-        }
+  const uint8_t* src_base = column_block.cell_ptr(0);
+
+  block.selection_vector()->ForEachSelectedRow([&](size_t row_idx) {
+    const uint8_t* src = src_base + row_idx * cell_size;
+    if (IS_NULLABLE && column_block.is_null(row_idx)) {
+      BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, true);
+    } else if (IS_VARLEN) {
+      const Slice *slice = reinterpret_cast<const Slice *>(src);
+      size_t offset_in_indirect = indirect_data->size();
+      indirect_data->append(reinterpret_cast<const char*>(slice->data()), slice->size());
+
+      Slice *dst_slice = reinterpret_cast<Slice *>(dst);
+      *dst_slice = Slice(reinterpret_cast<const uint8_t*>(offset_in_indirect),
+                         slice->size());
+      if (IS_NULLABLE) {
+        BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
+      }
+    } else { // non-string, non-null
+      strings::memcpy_inlined(dst, src, cell_size);
+      if (IS_NULLABLE) {
+        BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
       }
-      dst += row_stride;
-      src += cell_size;
-      row_idx++;
     }
-  }
+    dst += row_stride;
+  });
 }
 
 // Because we use a faststring here, ASAN tests become unbearably slow
@@ -948,4 +1051,281 @@ void SerializeRowBlock(const RowBlock& block,
   rowblock_pb->set_num_rows(rowblock_pb->num_rows() + num_rows);
 }
 
+// The distinct values of a dictionary-encoded column, mapped to their codes.
+struct ColumnarSerializedBatch::Dictionary {
+  Dictionary() : strings_arena(1024) {
+    // We use this invalid StringPiece for the "empty key". It's safe to build
+    // such a string and use it in equality comparisons.
+    codes.set_empty_key(StringPiece(static_cast<const char*>(nullptr),
+                                    std::numeric_limits<int>::max()));
+  }
+
+  // Holds the keys of 'codes'.
+  Arena strings_arena;
+  google::dense_hash_map<StringPiece, uint32_t, GoodFastHash<StringPiece>> codes;
+};
+
+namespace {
+
+// A dictionary-encoded column falls back to the plain layout once its
+// dictionary has more than one entry per this many rows...
+const int64_t kMinRowsPerDictionaryEntry = 4;
+
+// ... but only once it has at least this many rows, so that the first few
+// values don't decide for the whole batch.
+const int64_t kMinRowsToFallBackFromDictionary = 1024;
+
+} // anonymous namespace
+
+ColumnarSerializedBatch::ColumnarSerializedBatch(const Schema& projection_schema,
+                                                 bool dictionary_encode)
+    : projection_schema_(projection_schema),
+      num_rows_(0) {
+  columns_.resize(projection_schema.num_columns());
+  dictionaries_.resize(projection_schema.num_columns());
+  uint32_t zero = 0;
+  for (int i = 0; i < projection_schema.num_columns(); i++) {
+    const ColumnSchema& col = projection_schema.column(i);
+    Column& dst = columns_[i];
+    dst.data.reset(new faststring());
+    if (col.type_info()->physical_type() == BINARY) {
+      dst.varlen_data.reset(new faststring());
+      if (dictionary_encode) {
+        dictionaries_[i].reset(new Dictionary());
+        dst.dictionary_offsets.reset(new faststring());
+        dst.dictionary_offsets->append(&zero, sizeof(zero));
+      } else {
+        // The offsets always begin with the start of the first cell.
+        dst.data->append(&zero, sizeof(zero));
+      }
+    }
+    if (col.is_nullable()) {
+      dst.non_null_bitmap.reset(new faststring());
+    }
+  }
+}
+
+ColumnarSerializedBatch::~ColumnarSerializedBatch() {
+}
+
+namespace {
+
+// Grows the non-null bitmap of 'dst' to 'num_rows' rows, clearing the bytes
+// it gains, so that only the non-null bits need to be set. Returns the
+// bitmap.
+uint8_t* GrowNonNullBitmap(int64_t num_rows, ColumnarSerializedBatch::Column* dst) {
+  size_t old_size = dst->non_null_bitmap->size();
+  size_t new_size = BitmapSize(num_rows);
+  dst->non_null_bitmap->resize(new_size);
+  uint8_t* non_null_bitmap = dst->non_null_bitmap->data();
+  memset(non_null_bitmap + old_size, 0, new_size - old_size);
+  return non_null_bitmap;
+}
+
+// Appends the selected cells of 'column_block' to 'dst', whose first
+// 'num_rows_before' rows are already filled in.
+//
+// As with CopyColumn() above, the template parameters avoid branches inside
+// the copy loop.
+template<bool IS_NULLABLE, bool IS_VARLEN>
+void CopyColumnarColumn(const ColumnBlock& column_block,
+                        const SelectionVector& selection,
+                        int64_t num_rows_before,
+                        int64_t num_selected,
+                        ColumnarSerializedBatch::Column* dst) {
+  size_t cell_size = column_block.stride();
+  size_t dst_cell_size = IS_VARLEN ? sizeof(uint32_t) : cell_size;
+
+  uint8_t* non_null_bitmap = nullptr;
+  if (IS_NULLABLE) {
+    non_null_bitmap = GrowNonNullBitmap(num_rows_before + num_selected, dst);
+  }
+
+  size_t old_data_size = dst->data->size();
+  dst->data->resize(old_data_size + num_selected * dst_cell_size);
+  uint8_t* dst_cell = dst->data->data() + old_data_size;
+  uint32_t varlen_offset = 0;
+  if (IS_VARLEN) {
+    varlen_offset = UnalignedLoad<uint32_t>(dst_cell - sizeof(uint32_t));
+  }
+
+  const uint8_t* src_base = column_block.cell_ptr(0);
+  int64_t dst_row_idx = num_rows_before;
+  BitmapForEachSetBit(selection.bitmap(), column_block.nrows(), [&](size_t row_idx) {
+    const uint8_t* src = src_base + row_idx * cell_size;
+    bool is_null = IS_NULLABLE && column_block.is_null(row_idx);
+    if (IS_VARLEN) {
+      if (!is_null) {
+        const Slice* slice = reinterpret_cast<const Slice*>(src);
+        dst->varlen_data->append(slice->data(), slice->size());
+        varlen_offset += slice->size();
+      }
+      UnalignedStore<uint32_t>(dst_cell, varlen_offset);
+    } else if (is_null) {
+      // Don't leak unrelated data to the client.
+      memset(dst_cell, 0, cell_size);
+    } else {
+      strings::memcpy_inlined(dst_cell, src, cell_size);
+    }
+    if (IS_NULLABLE && !is_null) {
+      BitmapSet(non_null_bitmap, dst_row_idx);
+    }
+    dst_cell += dst_cell_size;
+    dst_row_idx++;
+  });
+}
+
+// Appends the selected cells of variable-length 'column_block' to
+// dictionary-encoded 'dst', adding the values 'dict' doesn't hold yet to it.
+template<bool IS_NULLABLE, class Dictionary>
+void CopyDictionaryEncodedColumn(const ColumnBlock& column_block,
+                                 const SelectionVector& selection,
+                                 int64_t num_rows_before,
+                                 int64_t num_selected,
+                                 Dictionary* dict,
+                                 ColumnarSerializedBatch::Column* dst) {
+  uint8_t* non_null_bitmap = nullptr;
+  if (IS_NULLABLE) {
+    non_null_bitmap = GrowNonNullBitmap(num_rows_before + num_selected, dst);
+  }
+
+  size_t old_data_size = dst->data->size();
+  dst->data->resize(old_data_size + num_selected * sizeof(uint32_t));
+  uint8_t* dst_cell = dst->data->data() + old_data_size;
+
+  const Slice* src_base = reinterpret_cast<const Slice*>(column_block.cell_ptr(0));
+  int64_t dst_row_idx = num_rows_before;
+  BitmapForEachSetBit(selection.bitmap(), column_block.nrows(), [&](size_t row_idx) {
+    uint32_t code = 0;
+    if (!IS_NULLABLE || !column_block.is_null(row_idx)) {
+      const Slice& value = src_base[row_idx];
+      StringPiece key(reinterpret_cast<const char*>(value.data()), value.size());
+      auto it = dict->codes.find(key);
+      if (it != dict->codes.end()) {
+        code = it->second;
+      } else {
+        // A new value: add it to the dictionary.
+        code = dict->codes.size();
+        const char* key_copy = reinterpret_cast<const char*>(
+            CHECK_NOTNULL(dict->strings_arena.AddSlice(value)));
+        dict->codes.insert({ StringPiece(key_copy, value.size()), code });
+        dst->varlen_data->append(value.data(), value.size());
+        uint32_t end_offset = dst->varlen_data->size();
+        dst->dictionary_offsets->append(&end_offset, sizeof(end_offset));
+      }
+      if (IS_NULLABLE) {
+        BitmapSet(non_null_bitmap, dst_row_idx);
+      }
+    }
+    UnalignedStore<uint32_t>(dst_cell, code);
+    dst_cell += sizeof(uint32_t);
+    dst_row_idx++;
+  });
+}
+
+} // anonymous namespace
+
+void ColumnarSerializedBatch::ConvertToPlain(int idx) {
+  Column* col = &columns_[idx];
+  const uint8_t* codes = col->data->data();
+  const uint8_t* dict_offsets = col->dictionary_offsets->data();
+  const uint8_t* dict_data = col->varlen_data->data();
+  const uint8_t* non_null_bitmap = col->non_null_bitmap ? col->non_null_bitmap->data() : nullptr;
+
+  unique_ptr<faststring> offsets(new faststring());
+  unique_ptr<faststring> varlen_data(new faststring());
+  offsets->resize((num_rows_ + 1) * sizeof(uint32_t));
+  uint8_t* offset_ptr = offsets->data();
+  uint32_t offset = 0;
+  UnalignedStore<uint32_t>(offset_ptr, offset);
+  for (int64_t row = 0; row < num_rows_; row++) {
+    offset_ptr += sizeof(uint32_t);
+    if (!non_null_bitmap || BitmapTest(non_null_bitmap, row)) {
+      uint32_t code = UnalignedLoad<uint32_t>(codes + row * sizeof(uint32_t));
+      uint32_t begin = UnalignedLoad<uint32_t>(dict_offsets + code * sizeof(uint32_t));
+      uint32_t end = UnalignedLoad<uint32_t>(dict_offsets + (code + 1) * sizeof(uint32_t));
+      varlen_data->append(dict_data + begin, end - begin);
+      offset += end - begin;
+    }
+    UnalignedStore<uint32_t>(offset_ptr, offset);
+  }
+  col->data = std::move(offsets);
+  col->varlen_data = std::move(varlen_data);
+  col->dictionary_offsets.reset();
+  dictionaries_[idx].reset();
+}
+
+// See SerializeRowBlock() for why address safety analysis is disabled.
+ATTRIBUTE_NO_ADDRESS_SAFETY_ANALYSIS
+void ColumnarSerializedBatch::AddRowBlock(const RowBlock& block) {
+  int64_t num_selected = block.selection_vector()->CountSelected();
+  if (num_selected == 0) {
+    return;
+  }
+  const Schema& tablet_schema = block.schema();
+  for (int p_schema_idx = 0; p_schema_idx < projection_schema_.num_columns(); p_schema_idx++) {
+    const ColumnSchema& col = projection_schema_.column(p_schema_idx);
+    int t_schema_idx = tablet_schema.find_column(col.name());
+    DCHECK_NE(t_schema_idx, -1);
+    ColumnBlock column_block = block.column_block(t_schema_idx);
+    Column* dst = &columns_[p_schema_idx];
+
+    Dictionary* dict = dictionaries_[p_schema_idx].get();
+    if (dict) {
+      if (col.is_nullable()) {
+        CopyDictionaryEncodedColumn<true>(column_block, *block.selection_vector(),
+                                          num_rows_, num_selected, dict, dst);
+      } else {
+        CopyDictionaryEncodedColumn<false>(column_block, *block.selection_vector(),
+                                           num_rows_, num_selected, dict, dst);
+      }
+      continue;
+    }
+
+    bool is_varlen = col.type_info()->physical_type() == BINARY;
+    if (col.is_nullable() && is_varlen) {
+      CopyColumnarColumn<true, true>(column_block, *block.selection_vector(),
+                                     num_rows_, num_selected, dst);
+    } else if (col.is_nullable() && !is_varlen) {
+      CopyColumnarColumn<true, false>(column_block, *block.selection_vector(),
+                                      num_rows_, num_selected, dst);
+    } else if (!col.is_nullable() && is_varlen) {
+      CopyColumnarColumn<false, true>(column_block, *block.selection_vector(),
+                                      num_rows_, num_selected, dst);
+    } else {
+      CopyColumnarColumn<false, false>(column_block, *block.selection_vector(),
+                                       num_rows_, num_selected, dst);
+    }
+  }
+  num_rows_ += num_selected;
+
+  // Fall back to the plain layout for the columns whose values don't repeat
+  // enough for a dictionary to pay off.
+  if (num_rows_ >= kMinRowsToFallBackFromDictionary) {
+    for (int i = 0; i < dictionaries_.size(); i++) {
+      if (dictionaries_[i] &&
+          dictionaries_[i]->codes.size() * kMinRowsPerDictionaryEntry > num_rows_) {
+        ConvertToPlain(i);
+      }
+    }
+  }
+}
+
+int64_t ColumnarSerializedBatch::TotalSizeBytes() const {
+  int64_t total = 0;
+  for (const auto& col : columns_) {
+    total += col.data->size();
+    if (col.varlen_data) {
+      total += col.varlen_data->size();
+    }
+    if (col.non_null_bitmap) {
+      total += col.non_null_bitmap->size();
+    }
+    if (col.dictionary_offsets) {
+      total += col.dictionary_offsets->size();
+    }
+  }
+  return total;
+}
+
 } // namespace kudu
@@ -20,8 +20,11 @@
 #define KUDU_COMMON_WIRE_PROTOCOL_H
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/status.h"
 
 namespace boost {
@@ -40,7 +43,6 @@ namespace kudu {
 class Arena;
 class ColumnPredicate;
 class ColumnSchema;
-class faststring;
 class HostPort;
 class RowBlock;
 class Schema;
@@ -154,6 +156,66 @@ void SerializeRowBlock(const RowBlock& block, RowwiseRowBlockPB* rowblock_pb,
                        faststring* data_buf, faststring* indirect_data,
                        bool pad_unixtime_micros_to_16_bytes = false);
 
+// Accumulates the selected rows of row blocks in columnar layout, for
+// returning scan results to clients which requested it. See
+// ColumnarRowBlockPB for the layout of each column's buffers.
+class ColumnarSerializedBatch {
+ public:
+  // The buffers holding a column's cells.
+  struct Column {
+    // The cells, or the offsets of the cells of variable-length columns.
+    std::unique_ptr<faststring> data;
+    // The cells of variable-length columns, null for other columns.
+    std::unique_ptr<faststring> varlen_data;
+    // The non-null bitmap of nullable columns, null for other columns.
+    std::unique_ptr<faststring> non_null_bitmap;
+    // The offsets of the dictionary's entries in 'varlen_data' for
+    // dictionary-encoded columns, whose 'data' then holds each row's code
+    // into the dictionary. Null for other columns.
+    std::unique_ptr<faststring> dictionary_offsets;
+  };
+
+  // 'projection_schema' must outlive this object.
+  //
+  // If 'dictionary_encode' is true, the variable-length columns are
+  // dictionary-encoded for as long as their values repeat enough: a column
+  // falls back to the plain layout once it has 1024 rows or more and its
+  // dictionary holds more than a quarter of them. See ColumnarRowBlockPB for
+  // both layouts.
+  explicit ColumnarSerializedBatch(const Schema& projection_schema,
+                                   bool dictionary_encode = false);
+  ~ColumnarSerializedBatch();
+
+  // Appends the selected rows of 'block', whose schema must contain all the
+  // projection's columns.
+  void AddRowBlock(const RowBlock& block);
+
+  // Returns the total size of the buffers of all columns.
+  int64_t TotalSizeBytes() const;
+
+  int64_t num_rows() const { return num_rows_; }
+
+  // The columns' buffers, in the projection's order. The caller may move the
+  // buffers out once all row blocks are added.
+  std::vector<Column>* mutable_columns() { return &columns_; }
+
+ private:
+  struct Dictionary;
+
+  // Rewrites dictionary-encoded column 'idx' in the plain layout.
+  void ConvertToPlain(int idx);
+
+  const Schema& projection_schema_;
+  std::vector<Column> columns_;
+
+  // The dictionary of each column being dictionary-encoded, or null for the
+  // other columns.
+  std::vector<std::unique_ptr<Dictionary>> dictionaries_;
+  int64_t num_rows_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnarSerializedBatch);
+};
+
 // Rewrites the data pointed-to by row data slice 'row_data_slice' by replacing
 // relative indirect data pointers with absolute ones in 'indirect_data_slice'.
 // At the time of this writing, this rewriting is only done for STRING types.
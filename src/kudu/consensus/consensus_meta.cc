@@ -52,6 +52,40 @@ using std::lock_guard;
 using std::string;
 using strings::Substitute;
 
+ConsensusMetadataDirSyncer::ConsensusMetadataDirSyncer(Env* env, string dir)
+    : env_(env),
+      dir_(std::move(dir)),
+      cond_(&lock_),
+      num_requested_(0),
+      num_synced_(0),
+      sync_in_progress_(false) {
+}
+
+Status ConsensusMetadataDirSyncer::SyncDir() {
+  MutexLock l(lock_);
+  const int64_t call = ++num_requested_;
+  while (num_synced_ < call) {
+    if (sync_in_progress_) {
+      // The sync in progress may have started before this call; wait for it
+      // and check again.
+      cond_.Wait();
+      continue;
+    }
+    // Sync on behalf of this call and all those waiting behind the previous
+    // sync.
+    sync_in_progress_ = true;
+    const int64_t covered = num_requested_;
+    l.Unlock();
+    Status s = env_->SyncDir(dir_);
+    l.Lock();
+    sync_in_progress_ = false;
+    num_synced_ = covered;
+    last_status_ = std::move(s);
+    cond_.Broadcast();
+  }
+  return last_status_;
+}
+
 int64_t ConsensusMetadata::current_term() const {
   DFAKE_SCOPED_RECURSIVE_LOCK(fake_lock_);
   DCHECK(pb_.has_current_term());
@@ -233,17 +267,25 @@ Status ConsensusMetadata::Flush(FlushMode flush_mode) {
                           "Unable to fsync consensus parent dir " + parent_dir);
   }
 
+  // We use FLAGS_log_force_fsync_all here because the consensus metadata is
+  // essentially an extension of the primary durability mechanism of the
+  // consensus subsystem: the WAL. Using the same flag ensures that the WAL
+  // and the consensus metadata get the same durability guarantees.
+  pb_util::SyncMode sync_mode = pb_util::NO_SYNC;
+  if (FLAGS_log_force_fsync_all) {
+    sync_mode = dir_syncer_ ? pb_util::SYNC_FILE_ONLY : pb_util::SYNC;
+  }
   string meta_file_path = fs_manager_->GetConsensusMetadataPath(tablet_id_);
   RETURN_NOT_OK_PREPEND(pb_util::WritePBContainerToPath(
       fs_manager_->env(), meta_file_path, pb_,
       flush_mode == OVERWRITE ? pb_util::OVERWRITE : pb_util::NO_OVERWRITE,
-      // We use FLAGS_log_force_fsync_all here because the consensus metadata is
-      // essentially an extension of the primary durability mechanism of the
-      // consensus subsystem: the WAL. Using the same flag ensures that the WAL
-      // and the consensus metadata get the same durability guarantees.
-      FLAGS_log_force_fsync_all ? pb_util::SYNC : pb_util::NO_SYNC),
+      sync_mode),
           Substitute("Unable to write consensus meta file for tablet $0 to path $1",
                      tablet_id_, meta_file_path));
+  if (sync_mode == pb_util::SYNC_FILE_ONLY) {
+    RETURN_NOT_OK_PREPEND(dir_syncer_->SyncDir(),
+                          "Failed to SyncDir() parent of " + meta_file_path);
+  }
   RETURN_NOT_OK(UpdateOnDiskSize());
   return Status::OK();
 }
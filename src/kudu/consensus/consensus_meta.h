@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
 
 #include <gtest/gtest_prod.h>
@@ -27,11 +28,14 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/threading/thread_collision_warner.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 
+class Env;
 class FsManager;
-class Status;
 
 namespace consensus {
 
@@ -43,6 +47,43 @@ enum class ConsensusMetadataCreateMode {
   NO_FLUSH_ON_CREATE,
 };
 
+// Coalesces the syncs of the consensus metadata directory done on behalf of
+// flushes of different tablets' metadata. Each flush renames its file into the
+// directory and then needs a directory sync which started after the rename.
+// While one sync is in progress, the flushes arriving behind it share the next
+// one, so a mass leader election after a server failure doesn't issue one
+// directory sync per tablet.
+//
+// This class is thread-safe.
+class ConsensusMetadataDirSyncer {
+ public:
+  ConsensusMetadataDirSyncer(Env* env, std::string dir);
+
+  // Syncs the directory, or waits for another thread's sync which started
+  // after this call, and returns its result.
+  Status SyncDir();
+
+ private:
+  Env* const env_;
+  const std::string dir_;
+
+  Mutex lock_;
+  ConditionVariable cond_;
+
+  // The number of calls to SyncDir() so far.
+  int64_t num_requested_;
+
+  // All the calls up to this one have been covered by a completed sync.
+  int64_t num_synced_;
+
+  bool sync_in_progress_;
+
+  // The result of the latest completed sync.
+  Status last_status_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConsensusMetadataDirSyncer);
+};
+
 // Provides methods to read, write, and persist consensus-related metadata.
 // This partly corresponds to Raft Figure 2's "Persistent state on all servers".
 //
@@ -218,6 +259,10 @@ class ConsensusMetadata : public RefCountedThreadSafe<ConsensusMetadata> {
   const std::string tablet_id_;
   const std::string peer_uuid_;
 
+  // If set, flushes share directory syncs with those of other tablets through
+  // it. Otherwise, each flush syncs the directory on its own.
+  std::shared_ptr<ConsensusMetadataDirSyncer> dir_syncer_;
+
   // This fake mutex helps ensure that this ConsensusMetadata object stays
   // externally synchronized.
   DFAKE_MUTEX(fake_lock_);
@@ -17,7 +17,10 @@
 
 #include <cstdint>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
 
@@ -27,12 +30,19 @@
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/status.h"
 
+DECLARE_bool(log_force_fsync_all);
+
 using google::protobuf::util::MessageDifferencer;
+using std::string;
+using std::thread;
+using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace consensus {
@@ -156,5 +166,47 @@ TEST_F(ConsensusMetadataManagerTest, TestNoClobber) {
   }
 }
 
+// Test concurrent fsync'ed flushes of the cmeta of different tablets, which
+// share directory syncs.
+TEST_F(ConsensusMetadataManagerTest, TestConcurrentSyncedFlushes) {
+  FLAGS_log_force_fsync_all = true;
+  const int kNumTablets = 16;
+  const int kNumTerms = 10;
+
+  vector<scoped_refptr<ConsensusMetadata>> cmetas(kNumTablets);
+  for (int i = 0; i < kNumTablets; i++) {
+    ASSERT_OK(cmeta_manager_->Create(Substitute("$0-$1", kTabletId, i), config_, kInitialTerm,
+                                     ConsensusMetadataCreateMode::FLUSH_ON_CREATE,
+                                     &cmetas[i]));
+  }
+
+  vector<Status> statuses(kNumTablets);
+  vector<thread> threads;
+  for (int i = 0; i < kNumTablets; i++) {
+    threads.emplace_back([&, i]() {
+      for (int term = kInitialTerm + 1; term <= kInitialTerm + kNumTerms; term++) {
+        cmetas[i]->set_current_term(term);
+        Status s = cmetas[i]->Flush();
+        if (!s.ok()) {
+          statuses[i] = s;
+          return;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // Reload the cmetas with a fresh manager to read them from disk.
+  scoped_refptr<ConsensusMetadataManager> manager(new ConsensusMetadataManager(&fs_manager_));
+  for (int i = 0; i < kNumTablets; i++) {
+    ASSERT_OK(statuses[i]);
+    scoped_refptr<ConsensusMetadata> cmeta;
+    ASSERT_OK(manager->Load(Substitute("$0-$1", kTabletId, i), &cmeta));
+    ASSERT_EQ(kInitialTerm + kNumTerms, cmeta->current_term());
+  }
+}
+
 } // namespace consensus
 } // namespace kudu
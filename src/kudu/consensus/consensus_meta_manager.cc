@@ -16,6 +16,7 @@
 // under the License.
 #include "kudu/consensus/consensus_meta_manager.h"
 
+#include <memory>
 #include <mutex>
 #include <utility>
 
@@ -35,7 +36,9 @@ using std::string;
 using strings::Substitute;
 
 ConsensusMetadataManager::ConsensusMetadataManager(FsManager* fs_manager)
-    : fs_manager_(DCHECK_NOTNULL(fs_manager)) {
+    : fs_manager_(DCHECK_NOTNULL(fs_manager)),
+      dir_syncer_(std::make_shared<ConsensusMetadataDirSyncer>(
+          fs_manager_->env(), fs_manager_->GetConsensusMetadataDir())) {
 }
 
 Status ConsensusMetadataManager::Create(const string& tablet_id,
@@ -48,6 +51,7 @@ Status ConsensusMetadataManager::Create(const string& tablet_id,
                                                   config, initial_term, create_mode,
                                                   &cmeta),
                         Substitute("Unable to create consensus metadata for tablet $0", tablet_id));
+  cmeta->dir_syncer_ = dir_syncer_;
 
   lock_guard<Mutex> l(lock_);
   if (!InsertIfNotPresent(&cmeta_cache_, tablet_id, cmeta)) {
@@ -76,6 +80,7 @@ Status ConsensusMetadataManager::Load(const string& tablet_id,
   RETURN_NOT_OK_PREPEND(ConsensusMetadata::Load(fs_manager_, tablet_id, fs_manager_->uuid(),
                                                 &cmeta),
                         Substitute("Unable to load consensus metadata for tablet $0", tablet_id));
+  cmeta->dir_syncer_ = dir_syncer_;
 
   // Cache and return the loaded ConsensusMetadata.
   {
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -86,6 +87,9 @@ class ConsensusMetadataManager : public RefCountedThreadSafe<ConsensusMetadataMa
 
   FsManager* const fs_manager_;
 
+  // Shared by all the managed instances to coalesce their directory syncs.
+  const std::shared_ptr<ConsensusMetadataDirSyncer> dir_syncer_;
+
   // Lock protecting the map below.
   Mutex lock_;
 
@@ -15,12 +15,15 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -32,6 +35,7 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus-test-util.h"
 #include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/consensus.service.h"
 #include "kudu/consensus/consensus_peers.h"
 #include "kudu/consensus/consensus_queue.h"
 #include "kudu/consensus/log.h"
@@ -44,15 +48,29 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/acceptor_pool.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/result_tracker.h"
+#include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/service_if.h"
+#include "kudu/rpc/service_pool.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/net/net_util.h"
+#include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/threadpool.h"
 
+DECLARE_int32(raft_heartbeat_batch_window_ms);
+
 METRIC_DECLARE_entity(tablet);
 
 namespace kudu {
@@ -60,11 +78,20 @@ namespace consensus {
 
 using log::Log;
 using log::LogOptions;
+using rpc::AcceptorPool;
+using rpc::ErrorStatusPB;
 using rpc::Messenger;
 using rpc::MessengerBuilder;
+using rpc::ResultTracker;
+using rpc::RpcContext;
+using rpc::RpcController;
+using rpc::ServiceIf;
+using rpc::ServicePool;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
 
 const char* kTabletId = "test-peers-tablet";
 const char* kLeaderUuid = "peer-0";
@@ -355,6 +382,243 @@ TEST_F(ConsensusPeersTest, TestDontSendOneRpcPerWriteWhenPeerIsDown) {
   ASSERT_LT(mock_proxy->update_count(), 5);
 }
 
+// A consensus service which answers heartbeats, with the ID of their tablet
+// as the responder UUID, and counts the RPCs carrying them.
+class FakeConsensusService : public ConsensusServiceIf {
+ public:
+  FakeConsensusService(const scoped_refptr<MetricEntity>& metric_entity,
+                       const scoped_refptr<ResultTracker>& result_tracker,
+                       bool supports_multi_update)
+      : ConsensusServiceIf(metric_entity, result_tracker),
+        supports_multi_update_(supports_multi_update),
+        num_update_calls_(0),
+        num_multi_update_calls_(0) {
+  }
+
+  void UpdateConsensus(const ConsensusRequestPB* req, ConsensusResponsePB* resp,
+                       RpcContext* context) override {
+    num_update_calls_++;
+    resp->set_responder_uuid(req->tablet_id());
+    context->RespondSuccess();
+  }
+
+  void MultiUpdateConsensus(const MultiUpdateConsensusRequestPB* req,
+                            MultiUpdateConsensusResponsePB* resp,
+                            RpcContext* context) override {
+    // Answer as a server which predates the method would.
+    if (!supports_multi_update_) {
+      context->RespondRpcFailure(ErrorStatusPB::ERROR_NO_SUCH_METHOD,
+                                 Status::RemoteError("no such method"));
+      return;
+    }
+    num_multi_update_calls_++;
+    for (const auto& tablet_req : req->requests()) {
+      resp->add_responses()->set_responder_uuid(tablet_req.tablet_id());
+    }
+    context->RespondSuccess();
+  }
+
+  void RequestConsensusVote(const VoteRequestPB* /*req*/, VoteResponsePB* /*resp*/,
+                            RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void ChangeConfig(const ChangeConfigRequestPB* /*req*/, ChangeConfigResponsePB* /*resp*/,
+                    RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void BulkChangeConfig(const BulkChangeConfigRequestPB* /*req*/,
+                        ChangeConfigResponsePB* /*resp*/, RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void UnsafeChangeConfig(const UnsafeChangeConfigRequestPB* /*req*/,
+                          UnsafeChangeConfigResponsePB* /*resp*/,
+                          RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void GetNodeInstance(const GetNodeInstanceRequestPB* /*req*/,
+                       GetNodeInstanceResponsePB* /*resp*/, RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void RunLeaderElection(const RunLeaderElectionRequestPB* /*req*/,
+                         RunLeaderElectionResponsePB* /*resp*/, RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void LeaderStepDown(const LeaderStepDownRequestPB* /*req*/,
+                      LeaderStepDownResponsePB* /*resp*/, RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void GetLastOpId(const GetLastOpIdRequestPB* /*req*/, GetLastOpIdResponsePB* /*resp*/,
+                   RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void GetConsensusState(const GetConsensusStateRequestPB* /*req*/,
+                         GetConsensusStateResponsePB* /*resp*/, RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+  void StartTabletCopy(const StartTabletCopyRequestPB* /*req*/,
+                       StartTabletCopyResponsePB* /*resp*/, RpcContext* context) override {
+    RespondNotSupported(context);
+  }
+
+  bool AuthorizeServiceUser(const google::protobuf::Message* /*req*/,
+                            google::protobuf::Message* /*resp*/,
+                            RpcContext* /*context*/) override {
+    return true;
+  }
+
+  int num_update_calls() const { return num_update_calls_; }
+  int num_multi_update_calls() const { return num_multi_update_calls_; }
+
+ private:
+  static void RespondNotSupported(RpcContext* context) {
+    context->RespondFailure(Status::NotSupported("not implemented by the fake service"));
+  }
+
+  const bool supports_multi_update_;
+  std::atomic<int> num_update_calls_;
+  std::atomic<int> num_multi_update_calls_;
+};
+
+// Tests the batching of heartbeats by RpcPeerProxy, against a fake server.
+class HeartbeatBatchingTest : public KuduTest {
+ public:
+  void TearDown() override {
+    proxies_.clear();
+    if (client_messenger_) {
+      client_messenger_->Shutdown();
+    }
+    if (server_messenger_) {
+      server_messenger_->Shutdown();
+    }
+    KuduTest::TearDown();
+  }
+
+ protected:
+  // A heartbeat sent by one of the proxies.
+  struct Heartbeat {
+    ConsensusRequestPB req;
+    ConsensusResponsePB resp;
+    RpcController controller;
+    Status status;
+  };
+
+  // Starts the fake server, and creates a proxy to it for each of
+  // 'num_tablets' tablets.
+  void StartServer(bool supports_multi_update, int num_tablets) {
+    ASSERT_OK(MessengerBuilder("server").Build(&server_messenger_));
+    shared_ptr<AcceptorPool> pool;
+    ASSERT_OK(server_messenger_->AddAcceptorPool(Sockaddr(), &pool));
+    ASSERT_OK(pool->Start(1));
+    scoped_refptr<ResultTracker> result_tracker(
+        new ResultTracker(MemTracker::CreateTracker(-1, "result_tracker")));
+    service_ = new FakeConsensusService(server_messenger_->metric_entity(), result_tracker,
+                                        supports_multi_update);
+    scoped_refptr<ServicePool> service_pool(new ServicePool(
+        gscoped_ptr<ServiceIf>(service_), server_messenger_->metric_entity(), 50));
+    ASSERT_OK(server_messenger_->RegisterService(service_->service_name(), service_pool));
+    ASSERT_OK(service_pool->Init(2));
+
+    ASSERT_OK(MessengerBuilder("client").Build(&client_messenger_));
+    RaftPeerPB peer_pb;
+    peer_pb.set_permanent_uuid(kFollowerUuid);
+    ASSERT_OK(HostPortToPB(HostPort(pool->bind_address()), peer_pb.mutable_last_known_addr()));
+    RpcPeerProxyFactory factory(client_messenger_, kLeaderUuid);
+    for (int i = 0; i < num_tablets; i++) {
+      gscoped_ptr<PeerProxy> proxy;
+      ASSERT_OK(factory.NewProxy(peer_pb, &proxy));
+      proxies_.emplace_back(proxy.release());
+    }
+  }
+
+  // Sends a heartbeat for the tablet of each proxy, all at once, and returns
+  // them once they're answered.
+  vector<unique_ptr<Heartbeat>> SendHeartbeats() {
+    vector<unique_ptr<Heartbeat>> heartbeats;
+    CountDownLatch latch(proxies_.size());
+    for (int i = 0; i < proxies_.size(); i++) {
+      heartbeats.emplace_back(new Heartbeat);
+      Heartbeat* heartbeat = heartbeats.back().get();
+      heartbeat->req.set_tablet_id(Substitute("tablet-$0", i));
+      heartbeat->req.set_caller_uuid(kLeaderUuid);
+      heartbeat->req.set_caller_term(1);
+      heartbeat->req.set_dest_uuid(kFollowerUuid);
+      proxies_[i]->HeartbeatAsync(&heartbeat->req, &heartbeat->resp, &heartbeat->controller,
+                                  [heartbeat, &latch](const Status& s) {
+                                    heartbeat->status = s;
+                                    latch.CountDown();
+                                  });
+    }
+    latch.Wait();
+    return heartbeats;
+  }
+
+  // Asserts that each of 'heartbeats' was answered for its own tablet.
+  static void CheckHeartbeats(const vector<unique_ptr<Heartbeat>>& heartbeats) {
+    for (const auto& heartbeat : heartbeats) {
+      ASSERT_OK(heartbeat->status);
+      ASSERT_EQ(heartbeat->req.tablet_id(), heartbeat->resp.responder_uuid());
+    }
+  }
+
+  shared_ptr<Messenger> server_messenger_;
+  shared_ptr<Messenger> client_messenger_;
+  // Owned by the service pool.
+  FakeConsensusService* service_;
+  vector<unique_ptr<PeerProxy>> proxies_;
+};
+
+// Test that the heartbeats sent to a server within the batch window go out
+// in one MultiUpdateConsensus RPC, and that each gets its own response.
+TEST_F(HeartbeatBatchingTest, TestBatching) {
+  FLAGS_raft_heartbeat_batch_window_ms = 100;
+  NO_FATALS(StartServer(/*supports_multi_update=*/true, 3));
+
+  NO_FATALS(CheckHeartbeats(SendHeartbeats()));
+  ASSERT_EQ(1, service_->num_multi_update_calls());
+  ASSERT_EQ(0, service_->num_update_calls());
+
+  // Once a batch is flushed, the next heartbeats start a new one.
+  NO_FATALS(CheckHeartbeats(SendHeartbeats()));
+  ASSERT_EQ(2, service_->num_multi_update_calls());
+  ASSERT_EQ(0, service_->num_update_calls());
+}
+
+// Test that heartbeats waiting for their batch to be flushed fail, rather
+// than hang, if the flush can't run.
+TEST_F(HeartbeatBatchingTest, TestFlushAborted) {
+  FLAGS_raft_heartbeat_batch_window_ms = 60 * 1000;
+  NO_FATALS(StartServer(/*supports_multi_update=*/true, 2));
+
+  Heartbeat heartbeat;
+  heartbeat.req.set_tablet_id("tablet-0");
+  heartbeat.req.set_caller_uuid(kLeaderUuid);
+  heartbeat.req.set_caller_term(1);
+  CountDownLatch latch(1);
+  proxies_[0]->HeartbeatAsync(&heartbeat.req, &heartbeat.resp, &heartbeat.controller,
+                              [&](const Status& s) {
+                                heartbeat.status = s;
+                                latch.CountDown();
+                              });
+  // Shutting down the messenger aborts the scheduled flush.
+  client_messenger_->Shutdown();
+  latch.Wait();
+  ASSERT_FALSE(heartbeat.status.ok());
+  ASSERT_EQ(0, service_->num_multi_update_calls());
+}
+
+// Test that heartbeats to a server which doesn't know MultiUpdateConsensus
+// are resent on their own, and that later ones aren't batched at all.
+TEST_F(HeartbeatBatchingTest, TestFallbackWithoutMultiUpdate) {
+  FLAGS_raft_heartbeat_batch_window_ms = 100;
+  NO_FATALS(StartServer(/*supports_multi_update=*/false, 3));
+
+  NO_FATALS(CheckHeartbeats(SendHeartbeats()));
+  ASSERT_EQ(0, service_->num_multi_update_calls());
+  ASSERT_EQ(3, service_->num_update_calls());
+
+  NO_FATALS(CheckHeartbeats(SendHeartbeats()));
+  ASSERT_EQ(6, service_->num_update_calls());
+}
+
 }  // namespace consensus
 }  // namespace kudu
-
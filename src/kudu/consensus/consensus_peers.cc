@@ -18,12 +18,16 @@
 #include "kudu/consensus/consensus_peers.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -42,9 +46,11 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/rpc/periodic.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
@@ -83,15 +89,38 @@ DEFINE_bool(enable_tablet_copy, true,
             "replica. For testing purposes only.");
 TAG_FLAG(enable_tablet_copy, unsafe);
 
+DEFINE_int32(raft_heartbeat_batch_window_ms, 0,
+             "If greater than 0, the heartbeats sent by the leaders on this server to "
+             "their followers on another server are collected for up to this many "
+             "milliseconds and sent together in a single RPC. Requests which carry "
+             "operations are always sent on their own. Should be well under "
+             "--raft_heartbeat_interval_ms.");
+TAG_FLAG(raft_heartbeat_batch_window_ms, advanced);
+TAG_FLAG(raft_heartbeat_batch_window_ms, experimental);
+
+DEFINE_int32(raft_server_liveness_interval_ms, 0,
+             "If greater than 0, this server sends a liveness signal at this interval "
+             "to every server hosting followers of the tablets it leads, in a single "
+             "RPC per server pair which doubles as the batch of coalesced heartbeats "
+             "when there is one (see --raft_heartbeat_batch_window_ms). Once the "
+             "signals stop, the followers start elections without waiting for their "
+             "election timeouts (see --raft_server_liveness_max_missed_periods), so "
+             "that leader failures are detected within a few of these intervals.");
+TAG_FLAG(raft_server_liveness_interval_ms, advanced);
+TAG_FLAG(raft_server_liveness_interval_ms, experimental);
+
+DECLARE_int32(consensus_max_inflight_requests_per_peer);
 DECLARE_int32(raft_heartbeat_interval_ms);
 
 using kudu::pb_util::SecureShortDebugString;
+using kudu::rpc::ErrorStatusPB;
 using kudu::rpc::Messenger;
 using kudu::rpc::PeriodicTimer;
 using kudu::rpc::RpcController;
 using kudu::tserver::TabletServerErrorPB;
 using std::shared_ptr;
 using std::string;
+using std::unordered_map;
 using std::vector;
 using std::weak_ptr;
 using strings::Substitute;
@@ -137,6 +166,7 @@ Peer::Peer(RaftPeerPB peer_pb,
       proxy_(std::move(proxy)),
       queue_(queue),
       failed_attempts_(0),
+      last_request_committed_index_(kMinimumOpIdIndex),
       messenger_(std::move(messenger)),
       raft_pool_token_(raft_pool_token) {
 }
@@ -169,9 +199,9 @@ Status Peer::SignalRequest(bool even_if_queue_empty) {
     return Status::IllegalState("Peer was closed.");
   }
 
-  // Only allow one request at a time. No sense waking up the
-  // raft thread pool if the task will just abort anyway.
-  if (request_pending_) {
+  // No sense waking up the raft thread pool if the task will just abort
+  // anyway.
+  if (requests_in_flight_ >= MaxRequestsInFlight()) {
     return Status::OK();
   }
 
@@ -192,8 +222,13 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // Only allow one request at a time.
-  if (request_pending_) {
+  if (requests_in_flight_ >= MaxRequestsInFlight()) {
+    return;
+  }
+  // A request sent while others are in flight only pipelines operations
+  // behind them: there's no need for it to heartbeat or report errors.
+  const bool pipelined = requests_in_flight_ > 0;
+  if (pipelined && failed_attempts_ > 0) {
     return;
   }
 
@@ -219,25 +254,32 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // The peer has no pending request nor is sending: send the request.
   bool needs_tablet_copy = false;
-  int64_t commit_index_before = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
-  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request_,
-                                    &replicate_msg_refs_, &needs_tablet_copy);
-  int64_t commit_index_after = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
+  shared_ptr<UpdateCall> call = std::make_shared<UpdateCall>();
+  call->request_time = MonoTime::Now();
+  call->pipelined = pipelined;
+  ConsensusRequestPB* request = &call->request;
+  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), request,
+                                    &call->replicate_msg_refs, &needs_tablet_copy, pipelined);
 
   if (PREDICT_FALSE(!s.ok())) {
     VLOG_WITH_PREFIX_UNLOCKED(1) << s.ToString();
     return;
   }
+  if (pipelined && request->ops_size() == 0) {
+    return;
+  }
+
+  int64_t commit_index_before = last_request_committed_index_;
+  int64_t commit_index_after = request->has_committed_index() ?
+      request->committed_index() : kMinimumOpIdIndex;
+  last_request_committed_index_ = commit_index_after;
 
   if (PREDICT_FALSE(needs_tablet_copy)) {
     Status s = PrepareTabletCopyRequest();
     if (s.ok()) {
       controller_.Reset();
-      request_pending_ = true;
+      requests_in_flight_++;
       l.unlock();
       // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
       // that this object outlives the RPC.
@@ -253,11 +295,11 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  request_.set_tablet_id(tablet_id_);
-  request_.set_caller_uuid(leader_uuid_);
-  request_.set_dest_uuid(peer_pb_.permanent_uuid());
+  request->set_tablet_id(tablet_id_);
+  request->set_caller_uuid(leader_uuid_);
+  request->set_dest_uuid(peer_pb_.permanent_uuid());
 
-  bool req_has_ops = request_.ops_size() > 0 || (commit_index_after > commit_index_before);
+  bool req_has_ops = request->ops_size() > 0 || (commit_index_after > commit_index_before);
   // If the queue is empty, check if we were told to send a status-only
   // message, if not just return.
   if (PREDICT_FALSE(!req_has_ops && !even_if_queue_empty)) {
@@ -273,18 +315,41 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
 
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Sending to peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(request_);
-  controller_.Reset();
+      << SecureShortDebugString(*request);
 
-  request_pending_ = true;
+  call->sequence_number = next_sequence_number_++;
+  requests_in_flight_++;
+  bool send_more = requests_in_flight_ < MaxRequestsInFlight() && req_has_ops;
   l.unlock();
   // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
   // that this object outlives the RPC.
   shared_ptr<Peer> s_this = shared_from_this();
-  proxy_->UpdateAsync(&request_, &response_, &controller_,
-                      [s_this]() {
-                        s_this->ProcessResponse();
+  if (!req_has_ops) {
+    proxy_->HeartbeatAsync(request, &call->response, &call->controller,
+                           [s_this, call](const Status& s) {
+                             s_this->ProcessResponse(call, s);
+                           });
+    return;
+  }
+  proxy_->UpdateAsync(request, &call->response, &call->controller,
+                      [s_this, call]() {
+                        s_this->ProcessResponse(call, call->controller.status());
                       });
+
+  // If there is room in the pipeline, follow up with any further operations
+  // right away.
+  if (send_more) {
+    SendNextRequest(false);
+  }
+}
+
+int Peer::MaxRequestsInFlight() {
+  return std::max(1, FLAGS_consensus_max_inflight_requests_per_peer);
+}
+
+Peer::UpdateCall::~UpdateCall() {
+  // We don't own the ops (the queue does).
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
 }
 
 Status Peer::StartElection() {
@@ -296,49 +361,48 @@ Status Peer::StartElection() {
   RETURN_NOT_OK(proxy_->StartElection(&req, &resp, &controller));
   RETURN_NOT_OK(controller.status());
   if (resp.has_error()) {
-    return StatusFromPB(response_.error().status());
+    return StatusFromPB(resp.error().status());
   }
   return Status::OK();
 }
 
-void Peer::ProcessResponse() {
+void Peer::ProcessResponse(const shared_ptr<UpdateCall>& call, const Status& rpc_status) {
   // Note: This method runs on the reactor thread.
   std::unique_lock<simple_spinlock> lock(peer_lock_);
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
+  CHECK_GT(requests_in_flight_, 0);
+  const ConsensusResponsePB& response = call->response;
 
   MAYBE_FAULT(FLAGS_fault_crash_after_leader_request_fraction);
 
-  // Process RpcController errors.
-  const auto controller_status = controller_.status();
-  if (!controller_status.ok()) {
-    auto ps = controller_status.IsRemoteError() ?
+  // Process RPC errors.
+  if (!rpc_status.ok()) {
+    auto ps = rpc_status.IsRemoteError() ?
         PeerStatus::REMOTE_ERROR : PeerStatus::RPC_LAYER_ERROR;
-    queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, controller_status);
-    ProcessResponseError(controller_status);
+    queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, rpc_status);
+    ProcessResponseError(response, rpc_status);
     return;
   }
 
   // Process CANNOT_PREPARE.
   // TODO(todd): there is no integration test coverage of this code path. Likely a bug in
   // this path is responsible for KUDU-1779.
-  if (response_.status().has_error() &&
-      response_.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE) {
-    Status response_status = StatusFromPB(response_.status().error().status());
+  if (response.status().has_error() &&
+      response.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE) {
+    Status response_status = StatusFromPB(response.status().error().status());
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), PeerStatus::CANNOT_PREPARE,
                              response_status);
-    ProcessResponseError(response_status);
+    ProcessResponseError(response, response_status);
     return;
   }
 
   // Process tserver-level errors.
-  if (response_.has_error()) {
-    Status response_status = StatusFromPB(response_.error().status());
+  if (response.has_error()) {
+    Status response_status = StatusFromPB(response.error().status());
     PeerStatus ps;
-    TabletServerErrorPB resp_error = response_.error();
-    switch (response_.error().code()) {
+    switch (response.error().code()) {
       // We treat WRONG_SERVER_UUID as failed.
       case TabletServerErrorPB::WRONG_SERVER_UUID: FALLTHROUGH_INTENDED;
       case TabletServerErrorPB::TABLET_FAILED:
@@ -352,7 +416,7 @@ void Peer::ProcessResponse() {
         ps = PeerStatus::REMOTE_ERROR;
     }
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, response_status);
-    ProcessResponseError(response_status);
+    ProcessResponseError(response, response_status);
     return;
   }
 
@@ -364,37 +428,75 @@ void Peer::ProcessResponse() {
   // Capture a weak_ptr reference into the submitted functor so that we can
   // safely handle the functor outliving its peer.
   weak_ptr<Peer> w_this = shared_from_this();
-  Status s = raft_pool_token_->SubmitFunc([w_this]() {
+  Status s = raft_pool_token_->SubmitFunc([w_this, call]() {
     if (auto p = w_this.lock()) {
-      p->DoProcessResponse();
+      p->DoProcessResponse(call);
 
     }
   });
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to process peer response: " << s.ToString()
-        << ": " << SecureShortDebugString(response_);
-    request_pending_ = false;
+        << ": " << SecureShortDebugString(response);
+    requests_in_flight_--;
   }
 }
 
-void Peer::DoProcessResponse() {
+void Peer::DoProcessResponse(const shared_ptr<UpdateCall>& call) {
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Response from peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(response_);
+      << SecureShortDebugString(call->response);
 
-  bool send_more_immediately = queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), response_);
+  const ConsensusRequestPB& request = call->request;
+  const ConsensusResponsePB& response = call->response;
+  bool handled = false;
+  bool send_more_immediately = false;
+  {
+    std::lock_guard<std::mutex> l(response_lock_);
+    if (call->sequence_number < last_handled_sequence_number_) {
+      // The response to a later request, carrying later operations, was
+      // handled already: the peer's state is more recent than this response.
+      VLOG_WITH_PREFIX_UNLOCKED(2) << "Ignoring out-of-order response from peer "
+                                   << peer_pb().permanent_uuid();
+    } else if (call->pipelined &&
+               response.status().has_error() &&
+               response.status().error().code() ==
+                   ConsensusErrorPB::PRECEDING_ENTRY_DIDNT_MATCH &&
+               response.status().last_received().index() < request.preceding_id().index()) {
+      // The request overtook those ahead of it: the operations it carried
+      // are to be sent again. Were the peer to have really lost operations,
+      // the requests ahead of it, or the next one sent once none are in
+      // flight, would find out.
+      VLOG_WITH_PREFIX_UNLOCKED(2) << "Pipelined request after operation "
+                                   << request.preceding_id().index()
+                                   << " reached peer " << peer_pb().permanent_uuid()
+                                   << " out of order";
+      queue_->PipelinedRequestRejected(peer_pb_.permanent_uuid(),
+                                       request.preceding_id().index());
+    } else {
+      last_handled_sequence_number_ = call->sequence_number;
+      handled = true;
+      send_more_immediately = queue_->ResponseFromPeer(peer_pb_.permanent_uuid(),
+                                                       response,
+                                                       call->request_time);
+    }
+  }
 
   {
     std::unique_lock<simple_spinlock> lock(peer_lock_);
-    CHECK(request_pending_);
-    failed_attempts_ = 0;
-    request_pending_ = false;
+    CHECK_GT(requests_in_flight_, 0);
+    if (handled) {
+      failed_attempts_ = 0;
+    }
+    requests_in_flight_--;
   }
   // We're OK to read the state_ without a lock here -- if we get a race,
   // the worst thing that could happen is that we'll make one more request before
   // noticing a close.
   if (send_more_immediately) {
     SendNextRequest(true);
+  } else if (!handled) {
+    // Send whatever was rejected or is still pending.
+    SendNextRequest(false);
   }
 }
 
@@ -415,8 +517,8 @@ void Peer::ProcessTabletCopyResponse() {
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
-  request_pending_ = false;
+  CHECK_GT(requests_in_flight_, 0);
+  requests_in_flight_--;
 
   // If the response is OK, or ALREADY_INPROGRESS, then consider the RPC successful.
   const auto controller_status = controller_.status();
@@ -439,13 +541,13 @@ void Peer::ProcessTabletCopyResponse() {
   }
 }
 
-void Peer::ProcessResponseError(const Status& status) {
+void Peer::ProcessResponseError(const ConsensusResponsePB& response, const Status& status) {
   failed_attempts_++;
   string resp_err_info;
-  if (response_.has_error()) {
+  if (response.has_error()) {
     resp_err_info = Substitute(" Error code: $0 ($1).",
-                               TabletServerErrorPB::Code_Name(response_.error().code()),
-                               response_.error().code());
+                               TabletServerErrorPB::Code_Name(response.error().code()),
+                               response.error().code());
   }
   // We log the warning at the first failure, then every
   // 'kNumRetriesBetweenLoggingFailedRequest' retries.
@@ -463,7 +565,7 @@ void Peer::ProcessResponseError(const Status& status) {
                  failed_attempts_,
                  kNumRetriesBetweenLoggingFailedRequest);
   }
-  request_pending_ = false;
+  requests_in_flight_--;
 }
 
 string Peer::LogPrefixUnlocked() const {
@@ -489,15 +591,323 @@ Peer::~Peer() {
   if (heartbeater_) {
     heartbeater_->Stop();
   }
+}
 
-  // We don't own the ops (the queue does).
-  request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
+// Coalesces the heartbeats sent by the leaders on this server to the
+// followers on another server into MultiUpdateConsensus RPCs.
+//
+// A batcher is shared by the RpcPeerProxies of all the tablets with a peer
+// on that server, and lives as long as any of them. If
+// --raft_server_liveness_interval_ms is set, it also sends a batch, if only an
+// empty one, at least that often, which the remote server takes as a sign that
+// the leaders on this server are alive.
+class HeartbeatBatcher : public std::enable_shared_from_this<HeartbeatBatcher> {
+ public:
+  // Returns the batcher for heartbeats sent with 'messenger' to the server at
+  // 'hostport', creating it if there is none.
+  static Status GetOrCreate(const shared_ptr<Messenger>& messenger,
+                            const string& local_uuid,
+                            const HostPort& hostport,
+                            shared_ptr<HeartbeatBatcher>* batcher);
+
+  ~HeartbeatBatcher();
+
+  // Queues a heartbeat to be sent as part of the next batch. See
+  // PeerProxy::HeartbeatAsync().
+  void Enqueue(const ConsensusRequestPB* request,
+               ConsensusResponsePB* response,
+               RpcController* controller,
+               StdStatusCallback callback);
+
+ private:
+  struct PendingHeartbeat {
+    const ConsensusRequestPB* request;
+    ConsensusResponsePB* response;
+    RpcController* controller;
+    StdStatusCallback callback;
+  };
+
+  // The state of one MultiUpdateConsensus RPC.
+  struct BatchCall {
+    MultiUpdateConsensusRequestPB req;
+    MultiUpdateConsensusResponsePB resp;
+    RpcController controller;
+    vector<PendingHeartbeat> heartbeats;
+  };
+
+  HeartbeatBatcher(shared_ptr<Messenger> messenger,
+                   string local_uuid,
+                   string peer_name,
+                   gscoped_ptr<ConsensusServiceProxy> proxy)
+      : messenger_(std::move(messenger)),
+        local_uuid_(std::move(local_uuid)),
+        peer_name_(std::move(peer_name)),
+        proxy_(std::move(proxy)),
+        multi_update_supported_(true) {
+  }
+
+  // Fills in the fields of 'req' which describe this server.
+  void SetSender(MultiUpdateConsensusRequestPB* req) const;
+
+  // Sends an empty batch, unless a batch was sent recently enough for the
+  // remote server to know this server is alive.
+  void SendLivenessSignal();
+
+  // Called when the remote server doesn't support MultiUpdateConsensus.
+  void HandleMultiUpdateNotSupported();
+
+  // Sends the queued heartbeats, or fails them with 's' if the reactor
+  // couldn't run the flush.
+  void Flush(const Status& s);
+
+  // Hands the response of 'call' back to the heartbeats it carried.
+  void ProcessBatchResponse(BatchCall* call);
+
+  // Sends 'heartbeat' in an UpdateConsensus RPC of its own.
+  void SendAlone(const PendingHeartbeat& heartbeat);
+
+  const shared_ptr<Messenger> messenger_;
+  const string local_uuid_;
+  const string peer_name_;
+  const gscoped_ptr<ConsensusServiceProxy> proxy_;
+
+  // Sends the liveness signals, if they are enabled.
+  shared_ptr<PeriodicTimer> liveness_timer_;
+
+  // Set to false once the remote server is found not to support
+  // MultiUpdateConsensus, after which heartbeats are sent on their own.
+  std::atomic<bool> multi_update_supported_;
+
+  simple_spinlock lock_;
+  vector<PendingHeartbeat> pending_;
+
+  // When the last batch was sent.
+  MonoTime last_sent_;
+};
+
+namespace {
+
+Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger,
+                                          const HostPort& hostport,
+                                          gscoped_ptr<ConsensusServiceProxy>* new_proxy);
+
+// All the heartbeat batchers in the process, keyed by messenger and
+// destination. Entries expire along with the proxies using them.
+simple_spinlock heartbeat_batchers_lock;
+unordered_map<string, std::weak_ptr<HeartbeatBatcher>>* heartbeat_batchers = nullptr;
+
+} // anonymous namespace
+
+Status HeartbeatBatcher::GetOrCreate(const shared_ptr<Messenger>& messenger,
+                                     const string& local_uuid,
+                                     const HostPort& hostport,
+                                     shared_ptr<HeartbeatBatcher>* batcher) {
+  string key = Substitute("$0/$1", reinterpret_cast<uintptr_t>(messenger.get()),
+                          hostport.ToString());
+  std::lock_guard<simple_spinlock> l(heartbeat_batchers_lock);
+  if (!heartbeat_batchers) {
+    heartbeat_batchers = new unordered_map<string, std::weak_ptr<HeartbeatBatcher>>();
+  }
+  shared_ptr<HeartbeatBatcher> existing = (*heartbeat_batchers)[key].lock();
+  if (existing) {
+    *batcher = std::move(existing);
+    return Status::OK();
+  }
+
+  gscoped_ptr<ConsensusServiceProxy> proxy;
+  RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger, hostport, &proxy));
+  shared_ptr<HeartbeatBatcher> created(new HeartbeatBatcher(messenger, local_uuid,
+                                                            hostport.ToString(),
+                                                            std::move(proxy)));
+  if (FLAGS_raft_server_liveness_interval_ms > 0) {
+    // No jitter: the remote server expects a signal every interval.
+    PeriodicTimer::Options opts;
+    opts.jitter_pct = 0;
+    std::weak_ptr<HeartbeatBatcher> w_created = created;
+    created->liveness_timer_ = PeriodicTimer::Create(
+        messenger,
+        [w_created]() {
+          if (auto b = w_created.lock()) {
+            b->SendLivenessSignal();
+          }
+        },
+        MonoDelta::FromMilliseconds(FLAGS_raft_server_liveness_interval_ms),
+        opts);
+    created->liveness_timer_->Start();
+  }
+  // Drop the entries of batchers which are gone.
+  for (auto it = heartbeat_batchers->begin(); it != heartbeat_batchers->end();) {
+    if (it->second.expired()) {
+      it = heartbeat_batchers->erase(it);
+    } else {
+      ++it;
+    }
+  }
+  (*heartbeat_batchers)[key] = created;
+  *batcher = std::move(created);
+  return Status::OK();
+}
+
+HeartbeatBatcher::~HeartbeatBatcher() {
+  if (liveness_timer_) {
+    liveness_timer_->Stop();
+  }
+}
+
+void HeartbeatBatcher::SetSender(MultiUpdateConsensusRequestPB* req) const {
+  req->set_caller_uuid(local_uuid_);
+  if (liveness_timer_) {
+    req->set_liveness_interval_ms(FLAGS_raft_server_liveness_interval_ms);
+  }
+}
+
+void HeartbeatBatcher::SendLivenessSignal() {
+  if (!multi_update_supported_) {
+    return;
+  }
+  const MonoDelta interval = MonoDelta::FromMilliseconds(FLAGS_raft_server_liveness_interval_ms);
+  const MonoTime now = MonoTime::Now();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    // Skip the signal if a batch of heartbeats went out less than half an
+    // interval ago: the remote server still hears from this server at
+    // least every one and a half intervals.
+    if (last_sent_.Initialized() &&
+        (now - last_sent_).ToNanoseconds() < interval.ToNanoseconds() / 2) {
+      return;
+    }
+    last_sent_ = now;
+  }
+
+  shared_ptr<BatchCall> call = std::make_shared<BatchCall>();
+  SetSender(&call->req);
+  // A signal which is late is useless: the next one is due by then.
+  call->controller.set_timeout(interval);
+  shared_ptr<HeartbeatBatcher> s_this = shared_from_this();
+  proxy_->MultiUpdateConsensusAsync(call->req, &call->resp, &call->controller,
+                                    [s_this, call]() {
+    const Status s = call->controller.status();
+    if (s.IsRemoteError()) {
+      const ErrorStatusPB* err = call->controller.error_response();
+      if (err && err->code() == ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+        s_this->HandleMultiUpdateNotSupported();
+      }
+    }
+  });
+}
+
+void HeartbeatBatcher::HandleMultiUpdateNotSupported() {
+  KLOG_FIRST_N(INFO, 1) << "Server " << peer_name_ << " doesn't support "
+                        << "batched heartbeats; sending them one at a time";
+  multi_update_supported_ = false;
+  if (liveness_timer_) {
+    liveness_timer_->Stop();
+  }
+}
+
+void HeartbeatBatcher::Enqueue(const ConsensusRequestPB* request,
+                               ConsensusResponsePB* response,
+                               RpcController* controller,
+                               StdStatusCallback callback) {
+  PendingHeartbeat heartbeat = { request, response, controller, std::move(callback) };
+  if (!multi_update_supported_) {
+    SendAlone(heartbeat);
+    return;
+  }
+  bool schedule_flush;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    pending_.emplace_back(std::move(heartbeat));
+    schedule_flush = pending_.size() == 1;
+  }
+  if (schedule_flush) {
+    std::weak_ptr<HeartbeatBatcher> w_this = shared_from_this();
+    messenger_->ScheduleOnReactor(
+        [w_this](const Status& s) {
+          if (auto b = w_this.lock()) {
+            b->Flush(s);
+          }
+        },
+        MonoDelta::FromMilliseconds(FLAGS_raft_heartbeat_batch_window_ms));
+  }
+}
+
+void HeartbeatBatcher::Flush(const Status& s) {
+  vector<PendingHeartbeat> heartbeats;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    heartbeats.swap(pending_);
+    if (!heartbeats.empty()) {
+      last_sent_ = MonoTime::Now();
+    }
+  }
+  if (heartbeats.empty()) {
+    return;
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    for (const auto& heartbeat : heartbeats) {
+      heartbeat.callback(s);
+    }
+    return;
+  }
+
+  shared_ptr<BatchCall> call = std::make_shared<BatchCall>();
+  SetSender(&call->req);
+  for (const auto& heartbeat : heartbeats) {
+    *call->req.add_requests() = *heartbeat.request;
+  }
+  call->heartbeats = std::move(heartbeats);
+  call->controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  shared_ptr<HeartbeatBatcher> s_this = shared_from_this();
+  proxy_->MultiUpdateConsensusAsync(call->req, &call->resp, &call->controller,
+                                    [s_this, call]() {
+                                      s_this->ProcessBatchResponse(call.get());
+                                    });
+}
+
+void HeartbeatBatcher::ProcessBatchResponse(BatchCall* call) {
+  const Status s = call->controller.status();
+  if (s.IsRemoteError()) {
+    const ErrorStatusPB* err = call->controller.error_response();
+    if (err && err->code() == ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+      HandleMultiUpdateNotSupported();
+      for (const auto& heartbeat : call->heartbeats) {
+        SendAlone(heartbeat);
+      }
+      return;
+    }
+  }
+
+  for (int i = 0; i < call->heartbeats.size(); i++) {
+    const PendingHeartbeat& heartbeat = call->heartbeats[i];
+    if (!s.ok()) {
+      heartbeat.callback(s);
+    } else if (PREDICT_FALSE(i >= call->resp.responses_size())) {
+      heartbeat.callback(Status::IllegalState(
+          "MultiUpdateConsensus response has fewer responses than requests"));
+    } else {
+      heartbeat.response->Swap(call->resp.mutable_responses(i));
+      heartbeat.callback(Status::OK());
+    }
+  }
+}
+
+void HeartbeatBatcher::SendAlone(const PendingHeartbeat& heartbeat) {
+  RpcController* controller = heartbeat.controller;
+  StdStatusCallback callback = heartbeat.callback;
+  controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  proxy_->UpdateConsensusAsync(*heartbeat.request, heartbeat.response, controller,
+                               [controller, callback]() {
+                                 callback(controller->status());
+                               });
 }
 
 RpcPeerProxy::RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+                           shared_ptr<HeartbeatBatcher> heartbeat_batcher)
     : hostport_(std::move(DCHECK_NOTNULL(hostport))),
-      consensus_proxy_(std::move(DCHECK_NOTNULL(consensus_proxy))) {
+      consensus_proxy_(std::move(DCHECK_NOTNULL(consensus_proxy))),
+      heartbeat_batcher_(std::move(heartbeat_batcher)) {
 }
 
 void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
@@ -508,6 +918,18 @@ void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
   consensus_proxy_->UpdateConsensusAsync(*request, response, controller, callback);
 }
 
+void RpcPeerProxy::HeartbeatAsync(const ConsensusRequestPB* request,
+                                  ConsensusResponsePB* response,
+                                  rpc::RpcController* controller,
+                                  const StdStatusCallback& callback) {
+  // The batcher may only be there to send liveness signals.
+  if (!heartbeat_batcher_ || FLAGS_raft_heartbeat_batch_window_ms <= 0) {
+    PeerProxy::HeartbeatAsync(request, response, controller, callback);
+    return;
+  }
+  heartbeat_batcher_->Enqueue(request, response, controller, callback);
+}
+
 Status RpcPeerProxy::StartElection(const RunLeaderElectionRequestPB* request,
                                  RunLeaderElectionResponsePB* response,
                                  rpc::RpcController* controller) {
@@ -552,8 +974,10 @@ Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger
 
 } // anonymous namespace
 
-RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger)
-    : messenger_(std::move(messenger)) {}
+RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger,
+                                         string local_uuid)
+    : messenger_(std::move(messenger)),
+      local_uuid_(std::move(local_uuid)) {}
 
 Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
                                      gscoped_ptr<PeerProxy>* proxy) {
@@ -561,7 +985,13 @@ Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
   RETURN_NOT_OK(HostPortFromPB(peer_pb.last_known_addr(), hostport.get()));
   gscoped_ptr<ConsensusServiceProxy> new_proxy;
   RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger_, *hostport, &new_proxy));
-  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy)));
+  shared_ptr<HeartbeatBatcher> heartbeat_batcher;
+  if (FLAGS_raft_heartbeat_batch_window_ms > 0 || FLAGS_raft_server_liveness_interval_ms > 0) {
+    RETURN_NOT_OK(HeartbeatBatcher::GetOrCreate(messenger_, local_uuid_, *hostport,
+                                                &heartbeat_batcher));
+  }
+  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy),
+                                std::move(heartbeat_batcher)));
   return Status::OK();
 }
 
@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -34,8 +35,10 @@
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
 
 namespace kudu {
 class ThreadPoolToken;
@@ -46,6 +49,7 @@ class PeriodicTimer;
 }
 
 namespace consensus {
+class HeartbeatBatcher;
 class PeerMessageQueue;
 class PeerProxy;
 
@@ -57,7 +61,7 @@ class PeerProxy;
 // the request will be generated once the outstanding one finishes.
 //
 // Peers are owned by the consensus implementation and do not keep
-// state aside from the most recent request and response.
+// state aside from the requests in flight and their responses.
 //
 // Peers are also responsible for sending periodic heartbeats
 // to assert liveness of the leader. The peer constructs a heartbeater
@@ -67,6 +71,10 @@ class PeerProxy;
 // object, and performed on a thread pool (since it may do IO). When a
 // response is received, the peer updates the PeerMessageQueue
 // using PeerMessageQueue::ResponseFromPeer(...) on the same thread pool.
+//
+// Usually only one request is in flight to a peer at a time. With
+// --consensus_max_inflight_requests_per_peer greater than 1, requests carrying
+// further operations may be pipelined behind it while the peer is in sync.
 class Peer : public std::enable_shared_from_this<Peer> {
  public:
   // Initializes a peer and start sending periodic heartbeats.
@@ -81,7 +89,7 @@ class Peer : public std::enable_shared_from_this<Peer> {
   // Synchronously starts a leader election on this peer.
   // This method is ad hoc, using this instance's PeerProxy to send the
   // StartElection request.
-  // The StartElection RPC does not count as the single outstanding request
+  // The StartElection RPC does not count as one of the outstanding requests
   // that this class tracks.
   Status StartElection();
 
@@ -124,17 +132,54 @@ class Peer : public std::enable_shared_from_this<Peer> {
        gscoped_ptr<PeerProxy> proxy,
        std::shared_ptr<rpc::Messenger> messenger);
 
+  // The state of one UpdateConsensus RPC to the peer.
+  struct UpdateCall {
+    ~UpdateCall();
+
+    ConsensusRequestPB request;
+    ConsensusResponsePB response;
+    rpc::RpcController controller;
+
+    // When the request was assembled.
+    MonoTime request_time;
+
+    // The order in which the requests to the peer were assembled, which is
+    // also the order of the operations they carry.
+    int64_t sequence_number = 0;
+
+    // Whether the request was pipelined behind others in flight.
+    bool pipelined = false;
+
+    // Reference-counted pointers to the ReplicateMsgs in 'request'. We may
+    // have loaded these messages from the LogCache, in which case we are
+    // potentially sharing the same object as other peers. Since the PB
+    // request itself can't hold reference counts, this holds them.
+    std::vector<ReplicateRefPtr> replicate_msg_refs;
+  };
+
+  // Returns the maximum number of requests to have in flight to the peer.
+  static int MaxRequestsInFlight();
+
   void SendNextRequest(bool even_if_queue_empty);
 
-  // Signals that a response was received from the peer.
+  // Signals that the response to 'call' was received from the peer.
+  // 'rpc_status' is the status of the RPC that carried the request.
   //
   // This method is called from the reactor thread and calls
   // DoProcessResponse() on raft_pool_token_ to do any work that requires IO or
   // lock-taking.
-  void ProcessResponse();
+  void ProcessResponse(const std::shared_ptr<UpdateCall>& call, const Status& rpc_status);
 
   // Run on 'raft_pool_token'. Does response handling that requires IO or may block.
-  void DoProcessResponse();
+  //
+  // The peer's service queue doesn't preserve the order of the requests in
+  // flight, nor does the network that of their responses. Responses are
+  // therefore handed to the queue in the order of their requests: a
+  // response is dropped if that to a later request was already handled. A
+  // pipelined request which reached the peer before the requests ahead of it
+  // is rejected for lacking the preceding operation; its operations are
+  // sent again rather than the peer being considered out of sync.
+  void DoProcessResponse(const std::shared_ptr<UpdateCall>& call);
 
   // Fetch the desired tablet copy request from the queue and set up
   // tc_request_ appropriately.
@@ -146,8 +191,9 @@ class Peer : public std::enable_shared_from_this<Peer> {
   // Handle RPC callback from initiating tablet copy.
   void ProcessTabletCopyResponse();
 
-  // Signals there was an error sending the request to the peer.
-  void ProcessResponseError(const Status& status);
+  // Signals there was an error sending a request to the peer. 'response' is
+  // the response to that request.
+  void ProcessResponseError(const ConsensusResponsePB& response, const Status& status);
 
   std::string LogPrefixUnlocked() const;
 
@@ -163,20 +209,13 @@ class Peer : public std::enable_shared_from_this<Peer> {
   PeerMessageQueue* queue_;
   uint64_t failed_attempts_;
 
-  // The latest consensus update request and response.
-  ConsensusRequestPB request_;
-  ConsensusResponsePB response_;
+  // The committed index in the latest consensus update request assembled.
+  int64_t last_request_committed_index_;
 
-  // The latest tablet copy request and response.
+  // The latest tablet copy request and response, and the controller of the
+  // RPC carrying them.
   StartTabletCopyRequestPB tc_request_;
   StartTabletCopyResponsePB tc_response_;
-
-  // Reference-counted pointers to any ReplicateMsgs which are in-flight to the peer. We
-  // may have loaded these messages from the LogCache, in which case we are potentially
-  // sharing the same object as other peers. Since the PB request_ itself can't hold
-  // reference counts, this holds them.
-  std::vector<ReplicateRefPtr> replicate_msg_refs_;
-
   rpc::RpcController controller_;
 
   std::shared_ptr<rpc::Messenger> messenger_;
@@ -191,9 +230,20 @@ class Peer : public std::enable_shared_from_this<Peer> {
 
   // Lock that protects Peer state changes, initialization, etc.
   mutable simple_spinlock peer_lock_;
-  bool request_pending_ = false;
+  // The number of requests to the peer, including tablet copy requests, that
+  // have been sent and whose responses haven't been processed yet.
+  int requests_in_flight_ = 0;
   bool closed_ = false;
   bool has_sent_first_request_ = false;
+  // The sequence number of the next UpdateCall. Protected by 'peer_lock_'.
+  int64_t next_sequence_number_ = 0;
+
+  // Serializes the handling of responses by DoProcessResponse(), which runs
+  // on a concurrent thread pool token.
+  std::mutex response_lock_;
+  // The sequence number of the latest UpdateCall whose response was handed to
+  // the queue. Protected by 'response_lock_'.
+  int64_t last_handled_sequence_number_ = -1;
 };
 
 // A proxy to another peer. Usually a thin wrapper around an rpc proxy but can
@@ -208,6 +258,19 @@ class PeerProxy {
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) = 0;
 
+  // Sends a heartbeat, i.e. a request which carries no operations,
+  // asynchronously, to a remote peer. Since the request may be sent as part
+  // of a larger RPC, 'callback' is passed the status of the RPC rather than
+  // it being set in 'controller'. By default, the request is sent on its own.
+  virtual void HeartbeatAsync(const ConsensusRequestPB* request,
+                              ConsensusResponsePB* response,
+                              rpc::RpcController* controller,
+                              const StdStatusCallback& callback) {
+    UpdateAsync(request, response, controller, [controller, callback]() {
+      callback(controller->status());
+    });
+  }
+
   // Sends a RequestConsensusVote to a remote peer.
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
@@ -246,14 +309,22 @@ class PeerProxyFactory {
 // PeerProxy implementation that does RPC calls
 class RpcPeerProxy : public PeerProxy {
  public:
+  // If 'heartbeat_batcher' is set, heartbeats are sent through it, batched
+  // with those of other tablets to the same server.
   RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-               gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+               gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+               std::shared_ptr<HeartbeatBatcher> heartbeat_batcher);
 
   void UpdateAsync(const ConsensusRequestPB* request,
                    ConsensusResponsePB* response,
                    rpc::RpcController* controller,
                    const rpc::ResponseCallback& callback) override;
 
+  void HeartbeatAsync(const ConsensusRequestPB* request,
+                      ConsensusResponsePB* response,
+                      rpc::RpcController* controller,
+                      const StdStatusCallback& callback) override;
+
   void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                  VoteResponsePB* response,
                                  rpc::RpcController* controller,
@@ -273,12 +344,16 @@ class RpcPeerProxy : public PeerProxy {
  private:
   gscoped_ptr<HostPort> hostport_;
   gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+  std::shared_ptr<HeartbeatBatcher> heartbeat_batcher_;
 };
 
 // PeerProxyFactory implementation that generates RPCPeerProxies
 class RpcPeerProxyFactory : public PeerProxyFactory {
  public:
-  explicit RpcPeerProxyFactory(std::shared_ptr<rpc::Messenger> messenger);
+  // 'local_uuid' is the UUID of the local server, which is sent along with
+  // its liveness signals.
+  RpcPeerProxyFactory(std::shared_ptr<rpc::Messenger> messenger,
+                      std::string local_uuid);
 
   Status NewProxy(const RaftPeerPB& peer_pb,
                   gscoped_ptr<PeerProxy>* proxy) override;
@@ -291,6 +366,7 @@ class RpcPeerProxyFactory : public PeerProxyFactory {
 
  private:
   std::shared_ptr<rpc::Messenger> messenger_;
+  const std::string local_uuid_;
 };
 
 // Query the consensus service at last known host/port that is
@@ -59,6 +59,7 @@
 #include "kudu/util/threadpool.h"
 
 DECLARE_int32(consensus_max_batch_size_bytes);
+DECLARE_int32(consensus_max_inflight_requests_per_peer);
 DECLARE_int32(follower_unavailable_considered_failed_sec);
 
 using kudu::consensus::HealthReportPB;
@@ -720,6 +721,80 @@ TEST_F(ConsensusQueueTest, TestQueueHandlesOperationOverwriting) {
   request.mutable_ops()->ExtractSubrange(0, request.ops().size(), nullptr);
 }
 
+// Tests that pipelined requests carry the operations after those already in
+// flight, and that the operations of a pipelined request which overtook the
+// request ahead of it are sent again.
+TEST_F(ConsensusQueueTest, TestPipelinedRequests) {
+  FLAGS_consensus_max_inflight_requests_per_peer = 2;
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 100);
+
+  ConsensusRequestPB request;
+  ConsensusResponsePB response;
+  response.set_responder_uuid(kPeerUuid);
+  bool send_more_immediately = false;
+  UpdatePeerWatermarkToOp(&request, &response, MakeOpId(7, 50), MinimumOpId(),
+                          &send_more_immediately);
+  ASSERT_TRUE(send_more_immediately);
+
+  // Nothing is pipelined until the peer is known to be in sync.
+  vector<ReplicateRefPtr> refs;
+  bool needs_tablet_copy;
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &request, &refs, &needs_tablet_copy,
+                                   /*pipelined=*/true));
+  ASSERT_FALSE(needs_tablet_copy);
+  ASSERT_EQ(0, request.ops_size());
+
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &request, &refs, &needs_tablet_copy));
+  ASSERT_EQ(50, request.ops_size());
+  SetLastReceivedAndLastCommitted(&response, request.ops(49).id());
+  queue_->ResponseFromPeer(response.responder_uuid(), response);
+
+  // Send the next operations, and pipeline some more behind them.
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 101, 50);
+  ConsensusRequestPB first_request;
+  vector<ReplicateRefPtr> first_refs;
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &first_request, &first_refs,
+                                   &needs_tablet_copy));
+  ASSERT_EQ(50, first_request.ops_size());
+  ASSERT_EQ(150, first_request.ops(49).id().index());
+
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 151, 50);
+  ConsensusRequestPB second_request;
+  vector<ReplicateRefPtr> second_refs;
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &second_request, &second_refs,
+                                   &needs_tablet_copy, /*pipelined=*/true));
+  ASSERT_EQ(50, second_request.ops_size());
+  ASSERT_EQ(150, second_request.preceding_id().index());
+  ASSERT_EQ(151, second_request.ops(0).id().index());
+
+  // The second request reached the peer first, and was rejected for lacking
+  // the operations of the first.
+  queue_->PipelinedRequestRejected(kPeerUuid, second_request.preceding_id().index());
+
+  ConsensusResponsePB first_response;
+  first_response.set_responder_uuid(kPeerUuid);
+  SetLastReceivedAndLastCommitted(&first_response, first_request.ops(49).id());
+  queue_->ResponseFromPeer(kPeerUuid, first_response);
+  PeerMessageQueue::TrackedPeer peer = queue_->GetTrackedPeerForTests(kPeerUuid);
+  ASSERT_EQ(150, peer.last_received.index());
+  ASSERT_EQ(151, peer.next_index);
+
+  // The operations of the second request are pipelined again.
+  ConsensusRequestPB third_request;
+  vector<ReplicateRefPtr> third_refs;
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &third_request, &third_refs,
+                                   &needs_tablet_copy, /*pipelined=*/true));
+  ASSERT_EQ(50, third_request.ops_size());
+  ASSERT_EQ(151, third_request.ops(0).id().index());
+
+  // Extract the ops from the requests to avoid double frees.
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+  first_request.mutable_ops()->ExtractSubrange(0, first_request.ops_size(), nullptr);
+  second_request.mutable_ops()->ExtractSubrange(0, second_request.ops_size(), nullptr);
+  third_request.mutable_ops()->ExtractSubrange(0, third_request.ops_size(), nullptr);
+}
+
 // Test for a bug where we wouldn't move any watermark back, when overwriting
 // operations, which would cause a check failure on the write immediately
 // following the overwriting write.
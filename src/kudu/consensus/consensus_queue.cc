@@ -59,6 +59,16 @@ DEFINE_int32(consensus_max_batch_size_bytes, 1024 * 1024,
              "The maximum per-tablet RPC batch size when updating peers.");
 TAG_FLAG(consensus_max_batch_size_bytes, advanced);
 
+DEFINE_int32(consensus_max_inflight_requests_per_peer, 1,
+             "The maximum number of UpdateConsensus requests that a leader keeps "
+             "in flight to each of its followers. Values greater than 1 let a "
+             "leader send further batches of operations to a follower which is "
+             "in sync without waiting for the previous batch to be acknowledged, "
+             "so that replication over high-latency links is not limited to one "
+             "batch per round trip.");
+TAG_FLAG(consensus_max_inflight_requests_per_peer, advanced);
+TAG_FLAG(consensus_max_inflight_requests_per_peer, experimental);
+
 DEFINE_int32(follower_unavailable_considered_failed_sec, 300,
              "Seconds that a leader is unable to successfully heartbeat to a "
              "follower after which the follower is considered to be failed and "
@@ -77,6 +87,9 @@ DECLARE_int32(consensus_rpc_timeout_ms);
 DECLARE_bool(safe_time_advancement_without_writes);
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_bool(raft_attempt_to_replace_replica_without_majority);
+DECLARE_bool(raft_enable_leader_leases);
+DECLARE_double(leader_failure_max_missed_heartbeat_periods);
+DECLARE_int32(raft_heartbeat_interval_ms);
 
 using kudu::log::Log;
 using kudu::pb_util::SecureDebugString;
@@ -102,6 +115,19 @@ METRIC_DEFINE_gauge_int64(tablet, ops_behind_leader, "Operations Behind Leader",
                           MetricUnit::kOperations,
                           "Number of operations this server believes it is behind the leader.");
 
+namespace {
+
+// Returns how long a leader's lease lasts past the time it was granted. The
+// followers withhold their votes for the minimum election timeout; the lease
+// is a little shorter to allow for server clocks running at slightly different
+// rates.
+MonoDelta LeaderLeaseDuration() {
+  return MonoDelta::FromMilliseconds(0.9 * FLAGS_leader_failure_max_missed_heartbeat_periods *
+                                     FLAGS_raft_heartbeat_interval_ms);
+}
+
+} // anonymous namespace
+
 const char* PeerStatusToString(PeerStatus p) {
   switch (p) {
     case PeerStatus::OK: return "OK";
@@ -121,13 +147,16 @@ const char* PeerStatusToString(PeerStatus p) {
 PeerMessageQueue::TrackedPeer::TrackedPeer(RaftPeerPB peer_pb)
     : peer_pb(std::move(peer_pb)),
       next_index(kInvalidOpIdIndex),
+      last_sent_index(kInvalidOpIdIndex),
       last_received(MinimumOpId()),
       last_known_committed_index(MinimumOpId().index()),
       last_exchange_status(PeerStatus::NEW),
       last_communication_time(MonoTime::Now()),
       wal_catchup_possible(true),
       last_overall_health_status(HealthReportPB::UNKNOWN),
+      last_lease_grant_time(MonoTime::Min()),
       status_log_throttler(std::make_shared<logging::LogThrottler>()),
+      log_read_ahead(std::make_shared<LogCache::ReadAheadBuffer>()),
       last_seen_term_(0) {
 }
 
@@ -157,7 +186,8 @@ PeerMessageQueue::PeerMessageQueue(const scoped_refptr<MetricEntity>& metric_ent
                                    string tablet_id,
                                    unique_ptr<ThreadPoolToken> raft_pool_observers_token,
                                    OpId last_locally_replicated,
-                                   const OpId& last_locally_committed)
+                                   const OpId& last_locally_committed,
+                                   unique_ptr<ThreadPoolToken> log_read_ahead_token)
     : raft_pool_observers_token_(std::move(raft_pool_observers_token)),
       local_peer_pb_(std::move(local_peer_pb)),
       tablet_id_(std::move(tablet_id)),
@@ -182,6 +212,9 @@ PeerMessageQueue::PeerMessageQueue(const scoped_refptr<MetricEntity>& metric_ent
   queue_state_.state = kQueueOpen;
   // TODO(mpercy): Merge LogCache::Init() with its constructor.
   log_cache_.Init(queue_state_.last_appended);
+  if (log_read_ahead_token) {
+    log_cache_.EnableReadAhead(std::move(log_read_ahead_token));
+  }
 }
 
 void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
@@ -192,6 +225,10 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
     CHECK_GT(current_term, queue_state_.current_term) << "Terms should only increase";
     queue_state_.first_index_in_current_term = boost::none;
     queue_state_.current_term = current_term;
+    // Leases granted in earlier terms don't count.
+    for (const PeersMap::value_type& entry : peers_map_) {
+      entry.second->last_lease_grant_time = MonoTime::Min();
+    }
   }
 
   queue_state_.committed_index = committed_index;
@@ -213,6 +250,7 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
     entry.second->last_communication_time = now;
   }
   time_manager_->SetLeaderMode();
+  UpdateLeaderLeaseUnlocked();
 }
 
 void PeerMessageQueue::SetNonLeaderMode(const RaftConfigPB& active_config) {
@@ -507,6 +545,45 @@ bool PeerMessageQueue::SafeToEvictUnlocked(const string& evict_uuid) const {
   return true;
 }
 
+void PeerMessageQueue::UpdateLeaderLeaseUnlocked() {
+  DCHECK(queue_lock_.is_locked());
+  if (!FLAGS_raft_enable_leader_leases || queue_state_.mode != LEADER ||
+      successor_watch_in_progress_) {
+    return;
+  }
+  // The local peer always grants itself the lease, so a leader which makes up
+  // a majority on its own holds it for good.
+  if (queue_state_.majority_size_ == 1) {
+    time_manager_->UpdateLeaderLease(MonoTime::Max());
+    return;
+  }
+
+  const MonoTime now = MonoTime::Now();
+  vector<MonoTime> grant_times;
+  for (const PeersMap::value_type& entry : peers_map_) {
+    const TrackedPeer* peer = entry.second;
+    if (peer->peer_pb.member_type() != RaftPeerPB::VOTER) {
+      continue;
+    }
+    grant_times.push_back(peer->uuid() == local_peer_pb_.permanent_uuid() ?
+                          now : peer->last_lease_grant_time);
+  }
+  MonoTime expiry = MonoTime::Min();
+  if (queue_state_.majority_size_ > 0 &&
+      static_cast<int>(grant_times.size()) >= queue_state_.majority_size_) {
+    // The lease holds from the latest time by which a majority granted it.
+    std::nth_element(grant_times.begin(),
+                     grant_times.begin() + queue_state_.majority_size_ - 1,
+                     grant_times.end(),
+                     std::greater<MonoTime>());
+    const MonoTime& granted = grant_times[queue_state_.majority_size_ - 1];
+    if (granted != MonoTime::Min()) {
+      expiry = granted + LeaderLeaseDuration();
+    }
+  }
+  time_manager_->UpdateLeaderLease(expiry);
+}
+
 void PeerMessageQueue::UpdatePeerHealthUnlocked(TrackedPeer* peer) {
   DCHECK(queue_lock_.is_locked());
   DCHECK_EQ(LEADER, queue_state_.mode);
@@ -611,12 +688,22 @@ HealthReportPB::HealthStatus PeerMessageQueue::PeerHealthStatus(const TrackedPee
 Status PeerMessageQueue::RequestForPeer(const string& uuid,
                                         ConsensusRequestPB* request,
                                         vector<ReplicateRefPtr>* msg_refs,
-                                        bool* needs_tablet_copy) {
+                                        bool* needs_tablet_copy,
+                                        bool pipelined) {
   // Maintain a thread-safe copy of necessary members.
   OpId preceding_id;
   int64_t current_term;
   TrackedPeer peer_copy;
   MonoDelta unreachable_time;
+
+  // A leader holding a lease attaches its safe time to any request that brings
+  // the peer up to date, not just to heartbeats. Safe time is taken before the
+  // last appended op so that all the ops with lower timestamps are appended
+  // by then.
+  boost::optional<Timestamp> lease_safe_time;
+  if (FLAGS_raft_enable_leader_leases && time_manager_->HasLeaderLease()) {
+    lease_safe_time = time_manager_->GetSafeTime();
+  }
   {
     std::lock_guard<simple_spinlock> lock(queue_lock_);
     DCHECK_EQ(queue_state_.state, kQueueOpen);
@@ -647,6 +734,7 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
   // Always trigger a health status update check at the end of this function.
   bool wal_catchup_progress = false;
   bool wal_catchup_failure = false;
+  int64_t last_op_sent = kInvalidOpIdIndex;
   SCOPED_CLEANUP({
       std::lock_guard<simple_spinlock> lock(queue_lock_);
       TrackedPeer* peer = FindPtrOrNull(peers_map_, uuid);
@@ -657,9 +745,23 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
       }
       if (wal_catchup_progress) peer->wal_catchup_possible = true;
       if (wal_catchup_failure) peer->wal_catchup_possible = false;
+      if (last_op_sent != kInvalidOpIdIndex) {
+        peer->last_sent_index = pipelined ?
+            std::max(peer->last_sent_index, last_op_sent) : last_op_sent;
+      }
       UpdatePeerHealthUnlocked(peer);
     });
 
+  if (pipelined) {
+    // Only pipeline entries to a peer which is known to be in sync with us;
+    // otherwise the request which is already in flight will sort it out.
+    *needs_tablet_copy = false;
+    if (peer_copy.last_exchange_status != PeerStatus::OK) {
+      request->mutable_preceding_id()->CopyFrom(preceding_id);
+      return Status::OK();
+    }
+  }
+
   if (peer_copy.last_exchange_status == PeerStatus::TABLET_NOT_FOUND) {
     VLOG(3) << LogPrefixUnlocked() << "Peer " << uuid << " needs tablet copy" << THROTTLE_MSG;
     *needs_tablet_copy = true;
@@ -676,11 +778,17 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     vector<ReplicateRefPtr> messages;
     int max_batch_size = FLAGS_consensus_max_batch_size_bytes - request->ByteSize();
 
-    // We try to get the follower's next_index from our log.
-    Status s = log_cache_.ReadOps(peer_copy.next_index - 1,
+    // We try to get the follower's next_index from our log, or the entry after
+    // the last one already in flight if this request is pipelined.
+    int64_t after_index = peer_copy.next_index - 1;
+    if (pipelined) {
+      after_index = std::max(after_index, peer_copy.last_sent_index);
+    }
+    Status s = log_cache_.ReadOps(after_index,
                                   max_batch_size,
                                   &messages,
-                                  &preceding_id);
+                                  &preceding_id,
+                                  peer_copy.log_read_ahead);
     if (PREDICT_FALSE(!s.ok())) {
       // It's normal to have a NotFound() here if a follower falls behind where
       // the leader has GCed its logs. The follower replica will hang around
@@ -720,6 +828,8 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
       request->mutable_ops()->AddAllocated(msg->get());
     }
     msg_refs->swap(messages);
+    last_op_sent = request->ops_size() > 0 ?
+        request->ops(request->ops_size() - 1).id().index() : after_index;
   }
 
   DCHECK(preceding_id.IsInitialized());
@@ -736,6 +846,9 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
           << (request->committed_index() - last_op_sent)
           << " ops behind the committed index " << THROTTLE_MSG;
     }
+    if (lease_safe_time && last_op_sent == request->last_idx_appended_to_leader()) {
+      request->set_safe_timestamp(lease_safe_time->value());
+    }
   // If we're not sending ops to the follower, set the safe time on the request.
   // TODO(dralves) When we have leader leases, send this all the time.
   } else {
@@ -873,6 +986,9 @@ void PeerMessageQueue::BeginWatchForSuccessor(
   std::lock_guard<simple_spinlock> l(queue_lock_);
   successor_watch_in_progress_ = true;
   designated_successor_uuid_ = successor_uuid;
+  // The successor is going to be elected regardless of whether a majority is
+  // withholding its votes, so give up the lease.
+  time_manager_->RevokeLeaderLease();
 }
 
 void PeerMessageQueue::EndWatchForSuccessor() {
@@ -896,6 +1012,16 @@ void PeerMessageQueue::UpdateLastIndexAppendedToLeader(int64_t last_idx_appended
   UpdateLagMetricsUnlocked();
 }
 
+void PeerMessageQueue::PipelinedRequestRejected(const string& peer_uuid,
+                                                int64_t preceding_index) {
+  std::lock_guard<simple_spinlock> l(queue_lock_);
+  TrackedPeer* peer = FindPtrOrNull(peers_map_, peer_uuid);
+  if (PREDICT_FALSE(peer == nullptr || queue_state_.mode == NON_LEADER)) {
+    return;
+  }
+  peer->last_sent_index = std::min(peer->last_sent_index, preceding_index);
+}
+
 void PeerMessageQueue::UpdatePeerStatus(const string& peer_uuid,
                                         PeerStatus ps,
                                         const Status& status) {
@@ -907,6 +1033,11 @@ void PeerMessageQueue::UpdatePeerStatus(const string& peer_uuid,
     return;
   }
   peer->last_exchange_status = ps;
+  if (ps != PeerStatus::OK) {
+    // The request may have been lost, so don't pipeline any more entries
+    // behind it.
+    peer->last_sent_index = peer->next_index - 1;
+  }
 
   if (ps != PeerStatus::RPC_LAYER_ERROR) {
     // So long as we got _any_ response from the follower, we consider it a 'communication'.
@@ -1075,7 +1206,8 @@ void PeerMessageQueue::TransferLeadershipIfNeeded(const TrackedPeer& peer,
 }
 
 bool PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
-                                        const ConsensusResponsePB& response) {
+                                        const ConsensusResponsePB& response,
+                                        const MonoTime& request_time) {
   DCHECK(response.IsInitialized()) << "Error: Uninitialized: "
       << response.InitializationErrorString() << ". Response: " << SecureShortDebugString(response);
   CHECK(!response.has_error());
@@ -1159,12 +1291,19 @@ bool PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
     }
 
     if (peer->last_exchange_status != PeerStatus::OK) {
+      // Anything in flight beyond 'next_index' is to be sent again.
+      peer->last_sent_index = peer->next_index - 1;
       // In this case, 'send_more_immediately' has already been set by
       // UpdateExchangeStatus() to true in the case of an LMP mismatch, false
       // otherwise.
       return send_more_immediately;
     }
 
+    if (request_time.Initialized() && request_time > peer->last_lease_grant_time) {
+      peer->last_lease_grant_time = request_time;
+      UpdateLeaderLeaseUnlocked();
+    }
+
     if (response.has_responder_term()) {
       // The peer must have responded with a term that is greater than or equal to
       // the last known term for that peer.
@@ -110,9 +110,8 @@ const char* PeerStatusToString(PeerStatus p);
 // This also takes care of pushing requests to peers as new operations are
 // added, and notifying RaftConsensus when the commit index advances.
 //
-// TODO(todd): Right now this class is able to track one outstanding operation
-// per peer. If we want to have more than one outstanding RPC we need to
-// modify it.
+// Several requests may be in flight to a peer at once if they are pipelined:
+// see RequestForPeer().
 class PeerMessageQueue {
  public:
   struct TrackedPeer {
@@ -142,6 +141,11 @@ class PeerMessageQueue {
     // This corresponds to "nextIndex" as specified in Raft.
     int64_t next_index;
 
+    // The index of the last operation sent to the peer, which may be beyond
+    // 'next_index' if requests are in flight. Pipelined requests start
+    // after it.
+    int64_t last_sent_index;
+
     // The last operation that we've sent to this peer and that
     // it acked. Used for watermark movement.
     OpId last_received;
@@ -171,10 +175,19 @@ class PeerMessageQueue {
     // The peer's latest overall health status.
     HealthReportPB::HealthStatus last_overall_health_status;
 
+    // The time the latest request this peer accepted was assembled. Having
+    // accepted it, the peer withholds its vote from other candidates for the
+    // minimum election timeout, which grants the leader's lease.
+    MonoTime last_lease_grant_time;
+
     // Throttler for how often we will log status messages pertaining to this
     // peer (eg when it is lagging, etc).
     std::shared_ptr<logging::LogThrottler> status_log_throttler;
 
+    // The operations read ahead from the on-disk log for this peer, if it's
+    // being caught up from it. Shared by the copies of the peer.
+    std::shared_ptr<LogCache::ReadAheadBuffer> log_read_ahead;
+
    private:
     // The last term we saw from a given peer.
     // This is only used for sanity checking that a peer doesn't
@@ -189,7 +202,8 @@ class PeerMessageQueue {
                    std::string tablet_id,
                    std::unique_ptr<ThreadPoolToken> raft_pool_observers_token,
                    OpId last_locally_replicated,
-                   const OpId& last_locally_committed);
+                   const OpId& last_locally_committed,
+                   std::unique_ptr<ThreadPoolToken> log_read_ahead_token = nullptr);
 
   // Changes the queue to leader mode, meaning it tracks majority replicated
   // operations and notifies observers when those change.
@@ -268,10 +282,22 @@ class PeerMessageQueue {
   // instance of ConsensusRequestPB to RequestForPeer(): the buffer will
   // replace the old entries with new ones without de-allocating the old
   // ones if they are still required.
+  //
+  // If 'pipelined' is true, the request is to be sent while others are still
+  // in flight to the peer, and carries the entries after the last one sent
+  // rather than those after the peer's 'next_index'. Such a request is left
+  // without entries unless the last exchange with the peer was successful.
   Status RequestForPeer(const std::string& uuid,
                         ConsensusRequestPB* request,
                         std::vector<ReplicateRefPtr>* msg_refs,
-                        bool* needs_tablet_copy);
+                        bool* needs_tablet_copy,
+                        bool pipelined = false);
+
+  // Signals that a pipelined request carrying the operations after
+  // 'preceding_index' was rejected by the peer because it arrived before
+  // the requests ahead of it. Those operations are sent again by the next
+  // requests to the peer.
+  void PipelinedRequestRejected(const std::string& peer_uuid, int64_t preceding_index);
 
   // Fill in a StartTabletCopyRequest for the specified peer.
   // If that peer should not initiate Tablet Copy, returns a non-OK status.
@@ -288,12 +314,14 @@ class PeerMessageQueue {
                         const Status& status);
 
   // Updates the request queue with the latest response from a request to a
-  // consensus peer.
+  // consensus peer. 'request_time', if initialized, is the time the request
+  // was assembled, and is used to extend the leader's lease.
   // Returns true iff there are more requests pending in the queue for this
   // peer and another request should be sent immediately, with no intervening
   // delay.
   bool ResponseFromPeer(const std::string& peer_uuid,
-                        const ConsensusResponsePB& response);
+                        const ConsensusResponsePB& response,
+                        const MonoTime& request_time = MonoTime());
 
   // Called by the consensus implementation to update the queue's watermarks
   // based on information provided by the leader. This is used for metrics and
@@ -453,6 +481,11 @@ class PeerMessageQueue {
   // notifications.
   void UpdatePeerHealthUnlocked(TrackedPeer* peer);
 
+  // Sets the leader's lease in the TimeManager to expire a little less than the
+  // minimum election timeout past the time by which a majority of the voters
+  // last granted it.
+  void UpdateLeaderLeaseUnlocked();
+
   // Update the peer's last exchange status, and other fields, based on the
   // response. Sets 'lmp_mismatch' to true if the given response indicates
   // there was a log-matching property mismatch on the remote, otherwise sets
@@ -53,6 +53,8 @@
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/env.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
@@ -68,6 +70,15 @@ DECLARE_double(log_inject_io_error_on_preallocate_fraction);
 DECLARE_int64(fs_wal_dir_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_string(log_compression_codec);
+DECLARE_bool(log_inject_latency);
+DECLARE_bool(log_use_segment_index);
+DECLARE_int32(log_append_shared_pool_threads);
+DECLARE_int32(log_group_commit_max_wait_us);
+DECLARE_int32(log_inject_latency_ms_mean);
+DECLARE_int32(log_inject_latency_ms_stddev);
+
+METRIC_DECLARE_histogram(log_group_commit_bytes);
+METRIC_DECLARE_histogram(log_group_commit_wait_time);
 
 namespace kudu {
 namespace log {
@@ -80,7 +91,9 @@ using consensus::CommitMsg;
 using consensus::MakeOpId;
 using consensus::NO_OP;
 using consensus::OpId;
+using consensus::make_scoped_refptr_replicate;
 using consensus::ReplicateMsg;
+using consensus::ReplicateRefPtr;
 using consensus::WRITE_OP;
 using strings::Substitute;
 
@@ -1088,6 +1101,63 @@ TEST_F(LogTest, TestGetGCableDataSize) {
   EXPECT_EQ(kSegmentSizeBytes * 4, log_->GetGCableDataSize(RetentionIndexes(35)));
 }
 
+// Test that the segment index is kept up to date as the log rolls and is
+// closed, and that reopening the log with it, or with a stale version of it,
+// finds the same segments as reading their footers.
+TEST_F(LogTest, TestSegmentIndex) {
+  ASSERT_OK(BuildLog());
+  const int kNumSegments = 4;
+  OpId op_id = MakeOpId(1, 1);
+  ASSERT_OK(AppendMultiSegmentSequence(kNumSegments, 5, &op_id, nullptr));
+  ASSERT_OK(log_->Close());
+
+  // All the segments were closed, so all of them are in the index.
+  const string wal_dir = fs_manager_->GetTabletWalDir(kTestTablet);
+  LogSegmentIndexPB index;
+  ASSERT_OK(ReadLogSegmentIndex(env_, wal_dir, &index));
+  ASSERT_EQ(kNumSegments, index.segments_size());
+
+  auto read_footers = [&](vector<LogSegmentFooterPB>* footers) {
+    shared_ptr<LogReader> reader;
+    ASSERT_OK(LogReader::Open(fs_manager_.get(), nullptr, kTestTablet, nullptr, &reader));
+    SegmentSequence segments;
+    ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+    footers->clear();
+    for (const auto& segment : segments) {
+      ASSERT_TRUE(segment->HasFooter());
+      ASSERT_FALSE(segment->footer_was_rebuilt());
+      footers->push_back(segment->footer());
+    }
+  };
+
+  vector<LogSegmentFooterPB> expected;
+  FLAGS_log_use_segment_index = false;
+  NO_FATALS(read_footers(&expected));
+  ASSERT_EQ(kNumSegments, expected.size());
+
+  FLAGS_log_use_segment_index = true;
+  vector<LogSegmentFooterPB> footers;
+  NO_FATALS(read_footers(&footers));
+  ASSERT_EQ(expected.size(), footers.size());
+  for (size_t i = 0; i < footers.size(); i++) {
+    ASSERT_EQ(pb_util::SecureShortDebugString(expected[i]),
+              pb_util::SecureShortDebugString(footers[i]));
+  }
+
+  // Make the entry of the first segment stale. It should be ignored in favor
+  // of the footer on disk.
+  LogSegmentIndexPB::SegmentPB* entry = index.mutable_segments(0);
+  entry->set_file_size(entry->file_size() + 1);
+  entry->mutable_footer()->set_num_entries(entry->footer().num_entries() + 1);
+  ASSERT_OK(pb_util::WritePBContainerToPath(env_,
+                                            JoinPathSegments(wal_dir, kLogSegmentIndexFileName),
+                                            index, pb_util::OVERWRITE, pb_util::NO_SYNC));
+  NO_FATALS(read_footers(&footers));
+  ASSERT_EQ(expected.size(), footers.size());
+  ASSERT_EQ(pb_util::SecureShortDebugString(expected[0]),
+            pb_util::SecureShortDebugString(footers[0]));
+}
+
 // Regression test. Check that failed preallocation returns an error instead of
 // hanging.
 TEST_F(LogTest, TestFailedLogPreAllocation) {
@@ -1140,6 +1210,74 @@ TEST_F(LogTest, TestAutoStopIdleAppendThread) {
     });
 }
 
+// Test that logs appending on the shared pool don't hold its threads while
+// idle, and that the entries appended that way can be read back.
+TEST_F(LogTest, TestSharedAppendPool) {
+  FLAGS_log_append_shared_pool_threads = 2;
+  ASSERT_OK(BuildLog());
+  OpId opid = MakeOpId(1, 1);
+  const int kNumEntries = 100;
+  ASSERT_OK(AppendNoOps(&opid, kNumEntries / 2));
+  // The next segment is allocated on the shared allocation pool.
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+  ASSERT_OK(log_->AllocateSegmentAndRollOver());
+  ASSERT_OK(AppendNoOps(&opid, kNumEntries / 2));
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_FALSE(log_->append_thread_active_for_tests());
+    });
+  ASSERT_OK(log_->Close());
+
+  shared_ptr<LogReader> reader;
+  ASSERT_OK(LogReader::Open(fs_manager_.get(), nullptr, kTestTablet, nullptr, &reader));
+  vector<scoped_refptr<ReadableLogSegment>> segments;
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  int num_entries = 0;
+  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
+    entries_.clear();
+    ASSERT_OK(segment->ReadEntries(&entries_));
+    num_entries += entries_.size();
+  }
+  ASSERT_EQ(2, segments.size());
+  ASSERT_EQ(kNumEntries, num_entries);
+}
+
+// Test that, once it has measured the latency of an fsync, the append thread
+// waits for more entries to join a group before syncing it.
+TEST_F(LogTest, TestGroupCommitWait) {
+  options_.force_fsync_all = true;
+  FLAGS_log_inject_latency = true;
+  FLAGS_log_inject_latency_ms_mean = 20;
+  FLAGS_log_inject_latency_ms_stddev = 0;
+  FLAGS_log_group_commit_max_wait_us = 5000;
+  ASSERT_OK(BuildLog());
+  OpId opid = MakeOpId(1, 1);
+
+  // The first group measures the (injected) fsync latency.
+  ASSERT_OK(AppendNoOp(&opid));
+  scoped_refptr<Histogram> wait_time =
+      METRIC_log_group_commit_wait_time.Instantiate(metric_entity_);
+  scoped_refptr<Histogram> group_bytes =
+      METRIC_log_group_commit_bytes.Instantiate(metric_entity_);
+
+  // The next groups wait for more entries before syncing.
+  const int kNumAppends = 10;
+  vector<Synchronizer> syncs(kNumAppends);
+  for (int i = 0; i < kNumAppends; i++) {
+    ReplicateRefPtr replicate = make_scoped_refptr_replicate(new ReplicateMsg());
+    replicate->get()->mutable_id()->CopyFrom(opid);
+    replicate->get()->set_op_type(NO_OP);
+    replicate->get()->set_timestamp(clock_->Now().ToUint64());
+    opid.set_index(opid.index() + 1);
+    ASSERT_OK(log_->AsyncAppendReplicates({ replicate }, syncs[i].AsStatusCallback()));
+  }
+  for (auto& s : syncs) {
+    ASSERT_OK(s.Wait());
+  }
+  ASSERT_GE(wait_time->TotalCount(), 1);
+  ASSERT_GE(group_bytes->TotalCount(), 2);
+  ASSERT_OK(log_->Close());
+}
+
 // Test that Log::TotalSize() captures creation, addition, and deletion of log segments.
 TEST_P(LogTestOptionalCompression, TestTotalSize) {
   // Build a log. There is an active segment, so on-disk size should be positive.
@@ -17,6 +17,7 @@
 
 #include "kudu/consensus/log.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdint>
 #include <memory>
@@ -84,6 +85,25 @@ DEFINE_int32(group_commit_queue_size_bytes, 4 * 1024 * 1024,
              "Maximum size of the group commit queue in bytes");
 TAG_FLAG(group_commit_queue_size_bytes, advanced);
 
+DEFINE_int32(log_group_commit_max_wait_us, 0,
+             "Maximum number of microseconds the log append thread may wait for more "
+             "entries before syncing a group. The wait is further bounded by half of "
+             "the recently measured WAL fsync latency, which is shared by all the "
+             "tablets of the server, and is skipped for a while after a wait that "
+             "collected no entries. Only applies when fsync is enabled. If 0, groups "
+             "are synced as soon as they are collected.");
+TAG_FLAG(log_group_commit_max_wait_us, advanced);
+TAG_FLAG(log_group_commit_max_wait_us, experimental);
+TAG_FLAG(log_group_commit_max_wait_us, runtime);
+
+
+DEFINE_int32(log_append_shared_pool_threads, 0,
+             "If greater than 0, the logs of all tablets on the server append and "
+             "sync their entries on a single shared pool with this many threads, "
+             "instead of each log using its own append thread. This bounds the "
+             "number of WAL threads on servers with many tablets.");
+TAG_FLAG(log_append_shared_pool_threads, advanced);
+TAG_FLAG(log_append_shared_pool_threads, experimental);
 
 DEFINE_int32(log_thread_idle_threshold_ms, 1000,
              "Number of milliseconds after which the log append thread decides that a "
@@ -91,6 +111,15 @@ DEFINE_int32(log_thread_idle_threshold_ms, 1000,
 TAG_FLAG(log_thread_idle_threshold_ms, experimental);
 TAG_FLAG(log_thread_idle_threshold_ms, hidden);
 
+DEFINE_bool(log_drop_segment_page_cache, false,
+            "Whether to evict WAL segment data from the OS page cache once it has "
+            "been synced. This keeps the WAL from crowding other data out of the "
+            "cache and makes sync latency less sensitive to memory pressure, at "
+            "the cost of reading from disk when catching up lagging peers from "
+            "the log. Only takes effect if --log_force_fsync_all is set.");
+TAG_FLAG(log_drop_segment_page_cache, advanced);
+TAG_FLAG(log_drop_segment_page_cache, experimental);
+
 // Compression configuration.
 // -----------------------------
 DEFINE_string(log_compression_codec, "LZ4",
@@ -170,6 +199,8 @@ static bool ValidateLogsToRetain(const char* flagname, int value) {
 static bool dummy = google::RegisterFlagValidator(
     &FLAGS_log_min_segments_to_retain, &ValidateLogsToRetain);
 
+DECLARE_bool(log_use_segment_index);
+
 namespace kudu {
 namespace log {
 
@@ -205,6 +236,60 @@ using strings::Substitute;
 //    ensure that it doesn't miss a concurrent wake-up. This is done in GoIdle().
 //
 // See the implementation comments in Wake() and GoIdle() for details.
+namespace {
+
+// Exponentially-weighted moving average of the latency of WAL syncs that
+// fsync, in microseconds. It is shared by every Log in the process: all the
+// WALs live in the same directory and so sync against the same disk.
+Atomic64 g_wal_fsync_latency_ewma_us = 0;
+
+void RecordWalFsyncLatency(int64_t latency_us) {
+  while (true) {
+    Atomic64 old_ewma = base::subtle::NoBarrier_Load(&g_wal_fsync_latency_ewma_us);
+    Atomic64 new_ewma = old_ewma == 0 ? latency_us : old_ewma + (latency_us - old_ewma) / 8;
+    if (base::subtle::NoBarrier_CompareAndSwap(
+            &g_wal_fsync_latency_ewma_us, old_ewma, new_ewma) == old_ewma) {
+      return;
+    }
+  }
+}
+
+// Returns the pool shared by the append tasks of every Log in the process,
+// creating it on first use. Only used if --log_append_shared_pool_threads > 0.
+ThreadPool* SharedAppendPool() {
+  static ThreadPool* pool = []() {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("wal-append-shared")
+             .set_min_threads(0)
+             .set_max_threads(FLAGS_log_append_shared_pool_threads)
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+// Returns the pool shared by the segment allocation tasks of every Log in the
+// process, creating it on first use. Only used along with SharedAppendPool():
+// allocations are kept off the append pool since an append task may wait for
+// the allocation of the next segment.
+ThreadPool* SharedAllocationPool() {
+  static ThreadPool* pool = []() {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("log-alloc-shared")
+             .set_min_threads(0)
+             .set_max_threads(FLAGS_log_append_shared_pool_threads)
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+// Number of groups the append thread syncs without waiting after a group
+// commit wait that collected no entries.
+const int kGroupsBetweenUnproductiveWaits = 16;
+
+} // anonymous namespace
+
 class Log::AppendThread {
  public:
   explicit AppendThread(Log* log);
@@ -238,10 +323,22 @@ class Log::AppendThread {
   // a new task was enqueued just as we were trying to go idle.
   bool GoIdle();
 
+  // Submits DoWork() to the append pool or token.
+  void SubmitWork();
+
   // Handle the actual appending of a group of entries. Responsible for deleting the
   // LogEntryBatch* pointers.
   void HandleGroup(vector<LogEntryBatch*> entry_batches);
 
+  // Returns the number of microseconds to wait for more entries before
+  // syncing 'entry_batches', or 0 if the group should be synced right away.
+  int64_t GroupCommitWaitMicros(const vector<LogEntryBatch*>& entry_batches);
+
+  // Appends to 'entry_batches' whatever is enqueued within 'wait_us'
+  // microseconds, stopping early once the group reaches the size of the group
+  // commit queue. Returns Status::Aborted() if the queue was shut down.
+  Status WaitForMoreEntries(int64_t wait_us, vector<LogEntryBatch*>* entry_batches);
+
   string LogPrefix() const;
 
   Log* const log_;
@@ -256,9 +353,17 @@ class Log::AppendThread {
   };
   Atomic32 worker_state_ = WORKER_STOPPED;
 
+  // Number of groups left to sync without a group commit wait. Only accessed
+  // by the append task.
+  int groups_until_next_wait_ = 0;
+
   // Pool with a single thread, which handles shutting down the thread
-  // when idle.
+  // when idle. Unset if the log appends on the shared pool.
   gscoped_ptr<ThreadPool> append_pool_;
+
+  // Serial token on the shared append pool, which keeps this log's tasks
+  // ordered. Unset if the log has its own append pool.
+  unique_ptr<ThreadPoolToken> append_token_;
 };
 
 
@@ -267,7 +372,12 @@ Log::AppendThread::AppendThread(Log *log)
 }
 
 Status Log::AppendThread::Init() {
-  DCHECK(!append_pool_) << "Already initialized";
+  DCHECK(!append_pool_ && !append_token_) << "Already initialized";
+  if (FLAGS_log_append_shared_pool_threads > 0) {
+    VLOG_WITH_PREFIX(1) << "Using shared log append pool";
+    append_token_ = SharedAppendPool()->NewToken(ThreadPool::ExecutionMode::SERIAL);
+    return Status::OK();
+  }
   VLOG_WITH_PREFIX(1) << "Starting log append thread";
   RETURN_NOT_OK(ThreadPoolBuilder("wal-append")
                 .set_min_threads(0)
@@ -282,11 +392,20 @@ Status Log::AppendThread::Init() {
 }
 
 void Log::AppendThread::Wake() {
-  DCHECK(append_pool_);
+  DCHECK(append_pool_ || append_token_);
   auto old_status = base::subtle::NoBarrier_CompareAndSwap(
       &worker_state_, WORKER_STOPPED, WORKER_ACTIVE);
   if (old_status == WORKER_STOPPED) {
-    CHECK_OK(append_pool_->SubmitClosure(Bind(&Log::AppendThread::DoWork, Unretained(this))));
+    SubmitWork();
+  }
+}
+
+void Log::AppendThread::SubmitWork() {
+  Closure work = Bind(&Log::AppendThread::DoWork, Unretained(this));
+  if (append_token_) {
+    CHECK_OK(append_token_->SubmitClosure(std::move(work)));
+  } else {
+    CHECK_OK(append_pool_->SubmitClosure(std::move(work)));
   }
 }
 
@@ -334,8 +453,11 @@ void Log::AppendThread::DoWork() {
   DCHECK_EQ(ANNOTATE_UNPROTECTED_READ(worker_state_), WORKER_ACTIVE);
   VLOG_WITH_PREFIX(2) << "WAL Appender going active";
   while (true) {
-    MonoTime deadline = MonoTime::Now() +
-        MonoDelta::FromMilliseconds(FLAGS_log_thread_idle_threshold_ms);
+    // On the shared pool, don't hold a thread while this log is idle.
+    MonoTime deadline = MonoTime::Now();
+    if (!append_token_) {
+      deadline += MonoDelta::FromMilliseconds(FLAGS_log_thread_idle_threshold_ms);
+    }
     vector<LogEntryBatch*> entry_batches;
     Status s = log_->entry_queue()->BlockingDrainTo(&entry_batches, deadline);
     if (PREDICT_FALSE(s.IsAborted())) {
@@ -344,14 +466,86 @@ void Log::AppendThread::DoWork() {
       if (GoIdle()) break;
       continue;
     }
+    int64_t wait_us = GroupCommitWaitMicros(entry_batches);
+    if (wait_us > 0) {
+      s = WaitForMoreEntries(wait_us, &entry_batches);
+    }
     HandleGroup(std::move(entry_batches));
+    if (PREDICT_FALSE(s.IsAborted())) {
+      break;
+    }
+    if (append_token_) {
+      // Let the logs of other tablets use the shared pool before handling
+      // this log's next group. The worker stays active.
+      SubmitWork();
+      return;
+    }
   }
   VLOG_WITH_PREFIX(2) << "WAL Appender going idle";
 }
 
+int64_t Log::AppendThread::GroupCommitWaitMicros(const vector<LogEntryBatch*>& entry_batches) {
+  int64_t max_wait_us = FLAGS_log_group_commit_max_wait_us;
+  if (max_wait_us <= 0 || !log_->force_sync_all_ || log_->sync_disabled_) {
+    return 0;
+  }
+  if (groups_until_next_wait_ > 0) {
+    groups_until_next_wait_--;
+    return 0;
+  }
+  // A group of only COMMIT messages isn't synced, so there's nothing to
+  // amortize by waiting.
+  bool needs_sync = std::any_of(entry_batches.begin(), entry_batches.end(),
+                                [](const LogEntryBatch* b) { return b->type_ != COMMIT; });
+  if (!needs_sync) {
+    return 0;
+  }
+  // Waiting longer than a fraction of an fsync costs more latency than
+  // coalescing the syncs saves.
+  int64_t fsync_us = static_cast<int64_t>(
+      base::subtle::NoBarrier_Load(&g_wal_fsync_latency_ewma_us));
+  return std::min(max_wait_us, fsync_us / 2);
+}
+
+Status Log::AppendThread::WaitForMoreEntries(int64_t wait_us,
+                                             vector<LogEntryBatch*>* entry_batches) {
+  MonoTime start = MonoTime::Now();
+  MonoTime deadline = start + MonoDelta::FromMicroseconds(wait_us);
+  size_t initial_num_batches = entry_batches->size();
+  int64_t group_bytes = 0;
+  for (const LogEntryBatch* entry_batch : *entry_batches) {
+    group_bytes += entry_batch->total_size_bytes();
+  }
+
+  Status s;
+  while (group_bytes < FLAGS_group_commit_queue_size_bytes) {
+    size_t num_batches = entry_batches->size();
+    s = log_->entry_queue()->BlockingDrainTo(entry_batches, deadline);
+    if (!s.ok()) {
+      break;
+    }
+    for (size_t i = num_batches; i < entry_batches->size(); i++) {
+      group_bytes += (*entry_batches)[i]->total_size_bytes();
+    }
+  }
+  if (entry_batches->size() == initial_num_batches) {
+    groups_until_next_wait_ = kGroupsBetweenUnproductiveWaits;
+  }
+  if (log_->metrics_) {
+    log_->metrics_->group_commit_wait_time->Increment(
+        (MonoTime::Now() - start).ToMicroseconds());
+  }
+  return s.IsAborted() ? s : Status::OK();
+}
+
 void Log::AppendThread::HandleGroup(vector<LogEntryBatch*> entry_batches) {
   if (log_->metrics_) {
     log_->metrics_->entry_batches_per_group->Increment(entry_batches.size());
+    int64_t group_bytes = 0;
+    for (const LogEntryBatch* entry_batch : entry_batches) {
+      group_bytes += entry_batch->total_size_bytes();
+    }
+    log_->metrics_->group_commit_bytes->Increment(group_bytes);
   }
   TRACE_EVENT1("log", "batch", "batch_size", entry_batches.size());
 
@@ -411,6 +605,10 @@ void Log::AppendThread::Shutdown() {
     append_pool_->Wait();
     append_pool_->Shutdown();
   }
+  if (append_token_) {
+    append_token_->Wait();
+    append_token_->Shutdown();
+  }
 }
 
 string Log::AppendThread::LogPrefix() const {
@@ -423,7 +621,7 @@ bool Log::append_thread_active_for_tests() const {
 }
 
 
-// This task is submitted to allocation_pool_ in order to
+// This task is submitted to allocation_pool_ (or allocation_token_) in order to
 // asynchronously pre-allocate new log segments.
 void Log::SegmentAllocationTask() {
   allocation_status_.Set(PreAllocateNewSegment());
@@ -478,7 +676,11 @@ Log::Log(LogOptions options, FsManager* fs_manager, string log_path,
       codec_(nullptr),
       metric_entity_(std::move(metric_entity)),
       on_disk_size_(0) {
-  CHECK_OK(ThreadPoolBuilder("log-alloc").set_max_threads(1).Build(&allocation_pool_));
+  if (FLAGS_log_append_shared_pool_threads > 0) {
+    allocation_token_ = SharedAllocationPool()->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  } else {
+    CHECK_OK(ThreadPoolBuilder("log-alloc").set_max_threads(1).Build(&allocation_pool_));
+  }
   if (metric_entity_) {
     metrics_.reset(new LogMetrics(metric_entity_));
   }
@@ -541,8 +743,12 @@ Status Log::AsyncAllocateSegment() {
   CHECK_EQ(allocation_state_, kAllocationNotStarted);
   allocation_status_.Reset();
   allocation_state_ = kAllocationInProgress;
-  RETURN_NOT_OK(allocation_pool_->SubmitClosure(
-                  Bind(&Log::SegmentAllocationTask, Unretained(this))));
+  Closure task = Bind(&Log::SegmentAllocationTask, Unretained(this));
+  if (allocation_token_) {
+    RETURN_NOT_OK(allocation_token_->SubmitClosure(std::move(task)));
+  } else {
+    RETURN_NOT_OK(allocation_pool_->SubmitClosure(std::move(task)));
+  }
   return Status::OK();
 }
 
@@ -572,6 +778,7 @@ Status Log::RollOver() {
   RETURN_NOT_OK(CloseCurrentSegment());
 
   RETURN_NOT_OK(SwitchToAllocatedSegment());
+  UpdateSegmentIndex();
 
   LOG_WITH_PREFIX(INFO) << "Rolled over to a new log segment at " << active_segment_->path();
   return Status::OK();
@@ -733,6 +940,7 @@ FsManager* Log::GetFsManager() {
 Status Log::Sync() {
   TRACE_EVENT0("log", "Sync");
   SCOPED_LATENCY_METRIC(metrics_, sync_latency);
+  MonoTime start = MonoTime::Now();
 
   if (PREDICT_FALSE(FLAGS_log_inject_latency && !sync_disabled_)) {
     Random r(GetCurrentTimeMicros());
@@ -753,6 +961,7 @@ Status Log::Sync() {
                               "PostSyncIfFsyncEnabled hook failed");
       }
     }
+    RecordWalFsyncLatency((MonoTime::Now() - start).ToMicroseconds());
   }
 
   if (log_hooks_) {
@@ -862,6 +1071,7 @@ Status Log::GC(RetentionIndexes retention_indexes, int32_t* num_gced) {
       RETURN_NOT_OK(fs_manager_->env()->DeleteFile(segment->path()));
       (*num_gced)++;
     }
+    UpdateSegmentIndex();
 
     // Determine the minimum remaining replicate index in order to properly GC
     // the index chunks.
@@ -937,7 +1147,11 @@ void Log::SetSchemaForNextLogSegment(const Schema& schema,
 }
 
 Status Log::Close() {
-  allocation_pool_->Shutdown();
+  if (allocation_token_) {
+    allocation_token_->Shutdown();
+  } else {
+    allocation_pool_->Shutdown();
+  }
   append_thread_->Shutdown();
 
   std::lock_guard<percpu_rwlock> l(state_lock_);
@@ -950,6 +1164,7 @@ Status Log::Close() {
       RETURN_NOT_OK(Sync());
       RETURN_NOT_OK(CloseCurrentSegment());
       RETURN_NOT_OK(ReplaceSegmentInReaderUnlocked());
+      UpdateSegmentIndex();
       log_state_ = kLogClosed;
       VLOG_WITH_PREFIX(1) << "Log closed";
 
@@ -1032,6 +1247,7 @@ Status Log::PreAllocateNewSegment() {
 
   WritableFileOptions opts;
   opts.sync_on_close = force_sync_all_;
+  opts.drop_cache_after_sync = FLAGS_log_drop_segment_page_cache;
   RETURN_NOT_OK(CreatePlaceholderSegment(opts, &next_segment_path_, &next_segment_file_));
 
   MAYBE_RETURN_FAILURE(FLAGS_log_inject_io_error_on_preallocate_fraction,
@@ -1139,6 +1355,19 @@ Status Log::ReplaceSegmentInReaderUnlocked() {
   return reader_->ReplaceLastSegment(readable_segment);
 }
 
+void Log::UpdateSegmentIndex() {
+  if (!FLAGS_log_use_segment_index) {
+    return;
+  }
+  std::lock_guard<Mutex> l(segment_index_lock_);
+  SegmentSequence segments;
+  Status s = reader_->GetSegmentsSnapshot(&segments);
+  if (s.ok()) {
+    s = WriteLogSegmentIndex(fs_manager_->env(), log_dir_, segments);
+  }
+  WARN_NOT_OK(s, Substitute("$0Unable to update the WAL segment index", LogPrefix()));
+}
+
 Status Log::CreatePlaceholderSegment(const WritableFileOptions& opts,
                                      string* result_path,
                                      shared_ptr<WritableFile>* out) {
@@ -43,6 +43,7 @@
 #include "kudu/util/blocking_queue.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/promise.h"
 #include "kudu/util/rw_mutex.h"
 #include "kudu/util/slice.h"
@@ -55,6 +56,7 @@ class CompressionCodec;
 class FsManager;
 class MetricEntity;
 class ThreadPool;
+class ThreadPoolToken;
 class WritableFile;
 struct WritableFileOptions;
 
@@ -317,6 +319,11 @@ class Log : public RefCountedThreadSafe<Log> {
   // being written to, by the same segment once properly closed.
   Status ReplaceSegmentInReaderUnlocked();
 
+  // Persists the headers and footers of the closed segments into the segment
+  // index, if enabled. Failures are logged but otherwise ignored, since the
+  // index is only used to speed up reopening the log.
+  void UpdateSegmentIndex();
+
   Status Sync();
 
   // Helper method to get the segment sequence to GC based on the provided 'retention' struct.
@@ -389,8 +396,14 @@ class Log : public RefCountedThreadSafe<Log> {
   // Thread writing to the log
   gscoped_ptr<AppendThread> append_thread_;
 
+  // Pool with a single thread on which new segments are pre-allocated. Unset
+  // if the log allocates on the shared pool.
   gscoped_ptr<ThreadPool> allocation_pool_;
 
+  // Serial token on the shared allocation pool. Unset if the log has its own
+  // allocation pool.
+  std::unique_ptr<ThreadPoolToken> allocation_token_;
+
   // If true, sync on all appends.
   bool force_sync_all_;
 
@@ -416,6 +429,10 @@ class Log : public RefCountedThreadSafe<Log> {
   // The cached on-disk size of the log, used to track its size even if it has been closed.
   std::atomic<int64_t> on_disk_size_;
 
+  // Serializes updates of the segment index so that an older snapshot of the
+  // segments can't overwrite a newer one.
+  Mutex segment_index_lock_;
+
   DISALLOW_COPY_AND_ASSIGN(Log);
 };
 
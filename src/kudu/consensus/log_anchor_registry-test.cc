@@ -19,6 +19,8 @@
 
 #include <cstdint>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -30,6 +32,8 @@
 #include "kudu/util/test_util.h"
 
 using std::string;
+using std::thread;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -121,5 +125,35 @@ TEST_F(LogAnchorRegistryTest, TestOrderedEarliestOpId) {
   ASSERT_TRUE(s.IsNotFound()) << s.ToString();
 }
 
+// Test that concurrent calls to MinLogIndexAnchorer::AnchorIfMinimum() leave
+// the registry anchored on the smallest index passed by any of them.
+TEST_F(LogAnchorRegistryTest, TestConcurrentAnchorIfMinimum) {
+  scoped_refptr<LogAnchorRegistry> reg(new LogAnchorRegistry());
+  const int kNumThreads = 8;
+  const int kIndexesPerThread = 10000;
+  {
+    MinLogIndexAnchorer anchorer(reg.get(), CURRENT_TEST_NAME());
+    vector<thread> threads;
+    for (int t = 0; t < kNumThreads; t++) {
+      threads.emplace_back([&, t]() {
+        // Each thread anchors a descending run of indexes, interleaved with
+        // indexes from the other threads, ending at 't + 1'.
+        for (int i = kIndexesPerThread - 1; i >= 0; i--) {
+          anchorer.AnchorIfMinimum(static_cast<int64_t>(i) * kNumThreads + t + 1);
+        }
+      });
+    }
+    for (auto& thr : threads) {
+      thr.join();
+    }
+    ASSERT_EQ(1, anchorer.minimum_log_index());
+    ASSERT_EQ(1, reg->GetAnchorCountForTests());
+    int64_t anchor_idx = -1;
+    ASSERT_OK(reg->GetEarliestRegisteredLogIndex(&anchor_idx));
+    ASSERT_EQ(1, anchor_idx);
+  }
+  ASSERT_EQ(0, reg->GetAnchorCountForTests());
+}
+
 } // namespace log
 } // namespace kudu
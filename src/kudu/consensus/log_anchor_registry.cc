@@ -156,27 +156,34 @@ MinLogIndexAnchorer::~MinLogIndexAnchorer() {
 }
 
 void MinLogIndexAnchorer::AnchorIfMinimum(int64_t log_index) {
+  // Since the minimum never increases once set, an index which isn't below a
+  // possibly stale minimum isn't below the current one either.
+  int64_t cur_min = minimum_log_index_.load(std::memory_order_acquire);
+  if (PREDICT_TRUE(cur_min != kInvalidOpIdIndex && log_index >= cur_min)) {
+    return;
+  }
+
   std::lock_guard<simple_spinlock> l(lock_);
-  if (PREDICT_FALSE(minimum_log_index_ == kInvalidOpIdIndex)) {
-    minimum_log_index_ = log_index;
-    registry_->Register(minimum_log_index_, owner_, &anchor_);
-  } else if (log_index < minimum_log_index_) {
-    minimum_log_index_ = log_index;
-    CHECK_OK(registry_->UpdateRegistration(minimum_log_index_, owner_, &anchor_));
+  cur_min = minimum_log_index_.load(std::memory_order_relaxed);
+  if (PREDICT_FALSE(cur_min == kInvalidOpIdIndex)) {
+    registry_->Register(log_index, owner_, &anchor_);
+    minimum_log_index_.store(log_index, std::memory_order_release);
+  } else if (log_index < cur_min) {
+    CHECK_OK(registry_->UpdateRegistration(log_index, owner_, &anchor_));
+    minimum_log_index_.store(log_index, std::memory_order_release);
   }
 }
 
 Status MinLogIndexAnchorer::ReleaseAnchor() {
   std::lock_guard<simple_spinlock> l(lock_);
-  if (PREDICT_TRUE(minimum_log_index_ != kInvalidOpIdIndex)) {
+  if (PREDICT_TRUE(minimum_log_index_.load(std::memory_order_relaxed) != kInvalidOpIdIndex)) {
     return registry_->Unregister(&anchor_);
   }
   return Status::OK(); // If there were no inserts, return OK.
 }
 
 int64_t MinLogIndexAnchorer::minimum_log_index() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  return minimum_log_index_;
+  return minimum_log_index_.load(std::memory_order_acquire);
 }
 
 } // namespace log
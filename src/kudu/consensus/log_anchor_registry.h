@@ -17,6 +17,7 @@
 #ifndef KUDU_CONSENSUS_LOG_ANCHOR_REGISTRY_
 #define KUDU_CONSENSUS_LOG_ANCHOR_REGISTRY_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <map>
@@ -137,6 +138,11 @@ class MinLogIndexAnchorer {
 
   // If op_id is less than the minimum index registered so far, or if no indexes
   // are currently registered, anchor on 'log_index'.
+  //
+  // This is called for every row written to a MemRowSet or DeltaMemStore, by
+  // all of the transactions being applied concurrently to the tablet, so the
+  // common case of an index which doesn't lower the minimum doesn't take
+  // 'lock_'.
   void AnchorIfMinimum(int64_t log_index);
 
   // Un-anchors the earliest index (which is the only one tracked).
@@ -152,7 +158,9 @@ class MinLogIndexAnchorer {
   LogAnchor anchor_;
 
   // The index currently anchored, or kInvalidOpIdIndex if no anchor has yet been registered.
-  int64_t minimum_log_index_;
+  // Only modified under 'lock_', but may be read without it. Once set it
+  // only ever decreases.
+  std::atomic<int64_t> minimum_log_index_;
   mutable simple_spinlock lock_;
 
   DISALLOW_COPY_AND_ASSIGN(MinLogIndexAnchorer);
@@ -53,6 +53,7 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/threadpool.h"
 
 using std::atomic;
 using std::shared_ptr;
@@ -62,6 +63,7 @@ using strings::Substitute;
 
 DECLARE_int32(log_cache_size_limit_mb);
 DECLARE_int32(global_log_cache_size_limit_mb);
+DECLARE_bool(log_cache_compress_evicted_ops);
 
 METRIC_DECLARE_entity(tablet);
 
@@ -292,6 +294,45 @@ TEST_F(LogCacheTest, TestMemoryLimit) {
   ASSERT_EQ(cache_->BytesUsed(), 0);
 }
 
+// Test that, when compression is enabled, ops past the memory limit are
+// compressed rather than evicted, and read back intact.
+TEST_F(LogCacheTest, TestCompressEvictedOps) {
+  FLAGS_log_cache_size_limit_mb = 1;
+  FLAGS_log_cache_compress_evicted_ops = true;
+  CloseAndReopenCache(MinimumOpId());
+
+  const int kPayloadSize = 400 * 1024;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, 2, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  int size_with_two_msgs = cache_->BytesUsed();
+
+  // Appending a third op goes over the limit, compressing the oldest ones
+  // instead of evicting them.
+  ASSERT_OK(AppendReplicateMessagesToCache(3, 1, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  ASSERT_EQ(3, cache_->num_cached_ops());
+  ASSERT_LE(cache_->BytesUsed(), size_with_two_msgs);
+  ASSERT_FALSE(cache_->cache_[1].msg);
+
+  OpId op_id;
+  ASSERT_OK(cache_->LookupOpId(1, &op_id));
+  ASSERT_OPID_EQ(MakeOpId(0, 1), op_id);
+
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 8 * 1024 * 1024, &messages, &preceding));
+  ASSERT_EQ(3, messages.size());
+  for (int i = 0; i < messages.size(); i++) {
+    ASSERT_EQ(i + 1, messages[i]->get()->id().index());
+    ASSERT_EQ(kPayloadSize, messages[i]->get()->noop_request().payload_for_tests().size());
+  }
+
+  // Compressed ops are evicted like any other.
+  cache_->EvictThroughOp(3);
+  ASSERT_EQ(0, cache_->num_cached_ops());
+  ASSERT_EQ(0, cache_->BytesUsed());
+}
+
 TEST_F(LogCacheTest, TestGlobalMemoryLimit) {
   // Need to force the global cache memtracker to be destroyed before calling
   // CloseAndreopenCache(), otherwise it'll just be reused instead of recreated
@@ -377,6 +418,58 @@ TEST_F(LogCacheTest, TestTruncation) {
   }
 }
 
+// Test that a peer catching up from the on-disk log is served the ops read
+// ahead for it, in order, and never ops which were truncated since.
+TEST_F(LogCacheTest, TestReadAhead) {
+  gscoped_ptr<ThreadPool> pool;
+  ASSERT_OK(ThreadPoolBuilder("read-ahead").Build(&pool));
+  // The cache's token must go away before the pool.
+  SCOPED_CLEANUP({
+    cache_.reset();
+  });
+  cache_->EnableReadAhead(pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT));
+  auto read_ahead = std::make_shared<LogCache::ReadAheadBuffer>();
+
+  ASSERT_OK(AppendReplicateMessagesToCache(1, 100));
+  log_->WaitUntilAllFlushed();
+  cache_->EvictThroughOp(100);
+  ASSERT_EQ(0, cache_->metrics_.log_cache_num_ops->value());
+
+  // Read the first ops from disk, which starts reading the following ones
+  // ahead.
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 1024, &messages, &preceding, read_ahead));
+  ASSERT_FALSE(messages.empty());
+  int64_t last_index = messages.back()->get()->id().index();
+  pool->Wait();
+
+  // Replace the ops after 50 by ops of another term, once some of them were
+  // read ahead.
+  cache_->TruncateOpsAfter(50);
+  for (int64_t index = 51; index <= 60; index++) {
+    vector<ReplicateRefPtr> msgs;
+    msgs.push_back(make_scoped_refptr_replicate(
+        CreateDummyReplicate(100, index, clock_->Now(), 0).release()));
+    ASSERT_OK(cache_->AppendOperations(msgs, Bind(&FatalOnError)));
+  }
+  log_->WaitUntilAllFlushed();
+  cache_->EvictThroughOp(60);
+
+  while (last_index < 60) {
+    messages.clear();
+    ASSERT_OK(cache_->ReadOps(last_index, 1024, &messages, &preceding, read_ahead));
+    ASSERT_FALSE(messages.empty());
+    for (const auto& msg : messages) {
+      const OpId& id = msg->get()->id();
+      ASSERT_EQ(last_index + 1, id.index());
+      ASSERT_EQ(id.index() <= 50 ? id.index() / 7 : 100, id.term());
+      last_index = id.index();
+    }
+    pool->Wait();
+  }
+}
+
 TEST_F(LogCacheTest, TestMTReadAndWrite) {
   atomic<bool> stop { false };
   vector<thread> threads;
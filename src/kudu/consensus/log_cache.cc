@@ -17,6 +17,7 @@
 
 #include "kudu/consensus/log_cache.h"
 
+#include <deque>
 #include <map>
 #include <mutex>
 #include <ostream>
@@ -39,14 +40,20 @@
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(log_cache_size_limit_mb, 128,
              "The total per-tablet size of consensus entries which may be kept in memory. "
@@ -60,8 +67,27 @@ DEFINE_int32(global_log_cache_size_limit_mb, 1024,
              "caching log entries across all tablets is kept under this threshold.");
 TAG_FLAG(global_log_cache_size_limit_mb, advanced);
 
+DEFINE_bool(log_cache_compress_evicted_ops, false,
+            "Whether the log cache compresses the oldest operations, with the codec set by "
+            "--log_compression_codec, before evicting them to stay under its memory limits. "
+            "Compressed operations are decompressed when they are sent to a peer, so that "
+            "lagging peers can be caught up from memory rather than from the on-disk log.");
+TAG_FLAG(log_cache_compress_evicted_ops, advanced);
+TAG_FLAG(log_cache_compress_evicted_ops, experimental);
+
+DEFINE_int64(log_cache_read_ahead_bytes, 8 * 1024 * 1024,
+             "Number of bytes of operations to read ahead from the on-disk log, in the "
+             "background, for each peer which is caught up from the on-disk log rather than "
+             "from the log cache. 0 disables the read-ahead.");
+TAG_FLAG(log_cache_read_ahead_bytes, advanced);
+TAG_FLAG(log_cache_read_ahead_bytes, runtime);
+
+DECLARE_string(log_compression_codec);
+
 using kudu::pb_util::SecureShortDebugString;
+using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -86,7 +112,9 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
   : log_(std::move(log)),
     local_uuid_(std::move(local_uuid)),
     tablet_id_(std::move(tablet_id)),
+    codec_(nullptr),
     next_sequential_op_index_(0),
+    truncations_(0),
     min_pinned_op_index_(0),
     metrics_(metric_entity) {
 
@@ -105,6 +133,17 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
                                      local_uuid_, tablet_id_),
       parent_tracker_);
 
+  if (FLAGS_log_cache_compress_evicted_ops) {
+    auto codec_type = GetCompressionCodecType(FLAGS_log_compression_codec);
+    if (codec_type != NO_COMPRESSION) {
+      Status s = GetCompressionCodec(codec_type, &codec_);
+      if (!s.ok()) {
+        LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Not compressing evicted ops: " << s.ToString();
+        codec_ = nullptr;
+      }
+    }
+  }
+
   // Put a fake message at index 0, since this simplifies a lot of our
   // code paths elsewhere.
   auto zero_op = new ReplicateMsg();
@@ -113,10 +152,17 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
 }
 
 LogCache::~LogCache() {
+  if (read_ahead_token_) {
+    read_ahead_token_->Shutdown();
+  }
   tracker_->Release(tracker_->consumption());
   cache_.clear();
 }
 
+void LogCache::EnableReadAhead(unique_ptr<ThreadPoolToken> read_ahead_token) {
+  read_ahead_token_ = std::move(read_ahead_token);
+}
+
 void LogCache::Init(const OpId& preceding_op) {
   std::lock_guard<simple_spinlock> l(lock_);
   CHECK_EQ(cache_.size(), 1)
@@ -145,6 +191,7 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
     }
   }
   next_sequential_op_index_ = index + 1;
+  truncations_++;
 }
 
 Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
@@ -185,7 +232,7 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
 
     // TODO: we should also try to evict from other tablets - probably better to
     // evict really old ops from another tablet than evict recent ops from this one.
-    EvictSomeUnlocked(min_pinned_op_index_, need_to_free);
+    FreeMemoryUnlocked(need_to_free);
 
     // Force consuming, so that we don't refuse appending data. We might
     // blow past our limit a little bit (as much as the number of tablets times
@@ -243,7 +290,7 @@ void LogCache::LogCallback(int64_t last_idx_in_batch,
     if (borrowed_memory) {
       int64_t spare_capacity = parent_tracker_->SpareCapacity();
       if (spare_capacity < 0) {
-        EvictSomeUnlocked(min_pinned_op_index_, -spare_capacity);
+        FreeMemoryUnlocked(-spare_capacity);
       }
     }
   }
@@ -271,7 +318,7 @@ Status LogCache::LookupOpId(int64_t op_index, OpId* op_id) const {
     }
     auto iter = cache_.find(op_index);
     if (iter != cache_.end()) {
-      *op_id = iter->second.msg->get()->id();
+      *op_id = EntryOpId(iter->first, iter->second);
       return Status::OK();
     }
   }
@@ -292,10 +339,111 @@ int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
 }
 } // anonymous namespace
 
+bool LogCache::TakeReadAheadOps(ReadAheadBuffer* read_ahead,
+                                int64_t truncations,
+                                int64_t up_to,
+                                int64_t* next_index,
+                                int64_t* remaining_space,
+                                vector<ReplicateRefPtr>* messages) {
+  std::lock_guard<simple_spinlock> l(read_ahead->lock_);
+  auto& ops = read_ahead->ops_;
+  if (read_ahead->truncations_ != truncations) {
+    // The ops may have been truncated since they were read.
+    ops.clear();
+    read_ahead->bytes_ = 0;
+    return false;
+  }
+  // Drop the ops the peer already has, or all of them if the peer went back.
+  while (!ops.empty() && ops.front()->get()->id().index() < *next_index) {
+    read_ahead->bytes_ -= TotalByteSizeForMessage(*ops.front()->get());
+    ops.pop_front();
+  }
+  if (!ops.empty() && ops.front()->get()->id().index() != *next_index) {
+    ops.clear();
+    read_ahead->bytes_ = 0;
+  }
+
+  bool took_any = false;
+  while (!ops.empty() && *next_index <= up_to) {
+    const int64_t size = TotalByteSizeForMessage(*ops.front()->get());
+    *remaining_space -= size;
+    if (*remaining_space <= 0 && !messages->empty()) {
+      break;
+    }
+    messages->push_back(std::move(ops.front()));
+    ops.pop_front();
+    read_ahead->bytes_ -= size;
+    (*next_index)++;
+    took_any = true;
+  }
+  return took_any;
+}
+
+void LogCache::MaybeStartReadAhead(const shared_ptr<ReadAheadBuffer>& read_ahead,
+                                   int64_t truncations,
+                                   int64_t next_index,
+                                   int64_t up_to) {
+  const int64_t max_bytes = FLAGS_log_cache_read_ahead_bytes;
+  if (!read_ahead_token_ || max_bytes <= 0) {
+    return;
+  }
+  int64_t from;
+  int64_t bytes_to_read;
+  {
+    std::lock_guard<simple_spinlock> l(read_ahead->lock_);
+    if (read_ahead->filling_ || read_ahead->bytes_ >= max_bytes / 2) {
+      return;
+    }
+    from = read_ahead->ops_.empty() ?
+        next_index : read_ahead->ops_.back()->get()->id().index() + 1;
+    if (from > up_to) {
+      return;
+    }
+    bytes_to_read = max_bytes - read_ahead->bytes_;
+    read_ahead->filling_ = true;
+  }
+
+  shared_ptr<log::LogReader> reader = log_->reader();
+  const string prefix = LogPrefixUnlocked();
+  Status s = read_ahead_token_->SubmitFunc([=]() {
+    vector<ReplicateMsg*> raw_replicate_ptrs;
+    Status s = reader->ReadReplicatesInRange(from, up_to, bytes_to_read, &raw_replicate_ptrs);
+    std::lock_guard<simple_spinlock> l(read_ahead->lock_);
+    read_ahead->filling_ = false;
+    if (!s.ok()) {
+      STLDeleteElements(&raw_replicate_ptrs);
+      VLOG(1) << prefix << Substitute("Failed to read ahead ops $0..$1: $2",
+                                      from, up_to, s.ToString());
+      return;
+    }
+    auto& ops = read_ahead->ops_;
+    if (ops.empty()) {
+      read_ahead->truncations_ = truncations;
+    }
+    // Only keep ops which follow those buffered, and were read before the
+    // same truncation; the peer may have moved on meanwhile.
+    bool keep = read_ahead->truncations_ == truncations &&
+        (ops.empty() || ops.back()->get()->id().index() + 1 == from);
+    for (ReplicateMsg* msg : raw_replicate_ptrs) {
+      if (keep) {
+        read_ahead->bytes_ += TotalByteSizeForMessage(*msg);
+        ops.push_back(make_scoped_refptr_replicate(msg));
+      } else {
+        delete msg;
+      }
+    }
+  });
+  if (PREDICT_FALSE(!s.ok())) {
+    std::lock_guard<simple_spinlock> l(read_ahead->lock_);
+    read_ahead->filling_ = false;
+  }
+}
+
 Status LogCache::ReadOps(int64_t after_op_index,
                          int max_size_bytes,
                          std::vector<ReplicateRefPtr>* messages,
-                         OpId* preceding_op) {
+                         OpId* preceding_op,
+                         const shared_ptr<ReadAheadBuffer>& read_ahead) {
   DCHECK_GE(after_op_index, 0);
   RETURN_NOT_OK(LookupOpId(after_op_index, preceding_op));
 
@@ -318,15 +466,30 @@ Status LogCache::ReadOps(int64_t after_op_index,
         // Read up to the next entry that's in the cache
         up_to = iter->first - 1;
       }
+      const int64_t truncations = truncations_;
 
       l.unlock();
 
+      if (read_ahead &&
+          TakeReadAheadOps(read_ahead.get(), truncations, up_to,
+                           &next_index, &remaining_space, messages)) {
+        MaybeStartReadAhead(read_ahead, truncations, next_index, up_to);
+        l.lock();
+        continue;
+      }
+
       vector<ReplicateMsg*> raw_replicate_ptrs;
       RETURN_NOT_OK_PREPEND(
         log_->reader()->ReadReplicatesInRange(
           next_index, up_to, remaining_space, &raw_replicate_ptrs),
         Substitute("Failed to read ops $0..$1", next_index, up_to));
       l.lock();
+      if (truncations_ != truncations) {
+        // The ops may have been replaced by a truncation while they were
+        // read: look them up again.
+        STLDeleteElements(&raw_replicate_ptrs);
+        continue;
+      }
       VLOG_WITH_PREFIX_UNLOCKED(2)
           << "Successfully read " << raw_replicate_ptrs.size() << " ops "
           << "from disk (" << next_index << ".."
@@ -343,16 +506,46 @@ Status LogCache::ReadOps(int64_t after_op_index,
           delete msg;
         }
       }
+      if (read_ahead) {
+        l.unlock();
+        MaybeStartReadAhead(read_ahead, truncations, next_index, up_to);
+        l.lock();
+      }
 
     } else {
       // Pull contiguous messages from the cache until the size limit is achieved.
       for (; iter != cache_.end(); ++iter) {
-        const ReplicateRefPtr& msg = iter->second.msg;
-        int64_t index = msg->get()->id().index();
+        int64_t index = iter->first;
         if (index != next_index) {
           continue;
         }
 
+        if (!iter->second.msg) {
+          // Decompress the op without holding the lock. Since that may
+          // invalidate 'iter', go back to looking up the next op afterwards.
+          shared_ptr<const string> compressed_msg = iter->second.compressed_msg;
+          int64_t uncompressed_size = iter->second.uncompressed_size;
+          const int64_t truncations = truncations_;
+          l.unlock();
+          unique_ptr<ReplicateMsg> msg;
+          RETURN_NOT_OK_PREPEND(DecompressMsg(*compressed_msg, uncompressed_size, &msg),
+                                Substitute("Failed to decompress cached op $0", index));
+          l.lock();
+          if (truncations_ != truncations) {
+            // The op may have been replaced by a truncation meanwhile: look
+            // it up again.
+            break;
+          }
+
+          remaining_space -= TotalByteSizeForMessage(*msg);
+          if (remaining_space > 0 || messages->empty()) {
+            messages->push_back(make_scoped_refptr_replicate(msg.release()));
+            next_index++;
+          }
+          break;
+        }
+
+        const ReplicateRefPtr& msg = iter->second.msg;
         remaining_space -= TotalByteSizeForMessage(*msg->get());
         if (remaining_space < 0 && !messages->empty()) {
           break;
@@ -367,6 +560,98 @@ Status LogCache::ReadOps(int64_t after_op_index,
 }
 
 
+OpId LogCache::EntryOpId(int64_t index, const CacheEntry& entry) {
+  if (entry.msg) {
+    return entry.msg->get()->id();
+  }
+  return MakeOpId(entry.term, index);
+}
+
+void LogCache::FreeMemoryUnlocked(int64_t bytes_to_free) {
+  DCHECK(lock_.is_locked());
+  if (codec_) {
+    bytes_to_free -= CompressSomeUnlocked(bytes_to_free);
+  }
+  if (bytes_to_free > 0) {
+    EvictSomeUnlocked(min_pinned_op_index_, bytes_to_free);
+  }
+}
+
+int64_t LogCache::CompressSomeUnlocked(int64_t bytes_to_free) {
+  DCHECK(lock_.is_locked());
+  int64_t bytes_saved = 0;
+  for (auto& e : cache_) {
+    int64_t msg_index = e.first;
+    CacheEntry& entry = e.second;
+    if (msg_index == 0) {
+      continue;
+    }
+    if (msg_index >= min_pinned_op_index_ || bytes_saved >= bytes_to_free) {
+      break;
+    }
+    // Ops in use by a peer would stay in memory regardless.
+    if (!entry.msg || !entry.msg->HasOneRef()) {
+      continue;
+    }
+
+    CacheEntry compressed;
+    Status s = CompressMsg(*entry.msg->get(), &compressed);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << LogPrefixUnlocked() << "Failed to compress op "
+                                     << msg_index << ": " << s.ToString();
+      continue;
+    }
+    if (compressed.mem_usage >= entry.mem_usage) {
+      continue;
+    }
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "Compressing cached op " << msg_index << " from "
+                                 << entry.mem_usage << " to " << compressed.mem_usage
+                                 << " bytes";
+    int64_t saved = entry.mem_usage - compressed.mem_usage;
+    tracker_->Release(saved);
+    metrics_.log_cache_size->DecrementBy(saved);
+    bytes_saved += saved;
+    entry = std::move(compressed);
+  }
+  return bytes_saved;
+}
+
+Status LogCache::CompressMsg(const ReplicateMsg& msg, CacheEntry* entry) const {
+  DCHECK(codec_);
+  faststring serialized;
+  pb_util::SerializeToString(msg, &serialized);
+  string compressed;
+  compressed.resize(codec_->MaxCompressedLength(serialized.size()));
+  size_t compressed_length;
+  RETURN_NOT_OK(codec_->Compress(Slice(serialized),
+                                 reinterpret_cast<uint8_t*>(&compressed[0]),
+                                 &compressed_length));
+  compressed.resize(compressed_length);
+  compressed.shrink_to_fit();
+
+  entry->msg = nullptr;
+  entry->mem_usage = sizeof(string) + compressed.capacity();
+  entry->compressed_msg = std::make_shared<const string>(std::move(compressed));
+  entry->term = msg.id().term();
+  entry->uncompressed_size = serialized.size();
+  return Status::OK();
+}
+
+Status LogCache::DecompressMsg(const string& compressed_msg,
+                               int64_t uncompressed_size,
+                               unique_ptr<ReplicateMsg>* msg) const {
+  DCHECK(codec_);
+  faststring uncompressed;
+  uncompressed.resize(uncompressed_size);
+  RETURN_NOT_OK(codec_->Uncompress(Slice(compressed_msg), uncompressed.data(),
+                                   uncompressed_size));
+  unique_ptr<ReplicateMsg> result(new ReplicateMsg());
+  RETURN_NOT_OK(pb_util::ParseFromArray(result.get(), uncompressed.data(),
+                                        uncompressed_size));
+  *msg = std::move(result);
+  return Status::OK();
+}
+
 void LogCache::EvictThroughOp(int64_t index) {
   std::lock_guard<simple_spinlock> lock(lock_);
 
@@ -384,8 +669,9 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
   for (auto iter = cache_.begin(); iter != cache_.end();) {
     const CacheEntry& entry = (*iter).second;
     const ReplicateRefPtr& msg = entry.msg;
-    VLOG_WITH_PREFIX_UNLOCKED(2) << "considering for eviction: " << msg->get()->id();
-    int64_t msg_index = msg->get()->id().index();
+    int64_t msg_index = iter->first;
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "considering for eviction: "
+                                 << EntryOpId(msg_index, entry);
     if (msg_index == 0) {
       // Always keep our special '0' op.
       ++iter;
@@ -396,14 +682,15 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
       break;
     }
 
-    if (!msg->HasOneRef()) {
+    if (msg && !msg->HasOneRef()) {
       VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache: cannot remove " << msg->get()->id()
                                    << " because it is in-use by a peer.";
       ++iter;
       continue;
     }
 
-    VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache. Removing: " << msg->get()->id();
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache. Removing: "
+                                 << EntryOpId(msg_index, entry);
     AccountForMessageRemovalUnlocked(entry);
     bytes_evicted += entry.mem_usage;
     cache_.erase(iter++);
@@ -467,6 +754,13 @@ void LogCache::DumpToStrings(vector<string>* lines) const {
   lines->push_back(ToStringUnlocked());
   lines->push_back("Messages:");
   for (const auto& entry : cache_) {
+    if (!entry.second.msg) {
+      OpId id = EntryOpId(entry.first, entry.second);
+      lines->push_back(
+        Substitute("Message[$0] $1.$2 : REPLICATE. Compressed, Size: $3",
+                   counter++, id.term(), id.index(), entry.second.uncompressed_size));
+      continue;
+    }
     const ReplicateMsg* msg = entry.second.msg->get();
     lines->push_back(
       Substitute("Message[$0] $1.$2 : REPLICATE. Type: $3, Size: $4",
@@ -486,6 +780,14 @@ void LogCache::DumpToHtml(std::ostream& out) const {
 
   int counter = 0;
   for (const auto& entry : cache_) {
+    if (!entry.second.msg) {
+      OpId id = EntryOpId(entry.first, entry.second);
+      out << Substitute("<tr><th>$0</th><th>$1.$2</th><td>REPLICATE (compressed)</td>"
+                        "<td>$3</td><td>$4</td></tr>",
+                        counter++, id.term(), id.index(),
+                        entry.second.uncompressed_size, SecureShortDebugString(id)) << endl;
+      continue;
+    }
     const ReplicateMsg* msg = entry.second.msg->get();
     out << Substitute("<tr><th>$0</th><th>$1.$2</th><td>REPLICATE $3</td>"
                       "<td>$4</td><td>$5</td></tr>",
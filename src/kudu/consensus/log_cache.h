@@ -18,6 +18,7 @@
 #define KUDU_CONSENSUS_LOG_CACHE_H
 
 #include <cstdint>
+#include <deque>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -36,7 +37,9 @@
 
 namespace kudu {
 
+class CompressionCodec;
 class MemTracker;
+class ThreadPoolToken;
 
 namespace log {
 class Log;
@@ -60,6 +63,38 @@ class LogCache {
            std::string tablet_id);
   ~LogCache();
 
+  // Operations read ahead from the on-disk log, in the background, for a peer
+  // which catches up from it. Each peer has its own buffer, which is only
+  // used through ReadOps().
+  class ReadAheadBuffer {
+   public:
+    ReadAheadBuffer() = default;
+
+   private:
+    friend class LogCache;
+
+    simple_spinlock lock_;
+
+    // Consecutive operations, the first of which the peer is expected to
+    // ask for next.
+    std::deque<ReplicateRefPtr> ops_;
+
+    // The sum of TotalByteSizeForMessage() over 'ops_'.
+    int64_t bytes_ = 0;
+
+    // The number of truncations of the cache when 'ops_' were read.
+    int64_t truncations_ = 0;
+
+    // Whether a background read into the buffer is in progress.
+    bool filling_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ReadAheadBuffer);
+  };
+
+  // Makes ReadOps() read operations ahead from the on-disk log on
+  // 'read_ahead_token', for the peers which pass a ReadAheadBuffer.
+  void EnableReadAhead(std::unique_ptr<ThreadPoolToken> read_ahead_token);
+
   // Initialize the cache.
   //
   // 'preceding_op' is the current latest op. The next AppendOperation() call
@@ -82,10 +117,16 @@ class LogCache {
   // If the ops being requested are not available in the log, this will synchronously
   // read these ops from disk. Therefore, this function may take a substantial amount
   // of time and should not be called with important locks held, etc.
+  //
+  // If 'read_ahead' is set and read-ahead is enabled, the ops read ahead into
+  // it are used instead of reading from disk, and once ops come from the disk
+  // the following ones are read ahead into it in the background, so that a
+  // peer catching up from the disk doesn't wait on a read per request.
   Status ReadOps(int64_t after_op_index,
                  int max_size_bytes,
                  std::vector<ReplicateRefPtr>* messages,
-                 OpId* preceding_op);
+                 OpId* preceding_op,
+                 const std::shared_ptr<ReadAheadBuffer>& read_ahead = nullptr);
 
   // Append the operations into the log and the cache.
   // When the messages have completed writing into the on-disk log, fires 'callback'.
@@ -144,19 +185,53 @@ class LogCache {
 
  private:
   FRIEND_TEST(LogCacheTest, TestAppendAndGetMessages);
+  FRIEND_TEST(LogCacheTest, TestCompressEvictedOps);
   FRIEND_TEST(LogCacheTest, TestGlobalMemoryLimit);
+  FRIEND_TEST(LogCacheTest, TestReadAhead);
   FRIEND_TEST(LogCacheTest, TestReplaceMessages);
   FRIEND_TEST(LogCacheTest, TestTruncation);
   friend class LogCacheTest;
 
   // An entry in the cache.
   struct CacheEntry {
+    // The op, or null if it has been compressed.
     ReplicateRefPtr msg;
     // The cached value of msg->SpaceUsedLong(). This method is expensive
-    // to compute, so we compute it only once upon insertion.
+    // to compute, so we compute it only once upon insertion. For a compressed
+    // op, the memory used by its compressed form instead.
     int64_t mem_usage;
+
+    // The following are only set for a compressed op.
+    //
+    // The serialized op, compressed with 'codec_'. Shared so that readers
+    // can decompress it without holding 'lock_'.
+    std::shared_ptr<const std::string> compressed_msg;
+    // The term of the op, so its OpId can be looked up without decompressing it.
+    int64_t term;
+    // The size of the serialized op.
+    int64_t uncompressed_size;
   };
 
+  // Returns the OpId of the op with index 'index', cached in 'entry'.
+  static OpId EntryOpId(int64_t index, const CacheEntry& entry);
+
+  // Frees at least 'bytes_to_free' bytes, if possible, by compressing
+  // and then evicting the oldest unpinned operations.
+  void FreeMemoryUnlocked(int64_t bytes_to_free);
+
+  // Compresses the oldest unpinned and unused operations in place, stopping
+  // once 'bytes_to_free' bytes have been saved. Returns the number of bytes
+  // saved.
+  int64_t CompressSomeUnlocked(int64_t bytes_to_free);
+
+  // Serializes and compresses 'msg' into 'entry'.
+  Status CompressMsg(const ReplicateMsg& msg, CacheEntry* entry) const;
+
+  // Decompresses an op cached by CompressMsg() into a new message.
+  Status DecompressMsg(const std::string& compressed_msg,
+                       int64_t uncompressed_size,
+                       std::unique_ptr<ReplicateMsg>* msg) const;
+
   // Try to evict the oldest operations from the queue, stopping either when
   // 'bytes_to_evict' bytes have been evicted, or the op with index
   // 'stop_after_index' has been evicted, whichever comes first.
@@ -168,6 +243,26 @@ class LogCache {
 
   void TruncateOpsAfterUnlocked(int64_t index);
 
+  // Moves the ops of 'read_ahead' from '*next_index' up to 'up_to' into
+  // 'messages', as long as they fit in '*remaining_space', advancing
+  // '*next_index' and decreasing '*remaining_space' as ReadOps() does.
+  // 'truncations' is the value of 'truncations_' when 'up_to' was computed.
+  // Returns whether any op was moved.
+  static bool TakeReadAheadOps(ReadAheadBuffer* read_ahead,
+                               int64_t truncations,
+                               int64_t up_to,
+                               int64_t* next_index,
+                               int64_t* remaining_space,
+                               std::vector<ReplicateRefPtr>* messages);
+
+  // Starts reading the ops following those of 'read_ahead', or from
+  // 'next_index' if it has none, up to 'up_to', in the background, unless
+  // the buffer is at least half full or already being filled.
+  void MaybeStartReadAhead(const std::shared_ptr<ReadAheadBuffer>& read_ahead,
+                           int64_t truncations,
+                           int64_t next_index,
+                           int64_t up_to);
+
   // Return a string with stats
   std::string StatsStringUnlocked() const;
 
@@ -188,6 +283,10 @@ class LogCache {
   // The id of the tablet.
   const std::string tablet_id_;
 
+  // The codec with which evicted operations are compressed and kept in
+  // the cache, or null if they are dropped.
+  const CompressionCodec* codec_;
+
   mutable simple_spinlock lock_;
 
   // An ordered map that serves as the buffer for the cached messages.
@@ -199,6 +298,10 @@ class LogCache {
   // start with this log index, or go backward (but never skip forward).
   int64_t next_sequential_op_index_;
 
+  // The number of times ops were truncated, so that ops read ahead before a
+  // truncation are not served after it.
+  int64_t truncations_;
+
   // Any operation with an index >= min_pinned_op_ may not be
   // evicted from the cache. This is used to prevent ops from being evicted
   // until they successfully have been appended to the underlying log.
@@ -218,6 +321,10 @@ class LogCache {
   // A MemTracker for this instance.
   std::shared_ptr<MemTracker> tracker_;
 
+  // The token on which ops are read ahead from disk, or null if read-ahead
+  // is disabled.
+  std::unique_ptr<ThreadPoolToken> read_ahead_token_;
+
   struct Metrics {
     explicit Metrics(const scoped_refptr<MetricEntity>& metric_entity);
 
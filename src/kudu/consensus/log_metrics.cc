@@ -48,6 +48,17 @@ METRIC_DEFINE_histogram(tablet, log_entry_batches_per_group, "Log Group Commit B
                         "Number of log entry batches in a group commit group",
                         1024, 2);
 
+METRIC_DEFINE_histogram(tablet, log_group_commit_bytes, "Log Group Commit Bytes",
+                        kudu::MetricUnit::kBytes,
+                        "Number of bytes of log entry batches in a group commit group",
+                        64LU * 1024 * 1024, 2);
+
+METRIC_DEFINE_histogram(tablet, log_group_commit_wait_time, "Log Group Commit Wait Time",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Microseconds the log append thread spent waiting for more entries "
+                        "to join a group before syncing it",
+                        60000000LU, 2);
+
 namespace kudu {
 namespace log {
 
@@ -58,7 +69,9 @@ LogMetrics::LogMetrics(const scoped_refptr<MetricEntity>& metric_entity)
       MINIT(append_latency),
       MINIT(group_commit_latency),
       MINIT(roll_latency),
-      MINIT(entry_batches_per_group) {
+      MINIT(entry_batches_per_group),
+      MINIT(group_commit_bytes),
+      MINIT(group_commit_wait_time) {
 }
 #undef MINIT
 
@@ -48,6 +48,7 @@ class ReplicateMsg;
 namespace log {
 class LogIndex;
 class LogEntryBatchPB;
+class LogSegmentReadAhead;
 struct LogIndexEntry;
 
 // Reads a set of segments from a given path. Segment headers and footers
@@ -166,10 +167,12 @@ class LogReader : public enable_make_shared<LogReader> {
   void UpdateLastSegmentOffset(int64_t readable_to_offset);
 
   // Read the LogEntryBatchPB pointed to by the provided index entry.
-  // 'tmp_buf' is used as scratch space to avoid extra allocation.
+  // 'tmp_buf' is used as scratch space to avoid extra allocation. If
+  // 'read_ahead' is not null, the batch is read through it.
   Status ReadBatchUsingIndexEntry(const LogIndexEntry& index_entry,
                                   faststring* tmp_buf,
-                                  std::unique_ptr<LogEntryBatchPB>* batch) const;
+                                  std::unique_ptr<LogEntryBatchPB>* batch,
+                                  LogSegmentReadAhead* read_ahead = nullptr) const;
 
   // Reads the headers of all segments in 'tablet_wal_path'.
   Status Init(const std::string& tablet_wal_path);
@@ -44,6 +44,7 @@
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 
 DEFINE_int32(log_segment_size_mb, 8,
@@ -62,6 +63,12 @@ DEFINE_bool(log_async_preallocate_segments, true,
             "Whether the WAL segments preallocation should happen asynchronously");
 TAG_FLAG(log_async_preallocate_segments, advanced);
 
+DEFINE_bool(log_use_segment_index, true,
+            "Whether to persist the headers and footers of closed WAL segments into a "
+            "per-tablet segment index, and use it when opening the WAL, instead of "
+            "reading the header and footer of each segment.");
+TAG_FLAG(log_use_segment_index, advanced);
+
 DEFINE_double(fault_crash_before_write_log_segment_header, 0.0,
               "Fraction of the time we will crash just before writing the log segment header");
 TAG_FLAG(fault_crash_before_write_log_segment_header, unsafe);
@@ -98,6 +105,8 @@ const size_t kEntryHeaderSizeV2 = 16;
 // Maximum log segment header/footer size, in bytes (8 MB).
 const uint32_t kLogSegmentMaxHeaderOrFooterSize = 8 * 1024 * 1024;
 
+const char* const kLogSegmentIndexFileName = "segment_index";
+
 LogOptions::LogOptions()
 : segment_size_mb(FLAGS_log_segment_size_mb),
   force_fsync_all(FLAGS_log_force_fsync_all),
@@ -259,13 +268,23 @@ Status LogEntryReader::MakeCorruptionStatus(const Status& status) const {
 
 Status ReadableLogSegment::Open(Env* env,
                                 const string& path,
-                                scoped_refptr<ReadableLogSegment>* segment) {
+                                scoped_refptr<ReadableLogSegment>* segment,
+                                const LogSegmentIndexPB::SegmentPB* index_entry) {
   VLOG(1) << "Parsing wal segment: " << path;
   shared_ptr<RandomAccessFile> readable_file;
   RETURN_NOT_OK_PREPEND(env_util::OpenFileForRandom(env, path, &readable_file),
                         "Unable to open file for reading");
 
   segment->reset(new ReadableLogSegment(path, readable_file));
+  if (index_entry) {
+    Status s = (*segment)->Init(*index_entry);
+    if (s.ok()) {
+      return Status::OK();
+    }
+    VLOG(1) << "Unable to open " << path << " using the segment index, reading "
+            << "its header and footer instead: " << s.ToString();
+    segment->reset(new ReadableLogSegment(path, readable_file));
+  }
   RETURN_NOT_OK_PREPEND((*segment)->Init(), "Unable to initialize segment");
   return Status::OK();
 }
@@ -318,6 +337,31 @@ Status ReadableLogSegment::Init(const LogSegmentHeaderPB& header,
   return Status::OK();
 }
 
+Status ReadableLogSegment::Init(const LogSegmentIndexPB::SegmentPB& index_entry) {
+  DCHECK(!IsInitialized()) << "Can only call Init() once";
+
+  RETURN_NOT_OK(ReadFileSize());
+  if (file_size() != index_entry.file_size()) {
+    return Status::IllegalState(
+        Substitute("Segment file size $0 doesn't match the size in the segment index: $1",
+                   file_size(), index_entry.file_size()));
+  }
+  if (index_entry.header().incompatible_features_size() > 0) {
+    return Status::NotSupported("log segment uses a feature not supported by this version "
+                                "of Kudu");
+  }
+
+  header_.CopyFrom(index_entry.header());
+  RETURN_NOT_OK(InitCompressionCodec());
+
+  footer_.CopyFrom(index_entry.footer());
+  first_entry_offset_ = index_entry.first_entry_offset();
+  is_initialized_ = true;
+  readable_to_offset_.Store(file_size());
+
+  return Status::OK();
+}
+
 Status ReadableLogSegment::Init() {
   DCHECK(!IsInitialized()) << "Can only call Init() once";
 
@@ -615,13 +659,45 @@ Status ReadableLogSegment::ScanForValidEntryHeaders(int64_t offset, bool* has_va
   return Status::OK();
 }
 
+Status LogSegmentReadAhead::Read(ReadableLogSegment* segment, int64_t offset, Slice result) {
+  if (segment_.get() != segment ||
+      offset < buffered_offset_ ||
+      offset + result.size() > buffered_offset_ + buffer_.size()) {
+    // Refill the buffer from 'offset', without reading past the end of what
+    // was written to the segment.
+    int64_t len = std::max<int64_t>(
+        result.size(), std::min(window_bytes_, segment->readable_up_to() - offset));
+    segment_ = segment;
+    buffered_offset_ = offset;
+    buffer_.resize(len);
+    Slice window(buffer_.data(), len);
+    Status s = segment->readable_file()->Read(offset, window);
+    if (PREDICT_FALSE(!s.ok())) {
+      segment_ = nullptr;
+      buffer_.clear();
+      return s;
+    }
+  }
+  memcpy(result.mutable_data(), buffer_.data() + (offset - buffered_offset_), result.size());
+  return Status::OK();
+}
+
+Status ReadableLogSegment::ReadBytes(int64_t offset, Slice result,
+                                     LogSegmentReadAhead* read_ahead) {
+  if (read_ahead) {
+    return read_ahead->Read(this, offset, result);
+  }
+  return readable_file()->Read(offset, result);
+}
+
 Status ReadableLogSegment::ReadEntryHeaderAndBatch(int64_t* offset, faststring* tmp_buf,
                                                    unique_ptr<LogEntryBatchPB>* batch,
-                                                   EntryHeaderStatus* status_detail) {
+                                                   EntryHeaderStatus* status_detail,
+                                                   LogSegmentReadAhead* read_ahead) {
   int64_t cur_offset = *offset;
   EntryHeader header;
-  RETURN_NOT_OK(ReadEntryHeader(&cur_offset, &header, status_detail));
-  Status s = ReadEntryBatch(&cur_offset, header, tmp_buf, batch);
+  RETURN_NOT_OK(ReadEntryHeader(&cur_offset, &header, status_detail, read_ahead));
+  Status s = ReadEntryBatch(&cur_offset, header, tmp_buf, batch, read_ahead);
   if (PREDICT_FALSE(!s.ok())) {
     // If we failed to actually decode the batch, make sure to set status_detail to
     // non-OK.
@@ -633,11 +709,12 @@ Status ReadableLogSegment::ReadEntryHeaderAndBatch(int64_t* offset, faststring*
 }
 
 Status ReadableLogSegment::ReadEntryHeader(int64_t *offset, EntryHeader* header,
-                                           EntryHeaderStatus* status_detail) {
+                                           EntryHeaderStatus* status_detail,
+                                           LogSegmentReadAhead* read_ahead) {
   const size_t header_size = entry_header_size();
   uint8_t scratch[header_size];
   Slice slice(scratch, header_size);
-  RETURN_NOT_OK_PREPEND(readable_file()->Read(*offset, slice),
+  RETURN_NOT_OK_PREPEND(ReadBytes(*offset, slice, read_ahead),
                         "Could not read log entry header");
 
   *status_detail = DecodeEntryHeader(slice, header);
@@ -689,7 +766,8 @@ EntryHeaderStatus ReadableLogSegment::DecodeEntryHeader(
 Status ReadableLogSegment::ReadEntryBatch(int64_t* offset,
                                           const EntryHeader& header,
                                           faststring* tmp_buf,
-                                          unique_ptr<LogEntryBatchPB>* entry_batch) {
+                                          unique_ptr<LogEntryBatchPB>* entry_batch,
+                                          LogSegmentReadAhead* read_ahead) {
   TRACE_EVENT2("log", "ReadableLogSegment::ReadEntryBatch",
                "path", path_,
                "range", Substitute("offset=$0 entry_len=$1",
@@ -715,7 +793,7 @@ Status ReadableLogSegment::ReadEntryBatch(int64_t* offset,
   }
   tmp_buf->resize(buf_len);
   Slice entry_batch_slice(tmp_buf->data(), header.msg_length_compressed);
-  Status s =  readable_file()->Read(*offset, entry_batch_slice);
+  Status s = ReadBytes(*offset, entry_batch_slice, read_ahead);
 
   if (!s.ok()) return Status::IOError(Substitute("Could not read entry. Cause: $0",
                                                  s.ToString()));
@@ -873,6 +951,36 @@ bool IsLogFileName(const string& fname) {
   return true;
 }
 
+Status WriteLogSegmentIndex(Env* env,
+                            const string& wal_dir,
+                            const SegmentSequence& segments) {
+  LogSegmentIndexPB index;
+  for (const auto& segment : segments) {
+    if (!segment->HasFooter() || segment->footer_was_rebuilt()) {
+      continue;
+    }
+    LogSegmentIndexPB::SegmentPB* entry = index.add_segments();
+    entry->set_file_name(BaseName(segment->path()));
+    entry->set_file_size(segment->file_size());
+    *entry->mutable_header() = segment->header();
+    *entry->mutable_footer() = segment->footer();
+    entry->set_first_entry_offset(segment->first_entry_offset());
+  }
+  return pb_util::WritePBContainerToPath(env,
+                                         JoinPathSegments(wal_dir, kLogSegmentIndexFileName),
+                                         index,
+                                         pb_util::OVERWRITE,
+                                         pb_util::NO_SYNC);
+}
+
+Status ReadLogSegmentIndex(Env* env,
+                           const string& wal_dir,
+                           LogSegmentIndexPB* index) {
+  return pb_util::ReadPBContainerFromPath(env,
+                                          JoinPathSegments(wal_dir, kLogSegmentIndexFileName),
+                                          index);
+}
+
 void UpdateFooterForReplicateEntry(const LogEntryPB& entry_pb,
                                    LogSegmentFooterPB* footer) {
   DCHECK(entry_pb.has_replicate());
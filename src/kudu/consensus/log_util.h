@@ -170,13 +170,46 @@ class LogEntryReader {
 // log_segment_size_mb flag, which defaults to 64). Upon reaching this size
 // segments are rolled over and the Log continues in a new segment.
 
+// Buffers sequential reads of log segments: a read which isn't within the
+// buffered range reads up to 'window_bytes' of the segment at once, so that
+// reading many consecutive entries takes a few large reads instead of two
+// small reads per entry. Used to read ranges of the log for follower catch-up.
+//
+// This class is not thread-safe.
+class LogSegmentReadAhead {
+ public:
+  explicit LogSegmentReadAhead(int64_t window_bytes)
+      : window_bytes_(window_bytes),
+        buffered_offset_(0) {
+  }
+
+ private:
+  friend class ReadableLogSegment;
+
+  // Reads 'result.size()' bytes at 'offset' of 'segment' into 'result'.
+  Status Read(ReadableLogSegment* segment, int64_t offset, Slice result);
+
+  const int64_t window_bytes_;
+
+  // The segment whose bytes from 'buffered_offset_' are in 'buffer_'.
+  scoped_refptr<ReadableLogSegment> segment_;
+  int64_t buffered_offset_;
+  faststring buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogSegmentReadAhead);
+};
+
 // A readable log segment for recovery and follower catch-up.
 class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
  public:
   // Factory method to construct a ReadableLogSegment from a file on the FS.
+  //
+  // If 'index_entry' is not null and matches the file, the header and footer
+  // are taken from it instead of being read from the file.
   static Status Open(Env* env,
                      const std::string& path,
-                     scoped_refptr<ReadableLogSegment>* segment);
+                     scoped_refptr<ReadableLogSegment>* segment,
+                     const LogSegmentIndexPB::SegmentPB* index_entry = nullptr);
 
   // Build a readable segment to read entries from the provided path.
   ReadableLogSegment(std::string path,
@@ -196,6 +229,11 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
               const LogSegmentFooterPB& footer,
               int64_t first_entry_offset);
 
+  // Initialize the ReadableLogSegment from the given entry of a persisted
+  // segment index, without reading the segment's header and footer. Returns
+  // Status::IllegalState if the file doesn't match the entry.
+  Status Init(const LogSegmentIndexPB::SegmentPB& index_entry);
+
   // Initialize the ReadableLogSegment.
   // This initializer will parse the log segment header and footer.
   // Note: This returns Status and may fail.
@@ -248,6 +286,12 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
     return footer_;
   }
 
+  // Returns true if the footer was rebuilt by scanning the segment, rather
+  // than actually found on disk.
+  bool footer_was_rebuilt() const {
+    return footer_was_rebuilt_;
+  }
+
   const std::shared_ptr<RandomAccessFile> readable_file() const {
     return readable_file_;
   }
@@ -337,16 +381,20 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
   //
   // If unsuccessful, '*offset' is not updated, and *status_detail will be updated
   // to indicate the cause of the error.
+  //
+  // If 'read_ahead' is not null, the bytes are read through it.
   Status ReadEntryHeaderAndBatch(int64_t* offset, faststring* tmp_buf,
                                  std::unique_ptr<LogEntryBatchPB>* batch,
-                                 EntryHeaderStatus* status_detail);
+                                 EntryHeaderStatus* status_detail,
+                                 LogSegmentReadAhead* read_ahead = nullptr);
 
   // Reads a log entry header from the segment.
   //
   // Also increments the passed offset* by the length of the entry on successful
   // read.
   Status ReadEntryHeader(int64_t *offset, EntryHeader* header,
-                         EntryHeaderStatus* status_detail);
+                         EntryHeaderStatus* status_detail,
+                         LogSegmentReadAhead* read_ahead = nullptr);
 
   // Decode a log entry header from the given slice. The header length is
   // determined by 'entry_header_size()'.
@@ -361,7 +409,12 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
   Status ReadEntryBatch(int64_t* offset,
                         const EntryHeader& header,
                         faststring* tmp_buf,
-                        std::unique_ptr<LogEntryBatchPB>* entry_batch);
+                        std::unique_ptr<LogEntryBatchPB>* entry_batch,
+                        LogSegmentReadAhead* read_ahead = nullptr);
+
+  // Reads 'result.size()' bytes at 'offset' into 'result', through
+  // 'read_ahead' if it's not null.
+  Status ReadBytes(int64_t offset, Slice result, LogSegmentReadAhead* read_ahead);
 
   void UpdateReadableToOffset(int64_t readable_to_offset);
 
@@ -506,6 +559,23 @@ std::unique_ptr<LogEntryBatchPB> CreateBatchFromAllocatedOperations(
 // Checks if 'fname' is a correctly formatted name of log segment file.
 bool IsLogFileName(const std::string& fname);
 
+// The name of the file, within a tablet's WAL directory, where the headers
+// and footers of the closed segments are persisted. See LogSegmentIndexPB.
+extern const char* const kLogSegmentIndexFileName;
+
+// Persists the headers and footers of those of 'segments' which have a footer
+// written on disk into the segment index of 'wal_dir', replacing any previous
+// contents. The index is a cache and isn't synced.
+Status WriteLogSegmentIndex(Env* env,
+                            const std::string& wal_dir,
+                            const SegmentSequence& segments);
+
+// Reads the segment index of 'wal_dir' into 'index'. Returns
+// Status::NotFound if there is none.
+Status ReadLogSegmentIndex(Env* env,
+                           const std::string& wal_dir,
+                           LogSegmentIndexPB* index);
+
 // Update 'footer' to reflect the given REPLICATE message 'entry_pb'.
 // In particular, updates the min/max seen replicate OpID.
 void UpdateFooterForReplicateEntry(
@@ -27,6 +27,7 @@
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
@@ -46,6 +47,7 @@
 #include "kudu/consensus/peer_manager.h"
 #include "kudu/consensus/pending_rounds.h"
 #include "kudu/consensus/quorum_util.h"
+#include "kudu/consensus/server_liveness.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/macros.h"
@@ -174,6 +176,7 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::unordered_set;
+using std::vector;
 using std::weak_ptr;
 using strings::Substitute;
 
@@ -195,6 +198,7 @@ RaftConsensus::RaftConsensus(
       withhold_votes_until_(MonoTime::Min()),
       last_received_cur_leader_(MinimumOpId()),
       failed_elections_since_stable_leader_(0),
+      leader_server_watch_id_(-1),
       shutdown_(false),
       update_calls_for_tests_(0) {
   DCHECK(local_peer_pb_.has_permanent_uuid());
@@ -275,7 +279,8 @@ Status RaftConsensus::Start(const ConsensusBootstrapInfo& info,
       options_.tablet_id,
       raft_pool_->NewToken(ThreadPool::ExecutionMode::SERIAL),
       info.last_id,
-      info.last_committed_id));
+      info.last_committed_id,
+      raft_pool_->NewToken(ThreadPool::ExecutionMode::CONCURRENT)));
 
   // A manager for the set of peers that actually send the operations both remotely
   // and to the local wal.
@@ -657,6 +662,37 @@ void RaftConsensus::ReportFailureDetected() {
               LogPrefixThreadSafe() + "failed to submit failure detected task");
 }
 
+void RaftConsensus::ReportLeaderServerLost(const string& leader_uuid, MonoDelta timeout) {
+  // We're running on a reactor thread; handle the loss on a different thread pool.
+  WARN_NOT_OK(raft_pool_token_->SubmitFunc(std::bind(
+      &RaftConsensus::LeaderServerLostTask, shared_from_this(), leader_uuid, timeout)),
+              LogPrefixThreadSafe() + "failed to submit leader server lost task");
+}
+
+void RaftConsensus::LeaderServerLostTask(const string& leader_uuid, MonoDelta timeout) {
+  ThreadRestrictions::AssertWaitAllowed();
+  LockGuard l(lock_);
+  if (state_ != kRunning || GetLeaderUuidUnlocked() != leader_uuid) {
+    return;
+  }
+  // The other followers of the leader are told about the loss too, so there
+  // is no live leader to protect by withholding votes from them.
+  withhold_votes_until_ = MonoTime::Min();
+  if (!FLAGS_enable_leader_failure_detection || !failure_detector_->started()) {
+    return;
+  }
+  // Wait for between half and all of the time the leader's server had to be
+  // silent for, so that the other followers have likely found it lost as well
+  // when the election starts, and don't all start elections at once.
+  MonoDelta delay = MonoDelta::FromMilliseconds(
+      timeout.ToMilliseconds() * (0.5 + 0.5 * rng_.NextDoubleFraction()));
+  LOG_WITH_PREFIX_UNLOCKED(INFO)
+      << Substitute("Server of leader $0 is lost; starting an election in $1",
+                    leader_uuid, delay.ToString());
+  failure_detector_->Stop();
+  failure_detector_->Start(delay);
+}
+
 Status RaftConsensus::BecomeLeaderUnlocked() {
   DCHECK(lock_.is_locked());
 
@@ -736,6 +772,42 @@ Status RaftConsensus::Replicate(const scoped_refptr<ConsensusRound>& round) {
   return Status::OK();
 }
 
+Status RaftConsensus::ReplicateBatch(const vector<scoped_refptr<ConsensusRound>>& rounds,
+                                     int* num_replicated) {
+  *num_replicated = 0;
+  Status s;
+  {
+    std::lock_guard<simple_spinlock> lock(update_lock_);
+    ThreadRestrictions::AssertWaitAllowed();
+    LockGuard l(lock_);
+    // Only the rounds which pass the checks are appended, so that a round
+    // which can't be replicated doesn't hold back the ones before it.
+    int num_checked = 0;
+    for (const auto& round : rounds) {
+      s = CheckSafeToReplicateUnlocked(*round->replicate_msg());
+      if (s.ok()) {
+        s = round->CheckBoundTerm(CurrentTermUnlocked());
+      }
+      if (!s.ok()) {
+        break;
+      }
+      num_checked++;
+    }
+    if (num_checked > 0) {
+      vector<scoped_refptr<ConsensusRound>> checked(rounds.begin(), rounds.begin() + num_checked);
+      Status append_status = AppendNewRoundsToQueueUnlocked(checked, num_replicated);
+      if (!append_status.ok()) {
+        s = append_status;
+      }
+    }
+  }
+
+  if (*num_replicated > 0) {
+    peer_manager_->SignalRequest();
+  }
+  return s;
+}
+
 Status RaftConsensus::CheckLeadershipAndBindTerm(const scoped_refptr<ConsensusRound>& round) {
   ThreadRestrictions::AssertWaitAllowed();
   LockGuard l(lock_);
@@ -752,11 +824,59 @@ Status RaftConsensus::AppendNewRoundToQueueUnlocked(const scoped_refptr<Consensu
 
   // The only reasons for a bad status would be if the log itself were shut down,
   // or if we had an actual IO error, which we currently don't handle.
-  CHECK_OK_PREPEND(queue_->AppendOperation(round->replicate_scoped_refptr()),
+  CHECK_OK_PREPEND(queue_->AppendOperations(
+                       { round->replicate_scoped_refptr() },
+                       Bind(&ConsensusRound::NotifyLocalAppendFinished, round, MonoTime::Now())),
                    Substitute("$0: could not append to queue", LogPrefixUnlocked()));
   return Status::OK();
 }
 
+namespace {
+// Notifies each of 'rounds' that the batch of entries they were appended to
+// the local WAL in has been written.
+void NotifyLocalAppendFinishedForRounds(const vector<scoped_refptr<ConsensusRound>>& rounds,
+                                        MonoTime append_start_time,
+                                        const Status& status) {
+  for (const auto& round : rounds) {
+    round->NotifyLocalAppendFinished(append_start_time, status);
+  }
+}
+} // anonymous namespace
+
+Status RaftConsensus::AppendNewRoundsToQueueUnlocked(
+    const vector<scoped_refptr<ConsensusRound>>& rounds,
+    int* num_appended) {
+  DCHECK(lock_.is_locked());
+
+  *num_appended = 0;
+  Status s;
+  vector<ReplicateRefPtr> msgs;
+  msgs.reserve(rounds.size());
+  // The queue only moves its next id past an op once the op is appended, so
+  // the ids of the batch are assigned from the first one.
+  OpId next_id = queue_->GetNextOpId();
+  for (const auto& round : rounds) {
+    *round->replicate_msg()->mutable_id() = next_id;
+    s = AddPendingOperationUnlocked(round);
+    if (PREDICT_FALSE(!s.ok())) {
+      break;
+    }
+    msgs.push_back(round->replicate_scoped_refptr());
+    (*num_appended)++;
+    next_id.set_index(next_id.index() + 1);
+  }
+  if (msgs.empty()) {
+    return s;
+  }
+
+  vector<scoped_refptr<ConsensusRound>> appended(rounds.begin(), rounds.begin() + *num_appended);
+  CHECK_OK_PREPEND(queue_->AppendOperations(
+                       msgs,
+                       Bind(&NotifyLocalAppendFinishedForRounds, appended, MonoTime::Now())),
+                   Substitute("$0: could not append to queue", LogPrefixUnlocked()));
+  return s;
+}
+
 Status RaftConsensus::AddPendingOperationUnlocked(const scoped_refptr<ConsensusRound>& round) {
   DCHECK(lock_.is_locked());
   DCHECK(pending_);
@@ -1527,10 +1647,9 @@ Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
     }
 
     // All transactions that are going to be prepared were started, advance the safe timestamp.
-    // TODO(dralves) This is only correct because the queue only sets safe time when the request is
-    // an empty heartbeat. If we actually start setting this on a consensus request along with
-    // actual messages we need to be careful to ignore it if any of the messages fails to prepare.
-    if (request->has_safe_timestamp()) {
+    // A leader holding a lease may set safe time on a request along with actual messages, in
+    // which case it only holds if all of them were prepared.
+    if (request->has_safe_timestamp() && prepare_status.ok()) {
       time_manager_->AdvanceSafeTime(Timestamp(request->safe_timestamp()));
     }
 
@@ -2167,6 +2286,7 @@ void RaftConsensus::Stop() {
     if (cmeta_) {
       ClearLeaderUnlocked();
     }
+    UnwatchLeaderServerUnlocked();
 
     // If we were the leader, stop witholding votes.
     if (withhold_votes_until_ == MonoTime::Max()) {
@@ -2192,6 +2312,7 @@ void RaftConsensus::Shutdown() {
   {
     LockGuard l(lock_);
     SetStateUnlocked(kShutdown);
+    UnwatchLeaderServerUnlocked();
   }
   shutdown_.Store(true, kMemOrderRelease);
 }
@@ -2416,6 +2537,7 @@ void RaftConsensus::SetLeaderUuidUnlocked(const string& uuid) {
   failed_elections_since_stable_leader_ = 0;
   num_failed_elections_metric_->set_value(failed_elections_since_stable_leader_);
   cmeta_->set_leader_uuid(uuid);
+  UpdateLeaderServerWatchUnlocked();
   MarkDirty(Substitute("New leader $0", uuid));
 }
 
@@ -3039,6 +3161,37 @@ bool RaftConsensus::HasLeaderUnlocked() const {
 void RaftConsensus::ClearLeaderUnlocked() {
   DCHECK(lock_.is_locked());
   cmeta_->set_leader_uuid("");
+  UpdateLeaderServerWatchUnlocked();
+}
+
+void RaftConsensus::UnwatchLeaderServerUnlocked() {
+  DCHECK(lock_.is_locked());
+  if (leader_server_watch_id_ >= 0) {
+    ServerLivenessTracker::GetInstance()->Unwatch(leader_server_watch_id_);
+    leader_server_watch_id_ = -1;
+  }
+}
+
+void RaftConsensus::UpdateLeaderServerWatchUnlocked() {
+  DCHECK(lock_.is_locked());
+  UnwatchLeaderServerUnlocked();
+  // A stopped replica must not hold on to a watch: the tracker would keep
+  // the messenger and the timer checking the leader alive.
+  if (state_ != kRunning) {
+    return;
+  }
+  const string leader_uuid = GetLeaderUuidUnlocked();
+  if (leader_uuid.empty() || leader_uuid == peer_uuid()) {
+    return;
+  }
+  weak_ptr<RaftConsensus> w = shared_from_this();
+  leader_server_watch_id_ = ServerLivenessTracker::GetInstance()->Watch(
+      peer_proxy_factory_->messenger(), peer_uuid(), leader_uuid,
+      [w, leader_uuid](MonoDelta timeout) {
+        if (auto consensus = w.lock()) {
+          consensus->ReportLeaderServerLost(leader_uuid, timeout);
+        }
+      });
 }
 
 const bool RaftConsensus::HasVotedCurrentTermUnlocked() const {
@@ -3137,13 +3290,15 @@ ConsensusRound::ConsensusRound(RaftConsensus* consensus,
     : consensus_(consensus),
       replicate_msg_(new RefCountedReplicate(replicate_msg.release())),
       replicated_cb_(std::move(replicated_cb)),
-      bound_term_(-1) {}
+      bound_term_(-1),
+      local_append_nanos_(-1) {}
 
 ConsensusRound::ConsensusRound(RaftConsensus* consensus,
                                ReplicateRefPtr replicate_msg)
     : consensus_(consensus),
       replicate_msg_(std::move(replicate_msg)),
-      bound_term_(-1) {
+      bound_term_(-1),
+      local_append_nanos_(-1) {
   DCHECK(replicate_msg_);
 }
 
@@ -3152,6 +3307,18 @@ void ConsensusRound::NotifyReplicationFinished(const Status& status) {
   replicated_cb_(status);
 }
 
+void ConsensusRound::NotifyLocalAppendFinished(MonoTime append_start_time,
+                                               const Status& status) {
+  CrashIfNotOkStatusCB("Enqueued replicate operation failed to write to WAL", status);
+  local_append_nanos_.store((MonoTime::Now() - append_start_time).ToNanoseconds(),
+                            std::memory_order_release);
+}
+
+MonoDelta ConsensusRound::local_append_duration() const {
+  int64_t nanos = local_append_nanos_.load(std::memory_order_acquire);
+  return nanos < 0 ? MonoDelta() : MonoDelta::FromNanoseconds(nanos);
+}
+
 Status ConsensusRound::CheckBoundTerm(int64_t current_term) const {
   if (PREDICT_FALSE(bound_term_ != -1 &&
                     bound_term_ != current_term)) {
@@ -240,6 +240,19 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // This method can only be called on the leader, i.e. role() == LEADER
   Status Replicate(const scoped_refptr<ConsensusRound>& round);
 
+  // Like Replicate(), but replicates several rounds at once: they are
+  // appended to the queue under a single acquisition of the consensus lock,
+  // written to the WAL as a single batch of entries, and the peers are
+  // signaled once for all of them. The rounds are replicated in the order of
+  // 'rounds'.
+  //
+  // On return, '*num_replicated' is the number of leading rounds which were
+  // submitted for replication. If it is less than the size of 'rounds', the
+  // returned status is the reason the next round couldn't be replicated, and
+  // neither it nor the rounds after it were submitted.
+  Status ReplicateBatch(const std::vector<scoped_refptr<ConsensusRound>>& rounds,
+                        int* num_replicated);
+
   // Ensures that the consensus implementation is currently acting as LEADER,
   // and thus is allowed to submit operations to be prepared before they are
   // replicated. To avoid a time-of-check-to-time-of-use (TOCTOU) race, the
@@ -696,6 +709,23 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // being shut down).
   void ReportFailureDetectedTask();
 
+  // Watches the liveness of the server of the current leader, if it is
+  // another server and the replica is running, in place of any server
+  // watched before.
+  void UpdateLeaderServerWatchUnlocked();
+
+  // Stops watching the liveness of the server of the leader, if it was.
+  void UnwatchLeaderServerUnlocked();
+
+  // Called when the server 'leader_uuid' is found to be lost, after having
+  // been silent for 'timeout'. Submits LeaderServerLostTask() to a thread pool.
+  void ReportLeaderServerLost(const std::string& leader_uuid, MonoDelta timeout);
+
+  // If 'leader_uuid' is still the leader, stops withholding votes and, if
+  // this replica runs the failure detector, brings its expiry forward to
+  // start an election shortly.
+  void LeaderServerLostTask(const std::string& leader_uuid, MonoDelta timeout);
+
   // Handle the completion of replication of a config change operation.
   // If 'status' is OK, this takes care of persisting the new configuration
   // to disk as the committed configuration. A non-OK status indicates that
@@ -719,6 +749,11 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // As a leader, append a new ConsensusRound to the queue.
   Status AppendNewRoundToQueueUnlocked(const scoped_refptr<ConsensusRound>& round);
 
+  // As a leader, append several new ConsensusRounds to the queue in a single
+  // batch. See ReplicateBatch() for the meaning of 'num_appended'.
+  Status AppendNewRoundsToQueueUnlocked(const std::vector<scoped_refptr<ConsensusRound>>& rounds,
+                                        int* num_appended);
+
   // As a follower, start a consensus round not associated with a Transaction.
   Status StartConsensusOnlyRoundUnlocked(const ReplicateRefPtr& msg);
 
@@ -884,6 +919,10 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // This is used to calculate back-off of the election timeout.
   int64_t failed_elections_since_stable_leader_;
 
+  // The id of the ServerLivenessTracker watch on the server of the current
+  // leader, or -1 if there is none.
+  int64_t leader_server_watch_id_;
+
   Callback<void(const std::string& reason)> mark_dirty_clbk_;
 
   // A flag to help us avoid taking a lock on the reactor thread if the object
@@ -1010,6 +1049,16 @@ class ConsensusRound : public RefCountedThreadSafe<ConsensusRound> {
   // If a continuation was set, notifies it that the round has been replicated.
   void NotifyReplicationFinished(const Status& status);
 
+  // Records that the round's operation, appended to the queue by a leader at
+  // 'append_start_time', is now durable in the local WAL. Crashes if
+  // 'status' is not OK.
+  void NotifyLocalAppendFinished(MonoTime append_start_time, const Status& status);
+
+  // Returns the time the leader took to durably append the round's operation
+  // to its local WAL, or an uninitialized MonoDelta if it isn't durable yet
+  // or this isn't a leader round.
+  MonoDelta local_append_duration() const;
+
   // Binds this round such that it may not be eventually executed in any term
   // other than 'term'.
   // See CheckBoundTerm().
@@ -1048,6 +1097,9 @@ class ConsensusRound : public RefCountedThreadSafe<ConsensusRound> {
   //
   // Set to -1 if no term has been bound.
   int64_t bound_term_;
+
+  // See local_append_duration(). Set to -1 until the append finishes.
+  std::atomic<int64_t> local_append_nanos_;
 };
 
 }  // namespace consensus
@@ -53,6 +53,7 @@
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/consensus/raft_consensus.h"
+#include "kudu/consensus/server_liveness.h"
 #include "kudu/consensus/time_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/bind.h"
@@ -659,6 +660,36 @@ TEST_F(RaftConsensusQuorumTest, TestFollowersReplicateAndCommitSequence) {
   VerifyLogs(2, 0, 1);
 }
 
+// Tests that the followers watch the liveness of the leader's server, and stop
+// watching it once they're shut down.
+TEST_F(RaftConsensusQuorumTest, TestLeaderServerWatchRemovedOnShutdown) {
+  const int kFollower0Idx = 0;
+  const int kFollower1Idx = 1;
+  const int kLeaderIdx = 2;
+
+  ASSERT_OK(BuildAndStartConfig(3));
+
+  OpId last_op_id;
+  vector<scoped_refptr<ConsensusRound>> rounds;
+  NO_FATALS(ReplicateSequenceOfMessages(
+      1, kLeaderIdx, WAIT_FOR_ALL_REPLICAS, DONT_COMMIT, &last_op_id, &rounds));
+
+  ServerLivenessTracker* tracker = ServerLivenessTracker::GetInstance();
+  shared_ptr<RaftConsensus> follower0;
+  shared_ptr<RaftConsensus> follower1;
+  shared_ptr<RaftConsensus> leader;
+  ASSERT_OK(peers_->GetPeerByIdx(kFollower0Idx, &follower0));
+  ASSERT_OK(peers_->GetPeerByIdx(kFollower1Idx, &follower1));
+  ASSERT_OK(peers_->GetPeerByIdx(kLeaderIdx, &leader));
+  ASSERT_EQ(1, tracker->NumWatches(follower0->peer_uuid()));
+  ASSERT_EQ(1, tracker->NumWatches(follower1->peer_uuid()));
+  ASSERT_EQ(0, tracker->NumWatches(leader->peer_uuid()));
+
+  follower0->Shutdown();
+  ASSERT_EQ(0, tracker->NumWatches(follower0->peer_uuid()));
+  ASSERT_EQ(1, tracker->NumWatches(follower1->peer_uuid()));
+}
+
 TEST_F(RaftConsensusQuorumTest, TestConsensusContinuesIfAMinorityFallsBehind) {
   // Constants with the indexes of peers with certain roles,
   // since peers don't change roles in this test.
@@ -0,0 +1,122 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/consensus/server_liveness.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "kudu/rpc/messenger.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using kudu::rpc::Messenger;
+using kudu::rpc::MessengerBuilder;
+using std::shared_ptr;
+
+namespace kudu {
+namespace consensus {
+
+class ServerLivenessTrackerTest : public KuduTest {
+ public:
+  ServerLivenessTrackerTest()
+      : tracker_(ServerLivenessTracker::GetInstance()),
+        num_lost_(0) {
+  }
+
+  void SetUp() override {
+    KuduTest::SetUp();
+    ASSERT_OK(MessengerBuilder("test").Build(&messenger_));
+  }
+
+  void TearDown() override {
+    // Ensure no callbacks are running by the time 'num_lost_' is destroyed.
+    messenger_->Shutdown();
+    KuduTest::TearDown();
+  }
+
+ protected:
+  int64_t Watch(const char* local_uuid, const char* remote_uuid) {
+    return tracker_->Watch(messenger_, local_uuid, remote_uuid,
+                           [this](MonoDelta /*timeout*/) { num_lost_++; });
+  }
+
+  ServerLivenessTracker* const tracker_;
+  shared_ptr<Messenger> messenger_;
+  std::atomic<int> num_lost_;
+};
+
+const MonoDelta kInterval = MonoDelta::FromMilliseconds(10);
+
+// A server is lost once it goes silent, only once until it's heard from again.
+TEST_F(ServerLivenessTrackerTest, TestLostAfterSilence) {
+  int64_t watch_id = Watch("lost-local", "lost-remote");
+
+  // A server which never sent a liveness signal isn't tracked.
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(0, num_lost_);
+  ASSERT_FALSE(tracker_->IsLost("lost-local", "lost-remote"));
+
+  tracker_->RecordContact("lost-local", "lost-remote", kInterval);
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(1, num_lost_);
+  });
+  ASSERT_TRUE(tracker_->IsLost("lost-local", "lost-remote"));
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(1, num_lost_);
+
+  // Contact makes the server live again, until it goes silent again.
+  tracker_->RecordContact("lost-local", "lost-remote", kInterval);
+  ASSERT_FALSE(tracker_->IsLost("lost-local", "lost-remote"));
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(2, num_lost_);
+  });
+
+  // Contact with a different local server doesn't count.
+  tracker_->RecordContact("other-local", "lost-remote", kInterval);
+  ASSERT_TRUE(tracker_->IsLost("lost-local", "lost-remote"));
+  tracker_->Unwatch(watch_id);
+}
+
+// A server which keeps signalling is never lost.
+TEST_F(ServerLivenessTrackerTest, TestLiveServer) {
+  int64_t watch_id = Watch("live-local", "live-remote");
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(500);
+  while (MonoTime::Now() < deadline) {
+    tracker_->RecordContact("live-local", "live-remote", kInterval);
+    SleepFor(MonoDelta::FromMilliseconds(1));
+  }
+  ASSERT_EQ(0, num_lost_);
+  tracker_->Unwatch(watch_id);
+}
+
+// Once unwatched, a server is forgotten.
+TEST_F(ServerLivenessTrackerTest, TestUnwatch) {
+  int64_t watch_id = Watch("unwatch-local", "unwatch-remote");
+  tracker_->RecordContact("unwatch-local", "unwatch-remote", kInterval);
+  tracker_->Unwatch(watch_id);
+  SleepFor(MonoDelta::FromMilliseconds(200));
+  ASSERT_EQ(0, num_lost_);
+  ASSERT_FALSE(tracker_->IsLost("unwatch-local", "unwatch-remote"));
+}
+
+} // namespace consensus
+} // namespace kudu
@@ -0,0 +1,179 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/consensus/server_liveness.h"
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
+#include "kudu/rpc/periodic.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(raft_server_liveness_max_missed_periods, 5,
+             "Number of liveness intervals a server which sends liveness signals "
+             "(see --raft_server_liveness_interval_ms) must miss for the followers "
+             "of the tablets it leads to start elections early.");
+TAG_FLAG(raft_server_liveness_max_missed_periods, advanced);
+TAG_FLAG(raft_server_liveness_max_missed_periods, experimental);
+TAG_FLAG(raft_server_liveness_max_missed_periods, runtime);
+
+using kudu::rpc::Messenger;
+using kudu::rpc::PeriodicTimer;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace consensus {
+
+ServerLivenessTracker::ServerLivenessTracker()
+    : next_watch_id_(0) {
+}
+
+string ServerLivenessTracker::PairKey(const string& local_uuid, const string& remote_uuid) {
+  return strings::Substitute("$0/$1", local_uuid, remote_uuid);
+}
+
+void ServerLivenessTracker::RecordContact(const string& local_uuid,
+                                          const string& remote_uuid,
+                                          MonoDelta interval) {
+  DCHECK(interval.Initialized());
+  const string key = PairKey(local_uuid, remote_uuid);
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  RemoteServer* remote = FindOrNull(remotes_, key);
+  if (!remote) {
+    // Only the servers hosting the leaders of local replicas are of
+    // interest; there's nothing to track until one of them is watched.
+    return;
+  }
+  if (PREDICT_FALSE(remote->lost)) {
+    LOG(INFO) << "Server " << remote_uuid << " is sending liveness signals again";
+    remote->lost = false;
+  }
+  remote->last_contact = now;
+  remote->interval = interval;
+  MaybeStartCheckingUnlocked(key, remote);
+}
+
+int64_t ServerLivenessTracker::Watch(const shared_ptr<Messenger>& messenger,
+                                     const string& local_uuid,
+                                     const string& remote_uuid,
+                                     LostCallback callback) {
+  const string key = PairKey(local_uuid, remote_uuid);
+  std::lock_guard<simple_spinlock> l(lock_);
+  RemoteServer* remote = &remotes_[key];
+  if (!remote->messenger) {
+    remote->messenger = messenger;
+  }
+  int64_t watch_id = next_watch_id_++;
+  remote->watchers.emplace(watch_id, std::move(callback));
+  watch_keys_.emplace(watch_id, key);
+  MaybeStartCheckingUnlocked(key, remote);
+  return watch_id;
+}
+
+void ServerLivenessTracker::Unwatch(int64_t watch_id) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  auto key_it = watch_keys_.find(watch_id);
+  if (key_it == watch_keys_.end()) {
+    return;
+  }
+  auto remote_it = remotes_.find(key_it->second);
+  DCHECK(remote_it != remotes_.end());
+  RemoteServer* remote = &remote_it->second;
+  remote->watchers.erase(watch_id);
+  watch_keys_.erase(key_it);
+  if (remote->watchers.empty()) {
+    // Forget the pair along with its contact history: a server which leads
+    // nothing replicated here needn't be watched.
+    if (remote->check_timer) {
+      remote->check_timer->Stop();
+    }
+    remotes_.erase(remote_it);
+  }
+}
+
+bool ServerLivenessTracker::IsLost(const string& local_uuid, const string& remote_uuid) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  const RemoteServer* remote = FindOrNull(remotes_, PairKey(local_uuid, remote_uuid));
+  return remote && remote->lost;
+}
+
+int ServerLivenessTracker::NumWatches(const string& local_uuid) const {
+  const string prefix = local_uuid + "/";
+  std::lock_guard<simple_spinlock> l(lock_);
+  int num_watches = 0;
+  for (const auto& e : remotes_) {
+    if (HasPrefixString(e.first, prefix)) {
+      num_watches += e.second.watchers.size();
+    }
+  }
+  return num_watches;
+}
+
+void ServerLivenessTracker::MaybeStartCheckingUnlocked(const string& key, RemoteServer* remote) {
+  DCHECK(lock_.is_locked());
+  if (remote->check_timer || !remote->messenger || !remote->interval.Initialized()) {
+    return;
+  }
+  // Check once per interval of the remote server. The timer captures
+  // 'this' as the tracker is never destroyed.
+  remote->check_timer = PeriodicTimer::Create(
+      remote->messenger,
+      [this, key]() { this->CheckForSilence(key); },
+      remote->interval);
+  remote->check_timer->Start();
+}
+
+void ServerLivenessTracker::CheckForSilence(const string& key) {
+  vector<LostCallback> callbacks;
+  MonoDelta timeout;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    RemoteServer* remote = FindOrNull(remotes_, key);
+    if (!remote || remote->lost || !remote->last_contact.Initialized()) {
+      return;
+    }
+    timeout = MonoDelta::FromNanoseconds(
+        remote->interval.ToNanoseconds() * FLAGS_raft_server_liveness_max_missed_periods);
+    MonoDelta silence = MonoTime::Now() - remote->last_contact;
+    if (silence < timeout) {
+      return;
+    }
+    remote->lost = true;
+    callbacks.reserve(remote->watchers.size());
+    for (const auto& watcher : remote->watchers) {
+      callbacks.push_back(watcher.second);
+    }
+    LOG(WARNING) << "No liveness signal from server " << key.substr(key.find('/') + 1)
+                 << " for " << silence.ToString() << "; considering it lost";
+  }
+  for (const auto& callback : callbacks) {
+    callback(timeout);
+  }
+}
+
+} // namespace consensus
+} // namespace kudu
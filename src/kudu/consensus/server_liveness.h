@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/singleton.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+namespace rpc {
+class Messenger;
+class PeriodicTimer;
+} // namespace rpc
+
+namespace consensus {
+
+// Tracks whether the servers hosting the leaders of the local replicas are
+// alive, from the liveness signals they send once per server pair rather than
+// once per tablet (see --raft_server_liveness_interval_ms). This lets the
+// followers of all the tablets led from a server learn that it is gone well
+// before their own election timeouts expire.
+//
+// A remote server is only considered lost after it has sent at least one
+// liveness signal, so that servers which don't send any are only subject to
+// the regular, per-tablet failure detection.
+//
+// Pairs are keyed by the UUIDs of both servers, since several servers may run
+// in the same process in tests.
+//
+// This class is thread-safe.
+class ServerLivenessTracker {
+ public:
+  static ServerLivenessTracker* GetInstance() {
+    return Singleton<ServerLivenessTracker>::get();
+  }
+
+  // Called when a server is found to be lost, with the time it must have
+  // been silent for to be considered lost.
+  typedef std::function<void(MonoDelta)> LostCallback;
+
+  // Records that the server 'local_uuid' got a liveness signal from the
+  // server 'remote_uuid', which promised to send one at least every
+  // 'interval'.
+  void RecordContact(const std::string& local_uuid,
+                     const std::string& remote_uuid,
+                     MonoDelta interval);
+
+  // Arranges for 'callback' to be called, on a reactor thread of 'messenger',
+  // every time the server 'local_uuid' hasn't heard from 'remote_uuid' for
+  // --raft_server_liveness_max_missed_periods of its intervals. The callback
+  // must do very little work and must not call back into this class.
+  //
+  // Returns an id to pass to Unwatch() to cancel the callback.
+  int64_t Watch(const std::shared_ptr<rpc::Messenger>& messenger,
+                const std::string& local_uuid,
+                const std::string& remote_uuid,
+                LostCallback callback);
+
+  // Cancels the callback set up by the Watch() call which returned 'watch_id'.
+  // The callback may still be running, or about to run, when this returns.
+  void Unwatch(int64_t watch_id);
+
+  // Returns true if the server 'remote_uuid' is currently considered lost by
+  // the server 'local_uuid'.
+  bool IsLost(const std::string& local_uuid, const std::string& remote_uuid) const;
+
+  // Returns the number of watches set up by the server 'local_uuid'.
+  int NumWatches(const std::string& local_uuid) const;
+
+ private:
+  friend class Singleton<ServerLivenessTracker>;
+
+  // The liveness state of a remote server, as seen by a local server.
+  struct RemoteServer {
+    // The time of the last liveness signal, and the interval the remote
+    // server sends them at. Unset until the first signal.
+    MonoTime last_contact;
+    MonoDelta interval;
+
+    // Whether the remote server is lost, i.e. the callbacks were called
+    // and it hasn't been heard from since.
+    bool lost = false;
+
+    // The messenger of the first watcher, used to check for silence, and the
+    // timer doing so. The timer is only created once both are known.
+    std::shared_ptr<rpc::Messenger> messenger;
+    std::shared_ptr<rpc::PeriodicTimer> check_timer;
+
+    std::unordered_map<int64_t, LostCallback> watchers;
+  };
+
+  ServerLivenessTracker();
+
+  static std::string PairKey(const std::string& local_uuid, const std::string& remote_uuid);
+
+  // Starts checking 'remote' for silence if it isn't checked yet and it can
+  // be.
+  void MaybeStartCheckingUnlocked(const std::string& key, RemoteServer* remote);
+
+  // Calls the callbacks watching the pair 'key' if its remote server has
+  // become lost.
+  void CheckForSilence(const std::string& key);
+
+  mutable simple_spinlock lock_;
+  std::unordered_map<std::string, RemoteServer> remotes_;
+
+  // The pair each watch id is for, and the next id to hand out.
+  std::unordered_map<int64_t, std::string> watch_keys_;
+  int64_t next_watch_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(ServerLivenessTracker);
+};
+
+} // namespace consensus
+} // namespace kudu
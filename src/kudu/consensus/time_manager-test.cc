@@ -19,6 +19,7 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -34,6 +35,8 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(raft_enable_leader_leases);
+
 namespace kudu {
 namespace consensus {
 
@@ -204,5 +207,44 @@ TEST_F(TimeManagerTest, TestTimeManagerLeaderMode) {
   after_latch->Wait();
 }
 
+// Tests that with leader leases, the leader only moves safe time with its clock
+// while it holds a lease.
+TEST_F(TimeManagerTest, TestLeaderLease) {
+  FLAGS_raft_enable_leader_leases = true;
+  InitTimeManager(clock_->Now());
+
+  // There's no lease outside leader mode.
+  time_manager_->UpdateLeaderLease(MonoTime::Max());
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  time_manager_->SetLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  Timestamp safe_before = time_manager_->GetSafeTime();
+  ASSERT_EQ(safe_before, time_manager_->GetSafeTime());
+  Timestamp now = clock_->Now();
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(100);
+  ASSERT_TRUE(time_manager_->WaitUntilSafe(now, deadline).IsTimedOut());
+
+  // Once granted a lease, safe time moves with the clock again.
+  time_manager_->UpdateLeaderLease(MonoTime::Now() + MonoDelta::FromSeconds(60));
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  ASSERT_GT(time_manager_->GetSafeTime(), now);
+
+  // ... until the lease expires or is revoked.
+  time_manager_->UpdateLeaderLease(MonoTime::Now());
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  time_manager_->UpdateLeaderLease(MonoTime::Now() + MonoDelta::FromSeconds(60));
+  time_manager_->RevokeLeaderLease();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  Timestamp safe_after = time_manager_->GetSafeTime();
+  ASSERT_EQ(safe_after, time_manager_->GetSafeTime());
+
+  // Leaving leader mode gives up the lease too.
+  time_manager_->UpdateLeaderLease(MonoTime::Max());
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  time_manager_->SetNonLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+}
+
 } // namespace consensus
 } // namespace kudu
@@ -49,6 +49,17 @@ DEFINE_int32(safe_time_max_lag_ms, 30 * 1000,
              "before forcing the client to retry, in milliseconds.");
 TAG_FLAG(safe_time_max_lag_ms, experimental);
 
+DEFINE_bool(raft_enable_leader_leases, false,
+            "Whether leaders hold leases, which are granted by a majority of the voters "
+            "withholding their votes from other candidates for the minimum election "
+            "timeout after accepting a request. A leader then only lets safe time move "
+            "with its clock while it holds a lease, and attaches its safe time to any "
+            "request which brings a follower up to date, letting snapshot scans at recent "
+            "timestamps proceed without waiting for heartbeats. Elections forced by "
+            "operators regardless of a live leader bypass the lease.");
+TAG_FLAG(raft_enable_leader_leases, advanced);
+TAG_FLAG(raft_enable_leader_leases, experimental);
+
 DECLARE_int32(raft_heartbeat_interval_ms);
 DECLARE_int32(scanner_max_wait_ms);
 
@@ -76,6 +87,7 @@ TimeManager::TimeManager(scoped_refptr<Clock> clock, Timestamp initial_safe_time
   : last_serial_ts_assigned_(initial_safe_time),
     last_safe_ts_(initial_safe_time),
     last_advanced_safe_time_(MonoTime::Now()),
+    leader_lease_expiry_(MonoTime::Min()),
     mode_(NON_LEADER),
     clock_(std::move(clock)) {}
 
@@ -88,6 +100,29 @@ void TimeManager::SetLeaderMode() {
 void TimeManager::SetNonLeaderMode() {
   Lock l(lock_);
   mode_ = NON_LEADER;
+  leader_lease_expiry_ = MonoTime::Min();
+}
+
+void TimeManager::UpdateLeaderLease(MonoTime expiry) {
+  Lock l(lock_);
+  if (mode_ == LEADER) {
+    leader_lease_expiry_ = expiry;
+  }
+}
+
+void TimeManager::RevokeLeaderLease() {
+  Lock l(lock_);
+  leader_lease_expiry_ = MonoTime::Min();
+}
+
+bool TimeManager::HasLeaderLease() {
+  Lock l(lock_);
+  return HasLeaderLeaseUnlocked();
+}
+
+bool TimeManager::HasLeaderLeaseUnlocked() const {
+  DCHECK(lock_.is_locked());
+  return mode_ == LEADER && MonoTime::Now() < leader_lease_expiry_;
 }
 
 Status TimeManager::AssignTimestamp(ReplicateMsg* message) {
@@ -296,6 +331,11 @@ Timestamp TimeManager::GetSafeTimeUnlocked() {
 
   switch (mode_) {
     case LEADER: {
+      // A leader without a lease might have been deposed already, in which case
+      // another leader may assign lower timestamps than its clock's.
+      if (FLAGS_raft_enable_leader_leases && !HasLeaderLeaseUnlocked()) {
+        return last_safe_ts_;
+      }
       // In ASCII form, where 'S' represents a safe timestamp, 'A' represents the last assigned
       // timestamp, and 'N' represents the current clock value, the internal state can look like
       // the following diagrams (time moves from left to right):
@@ -58,8 +58,13 @@ class ReplicateMsg;
 // when it advances.
 //
 // This class's leadership status is meant to be in tune with the queue's as the queue
-// is responsible for broadcasting safe time from a leader (and will eventually be responsible
-// for calculating that leader's lease).
+// is responsible for broadcasting safe time from a leader and for calculating that
+// leader's lease.
+//
+// With --raft_enable_leader_leases, the leader only moves safe time with the clock while
+// it holds a lease, i.e. while a majority of the voters is known to be withholding its
+// votes from other candidates. Such a leader can't have been deposed, so its safe time
+// can be trusted.
 //
 // See: docs/design-docs/repeatable-reads.md
 //
@@ -83,6 +88,16 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // Sets this TimeManager to non-leader mode.
   void SetNonLeaderMode();
 
+  // Sets the leader's lease to expire at 'expiry'. Has no effect in non-leader mode,
+  // where there is no lease.
+  void UpdateLeaderLease(MonoTime expiry);
+
+  // Gives up the leader's lease, e.g. before handing leadership over to another peer.
+  void RevokeLeaderLease();
+
+  // Returns true if this TimeManager is in leader mode and holds a valid lease.
+  bool HasLeaderLease();
+
   // Assigns a timestamp to 'message' according to the message's ExternalConsistencyMode and/or
   // message type.
   //
@@ -141,6 +156,7 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
  private:
   FRIEND_TEST(TimeManagerTest, TestTimeManagerNonLeaderMode);
   FRIEND_TEST(TimeManagerTest, TestTimeManagerLeaderMode);
+  FRIEND_TEST(TimeManagerTest, TestLeaderLease);
 
   // Returns whether we've advanced safe time recently.
   // If this returns false we might be partitioned or there might be election churn.
@@ -193,6 +209,9 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // Internal, unlocked implementation of GetSafeTime().
   Timestamp GetSafeTimeUnlocked();
 
+  // Internal, unlocked implementation of HasLeaderLease().
+  bool HasLeaderLeaseUnlocked() const;
+
   // Lock to protect the non-const fields below.
   mutable simple_spinlock lock_;
 
@@ -210,6 +229,9 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // Used in the decision of whether we should have waiters wait or try again.
   MonoTime last_advanced_safe_time_;
 
+  // When the leader's lease expires. MonoTime::Min() if there's no lease.
+  MonoTime leader_lease_expiry_;
+
   // The current mode of the TimeManager.
   Mode mode_;
 
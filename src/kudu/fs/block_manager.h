@@ -165,6 +165,21 @@ class ReadableBlock : public Block {
   // If an error was encountered, returns a non-OK status.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Starts reading 'length' bytes beginning from 'offset' in the block in
+  // the background, without waiting for the read to complete, so that a
+  // later Read() or ReadV() of the range is likely to be served from memory.
+  // Issuing several prefetches lets the device work on many reads at once
+  // without tying up a thread for each.
+  //
+  // This is only a hint; returns an error if the range is out of bounds or
+  // the hint couldn't be given.
+  virtual Status Prefetch(uint64_t offset, size_t length) const = 0;
+
+  // Like ReadV(), but bypasses the OS page cache where the filesystem allows
+  // it, so that reading data that won't be read again doesn't evict data
+  // that will.
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const = 0;
+
   // Returns the memory usage of this object including the object itself.
   virtual size_t memory_footprint() const = 0;
 };
@@ -175,6 +190,12 @@ class ReadableBlock : public Block {
 // placement into SSD-backed directories).
 struct CreateBlockOptions {
   const std::string tablet_id;
+
+  // Whether the block should be placed in a directory of the fast storage
+  // tier (see --fs_fast_tier_data_dirs). Without this, blocks are placed in
+  // the slow tier. Either way, any tier is used if the preferred one is full
+  // or not part of the tablet's data dir group.
+  const bool prefer_fast_tier;
 };
 
 // Block manager creation options.
@@ -40,6 +40,7 @@
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
@@ -52,8 +53,10 @@ using std::unique_ptr;
 using strings::Substitute;
 
 DECLARE_bool(crash_on_eio);
+DECLARE_bool(fs_data_dirs_consider_io_load);
 DECLARE_double(env_inject_eio);
 DECLARE_int32(fs_data_dirs_full_disk_cache_seconds);
+DECLARE_int32(fs_data_dirs_io_load_half_life_ms);
 DECLARE_int32(fs_target_data_dirs_per_tablet);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_int64(fs_data_dirs_reserved_bytes);
@@ -260,6 +263,101 @@ TEST_F(DataDirsTest, TestFailedDirNotAddedToGroup) {
   ASSERT_TRUE(s.IsIOError());
 }
 
+TEST_F(DataDirsTest, TestNewBlocksAvoidBusyDir) {
+  FLAGS_fs_target_data_dirs_per_tablet = 2;
+  ASSERT_OK(dd_manager_->CreateDataDirGroup(test_tablet_name_));
+  DataDir* busy_dd;
+  ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &busy_dd));
+
+  // Make one dir of the group look slow. With two dirs to choose from, new
+  // blocks should always go to the other one.
+  busy_dd->RecordIOLatency(MonoDelta::FromMilliseconds(100));
+  for (int i = 0; i < 10; i++) {
+    DataDir* dd;
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    ASSERT_NE(busy_dd, dd);
+  }
+
+  // Without further I/O, the dir's latency decays until it's tried again.
+  FLAGS_fs_data_dirs_io_load_half_life_ms = 1;
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(0, busy_dd->avg_io_latency_us());
+  bool busy_dd_returned = false;
+  for (int i = 0; i < 100 && !busy_dd_returned; i++) {
+    DataDir* dd;
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    busy_dd_returned = dd == busy_dd;
+  }
+  ASSERT_TRUE(busy_dd_returned);
+
+  // Unless the I/O load isn't taken into account, the dir is avoided again
+  // once it is found to be slow.
+  FLAGS_fs_data_dirs_io_load_half_life_ms = 10000;
+  busy_dd->RecordIOLatency(MonoDelta::FromMilliseconds(100));
+  FLAGS_fs_data_dirs_consider_io_load = false;
+  busy_dd_returned = false;
+  for (int i = 0; i < 100 && !busy_dd_returned; i++) {
+    DataDir* dd;
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    busy_dd_returned = dd == busy_dd;
+  }
+  ASSERT_TRUE(busy_dd_returned);
+}
+
+TEST_F(DataDirsTest, TestNewGroupsAvoidBusyDir) {
+  FLAGS_fs_target_data_dirs_per_tablet = 3;
+  // Give every dir some latency, and one a lot more.
+  for (const auto& dd : dd_manager_->data_dirs()) {
+    dd->RecordIOLatency(MonoDelta::FromMicroseconds(100));
+  }
+  DataDir* busy_dd = dd_manager_->data_dirs()[0].get();
+  busy_dd->RecordIOLatency(MonoDelta::FromSeconds(1));
+  int busy_uuid_idx;
+  ASSERT_TRUE(dd_manager_->FindUuidIndexByDataDir(busy_dd, &busy_uuid_idx));
+
+  // There are always enough other dirs for a group, so the busy one
+  // shouldn't be picked for any of them.
+  for (int tablet_idx = 0; tablet_idx < 20; tablet_idx++) {
+    ASSERT_OK(dd_manager_->CreateDataDirGroup(Substitute("$0-$1", test_tablet_name_, tablet_idx)));
+  }
+  ASSERT_TRUE(FindOrDie(dd_manager_->tablets_by_uuid_idx_map_, busy_uuid_idx).empty());
+}
+
+TEST_F(DataDirsTest, TestTieredPlacement) {
+  // Replace the directory manager with one whose first two dirs are fast.
+  dd_manager_.reset();
+  vector<string> roots;
+  for (int i = 0; i < kNumDirs; i++) {
+    roots.push_back(GetTestPath(Substitute("tiered-$0", i)));
+    ASSERT_OK(env_->CreateDir(roots.back()));
+  }
+  DataDirManagerOptions opts;
+  opts.fast_tier_data_roots = { roots[0], roots[1] };
+  ASSERT_OK(DataDirManager::CreateNewForTests(env_, roots, opts, &dd_manager_));
+  ASSERT_TRUE(dd_manager_->has_fast_tier());
+
+  // Every new group gets a fast dir.
+  FLAGS_fs_target_data_dirs_per_tablet = 3;
+  for (int tablet_idx = 0; tablet_idx < 10; tablet_idx++) {
+    const string tablet_id = Substitute("$0-$1", test_tablet_name_, tablet_idx);
+    ASSERT_OK(dd_manager_->CreateDataDirGroup(tablet_id));
+
+    // Blocks are placed in the requested tier.
+    for (bool fast : { false, true }) {
+      DataDir* dd;
+      ASSERT_OK(dd_manager_->GetNextDataDir(CreateBlockOptions({ tablet_id, fast }), &dd));
+      ASSERT_EQ(fast ? DataDirTier::FAST : DataDirTier::SLOW, dd->tier());
+    }
+  }
+
+  // A fast tier dir must be one of the data dirs.
+  dd_manager_.reset();
+  opts.fast_tier_data_roots = { GetTestPath("not-a-data-dir") };
+  ASSERT_OK(env_->CreateDir(opts.fast_tier_data_roots[0]));
+  Status s = DataDirManager::OpenExistingForTests(env_, roots, opts, &dd_manager_);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 TEST_F(DataDirsTest, TestLoadBalancingDistribution) {
   FLAGS_fs_target_data_dirs_per_tablet = 3;
   const double kNumTablets = 20;
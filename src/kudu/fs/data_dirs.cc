@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <cmath>
 #include <cstdint>
 #include <iterator>
 #include <memory>
@@ -46,7 +47,9 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/flag_tags.h"
@@ -91,6 +94,46 @@ DEFINE_int32(fs_data_dirs_full_disk_cache_seconds, 30,
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, advanced);
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, evolving);
 
+DEFINE_bool(fs_data_dirs_consider_io_load, true,
+            "Whether to take the recent I/O latency and queue depth of each "
+            "data directory into account when placing new blocks and when "
+            "choosing data directories for new tablets, steering data away "
+            "from slow or busy disks.");
+TAG_FLAG(fs_data_dirs_consider_io_load, advanced);
+TAG_FLAG(fs_data_dirs_consider_io_load, evolving);
+TAG_FLAG(fs_data_dirs_consider_io_load, runtime);
+
+DEFINE_double(fs_data_dirs_slow_io_load_ratio, 4.0,
+              "When choosing data directories for a new tablet, directories "
+              "whose I/O load is more than this many times the average of the "
+              "healthy directories' are avoided where possible. Only relevant "
+              "if --fs_data_dirs_consider_io_load is true.");
+DEFINE_validator(fs_data_dirs_slow_io_load_ratio,
+    [](const char* /*n*/, double v) { return v >= 1.0; });
+TAG_FLAG(fs_data_dirs_slow_io_load_ratio, advanced);
+TAG_FLAG(fs_data_dirs_slow_io_load_ratio, evolving);
+TAG_FLAG(fs_data_dirs_slow_io_load_ratio, runtime);
+
+DEFINE_int32(fs_data_dirs_io_load_half_life_ms, 10000,
+             "The recorded I/O latency of a data directory is halved every this "
+             "many milliseconds during which no I/O to it completes, so that a "
+             "directory avoided for being slow is eventually tried again and its "
+             "latency measured anew. If 0 or less, the latency only changes as "
+             "I/Os complete.");
+TAG_FLAG(fs_data_dirs_io_load_half_life_ms, advanced);
+TAG_FLAG(fs_data_dirs_io_load_half_life_ms, evolving);
+TAG_FLAG(fs_data_dirs_io_load_half_life_ms, runtime);
+
+DEFINE_string(fs_fast_tier_data_dirs, "",
+              "Comma-separated list of the data directories, out of those given by "
+              "--fs_data_dirs and --fs_wal_dir, that are on fast devices such as "
+              "NVMe SSDs. Newly flushed and small compacted rowsets are placed in "
+              "these directories, and rowsets that go unread are later migrated to "
+              "the other directories. Each tablet's data directory group includes "
+              "at least one of these directories where possible. Empty means all "
+              "data directories are treated alike.");
+TAG_FLAG(fs_fast_tier_data_dirs, experimental);
+
 DEFINE_bool(fs_lock_data_dirs, true,
             "Lock the data directories to prevent concurrent usage. "
             "Note that read-only concurrent usage is still allowed.");
@@ -212,17 +255,22 @@ DataDirMetrics::DataDirMetrics(const scoped_refptr<MetricEntity>& entity)
 DataDir::DataDir(Env* env,
                  DataDirMetrics* metrics,
                  DataDirFsType fs_type,
+                 DataDirTier tier,
                  string dir,
                  unique_ptr<PathInstanceMetadataFile> metadata_file,
                  unique_ptr<ThreadPool> pool)
     : env_(env),
       metrics_(metrics),
       fs_type_(fs_type),
+      tier_(tier),
       dir_(std::move(dir)),
       metadata_file_(std::move(metadata_file)),
       pool_(std::move(pool)),
       is_shutdown_(false),
-      is_full_(false) {
+      is_full_(false),
+      ios_in_flight_(0),
+      avg_io_latency_us_(0),
+      last_io_time_us_(0) {
 }
 
 DataDir::~DataDir() {
@@ -295,6 +343,43 @@ Status DataDir::RefreshIsFull(RefreshMode mode) {
   return Status::OK();
 }
 
+namespace {
+
+// Returns 'avg_us', recorded at 'recorded_us', decayed as of 'now_us'.
+int64_t DecayedLatencyUs(int64_t avg_us, int64_t recorded_us, int64_t now_us) {
+  const int32_t half_life_ms = FLAGS_fs_data_dirs_io_load_half_life_ms;
+  if (avg_us == 0 || half_life_ms <= 0 || now_us <= recorded_us) {
+    return avg_us;
+  }
+  return static_cast<int64_t>(
+      avg_us * std::exp2(-static_cast<double>(now_us - recorded_us) / (half_life_ms * 1000)));
+}
+
+} // anonymous namespace
+
+int64_t DataDir::avg_io_latency_us() const {
+  return DecayedLatencyUs(avg_io_latency_us_.Load(), last_io_time_us_.Load(),
+                          GetMonoTimeMicros());
+}
+
+void DataDir::RecordIOLatency(MonoDelta latency) {
+  // Weigh each new sample at 1/8, so a dir's average follows changes in its
+  // disk's behavior within a few dozen I/Os.
+  const int64_t sample_us = std::max<int64_t>(latency.ToMicroseconds(), 1);
+  const int64_t now_us = GetMonoTimeMicros();
+  int64_t recorded_avg = avg_io_latency_us_.Load();
+  while (true) {
+    int64_t old_avg = DecayedLatencyUs(recorded_avg, last_io_time_us_.Load(), now_us);
+    int64_t new_avg = old_avg == 0 ? sample_us : old_avg + (sample_us - old_avg) / 8;
+    int64_t prev = avg_io_latency_us_.CompareAndSwap(recorded_avg, new_avg);
+    if (prev == recorded_avg) {
+      break;
+    }
+    recorded_avg = prev;
+  }
+  last_io_time_us_.StoreMax(now_us);
+}
+
 ////////////////////////////////////////////////////////////
 // DataDirGroup
 ////////////////////////////////////////////////////////////
@@ -344,7 +429,9 @@ Status DataDirGroup::CopyToPB(const UuidByUuidIndexMap& uuid_by_uuid_idx,
 DataDirManagerOptions::DataDirManagerOptions()
     : block_manager_type(FLAGS_block_manager),
       read_only(false),
-      consistency_check(ConsistencyCheckBehavior::ENFORCE_CONSISTENCY) {
+      consistency_check(ConsistencyCheckBehavior::ENFORCE_CONSISTENCY),
+      fast_tier_data_roots(strings::Split(FLAGS_fs_fast_tier_data_dirs, ",",
+                                          strings::SkipEmpty())) {
 }
 
 ////////////////////////////////////////////////////////////
@@ -364,6 +451,7 @@ DataDirManager::DataDirManager(Env* env,
     : env_(env),
       opts_(std::move(opts)),
       canonicalized_data_fs_roots_(std::move(canonicalized_data_roots)),
+      has_fast_tier_(false),
       rng_(GetRandomSeed32()) {
   DCHECK_GT(canonicalized_data_fs_roots_.size(), 0);
   DCHECK(opts_.consistency_check != ConsistencyCheckBehavior::UPDATE_ON_DISK ||
@@ -701,9 +789,26 @@ Status DataDirManager::Open() {
                    JoinStrings(GetDataDirs(), ",")));
   }
 
+  // Determine which data roots are in the fast tier.
+  set<string> fast_tier_roots;
+  for (const string& root : opts_.fast_tier_data_roots) {
+    string canonicalized;
+    RETURN_NOT_OK_PREPEND(env_->Canonicalize(root, &canonicalized),
+                          Substitute("could not canonicalize fast tier data dir $0", root));
+    if (std::none_of(canonicalized_data_fs_roots_.begin(), canonicalized_data_fs_roots_.end(),
+                     [&](const CanonicalizedRootAndStatus& r) {
+                       return r.path == canonicalized;
+                     })) {
+      return Status::InvalidArgument(
+          "fast tier data dir is not one of the data dirs", root);
+    }
+    fast_tier_roots.insert(std::move(canonicalized));
+  }
+
   // All instances are present and accounted for. Time to create the in-memory
   // data directory structures.
   int i = 0;
+  int num_fast_tier_dirs = 0;
   vector<unique_ptr<DataDir>> dds;
   for (auto& instance : loaded_instances) {
     const string data_dir = instance->dir();
@@ -730,8 +835,14 @@ Status DataDirManager::Open() {
       }
     }
 
+    DataDirTier tier = DataDirTier::SLOW;
+    if (ContainsKey(fast_tier_roots, DirName(data_dir))) {
+      tier = DataDirTier::FAST;
+      num_fast_tier_dirs++;
+    }
+
     unique_ptr<DataDir> dd(new DataDir(
-        env_, metrics_.get(), fs_type, data_dir, std::move(instance),
+        env_, metrics_.get(), fs_type, tier, data_dir, std::move(instance),
         unique_ptr<ThreadPool>(pool.release())));
     dds.emplace_back(std::move(dd));
     i++;
@@ -841,6 +952,7 @@ Status DataDirManager::Open() {
   }
 
   data_dirs_.swap(dds);
+  has_fast_tier_ = num_fast_tier_dirs > 0 && num_fast_tier_dirs < data_dirs_.size();
   uuid_by_idx_.swap(uuid_by_idx);
   idx_by_uuid_.swap(idx_by_uuid);
   data_dir_by_uuid_idx_.swap(dd_by_uuid_idx);
@@ -977,14 +1089,40 @@ Status DataDirManager::GetNextDataDir(const CreateBlockOptions& opts, DataDir**
   iota(random_indices.begin(), random_indices.end(), 0);
   shuffle(random_indices.begin(), random_indices.end(), default_random_engine(rng_.Next()));
 
-  // Randomly select a member of the group that is not full.
-  for (int i : random_indices) {
-    int uuid_idx = (*group_uuid_indices)[i];
-    DataDir* candidate = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
-    Status s = candidate->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY);
-    WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", candidate->dir()));
-    if (s.ok() && !candidate->is_full()) {
-      *dir = candidate;
+  // Randomly select a member of the group that is not full. If considering
+  // I/O load, select two and take the less busy one, so a slow disk gets
+  // fewer new blocks without the others being filled strictly in order.
+  //
+  // If the dirs are tiered, only members of the requested tier are considered
+  // at first, and the rest only if none of those is available.
+  const bool consider_io_load = FLAGS_fs_data_dirs_consider_io_load;
+  const DataDirTier tier = opts.prefer_fast_tier ? DataDirTier::FAST : DataDirTier::SLOW;
+  DataDir* chosen = nullptr;
+  for (bool any_tier : { !has_fast_tier_, true }) {
+    for (int i : random_indices) {
+      int uuid_idx = (*group_uuid_indices)[i];
+      DataDir* candidate = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
+      if (!any_tier && candidate->tier() != tier) {
+        continue;
+      }
+      Status s = candidate->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY);
+      WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", candidate->dir()));
+      if (s.ok() && !candidate->is_full()) {
+        if (chosen == nullptr) {
+          chosen = candidate;
+          if (!consider_io_load) {
+            break;
+          }
+          continue;
+        }
+        if (candidate->io_load() < chosen->io_load()) {
+          chosen = candidate;
+        }
+        break;
+      }
+    }
+    if (chosen) {
+      *dir = chosen;
       return Status::OK();
     }
   }
@@ -1044,18 +1182,66 @@ void DataDirManager::GetDirsForGroupUnlocked(int target_size,
       candidate_indices.push_back(e.first);
     }
   }
-  while (group_indices->size() < target_size && !candidate_indices.empty()) {
-    shuffle(candidate_indices.begin(), candidate_indices.end(), default_random_engine(rng_.Next()));
-    if (candidate_indices.size() == 1 ||
-        FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[0]).size() <
-            FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[1]).size()) {
-      group_indices->push_back(candidate_indices[0]);
-      candidate_indices.erase(candidate_indices.begin());
-    } else {
-      group_indices->push_back(candidate_indices[1]);
-      candidate_indices.erase(candidate_indices.begin() + 1);
+
+  // Find the candidates that are much busier than the rest.
+  unordered_set<int> slow_indices;
+  if (FLAGS_fs_data_dirs_consider_io_load && candidate_indices.size() > 1) {
+    double total_load = 0;
+    for (int uuid_idx : candidate_indices) {
+      total_load += FindOrDie(data_dir_by_uuid_idx_, uuid_idx)->io_load();
+    }
+    const double slow_load = FLAGS_fs_data_dirs_slow_io_load_ratio *
+        total_load / candidate_indices.size();
+    for (int uuid_idx : candidate_indices) {
+      DataDir* dd = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
+      if (total_load > 0 && dd->io_load() > slow_load) {
+        VLOG(1) << Substitute("avoiding busy data dir $0 (I/O load $1us)",
+                              dd->dir(), dd->io_load());
+        slow_indices.insert(uuid_idx);
+      }
     }
   }
+  // Returns whether the candidate at 'a' should be picked over the one at 'b'.
+  auto is_better = [&](int a, int b) {
+    bool a_slow = ContainsKey(slow_indices, a);
+    bool b_slow = ContainsKey(slow_indices, b);
+    if (a_slow != b_slow) {
+      return b_slow;
+    }
+    return FindOrDie(tablets_by_uuid_idx_map_, a).size() <
+        FindOrDie(tablets_by_uuid_idx_map_, b).size();
+  };
+
+  // Moves up to 'num_to_pick' entries of 'candidates' to 'group_indices'.
+  auto pick = [&](int num_to_pick, vector<int>* candidates) {
+    for (int i = 0; i < num_to_pick && !candidates->empty(); i++) {
+      shuffle(candidates->begin(), candidates->end(), default_random_engine(rng_.Next()));
+      if (candidates->size() == 1 || is_better((*candidates)[0], (*candidates)[1])) {
+        group_indices->push_back((*candidates)[0]);
+        candidates->erase(candidates->begin());
+      } else {
+        group_indices->push_back((*candidates)[1]);
+        candidates->erase(candidates->begin() + 1);
+      }
+    }
+  };
+
+  // If the dirs are tiered, make room for new rowsets on the fast tier by
+  // starting the group off with one fast dir.
+  if (has_fast_tier_ && target_size > 1) {
+    vector<int> fast_indices;
+    for (int uuid_idx : candidate_indices) {
+      if (FindOrDie(data_dir_by_uuid_idx_, uuid_idx)->tier() == DataDirTier::FAST) {
+        fast_indices.push_back(uuid_idx);
+      }
+    }
+    pick(1, &fast_indices);
+    if (!group_indices->empty()) {
+      candidate_indices.erase(std::find(candidate_indices.begin(), candidate_indices.end(),
+                                        group_indices->back()));
+    }
+  }
+  pick(target_size - group_indices->size(), &candidate_indices);
 }
 
 DataDir* DataDirManager::FindDataDirByUuidIndex(int uuid_idx) const {
@@ -1093,6 +1279,15 @@ set<string> DataDirManager::FindTabletsByDataDirUuidIdx(int uuid_idx) const {
   return {};
 }
 
+vector<int> DataDirManager::FindDataDirsByTabletId(const string& tablet_id) const {
+  shared_lock<rw_spinlock> lock(dir_group_lock_.get_lock());
+  const DataDirGroup* group = FindOrNull(group_by_tablet_map_, tablet_id);
+  if (group) {
+    return group->uuid_indices();
+  }
+  return {};
+}
+
 void DataDirManager::MarkDataDirFailedByUuid(const string& uuid) {
   int uuid_idx;
   CHECK(FindUuidIndexByUuid(uuid, &uuid_idx));
@@ -31,6 +31,7 @@
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -115,6 +116,15 @@ enum class DataDirFsType {
   OTHER
 };
 
+// The storage tier a data directory belongs to.
+enum class DataDirTier {
+  // Directories on slow, cheap devices, e.g. HDDs. The default.
+  SLOW,
+
+  // Directories on fast devices, e.g. NVMe SSDs. See --fs_fast_tier_data_dirs.
+  FAST
+};
+
 // Defines the behavior of the consistency checks performed when the directory
 // manager is opened.
 enum class ConsistencyCheckBehavior {
@@ -143,6 +153,7 @@ class DataDir {
   DataDir(Env* env,
           DataDirMetrics* metrics,
           DataDirFsType fs_type,
+          DataDirTier tier,
           std::string dir,
           std::unique_ptr<PathInstanceMetadataFile> metadata_file,
           std::unique_ptr<ThreadPool> pool);
@@ -178,6 +189,8 @@ class DataDir {
 
   DataDirFsType fs_type() const { return fs_type_; }
 
+  DataDirTier tier() const { return tier_; }
+
   const std::string& dir() const { return dir_; }
 
   const PathInstanceMetadataFile* instance() const {
@@ -189,10 +202,51 @@ class DataDir {
     return is_full_;
   }
 
+  // Tracks an I/O to this dir for as long as it is in scope, counting it
+  // towards the dir's queue depth and, once done, its I/O latency.
+  class ScopedIO {
+   public:
+    explicit ScopedIO(DataDir* dir)
+        : dir_(dir),
+          start_(MonoTime::Now()) {
+      dir_->ios_in_flight_.Increment();
+    }
+
+    ~ScopedIO() {
+      dir_->ios_in_flight_.IncrementBy(-1);
+      dir_->RecordIOLatency(MonoTime::Now() - start_);
+    }
+
+   private:
+    DataDir* dir_;
+    const MonoTime start_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedIO);
+  };
+
+  // Folds the latency of a completed I/O into the dir's moving average.
+  void RecordIOLatency(MonoDelta latency);
+
+  // Returns the number of I/Os to this dir currently in flight.
+  int64_t ios_in_flight() const { return ios_in_flight_.Load(); }
+
+  // Returns the exponentially weighted moving average of the latency of
+  // recent I/Os to this dir, in microseconds. The average decays while no
+  // I/O to the dir completes (see --fs_data_dirs_io_load_half_life_ms), so
+  // that a dir avoided for being slow is eventually tried again.
+  int64_t avg_io_latency_us() const;
+
+  // Returns how busy this dir is: roughly, how long a new I/O to it can be
+  // expected to take, in microseconds. Zero if no I/O has been recorded.
+  int64_t io_load() const {
+    return avg_io_latency_us() * (ios_in_flight() + 1);
+  }
+
  private:
   Env* env_;
   DataDirMetrics* metrics_;
   const DataDirFsType fs_type_;
+  const DataDirTier tier_;
   const std::string dir_;
   const std::unique_ptr<PathInstanceMetadataFile> metadata_file_;
   const std::unique_ptr<ThreadPool> pool_;
@@ -204,6 +258,12 @@ class DataDir {
   MonoTime last_check_is_full_;
   bool is_full_;
 
+  AtomicInt<int64_t> ios_in_flight_;
+  // The moving average as of the latest recorded I/O, and the monotonic time
+  // of that I/O, in microseconds.
+  AtomicInt<int64_t> avg_io_latency_us_;
+  AtomicInt<int64_t> last_io_time_us_;
+
   DISALLOW_COPY_AND_ASSIGN(DataDir);
 };
 
@@ -233,6 +293,12 @@ struct DataDirManagerOptions {
   //
   // Defaults to ENFORCE_CONSISTENCY.
   ConsistencyCheckBehavior consistency_check;
+
+  // The data roots that belong to the fast storage tier. Each must be one of
+  // the data roots the directory manager is opened with.
+  //
+  // Defaults to the value of FLAGS_fs_fast_tier_data_dirs.
+  std::vector<std::string> fast_tier_data_roots;
 };
 
 // Encapsulates knowledge of data directory management on behalf of block
@@ -290,6 +356,9 @@ class DataDirManager {
     return data_dirs_;
   }
 
+  // Returns whether the data dirs are split into a fast and a slow tier.
+  bool has_fast_tier() const { return has_fast_tier_; }
+
   // ==========================================================================
   // Tablet Placement
   // ==========================================================================
@@ -327,14 +396,20 @@ class DataDirManager {
   // and data dir to tablet set are cleared of all references to the tablet.
   void DeleteDataDirGroup(const std::string& tablet_id);
 
-  // Returns a random directory from the specfied option's data dir group. If
-  // there is no room in the group, returns an error.
+  // Returns a random directory from the specfied option's data dir group,
+  // favoring the less busy of two if --fs_data_dirs_consider_io_load is set,
+  // and one of the tier the options ask for if the dirs are tiered. If there
+  // is no room in the group, returns an error.
   Status GetNextDataDir(const CreateBlockOptions& opts, DataDir** dir);
 
   // Finds the set of tablet_ids in the data dir specified by 'uuid_idx' and
   // returns a copy, returning an empty set if none are found.
   std::set<std::string> FindTabletsByDataDirUuidIdx(int uuid_idx) const;
 
+  // Returns the uuid indexes of the data dirs in the specified tablet's data
+  // dir group, returning an empty vector if the tablet has no group.
+  std::vector<int> FindDataDirsByTabletId(const std::string& tablet_id) const;
+
   // ==========================================================================
   // Directory Health
   // ==========================================================================
@@ -399,6 +474,7 @@ class DataDirManager {
   FRIEND_TEST(DataDirsTest, TestLoadBalancingBias);
   FRIEND_TEST(DataDirsTest, TestLoadBalancingDistribution);
   FRIEND_TEST(DataDirsTest, TestFailedDirNotAddedToGroup);
+  FRIEND_TEST(DataDirsTest, TestNewGroupsAvoidBusyDir);
 
   // Constructs a directory manager.
   DataDirManager(Env* env,
@@ -458,6 +534,12 @@ class DataDirManager {
   // The resulting behavior fills directories that have fewer tablets stored on
   // them while not completely neglecting those with more tablets.
   //
+  // If --fs_data_dirs_consider_io_load is set, directories whose I/O load is
+  // far above the average of the candidates lose to any that aren't,
+  // regardless of tablet count.
+  //
+  // If the dirs are tiered, the first directory is picked from the fast tier.
+  //
   // 'group_indices' is an output that stores the list of uuid_indices to be
   // added. Although this function does not itself change DataDirManager state,
   // its expected usage warrants that it is called within the scope of a
@@ -485,6 +567,9 @@ class DataDirManager {
 
   std::vector<std::unique_ptr<DataDir>> data_dirs_;
 
+  // Whether some, but not all, of 'data_dirs_' are in the fast tier.
+  bool has_fast_tier_;
+
   typedef std::unordered_map<std::string, std::string> UuidByRootMap;
   UuidByRootMap uuid_by_root_;
 
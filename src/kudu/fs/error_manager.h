@@ -116,6 +116,10 @@ enum ErrorHandlerType {
 
   // For CFile corruptions.
   CFILE_CORRUPTION,
+
+  // For errors which leave a single tablet replica unusable, e.g. a replicated
+  // op which can't be applied on it.
+  TABLET_FAILURE,
 };
 
 // When certain operations fail, the side effects of the error can span multiple
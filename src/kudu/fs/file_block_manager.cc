@@ -339,7 +339,10 @@ Status FileWritableBlock::Append(const Slice& data) {
 
 Status FileWritableBlock::AppendV(ArrayView<const Slice> data) {
   DCHECK(state_ == CLEAN || state_ == DIRTY) << "Invalid state: " << state_;
-  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
+  {
+    DataDir::ScopedIO io(location_.data_dir());
+    RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
+  }
   RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshIsFull(
       DataDir::RefreshMode::ALWAYS));
   state_ = DIRTY;
@@ -395,6 +398,7 @@ Status FileWritableBlock::Close(SyncMode mode) {
     VLOG(3) << "Syncing block " << id();
     if (FLAGS_enable_data_block_fsync) {
       if (block_manager_->metrics_) block_manager_->metrics_->total_disk_sync->Increment();
+      DataDir::ScopedIO io(location_.data_dir());
       sync = writer_->Sync();
     }
     if (sync.ok()) {
@@ -449,11 +453,18 @@ class FileReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
   void HandleError(const Status& s) const;
 
  private:
+  // Reads into 'results' at 'offset', bypassing the page cache if 'direct'.
+  Status DoReadV(uint64_t offset, ArrayView<Slice> results, bool direct) const;
+
   // Back pointer to the owning block manager.
   FileBlockManager* block_manager_;
 
@@ -526,9 +537,22 @@ Status FileReadableBlock::Read(uint64_t offset, Slice result) const {
 }
 
 Status FileReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const {
+  return DoReadV(offset, results, /*direct=*/false);
+}
+
+Status FileReadableBlock::ReadVDirect(uint64_t offset, ArrayView<Slice> results) const {
+  return DoReadV(offset, results, /*direct=*/true);
+}
+
+Status FileReadableBlock::DoReadV(uint64_t offset, ArrayView<Slice> results,
+                                  bool direct) const {
   DCHECK(!closed_.Load());
 
-  RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadV(offset, results));
+  if (direct) {
+    RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadVDirect(offset, results));
+  } else {
+    RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadV(offset, results));
+  }
 
   if (block_manager_->metrics_) {
     // Calculate the read amount of data
@@ -542,6 +566,13 @@ Status FileReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const
   return Status::OK();
 }
 
+Status FileReadableBlock::Prefetch(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  RETURN_NOT_OK_HANDLE_ERROR(reader_->Prefetch(offset, length));
+  return Status::OK();
+}
+
 size_t FileReadableBlock::memory_footprint() const {
   DCHECK(reader_);
   return kudu_malloc_usable_size(this) + reader_->memory_footprint();
@@ -85,6 +85,20 @@ class CountingReadableBlock : public ReadableBlock {
     return Status::OK();
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE {
+    return block_->Prefetch(offset, length);
+  }
+
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const OVERRIDE {
+    RETURN_NOT_OK(block_->ReadVDirect(offset, results));
+    size_t length = std::accumulate(results.begin(), results.end(), static_cast<size_t>(0),
+                               [&](int sum, const Slice& curr) {
+                                 return sum + curr.size();
+                               });
+    *bytes_read_ += length;
+    return Status::OK();
+  }
+
   virtual size_t memory_footprint() const OVERRIDE {
     return block_->memory_footprint();
   }
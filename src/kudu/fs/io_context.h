@@ -17,11 +17,60 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
+#include <glog/logging.h>
+
+#include "kudu/gutil/macros.h"
+
 namespace kudu {
 namespace fs {
 
+// Bounds the number of bytes that may be read ahead of time on behalf of a
+// single operation, e.g. the data blocks that a scan prefetches before it
+// gets to them.
+//
+// This class is thread-safe.
+class ReadAheadBudget {
+ public:
+  explicit ReadAheadBudget(int64_t capacity_bytes)
+      : capacity_bytes_(capacity_bytes),
+        used_bytes_(0) {
+  }
+
+  ~ReadAheadBudget() {
+    DCHECK_EQ(0, used_bytes_.load());
+  }
+
+  // Reserves 'bytes' from the budget. Returns false, reserving nothing, if
+  // that would exceed the budget's capacity.
+  bool TryReserve(int64_t bytes) {
+    int64_t used = used_bytes_.load();
+    do {
+      if (used + bytes > capacity_bytes_) {
+        return false;
+      }
+    } while (!used_bytes_.compare_exchange_weak(used, used + bytes));
+    return true;
+  }
+
+  // Returns 'bytes' previously reserved with TryReserve() to the budget.
+  void Release(int64_t bytes) {
+    int64_t prev = used_bytes_.fetch_sub(bytes);
+    DCHECK_GE(prev, bytes);
+  }
+
+  int64_t used_bytes() const { return used_bytes_.load(); }
+
+ private:
+  const int64_t capacity_bytes_;
+  std::atomic<int64_t> used_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadAheadBudget);
+};
+
 // An IOContext provides a single interface to pass state around during IO. A
 // single IOContext should correspond to a single high-level operation that
 // does IO, e.g. a scan, a tablet bootstrap, etc.
@@ -43,6 +92,10 @@ namespace fs {
 struct IOContext {
   // The tablet id associated with this IO.
   std::string tablet_id;
+
+  // The budget for reads issued ahead of time on behalf of this operation,
+  // or nullptr if nothing should be read ahead. Not owned.
+  ReadAheadBudget* read_ahead_budget;
 };
 
 }  // namespace fs
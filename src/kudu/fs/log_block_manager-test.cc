@@ -49,11 +49,13 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
@@ -79,6 +81,7 @@ DECLARE_bool(crash_on_eio);
 DECLARE_double(env_inject_eio);
 DECLARE_double(log_container_excess_space_before_cleanup_fraction);
 DECLARE_double(log_container_live_metadata_before_compact_ratio);
+DECLARE_int32(log_container_load_threads_per_data_dir);
 DECLARE_int64(block_manager_max_open_files);
 DECLARE_int64(log_container_max_blocks);
 DECLARE_string(block_manager_preflush_control);
@@ -1258,6 +1261,54 @@ TEST_F(LogBlockManagerTest, TestRepairPreallocateExcessSpace) {
   NO_FATALS(AssertEmptyReport(report));
 }
 
+// Test that loading containers in parallel at startup finds the same blocks
+// as loading them one at a time.
+TEST_F(LogBlockManagerTest, TestParallelContainerLoad) {
+  const int kNumBlocks = 200;
+  FLAGS_log_container_max_blocks = 10;
+  ASSERT_OK(ReopenBlockManager());
+
+  vector<BlockId> live_ids;
+  vector<BlockId> deleted_ids;
+  {
+    for (int i = 0; i < kNumBlocks; i++) {
+      unique_ptr<WritableBlock> block;
+      ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+      ASSERT_OK(block->Append("aaaa"));
+      ASSERT_OK(block->Close());
+      (i % 2 == 0 ? live_ids : deleted_ids).push_back(block->id());
+    }
+    shared_ptr<BlockDeletionTransaction> deletion_transaction =
+        bm_->NewDeletionTransaction();
+    for (const auto& id : deleted_ids) {
+      deletion_transaction->AddDeletedBlock(id);
+    }
+    vector<BlockId> deleted;
+    ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+    ASSERT_EQ(deleted_ids.size(), deleted.size());
+  }
+  NO_FATALS(AssertNumContainers(kNumBlocks / 10));
+
+  for (int num_threads : { 1, 8 }) {
+    SCOPED_TRACE(num_threads);
+    FLAGS_log_container_load_threads_per_data_dir = num_threads;
+    FsReport report;
+    ASSERT_OK(ReopenBlockManager(nullptr, &report));
+    ASSERT_FALSE(report.HasFatalErrors());
+    ASSERT_EQ(kNumBlocks / 10, report.stats.lbm_container_count);
+    ASSERT_EQ(live_ids.size(), report.stats.live_block_count);
+    for (const auto& id : live_ids) {
+      unique_ptr<ReadableBlock> block;
+      ASSERT_OK(bm_->OpenBlock(id, &block));
+    }
+    for (const auto& id : deleted_ids) {
+      unique_ptr<ReadableBlock> block;
+      Status s = bm_->OpenBlock(id, &block);
+      ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+    }
+  }
+}
+
 TEST_F(LogBlockManagerTest, TestRepairUnpunchedBlocks) {
   const int kNumBlocks = 100;
 
@@ -1546,6 +1597,108 @@ TEST_F(LogBlockManagerTest, TestCompactFullContainerMetadataAtStartup) {
   ASSERT_EQ(last_live_aligned_bytes, report.stats.live_block_bytes_aligned);
 }
 
+// Tests that the live blocks of a mostly dead container can be moved out of
+// it online, without changing their IDs or disturbing open readers, and that
+// a compaction interrupted before deleting the old copies is recovered from.
+TEST_F(LogBlockManagerTest, TestCompactSparseContainers) {
+  FLAGS_log_container_max_blocks = 10;
+
+  // Fill a container, and delete all but two of its blocks.
+  vector<BlockId> block_ids;
+  for (int i = 0; i < FLAGS_log_container_max_blocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append(Substitute("block $0", i)));
+    ASSERT_OK(block->Close());
+    block_ids.emplace_back(block->id());
+  }
+  int64_t sparse_containers;
+  int64_t total_containers;
+  int64_t sparse_live_bytes;
+  auto delete_blocks = [&](int begin, int end) {
+    shared_ptr<BlockDeletionTransaction> deletion_transaction =
+        bm_->NewDeletionTransaction();
+    for (int i = begin; i < end; i++) {
+      deletion_transaction->AddDeletedBlock(block_ids[i]);
+    }
+    vector<BlockId> deleted;
+    ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+  };
+  // With more than half of its blocks live, the container isn't sparse yet.
+  NO_FATALS(delete_blocks(6, block_ids.size()));
+  bm_->GetSparseContainerStats(&sparse_containers, &total_containers, &sparse_live_bytes);
+  ASSERT_EQ(0, sparse_containers);
+  ASSERT_EQ(1, total_containers);
+  NO_FATALS(delete_blocks(2, 6));
+  bm_->GetSparseContainerStats(&sparse_containers, &total_containers, &sparse_live_bytes);
+  ASSERT_EQ(1, sparse_containers);
+
+  // A container which is sparse when it's loaded is found as well.
+  ASSERT_OK(ReopenBlockManager());
+  string container;
+  NO_FATALS(GetOnlyContainer(&container));
+  const string data_file = StrCat(container, LogBlockManager::kContainerDataFileSuffix);
+  const string metadata_file = StrCat(container, LogBlockManager::kContainerMetadataFileSuffix);
+  faststring old_data;
+  faststring old_metadata;
+  ASSERT_OK(ReadFileToString(env_, data_file, &old_data));
+  ASSERT_OK(ReadFileToString(env_, metadata_file, &old_metadata));
+
+  bm_->GetSparseContainerStats(&sparse_containers, &total_containers, &sparse_live_bytes);
+  ASSERT_EQ(1, sparse_containers);
+  ASSERT_EQ(1, total_containers);
+  ASSERT_EQ(strlen("block 0") * 2, sparse_live_bytes);
+
+  // Compact the container while one of its blocks is open.
+  unique_ptr<ReadableBlock> open_block;
+  ASSERT_OK(bm_->OpenBlock(block_ids[0], &open_block));
+  int64_t containers_compacted;
+  int64_t blocks_moved;
+  ASSERT_OK(bm_->CompactSparseContainers(1024 * 1024, &containers_compacted, &blocks_moved));
+  ASSERT_EQ(1, containers_compacted);
+  ASSERT_EQ(2, blocks_moved);
+  bm_->GetSparseContainerStats(&sparse_containers, &total_containers, &sparse_live_bytes);
+  ASSERT_EQ(0, sparse_containers);
+  ASSERT_EQ(2, total_containers);
+
+  auto check_blocks = [&]() {
+    for (int i = 0; i < 2; i++) {
+      unique_ptr<ReadableBlock> block;
+      ASSERT_OK(bm_->OpenBlock(block_ids[i], &block));
+      string expected = Substitute("block $0", i);
+      uint8_t scratch[16];
+      Slice result(scratch, expected.size());
+      ASSERT_OK(block->Read(0, result));
+      ASSERT_EQ(expected, result.ToString());
+    }
+  };
+  NO_FATALS(check_blocks());
+  uint8_t scratch[16];
+  Slice result(scratch, strlen("block 0"));
+  ASSERT_OK(open_block->Read(0, result));
+  ASSERT_EQ("block 0", result.ToString());
+  ASSERT_OK(open_block->Close());
+
+  // The emptied container is deleted at startup.
+  ASSERT_OK(ReopenBlockManager());
+  NO_FATALS(AssertNumContainers(1));
+  NO_FATALS(check_blocks());
+
+  // Simulate a crash before the old copies were deleted by restoring the old
+  // container. Both copies of each block are found at startup, but only one
+  // is kept; the other is deleted.
+  bm_.reset();
+  ASSERT_OK(WriteStringToFile(env_, old_data, data_file));
+  ASSERT_OK(WriteStringToFile(env_, old_metadata, metadata_file));
+  FsReport report;
+  ASSERT_OK(ReopenBlockManager(nullptr, &report));
+  ASSERT_EQ(4, report.stats.live_block_count);
+  NO_FATALS(check_blocks());
+  ASSERT_OK(ReopenBlockManager(nullptr, &report));
+  ASSERT_EQ(2, report.stats.live_block_count);
+  NO_FATALS(check_blocks());
+}
+
 // Regression test for a bug in which, after a metadata file was compacted,
 // we would not properly handle appending to the new (post-compaction) metadata.
 //
@@ -47,6 +47,7 @@
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stl_util.h"
@@ -59,6 +60,7 @@
 #include "kudu/util/alignment.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/file_cache.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
@@ -73,6 +75,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/sorted_disjoint_interval_list.h"
 #include "kudu/util/test_util_prod.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DECLARE_bool(enable_data_block_fsync);
@@ -107,6 +110,11 @@ DEFINE_double(log_container_live_metadata_before_compact_ratio, 0.50,
               "the container's metadata file will be compacted at startup.");
 TAG_FLAG(log_container_live_metadata_before_compact_ratio, experimental);
 
+DEFINE_int32(log_container_load_threads_per_data_dir, 4,
+             "Number of threads used to load the log containers of each data "
+             "directory at block manager startup.");
+TAG_FLAG(log_container_load_threads_per_data_dir, advanced);
+
 DEFINE_bool(log_block_manager_test_hole_punching, true,
             "Ensure hole punching is supported by the underlying filesystem");
 TAG_FLAG(log_block_manager_test_hole_punching, advanced);
@@ -245,6 +253,13 @@ class LogBlock : public RefCountedThreadSafe<LogBlock> {
   // The block deletion transaction with which this block has been registered.
   shared_ptr<LogBlockDeletionTransaction> transaction_;
 
+  // Links in the container's list of the blocks that are in the block map.
+  // Protected by the block manager's lock.
+  LogBlock* prev_in_container_;
+  LogBlock* next_in_container_;
+
+  friend class LogBlockContainer;
+
   DISALLOW_COPY_AND_ASSIGN(LogBlock);
 };
 
@@ -258,8 +273,14 @@ class LogBlock : public RefCountedThreadSafe<LogBlock> {
 // persisted.
 class LogWritableBlock : public WritableBlock {
  public:
+  // If 'relocated_block' is set, the new block is a copy of it, written by
+  // container compaction. Closing the block replaces 'relocated_block' with
+  // the copy, registering whichever copy is dropped with
+  // 'relocation_transaction'; aborting it leaves 'relocated_block' be.
   LogWritableBlock(LogBlockContainer* container, BlockId block_id,
-                   int64_t block_offset);
+                   int64_t block_offset,
+                   scoped_refptr<LogBlock> relocated_block = nullptr,
+                   shared_ptr<LogBlockDeletionTransaction> relocation_transaction = nullptr);
 
   virtual ~LogWritableBlock();
 
@@ -316,6 +337,10 @@ class LogWritableBlock : public WritableBlock {
   // for example, has it been synchronized to disk?
   WritableBlock::State state_;
 
+  // The block that this block is a copy of, if any.
+  scoped_refptr<LogBlock> relocated_block_;
+  shared_ptr<LogBlockDeletionTransaction> relocation_transaction_;
+
   DISALLOW_COPY_AND_ASSIGN(LogWritableBlock);
 };
 
@@ -397,6 +422,13 @@ class LogBlockContainer {
   // See RWFile::ReadV().
   Status ReadVData(int64_t offset, ArrayView<Slice> results) const;
 
+  // Starts reading 'length' bytes of the data file from 'offset' in the
+  // background. See ReadableBlock::Prefetch().
+  Status PrefetchData(int64_t offset, size_t length) const;
+
+  // See RWFile::ReadVDirect().
+  Status ReadVDataDirect(int64_t offset, ArrayView<Slice> results) const;
+
   // Appends 'pb' to this container's metadata file.
   //
   // The on-disk effects of this call are made durable only after SyncMetadata().
@@ -469,6 +501,25 @@ class LogBlockContainer {
   // Note: the container is not made "unfull"; containers remain sparse until deleted.
   void BlockDeleted(const scoped_refptr<LogBlock>& block);
 
+  // Adds 'block' to, or removes it from, the container's list of the blocks
+  // that are in the block manager's block map. Must hold the block manager's
+  // lock.
+  void IndexBlock(LogBlock* block);
+  void UnindexBlock(LogBlock* block);
+
+  // Returns the container's blocks that are in the block manager's block
+  // map. Must hold the block manager's lock.
+  vector<scoped_refptr<LogBlock>> IndexedBlocks() const;
+
+  // Called once the container is added to the block manager. From then on,
+  // the container registers itself with the block manager when it becomes
+  // sparse. See LogBlockManager::sparse_containers_.
+  void StartSparseTracking();
+
+  // Called by the block manager when it stops considering the container
+  // sparse, so that it registers itself again if it becomes sparse again.
+  void ClearSparseRegistration() { registered_sparse_.Store(false); }
+
   // Finalizes a fully written block. It updates the container data file's position,
   // truncates the container if full and marks the container as available.
   void FinalizeBlock(int64_t block_offset, int64_t block_length);
@@ -512,6 +563,19 @@ class LogBlockContainer {
     return next_block_offset() >= FLAGS_log_container_max_size ||
         (max_num_blocks_ && (total_blocks() >= max_num_blocks_));
   }
+  // Whether the container is full but mostly dead, such that its live blocks
+  // should be rewritten elsewhere. Uses the same thresholds as the metadata
+  // compaction and excess space cleanup done at startup.
+  bool sparse() const {
+    if (!full() || read_only() || live_blocks() == 0) {
+      return false;
+    }
+    int64_t dead_bytes = total_bytes() - live_bytes_aligned();
+    return static_cast<double>(live_blocks()) / total_blocks() <=
+        FLAGS_log_container_live_metadata_before_compact_ratio &&
+        dead_bytes > live_bytes_aligned() *
+        FLAGS_log_container_excess_space_before_cleanup_fraction;
+  }
   const LogBlockManagerMetrics* metrics() const { return metrics_; }
   DataDir* data_dir() const { return data_dir_; }
   const PathInstanceMetadataPB* instance() const { return data_dir_->instance()->metadata(); }
@@ -596,6 +660,19 @@ class LogBlockContainer {
   mutable simple_spinlock read_only_lock_;
   Status read_only_status_;
 
+  // The head of the list of the container's blocks that are in the block
+  // manager's block map. Protected by the block manager's lock.
+  LogBlock* indexed_blocks_head_;
+
+  // Whether the container has been added to the block manager, and whether
+  // it is registered as sparse with it.
+  AtomicBool sparse_tracking_;
+  AtomicBool registered_sparse_;
+
+  // Registers the container with the block manager if it is tracked and has
+  // become sparse.
+  void MaybeRegisterSparse();
+
   DISALLOW_COPY_AND_ASSIGN(LogBlockContainer);
 };
 
@@ -616,7 +693,10 @@ LogBlockContainer::LogBlockContainer(
       live_bytes_(0),
       live_bytes_aligned_(0),
       live_blocks_(0),
-      metrics_(block_manager->metrics()) {
+      metrics_(block_manager->metrics()),
+      indexed_blocks_head_(nullptr),
+      sparse_tracking_(false),
+      registered_sparse_(false) {
 }
 
 void LogBlockContainer::HandleError(const Status& s) const {
@@ -969,7 +1049,10 @@ Status LogBlockContainer::WriteVData(int64_t offset, ArrayView<const Slice> data
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   DCHECK_GE(offset, next_block_offset());
 
-  RETURN_NOT_OK_HANDLE_ERROR(data_file_->WriteV(offset, data));
+  {
+    DataDir::ScopedIO io(data_dir_);
+    RETURN_NOT_OK_HANDLE_ERROR(data_file_->WriteV(offset, data));
+  }
 
   // This append may have changed the container size if:
   // 1. It was large enough that it blew out the preallocated space.
@@ -986,15 +1069,30 @@ Status LogBlockContainer::WriteVData(int64_t offset, ArrayView<const Slice> data
 
 Status LogBlockContainer::ReadData(int64_t offset, Slice result) const {
   DCHECK_GE(offset, 0);
+  DataDir::ScopedIO io(data_dir_);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->Read(offset, result));
   return Status::OK();
 }
 Status LogBlockContainer::ReadVData(int64_t offset, ArrayView<Slice> results) const {
   DCHECK_GE(offset, 0);
+  DataDir::ScopedIO io(data_dir_);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->ReadV(offset, results));
   return Status::OK();
 }
 
+Status LogBlockContainer::PrefetchData(int64_t offset, size_t length) const {
+  DCHECK_GE(offset, 0);
+  RETURN_NOT_OK_HANDLE_ERROR(data_file_->Prefetch(offset, length));
+  return Status::OK();
+}
+
+Status LogBlockContainer::ReadVDataDirect(int64_t offset, ArrayView<Slice> results) const {
+  DCHECK_GE(offset, 0);
+  DataDir::ScopedIO io(data_dir_);
+  RETURN_NOT_OK_HANDLE_ERROR(data_file_->ReadVDirect(offset, results));
+  return Status::OK();
+}
+
 Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   // Note: We don't check for sufficient disk space for metadata writes in
@@ -1021,6 +1119,7 @@ Status LogBlockContainer::SyncData() {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   if (FLAGS_enable_data_block_fsync) {
     if (metrics_) metrics_->generic_metrics.total_disk_sync->Increment();
+    DataDir::ScopedIO io(data_dir_);
     RETURN_NOT_OK_HANDLE_ERROR(data_file_->Sync());
   }
   return Status::OK();
@@ -1135,6 +1234,59 @@ void LogBlockContainer::BlockDeleted(const scoped_refptr<LogBlock>& block) {
   live_bytes_.IncrementBy(-block->length());
   live_bytes_aligned_.IncrementBy(-block->fs_aligned_length());
   live_blocks_.IncrementBy(-1);
+  MaybeRegisterSparse();
+}
+
+void LogBlockContainer::IndexBlock(LogBlock* block) {
+  DCHECK(block_manager_->lock_.is_locked());
+  DCHECK_EQ(this, block->container());
+  block->prev_in_container_ = nullptr;
+  block->next_in_container_ = indexed_blocks_head_;
+  if (indexed_blocks_head_) {
+    indexed_blocks_head_->prev_in_container_ = block;
+  }
+  indexed_blocks_head_ = block;
+}
+
+void LogBlockContainer::UnindexBlock(LogBlock* block) {
+  DCHECK(block_manager_->lock_.is_locked());
+  DCHECK_EQ(this, block->container());
+  if (block->prev_in_container_) {
+    block->prev_in_container_->next_in_container_ = block->next_in_container_;
+  } else {
+    DCHECK_EQ(indexed_blocks_head_, block);
+    indexed_blocks_head_ = block->next_in_container_;
+  }
+  if (block->next_in_container_) {
+    block->next_in_container_->prev_in_container_ = block->prev_in_container_;
+  }
+  block->prev_in_container_ = nullptr;
+  block->next_in_container_ = nullptr;
+}
+
+vector<scoped_refptr<LogBlock>> LogBlockContainer::IndexedBlocks() const {
+  DCHECK(block_manager_->lock_.is_locked());
+  vector<scoped_refptr<LogBlock>> blocks;
+  blocks.reserve(live_blocks());
+  for (LogBlock* b = indexed_blocks_head_; b != nullptr; b = b->next_in_container_) {
+    blocks.emplace_back(b);
+  }
+  return blocks;
+}
+
+void LogBlockContainer::StartSparseTracking() {
+  sparse_tracking_.Store(true);
+  MaybeRegisterSparse();
+}
+
+void LogBlockContainer::MaybeRegisterSparse() {
+  // Only a deletion can make a full container sparse, and deletions are
+  // frequent: check the cheap flags first.
+  if (!sparse_tracking_.Load() || registered_sparse_.Load() || !sparse()) {
+    return;
+  }
+  registered_sparse_.Store(true);
+  block_manager_->AddSparseContainer(this);
 }
 
 void LogBlockContainer::ExecClosure(const Closure& task) {
@@ -1316,7 +1468,9 @@ LogBlock::LogBlock(LogBlockContainer* container, BlockId block_id,
     : container_(container),
       block_id_(block_id),
       offset_(offset),
-      length_(length) {
+      length_(length),
+      prev_in_container_(nullptr),
+      next_in_container_(nullptr) {
   DCHECK_GE(offset, 0);
   DCHECK_GE(length, 0);
 }
@@ -1352,12 +1506,16 @@ void LogBlock::RegisterDeletion(
 ////////////////////////////////////////////////////////////
 
 LogWritableBlock::LogWritableBlock(LogBlockContainer* container,
-                                   BlockId block_id, int64_t block_offset)
+                                   BlockId block_id, int64_t block_offset,
+                                   scoped_refptr<LogBlock> relocated_block,
+                                   shared_ptr<LogBlockDeletionTransaction> relocation_transaction)
     : container_(container),
       block_id_(block_id),
       block_offset_(block_offset),
       block_length_(0),
-      state_(CLEAN) {
+      state_(CLEAN),
+      relocated_block_(std::move(relocated_block)),
+      relocation_transaction_(std::move(relocation_transaction)) {
   DCHECK_GE(block_offset, 0);
   DCHECK_EQ(0, block_offset % container->instance()->filesystem_block_size_bytes());
   if (container->metrics()) {
@@ -1392,6 +1550,21 @@ Status LogWritableBlock::Abort() {
         Substitute("container $0 is read-only", container_->ToString()));
   }
 
+  // Deleting a relocated block would delete the original too. As nothing was
+  // recorded for the copy, it's enough to give its space up.
+  if (relocated_block_) {
+    if (state_ == CLEAN || state_ == DIRTY) {
+      container_->FinalizeBlock(block_offset_, block_length_);
+    }
+    state_ = CLOSED;
+    if (container_->metrics()) {
+      container_->metrics()->generic_metrics.blocks_open_writing->Decrement();
+      container_->metrics()->generic_metrics.total_bytes_written->IncrementBy(
+          block_length_);
+    }
+    return Status::OK();
+  }
+
   // Close the block and then delete it. Theoretically, we could do nothing
   // for Abort() other than updating metrics and block state. Here is the
   // reasoning why it would be safe to do so. Currently, failures in block
@@ -1524,6 +1697,15 @@ void LogWritableBlock::DoClose() {
     container_->FinalizeBlock(block_offset_, block_length_);
   }
 
+  if (relocated_block_) {
+    container_->block_manager()->FinishBlockRelocation(
+        std::move(relocated_block_), container_, block_offset_, block_length_,
+        relocation_transaction_);
+    relocation_transaction_.reset();
+    state_ = CLOSED;
+    return;
+  }
+
   scoped_refptr<LogBlock> lb = container_->block_manager()->AddLogBlock(
       container_, block_id_, block_offset_, block_length_);
   CHECK(lb);
@@ -1538,6 +1720,9 @@ Status LogWritableBlock::AppendMetadata() {
   record.set_timestamp_us(GetCurrentTimeMicros());
   record.set_offset(block_offset_);
   record.set_length(block_length_);
+  if (relocated_block_) {
+    record.set_relocated(true);
+  }
   return container_->AppendMetadata(record);
 }
 
@@ -1567,9 +1752,16 @@ class LogReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
+  // Reads into 'results' at 'offset', bypassing the page cache if 'direct'.
+  Status DoReadV(uint64_t offset, ArrayView<Slice> results, bool direct) const;
+
   // The owning container. Must outlive this block.
   LogBlockContainer* container_;
 
@@ -1630,6 +1822,15 @@ Status LogReadableBlock::Read(uint64_t offset, Slice result) const {
 }
 
 Status LogReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const {
+  return DoReadV(offset, results, /*direct=*/false);
+}
+
+Status LogReadableBlock::ReadVDirect(uint64_t offset, ArrayView<Slice> results) const {
+  return DoReadV(offset, results, /*direct=*/true);
+}
+
+Status LogReadableBlock::DoReadV(uint64_t offset, ArrayView<Slice> results,
+                                 bool direct) const {
   DCHECK(!closed_.Load());
 
   size_t read_length = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
@@ -1648,7 +1849,11 @@ Status LogReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const
   }
 
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
-  RETURN_NOT_OK(container_->ReadVData(read_offset, results));
+  if (direct) {
+    RETURN_NOT_OK(container_->ReadVDataDirect(read_offset, results));
+  } else {
+    RETURN_NOT_OK(container_->ReadVData(read_offset, results));
+  }
   MicrosecondsInt64 end_time = GetMonoTimeMicros();
 
   int64_t dur = end_time - start_time;
@@ -1663,6 +1868,21 @@ Status LogReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const
   return Status::OK();
 }
 
+Status LogReadableBlock::Prefetch(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  uint64_t prefetch_offset = log_block_->offset() + offset;
+  if (log_block_->length() < offset + length) {
+    return Status::IOError("Out-of-bounds prefetch",
+                           Substitute("prefetch of [$0-$1) in block [$2-$3)",
+                                      prefetch_offset,
+                                      prefetch_offset + length,
+                                      log_block_->offset(),
+                                      log_block_->offset() + log_block_->length()));
+  }
+  return container_->PrefetchData(prefetch_offset, length);
+}
+
 size_t LogReadableBlock::memory_footprint() const {
   return kudu_malloc_usable_size(this);
 }
@@ -1830,6 +2050,12 @@ Status LogBlockManager::Open(FsReport* report) {
         dd_manager_->data_dirs()[i]->dir(), s.ToString());
   }
 
+  {
+    // The relocated block IDs are only needed to reconcile duplicate blocks.
+    std::lock_guard<simple_spinlock> l(lock_);
+    relocated_block_ids_.clear();
+  }
+
   // Either return or log the report.
   if (report) {
     *report = std::move(merged_report);
@@ -1916,6 +2142,7 @@ void LogBlockManager::AddNewContainerUnlocked(LogBlockContainer* container) {
       metrics()->full_containers->Increment();
     }
   }
+  container->StartSparseTracking();
 }
 
 void LogBlockManager::RemoveFullContainerUnlocked(const string& container_name) {
@@ -1925,6 +2152,10 @@ void LogBlockManager::RemoveFullContainerUnlocked(const string& container_name)
   CHECK(to_delete);
   CHECK(to_delete->full())
       << Substitute("Container $0 is not full", container_name);
+  {
+    std::lock_guard<simple_spinlock> l(sparse_lock_);
+    sparse_containers_.erase(to_delete.get());
+  }
   if (metrics()) {
     metrics()->containers->Decrement();
     metrics()->full_containers->Decrement();
@@ -1936,7 +2167,11 @@ Status LogBlockManager::GetOrCreateContainer(const CreateBlockOptions& opts,
   DataDir* dir;
   RETURN_NOT_OK_EVAL(dd_manager_->GetNextDataDir(opts, &dir),
       error_manager_->RunErrorNotificationCb(ErrorHandlerType::NO_AVAILABLE_DISKS, opts.tablet_id));
+  return GetOrCreateContainerInDir(dir, container);
+}
 
+Status LogBlockManager::GetOrCreateContainerInDir(DataDir* dir,
+                                                  LogBlockContainer** container) {
   {
     std::lock_guard<simple_spinlock> l(lock_);
     auto& d = available_containers_by_data_dir_[DCHECK_NOTNULL(dir)];
@@ -1952,8 +2187,8 @@ Status LogBlockManager::GetOrCreateContainer(const CreateBlockOptions& opts,
   Status s = LogBlockContainer::Create(this, dir, &new_container);
 
   // We could create a container in a different directory, but there's
-  // currently no point in doing so. On disk failure, the tablet specified by
-  // 'opts' will be shut down, so the returned container would not be used.
+  // currently no point in doing so. On disk failure, the tablets in 'dir'
+  // will be shut down, so the returned container would not be used.
   HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(ErrorHandlerType::DISK_ERROR, dir));
   RETURN_NOT_OK_PREPEND(s, "Could not create new log block container at " + dir->dir());
   {
@@ -2052,6 +2287,7 @@ bool LogBlockManager::AddLogBlockUnlocked(scoped_refptr<LogBlock> lb) {
   // There may already be an entry in open_block_ids_ (e.g. we just finished
   // writing out a block).
   open_block_ids_.erase(lb->block_id());
+  lb->container()->IndexBlock(lb.get());
   if (metrics()) {
     metrics()->blocks_under_management->Increment();
     metrics()->bytes_under_management->IncrementBy(lb->length());
@@ -2150,12 +2386,459 @@ Status LogBlockManager::RemoveLogBlockUnlocked(const BlockId& block_id,
   }
   *lb = std::move(it->second);
   blocks_by_block_id_.erase(it);
+  container->UnindexBlock(lb->get());
 
   VLOG(2) << Substitute("Removed block: id $0, offset $1, length $2",
                         (*lb)->block_id().ToString(), (*lb)->offset(), (*lb)->length());
   return Status::OK();
 }
 
+void LogBlockManager::FinishBlockRelocation(
+    scoped_refptr<LogBlock> old_block,
+    LogBlockContainer* container,
+    int64_t offset,
+    int64_t length,
+    const shared_ptr<LogBlockDeletionTransaction>& transaction) {
+  scoped_refptr<LogBlock> new_block(new LogBlock(
+      container, old_block->block_id(), offset, length));
+  container->BlockCreated(new_block);
+
+  // Swap the copy into the block map, unless the block was deleted while it
+  // was being copied.
+  bool replaced = false;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto it = blocks_by_block_id_.find(old_block->block_id());
+    if (it != blocks_by_block_id_.end() && it->second == old_block) {
+      old_block->container()->UnindexBlock(old_block.get());
+      container->IndexBlock(new_block.get());
+      it->second = new_block;
+      replaced = true;
+    }
+  }
+  if (replaced) {
+    mem_tracker_->Consume(kudu_malloc_usable_size(new_block.get()));
+    mem_tracker_->Release(kudu_malloc_usable_size(old_block.get()));
+  }
+  VLOG(3) << Substitute("$0 block $1 from container $2 to container $3",
+                        replaced ? "Relocated" : "Did not relocate",
+                        old_block->block_id().ToString(),
+                        old_block->container()->ToString(), container->ToString());
+
+  // Whichever copy isn't in the block map is deleted once its last reader is
+  // done with it. If the block itself was deleted, the old copy has already
+  // been taken care of.
+  scoped_refptr<LogBlock> dead_block = replaced ? std::move(old_block) : std::move(new_block);
+  dead_block->container()->BlockDeleted(dead_block);
+  BlockRecordPB record;
+  dead_block->block_id().CopyToPB(record.mutable_block_id());
+  record.set_op_type(DELETE);
+  record.set_timestamp_us(GetCurrentTimeMicros());
+  Status s = dead_block->container()->AppendMetadata(record);
+  if (!s.ok()) {
+    // The block is left with two live copies, which will be reconciled at
+    // startup; neither may be punched out.
+    WARN_NOT_OK(s, Substitute("Unable to append deletion record for copy of block $0",
+                              dead_block->block_id().ToString()));
+    return;
+  }
+  dead_block->RegisterDeletion(transaction);
+  transaction->AddBlock(dead_block);
+}
+
+void LogBlockManager::GetSparseContainerStats(int64_t* sparse_containers,
+                                              int64_t* total_containers,
+                                              int64_t* sparse_live_bytes) {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    *total_containers = all_containers_by_name_.size();
+  }
+  vector<LogBlockContainer*> containers = GetSparseContainers();
+  *sparse_containers = containers.size();
+  *sparse_live_bytes = 0;
+  for (const LogBlockContainer* c : containers) {
+    *sparse_live_bytes += c->live_bytes();
+  }
+}
+
+void LogBlockManager::AddSparseContainer(LogBlockContainer* container) {
+  VLOG(1) << Substitute("Container $0 is now sparse", container->ToString());
+  std::lock_guard<simple_spinlock> l(sparse_lock_);
+  sparse_containers_.insert(container);
+}
+
+vector<LogBlockContainer*> LogBlockManager::GetSparseContainers() {
+  vector<LogBlockContainer*> containers;
+  std::lock_guard<simple_spinlock> l(sparse_lock_);
+  for (auto it = sparse_containers_.begin(); it != sparse_containers_.end();) {
+    LogBlockContainer* c = *it;
+    if (c->sparse()) {
+      containers.push_back(c);
+      ++it;
+    } else {
+      // The container registers itself again if a deletion makes it sparse
+      // again, e.g. once the thresholds are lowered.
+      c->ClearSparseRegistration();
+      it = sparse_containers_.erase(it);
+    }
+  }
+  return containers;
+}
+
+Status LogBlockManager::CompactSparseContainers(int64_t max_bytes_to_move,
+                                                int64_t* containers_compacted,
+                                                int64_t* blocks_moved) {
+  CHECK(!opts_.read_only);
+  *containers_compacted = 0;
+  *blocks_moved = 0;
+  std::unique_lock<std::mutex> compaction_lock(compaction_lock_, std::try_to_lock);
+  if (!compaction_lock.owns_lock()) {
+    return Status::OK();
+  }
+
+  // Pick the sparsest containers, up to 'max_bytes_to_move' of live data.
+  vector<LogBlockContainer*> containers;
+  unordered_map<LogBlockContainer*, vector<scoped_refptr<LogBlock>>> blocks_by_container;
+  {
+    set<int> failed_dirs = dd_manager_->GetFailedDataDirs();
+    containers = GetSparseContainers();
+    containers.erase(std::remove_if(containers.begin(), containers.end(),
+                                    [&](const LogBlockContainer* c) {
+                                      int uuid_idx;
+                                      return !dd_manager_->FindUuidIndexByDataDir(
+                                          c->data_dir(), &uuid_idx) ||
+                                          ContainsKey(failed_dirs, uuid_idx);
+                                    }),
+                     containers.end());
+    std::sort(containers.begin(), containers.end(),
+              [](const LogBlockContainer* a, const LogBlockContainer* b) {
+                return static_cast<double>(a->live_bytes()) / a->total_bytes() <
+                       static_cast<double>(b->live_bytes()) / b->total_bytes();
+              });
+    int64_t bytes_to_move = 0;
+    int num_picked = 0;
+    for (; num_picked < containers.size(); num_picked++) {
+      int64_t live_bytes = containers[num_picked]->live_bytes();
+      if (num_picked > 0 && bytes_to_move + live_bytes > max_bytes_to_move) {
+        break;
+      }
+      bytes_to_move += live_bytes;
+    }
+    containers.resize(num_picked);
+    if (containers.empty()) {
+      return Status::OK();
+    }
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (LogBlockContainer* c : containers) {
+      blocks_by_container[c] = c->IndexedBlocks();
+    }
+  }
+
+  for (LogBlockContainer* c : containers) {
+    auto& blocks = FindOrDie(blocks_by_container, c);
+    RETURN_NOT_OK_PREPEND(CompactContainer(c, std::move(blocks), blocks_moved),
+                          Substitute("could not compact container $0", c->ToString()));
+    (*containers_compacted)++;
+  }
+  return Status::OK();
+}
+
+Status LogBlockManager::CompactContainer(LogBlockContainer* container,
+                                         vector<scoped_refptr<LogBlock>> blocks,
+                                         int64_t* blocks_moved) {
+  // Copy the blocks in on-disk order.
+  std::sort(blocks.begin(), blocks.end(),
+            [](const scoped_refptr<LogBlock>& a, const scoped_refptr<LogBlock>& b) {
+              return a->offset() < b->offset();
+            });
+  VLOG(1) << Substitute("Compacting container $0: moving $1 live blocks",
+                        container->ToString(), blocks.size());
+
+  // The dropped copies may only be punched out once their DELETE records are
+  // durable: until then, a crash would leave the block with two live copies,
+  // either of which may be chosen at startup.
+  auto transaction = std::make_shared<LogBlockDeletionTransaction>(this);
+  unordered_set<LogBlockContainer*> touched_containers = { container };
+  SCOPED_CLEANUP({
+    for (LogBlockContainer* c : touched_containers) {
+      WARN_NOT_OK(c->SyncMetadata(), Substitute("could not sync metadata of container $0",
+                                                c->ToString()));
+    }
+  });
+
+  unordered_map<LogBlockContainer*, vector<unique_ptr<LogWritableBlock>>> new_blocks;
+  faststring buf;
+  for (auto& lb : blocks) {
+    buf.resize(lb->length());
+    Slice data(buf.data(), buf.size());
+    RETURN_NOT_OK(container->ReadData(lb->offset(), data));
+
+    LogBlockContainer* dest;
+    RETURN_NOT_OK(GetOrCreateContainerInDir(container->data_dir(), &dest));
+    touched_containers.insert(dest);
+    const BlockId block_id = lb->block_id();
+    unique_ptr<LogWritableBlock> wb(new LogWritableBlock(
+        dest, block_id, dest->next_block_offset(), std::move(lb), transaction));
+    RETURN_NOT_OK_PREPEND(wb->Append(data),
+                          Substitute("could not copy block $0", block_id.ToString()));
+    RETURN_NOT_OK_PREPEND(wb->Finalize(),
+                          Substitute("could not copy block $0", block_id.ToString()));
+    new_blocks[dest].emplace_back(std::move(wb));
+  }
+
+  for (auto& e : new_blocks) {
+    vector<LogWritableBlock*> to_close;
+    for (const auto& wb : e.second) {
+      to_close.push_back(wb.get());
+    }
+    RETURN_NOT_OK(e.first->DoCloseBlocks(to_close, LogBlockContainer::SyncMode::SYNC));
+    *blocks_moved += to_close.size();
+  }
+  return Status::OK();
+}
+
+// The results of loading a single container, to be merged into those of its
+// data directory once all of the directory's containers have been loaded.
+struct LogBlockManager::ContainerLoadResult {
+  Status status;
+  FsReport report;
+  vector<scoped_refptr<internal::LogBlock>> need_repunching;
+  vector<scoped_refptr<internal::LogBlock>> relocation_duplicates;
+  vector<string> dead_containers;
+  unordered_map<string, vector<BlockRecordPB>> low_live_block_containers;
+};
+
+void LogBlockManager::LoadContainer(DataDir* dir,
+                                    const string& container_name,
+                                    AtomicInt<int64_t>* num_containers_loaded,
+                                    ContainerLoadResult* result) {
+  // We are going to perform the same checks as OpenDataDir().
+  result->report.full_container_space_check.emplace();
+  result->report.incomplete_container_check.emplace();
+  result->report.malformed_record_check.emplace();
+  result->report.misaligned_block_check.emplace();
+  result->report.partial_record_check.emplace();
+
+  unique_ptr<LogBlockContainer> container;
+  Status s = LogBlockContainer::Open(
+      this, dir, &result->report, container_name, &container);
+  if (s.IsAborted()) {
+    // Skip the container. Open() added a record of it to the report for us.
+    return;
+  }
+  if (!s.ok()) {
+    result->status = s.CloneAndPrepend(Substitute(
+        "Could not open container $0", container_name));
+    return;
+  }
+
+  // Process the records, building a container-local map for live blocks and
+  // a list of dead blocks.
+  //
+  // It's important that we don't try to add these blocks to the global map
+  // incrementally as we see each record, since it's possible that one container
+  // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
+  // If we processed those two containers in this order, then upon processing
+  // the second container, we'd think there was a duplicate block. Building
+  // the container-local map first ensures that we discount deleted blocks
+  // before checking for duplicate IDs.
+  //
+  // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
+  // exceedingly unlikely. However, we might have old data which still exhibits
+  // the above issue.
+  UntrackedBlockMap live_blocks;
+  BlockRecordMap live_block_records;
+  vector<scoped_refptr<internal::LogBlock>> dead_blocks;
+  uint64_t max_block_id = 0;
+  s = container->ProcessRecords(&result->report,
+                                &live_blocks,
+                                &live_block_records,
+                                &dead_blocks,
+                                &max_block_id);
+  if (!s.ok()) {
+    result->status = s.CloneAndPrepend(Substitute(
+        "Could not process records in container $0", container->ToString()));
+    return;
+  }
+  vector<BlockId> relocated_block_ids;
+  for (const auto& e : live_block_records) {
+    if (e.second.relocated()) {
+      relocated_block_ids.push_back(e.first);
+    }
+  }
+
+  // With deleted blocks out of the way, check for misaligned blocks.
+  //
+  // We could also enforce that the record's offset is aligned with the
+  // underlying filesystem's block size, an invariant maintained by the log
+  // block manager. However, due to KUDU-1793, that invariant may have been
+  // broken, so we'll note but otherwise allow it.
+  for (const auto& e : live_blocks) {
+    if (PREDICT_FALSE(e.second->offset() %
+                      container->instance()->filesystem_block_size_bytes() != 0)) {
+      result->report.misaligned_block_check->entries.emplace_back(
+          container->ToString(), e.first);
+
+    }
+  }
+
+  if (container->full()) {
+    // Full containers without any live blocks can be deleted outright.
+    //
+    // TODO(adar): this should be reported as an inconsistency once dead
+    // container deletion is also done in real time. Until then, it would be
+    // confusing to report it as such since it'll be a natural event at startup.
+    if (container->live_blocks() == 0) {
+      DCHECK(live_blocks.empty());
+      result->dead_containers.emplace_back(container->ToString());
+    } else if (static_cast<double>(container->live_blocks()) /
+        container->total_blocks() <= FLAGS_log_container_live_metadata_before_compact_ratio) {
+      // Metadata files of containers with very few live blocks will be compacted.
+      //
+      // TODO(adar): this should be reported as an inconsistency once
+      // container metadata compaction is also done in realtime. Until then,
+      // it would be confusing to report it as such since it'll be a natural
+      // event at startup.
+      vector<BlockRecordPB> records(live_block_records.size());
+      int i = 0;
+      for (auto& e : live_block_records) {
+        records[i].Swap(&e.second);
+        i++;
+      }
+
+      // Sort the records such that their ordering reflects the ordering in
+      // the pre-compacted metadata file.
+      //
+      // This is preferred to storing the records in an order-preserving
+      // container (such as std::map) because while records are temporarily
+      // retained for every container, only some containers will actually
+      // undergo metadata compaction.
+      std::sort(records.begin(), records.end(),
+                [](const BlockRecordPB& a, const BlockRecordPB& b) {
+        // Sort by timestamp.
+        if (a.timestamp_us() != b.timestamp_us()) {
+          return a.timestamp_us() < b.timestamp_us();
+        }
+
+        // If the timestamps match, sort by offset.
+        //
+        // If the offsets also match (i.e. both blocks are of zero length),
+        // it doesn't matter which of the two records comes first.
+        return a.offset() < b.offset();
+      });
+
+      result->low_live_block_containers[container->ToString()] = std::move(records);
+    }
+
+    // Having processed the block records, let's check whether any full
+    // containers have any extra space (left behind after a crash or from an
+    // older version of Kudu).
+    //
+    // Filesystems are unpredictable beasts and may misreport the amount of
+    // space allocated to a file in various interesting ways. Some examples:
+    // - XFS's speculative preallocation feature may artificially enlarge the
+    //   container's data file without updating its file size. This makes the
+    //   file size untrustworthy for the purposes of measuring allocated space.
+    //   See KUDU-1856 for more details.
+    // - On el6.6/ext4 a container data file that consumed ~32K according to
+    //   its extent tree was actually reported as consuming an additional fs
+    //   block (2k) of disk space. A similar container data file (generated
+    //   via the same workload) on Ubuntu 16.04/ext4 did not exhibit this.
+    //   The suspicion is that older versions of ext4 include interior nodes
+    //   of the extent tree when reporting file block usage.
+    //
+    // To deal with these issues, our extra space cleanup code (deleted block
+    // repunching and container truncation) is gated on an "actual disk space
+    // consumed" heuristic. To prevent unnecessary triggering of the
+    // heuristic, we allow for some slop in our size measurements. The exact
+    // amount of slop is configurable via
+    // log_container_excess_space_before_cleanup_fraction.
+    //
+    // Too little slop and we'll do unnecessary work at startup. Too much and
+    // more unused space may go unreclaimed.
+    string data_filename = StrCat(container->ToString(), kContainerDataFileSuffix);
+    uint64_t reported_size;
+    s = env_->GetFileSizeOnDisk(data_filename, &reported_size);
+    if (!s.ok()) {
+      HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(
+          ErrorHandlerType::DISK_ERROR, dir));
+      result->status = s.CloneAndPrepend(Substitute(
+          "Could not get on-disk file size of container $0", container->ToString()));
+      return;
+    }
+    int64_t cleanup_threshold_size = container->live_bytes_aligned() *
+        (1 + FLAGS_log_container_excess_space_before_cleanup_fraction);
+    if (reported_size > cleanup_threshold_size) {
+      result->report.full_container_space_check->entries.emplace_back(
+          container->ToString(), reported_size - container->live_bytes_aligned());
+
+      // If the container is to be deleted outright, don't bother repunching
+      // its blocks. The report entry remains, however, so it's clear that
+      // there was a space discrepancy.
+      if (container->live_blocks()) {
+        result->need_repunching.insert(result->need_repunching.end(),
+                                       dead_blocks.begin(), dead_blocks.end());
+      }
+    }
+
+    result->report.stats.lbm_full_container_count++;
+  }
+  result->report.stats.live_block_bytes += container->live_bytes();
+  result->report.stats.live_block_bytes_aligned += container->live_bytes_aligned();
+  result->report.stats.live_block_count += container->live_blocks();
+  result->report.stats.lbm_container_count++;
+
+  num_containers_loaded->Increment();
+
+  next_block_id_.StoreMax(max_block_id + 1);
+
+  // Under the lock, merge this map into the main block map and add
+  // the container.
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    // To avoid cacheline contention during startup, we aggregate all of the
+    // memory in a local and add it to the mem-tracker in a single increment
+    // for the whole container.
+    relocated_block_ids_.insert(relocated_block_ids.begin(), relocated_block_ids.end());
+    int64_t mem_usage = 0;
+    for (UntrackedBlockMap::value_type& e : live_blocks) {
+      int block_mem = kudu_malloc_usable_size(e.second.get());
+      if (!AddLogBlockUnlocked(e.second)) {
+        // If container compaction crashed after copying a block but before
+        // deleting the old copy, both copies are live. They're identical, so
+        // this one can be dropped.
+        const auto& existing = FindOrDie(blocks_by_block_id_, e.first);
+        if (existing->length() == e.second->length() &&
+            ContainsKey(relocated_block_ids_, e.first)) {
+          VLOG(1) << Substitute("Dropping duplicate copy of relocated block $0 in container $1",
+                                e.first.ToString(), container->ToString());
+          container->BlockDeleted(e.second);
+          auto* records = FindOrNull(result->low_live_block_containers,
+                                     container->ToString());
+          if (records) {
+            records->erase(std::remove_if(records->begin(), records->end(),
+                                          [&](const BlockRecordPB& r) {
+                                            return BlockId::FromPB(r.block_id()) == e.first;
+                                          }),
+                           records->end());
+          }
+          result->relocation_duplicates.emplace_back(std::move(e.second));
+          continue;
+        }
+        // TODO(adar): track as an inconsistency?
+        LOG(FATAL) << "Found duplicate CREATE record for block " << e.first
+                   << " which already is alive from another container when "
+                   << " processing container " << container->ToString();
+      }
+      mem_usage += block_mem;
+    }
+
+    mem_tracker_->Consume(mem_usage);
+    AddNewContainerUnlocked(container.get());
+    MakeContainerAvailableUnlocked(container.release());
+  }
+}
+
 void LogBlockManager::OpenDataDir(DataDir* dir,
                                   FsReport* report,
                                   Status* result_status) {
@@ -2176,6 +2859,10 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
   // be repunched during repair.
   vector<scoped_refptr<internal::LogBlock>> need_repunching;
 
+  // Keep track of the extra copies of blocks whose relocation was interrupted;
+  // they will be deleted during repair.
+  vector<scoped_refptr<internal::LogBlock>> relocation_duplicates;
+
   // Keep track of containers that have nothing but dead blocks; they will be
   // deleted during repair.
   vector<string> dead_containers;
@@ -2195,7 +2882,7 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
         "Could not list children of $0", dir->dir()));
     return;
   }
-  MonoTime last_opened_container_log_time = MonoTime::Now();
+  vector<string> container_names;
   for (const string& child : children) {
     string container_name;
     if (!TryStripSuffixString(
@@ -2208,201 +2895,57 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
       continue;
     }
 
-    unique_ptr<LogBlockContainer> container;
-    s = LogBlockContainer::Open(
-        this, dir, &local_report, container_name, &container);
-    if (s.IsAborted()) {
-      // Skip the container. Open() added a record of it to 'local_report' for us.
-      continue;
-    }
-    if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not open container $0", container_name));
-      return;
-    }
+    container_names.emplace_back(std::move(container_name));
+  }
 
-    // Process the records, building a container-local map for live blocks and
-    // a list of dead blocks.
-    //
-    // It's important that we don't try to add these blocks to the global map
-    // incrementally as we see each record, since it's possible that one container
-    // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
-    // If we processed those two containers in this order, then upon processing
-    // the second container, we'd think there was a duplicate block. Building
-    // the container-local map first ensures that we discount deleted blocks
-    // before checking for duplicate IDs.
-    //
-    // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
-    // exceedingly unlikely. However, we might have old data which still exhibits
-    // the above issue.
-    UntrackedBlockMap live_blocks;
-    BlockRecordMap live_block_records;
-    vector<scoped_refptr<internal::LogBlock>> dead_blocks;
-    uint64_t max_block_id = 0;
-    s = container->ProcessRecords(&local_report,
-                                  &live_blocks,
-                                  &live_block_records,
-                                  &dead_blocks,
-                                  &max_block_id);
+  // Load the containers in parallel: the time spent here is dominated by
+  // reading and parsing container metadata files, which is largely CPU-bound.
+  vector<ContainerLoadResult> results(container_names.size());
+  AtomicInt<int64_t> num_containers_loaded(0);
+  gscoped_ptr<ThreadPool> pool;
+  s = ThreadPoolBuilder("lbm container load")
+      .set_min_threads(0)
+      .set_max_threads(std::max(1, FLAGS_log_container_load_threads_per_data_dir))
+      .Build(&pool);
+  if (!s.ok()) {
+    *result_status = s.CloneAndPrepend(Substitute(
+        "Could not create container load pool for $0", dir->dir()));
+    return;
+  }
+  for (int i = 0; i < container_names.size(); i++) {
+    s = pool->SubmitFunc([this, dir, &container_names, &num_containers_loaded, &results, i]() {
+      this->LoadContainer(dir, container_names[i], &num_containers_loaded, &results[i]);
+    });
     if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not process records in container $0", container->ToString()));
-      return;
+      results[i].status = s;
     }
+  }
 
-    // With deleted blocks out of the way, check for misaligned blocks.
-    //
-    // We could also enforce that the record's offset is aligned with the
-    // underlying filesystem's block size, an invariant maintained by the log
-    // block manager. However, due to KUDU-1793, that invariant may have been
-    // broken, so we'll note but otherwise allow it.
-    for (const auto& e : live_blocks) {
-      if (PREDICT_FALSE(e.second->offset() %
-                        container->instance()->filesystem_block_size_bytes() != 0)) {
-        local_report.misaligned_block_check->entries.emplace_back(
-            container->ToString(), e.first);
-
-      }
-    }
-
-    if (container->full()) {
-      // Full containers without any live blocks can be deleted outright.
-      //
-      // TODO(adar): this should be reported as an inconsistency once dead
-      // container deletion is also done in real time. Until then, it would be
-      // confusing to report it as such since it'll be a natural event at startup.
-      if (container->live_blocks() == 0) {
-        DCHECK(live_blocks.empty());
-        dead_containers.emplace_back(container->ToString());
-      } else if (static_cast<double>(container->live_blocks()) /
-          container->total_blocks() <= FLAGS_log_container_live_metadata_before_compact_ratio) {
-        // Metadata files of containers with very few live blocks will be compacted.
-        //
-        // TODO(adar): this should be reported as an inconsistency once
-        // container metadata compaction is also done in realtime. Until then,
-        // it would be confusing to report it as such since it'll be a natural
-        // event at startup.
-        vector<BlockRecordPB> records(live_block_records.size());
-        int i = 0;
-        for (auto& e : live_block_records) {
-          records[i].Swap(&e.second);
-          i++;
-        }
-
-        // Sort the records such that their ordering reflects the ordering in
-        // the pre-compacted metadata file.
-        //
-        // This is preferred to storing the records in an order-preserving
-        // container (such as std::map) because while records are temporarily
-        // retained for every container, only some containers will actually
-        // undergo metadata compaction.
-        std::sort(records.begin(), records.end(),
-                  [](const BlockRecordPB& a, const BlockRecordPB& b) {
-          // Sort by timestamp.
-          if (a.timestamp_us() != b.timestamp_us()) {
-            return a.timestamp_us() < b.timestamp_us();
-          }
-
-          // If the timestamps match, sort by offset.
-          //
-          // If the offsets also match (i.e. both blocks are of zero length),
-          // it doesn't matter which of the two records comes first.
-          return a.offset() < b.offset();
-        });
-
-        low_live_block_containers[container->ToString()] = std::move(records);
-      }
-
-      // Having processed the block records, let's check whether any full
-      // containers have any extra space (left behind after a crash or from an
-      // older version of Kudu).
-      //
-      // Filesystems are unpredictable beasts and may misreport the amount of
-      // space allocated to a file in various interesting ways. Some examples:
-      // - XFS's speculative preallocation feature may artificially enlarge the
-      //   container's data file without updating its file size. This makes the
-      //   file size untrustworthy for the purposes of measuring allocated space.
-      //   See KUDU-1856 for more details.
-      // - On el6.6/ext4 a container data file that consumed ~32K according to
-      //   its extent tree was actually reported as consuming an additional fs
-      //   block (2k) of disk space. A similar container data file (generated
-      //   via the same workload) on Ubuntu 16.04/ext4 did not exhibit this.
-      //   The suspicion is that older versions of ext4 include interior nodes
-      //   of the extent tree when reporting file block usage.
-      //
-      // To deal with these issues, our extra space cleanup code (deleted block
-      // repunching and container truncation) is gated on an "actual disk space
-      // consumed" heuristic. To prevent unnecessary triggering of the
-      // heuristic, we allow for some slop in our size measurements. The exact
-      // amount of slop is configurable via
-      // log_container_excess_space_before_cleanup_fraction.
-      //
-      // Too little slop and we'll do unnecessary work at startup. Too much and
-      // more unused space may go unreclaimed.
-      string data_filename = StrCat(container->ToString(), kContainerDataFileSuffix);
-      uint64_t reported_size;
-      s = env_->GetFileSizeOnDisk(data_filename, &reported_size);
-      if (!s.ok()) {
-        HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(
-            ErrorHandlerType::DISK_ERROR, dir));
-        *result_status = s.CloneAndPrepend(Substitute(
-            "Could not get on-disk file size of container $0", container->ToString()));
-        return;
-      }
-      int64_t cleanup_threshold_size = container->live_bytes_aligned() *
-          (1 + FLAGS_log_container_excess_space_before_cleanup_fraction);
-      if (reported_size > cleanup_threshold_size) {
-        local_report.full_container_space_check->entries.emplace_back(
-            container->ToString(), reported_size - container->live_bytes_aligned());
-
-        // If the container is to be deleted outright, don't bother repunching
-        // its blocks. The report entry remains, however, so it's clear that
-        // there was a space discrepancy.
-        if (container->live_blocks()) {
-          need_repunching.insert(need_repunching.end(),
-                                 dead_blocks.begin(), dead_blocks.end());
-        }
-      }
+  // Log number of containers opened every 10 seconds
+  while (!pool->WaitFor(MonoDelta::FromSeconds(10))) {
+    LOG(INFO) << Substitute("Opened $0 of $1 log block containers in $2",
+                            num_containers_loaded.Load(), container_names.size(),
+                            dir->dir());
+  }
 
-      local_report.stats.lbm_full_container_count++;
+  // Merge the per-container results.
+  for (auto& result : results) {
+    if (!result.status.ok()) {
+      *result_status = result.status;
+      return;
     }
-    local_report.stats.live_block_bytes += container->live_bytes();
-    local_report.stats.live_block_bytes_aligned += container->live_bytes_aligned();
-    local_report.stats.live_block_count += container->live_blocks();
-    local_report.stats.lbm_container_count++;
-
-    // Log number of containers opened every 10 seconds
-    MonoTime now = MonoTime::Now();
-    if ((now - last_opened_container_log_time).ToSeconds() > 10) {
-      LOG(INFO) << Substitute("Opened $0 log block containers in $1",
-                              local_report.stats.lbm_container_count, dir->dir());
-      last_opened_container_log_time = now;
-    }
-
-    next_block_id_.StoreMax(max_block_id + 1);
-
-    // Under the lock, merge this map into the main block map and add
-    // the container.
-    {
-      std::lock_guard<simple_spinlock> l(lock_);
-      // To avoid cacheline contention during startup, we aggregate all of the
-      // memory in a local and add it to the mem-tracker in a single increment
-      // at the end of this loop.
-      int64_t mem_usage = 0;
-      for (UntrackedBlockMap::value_type& e : live_blocks) {
-        int block_mem = kudu_malloc_usable_size(e.second.get());
-        if (!AddLogBlockUnlocked(std::move(e.second))) {
-          // TODO(adar): track as an inconsistency?
-          LOG(FATAL) << "Found duplicate CREATE record for block " << e.first
-                     << " which already is alive from another container when "
-                     << " processing container " << container->ToString();
-        }
-        mem_usage += block_mem;
-      }
-
-      mem_tracker_->Consume(mem_usage);
-      AddNewContainerUnlocked(container.get());
-      MakeContainerAvailableUnlocked(container.release());
+    local_report.MergeFrom(result.report);
+    need_repunching.insert(need_repunching.end(),
+                           result.need_repunching.begin(),
+                           result.need_repunching.end());
+    relocation_duplicates.insert(relocation_duplicates.end(),
+                                 result.relocation_duplicates.begin(),
+                                 result.relocation_duplicates.end());
+    dead_containers.insert(dead_containers.end(),
+                           result.dead_containers.begin(),
+                           result.dead_containers.end());
+    for (auto& e : result.low_live_block_containers) {
+      low_live_block_containers[e.first] = std::move(e.second);
     }
   }
 
@@ -2411,6 +2954,7 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
   s = Repair(dir,
              &local_report,
              std::move(need_repunching),
+             std::move(relocation_duplicates),
              std::move(dead_containers),
              std::move(low_live_block_containers));
   if (!s.ok()) {
@@ -2442,6 +2986,7 @@ Status LogBlockManager::Repair(
     DataDir* dir,
     FsReport* report,
     vector<scoped_refptr<internal::LogBlock>> need_repunching,
+    vector<scoped_refptr<internal::LogBlock>> relocation_duplicates,
     vector<string> dead_containers,
     unordered_map<string, vector<BlockRecordPB>> low_live_block_containers) {
   if (opts_.read_only) {
@@ -2610,6 +3155,27 @@ Status LogBlockManager::Repair(
     }
   }
 
+  // Delete the extra copies of relocated blocks. Their DELETE records must be
+  // durable before they are punched out, lest a crash revive them.
+  unordered_set<internal::LogBlockContainer*> duplicate_containers;
+  for (auto& b : relocation_duplicates) {
+    BlockRecordPB record;
+    b->block_id().CopyToPB(record.mutable_block_id());
+    record.set_op_type(DELETE);
+    record.set_timestamp_us(GetCurrentTimeMicros());
+    RETURN_NOT_OK_LBM_DISK_FAILURE_PREPEND(b->container()->AppendMetadata(record),
+        "could not append deletion record for duplicate block");
+    duplicate_containers.insert(b->container());
+  }
+  for (auto* c : duplicate_containers) {
+    RETURN_NOT_OK_LBM_DISK_FAILURE_PREPEND(c->SyncMetadata(),
+        "could not sync deletion records for duplicate blocks");
+  }
+  need_repunching.insert(need_repunching.end(),
+                         relocation_duplicates.begin(),
+                         relocation_duplicates.end());
+  relocation_duplicates.clear();
+
   // Repunch all requested holes. Any excess space reclaimed was already
   // tracked by LBMFullContainerSpaceCheck.
   //
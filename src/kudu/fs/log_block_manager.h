@@ -21,6 +21,7 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -209,6 +210,26 @@ class LogBlockManager : public BlockManager {
 
   FsErrorManager* error_manager() override { return error_manager_; }
 
+  // Returns the number of sparse containers (full containers that are mostly
+  // dead; see CompactSparseContainers()), the total number of containers, and
+  // the number of live bytes in the sparse containers.
+  void GetSparseContainerStats(int64_t* sparse_containers,
+                               int64_t* total_containers,
+                               int64_t* sparse_live_bytes);
+
+  // Compacts the sparsest containers, moving up to 'max_bytes_to_move' bytes
+  // of live blocks (but at least one container's worth) into other containers
+  // of the same data directory. Block IDs are unchanged: once a block's copy
+  // is durable, it replaces the original in the block map, and the original
+  // is punched out after its last reader closes it. Compacted containers are
+  // left without live blocks, and are deleted at the next startup.
+  //
+  // Concurrent calls return immediately. The number of compacted containers
+  // and moved blocks are written to 'containers_compacted' and 'blocks_moved'.
+  Status CompactSparseContainers(int64_t max_bytes_to_move,
+                                 int64_t* containers_compacted,
+                                 int64_t* blocks_moved);
+
  private:
   FRIEND_TEST(LogBlockManagerTest, TestAbortBlock);
   FRIEND_TEST(LogBlockManagerTest, TestCloseFinalizedBlock);
@@ -273,6 +294,13 @@ class LogBlockManager : public BlockManager {
   // Must be called with 'lock_' held.
   void RemoveFullContainerUnlocked(const std::string& container_name);
 
+  // Registers 'container', which has become sparse, in 'sparse_containers_'.
+  void AddSparseContainer(internal::LogBlockContainer* container);
+
+  // Returns the containers of 'sparse_containers_' that are still sparse,
+  // dropping the others from it.
+  std::vector<internal::LogBlockContainer*> GetSparseContainers();
+
   // Returns a container appropriate for the given CreateBlockOptions, creating
   // a new container if necessary.
   //
@@ -282,6 +310,10 @@ class LogBlockManager : public BlockManager {
   Status GetOrCreateContainer(const CreateBlockOptions& opts,
                               internal::LogBlockContainer** container);
 
+  // Like GetOrCreateContainer(), but for a container in 'dir'.
+  Status GetOrCreateContainerInDir(DataDir* dir,
+                                   internal::LogBlockContainer** container);
+
   // Indicate that this container is no longer in use and can be handed out
   // to other writers.
   void MakeContainerAvailable(internal::LogBlockContainer* container);
@@ -331,18 +363,41 @@ class LogBlockManager : public BlockManager {
   Status RemoveLogBlockUnlocked(const BlockId& block_id,
                                 scoped_refptr<internal::LogBlock>* lb);
 
+  // Completes the relocation of 'old_block' to 'length' bytes at 'offset' in
+  // 'container', whose data and CREATE record have been made durable.
+  //
+  // Unless 'old_block' was deleted in the meantime, the new copy replaces it
+  // in the block map. The copy that is not in the block map is then deleted,
+  // and registered with 'transaction' to be punched out.
+  void FinishBlockRelocation(
+      scoped_refptr<internal::LogBlock> old_block,
+      internal::LogBlockContainer* container,
+      int64_t offset,
+      int64_t length,
+      const std::shared_ptr<internal::LogBlockDeletionTransaction>& transaction);
+
+  // Copies 'blocks', the live blocks of 'container', into other containers in
+  // the same data directory. See CompactSparseContainers().
+  //
+  // The number of blocks moved is added to 'blocks_moved'.
+  Status CompactContainer(internal::LogBlockContainer* container,
+                          std::vector<scoped_refptr<internal::LogBlock>> blocks,
+                          int64_t* blocks_moved);
+
   // Repairs any inconsistencies for 'dir' described in 'report'.
   //
   // The following additional repairs will be performed:
   // 1. Blocks in 'need_repunching' will be punched out again.
-  // 2. Containers in 'dead_containers' will be deleted from disk.
-  // 3. Containers in 'low_live_block_containers' will have their metadata
+  // 2. Blocks in 'relocation_duplicates' will be deleted and punched out.
+  // 3. Containers in 'dead_containers' will be deleted from disk.
+  // 4. Containers in 'low_live_block_containers' will have their metadata
   //    files compacted.
   //
   // Returns an error if repairing a fatal inconsistency failed.
   Status Repair(DataDir* dir,
                 FsReport* report,
                 std::vector<scoped_refptr<internal::LogBlock>> need_repunching,
+                std::vector<scoped_refptr<internal::LogBlock>> relocation_duplicates,
                 std::vector<std::string> dead_containers,
                 std::unordered_map<
                     std::string,
@@ -360,6 +415,19 @@ class LogBlockManager : public BlockManager {
                              const std::vector<BlockRecordPB>& records,
                              int64_t* file_bytes_delta);
 
+  struct ContainerLoadResult;
+
+  // Opens and processes the records of the container 'container_name' in
+  // 'dir', adding its live blocks to the block map. The consistency check
+  // results and the repairs to perform are written to 'result', and
+  // 'num_containers_loaded' is incremented on success.
+  //
+  // Thread-safe: the containers of a data directory are loaded in parallel.
+  void LoadContainer(DataDir* dir,
+                     const std::string& container_name,
+                     AtomicInt<int64_t>* num_containers_loaded,
+                     ContainerLoadResult* result);
+
   // Opens a particular data directory belonging to the block manager. The
   // results of consistency checking (and repair, if applicable) are written to
   // 'report'.
@@ -425,6 +493,26 @@ class LogBlockManager : public BlockManager {
   // they're WritableBlocks that were closed.
   BlockMap blocks_by_block_id_;
 
+  // The IDs of blocks whose CREATE records are marked as relocated. Used to
+  // reconcile duplicate blocks while opening the block manager, and cleared
+  // afterwards.
+  BlockIdSet relocated_block_ids_;
+
+  // Serializes calls to CompactSparseContainers().
+  std::mutex compaction_lock_;
+
+  // Protects 'sparse_containers_'. Acquired after 'lock_' when both are held.
+  simple_spinlock sparse_lock_;
+
+  // The containers which became sparse since they were added to the block
+  // manager, so that finding the containers to compact doesn't require
+  // scanning all of them. A container registers itself when a deletion (or
+  // its loading) makes it sparse; containers that are no longer sparse, e.g.
+  // because they were compacted, are dropped by GetSparseContainers().
+  //
+  // Does not own the containers.
+  std::unordered_set<internal::LogBlockContainer*> sparse_containers_;
+
   // Contains block IDs for WritableBlocks that are still open for writing.
   // When a WritableBlock is closed, its ID is moved to blocks_by_block_id.
   //
@@ -2142,6 +2142,40 @@ TEST_F(RaftConsensusITest, TestLargeBatches) {
 }
 
 
+// Test that a leader which pipelines UpdateConsensus requests to its followers
+// replicates all the writes, even though the followers may process the
+// requests, and the leader their responses, out of order.
+TEST_F(RaftConsensusITest, TestPipelinedUpdateConsensus) {
+  const vector<string> kTsFlags = {
+    "--consensus_max_inflight_requests_per_peer=4",
+    // Use small batches, so that many requests are pipelined.
+    "--consensus_max_batch_size_bytes=16384",
+  };
+  NO_FATALS(BuildAndStart(kTsFlags));
+
+  TestWorkload workload(cluster_.get());
+  workload.set_table_name(kTableId);
+  workload.set_payload_bytes(1024);
+  workload.set_write_batch_size(20);
+  workload.set_num_write_threads(4);
+  workload.Setup();
+  workload.Start();
+  while (workload.rows_inserted() < 20000) {
+    SleepFor(MonoDelta::FromMilliseconds(100));
+  }
+  workload.StopAndJoin();
+
+  const MonoDelta kTimeout = MonoDelta::FromSeconds(60);
+  ASSERT_OK(WaitForServersToAgree(kTimeout, tablet_servers_, tablet_id_,
+                                  workload.batches_completed()));
+  ClusterVerifier v(cluster_.get());
+  NO_FATALS(v.CheckCluster());
+  NO_FATALS(v.CheckRowCount(workload.table_name(),
+                            ClusterVerifier::EXACTLY,
+                            workload.rows_inserted()));
+}
+
+
 // Regression test for KUDU-1469, a case in which a leader and follower could get "stuck"
 // in a tight RPC loop, in which the leader would repeatedly send a batch of ops that the
 // follower already had, the follower would fully de-dupe them, and yet the leader would
@@ -29,6 +29,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/consensus/metadata.pb.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
@@ -36,6 +37,7 @@
 #include "kudu/mini-cluster/internal_mini_cluster.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/path_util.h"
@@ -46,6 +48,7 @@
 
 using kudu::cluster::InternalMiniCluster;
 using kudu::cluster::InternalMiniClusterOptions;
+using kudu::consensus::RaftPeerPB;
 using kudu::pb_util::SecureDebugString;
 using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
@@ -306,5 +309,56 @@ TEST_F(TableLocationsWithTSLocationTest, TestGetTSLocation) {
   }
 }
 
+// Test that the locations served from the master's tablet locations cache
+// reflect changes reported by the tablet servers.
+TEST_F(TableLocationsTest, TestCachedLocationsInvalidated) {
+  const string table_name = "test";
+  Schema schema({ ColumnSchema("key", STRING) }, 1);
+  ASSERT_OK(CreateTable(table_name, schema));
+
+  NO_FATALS(CheckMasterTableCreation(table_name, 1));
+
+  // Returns the UUID of the leader replica of the table's only tablet, or an
+  // empty string if there is no leader.
+  auto get_leader_uuid = [&](GetTableLocationsResponsePB* resp) {
+    GetTableLocationsRequestPB req;
+    RpcController controller;
+    req.mutable_table()->set_table_name(table_name);
+    CHECK_OK(proxy_->GetTableLocations(req, resp, &controller));
+    CHECK(!resp->has_error()) << SecureDebugString(*resp);
+    CHECK_EQ(1, resp->tablet_locations_size());
+    for (const auto& replica : resp->tablet_locations(0).replicas()) {
+      if (replica.role() == RaftPeerPB::LEADER) {
+        return replica.ts_info().permanent_uuid();
+      }
+    }
+    return string();
+  };
+
+  string leader_uuid;
+  ASSERT_EVENTUALLY([&] {
+    GetTableLocationsResponsePB resp;
+    leader_uuid = get_leader_uuid(&resp);
+    ASSERT_FALSE(leader_uuid.empty());
+  });
+
+  // Repeated requests are answered from the cache with identical locations.
+  GetTableLocationsResponsePB first;
+  GetTableLocationsResponsePB second;
+  ASSERT_EQ(leader_uuid, get_leader_uuid(&first));
+  ASSERT_EQ(leader_uuid, get_leader_uuid(&second));
+  ASSERT_EQ(SecureDebugString(first), SecureDebugString(second));
+
+  // Once the remaining replicas elect a new leader and report it, the cached
+  // locations must not be served anymore.
+  cluster_->mini_tablet_server_by_uuid(leader_uuid)->Shutdown();
+  ASSERT_EVENTUALLY([&] {
+    GetTableLocationsResponsePB resp;
+    const string new_leader_uuid = get_leader_uuid(&resp);
+    ASSERT_FALSE(new_leader_uuid.empty());
+    ASSERT_NE(leader_uuid, new_leader_uuid);
+  });
+}
+
 } // namespace master
 } // namespace kudu
@@ -509,7 +509,8 @@ TEST_F(TabletCopyITest, TestDeleteTabletDuringTabletCopy) {
     // Start up a TabletCopyClient and open a tablet copy session.
     TabletCopyClient tc_client(tablet_id, fs_manager.get(),
                                cmeta_manager, cluster_->messenger(),
-                               nullptr /* no metrics */);
+                               nullptr /* no metrics */,
+                               nullptr /* no throttling */);
     scoped_refptr<tablet::TabletMetadata> meta;
     ASSERT_OK(tc_client.Start(cluster_->tablet_server(kTsIndex)->bound_rpc_hostport(),
                               &meta));
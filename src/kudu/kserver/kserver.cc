@@ -55,6 +55,15 @@ static bool ValidateThreadPoolThreadLimit(const char* /*flagname*/, int32_t valu
 }
 DEFINE_validator(server_thread_pool_max_thread_count, &ValidateThreadPoolThreadLimit);
 
+DEFINE_int32(raft_pool_max_threads, 0,
+             "If greater than 0, the maximum number of threads of the server-wide "
+             "pool which sends the Raft requests of all the replicas and runs their "
+             "elections. Each replica queues its work on its own token, which takes "
+             "turns with the tokens of the other replicas. If 0, the pool is capped "
+             "like the other server-wide pools.");
+TAG_FLAG(raft_pool_max_threads, advanced);
+TAG_FLAG(raft_pool_max_threads, experimental);
+
 using std::string;
 using strings::Substitute;
 
@@ -150,9 +159,13 @@ Status KuduServer::Init() {
   RETURN_NOT_OK(ThreadPoolBuilder("prepare")
                 .set_max_threads(server_wide_pool_limit)
                 .Build(&tablet_prepare_pool_));
+  int raft_pool_limit = server_wide_pool_limit;
+  if (FLAGS_raft_pool_max_threads > 0) {
+    raft_pool_limit = std::min(raft_pool_limit, FLAGS_raft_pool_max_threads);
+  }
   RETURN_NOT_OK(ThreadPoolBuilder("raft")
                 .set_trace_metric_prefix("raft")
-                .set_max_threads(server_wide_pool_limit)
+                .set_max_threads(raft_pool_limit)
                 .Build(&raft_pool_));
 
   return Status::OK();
@@ -123,6 +123,8 @@
 #include "kudu/tablet/transactions/transaction_tracker.h"
 #include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/tserver/tserver_admin.proxy.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
@@ -133,6 +135,7 @@
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/threadpool.h"
@@ -159,6 +162,14 @@ DEFINE_int32(unresponsive_ts_rpc_timeout_ms, 60 * 60 * 1000, // 1 hour
              "a tablet server in order to perform operations such as deleting a tablet.");
 TAG_FLAG(unresponsive_ts_rpc_timeout_ms, advanced);
 
+DEFINE_int32(catalog_manager_load_threads, 4,
+             "Number of threads on which a master that becomes the leader decodes "
+             "and loads the tablet entries of the system catalog into memory. "
+             "Loading a large catalog in parallel shortens how long a new leader "
+             "master takes to start serving.");
+TAG_FLAG(catalog_manager_load_threads, advanced);
+TAG_FLAG(catalog_manager_load_threads, experimental);
+
 DEFINE_int32(default_num_replicas, 3,
              "Default number of replicas for tables that do not have the num_replicas set.");
 TAG_FLAG(default_num_replicas, advanced);
@@ -225,6 +236,12 @@ DEFINE_int32(table_locations_ttl_ms, 5 * 60 * 1000, // 5 minutes
              "until after waiting for the ttl period.");
 TAG_FLAG(table_locations_ttl_ms, advanced);
 
+DEFINE_int64(tablet_locations_cache_capacity_mb, 32,
+             "Capacity of the cache of serialized tablet locations used to "
+             "answer GetTableLocations and GetTabletLocations requests, in MiB. "
+             "Set to 0 to disable the cache.");
+TAG_FLAG(tablet_locations_cache_capacity_mb, advanced);
+
 DEFINE_bool(catalog_manager_fail_ts_rpcs, false,
             "Whether all master->TS async calls should fail. Only for testing!");
 TAG_FLAG(catalog_manager_fail_ts_rpcs, hidden);
@@ -358,6 +375,9 @@ class TableLoader : public TableVisitor {
 // Tablet Loader
 ////////////////////////////////////////////////////////////
 
+// The tablets may be visited concurrently: the tablet map is only updated
+// under 'tablet_map_lock_', and the table map isn't changed while the tablets
+// are loaded.
 class TabletLoader : public TabletVisitor {
  public:
   explicit TabletLoader(CatalogManager *catalog_manager)
@@ -385,7 +405,10 @@ class TabletLoader : public TabletVisitor {
     l.mutable_data()->pb.CopyFrom(metadata);
 
     // Add the tablet to the tablet manager.
-    catalog_manager_->tablet_map_[tablet->id()] = tablet;
+    {
+      std::lock_guard<simple_spinlock> map_lock(tablet_map_lock_);
+      catalog_manager_->tablet_map_[tablet->id()] = tablet;
+    }
 
     // Add the tablet to the table.
     bool is_deleted = l.mutable_data()->is_deleted();
@@ -406,6 +429,7 @@ class TabletLoader : public TabletVisitor {
 
  private:
   CatalogManager *catalog_manager_;
+  simple_spinlock tablet_map_lock_;
 
   DISALLOW_COPY_AND_ASSIGN(TabletLoader);
 };
@@ -692,6 +716,7 @@ CatalogManager::CatalogManager(Master* master)
            // closely timed consecutive elections).
            .set_max_threads(1)
            .Build(&leader_election_pool_));
+  ResetTabletLocationsCache();
 }
 
 CatalogManager::~CatalogManager() {
@@ -945,7 +970,7 @@ Status CatalogManager::InitTokenSigner() {
 void CatalogManager::PrepareForLeadershipTask() {
   {
     // Hack to block this function until InitSysCatalogAsync() is finished.
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
   }
   const RaftConsensus* consensus = sys_catalog_->tablet_replica()->consensus();
   const int64_t term_before_wait = consensus->CurrentTerm();
@@ -1157,12 +1182,17 @@ Status CatalogManager::VisitTablesAndTabletsUnlocked() {
   table_ids_map_.clear();
   tablet_map_.clear();
 
+  // The reloaded TabletInfos start over at metadata version 0, so the cached
+  // locations can't be told apart from current ones.
+  ResetTabletLocationsCache();
+
   // Visit tables and tablets, load them into memory.
   TableLoader table_loader(this);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTables(&table_loader),
                         "Failed while visiting tables in sys catalog");
   TabletLoader tablet_loader(this);
-  RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader),
+  RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader,
+                                                  FLAGS_catalog_manager_load_threads),
                         "Failed while visiting tablets in sys catalog");
   return Status::OK();
 }
@@ -1231,7 +1261,7 @@ void CatalogManager::Shutdown() {
   // tasks for those entries.
   vector<scoped_refptr<TableInfo>> copy;
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     AppendValuesFromMap(table_ids_map_, &copy);
   }
   AbortAndWaitForAllTasks(copy);
@@ -1731,7 +1761,7 @@ Status CatalogManager::FindAndLockTable(const ReqClass& request,
 
   scoped_refptr<TableInfo> table;
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     if (table_identifier.has_table_id()) {
       table = FindPtrOrNull(table_ids_map_, table_identifier.table_id());
 
@@ -2585,7 +2615,7 @@ Status CatalogManager::ListTables(const ListTablesRequestPB* req,
   leader_lock_.AssertAcquiredForReading();
   RETURN_NOT_OK(CheckOnline());
 
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
 
   for (const TableInfoMap::value_type& entry : normalized_table_names_map_) {
     TableMetadataLock ltm(entry.second.get(), LockMode::READ);
@@ -2610,7 +2640,7 @@ Status CatalogManager::GetTableInfo(const string& table_id, scoped_refptr<TableI
   leader_lock_.AssertAcquiredForReading();
   RETURN_NOT_OK(CheckOnline());
 
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   *table = FindPtrOrNull(table_ids_map_, table_id);
   return Status::OK();
 }
@@ -2620,7 +2650,7 @@ Status CatalogManager::GetAllTables(vector<scoped_refptr<TableInfo>>* tables) {
   RETURN_NOT_OK(CheckOnline());
 
   tables->clear();
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   AppendValuesFromMap(table_ids_map_, tables);
 
   return Status::OK();
@@ -2630,7 +2660,7 @@ Status CatalogManager::TableNameExists(const string& table_name, bool* exists) {
   leader_lock_.AssertAcquiredForReading();
   RETURN_NOT_OK(CheckOnline());
 
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   *exists = ContainsKey(normalized_table_names_map_, NormalizeTableName(table_name));
   return Status::OK();
 }
@@ -2675,7 +2705,7 @@ Status CatalogManager::GetTabletReplica(const string& tablet_id,
                                         scoped_refptr<TabletReplica>* replica) const {
   // Note: CatalogManager has only one table, 'sys_catalog', with only
   // one tablet.
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   if (!sys_catalog_) {
     return Status::ServiceUnavailable("Systable not yet initialized");
   }
@@ -2691,7 +2721,7 @@ Status CatalogManager::GetTabletReplica(const string& tablet_id,
 void CatalogManager::GetTabletReplicas(vector<scoped_refptr<TabletReplica>>* replicas) const {
   // Note: CatalogManager has only one table, 'sys_catalog', with only
   // one tablet.
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   if (!sys_catalog_) {
     return;
   }
@@ -3598,7 +3628,7 @@ Status CatalogManager::ProcessTabletReport(
     // We only need to acquire lock_ for the tablet_map_ access, but since it's
     // acquired exclusively so rarely, it's probably cheaper to acquire and
     // hold it for all tablets here than to acquire/release it for each tablet.
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     for (const ReportedTabletPB& report : full_report.updated_tablets()) {
       const string& tablet_id = report.tablet_id();
 
@@ -3894,11 +3924,12 @@ Status CatalogManager::ProcessTabletReport(
 
   // 11. Write all tablet mutations to the catalog table.
   //
-  // SysCatalogTable::Write will short-circuit the case where the data has not
-  // in fact changed since the previous version and avoid any unnecessary mutations.
-  SysCatalogTable::Actions actions;
-  actions.tablets_to_update = std::move(mutated_tablets);
-  Status s = sys_catalog_->Write(actions);
+  // Reports from many tservers tend to arrive at once (e.g. after a network
+  // partition heals), so the write is coalesced with those of any reports
+  // being processed concurrently. SysCatalogTable::Write will short-circuit
+  // the case where the data has not in fact changed since the previous
+  // version and avoid any unnecessary mutations.
+  Status s = sys_catalog_->UpdateTablets(mutated_tablets);
   if (!s.ok()) {
     LOG(ERROR) << Substitute(
         "Error updating tablets from $0: $1. Tablet report was: $2",
@@ -3973,7 +4004,7 @@ std::shared_ptr<RaftConsensus> CatalogManager::master_consensus() const {
   // CatalogManager::InitSysCatalogAsync takes lock_ in exclusive mode in order
   // to initialize sys_catalog_, so it's sufficient to take lock_ in shared mode
   // here to protect access to sys_catalog_.
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   if (!sys_catalog_) {
     return nullptr;
   }
@@ -4030,7 +4061,7 @@ void CatalogManager::SendDeleteTabletRequest(const scoped_refptr<TabletInfo>& ta
 void CatalogManager::ExtractTabletsToProcess(
     vector<scoped_refptr<TabletInfo>>* tablets_to_process) {
 
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
 
   // TODO: At the moment we loop through all the tablets
   //       we can keep a set of tablets waiting for "assignment"
@@ -4404,6 +4435,10 @@ Status CatalogManager::BuildLocationsForTablet(
     const scoped_refptr<TabletInfo>& tablet,
     master::ReplicaTypeFilter filter,
     TabletLocationsPB* locs_pb) {
+  // Sampled before any registrations are looked up, so that locations built
+  // concurrently with a re-registration are never cached as current.
+  const int64_t ts_epoch = master_->ts_manager()->registration_epoch();
+
   TabletMetadataLock l_tablet(tablet.get(), LockMode::READ);
   if (PREDICT_FALSE(l_tablet.data().is_deleted())) {
     return Status::NotFound("Tablet deleted", l_tablet.data().pb.state_msg());
@@ -4413,6 +4448,11 @@ Status CatalogManager::BuildLocationsForTablet(
     return Status::ServiceUnavailable("Tablet not running");
   }
 
+  const int64_t metadata_version = tablet->metadata().version();
+  if (GetCachedTabletLocations(tablet->id(), filter, metadata_version, ts_epoch, locs_pb)) {
+    return Status::OK();
+  }
+
   // Guaranteed because the tablet is RUNNING.
   DCHECK(l_tablet.data().pb.has_consensus_state());
 
@@ -4469,9 +4509,88 @@ Status CatalogManager::BuildLocationsForTablet(
   // No longer used; always set to false.
   locs_pb->set_deprecated_stale(false);
 
+  CacheTabletLocations(tablet->id(), filter, metadata_version, ts_epoch, *locs_pb);
   return Status::OK();
 }
 
+namespace {
+
+// Cached tablet location values are laid out as the metadata version and
+// registration epoch they were built from, followed by the serialized
+// TabletLocationsPB.
+constexpr int kTabletLocationsHeaderSize = 2 * sizeof(uint64_t);
+
+string TabletLocationsCacheKey(const string& tablet_id, master::ReplicaTypeFilter filter) {
+  string key = tablet_id;
+  key.push_back(static_cast<char>(filter));
+  return key;
+}
+
+} // anonymous namespace
+
+bool CatalogManager::GetCachedTabletLocations(const string& tablet_id,
+                                              master::ReplicaTypeFilter filter,
+                                              int64_t metadata_version,
+                                              int64_t ts_epoch,
+                                              TabletLocationsPB* locs_pb) {
+  if (!tablet_locations_cache_) {
+    return false;
+  }
+  Cache::UniqueHandle h(
+      tablet_locations_cache_->Lookup(TabletLocationsCacheKey(tablet_id, filter),
+                                      Cache::EXPECT_IN_CACHE),
+      Cache::HandleDeleter(tablet_locations_cache_.get()));
+  if (!h) {
+    return false;
+  }
+  Slice value = tablet_locations_cache_->Value(h.get());
+  DCHECK_GE(value.size(), kTabletLocationsHeaderSize);
+  if (static_cast<int64_t>(DecodeFixed64(value.data())) != metadata_version ||
+      static_cast<int64_t>(DecodeFixed64(value.data() + sizeof(uint64_t))) != ts_epoch) {
+    // Stale; it is replaced once the current locations have been built.
+    return false;
+  }
+  value.remove_prefix(kTabletLocationsHeaderSize);
+  if (PREDICT_FALSE(!locs_pb->ParseFromArray(value.data(), value.size()))) {
+    LOG(DFATAL) << "Unable to parse cached locations of tablet " << tablet_id;
+    locs_pb->Clear();
+    return false;
+  }
+  return true;
+}
+
+void CatalogManager::CacheTabletLocations(const string& tablet_id,
+                                          master::ReplicaTypeFilter filter,
+                                          int64_t metadata_version,
+                                          int64_t ts_epoch,
+                                          const TabletLocationsPB& locs_pb) {
+  if (!tablet_locations_cache_) {
+    return;
+  }
+  const int pb_size = locs_pb.ByteSize();
+  const int val_len = kTabletLocationsHeaderSize + pb_size;
+  Cache::PendingHandle* pending = tablet_locations_cache_->Allocate(
+      TabletLocationsCacheKey(tablet_id, filter), val_len, val_len);
+  if (PREDICT_FALSE(!pending)) {
+    return;
+  }
+  uint8_t* dst = tablet_locations_cache_->MutableValue(pending);
+  EncodeFixed64(dst, metadata_version);
+  EncodeFixed64(dst + sizeof(uint64_t), ts_epoch);
+  locs_pb.SerializeWithCachedSizesToArray(dst + kTabletLocationsHeaderSize);
+  tablet_locations_cache_->Release(tablet_locations_cache_->Insert(pending, nullptr));
+}
+
+void CatalogManager::ResetTabletLocationsCache() {
+  if (FLAGS_tablet_locations_cache_capacity_mb <= 0) {
+    tablet_locations_cache_.reset();
+    return;
+  }
+  tablet_locations_cache_.reset(NewLRUCache(
+      DRAM_CACHE, FLAGS_tablet_locations_cache_capacity_mb * 1024 * 1024,
+      "tablet-locations-cache"));
+}
+
 Status CatalogManager::GetTabletLocations(const string& tablet_id,
                                           master::ReplicaTypeFilter filter,
                                           TabletLocationsPB* locs_pb) {
@@ -4481,7 +4600,7 @@ Status CatalogManager::GetTabletLocations(const string& tablet_id,
   locs_pb->mutable_replicas()->Clear();
   scoped_refptr<TabletInfo> tablet_info;
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     if (!FindCopy(tablet_map_, tablet_id, &tablet_info)) {
       return Status::NotFound(Substitute("Unknown tablet $0", tablet_id));
     }
@@ -4497,7 +4616,7 @@ Status CatalogManager::ReplaceTablet(const string& tablet_id, ReplaceTabletRespo
   // Lookup the tablet-to-be-replaced and get its table.
   scoped_refptr<TabletInfo> old_tablet;
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     if (!FindCopy(tablet_map_, tablet_id, &old_tablet)) {
       return Status::NotFound(Substitute("Unknown tablet $0", tablet_id));
     }
@@ -4635,7 +4754,7 @@ void CatalogManager::DumpState(std::ostream* out) const {
   // Copy the internal state so that, if the output stream blocks,
   // we don't end up holding the lock for a long time.
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     ids_copy = table_ids_map_;
     names_copy = normalized_table_names_map_;
     tablets_copy = tablet_map_;
@@ -53,6 +53,7 @@
 
 namespace kudu {
 
+class Cache;
 class CreateTableStressTest_TestConcurrentCreateTableAndReloadMetadata_Test;
 class MonitoredTask;
 class NodeInstancePB;
@@ -824,6 +825,28 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
                                  master::ReplicaTypeFilter filter,
                                  TabletLocationsPB* locs_pb);
 
+  // Looks up the serialized locations of 'tablet_id' for 'filter' in the
+  // tablet locations cache. Entries are only valid if they were built from
+  // tablet metadata version 'metadata_version' and tablet server registration
+  // epoch 'ts_epoch'. Returns true and populates 'locs_pb' on a hit.
+  bool GetCachedTabletLocations(const std::string& tablet_id,
+                                master::ReplicaTypeFilter filter,
+                                int64_t metadata_version,
+                                int64_t ts_epoch,
+                                TabletLocationsPB* locs_pb);
+
+  // Inserts 'locs_pb' into the tablet locations cache, tagged with the
+  // tablet metadata version and registration epoch it was built from.
+  void CacheTabletLocations(const std::string& tablet_id,
+                            master::ReplicaTypeFilter filter,
+                            int64_t metadata_version,
+                            int64_t ts_epoch,
+                            const TabletLocationsPB& locs_pb);
+
+  // Discards all cached tablet locations. The leader lock must be held for
+  // writing.
+  void ResetTabletLocationsCache();
+
   // Looks up the table and locks it with the provided lock mode. If the table
   // does not exist an error status is returned, and the appropriate error code
   // is set in the response.
@@ -945,7 +968,13 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // easy to make a "gettable set".
 
   // Lock protecting the various maps and sets below.
-  typedef rw_spinlock LockType;
+  //
+  // The maps are read for every table and tablet lookup (e.g. by
+  // GetTableLocations() and tablet reports) but written only when tables
+  // or tablets are created or deleted, so readers take just the lock of
+  // the CPU they run on and don't contend with readers on other CPUs.
+  // Readers must use lock_.get_lock().
+  typedef percpu_rwlock LockType;
   mutable LockType lock_;
 
   // Table maps: table-id -> TableInfo and normalized-table-name -> TableInfo
@@ -984,6 +1013,13 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   std::unique_ptr<hms::HmsCatalog> hms_catalog_;
   std::unique_ptr<HmsNotificationLogListenerTask> hms_notification_log_listener_;
 
+  // Serialized TabletLocationsPBs built by BuildLocationsForTablet(), keyed by
+  // tablet ID and replica type filter. Null if the cache is disabled.
+  //
+  // The pointer itself is protected by leader_lock_; the cache is internally
+  // synchronized.
+  std::unique_ptr<Cache> tablet_locations_cache_;
+
   enum State {
     kConstructed,
     kStarting,
@@ -189,7 +189,7 @@ Status Master::StartAsync() {
   gscoped_ptr<ServiceIf> consensus_service(new ConsensusServiceImpl(
       this, catalog_manager_.get()));
   gscoped_ptr<ServiceIf> tablet_copy_service(new TabletCopyServiceImpl(
-      this, catalog_manager_.get()));
+      this, catalog_manager_.get(), nullptr /* no throttling */));
 
   RETURN_NOT_OK(RegisterService(std::move(impl)));
   RETURN_NOT_OK(RegisterService(std::move(consensus_service)));
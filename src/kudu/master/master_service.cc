@@ -230,6 +230,13 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
   // 4. Update tserver soft state based on the heartbeat contents.
   ts_desc->UpdateHeartbeatTime();
   ts_desc->set_num_live_replicas(req->num_live_tablets());
+  if (req->has_load()) {
+    TSDescriptor::Load load;
+    load.on_disk_size = req->load().on_disk_size();
+    load.rows_written_per_sec = req->load().rows_written_per_sec();
+    load.rows_scanned_per_sec = req->load().rows_scanned_per_sec();
+    ts_desc->set_load(load);
+  }
 
   // 5. Only leaders handle tablet reports.
   if (is_leader_master && req->has_tablet_report()) {
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -45,6 +46,9 @@ using std::string;
 using std::vector;
 using strings::Substitute;
 
+DECLARE_double(placement_on_disk_size_weight);
+DECLARE_double(placement_rows_scanned_weight);
+
 namespace kudu {
 namespace master {
 
@@ -286,6 +290,50 @@ TEST_F(PlacementPolicyTest, PlaceExtraTabletReplicaNoLoc) {
   }
 }
 
+// Verify that the resource usage of the replicas is taken into account when
+// configured, even if the tablet servers host the same number of replicas.
+TEST_F(PlacementPolicyTest, PlaceExtraTabletReplicaByResourceUsage) {
+  google::FlagSaver saver;
+  const vector<LocationInfo> cluster_info = {
+    { "", { { "ts0", 10 }, { "ts1", 10 }, } },
+  };
+  ASSERT_OK(Prepare(cluster_info));
+  const auto& all = descriptors();
+  TSDescriptor::Load heavy;
+  heavy.on_disk_size = 100L * 1024 * 1024 * 1024;
+  heavy.rows_scanned_per_sec = 1000000;
+  TSDescriptor::Load light;
+  light.on_disk_size = 1024 * 1024 * 1024;
+  light.rows_scanned_per_sec = 1000;
+
+  const auto place_extra_replica = [&](string* uuid) {
+    PlacementPolicy policy(all, rng());
+    shared_ptr<TSDescriptor> extra_ts;
+    RETURN_NOT_OK(policy.PlaceExtraTabletReplica({}, &extra_ts));
+    *uuid = extra_ts->permanent_uuid();
+    return Status::OK();
+  };
+
+  FLAGS_placement_on_disk_size_weight = 1;
+  all[0]->set_load(heavy);
+  all[1]->set_load(light);
+  for (auto i = 0; i < 5; ++i) {
+    string uuid;
+    ASSERT_OK(place_extra_replica(&uuid));
+    ASSERT_EQ("ts1", uuid);
+  }
+
+  FLAGS_placement_on_disk_size_weight = 0;
+  FLAGS_placement_rows_scanned_weight = 1;
+  all[0]->set_load(light);
+  all[1]->set_load(heavy);
+  for (auto i = 0; i < 5; ++i) {
+    string uuid;
+    ASSERT_OK(place_extra_replica(&uuid));
+    ASSERT_EQ("ts0", uuid);
+  }
+}
+
 TEST_F(PlacementPolicyTest, PlaceTabletReplicasNoLoc) {
   // 'No location case': expecting backward-compatible behavior with the
   // legacy (i.e. non-location-aware) logic.
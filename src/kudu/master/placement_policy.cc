@@ -17,6 +17,7 @@
 
 #include "kudu/master/placement_policy.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iterator>
 #include <limits>
@@ -30,13 +31,42 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/ts_descriptor.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/random.h"
 
+// A weight of W for a resource charges a tablet server whose usage of the
+// resource is at the cluster average as if it hosted W times the average
+// number of replicas per tablet server on top of its own replicas.
+DEFINE_double(placement_on_disk_size_weight, 0,
+              "Weight of the on-disk size of a tablet server's replicas, "
+              "relative to the cluster average, when determining the load of "
+              "the tablet server for placing new tablet replicas. "
+              "0 means ignoring the on-disk size.");
+TAG_FLAG(placement_on_disk_size_weight, experimental);
+TAG_FLAG(placement_on_disk_size_weight, runtime);
+
+DEFINE_double(placement_rows_written_weight, 0,
+              "Weight of the rate of rows written to a tablet server's replicas, "
+              "relative to the cluster average, when determining the load of "
+              "the tablet server for placing new tablet replicas. "
+              "0 means ignoring the write rate.");
+TAG_FLAG(placement_rows_written_weight, experimental);
+TAG_FLAG(placement_rows_written_weight, runtime);
+
+DEFINE_double(placement_rows_scanned_weight, 0,
+              "Weight of the rate of rows scanned from a tablet server's "
+              "replicas, relative to the cluster average, when determining the "
+              "load of the tablet server for placing new tablet replicas. "
+              "0 means ignoring the scan rate.");
+TAG_FLAG(placement_rows_scanned_weight, experimental);
+TAG_FLAG(placement_rows_scanned_weight, runtime);
+
 using std::multimap;
 using std::numeric_limits;
 using std::set;
@@ -51,15 +81,66 @@ namespace master {
 
 namespace {
 
-double GetTSLoad(TSDescriptor* desc) {
-  return desc->RecentReplicaCreations() + desc->num_live_replicas();
+// Returns 'weight' times the ratio of 'usage' to 'mean_usage', or 0 if there's
+// no usage to compare against.
+double WeightedUsage(double weight, double usage, double mean_usage) {
+  if (weight == 0 || mean_usage <= 0) {
+    return 0;
+  }
+  return weight * usage / mean_usage;
+}
+
+} // anonymous namespace
+
+PlacementPolicy::PlacementPolicy(TSDescriptorVector descs,
+                                 ThreadSafeRandom* rng)
+    : ts_num_(descs.size()),
+      rng_(rng),
+      mean_replicas_(0),
+      mean_on_disk_size_(0),
+      mean_rows_written_per_sec_(0),
+      mean_rows_scanned_per_sec_(0) {
+  CHECK(rng_);
+  for (auto& desc : descs) {
+    const auto load = desc->load();
+    mean_replicas_ += desc->num_live_replicas();
+    mean_on_disk_size_ += load.on_disk_size;
+    mean_rows_written_per_sec_ += load.rows_written_per_sec;
+    mean_rows_scanned_per_sec_ += load.rows_scanned_per_sec;
+    EmplaceOrDie(&known_ts_ids_, desc->permanent_uuid());
+    string location = desc->location() ? *desc->location() : "";
+    LookupOrEmplace(&ltd_, std::move(location),
+                    TSDescriptorVector()).emplace_back(std::move(desc));
+  }
+  if (ts_num_ > 0) {
+    mean_replicas_ /= ts_num_;
+    mean_on_disk_size_ /= ts_num_;
+    mean_rows_written_per_sec_ /= ts_num_;
+    mean_rows_scanned_per_sec_ /= ts_num_;
+  }
 }
 
-// Given exactly two choices in 'two_choices', pick the better tablet server on
-// which to place a tablet replica. Ties are broken using 'rng'.
-shared_ptr<TSDescriptor> PickBetterReplica(
-    const TSDescriptorVector& two_choices,
-    ThreadSafeRandom* rng) {
+double PlacementPolicy::GetResourceLoad(const TSDescriptor& desc) const {
+  const auto load = desc.load();
+  const double weighted_usage =
+      WeightedUsage(FLAGS_placement_on_disk_size_weight,
+                    load.on_disk_size, mean_on_disk_size_) +
+      WeightedUsage(FLAGS_placement_rows_written_weight,
+                    load.rows_written_per_sec, mean_rows_written_per_sec_) +
+      WeightedUsage(FLAGS_placement_rows_scanned_weight,
+                    load.rows_scanned_per_sec, mean_rows_scanned_per_sec_);
+  // Express the usage in replicas, so it's comparable with the replica counts
+  // even in a cluster with very few replicas.
+  return weighted_usage * std::max(mean_replicas_, 1.0);
+}
+
+double PlacementPolicy::GetTSLoad(TSDescriptor* desc) const {
+  return desc->RecentReplicaCreations() + desc->num_live_replicas() +
+      GetResourceLoad(*desc);
+}
+
+shared_ptr<TSDescriptor> PlacementPolicy::PickBetterReplica(
+    const TSDescriptorVector& two_choices) const {
   CHECK_EQ(2, two_choices.size());
 
   const auto& a = two_choices[0];
@@ -79,8 +160,10 @@ shared_ptr<TSDescriptor> PickBetterReplica(
   // we batch the selection process before sending any creation commands to the
   // servers themselves.
   //
-  // TODO(wdberkeley): in the future we may want to factor in other items such
-  // as available disk space, actual request load, etc.
+  // On top of that, the on-disk size and request rates of the replicas already
+  // on the server are accounted for, if configured by the --placement_*_weight
+  // flags. Servers hosting the same number of replicas may differ widely in
+  // how much data and traffic those replicas carry.
   double load_a = GetTSLoad(a.get());
   double load_b = GetTSLoad(b.get());
   if (load_a < load_b) {
@@ -90,22 +173,7 @@ shared_ptr<TSDescriptor> PickBetterReplica(
     return b;
   }
   // If the load is the same, we can just pick randomly.
-  return two_choices[rng->Uniform(2)];
-}
-
-} // anonymous namespace
-
-PlacementPolicy::PlacementPolicy(TSDescriptorVector descs,
-                                 ThreadSafeRandom* rng)
-    : ts_num_(descs.size()),
-      rng_(rng) {
-  CHECK(rng_);
-  for (auto& desc : descs) {
-    EmplaceOrDie(&known_ts_ids_, desc->permanent_uuid());
-    string location = desc->location() ? *desc->location() : "";
-    LookupOrEmplace(&ltd_, std::move(location),
-                    TSDescriptorVector()).emplace_back(std::move(desc));
-  }
+  return two_choices[rng_->Uniform(2)];
 }
 
 Status PlacementPolicy::PlaceTabletReplicas(int nreplicas,
@@ -181,11 +249,12 @@ double PlacementPolicy::GetLocationLoad(
   // among tablet servers in the specified location.
   const auto& ts_descriptors = FindOrDie(ltd_, location);
   CHECK(!ts_descriptors.empty());
-  // Count the number of already existing replicas at the specified location.
+  // Count the number of already existing replicas at the specified location,
+  // weighted by their resource usage.
   auto num_live_replicas = accumulate(
-        ts_descriptors.begin(), ts_descriptors.end(), 0,
-        [](int val, const shared_ptr<TSDescriptor>& desc) {
-          return val + desc->num_live_replicas();
+        ts_descriptors.begin(), ts_descriptors.end(), 0.0,
+        [this](double val, const shared_ptr<TSDescriptor>& desc) {
+          return val + desc->num_live_replicas() + GetResourceLoad(*desc);
         });
   // Add the number of to-be-replicas slated for the placement at the specified
   // location.
@@ -193,7 +262,7 @@ double PlacementPolicy::GetLocationLoad(
   if (location_rep_num_ptr) {
     num_live_replicas += *location_rep_num_ptr;
   }
-  return static_cast<double>(num_live_replicas) / ts_descriptors.size();
+  return num_live_replicas / ts_descriptors.size();
 }
 
 Status PlacementPolicy::SelectReplicaLocations(
@@ -285,7 +354,7 @@ shared_ptr<TSDescriptor> PlacementPolicy::SelectReplica(
 
   if (two_choices.size() == 2) {
     // Pick the better of the two.
-    return PickBetterReplica(two_choices, rng_);
+    return PickBetterReplica(two_choices);
   }
   if (two_choices.size() == 1) {
     return two_choices.front();
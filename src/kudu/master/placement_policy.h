@@ -100,8 +100,24 @@ class PlacementPolicy {
   friend class PlacementPolicyTest;
   FRIEND_TEST(PlacementPolicyTest, SelectLocationRandomnessForExtraReplica);
 
+  // Get the part of the load of the tablet server which stems from the
+  // resource usage of its replicas, as configured by the --placement_*_weight
+  // flags. The usage is measured relative to the cluster average and
+  // expressed in units of replicas.
+  double GetResourceLoad(const TSDescriptor& desc) const;
+
+  // Get the load of the tablet server: the number of its live and recently
+  // created replicas, plus its resource usage-based load.
+  double GetTSLoad(TSDescriptor* desc) const;
+
+  // Given exactly two choices in 'two_choices', pick the better tablet server
+  // on which to place a tablet replica. Ties are broken randomly.
+  std::shared_ptr<TSDescriptor> PickBetterReplica(
+      const TSDescriptorVector& two_choices) const;
+
   // Get the load of the location: a location with N tablet servers and
-  // R replicas has load R/N.
+  // R replicas has load R/N. Each replica is weighted by the resource usage
+  // of its tablet server, see GetResourceLoad().
   //
   // Parameters:
   //   'location'       The location in question.
@@ -164,6 +180,13 @@ class PlacementPolicy {
 
   // A set of known tablet server identifiers (derived from ltd_).
   std::unordered_set<std::string> known_ts_ids_;
+
+  // Averages of the number of live replicas and of the resource usage metrics
+  // over all available tablet servers.
+  double mean_replicas_;
+  double mean_on_disk_size_;
+  double mean_rows_written_per_sec_;
+  double mean_rows_scanned_per_sec_;
 };
 
 } // namespace master
@@ -15,8 +15,11 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -26,8 +29,10 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.pb.h"
@@ -38,7 +43,9 @@
 #include "kudu/security/cert.h"
 #include "kudu/security/crypto.h"
 #include "kudu/security/openssl_util.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/cow_object.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
@@ -54,7 +61,9 @@ using kudu::security::DataFormat;
 using kudu::security::PrivateKey;
 using std::shared_ptr;
 using std::string;
+using std::thread;
 using std::vector;
+using strings::Substitute;
 
 namespace google {
 namespace protobuf {
@@ -232,11 +241,16 @@ class TestTabletLoader : public TabletVisitor {
     TabletMetadataLock l(tablet.get(), LockMode::WRITE);
     l.mutable_data()->pb.CopyFrom(metadata);
     l.Commit();
+    std::lock_guard<simple_spinlock> tablets_lock(lock_);
     tablets.emplace_back(std::move(tablet));
     return Status::OK();
   }
 
   vector<scoped_refptr<TabletInfo>> tablets;
+
+ private:
+  // Protects 'tablets' when the tablets are visited on several threads.
+  simple_spinlock lock_;
 };
 
 // Create a new TabletInfo. The object is in uncommitted
@@ -340,6 +354,92 @@ TEST_F(SysCatalogTest, TestSysCatalogTabletsOperations) {
   }
 }
 
+// Test that concurrent UpdateTablets() calls all get persisted.
+// Test that visiting the tablets on several threads visits each tablet once.
+TEST_F(SysCatalogTest, TestVisitTabletsInParallel) {
+  SysCatalogTable* sys_catalog = master_->catalog_manager()->sys_catalog();
+  scoped_refptr<TableInfo> table(new TableInfo("abc"));
+  // Enough tablets to span several blocks of the scan.
+  const int kNumTablets = 2000;
+  vector<scoped_refptr<TabletInfo>> tablets;
+  for (int i = 0; i < kNumTablets; i++) {
+    tablets.emplace_back(CreateTablet(table, Substitute("$0", i),
+                                      Substitute("$0", i), Substitute("$0", i + 1)));
+  }
+  {
+    vector<std::unique_ptr<TabletMetadataLock>> locks;
+    for (const auto& tablet : tablets) {
+      locks.emplace_back(new TabletMetadataLock(tablet.get(), LockMode::WRITE));
+    }
+    SysCatalogTable::Actions actions;
+    actions.tablets_to_add = tablets;
+    ASSERT_OK(sys_catalog->Write(actions));
+  }
+
+  TestTabletLoader loader;
+  ASSERT_OK(sys_catalog->VisitTablets(&loader, 4));
+  ASSERT_EQ(kNumTablets, loader.tablets.size());
+  std::map<string, scoped_refptr<TabletInfo>> loaded;
+  for (const auto& tablet : loader.tablets) {
+    ASSERT_TRUE(loaded.emplace(tablet->id(), tablet).second) << tablet->id();
+  }
+  for (const auto& tablet : tablets) {
+    ASSERT_TRUE(MetadatasEqual(tablet, FindOrDie(loaded, tablet->id())));
+  }
+}
+
+TEST_F(SysCatalogTest, TestConcurrentUpdateTablets) {
+  const int kNumTablets = 16;
+  scoped_refptr<TableInfo> table(new TableInfo("abc"));
+  vector<scoped_refptr<TabletInfo>> tablets;
+  for (int i = 0; i < kNumTablets; i++) {
+    tablets.emplace_back(CreateTablet(table, Substitute("$0", 100 + i), "", ""));
+  }
+
+  SysCatalogTable* sys_catalog = master_->catalog_manager()->sys_catalog();
+  {
+    TabletMetadataGroupLock l(LockMode::RELEASED);
+    l.AddMutableInfos(tablets);
+    l.Lock(LockMode::WRITE);
+    SysCatalogTable::Actions actions;
+    actions.tablets_to_add = tablets;
+    ASSERT_OK(sys_catalog->Write(actions));
+    l.Commit();
+  }
+
+  // Update each tablet from its own thread, all at once.
+  CountDownLatch start(1);
+  vector<thread> threads;
+  vector<Status> statuses(kNumTablets);
+  for (int i = 0; i < kNumTablets; i++) {
+    threads.emplace_back([&, i]() {
+      start.Wait();
+      TabletMetadataLock l(tablets[i].get(), LockMode::WRITE);
+      l.mutable_data()->pb.set_state(SysTabletsEntryPB::RUNNING);
+      statuses[i] = sys_catalog->UpdateTablets({ tablets[i] });
+      if (statuses[i].ok()) {
+        l.Commit();
+      }
+    });
+  }
+  start.CountDown();
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (const auto& s : statuses) {
+    ASSERT_OK(s);
+  }
+
+  TestTabletLoader loader;
+  ASSERT_OK(sys_catalog->VisitTablets(&loader));
+  ASSERT_EQ(kNumTablets, loader.tablets.size());
+  for (int i = 0; i < kNumTablets; i++) {
+    ASSERT_TRUE(MetadatasEqual(tablets[i], loader.tablets[i]));
+    TabletMetadataLock l(loader.tablets[i].get(), LockMode::READ);
+    ASSERT_EQ(SysTabletsEntryPB::RUNNING, l.data().pb.state());
+  }
+}
+
 // Verify that data mutations are not available from metadata() until commit.
 TEST_F(SysCatalogTest, TestTabletInfoCommit) {
   scoped_refptr<TabletInfo> tablet(new TabletInfo(nullptr, "123"));
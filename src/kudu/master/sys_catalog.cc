@@ -22,6 +22,7 @@
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <set>
 #include <string>
@@ -82,6 +83,7 @@
 #include "kudu/util/faststring.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
@@ -89,6 +91,8 @@
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
+#include "kudu/util/trace.h"
 
 DEFINE_double(sys_catalog_fail_during_write, 0.0,
               "Fraction of the time when system table writes will fail");
@@ -107,6 +111,7 @@ using kudu::tablet::TabletReplica;
 using kudu::tserver::WriteRequestPB;
 using kudu::tserver::WriteResponsePB;
 using std::function;
+using std::pair;
 using std::set;
 using std::shared_ptr;
 using std::string;
@@ -161,7 +166,9 @@ SysCatalogTable::SysCatalogTable(Master* master,
     : metric_registry_(master->metric_registry()),
       master_(master),
       cmeta_manager_(new ConsensusMetadataManager(master_->fs_manager())),
-      leader_cb_(std::move(leader_cb)) {
+      leader_cb_(std::move(leader_cb)),
+      pending_updates_cond_(&pending_updates_lock_),
+      update_in_progress_(false) {
 }
 
 SysCatalogTable::~SysCatalogTable() {
@@ -521,6 +528,48 @@ Status SysCatalogTable::Write(const Actions& actions) {
   return Status::OK();
 }
 
+Status SysCatalogTable::UpdateTablets(const vector<scoped_refptr<TabletInfo>>& tablets) {
+  if (tablets.empty()) {
+    return Status::OK();
+  }
+
+  PendingTabletUpdates update(&tablets);
+  MutexLock l(pending_updates_lock_);
+  pending_updates_.push_back(&update);
+  while (update_in_progress_ && !update.done) {
+    pending_updates_cond_.Wait();
+  }
+  if (update.done) {
+    // Written by another caller as part of its batch.
+    return update.status;
+  }
+
+  // No write is in flight: write the updates of everyone who has queued up so
+  // far, including our own.
+  vector<PendingTabletUpdates*> batch;
+  batch.swap(pending_updates_);
+  update_in_progress_ = true;
+  l.Unlock();
+
+  Actions actions;
+  for (const PendingTabletUpdates* u : batch) {
+    actions.tablets_to_update.insert(actions.tablets_to_update.end(),
+                                     u->tablets->begin(), u->tablets->end());
+  }
+  TRACE("Writing $0 tablets from $1 coalesced updates",
+        actions.tablets_to_update.size(), batch.size());
+  const Status s = Write(actions);
+
+  l.Lock();
+  for (PendingTabletUpdates* u : batch) {
+    u->status = s;
+    u->done = true;
+  }
+  update_in_progress_ = false;
+  pending_updates_cond_.Broadcast();
+  return s;
+}
+
 // ==================================================================
 // Table related methods
 // ==================================================================
@@ -610,7 +659,8 @@ Status SysCatalogTable::GetEntryFromRow(
 // with each entry found.
 template<typename T, SysCatalogTable::CatalogEntryType entry_type>
 Status SysCatalogTable::ProcessRows(
-    function<Status(const string&, const T&)> processor) const {
+    function<Status(const string&, const T&)> processor,
+    int num_threads) const {
   const int type_col_idx = schema_.find_column(kSysCatalogTableColType);
   CHECK(type_col_idx != Schema::kColumnNotFound)
       << "cannot find sys catalog table column " << kSysCatalogTableColType
@@ -628,20 +678,83 @@ Status SysCatalogTable::ProcessRows(
 
   Arena arena(32 * 1024);
   RowBlock block(iter->schema(), 512, &arena);
-  while (iter->HasNext()) {
-    RETURN_NOT_OK(iter->NextBlock(&block));
+  if (num_threads <= 1) {
+    while (iter->HasNext()) {
+      RETURN_NOT_OK(iter->NextBlock(&block));
+      const size_t nrows = block.nrows();
+      for (size_t i = 0; i < nrows; ++i) {
+        if (!block.selection_vector()->IsRowSelected(i)) {
+          continue;
+        }
+        string entry_id;
+        T entry_data;
+        RETURN_NOT_OK(GetEntryFromRow(block.row(i), &entry_id, &entry_data));
+        RETURN_NOT_OK(processor(entry_id, entry_data));
+      }
+    }
+    return Status::OK();
+  }
+
+  // Copy the raw entries of each block out of the scan, and leave parsing and
+  // processing them to the pool while the next block is read.
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("catalog-load")
+                .set_max_threads(num_threads)
+                .Build(&pool));
+  const int id_col_idx = schema_.find_column(kSysCatalogTableColId);
+  const int data_col_idx = schema_.find_column(kSysCatalogTableColMetadata);
+  simple_spinlock status_lock;
+  Status first_error;  // Protected by 'status_lock'.
+  auto has_failed = [&]() {
+    std::lock_guard<simple_spinlock> l(status_lock);
+    return !first_error.ok();
+  };
+  auto record_error = [&](const Status& s) {
+    std::lock_guard<simple_spinlock> l(status_lock);
+    if (first_error.ok()) {
+      first_error = s;
+    }
+  };
+
+  Status s;
+  while (s.ok() && iter->HasNext() && !has_failed()) {
+    s = iter->NextBlock(&block);
+    if (!s.ok()) {
+      break;
+    }
+    auto entries = std::make_shared<vector<pair<string, string>>>();
     const size_t nrows = block.nrows();
+    entries->reserve(nrows);
     for (size_t i = 0; i < nrows; ++i) {
       if (!block.selection_vector()->IsRowSelected(i)) {
         continue;
       }
-      string entry_id;
-      T entry_data;
-      RETURN_NOT_OK(GetEntryFromRow(block.row(i), &entry_id, &entry_data));
-      RETURN_NOT_OK(processor(entry_id, entry_data));
+      RowBlockRow row = block.row(i);
+      entries->emplace_back(schema_.ExtractColumnFromRow<STRING>(row, id_col_idx)->ToString(),
+                            schema_.ExtractColumnFromRow<STRING>(row, data_col_idx)->ToString());
     }
+    s = pool->SubmitFunc([&processor, &record_error, entries]() {
+      for (const auto& entry : *entries) {
+        T entry_data;
+        Status entry_status = pb_util::ParseFromArray(
+            &entry_data, reinterpret_cast<const uint8_t*>(entry.second.data()),
+            entry.second.size());
+        if (!entry_status.ok()) {
+          record_error(entry_status.CloneAndPrepend(
+              "unable to parse metadata field for row " + entry.first));
+          return;
+        }
+        entry_status = processor(entry.first, entry_data);
+        if (!entry_status.ok()) {
+          record_error(entry_status);
+          return;
+        }
+      }
+    });
   }
-  return Status::OK();
+  pool->Wait();
+  RETURN_NOT_OK(s);
+  return first_error;
 }
 
 Status SysCatalogTable::VisitTskEntries(TskEntryVisitor* visitor) {
@@ -827,7 +940,7 @@ void SysCatalogTable::ReqSetNotificationLogEventId(WriteRequestPB* req, int64_t
   enc.Add(RowOperationsPB::UPSERT, row);
 }
 
-Status SysCatalogTable::VisitTablets(TabletVisitor* visitor) {
+Status SysCatalogTable::VisitTablets(TabletVisitor* visitor, int num_threads) {
   TRACE_EVENT0("master", "SysCatalogTable::VisitTablets");
   auto processor = [&](
       const string& entry_id,
@@ -845,7 +958,7 @@ Status SysCatalogTable::VisitTablets(TabletVisitor* visitor) {
     metadata.clear_deprecated_end_key();
     return visitor->VisitTablet(metadata.table_id(), entry_id, metadata);
   };
-  return ProcessRows<SysTabletsEntryPB, TABLETS_ENTRY>(processor);
+  return ProcessRows<SysTabletsEntryPB, TABLETS_ENTRY>(processor, num_threads);
 }
 
 void SysCatalogTable::InitLocalRaftPeerPB() {
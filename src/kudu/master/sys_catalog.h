@@ -34,6 +34,8 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -163,11 +165,24 @@ class SysCatalogTable {
   };
   Status Write(const Actions& actions);
 
+  // Persists the dirty state of 'tablets', like a Write() of Actions with only
+  // 'tablets_to_update' set. Concurrent callers are coalesced: while one write
+  // is in flight, the tablets of further callers are queued and then written
+  // together in a single WriteTransaction.
+  //
+  // The caller must hold the tablets' write locks until this returns, which
+  // guarantees that coalesced callers never update the same tablet.
+  Status UpdateTablets(const std::vector<scoped_refptr<TabletInfo>>& tablets);
+
   // Scan of the table-related entries.
   Status VisitTables(TableVisitor* visitor);
 
   // Scan of the tablet-related entries.
-  Status VisitTablets(TabletVisitor* visitor);
+  //
+  // If 'num_threads' is greater than 1, the entries are decoded and visited
+  // on that many threads while the scan reads ahead, in which case 'visitor'
+  // must be thread-safe.
+  Status VisitTablets(TabletVisitor* visitor, int num_threads = 1);
 
   // Scan for TSK-related entries in the system table.
   Status VisitTskEntries(TskEntryVisitor* visitor);
@@ -241,8 +256,11 @@ class SysCatalogTable {
   Status GetEntryFromRow(const RowBlockRow& row,
                          std::string* entry_id, T* entry_data) const;
 
+  // Runs 'processor' on every entry of type 'entry_type', on 'num_threads'
+  // threads if it's greater than 1.
   template<typename T, CatalogEntryType entry_type>
-  Status ProcessRows(std::function<Status(const std::string&, const T&)>) const;
+  Status ProcessRows(std::function<Status(const std::string&, const T&)> processor,
+                     int num_threads = 1) const;
 
   // Tablet related private methods.
 
@@ -289,6 +307,30 @@ class SysCatalogTable {
   ElectedLeaderCallback leader_cb_;
 
   consensus::RaftPeerPB local_peer_pb_;
+
+  // A caller of UpdateTablets() whose tablets have yet to be written.
+  struct PendingTabletUpdates {
+    explicit PendingTabletUpdates(const std::vector<scoped_refptr<TabletInfo>>* tablets)
+        : tablets(tablets),
+          done(false) {
+    }
+
+    const std::vector<scoped_refptr<TabletInfo>>* tablets;
+    Status status;
+    bool done;
+  };
+
+  // Protects the UpdateTablets() state below.
+  Mutex pending_updates_lock_;
+
+  // Signaled whenever a coalesced write of pending updates completes.
+  ConditionVariable pending_updates_cond_;
+
+  // Updates queued while a coalesced write was in flight.
+  std::vector<PendingTabletUpdates*> pending_updates_;
+
+  // Whether a coalesced write is in flight.
+  bool update_in_progress_;
 };
 
 } // namespace master
@@ -59,6 +59,16 @@ namespace master {
 // This class is thread-safe.
 class TSDescriptor : public enable_make_shared<TSDescriptor> {
  public:
+  // Resource usage of the live replicas on a tablet server.
+  struct Load {
+    // Estimated total on-disk size of the replicas, in bytes.
+    int64_t on_disk_size = 0;
+
+    // Rows written to and scanned from the replicas per second.
+    double rows_written_per_sec = 0;
+    double rows_scanned_per_sec = 0;
+  };
+
   static Status RegisterNew(const NodeInstancePB& instance,
                             const ServerRegistrationPB& registration,
                             std::shared_ptr<TSDescriptor>* desc);
@@ -120,6 +130,18 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
     return num_live_replicas_;
   }
 
+  // Set the resource usage of the live replicas, from the last heartbeat.
+  void set_load(const Load& load) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    load_ = load;
+  }
+
+  // Return the resource usage of the live replicas.
+  Load load() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return load_;
+  }
+
   // Return the location of the tablet server. This returns a safe copy
   // since the location could change at any time if the tablet server
   // re-registers.
@@ -165,6 +187,10 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
   // The number of live replicas on this host, from the last heartbeat.
   int num_live_replicas_;
 
+  // The resource usage of the live replicas on this host, from the last
+  // heartbeat.
+  Load load_;
+
   // The tablet server's location, as determined by the master at registration.
   boost::optional<std::string> location_;
 
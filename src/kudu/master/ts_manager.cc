@@ -49,7 +49,8 @@ using strings::Substitute;
 namespace kudu {
 namespace master {
 
-TSManager::TSManager(const scoped_refptr<MetricEntity>& metric_entity) {
+TSManager::TSManager(const scoped_refptr<MetricEntity>& metric_entity)
+    : registration_epoch_(0) {
   METRIC_cluster_replica_skew.InstantiateFunctionGauge(
       metric_entity,
       Bind(&TSManager::ClusterSkew, Unretained(this)))
@@ -105,6 +106,7 @@ Status TSManager::RegisterTS(const NodeInstancePB& instance,
                             found->ToString());
     desc->swap(found);
   }
+  registration_epoch_.Increment(kMemOrderRelease);
 
   return Status::OK();
 }
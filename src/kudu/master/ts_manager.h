@@ -17,6 +17,7 @@
 #ifndef KUDU_MASTER_TS_MANAGER_H
 #define KUDU_MASTER_TS_MANAGER_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -24,6 +25,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/master/ts_descriptor.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
@@ -81,6 +83,14 @@ class TSManager {
   // Get the TS count.
   int GetCount() const;
 
+  // Returns a number which changes whenever a tablet server registers or
+  // re-registers, i.e. whenever the registration or location returned by
+  // any TSDescriptor may have changed. Data derived from the registrations
+  // may be cached along with the epoch it was built in.
+  int64_t registration_epoch() const {
+    return registration_epoch_.Load(kMemOrderAcquire);
+  }
+
  private:
   int ClusterSkew() const;
 
@@ -92,6 +102,8 @@ class TSManager {
     std::string, std::shared_ptr<TSDescriptor>> TSDescriptorMap;
   TSDescriptorMap servers_by_id_;
 
+  AtomicInt<int64_t> registration_epoch_;
+
   DISALLOW_COPY_AND_ASSIGN(TSManager);
 };
 
@@ -28,6 +28,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/reactor.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
@@ -65,10 +66,11 @@ namespace kudu {
 namespace rpc {
 
 AcceptorPool::AcceptorPool(Messenger* messenger, Socket* socket,
-                           Sockaddr bind_address)
+                           Sockaddr bind_address, int reactor_idx)
     : messenger_(messenger),
       socket_(socket->Release()),
       bind_address_(bind_address),
+      reactor_idx_(reactor_idx),
       rpc_connections_accepted_(METRIC_rpc_connections_accepted.Instantiate(
           messenger->metric_entity())),
       closing_(false) {}
@@ -144,6 +146,7 @@ int64_t AcceptorPool::num_rpc_connections_accepted() const {
 }
 
 void AcceptorPool::RunThread() {
+  WARN_NOT_OK(BindThreadToReactorCpus(reactor_idx_), "could not pin acceptor thread");
   while (true) {
     Socket new_sock;
     Sockaddr remote;
@@ -166,7 +169,7 @@ void AcceptorPool::RunThread() {
       continue;
     }
     rpc_connections_accepted_->Increment();
-    messenger_->RegisterInboundSocket(&new_sock, remote);
+    messenger_->RegisterInboundSocket(&new_sock, remote, reactor_idx_);
   }
   VLOG(1) << "AcceptorPool shutting down.";
 }
@@ -45,7 +45,12 @@ class AcceptorPool {
   // Create a new acceptor pool.  Calls socket::Release to take ownership of the
   // socket.
   // 'socket' must be already bound, but should not yet be listening.
-  AcceptorPool(Messenger *messenger, Socket *socket, Sockaddr bind_address);
+  //
+  // If 'reactor_idx' is not -1, every connection accepted by the pool is
+  // handled by the messenger's reactor with that index, and the pool's threads
+  // are pinned to the same CPUs as that reactor.
+  AcceptorPool(Messenger *messenger, Socket *socket, Sockaddr bind_address,
+               int reactor_idx = -1);
   ~AcceptorPool();
 
   // Start listening and accepting connections.
@@ -70,6 +75,7 @@ class AcceptorPool {
   Messenger *messenger_;
   Socket socket_;
   Sockaddr bind_address_;
+  const int reactor_idx_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
 
   scoped_refptr<Counter> rpc_connections_accepted_;
@@ -28,6 +28,7 @@
 #include <boost/intrusive/detail/list_iterator.hpp>
 #include <boost/intrusive/list.hpp>
 #include <ev.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
@@ -42,10 +43,46 @@
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/status.h"
 
+DEFINE_int64(rpc_zero_copy_min_response_bytes, 0,
+             "RPC responses of at least this many bytes, e.g. scan responses "
+             "carrying row data in sidecars, are sent with MSG_ZEROCOPY where "
+             "the kernel supports it (Linux 4.14 and newer), so that the "
+             "kernel sends them from their buffers in place instead of copying "
+             "them. Not used on TLS-encrypted connections. Takes effect for "
+             "new connections. 0 disables zero-copy sends.");
+TAG_FLAG(rpc_zero_copy_min_response_bytes, experimental);
+
+DEFINE_string(rpc_compression_codec, "none",
+              "Codec with which RPC main messages and sidecars are compressed "
+              "on connections whose remote end can uncompress it. "
+              "One of 'none', 'lz4' or 'zstd'. Takes effect for new connections.");
+TAG_FLAG(rpc_compression_codec, experimental);
+
+DEFINE_int64(rpc_compression_min_bytes, 64 * 1024,
+             "RPC main messages which, together with their sidecars, are at "
+             "least this many bytes are compressed with the codec set by "
+             "--rpc_compression_codec. Smaller ones are sent as-is.");
+TAG_FLAG(rpc_compression_min_bytes, experimental);
+TAG_FLAG(rpc_compression_min_bytes, runtime);
+
+static bool ValidateRpcCompressionCodec(const char* flag_name, const std::string& flag_value) {
+  kudu::CompressionType type = kudu::GetCompressionCodecType(flag_value);
+  if (type == kudu::NO_COMPRESSION || type == kudu::LZ4 || type == kudu::ZSTD) {
+    return true;
+  }
+  LOG(ERROR) << "Invalid value for --" << flag_name << ": '" << flag_value
+             << "'; must be one of 'none', 'lz4' or 'zstd'";
+  return false;
+}
+DEFINE_validator(rpc_compression_codec, &ValidateRpcCompressionCodec);
+
 using std::includes;
 using std::set;
 using std::shared_ptr;
@@ -57,6 +94,33 @@ namespace rpc {
 
 typedef OutboundCall::Phase Phase;
 
+namespace {
+
+// Returns the codec configured by --rpc_compression_codec if the remote end,
+// which advertised 'remote_features', can uncompress it, or nullptr otherwise.
+const CompressionCodec* ChooseCompressionCodec(const set<RpcFeatureFlag>& remote_features) {
+  CompressionType type = GetCompressionCodecType(FLAGS_rpc_compression_codec);
+  RpcFeatureFlag feature;
+  switch (type) {
+    case LZ4:
+      feature = LZ4_COMPRESSION;
+      break;
+    case ZSTD:
+      feature = ZSTD_COMPRESSION;
+      break;
+    default:
+      return nullptr;
+  }
+  if (!ContainsKey(remote_features, feature)) {
+    return nullptr;
+  }
+  const CompressionCodec* codec;
+  CHECK_OK(GetCompressionCodec(type, &codec));
+  return codec;
+}
+
+} // anonymous namespace
+
 ///
 /// Connection
 ///
@@ -71,6 +135,9 @@ Connection::Connection(ReactorThread *reactor_thread,
       direction_(direction),
       last_activity_time_(MonoTime::Now()),
       is_epoll_registered_(false),
+      zero_copy_enabled_(false),
+      next_zero_copy_id_(0),
+      compression_codec_(nullptr),
       next_call_id_(1),
       credentials_policy_(policy),
       negotiation_complete_(false),
@@ -101,6 +168,7 @@ void Connection::EpollRegister(ev::loop_ref& loop) {
 Connection::~Connection() {
   // Must clear the outbound_transfers_ list before deleting.
   CHECK(outbound_transfers_.begin() == outbound_transfers_.end());
+  CHECK(zero_copy_transfers_.empty());
 
   // It's crucial that the connection is Shutdown first -- otherwise
   // our destructor will end up calling read_io_.stop() and write_io_.stop()
@@ -120,6 +188,10 @@ bool Connection::Idle() const {
   if (!outbound_transfers_.empty()) {
     return false;
   }
+  // or wait for the kernel to finish sending something
+  if (!zero_copy_transfers_.empty()) {
+    return false;
+  }
   // can't kill a connection if calls are waiting response
   if (!awaiting_response_.empty()) {
     return false;
@@ -171,6 +243,17 @@ void Connection::Shutdown(const Status &status,
   }
   awaiting_response_.clear();
 
+  // Clear any transfers waiting for zero-copy sends to complete. The kernel
+  // holds its own references to the pages being sent, so the buffers may be
+  // freed. Transfers which are still being sent are owned (and deleted
+  // below) by 'outbound_transfers_'.
+  for (const auto& zt : zero_copy_transfers_) {
+    if (zt.transfer->TransferFinished()) {
+      delete zt.transfer;
+    }
+  }
+  zero_copy_transfers_.clear();
+
   // Clear any outbound transfers.
   while (!outbound_transfers_.empty()) {
     OutboundTransfer *t = &outbound_transfers_.front();
@@ -212,19 +295,20 @@ Connection::CallAwaitingResponse::~CallAwaitingResponse() {
   DCHECK(conn->reactor_thread_->IsCurrentThread());
 }
 
-void Connection::CallAwaitingResponse::HandleTimeout(ev::timer &watcher, int revents) {
-  if (remaining_timeout > 0) {
-    if (watcher.remaining() < -1.0) {
+void Connection::CallAwaitingResponse::HandleTimeout() {
+  if (remaining_timeout.ToNanoseconds() > 0) {
+    MonoTime now = MonoTime::Now();
+    MonoDelta delay = now - timeout_entry.deadline();
+    if (delay.ToSeconds() > 1.0) {
       LOG(WARNING) << "RPC call timeout handler was delayed by "
-                   << -watcher.remaining() << "s! This may be due to a process-wide "
+                   << delay.ToSeconds() << "s! This may be due to a process-wide "
                    << "pause such as swapping, logging-related delays, or allocator lock "
                    << "contention. Will allow an additional "
-                   << remaining_timeout << "s for a response.";
+                   << remaining_timeout.ToSeconds() << "s for a response.";
     }
 
-    watcher.set(remaining_timeout, 0);
-    watcher.start();
-    remaining_timeout = 0;
+    conn->reactor_thread_->ScheduleTimeout(&timeout_entry, now + remaining_timeout);
+    remaining_timeout = MonoDelta::FromNanoseconds(0);
     return;
   }
 
@@ -234,7 +318,7 @@ void Connection::CallAwaitingResponse::HandleTimeout(ev::timer &watcher, int rev
 void Connection::HandleOutboundCallTimeout(CallAwaitingResponse *car) {
   DCHECK(reactor_thread_->IsCurrentThread());
   DCHECK(car->call);
-  // The timeout timer is stopped by the car destructor exiting Connection::HandleCallResponse()
+  // The timeout entry is cancelled by the car destructor exiting Connection::HandleCallResponse()
   DCHECK(!car->call->IsFinished());
 
   // Mark the call object as failed.
@@ -332,7 +416,8 @@ void Connection::QueueOutboundCall(shared_ptr<OutboundCall> call) {
 
   // Serialize the actual bytes to be put on the wire.
   TransferPayload tmp_slices;
-  size_t n_slices = call->SerializeTo(&tmp_slices);
+  size_t n_slices = call->SerializeTo(&tmp_slices,
+                                      OutboundCompressionCodec(call->payload_size()));
 
   call->SetQueued();
 
@@ -343,11 +428,10 @@ void Connection::QueueOutboundCall(shared_ptr<OutboundCall> call) {
   car->conn = this;
   car->call = call;
 
-  // Set up the timeout timer.
+  // Set up the timeout on the reactor's timer wheel.
   const MonoDelta &timeout = call->controller()->timeout();
   if (timeout.Initialized()) {
-    reactor_thread_->RegisterTimeout(&car->timeout_timer);
-    car->timeout_timer.set<CallAwaitingResponse, // NOLINT(*)
+    car->timeout_entry.set<CallAwaitingResponse, // NOLINT(*)
                            &CallAwaitingResponse::HandleTimeout>(car.get());
 
     // For calls with a timeout of at least 500ms, we actually run the timeout
@@ -375,16 +459,16 @@ void Connection::QueueOutboundCall(shared_ptr<OutboundCall> call) {
     //
     // We don't bother with this logic for calls with very short timeouts - assumedly
     // a user setting such a short RPC timeout is well equipped to handle one.
-    double time = timeout.ToSeconds();
-    if (time >= 0.5) {
-      car->remaining_timeout = time * 0.1;
-      time -= car->remaining_timeout;
+    const int64_t nanos = timeout.ToNanoseconds();
+    MonoDelta time = timeout;
+    if (timeout.ToSeconds() >= 0.5) {
+      car->remaining_timeout = MonoDelta::FromNanoseconds(nanos / 10);
+      time = MonoDelta::FromNanoseconds(nanos - nanos / 10);
     } else {
-      car->remaining_timeout = 0;
+      car->remaining_timeout = MonoDelta::FromNanoseconds(0);
     }
 
-    car->timeout_timer.set(time, 0);
-    car->timeout_timer.start();
+    reactor_thread_->ScheduleTimeout(&car->timeout_entry, MonoTime::Now() + time);
   }
 
   TransferCallbacks *cb = new CallTransferCallbacks(std::move(call), this);
@@ -479,6 +563,15 @@ void Connection::set_confidential(bool is_confidential) {
   is_confidential_ = is_confidential;
 }
 
+const CompressionCodec* Connection::OutboundCompressionCodec(size_t size) const {
+  DCHECK(negotiation_complete_);
+  if (compression_codec_ == nullptr ||
+      static_cast<int64_t>(size) < FLAGS_rpc_compression_min_bytes) {
+    return nullptr;
+  }
+  return compression_codec_;
+}
+
 bool Connection::SatisfiesCredentialsPolicy(CredentialsPolicy policy) const {
   DCHECK_EQ(direction_, CLIENT);
   return (policy == CredentialsPolicy::ANY_CREDENTIALS) ||
@@ -500,6 +593,17 @@ void Connection::ReadHandler(ev::io &watcher, int revents) {
   }
   last_activity_time_ = reactor_thread_->cur_time();
 
+  // Zero-copy completions are signalled by the socket reporting an error,
+  // which libev delivers as readability.
+  if (!zero_copy_transfers_.empty()) {
+    Status s = HandleZeroCopyCompletions();
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << ToString() << " error reading zero-copy completions: " << s.ToString();
+      reactor_thread_->DestroyConnection(this, s);
+      return;
+    }
+  }
+
   while (true) {
     if (!inbound_) {
       inbound_.reset(new InboundTransfer());
@@ -576,7 +680,7 @@ void Connection::HandleCallResponse(gscoped_ptr<InboundTransfer> transfer) {
     return;
   }
 
-  // The car->timeout_timer ev::timer will be stopped automatically by its destructor.
+  // The car->timeout_entry will be cancelled automatically by its destructor.
   scoped_car car(car_pool_.make_scoped_ptr(car_ptr));
 
   if (PREDICT_FALSE(!car->call)) {
@@ -653,7 +757,16 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
     }
 
     last_activity_time_ = reactor_thread_->cur_time();
-    Status status = transfer->SendBuffer(*socket_);
+    bool zero_copy = zero_copy_enabled_ && !transfer->is_for_outbound_call() &&
+        transfer->TotalLength() >= FLAGS_rpc_zero_copy_min_response_bytes;
+    const int32_t zero_copy_sends_before = transfer->num_zero_copy_sends();
+    Status status = transfer->SendBuffer(*socket_, zero_copy);
+    if (transfer->num_zero_copy_sends() > zero_copy_sends_before) {
+      if (zero_copy_sends_before == 0) {
+        zero_copy_transfers_.push_back({ transfer, next_zero_copy_id_, 0 });
+      }
+      next_zero_copy_id_ += transfer->num_zero_copy_sends() - zero_copy_sends_before;
+    }
     if (PREDICT_FALSE(!status.ok())) {
       LOG(WARNING) << ToString() << " send error: " << status.ToString();
       reactor_thread_->DestroyConnection(this, status);
@@ -666,7 +779,14 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
     }
 
     outbound_transfers_.pop_front();
-    delete transfer;
+    if (transfer->num_zero_copy_sends() == 0) {
+      delete transfer;
+    } else {
+      // 'zero_copy_transfers_' now owns the transfer. All of its zero-copy
+      // sends may have completed while it was still writing, e.g. if it fell
+      // back to copying, in which case no further notification will come.
+      CompleteZeroCopyTransfers();
+    }
   }
 
   // If we were able to write all of our outbound transfers,
@@ -725,7 +845,70 @@ void Connection::CompleteNegotiation(Status negotiation_status,
 
 void Connection::MarkNegotiationComplete() {
   DCHECK(reactor_thread_->IsCurrentThread());
+  compression_codec_ = ChooseCompressionCodec(remote_features_);
   negotiation_complete_ = true;
+  if (direction_ == SERVER && FLAGS_rpc_zero_copy_min_response_bytes > 0) {
+    Status s = socket_->EnableZeroCopy();
+    if (s.ok()) {
+      zero_copy_enabled_ = true;
+    } else {
+      VLOG(1) << ToString() << ": not using zero-copy sends: " << s.ToString();
+    }
+  }
+}
+
+Status Connection::HandleZeroCopyCompletions() {
+  DCHECK(reactor_thread_->IsCurrentThread());
+  while (!zero_copy_transfers_.empty()) {
+    bool found;
+    uint32_t lo;
+    uint32_t hi;
+    bool copied;
+    RETURN_NOT_OK(socket_->RecvZeroCopyCompletion(&found, &lo, &hi, &copied));
+    if (!found) {
+      break;
+    }
+    if (copied && zero_copy_enabled_) {
+      // This happens e.g. on loopback connections, or with network devices
+      // which can't send from user memory. The kernel then copies the data
+      // after all, and the notifications just add overhead.
+      VLOG(1) << ToString() << ": kernel copied zero-copy sends, disabling them";
+      zero_copy_enabled_ = false;
+    }
+
+    // Notification IDs are compared relative to the oldest outstanding one
+    // so that wrapping around 32 bits doesn't matter.
+    const uint32_t base = zero_copy_transfers_.front().first_id;
+    const int64_t range_lo = static_cast<uint32_t>(lo - base);
+    const int64_t range_hi = static_cast<uint32_t>(hi - base);
+    for (auto& zt : zero_copy_transfers_) {
+      const int64_t first = static_cast<uint32_t>(zt.first_id - base);
+      const int64_t last = first + zt.transfer->num_zero_copy_sends() - 1;
+      const int64_t overlap = std::min(last, range_hi) - std::max(first, range_lo) + 1;
+      if (overlap > 0) {
+        zt.num_completed += overlap;
+      }
+    }
+
+    CompleteZeroCopyTransfers();
+  }
+  return Status::OK();
+}
+
+void Connection::CompleteZeroCopyTransfers() {
+  DCHECK(reactor_thread_->IsCurrentThread());
+  // Completions normally arrive in order, but that isn't guaranteed.
+  for (auto it = zero_copy_transfers_.begin(); it != zero_copy_transfers_.end();) {
+    OutboundTransfer* transfer = it->transfer;
+    if (transfer->TransferFinished() &&
+        it->num_completed == transfer->num_zero_copy_sends()) {
+      transfer->ZeroCopySendsCompleted();
+      delete transfer;
+      it = zero_copy_transfers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
 }
 
 Status Connection::DumpPB(const DumpRunningRpcsRequestPB& req,
@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <limits>
 #include <memory>
 #include <set>
@@ -39,6 +40,7 @@
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/remote_user.h"
+#include "kudu/rpc/timer_wheel.h"
 #include "kudu/rpc/transfer.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
@@ -48,6 +50,8 @@
 
 namespace kudu {
 
+class CompressionCodec;
+
 namespace rpc {
 
 class DumpRunningRpcsRequestPB;
@@ -157,6 +161,11 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // Set/unset the 'confidentiality' property for this connection.
   void set_confidential(bool is_confidential);
 
+  // Returns the codec with which to compress a main message and sidecars of
+  // 'size' bytes sent on this connection, or nullptr to send them as-is.
+  // May be called from any thread once negotiation is complete.
+  const CompressionCodec* OutboundCompressionCodec(size_t size) const;
+
   // Credentials policy to start connection negotiation.
   CredentialsPolicy credentials_policy() const { return credentials_policy_; }
 
@@ -248,21 +257,40 @@ class Connection : public RefCountedThreadSafe<Connection> {
   struct CallAwaitingResponse {
     ~CallAwaitingResponse();
 
-    // Notification from libev that the call has timed out.
-    void HandleTimeout(ev::timer &watcher, int revents);
+    // Notification from the reactor's timer wheel that the call has timed
+    // out.
+    void HandleTimeout();
 
     Connection *conn;
     std::shared_ptr<OutboundCall> call;
-    ev::timer timeout_timer;
+
+    // The deadline of the call on the reactor's timer wheel, cancelled when
+    // the CallAwaitingResponse is destroyed.
+    TimerWheelEntry timeout_entry;
 
     // We time out RPC calls in two stages. This is set to the amount of timeout
     // remaining after the next timeout fires. See Connection::QueueOutboundCall().
-    double remaining_timeout;
+    MonoDelta remaining_timeout;
   };
 
   typedef std::unordered_map<uint64_t, CallAwaitingResponse*> car_map_t;
   typedef std::unordered_map<uint64_t, InboundCall*> inbound_call_map_t;
 
+  // A response transfer which made zero-copy sends, and whose buffers must
+  // stay alive until the kernel reports that all of those sends completed.
+  struct ZeroCopyTransfer {
+    // While the transfer is still sending, it's owned by
+    // 'outbound_transfers_'. Afterwards it's owned by this entry.
+    OutboundTransfer* transfer;
+
+    // Notification ID of the transfer's first zero-copy send. The IDs of its
+    // other sends follow consecutively.
+    uint32_t first_id;
+
+    // Number of the transfer's zero-copy sends which have completed.
+    int32_t num_completed;
+  };
+
   // Returns the next valid (positive) sequential call ID by incrementing a counter
   // and ensuring we roll over from INT32_MAX to 0.
   // Negative numbers are reserved for special purposes.
@@ -294,6 +322,14 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // This must be called from the reactor thread.
   void QueueOutbound(gscoped_ptr<OutboundTransfer> transfer);
 
+  // Reads the zero-copy completion notifications queued on the socket, and
+  // completes the transfers in 'zero_copy_transfers_' whose sends are done.
+  Status HandleZeroCopyCompletions();
+
+  // Completes the finished transfers in 'zero_copy_transfers_' whose
+  // zero-copy sends have all completed.
+  void CompleteZeroCopyTransfers();
+
   // Internal test function for injecting cancellation request when 'call'
   // reaches state specified in 'FLAGS_rpc_inject_cancellation_state'.
   void MaybeInjectCancellation(const std::shared_ptr<OutboundCall> &call);
@@ -337,6 +373,22 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // waiting to be sent
   boost::intrusive::list<OutboundTransfer> outbound_transfers_; // NOLINT(*)
 
+  // Transfers with outstanding zero-copy sends, in the order they were sent.
+  std::deque<ZeroCopyTransfer> zero_copy_transfers_;
+
+  // Whether large responses are sent with zero-copy sends. Only set on the
+  // server side, and cleared if the kernel turns out to copy them anyway.
+  bool zero_copy_enabled_;
+
+  // The notification ID which the kernel will assign to the next zero-copy
+  // send on the socket.
+  uint32_t next_zero_copy_id_;
+
+  // The codec with which messages sent on this connection are compressed, or
+  // nullptr if the remote end can't uncompress the one configured by
+  // --rpc_compression_codec. Set when negotiation completes.
+  const CompressionCodec* compression_codec_;
+
   // Calls which have been sent and are now waiting for a response.
   car_map_t awaiting_response_;
 
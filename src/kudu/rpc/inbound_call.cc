@@ -21,6 +21,7 @@
 #include <memory>
 #include <ostream>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <google/protobuf/message.h>
 #include <google/protobuf/message_lite.h>
@@ -34,11 +35,15 @@
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/trace.h"
 
+DECLARE_bool(rpc_dump_all_traces);
+
 namespace google {
 namespace protobuf {
 class FieldDescriptor;
@@ -58,7 +63,8 @@ namespace rpc {
 
 InboundCall::InboundCall(Connection* conn)
   : conn_(conn),
-    trace_(new Trace),
+    trace_(PREDICT_FALSE(FLAGS_rpc_dump_all_traces) ? make_scoped_refptr(new Trace)
+                                                    : Trace::NewSampled()),
     method_info_(nullptr),
     deadline_(MonoTime::Max()) {
   RecordCallReceived();
@@ -92,6 +98,15 @@ Status InboundCall::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
             header_.sidecar_offsets_size(), TransferLimits::kMaxSidecars));
   }
 
+  if (header_.has_compression() && header_.compression() != NO_COMPRESSION) {
+    const CompressionCodec* codec;
+    RETURN_NOT_OK_PREPEND(GetCompressionCodec(header_.compression(), &codec),
+                          "Invalid packet: unknown compression codec");
+    RETURN_NOT_OK(serialization::UncompressMainMessage(
+        *codec, serialized_request_, header_.uncompressed_size(), &uncompressed_request_));
+    serialized_request_ = Slice(uncompressed_request_);
+  }
+
   RETURN_NOT_OK(RpcSidecar::ParseSidecars(
           header_.sidecar_offsets(), serialized_request_, inbound_sidecar_slices_));
   if (header_.sidecar_offsets_size() > 0) {
@@ -193,6 +208,26 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
   serialization::SerializeMessage(response, &response_msg_buf_,
                                   sidecar_byte_size, true);
   int64_t main_msg_size = sidecar_byte_size + response_msg_buf_.size();
+
+  // Compress the response here, on the worker thread, rather than in the
+  // reactor thread which sends it.
+  const CompressionCodec* codec = conn_->OutboundCompressionCodec(main_msg_size);
+  if (codec) {
+    vector<Slice> sidecar_slices;
+    sidecar_slices.reserve(outbound_sidecars_.size());
+    for (const unique_ptr<RpcSidecar>& car : outbound_sidecars_) {
+      sidecar_slices.emplace_back(car->AsSlice());
+    }
+    uint32_t uncompressed_size;
+    if (serialization::CompressMainMessage(*codec, response_msg_buf_, sidecar_slices,
+                                           &compressed_response_buf_, &uncompressed_size)) {
+      resp_hdr.set_compression(codec->type());
+      resp_hdr.set_uncompressed_size(uncompressed_size);
+      main_msg_size = compressed_response_buf_.size();
+    } else {
+      compressed_response_buf_.clear();
+    }
+  }
   serialization::SerializeHeader(resp_hdr, main_msg_size,
                                  &response_hdr_buf_);
 }
@@ -201,6 +236,12 @@ size_t InboundCall::SerializeResponseTo(TransferPayload* slices) const {
   TRACE_EVENT0("rpc", "InboundCall::SerializeResponseTo");
   DCHECK_GT(response_hdr_buf_.size(), 0);
   DCHECK_GT(response_msg_buf_.size(), 0);
+  if (compressed_response_buf_.size() > 0) {
+    DCHECK_LE(2, slices->size());
+    (*slices)[0] = Slice(response_hdr_buf_);
+    (*slices)[1] = Slice(compressed_response_buf_);
+    return 2;
+  }
   size_t n_slices = 2 + outbound_sidecars_.size();
   DCHECK_LE(n_slices, slices->size());
   auto slice_iter = slices->begin();
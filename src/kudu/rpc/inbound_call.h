@@ -242,10 +242,20 @@ class InboundCall {
   // by 'serialized_request_' above.
   gscoped_ptr<InboundTransfer> transfer_;
 
+  // The uncompressed request and sidecars, if they were sent compressed.
+  // 'serialized_request_' and 'inbound_sidecar_slices_' then refer into this
+  // instead of 'transfer_'.
+  faststring uncompressed_request_;
+
   // The buffers for serialized response. Set by SerializeResponseBuffer().
   faststring response_hdr_buf_;
   faststring response_msg_buf_;
 
+  // The response compressed together with its sidecars, if it was
+  // compressed. Sent instead of 'response_msg_buf_' and the sidecars when
+  // not empty. Set by SerializeResponseBuffer().
+  faststring compressed_response_buf_;
+
   // Vector of additional sidecars that are tacked on to the call's response
   // after serialization of the protobuf. See rpc/rpc_sidecar.h for more info.
   std::vector<std::unique_ptr<RpcSidecar>> outbound_sidecars_;
@@ -24,6 +24,7 @@
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -57,6 +58,7 @@
 #include "kudu/util/threadpool.h"
 
 using std::string;
+using std::vector;
 using std::shared_ptr;
 using std::make_shared;
 using strings::Substitute;
@@ -304,8 +306,7 @@ void Messenger::ShutdownInternal(ShutdownMode mode) {
   }
 }
 
-Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
-                                  shared_ptr<AcceptorPool>* pool) {
+Status Messenger::PreflightCheckAcceptor() {
   // Before listening, if we expect to require Kerberos, we want to verify
   // that everything is set up correctly. This way we'll generate errors on
   // startup rather than later on when we first receive a client connection.
@@ -313,21 +314,52 @@ Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
     RETURN_NOT_OK_PREPEND(ServerNegotiation::PreflightCheckGSSAPI(sasl_proto_name()),
                           "GSSAPI/Kerberos not properly configured");
   }
+  return Status::OK();
+}
 
+Status Messenger::BindAcceptorPool(const Sockaddr& accept_addr, bool reuseport,
+                                   int reactor_idx, shared_ptr<AcceptorPool>* pool,
+                                   Sockaddr* bound_addr) {
   Socket sock;
   RETURN_NOT_OK(sock.Init(0));
   RETURN_NOT_OK(sock.SetReuseAddr(true));
-  if (reuseport_) {
+  if (reuseport) {
     RETURN_NOT_OK(sock.SetReusePort(true));
   }
   RETURN_NOT_OK(sock.Bind(accept_addr));
   Sockaddr remote;
   RETURN_NOT_OK(sock.GetSocketAddress(&remote));
-  auto acceptor_pool(make_shared<AcceptorPool>(this, &sock, remote));
+  auto acceptor_pool(make_shared<AcceptorPool>(this, &sock, remote, reactor_idx));
 
   std::lock_guard<percpu_rwlock> guard(lock_);
   acceptor_pools_.push_back(acceptor_pool);
   pool->swap(acceptor_pool);
+  *bound_addr = remote;
+  return Status::OK();
+}
+
+Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
+                                  shared_ptr<AcceptorPool>* pool) {
+  RETURN_NOT_OK(PreflightCheckAcceptor());
+  Sockaddr bound_addr;
+  return BindAcceptorPool(accept_addr, reuseport_, -1, pool, &bound_addr);
+}
+
+Status Messenger::AddReactorAcceptorPools(const Sockaddr &accept_addr,
+                                          vector<shared_ptr<AcceptorPool>>* pools) {
+  RETURN_NOT_OK(PreflightCheckAcceptor());
+  Sockaddr addr = accept_addr;
+  vector<shared_ptr<AcceptorPool>> new_pools;
+  for (int i = 0; i < reactors_.size(); i++) {
+    shared_ptr<AcceptorPool> pool;
+    Sockaddr bound_addr;
+    RETURN_NOT_OK_PREPEND(BindAcceptorPool(addr, true, i, &pool, &bound_addr),
+                          Substitute("could not bind acceptor for reactor $0", i));
+    // The remaining sockets must share the port of the first one.
+    addr.set_port(bound_addr.port());
+    new_pools.emplace_back(std::move(pool));
+  }
+  pools->swap(new_pools);
   return Status::OK();
 }
 
@@ -394,8 +426,10 @@ void Messenger::QueueCancellation(const shared_ptr<OutboundCall> &call) {
   reactor->QueueCancellation(call);
 }
 
-void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote) {
-  Reactor *reactor = RemoteToReactor(remote);
+void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote,
+                                      int reactor_idx) {
+  Reactor *reactor = reactor_idx >= 0 ? reactors_[reactor_idx % reactors_.size()]
+                                      : RemoteToReactor(remote);
   reactor->RegisterInboundSocket(new_socket, remote);
 }
 
@@ -238,6 +238,19 @@ class Messenger {
   Status AddAcceptorPool(const Sockaddr &accept_addr,
                          std::shared_ptr<AcceptorPool>* pool);
 
+  // Like AddAcceptorPool(), but adds one acceptor pool per reactor, each with
+  // its own SO_REUSEPORT listening socket bound to 'accept_addr'. The kernel
+  // spreads incoming connections across the sockets, and every connection
+  // accepted by a pool is handled by that pool's reactor, so that no single
+  // listening socket or acceptor thread serializes accepts.
+  //
+  // If the port of 'accept_addr' is 0, all the sockets are bound to the port
+  // chosen for the first one.
+  //
+  // As with AddAcceptorPool(), the returned pools are not initially started.
+  Status AddReactorAcceptorPools(const Sockaddr &accept_addr,
+                                 std::vector<std::shared_ptr<AcceptorPool>>* pools);
+
   // Register a new RpcService to handle inbound requests.
   //
   // Returns an error if a service with the same name is already registered.
@@ -263,7 +276,11 @@ class Messenger {
   void QueueCancellation(const std::shared_ptr<OutboundCall> &call);
 
   // Take ownership of the socket via Socket::Release
-  void RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote);
+  //
+  // The connection is handled by the reactor with index 'reactor_idx', or by
+  // a reactor picked based on 'remote' if 'reactor_idx' is -1.
+  void RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote,
+                             int reactor_idx = -1);
 
   // Dump the current RPCs into the given protobuf.
   Status DumpRunningRpcs(const DumpRunningRpcsRequestPB& req,
@@ -335,6 +352,15 @@ class Messenger {
 
   Reactor* RemoteToReactor(const Sockaddr &remote);
   Status Init();
+
+  // Performs the Kerberos pre-flight check described for AddAcceptorPool().
+  Status PreflightCheckAcceptor();
+
+  // Binds a listening socket to 'accept_addr' and registers an acceptor pool
+  // for it, returning the pool in 'pool' and the bound address in 'bound_addr'.
+  Status BindAcceptorPool(const Sockaddr& accept_addr, bool reuseport, int reactor_idx,
+                          std::shared_ptr<AcceptorPool>* pool, Sockaddr* bound_addr);
+
   void RunTimeoutThread();
   void UpdateCurTime();
 
@@ -40,6 +40,8 @@
 #include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/kernel_stack_watchdog.h"
 #include "kudu/util/net/sockaddr.h"
@@ -109,7 +111,7 @@ OutboundCall::~OutboundCall() {
   DVLOG(4) << "OutboundCall " << this << " destroyed with state_: " << StateName(state_);
 }
 
-size_t OutboundCall::SerializeTo(TransferPayload* slices) {
+size_t OutboundCall::SerializeTo(TransferPayload* slices, const CompressionCodec* codec) {
   DCHECK_LT(0, request_buf_.size())
       << "Must call SetRequestPayload() before SerializeTo()";
 
@@ -123,6 +125,26 @@ size_t OutboundCall::SerializeTo(TransferPayload* slices) {
   }
 
   DCHECK_LE(0, sidecar_byte_size_);
+  if (codec) {
+    vector<Slice> sidecar_slices;
+    sidecar_slices.reserve(sidecars_.size());
+    for (const unique_ptr<RpcSidecar>& car : sidecars_) {
+      sidecar_slices.emplace_back(car->AsSlice());
+    }
+    uint32_t uncompressed_size;
+    if (serialization::CompressMainMessage(*codec, request_buf_, sidecar_slices,
+                                           &compressed_buf_, &uncompressed_size)) {
+      header_.set_compression(codec->type());
+      header_.set_uncompressed_size(uncompressed_size);
+      serialization::SerializeHeader(header_, compressed_buf_.size(), &header_buf_);
+
+      DCHECK_LE(2, slices->size());
+      (*slices)[0] = Slice(header_buf_);
+      (*slices)[1] = Slice(compressed_buf_);
+      return 2;
+    }
+  }
+
   serialization::SerializeHeader(
       header_, sidecar_byte_size_ + request_buf_.size(), &header_buf_);
 
@@ -334,6 +356,7 @@ void OutboundCall::SetSent() {
   // which allocated it -- this lets it keep to thread-local operations instead
   // of taking a mutex to put memory back on the global freelist.
   delete [] header_buf_.release();
+  delete [] compressed_buf_.release();
 
   // request_buf_ is also done being used here, but since it was allocated by
   // the caller thread, we would rather let that thread free it whenever it
@@ -513,6 +536,15 @@ Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_,
                                             &serialized_response_));
 
+  if (header_.has_compression() && header_.compression() != NO_COMPRESSION) {
+    const CompressionCodec* codec;
+    RETURN_NOT_OK_PREPEND(GetCompressionCodec(header_.compression(), &codec),
+                          "Invalid packet: unknown compression codec");
+    RETURN_NOT_OK(serialization::UncompressMainMessage(
+        *codec, serialized_response_, header_.uncompressed_size(), &uncompressed_response_));
+    serialized_response_ = Slice(uncompressed_response_);
+  }
+
   // Use information from header to extract the payload slices.
   RETURN_NOT_OK(RpcSidecar::ParseSidecars(header_.sidecar_offsets(),
           serialized_response_, sidecar_slices_));
@@ -52,6 +52,9 @@ class Message;
 } // namespace google
 
 namespace kudu {
+
+class CompressionCodec;
+
 namespace rpc {
 
 class CallResponse;
@@ -106,8 +109,17 @@ class OutboundCall {
 
   // Serialize the call for the wire. Requires that SetRequestPayload()
   // is called first. This is called from the Reactor thread.
+  // If 'codec' is not null, the request and its sidecars are compressed with
+  // it, unless that doesn't make them any smaller.
   // Returns the number of slices in the serialized call.
-  size_t SerializeTo(TransferPayload* slices);
+  size_t SerializeTo(TransferPayload* slices, const CompressionCodec* codec = nullptr);
+
+  // Returns the size of the serialized request together with its sidecars.
+  // Requires that SetRequestPayload() is called first.
+  size_t payload_size() const {
+    DCHECK_LE(0, sidecar_byte_size_);
+    return request_buf_.size() + sidecar_byte_size_;
+  }
 
   // Mark in the call that cancellation has been requested. If the call hasn't yet
   // started sending or has finished sending the RPC request but is waiting for a
@@ -266,6 +278,9 @@ class OutboundCall {
   faststring header_buf_;
   faststring request_buf_;
 
+  // The request and its sidecars, compressed, if SerializeTo() compressed them.
+  faststring compressed_buf_;
+
   // Once a response has been received for this call, contains that response.
   // Otherwise NULL.
   gscoped_ptr<CallResponse> call_response_;
@@ -339,6 +354,10 @@ class CallResponse {
   // and sidecar_slices_ refer into its data.
   gscoped_ptr<InboundTransfer> transfer_;
 
+  // The uncompressed response and sidecars, if they were sent compressed.
+  // serialized_response_ and sidecar_slices_ then refer into this instead.
+  faststring uncompressed_response_;
+
   DISALLOW_COPY_AND_ASSIGN(CallResponse);
 };
 
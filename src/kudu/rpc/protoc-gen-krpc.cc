@@ -79,6 +79,19 @@ optional<string> GetAuthzMethod(const MethodDescriptor& method) {
   return boost::none;
 }
 
+// Return the priority class specified for this RPC method.
+//
+// This handles fallback to the service-wide default.
+RpcPriorityClassPB GetPriorityClass(const MethodDescriptor& method) {
+  if (method.options().HasExtension(priority_class)) {
+    return method.options().GetExtension(priority_class);
+  }
+  if (method.service()->options().HasExtension(default_priority_class)) {
+    return method.service()->options().GetExtension(default_priority_class);
+  }
+  return PRIORITY_NORMAL;
+}
+
 } // anonymous namespace
 
 class Substituter {
@@ -208,6 +221,11 @@ class MethodSubstitutions : public Substituter {
     bool track_result = static_cast<bool>(method_->options().GetExtension(track_rpc_result));
     (*map)["track_result"] = track_result ? " true" : "false";
     (*map)["authz_method"] = GetAuthzMethod(*method_).get_value_or("AuthorizeAllowAll");
+    bool allocate_on_arena =
+        static_cast<bool>(method_->options().GetExtension(kudu::rpc::allocate_on_arena));
+    (*map)["allocate_on_arena"] = allocate_on_arena ? " true" : "false";
+    (*map)["priority_class"] =
+        "::kudu::rpc::" + RpcPriorityClassPB_Name(GetPriorityClass(*method_));
   }
 
   // Strips the package from method arguments if they are in the same package as
@@ -514,6 +532,8 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
               "                           ctx);\n"
               "    };\n"
               "    mi->track_result = $track_result$;\n"
+              "    mi->priority_class = $priority_class$;\n"
+              "    mi->allocate_on_arena = $allocate_on_arena$;\n"
               "    mi->handler_latency_histogram =\n"
               "        METRIC_handler_latency_$rpc_full_name_plainchars$.Instantiate(entity);\n"
               "    mi->func = [this](const Message* req, Message* resp, RpcContext* ctx) {\n"
@@ -17,6 +17,12 @@
 
 #include "kudu/rpc/reactor.h"
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
 #include <cerrno>
 #include <memory>
 #include <mutex>
@@ -35,6 +41,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/rpc/client_negotiation.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/messenger.h"
@@ -44,11 +51,13 @@
 #include "kudu/rpc/server_negotiation.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/sanitizer_scopes.h"
+#include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
+#include "kudu/util/numa.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/thread_restrictions.h"
@@ -78,6 +87,26 @@ DEFINE_bool(rpc_reopen_outbound_connections, false,
             "reuse the connection otherwise. "
             "Used by tests only.");
 TAG_FLAG(rpc_reopen_outbound_connections, unsafe);
+
+DEFINE_string(rpc_reactor_cpu_affinity, "none",
+              "How to pin RPC reactor threads to CPUs. 'none', the default, "
+              "doesn't pin them. 'cpu' pins the Nth reactor of each messenger to "
+              "CPU N, and 'numa' pins it to the CPUs of NUMA node N, modulo the "
+              "number of CPUs or NUMA nodes. When RPC acceptors are sharded by "
+              "reactor (see --rpc_acceptor_per_reactor), each acceptor thread is "
+              "pinned along with its reactor, so that accepted connections are "
+              "handed over on the same CPUs. Only supported on Linux.");
+TAG_FLAG(rpc_reactor_cpu_affinity, experimental);
+
+static bool ValidateReactorCpuAffinity(const char* flag_name, const string& flag_value) {
+  if (flag_value == "none" || flag_value == "cpu" || flag_value == "numa") {
+    return true;
+  }
+  LOG(ERROR) << Substitute("invalid value for --$0: '$1' (expected 'none', 'cpu' or 'numa')",
+                           flag_name, flag_value);
+  return false;
+}
+DEFINE_validator(rpc_reactor_cpu_affinity, &ValidateReactorCpuAffinity);
 TAG_FLAG(rpc_reopen_outbound_connections, runtime);
 
 METRIC_DEFINE_histogram(server, reactor_load_percent,
@@ -101,6 +130,7 @@ namespace kudu {
 namespace rpc {
 
 namespace {
+
 Status ShutdownError(bool aborted) {
   const char* msg = "reactor is shutting down";
   return aborted ?
@@ -125,10 +155,39 @@ void DoInitLibEv() {
 
 } // anonymous namespace
 
+Status BindThreadToReactorCpus(int reactor_idx) {
+  const string& affinity = FLAGS_rpc_reactor_cpu_affinity;
+  if (affinity == "none" || reactor_idx < 0) {
+    return Status::OK();
+  }
+#if defined(__linux__)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  if (affinity == "cpu") {
+    CPU_SET(reactor_idx % base::NumCPUs(), &cpus);
+  } else {
+    DCHECK_EQ("numa", affinity);
+    int num_nodes = NumNumaNodes();
+    if (num_nodes == 0) {
+      return Status::NotSupported("no NUMA nodes found in sysfs");
+    }
+    return BindCurrentThreadToNumaNode(reactor_idx % num_nodes);
+  }
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  if (err != 0) {
+    return Status::RuntimeError("pthread_setaffinity_np() failed", ErrnoToString(err), err);
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("pinning reactor threads is only supported on Linux");
+#endif
+}
+
 ReactorThread::ReactorThread(Reactor *reactor, const MessengerBuilder& bld)
   : loop_(kDefaultLibEvFlags),
     cur_time_(MonoTime::Now()),
     last_unused_tcp_scan_(cur_time_),
+    timer_wheel_(cur_time_),
     reactor_(reactor),
     connection_keepalive_time_(bld.connection_keepalive_time_),
     coarse_timer_granularity_(bld.coarse_timer_granularity_),
@@ -159,6 +218,11 @@ Status ReactorThread::Init() {
   timer_.start(coarse_timer_granularity_.ToSeconds(),
                coarse_timer_granularity_.ToSeconds());
 
+  // The timer which advances the timer wheel is only armed while deadlines
+  // are scheduled.
+  wheel_timer_.set(loop_);
+  wheel_timer_.set<ReactorThread, &ReactorThread::WheelTimerHandler>(this); // NOLINT(*)
+
   // Register our callbacks. ev++ doesn't provide handy wrappers for these.
   ev_set_userdata(loop_, this);
   ev_set_loop_release_cb(loop_, &ReactorThread::AboutToPollCb, &ReactorThread::PollCompleteCb);
@@ -229,6 +293,7 @@ void ReactorThread::ShutdownInternal() {
     conn->Shutdown(service_unavailable);
   }
   client_conns_.clear();
+  wheel_timer_.stop();
 
   // Tear down any inbound TCP connections.
   VLOG(1) << name() << ": tearing down inbound TCP connections...";
@@ -401,8 +466,34 @@ void ReactorThread::TimerHandler(ev::timer& /*watcher*/, int revents) {
   ScanIdleConnections();
 }
 
-void ReactorThread::RegisterTimeout(ev::timer *watcher) {
-  watcher->set(loop_);
+void ReactorThread::ScheduleTimeout(TimerWheelEntry* entry, MonoTime deadline) {
+  DCHECK(IsCurrentThread());
+  timer_wheel_.Schedule(entry, deadline);
+  RearmWheelTimer();
+}
+
+void ReactorThread::WheelTimerHandler(ev::timer& /*watcher*/, int revents) {
+  DCHECK(IsCurrentThread());
+  if (EV_ERROR & revents) {
+    LOG(WARNING) << "Reactor " << name() << " got an error in "
+      "the timer wheel handler.";
+    return;
+  }
+  wheel_timer_wakeup_ = MonoTime();
+  timer_wheel_.Advance(MonoTime::Now());
+  RearmWheelTimer();
+}
+
+void ReactorThread::RearmWheelTimer() {
+  MonoTime next = timer_wheel_.NextWakeup();
+  if (!next.Initialized()) {
+    return;
+  }
+  if (wheel_timer_.is_active() && wheel_timer_wakeup_ <= next) {
+    return;
+  }
+  wheel_timer_wakeup_ = next;
+  wheel_timer_.start(std::max(0.0, (next - MonoTime::Now()).ToSeconds()), 0);
 }
 
 void ReactorThread::ScanIdleConnections() {
@@ -471,6 +562,8 @@ bool ReactorThread::IsCurrentThread() const {
 }
 
 void ReactorThread::RunThread() {
+  WARN_NOT_OK(BindThreadToReactorCpus(reactor_->index()),
+              Substitute("$0: could not pin reactor thread", name()));
   ThreadRestrictions::SetWaitAllowed(false);
   ThreadRestrictions::SetIOAllowed(false);
   DVLOG(6) << "Calling ReactorThread::RunThread()...";
@@ -717,6 +810,7 @@ Reactor::Reactor(shared_ptr<Messenger> messenger,
                  int index, const MessengerBuilder& bld)
     : messenger_(std::move(messenger)),
       name_(StringPrintf("%s_R%03d", messenger_->name().c_str(), index)),
+      index_(index),
       closing_(false),
       thread_(this, bld) {
   static std::once_flag libev_once;
@@ -34,6 +34,7 @@
 #include "kudu/rpc/connection_id.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/timer_wheel.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -166,9 +167,9 @@ class ReactorThread {
   // libev callback for handling timer events in our epoll thread.
   void TimerHandler(ev::timer &watcher, int revents);
 
-  // Register an epoll timer watcher with our event loop.
-  // Does not set a timeout or start it.
-  void RegisterTimeout(ev::timer *watcher);
+  // Schedules 'entry' to fire at 'deadline' on this thread's timer wheel.
+  // Must be called from the reactor thread.
+  void ScheduleTimeout(TimerWheelEntry* entry, MonoTime deadline);
 
   // This may be called from another thread.
   const std::string &name() const;
@@ -205,6 +206,13 @@ class ReactorThread {
   // Run the main event loop of the reactor.
   void RunThread();
 
+  // libev callback for when it's time to advance the timer wheel.
+  void WheelTimerHandler(ev::timer& watcher, int revents);
+
+  // Arms 'wheel_timer_' for the next wakeup of the timer wheel, unless it's
+  // already armed for an earlier time.
+  void RearmWheelTimer();
+
   // When libev has noticed that it needs to wake up an application watcher,
   // it calls this callback. The callback simply calls back into libev's
   // ev_invoke_pending() to trigger all the watcher callbacks, but
@@ -294,6 +302,14 @@ class ReactorThread {
   // last time we did TCP timeouts.
   MonoTime last_unused_tcp_scan_;
 
+  // The deadlines of the calls awaiting a response on this thread, and the
+  // libev timer which advances the wheel, armed for 'wheel_timer_wakeup_'.
+  // A single timer on the wheel costs much less than a libev timer per call
+  // when the calls come at high rates.
+  TimerWheel timer_wheel_;
+  ev::timer wheel_timer_;
+  MonoTime wheel_timer_wakeup_;
+
   // Map of sockaddrs to Connection objects for outbound (client) connections.
   conn_multimap_t client_conns_;
 
@@ -335,6 +351,11 @@ class ReactorThread {
   } last_load_measurement_;
 };
 
+// Pins the calling thread to the CPUs which --rpc_reactor_cpu_affinity
+// assigns to the reactor with index 'reactor_idx'. Does nothing if reactor
+// threads aren't pinned.
+Status BindThreadToReactorCpus(int reactor_idx);
+
 // A Reactor manages a ReactorThread
 class Reactor {
  public:
@@ -351,6 +372,11 @@ class Reactor {
 
   const std::string &name() const;
 
+  // The index of this reactor amongst its messenger's reactors.
+  int index() const {
+    return index_;
+  }
+
   // Collect metrics about the reactor.
   Status GetMetrics(ReactorMetrics *metrics);
 
@@ -408,6 +434,8 @@ class Reactor {
 
   const std::string name_;
 
+  const int index_;
+
   // Whether the reactor is shutting down.
   // Guarded by lock_.
   bool closing_;
@@ -221,6 +221,17 @@ ResultTracker::RpcState ResultTracker::TrackRpcUnlocked(const RequestIdPB& reque
   }
 }
 
+ResultTracker::RpcState ResultTracker::TrackEmbeddedRpc(const RequestIdPB& request_id,
+                                                        Message* response) {
+  lock_guard<simple_spinlock> l(lock_);
+  RpcState state = TrackRpcUnlocked(request_id, nullptr, nullptr);
+  if (state == RpcState::COMPLETED) {
+    CompletionRecord* completion_record = FindCompletionRecordOrDieUnlocked(request_id);
+    response->CopyFrom(*completion_record->response);
+  }
+  return state;
+}
+
 ResultTracker::RpcState ResultTracker::TrackRpcOrChangeDriver(const RequestIdPB& request_id) {
   lock_guard<simple_spinlock> l(lock_);
   RpcState state = TrackRpcUnlocked(request_id, nullptr, nullptr);
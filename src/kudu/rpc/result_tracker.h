@@ -179,6 +179,15 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
                     google::protobuf::Message* response,
                     RpcContext* context);
 
+  // Used to track client originated operations which were sent as part of another RPC, and
+  // thus have no RPC context of their own, e.g. the writes of a MultiTabletWrite RPC.
+  // If the RpcState == NEW the caller is supposed to execute the operation and record its
+  // result with RecordCompletionAndRespond() or FailAndRespond(). If the RpcState ==
+  // COMPLETED the stored response is copied to 'response'. Otherwise the operation must not
+  // be executed.
+  RpcState TrackEmbeddedRpc(const RequestIdPB& request_id,
+                            google::protobuf::Message* response);
+
   // Used to track RPC attempts which originate from other replicas, and which may race with
   // client originated ones.
   // Tracks the RPC if it is untracked or changes the current driver of this RPC, i.e. sets the
@@ -68,6 +68,18 @@ class RetriableRpc : public Rpc {
   // Try() to actually send the request.
   void SendRpc() override;
 
+  // Makes this RPC a retry of an operation which was first attempted as part
+  // of another RPC under the sequence number 'seq_no', so that the server
+  // applies the operation only once. This RPC takes over the sequence number,
+  // and marks it as completed when it finishes. Must be called before
+  // SendRpc().
+  void AdoptSequenceNumber(internal::SequenceNumber seq_no) {
+    DCHECK_EQ(sequence_number_, RequestTracker::kNoSeqNo);
+    sequence_number_ = seq_no;
+    // The first attempt was the one of the other RPC.
+    num_attempts_ = 1;
+  }
+
   // The callback to call upon retrieving (of failing to retrieve) a new authn
   // token. This is the callback that subclasses should call in their custom
   // implementation of the GetNewAuthnTokenAndRetry() method.
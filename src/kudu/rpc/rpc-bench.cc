@@ -15,6 +15,8 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -24,6 +26,7 @@
 #include <utility>
 #include <vector>
 
+#include <boost/function.hpp>
 #include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
@@ -32,8 +35,10 @@
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc-test-base.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/rtest.pb.h"
 #include "kudu/rpc/rtest.proxy.h"
 #include "kudu/util/countdown_latch.h"
@@ -41,11 +46,13 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+using std::atomic;
 using std::bind;
 using std::shared_ptr;
 using std::string;
@@ -56,7 +63,8 @@ using std::vector;
 DEFINE_int32(client_threads, 16,
              "Number of client threads. For the synchronous benchmark, each thread has "
              "a single outstanding synchronous request at a time. For the async "
-             "benchmark, this determines the number of client reactors.");
+             "benchmark, this determines the number of client reactors. For the "
+             "open-loop benchmark, this is the number of threads issuing calls.");
 
 DEFINE_int32(async_call_concurrency, 60,
              "Number of concurrent requests that will be outstanding at a time for the "
@@ -71,6 +79,28 @@ DEFINE_int32(server_reactors, 4,
 
 DEFINE_int32(run_seconds, 1, "Seconds to run the test");
 
+DEFINE_int32(payload_bytes, 0,
+             "Size of the payload carried in each request, and echoed back in its "
+             "response. If this or --sidecar_bytes is non-zero, the benchmarks call "
+             "Echo instead of Add.");
+
+DEFINE_int32(sidecar_bytes, 0,
+             "Size of a sidecar attached to each request, and echoed back in a "
+             "sidecar of its response.");
+
+DEFINE_int32(target_qps, 10000,
+             "Rate at which the open-loop benchmark issues requests, regardless of how "
+             "quickly they complete.");
+
+DEFINE_int32(client_connections, 16,
+             "Number of client connections over which the open-loop benchmark spreads "
+             "its requests. Each connection belongs to its own client messenger.");
+
+DEFINE_int32(open_loop_max_outstanding, 10000,
+             "Maximum number of requests the open-loop benchmark has outstanding at a "
+             "time. Requests which fall due while at the maximum are skipped, and "
+             "reported.");
+
 DECLARE_bool(rpc_encrypt_loopback_connections);
 DEFINE_bool(enable_encryption, false, "Whether to enable TLS encryption for rpc-bench");
 
@@ -80,11 +110,21 @@ METRIC_DECLARE_histogram(reactor_active_latency_us);
 namespace kudu {
 namespace rpc {
 
+// The highest call latency tracked by the benchmarks' histograms.
+static const uint64_t kMaxLatencyMicros = 60 * 1000 * 1000;
+
+enum class BenchMode {
+  SYNC,
+  ASYNC,
+  OPEN_LOOP,
+};
+
 class RpcBench : public RpcTestBase {
  public:
   RpcBench()
       : should_run_(true),
-        stop_(0)
+        stop_(0),
+        latency_us_(kMaxLatencyMicros, 3)
   {}
 
   void SetUp() override {
@@ -93,13 +133,15 @@ class RpcBench : public RpcTestBase {
 
     n_worker_threads_ = FLAGS_worker_threads;
     n_server_reactor_threads_ = FLAGS_server_reactors;
+    payload_.assign(FLAGS_payload_bytes, 'x');
+    sidecar_.assign(FLAGS_sidecar_bytes, 'y');
 
     // Set up server.
     FLAGS_rpc_encrypt_loopback_connections = FLAGS_enable_encryption;
     ASSERT_OK(StartTestServerWithGeneratedCode(&server_addr_, FLAGS_enable_encryption));
   }
 
-  void SummarizePerf(CpuTimes elapsed, int total_reqs, bool sync) {
+  void SummarizePerf(CpuTimes elapsed, int total_reqs, BenchMode mode) {
     float reqs_per_second = static_cast<float>(total_reqs / elapsed.wall_seconds());
     float user_cpu_micros_per_req = static_cast<float>(elapsed.user / 1000.0 / total_reqs);
     float sys_cpu_micros_per_req = static_cast<float>(elapsed.system / 1000.0 / total_reqs);
@@ -110,22 +152,40 @@ class RpcBench : public RpcTestBase {
     HdrHistogram reactor_latency(*METRIC_reactor_active_latency_us.Instantiate(
         server_messenger_->metric_entity())->histogram());
 
-    LOG(INFO) << "Mode:            " << (sync ? "Sync" : "Async");
-    if (sync) {
-      LOG(INFO) << "Client threads:   " << FLAGS_client_threads;
-    } else {
-      LOG(INFO) << "Client reactors:  " << FLAGS_client_threads;
-      LOG(INFO) << "Call concurrency: " << FLAGS_async_call_concurrency;
+    switch (mode) {
+      case BenchMode::SYNC:
+        LOG(INFO) << "Mode:            Sync";
+        LOG(INFO) << "Client threads:   " << FLAGS_client_threads;
+        break;
+      case BenchMode::ASYNC:
+        LOG(INFO) << "Mode:            Async";
+        LOG(INFO) << "Client reactors:  " << FLAGS_client_threads;
+        LOG(INFO) << "Call concurrency: " << FLAGS_async_call_concurrency;
+        break;
+      case BenchMode::OPEN_LOOP:
+        LOG(INFO) << "Mode:            Open-loop";
+        LOG(INFO) << "Client threads:   " << FLAGS_client_threads;
+        LOG(INFO) << "Connections:      " << FLAGS_client_connections;
+        LOG(INFO) << "Target reqs/sec:  " << FLAGS_target_qps;
+        LOG(INFO) << "Skipped reqs:     " << skipped_reqs_;
+        break;
     }
 
     LOG(INFO) << "Worker threads:   " << FLAGS_worker_threads;
     LOG(INFO) << "Server reactors:  " << FLAGS_server_reactors;
     LOG(INFO) << "Encryption:       " << FLAGS_enable_encryption;
+    LOG(INFO) << "Payload bytes:    " << FLAGS_payload_bytes;
+    LOG(INFO) << "Sidecar bytes:    " << FLAGS_sidecar_bytes;
     LOG(INFO) << "----------------------------------";
     LOG(INFO) << "Reqs/sec:         " << reqs_per_second;
     LOG(INFO) << "User CPU per req: " << user_cpu_micros_per_req << "us";
     LOG(INFO) << "Sys CPU per req:  " << sys_cpu_micros_per_req << "us";
     LOG(INFO) << "Ctx Sw. per req:  " << csw_per_req;
+    LOG(INFO) << "Latency (mean):   " << latency_us_.MeanValue() << "us";
+    LOG(INFO) << "Latency (50p):    " << latency_us_.ValueAtPercentile(50) << "us";
+    LOG(INFO) << "Latency (99p):    " << latency_us_.ValueAtPercentile(99) << "us";
+    LOG(INFO) << "Latency (99.9p):  " << latency_us_.ValueAtPercentile(99.9) << "us";
+    LOG(INFO) << "Latency (max):    " << latency_us_.MaxValue() << "us";
     LOG(INFO) << "Server Reactor load (mean):     "
               << reactor_load.MeanValue() << "%";
     LOG(INFO) << "Server Reactor load (95p):      "
@@ -138,12 +198,94 @@ class RpcBench : public RpcTestBase {
   }
 
  protected:
+  friend class BenchCall;
   friend class ClientThread;
   friend class ClientAsyncWorkload;
+  friend class OpenLoopClientThread;
+
+  bool use_echo() const {
+    return !payload_.empty() || !sidecar_.empty();
+  }
+
+  // Records the latency of a call which was due to be sent at 'start'.
+  void RecordLatency(const MonoTime& start) {
+    latency_us_.Increment(std::min<int64_t>((MonoTime::Now() - start).ToMicroseconds(),
+                                            kMaxLatencyMicros));
+  }
 
   Sockaddr server_addr_;
   Atomic32 should_run_;
   CountDownLatch stop_;
+
+  // Latencies of all calls made by a benchmark.
+  HdrHistogram latency_us_;
+
+  // Data sent in, and echoed back by, each Echo call.
+  string payload_;
+  string sidecar_;
+
+  // The number of calls the open-loop benchmark didn't send.
+  atomic<int64_t> skipped_reqs_ { 0 };
+};
+
+// A call to the benchmark's server, either Add or Echo, which can be sent
+// repeatedly.
+class BenchCall {
+ public:
+  explicit BenchCall(RpcBench* bench)
+      : bench_(bench),
+        count_(0) {
+    echo_req_.set_data(bench_->payload_);
+  }
+
+  // Sends the call asynchronously. 'callback' runs once it completes.
+  void Send(CalculatorServiceProxy* proxy, const ResponseCallback& callback) {
+    controller_.Reset();
+    controller_.set_timeout(MonoDelta::FromSeconds(10));
+    count_++;
+    if (bench_->use_echo()) {
+      if (!bench_->sidecar_.empty()) {
+        int idx;
+        CHECK_OK(controller_.AddOutboundSidecar(
+            RpcSidecar::FromSlice(Slice(bench_->sidecar_)), &idx));
+        echo_req_.set_sidecar_idx(idx);
+      }
+      proxy->EchoAsync(echo_req_, &echo_resp_, &controller_, callback);
+    } else {
+      add_req_.set_x(count_);
+      add_req_.set_y(count_);
+      proxy->AddAsync(add_req_, &add_resp_, &controller_, callback);
+    }
+  }
+
+  // Checks the response to the call last sent.
+  void Check() const {
+    CHECK_OK(controller_.status());
+    if (bench_->use_echo()) {
+      CHECK_EQ(bench_->payload_.size(), echo_resp_.data().size());
+      if (!bench_->sidecar_.empty()) {
+        Slice sidecar;
+        CHECK_OK(controller_.GetInboundSidecar(echo_resp_.sidecar_idx(), &sidecar));
+        CHECK_EQ(bench_->sidecar_.size(), sidecar.size());
+      }
+    } else {
+      CHECK_EQ(add_req_.x() + add_req_.y(), add_resp_.result());
+    }
+  }
+
+  // The number of times the call was sent.
+  uint32_t count() const {
+    return count_;
+  }
+
+ private:
+  RpcBench* bench_;
+  uint32_t count_;
+  RpcController controller_;
+  AddRequestPB add_req_;
+  AddResponsePB add_resp_;
+  EchoRequestPB echo_req_;
+  EchoResponsePB echo_resp_;
 };
 
 class ClientThread {
@@ -167,15 +309,14 @@ class ClientThread {
 
     CalculatorServiceProxy p(client_messenger, bench_->server_addr_, "localhost");
 
-    AddRequestPB req;
-    AddResponsePB resp;
+    BenchCall call(bench_);
     while (Acquire_Load(&bench_->should_run_)) {
-      req.set_x(request_count_);
-      req.set_y(request_count_);
-      RpcController controller;
-      controller.set_timeout(MonoDelta::FromSeconds(10));
-      CHECK_OK(p.Add(req, &resp, &controller));
-      CHECK_EQ(req.x() + req.y(), resp.result());
+      CountDownLatch latch(1);
+      MonoTime start = MonoTime::Now();
+      call.Send(&p, [&latch]() { latch.CountDown(); });
+      latch.Wait();
+      bench_->RecordLatency(start);
+      call.Check();
       request_count_++;
     }
   }
@@ -208,7 +349,7 @@ TEST_F(RpcBench, BenchmarkCalls) {
   }
   sw.stop();
 
-  SummarizePerf(sw.elapsed(), total_reqs, true);
+  SummarizePerf(sw.elapsed(), total_reqs, BenchMode::SYNC);
 }
 
 class ClientAsyncWorkload {
@@ -216,41 +357,36 @@ class ClientAsyncWorkload {
   ClientAsyncWorkload(RpcBench *bench, shared_ptr<Messenger> messenger)
     : bench_(bench),
       messenger_(std::move(messenger)),
-      request_count_(0) {
-    controller_.set_timeout(MonoDelta::FromSeconds(10));
+      call_(bench) {
     proxy_.reset(new CalculatorServiceProxy(messenger_, bench_->server_addr_, "localhost"));
   }
 
   void CallOneRpc() {
-    if (request_count_ > 0) {
-      CHECK_OK(controller_.status());
-      CHECK_EQ(req_.x() + req_.y(), resp_.result());
+    if (call_.count() > 0) {
+      bench_->RecordLatency(start_);
+      call_.Check();
     }
     if (!Acquire_Load(&bench_->should_run_)) {
       bench_->stop_.CountDown();
       return;
     }
-    controller_.Reset();
-    req_.set_x(request_count_);
-    req_.set_y(request_count_);
-    request_count_++;
-    proxy_->AddAsync(req_,
-                     &resp_,
-                     &controller_,
-                     bind(&ClientAsyncWorkload::CallOneRpc, this));
+    start_ = MonoTime::Now();
+    call_.Send(proxy_.get(), bind(&ClientAsyncWorkload::CallOneRpc, this));
   }
 
   void Start() {
     CallOneRpc();
   }
 
+  uint32_t request_count() const {
+    return call_.count();
+  }
+
   RpcBench *bench_;
   shared_ptr<Messenger> messenger_;
   unique_ptr<CalculatorServiceProxy> proxy_;
-  uint32_t request_count_;
-  RpcController controller_;
-  AddRequestPB req_;
-  AddResponsePB resp_;
+  BenchCall call_;
+  MonoTime start_;
 };
 
 TEST_F(RpcBench, BenchmarkCallsAsync) {
@@ -287,12 +423,105 @@ TEST_F(RpcBench, BenchmarkCallsAsync) {
   stop_.Wait();
   int total_reqs = 0;
   for (int i = 0; i < concurrency; i++) {
-    total_reqs += workloads[i]->request_count_;
+    total_reqs += workloads[i]->request_count();
+  }
+
+  SummarizePerf(sw.elapsed(), total_reqs, BenchMode::ASYNC);
+}
+
+// Issues calls at a fixed rate, whether or not earlier ones have completed,
+// spreading them over the given proxies. A call's latency is measured from
+// when it was due to be sent, so that a server which falls behind can't hide
+// the delay it causes to the calls queued up behind its slow ones.
+class OpenLoopClientThread {
+ public:
+  OpenLoopClientThread(RpcBench* bench,
+                       vector<CalculatorServiceProxy*> proxies,
+                       double qps)
+      : bench_(bench),
+        proxies_(std::move(proxies)),
+        interval_(MonoDelta::FromNanoseconds(static_cast<int64_t>(1e9 / qps))),
+        request_count_(0) {
+  }
+
+  void Start() {
+    thread_.reset(new thread(&OpenLoopClientThread::Run, this));
+  }
+
+  void Join() {
+    thread_->join();
+  }
+
+  void Run() {
+    MonoTime start = MonoTime::Now();
+    for (int64_t i = 0; Acquire_Load(&bench_->should_run_); i++) {
+      MonoTime due = start + MonoDelta::FromNanoseconds(interval_.ToNanoseconds() * i);
+      MonoTime now = MonoTime::Now();
+      if (due > now) {
+        SleepFor(due - now);
+      }
+      if (outstanding_ >= FLAGS_open_loop_max_outstanding) {
+        bench_->skipped_reqs_++;
+        continue;
+      }
+      outstanding_++;
+      BenchCall* call = new BenchCall(bench_);
+      call->Send(proxies_[i % proxies_.size()], [this, call, due]() {
+          bench_->RecordLatency(due);
+          call->Check();
+          delete call;
+          outstanding_--;
+        });
+      request_count_++;
+    }
+    while (outstanding_ > 0) {
+      SleepFor(MonoDelta::FromMilliseconds(1));
+    }
   }
 
-  SummarizePerf(sw.elapsed(), total_reqs, false);
+  unique_ptr<thread> thread_;
+  RpcBench* bench_;
+  const vector<CalculatorServiceProxy*> proxies_;
+  const MonoDelta interval_;
+  int request_count_;
+  atomic<int> outstanding_ { 0 };
+};
+
+// Test making RPC calls at a target rate, measuring their latency.
+TEST_F(RpcBench, BenchmarkCallsOpenLoop) {
+  vector<shared_ptr<Messenger>> messengers;
+  vector<unique_ptr<CalculatorServiceProxy>> proxies;
+  vector<CalculatorServiceProxy*> proxy_ptrs;
+  for (int i = 0; i < FLAGS_client_connections; i++) {
+    shared_ptr<Messenger> m;
+    ASSERT_OK(CreateMessenger("Client", &m));
+    proxies.emplace_back(new CalculatorServiceProxy(m, server_addr_, "localhost"));
+    proxy_ptrs.push_back(proxies.back().get());
+    messengers.emplace_back(std::move(m));
+  }
+
+  Stopwatch sw(Stopwatch::ALL_THREADS);
+  sw.start();
+
+  vector<unique_ptr<OpenLoopClientThread>> threads;
+  for (int i = 0; i < FLAGS_client_threads; i++) {
+    threads.emplace_back(new OpenLoopClientThread(
+        this, proxy_ptrs, static_cast<double>(FLAGS_target_qps) / FLAGS_client_threads));
+    threads.back()->Start();
+  }
+
+  SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
+  Release_Store(&should_run_, false);
+
+  int total_reqs = 0;
+  for (auto& thr : threads) {
+    thr->Join();
+    total_reqs += thr->request_count_;
+  }
+  sw.stop();
+
+  SummarizePerf(sw.elapsed(), total_reqs, BenchMode::OPEN_LOOP);
 }
 
 } // namespace rpc
 } // namespace kudu
-
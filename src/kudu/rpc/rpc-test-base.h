@@ -293,6 +293,15 @@ class CalculatorService : public CalculatorServiceIf {
 
   void Echo(const EchoRequestPB *req, EchoResponsePB *resp, RpcContext *context) override {
     resp->set_data(req->data());
+    resp->set_on_arena(req->GetArena() != nullptr && resp->GetArena() == req->GetArena());
+    if (req->has_sidecar_idx()) {
+      // The sidecar refers to the request's memory, which outlives the response.
+      Slice sidecar;
+      CHECK_OK(context->GetInboundSidecar(req->sidecar_idx(), &sidecar));
+      int idx;
+      CHECK_OK(context->AddOutboundSidecar(RpcSidecar::FromSlice(sidecar), &idx));
+      resp->set_sidecar_idx(idx);
+    }
     context->RespondSuccess();
   }
 
@@ -72,6 +72,10 @@ METRIC_DECLARE_histogram(rpc_incoming_queue_time);
 
 DECLARE_bool(rpc_reopen_outbound_connections);
 DECLARE_int32(rpc_negotiation_inject_delay_ms);
+DECLARE_int64(rpc_compression_min_bytes);
+DECLARE_int64(rpc_zero_copy_min_response_bytes);
+DECLARE_string(rpc_compression_codec);
+DECLARE_string(rpc_reactor_cpu_affinity);
 
 using std::shared_ptr;
 using std::string;
@@ -726,6 +730,139 @@ TEST_P(TestRpc, TestRpcSidecar) {
   DoTestOutgoingSidecarExpectOK(p, 3000 * 1024, 2000 * 1024);
 }
 
+// Test that responses sent with zero-copy sends arrive intact. On kernels
+// without MSG_ZEROCOPY, and with TLS, the responses are sent as usual.
+TEST_P(TestRpc, TestRpcSidecarZeroCopy) {
+  FLAGS_rpc_zero_copy_min_response_bytes = 1024;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, GetParam()));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  // Mix responses below and above the threshold, including ones which can't
+  // be written to the socket in a single call.
+  for (int i = 0; i < 3; i++) {
+    DoTestSidecar(p, 123, 456);
+    DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+    DoTestSidecar(p, 0, 0);
+  }
+}
+
+// Test that calls whose responses were sent with zero-copy sends finish on
+// the server, even when the kernel reports all of the sends as completed
+// before the response is fully written. That's always the case on loopback,
+// where the kernel copies the data and zero-copy sends get disabled while
+// large responses are being written.
+TEST_P(TestRpc, TestZeroCopyCallsFinishOnLoopback) {
+  FLAGS_rpc_zero_copy_min_response_bytes = 1024;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, GetParam()));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  for (int i = 0; i < 5; i++) {
+    DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+    DoTestSidecar(p, 4096, 0);
+  }
+
+  // None of the calls is left waiting for its zero-copy sends to complete.
+  ASSERT_EVENTUALLY([&]{
+    DumpRunningRpcsRequestPB dump_req;
+    DumpRunningRpcsResponsePB dump_resp;
+    dump_req.set_include_traces(false);
+    ASSERT_OK(server_messenger_->DumpRunningRpcs(dump_req, &dump_resp));
+    for (const auto& conn : dump_resp.inbound_connections()) {
+      ASSERT_EQ(0, conn.calls_in_flight_size());
+    }
+  });
+}
+
+// Test that requests and responses compressed on the wire, together with
+// their sidecars, arrive intact with each supported codec.
+TEST_P(TestRpc, TestCompressedCalls) {
+  FLAGS_rpc_compression_min_bytes = 100;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  for (const char* codec : { "lz4", "zstd" }) {
+    SCOPED_TRACE(codec);
+    FLAGS_rpc_compression_codec = codec;
+
+    // The codec is chosen when a connection is negotiated, so set up a new
+    // client for each one.
+    shared_ptr<Messenger> client_messenger;
+    ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, GetParam()));
+    Proxy p(client_messenger, server_addr, server_addr.host(),
+            GenericCalculatorService::static_service_name());
+
+    // Random sidecars don't compress, so they are sent as-is; the ones pushed
+    // by the client, and echoed back in the response, do.
+    DoTestSidecar(p, 0, 0);
+    DoTestSidecar(p, 123, 456);
+    DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+    DoTestOutgoingSidecarExpectOK(p, 0, 0);
+    DoTestOutgoingSidecarExpectOK(p, 123, 456);
+    DoTestOutgoingSidecarExpectOK(p, 3000 * 1024, 2000 * 1024);
+  }
+}
+
+// Test that a server can listen with one acceptor pool per reactor, each
+// on its own SO_REUSEPORT socket, and that connections made to the shared port
+// are served.
+TEST_P(TestRpc, TestAcceptorPerReactor) {
+  FLAGS_rpc_reactor_cpu_affinity = "cpu";
+  constexpr int kNumReactors = 4;
+  bool enable_ssl = GetParam();
+  shared_ptr<Messenger> server_messenger;
+  ASSERT_OK(CreateMessenger("Server", &server_messenger, kNumReactors, enable_ssl));
+  Sockaddr unused_addr;
+  ASSERT_OK(StartTestServerWithCustomMessenger(&unused_addr, server_messenger, enable_ssl));
+
+  vector<shared_ptr<AcceptorPool>> pools;
+  ASSERT_OK(server_messenger->AddReactorAcceptorPools(Sockaddr(), &pools));
+  ASSERT_EQ(kNumReactors, pools.size());
+  Sockaddr server_addr = pools[0]->bind_address();
+  ASSERT_NE(0, server_addr.port());
+  for (const auto& pool : pools) {
+    ASSERT_EQ(server_addr.port(), pool->bind_address().port());
+    ASSERT_OK(pool->Start(1));
+  }
+
+  // Each client messenger makes its own connection, from its own port.
+  constexpr int kNumClients = 8;
+  for (int i = 0; i < kNumClients; i++) {
+    shared_ptr<Messenger> client_messenger;
+    ASSERT_OK(CreateMessenger(strings::Substitute("Client$0", i), &client_messenger, 1,
+                              enable_ssl));
+    Proxy p(client_messenger, server_addr, server_addr.host(),
+            GenericCalculatorService::static_service_name());
+    for (int j = 0; j < 3; j++) {
+      ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+    }
+  }
+
+  // All the acceptor pools share the messenger's counter of accepted
+  // connections.
+  ASSERT_EQ(kNumClients, pools[0]->num_rpc_connections_accepted());
+}
+
 TEST_P(TestRpc, TestRpcSidecarLimits) {
   {
     // Test that the limits on the number of sidecars is respected.
@@ -24,6 +24,7 @@
 #include <glog/logging.h>
 #include <google/protobuf/message.h>
 
+#include "kudu/gutil/basictypes.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/remote_method.h"
@@ -48,8 +49,10 @@ namespace rpc {
 
 RpcContext::RpcContext(InboundCall *call,
                        const google::protobuf::Message *request_pb,
-                       google::protobuf::Message *response_pb)
+                       google::protobuf::Message *response_pb,
+                       unique_ptr<google::protobuf::Arena> arena)
   : call_(CHECK_NOTNULL(call)),
+    arena_(std::move(arena)),
     request_pb_(request_pb),
     response_pb_(response_pb) {
   VLOG(4) << call_->remote_method().service_name() << ": Received RPC request for "
@@ -60,6 +63,11 @@ RpcContext::RpcContext(InboundCall *call,
 }
 
 RpcContext::~RpcContext() {
+  if (arena_) {
+    // The protobufs are freed with the arena; they mustn't be deleted.
+    ignore_result(request_pb_.release());
+    ignore_result(response_pb_.release());
+  }
 }
 
 void RpcContext::SetResultTracker(scoped_refptr<ResultTracker> result_tracker) {
@@ -22,6 +22,7 @@
 #include <string>
 
 #include <glog/logging.h>
+#include <google/protobuf/arena.h>
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
@@ -67,9 +68,13 @@ class RpcContext {
  public:
   // Create an RpcContext. This is called only from generated code
   // and is not a public API.
+  //
+  // If 'arena' is not null, 'request_pb' and 'response_pb' are allocated on
+  // it, and are freed along with it when the context is destroyed.
   RpcContext(InboundCall *call,
              const google::protobuf::Message *request_pb,
-             google::protobuf::Message *response_pb);
+             google::protobuf::Message *response_pb,
+             std::unique_ptr<google::protobuf::Arena> arena = nullptr);
 
   ~RpcContext();
 
@@ -241,8 +246,10 @@ class RpcContext {
  private:
   friend class ResultTracker;
   InboundCall* const call_;
-  const gscoped_ptr<const google::protobuf::Message> request_pb_;
-  const gscoped_ptr<google::protobuf::Message> response_pb_;
+  // Declared before the protobufs, which may be allocated on it.
+  const std::unique_ptr<google::protobuf::Arena> arena_;
+  gscoped_ptr<const google::protobuf::Message> request_pb_;
+  gscoped_ptr<google::protobuf::Message> response_pb_;
   scoped_refptr<ResultTracker> result_tracker_;
 };
 
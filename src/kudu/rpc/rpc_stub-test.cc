@@ -67,6 +67,7 @@
 #include "kudu/util/user.h"
 
 DEFINE_bool(is_panic_test_child, false, "Used by TestRpcPanic");
+DECLARE_bool(rpc_allocate_messages_on_arena);
 DECLARE_bool(socket_inject_short_recvs);
 
 using kudu::pb_util::SecureDebugString;
@@ -157,6 +158,22 @@ TEST_F(RpcStubTest, TestBigCallData) {
   }
 }
 
+// Test that the protobufs of calls to methods which allow it are allocated on
+// a protobuf arena, unless that is disabled.
+TEST_F(RpcStubTest, TestArenaAllocatedMessages) {
+  CalculatorServiceProxy p(client_messenger_, server_addr_, server_addr_.host());
+  for (bool use_arena : { true, false }) {
+    FLAGS_rpc_allocate_messages_on_arena = use_arena;
+    RpcController controller;
+    EchoRequestPB req;
+    req.set_data("hello");
+    EchoResponsePB resp;
+    ASSERT_OK(p.Echo(req, &resp, &controller));
+    ASSERT_EQ("hello", resp.data());
+    ASSERT_EQ(use_arena, resp.on_arena());
+  }
+}
+
 TEST_F(RpcStubTest, TestRespondDeferred) {
   CalculatorServiceProxy p(client_messenger_, server_addr_, server_addr_.host());
 
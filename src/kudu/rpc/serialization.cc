@@ -20,6 +20,7 @@
 #include <limits>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
@@ -31,6 +32,7 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/constants.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/slice.h"
@@ -41,6 +43,7 @@ DECLARE_int64(rpc_max_message_size);
 using google::protobuf::MessageLite;
 using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::CodedOutputStream;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -177,6 +180,71 @@ Status ParseMessage(const Slice& buf,
   return Status::OK();
 }
 
+bool CompressMainMessage(const CompressionCodec& codec,
+                         const faststring& param_buf,
+                         const vector<Slice>& sidecars,
+                         faststring* compressed_buf,
+                         uint32_t* uncompressed_size) {
+  // Skip the varint prefix; it records the uncompressed size, which is sent
+  // in the header instead.
+  CodedInputStream in(param_buf.data(), param_buf.size());
+  uint32_t recorded_size;
+  CHECK(in.ReadVarint32(&recorded_size));
+  int prefix_len = CodedOutputStream::VarintSize32(recorded_size);
+
+  vector<Slice> input;
+  input.reserve(1 + sidecars.size());
+  input.emplace_back(param_buf.data() + prefix_len, param_buf.size() - prefix_len);
+  for (const Slice& sidecar : sidecars) {
+    input.emplace_back(sidecar);
+  }
+
+  size_t max_len = codec.MaxCompressedLength(recorded_size);
+  compressed_buf->resize(CodedOutputStream::VarintSize32(max_len) + max_len);
+  size_t compressed_len;
+  Status s = codec.Compress(input,
+                            compressed_buf->data() + CodedOutputStream::VarintSize32(max_len),
+                            &compressed_len);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 10) << "Unable to compress RPC message: " << s.ToString();
+    return false;
+  }
+  int compressed_prefix_len = CodedOutputStream::VarintSize32(compressed_len);
+  if (compressed_prefix_len + compressed_len >= prefix_len + recorded_size) {
+    return false;
+  }
+
+  // The varint prefix of the compressed length may be shorter than the one
+  // reserved for the maximum length; move the data up against it.
+  uint8_t* data = compressed_buf->data();
+  memmove(data + compressed_prefix_len,
+          data + CodedOutputStream::VarintSize32(max_len),
+          compressed_len);
+  CodedOutputStream::WriteVarint32ToArray(compressed_len, data);
+  compressed_buf->resize(compressed_prefix_len + compressed_len);
+  *uncompressed_size = recorded_size;
+  return true;
+}
+
+Status UncompressMainMessage(const CompressionCodec& codec,
+                             const Slice& compressed,
+                             uint32_t uncompressed_size,
+                             faststring* uncompressed) {
+  if (PREDICT_FALSE(uncompressed_size > FLAGS_rpc_max_message_size)) {
+    return Status::Corruption(Substitute(
+        "Invalid packet: compressed message would expand to $0 bytes, "
+        "larger than the maximum configured RPC message size ($1 bytes)",
+        uncompressed_size, FLAGS_rpc_max_message_size));
+  }
+  uncompressed->resize(uncompressed_size);
+  Status s = codec.Uncompress(compressed, uncompressed->data(), uncompressed_size);
+  if (PREDICT_FALSE(!s.ok())) {
+    return Status::Corruption("Invalid packet: unable to uncompress main message",
+                              s.ToString());
+  }
+  return Status::OK();
+}
+
 void SerializeConnHeader(uint8_t* buf) {
   memcpy(reinterpret_cast<char *>(buf), kMagicNumber, kMagicNumberLength);
   buf += kMagicNumberLength;
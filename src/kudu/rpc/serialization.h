@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <vector>
 
 namespace google {
 namespace protobuf {
@@ -29,6 +30,7 @@ class MessageLite;
 
 namespace kudu {
 
+class CompressionCodec;
 class Status;
 class faststring;
 class Slice;
@@ -74,6 +76,30 @@ Status ParseMessage(const Slice& buf,
                     google::protobuf::MessageLite* parsed_header,
                     Slice* parsed_main_message);
 
+// Compress a main message serialized by SerializeMessage() into 'param_buf',
+// together with the sidecars that follow it, as a single unit with 'codec'.
+// On success, 'compressed_buf' holds the varint-prefixed compressed data,
+// which replaces both the main message and the sidecars on the wire, and
+// 'uncompressed_size' holds the size of the main message and sidecars without
+// the varint prefix.
+//
+// Returns false, leaving the call to be sent uncompressed, if compression
+// fails or does not shrink the data.
+bool CompressMainMessage(const CompressionCodec& codec,
+                         const faststring& param_buf,
+                         const std::vector<Slice>& sidecars,
+                         faststring* compressed_buf,
+                         uint32_t* uncompressed_size);
+
+// Uncompress the main message and sidecars sent as 'compressed' by the remote
+// side's CompressMainMessage() into 'uncompressed'. The result has the layout
+// of an uncompressed main message as parsed by ParseMessage(), i.e. the
+// sidecar offsets in the header refer into it.
+Status UncompressMainMessage(const CompressionCodec& codec,
+                             const Slice& compressed,
+                             uint32_t uncompressed_size,
+                             faststring* uncompressed);
+
 // Serialize the RPC connection header (magic number + flags).
 // buf must have 7 bytes available (kMagicNumberLength + kHeaderFlagsLength).
 void SerializeConnHeader(uint8_t* buf);
@@ -17,6 +17,7 @@
 
 #include "kudu/rpc/service_if.h"
 
+#include <algorithm>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -24,7 +25,9 @@
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <google/protobuf/arena.h>
 
+#include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -46,6 +49,21 @@
 DEFINE_bool(enable_exactly_once, true, "Whether to enable exactly once semantics.");
 TAG_FLAG(enable_exactly_once, hidden);
 
+DEFINE_bool(rpc_allocate_messages_on_arena, true,
+            "Whether to allocate the request and response protobufs of RPC methods "
+            "which allow it (see the 'allocate_on_arena' method option) on a "
+            "per-call protobuf arena, rather than on the heap.");
+TAG_FLAG(rpc_allocate_messages_on_arena, advanced);
+TAG_FLAG(rpc_allocate_messages_on_arena, runtime);
+
+// The arena used for a call's protobufs starts with a block sized after the
+// serialized request, within these bounds, and grows in blocks of at most the
+// maximum size.
+static const size_t kMinArenaBlockSize = 256;
+static const size_t kMaxArenaBlockSize = 64 * 1024;
+
+using google::protobuf::Arena;
+using google::protobuf::ArenaOptions;
 using google::protobuf::Message;
 using std::string;
 using std::unique_ptr;
@@ -104,13 +122,24 @@ void GeneratedServiceIf::Handle(InboundCall *call) {
     RespondBadMethod(call);
     return;
   }
-  unique_ptr<Message> req(method_info->req_prototype->New());
-  if (PREDICT_FALSE(!ParseParam(call, req.get()))) {
+  unique_ptr<Arena> arena;
+  if (method_info->allocate_on_arena && FLAGS_rpc_allocate_messages_on_arena) {
+    ArenaOptions options;
+    options.start_block_size = std::min(
+        std::max(call->serialized_request().size(), kMinArenaBlockSize), kMaxArenaBlockSize);
+    options.max_block_size = kMaxArenaBlockSize;
+    arena.reset(new Arena(options));
+  }
+  // Arena-allocated messages are freed along with the arena instead.
+  Message* req = method_info->req_prototype->New(arena.get());
+  unique_ptr<Message> req_owner(arena ? nullptr : req);
+  if (PREDICT_FALSE(!ParseParam(call, req))) {
     return;
   }
-  Message* resp = method_info->resp_prototype->New();
+  Message* resp = method_info->resp_prototype->New(arena.get());
 
-  RpcContext* ctx = new RpcContext(call, req.release(), resp);
+  ignore_result(req_owner.release());
+  RpcContext* ctx = new RpcContext(call, req, resp, std::move(arena));
   if (!method_info->authz_method(ctx->request_pb(), resp, ctx)) {
     // The authz_method itself should have responded to the RPC.
     return;
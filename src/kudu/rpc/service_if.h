@@ -26,6 +26,7 @@
 #include <google/protobuf/message.h>
 
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/util/metrics.h"
 
 namespace kudu {
@@ -52,6 +53,13 @@ struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
   // Whether we should track this method's result, using ResultTracker.
   bool track_result;
 
+  // The class of service queue in which calls to this method wait.
+  RpcPriorityClassPB priority_class = PRIORITY_NORMAL;
+
+  // Whether the request and response protobufs of calls to this method are
+  // allocated on a per-call protobuf arena.
+  bool allocate_on_arena = false;
+
   // The authorization function for this RPC. If this function
   // returns false, the RPC has already been handled (i.e. rejected)
   // by the authorization function.
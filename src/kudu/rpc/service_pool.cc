@@ -26,21 +26,28 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/remote_method.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/numa.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/trace.h"
@@ -68,6 +75,84 @@ METRIC_DEFINE_counter(server, rpcs_queue_overflow,
                       "Number of RPCs dropped because the service queue "
                       "was full.");
 
+METRIC_DEFINE_counter(server, rpcs_queue_shed,
+                      "RPC Queue Load Sheds",
+                      kudu::MetricUnit::kRequests,
+                      "Number of RPCs rejected because they waited too long "
+                      "in an overloaded service queue. Only counted when "
+                      "--rpc_service_queue_target_delay_ms is set.");
+
+DEFINE_int32(rpc_service_queue_target_delay_ms, 0,
+             "If positive, the service queues shed load once RPCs persistently "
+             "wait longer than this many milliseconds in them: when even the "
+             "shortest wait over an interval of --rpc_service_queue_interval_ms "
+             "exceeds the target, RPCs which waited more than twice the target are "
+             "rejected with a retriable 'server too busy' error rather than "
+             "handled. If 0, RPCs are only rejected when a service queue is full.");
+TAG_FLAG(rpc_service_queue_target_delay_ms, experimental);
+
+DEFINE_int32(rpc_service_queue_interval_ms, 100,
+             "The interval over which a service queue judges whether it is "
+             "overloaded. See --rpc_service_queue_target_delay_ms.");
+TAG_FLAG(rpc_service_queue_interval_ms, experimental);
+
+DEFINE_string(rpc_service_queue_priority_weights, "8,4,1",
+              "Comma-separated weights of the high, normal and low RPC priority "
+              "classes. Service threads take queued RPCs of the classes in "
+              "proportion to these weights, so that a backlog of low-priority "
+              "RPCs, such as scans, doesn't delay high-priority ones, such as "
+              "writes. The priority class of an RPC method is set in its "
+              "service definition.");
+TAG_FLAG(rpc_service_queue_priority_weights, advanced);
+TAG_FLAG(rpc_service_queue_priority_weights, experimental);
+
+DEFINE_bool(rpc_service_thread_numa_affinity, false,
+            "Whether to pin the service threads of each RPC service to NUMA "
+            "nodes, spreading them over the nodes round-robin, so that the "
+            "memory they allocate while handling RPCs is local to the CPUs they "
+            "run on. Has no effect on machines without NUMA nodes. Only "
+            "supported on Linux.");
+TAG_FLAG(rpc_service_thread_numa_affinity, experimental);
+
+namespace {
+
+bool ParsePriorityWeights(const string& weights_str, vector<int>* weights) {
+  vector<int> parsed;
+  for (StringPiece weight_str : strings::Split(weights_str, ",")) {
+    int weight;
+    if (!safe_strto32(weight_str.ToString(), &weight) || weight <= 0) {
+      return false;
+    }
+    parsed.push_back(weight);
+  }
+  if (parsed.size() != kudu::rpc::LifoServiceQueue::kNumPriorityClasses) {
+    return false;
+  }
+  weights->swap(parsed);
+  return true;
+}
+
+bool ValidatePriorityWeights(const char* flag_name, const string& flag_value) {
+  vector<int> weights;
+  if (!ParsePriorityWeights(flag_value, &weights)) {
+    LOG(ERROR) << Substitute("invalid value for --$0: '$1' (expected $2 comma-separated "
+                             "positive integers)", flag_name, flag_value,
+                             kudu::rpc::LifoServiceQueue::kNumPriorityClasses);
+    return false;
+  }
+  return true;
+}
+
+vector<int> PriorityWeights() {
+  vector<int> weights;
+  CHECK(ParsePriorityWeights(FLAGS_rpc_service_queue_priority_weights, &weights));
+  return weights;
+}
+
+} // anonymous namespace
+
+DEFINE_validator(rpc_service_queue_priority_weights, &ValidatePriorityWeights);
+
 namespace kudu {
 namespace rpc {
 
@@ -75,10 +160,16 @@ ServicePool::ServicePool(gscoped_ptr<ServiceIf> service,
                          const scoped_refptr<MetricEntity>& entity,
                          size_t service_queue_length)
   : service_(std::move(service)),
-    service_queue_(service_queue_length),
+    service_queue_(service_queue_length,
+                   FLAGS_rpc_service_queue_target_delay_ms > 0 ?
+                       MonoDelta::FromMilliseconds(FLAGS_rpc_service_queue_target_delay_ms) :
+                       MonoDelta(),
+                   MonoDelta::FromMilliseconds(FLAGS_rpc_service_queue_interval_ms),
+                   PriorityWeights()),
     incoming_queue_time_(METRIC_rpc_incoming_queue_time.Instantiate(entity)),
     rpcs_timed_out_in_queue_(METRIC_rpcs_timed_out_in_queue.Instantiate(entity)),
     rpcs_queue_overflow_(METRIC_rpcs_queue_overflow.Instantiate(entity)),
+    rpcs_queue_shed_(METRIC_rpcs_queue_shed.Instantiate(entity)),
     closing_(false) {
 }
 
@@ -90,7 +181,7 @@ Status ServicePool::Init(int num_threads) {
   for (int i = 0; i < num_threads; i++) {
     scoped_refptr<kudu::Thread> new_thread;
     CHECK_OK(kudu::Thread::Create("service pool", "rpc worker",
-        &ServicePool::RunThread, this, &new_thread));
+        &ServicePool::RunThread, this, i, &new_thread));
     threads_.push_back(new_thread);
   }
   return Status::OK();
@@ -137,6 +228,20 @@ void ServicePool::RejectTooBusy(InboundCall* c) {
   }
 }
 
+void ServicePool::RejectOverloaded(InboundCall* c) {
+  string err_msg =
+      Substitute("$0 request on $1 from $2 dropped due to backpressure. "
+                 "The service queue is overloaded; the call waited $3 in it.",
+                 c->remote_method().method_name(),
+                 service_->service_name(),
+                 c->remote_address().ToString(),
+                 (MonoTime::Now() - c->GetTimeReceived()).ToString());
+  rpcs_queue_shed_->Increment();
+  KLOG_EVERY_N_SECS(WARNING, 1) << err_msg << THROTTLE_MSG;
+  c->RespondFailure(ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
+                    Status::ServiceUnavailable(err_msg));
+}
+
 RpcMethodInfo* ServicePool::LookupMethod(const RemoteMethod& method) {
   return service_->LookupMethod(method);
 }
@@ -191,10 +296,19 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
   return status;
 }
 
-void ServicePool::RunThread() {
+void ServicePool::RunThread(int thread_idx) {
+  if (FLAGS_rpc_service_thread_numa_affinity) {
+    int num_nodes = NumNumaNodes();
+    if (num_nodes > 0) {
+      WARN_NOT_OK(BindCurrentThreadToNumaNode(thread_idx % num_nodes),
+                  "unable to pin service thread to its NUMA node");
+    }
+  }
+
   while (true) {
     std::unique_ptr<InboundCall> incoming;
-    if (!service_queue_.BlockingGet(&incoming)) {
+    bool shed;
+    if (!service_queue_.BlockingGet(&incoming, &shed)) {
       VLOG(1) << "ServicePool: messenger shutting down.";
       return;
     }
@@ -202,6 +316,13 @@ void ServicePool::RunThread() {
     incoming->RecordHandlingStarted(incoming_queue_time_.get());
     ADOPT_TRACE(incoming->trace());
 
+    if (PREDICT_FALSE(shed)) {
+      TRACE_TO(incoming->trace(), "Shedding call from overloaded queue");
+      // RejectOverloaded() ends up taking ownership of the call.
+      RejectOverloaded(incoming.release());
+      continue;
+    }
+
     if (PREDICT_FALSE(incoming->ClientTimedOut())) {
       TRACE_TO(incoming->trace(), "Skipping call since client already timed out");
       rpcs_timed_out_in_queue_->Increment();
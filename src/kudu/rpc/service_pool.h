@@ -90,18 +90,28 @@ class ServicePool : public RpcService {
     return rpcs_queue_overflow_.get();
   }
 
+  const Counter* RpcsQueueShedMetricForTests() const {
+    return rpcs_queue_shed_.get();
+  }
+
   const std::string service_name() const;
 
  private:
-  void RunThread();
+  // Handles queued RPCs until the pool shuts down. 'thread_idx' is the index
+  // of the thread within the pool.
+  void RunThread(int thread_idx);
   void RejectTooBusy(InboundCall* c);
 
+  // Rejects a call which the service queue shed because of its queueing delay.
+  void RejectOverloaded(InboundCall* c);
+
   gscoped_ptr<ServiceIf> service_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
   LifoServiceQueue service_queue_;
   scoped_refptr<Histogram> incoming_queue_time_;
   scoped_refptr<Counter> rpcs_timed_out_in_queue_;
   scoped_refptr<Counter> rpcs_queue_overflow_;
+  scoped_refptr<Counter> rpcs_queue_shed_;
 
   mutable Mutex shutdown_lock_;
   bool closing_;
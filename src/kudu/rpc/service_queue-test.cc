@@ -21,6 +21,7 @@
 #include <ostream>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -30,10 +31,14 @@
 
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::shared_ptr;
@@ -147,5 +152,142 @@ TEST(TestServiceQueue, LifoServiceQueuePerf) {
   LOG(INFO) << "Avg idle workers:     " << total_idle_workers / static_cast<double>(total_sample);
 }
 
+// Test that in controlled-delay mode, the queue sheds the calls which waited
+// too long only once the queueing delay has stayed above the target for an
+// interval, and stops shedding once the delay drops again.
+TEST(TestServiceQueue, TestControlledDelay) {
+  const MonoDelta kTarget = MonoDelta::FromMilliseconds(5);
+  const MonoDelta kInterval = MonoDelta::FromMilliseconds(50);
+  LifoServiceQueue queue(10, kTarget, kInterval);
+
+  // Consume from a separate thread, since consumers are bound to the first
+  // queue they access.
+  std::thread consumer([&]() {
+    auto put = [&]() {
+      boost::optional<InboundCall*> evicted;
+      ASSERT_EQ(QUEUE_SUCCESS, queue.Put(new InboundCall(nullptr), &evicted));
+      ASSERT_TRUE(evicted == boost::none);
+    };
+    auto get = [&](bool* shed) {
+      unique_ptr<InboundCall> call;
+      ASSERT_TRUE(queue.BlockingGet(&call, shed));
+    };
+    bool shed;
+    for (int i = 0; i < 4; i++) {
+      NO_FATALS(put());
+    }
+
+    // The first call starts the first interval; nothing is known to be
+    // overloaded yet.
+    SleepFor(MonoDelta::FromMilliseconds(20));
+    NO_FATALS(get(&shed));
+    ASSERT_FALSE(shed);
+
+    // Over the whole interval the shortest delay exceeded the target, so the
+    // calls that waited too long are shed from now on.
+    SleepFor(MonoDelta::FromMilliseconds(55));
+    NO_FATALS(get(&shed));
+    ASSERT_TRUE(shed);
+    NO_FATALS(get(&shed));
+    ASSERT_TRUE(shed);
+    NO_FATALS(get(&shed));
+    ASSERT_TRUE(shed);
+
+    // A fresh call is handled even while the queue is overloaded.
+    NO_FATALS(put());
+    NO_FATALS(get(&shed));
+    ASSERT_FALSE(shed);
+
+    // That call's short wait ends the overload with the next interval.
+    SleepFor(MonoDelta::FromMilliseconds(55));
+    for (int i = 0; i < 2; i++) {
+      NO_FATALS(put());
+    }
+    NO_FATALS(get(&shed));
+    ASSERT_FALSE(shed);
+    NO_FATALS(get(&shed));
+    ASSERT_FALSE(shed);
+  });
+  consumer.join();
+  queue.Shutdown();
+}
+
+// Returns a new call to a method of the given priority class.
+static InboundCall* NewCall(RpcPriorityClassPB priority_class) {
+  scoped_refptr<RpcMethodInfo> info(new RpcMethodInfo());
+  info->priority_class = priority_class;
+  InboundCall* call = new InboundCall(nullptr);
+  call->set_method_info(std::move(info));
+  return call;
+}
+
+// Test that calls of different priority classes are taken in weighted
+// round-robin order.
+TEST(TestServiceQueue, TestPriorityClassScheduling) {
+  LifoServiceQueue queue(100, MonoDelta(), MonoDelta::FromMilliseconds(100), { 2, 1, 1 });
+  for (int i = 0; i < 4; i++) {
+    for (RpcPriorityClassPB priority : { PRIORITY_LOW, PRIORITY_NORMAL, PRIORITY_HIGH }) {
+      boost::optional<InboundCall*> evicted;
+      ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall(priority), &evicted));
+    }
+  }
+  ASSERT_EQ(12, queue.estimated_queue_length());
+
+  // Consume from a separate thread, since consumers are bound to the first
+  // queue they access.
+  vector<int> order;
+  std::thread consumer([&]() {
+    unique_ptr<InboundCall> call;
+    while (!queue.empty() && queue.BlockingGet(&call)) {
+      order.push_back(call->method_info()->priority_class);
+    }
+  });
+  consumer.join();
+  queue.Shutdown();
+
+  const vector<int> kExpected = {
+    PRIORITY_HIGH, PRIORITY_HIGH, PRIORITY_NORMAL, PRIORITY_LOW,
+    PRIORITY_HIGH, PRIORITY_HIGH, PRIORITY_NORMAL, PRIORITY_LOW,
+    PRIORITY_NORMAL, PRIORITY_LOW,
+    PRIORITY_NORMAL, PRIORITY_LOW,
+  };
+  ASSERT_EQ(kExpected, order);
+}
+
+// Test that a full queue makes room for a call by evicting a call of a less
+// important class, but never of a more important one.
+TEST(TestServiceQueue, TestPriorityClassEviction) {
+  LifoServiceQueue queue(2);
+  boost::optional<InboundCall*> evicted;
+  InboundCall* low = NewCall(PRIORITY_LOW);
+  InboundCall* normal = NewCall(PRIORITY_NORMAL);
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall(PRIORITY_HIGH), &evicted));
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(low, &evicted));
+  ASSERT_TRUE(evicted == boost::none);
+
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(normal, &evicted));
+  ASSERT_TRUE(evicted == low);
+  delete low;
+
+  unique_ptr<InboundCall> rejected(NewCall(PRIORITY_LOW));
+  evicted = boost::none;
+  ASSERT_EQ(QUEUE_FULL, queue.Put(rejected.get(), &evicted));
+  ASSERT_TRUE(evicted == boost::none);
+
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall(PRIORITY_HIGH), &evicted));
+  ASSERT_TRUE(evicted == normal);
+  delete normal;
+
+  std::thread consumer([&]() {
+    unique_ptr<InboundCall> call;
+    for (int i = 0; i < 2; i++) {
+      ASSERT_TRUE(queue.BlockingGet(&call));
+      ASSERT_EQ(PRIORITY_HIGH, call->method_info()->priority_class);
+    }
+  });
+  consumer.join();
+  queue.Shutdown();
+}
+
 } // namespace rpc
 } // namespace kudu
@@ -19,28 +19,80 @@
 
 #include <mutex>
 #include <ostream>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 
 #include "kudu/gutil/port.h"
+#include "kudu/rpc/service_if.h"
 
 namespace kudu {
 namespace rpc {
 
 __thread LifoServiceQueue::ConsumerState* LifoServiceQueue::tl_consumer_ = nullptr;
 
-LifoServiceQueue::LifoServiceQueue(int max_size)
+constexpr int LifoServiceQueue::kNumPriorityClasses;
+
+LifoServiceQueue::LifoServiceQueue(int max_size, MonoDelta target_delay, MonoDelta interval,
+                                   const std::vector<int>& priority_weights)
    : shutdown_(false),
-     max_queue_size_(max_size) {
+     max_queue_size_(max_size),
+     target_delay_(target_delay),
+     interval_(interval),
+     min_delay_(MonoDelta::FromNanoseconds(0)),
+     overloaded_(false),
+     num_queued_(0) {
   CHECK_GT(max_queue_size_, 0);
+  if (target_delay_.Initialized()) {
+    CHECK_GT(target_delay_.ToNanoseconds(), 0);
+    CHECK(interval_.Initialized() && interval_.ToNanoseconds() > 0);
+  }
+  if (priority_weights.empty()) {
+    weights_.fill(1);
+  } else {
+    CHECK_EQ(kNumPriorityClasses, priority_weights.size());
+    for (int i = 0; i < kNumPriorityClasses; i++) {
+      CHECK_GT(priority_weights[i], 0);
+      weights_[i] = priority_weights[i];
+    }
+  }
+  credits_ = weights_;
 }
 
 LifoServiceQueue::~LifoServiceQueue() {
-  DCHECK(queue_.empty())
+  DCHECK_EQ(0, num_queued_)
       << "ServiceQueue holds bare pointers at destruction time";
 }
 
-bool LifoServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out) {
+int LifoServiceQueue::PriorityClass(InboundCall* call) {
+  const RpcMethodInfo* info = call->method_info();
+  return info ? info->priority_class : PRIORITY_NORMAL;
+}
+
+InboundCall* LifoServiceQueue::PopUnlocked() {
+  DCHECK(lock_.is_locked());
+  DCHECK_GT(num_queued_, 0);
+  while (true) {
+    for (int c = 0; c < kNumPriorityClasses; c++) {
+      auto& queue = queues_[c];
+      if (!queue.empty() && credits_[c] > 0) {
+        credits_[c]--;
+        auto it = queue.begin();
+        InboundCall* call = *it;
+        queue.erase(it);
+        num_queued_--;
+        return call;
+      }
+    }
+    // Every class with queued calls has used up its share of this round.
+    credits_ = weights_;
+  }
+}
+
+bool LifoServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out, bool* shed) {
+  if (shed) {
+    *shed = false;
+  }
   auto consumer = tl_consumer_;
   if (PREDICT_FALSE(!consumer)) {
     consumer = tl_consumer_ = new ConsumerState(this);
@@ -51,10 +103,15 @@ bool LifoServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out) {
   while (true) {
     {
       std::lock_guard<simple_spinlock> l(lock_);
-      if (!queue_.empty()) {
-        auto it = queue_.begin();
-        out->reset(*it);
-        queue_.erase(it);
+      if (num_queued_ > 0) {
+        out->reset(PopUnlocked());
+        if (target_delay_.Initialized()) {
+          MonoTime now = MonoTime::Now();
+          bool should_shed = ShouldShedUnlocked(now - (*out)->GetTimeReceived(), now);
+          if (shed) {
+            *shed = should_shed;
+          }
+        }
         return true;
       }
       if (PREDICT_FALSE(shutdown_)) {
@@ -80,12 +137,16 @@ QueueStatus LifoServiceQueue::Put(InboundCall* call,
     return QUEUE_SHUTDOWN;
   }
 
-  DCHECK(!(waiting_consumers_.size() > 0 && queue_.size() > 0));
+  DCHECK(!(waiting_consumers_.size() > 0 && num_queued_ > 0));
 
   // fast path
-  if (queue_.empty() && waiting_consumers_.size() > 0) {
+  if (num_queued_ == 0 && waiting_consumers_.size() > 0) {
     auto consumer = waiting_consumers_[waiting_consumers_.size() - 1];
     waiting_consumers_.pop_back();
+    if (target_delay_.Initialized()) {
+      // The call doesn't wait at all, which shows the queue is keeping up.
+      ShouldShedUnlocked(MonoDelta::FromNanoseconds(0), MonoTime::Now());
+    }
     // Notify condition var(and wake up consumer thread) takes time,
     // so put it out of spinlock scope.
     l.unlock();
@@ -93,23 +154,47 @@ QueueStatus LifoServiceQueue::Put(InboundCall* call,
     return QUEUE_SUCCESS;
   }
 
-  if (PREDICT_FALSE(queue_.size() >= max_queue_size_)) {
-    // eviction
-    DCHECK_EQ(queue_.size(), max_queue_size_);
-    auto it = queue_.end();
+  const int priority_class = PriorityClass(call);
+  if (PREDICT_FALSE(num_queued_ >= max_queue_size_)) {
+    // eviction, from the least important class with queued calls
+    DCHECK_EQ(num_queued_, max_queue_size_);
+    int victim_class = kNumPriorityClasses - 1;
+    while (queues_[victim_class].empty()) {
+      victim_class--;
+    }
+    auto& victim_queue = queues_[victim_class];
+    auto it = victim_queue.end();
     --it;
-    if (DeadlineLess(*it, call)) {
+    if (victim_class < priority_class ||
+        (victim_class == priority_class && DeadlineLess(*it, call))) {
       return QUEUE_FULL;
     }
 
     *evicted = *it;
-    queue_.erase(it);
+    victim_queue.erase(it);
+    num_queued_--;
   }
 
-  queue_.insert(call);
+  queues_[priority_class].insert(call);
+  num_queued_++;
   return QUEUE_SUCCESS;
 }
 
+bool LifoServiceQueue::ShouldShedUnlocked(const MonoDelta& sojourn, const MonoTime& now) {
+  DCHECK(lock_.is_locked());
+  if (!interval_end_.Initialized() || now >= interval_end_) {
+    // Judge the interval that just ended, and start a new one.
+    overloaded_ = interval_end_.Initialized() && min_delay_ > target_delay_;
+    min_delay_ = sojourn;
+    interval_end_ = now + interval_;
+  } else if (sojourn < min_delay_) {
+    min_delay_ = sojourn;
+  }
+  // Shed only calls that waited well past the target, so that a queue which is
+  // merely draining a backlog still hands out its freshest calls.
+  return overloaded_ && sojourn.ToNanoseconds() > target_delay_.ToNanoseconds() * 2;
+}
+
 void LifoServiceQueue::Shutdown() {
   std::lock_guard<simple_spinlock> l(lock_);
   shutdown_ = true;
@@ -123,7 +208,7 @@ void LifoServiceQueue::Shutdown() {
 
 bool LifoServiceQueue::empty() const {
   std::lock_guard<simple_spinlock> l(lock_);
-  return queue_.empty();
+  return num_queued_ == 0;
 }
 
 int LifoServiceQueue::max_size() const {
@@ -134,9 +219,11 @@ std::string LifoServiceQueue::ToString() const {
   std::string ret;
 
   std::lock_guard<simple_spinlock> l(lock_);
-  for (const auto* t : queue_) {
-    ret.append(t->ToString());
-    ret.append("\n");
+  for (const auto& queue : queues_) {
+    for (const auto* t : queue) {
+      ret.append(t->ToString());
+      ret.append("\n");
+    }
   }
   return ret;
 }
@@ -17,6 +17,8 @@
 #ifndef KUDU_UTIL_SERVICE_QUEUE_H
 #define KUDU_UTIL_SERVICE_QUEUE_H
 
+#include <array>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <set>
@@ -27,6 +29,7 @@
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
@@ -72,24 +75,60 @@ enum QueueStatus {
 //   work rate, the queue implementation itself is never used. Thus, we can
 //   have a priority queue without paying extra for it in the common case.
 //
+// Calls are divided into priority classes by the priority class of their
+// method (see RpcPriorityClassPB), and each class is queued separately.
+// Consumers take calls from the classes in weighted round-robin order: in each
+// round, a class hands out at most as many calls as its weight, and classes
+// are served in priority order within the round. This keeps a backlog of
+// low-priority calls from delaying the high-priority ones, without starving
+// them. The bound on the number of calls is shared by all classes, and a new
+// call which finds the queue full evicts a call of the least important class
+// queued, provided that class is less important than the new call's (or it is
+// the same class, and the evicted call has a later deadline).
+//
+// The queue may also run in a controlled-delay ("CoDel") admission mode, which
+// sheds load before the queue overflows. Rather than the queue length, it
+// watches the time calls spend in the queue: if even the shortest wait over an
+// interval exceeds the target delay, the queue is standing rather than
+// absorbing a burst, and calls which have waited more than twice the target
+// are handed back to be rejected instead of being handled. Clients retry
+// such calls with backoff, while the calls that are handled keep a bounded
+// queueing delay, instead of every call waiting until its deadline runs out.
+//
 // NOTE: because of the use of thread-local consumer records, once a consumer
 // thread accesses one LifoServiceQueue, it becomes "bound" to that queue and
 // must never access any other instance.
 class LifoServiceQueue {
  public:
-  explicit LifoServiceQueue(int max_size);
+  static constexpr int kNumPriorityClasses = RpcPriorityClassPB_ARRAYSIZE;
+
+  // If 'target_delay' is initialized, the queue runs in controlled-delay mode,
+  // judging whether it is overloaded once every 'interval'.
+  //
+  // If not empty, 'priority_weights' holds the weight of each priority class,
+  // indexed by RpcPriorityClassPB. Otherwise, all the classes are weighted
+  // equally.
+  explicit LifoServiceQueue(int max_size,
+                            MonoDelta target_delay = MonoDelta(),
+                            MonoDelta interval = MonoDelta::FromMilliseconds(100),
+                            const std::vector<int>& priority_weights = {});
 
   ~LifoServiceQueue();
 
   // Get an element from the queue.  Returns false if we were shut down prior to
   // getting the element.
-  bool BlockingGet(std::unique_ptr<InboundCall>* out);
+  //
+  // In controlled-delay mode, if 'shed' is not null, it is set to whether the
+  // returned call should be rejected rather than handled, because the queue is
+  // overloaded and the call has already waited too long.
+  bool BlockingGet(std::unique_ptr<InboundCall>* out, bool* shed = nullptr);
 
   // Add a new call to the queue.
   // Returns:
   // - QUEUE_SHUTDOWN if Shutdown() has already been called.
-  // - QUEUE_FULL if the queue is full and 'call' has a later deadline than any
-  //   RPC already in the queue.
+  // - QUEUE_FULL if the queue is full and there's no call to evict for 'call':
+  //   every queued call is of a more important class, or of the same class and
+  //   with an earlier deadline.
   // - QUEUE_SUCCESS if 'call' was enqueued.
   //
   // In the case of a 'QUEUE_SUCCESS' response, the new element may have bumped
@@ -113,11 +152,7 @@ class LifoServiceQueue {
   // Return an estimate of the current queue length.
   int estimated_queue_length() const {
     ANNOTATE_IGNORE_READS_BEGIN();
-    // The C++ standard says that std::multiset::size must be constant time,
-    // so this method won't try to traverse any actual nodes of the underlying
-    // RB tree. Investigation of the libstdcxx implementation confirms that
-    // size() is a simple field access of the _Rb_tree structure.
-    int ret = queue_.size();
+    int ret = num_queued_;
     ANNOTATE_IGNORE_READS_END();
     return ret;
   }
@@ -146,6 +181,17 @@ class LifoServiceQueue {
     return time_a < time_b;
   }
 
+  // Returns the priority class of 'call', by its method.
+  static int PriorityClass(InboundCall* call);
+
+  // Removes and returns the next call to handle from the queues, following
+  // the weighted round-robin order. The queues must not all be empty.
+  InboundCall* PopUnlocked();
+
+  // Accounts for a call which waited 'sojourn' in the queue, returning whether
+  // it should be shed. Only used in controlled-delay mode.
+  bool ShouldShedUnlocked(const MonoDelta& sojourn, const MonoTime& now);
+
   // Struct functor wrapper for DeadlineLess.
   struct DeadlineLessStruct {
     bool operator()(const InboundCall* a, const InboundCall* b) const {
@@ -206,12 +252,32 @@ class LifoServiceQueue {
   bool shutdown_;
   int max_queue_size_;
 
+  // Controlled-delay state. 'target_delay_' is uninitialized if the mode is
+  // disabled. The rest is protected by 'lock_'.
+  const MonoDelta target_delay_;
+  const MonoDelta interval_;
+  // The end of the current interval.
+  MonoTime interval_end_;
+  // The shortest queueing delay seen in the current interval.
+  MonoDelta min_delay_;
+  // Whether the shortest queueing delay in the previous interval exceeded the
+  // target.
+  bool overloaded_;
+
   // Stack of consumer threads which are currently waiting for work.
   std::vector<ConsumerState*> waiting_consumers_;
 
-  // The actual queue. Work is only added to the queue when there were no
-  // consumers available for a "direct hand-off".
-  std::multiset<InboundCall*, DeadlineLessStruct> queue_;
+  // The actual queues, one per priority class. Work is only added to the
+  // queues when there were no consumers available for a "direct hand-off".
+  std::array<std::multiset<InboundCall*, DeadlineLessStruct>, kNumPriorityClasses> queues_;
+
+  // The total number of calls in 'queues_'.
+  int num_queued_;
+
+  // The weight of each priority class, and the number of calls each may still
+  // hand out in the current round-robin round.
+  std::array<int, kNumPriorityClasses> weights_;
+  std::array<int, kNumPriorityClasses> credits_;
 
   // The total set of consumers who have ever accessed this queue.
   std::vector<std::unique_ptr<ConsumerState>> consumers_;
@@ -0,0 +1,154 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/rpc/timer_wheel.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/test_util.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace rpc {
+
+class TimerWheelTest : public KuduTest {
+ protected:
+  // A deadline which records the order it fired in.
+  struct Timer {
+    void Fire() {
+      fired_at = test->next_fired++;
+    }
+
+    TimerWheelTest* test;
+    int fired_at = -1;
+    TimerWheelEntry entry;
+  };
+
+  unique_ptr<Timer> NewTimer() {
+    unique_ptr<Timer> t(new Timer);
+    t->test = this;
+    t->entry.set<Timer, &Timer::Fire>(t.get());
+    return t;
+  }
+
+  int next_fired = 0;
+};
+
+TEST_F(TimerWheelTest, TestFiresInOrder) {
+  const MonoTime start = MonoTime::Now();
+  TimerWheel wheel(start);
+  ASSERT_FALSE(wheel.NextWakeup().Initialized());
+
+  // Deadlines on every level of the wheel, scheduled out of order.
+  const vector<int64_t> delays_ms = { 100000000, 5, 70, 0, 300000, 4100, 63, 64 };
+  vector<unique_ptr<Timer>> timers;
+  for (int64_t delay_ms : delays_ms) {
+    timers.emplace_back(NewTimer());
+    wheel.Schedule(&timers.back()->entry, start + MonoDelta::FromMilliseconds(delay_ms));
+  }
+
+  // Each deadline fires once the wheel turns to it, and not before.
+  vector<int> by_deadline = { 3, 1, 6, 7, 2, 5, 4, 0 };
+  for (int order = 0; order < by_deadline.size(); order++) {
+    int i = by_deadline[order];
+    SCOPED_TRACE(delays_ms[i]);
+    MonoTime deadline = start + MonoDelta::FromMilliseconds(delays_ms[i]);
+    ASSERT_LE(wheel.NextWakeup(), deadline);
+    wheel.Advance(deadline - MonoDelta::FromMicroseconds(1));
+    ASSERT_EQ(-1, timers[i]->fired_at);
+    wheel.Advance(deadline);
+    ASSERT_EQ(order, timers[i]->fired_at);
+  }
+  ASSERT_FALSE(wheel.NextWakeup().Initialized());
+}
+
+TEST_F(TimerWheelTest, TestCancelAndReschedule) {
+  const MonoTime start = MonoTime::Now();
+  TimerWheel wheel(start);
+  unique_ptr<Timer> cancelled = NewTimer();
+  unique_ptr<Timer> destroyed = NewTimer();
+  unique_ptr<Timer> moved = NewTimer();
+  wheel.Schedule(&cancelled->entry, start + MonoDelta::FromMilliseconds(10));
+  wheel.Schedule(&destroyed->entry, start + MonoDelta::FromMilliseconds(10));
+  wheel.Schedule(&moved->entry, start + MonoDelta::FromMilliseconds(10));
+  ASSERT_TRUE(cancelled->entry.is_scheduled());
+
+  cancelled->entry.cancel();
+  ASSERT_FALSE(cancelled->entry.is_scheduled());
+  destroyed.reset();
+  wheel.Schedule(&moved->entry, start + MonoDelta::FromSeconds(10));
+
+  wheel.Advance(start + MonoDelta::FromSeconds(1));
+  ASSERT_EQ(-1, cancelled->fired_at);
+  ASSERT_EQ(-1, moved->fired_at);
+  wheel.Advance(start + MonoDelta::FromSeconds(10));
+  ASSERT_EQ(0, moved->fired_at);
+  ASSERT_FALSE(wheel.NextWakeup().Initialized());
+}
+
+// Test that the wheel wakes up by the first deadline, and that deadlines
+// spread over a long time all fire in order, when the wheel is advanced only
+// when it asks to be.
+TEST_F(TimerWheelTest, TestRandomDeadlines) {
+  const int kNumTimers = 1000;
+  const MonoTime start = MonoTime::Now();
+  TimerWheel wheel(start);
+  Random rng(SeedRandom());
+  vector<unique_ptr<Timer>> timers;
+  vector<MonoTime> deadlines;
+  for (int i = 0; i < kNumTimers; i++) {
+    timers.emplace_back(NewTimer());
+    deadlines.push_back(start + MonoDelta::FromMicroseconds(rng.Uniform64(600 * 1000 * 1000)));
+    wheel.Schedule(&timers.back()->entry, deadlines.back());
+  }
+
+  MonoTime now = start;
+  int wakeups = 0;
+  while (true) {
+    MonoTime next = wheel.NextWakeup();
+    if (!next.Initialized()) {
+      break;
+    }
+    ASSERT_GE(next, now);
+    for (int i = 0; i < kNumTimers; i++) {
+      if (timers[i]->fired_at == -1) {
+        ASSERT_GE(deadlines[i] + MonoDelta::FromMilliseconds(1), next);
+      }
+    }
+    now = next;
+    wheel.Advance(now);
+    wakeups++;
+  }
+  ASSERT_EQ(kNumTimers, next_fired);
+  for (int i = 0; i < kNumTimers; i++) {
+    for (int j = 0; j < kNumTimers; j++) {
+      if (deadlines[i] + MonoDelta::FromMilliseconds(1) < deadlines[j]) {
+        ASSERT_LT(timers[i]->fired_at, timers[j]->fired_at);
+      }
+    }
+  }
+  LOG(INFO) << kNumTimers << " deadlines fired in " << wakeups << " wakeups";
+}
+
+} // namespace rpc
+} // namespace kudu
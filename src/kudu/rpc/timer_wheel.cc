@@ -0,0 +1,160 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/rpc/timer_wheel.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/bits.h"
+
+namespace kudu {
+namespace rpc {
+
+TimerWheel::TimerWheel(MonoTime start, MonoDelta tick)
+    : start_(start),
+      tick_(tick),
+      cur_tick_(0) {
+  CHECK_GT(tick_.ToNanoseconds(), 0);
+}
+
+TimerWheel::~TimerWheel() {
+  // The lists unlink the entries left in them.
+}
+
+void TimerWheel::Schedule(TimerWheelEntry* entry, MonoTime deadline) {
+  DCHECK(entry->cb_) << "entry has no callback";
+  entry->unlink();
+  entry->deadline_ = deadline;
+  // Round up, so that the entry doesn't fire before its deadline.
+  int64_t nanos = (deadline - start_).ToNanoseconds();
+  int64_t tick_nanos = tick_.ToNanoseconds();
+  entry->expiry_tick_ = nanos <= 0 ? 0 : (nanos + tick_nanos - 1) / tick_nanos;
+  Insert(entry);
+}
+
+void TimerWheel::Insert(TimerWheelEntry* entry) {
+  // An entry which is already due goes in the next slot to fire.
+  uint64_t tick = std::max(entry->expiry_tick_, cur_tick_);
+  uint64_t delta = tick - cur_tick_;
+  int level = 0;
+  while (level < kNumLevels - 1 && delta >> (kLevelBits * (level + 1)) != 0) {
+    level++;
+  }
+  if (delta >> (kLevelBits * (level + 1)) != 0) {
+    // Beyond the reach of the top level: park the entry in the farthest slot
+    // of the top level, from which it's put back in the top level until it's
+    // in reach.
+    tick = cur_tick_ + (1ULL << (kLevelBits * kNumLevels)) - 1;
+  }
+  int idx = (tick >> (kLevelBits * level)) & (kSlotsPerLevel - 1);
+  Level* l = &levels_[level];
+  l->slots[idx].push_back(*entry);
+  l->occupied |= 1ULL << idx;
+}
+
+void TimerWheel::TakeSlot(int level, int idx, EntryList* out) {
+  Level* l = &levels_[level];
+  out->splice(out->end(), l->slots[idx]);
+  l->occupied &= ~(1ULL << idx);
+}
+
+uint64_t TimerWheel::NextEventTick() {
+  uint64_t next = UINT64_MAX;
+  for (int level = 0; level < kNumLevels; level++) {
+    Level* l = &levels_[level];
+    if (l->occupied == 0) {
+      continue;
+    }
+    // The wheel turns to a slot of this level on the ticks which are a
+    // multiple of the span of the slots of the level below.
+    const int shift = kLevelBits * level;
+    uint64_t first = ((cur_tick_ + (1ULL << shift) - 1) >> shift) << shift;
+    int first_idx = (first >> shift) & (kSlotsPerLevel - 1);
+    // Find the first occupied slot from 'first_idx' on, wrapping around.
+    uint64_t rotated = first_idx == 0 ? l->occupied :
+        (l->occupied >> first_idx) | (l->occupied << (kSlotsPerLevel - first_idx));
+    uint64_t slots_away = Bits::FindLSBSetNonZero64(rotated);
+    next = std::min(next, first + (slots_away << shift));
+  }
+  return next;
+}
+
+void TimerWheel::ProcessTick(uint64_t tick) {
+  DCHECK_EQ(tick, cur_tick_);
+  // Move down the entries of the higher levels first, as they may land in
+  // the slots of the lower levels which the wheel turns to on this tick.
+  for (int level = kNumLevels - 1; level > 0; level--) {
+    const int shift = kLevelBits * level;
+    if ((tick & ((1ULL << shift) - 1)) != 0) {
+      continue;
+    }
+    int idx = (tick >> shift) & (kSlotsPerLevel - 1);
+    if ((levels_[level].occupied & (1ULL << idx)) == 0) {
+      continue;
+    }
+    EntryList cascading;
+    TakeSlot(level, idx, &cascading);
+    while (!cascading.empty()) {
+      TimerWheelEntry* entry = &cascading.front();
+      cascading.pop_front();
+      Insert(entry);
+    }
+  }
+
+  int idx = tick & (kSlotsPerLevel - 1);
+  EntryList firing;
+  TakeSlot(0, idx, &firing);
+  // Entries scheduled by the callbacks go in the following slots.
+  cur_tick_ = tick + 1;
+  // An entry destroyed or rescheduled by the callback of another unlinks
+  // itself from 'firing'.
+  while (!firing.empty()) {
+    TimerWheelEntry* entry = &firing.front();
+    firing.pop_front();
+    entry->cb_(entry->obj_);
+  }
+}
+
+void TimerWheel::Advance(MonoTime now) {
+  int64_t nanos = (now - start_).ToNanoseconds();
+  if (nanos < 0) {
+    return;
+  }
+  const uint64_t now_tick = nanos / tick_.ToNanoseconds();
+  while (cur_tick_ <= now_tick) {
+    uint64_t tick = NextEventTick();
+    if (tick > now_tick) {
+      cur_tick_ = now_tick + 1;
+      break;
+    }
+    cur_tick_ = tick;
+    ProcessTick(tick);
+  }
+}
+
+MonoTime TimerWheel::NextWakeup() {
+  uint64_t tick = NextEventTick();
+  if (tick == UINT64_MAX) {
+    return MonoTime();
+  }
+  return start_ + MonoDelta::FromNanoseconds(tick * tick_.ToNanoseconds());
+}
+
+} // namespace rpc
+} // namespace kudu
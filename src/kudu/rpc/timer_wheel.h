@@ -0,0 +1,153 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/list_hook.hpp>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace rpc {
+
+class TimerWheel;
+
+// A deadline scheduled on a TimerWheel, embedded in the object the deadline
+// belongs to. Destroying the entry cancels it.
+//
+// Example:
+//    TimerWheelEntry entry;
+//    entry.set<Foo, &Foo::HandleTimeout>(foo);
+//    wheel->Schedule(&entry, deadline);
+class TimerWheelEntry : public boost::intrusive::list_base_hook<
+    boost::intrusive::link_mode<boost::intrusive::auto_unlink>> {
+ public:
+  TimerWheelEntry() : cb_(nullptr), obj_(nullptr), expiry_tick_(0) {}
+
+  // Sets the method of 'obj' to call when the deadline passes.
+  template<class T, void (T::*method)()>
+  void set(T* obj) {
+    obj_ = obj;
+    cb_ = [](void* o) { (static_cast<T*>(o)->*method)(); };
+  }
+
+  // Returns whether the entry is scheduled on a wheel.
+  bool is_scheduled() const { return is_linked(); }
+
+  // Cancels the entry if it's scheduled.
+  void cancel() { unlink(); }
+
+  // The deadline the entry was last scheduled for.
+  MonoTime deadline() const { return deadline_; }
+
+ private:
+  friend class TimerWheel;
+
+  void (*cb_)(void*);
+  void* obj_;
+  MonoTime deadline_;
+  uint64_t expiry_tick_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheelEntry);
+};
+
+// A hierarchical timing wheel, which schedules and cancels deadlines in
+// constant time, unlike a heap of timers. It's meant for the many deadlines
+// of a reactor which are almost always cancelled before they pass, such as
+// the timeouts of RPC calls.
+//
+// Time is cut into ticks of 'tick' each. The wheel has kNumLevels levels of
+// kSlotsPerLevel slots: a slot of level 0 spans one tick, and a slot of level
+// L spans all the slots of level L-1. A deadline is put in the slot of the
+// lowest level which reaches out to it, and moved down a level each time
+// the wheel turns to its slot, until it fires from level 0. Deadlines are
+// rounded up to a tick, so they never fire early.
+//
+// The wheel doesn't keep time on its own: its owner calls Advance() by the
+// time NextWakeup() returns, e.g. from a single timer of its event loop.
+//
+// This class is not thread-safe.
+class TimerWheel {
+ public:
+  explicit TimerWheel(MonoTime start,
+                      MonoDelta tick = MonoDelta::FromMilliseconds(1));
+  ~TimerWheel();
+
+  // Schedules 'entry' to fire at 'deadline', moving it if it was already
+  // scheduled. A deadline which is already past fires with the next call to
+  // Advance().
+  void Schedule(TimerWheelEntry* entry, MonoTime deadline);
+
+  // Fires the entries whose deadline is at or before 'now', in the order of
+  // their deadlines (rounded to ticks). The callbacks may schedule and cancel
+  // any entries, including the ones being fired.
+  void Advance(MonoTime now);
+
+  // Returns the time by which Advance() should be called next, or an
+  // uninitialized MonoTime if no entry is scheduled. The time may be earlier
+  // than the first deadline, e.g. when an entry needs to be moved to a lower
+  // level, or when the soonest entry was cancelled.
+  MonoTime NextWakeup();
+
+ private:
+  static const int kLevelBits = 6;
+  static const int kSlotsPerLevel = 1 << kLevelBits;
+  static const int kNumLevels = 6;
+
+  typedef boost::intrusive::list<
+      TimerWheelEntry, boost::intrusive::constant_time_size<false>> EntryList;
+
+  struct Level {
+    std::array<EntryList, kSlotsPerLevel> slots;
+
+    // The slots which may have entries. An entry which is cancelled leaves
+    // its bit set until the wheel turns to its slot.
+    uint64_t occupied = 0;
+  };
+
+  // Puts 'entry' in the slot covering its expiry tick.
+  void Insert(TimerWheelEntry* entry);
+
+  // Moves the entries of the slot of level 'level' with index 'idx' to
+  // 'out', and clears the slot's occupied bit.
+  void TakeSlot(int level, int idx, EntryList* out);
+
+  // Returns the first tick at or after 'cur_tick_' at which the wheel turns to
+  // a slot which may have entries, or UINT64_MAX if none may.
+  uint64_t NextEventTick();
+
+  // Processes tick 'tick': moves down the entries of the slots of the higher
+  // levels which the wheel turns to, and fires those of the level 0 slot.
+  void ProcessTick(uint64_t tick);
+
+  const MonoTime start_;
+  const MonoDelta tick_;
+
+  // The next tick to process: all the earlier ones were.
+  uint64_t cur_tick_;
+
+  std::array<Level, kNumLevels> levels_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+} // namespace rpc
+} // namespace kudu
@@ -20,6 +20,7 @@
 #include <sys/uio.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <cstdint>
 #include <iostream>
 #include <limits>
@@ -174,7 +175,9 @@ OutboundTransfer::OutboundTransfer(int32_t call_id,
     callbacks_(callbacks),
     call_id_(call_id),
     started_(false),
-    aborted_(false) {
+    aborted_(false),
+    num_zero_copy_sends_(0),
+    zero_copy_completion_pending_(false) {
 
   n_payload_slices_ = n_payload_slices;
   CHECK_LE(n_payload_slices_, payload_slices_.size());
@@ -184,7 +187,11 @@ OutboundTransfer::OutboundTransfer(int32_t call_id,
 }
 
 OutboundTransfer::~OutboundTransfer() {
-  if (!TransferFinished() && !aborted_) {
+  if (zero_copy_completion_pending_) {
+    // The connection is going away without waiting for the kernel; all of
+    // the data was handed to it, so consider the transfer finished.
+    ZeroCopySendsCompleted();
+  } else if (!TransferFinished() && !aborted_) {
     callbacks_->NotifyTransferAborted(
       Status::RuntimeError("RPC transfer destroyed before it finished sending"));
   }
@@ -197,7 +204,13 @@ void OutboundTransfer::Abort(const Status &status) {
   aborted_ = true;
 }
 
-Status OutboundTransfer::SendBuffer(Socket &socket) {
+void OutboundTransfer::ZeroCopySendsCompleted() {
+  DCHECK(zero_copy_completion_pending_);
+  zero_copy_completion_pending_ = false;
+  callbacks_->NotifyTransferFinished();
+}
+
+Status OutboundTransfer::SendBuffer(Socket &socket, bool zero_copy) {
   CHECK_LT(cur_slice_idx_, n_payload_slices_);
 
   started_ = true;
@@ -215,8 +228,17 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
   }
 
   int64_t written;
-  Status status = socket.Writev(iovec, n_iovecs, &written);
+  Status status = zero_copy ? socket.WritevZeroCopy(iovec, n_iovecs, &written)
+                            : socket.Writev(iovec, n_iovecs, &written);
+  if (zero_copy && status.posix_code() == ENOBUFS) {
+    // The socket has too many zero-copy sends outstanding; copy this data.
+    zero_copy = false;
+    status = socket.Writev(iovec, n_iovecs, &written);
+  }
   RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
+  if (zero_copy) {
+    num_zero_copy_sends_++;
+  }
 
   // Adjust our accounting of current writer position.
   for (int i = cur_slice_idx_; i < n_payload_slices_; i++) {
@@ -237,7 +259,11 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
   }
 
   if (cur_slice_idx_ == n_payload_slices_) {
-    callbacks_->NotifyTransferFinished();
+    if (num_zero_copy_sends_ > 0) {
+      zero_copy_completion_pending_ = true;
+    } else {
+      callbacks_->NotifyTransferFinished();
+    }
     DCHECK_EQ(0, cur_offset_in_slice_);
   } else {
     DCHECK_LT(cur_slice_idx_, n_payload_slices_);
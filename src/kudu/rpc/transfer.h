@@ -139,7 +139,25 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
   void Abort(const Status &status);
 
   // send from our buffers into the sock
-  Status SendBuffer(Socket &socket);
+  //
+  // If 'zero_copy' is true, the socket must have zero-copy sends enabled and
+  // the buffers are sent with Socket::WritevZeroCopy(). A transfer which made
+  // any zero-copy sends doesn't notify its callbacks when it finishes
+  // sending, since the kernel may still be reading from its buffers; the
+  // owner must call ZeroCopySendsCompleted() once it has been told that they
+  // are done.
+  Status SendBuffer(Socket &socket, bool zero_copy = false);
+
+  // Notify the callbacks that a transfer which finished sending with
+  // zero-copy sends is complete, now that the kernel has released its
+  // buffers.
+  void ZeroCopySendsCompleted();
+
+  // Return the number of zero-copy sends made by SendBuffer() which wrote
+  // any bytes. Each of them is assigned a zero-copy notification ID.
+  int32_t num_zero_copy_sends() const {
+    return num_zero_copy_sends_;
+  }
 
   // Return true if any bytes have yet been sent.
   bool TransferStarted() const;
@@ -192,6 +210,13 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
 
   bool aborted_;
 
+  // See num_zero_copy_sends().
+  int32_t num_zero_copy_sends_;
+
+  // True if the transfer finished sending but its callbacks haven't been
+  // notified yet because zero-copy sends are outstanding.
+  bool zero_copy_completion_pending_;
+
   DISALLOW_COPY_AND_ASSIGN(OutboundTransfer);
 };
 
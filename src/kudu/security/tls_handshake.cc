@@ -20,6 +20,8 @@
 #include <memory>
 #include <string>
 
+#include <gflags/gflags.h>
+#include <glog/logging.h>
 #include <openssl/ssl.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
@@ -28,6 +30,8 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/security/cert.h"
 #include "kudu/security/tls_socket.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/status.h"
 #include "kudu/util/trace.h"
@@ -36,6 +40,14 @@
 #include "kudu/security/x509_check_host.h"
 #endif // OPENSSL_VERSION_NUMBER
 
+DEFINE_bool(rpc_tls_kernel_offload, false,
+            "Whether to have the kernel encrypt data sent on TLS-encrypted RPC "
+            "connections (kTLS), rather than OpenSSL. Requires Linux 4.13 or "
+            "newer with the 'tls' module loaded, OpenSSL 1.1.0 or newer, and "
+            "connections negotiating TLSv1.2 with an AES-GCM cipher; other "
+            "connections are encrypted by OpenSSL as usual.");
+TAG_FLAG(rpc_tls_kernel_offload, experimental);
+
 using std::string;
 using std::unique_ptr;
 using strings::Substitute;
@@ -211,7 +223,15 @@ Status TlsHandshake::Finish(unique_ptr<Socket>* socket) {
   }
 
   // Transfer the SSL instance to the socket.
-  socket->reset(new TlsSocket(fd, std::move(ssl_)));
+  unique_ptr<TlsSocket> tls_socket(new TlsSocket(fd, std::move(ssl_)));
+  if (FLAGS_rpc_tls_kernel_offload) {
+    Status s = tls_socket->EnableKernelTlsTx();
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(INFO, 60) << "Not using kernel TLS offload: " << s.ToString()
+                                  << THROTTLE_MSG;
+    }
+  }
+  socket->reset(tls_socket.release());
 
   return Status::OK();
 }
@@ -33,11 +33,13 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/security/tls_context.h"
+#include "kudu/security/tls_socket.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
@@ -50,6 +52,8 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(rpc_tls_kernel_offload);
+
 using std::string;
 using std::thread;
 using std::unique_ptr;
@@ -282,6 +286,37 @@ TEST_F(TlsSocketTest, TestTlsSocketInterrupted) {
   LOG(INFO) << "client done";
 }
 
+// Test that data sent with kernel TLS offload enabled on both ends arrives
+// intact. Where the kernel or the negotiated cipher doesn't support it, the
+// sockets fall back to encrypting with OpenSSL.
+TEST_F(TlsSocketTest, TestKernelTlsOffload) {
+  FLAGS_rpc_tls_kernel_offload = true;
+
+  EchoServer server;
+  NO_FATALS(server.Start());
+
+  unique_ptr<Socket> client_sock;
+  NO_FATALS(ConnectClient(server.listen_addr(), &client_sock));
+  LOG(INFO) << "client kernel TLS offload: "
+            << static_cast<TlsSocket*>(client_sock.get())->kernel_tls_tx();
+
+  Random rng(GetRandomSeed32());
+  unique_ptr<uint8_t[]> buf(new uint8_t[kEchoChunkSize]);
+  unique_ptr<uint8_t[]> rbuf(new uint8_t[kEchoChunkSize]);
+  for (int i = 0; i < 3; i++) {
+    RandomString(buf.get(), kEchoChunkSize, &rng);
+    size_t nwritten;
+    ASSERT_OK(client_sock->BlockingWrite(buf.get(), kEchoChunkSize, &nwritten,
+        MonoTime::Now() + kTimeout));
+    size_t n;
+    ASSERT_OK(client_sock->BlockingRecv(rbuf.get(), kEchoChunkSize, &n,
+        MonoTime::Now() + kTimeout));
+    ASSERT_EQ(0, memcmp(buf.get(), rbuf.get(), kEchoChunkSize));
+  }
+  server.Stop();
+  ASSERT_OK(client_sock->Close());
+}
+
 // Return an iovec containing the same data as the buffer 'buf' with the length 'len',
 // but split into random-sized chunks. The chunks are sized randomly between 1 and
 // 'max_chunk_size' bytes.
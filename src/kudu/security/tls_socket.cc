@@ -17,25 +17,136 @@
 
 #include "kudu/security/tls_socket.h"
 
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <sys/uio.h>
 
 #include <cerrno>
+#include <cstring>
 #include <string>
 #include <utility>
 
 #include <glog/logging.h>
+#include <openssl/crypto.h>
 #include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+#include <openssl/kdf.h>
+#endif
 
 #include "kudu/gutil/basictypes.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/security/openssl_util.h"
 #include "kudu/util/errno.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
+#include "kudu/util/scoped_cleanup.h"
+
+#if defined(__linux__) && OPENSSL_VERSION_NUMBER >= 0x10100000L
+#define KUDU_KERNEL_TLS_SUPPORTED 1
+#endif
 
 namespace kudu {
 namespace security {
 
+#if defined(KUDU_KERNEL_TLS_SUPPORTED)
+
+template<> struct SslTypeTraits<EVP_PKEY_CTX> {
+  static constexpr auto kFreeFunc = &EVP_PKEY_CTX_free;
+};
+
+namespace {
+
+// Definitions from <linux/tls.h> and <netinet/tcp.h>, which older system
+// headers lack.
+constexpr int kSolTls = 282;
+constexpr int kTcpUlp = 31;
+constexpr int kTlsTx = 1;
+constexpr int kTlsSetRecordType = 1;
+constexpr uint16_t kTls12Version = 0x0303;
+constexpr uint16_t kTlsCipherAesGcm128 = 51;
+constexpr uint16_t kTlsCipherAesGcm256 = 52;
+constexpr uint8_t kTlsRecordTypeAlert = 21;
+
+// The size of the implicit part of the AES-GCM nonce, the "salt".
+constexpr size_t kAesGcmSaltLen = 4;
+
+// The layout of the kernel's struct tls12_crypto_info_aes_gcm_128 and
+// struct tls12_crypto_info_aes_gcm_256.
+template<size_t kKeyLen>
+struct Tls12CryptoInfoAesGcm {
+  uint16_t version;
+  uint16_t cipher_type;
+  uint8_t iv[8];
+  uint8_t key[kKeyLen];
+  uint8_t salt[kAesGcmSaltLen];
+  uint8_t rec_seq[8];
+};
+
+// Derives 'len' bytes of the TLSv1.2 key block of 'ssl' into 'key_block'.
+// See RFC 5246, section 6.3.
+Status DeriveTls12KeyBlock(SSL* ssl, const EVP_MD* prf_md, uint8_t* key_block, size_t len) {
+  uint8_t master_key[SSL_MAX_MASTER_KEY_LENGTH];
+  size_t master_key_len = SSL_SESSION_get_master_key(SSL_get_session(ssl),
+                                                     master_key, sizeof(master_key));
+  SCOPED_CLEANUP({ OPENSSL_cleanse(master_key, sizeof(master_key)); });
+  uint8_t client_random[SSL3_RANDOM_SIZE];
+  uint8_t server_random[SSL3_RANDOM_SIZE];
+  SSL_get_client_random(ssl, client_random, sizeof(client_random));
+  SSL_get_server_random(ssl, server_random, sizeof(server_random));
+
+  static const char kLabel[] = "key expansion";
+  auto pctx = ssl_make_unique(EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr));
+  OPENSSL_RET_IF_NULL(pctx, "failed to create TLS PRF context");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_derive_init(pctx.get()),
+                     "failed to initialize TLS PRF context");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_set_tls1_prf_md(pctx.get(), prf_md),
+                     "failed to set TLS PRF digest");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_set1_tls1_prf_secret(pctx.get(), master_key, master_key_len),
+                     "failed to set TLS PRF secret");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_add1_tls1_prf_seed(
+                         pctx.get(), reinterpret_cast<const uint8_t*>(kLabel), strlen(kLabel)),
+                     "failed to set TLS PRF seed");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_add1_tls1_prf_seed(pctx.get(), server_random,
+                                                     sizeof(server_random)),
+                     "failed to set TLS PRF seed");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_add1_tls1_prf_seed(pctx.get(), client_random,
+                                                     sizeof(client_random)),
+                     "failed to set TLS PRF seed");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_derive(pctx.get(), key_block, &len),
+                     "failed to derive TLS key block");
+  return Status::OK();
+}
+
+// Configures the kernel to encrypt data sent on 'fd' with AES-GCM 'key' and
+// 'salt', starting from the first record after the handshake.
+template<size_t kKeyLen>
+Status SetKernelTlsTx(int fd, uint16_t cipher_type, const uint8_t* key, const uint8_t* salt) {
+  Tls12CryptoInfoAesGcm<kKeyLen> info;
+  memset(&info, 0, sizeof(info));
+  SCOPED_CLEANUP({ OPENSSL_cleanse(&info, sizeof(info)); });
+  info.version = kTls12Version;
+  info.cipher_type = cipher_type;
+  memcpy(info.key, key, kKeyLen);
+  memcpy(info.salt, salt, kAesGcmSaltLen);
+  // Record 0 under the negotiated keys is the handshake's Finished message,
+  // so the first record to send is record 1. Like OpenSSL, use the record
+  // sequence number as the explicit part of the nonce.
+  info.rec_seq[7] = 1;
+  memcpy(info.iv, info.rec_seq, sizeof(info.iv));
+  if (::setsockopt(fd, kSolTls, kTlsTx, &info, sizeof(info)) == -1) {
+    int err = errno;
+    return Status::NetworkError("failed to set kernel TLS keys", ErrnoToString(err), err);
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+#endif // defined(KUDU_KERNEL_TLS_SUPPORTED)
+
 TlsSocket::TlsSocket(int fd, c_unique_ptr<SSL> ssl)
     : Socket(fd),
       ssl_(std::move(ssl)) {
@@ -57,6 +168,10 @@ Status TlsSocket::Write(const uint8_t *buf, int32_t amt, int32_t *nwritten) {
     return Status::OK();
   }
 
+  if (kernel_tls_tx_) {
+    return Socket::Write(buf, amt, nwritten);
+  }
+
   errno = 0;
   int32_t bytes_written = SSL_write(ssl_.get(), buf, amt);
   int save_errno = errno;
@@ -77,10 +192,18 @@ Status TlsSocket::Write(const uint8_t *buf, int32_t amt, int32_t *nwritten) {
   return Status::OK();
 }
 
+Status TlsSocket::EnableZeroCopy() {
+  return Status::NotSupported("zero-copy sends are not supported on TLS sockets");
+}
+
 Status TlsSocket::Writev(const struct ::iovec *iov, int iov_len, int64_t *nwritten) {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(ssl_);
   *nwritten = 0;
+  if (kernel_tls_tx_) {
+    // The kernel splits the data into records itself.
+    return Socket::Writev(iov, iov_len, nwritten);
+  }
   // Allows packets to be aggresively be accumulated before sending.
   RETURN_NOT_OK(SetTcpCork(1));
   Status write_status = Status::OK();
@@ -165,13 +288,18 @@ Status TlsSocket::Close() {
 
   // Start the TLS shutdown processes. We don't care about waiting for the
   // response, since the underlying socket will not be reused.
-  int32_t ret = SSL_shutdown(ssl_.get());
   Status ssl_shutdown;
-  if (ret >= 0) {
-    ssl_shutdown = Status::OK();
+  if (kernel_tls_tx_) {
+    // OpenSSL no longer knows the state of the sending side of the connection.
+    ssl_shutdown = SendKernelTlsCloseNotify();
   } else {
-    auto error_code = SSL_get_error(ssl_.get(), ret);
-    ssl_shutdown = Status::NetworkError("TlsSocket::Close", GetSSLErrorDescription(error_code));
+    int32_t ret = SSL_shutdown(ssl_.get());
+    if (ret >= 0) {
+      ssl_shutdown = Status::OK();
+    } else {
+      auto error_code = SSL_get_error(ssl_.get(), ret);
+      ssl_shutdown = Status::NetworkError("TlsSocket::Close", GetSSLErrorDescription(error_code));
+    }
   }
 
   ssl_.reset();
@@ -181,5 +309,99 @@ Status TlsSocket::Close() {
   return ssl_shutdown;
 }
 
+Status TlsSocket::EnableKernelTlsTx() {
+#if defined(KUDU_KERNEL_TLS_SUPPORTED)
+  SCOPED_OPENSSL_NO_PENDING_ERRORS;
+  CHECK(ssl_);
+  DCHECK(!kernel_tls_tx_);
+  SSL* ssl = ssl_.get();
+
+  if (SSL_version(ssl) != TLS1_2_VERSION) {
+    return Status::NotSupported("kernel TLS offload requires TLSv1.2", SSL_get_version(ssl));
+  }
+  if (BIO_number_written(SSL_get_wbio(ssl)) != 0) {
+    return Status::IllegalState("data has already been sent on the TLS socket");
+  }
+
+  const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl);
+  size_t key_len;
+  uint16_t cipher_type;
+  const EVP_MD* prf_md;
+  switch (SSL_CIPHER_get_cipher_nid(cipher)) {
+    case NID_aes_128_gcm:
+      key_len = 16;
+      cipher_type = kTlsCipherAesGcm128;
+      prf_md = EVP_sha256();
+      break;
+    case NID_aes_256_gcm:
+      key_len = 32;
+      cipher_type = kTlsCipherAesGcm256;
+      prf_md = EVP_sha384();
+      break;
+    default:
+      return Status::NotSupported("kernel TLS offload requires an AES-GCM cipher",
+                                  SSL_CIPHER_get_name(cipher));
+  }
+
+  // With AEAD ciphers the key block holds no MAC keys, just the client and
+  // server write keys followed by the client and server salts.
+  uint8_t key_block[2 * 32 + 2 * kAesGcmSaltLen];
+  SCOPED_CLEANUP({ OPENSSL_cleanse(key_block, sizeof(key_block)); });
+  RETURN_NOT_OK(DeriveTls12KeyBlock(ssl, prf_md, key_block, 2 * key_len + 2 * kAesGcmSaltLen));
+  bool is_server = SSL_is_server(ssl);
+  const uint8_t* key = key_block + (is_server ? key_len : 0);
+  const uint8_t* salt = key_block + 2 * key_len + (is_server ? kAesGcmSaltLen : 0);
+
+  static const char kTlsUlp[] = "tls";
+  if (::setsockopt(GetFd(), IPPROTO_TCP, kTcpUlp, kTlsUlp, sizeof(kTlsUlp)) == -1) {
+    int err = errno;
+    return Status::NotSupported("kernel TLS is not available", ErrnoToString(err), err);
+  }
+  RETURN_NOT_OK(key_len == 16 ? SetKernelTlsTx<16>(GetFd(), cipher_type, key, salt)
+                              : SetKernelTlsTx<32>(GetFd(), cipher_type, key, salt));
+
+  // OpenSSL must not send any records of its own from now on. Kudu never
+  // renegotiates, so this only matters for a misbehaving peer.
+#ifdef SSL_OP_NO_RENEGOTIATION
+  SSL_set_options(ssl, SSL_OP_NO_RENEGOTIATION);
+#endif
+  kernel_tls_tx_ = true;
+  return Status::OK();
+#else
+  return Status::NotSupported("kernel TLS offload requires Linux and OpenSSL 1.1.0 or newer");
+#endif // defined(KUDU_KERNEL_TLS_SUPPORTED)
+}
+
+Status TlsSocket::SendKernelTlsCloseNotify() {
+#if defined(KUDU_KERNEL_TLS_SUPPORTED)
+  // A warning-level close_notify alert.
+  uint8_t alert[] = { 1, 0 };
+  struct iovec iov = { alert, sizeof(alert) };
+  char control[CMSG_SPACE(sizeof(kTlsRecordTypeAlert))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = kSolTls;
+  cmsg->cmsg_type = kTlsSetRecordType;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(kTlsRecordTypeAlert));
+  *CMSG_DATA(cmsg) = kTlsRecordTypeAlert;
+
+  ssize_t res;
+  RETRY_ON_EINTR(res, ::sendmsg(GetFd(), &msg, MSG_NOSIGNAL | MSG_DONTWAIT));
+  if (res < 0) {
+    int err = errno;
+    return Status::NetworkError("TlsSocket::Close", ErrnoToString(err), err);
+  }
+  return Status::OK();
+#else
+  LOG(FATAL) << "kernel TLS offload is not supported";
+  return Status::OK();
+#endif // defined(KUDU_KERNEL_TLS_SUPPORTED)
+}
+
 } // namespace security
 } // namespace kudu
@@ -42,18 +42,44 @@ class TlsSocket : public Socket {
                 int iov_len,
                 int64_t *nwritten) override WARN_UNUSED_RESULT;
 
+  // Zero-copy sends aren't possible, since the data is encrypted into
+  // OpenSSL's own buffers before it is written to the socket.
+  Status EnableZeroCopy() override WARN_UNUSED_RESULT;
+
   Status Recv(uint8_t *buf, int32_t amt, int32_t *nread) override WARN_UNUSED_RESULT;
 
   Status Close() override WARN_UNUSED_RESULT;
 
+  // Hands encryption of the data sent on this socket over to the kernel
+  // (kTLS): Write() and Writev() then pass plaintext straight to the socket
+  // instead of encrypting it into OpenSSL's buffers first. Received data is
+  // still decrypted by OpenSSL.
+  //
+  // Only TLSv1.2 connections with an AES-GCM cipher are supported, and no
+  // data may have been sent on the socket since the handshake. Requires a
+  // Linux kernel with the 'tls' module (4.13 and newer).
+  Status EnableKernelTlsTx() WARN_UNUSED_RESULT;
+
+  // Whether encryption of sent data is offloaded to the kernel.
+  bool kernel_tls_tx() const {
+    return kernel_tls_tx_;
+  }
+
  private:
 
   friend class TlsHandshake;
 
   TlsSocket(int fd, c_unique_ptr<SSL> ssl);
 
+  // Sends a TLS close_notify alert through the kernel. Used instead of
+  // SSL_shutdown() once the kernel encrypts sent data.
+  Status SendKernelTlsCloseNotify();
+
   // Owned SSL handle.
   c_unique_ptr<SSL> ssl_;
+
+  // See kernel_tls_tx().
+  bool kernel_tls_tx_ = false;
 };
 
 } // namespace security
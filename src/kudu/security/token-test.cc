@@ -720,6 +720,36 @@ TEST_F(TokenTest, TestEndToEnd_InvalidCases) {
   }
 }
 
+// Test that a token whose signature was verified before is still checked for
+// expiration, and that a token with a different signature isn't mistaken for
+// it.
+TEST_F(TokenTest, TestVerifiedTokenCache) {
+  TokenSigner signer(kTokenValiditySeconds, kTokenValiditySeconds, 10);
+  {
+    std::unique_ptr<TokenSigningPrivateKey> key;
+    ASSERT_OK(signer.CheckNeedKey(&key));
+    ASSERT_NE(nullptr, key.get());
+    ASSERT_OK(signer.AddKey(std::move(key)));
+  }
+  TokenVerifier verifier;
+  ASSERT_OK(verifier.ImportKeys(signer.verifier().ExportKeys()));
+
+  SignedTokenPB signed_token = MakeUnsignedToken(WallTime_Now() + 1);
+  ASSERT_OK(signer.SignToken(&signed_token));
+  TokenPB token;
+  ASSERT_EQ(VerificationResult::VALID, verifier.VerifyTokenSignature(signed_token, &token));
+  ASSERT_EQ(VerificationResult::VALID, verifier.VerifyTokenSignature(signed_token, &token));
+
+  SignedTokenPB corrupt_token = signed_token;
+  corrupt_token.set_signature("xyz");
+  ASSERT_EQ(VerificationResult::INVALID_SIGNATURE,
+            verifier.VerifyTokenSignature(corrupt_token, &token));
+
+  SleepFor(MonoDelta::FromSeconds(2));
+  ASSERT_EQ(VerificationResult::EXPIRED_TOKEN,
+            verifier.VerifyTokenSignature(signed_token, &token));
+}
+
 // Test functionality of the TokenVerifier::ImportKeys() method.
 TEST_F(TokenTest, TestTokenVerifierImportKeys) {
   TokenVerifier verifier;
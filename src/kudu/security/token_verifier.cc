@@ -18,6 +18,7 @@
 #include "kudu/security/token_verifier.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <mutex>
 #include <ostream>
@@ -25,16 +26,25 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/security/token_signing_key.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/status.h"
 
+DEFINE_int32(token_verifier_cache_capacity, 10000,
+             "The maximum number of tokens whose verified signatures a server "
+             "remembers, sparing clients which present the same token again "
+             "another signature verification. If 0, every token is verified.");
+TAG_FLAG(token_verifier_cache_capacity, advanced);
+TAG_FLAG(token_verifier_cache_capacity, experimental);
+
 using std::lock_guard;
 using std::string;
 using std::transform;
@@ -129,6 +139,17 @@ VerificationResult TokenVerifier::VerifyTokenSignature(const SignedTokenPB& sign
     }
   }
 
+  string cache_key;
+  const int capacity = FLAGS_token_verifier_cache_capacity;
+  if (capacity > 0) {
+    cache_key = std::to_string(signed_token.signing_key_seq_num());
+    cache_key.push_back(':');
+    cache_key.append(std::to_string(signed_token.signature().size()));
+    cache_key.push_back(':');
+    cache_key.append(signed_token.signature());
+    cache_key.append(signed_token.token_data());
+  }
+
   {
     shared_lock<RWMutex> l(lock_);
     auto* tsk = FindPointeeOrNull(keys_by_seq_, signed_token.signing_key_seq_num());
@@ -138,11 +159,25 @@ VerificationResult TokenVerifier::VerifyTokenSignature(const SignedTokenPB& sign
     if (tsk->pb().expire_unix_epoch_seconds() < now) {
       return VerificationResult::EXPIRED_SIGNING_KEY;
     }
+    if (capacity > 0) {
+      lock_guard<simple_spinlock> verified_l(verified_lock_);
+      if (ContainsKey(verified_tokens_, cache_key)) {
+        return VerificationResult::VALID;
+      }
+    }
     if (!tsk->VerifySignature(signed_token)) {
       return VerificationResult::INVALID_SIGNATURE;
     }
   }
 
+  if (capacity > 0) {
+    lock_guard<simple_spinlock> l(verified_lock_);
+    if (verified_tokens_.size() >= static_cast<size_t>(capacity)) {
+      verified_tokens_.clear();
+    }
+    verified_tokens_.emplace(std::move(cache_key));
+  }
+
   return VerificationResult::VALID;
 }
 
@@ -19,10 +19,13 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/rw_mutex.h"
 
 namespace kudu {
@@ -85,6 +88,11 @@ class TokenVerifier {
 
   // Verify the signature on the given signed token, and deserialize the
   // contents into 'token'.
+  //
+  // The signatures found valid are remembered, up to
+  // --token_verifier_cache_capacity of them, so that a client presenting the
+  // same token again doesn't cost another RSA verification. The expiration
+  // of the token and of its signing key are checked every time.
   VerificationResult VerifyTokenSignature(const SignedTokenPB& signed_token,
                                           TokenPB* token) const;
 
@@ -95,6 +103,12 @@ class TokenVerifier {
   mutable RWMutex lock_;
   KeysMap keys_by_seq_;
 
+  // The signed tokens whose signatures were verified, keyed by their signing
+  // key sequence number, signature and data. Since a key is never replaced
+  // once imported, the entries stay valid as long as the verifier lives.
+  mutable simple_spinlock verified_lock_;
+  mutable std::unordered_set<std::string> verified_tokens_;
+
   DISALLOW_COPY_AND_ASSIGN(TokenVerifier);
 };
 
@@ -23,6 +23,7 @@
 #include <string>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 
 #include "kudu/rpc/sasl_common.h"
@@ -51,6 +52,8 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+DECLARE_int32(sentry_privilege_cache_ttl_ms);
+
 namespace kudu {
 namespace sentry {
 
@@ -299,5 +302,66 @@ TEST_P(SentryClientTest, TestGrantPrivilege) {
   ASSERT_OK(sentry_client_->AlterRoleGrantPrivilege(privilege_request, &privilege_response));
 }
 
+// Test that privilege listings are answered from the cache until a change
+// made through the same client invalidates them.
+TEST_P(SentryClientTest, TestPrivilegeCache) {
+  FLAGS_sentry_privilege_cache_ttl_ms = 60 * 1000;
+
+  TCreateSentryRoleRequest role_request;
+  role_request.requestorUserName = "test-admin";
+  role_request.roleName = "viewer";
+  ASSERT_OK(sentry_client_->CreateRole(role_request));
+
+  TSentryGroup group;
+  group.groupName = "user";
+  TAlterSentryRoleAddGroupsRequest group_request;
+  TAlterSentryRoleAddGroupsResponse group_response;
+  group_request.requestorUserName = "test-admin";
+  group_request.roleName = "viewer";
+  group_request.groups.insert(group);
+  ASSERT_OK(sentry_client_->AlterRoleAddGroups(group_request, &group_response));
+
+  TSentryAuthorizable authorizable;
+  authorizable.server = "server";
+  authorizable.__set_db("db");
+  authorizable.__set_table("table");
+  TListSentryPrivilegesRequest list_request;
+  list_request.requestorUserName = "test-admin";
+  list_request.authorizableHierarchy = authorizable;
+  list_request.__set_principalName("test-user");
+  TListSentryPrivilegesResponse list_response;
+  ASSERT_OK(sentry_client_->ListPrivilegesByUser(list_request, &list_response));
+  ASSERT_TRUE(list_response.privileges.empty());
+
+  TAlterSentryRoleGrantPrivilegeRequest privilege_request;
+  TAlterSentryRoleGrantPrivilegeResponse privilege_response;
+  privilege_request.requestorUserName = "test-admin";
+  privilege_request.roleName = "viewer";
+  TSentryPrivilege privilege;
+  privilege.serverName = "server";
+  privilege.dbName = "db";
+  privilege.tableName = "table";
+  privilege.action = "SELECT";
+  privilege_request.__set_privilege(privilege);
+
+  // A grant through another client isn't seen until the cache expires.
+  thrift::ClientOptions opts;
+  opts.enable_kerberos = KerberosEnabled();
+  opts.service_principal = "sentry";
+  SentryClient other_client(sentry_->address(), opts);
+  ASSERT_OK(other_client.Start());
+  ASSERT_OK(other_client.AlterRoleGrantPrivilege(privilege_request, &privilege_response));
+  ASSERT_OK(other_client.Stop());
+  ASSERT_OK(sentry_client_->ListPrivilegesByUser(list_request, &list_response));
+  ASSERT_TRUE(list_response.privileges.empty());
+
+  // A change through this client invalidates the cache.
+  privilege.action = "INSERT";
+  privilege_request.__set_privilege(privilege);
+  ASSERT_OK(sentry_client_->AlterRoleGrantPrivilege(privilege_request, &privilege_response));
+  ASSERT_OK(sentry_client_->ListPrivilegesByUser(list_request, &list_response));
+  ASSERT_EQ(2, list_response.privileges.size());
+}
+
 } // namespace sentry
 } // namespace kudu
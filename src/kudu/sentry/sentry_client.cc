@@ -17,11 +17,15 @@
 
 #include "kudu/sentry/sentry_client.h"
 
+#include <cstddef>
 #include <exception>
+#include <iterator>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <thrift/Thrift.h>
 #include <thrift/protocol/TMultiplexedProtocol.h>
@@ -35,9 +39,24 @@
 #include "kudu/sentry/sentry_policy_service_types.h"
 #include "kudu/thrift/client.h"
 #include "kudu/thrift/sasl_client_transport.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 
+DEFINE_int32(sentry_privilege_cache_ttl_ms, 0,
+             "How long, in milliseconds, a Sentry client caches the privileges it "
+             "listed for a user. Caching spares repeated authorization checks a "
+             "round trip to Sentry, at the cost of taking up to this long to see "
+             "policy changes made through other clients. If 0, privileges are not "
+             "cached.");
+TAG_FLAG(sentry_privilege_cache_ttl_ms, advanced);
+TAG_FLAG(sentry_privilege_cache_ttl_ms, experimental);
+
+DEFINE_int32(sentry_privilege_cache_capacity, 1024,
+             "The maximum number of privilege listings a Sentry client caches.");
+TAG_FLAG(sentry_privilege_cache_capacity, advanced);
+TAG_FLAG(sentry_privilege_cache_capacity, experimental);
+
 using apache::thrift::TException;
 using apache::thrift::protocol::TMultiplexedProtocol;
 using apache::thrift::transport::TTransportException;
@@ -54,9 +73,11 @@ using sentry::TDropSentryRoleRequest;
 using sentry::TDropSentryRoleResponse;
 using sentry::TListSentryPrivilegesRequest;
 using sentry::TListSentryPrivilegesResponse;
+using sentry::TSentryAuthorizable;
 using sentry::TSentryResponseStatus;
 using sentry::g_sentry_common_service_constants;
 using std::make_shared;
+using std::string;
 using strings::Substitute;
 
 namespace kudu {
@@ -120,6 +141,22 @@ Status ConvertStatus(const TSentryResponseStatus& status) {
     return Status::RuntimeError((msg), e.what()); \
   }
 
+namespace {
+
+// Appends 'field' to 'key', prefixed by its length so that the fields of
+// different keys can't line up, or a marker if it isn't set.
+void AppendKeyField(bool is_set, const string& field, string* key) {
+  if (!is_set) {
+    key->append("-;");
+    return;
+  }
+  key->append(std::to_string(field.size()));
+  key->push_back(':');
+  key->append(field);
+}
+
+} // anonymous namespace
+
 SentryClient::SentryClient(const HostPort& address, const thrift::ClientOptions& options)
       : client_(SentryPolicyServiceClient(
             make_shared<TMultiplexedProtocol>(CreateClientProtocol(address, options),
@@ -150,6 +187,7 @@ bool SentryClient::IsConnected() {
 
 Status SentryClient::CreateRole(const TCreateSentryRoleRequest& request) {
   SCOPED_LOG_SLOW_EXECUTION(WARNING, kSlowExecutionWarningThresholdMs, "create Sentry role");
+  InvalidatePrivilegeCache();
   TCreateSentryRoleResponse response;
   SENTRY_RET_NOT_OK(client_.create_sentry_role(response, request),
                     response.status, "failed to create Sentry role");
@@ -158,6 +196,7 @@ Status SentryClient::CreateRole(const TCreateSentryRoleRequest& request) {
 
 Status SentryClient::DropRole(const TDropSentryRoleRequest& request) {
   SCOPED_LOG_SLOW_EXECUTION(WARNING, kSlowExecutionWarningThresholdMs, "drop Sentry role");
+  InvalidatePrivilegeCache();
   TDropSentryRoleResponse response;
   SENTRY_RET_NOT_OK(client_.drop_sentry_role(response, request),
                     response.status, "failed to drop Sentry role");
@@ -166,17 +205,68 @@ Status SentryClient::DropRole(const TDropSentryRoleRequest& request) {
 
 Status SentryClient::ListPrivilegesByUser(const TListSentryPrivilegesRequest& request,
                                           TListSentryPrivilegesResponse* response)  {
+  string key;
+  MonoTime now;
+  if (FLAGS_sentry_privilege_cache_ttl_ms > 0) {
+    key = PrivilegeCacheKey(request);
+    now = MonoTime::Now();
+    auto it = privilege_cache_.find(key);
+    if (it != privilege_cache_.end()) {
+      if (now < it->second.expiration) {
+        *response = it->second.response;
+        return Status::OK();
+      }
+      privilege_cache_.erase(it);
+    }
+  }
+
   SCOPED_LOG_SLOW_EXECUTION(WARNING, kSlowExecutionWarningThresholdMs,
                             "list Sentry privilege by user");
   SENTRY_RET_NOT_OK(client_.list_sentry_privileges_by_user_and_itsgroups(*response, request),
                     response->status, "failed to list Sentry privilege by user");
+
+  if (FLAGS_sentry_privilege_cache_ttl_ms > 0) {
+    if (privilege_cache_.size() >= static_cast<size_t>(FLAGS_sentry_privilege_cache_capacity)) {
+      // Make room by dropping the expired entries, or everything if none
+      // expired yet.
+      for (auto it = privilege_cache_.begin(); it != privilege_cache_.end();) {
+        it = now < it->second.expiration ? std::next(it) : privilege_cache_.erase(it);
+      }
+      if (privilege_cache_.size() >= static_cast<size_t>(FLAGS_sentry_privilege_cache_capacity)) {
+        privilege_cache_.clear();
+      }
+    }
+    privilege_cache_[std::move(key)] = {
+        *response, now + MonoDelta::FromMilliseconds(FLAGS_sentry_privilege_cache_ttl_ms) };
+  }
   return Status::OK();
 }
 
+void SentryClient::InvalidatePrivilegeCache() {
+  privilege_cache_.clear();
+}
+
+string SentryClient::PrivilegeCacheKey(const TListSentryPrivilegesRequest& request) {
+  string key;
+  AppendKeyField(true, std::to_string(request.protocol_version), &key);
+  AppendKeyField(true, request.requestorUserName, &key);
+  AppendKeyField(true, request.roleName, &key);
+  AppendKeyField(request.__isset.principalName, request.principalName, &key);
+  const TSentryAuthorizable& authorizable = request.authorizableHierarchy;
+  bool has_authorizable = request.__isset.authorizableHierarchy;
+  AppendKeyField(has_authorizable, authorizable.server, &key);
+  AppendKeyField(has_authorizable && authorizable.__isset.uri, authorizable.uri, &key);
+  AppendKeyField(has_authorizable && authorizable.__isset.db, authorizable.db, &key);
+  AppendKeyField(has_authorizable && authorizable.__isset.table, authorizable.table, &key);
+  AppendKeyField(has_authorizable && authorizable.__isset.column, authorizable.column, &key);
+  return key;
+}
+
 Status SentryClient::AlterRoleAddGroups(const TAlterSentryRoleAddGroupsRequest& request,
                                         TAlterSentryRoleAddGroupsResponse* response)  {
   SCOPED_LOG_SLOW_EXECUTION(WARNING, kSlowExecutionWarningThresholdMs,
                             "alter Sentry role add groups");
+  InvalidatePrivilegeCache();
   SENTRY_RET_NOT_OK(client_.alter_sentry_role_add_groups(*response, request),
                     response->status, "failed to alter Sentry role add groups");
   return Status::OK();
@@ -186,6 +276,7 @@ Status SentryClient::AlterRoleGrantPrivilege(const TAlterSentryRoleGrantPrivileg
                                              TAlterSentryRoleGrantPrivilegeResponse* response)  {
   SCOPED_LOG_SLOW_EXECUTION(WARNING, kSlowExecutionWarningThresholdMs,
                             "alter Sentry role grant privileges");
+  InvalidatePrivilegeCache();
   SENTRY_RET_NOT_OK(client_.alter_sentry_role_grant_privilege(*response, request),
                     response->status, "failed to alter Sentry role grant privileges");
   return Status::OK();
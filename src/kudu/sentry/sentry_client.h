@@ -18,9 +18,13 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <unordered_map>
 
 #include "kudu/gutil/port.h"
 #include "kudu/sentry/SentryPolicyService.h"
+#include "kudu/sentry/sentry_policy_service_types.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace sentry {
@@ -89,6 +93,11 @@ class SentryClient {
   Status DropRole(const ::sentry::TDropSentryRoleRequest& request) WARN_UNUSED_RESULT;
 
   // List Sentry privileges by user.
+  //
+  // If --sentry_privilege_cache_ttl_ms is positive, successful responses are
+  // cached for that long, and repeated requests are answered from the cache.
+  // The cache is invalidated by every change to the roles and privileges made
+  // through this client, and by InvalidatePrivilegeCache().
   Status ListPrivilegesByUser(const ::sentry::TListSentryPrivilegesRequest& request,
       ::sentry::TListSentryPrivilegesResponse* response) WARN_UNUSED_RESULT;
 
@@ -100,8 +109,23 @@ class SentryClient {
   Status AlterRoleGrantPrivilege(const ::sentry::TAlterSentryRoleGrantPrivilegeRequest& request,
      ::sentry::TAlterSentryRoleGrantPrivilegeResponse* response) WARN_UNUSED_RESULT;
 
+  // Drops the cached privileges, e.g. after being notified that the Sentry
+  // policies changed.
+  void InvalidatePrivilegeCache();
+
 private:
+  struct CachedPrivileges {
+    ::sentry::TListSentryPrivilegesResponse response;
+    MonoTime expiration;
+  };
+
+  // Returns the key of the privilege cache for 'request'.
+  static std::string PrivilegeCacheKey(const ::sentry::TListSentryPrivilegesRequest& request);
+
   ::sentry::SentryPolicyServiceClient client_;
+
+  // Cached responses of ListPrivilegesByUser(), by PrivilegeCacheKey().
+  std::unordered_map<std::string, CachedPrivileges> privilege_cache_;
 };
 
 } // namespace sentry
@@ -23,8 +23,11 @@
 #include <cstdint>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
@@ -42,6 +45,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/human_readable.h"
+#include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -54,6 +58,7 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/flags.h"
 #include "kudu/util/jsonwriter.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
@@ -72,6 +77,15 @@ DEFINE_int64(web_log_bytes, 1024 * 1024,
 TAG_FLAG(web_log_bytes, advanced);
 TAG_FLAG(web_log_bytes, runtime);
 
+DEFINE_int32(metrics_prometheus_merged_cache_ms, 5000,
+             "How long the Prometheus metrics endpoint caches its output when the "
+             "metrics of the tablets are merged by table, in milliseconds. Merging "
+             "the metrics of many tablets is the most expensive part of a scrape, and "
+             "this avoids redoing it for concurrent or frequent scrapers. If 0, the "
+             "output isn't cached.");
+TAG_FLAG(metrics_prometheus_merged_cache_ms, advanced);
+TAG_FLAG(metrics_prometheus_merged_cache_ms, runtime);
+
 // For configuration dashboard
 DECLARE_string(redact);
 DECLARE_string(rpc_encryption);
@@ -345,6 +359,89 @@ static void WriteMetricsAsJson(const MetricRegistry* const metrics,
               "Couldn't write JSON metrics over HTTP");
 }
 
+namespace {
+
+// Caches the recent outputs of the Prometheus metrics endpoint, keyed by
+// the options they were produced with.
+class PrometheusOutputCache {
+ public:
+  // Returns true and sets 'output' if 'key' was cached less than 'ttl' ago.
+  bool Lookup(const string& key, MonoDelta ttl, string* output) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    const auto* entry = FindOrNull(entries_, key);
+    if (!entry || MonoTime::Now() - entry->first > ttl) {
+      return false;
+    }
+    *output = entry->second;
+    return true;
+  }
+
+  void Insert(const string& key, string output) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    // Only a handful of distinct queries are expected; don't let arbitrary
+    // ones grow the cache without bound.
+    if (entries_.size() >= kMaxEntries) {
+      entries_.clear();
+    }
+    entries_[key] = { MonoTime::Now(), std::move(output) };
+  }
+
+ private:
+  static const int kMaxEntries = 16;
+
+  simple_spinlock lock_;
+  std::unordered_map<string, std::pair<MonoTime, string>> entries_;
+};
+
+} // anonymous namespace
+
+// Writes the metrics in the Prometheus text format. The supported arguments:
+//
+//   metrics: comma-separated substrings of the entity IDs and metric names
+//            to include.
+//   types: comma-separated entity types to include, e.g. 'server,tablet'.
+//   merge_tablets: whether to merge the metrics of the tablets by table.
+static void WriteMetricsAsPrometheus(const MetricRegistry* const metrics,
+                                     const shared_ptr<PrometheusOutputCache>& cache,
+                                     const Webserver::WebRequest& req,
+                                     Webserver::PrerenderedWebResponse* resp) {
+  MetricPrometheusOptions opts;
+  const string* requested_metrics_param = FindOrNull(req.parsed_args, "metrics");
+  if (requested_metrics_param != nullptr) {
+    SplitStringUsing(*requested_metrics_param, ",", &opts.requested_metrics);
+  }
+  const string* requested_types_param = FindOrNull(req.parsed_args, "types");
+  if (requested_types_param != nullptr) {
+    SplitStringUsing(*requested_types_param, ",", &opts.requested_entity_types);
+  }
+  {
+    string arg = FindWithDefault(req.parsed_args, "merge_tablets", "false");
+    opts.merge_tablets_by_table = ParseLeadingBoolValue(arg.c_str(), false);
+  }
+
+  const int32_t cache_ms = FLAGS_metrics_prometheus_merged_cache_ms;
+  if (!opts.merge_tablets_by_table || cache_ms <= 0) {
+    // Write directly to the response rather than to an intermediate buffer.
+    WARN_NOT_OK(metrics->WriteAsPrometheus(resp->output, opts),
+                "Couldn't write Prometheus metrics over HTTP");
+    return;
+  }
+
+  const string key = Substitute("$0/$1", JoinStrings(opts.requested_metrics, ","),
+                                JoinStrings(opts.requested_entity_types, ","));
+  string cached;
+  if (cache->Lookup(key, MonoDelta::FromMilliseconds(cache_ms), &cached)) {
+    *resp->output << cached;
+    return;
+  }
+  std::ostringstream output;
+  WARN_NOT_OK(metrics->WriteAsPrometheus(&output, opts),
+              "Couldn't write Prometheus metrics over HTTP");
+  string output_str = output.str();
+  *resp->output << output_str;
+  cache->Insert(key, std::move(output_str));
+}
+
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics) {
   Webserver::PrerenderedPathHandlerCallback callback = boost::bind(WriteMetricsAsJson, metrics,
                                                                    _1, _2);
@@ -358,6 +455,12 @@ void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* cons
   // monitoring software which expects the old name.
   webserver->RegisterPrerenderedPathHandler("/jsonmetricz", "Metrics", callback,
                                             not_styled, not_on_nav_bar);
+
+  Webserver::PrerenderedPathHandlerCallback prometheus_callback = boost::bind(
+      WriteMetricsAsPrometheus, metrics, std::make_shared<PrometheusOutputCache>(), _1, _2);
+  webserver->RegisterPrerenderedPathHandler("/metrics_prometheus", "Prometheus Metrics",
+                                            prometheus_callback,
+                                            not_styled, not_on_nav_bar);
 }
 
 } // namespace kudu
@@ -27,7 +27,7 @@ class Webserver;
 // logs and configuration flags.
 void AddDefaultPathHandlers(Webserver* webserver);
 
-// Adds an endpoint to get metrics in JSON format.
+// Adds endpoints to get metrics in JSON and Prometheus formats.
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics);
 
 } // namespace kudu
@@ -17,12 +17,14 @@
 
 #include "kudu/server/diagnostics_log.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <ostream>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -45,6 +47,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/os-util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/rolling_log.h"
@@ -56,6 +59,7 @@ using std::pair;
 using std::priority_queue;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
 using std::vector;
 using strings::Substitute;
 
@@ -79,6 +83,22 @@ DEFINE_int32(diagnostics_log_stack_traces_interval_ms, 60000,
 TAG_FLAG(diagnostics_log_stack_traces_interval_ms, runtime);
 TAG_FLAG(diagnostics_log_stack_traces_interval_ms, experimental);
 
+DEFINE_int32(diagnostics_log_cpu_profile_sample_interval_ms, 200,
+             "The interval at which the server will sample the stacks of its threads "
+             "which are running on CPU, for the continuous CPU profile written to the "
+             "diagnostics log. As with the stack traces, the actual interval is random, "
+             "between zero and twice the configured value. Setting this to 0 or a "
+             "negative value disables the CPU profile.");
+TAG_FLAG(diagnostics_log_cpu_profile_sample_interval_ms, runtime);
+TAG_FLAG(diagnostics_log_cpu_profile_sample_interval_ms, experimental);
+
+DEFINE_int32(diagnostics_log_cpu_profile_interval_ms, 60000,
+             "The interval at which the server will write the CPU samples it collected "
+             "to the diagnostics log, aggregated by stack trace. This bounds the time "
+             "resolution of the profiles which can be extracted from the log.");
+TAG_FLAG(diagnostics_log_cpu_profile_interval_ms, runtime);
+TAG_FLAG(diagnostics_log_cpu_profile_interval_ms, experimental);
+
 namespace kudu {
 namespace server {
 
@@ -109,13 +129,83 @@ class DiagnosticsLog::SymbolSet {
   google::dense_hash_set<void*> set_;
 };
 
+// The on-CPU stack samples collected since the profile was last logged,
+// aggregated by stack trace.
+class DiagnosticsLog::CpuProfile {
+ public:
+  CpuProfile() {
+    Reset();
+  }
+
+  void AddSample(const StackTrace& stack) {
+    counts_[stack]++;
+    num_samples_++;
+  }
+
+  void Reset() {
+    counts_.clear();
+    num_samples_ = 0;
+    start_us_ = GetCurrentTimeMicros();
+  }
+
+  int64_t num_samples() const { return num_samples_; }
+  MicrosecondsInt64 start_us() const { return start_us_; }
+
+  template<class F>
+  void VisitStacks(const F& visitor) const {
+    for (const auto& e : counts_) {
+      visitor(e.first, e.second);
+    }
+  }
+
+ private:
+  struct StackTraceHash {
+    size_t operator()(const StackTrace& stack) const {
+      return stack.HashCode();
+    }
+  };
+  struct StackTraceEqual {
+    bool operator()(const StackTrace& a, const StackTrace& b) const {
+      return a.Equals(b);
+    }
+  };
+
+  unordered_map<StackTrace, int64_t, StackTraceHash, StackTraceEqual> counts_;
+  int64_t num_samples_;
+  MicrosecondsInt64 start_us_;
+};
+
+namespace {
+
+// Appends a 'symbols' record for 'new_symbols' to 'buf'.
+void AppendSymbolsRecord(MicrosecondsInt64 now,
+                         const vector<pair<void*, string>>& new_symbols,
+                         std::ostringstream* buf) {
+  if (new_symbols.empty()) {
+    return;
+  }
+  *buf << "I" << FormatTimestampForLog(now)
+       << " symbols " << now << " ";
+  JsonWriter jw(buf, JsonWriter::COMPACT);
+  jw.StartObject();
+  for (auto& p : new_symbols) {
+    jw.String(StringPrintf("%p", p.first));
+    jw.String(p.second);
+  }
+  jw.EndObject();
+  *buf << "\n";
+}
+
+} // anonymous namespace
+
 DiagnosticsLog::DiagnosticsLog(string log_dir,
                                MetricRegistry* metric_registry) :
     log_dir_(std::move(log_dir)),
     metric_registry_(metric_registry),
     wake_(&lock_),
     metrics_log_interval_(MonoDelta::FromSeconds(60)),
-    symbols_(new SymbolSet()) {
+    symbols_(new SymbolSet()),
+    cpu_profile_(new CpuProfile()) {
 }
 DiagnosticsLog::~DiagnosticsLog() {
   Stop();
@@ -158,6 +248,8 @@ void DiagnosticsLog::Stop() {
   thread_->Join();
   thread_.reset();
   stop_ = false;
+  // Don't lose the samples collected since the profile was last logged.
+  WARN_NOT_OK(LogCpuProfile(), "Unable to write CPU profile to diagnostics log");
   WARN_NOT_OK(log_->Close(), "Unable to close diagnostics log");
 }
 
@@ -183,6 +275,17 @@ MonoTime DiagnosticsLog::ComputeNextWakeup(DiagnosticsLog::WakeupType type) cons
       break;
     case WakeupType::METRICS:
       return MonoTime::Now() + metrics_log_interval_;
+    case WakeupType::CPU_SAMPLE:
+      if (FLAGS_diagnostics_log_cpu_profile_sample_interval_ms > 0) {
+        // Randomize the samples for the same reason as the stack traces above.
+        Random rng(GetRandomSeed32());
+        int64_t ms = rng.Uniform(FLAGS_diagnostics_log_cpu_profile_sample_interval_ms * 2);
+        return MonoTime::Now() + MonoDelta::FromMilliseconds(ms);
+      }
+      return MonoTime::Now() + MonoDelta::FromSeconds(5);
+    case WakeupType::CPU_PROFILE:
+      return MonoTime::Now() + MonoDelta::FromMilliseconds(
+          std::max(FLAGS_diagnostics_log_cpu_profile_interval_ms, 1000));
   }
   __builtin_unreachable();
 }
@@ -195,6 +298,8 @@ void DiagnosticsLog::RunThread() {
   priority_queue<QueueElem, vector<QueueElem>, std::greater<QueueElem>> wakeups;
   wakeups.emplace(ComputeNextWakeup(WakeupType::METRICS), WakeupType::METRICS);
   wakeups.emplace(ComputeNextWakeup(WakeupType::STACKS), WakeupType::STACKS);
+  wakeups.emplace(ComputeNextWakeup(WakeupType::CPU_SAMPLE), WakeupType::CPU_SAMPLE);
+  wakeups.emplace(ComputeNextWakeup(WakeupType::CPU_PROFILE), WakeupType::CPU_PROFILE);
 
   while (!stop_) {
     MonoTime next_log = wakeups.top().first;
@@ -225,6 +330,15 @@ void DiagnosticsLog::RunThread() {
       WARN_NOT_OK(LogMetrics(), "Unable to collect metrics to diagnostics log");
     } else if (what == WakeupType::STACKS && FLAGS_diagnostics_log_stack_traces_interval_ms >= 0) {
       WARN_NOT_OK(LogStacks(reason), "Unable to collect stacks to diagnostics log");
+    } else if (what == WakeupType::CPU_SAMPLE &&
+               FLAGS_diagnostics_log_cpu_profile_sample_interval_ms > 0) {
+      // Sampling happens often, so don't flood the log if it keeps failing.
+      s = SampleCpu();
+      if (PREDICT_FALSE(!s.ok())) {
+        KLOG_EVERY_N_SECS(WARNING, 60) << "Unable to sample CPU stacks: " << s.ToString();
+      }
+    } else if (what == WakeupType::CPU_PROFILE) {
+      WARN_NOT_OK(LogCpuProfile(), "Unable to write CPU profile to diagnostics log");
     }
   }
 }
@@ -247,35 +361,9 @@ Status DiagnosticsLog::LogStacks(const string& reason) {
   symbols_->ResetIfLogRolled(log_->roll_count());
   vector<std::pair<void*, string>> new_symbols;
   snap.VisitGroups([&](ArrayView<StackTraceSnapshot::ThreadInfo> group) {
-      const StackTrace& stack = group[0].stack;
-      for (int i = 0; i < stack.num_frames(); i++) {
-        void* addr = stack.frame(i);
-        if (symbols_->Add(addr)) {
-          char buf[1024];
-          // Subtract 1 from the address before symbolizing, because the
-          // address on the stack is actually the return address of the function
-          // call rather than the address of the call instruction itself.
-          if (google::Symbolize(static_cast<char*>(addr) - 1, buf, sizeof(buf))) {
-            new_symbols.emplace_back(addr, buf);
-          }
-          // If symbolization fails, don't bother adding it. Readers of the log
-          // will just see that it's missing from the symbol map and should handle that
-          // as an unknown symbol.
-        }
-      }
+      AddNewSymbols(group[0].stack, &new_symbols);
     });
-  if (!new_symbols.empty()) {
-    buf << "I" << FormatTimestampForLog(now)
-        << " symbols " << now << " ";
-    JsonWriter jw(&buf, JsonWriter::COMPACT);
-    jw.StartObject();
-    for (auto& p : new_symbols) {
-      jw.String(StringPrintf("%p", p.first));
-      jw.String(p.second);
-    }
-    jw.EndObject();
-    buf << "\n";
-  }
+  AppendSymbolsRecord(now, new_symbols, &buf);
 
   buf << "I" << FormatTimestampForLog(now) << " stacks " << now << " ";
   JsonWriter jw(&buf, JsonWriter::COMPACT);
@@ -318,6 +406,96 @@ Status DiagnosticsLog::LogStacks(const string& reason) {
   return Status::OK();
 }
 
+void DiagnosticsLog::AddNewSymbols(const StackTrace& stack,
+                                   vector<pair<void*, string>>* new_symbols) {
+  for (int i = 0; i < stack.num_frames(); i++) {
+    void* addr = stack.frame(i);
+    if (symbols_->Add(addr)) {
+      char buf[1024];
+      // Subtract 1 from the address before symbolizing, because the
+      // address on the stack is actually the return address of the function
+      // call rather than the address of the call instruction itself.
+      if (google::Symbolize(static_cast<char*>(addr) - 1, buf, sizeof(buf))) {
+        new_symbols->emplace_back(addr, buf);
+      }
+      // If symbolization fails, don't bother adding it. Readers of the log
+      // will just see that it's missing from the symbol map and should handle that
+      // as an unknown symbol.
+    }
+  }
+}
+
+Status DiagnosticsLog::SampleCpu() {
+  vector<pid_t> tids;
+  RETURN_NOT_OK(ListThreads(&tids));
+  const int64_t self_tid = Thread::CurrentThreadId();
+  for (pid_t tid : tids) {
+    // Only the threads which are on CPU (or waiting for one) are sampled, so
+    // that the cost of signaling is only paid for the threads of interest.
+    // This thread is running by definition, but it is not of interest.
+    ThreadStats stats;
+    if (tid == self_tid || !GetThreadStats(tid, &stats).ok() || stats.state != 'R') {
+      continue;
+    }
+    StackTrace stack;
+    // The thread may have exited or gone to sleep in the meantime, in which
+    // case the sample is skipped or slightly off, respectively.
+    if (GetThreadStack(tid, &stack).ok() && stack.HasCollected()) {
+      cpu_profile_->AddSample(stack);
+    }
+  }
+  return Status::OK();
+}
+
+Status DiagnosticsLog::LogCpuProfile() {
+  if (cpu_profile_->num_samples() == 0) {
+    cpu_profile_->Reset();
+    return Status::OK();
+  }
+
+  std::ostringstream buf;
+  MicrosecondsInt64 now = GetCurrentTimeMicros();
+
+  // Dictionary-encode the symbols as for the stack traces.
+  symbols_->ResetIfLogRolled(log_->roll_count());
+  vector<pair<void*, string>> new_symbols;
+  cpu_profile_->VisitStacks([&](const StackTrace& stack, int64_t /*count*/) {
+      AddNewSymbols(stack, &new_symbols);
+    });
+  AppendSymbolsRecord(now, new_symbols, &buf);
+
+  buf << "I" << FormatTimestampForLog(now) << " cpu_profile " << now << " ";
+  JsonWriter jw(&buf, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("start_us");
+  jw.Int64(cpu_profile_->start_us());
+  jw.String("end_us");
+  jw.Int64(now);
+  jw.String("samples");
+  jw.Int64(cpu_profile_->num_samples());
+  jw.String("stacks");
+  jw.StartArray();
+  cpu_profile_->VisitStacks([&](const StackTrace& stack, int64_t count) {
+      jw.StartObject();
+      jw.String("count");
+      jw.Int64(count);
+      jw.String("stack");
+      jw.StartArray();
+      for (int i = 0; i < stack.num_frames(); i++) {
+        jw.String(StringPrintf("%p", stack.frame(i)));
+      }
+      jw.EndArray();
+      jw.EndObject();
+    });
+  jw.EndArray();
+  jw.EndObject();
+  buf << "\n";
+
+  RETURN_NOT_OK(log_->Append(buf.str()));
+  cpu_profile_->Reset();
+  return Status::OK();
+}
+
 Status DiagnosticsLog::LogMetrics() {
   MetricJsonOptions opts;
   opts.include_raw_histograms = true;
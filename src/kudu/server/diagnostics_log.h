@@ -19,6 +19,8 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 
@@ -32,6 +34,7 @@ namespace kudu {
 
 class MetricRegistry;
 class RollingLog;
+class StackTrace;
 class Thread;
 class Status;
 
@@ -55,16 +58,31 @@ class DiagnosticsLog {
 
  private:
   class SymbolSet;
+  class CpuProfile;
 
   enum class WakeupType {
     METRICS,
-    STACKS
+    STACKS,
+    CPU_SAMPLE,
+    CPU_PROFILE
   };
 
   void RunThread();
   Status LogMetrics();
   Status LogStacks(const std::string& reason);
 
+  // Samples the stacks of the threads which are currently on CPU into
+  // 'cpu_profile_'.
+  Status SampleCpu();
+
+  // Logs the CPU samples aggregated since the last call, if any.
+  Status LogCpuProfile();
+
+  // Appends the addresses of 'stack' which have not been logged yet since
+  // the log was last rolled, along with their symbols, to 'new_symbols'.
+  void AddNewSymbols(const StackTrace& stack,
+                     std::vector<std::pair<void*, std::string>>* new_symbols);
+
   MonoTime ComputeNextWakeup(DiagnosticsLog::WakeupType type) const;
 
   const std::string log_dir_;
@@ -89,6 +107,9 @@ class DiagnosticsLog {
   // Out-of-line this internal data to keep the header smaller.
   std::unique_ptr<SymbolSet> symbols_;
 
+  // The CPU samples not yet logged. Only accessed by the logging thread.
+  std::unique_ptr<CpuProfile> cpu_profile_;
+
   DISALLOW_COPY_AND_ASSIGN(DiagnosticsLog);
 };
 
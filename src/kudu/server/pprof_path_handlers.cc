@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -43,6 +44,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/server/webserver.h"
+#include "kudu/util/debug-util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/monotime.h"
@@ -164,29 +166,57 @@ static void PprofGrowthHandler(const Webserver::WebRequest& /*req*/,
 }
 
 // Lock contention profiling
+//
+// Collects contention on all profiled lock types (see spinlock_profiling.h)
+// for 'seconds', and responds with a pprof contention profile. If 'lock_type'
+// is set (e.g. to "mutex"), the profile only covers locks of that type.
 static void PprofContentionHandler(const Webserver::WebRequest& req,
                                    Webserver::PrerenderedWebResponse* resp) {
   string secs_str = FindWithDefault(req.parsed_args, "seconds", "");
   int32_t seconds = ParseLeadingInt32Value(secs_str.c_str(), kPprofDefaultSampleSecs);
+  LockType lock_type = LockType::SPINLOCK;
+  const string* lock_type_str = FindOrNull(req.parsed_args, "lock_type");
+  if (lock_type_str && !ParseLockType(*lock_type_str, &lock_type)) {
+    resp->status_code = HttpStatusCode::BadRequest;
+    *resp->output << "Unknown lock type: " << *lock_type_str;
+    return;
+  }
   int64_t discarded_samples = 0;
 
   MonoTime end = MonoTime::Now() + MonoDelta::FromSeconds(seconds);
-  ostringstream profile;
+  vector<LockContentionSample> samples;
   StartSynchronizationProfiling();
   while (MonoTime::Now() < end) {
     SleepFor(MonoDelta::FromMilliseconds(500));
-    FlushSynchronizationProfile(&profile, &discarded_samples);
+    FlushSynchronizationProfile(&samples, &discarded_samples);
   }
   StopSynchronizationProfiling();
-  FlushSynchronizationProfile(&profile, &discarded_samples);
+  FlushSynchronizationProfile(&samples, &discarded_samples);
+
+  // Total the waits by lock type, skipping the types we weren't asked for.
+  std::map<string, int64_t> cycles_by_type;
+  ostringstream profile;
+  for (const auto& s : samples) {
+    if (lock_type_str && s.lock_type != lock_type) {
+      continue;
+    }
+    cycles_by_type[LockTypeToString(s.lock_type)] += s.wait_cycles;
+    profile << s.wait_cycles << " " << s.trip_count
+            << " @ " << s.stack.ToHexString(StackTrace::NO_FIX_CALLER_ADDRESSES |
+                                            StackTrace::HEX_0X_PREFIX)
+            << endl;
+  }
 
   ostringstream* output = resp->output;
   *output << "--- contention:" << endl;
   *output << "sampling period = 1" << endl;
   *output << "cycles/second = " << static_cast<int64_t>(base::CyclesPerSecond()) << endl;
-  // pprof itself ignores this value, but we can at least look at it in the textual
-  // output.
+  // pprof itself ignores these values, but we can at least look at them in the
+  // textual output.
   *output << "discarded samples = " << discarded_samples << std::endl;
+  for (const auto& e : cycles_by_type) {
+    *output << e.first << " wait cycles = " << e.second << endl;
+  }
   *output << profile.str();
 
 #if defined(__linux__)
@@ -265,6 +295,9 @@ void AddPprofPathHandlers(Webserver* webserver) {
   webserver->RegisterPrerenderedPathHandler("/pprof/symbol", "", PprofSymbolHandler, false, false);
   webserver->RegisterPrerenderedPathHandler("/pprof/contention", "", PprofContentionHandler,
                                             false, false);
+  // The same profile, under a shorter name for fetching it by hand.
+  webserver->RegisterPrerenderedPathHandler("/contention", "", PprofContentionHandler,
+                                            false, false);
 }
 
 } // namespace kudu
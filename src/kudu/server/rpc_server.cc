@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <ostream>
@@ -84,6 +85,13 @@ DEFINE_bool(rpc_reuseport, false,
             "Whether to set the SO_REUSEPORT option on listening RPC sockets.");
 TAG_FLAG(rpc_reuseport, experimental);
 
+DEFINE_bool(rpc_acceptor_per_reactor, false,
+            "Whether to listen on each bound address with one SO_REUSEPORT socket "
+            "per RPC reactor, letting the kernel spread incoming connections across "
+            "them. Connections accepted on a socket are handled by its reactor. "
+            "Each socket gets --rpc_num_acceptors_per_address acceptor threads.");
+TAG_FLAG(rpc_acceptor_per_reactor, experimental);
+
 namespace kudu {
 
 RpcServerOptions::RpcServerOptions()
@@ -93,7 +101,8 @@ RpcServerOptions::RpcServerOptions()
     num_service_threads(FLAGS_rpc_num_service_threads),
     default_port(0),
     service_queue_length(FLAGS_rpc_service_queue_length),
-    rpc_reuseport(FLAGS_rpc_reuseport) {
+    rpc_reuseport(FLAGS_rpc_reuseport),
+    acceptor_per_reactor(FLAGS_rpc_acceptor_per_reactor) {
 }
 
 RpcServer::RpcServer(RpcServerOptions opts)
@@ -168,10 +177,17 @@ Status RpcServer::RegisterService(gscoped_ptr<rpc::ServiceIf> service) {
 Status RpcServer::Bind() {
   CHECK_EQ(server_state_, INITIALIZED);
 
-  // Create the Acceptor pools (one per bind address)
+  // Create the Acceptor pools (one per bind address, or one per bind address
+  // and reactor if sharding acceptors by reactor)
   vector<shared_ptr<AcceptorPool> > new_acceptor_pools;
   // Create the AcceptorPool for each bind address.
   for (const Sockaddr& bind_addr : rpc_bind_addresses_) {
+    if (options_.acceptor_per_reactor) {
+      vector<shared_ptr<AcceptorPool>> pools;
+      RETURN_NOT_OK(messenger_->AddReactorAcceptorPools(bind_addr, &pools));
+      new_acceptor_pools.insert(new_acceptor_pools.end(), pools.begin(), pools.end());
+      continue;
+    }
     shared_ptr<rpc::AcceptorPool> pool;
     RETURN_NOT_OK(messenger_->AddAcceptorPool(
                     bind_addr,
@@ -227,6 +243,10 @@ Status RpcServer::GetBoundAddresses(vector<Sockaddr>* addresses) const {
     Sockaddr bound_addr;
     RETURN_NOT_OK_PREPEND(pool->GetBoundAddress(&bound_addr),
                           "Unable to get bound address from AcceptorPool");
+    // Acceptor pools sharded by reactor share their bound address.
+    if (std::find(addresses->begin(), addresses->end(), bound_addr) != addresses->end()) {
+      continue;
+    }
     addresses->push_back(bound_addr);
   }
   return Status::OK();
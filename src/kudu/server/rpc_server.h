@@ -53,6 +53,7 @@ struct RpcServerOptions {
   uint16_t default_port;
   size_t service_queue_length;
   bool rpc_reuseport;
+  bool acceptor_per_reactor;
 };
 
 class RpcServer {
@@ -15,9 +15,12 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <thread>
 #include <unordered_set>
@@ -26,6 +29,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/endian.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/tablet/concurrent_btree.h"
@@ -37,6 +41,7 @@
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::string;
@@ -48,6 +53,15 @@ namespace kudu {
 namespace tablet {
 namespace btree {
 
+// Traits with the same layout as the MemRowSet's tree: larger nodes with
+// 16-byte key slots, which store short keys inline and a prefix of the
+// longer ones.
+struct PrefixKeyTraits : public BTreeTraits {
+  static const size_t kInternalNodeSize = 8 * CACHELINE_SIZE;
+  static const size_t kLeafNodeSize = 8 * CACHELINE_SIZE;
+  static const size_t kKeySliceSize = 16;
+};
+
 class TestCBTree : public KuduTest {
  protected:
   template<class T>
@@ -99,6 +113,12 @@ TEST_F(TestCBTree, TestNodeSizes) {
   InternalNode<BTreeTraits> inode(Slice("split"), &lnode, &lnode, &arena);
   ASSERT_LE(sizeof(inode), BTreeTraits::kInternalNodeSize);
 
+  LeafNode<PrefixKeyTraits> prefix_lnode(false);
+  ASSERT_LE(sizeof(prefix_lnode), PrefixKeyTraits::kLeafNodeSize);
+
+  InternalNode<PrefixKeyTraits> prefix_inode(Slice("split"), &prefix_lnode, &prefix_lnode,
+                                             &arena);
+  ASSERT_LE(sizeof(prefix_inode), PrefixKeyTraits::kInternalNodeSize);
 }
 
 TEST_F(TestCBTree, TestLeafNode) {
@@ -177,6 +197,14 @@ struct RacyTraits : public SmallFanoutTraits {
   static const size_t kDebugRaciness = 100;
 };
 
+// Small fanout with 16-byte key slots, so that the keys' inline prefixes are
+// copied around by node splits.
+struct SmallFanoutPrefixKeyTraits : public BTreeTraits {
+  static const size_t kInternalNodeSize = 120;
+  static const size_t kLeafNodeSize = 128;
+  static const size_t kKeySliceSize = 16;
+};
+
 void MakeKey(char *kbuf, size_t len, int i) {
   snprintf(kbuf, len, "key_%d%d", i % 10, i / 10);
 }
@@ -347,6 +375,56 @@ TEST_F(TestCBTree, TestInsertAndVerifyRandom) {
   }
 }
 
+// Insert keys which are longer than the key slots and share prefixes of
+// various lengths, in random order, and verify that they're found and
+// iterated in order. This exercises the comparisons which are decided by the
+// keys' inline prefixes as well as the ones which have to follow the pointers.
+TEST_F(TestCBTree, TestInsertAndVerifyLongKeys) {
+  CBTree<SmallFanoutPrefixKeyTraits> t;
+  int n_keys = 1000;
+  if (AllowSlowTests()) {
+    n_keys = 100000;
+  }
+
+  vector<string> keys;
+  for (int i = 0; i < n_keys; i++) {
+    // The first 'shared' bytes of the keys are the same, the rest is random.
+    int shared = i % 24;
+    string key(shared, 'k');
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%08x%08x", rand(), i);
+    key.append(buf);
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+
+  for (const string& key : keys) {
+    ASSERT_TRUE(t.Insert(Slice(key), Slice("val")));
+  }
+  for (const string& key : keys) {
+    char vbuf_out[64];
+    size_t len = sizeof(vbuf_out);
+    ASSERT_EQ(CBTree<SmallFanoutPrefixKeyTraits>::GET_SUCCESS,
+              t.GetCopy(Slice(key), vbuf_out, &len)) << key;
+    // A prefix of an inserted key isn't found.
+    ASSERT_EQ(CBTree<SmallFanoutPrefixKeyTraits>::GET_NOT_FOUND,
+              t.GetCopy(Slice(key.data(), key.size() - 1), vbuf_out, &len)) << key;
+  }
+
+  std::sort(keys.begin(), keys.end());
+  gscoped_ptr<CBTreeIterator<SmallFanoutPrefixKeyTraits> > iter(t.NewIterator());
+  bool exact;
+  iter->SeekAtOrAfter(Slice(""), &exact);
+  for (const string& key : keys) {
+    ASSERT_TRUE(iter->IsValid());
+    Slice k, v;
+    iter->GetCurrentEntry(&k, &v);
+    ASSERT_EQ(key, k.ToString());
+    iter->Next();
+  }
+  ASSERT_FALSE(iter->IsValid());
+}
+
 // Thread which cycles through doing the following:
 // - lock the node
 // - either mark it splitting or inserting (alternatingly)
@@ -430,6 +508,11 @@ TEST_F(TestCBTree, TestRacyConcurrentInsert) {
   DoTestConcurrentInsert<RacyTraits>();
 }
 
+// Same, but with keys stored in 16-byte slots.
+TEST_F(TestCBTree, TestConcurrentInsertPrefixKeys) {
+  DoTestConcurrentInsert<SmallFanoutPrefixKeyTraits>();
+}
+
 template<class TraitsClass>
 void TestCBTree::DoTestConcurrentInsert() {
   gscoped_ptr<CBTree<TraitsClass> > tree;
@@ -786,6 +869,69 @@ TEST_F(TestCBTree, TestScanPerformance) {
   }
 }
 
+// Insert 'n_keys' keys into 'tree' from 'num_threads' threads, each of
+// which inserts a disjoint range of keys, and log the insert throughput and
+// the memory used per row. The keys are big-endian integers, optionally
+// preceded by 'key_prefix_len' bytes which vary with the low bits of the
+// integer, as is the case for composite or hash-partitioned primary keys.
+template<class Traits>
+static void DoConcurrentInsertBenchmark(const char* traits_name, int num_threads,
+                                        int n_keys, int key_prefix_len) {
+  auto arena = std::make_shared<typename Traits::ArenaType>(4 * 1024);
+  CBTree<Traits> tree(arena);
+
+  int keys_per_thread = n_keys / num_threads;
+  Stopwatch sw;
+  sw.start();
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+        faststring key;
+        for (int i = t * keys_per_thread; i < (t + 1) * keys_per_thread; i++) {
+          key.clear();
+          for (int j = 0; j < key_prefix_len; j++) {
+            key.push_back(static_cast<uint8_t>('a' + (i + j) % 16));
+          }
+          uint32_t be = BigEndian::FromHost32(static_cast<uint32_t>(i));
+          key.append(&be, sizeof(be));
+          CHECK(tree.Insert(Slice(key), Slice("v")));
+        }
+      });
+  }
+  for (thread& thr : threads) {
+    thr.join();
+  }
+  sw.stop();
+
+  int total = keys_per_thread * num_threads;
+  LOG(INFO) << StringPrintf("%s: inserted %d %d-byte keys from %d threads: "
+                            "%.0f inserts/sec, %.1f bytes/row",
+                            traits_name, total, key_prefix_len + 4, num_threads,
+                            total / sw.elapsed().wall_seconds(),
+                            static_cast<double>(arena->memory_footprint()) / total);
+  ASSERT_EQ(total, static_cast<int>(tree.count()));
+}
+
+// Compare the insert performance of the default traits with the ones used by
+// the MemRowSet.
+TEST_F(TestCBTree, TestConcurrentInsertPerformance) {
+#ifndef NDEBUG
+  int n_keys = 10000;
+#else
+  int n_keys = 1000000;
+#endif
+  if (AllowSlowTests()) {
+    n_keys = 4000000;
+  }
+  const int kNumThreads = 8;
+  for (int key_prefix_len : { 0, 28 }) {
+    NO_FATALS(DoConcurrentInsertBenchmark<BTreeTraits>(
+        "default traits", kNumThreads, n_keys, key_prefix_len));
+    NO_FATALS(DoConcurrentInsertBenchmark<PrefixKeyTraits>(
+        "prefix key traits", kNumThreads, n_keys, key_prefix_len));
+  }
+}
+
 } // namespace btree
 } // namespace tablet
 } // namespace kudu
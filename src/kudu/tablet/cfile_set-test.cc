@@ -24,6 +24,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -43,12 +44,15 @@
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/fs/block_id.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/tablet/diskrowset.h"
+#include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/secondary_index.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/util/auto_release_pool.h"
 #include "kudu/util/bloom_filter.h"
@@ -58,6 +62,8 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(consult_secondary_indexes);
+DECLARE_bool(consult_zone_maps);
 DECLARE_int32(cfile_default_block_size);
 
 using std::shared_ptr;
@@ -557,5 +563,241 @@ TEST_F(TestCFileSet, TestBloomFilterPredicates) {
   DoTestBloomFilterScan(fileset, { bf_with_range }, ret1_contain_range);
 }
 
+class TestCFileSetSecondaryIndex : public KuduRowSetTest {
+ public:
+  TestCFileSetSecondaryIndex()
+      : KuduRowSetTest(Schema({ ColumnSchema("key", INT32),
+                                ColumnSchema("email", STRING, false, nullptr, nullptr,
+                                             GetIndexedStorage()),
+                                ColumnSchema("group", INT32, true, nullptr, nullptr,
+                                             GetIndexedStorage()) }, 1)) {
+  }
+
+  // Write a rowset whose row 'i' has the key 'i', the e-mail "user<i>" and,
+  // except for every third row which is null, the group 'i % 7'.
+  void WriteTestRowSet(int nrows) {
+    DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
+                         BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
+    ASSERT_OK(rsw.Open());
+    RowBuilder rb(schema_);
+    for (int i = 0; i < nrows; i++) {
+      rb.Reset();
+      rb.AddInt32(i);
+      string email = StringPrintf("user%d", i);
+      rb.AddString(Slice(email));
+      if (i % 3 == 0) {
+        rb.AddNull();
+      } else {
+        rb.AddInt32(i % 7);
+      }
+      ASSERT_OK_FAST(WriteRow(rb.data(), &rsw));
+    }
+    ASSERT_OK(rsw.Finish());
+  }
+
+  // Scan 'fileset' with 'pred' and return the keys of the matching rows.
+  void ScanKeys(const shared_ptr<CFileSet>& fileset,
+                const ColumnPredicate& pred,
+                vector<int32_t>* keys,
+                vector<IteratorStats>* stats) {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    ASSERT_OK(iter->Init(&spec));
+    Arena arena(1024);
+    RowBlock block(schema_, 100, &arena);
+    keys->clear();
+    while (iter->HasNext()) {
+      ASSERT_OK_FAST(iter->NextBlock(&block));
+      for (size_t i = 0; i < block.nrows(); i++) {
+        if (block.selection_vector()->IsRowSelected(i)) {
+          keys->push_back(*schema_.ExtractColumnFromRow<INT32>(block.row(i), 0));
+        }
+      }
+    }
+    cfile_iter->GetIteratorStats(stats);
+  }
+
+ private:
+  static ColumnStorageAttributes GetIndexedStorage() {
+    ColumnStorageAttributes attr;
+    attr.secondary_index = true;
+    return attr;
+  }
+};
+
+TEST_F(TestCFileSetSecondaryIndex, TestLookupAndScan) {
+  const int kNumRows = 10000;
+  // Make sure that the rows are skipped thanks to the indexes only.
+  FLAGS_consult_zone_maps = false;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+  ASSERT_EQ(nullptr, fileset->index_reader_for_col_id(schema_.column_id(0)));
+  cfile::CFileReader* email_index = fileset->index_reader_for_col_id(schema_.column_id(1));
+  cfile::CFileReader* group_index = fileset->index_reader_for_col_id(schema_.column_id(2));
+  ASSERT_NE(nullptr, email_index);
+  ASSERT_NE(nullptr, group_index);
+  ASSERT_GT(fileset->SecondaryIndexOnDiskSize(), 0);
+
+  // "user1" is a prefix of "user10" etc, which must not match.
+  Slice user1("user1");
+  Slice user9999("user9999");
+  Slice missing("user10000");
+  vector<rowid_t> rowids;
+  ASSERT_OK(SecondaryIndexLookup(email_index,
+                                 ColumnPredicate::Equality(schema_.column(1), &user1),
+                                 nullptr, &rowids));
+  ASSERT_EQ(vector<rowid_t>({ 1 }), rowids);
+  vector<const void*> emails = { &missing, &user1, &user9999 };
+  ASSERT_OK(SecondaryIndexLookup(email_index,
+                                 ColumnPredicate::InList(schema_.column(1), &emails),
+                                 nullptr, &rowids));
+  ASSERT_EQ(vector<rowid_t>({ 1, 9999 }), rowids);
+
+  // Null cells aren't indexed.
+  int32_t group = 0;
+  ASSERT_OK(SecondaryIndexLookup(group_index,
+                                 ColumnPredicate::Equality(schema_.column(2), &group),
+                                 nullptr, &rowids));
+  vector<rowid_t> expected_rowids;
+  for (int i = 0; i < kNumRows; i++) {
+    if (i % 3 != 0 && i % 7 == group) {
+      expected_rowids.push_back(i);
+    }
+  }
+  ASSERT_EQ(expected_rowids, rowids);
+
+  // A scan only reads the batches holding the matching rows.
+  vector<int32_t> keys;
+  vector<IteratorStats> stats;
+  NO_FATALS(ScanKeys(fileset, ColumnPredicate::InList(schema_.column(1), &emails),
+                     &keys, &stats));
+  ASSERT_EQ(vector<int32_t>({ 1, 9999 }), keys);
+  ASSERT_LE(stats[1].cells_read, 200);
+
+  // Unless the indexes are ignored.
+  FLAGS_consult_secondary_indexes = false;
+  NO_FATALS(ScanKeys(fileset, ColumnPredicate::InList(schema_.column(1), &emails),
+                     &keys, &stats));
+  ASSERT_EQ(vector<int32_t>({ 1, 9999 }), keys);
+  ASSERT_EQ(kNumRows, stats[1].cells_read);
+}
+
+class TestCFileSetColumnGroup : public KuduRowSetTest {
+ public:
+  TestCFileSetColumnGroup()
+      : KuduRowSetTest(Schema({ ColumnSchema("key", INT32),
+                                ColumnSchema("name", STRING, false, nullptr, nullptr,
+                                             GetGroupStorage(NO_COMPRESSION)),
+                                ColumnSchema("count", INT32, true, nullptr, nullptr,
+                                             GetGroupStorage(LZ4)),
+                                ColumnSchema("other", INT64) }, 1)) {
+  }
+
+  // Write a rowset whose row 'i' has the key 'i', the name "name<i>", the
+  // count 'i * 3' except for every fifth row which is null, and the other
+  // value 'i * 7'.
+  void WriteTestRowSet(int nrows) {
+    DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
+                         BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
+    ASSERT_OK(rsw.Open());
+    RowBuilder rb(schema_);
+    for (int i = 0; i < nrows; i++) {
+      rb.Reset();
+      rb.AddInt32(i);
+      string name = StringPrintf("name%d", i);
+      rb.AddString(Slice(name));
+      if (i % 5 == 0) {
+        rb.AddNull();
+      } else {
+        rb.AddInt32(i * 3);
+      }
+      rb.AddInt64(i * 7);
+      ASSERT_OK_FAST(WriteRow(rb.data(), &rsw));
+    }
+    ASSERT_OK(rsw.Finish());
+  }
+
+ private:
+  static ColumnStorageAttributes GetGroupStorage(CompressionType compression) {
+    ColumnStorageAttributes attr;
+    attr.compression = compression;
+    attr.column_group = "g";
+    return attr;
+  }
+};
+
+TEST_F(TestCFileSetColumnGroup, TestWriteAndScan) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  // The grouped columns share a block, one after the other.
+  const ColumnId key_id = schema_.column_id(0);
+  const ColumnId name_id = schema_.column_id(1);
+  const ColumnId count_id = schema_.column_id(2);
+  const ColumnId other_id = schema_.column_id(3);
+  const BlockId group_block = rowset_meta_->column_data_block_for_col_id(name_id);
+  ASSERT_EQ(group_block, rowset_meta_->column_data_block_for_col_id(count_id));
+  ASSERT_NE(group_block, rowset_meta_->column_data_block_for_col_id(other_id));
+  ColumnBlockRange name_range;
+  ColumnBlockRange count_range;
+  ColumnBlockRange unused;
+  ASSERT_TRUE(rowset_meta_->GetColumnBlockRange(name_id, &name_range));
+  ASSERT_TRUE(rowset_meta_->GetColumnBlockRange(count_id, &count_range));
+  ASSERT_FALSE(rowset_meta_->GetColumnBlockRange(key_id, &unused));
+  ASSERT_FALSE(rowset_meta_->GetColumnBlockRange(other_id, &unused));
+  ASSERT_EQ(0, name_range.offset);
+  ASSERT_EQ(name_range.length, count_range.offset);
+
+  // The shared block is only listed once.
+  vector<BlockId> blocks = rowset_meta_->GetAllBlocks();
+  ASSERT_EQ(blocks.size(), BlockIdSet(blocks.begin(), blocks.end()).size());
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+  ASSERT_EQ(name_range.length, fileset->OnDiskColumnDataSize(name_id));
+  ASSERT_EQ(count_range.length, fileset->OnDiskColumnDataSize(count_id));
+
+  gscoped_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+  gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(
+      shared_ptr<ColumnwiseIterator>(cfile_iter.release())));
+  ASSERT_OK(iter->Init(nullptr));
+  Arena arena(1024);
+  RowBlock block(schema_, 100, &arena);
+  int i = 0;
+  while (iter->HasNext()) {
+    arena.Reset();
+    ASSERT_OK_FAST(iter->NextBlock(&block));
+    for (size_t j = 0; j < block.nrows(); j++, i++) {
+      RowBlockRow row = block.row(j);
+      ASSERT_EQ(i, *schema_.ExtractColumnFromRow<INT32>(row, 0));
+      ASSERT_EQ(StringPrintf("name%d", i),
+                schema_.ExtractColumnFromRow<STRING>(row, 1)->ToString());
+      if (i % 5 == 0) {
+        ASSERT_TRUE(row.is_null(2));
+      } else {
+        ASSERT_EQ(i * 3, *schema_.ExtractColumnFromRow<INT32>(row, 2));
+      }
+      ASSERT_EQ(i * 7, *schema_.ExtractColumnFromRow<INT64>(row, 3));
+    }
+  }
+  ASSERT_EQ(kNumRows, i);
+
+  // The shared block is only removed once no column refers to it.
+  vector<BlockId> removed;
+  RowSetMetadataUpdate update;
+  update.ReplaceColumnId(name_id, BlockId(1));
+  rowset_meta_->CommitUpdate(update, &removed);
+  ASSERT_TRUE(removed.empty());
+  ASSERT_FALSE(rowset_meta_->GetColumnBlockRange(name_id, &unused));
+  RowSetMetadataUpdate update2;
+  update2.RemoveColumnId(count_id);
+  rowset_meta_->CommitUpdate(update2, &removed);
+  ASSERT_EQ(vector<BlockId>({ group_block }), removed);
+}
+
 } // namespace tablet
 } // namespace kudu
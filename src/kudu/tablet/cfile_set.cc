@@ -54,6 +54,9 @@
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/secondary_index.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/slice.h"
@@ -62,6 +65,19 @@
 DEFINE_bool(consult_bloom_filters, true, "Whether to consult bloom filters on row presence checks");
 TAG_FLAG(consult_bloom_filters, hidden);
 
+DEFINE_bool(consult_zone_maps, true,
+            "Whether to consult per-block column statistics (zone maps), and "
+            "the per-rowset statistics derived from them, to skip blocks of "
+            "rows and whole rowsets which cannot match a scan predicate");
+TAG_FLAG(consult_zone_maps, hidden);
+
+DEFINE_bool(consult_secondary_indexes, true,
+            "Whether to look up the rows matching equality and IN-list scan "
+            "predicates in the secondary indexes of their columns, and skip "
+            "the blocks of rows which hold none of them");
+TAG_FLAG(consult_secondary_indexes, advanced);
+TAG_FLAG(consult_secondary_indexes, runtime);
+
 DECLARE_bool(rowset_metadata_store_keys);
 
 namespace kudu {
@@ -88,17 +104,24 @@ using strings::Substitute;
 // Utilities
 ////////////////////////////////////////////////////////////
 
-static Status OpenReader(FsManager* fs,
+// If 'range' isn't null, the cfile is that range of the block.
+static Status OpenReader(const RowSetMetadata& rowset_metadata,
                          shared_ptr<MemTracker> parent_mem_tracker,
                          const BlockId& block_id,
+                         const ColumnBlockRange* range,
                          const IOContext* io_context,
                          unique_ptr<CFileReader>* new_reader) {
   unique_ptr<ReadableBlock> block;
-  RETURN_NOT_OK(fs->OpenBlock(block_id, &block));
+  RETURN_NOT_OK(rowset_metadata.fs_manager()->OpenBlock(block_id, &block));
 
   ReaderOptions opts;
   opts.parent_mem_tracker = std::move(parent_mem_tracker);
   opts.io_context = io_context;
+  opts.table_id = rowset_metadata.tablet_metadata()->table_id();
+  if (range != nullptr) {
+    opts.block_offset = range->offset;
+    opts.block_length = range->length;
+  }
   return CFileReader::OpenNoInit(std::move(block),
                                  std::move(opts),
                                  new_reader);
@@ -139,10 +162,14 @@ Status CFileSet::DoOpen(const IOContext* io_context) {
     ColumnId col_id = e.first;
     DCHECK(!ContainsKey(readers_by_col_id_, col_id)) << "already open";
 
+    // The columns of a column group share a block.
+    ColumnBlockRange range;
+    const bool shared = rowset_metadata_->GetColumnBlockRange(col_id, &range);
     unique_ptr<CFileReader> reader;
-    RETURN_NOT_OK(OpenReader(rowset_metadata_->fs_manager(),
+    RETURN_NOT_OK(OpenReader(*rowset_metadata_,
                              parent_mem_tracker_,
-                             rowset_metadata_->column_data_block_for_col_id(col_id),
+                             e.second,
+                             shared ? &range : nullptr,
                              io_context,
                              &reader));
     readers_by_col_id_[col_id] = std::move(reader);
@@ -151,10 +178,25 @@ Status CFileSet::DoOpen(const IOContext* io_context) {
   }
   readers_by_col_id_.shrink_to_fit();
 
+  RowSetMetadata::ColumnIdToBlockIdMap index_block_map =
+      rowset_metadata_->GetColumnIndexBlocksById();
+  for (const RowSetMetadata::ColumnIdToBlockIdMap::value_type& e : index_block_map) {
+    unique_ptr<CFileReader> reader;
+    RETURN_NOT_OK(OpenReader(*rowset_metadata_,
+                             parent_mem_tracker_,
+                             e.second,
+                             nullptr,
+                             io_context,
+                             &reader));
+    index_readers_by_col_id_[e.first] = std::move(reader);
+  }
+  index_readers_by_col_id_.shrink_to_fit();
+
   if (rowset_metadata_->has_adhoc_index_block()) {
-    RETURN_NOT_OK(OpenReader(rowset_metadata_->fs_manager(),
+    RETURN_NOT_OK(OpenReader(*rowset_metadata_,
                              parent_mem_tracker_,
                              rowset_metadata_->adhoc_index_block(),
+                             nullptr,
                              io_context,
                              &ad_hoc_idx_reader_));
   }
@@ -174,6 +216,13 @@ Status CFileSet::DoOpen(const IOContext* io_context) {
                                          KUDU_REDACT(Slice(max_encoded_key_).ToDebugString())),
                               ToString());
   }
+  // Backfill the keys of rowsets written without them into the metadata,
+  // so that they are persisted with the next metadata flush and the key
+  // index doesn't need to be read the next time the rowset is opened.
+  if (FLAGS_rowset_metadata_store_keys && !rowset_metadata_->has_encoded_keys()) {
+    rowset_metadata_->set_min_encoded_key(min_encoded_key_);
+    rowset_metadata_->set_max_encoded_key(max_encoded_key_);
+  }
 
   return Status::OK();
 }
@@ -186,6 +235,7 @@ Status CFileSet::OpenBloomReader(const IOContext* io_context) {
   ReaderOptions opts;
   opts.parent_mem_tracker = parent_mem_tracker_;
   opts.io_context = io_context;
+  opts.table_id = rowset_metadata_->tablet_metadata()->table_id();
   Status s = BloomFileReader::OpenNoInit(std::move(block),
                                          std::move(opts),
                                          &bloom_reader_);
@@ -255,6 +305,14 @@ uint64_t CFileSet::BloomFileOnDiskSize() const {
   return bloom_reader_->FileSize();
 }
 
+uint64_t CFileSet::SecondaryIndexOnDiskSize() const {
+  uint64_t ret = 0;
+  for (const auto& e : index_readers_by_col_id_) {
+    ret += e.second->file_size();
+  }
+  return ret;
+}
+
 uint64_t CFileSet::OnDiskDataSize() const {
   uint64_t ret = 0;
   for (const auto& e : readers_by_col_id_) {
@@ -314,6 +372,43 @@ Status CFileSet::FindRow(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status CFileSet::CheckRowsMayBePresent(const RowSetKeyProbe* const* probes,
+                                       size_t n,
+                                       const IOContext* io_context,
+                                       bool* maybe_present,
+                                       ProbeStats* const* stats) const {
+  std::fill(maybe_present, maybe_present + n, true);
+  if (!FLAGS_consult_bloom_filters || n == 0) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(bloom_reader_->Init(io_context));
+
+  vector<const BloomKeyProbe*> bloom_probes(n);
+  for (size_t i = 0; i < n; i++) {
+    bloom_probes[i] = &probes[i]->bloom_probe();
+  }
+  Status s = bloom_reader_->CheckKeysPresent(bloom_probes.data(), n, io_context, maybe_present);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 1) << Substitute("Unable to query bloom in $0: $1",
+        rowset_metadata_->bloom_block().ToString(), s.ToString());
+    if (PREDICT_FALSE(s.IsDiskFailure())) {
+      return s;
+    }
+    // The keys will be checked one by one instead.
+    std::fill(maybe_present, maybe_present + n, true);
+    return Status::OK();
+  }
+
+  // The keys which may be present consult the bloom again when they're
+  // checked, so they're only counted then.
+  for (size_t i = 0; i < n; i++) {
+    if (!maybe_present[i]) {
+      stats[i]->blooms_consulted++;
+    }
+  }
+  return Status::OK();
+}
+
 Status CFileSet::CheckRowPresent(const RowSetKeyProbe& probe, const IOContext* io_context,
                                  bool* present, rowid_t* rowid, ProbeStats* stats) const {
   boost::optional<rowid_t> opt_rowid;
@@ -461,11 +556,58 @@ Status CFileSet::Iterator::PushdownRangeScanPredicate(ScanSpec *spec) {
   return Status::OK();
 }
 
+Status CFileSet::Iterator::SeekToKey(const EncodedKey& key, bool* exact) {
+  DCHECK(initted_);
+  DCHECK_EQ(0, prepared_count_);
+  *exact = false;
+  Status s = key_iter_->SeekAtOrAfter(key, exact);
+  if (s.IsNotFound()) {
+    // The key is after the end of the key range.
+    cur_idx_ = row_count_;
+    upper_bound_idx_ = row_count_;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+  cur_idx_ = key_iter_->GetCurrentOrdinal();
+  upper_bound_idx_ = *exact ? cur_idx_ + 1 : cur_idx_;
+  return Status::OK();
+}
+
 void CFileSet::Iterator::Unprepare() {
   prepared_count_ = 0;
   cols_prepared_.assign(col_iters_.size(), false);
 }
 
+Status CFileSet::Iterator::CheckIndexForBatch(ColumnMaterializationContext* ctx,
+                                              bool* answered,
+                                              bool* has_match) {
+  *answered = false;
+  const size_t col_idx = ctx->col_idx();
+  if (index_matches_.empty()) {
+    index_matches_.resize(col_iters_.size());
+    index_unusable_.assign(col_iters_.size(), false);
+  }
+  if (index_unusable_[col_idx]) {
+    return Status::OK();
+  }
+  if (!index_matches_[col_idx]) {
+    CFileReader* reader = base_data_->index_reader_for_col_id(projection_->column_id(col_idx));
+    if (reader == nullptr || !SecondaryIndexSupportsPredicate(*ctx->pred())) {
+      index_unusable_[col_idx] = true;
+      return Status::OK();
+    }
+    unique_ptr<vector<rowid_t>> matches(new vector<rowid_t>());
+    RETURN_NOT_OK(SecondaryIndexLookup(reader, *ctx->pred(), io_context_, matches.get()));
+    index_matches_[col_idx] = std::move(matches);
+  }
+
+  const vector<rowid_t>& matches = *index_matches_[col_idx];
+  auto it = std::lower_bound(matches.begin(), matches.end(), cur_idx_);
+  *has_match = it != matches.end() && *it < cur_idx_ + prepared_count_;
+  *answered = true;
+  return Status::OK();
+}
+
 Status CFileSet::Iterator::PrepareBatch(size_t *n) {
   DCHECK_EQ(prepared_count_, 0) << "Already prepared";
 
@@ -525,9 +667,38 @@ Status CFileSet::Iterator::InitializeSelectionVector(SelectionVector *sel_vec) {
 Status CFileSet::Iterator::MaterializeColumn(ColumnMaterializationContext *ctx) {
   CHECK_EQ(prepared_count_, ctx->block()->nrows());
   DCHECK_LT(ctx->col_idx(), col_iters_.size());
+  ColumnIterator* iter = col_iters_[ctx->col_idx()].get();
+
+  // If the column's zone map shows that no row of this batch can match the
+  // predicate, filter out the whole batch without reading the column. This
+  // is only safe if the predicate may be evaluated as part of the scan
+  // (e.g. not when the column has updates which must be applied first).
+  if (FLAGS_consult_zone_maps && ctx->DecoderEvalNotDisabled() &&
+      !cols_prepared_[ctx->col_idx()]) {
+    bool may_match;
+    RETURN_NOT_OK(iter->RowsMayMatch(cur_idx_, prepared_count_, *ctx->pred(), &may_match));
+    if (!may_match) {
+      ctx->SetDecoderEvalSupported();
+      ctx->sel()->SetAllFalse();
+      return Status::OK();
+    }
+  }
+
+  // Likewise if the column's secondary index shows that the batch holds none
+  // of the rows matching the predicate.
+  if (FLAGS_consult_secondary_indexes && ctx->DecoderEvalNotDisabled() &&
+      !cols_prepared_[ctx->col_idx()]) {
+    bool answered;
+    bool has_match;
+    RETURN_NOT_OK(CheckIndexForBatch(ctx, &answered, &has_match));
+    if (answered && !has_match) {
+      ctx->SetDecoderEvalSupported();
+      ctx->sel()->SetAllFalse();
+      return Status::OK();
+    }
+  }
 
   RETURN_NOT_OK(PrepareColumn(ctx));
-  ColumnIterator* iter = col_iters_[ctx->col_idx()].get();
 
   RETURN_NOT_OK(iter->Scan(ctx));
 
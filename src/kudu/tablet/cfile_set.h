@@ -48,6 +48,7 @@ class optional;
 namespace kudu {
 
 class ColumnMaterializationContext;
+class EncodedKey;
 class MemTracker;
 class ScanSpec;
 class SelectionVector;
@@ -98,8 +99,12 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   // Returns 0 if there are no bloomfiles.
   uint64_t BloomFileOnDiskSize() const;
 
+  // The on-disk size, in bytes, of this cfile set's secondary indexes.
+  // Returns 0 if there are none.
+  uint64_t SecondaryIndexOnDiskSize() const;
+
   // The size on-disk of this cfile set's data, in bytes.
-  // Excludes the ad hoc index and bloomfiles.
+  // Excludes the ad hoc index, bloomfiles and secondary indexes.
   uint64_t OnDiskDataSize() const;
 
   // The size on-disk of column cfile's data, in bytes.
@@ -121,11 +126,26 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   Status CheckRowPresent(const RowSetKeyProbe& probe, const fs::IOContext* io_context,
                          bool* present, rowid_t* rowid, ProbeStats* stats) const;
 
+  // Check the sorted keys of 'probes' against the bloom filter in one batch.
+  // See RowSet::CheckRowsMayBePresent().
+  Status CheckRowsMayBePresent(const RowSetKeyProbe* const* probes,
+                               size_t n,
+                               const fs::IOContext* io_context,
+                               bool* maybe_present,
+                               ProbeStats* const* stats) const;
+
   // Return true if there exists a CFile for the given column ID.
   bool has_data_for_column_id(ColumnId col_id) const {
     return ContainsKey(readers_by_col_id_, col_id);
   }
 
+  // Return the reader of the secondary index of the given column ID, or
+  // null if the column has none in this cfile set.
+  cfile::CFileReader* index_reader_for_col_id(ColumnId col_id) const {
+    const auto* reader = FindOrNull(index_readers_by_col_id_, col_id);
+    return reader ? reader->get() : nullptr;
+  }
+
   virtual ~CFileSet();
 
  private:
@@ -164,6 +184,10 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   typedef boost::container::flat_map<int, std::unique_ptr<cfile::CFileReader>> ReaderMap;
   ReaderMap readers_by_col_id_;
 
+  // Map of column ID to the reader of its secondary index, for the columns
+  // which have one. These are also lazily initialized.
+  ReaderMap index_readers_by_col_id_;
+
   // A file reader for an ad-hoc index, i.e. an index that sits in its own file
   // and is not embedded with the column's data blocks. This is used when the
   // index pertains to more than one column, as in the case of composite keys.
@@ -210,6 +234,13 @@ class CFileSet::Iterator : public ColumnwiseIterator {
     return cur_idx_;
   }
 
+  // Positions the initialized iterator on the row with the given key, so that
+  // it yields only that row, and sets '*exact' to whether there is one. If
+  // there isn't, the iterator has no more rows until the next seek.
+  //
+  // Must be called between batches.
+  Status SeekToKey(const EncodedKey& key, bool* exact);
+
   // Collect the IO statistics for each of the underlying columns.
   virtual void GetIteratorStats(std::vector<IteratorStats> *stats) const OVERRIDE;
 
@@ -239,6 +270,14 @@ class CFileSet::Iterator : public ColumnwiseIterator {
 
   void Unprepare();
 
+  // If the column of 'ctx' has a secondary index which can answer its
+  // predicate, sets '*has_match' to whether the prepared batch holds any of
+  // the matching rows and '*answered' to true. Otherwise, sets '*answered'
+  // to false. The matching rows are looked up once per iterator.
+  Status CheckIndexForBatch(ColumnMaterializationContext* ctx,
+                            bool* answered,
+                            bool* has_match);
+
   // Prepare the given column if not already prepared.
   Status PrepareColumn(ColumnMaterializationContext *ctx);
 
@@ -270,6 +309,12 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // materialized, it doesn't need to be read off disk.
   std::vector<bool> cols_prepared_;
 
+  // The rows matching the predicate on each projected column, as looked up
+  // in the column's secondary index, or null if it wasn't looked up yet.
+  // 'index_unusable_' is set for the columns which can't use an index.
+  std::vector<std::unique_ptr<std::vector<rowid_t>>> index_matches_;
+  std::vector<bool> index_unusable_;
+
 };
 
 } // namespace tablet
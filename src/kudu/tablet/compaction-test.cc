@@ -51,6 +51,7 @@
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/diskrowset.h"
@@ -87,6 +88,8 @@ DEFINE_int32(merge_benchmark_num_rowsets, 3,
 DEFINE_int32(merge_benchmark_num_rows_per_rowset, 500000,
              "Number of rowsets as input to the merge");
 
+DECLARE_bool(compaction_copy_unmutated_runs);
+DECLARE_int32(compaction_output_block_rows);
 DECLARE_string(block_manager);
 
 using std::shared_ptr;
@@ -532,14 +535,79 @@ TEST_F(TestCompaction, TestFlushMRSWithRolling) {
                 "int32 nullable_val=0); Undo Mutations: [@1(DELETE)]; Redo Mutations: [];",
             rows[0]);
 
+  // The second rowset picks up right where the first one stopped.
+  const int first_rowset_rows = rows.size();
   rows.clear();
   rowsets[1]->DebugDump(&rows);
-  EXPECT_EQ(R"(RowIdxInBlock: 0; Base: (string key="hello 00017150", int32 val=1715, )"
-            "int32 nullable_val=NULL); Undo Mutations: [@1716(DELETE)]; Redo Mutations: [];",
-            rows[0]);
-  EXPECT_EQ(R"(RowIdxInBlock: 1; Base: (string key="hello 00017160", int32 val=1716, )"
-            "int32 nullable_val=1716); Undo Mutations: [@1717(DELETE)]; Redo Mutations: [];",
-            rows[1]);
+  ASSERT_GE(rows.size(), 2);
+  for (int i = 0; i < 2; i++) {
+    int val = first_rowset_rows + i;
+    EXPECT_EQ(Substitute(R"(RowIdxInBlock: $0; Base: (string key="$1", int32 val=$2, )"
+                         "int32 nullable_val=$3); Undo Mutations: [@$4(DELETE)]; "
+                         "Redo Mutations: [];",
+                         i, StringPrintf(kRowKeyFormat, val * 10), val,
+                         val % 2 == 0 ? std::to_string(val) : "NULL", val + 1),
+              rows[i]);
+  }
+}
+
+// Test that flushes batching up rows across the leaves of the MemRowSet write
+// the same rows, whatever the size of the batches.
+TEST_F(TestCompaction, TestFlushMRSWithOutputBlockSizes) {
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              mem_trackers_.tablet_tracker, &mrs));
+  InsertRows(mrs.get(), 1000, 0);
+  UpdateRows(mrs.get(), 1000, 0, 1);
+
+  vector<string> expected;
+  for (int block_rows : { 100, 1, 7, 2048 }) {
+    SCOPED_TRACE(block_rows);
+    FLAGS_compaction_output_block_rows = block_rows;
+    shared_ptr<DiskRowSet> rs;
+    NO_FATALS(FlushMRSAndReopenNoRoll(*mrs, schema_, &rs));
+    vector<string> rows;
+    ASSERT_OK(rs->DebugDump(&rows));
+    ASSERT_EQ(1000, rows.size());
+    if (expected.empty()) {
+      expected = rows;
+      continue;
+    }
+    for (int i = 0; i < rows.size(); i++) {
+      ASSERT_EQ(expected[i], rows[i]);
+    }
+  }
+}
+
+// Test that copying the runs of rows without mutations column by column
+// writes the same rows as copying every row by itself.
+TEST_F(TestCompaction, TestFlushMRSCopyingUnmutatedRuns) {
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              mem_trackers_.tablet_tracker, &mrs));
+  InsertRows(mrs.get(), 1000, 0);
+  // Break up the runs with some updated rows.
+  for (int i = 0; i < 1000; i += 7) {
+    UpdateRow(mrs.get(), i * 10, i + 1);
+  }
+
+  vector<string> expected;
+  for (bool copy_runs : { false, true }) {
+    SCOPED_TRACE(copy_runs);
+    FLAGS_compaction_copy_unmutated_runs = copy_runs;
+    shared_ptr<DiskRowSet> rs;
+    NO_FATALS(FlushMRSAndReopenNoRoll(*mrs, schema_, &rs));
+    vector<string> rows;
+    ASSERT_OK(rs->DebugDump(&rows));
+    ASSERT_EQ(1000, rows.size());
+    if (expected.empty()) {
+      expected = rows;
+      continue;
+    }
+    for (int i = 0; i < rows.size(); i++) {
+      ASSERT_EQ(expected[i], rows[i]);
+    }
+  }
 }
 
 TEST_F(TestCompaction, TestRowSetInput) {
@@ -19,7 +19,9 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -27,9 +29,11 @@
 #include <unordered_set>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
@@ -55,8 +59,23 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
 
+DEFINE_int32(compaction_output_block_rows, 100,
+             "Number of rows a flush or a compaction batches up before handing "
+             "them to the column encoders of the output rowset. Larger batches "
+             "amortize the per-batch overhead of the encoders, in particular when "
+             "--tablet_column_write_parallelism is greater than 1.");
+TAG_FLAG(compaction_output_block_rows, experimental);
+
+DEFINE_bool(compaction_copy_unmutated_runs, true,
+            "Whether a flush or a compaction copies runs of consecutive input "
+            "rows without REDO mutations to the output block column by column, "
+            "rather than row by row.");
+TAG_FLAG(compaction_copy_unmutated_runs, advanced);
+TAG_FLAG(compaction_copy_unmutated_runs, experimental);
+
 using kudu::clock::HybridClock;
 using kudu::fs::IOContext;
 using std::deque;
@@ -72,10 +91,6 @@ namespace tablet {
 
 namespace {
 
-// The maximum number of rows we will output at a time during
-// compaction.
-const int kCompactionOutputBlockNumRows = 100;
-
 // Advances to the last mutation in a mutation list.
 void AdvanceToLastInList(const Mutation** m) {
   if (*m == nullptr) return;
@@ -85,6 +100,65 @@ void AdvanceToLastInList(const Mutation** m) {
   }
 }
 
+// Returns the number of rows, starting at rows[start] and up to 'max_rows',
+// which come from consecutive rows of the same input block and which are
+// output unchanged: they have no REDO mutations, no ghosts and aren't
+// expired. Such rows are never garbage collected either, so they end up in
+// consecutive rows of the output block.
+int UnmutatedRunLength(const vector<CompactionInputRow>& rows,
+                       int start,
+                       int max_rows,
+                       const HistoryGcOpts& history_gc_opts) {
+  const RowBlock* block = rows[start].row.row_block();
+  const size_t first_index = rows[start].row.row_index();
+  int len = 0;
+  while (len < max_rows && start + len < rows.size()) {
+    const CompactionInputRow& row = rows[start + len];
+    if (row.row.row_block() != block ||
+        row.row.row_index() != first_index + len ||
+        row.redo_head != nullptr ||
+        row.previous_ghost != nullptr ||
+        history_gc_opts.IsRowExpired(row.row)) {
+      break;
+    }
+    len++;
+  }
+  return len;
+}
+
+// Copies 'count' rows of 'src', starting at 'src_index', to the rows of 'dst'
+// starting at 'dst_index', one column at a time. Indirect data is relocated
+// into 'arena'. This is equivalent to calling CopyRow() on each row, without
+// going through the type of each cell of each row.
+Status CopyRowRun(const RowBlock& src, size_t src_index,
+                  RowBlock* dst, size_t dst_index,
+                  size_t count, Arena* arena) {
+  DCHECK_SCHEMA_EQ(src.schema(), dst->schema());
+  for (size_t c = 0; c < src.schema().num_columns(); c++) {
+    const ColumnBlock src_col = src.column_block(c);
+    ColumnBlock dst_col = dst->column_block(c);
+    memcpy(dst_col.mutable_cell_ptr(dst_index), src_col.cell_ptr(src_index),
+           count * src_col.stride());
+    if (src_col.is_nullable()) {
+      for (size_t i = 0; i < count; i++) {
+        dst_col.SetCellIsNull(dst_index + i, src_col.is_null(src_index + i));
+      }
+    }
+    if (src_col.type_info()->physical_type() == BINARY) {
+      for (size_t i = 0; i < count; i++) {
+        if (dst_col.is_nullable() && dst_col.is_null(dst_index + i)) {
+          continue;
+        }
+        Slice* slice = reinterpret_cast<Slice*>(dst_col.mutable_cell_ptr(dst_index + i));
+        if (PREDICT_FALSE(!arena->RelocateSlice(*slice, slice))) {
+          return Status::IOError("out of memory copying slice", slice->ToString());
+        }
+      }
+    }
+  }
+  return Status::OK();
+}
+
 // CompactionInput yielding rows and mutations from a MemRowSet.
 class MemRowSetCompactionInput : public CompactionInput {
  public:
@@ -1100,20 +1174,40 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
 Status FlushCompactionInput(CompactionInput* input,
                             const MvccSnapshot& snap,
                             const HistoryGcOpts& history_gc_opts,
-                            RollingDiskRowSetWriter* out) {
+                            RollingDiskRowSetWriter* out,
+                            const std::function<bool()>& should_abort) {
   RETURN_NOT_OK(input->Init());
   vector<CompactionInputRow> rows;
 
   DCHECK(out->schema().has_column_ids());
 
-  RowBlock block(out->schema(), kCompactionOutputBlockNumRows, nullptr);
+  // The output block is filled across input blocks so that the writer always
+  // gets full batches, even from inputs with small blocks like the leaves of a
+  // MemRowSet. Since the memory of an input block isn't valid past
+  // FinishBlock(), the rows are copied into the output block's own arena,
+  // which is reset whenever the block is written.
+  Arena block_arena(32 * 1024);
+  RowBlock block(out->schema(), std::max(FLAGS_compaction_output_block_rows, 1),
+                 &block_arena);
+  int n = 0;
 
   while (input->HasMoreBlocks()) {
+    if (should_abort && should_abort()) {
+      return Status::Aborted("compaction was asked to stop");
+    }
     RETURN_NOT_OK(input->PrepareBlock(&rows));
 
-    int n = 0;
+    // The rows before this index were already copied to the output block
+    // by CopyRowRun().
+    int copied_until = 0;
     for (int i = 0; i < rows.size(); i++) {
       CompactionInputRow* input_row = &rows[i];
+      // Expired rows are dropped along with their whole history, including
+      // that of any ghosts of the row.
+      if (history_gc_opts.IsRowExpired(input_row->row)) {
+        DVLOG(4) << "Dropping expired row: " << CompactionInputRowToString(*input_row);
+        continue;
+      }
       RETURN_NOT_OK(out->RollIfNecessary());
 
       const Schema* schema = input_row->row.schema();
@@ -1121,7 +1215,20 @@ Status FlushCompactionInput(CompactionInput* input,
       DCHECK(schema->has_column_ids());
 
       RowBlockRow dst_row = block.row(n);
-      RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, static_cast<Arena*>(nullptr)));
+      if (i >= copied_until) {
+        // Runs of rows which are output unchanged are copied all at once, up
+        // to the end of the output block, since the block's arena is reset
+        // once it's written.
+        int run = FLAGS_compaction_copy_unmutated_runs ?
+            UnmutatedRunLength(rows, i, block.nrows() - n, history_gc_opts) : 0;
+        if (run > 1) {
+          RETURN_NOT_OK(CopyRowRun(*input_row->row.row_block(), input_row->row.row_index(),
+                                   &block, n, run, &block_arena));
+          copied_until = i + run;
+        } else {
+          RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, &block_arena));
+        }
+      }
 
       DVLOG(4) << "Input Row: " << CompactionInputRowToString(*input_row);
 
@@ -1133,7 +1240,7 @@ Status FlushCompactionInput(CompactionInput* input,
                                                    *input_row,
                                                    &new_undos_head,
                                                    &new_redos_head,
-                                                   input->PreparedBlockArena(),
+                                                   &block_arena,
                                                    &dst_row));
 
       // Merge the histories of 'input_row' with previous ghosts, if there are any.
@@ -1173,18 +1280,18 @@ Status FlushCompactionInput(CompactionInput* input,
       n++;
       if (n == block.nrows()) {
         RETURN_NOT_OK(out->AppendBlock(block));
+        block_arena.Reset();
         n = 0;
       }
     }
 
-    if (n > 0) {
-      block.Resize(n);
-      RETURN_NOT_OK(out->AppendBlock(block));
-      block.Resize(block.row_capacity());
-    }
-
     RETURN_NOT_OK(input->FinishBlock());
   }
+
+  if (n > 0) {
+    block.Resize(n);
+    RETURN_NOT_OK(out->AppendBlock(block));
+  }
   return Status::OK();
 }
 
@@ -1235,6 +1342,15 @@ Status ReupdateMissedDeltas(const IOContext* io_context,
     for (const CompactionInputRow &row : rows) {
       DVLOG(4) << "Revisiting row: " << CompactionInputRowToString(row);
 
+      // Expired rows weren't flushed, so there's nothing to carry their
+      // missed deltas over to. Like GCed rows, they must not increment the
+      // output row offset.
+      if (history_gc_opts.IsRowExpired(row.row)) {
+        DVLOG(4) << "Skipping expired input row: " << schema->DebugRow(row.row)
+                 << " while reupdating missed deltas";
+        continue;
+      }
+
       bool is_garbage_collected = false;
       for (const Mutation *mut = row.redo_head;
            mut != nullptr;
@@ -18,6 +18,9 @@
 #define KUDU_TABLET_COMPACTION_H
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -78,10 +81,28 @@ class HistoryGcOpts {
     return ancient_history_mark_;
   }
 
+  // Returns a copy of these options under which the rows whose first primary
+  // key column, of type UNIXTIME_MICROS, is below 'cutoff_micros' have
+  // expired and are garbage collected regardless of their history.
+  HistoryGcOpts WithRowExpiry(int64_t cutoff_micros) const {
+    return HistoryGcOpts(gc_enabled_, ancient_history_mark_, cutoff_micros);
+  }
+
+  // Returns true if the row has expired. If row expiry is enabled, the first
+  // column of the row's schema must be of type UNIXTIME_MICROS.
+  template<class RowType>
+  bool IsRowExpired(const RowType& row) const {
+    return row_expiry_cutoff_micros_ != kNoRowExpiry &&
+        *reinterpret_cast<const int64_t*>(row.cell_ptr(0)) < row_expiry_cutoff_micros_;
+  }
+
  private:
-  HistoryGcOpts(bool gc_enabled, Timestamp ahm)
+  static constexpr int64_t kNoRowExpiry = std::numeric_limits<int64_t>::min();
+
+  HistoryGcOpts(bool gc_enabled, Timestamp ahm, int64_t row_expiry_cutoff_micros = kNoRowExpiry)
       : gc_enabled_(gc_enabled),
-        ancient_history_mark_(ahm) {
+        ancient_history_mark_(ahm),
+        row_expiry_cutoff_micros_(row_expiry_cutoff_micros) {
   }
 
   // Whether historical records prior to the ancient history mark should be
@@ -91,6 +112,10 @@ class HistoryGcOpts {
   // A timestamp prior to which no history will be preserved.
   // Ignored if 'enabled' != GC_ENABLED.
   const Timestamp ancient_history_mark_;
+
+  // Rows with a lower first key column value have expired, or kNoRowExpiry
+  // if rows never expire.
+  const int64_t row_expiry_cutoff_micros_;
 };
 
 // Interface for an input feeding into a compaction or flush.
@@ -228,10 +253,14 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
 //
 // After return of this function, this CompactionInput object is "used up" and will
 // no longer be useful.
+//
+// If 'should_abort' is set, it is polled before each input block, and the flush
+// stops with Status::Aborted as soon as it returns true.
 Status FlushCompactionInput(CompactionInput *input,
                             const MvccSnapshot &snap,
                             const HistoryGcOpts& history_gc_opts,
-                            RollingDiskRowSetWriter *out);
+                            RollingDiskRowSetWriter *out,
+                            const std::function<bool()>& should_abort = nullptr);
 
 // Iterate through this compaction input, finding any mutations which came between
 // snap_to_exclude and snap_to_include (ie those transactions that were not yet
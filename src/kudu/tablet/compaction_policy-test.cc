@@ -16,6 +16,7 @@
 // under the License.
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -27,6 +28,8 @@
 #include <glog/stl_logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
@@ -278,6 +281,93 @@ TEST_F(TestCompactionPolicy, KUDU2251) {
   ASSERT_LT(quality, 2.0);
 }
 
+namespace {
+
+// Time-window compaction policy whose clock is set by the test.
+class TestTimeWindowCompactionPolicy : public TimeWindowCompactionPolicy {
+ public:
+  TestTimeWindowCompactionPolicy(int size_budget_mb, int64_t window_us,
+                                 int64_t seal_age_us, int64_t now)
+      : TimeWindowCompactionPolicy(size_budget_mb, window_us, seal_age_us),
+        now_(now) {
+  }
+
+ protected:
+  int64_t NowMicros() const override {
+    return now_;
+  }
+
+ private:
+  const int64_t now_;
+};
+
+// Returns a rowset whose keys are the timestamps in [min_ts, max_ts].
+std::shared_ptr<RowSet> TimestampRowSet(int64_t min_ts, int64_t max_ts) {
+  faststring min_key;
+  faststring max_key;
+  KeyEncoderTraits<UNIXTIME_MICROS, faststring>::Encode(min_ts, &min_key);
+  KeyEncoderTraits<UNIXTIME_MICROS, faststring>::Encode(max_ts, &max_key);
+  return std::make_shared<MockDiskRowSet>(min_key.ToString(), max_key.ToString());
+}
+
+} // anonymous namespace
+
+// Test that the time-window policy only compacts rowsets of the same window,
+// and that it picks the window whose compaction is the most valuable.
+TEST_F(TestCompactionPolicy, TestTimeWindowSelection) {
+  /*
+   * Windows of 100us:
+   *
+   * [0 ...................... 100) [100 .................... 200)
+   *   [A ---------------- a]          [D ------ d]  [F ---- f]
+   *    [B -------------- b]            [E ---- e]
+   *     [C ------------ c]
+   */
+  const RowSetVector rowsets = {
+    TimestampRowSet(5, 95),
+    TimestampRowSet(10, 90),
+    TimestampRowSet(15, 85),
+    TimestampRowSet(110, 140),
+    TimestampRowSet(115, 135),
+    TimestampRowSet(160, 190),
+  };
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(rowsets));
+
+  // Nothing is sealed: the first window, with three overlapping rowsets, is
+  // picked, and its rowsets aren't compacted with the second window's.
+  {
+    TestTimeWindowCompactionPolicy policy(1000, 100, 0, 1000);
+    unordered_set<RowSet*> picked;
+    double quality = 0.0;
+    ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, /*log=*/nullptr));
+    ASSERT_EQ(unordered_set<RowSet*>({ rowsets[0].get(), rowsets[1].get(),
+                                       rowsets[2].get() }), picked);
+    ASSERT_GT(quality, 0.0);
+  }
+
+  // The first window is sealed: the overlapping rowsets of the second window
+  // are picked.
+  {
+    TestTimeWindowCompactionPolicy policy(1000, 100, 50, 160);
+    unordered_set<RowSet*> picked;
+    double quality = 0.0;
+    ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, /*log=*/nullptr));
+    ASSERT_EQ(unordered_set<RowSet*>({ rowsets[3].get(), rowsets[4].get() }), picked);
+    ASSERT_GT(quality, 0.0);
+  }
+
+  // Both windows are sealed: nothing is picked.
+  {
+    TestTimeWindowCompactionPolicy policy(1000, 100, 50, 300);
+    unordered_set<RowSet*> picked;
+    double quality = 0.0;
+    ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, /*log=*/nullptr));
+    ASSERT_TRUE(picked.empty());
+    ASSERT_EQ(0.0, quality);
+  }
+}
+
 namespace {
 double ComputeAverageRowsetHeight(
     const vector<std::pair<string, string>>& intervals) {
@@ -18,6 +18,9 @@
 #include "kudu/tablet/compaction_policy.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <ostream>
 #include <queue>
 #include <string>
@@ -28,14 +31,24 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_info.h"
+#include "kudu/tablet/rowset_tree.h"
 #include "kudu/tablet/svg_dump.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/knapsack_solver.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+using std::map;
+using std::string;
+using std::unordered_set;
 using std::vector;
 
 DEFINE_int32(budgeted_compaction_target_rowset_size, 32*1024*1024,
@@ -476,5 +489,106 @@ Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
   return Status::OK();
 }
 
+////////////////////////////////////////////////////////////
+// TimeWindowCompactionPolicy
+////////////////////////////////////////////////////////////
+
+TimeWindowCompactionPolicy::TimeWindowCompactionPolicy(int size_budget_mb,
+                                                       int64_t window_us,
+                                                       int64_t seal_age_us)
+  : window_policy_(size_budget_mb),
+    window_us_(window_us),
+    seal_age_us_(seal_age_us) {
+  CHECK_GT(window_us, 0);
+  CHECK_GE(seal_age_us, 0);
+}
+
+uint64_t TimeWindowCompactionPolicy::target_rowset_size() const {
+  return window_policy_.target_rowset_size();
+}
+
+int64_t TimeWindowCompactionPolicy::NowMicros() const {
+  return GetCurrentTimeMicros();
+}
+
+Status TimeWindowCompactionPolicy::PickRowSets(const RowSetTree &tree,
+                                               unordered_set<RowSet*>* picked,
+                                               double* quality,
+                                               vector<string>* log) {
+  picked->clear();
+  *quality = 0;
+
+  // Group the rowsets by the window of the timestamp of their first key.
+  struct Window {
+    RowSetVector rowsets;
+    uint64_t size = 0;
+  };
+  map<int64_t, Window> windows;
+  uint64_t total_size = 0;
+  for (const auto& rs : tree.all_rowsets()) {
+    string min_key, max_key;
+    if (!rs->GetBounds(&min_key, &max_key).ok()) {
+      continue;
+    }
+    Slice encoded(min_key);
+    int64_t ts;
+    if (!KeyEncoderTraits<UNIXTIME_MICROS, faststring>::DecodeKeyPortion(
+            &encoded, false, nullptr, reinterpret_cast<uint8_t*>(&ts)).ok()) {
+      continue;
+    }
+    // Round towards negative infinity, so that timestamps before the epoch
+    // fall in the right window.
+    int64_t window_start = ts - ts % window_us_;
+    if (ts % window_us_ < 0) {
+      window_start -= window_us_;
+    }
+    Window* window = &windows[window_start];
+    window->rowsets.push_back(rs);
+    window->size += rs->OnDiskBaseDataSize();
+    total_size += rs->OnDiskBaseDataSize();
+  }
+
+  const int64_t now = NowMicros();
+  for (const auto& e : windows) {
+    const int64_t window_start = e.first;
+    const Window& window = e.second;
+    if (window.rowsets.size() < 2) {
+      continue;
+    }
+    if (seal_age_us_ > 0 && window_start <= now - seal_age_us_ - window_us_) {
+      if (log) {
+        LOG_STRING(INFO, log) << "Skipping " << window.rowsets.size()
+                              << " rowsets of sealed window starting at " << window_start;
+      }
+      continue;
+    }
+
+    RowSetTree window_tree;
+    RETURN_NOT_OK(window_tree.Reset(window.rowsets));
+    unordered_set<RowSet*> window_picked;
+    double window_quality = 0;
+    if (log) {
+      LOG_STRING(INFO, log) << "Window starting at " << window_start << ":";
+    }
+    RETURN_NOT_OK(window_policy_.PickRowSets(window_tree, &window_picked,
+                                             &window_quality, log));
+    if (window_picked.empty()) {
+      continue;
+    }
+
+    // The window's quality is the reduction of the average height of the
+    // rowsets over the window's key range. Scale it by the window's share of
+    // the tablet's data, which gives the reduction over the whole tablet.
+    if (total_size > 0) {
+      window_quality *= static_cast<double>(window.size) / total_size;
+    }
+    if (window_quality > *quality) {
+      *quality = window_quality;
+      picked->swap(window_picked);
+    }
+  }
+  return Status::OK();
+}
+
 } // namespace tablet
 } // namespace kudu
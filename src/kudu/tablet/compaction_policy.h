@@ -127,6 +127,42 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
   size_t size_budget_mb_;
 };
 
+// Compaction policy for tables whose primary key starts with a
+// UNIXTIME_MICROS column, e.g. time series whose rows are mostly inserted
+// in timestamp order.
+//
+// Rowsets are grouped into time windows of 'window_us' microseconds by the
+// timestamp of their first key, and only rowsets of the same window are
+// compacted together, as chosen by a BudgetedCompactionPolicy limited to
+// that window. The window with the most valuable compaction is picked.
+// Windows which ended more than 'seal_age_us' microseconds ago are sealed:
+// they are never compacted again, even if rows were inserted into them
+// late. If 'seal_age_us' is 0, windows are never sealed.
+//
+// Since old windows aren't merged with newer ones, the rowsets holding
+// stable data are not rewritten over and over as new data arrives.
+class TimeWindowCompactionPolicy : public CompactionPolicy {
+ public:
+  TimeWindowCompactionPolicy(int size_budget_mb, int64_t window_us, int64_t seal_age_us);
+
+  virtual Status PickRowSets(const RowSetTree &tree,
+                             std::unordered_set<RowSet*>* picked,
+                             double* quality,
+                             std::vector<std::string>* log) OVERRIDE;
+
+  virtual uint64_t target_rowset_size() const OVERRIDE;
+
+ protected:
+  // Returns the current time, in microseconds since the Unix epoch, against
+  // which windows are sealed. Overridden in tests.
+  virtual int64_t NowMicros() const;
+
+ private:
+  BudgetedCompactionPolicy window_policy_;
+  const int64_t window_us_;
+  const int64_t seal_age_us_;
+};
+
 } // namespace tablet
 } // namespace kudu
 #endif
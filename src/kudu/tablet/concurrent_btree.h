@@ -82,6 +82,14 @@ struct BTreeTraits {
     // Number of bytes used by a leaf node.
     kLeafNodeSize = 4 * CACHELINE_SIZE,
 
+    // Number of bytes used to store each key within a node. Keys which are
+    // shorter than this are stored inline. Longer keys are copied into the
+    // arena, and the node stores a pointer to the copy followed by as much
+    // of the key's prefix as fits, so that most comparisons made while
+    // searching a node don't have to follow the pointer. Must be at least
+    // the size of a pointer.
+    kKeySliceSize = sizeof(void*),
+
     // Tests can set this trait to a non-zero value, which inserts
     // some pause-loops in key parts of the code to try to simulate
     // races.
@@ -321,9 +329,7 @@ size_t FindInSliceArray(const InlineSlice<N, true> *array, ssize_t num_entries,
 
   while (left < right) {
     int mid = (left + right + 1) / 2;
-    // TODO: inline slices with more than 8 bytes will store a prefix of the
-    // slice inline, which we could use to short circuit some of these comparisons.
-    int compare = array[mid].as_slice().compare(key);
+    int compare = array[mid].compare(key);
     if (compare < 0) { // mid < key
       left = mid;
     } else if (compare > 0) { // mid > search
@@ -334,7 +340,7 @@ size_t FindInSliceArray(const InlineSlice<N, true> *array, ssize_t num_entries,
     }
   }
 
-  int compare = array[left].as_slice().compare(key);
+  int compare = array[left].compare(key);
   *exact = compare == 0;
   if (compare < 0) { // key > left
     left++;
@@ -651,7 +657,7 @@ class PACKED InternalNode : public NodeBase<Traits> {
     return num_children_ - 1;
   }
 
-  typedef InlineSlice<sizeof(void*), true> KeyInlineSlice;
+  typedef InlineSlice<Traits::kKeySliceSize, true> KeyInlineSlice;
 
   enum SpaceConstants {
     constant_overhead = sizeof(NodeBase<Traits>) // base class
@@ -800,7 +806,7 @@ class LeafNode : public NodeBase<Traits> {
   friend class InternalNode<Traits>;
   friend class CBTreeIterator<Traits>;
 
-  typedef InlineSlice<sizeof(void*), true> KeyInlineSlice;
+  typedef InlineSlice<Traits::kKeySliceSize, true> KeyInlineSlice;
 
   // It is necessary to name this enum so that DCHECKs can use its
   // constants (the macros may attempt to specialize templates
@@ -25,7 +25,16 @@
 #include <glog/logging.h>
 
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/tablet/delta_store.h"
+#include "kudu/tablet/mutation.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 using std::shared_ptr;
@@ -35,18 +44,38 @@ using std::unique_ptr;
 namespace kudu {
 
 class ScanSpec;
-class Schema;
-class SelectionVector;
-struct IteratorStats;
 
 namespace tablet {
 
   // Construct. The base_iter and delta_iter should not be Initted.
-DeltaApplier::DeltaApplier(shared_ptr<CFileSet::Iterator> base_iter,
-                           unique_ptr<DeltaIterator> delta_iter)
-    : base_iter_(std::move(base_iter)),
+DeltaApplier::DeltaApplier(RowIteratorOptions opts,
+                           shared_ptr<CFileSet::Iterator> base_iter,
+                           unique_ptr<DeltaIterator> delta_iter,
+                           unique_ptr<DeltaIterator> undo_window_iter,
+                           unique_ptr<DeltaIterator> redo_window_iter)
+    : opts_(std::move(opts)),
+      base_iter_(std::move(base_iter)),
       delta_iter_(std::move(delta_iter)),
-      first_prepare_(true) {}
+      undo_window_iter_(std::move(undo_window_iter)),
+      redo_window_iter_(std::move(redo_window_iter)),
+      prepared_rows_(0),
+      is_deleted_col_idx_(Schema::kColumnNotFound),
+      window_arena_(1024),
+      delta_apply_nanos_(base_iter_->schema().num_columns(), 0),
+      delta_updates_applied_(base_iter_->schema().num_columns(), 0),
+      first_prepare_(true) {
+  DCHECK_EQ(static_cast<bool>(undo_window_iter_), static_cast<bool>(opts_.snap_to_exclude));
+  DCHECK_EQ(static_cast<bool>(redo_window_iter_), static_cast<bool>(opts_.snap_to_exclude));
+  if (opts_.include_deleted_rows) {
+    const Schema& projection = base_iter_->schema();
+    for (int i = 0; i < projection.num_columns(); i++) {
+      if (projection.column(i).type_info()->type() == IS_DELETED) {
+        is_deleted_col_idx_ = i;
+        break;
+      }
+    }
+  }
+}
 
 DeltaApplier::~DeltaApplier() {
 }
@@ -54,6 +83,10 @@ DeltaApplier::~DeltaApplier() {
 Status DeltaApplier::Init(ScanSpec *spec) {
   RETURN_NOT_OK(base_iter_->Init(spec));
   RETURN_NOT_OK(delta_iter_->Init(spec));
+  if (undo_window_iter_) {
+    RETURN_NOT_OK(undo_window_iter_->Init(spec));
+    RETURN_NOT_OK(redo_window_iter_->Init(spec));
+  }
   return Status::OK();
 }
 
@@ -73,23 +106,55 @@ const Schema &DeltaApplier::schema() const {
 }
 
 void DeltaApplier::GetIteratorStats(std::vector<IteratorStats>* stats) const {
-  return base_iter_->GetIteratorStats(stats);
+  base_iter_->GetIteratorStats(stats);
+  DCHECK_EQ(stats->size(), delta_apply_nanos_.size());
+  ANNOTATE_IGNORE_READS_BEGIN();
+  for (int i = 0; i < delta_apply_nanos_.size(); i++) {
+    (*stats)[i].delta_apply_nanos += delta_apply_nanos_[i];
+    (*stats)[i].delta_updates_applied += delta_updates_applied_[i];
+  }
+  ANNOTATE_IGNORE_READS_END();
 }
 
 bool DeltaApplier::HasNext() const {
   return base_iter_->HasNext();
 }
 
+Status DeltaApplier::SeekToKey(const EncodedKey& key, bool* exact) {
+  RETURN_NOT_OK(base_iter_->SeekToKey(key, exact));
+  if (!*exact) {
+    return Status::OK();
+  }
+  const rowid_t row = base_iter_->cur_ordinal_idx();
+  RETURN_NOT_OK(delta_iter_->SeekToOrdinal(row));
+  if (undo_window_iter_) {
+    RETURN_NOT_OK(undo_window_iter_->SeekToOrdinal(row));
+    RETURN_NOT_OK(redo_window_iter_->SeekToOrdinal(row));
+  }
+  first_prepare_ = false;
+  return Status::OK();
+}
+
 Status DeltaApplier::PrepareBatch(size_t *nrows) {
   // The initial seek is deferred from Init() into the first PrepareBatch()
   // because it requires a loaded delta file, and we don't want to require
   // that at Init() time.
   if (first_prepare_) {
-    RETURN_NOT_OK(delta_iter_->SeekToOrdinal(base_iter_->cur_ordinal_idx()));
+    const rowid_t first_row = base_iter_->cur_ordinal_idx();
+    RETURN_NOT_OK(delta_iter_->SeekToOrdinal(first_row));
+    if (undo_window_iter_) {
+      RETURN_NOT_OK(undo_window_iter_->SeekToOrdinal(first_row));
+      RETURN_NOT_OK(redo_window_iter_->SeekToOrdinal(first_row));
+    }
     first_prepare_ = false;
   }
   RETURN_NOT_OK(base_iter_->PrepareBatch(nrows));
   RETURN_NOT_OK(delta_iter_->PrepareBatch(*nrows, DeltaIterator::PREPARE_FOR_APPLY));
+  if (undo_window_iter_) {
+    RETURN_NOT_OK(undo_window_iter_->PrepareBatch(*nrows, DeltaIterator::PREPARE_FOR_COLLECT));
+    RETURN_NOT_OK(redo_window_iter_->PrepareBatch(*nrows, DeltaIterator::PREPARE_FOR_COLLECT));
+  }
+  prepared_rows_ = *nrows;
   return Status::OK();
 }
 
@@ -100,16 +165,77 @@ Status DeltaApplier::FinishBatch() {
 Status DeltaApplier::InitializeSelectionVector(SelectionVector *sel_vec) {
   DCHECK(!first_prepare_) << "PrepareBatch() must be called at least once";
   RETURN_NOT_OK(base_iter_->InitializeSelectionVector(sel_vec));
-  return delta_iter_->ApplyDeletes(sel_vec);
+  if (!opts_.include_deleted_rows) {
+    RETURN_NOT_OK(delta_iter_->ApplyDeletes(sel_vec));
+  } else {
+    // Keep the deleted rows selected, but remember which they are.
+    SelectionVector live_rows(prepared_rows_);
+    memcpy(live_rows.mutable_bitmap(), sel_vec->bitmap(), BitmapSize(prepared_rows_));
+    RETURN_NOT_OK(delta_iter_->ApplyDeletes(&live_rows));
+    deleted_rows_.reset(new SelectionVector(prepared_rows_));
+    deleted_rows_->SetAllFalse();
+    for (size_t i = 0; i < prepared_rows_; i++) {
+      if (sel_vec->IsRowSelected(i) && !live_rows.IsRowSelected(i)) {
+        deleted_rows_->SetRowSelected(i);
+      }
+    }
+  }
+  if (undo_window_iter_) {
+    RETURN_NOT_OK(UnselectUnchangedRows(sel_vec));
+  }
+  return Status::OK();
+}
+
+Status DeltaApplier::UnselectUnchangedRows(SelectionVector* sel_vec) {
+  window_arena_.Reset();
+  window_mutations_.assign(prepared_rows_, nullptr);
+  RETURN_NOT_OK(undo_window_iter_->CollectMutations(&window_mutations_, &window_arena_));
+  RETURN_NOT_OK(redo_window_iter_->CollectMutations(&window_mutations_, &window_arena_));
+
+  // The UNDOs of a rowset include the insertion of each of its rows, so a
+  // row without any mutation between the snapshots didn't change then.
+  const MvccSnapshot& start = *opts_.snap_to_exclude;
+  const MvccSnapshot& end = opts_.snap_to_include;
+  for (size_t i = 0; i < prepared_rows_; i++) {
+    if (!sel_vec->IsRowSelected(i)) {
+      continue;
+    }
+    bool changed = false;
+    for (const Mutation* mut = window_mutations_[i]; mut != nullptr; mut = mut->next()) {
+      if (end.IsCommitted(mut->timestamp()) && !start.IsCommitted(mut->timestamp())) {
+        changed = true;
+        break;
+      }
+    }
+    if (!changed) {
+      sel_vec->SetRowUnselected(i);
+    }
+  }
+  return Status::OK();
 }
 
 Status DeltaApplier::MaterializeColumn(ColumnMaterializationContext *ctx) {
   DCHECK(!first_prepare_) << "PrepareBatch() must be called at least once";
+  if (static_cast<int>(ctx->col_idx()) == is_deleted_col_idx_) {
+    // The virtual column has no data of its own: report the deleted rows.
+    DCHECK(deleted_rows_);
+    ctx->SetDecoderEvalNotSupported();
+    ColumnBlock* dst = ctx->block();
+    for (size_t i = 0; i < dst->nrows(); i++) {
+      bool deleted = deleted_rows_->IsRowSelected(i);
+      dst->SetCellValue(i, &deleted);
+    }
+    return Status::OK();
+  }
   // Data with updates cannot be evaluated at the decoder-level.
   if (delta_iter_->MayHaveDeltas()) {
     ctx->SetDecoderEvalNotSupported();
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
+    const MonoTime apply_start = MonoTime::Now();
+    const int64_t updates_before = delta_iter_->updates_applied();
     RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block()));
+    delta_apply_nanos_[ctx->col_idx()] += (MonoTime::Now() - apply_start).ToNanoseconds();
+    delta_updates_applied_[ctx->col_idx()] += delta_iter_->updates_applied() - updates_before;
   } else {
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
   }
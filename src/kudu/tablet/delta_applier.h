@@ -18,6 +18,7 @@
 #define KUDU_TABLET_DELTA_APPLIER_H
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <vector>
@@ -25,22 +26,26 @@
 #include <gtest/gtest_prod.h>
 
 #include "kudu/common/iterator.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/cfile_set.h"
+#include "kudu/tablet/rowset.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
 class ColumnMaterializationContext;
+class EncodedKey;
 class ScanSpec;
 class Schema;
-class SelectionVector;
 struct IteratorStats;
 
 namespace tablet {
 
 class DeltaIterator;
+class Mutation;
 
 ////////////////////////////////////////////////////////////
 // Delta-applying iterators
@@ -49,6 +54,11 @@ class DeltaIterator;
 // A DeltaApplier takes in a base ColumnwiseIterator along with a a
 // DeltaIterator. It is responsible for applying the updates coming
 // from the delta iterator to the results of the base iterator.
+//
+// In a diff scan (see RowIteratorOptions::snap_to_exclude), the DeltaApplier
+// also selects only the rows with a mutation between the scan's snapshots,
+// which it finds by collecting the mutations of a second pair of delta
+// iterators over the UNDOs and REDOs.
 class DeltaApplier : public ColumnwiseIterator {
  public:
   virtual Status Init(ScanSpec *spec) OVERRIDE;
@@ -65,11 +75,17 @@ class DeltaApplier : public ColumnwiseIterator {
   virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
   // Initialize the selection vector for the current batch.
-  // This processes DELETEs -- any deleted rows are set to 0 in 'sel_vec'.
+  // This processes DELETEs -- any deleted rows are set to 0 in 'sel_vec',
+  // unless the iterator includes deleted rows. In diff scans, the rows
+  // without mutations between the snapshots are set to 0 as well.
   // All other rows are set to 1.
   virtual Status InitializeSelectionVector(SelectionVector *sel_vec) OVERRIDE;
 
   Status MaterializeColumn(ColumnMaterializationContext *ctx) override;
+
+  // Positions the initialized iterator on the row with the given key. See
+  // CFileSet::Iterator::SeekToKey().
+  Status SeekToKey(const EncodedKey& key, bool* exact);
  private:
   friend class DeltaTracker;
 
@@ -78,13 +94,50 @@ class DeltaApplier : public ColumnwiseIterator {
   DISALLOW_COPY_AND_ASSIGN(DeltaApplier);
 
   // Construct. The base_iter and delta_iter should not be Initted.
-  DeltaApplier(std::shared_ptr<CFileSet::Iterator> base_iter,
-               std::unique_ptr<DeltaIterator> delta_iter);
+  //
+  // For diff scans, 'undo_window_iter' must collect all the UNDOs, and
+  // 'redo_window_iter' the REDOs committed in 'opts.snap_to_include'.
+  DeltaApplier(RowIteratorOptions opts,
+               std::shared_ptr<CFileSet::Iterator> base_iter,
+               std::unique_ptr<DeltaIterator> delta_iter,
+               std::unique_ptr<DeltaIterator> undo_window_iter = nullptr,
+               std::unique_ptr<DeltaIterator> redo_window_iter = nullptr);
   virtual ~DeltaApplier();
 
+  // Unselects the rows of the current batch in 'sel_vec' which have no
+  // mutation committed in opts_.snap_to_include but not in
+  // opts_.snap_to_exclude.
+  Status UnselectUnchangedRows(SelectionVector* sel_vec);
+
+  const RowIteratorOptions opts_;
+
   std::shared_ptr<CFileSet::Iterator> base_iter_;
   std::unique_ptr<DeltaIterator> delta_iter_;
 
+  // Set in diff scans only.
+  std::unique_ptr<DeltaIterator> undo_window_iter_;
+  std::unique_ptr<DeltaIterator> redo_window_iter_;
+
+  // The size of the current batch.
+  size_t prepared_rows_;
+
+  // If the iterator includes deleted rows, the rows of the current batch
+  // which are deleted, and the index of the IS_DELETED virtual column in the
+  // projection which reports them, if any.
+  std::unique_ptr<SelectionVector> deleted_rows_;
+  int is_deleted_col_idx_;
+
+  // Holds the mutations collected by the window iterators for a batch.
+  std::vector<Mutation*> window_mutations_;
+  Arena window_arena_;
+
+  // The time spent applying updates to each column of the projection, which
+  // is added to the stats of the base iterator.
+  std::vector<int64_t> delta_apply_nanos_;
+
+  // The number of cell updates applied to each column of the projection.
+  std::vector<int64_t> delta_updates_applied_;
+
   bool first_prepare_;
 };
 
@@ -26,6 +26,7 @@
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
@@ -81,7 +82,8 @@ MajorDeltaCompaction::MajorDeltaCompaction(
     vector<shared_ptr<DeltaStore> > included_stores,
     vector<ColumnId> col_ids,
     HistoryGcOpts history_gc_opts,
-    string tablet_id)
+    string tablet_id,
+    string table_id)
     : fs_manager_(fs_manager),
       base_schema_(base_schema),
       column_ids_(std::move(col_ids)),
@@ -90,6 +92,7 @@ MajorDeltaCompaction::MajorDeltaCompaction(
       included_stores_(std::move(included_stores)),
       delta_iter_(std::move(delta_iter)),
       tablet_id_(std::move(tablet_id)),
+      table_id_(std::move(table_id)),
       redo_delta_mutations_written_(0),
       undo_delta_mutations_written_(0),
       state_(kInitialized) {
@@ -267,7 +270,8 @@ Status MajorDeltaCompaction::OpenBaseDataWriter() {
 
   gscoped_ptr<MultiColumnWriter> w(new MultiColumnWriter(fs_manager_,
                                                          &partial_schema_,
-                                                         tablet_id_));
+                                                         tablet_id_,
+                                                         table_id_));
   RETURN_NOT_OK(w->Open());
   base_data_writer_.swap(w);
   return Status::OK();
@@ -362,6 +366,12 @@ void MajorDeltaCompaction::CreateMetadataUpdate(
   // Replace old column blocks with new ones
   std::map<ColumnId, BlockId> new_column_blocks;
   base_data_writer_->GetFlushedBlocksByColumnId(&new_column_blocks);
+  std::map<ColumnId, cfile::ZoneMapEntryPB> new_column_stats;
+  base_data_writer_->GetFlushedColumnStatsByColumnId(&new_column_stats);
+  std::map<ColumnId, BlockId> new_index_blocks;
+  base_data_writer_->GetFlushedIndexBlocksByColumnId(&new_index_blocks);
+  std::map<ColumnId, ColumnBlockRange> new_ranges;
+  base_data_writer_->GetFlushedBlockRangesByColumnId(&new_ranges);
 
   // NOTE: in the case that one of the columns being compacted is deleted,
   // we may have fewer elements in new_column_blocks compared to 'column_ids'.
@@ -372,6 +382,18 @@ void MajorDeltaCompaction::CreateMetadataUpdate(
     BlockId new_block;
     if (FindCopy(new_column_blocks, col_id, &new_block)) {
       update->ReplaceColumnId(col_id, new_block);
+      const cfile::ZoneMapEntryPB* stats = FindOrNull(new_column_stats, col_id);
+      if (stats != nullptr) {
+        update->SetReplacedColumnStats(col_id, *stats);
+      }
+      BlockId index_block;
+      if (FindCopy(new_index_blocks, col_id, &index_block)) {
+        update->SetReplacedColumnIndex(col_id, index_block);
+      }
+      const ColumnBlockRange* range = FindOrNull(new_ranges, col_id);
+      if (range != nullptr) {
+        update->SetReplacedColumnRange(col_id, *range);
+      }
     } else {
       // The column has been deleted.
       // If the base data has a block for this column, we need to remove it.
@@ -64,7 +64,8 @@ class MajorDeltaCompaction {
       std::vector<std::shared_ptr<DeltaStore> > included_stores,
       std::vector<ColumnId> col_ids,
       HistoryGcOpts history_gc_opts,
-      std::string tablet_id);
+      std::string tablet_id,
+      std::string table_id);
   ~MajorDeltaCompaction();
 
   // Executes the compaction.
@@ -125,8 +126,9 @@ class MajorDeltaCompaction {
   // The merged view of the deltas from included_stores_.
   const std::unique_ptr<DeltaIterator> delta_iter_;
 
-  // The ID of the tablet being compacted.
+  // The ID of the tablet being compacted, and of its table.
   const std::string tablet_id_;
+  const std::string table_id_;
 
   // Outputs:
   gscoped_ptr<MultiColumnWriter> base_data_writer_;
@@ -71,6 +71,14 @@ Status DeltaIteratorMerger::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst)
   return Status::OK();
 }
 
+int64_t DeltaIteratorMerger::updates_applied() const {
+  int64_t total = 0;
+  for (const unique_ptr<DeltaIterator> &iter : iters_) {
+    total += iter->updates_applied();
+  }
+  return total;
+}
+
 Status DeltaIteratorMerger::ApplyDeletes(SelectionVector *sel_vec) {
   for (const unique_ptr<DeltaIterator> &iter : iters_) {
     RETURN_NOT_OK(iter->ApplyDeletes(sel_vec));
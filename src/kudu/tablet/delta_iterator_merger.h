@@ -68,6 +68,7 @@ class DeltaIteratorMerger : public DeltaIterator {
                                                  Arena* arena) OVERRIDE;
   virtual bool HasNext() OVERRIDE;
   bool MayHaveDeltas() override;
+  int64_t updates_applied() const override;
   virtual std::string ToString() const OVERRIDE;
 
  private:
@@ -19,18 +19,24 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 
 #include <glog/logging.h>
 
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/deltafile.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/memory/arena.h"
 
 namespace kudu {
@@ -51,6 +57,108 @@ string DeltaKeyAndUpdate::Stringify(DeltaType type, const Schema& schema, bool p
                                                  key.timestamp().ToString()))));
 }
 
+void AddColumnUpdate(const ColumnSchema& col_schema, rowid_t row_id,
+                     const void* new_val, UpdatesForColumn* updates) {
+  // If we already have an earlier update for the same row, we can
+  // just overwrite that one.
+  if (updates->empty() || updates->back().row_id != row_id) {
+    updates->emplace_back();
+  }
+
+  ColumnUpdate& cu = updates->back();
+  cu.row_id = row_id;
+  if (new_val == nullptr) {
+    cu.new_val_ptr = nullptr;
+  } else {
+    size_t col_size = col_schema.type_info()->size();
+    DCHECK_LE(col_size, sizeof(cu.new_val_buf));
+    memcpy(cu.new_val_buf, new_val, col_size);
+    // NOTE: we're constructing a pointer here to an element inside the deque.
+    // This is safe because deques never invalidate pointers to their elements.
+    cu.new_val_ptr = cu.new_val_buf;
+  }
+}
+
+namespace {
+
+template<DataType PhysicalType, bool kNullable>
+Status ApplyColumnUpdatesForType(const UpdatesForColumn& updates,
+                                 rowid_t first_row_id,
+                                 ColumnBlock* dst) {
+  typedef typename DataTypeTraits<PhysicalType>::cpp_type CppType;
+  CppType* dst_cells = reinterpret_cast<CppType*>(dst->data());
+  uint8_t* null_bitmap = dst->null_bitmap();
+  Arena* arena = dst->arena();
+
+  for (const ColumnUpdate& cu : updates) {
+    size_t idx = cu.row_id - first_row_id;
+    DCHECK_LT(idx, dst->nrows());
+    if (kNullable) {
+      BitmapChange(null_bitmap, idx, cu.new_val_ptr != nullptr);
+      if (cu.new_val_ptr == nullptr) continue;
+    } else {
+      DCHECK(cu.new_val_ptr != nullptr);
+    }
+
+    if (PhysicalType == BINARY) {
+      const Slice* src_slice = reinterpret_cast<const Slice*>(cu.new_val_ptr);
+      Slice* dst_slice = reinterpret_cast<Slice*>(&dst_cells[idx]);
+      if (arena != nullptr) {
+        if (PREDICT_FALSE(!arena->RelocateSlice(*src_slice, dst_slice))) {
+          return Status::IOError("out of memory copying slice", src_slice->ToString());
+        }
+      } else {
+        *dst_slice = *src_slice;
+      }
+    } else {
+      memcpy(&dst_cells[idx], cu.new_val_ptr, sizeof(CppType));
+    }
+  }
+  return Status::OK();
+}
+
+template<DataType PhysicalType>
+Status ApplyColumnUpdatesForType(const ColumnSchema& col_schema,
+                                 const UpdatesForColumn& updates,
+                                 rowid_t first_row_id,
+                                 ColumnBlock* dst) {
+  if (col_schema.is_nullable()) {
+    return ApplyColumnUpdatesForType<PhysicalType, true>(updates, first_row_id, dst);
+  }
+  return ApplyColumnUpdatesForType<PhysicalType, false>(updates, first_row_id, dst);
+}
+
+} // anonymous namespace
+
+Status ApplyColumnUpdates(const ColumnSchema& col_schema,
+                          const UpdatesForColumn& updates,
+                          rowid_t first_row_id,
+                          ColumnBlock* dst) {
+  DCHECK_EQ(col_schema.is_nullable(), dst->is_nullable());
+  DCHECK_EQ(col_schema.type_info()->physical_type(), dst->type_info()->physical_type());
+  if (updates.empty()) {
+    return Status::OK();
+  }
+
+  switch (col_schema.type_info()->physical_type()) {
+    case BOOL: return ApplyColumnUpdatesForType<BOOL>(col_schema, updates, first_row_id, dst);
+    case INT8: return ApplyColumnUpdatesForType<INT8>(col_schema, updates, first_row_id, dst);
+    case INT16: return ApplyColumnUpdatesForType<INT16>(col_schema, updates, first_row_id, dst);
+    case INT32: return ApplyColumnUpdatesForType<INT32>(col_schema, updates, first_row_id, dst);
+    case INT64: return ApplyColumnUpdatesForType<INT64>(col_schema, updates, first_row_id, dst);
+    case INT128: return ApplyColumnUpdatesForType<INT128>(col_schema, updates, first_row_id, dst);
+    case UINT8: return ApplyColumnUpdatesForType<UINT8>(col_schema, updates, first_row_id, dst);
+    case UINT16: return ApplyColumnUpdatesForType<UINT16>(col_schema, updates, first_row_id, dst);
+    case UINT32: return ApplyColumnUpdatesForType<UINT32>(col_schema, updates, first_row_id, dst);
+    case UINT64: return ApplyColumnUpdatesForType<UINT64>(col_schema, updates, first_row_id, dst);
+    case FLOAT: return ApplyColumnUpdatesForType<FLOAT>(col_schema, updates, first_row_id, dst);
+    case DOUBLE: return ApplyColumnUpdatesForType<DOUBLE>(col_schema, updates, first_row_id, dst);
+    case BINARY: return ApplyColumnUpdatesForType<BINARY>(col_schema, updates, first_row_id, dst);
+    default:
+      return Status::InvalidArgument("unsupported column type", col_schema.ToString());
+  }
+}
+
 Status DebugDumpDeltaIterator(DeltaType type,
                               DeltaIterator* iter,
                               const Schema& schema,
@@ -92,10 +200,16 @@ Status DebugDumpDeltaIterator(DeltaType type,
   return Status::OK();
 }
 
-template<DeltaType Type>
-Status WriteDeltaIteratorToFile(DeltaIterator* iter,
-                                size_t nrows,
-                                DeltaFileWriter* out) {
+namespace {
+
+// Writes the deltas of 'iter' for which 'keep' returns true to 'out', and
+// returns their number in 'deltas_written'. See WriteDeltaIteratorToFile().
+template<DeltaType Type, class KeepFunc>
+Status WriteFilteredDeltaIteratorToFile(DeltaIterator* iter,
+                                        size_t nrows,
+                                        const KeepFunc& keep,
+                                        DeltaFileWriter* out,
+                                        int64_t* deltas_written) {
   ScanSpec spec;
   spec.set_cache_blocks(false);
   RETURN_NOT_OK(iter->Init(&spec));
@@ -103,6 +217,7 @@ Status WriteDeltaIteratorToFile(DeltaIterator* iter,
 
   const size_t kRowsPerBlock = 100;
   DeltaStats stats;
+  int64_t written = 0;
   Arena arena(32 * 1024);
   for (size_t i = 0; iter->HasNext(); ) {
     size_t n;
@@ -123,17 +238,44 @@ Status WriteDeltaIteratorToFile(DeltaIterator* iter,
                                                         &cells,
                                                         &arena));
     for (const DeltaKeyAndUpdate& cell : cells) {
+      if (!keep(cell.key)) {
+        continue;
+      }
       RowChangeList rcl(cell.cell);
       RETURN_NOT_OK(out->AppendDelta<Type>(cell.key, rcl));
       RETURN_NOT_OK(stats.UpdateStats(cell.key.timestamp(), rcl));
+      written++;
     }
 
     i += n;
   }
   out->WriteDeltaStats(stats);
+  *deltas_written = written;
   return Status::OK();
 }
 
+} // anonymous namespace
+
+template<DeltaType Type>
+Status WriteDeltaIteratorToFile(DeltaIterator* iter,
+                                size_t nrows,
+                                DeltaFileWriter* out) {
+  int64_t deltas_written;
+  return WriteFilteredDeltaIteratorToFile<Type>(iter, nrows,
+                                                [](const DeltaKey& /*key*/) { return true; },
+                                                out, &deltas_written);
+}
+
+Status WriteNonAncientUndosToFile(DeltaIterator* iter,
+                                  Timestamp ancient_history_mark,
+                                  DeltaFileWriter* out,
+                                  int64_t* deltas_written) {
+  return WriteFilteredDeltaIteratorToFile<UNDO>(
+      iter, ITERATE_OVER_ALL_ROWS,
+      [&](const DeltaKey& key) { return key.timestamp() >= ancient_history_mark; },
+      out, deltas_written);
+}
+
 template
 Status WriteDeltaIteratorToFile<REDO>(DeltaIterator* iter,
                                       size_t nrows,
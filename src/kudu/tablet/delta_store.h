@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
@@ -32,6 +33,7 @@ namespace kudu {
 
 class Arena;
 class ColumnBlock;
+class ColumnSchema;
 class ScanSpec;
 class Schema;
 class SelectionVector;
@@ -194,6 +196,10 @@ class DeltaIterator {
   // Must have called PrepareBatch() with flag = PREPARE_FOR_APPLY.
   virtual bool MayHaveDeltas() = 0;
 
+  // Returns the number of cell updates ApplyUpdates() has applied over the
+  // lifetime of the iterator.
+  virtual int64_t updates_applied() const = 0;
+
   // Return a string representation suitable for debug printouts.
   virtual std::string ToString() const = 0;
 
@@ -204,6 +210,37 @@ enum {
   ITERATE_OVER_ALL_ROWS = 0
 };
 
+// A decoded update of a single cell, as gathered by a delta iterator when
+// preparing a batch of rows for ApplyUpdates().
+struct ColumnUpdate {
+  rowid_t row_id;
+  // Points to 'new_val_buf', or is NULL if the cell is set to NULL.
+  void* new_val_ptr;
+  // A copy of the new value. For BINARY columns, this is a Slice whose
+  // referred-to data must be kept alive by the iterator.
+  uint8_t new_val_buf[16];
+};
+typedef std::deque<ColumnUpdate> UpdatesForColumn;
+
+// Records that the cell of row 'row_id' in a column described by
+// 'col_schema' is set to the value pointed to by 'new_val' (or to NULL, if
+// 'new_val' is NULL). If the last update in 'updates' is for the same row,
+// it is overwritten, so updates must be added in the order they apply.
+void AddColumnUpdate(const ColumnSchema& col_schema, rowid_t row_id,
+                     const void* new_val, UpdatesForColumn* updates);
+
+// Writes 'updates' into 'dst', a block of the column described by
+// 'col_schema' whose first row is 'first_row_id'. BINARY values are
+// relocated into dst's arena, if it has one.
+//
+// The column's type and nullability are resolved once for the whole batch,
+// so that each update is applied as a single fixed-size store rather than
+// through the generic, per-cell type dispatch of CopyCell().
+Status ApplyColumnUpdates(const ColumnSchema& col_schema,
+                          const UpdatesForColumn& updates,
+                          rowid_t first_row_id,
+                          ColumnBlock* dst);
+
 // Dumps contents of 'iter' to 'out', line-by-line.  Used to unit test
 // minor delta compaction.
 //
@@ -223,6 +260,16 @@ Status WriteDeltaIteratorToFile(DeltaIterator* iter,
                                 size_t nrows,
                                 DeltaFileWriter* out);
 
+// Writes the UNDO deltas of 'iter' which are not older than
+// 'ancient_history_mark' to 'out', block by block, dropping the ancient ones.
+// Used to garbage collect the history of partially ancient UNDO delta files.
+//
+// Sets 'deltas_written' to the number of deltas written to 'out'.
+Status WriteNonAncientUndosToFile(DeltaIterator* iter,
+                                  Timestamp ancient_history_mark,
+                                  DeltaFileWriter* out,
+                                  int64_t* deltas_written);
+
 } // namespace tablet
 } // namespace kudu
 
@@ -18,6 +18,7 @@
 #include "kudu/tablet/delta_tracker.h"
 
 #include <algorithm>
+#include <map>
 #include <mutex>
 #include <ostream>
 #include <set>
@@ -45,6 +46,7 @@
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/deltamemstore.h"
+#include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet.pb.h"
@@ -115,6 +117,7 @@ Status DeltaTracker::OpenDeltaReaders(const vector<BlockId>& blocks,
     ReaderOptions options;
     options.parent_mem_tracker = mem_trackers_.tablet_tracker;
     options.io_context = io_context;
+    options.table_id = rowset_metadata_->tablet_metadata()->table_id();
     s = DeltaFileReader::OpenNoInit(std::move(block),
                                     type,
                                     std::move(options),
@@ -526,6 +529,125 @@ Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
   return Status::OK();
 }
 
+namespace {
+
+// Returns the fraction of the deltas of the initialized UNDO delta store
+// 'undo' which are estimated to be older than 'ancient_history_mark',
+// assuming that their timestamps are evenly spread out.
+double EstimateAncientRatio(const DeltaStore& undo, Timestamp ancient_history_mark) {
+  const DeltaStats& stats = undo.delta_stats();
+  if (stats.max_timestamp() < ancient_history_mark) {
+    return 1;
+  }
+  if (stats.min_timestamp() >= ancient_history_mark) {
+    return 0;
+  }
+  return static_cast<double>(ancient_history_mark.value() - stats.min_timestamp().value()) /
+      (stats.max_timestamp().value() - stats.min_timestamp().value() + 1);
+}
+
+} // anonymous namespace
+
+int64_t DeltaTracker::EstimateBytesInPartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                                                double min_ancient_ratio) {
+  SharedDeltaStoreVector undos_newest_first;
+  CollectStores(&undos_newest_first, UNDOS_ONLY);
+
+  int64_t bytes = 0;
+  for (const auto& undo : boost::adaptors::reverse(undos_newest_first)) {
+    // Never initialize the deltas in this code path; InitUndoDeltas() does.
+    if (!undo->Initted()) break;
+    double ratio = EstimateAncientRatio(*undo, ancient_history_mark);
+    if (ratio == 0) break;
+    if (ratio < 1 && ratio >= min_ancient_ratio) {
+      bytes += static_cast<int64_t>(undo->EstimateSize() * ratio);
+    }
+  }
+  return bytes;
+}
+
+Status DeltaTracker::RewritePartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                                       double min_ancient_ratio,
+                                                       int64_t max_bytes,
+                                                       const IOContext* io_context,
+                                                       int64_t* blocks_rewritten,
+                                                       int64_t* bytes_rewritten) {
+  DCHECK_NE(Timestamp::kInvalidTimestamp, ancient_history_mark);
+
+  // Like DeleteAncientUndoDeltas(), this swaps out delta stores, so it must
+  // be the only thread doing a flush or a compaction on this RowSet.
+  std::lock_guard<Mutex> l(compact_flush_lock_);
+  RETURN_NOT_OK(CheckWritableUnlocked());
+
+  SharedDeltaStoreVector undos_newest_first;
+  CollectStores(&undos_newest_first, UNDOS_ONLY);
+
+  int64_t tmp_blocks_rewritten = 0;
+  int64_t tmp_bytes_rewritten = 0;
+  FsManager* fs = rowset_metadata_->fs_manager();
+  Schema empty_schema;
+
+  // Traverse oldest-first: the older a delta file, the more of it is ancient.
+  for (const auto& undo : boost::adaptors::reverse(undos_newest_first)) {
+    if (tmp_bytes_rewritten >= max_bytes) break;
+    if (!undo->Initted()) break;
+    double ratio = EstimateAncientRatio(*undo, ancient_history_mark);
+    if (ratio == 0) break;
+    // Entirely ancient files are deleted as a whole by DeleteAncientUndoDeltas().
+    if (ratio == 1 || ratio < min_ancient_ratio) continue;
+
+    // This is always a safe downcast because UNDO deltas are always on disk.
+    const DeltaFileReader* dfr = down_cast<DeltaFileReader*>(undo.get());
+    RowIteratorOptions opts;
+    opts.projection = &empty_schema;
+    opts.io_context = io_context;
+    // UNDOs are only relevant to snapshots which don't include their
+    // transactions.
+    opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingNoTransactions();
+    DeltaIterator* raw_iter;
+    RETURN_NOT_OK(dfr->NewDeltaIterator(opts, &raw_iter));
+    unique_ptr<DeltaIterator> iter(raw_iter);
+
+    unique_ptr<WritableBlock> block;
+    CreateBlockOptions block_opts({ rowset_metadata_->tablet_metadata()->tablet_id() });
+    RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(block_opts, &block),
+                          "Could not allocate delta block");
+    BlockId new_block_id(block->id());
+    DeltaFileWriter dfw(std::move(block));
+    RETURN_NOT_OK(dfw.Start());
+    int64_t deltas_written;
+    RETURN_NOT_OK(WriteNonAncientUndosToFile(iter.get(), ancient_history_mark,
+                                             &dfw, &deltas_written));
+
+    // If every delta turned out to be ancient, the file is simply removed.
+    vector<BlockId> new_blocks;
+    Status s = dfw.Finish();
+    if (s.ok()) {
+      new_blocks.push_back(new_block_id);
+    } else if (!s.IsAborted()) {
+      return s;
+    }
+
+    const int64_t old_size = undo->EstimateSize();
+    RowSetMetadataUpdate update;
+    update.ReplaceUndoDeltaBlocks({ dfr->block_id() }, new_blocks);
+    LOG_WITH_PREFIX(INFO) << Substitute("Rewrote partially ancient undo delta block $0 "
+                                        "($1 bytes) into $2, keeping $3 deltas",
+                                        dfr->block_id().ToString(), old_size,
+                                        new_blocks.empty() ? "nothing" : new_block_id.ToString(),
+                                        deltas_written);
+    // We do not flush the tablet metadata - that is the caller's responsibility.
+    RETURN_NOT_OK(CommitDeltaStoreMetadataUpdate(update, { undo }, new_blocks, io_context,
+                                                 UNDO, NO_FLUSH_METADATA));
+    tmp_blocks_rewritten++;
+    tmp_bytes_rewritten += old_size;
+  }
+
+  if (blocks_rewritten) *blocks_rewritten = tmp_blocks_rewritten;
+  if (bytes_rewritten) *bytes_rewritten = tmp_bytes_rewritten;
+  return Status::OK();
+}
+
 Status DeltaTracker::DoCompactStores(const IOContext* io_context,
                                      size_t start_idx, size_t end_idx,
                                      unique_ptr<WritableBlock> block,
@@ -601,13 +723,101 @@ Status DeltaTracker::NewDeltaFileIterator(
   return DeltaIteratorMerger::Create(*included_stores, opts, out);
 }
 
+namespace {
+
+// Returns false if the delta store 'store' holds no delta committed in
+// 'snap_to_include' but not in 'snap_to_exclude'. Stores whose stats can't be
+// read are assumed to hold such deltas.
+bool StoreMayHaveDeltasBetween(DeltaStore* store,
+                               const MvccSnapshot& snap_to_exclude,
+                               const MvccSnapshot& snap_to_include,
+                               const fs::IOContext* io_context) {
+  if (!store->Initted() && !store->Init(io_context).ok()) {
+    return true;
+  }
+  const DeltaStats& stats = store->delta_stats();
+  return snap_to_include.MayHaveCommittedTransactionsAtOrAfter(stats.min_timestamp()) &&
+      snap_to_exclude.MayHaveUncommittedTransactionsAtOrBefore(stats.max_timestamp());
+}
+
+} // anonymous namespace
+
+bool DeltaTracker::MayHaveDeltasBetween(const MvccSnapshot& snap_to_exclude,
+                                        const MvccSnapshot& snap_to_include,
+                                        const fs::IOContext* io_context) const {
+  SharedDeltaStoreVector stores;
+  shared_ptr<DeltaMemStore> dms;
+  {
+    std::lock_guard<rw_spinlock> lock(component_lock_);
+    stores.assign(undo_delta_stores_.begin(), undo_delta_stores_.end());
+    stores.insert(stores.end(), redo_delta_stores_.begin(), redo_delta_stores_.end());
+    dms = dms_;
+  }
+  // The DMS doesn't keep delta stats.
+  if (!dms->Empty()) {
+    return true;
+  }
+  for (const auto& store : stores) {
+    if (StoreMayHaveDeltasBetween(store.get(), snap_to_exclude, snap_to_include, io_context)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Status DeltaTracker::NewDiffScanDeltaIterators(const RowIteratorOptions& opts,
+                                               unique_ptr<DeltaIterator>* undos,
+                                               unique_ptr<DeltaIterator>* redos) const {
+  DCHECK(opts.snap_to_exclude);
+  SharedDeltaStoreVector undo_stores;
+  SharedDeltaStoreVector redo_stores;
+  shared_ptr<DeltaMemStore> dms;
+  {
+    std::lock_guard<rw_spinlock> lock(component_lock_);
+    undo_stores = undo_delta_stores_;
+    redo_stores = redo_delta_stores_;
+    dms = dms_;
+  }
+  auto cull = [&](SharedDeltaStoreVector* stores) {
+    stores->erase(std::remove_if(stores->begin(), stores->end(),
+                                 [&](const shared_ptr<DeltaStore>& store) {
+                                   return !StoreMayHaveDeltasBetween(
+                                       store.get(), *opts.snap_to_exclude,
+                                       opts.snap_to_include, opts.io_context);
+                                 }),
+                  stores->end());
+  };
+  cull(&undo_stores);
+  cull(&redo_stores);
+  redo_stores.push_back(dms);
+
+  // The UNDOs to collect are the ones of the transactions which *are*
+  // committed in the snapshots, so collect all of them and leave the
+  // filtering to the caller.
+  RowIteratorOptions undo_opts = opts;
+  undo_opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingNoTransactions();
+  undo_opts.snap_to_exclude = boost::none;
+  RETURN_NOT_OK(DeltaIteratorMerger::Create(undo_stores, undo_opts, undos));
+
+  RowIteratorOptions redo_opts = opts;
+  redo_opts.snap_to_exclude = boost::none;
+  return DeltaIteratorMerger::Create(redo_stores, redo_opts, redos);
+}
+
 Status DeltaTracker::WrapIterator(const shared_ptr<CFileSet::Iterator> &base,
                                   const RowIteratorOptions& opts,
                                   gscoped_ptr<ColumnwiseIterator>* out) const {
   unique_ptr<DeltaIterator> iter;
   RETURN_NOT_OK(NewDeltaIterator(opts, &iter));
 
-  out->reset(new DeltaApplier(base, std::move(iter)));
+  unique_ptr<DeltaIterator> undo_window_iter;
+  unique_ptr<DeltaIterator> redo_window_iter;
+  if (opts.snap_to_exclude) {
+    RETURN_NOT_OK(NewDiffScanDeltaIterators(opts, &undo_window_iter, &redo_window_iter));
+  }
+
+  out->reset(new DeltaApplier(opts, base, std::move(iter),
+                              std::move(undo_window_iter), std::move(redo_window_iter)));
   return Status::OK();
 }
 
@@ -684,6 +894,7 @@ Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
   ReaderOptions options;
   options.parent_mem_tracker = mem_trackers_.tablet_tracker;
   options.io_context = io_context;
+  options.table_id = rowset_metadata_->tablet_metadata()->table_id();
   RETURN_NOT_OK(DeltaFileReader::OpenNoInit(std::move(readable_block),
                                             REDO,
                                             std::move(options),
@@ -819,6 +1030,70 @@ void DeltaTracker::GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const
   col_ids->assign(column_ids_with_updates.begin(), column_ids_with_updates.end());
 }
 
+Status DeltaTracker::MayHaveDeletedRows(const IOContext* io_context,
+                                        bool* may_have_deletes) const {
+  SharedDeltaStoreVector redo_stores;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    if (dms_->Count() > 0) {
+      *may_have_deletes = true;
+      return Status::OK();
+    }
+    redo_stores = redo_delta_stores_;
+  }
+
+  // Read the stats without holding the lock, since that may require IO.
+  for (const shared_ptr<DeltaStore>& ds : redo_stores) {
+    // A DeltaMemStore which is being flushed is also in the list of REDO
+    // stores, and its stats are always empty.
+    if (!dynamic_cast<DeltaFileReader*>(ds.get())) {
+      *may_have_deletes = true;
+      return Status::OK();
+    }
+    RETURN_NOT_OK(ds->Init(io_context));
+    if (ds->delta_stats().delete_count() > 0) {
+      *may_have_deletes = true;
+      return Status::OK();
+    }
+  }
+  *may_have_deletes = false;
+  return Status::OK();
+}
+
+bool DeltaTracker::MayHaveUpdatesToColumn(const ColumnId& col_id,
+                                          const MvccSnapshot& snap) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  if (dms_->Count() > 0) {
+    return true;
+  }
+  for (const auto* stores : { &redo_delta_stores_, &undo_delta_stores_ }) {
+    for (const shared_ptr<DeltaStore>& ds : *stores) {
+      // A DeltaMemStore which is being flushed is also in the list of REDO
+      // stores, and its stats are always empty.
+      const DeltaFileReader* dfr = dynamic_cast<const DeltaFileReader*>(ds.get());
+      if (dfr == nullptr || !ds->Initted()) {
+        return true;
+      }
+      if (dfr->delta_stats().update_count_for_col_id(col_id) > 0 &&
+          dfr->IsRelevantForSnapshot(snap)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void DeltaTracker::GetRedoBytesAppliedByScans(std::map<ColumnId, int64_t>* bytes_by_col) const {
+  bytes_by_col->clear();
+  shared_lock<rw_spinlock> lock(component_lock_);
+  for (const shared_ptr<DeltaStore>& ds : redo_delta_stores_) {
+    const DeltaFileReader* dfr = dynamic_cast<const DeltaFileReader*>(ds.get());
+    if (dfr) {
+      dfr->GetBytesAppliedByScans(bytes_by_col);
+    }
+  }
+}
+
 Status DeltaTracker::InitAllDeltaStoresForTests(WhichStores stores) {
   shared_lock<rw_spinlock> lock(component_lock_);
   if (stores == UNDOS_AND_REDOS || stores == UNDOS_ONLY) {
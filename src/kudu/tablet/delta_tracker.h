@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -64,6 +65,7 @@ namespace tablet {
 
 class DeltaFileReader;
 class DeltaMemStore;
+class MvccSnapshot;
 class OperationResultPB;
 class RowSetMetadata;
 class RowSetMetadataUpdate;
@@ -116,6 +118,22 @@ class DeltaTracker {
     return NewDeltaIterator(opts, UNDOS_AND_REDOS, out);
   }
 
+  // Returns false if none of the delta stores may hold a delta committed in
+  // 'snap_to_include' but not in 'snap_to_exclude', according to their
+  // timestamp ranges. Initializes the delta files which aren't yet.
+  bool MayHaveDeltasBetween(const MvccSnapshot& snap_to_exclude,
+                            const MvccSnapshot& snap_to_include,
+                            const fs::IOContext* io_context) const;
+
+  // Creates the iterators with which a diff scan finds the rows that changed
+  // between 'opts.snap_to_exclude' and 'opts.snap_to_include': 'undos'
+  // collects all the UNDOs and 'redos' the REDOs committed in
+  // 'opts.snap_to_include', of the delta stores which may have deltas between
+  // the two snapshots.
+  Status NewDiffScanDeltaIterators(const RowIteratorOptions& opts,
+                                   std::unique_ptr<DeltaIterator>* undos,
+                                   std::unique_ptr<DeltaIterator>* redos) const;
+
 
   // Like NewDeltaIterator() but only includes file based stores, does not include
   // the DMS.
@@ -188,6 +206,18 @@ class DeltaTracker {
   Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark, const fs::IOContext* io_context,
                                  int64_t* blocks_deleted, int64_t* bytes_deleted);
 
+  // See RowSet::EstimateBytesInPartiallyAncientUndoDeltas().
+  int64_t EstimateBytesInPartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                                    double min_ancient_ratio);
+
+  // See RowSet::RewritePartiallyAncientUndoDeltas().
+  Status RewritePartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                           double min_ancient_ratio,
+                                           int64_t max_bytes,
+                                           const fs::IOContext* io_context,
+                                           int64_t* blocks_rewritten,
+                                           int64_t* bytes_rewritten);
+
   // Opens the input 'blocks' of type 'type' and returns the opened delta file
   // readers in 'stores'.
   Status OpenDeltaReaders(const std::vector<BlockId>& blocks,
@@ -245,6 +275,28 @@ class DeltaTracker {
   // Retrieves the list of column indexes that currently have updates.
   void GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const;
 
+  // Sets '*may_have_deletes' to false if none of the REDO delta stores
+  // contains a DELETE, according to their stats, and to true otherwise.
+  //
+  // DeltaMemStores don't keep stats, so a non-empty DeltaMemStore is assumed
+  // to contain DELETEs. The stats of the flushed stores are read if needed.
+  Status MayHaveDeletedRows(const fs::IOContext* io_context, bool* may_have_deletes) const;
+
+  // Returns false if none of the delta stores, REDO or UNDO, contains an
+  // update to the column 'col_id' which is relevant to a scan of 'snap',
+  // according to their stats, and true otherwise.
+  //
+  // This doesn't read the stats of the flushed stores which aren't
+  // initialized yet: they, and a non-empty DeltaMemStore, are assumed to
+  // contain updates to the column.
+  bool MayHaveUpdatesToColumn(const ColumnId& col_id, const MvccSnapshot& snap) const;
+
+  // Retrieves the number of bytes of REDO deltas which scans have read from
+  // the flushed delta stores to apply updates to each column. The counts are
+  // kept in memory by each delta file, so they restart from zero when the
+  // tablet is reopened and when delta files are compacted.
+  void GetRedoBytesAppliedByScans(std::map<ColumnId, int64_t>* bytes_by_col) const;
+
   Mutex* compact_flush_lock() {
     return &compact_flush_lock_;
   }
@@ -417,5 +417,134 @@ TEST_F(TestDeltaFile, TestEmptyFileIsAborted) {
   ASSERT_TRUE(s.IsNotFound()) << s.ToString();
 }
 
+// Test applying updates to several columns of different types from the same
+// change lists, including updates which set nullable cells to NULL and later
+// updates of the same cells which overwrite earlier ones.
+TEST_F(TestDeltaFile, TestApplyUpdatesToMultipleColumns) {
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddColumn("u32", UINT32));
+  ASSERT_OK(builder.AddNullableColumn("str", STRING));
+  ASSERT_OK(builder.AddColumn("i64", INT64));
+  const Schema schema = builder.Build();
+  const int kNumRows = 1000;
+
+  unique_ptr<WritableBlock> block;
+  ASSERT_OK(fs_manager_->CreateNewBlock({}, &block));
+  test_block_ = block->id();
+  {
+    DeltaFileWriter dfw(std::move(block));
+    ASSERT_OK(dfw.Start());
+    DeltaStats stats;
+    faststring buf;
+    for (int i = 0; i < kNumRows; i++) {
+      // Update every row's u32, every third row's str and i64, and then set
+      // the str of every sixth row to NULL at a later timestamp.
+      for (int ts = 0; ts < (i % 6 == 0 ? 2 : 1); ts++) {
+        buf.clear();
+        RowChangeListEncoder update(&buf);
+        if (ts == 0) {
+          uint32_t u32 = i;
+          update.AddColumnUpdate(schema.column(0), schema.column_id(0), &u32);
+          if (i % 3 == 0) {
+            string str = std::to_string(i);
+            Slice str_slice(str);
+            int64_t i64 = -i;
+            update.AddColumnUpdate(schema.column(1), schema.column_id(1), &str_slice);
+            update.AddColumnUpdate(schema.column(2), schema.column_id(2), &i64);
+          }
+        } else {
+          update.AddColumnUpdate(schema.column(1), schema.column_id(1), nullptr);
+        }
+        DeltaKey key(i, Timestamp(ts));
+        RowChangeList rcl(buf);
+        ASSERT_OK(dfw.AppendDelta<REDO>(key, rcl));
+        ASSERT_OK(stats.UpdateStats(key.timestamp(), rcl));
+      }
+    }
+    dfw.WriteDeltaStats(stats);
+    ASSERT_OK(dfw.Finish());
+  }
+
+  shared_ptr<DeltaFileReader> reader;
+  ASSERT_OK(OpenDeltaFileReader(test_block_, &reader));
+  RowIteratorOptions opts;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  opts.projection = &schema;
+  DeltaIterator* raw_iter;
+  ASSERT_OK(reader->NewDeltaIterator(opts, &raw_iter));
+  gscoped_ptr<DeltaIterator> it(raw_iter);
+  ASSERT_OK(it->Init(nullptr));
+  ASSERT_OK(it->SeekToOrdinal(0));
+
+  RowBlock rb(schema, 100, &arena_);
+  for (int start_row = 0; start_row < kNumRows; start_row += rb.nrows()) {
+    rb.ZeroMemory();
+    arena_.Reset();
+    ASSERT_OK(it->PrepareBatch(rb.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
+    // Apply the columns out of order.
+    for (int col_idx : { 2, 0, 1 }) {
+      ColumnBlock dst_col = rb.column_block(col_idx);
+      ASSERT_OK(it->ApplyUpdates(col_idx, &dst_col));
+    }
+
+    for (int i = 0; i < rb.nrows(); i++) {
+      int row = start_row + i;
+      SCOPED_TRACE(row);
+      RowBlockRow rbr = rb.row(i);
+      ASSERT_EQ(row, *schema.ExtractColumnFromRow<UINT32>(rbr, 0));
+      if (row % 6 == 0) {
+        ASSERT_TRUE(rbr.is_null(1));
+      } else if (row % 3 == 0) {
+        ASSERT_FALSE(rbr.is_null(1));
+        ASSERT_EQ(std::to_string(row),
+                  reinterpret_cast<const Slice*>(rbr.cell_ptr(1))->ToString());
+      }
+      ASSERT_EQ(row % 3 == 0 ? -row : 0, *schema.ExtractColumnFromRow<INT64>(rbr, 2));
+    }
+  }
+}
+
+// Test that scanning a projection whose columns have no updates in a delta
+// file doesn't read the file's delta blocks.
+TEST_F(TestDeltaFile, TestSkipsFileWithoutUpdatesToProjection) {
+  WriteTestFile();
+
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(test_block_, &block));
+  size_t bytes_read = 0;
+  unique_ptr<ReadableBlock> count_block(
+      new CountingReadableBlock(std::move(block), &bytes_read));
+  shared_ptr<DeltaFileReader> reader;
+  ASSERT_OK(DeltaFileReader::Open(
+      std::move(count_block), REDO, ReaderOptions(), &reader));
+
+  // A projection of a column other than the updated one.
+  const Schema projection({ ColumnSchema("other", UINT32) },
+                          { ColumnId(schema_.column_id(0) + 1) }, 0);
+  RowIteratorOptions opts;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  opts.projection = &projection;
+  DeltaIterator* raw_iter;
+  ASSERT_OK(reader->NewDeltaIterator(opts, &raw_iter));
+  gscoped_ptr<DeltaIterator> it(raw_iter);
+  ASSERT_OK(it->Init(nullptr));
+  ASSERT_OK(it->SeekToOrdinal(0));
+  size_t bytes_read_before_scan = bytes_read;
+
+  RowBlock rb(projection, 100, &arena_);
+  for (int start_row = 0; start_row < FLAGS_last_row_to_update; start_row += rb.nrows()) {
+    rb.ZeroMemory();
+    ASSERT_OK(it->PrepareBatch(rb.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
+    ASSERT_FALSE(it->MayHaveDeltas());
+    ColumnBlock dst_col = rb.column_block(0);
+    ASSERT_OK(it->ApplyUpdates(0, &dst_col));
+    for (int i = 0; i < rb.nrows(); i++) {
+      ASSERT_EQ(0, *projection.ExtractColumnFromRow<UINT32>(rb.row(i), 0));
+    }
+  }
+  ASSERT_EQ(bytes_read_before_scan, bytes_read);
+  ASSERT_EQ(0, it->updates_applied());
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -17,7 +17,9 @@
 
 #include "kudu/tablet/deltafile.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -304,6 +306,18 @@ bool DeltaFileReader::IsRelevantForSnapshot(const MvccSnapshot& snap) const {
   return false;
 }
 
+void DeltaFileReader::RecordBytesAppliedByScans(ColumnId col_id, int64_t bytes) const {
+  std::lock_guard<simple_spinlock> l(scan_stats_lock_);
+  bytes_applied_by_scans_[col_id] += bytes;
+}
+
+void DeltaFileReader::GetBytesAppliedByScans(std::map<ColumnId, int64_t>* bytes_by_col) const {
+  std::lock_guard<simple_spinlock> l(scan_stats_lock_);
+  for (const auto& e : bytes_applied_by_scans_) {
+    (*bytes_by_col)[e.first] += e.second;
+  }
+}
+
 Status DeltaFileReader::CloneForDebugging(FsManager* fs_manager,
                                           const shared_ptr<MemTracker>& parent_mem_tracker,
                                           shared_ptr<DeltaFileReader>* out) const {
@@ -409,7 +423,26 @@ DeltaFileIterator::DeltaFileIterator(shared_ptr<DeltaFileReader> dfr,
       exhausted_(false),
       initted_(false),
       delta_type_(delta_type),
-      cache_blocks_(CFileReader::CACHE_BLOCK) {}
+      cache_blocks_(CFileReader::CACHE_BLOCK),
+      updates_decoded_(false),
+      prepared_redo_bytes_(0),
+      updates_applied_(0),
+      projection_untouched_(false) {
+  if (delta_type_ == REDO && opts_.projection) {
+    bytes_applied_by_col_.resize(opts_.projection->num_columns());
+  }
+}
+
+DeltaFileIterator::~DeltaFileIterator() {
+  if (bytes_applied_by_col_.empty() || !opts_.projection->has_column_ids()) {
+    return;
+  }
+  for (size_t i = 0; i < bytes_applied_by_col_.size(); i++) {
+    if (bytes_applied_by_col_[i] > 0) {
+      dfr_->RecordBytesAppliedByScans(opts_.projection->column_id(i), bytes_applied_by_col_[i]);
+    }
+  }
+}
 
 Status DeltaFileIterator::Init(ScanSpec *spec) {
   DCHECK(!initted_) << "Already initted";
@@ -439,6 +472,8 @@ Status DeltaFileIterator::SeekToOrdinal(rowid_t idx) {
     return Status::OK();
   }
 
+  ComputeUpdatedColumns();
+
   if (!index_iter_) {
     index_iter_.reset(IndexTreeIterator::Create(
         opts_.io_context,
@@ -469,6 +504,24 @@ Status DeltaFileIterator::SeekToOrdinal(rowid_t idx) {
   return Status::OK();
 }
 
+void DeltaFileIterator::ComputeUpdatedColumns() {
+  col_has_updates_.clear();
+  projection_untouched_ = false;
+  if (!opts_.projection || !opts_.projection->has_column_ids()) {
+    return;
+  }
+  const DeltaStats& stats = dfr_->delta_stats();
+  bool any_updated = false;
+  col_has_updates_.resize(opts_.projection->num_columns());
+  for (size_t i = 0; i < col_has_updates_.size(); i++) {
+    col_has_updates_[i] = stats.update_count_for_col_id(opts_.projection->column_id(i)) > 0;
+    any_updated |= col_has_updates_[i];
+  }
+  projection_untouched_ = !any_updated &&
+                          stats.delete_count() == 0 &&
+                          stats.reinsert_count() == 0;
+}
+
 Status DeltaFileIterator::ReadCurrentBlockOntoQueue() {
   DCHECK(initted_) << "Must call Init()";
   DCHECK(index_iter_) << "Must call SeekToOrdinal()";
@@ -537,6 +590,17 @@ Status DeltaFileIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
   rowid_t start_row = prepared_idx_ + prepared_count_;
   rowid_t stop_row = start_row + nrows - 1;
 
+  if (flag == PREPARE_FOR_APPLY && projection_untouched_) {
+    // None of the deltas in the file can change the projected columns or the
+    // liveness of a row, so there is no need to read its blocks at all.
+    delta_blocks_.clear();
+    prepared_idx_ = start_row;
+    prepared_count_ = nrows;
+    prepared_ = true;
+    updates_decoded_ = false;
+    return Status::OK();
+  }
+
   // Remove blocks from our list which are no longer relevant to the range
   // being prepared.
   while (!delta_blocks_.empty() &&
@@ -584,6 +648,7 @@ Status DeltaFileIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
   prepared_idx_ = start_row;
   prepared_count_ = nrows;
   prepared_ = true;
+  updates_decoded_ = false;
   return Status::OK();
 }
 
@@ -681,70 +746,114 @@ inline bool IsUndoRelevant(const MvccSnapshot& snap,
   return true;
 }
 
+// Visitor which decodes each relevant update or reinsert once, gathering the
+// new cell values by column so that ApplyUpdates() need not decode the
+// change lists again for every column it is called for.
 template<DeltaType Type>
-struct ApplyingVisitor {
+struct DecodingVisitor {
 
   Status Visit(const DeltaKey &key, const Slice &deltas, bool* continue_visit);
 
-  inline Status ApplyMutation(const DeltaKey &key, const Slice &deltas) {
-    int64_t rel_idx = key.row_idx() - dfi->prepared_idx_;
-    DCHECK_GE(rel_idx, 0);
-
-    // TODO(todd): this code looks eerily similar to DMSIterator::ApplyUpdates!
-    // I bet it can be combined.
+  inline Status DecodeMutation(const DeltaKey &key, const Slice &deltas) {
+    DCHECK_GE(key.row_idx(), dfi->prepared_idx_);
 
     const Schema* schema = dfi->opts_.projection;
     RowChangeListDecoder decoder((RowChangeList(deltas)));
     RETURN_NOT_OK(decoder.Init());
-    if (decoder.is_update() || decoder.is_reinsert()) {
-      return decoder.ApplyToOneColumn(rel_idx, dst, *schema, col_to_apply, dst->arena());
+    if (decoder.is_delete()) {
+      // If it's a DELETE, then it will be processed by LivenessVisitor.
+      return Status::OK();
     }
 
-    DCHECK(decoder.is_delete());
-    // If it's a DELETE, then it will be processed by LivenessVisitor.
+    DCHECK(decoder.is_update() || decoder.is_reinsert());
+    while (decoder.HasNext()) {
+      RowChangeListDecoder::DecodedUpdate dec;
+      RETURN_NOT_OK(decoder.DecodeNext(&dec));
+      int col_idx;
+      const void* col_val;
+      RETURN_NOT_OK(dec.Validate(*schema, &col_idx, &col_val));
+      if (col_idx == -1) {
+        // This column isn't being projected.
+        continue;
+      }
+      AddColumnUpdate(schema->column(col_idx), key.row_idx(), col_val,
+                      &dfi->updates_by_col_[col_idx]);
+    }
     return Status::OK();
   }
 
   DeltaFileIterator *dfi;
-  size_t col_to_apply;
-  ColumnBlock *dst;
 };
 
 template<>
-inline Status ApplyingVisitor<REDO>::Visit(const DeltaKey& key,
+inline Status DecodingVisitor<REDO>::Visit(const DeltaKey& key,
                                            const Slice& deltas,
                                            bool* continue_visit) {
   if (IsRedoRelevant(dfi->opts_.snap_to_include, key.timestamp(), continue_visit)) {
-    DVLOG(3) << "Applied redo delta";
-    return ApplyMutation(key, deltas);
+    DVLOG(3) << "Decoded redo delta";
+    dfi->prepared_redo_bytes_ += deltas.size();
+    return DecodeMutation(key, deltas);
   }
   DVLOG(3) << "Redo delta uncommitted, skipped applying.";
   return Status::OK();
 }
 
 template<>
-inline Status ApplyingVisitor<UNDO>::Visit(const DeltaKey& key,
+inline Status DecodingVisitor<UNDO>::Visit(const DeltaKey& key,
                                            const Slice& deltas,
                                            bool* continue_visit) {
   if (IsUndoRelevant(dfi->opts_.snap_to_include, key.timestamp(), continue_visit)) {
-    DVLOG(3) << "Applied undo delta";
-    return ApplyMutation(key, deltas);
+    DVLOG(3) << "Decoded undo delta";
+    return DecodeMutation(key, deltas);
   }
   DVLOG(3) << "Undo delta committed, skipped applying.";
   return Status::OK();
 }
 
+Status DeltaFileIterator::DecodeUpdatesIfNeeded() {
+  DCHECK(prepared_) << "must prepare";
+  if (updates_decoded_) {
+    return Status::OK();
+  }
+
+  if (updates_by_col_.empty()) {
+    updates_by_col_.resize(opts_.projection->num_columns());
+  }
+  for (UpdatesForColumn& ufc : updates_by_col_) {
+    ufc.clear();
+  }
+  prepared_redo_bytes_ = 0;
+
+  if (delta_type_ == REDO) {
+    DVLOG(3) << "Decoding REDO mutations";
+    DecodingVisitor<REDO> visitor = {this};
+    RETURN_NOT_OK(VisitMutations(&visitor));
+  } else {
+    DVLOG(3) << "Decoding UNDO mutations";
+    DecodingVisitor<UNDO> visitor = {this};
+    RETURN_NOT_OK(VisitMutations(&visitor));
+  }
+  updates_decoded_ = true;
+  return Status::OK();
+}
+
 Status DeltaFileIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
   DCHECK_LE(prepared_count_, dst->nrows());
 
-  if (delta_type_ == REDO) {
-    DVLOG(3) << "Applying REDO mutations to " << col_to_apply;
-    ApplyingVisitor<REDO> visitor = {this, col_to_apply, dst};
-    return VisitMutations(&visitor);
+  // Skip decoding the deltas if the file has no updates to this column.
+  if (col_to_apply < col_has_updates_.size() && !col_has_updates_[col_to_apply]) {
+    return Status::OK();
   }
-  DVLOG(3) << "Applying UNDO mutations to " << col_to_apply;
-  ApplyingVisitor<UNDO> visitor = {this, col_to_apply, dst};
-  return VisitMutations(&visitor);
+
+  RETURN_NOT_OK(DecodeUpdatesIfNeeded());
+  if (col_to_apply < bytes_applied_by_col_.size()) {
+    bytes_applied_by_col_[col_to_apply] += prepared_redo_bytes_;
+  }
+
+  DVLOG(3) << "Applying " << DeltaType_Name(delta_type_) << " mutations to " << col_to_apply;
+  updates_applied_ += updates_by_col_[col_to_apply].size();
+  return ApplyColumnUpdates(opts_.projection->column(col_to_apply),
+                            updates_by_col_[col_to_apply], prepared_idx_, dst);
 }
 
 // Visitor which establishes the liveness of a row by applying deletes and reinserts.
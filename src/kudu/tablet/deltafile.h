@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -33,6 +34,7 @@
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/cfile/index_btree.h"
 #include "kudu/common/rowid.h"
+#include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
@@ -42,6 +44,7 @@
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/once.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
@@ -56,7 +59,6 @@ class MemTracker;
 class RowChangeList;
 class ScanSpec;
 class SelectionVector;
-struct ColumnId;
 
 namespace tablet {
 class MvccSnapshot;
@@ -77,7 +79,7 @@ namespace tablet {
 
 class Mutation;
 template<DeltaType Type>
-struct ApplyingVisitor;
+struct DecodingVisitor;
 template<DeltaType Type>
 struct CollectingVisitor;
 template<DeltaType Type>
@@ -193,6 +195,14 @@ class DeltaFileReader : public DeltaStore,
   // been fully initialized.
   bool IsRelevantForSnapshot(const MvccSnapshot& snap) const;
 
+  // Adds 'bytes' to the number of bytes of deltas which scans have read from
+  // this file to apply updates to the column 'col_id'.
+  void RecordBytesAppliedByScans(ColumnId col_id, int64_t bytes) const;
+
+  // Adds the number of bytes of deltas which scans have read from this file
+  // to apply updates to each column to '*bytes_by_col'.
+  void GetBytesAppliedByScans(std::map<ColumnId, int64_t>* bytes_by_col) const;
+
   // Clone this DeltaFileReader for testing and validation purposes (such as
   // while in DEBUG mode). The resulting object will not be Initted().
   Status CloneForDebugging(FsManager* fs_manager,
@@ -223,6 +233,11 @@ class DeltaFileReader : public DeltaStore,
   const DeltaType delta_type_;
 
   KuduOnceLambda init_once_;
+
+  // Bytes of deltas read by scans to apply updates to each column, since the
+  // file was opened. Protected by 'scan_stats_lock_'.
+  mutable simple_spinlock scan_stats_lock_;
+  mutable std::map<ColumnId, int64_t> bytes_applied_by_scans_;
 };
 
 // Iterator over the deltas contained in a delta file.
@@ -230,6 +245,8 @@ class DeltaFileReader : public DeltaStore,
 // See DeltaIterator for details.
 class DeltaFileIterator : public DeltaIterator {
  public:
+  ~DeltaFileIterator();
+
   Status Init(ScanSpec *spec) OVERRIDE;
 
   Status SeekToOrdinal(rowid_t idx) OVERRIDE;
@@ -244,10 +261,14 @@ class DeltaFileIterator : public DeltaIterator {
   virtual bool HasNext() OVERRIDE;
   bool MayHaveDeltas() override;
 
+  int64_t updates_applied() const override {
+    return updates_applied_;
+  }
+
  private:
   friend class DeltaFileReader;
-  friend struct ApplyingVisitor<REDO>;
-  friend struct ApplyingVisitor<UNDO>;
+  friend struct DecodingVisitor<REDO>;
+  friend struct DecodingVisitor<UNDO>;
   friend struct CollectingVisitor<REDO>;
   friend struct CollectingVisitor<UNDO>;
   friend struct LivenessVisitor<REDO>;
@@ -315,6 +336,14 @@ class DeltaFileIterator : public DeltaIterator {
   template<class Visitor>
   Status VisitMutations(Visitor *visitor);
 
+  // Finds which of the projected columns the file has updates to, from its
+  // delta stats. Must be called once the reader is initialized.
+  void ComputeUpdatedColumns();
+
+  // Decodes the updates in the prepared row range into 'updates_by_col_',
+  // if that has not been done yet since the last PrepareBatch().
+  Status DecodeUpdatesIfNeeded();
+
   // Log a FATAL error message about a bad delta.
   void FatalUnexpectedDelta(const DeltaKey &key, const Slice &deltas,
                             const std::string &msg);
@@ -346,6 +375,32 @@ class DeltaFileIterator : public DeltaIterator {
   const DeltaType delta_type_;
 
   cfile::CFileReader::CacheControl cache_blocks_;
+
+  // Bytes of REDO deltas read by ApplyUpdates() for each column of the
+  // projection. Recorded in 'dfr_' when the iterator is destroyed.
+  std::vector<int64_t> bytes_applied_by_col_;
+
+  // The updates in the prepared row range, by projection column. Each
+  // change list is decoded once for all of the columns, on the first
+  // ApplyUpdates() after PrepareBatch(). BINARY values point into the
+  // blocks in 'delta_blocks_'.
+  std::vector<UpdatesForColumn> updates_by_col_;
+  bool updates_decoded_;
+
+  // Bytes of the relevant REDO deltas in the prepared row range.
+  int64_t prepared_redo_bytes_;
+
+  // The number of cell updates applied by ApplyUpdates().
+  int64_t updates_applied_;
+
+  // Whether the file has updates to each projection column, according to
+  // its delta stats. Empty if the projection has no column IDs.
+  std::vector<bool> col_has_updates_;
+
+  // Whether the file has neither updates to the projected columns nor
+  // deletes or reinserts, in which case PrepareBatch() for PREPARE_FOR_APPLY
+  // doesn't read any blocks.
+  bool projection_untouched_;
 };
 
 
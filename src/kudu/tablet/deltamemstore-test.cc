@@ -25,6 +25,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -66,6 +67,7 @@
 #include "kudu/util/test_util.h"
 
 DEFINE_int32(benchmark_num_passes, 100, "Number of passes to apply deltas in the benchmark");
+DECLARE_int32(dms_num_shards);
 
 using std::shared_ptr;
 using std::string;
@@ -246,6 +248,50 @@ TEST_F(TestDeltaMemStore, TestDMSSparseUpdates) {
   }
 }
 
+// Test concurrent updates of a DMS whose deltas are split between several
+// shards, and that reads and flushes see them in key order.
+TEST_F(TestDeltaMemStore, TestShardedConcurrentUpdates) {
+  FLAGS_dms_num_shards = 4;
+  ASSERT_OK(DeltaMemStore::Create(1, 0, new log::LogAnchorRegistry(),
+                                  MemTracker::GetRootTracker(), &dms_));
+  ASSERT_OK(dms_->Init(nullptr));
+  ASSERT_EQ(4, dms_->num_shards());
+
+  const int kNumRows = 2000;
+  const int kNumThreads = 4;
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      // Each thread updates a quarter of the rows, spread over all shards.
+      vector<uint32_t> indexes;
+      for (uint32_t idx = t; idx < kNumRows; idx += kNumThreads) {
+        indexes.push_back(idx);
+      }
+      std::random_shuffle(indexes.begin(), indexes.end());
+      UpdateIntsAtIndexes(indexes);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(kNumRows, dms_->Count());
+
+  ScopedColumnBlock<UINT32> read_back(kNumRows);
+  ApplyUpdates(MvccSnapshot(mvcc_), 0, kIntColumn, &read_back);
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(i * 10, read_back[i]);
+  }
+
+  // The delta file writer checks that the deltas are flushed in key order.
+  unique_ptr<WritableBlock> block;
+  ASSERT_OK(fs_manager_->CreateNewBlock({}, &block));
+  DeltaFileWriter dfw(std::move(block));
+  ASSERT_OK(dfw.Start());
+  gscoped_ptr<DeltaStats> stats;
+  ASSERT_OK(dms_->FlushToFile(&dfw, &stats));
+  ASSERT_EQ(kNumRows, stats->update_count_for_col_id(schema_.column_id(kIntColumn)));
+}
+
 // Performance test for KUDU-749: zipfian workloads can cause a lot
 // of updates to a single row. This benchmark updates a single row many
 // times and times how long it takes to apply those updates during
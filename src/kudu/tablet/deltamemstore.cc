@@ -17,10 +17,11 @@
 
 #include "kudu/tablet/deltamemstore.h"
 
-#include <cstring>
+#include <algorithm>
 #include <ostream>
 #include <utility>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/common/columnblock.h"
@@ -38,10 +39,17 @@
 #include "kudu/tablet/mvcc.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/memcmpable_varint.h"
 #include "kudu/util/memory/memory.h"
 #include "kudu/util/status.h"
 
+DEFINE_int32(dms_num_shards, 1,
+             "Number of concurrent B-trees the deltas of each DeltaMemStore are "
+             "split between. More shards reduce the contention between concurrent "
+             "updates of the same row set, at the cost of some memory per row set.");
+TAG_FLAG(dms_num_shards, experimental);
+
 namespace kudu {
 namespace tablet {
 
@@ -49,6 +57,7 @@ using fs::IOContext;
 using log::LogAnchorRegistry;
 using std::string;
 using std::shared_ptr;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -78,12 +87,16 @@ DeltaMemStore::DeltaMemStore(int64_t id,
   : id_(id),
     rs_id_(rs_id),
     allocator_(new MemoryTrackingBufferAllocator(
-        HeapBufferAllocator::Get(), std::move(parent_tracker))),
-    arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
-    tree_(arena_),
+        ArenaComponentAllocator::Get(), std::move(parent_tracker))),
     anchorer_(log_anchor_registry,
               Substitute("Rowset-$0/DeltaMemStore-$1", rs_id_, id_)),
     disambiguator_sequence_number_(0) {
+  int num_shards = std::max(1, FLAGS_dms_num_shards);
+  shards_.reserve(num_shards);
+  for (int i = 0; i < num_shards; i++) {
+    shards_.emplace_back(new Shard(std::make_shared<ThreadSafeMemoryTrackingArena>(
+        kInitialArenaSize, allocator_)));
+  }
 }
 
 Status DeltaMemStore::Init(const IOContext* /*io_context*/) {
@@ -101,8 +114,9 @@ Status DeltaMemStore::Update(Timestamp timestamp,
   key.EncodeTo(&buf);
 
   Slice key_slice(buf);
+  DMSTree* tree = &ShardForRow(row_idx)->tree;
   btree::PreparedMutation<DMSTreeTraits> mutation(key_slice);
-  mutation.Prepare(&tree_);
+  mutation.Prepare(tree);
   if (PREDICT_FALSE(mutation.exists())) {
     // We already have a delta for this row at the same timestamp.
     // Try again with a disambiguating sequence number appended to the key.
@@ -110,7 +124,7 @@ Status DeltaMemStore::Update(Timestamp timestamp,
     PutMemcmpableVarint64(&buf, seq);
     key_slice = Slice(buf);
     mutation.Reset(key_slice);
-    mutation.Prepare(&tree_);
+    mutation.Prepare(tree);
     CHECK(!mutation.exists())
       << "Appended a sequence number but still hit a duplicate "
       << "for rowid " << row_idx << " at timestamp " << timestamp;
@@ -128,17 +142,17 @@ Status DeltaMemStore::FlushToFile(DeltaFileWriter *dfw,
                                   gscoped_ptr<DeltaStats>* stats_ret) {
   gscoped_ptr<DeltaStats> stats(new DeltaStats());
 
-  gscoped_ptr<DMSTreeIter> iter(tree_.NewIterator());
-  iter->SeekToStart();
-  while (iter->IsValid()) {
+  MergingTreeIter iter(shards_);
+  iter.SeekToStart();
+  while (iter.IsValid()) {
     Slice key_slice, val;
-    iter->GetCurrentEntry(&key_slice, &val);
+    iter.GetCurrentEntry(&key_slice, &val);
     DeltaKey key;
     RETURN_NOT_OK(key.DecodeFrom(&key_slice));
     RowChangeList rcl(val);
     RETURN_NOT_OK_PREPEND(dfw->AppendDelta<REDO>(key, rcl), "Failed to append delta");
     stats->UpdateStats(key.timestamp(), rcl);
-    iter->Next();
+    iter.Next();
   }
   dfw->WriteDeltaStats(*stats);
 
@@ -165,7 +179,7 @@ Status DeltaMemStore::CheckRowDeleted(rowid_t row_idx,
   bool exact;
 
   // TODO(unknown): can we avoid the allocation here?
-  gscoped_ptr<DMSTreeIter> iter(tree_.NewIterator());
+  gscoped_ptr<DMSTreeIter> iter(ShardForRow(row_idx)->tree.NewIterator());
   if (!iter->SeekAtOrAfter(key_slice, &exact)) {
     return Status::OK();
   }
@@ -190,8 +204,86 @@ Status DeltaMemStore::CheckRowDeleted(rowid_t row_idx,
   return Status::OK();
 }
 
+size_t DeltaMemStore::Count() const {
+  size_t count = 0;
+  for (const auto& shard : shards_) {
+    count += shard->tree.count();
+  }
+  return count;
+}
+
+bool DeltaMemStore::Empty() const {
+  for (const auto& shard : shards_) {
+    if (!shard->tree.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t DeltaMemStore::EstimateSize() const {
+  uint64_t size = 0;
+  for (const auto& shard : shards_) {
+    size += shard->arena->memory_footprint();
+  }
+  return size;
+}
+
 void DeltaMemStore::DebugPrint() const {
-  tree_.DebugPrint();
+  for (const auto& shard : shards_) {
+    shard->tree.DebugPrint();
+  }
+}
+
+DeltaMemStore::MergingTreeIter::MergingTreeIter(const vector<unique_ptr<Shard>>& shards)
+    : cur_(-1) {
+  iters_.reserve(shards.size());
+  for (const auto& shard : shards) {
+    iters_.emplace_back(shard->tree.NewIterator());
+  }
+}
+
+bool DeltaMemStore::MergingTreeIter::SeekToStart() {
+  bool exact;
+  return SeekAtOrAfter(Slice(""), &exact);
+}
+
+bool DeltaMemStore::MergingTreeIter::SeekAtOrAfter(const Slice& key, bool* exact) {
+  *exact = false;
+  for (auto& iter : iters_) {
+    bool iter_exact = false;
+    iter->SeekAtOrAfter(key, &iter_exact);
+    *exact |= iter_exact;
+  }
+  FindSmallest();
+  return IsValid();
+}
+
+void DeltaMemStore::MergingTreeIter::GetCurrentEntry(Slice* key, Slice* val) const {
+  DCHECK(IsValid());
+  iters_[cur_]->GetCurrentEntry(key, val);
+}
+
+bool DeltaMemStore::MergingTreeIter::Next() {
+  DCHECK(IsValid());
+  iters_[cur_]->Next();
+  FindSmallest();
+  return IsValid();
+}
+
+void DeltaMemStore::MergingTreeIter::FindSmallest() {
+  cur_ = -1;
+  Slice smallest;
+  for (int i = 0; i < static_cast<int>(iters_.size()); i++) {
+    if (!iters_[i]->IsValid()) {
+      continue;
+    }
+    Slice key = iters_[i]->GetCurrentKey();
+    if (cur_ == -1 || key.compare(smallest) < 0) {
+      cur_ = i;
+      smallest = key;
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////
@@ -202,12 +294,13 @@ DMSIterator::DMSIterator(const shared_ptr<const DeltaMemStore>& dms,
                          RowIteratorOptions opts)
     : dms_(dms),
       opts_(std::move(opts)),
-      iter_(dms->tree_.NewIterator()),
+      iter_(new DeltaMemStore::MergingTreeIter(dms->shards_)),
       initted_(false),
       prepared_idx_(0),
       prepared_count_(0),
       prepared_for_(NOT_PREPARED),
-      seeked_(false) {}
+      seeked_(false),
+      updates_applied_(0) {}
 
 Status DMSIterator::Init(ScanSpec* /*spec*/) {
   initted_ = true;
@@ -287,25 +380,8 @@ Status DMSIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
             // This column isn't being projected.
             continue;
           }
-          int col_size = opts_.projection->column(col_idx).type_info()->size();
-
-          // If we already have an earlier update for the same column, we can
-          // just overwrite that one.
-          if (updates_by_col_[col_idx].empty() ||
-              updates_by_col_[col_idx].back().row_id != key.row_idx()) {
-            updates_by_col_[col_idx].emplace_back();
-          }
-
-          ColumnUpdate& cu = updates_by_col_[col_idx].back();
-          cu.row_id = key.row_idx();
-          if (col_val == nullptr) {
-            cu.new_val_ptr = nullptr;
-          } else {
-            memcpy(cu.new_val_buf, col_val, col_size);
-            // NOTE: we're constructing a pointer here to an element inside the deque.
-            // This is safe because deques never invalidate pointers to their elements.
-            cu.new_val_ptr = cu.new_val_buf;
-          }
+          AddColumnUpdate(opts_.projection->column(col_idx), key.row_idx(), col_val,
+                          &updates_by_col_[col_idx]);
         }
       }
     } else {
@@ -328,16 +404,9 @@ Status DMSIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
   DCHECK_EQ(prepared_for_, PREPARED_FOR_APPLY);
   DCHECK_EQ(prepared_count_, dst->nrows());
 
-  const ColumnSchema* col_schema = &opts_.projection->column(col_to_apply);
-  for (const ColumnUpdate& cu : updates_by_col_[col_to_apply]) {
-    int32_t idx_in_block = cu.row_id - prepared_idx_;
-    DCHECK_GE(idx_in_block, 0);
-    SimpleConstCell src(col_schema, cu.new_val_ptr);
-    ColumnBlock::Cell dst_cell = dst->cell(idx_in_block);
-    RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
-  }
-
-  return Status::OK();
+  updates_applied_ += updates_by_col_[col_to_apply].size();
+  return ApplyColumnUpdates(opts_.projection->column(col_to_apply),
+                            updates_by_col_[col_to_apply], prepared_idx_, dst);
 }
 
 
@@ -22,6 +22,7 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
@@ -95,13 +96,9 @@ class DeltaMemStore : public DeltaStore,
                 const RowChangeList &update,
                 const consensus::OpId& op_id);
 
-  size_t Count() const {
-    return tree_.count();
-  }
+  size_t Count() const;
 
-  bool Empty() const {
-    return tree_.empty();
-  }
+  bool Empty() const;
 
   // Dump a debug version of the tree to the logs. This is not thread-safe, so
   // is only really useful in unit tests.
@@ -129,15 +126,18 @@ class DeltaMemStore : public DeltaStore,
   virtual Status CheckRowDeleted(rowid_t row_idx, const fs::IOContext* io_context,
                                  bool* deleted) const OVERRIDE;
 
-  virtual uint64_t EstimateSize() const OVERRIDE {
-    return arena_->memory_footprint();
-  }
+  virtual uint64_t EstimateSize() const OVERRIDE;
 
   const int64_t id() const { return id_; }
 
   typedef btree::CBTree<DMSTreeTraits> DMSTree;
   typedef btree::CBTreeIterator<DMSTreeTraits> DMSTreeIter;
 
+  // The number of trees the deltas are split between.
+  int num_shards() const {
+    return shards_.size();
+  }
+
   virtual std::string ToString() const OVERRIDE {
     return "DMS";
   }
@@ -160,19 +160,62 @@ class DeltaMemStore : public DeltaStore,
                 log::LogAnchorRegistry* log_anchor_registry,
                 std::shared_ptr<MemTracker> parent_tracker);
 
-  const DMSTree& tree() const {
-    return tree_;
+  // The deltas are split between several concurrent B-trees, each with its
+  // own arena, so that concurrent updates of one row set don't all contend
+  // on the same tree nodes and arena. Rows are assigned to the shards by
+  // stripes of consecutive row indexes, so all of the deltas of a row are in
+  // the same shard.
+  struct Shard {
+    explicit Shard(std::shared_ptr<ThreadSafeMemoryTrackingArena> shard_arena)
+        : arena(std::move(shard_arena)),
+          tree(arena) {
+    }
+
+    std::shared_ptr<ThreadSafeMemoryTrackingArena> arena;
+
+    // Concurrent B-Tree storing <key index> -> RowChangeList
+    DMSTree tree;
+  };
+
+  // Iterates over the deltas of all of the shards in key order, by merging
+  // the iterators of the shards' trees.
+  class MergingTreeIter {
+   public:
+    explicit MergingTreeIter(const std::vector<std::unique_ptr<Shard>>& shards);
+
+    bool SeekToStart();
+    bool SeekAtOrAfter(const Slice& key, bool* exact);
+    bool IsValid() const { return cur_ != -1; }
+    void GetCurrentEntry(Slice* key, Slice* val) const;
+    bool Next();
+
+   private:
+    // Points 'cur_' at the valid shard iterator with the smallest key.
+    void FindSmallest();
+
+    std::vector<std::unique_ptr<DMSTreeIter>> iters_;
+
+    // The index of the current iterator in 'iters_', or -1 if all of them
+    // are exhausted.
+    int cur_;
+
+    DISALLOW_COPY_AND_ASSIGN(MergingTreeIter);
+  };
+
+  // Returns the shard which holds the deltas of row 'row_idx'.
+  Shard* ShardForRow(rowid_t row_idx) const {
+    return shards_[(row_idx / kRowsPerShardStripe) % shards_.size()].get();
   }
 
+  // The number of consecutive rows assigned to the same shard.
+  static const rowid_t kRowsPerShardStripe = 128;
+
   const int64_t id_;    // DeltaMemStore ID.
   const int64_t rs_id_; // Rowset ID.
 
   std::shared_ptr<MemoryTrackingBufferAllocator> allocator_;
 
-  std::shared_ptr<ThreadSafeMemoryTrackingArena> arena_;
-
-  // Concurrent B-Tree storing <key index> -> RowChangeList
-  DMSTree tree_;
+  std::vector<std::unique_ptr<Shard>> shards_;
 
   log::MinLogIndexAnchorer anchorer_;
 
@@ -222,6 +265,10 @@ class DMSIterator : public DeltaIterator {
 
   bool MayHaveDeltas() override;
 
+  int64_t updates_applied() const override {
+    return updates_applied_;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(DMSIterator);
   FRIEND_TEST(TestDeltaMemStore, TestIteratorDoesUpdates);
@@ -239,7 +286,7 @@ class DMSIterator : public DeltaIterator {
 
   const RowIteratorOptions opts_;
 
-  gscoped_ptr<DeltaMemStore::DMSTreeIter> iter_;
+  gscoped_ptr<DeltaMemStore::MergingTreeIter> iter_;
 
   bool initted_;
 
@@ -262,15 +309,12 @@ class DMSIterator : public DeltaIterator {
 
   // State when prepared_for_ == PREPARED_FOR_APPLY
   // ------------------------------------------------------------
-  struct ColumnUpdate {
-    rowid_t row_id;
-    void* new_val_ptr;
-    uint8_t new_val_buf[16];
-  };
-  typedef std::deque<ColumnUpdate> UpdatesForColumn;
   std::vector<UpdatesForColumn> updates_by_col_;
   std::deque<rowid_t> deleted_;
 
+  // The number of cell updates applied by ApplyUpdates().
+  int64_t updates_applied_;
+
   // State when prepared_for_ == PREPARED_FOR_COLLECT
   // ------------------------------------------------------------
   struct PreparedDelta {
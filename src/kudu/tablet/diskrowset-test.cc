@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -31,10 +32,13 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/clock/clock.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/fs/block_id.h"
@@ -48,6 +52,7 @@
 #include "kudu/tablet/delta_tracker.h"
 #include "kudu/tablet/deltamemstore.h"
 #include "kudu/tablet/diskrowset-test-base.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
@@ -64,9 +69,12 @@
 DEFINE_double(update_fraction, 0.1f, "fraction of rows to update");
 DECLARE_bool(cfile_lazy_open);
 DECLARE_bool(crash_on_eio);
+DECLARE_bool(rowset_metadata_store_keys);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(tablet_column_write_parallelism);
 DECLARE_double(env_inject_eio);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
+DECLARE_double(tablet_delta_store_major_compact_scan_weight);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
 
 using std::is_sorted;
@@ -159,6 +167,85 @@ TEST_F(TestRowSet, TestRowSetRoundTrip) {
   }
 }
 
+// Test that the keys of a rowset written without them in its metadata are
+// backfilled into the metadata when the rowset is opened.
+TEST_F(TestRowSet, TestBackfillKeysIntoRowSetMetadata) {
+  FLAGS_rowset_metadata_store_keys = false;
+  WriteTestRowSet();
+  ASSERT_FALSE(rowset_meta_->has_encoded_keys());
+
+  // Opening the rowset without storing keys doesn't change the metadata.
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  ASSERT_FALSE(rowset_meta_->has_encoded_keys());
+
+  FLAGS_rowset_metadata_store_keys = true;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  ASSERT_TRUE(rowset_meta_->has_encoded_keys());
+  string min_key;
+  string max_key;
+  ASSERT_OK(rs->GetBounds(&min_key, &max_key));
+  ASSERT_EQ(min_key, rowset_meta_->min_encoded_key());
+  ASSERT_EQ(max_key, rowset_meta_->max_encoded_key());
+}
+
+// Test that a rowset's column statistics are stored in its metadata, and
+// rule the rowset out of scans until its delta stores may update the column.
+TEST_F(TestRowSet, TestMayMatchScanSpecWithColumnStats) {
+  WriteTestRowSet();
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  // Only the non-key column keeps statistics.
+  cfile::ZoneMapEntryPB stats;
+  ASSERT_FALSE(rowset_meta_->GetColumnStats(schema_.column_id(0), &stats));
+  ASSERT_TRUE(rowset_meta_->GetColumnStats(schema_.column_id(1), &stats));
+  ASSERT_EQ(n_rows_, stats.num_rows());
+  ASSERT_EQ(0, stats.null_count());
+
+  // The statistics survive a round trip through the metadata protobuf.
+  RowSetDataPB pb;
+  rowset_meta_->ToProtobuf(&pb);
+  unique_ptr<RowSetMetadata> loaded;
+  ASSERT_OK(RowSetMetadata::Load(rowset_meta_->tablet_metadata(), pb, &loaded));
+  cfile::ZoneMapEntryPB loaded_stats;
+  ASSERT_TRUE(loaded->GetColumnStats(schema_.column_id(1), &loaded_stats));
+  ASSERT_EQ(stats.SerializeAsString(), loaded_stats.SerializeAsString());
+
+  Schema proj_val = CreateProjection(schema_, { "val" });
+  RowIteratorOptions opts;
+  opts.projection = &proj_val;
+  auto may_match = [&](uint32_t lower, uint32_t upper) {
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, &upper));
+    return rs->MayMatchScanSpec(opts, spec);
+  };
+  const uint32_t kMissingVal = n_rows_ + 5;
+  ASSERT_TRUE(may_match(0, 10));
+  ASSERT_FALSE(may_match(kMissingVal, kMissingVal + 1));
+
+  // Once a row is updated, the statistics can't be trusted anymore, whether
+  // the update is in the DMS or in a delta file.
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(rs.get(), 0, kMissingVal, &result));
+  ASSERT_TRUE(may_match(kMissingVal, kMissingVal + 1));
+  ASSERT_OK(rs->FlushDeltas(nullptr));
+  ASSERT_TRUE(may_match(kMissingVal, kMissingVal + 1));
+}
+
+// Test writing a rowset with its columns written in parallel.
+TEST_F(TestRowSet, TestRowSetRoundTripParallelColumnWrites) {
+  FLAGS_tablet_column_write_parallelism = 2;
+  WriteTestRowSet();
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  IterateProjection(*rs, schema_, n_rows_);
+  NO_FATALS(VerifyUpdates(*rs, {}));
+  NO_FATALS(VerifyRandomRead(*rs, "hello 000000000000050",
+                             R"((string key="hello 000000000000050", uint32 val=50))"));
+}
+
 // Test writing a rowset, and then updating some rows in it.
 TEST_F(TestRowSet, TestRowSetUpdate) {
   WriteTestRowSet();
@@ -605,6 +692,49 @@ TEST_F(TestRowSet, TestCompactStores) {
   ASSERT_TRUE(is_sorted(results.begin(), results.end()));
 }
 
+// Test that the REDO deltas applied by scans raise the score of major delta
+// compactions.
+TEST_F(TestRowSet, TestMajorCompactionScoreIncludesScans) {
+  FLAGS_tablet_delta_store_major_compact_min_ratio = 0.0001;
+  FLAGS_cfile_lazy_open = false;
+
+  WriteTestRowSet();
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  UpdateExistingRows(rs.get(), FLAGS_update_fraction, nullptr);
+  ASSERT_OK(rs->FlushDeltas(nullptr));
+  const double score_before_scan =
+      rs->DeltaStoresCompactionPerfImprovementScore(RowSet::MAJOR_DELTA_COMPACTION);
+  NO_FATALS(BetweenZeroAndOne(score_before_scan));
+
+  std::map<ColumnId, int64_t> bytes_by_col;
+  rs->delta_tracker()->GetRedoBytesAppliedByScans(&bytes_by_col);
+  ASSERT_TRUE(bytes_by_col.empty());
+
+  // Scanning only the key column doesn't apply any updates.
+  Schema proj_key;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "key" }, &proj_key));
+  IterateProjection(*rs, proj_key, n_rows_, false);
+  rs->delta_tracker()->GetRedoBytesAppliedByScans(&bytes_by_col);
+  ASSERT_TRUE(bytes_by_col.empty());
+
+  // Scanning the updated column does.
+  Schema proj_val;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "val" }, &proj_val));
+  IterateProjection(*rs, proj_val, n_rows_, false);
+  rs->delta_tracker()->GetRedoBytesAppliedByScans(&bytes_by_col);
+  ASSERT_EQ(1, bytes_by_col.size());
+  ASSERT_EQ(schema_.column_id(1), bytes_by_col.begin()->first);
+  ASSERT_GT(bytes_by_col.begin()->second, 0);
+  ASSERT_GT(rs->DeltaStoresCompactionPerfImprovementScore(RowSet::MAJOR_DELTA_COMPACTION),
+            score_before_scan);
+
+  // The scans aren't taken into account with a weight of 0.
+  FLAGS_tablet_delta_store_major_compact_scan_weight = 0;
+  ASSERT_EQ(score_before_scan,
+            rs->DeltaStoresCompactionPerfImprovementScore(RowSet::MAJOR_DELTA_COMPACTION));
+}
+
 TEST_F(TestRowSet, TestGCAncientStores) {
   // Disable lazy open so that major delta compactions don't require manual REDO initialization.
   FLAGS_cfile_lazy_open = false;
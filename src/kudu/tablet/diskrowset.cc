@@ -18,6 +18,7 @@
 #include "kudu/tablet/diskrowset.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <map>
 #include <ostream>
 #include <vector>
@@ -28,21 +29,29 @@
 #include <glog/stl_logging.h>
 
 #include "kudu/cfile/bloomfile.h"
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/zone_map.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/types.h"
 #include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/casts.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/compaction.h"
+#include "kudu/tablet/delta_applier.h"
 #include "kudu/tablet/delta_compaction.h"
 #include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/delta_store.h"
@@ -71,14 +80,39 @@ DEFINE_double(tablet_delta_store_major_compact_min_ratio, 0.1f,
              "can run (Advanced option)");
 TAG_FLAG(tablet_delta_store_major_compact_min_ratio, experimental);
 
+DEFINE_double(tablet_delta_store_major_compact_scan_weight, 1.0,
+              "Weight of the REDO deltas applied by scans in the score of major delta "
+              "compactions. The bytes of deltas that scans read to apply updates to the "
+              "columns of a rowset, multiplied by this weight, are added to the size of "
+              "its deltas when computing the ratio of sizeof(deltas) to sizeof(base data), "
+              "so that the rowsets whose deltas are applied most often by scans are "
+              "compacted first. If 0, only the size of the deltas is considered.");
+TAG_FLAG(tablet_delta_store_major_compact_scan_weight, experimental);
+TAG_FLAG(tablet_delta_store_major_compact_scan_weight, runtime);
+
 DEFINE_int32(default_composite_key_index_block_size_bytes, 4096,
              "Block size used for composite key indexes.");
 TAG_FLAG(default_composite_key_index_block_size_bytes, experimental);
 
-DEFINE_bool(rowset_metadata_store_keys, false,
+DEFINE_bool(rowset_metadata_store_keys, true,
             "Whether to store the min/max encoded keys in the rowset "
-            "metadata. If false, keys will be read from the data blocks.");
-TAG_FLAG(rowset_metadata_store_keys, experimental);
+            "metadata. If false, keys will be read from the data blocks. "
+            "If true, the keys of rowsets written without them are read "
+            "from the data blocks once, when the rowset is opened, and "
+            "stored in the metadata the next time it is flushed, so that "
+            "opening the rowset doesn't need to read any of its blocks.");
+TAG_FLAG(rowset_metadata_store_keys, advanced);
+
+DEFINE_bool(rowset_skip_default_only_columns, true,
+            "Whether flushes and compactions skip writing the non-key columns "
+            "of a rowset whose values are all the column's read default, e.g. "
+            "the columns added by an ALTER TABLE since the rows were "
+            "inserted. Scans fill in the read default for those columns "
+            "without reading anything.");
+TAG_FLAG(rowset_skip_default_only_columns, experimental);
+TAG_FLAG(rowset_skip_default_only_columns, runtime);
+
+DECLARE_bool(consult_zone_maps);
 
 namespace kudu {
 
@@ -107,12 +141,15 @@ const char *DiskRowSet::kMaxKeyMetaEntryName = "max_key";
 
 DiskRowSetWriter::DiskRowSetWriter(RowSetMetadata* rowset_metadata,
                                    const Schema* schema,
-                                   BloomFilterSizing bloom_sizing)
+                                   BloomFilterSizing bloom_sizing,
+                                   bool prefer_fast_tier)
     : rowset_metadata_(rowset_metadata),
       schema_(schema),
       bloom_sizing_(bloom_sizing),
+      prefer_fast_tier_(prefer_fast_tier),
       finished_(false),
-      written_count_(0) {
+      written_count_(0),
+      key_arena_(32 * 1024) {
   CHECK(schema->has_column_ids());
 }
 
@@ -121,7 +158,11 @@ Status DiskRowSetWriter::Open() {
 
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id));
+  rowset_metadata_->set_on_fast_tier(prefer_fast_tier_ && fs->dd_manager()->has_fast_tier());
+  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id,
+                                          rowset_metadata_->tablet_metadata()->table_id(),
+                                          prefer_fast_tier_,
+                                          FLAGS_rowset_skip_default_only_columns));
   RETURN_NOT_OK(col_writer_->Open());
 
   // Open bloom filter.
@@ -140,7 +181,7 @@ Status DiskRowSetWriter::InitBloomFileWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, prefer_fast_tier_ }),
                                            &block),
                         "Couldn't allocate a block for bloom filter");
   rowset_metadata_->set_bloom_block(block->id());
@@ -155,7 +196,7 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, prefer_fast_tier_ }),
                                            &block),
                         "Couldn't allocate a block for compoound index");
 
@@ -201,34 +242,27 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   // Write the batch to each of the columns
   RETURN_NOT_OK(col_writer_->AppendBlock(block));
 
-#ifndef NDEBUG
-    faststring prev_key;
-#endif
-
-  // Write the batch to the bloom and optionally the ad-hoc index
+  // Encode the keys of the batch, then write them to the bloom and optionally
+  // the ad-hoc index in one go.
+  key_arena_.Reset();
+  encoded_keys_.resize(block.nrows());
   for (size_t i = 0; i < block.nrows(); i++) {
+    RETURN_NOT_OK(schema_->EncodeComparableKey(block.row(i), &key_arena_, &encoded_keys_[i]));
 #ifndef NDEBUG
-    prev_key.assign_copy(last_encoded_key_.data(), last_encoded_key_.size());
-#endif
-
-    // TODO: performance might be better if we actually batch this -
-    // encode a bunch of key slices, then pass them all in one go.
-    RowBlockRow row = block.row(i);
-    // Insert the encoded key into the bloom.
-    Slice enc_key = schema_->EncodeComparableKey(row, &last_encoded_key_);
-    RETURN_NOT_OK(bloom_writer_->AppendKeys(&enc_key, 1));
-
-    // Write the batch to the ad hoc index if we're using one
-    if (ad_hoc_index_writer_ != nullptr) {
-      RETURN_NOT_OK(ad_hoc_index_writer_->AppendEntries(&enc_key, 1));
-    }
-
-#ifndef NDEBUG
-    CHECK(prev_key.size() == 0 || Slice(prev_key).compare(enc_key) < 0)
-      << KUDU_REDACT(enc_key.ToDebugString()) << " appended to file not > previous key "
-      << KUDU_REDACT(Slice(prev_key).ToDebugString());
+    Slice prev_key = i == 0 ? Slice(last_encoded_key_) : encoded_keys_[i - 1];
+    CHECK(prev_key.size() == 0 || prev_key.compare(encoded_keys_[i]) < 0)
+      << KUDU_REDACT(encoded_keys_[i].ToDebugString()) << " appended to file not > previous key "
+      << KUDU_REDACT(prev_key.ToDebugString());
 #endif
   }
+  RETURN_NOT_OK(bloom_writer_->AppendKeys(encoded_keys_.data(), encoded_keys_.size()));
+  if (ad_hoc_index_writer_ != nullptr) {
+    RETURN_NOT_OK(ad_hoc_index_writer_->AppendEntries(encoded_keys_.data(),
+                                                      encoded_keys_.size()));
+  }
+  if (!encoded_keys_.empty()) {
+    last_encoded_key_.assign_copy(encoded_keys_.back().data(), encoded_keys_.back().size());
+  }
 
   written_count_ += block.nrows();
 
@@ -273,6 +307,15 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(BlockCreationTransaction* transa
   std::map<ColumnId, BlockId> flushed_blocks;
   col_writer_->GetFlushedBlocksByColumnId(&flushed_blocks);
   rowset_metadata_->SetColumnDataBlocks(flushed_blocks);
+  std::map<ColumnId, cfile::ZoneMapEntryPB> flushed_stats;
+  col_writer_->GetFlushedColumnStatsByColumnId(&flushed_stats);
+  rowset_metadata_->SetColumnStats(flushed_stats);
+  std::map<ColumnId, BlockId> flushed_index_blocks;
+  col_writer_->GetFlushedIndexBlocksByColumnId(&flushed_index_blocks);
+  rowset_metadata_->SetColumnIndexBlocks(flushed_index_blocks);
+  std::map<ColumnId, ColumnBlockRange> flushed_ranges;
+  col_writer_->GetFlushedBlockRangesByColumnId(&flushed_ranges);
+  rowset_metadata_->SetColumnBlockRanges(flushed_ranges);
 
   if (ad_hoc_index_writer_ != nullptr) {
     Status s = ad_hoc_index_writer_->FinishAndReleaseBlock(transaction);
@@ -320,12 +363,14 @@ DiskRowSetWriter::~DiskRowSetWriter() {
 
 RollingDiskRowSetWriter::RollingDiskRowSetWriter(
     TabletMetadata* tablet_metadata, const Schema& schema,
-    BloomFilterSizing bloom_sizing, size_t target_rowset_size)
+    BloomFilterSizing bloom_sizing, size_t target_rowset_size,
+    bool prefer_fast_tier)
     : state_(kInitialized),
       tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       schema_(schema),
       bloom_sizing_(bloom_sizing),
       target_rowset_size_(target_rowset_size),
+      prefer_fast_tier_(prefer_fast_tier),
       row_idx_in_cur_drs_(0),
       can_roll_(false),
       written_count_(0),
@@ -351,16 +396,16 @@ Status RollingDiskRowSetWriter::RollWriter() {
 
   RETURN_NOT_OK(tablet_metadata_->CreateRowSet(&cur_drs_metadata_));
 
-  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_));
+  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_,
+                                         prefer_fast_tier_));
   RETURN_NOT_OK(cur_writer_->Open());
 
   FsManager* fs = tablet_metadata_->fs_manager();
+  const CreateBlockOptions block_opts({ tablet_metadata_->tablet_id(), prefer_fast_tier_ });
   unique_ptr<WritableBlock> undo_data_block;
   unique_ptr<WritableBlock> redo_data_block;
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
-                                   &undo_data_block));
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
-                                   &redo_data_block));
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &undo_data_block));
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &redo_data_block));
   cur_undo_ds_block_id_ = undo_data_block->id();
   cur_redo_ds_block_id_ = redo_data_block->id();
   cur_undo_writer_.reset(new DeltaFileWriter(std::move(undo_data_block)));
@@ -529,7 +574,8 @@ DiskRowSet::DiskRowSet(shared_ptr<RowSetMetadata> rowset_metadata,
       log_anchor_registry_(log_anchor_registry),
       mem_trackers_(std::move(mem_trackers)),
       num_rows_(-1),
-      has_been_compacted_(false) {}
+      has_been_compacted_(false),
+      last_scan_micros_(GetMonoTimeMicros()) {}
 
 Status DiskRowSet::Open(const IOContext* io_context) {
   TRACE_EVENT0("tablet", "DiskRowSet::Open");
@@ -651,13 +697,15 @@ Status DiskRowSet::NewMajorDeltaCompaction(const vector<ColumnId>& col_ids,
                                       std::move(included_stores),
                                       col_ids,
                                       std::move(history_gc_opts),
-                                      rowset_metadata_->tablet_metadata()->tablet_id()));
+                                      rowset_metadata_->tablet_metadata()->tablet_id(),
+                                      rowset_metadata_->tablet_metadata()->table_id()));
   return Status::OK();
 }
 
 Status DiskRowSet::NewRowIterator(const RowIteratorOptions& opts,
                                   gscoped_ptr<RowwiseIterator>* out) const {
   DCHECK(open_);
+  last_scan_micros_.store(GetMonoTimeMicros());
   shared_lock<rw_spinlock> l(component_lock_);
 
   shared_ptr<CFileSet::Iterator> base_iter(base_data_->NewIterator(opts.projection,
@@ -670,6 +718,70 @@ Status DiskRowSet::NewRowIterator(const RowIteratorOptions& opts,
   return Status::OK();
 }
 
+Status DiskRowSet::NewKeyLookupIterator(const RowIteratorOptions& opts,
+                                        gscoped_ptr<RowwiseIterator>* out,
+                                        DeltaApplier** applier) const {
+  DCHECK(open_);
+  last_scan_micros_.store(GetMonoTimeMicros());
+  shared_lock<rw_spinlock> l(component_lock_);
+
+  shared_ptr<CFileSet::Iterator> base_iter(base_data_->NewIterator(opts.projection,
+                                                                   opts.io_context));
+  gscoped_ptr<ColumnwiseIterator> col_iter;
+  RETURN_NOT_OK(delta_tracker_->WrapIterator(base_iter, opts, &col_iter));
+  DeltaApplier* delta_applier = down_cast<DeltaApplier*>(col_iter.get());
+
+  gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(
+      shared_ptr<ColumnwiseIterator>(col_iter.release())));
+  RETURN_NOT_OK(iter->Init(nullptr));
+  out->reset(iter.release());
+  *applier = delta_applier;
+  return Status::OK();
+}
+
+bool DiskRowSet::MayMatchScanSpec(const RowIteratorOptions& opts,
+                                  const ScanSpec& spec) const {
+  DCHECK(open_);
+  if (!FLAGS_consult_zone_maps || !opts.projection->has_column_ids()) {
+    return true;
+  }
+  for (const auto& name_and_pred : spec.predicates()) {
+    const ColumnPredicate& pred = name_and_pred.second;
+    int col_idx = opts.projection->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    cfile::ZoneMapEntryPB stats;
+    if (!GetColumnStatsForScan(opts, col_idx, &stats)) {
+      continue;
+    }
+    if (!cfile::ZoneMayMatch(opts.projection->column(col_idx).type_info(), stats, pred)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DiskRowSet::MayHaveChangesInDiffScan(const RowIteratorOptions& opts) const {
+  DCHECK(open_);
+  DCHECK(opts.snap_to_exclude);
+  return delta_tracker_->MayHaveDeltasBetween(*opts.snap_to_exclude, opts.snap_to_include,
+                                              opts.io_context);
+}
+
+bool DiskRowSet::GetColumnStatsForScan(const RowIteratorOptions& opts,
+                                       int col_idx,
+                                       cfile::ZoneMapEntryPB* stats) const {
+  DCHECK(open_);
+  if (!opts.projection->has_column_ids()) {
+    return false;
+  }
+  const ColumnId col_id = opts.projection->column_id(col_idx);
+  shared_lock<rw_spinlock> l(component_lock_);
+  return rowset_metadata_->GetColumnStats(col_id, stats) &&
+      !delta_tracker_->MayHaveUpdatesToColumn(col_id, opts.snap_to_include);
+}
+
 Status DiskRowSet::NewCompactionInput(const Schema* projection,
                                       const MvccSnapshot &snap,
                                       const IOContext* io_context,
@@ -713,6 +825,16 @@ Status DiskRowSet::MutateRow(Timestamp timestamp,
   return Status::OK();
 }
 
+Status DiskRowSet::CheckRowsMayBePresent(const RowSetKeyProbe* const* probes,
+                                         size_t n,
+                                         const IOContext* io_context,
+                                         bool* maybe_present,
+                                         ProbeStats* const* stats) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+  return base_data_->CheckRowsMayBePresent(probes, n, io_context, maybe_present, stats);
+}
+
 Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
                                    const IOContext* io_context,
                                    bool* present,
@@ -741,6 +863,21 @@ Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DiskRowSet::CountLiveRowsFromMetadata(const IOContext* io_context,
+                                             bool* known,
+                                             rowid_t* count) const {
+  DCHECK(open_);
+  bool may_have_deletes;
+  RETURN_NOT_OK(delta_tracker_->MayHaveDeletedRows(io_context, &may_have_deletes));
+  if (may_have_deletes) {
+    *known = false;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(CountRows(io_context, count));
+  *known = true;
+  return Status::OK();
+}
+
 Status DiskRowSet::CountRows(const IOContext* io_context, rowid_t *count) const {
   DCHECK(open_);
   rowid_t num_rows = num_rows_.load();
@@ -767,6 +904,7 @@ void DiskRowSet::GetDiskRowSetSpaceUsage(DiskRowSetSpace* drss) const {
   drss->base_data_size = base_data_->OnDiskDataSize();
   drss->bloom_size = base_data_->BloomFileOnDiskSize();
   drss->ad_hoc_index_size = base_data_->AdhocIndexOnDiskSize();
+  drss->secondary_index_size = base_data_->SecondaryIndexOnDiskSize();
   drss->redo_deltas_size = delta_tracker_->RedoDeltaOnDiskSize();
   drss->undo_deltas_size = delta_tracker_->UndoDeltaOnDiskSize();
 }
@@ -825,7 +963,9 @@ size_t DiskRowSet::CountDeltaStores() const {
 //  - Major compactions: the score will be the result of sizeof(deltas)/sizeof(base data), unless
 //                       it is smaller than tablet_delta_store_major_compact_min_ratio or if the
 //                       delta files are only composed of deletes, in which case the score is
-//                       brought down to zero.
+//                       brought down to zero. The bytes of deltas which scans read to apply
+//                       updates to the columns with updates, weighted by
+//                       tablet_delta_store_major_compact_scan_weight, count as deltas.
 //  - Minor compactions: the score will be zero if there's only 1 redo file, else it will be the
 //                       result of redo_files_count/tablet_delta_store_minor_compact_max. The
 //                       latter is meant to be high since minor compactions don't give us much, so
@@ -846,7 +986,17 @@ double DiskRowSet::DeltaStoresCompactionPerfImprovementScore(DeltaCompactionType
     if (!col_ids_with_updates.empty()) {
       DiskRowSetSpace drss;
       GetDiskRowSetSpaceUsage(&drss);
-      double ratio = static_cast<double>(drss.redo_deltas_size) / drss.base_data_size;
+      double deltas_size = drss.redo_deltas_size;
+      if (FLAGS_tablet_delta_store_major_compact_scan_weight > 0) {
+        std::map<ColumnId, int64_t> bytes_applied_by_col;
+        delta_tracker_->GetRedoBytesAppliedByScans(&bytes_applied_by_col);
+        int64_t bytes_applied = 0;
+        for (const ColumnId& col_id : col_ids_with_updates) {
+          bytes_applied += FindWithDefault(bytes_applied_by_col, col_id, 0);
+        }
+        deltas_size += FLAGS_tablet_delta_store_major_compact_scan_weight * bytes_applied;
+      }
+      double ratio = deltas_size / drss.base_data_size;
       if (ratio >= FLAGS_tablet_delta_store_major_compact_min_ratio) {
         perf_improv = ratio;
       }
@@ -884,6 +1034,25 @@ Status DiskRowSet::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
                                                  blocks_deleted, bytes_deleted);
 }
 
+int64_t DiskRowSet::EstimateBytesInPartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                                              double min_ancient_ratio) {
+  return delta_tracker_->EstimateBytesInPartiallyAncientUndoDeltas(ancient_history_mark,
+                                                                   min_ancient_ratio);
+}
+
+Status DiskRowSet::RewritePartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                                     double min_ancient_ratio,
+                                                     int64_t max_bytes,
+                                                     const IOContext* io_context,
+                                                     int64_t* blocks_rewritten,
+                                                     int64_t* bytes_rewritten) {
+  TRACE_EVENT0("tablet", "DiskRowSet::RewritePartiallyAncientUndoDeltas");
+  return delta_tracker_->RewritePartiallyAncientUndoDeltas(ancient_history_mark,
+                                                           min_ancient_ratio, max_bytes,
+                                                           io_context, blocks_rewritten,
+                                                           bytes_rewritten);
+}
+
 Status DiskRowSet::DebugDump(vector<string> *lines) {
   // Using CompactionInput to dump our data is an easy way of seeing all the
   // rows and deltas.
@@ -38,6 +38,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/tablet/delta_key.h"
 #include "kudu/tablet/delta_tracker.h"
 #include "kudu/tablet/rowset.h"
@@ -47,6 +48,9 @@
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -55,6 +59,7 @@ class MonoTime;
 class RowBlock;
 class RowChangeList;
 class RowwiseIterator;
+class ScanSpec;
 class Timestamp;
 
 namespace cfile {
@@ -79,6 +84,7 @@ namespace tablet {
 
 class CFileSet;
 class CompactionInput;
+class DeltaApplier;
 class DeltaFileWriter;
 class DeltaStats;
 class HistoryGcOpts;
@@ -90,8 +96,11 @@ class OperationResultPB;
 class DiskRowSetWriter {
  public:
   // TODO: document ownership of rowset_metadata
+  //
+  // If 'prefer_fast_tier' is true, the rowset's blocks are placed in the fast
+  // storage tier if there is one.
   DiskRowSetWriter(RowSetMetadata* rowset_metadata, const Schema* schema,
-                   BloomFilterSizing bloom_sizing);
+                   BloomFilterSizing bloom_sizing, bool prefer_fast_tier = false);
 
   ~DiskRowSetWriter();
 
@@ -143,6 +152,7 @@ class DiskRowSetWriter {
   const Schema* const schema_;
 
   BloomFilterSizing bloom_sizing_;
+  const bool prefer_fast_tier_;
 
   bool finished_;
   rowid_t written_count_;
@@ -152,6 +162,10 @@ class DiskRowSetWriter {
 
   // The last encoded key written.
   faststring last_encoded_key_;
+
+  // The encoded keys of the block being appended, and the arena holding them.
+  Arena key_arena_;
+  std::vector<Slice> encoded_keys_;
 };
 
 
@@ -164,10 +178,12 @@ class RollingDiskRowSetWriter {
  public:
   // Create a new rolling writer. The given 'tablet_metadata' must stay valid
   // for the lifetime of this writer, and is used to construct the new rowsets
-  // that this RollingDiskRowSetWriter creates.
+  // that this RollingDiskRowSetWriter creates. If 'prefer_fast_tier' is true,
+  // they are placed in the fast storage tier if there is one.
   RollingDiskRowSetWriter(TabletMetadata* tablet_metadata, const Schema& schema,
                           BloomFilterSizing bloom_sizing,
-                          size_t target_rowset_size);
+                          size_t target_rowset_size,
+                          bool prefer_fast_tier = false);
   ~RollingDiskRowSetWriter();
 
   Status Open();
@@ -245,6 +261,7 @@ class RollingDiskRowSetWriter {
   std::shared_ptr<RowSetMetadata> cur_drs_metadata_;
   const BloomFilterSizing bloom_sizing_;
   const size_t target_rowset_size_;
+  const bool prefer_fast_tier_;
 
   gscoped_ptr<DiskRowSetWriter> cur_writer_;
 
@@ -282,6 +299,7 @@ class RollingDiskRowSetWriter {
 //   - base data
 //   - bloom file
 //   - ad hoc index
+//   - secondary indexes
 // - delta files
 //   - UNDO deltas
 //   - REDO deltas
@@ -290,12 +308,13 @@ struct DiskRowSetSpace {
   uint64_t base_data_size;
   uint64_t bloom_size;
   uint64_t ad_hoc_index_size;
+  uint64_t secondary_index_size;
   uint64_t redo_deltas_size;
   uint64_t undo_deltas_size;
 
   // Helper method to compute the size of the diskrowset's underlying cfile set.
   uint64_t CFileSetOnDiskSize() {
-    return base_data_size + bloom_size + ad_hoc_index_size;
+    return base_data_size + bloom_size + ad_hoc_index_size + secondary_index_size;
   }
 };
 
@@ -352,12 +371,42 @@ class DiskRowSet : public RowSet {
   Status CheckRowPresent(const RowSetKeyProbe &probe, const fs::IOContext* io_context,
                          bool *present, ProbeStats* stats) const override;
 
+  // Consults the bloom filter of the base data for all the keys at once.
+  Status CheckRowsMayBePresent(const RowSetKeyProbe* const* probes,
+                               size_t n,
+                               const fs::IOContext* io_context,
+                               bool* maybe_present,
+                               ProbeStats* const* stats) const override;
+
   ////////////////////
   // Read functions.
   ////////////////////
   virtual Status NewRowIterator(const RowIteratorOptions& opts,
                                 gscoped_ptr<RowwiseIterator>* out) const override;
 
+  // Like NewRowIterator(), but for point lookups of many keys of the rowset:
+  // the returned iterator is initialized, and is positioned on the row of
+  // each key in turn with '*applier', which it reads from.
+  Status NewKeyLookupIterator(const RowIteratorOptions& opts,
+                              gscoped_ptr<RowwiseIterator>* out,
+                              DeltaApplier** applier) const;
+
+  // Consults the statistics of the base data's columns, for the columns
+  // which the delta stores don't update.
+  bool MayMatchScanSpec(const RowIteratorOptions& opts,
+                        const ScanSpec& spec) const override;
+
+  // Returns the statistics of the base data's column, if the delta stores
+  // don't update it.
+  bool GetColumnStatsForScan(const RowIteratorOptions& opts,
+                             int col_idx,
+                             cfile::ZoneMapEntryPB* stats) const override;
+
+  // Consults the timestamp ranges of the delta stores. Every row of a
+  // DiskRowSet has an UNDO for its insertion, so the delta stores cover the
+  // insertions too.
+  bool MayHaveChangesInDiffScan(const RowIteratorOptions& opts) const override;
+
   virtual Status NewCompactionInput(const Schema* projection,
                                     const MvccSnapshot &snap,
                                     const fs::IOContext* io_context,
@@ -367,6 +416,12 @@ class DiskRowSet : public RowSet {
   // yet set, consults the base data and stores the result in 'num_rows_'.
   Status CountRows(const fs::IOContext* io_context, rowid_t *count) const final override;
 
+  // The live rows can be counted without scanning if none of the rowset's
+  // REDO deltas delete rows, in which case all the base data's rows are live.
+  Status CountLiveRowsFromMetadata(const fs::IOContext* io_context,
+                                   bool* known,
+                                   rowid_t* count) const override;
+
   // See RowSet::GetBounds(...)
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const override;
@@ -403,6 +458,16 @@ class DiskRowSet : public RowSet {
   Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark, const fs::IOContext* io_context,
                                  int64_t* blocks_deleted, int64_t* bytes_deleted) override;
 
+  int64_t EstimateBytesInPartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                                    double min_ancient_ratio) override;
+
+  Status RewritePartiallyAncientUndoDeltas(Timestamp ancient_history_mark,
+                                           double min_ancient_ratio,
+                                           int64_t max_bytes,
+                                           const fs::IOContext* io_context,
+                                           int64_t* blocks_rewritten,
+                                           int64_t* bytes_rewritten) override;
+
   // Major compacts all the delta files for all the columns.
   Status MajorCompactDeltaStores(const fs::IOContext* io_context, HistoryGcOpts history_gc_opts);
 
@@ -418,6 +483,12 @@ class DiskRowSet : public RowSet {
     has_been_compacted_.store(true);
   }
 
+  // Returns how long it's been since the rowset was last scanned, or since
+  // it was opened if it hasn't been scanned since.
+  MonoDelta TimeSinceLastScan() const {
+    return MonoDelta::FromMicroseconds(GetMonoTimeMicros() - last_scan_micros_.load());
+  }
+
   DeltaTracker *delta_tracker() {
     return DCHECK_NOTNULL(delta_tracker_.get());
   }
@@ -490,6 +561,10 @@ class DiskRowSet : public RowSet {
   // and thus should not be scheduled for further compactions.
   std::atomic<bool> has_been_compacted_;
 
+  // The monotonic time, in microseconds, at which the rowset was last
+  // scanned or opened.
+  mutable std::atomic<int64_t> last_scan_micros_;
+
   DISALLOW_COPY_AND_ASSIGN(DiskRowSet);
 };
 
@@ -0,0 +1,126 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/hot_key_tracker.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+class HotKeyTrackerTest : public KuduTest {
+};
+
+// With no sampling, the counts of keys which were never evicted are exact.
+TEST_F(HotKeyTrackerTest, TestExactCounts) {
+  HotKeyTracker tracker(4, 1, MonoDelta::FromSeconds(3600));
+  ASSERT_EQ(0, tracker.HottestKeyShare());
+  ASSERT_TRUE(tracker.HottestKeys(10).empty());
+
+  for (int i = 0; i < 3; i++) tracker.Record("a");
+  tracker.Record("b");
+  vector<string> keys = { "c", "c" };
+  tracker.RecordBatch(keys.size(), [&](int i) { return Slice(keys[i]); });
+
+  ASSERT_EQ(6, tracker.total_count());
+  vector<HotKeyTracker::HotKey> hot = tracker.HottestKeys(10);
+  ASSERT_EQ(3, hot.size());
+  ASSERT_EQ("a", hot[0].key);
+  ASSERT_EQ(3, hot[0].count);
+  ASSERT_EQ(0, hot[0].max_error);
+  ASSERT_EQ("c", hot[1].key);
+  ASSERT_EQ(2, hot[1].count);
+  ASSERT_EQ("b", hot[2].key);
+  ASSERT_EQ(1, hot[2].count);
+  ASSERT_DOUBLE_EQ(0.5, tracker.HottestKeyShare());
+
+  ASSERT_EQ(1, tracker.HottestKeys(1).size());
+}
+
+// A key which gets a large share of the accesses is tracked first, however
+// many other keys are accessed, and the counts bound the actual accesses.
+TEST_F(HotKeyTrackerTest, TestSkewedKeyIsFound) {
+  const int kCapacity = 8;
+  HotKeyTracker tracker(kCapacity, 1, MonoDelta::FromSeconds(3600));
+  int64_t hot_accesses = 0;
+  for (int i = 0; i < 10000; i++) {
+    if (i % 4 == 0) {
+      tracker.Record("hot");
+      hot_accesses++;
+    } else {
+      tracker.Record(Substitute("cold-$0", i));
+    }
+  }
+  vector<HotKeyTracker::HotKey> hot = tracker.HottestKeys(kCapacity);
+  ASSERT_EQ(kCapacity, hot.size());
+  ASSERT_EQ("hot", hot[0].key);
+  ASSERT_GE(hot[0].count, hot_accesses);
+  ASSERT_LE(hot[0].count - hot[0].max_error, hot_accesses);
+  for (const auto& key : hot) {
+    ASSERT_LE(key.max_error, tracker.total_count() / kCapacity);
+  }
+  double share = tracker.HottestKeyShare();
+  ASSERT_GT(share, 0.1);
+  ASSERT_LE(share, 0.25);
+}
+
+// Sampled accesses are recorded with the sampling rate as their weight.
+TEST_F(HotKeyTrackerTest, TestSampling) {
+  const int kSampleRate = 16;
+  HotKeyTracker tracker(4, kSampleRate, MonoDelta::FromSeconds(3600));
+  const int kBatchSize = kSampleRate * 100;
+  tracker.RecordBatch(kBatchSize, [](int /*i*/) { return Slice("a"); });
+  ASSERT_EQ(kBatchSize, tracker.total_count());
+  vector<HotKeyTracker::HotKey> hot = tracker.HottestKeys(10);
+  ASSERT_EQ(1, hot.size());
+  ASSERT_EQ(kBatchSize, hot[0].count);
+  ASSERT_DOUBLE_EQ(1, tracker.HottestKeyShare());
+}
+
+// The counts are halved every decay interval, and the keys whose counts drop
+// to zero are forgotten.
+TEST_F(HotKeyTrackerTest, TestDecay) {
+  const MonoDelta kDecayInterval = MonoDelta::FromMilliseconds(100);
+  HotKeyTracker tracker(4, 1, kDecayInterval);
+  for (int i = 0; i < 8; i++) tracker.Record("a");
+  tracker.Record("b");
+  SleepFor(MonoDelta::FromMilliseconds(150));
+  tracker.Record("c");
+  ASSERT_EQ(5, tracker.total_count());
+  vector<HotKeyTracker::HotKey> hot = tracker.HottestKeys(10);
+  ASSERT_EQ(2, hot.size());
+  ASSERT_EQ("a", hot[0].key);
+  ASSERT_EQ(4, hot[0].count);
+  ASSERT_EQ("c", hot[1].key);
+  ASSERT_EQ(1, hot[1].count);
+}
+
+} // namespace tablet
+} // namespace kudu
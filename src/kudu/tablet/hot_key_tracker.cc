@@ -0,0 +1,144 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/hot_key_tracker.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/walltime.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+HotKeyTracker::HotKeyTracker(int capacity, int sample_rate, MonoDelta decay_interval)
+    : capacity_(capacity),
+      sample_rate_(sample_rate),
+      decay_interval_(decay_interval),
+      rand_(GetCurrentTimeMicros()),
+      total_count_(0),
+      last_decay_(MonoTime::Now()) {
+  CHECK_GT(capacity_, 0);
+  CHECK_GT(sample_rate_, 0);
+}
+
+void HotKeyTracker::RecordBatch(int num_accesses, const std::function<Slice(int)>& key_at) {
+  // Sample every 'sample_rate_'-th access from a random offset, so that a
+  // batch smaller than the rate is sampled in proportion to its size.
+  int first = sample_rate_ == 1 ? 0 : rand_.Uniform(sample_rate_);
+  if (first >= num_accesses) {
+    return;
+  }
+  vector<Slice> keys;
+  keys.reserve((num_accesses - first + sample_rate_ - 1) / sample_rate_);
+  for (int i = first; i < num_accesses; i += sample_rate_) {
+    keys.push_back(key_at(i));
+  }
+
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  MaybeDecayUnlocked(now);
+  for (const Slice& key : keys) {
+    RecordUnlocked(key, sample_rate_);
+  }
+}
+
+void HotKeyTracker::RecordUnlocked(const Slice& key, int64_t weight) {
+  total_count_ += weight;
+  string key_str = key.ToString();
+  auto it = counters_.find(key_str);
+  if (it != counters_.end()) {
+    it->second.count += weight;
+    return;
+  }
+  if (counters_.size() < static_cast<size_t>(capacity_)) {
+    counters_.emplace(std::move(key_str), Counter{ weight, 0 });
+    return;
+  }
+  // Replace the least accessed key, which the new key may have been
+  // mistaken for all along.
+  auto min_it = std::min_element(
+      counters_.begin(), counters_.end(),
+      [](const std::pair<const string, Counter>& a, const std::pair<const string, Counter>& b) {
+        return a.second.count < b.second.count;
+      });
+  int64_t min_count = min_it->second.count;
+  counters_.erase(min_it);
+  counters_.emplace(std::move(key_str), Counter{ min_count + weight, min_count });
+}
+
+void HotKeyTracker::MaybeDecayUnlocked(MonoTime now) {
+  if (now - last_decay_ < decay_interval_) {
+    return;
+  }
+  last_decay_ = now;
+  total_count_ /= 2;
+  for (auto it = counters_.begin(); it != counters_.end();) {
+    it->second.count /= 2;
+    it->second.max_error /= 2;
+    if (it->second.count == 0) {
+      it = counters_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+vector<HotKeyTracker::HotKey> HotKeyTracker::HottestKeys(int n) const {
+  vector<HotKey> keys;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    keys.reserve(counters_.size());
+    for (const auto& entry : counters_) {
+      keys.push_back({ entry.first, entry.second.count, entry.second.max_error });
+    }
+  }
+  auto hotter = [](const HotKey& a, const HotKey& b) {
+    return a.count > b.count || (a.count == b.count && a.key < b.key);
+  };
+  if (keys.size() > static_cast<size_t>(n)) {
+    std::partial_sort(keys.begin(), keys.begin() + n, keys.end(), hotter);
+    keys.resize(n);
+  } else {
+    std::sort(keys.begin(), keys.end(), hotter);
+  }
+  return keys;
+}
+
+int64_t HotKeyTracker::total_count() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return total_count_;
+}
+
+double HotKeyTracker::HottestKeyShare() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  int64_t max_count = 0;
+  for (const auto& entry : counters_) {
+    // Only count the accesses the key is known to have had.
+    max_count = std::max(max_count, entry.second.count - entry.second.max_error);
+  }
+  return total_count_ == 0 ? 0 : static_cast<double>(max_count) / total_count_;
+}
+
+} // namespace tablet
+} // namespace kudu
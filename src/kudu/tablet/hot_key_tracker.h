@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+namespace tablet {
+
+// Tracks the keys of a tablet which are accessed the most, with the
+// Space-Saving algorithm: at most 'capacity' keys are counted, and an access
+// to an untracked key replaces the least accessed tracked key, inheriting its
+// count. A key's count thus overestimates its accesses by at most the count
+// it inherited, and any key which gets more than 1/capacity of the accesses
+// is guaranteed to be tracked.
+//
+// To keep the overhead low, only one in 'sample_rate' accesses is recorded,
+// with a weight of 'sample_rate'. The counts are halved every
+// 'decay_interval', so that the tracker follows the recent load.
+//
+// This class is thread-safe.
+class HotKeyTracker {
+ public:
+  HotKeyTracker(int capacity, int sample_rate, MonoDelta decay_interval);
+
+  // Records a batch of 'num_accesses' accesses, where the key of the i-th
+  // access is 'key_at(i)'. The keys are only looked up for the sampled
+  // accesses.
+  void RecordBatch(int num_accesses, const std::function<Slice(int)>& key_at);
+
+  // Records a single access of 'key'.
+  void Record(const Slice& key) {
+    RecordBatch(1, [&](int /*i*/) { return key; });
+  }
+
+  struct HotKey {
+    std::string key;
+
+    // The estimated number of accesses, and by how much it may overestimate
+    // the actual number.
+    int64_t count;
+    int64_t max_error;
+  };
+
+  // Returns up to 'n' of the tracked keys, the most accessed first.
+  std::vector<HotKey> HottestKeys(int n) const;
+
+  // Returns the estimated number of accesses recorded, decayed as the counts.
+  int64_t total_count() const;
+
+  // Returns the share of the accesses which are known to have gone to the
+  // most accessed key, between 0 and 1: its count minus the count it may
+  // have inherited, over the total.
+  double HottestKeyShare() const;
+
+ private:
+  struct Counter {
+    int64_t count;
+    int64_t max_error;
+  };
+
+  // Records an access of 'key' with weight 'weight'.
+  void RecordUnlocked(const Slice& key, int64_t weight);
+
+  // Halves the counts if 'decay_interval_' has elapsed since they were last
+  // halved.
+  void MaybeDecayUnlocked(MonoTime now);
+
+  const int capacity_;
+  const int sample_rate_;
+  const MonoDelta decay_interval_;
+
+  // Picks the first access of each batch which is sampled.
+  ThreadSafeRandom rand_;
+
+  mutable simple_spinlock lock_;
+  std::unordered_map<std::string, Counter> counters_;
+  int64_t total_count_;
+  MonoTime last_decay_;
+
+  DISALLOW_COPY_AND_ASSIGN(HotKeyTracker);
+};
+
+} // namespace tablet
+} // namespace kudu
@@ -125,6 +125,12 @@ class LocalTabletWriter {
     return result_.ops(result_.ops_size() - 1);
   }
 
+  // Return the results of the row operations of the last write, in the order
+  // the operations were passed to WriteBatch().
+  const TxResultPB& result() const {
+    return result_;
+  }
+
  private:
   Tablet* const tablet_;
   const Schema* client_schema_;
@@ -35,6 +35,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
 
@@ -62,6 +63,14 @@ class LockManagerTest : public KuduTest {
               lock_manager_.TryLock(key, kFakeTransaction, LockManager::LOCK_EXCLUSIVE, &entry));
   }
 
+  void VerifyUnlocked(const Slice& key) {
+    LockEntry *entry;
+    LockManager::LockStatus ls =
+        lock_manager_.TryLock(key, kFakeTransaction, LockManager::LOCK_EXCLUSIVE, &entry);
+    ASSERT_EQ(LockManager::LOCK_ACQUIRED, ls);
+    lock_manager_.Release(entry, ls);
+  }
+
   LockManager lock_manager_;
 };
 
@@ -117,6 +126,53 @@ TEST_F(LockManagerTest, TestMoveLock) {
   ASSERT_FALSE(row_lock.acquired()); // NOLINT(bugprone-use-after-move)
 }
 
+TEST_F(LockManagerTest, TestLockBatch) {
+  // The batch may lock the same row more than once.
+  vector<Slice> keys = { "c", "a", "b", "a" };
+  {
+    vector<ScopedRowLock> locks(keys.size());
+    lock_manager_.LockBatch(keys.data(), keys.size(), kFakeTransaction,
+                            LockManager::LOCK_EXCLUSIVE, locks.data());
+    for (const auto& l : locks) {
+      ASSERT_TRUE(l.acquired());
+    }
+    for (const auto& key : keys) {
+      NO_FATALS(VerifyAlreadyLocked(key));
+    }
+
+    // Locks from a batch can be released one by one.
+    locks[0].Release();
+    NO_FATALS(VerifyUnlocked(keys[0]));
+    locks[1].Release();
+    NO_FATALS(VerifyAlreadyLocked(keys[3]));
+  }
+  for (const auto& key : keys) {
+    NO_FATALS(VerifyUnlocked(key));
+  }
+}
+
+// Lock enough rows in one batch that the shards of the lock table need to
+// be resized.
+TEST_F(LockManagerTest, TestLockLargeBatch) {
+  vector<string> key_strings;
+  for (int i = 0; i < 10000; i++) {
+    key_strings.push_back(StringPrintf("key%05d", i));
+  }
+  vector<Slice> keys(key_strings.begin(), key_strings.end());
+  {
+    vector<ScopedRowLock> locks(keys.size());
+    lock_manager_.LockBatch(keys.data(), keys.size(), kFakeTransaction,
+                            LockManager::LOCK_EXCLUSIVE, locks.data());
+    for (size_t i = 0; i < keys.size(); i += 100) {
+      ASSERT_TRUE(locks[i].acquired());
+      NO_FATALS(VerifyAlreadyLocked(keys[i]));
+    }
+  }
+  for (size_t i = 0; i < keys.size(); i += 100) {
+    NO_FATALS(VerifyUnlocked(keys[i]));
+  }
+}
+
 class LmTestResource {
  public:
   explicit LmTestResource(const Slice* id)
@@ -157,8 +213,9 @@ class LmTestResource {
 class LmTestThread {
  public:
   LmTestThread(LockManager* manager, vector<const Slice*> keys,
-               const vector<LmTestResource*> resources)
-      : manager_(manager), keys_(std::move(keys)), resources_(resources) {}
+               const vector<LmTestResource*> resources, bool use_batch = false)
+      : manager_(manager), keys_(std::move(keys)), resources_(resources),
+        use_batch_(use_batch) {}
 
   void Start() {
     CHECK_OK(kudu::Thread::Create("test", "test", &LmTestThread::Run, this, &thread_));
@@ -168,13 +225,27 @@ class LmTestThread {
     tid_ = Env::Default()->gettid();
     const TransactionState* my_txn = reinterpret_cast<TransactionState*>(tid_);
 
-    std::sort(keys_.begin(), keys_.end());
+    // Batches are locked in a consistent order by the lock manager, but
+    // single locks have to be sorted here to avoid deadlocks.
+    if (!use_batch_) {
+      std::sort(keys_.begin(), keys_.end());
+    }
+    vector<Slice> batch_keys;
+    for (const Slice* key : keys_) {
+      batch_keys.push_back(*key);
+    }
     for (int i = 0; i < FLAGS_num_iterations; i++) {
       std::vector<shared_ptr<ScopedRowLock> > locks;
-      // TODO: We don't have an API for multi-row
-      for (const Slice* key : keys_) {
-        locks.push_back(std::make_shared<ScopedRowLock>(
-            manager_, my_txn, *key, LockManager::LOCK_EXCLUSIVE));
+      vector<ScopedRowLock> batch_locks;
+      if (use_batch_) {
+        batch_locks.resize(batch_keys.size());
+        manager_->LockBatch(batch_keys.data(), batch_keys.size(), my_txn,
+                            LockManager::LOCK_EXCLUSIVE, batch_locks.data());
+      } else {
+        for (const Slice* key : keys_) {
+          locks.push_back(std::make_shared<ScopedRowLock>(
+              manager_, my_txn, *key, LockManager::LOCK_EXCLUSIVE));
+        }
       }
 
       for (LmTestResource* r : resources_) {
@@ -199,6 +270,7 @@ class LmTestThread {
   LockManager* manager_;
   vector<const Slice*> keys_;
   const vector<LmTestResource*> resources_;
+  const bool use_batch_;
   uint64_t tid_;
   scoped_refptr<kudu::Thread> thread_;
 };
@@ -267,6 +339,35 @@ TEST_F(LockManagerTest, TestContention) {
   runPerformanceTest("Contended", &threads);
 }
 
+// Like TestContention, but each thread locks its rows in one batch, in an
+// arbitrary order.
+TEST_F(LockManagerTest, TestContentionBatch) {
+  Slice slice_a("a");
+  LmTestResource resource_a(&slice_a);
+  Slice slice_b("b");
+  LmTestResource resource_b(&slice_b);
+  Slice slice_c("c");
+  LmTestResource resource_c(&slice_c);
+  vector<shared_ptr<LmTestThread> > threads;
+  for (int i = 0; i < FLAGS_num_test_threads; ++i) {
+    vector<LmTestResource*> resources;
+    if (i % 3 == 0) {
+      resources = { &resource_a, &resource_b };
+    } else if (i % 3 == 1) {
+      resources = { &resource_c, &resource_b };
+    } else {
+      resources = { &resource_a, &resource_c, &resource_b };
+    }
+    vector<const Slice*> keys;
+    for (const auto* r : resources) {
+      keys.push_back(r->id());
+    }
+    threads.push_back(std::make_shared<LmTestThread>(
+        &lock_manager_, keys, resources, /*use_batch=*/true));
+  }
+  runPerformanceTest("Contended batch", &threads);
+}
+
 // Test running a bunch of threads at once that want different
 // resources.
 TEST_F(LockManagerTest, TestUncontended) {
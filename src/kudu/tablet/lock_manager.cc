@@ -17,10 +17,13 @@
 
 #include "kudu/tablet/lock_manager.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <mutex>
+#include <numeric>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -100,6 +103,13 @@ class LockEntry {
   const TransactionState* holder_;
 };
 
+// A hash table of the entries of the locked rows.
+//
+// The table is split into shards by the top bits of the keys' hashes, each
+// with its own bucket array, item count, and reader-writer lock (taken for
+// write only when the shard's bucket array is resized). Threads which lock
+// different rows thus rarely touch the same cache lines, and a batch of
+// locks takes each shard's lock once (see GetLockEntries()).
 class LockTable {
  private:
   struct Bucket {
@@ -109,33 +119,72 @@ class LockTable {
     Bucket() : chain_head(nullptr) {}
   };
 
+  struct Shard {
+    Shard() : mask(0), size(0), item_count(0) {}
+
+    // shard rwlock used as write on resize
+    rw_spinlock lock;
+    // size - 1 used to lookup the bucket (hash & mask)
+    uint64_t mask;
+    // number of buckets in the shard
+    uint64_t size;
+    // shard buckets
+    gscoped_array<Bucket> buckets;
+    // number of items in the shard
+    base::subtle::Atomic64 item_count;
+  };
+
+  // Pad the shards so that neighbouring shards don't share cache lines.
+  struct PaddedShard : public Shard {
+    char padding[CACHELINE_SIZE - (sizeof(Shard) % CACHELINE_SIZE)];
+  };
+
+  static constexpr int kNumShardBits = 4;
+  static constexpr int kNumShards = 1 << kNumShardBits;
+
  public:
-  LockTable() : mask_(0), size_(0), item_count_(0) {
-    Resize();
+  LockTable() {
+    for (auto& shard : shards_) {
+      Resize(&shard);
+    }
   }
 
   ~LockTable() {
     // Sanity checks: The table shouldn't be destructed when there are any entries in it.
-    DCHECK_EQ(0, NoBarrier_Load(&(item_count_))) << "There are some unreleased locks";
-    for (size_t i = 0; i < size_; ++i) {
-      for (LockEntry *p = buckets_[i].chain_head; p != nullptr; p = p->ht_next_) {
-        DCHECK(p == nullptr) << "The entry " << p->ToString() << " was not released";
+    for (const auto& shard : shards_) {
+      DCHECK_EQ(0, NoBarrier_Load(&(shard.item_count))) << "There are some unreleased locks";
+      for (size_t i = 0; i < shard.size; ++i) {
+        for (LockEntry *p = shard.buckets[i].chain_head; p != nullptr; p = p->ht_next_) {
+          DCHECK(p == nullptr) << "The entry " << p->ToString() << " was not released";
+        }
       }
     }
   }
 
   LockEntry *GetLockEntry(const Slice &key);
+
+  // Get the entries for the 'n' 'keys', setting 'entries[i]' to the entry
+  // of 'keys[i]'. Also sets 'order' to the indexes of the keys sorted by
+  // their hashes and then by the keys themselves, which is the order in
+  // which the shards are visited.
+  void GetLockEntries(const Slice* keys, size_t n, LockEntry** entries,
+                      std::vector<size_t>* order);
+
   void ReleaseLockEntry(LockEntry *entry);
 
  private:
-  Bucket *FindBucket(uint64_t hash) const {
-    return &(buckets_[hash & mask_]);
+  Shard *FindShard(uint64_t hash) {
+    return &shards_[hash >> (64 - kNumShardBits)];
+  }
+
+  static Bucket *FindBucket(const Shard *shard, uint64_t hash) {
+    return &(shard->buckets[hash & shard->mask]);
   }
 
   // Return a pointer to slot that points to a lock entry that
   // matches key/hash. If there is no such lock entry, return a
   // pointer to the trailing slot in the corresponding linked list.
-  LockEntry **FindSlot(Bucket *bucket, const Slice& key, uint64_t hash) const {
+  static LockEntry **FindSlot(Bucket *bucket, const Slice& key, uint64_t hash) {
     LockEntry **node = &(bucket->chain_head);
     while (*node && !(*node)->Equals(key, hash)) {
       node = &((*node)->ht_next_);
@@ -146,7 +195,7 @@ class LockTable {
   // Return a pointer to slot that points to a lock entry that
   // matches the specified 'entry'.
   // If there is no such lock entry, NULL is returned.
-  LockEntry **FindEntry(Bucket *bucket, LockEntry *entry) const {
+  static LockEntry **FindEntry(Bucket *bucket, LockEntry *entry) {
     for (LockEntry **node = &(bucket->chain_head); *node != nullptr; node = &((*node)->ht_next_)) {
       if (*node == entry) {
         return node;
@@ -155,64 +204,111 @@ class LockTable {
     return nullptr;
   }
 
-  void Resize();
+  // Return the entry in 'shard' with the same key as 'new_entry', taking a
+  // reference to it, or insert 'new_entry' and return it if there is no such
+  // entry. The shard's lock must be held in shared mode.
+  static LockEntry *InsertOrRefUnlocked(Shard *shard, LockEntry *new_entry);
 
- private:
-  // table rwlock used as write on resize
-  percpu_rwlock lock_;
-  // size - 1 used to lookup the bucket (hash & mask_)
-  uint64_t mask_;
-  // number of buckets in the table
-  uint64_t size_;
-  // table buckets
-  gscoped_array<Bucket> buckets_;
-  // number of items in the table
-  base::subtle::Atomic64 item_count_;
-};
+  // Account for 'count' entries inserted into 'shard', resizing it if it's
+  // too full.
+  static void AddItems(Shard *shard, int64_t count);
 
-LockEntry *LockTable::GetLockEntry(const Slice& key) {
-  auto new_entry = new LockEntry(key);
-  LockEntry *old_entry;
+  static void Resize(Shard *shard);
 
-  {
-    shared_lock<rw_spinlock> l(lock_.get_lock());
-    Bucket *bucket = FindBucket(new_entry->key_hash_);
-    {
-      std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
-      LockEntry **node = FindSlot(bucket, new_entry->key_, new_entry->key_hash_);
-      old_entry = *node;
-      if (old_entry != nullptr) {
-        old_entry->refs_++;
-      } else {
-        new_entry->ht_next_ = nullptr;
-        new_entry->CopyKey();
-        *node = new_entry;
-      }
-    }
-  }
+  PaddedShard shards_[kNumShards];
+};
 
+LockEntry *LockTable::InsertOrRefUnlocked(Shard *shard, LockEntry *new_entry) {
+  Bucket *bucket = FindBucket(shard, new_entry->key_hash_);
+  std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
+  LockEntry **node = FindSlot(bucket, new_entry->key_, new_entry->key_hash_);
+  LockEntry *old_entry = *node;
   if (old_entry != nullptr) {
-    delete new_entry;
+    old_entry->refs_++;
     return old_entry;
   }
+  new_entry->ht_next_ = nullptr;
+  new_entry->CopyKey();
+  *node = new_entry;
+  return new_entry;
+}
 
-  if (base::subtle::NoBarrier_AtomicIncrement(&item_count_, 1) > size_) {
-    std::unique_lock<percpu_rwlock> table_wrlock(lock_, std::try_to_lock);
+void LockTable::AddItems(Shard *shard, int64_t count) {
+  if (base::subtle::NoBarrier_AtomicIncrement(&shard->item_count, count) > shard->size) {
+    std::unique_lock<rw_spinlock> shard_wrlock(shard->lock, std::try_to_lock);
     // if we can't take the lock, means that someone else is resizing.
-    // (The percpu_rwlock try_lock waits for readers to complete)
-    if (table_wrlock.owns_lock()) {
-      Resize();
+    // (The rw_spinlock try_lock waits for readers to complete)
+    if (shard_wrlock.owns_lock()) {
+      Resize(shard);
     }
   }
+}
+
+LockEntry *LockTable::GetLockEntry(const Slice& key) {
+  auto new_entry = new LockEntry(key);
+  Shard *shard = FindShard(new_entry->key_hash_);
+  LockEntry *entry;
+  {
+    shared_lock<rw_spinlock> l(shard->lock);
+    entry = InsertOrRefUnlocked(shard, new_entry);
+  }
 
+  if (entry != new_entry) {
+    delete new_entry;
+    return entry;
+  }
+  AddItems(shard, 1);
   return new_entry;
 }
 
+void LockTable::GetLockEntries(const Slice* keys, size_t n, LockEntry** entries,
+                               std::vector<size_t>* order) {
+  for (size_t i = 0; i < n; i++) {
+    entries[i] = new LockEntry(keys[i]);
+  }
+  order->resize(n);
+  std::iota(order->begin(), order->end(), 0);
+  std::sort(order->begin(), order->end(), [&](size_t a, size_t b) {
+    if (entries[a]->key_hash_ != entries[b]->key_hash_) {
+      return entries[a]->key_hash_ < entries[b]->key_hash_;
+    }
+    return entries[a]->key_.compare(entries[b]->key_) < 0;
+  });
+
+  // Since the shard is picked by the top bits of the hash, the keys of each
+  // shard are now contiguous.
+  size_t run_start = 0;
+  while (run_start < n) {
+    Shard *shard = FindShard(entries[(*order)[run_start]]->key_hash_);
+    size_t run_end = run_start;
+    int64_t inserted = 0;
+    {
+      shared_lock<rw_spinlock> l(shard->lock);
+      for (; run_end < n && FindShard(entries[(*order)[run_end]]->key_hash_) == shard;
+           run_end++) {
+        size_t idx = (*order)[run_end];
+        LockEntry *entry = InsertOrRefUnlocked(shard, entries[idx]);
+        if (entry != entries[idx]) {
+          delete entries[idx];
+          entries[idx] = entry;
+        } else {
+          inserted++;
+        }
+      }
+    }
+    if (inserted > 0) {
+      AddItems(shard, inserted);
+    }
+    run_start = run_end;
+  }
+}
+
 void LockTable::ReleaseLockEntry(LockEntry *entry) {
+  Shard *shard = FindShard(entry->key_hash_);
   bool removed = false;
   {
-    std::lock_guard<rw_spinlock> table_rdlock(lock_.get_lock());
-    Bucket *bucket = FindBucket(entry->key_hash_);
+    shared_lock<rw_spinlock> l(shard->lock);
+    Bucket *bucket = FindBucket(shard, entry->key_hash_);
     {
       std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
       LockEntry **node = FindEntry(bucket, entry);
@@ -229,18 +325,18 @@ void LockTable::ReleaseLockEntry(LockEntry *entry) {
   }
 
   DCHECK(removed) << "Unable to find LockEntry on release";
-  base::subtle::NoBarrier_AtomicIncrement(&item_count_, -1);
+  base::subtle::NoBarrier_AtomicIncrement(&shard->item_count, -1);
   delete entry;
 }
 
-void LockTable::Resize() {
-  // Calculate a new table size
+void LockTable::Resize(Shard *shard) {
+  // Calculate a new shard size
   size_t new_size = 16;
-  while (new_size < base::subtle::NoBarrier_Load(&item_count_)) {
+  while (new_size < base::subtle::NoBarrier_Load(&shard->item_count)) {
     new_size <<= 1;
   }
 
-  if (PREDICT_FALSE(size_ >= new_size))
+  if (PREDICT_FALSE(shard->size >= new_size))
     return;
 
   // Allocate a new bucket list
@@ -248,8 +344,8 @@ void LockTable::Resize() {
   size_t new_mask = new_size - 1;
 
   // Copy entries
-  for (size_t i = 0; i < size_; ++i) {
-    LockEntry *p = buckets_[i].chain_head;
+  for (size_t i = 0; i < shard->size; ++i) {
+    LockEntry *p = shard->buckets[i].chain_head;
     while (p != nullptr) {
       LockEntry *next = p->ht_next_;
 
@@ -263,9 +359,9 @@ void LockTable::Resize() {
   }
 
   // Swap the bucket
-  mask_ = new_mask;
-  size_ = new_size;
-  buckets_.swap(new_buckets);
+  shard->mask = new_mask;
+  shard->size = new_size;
+  shard->buckets.swap(new_buckets);
 }
 
 // ============================================================================
@@ -289,6 +385,18 @@ ScopedRowLock::ScopedRowLock(LockManager *manager,
   }
 }
 
+ScopedRowLock::ScopedRowLock(LockManager *manager,
+                             LockEntry *entry,
+                             LockManager::LockStatus ls)
+  : manager_(DCHECK_NOTNULL(manager)),
+    acquired_(ls == LockManager::LOCK_ACQUIRED),
+    entry_(entry),
+    ls_(ls) {
+  // As in the other constructor, a batch waits for its locks rather than
+  // returning LOCK_BUSY.
+  CHECK_NE(ls_, LockManager::LOCK_BUSY);
+}
+
 ScopedRowLock::ScopedRowLock(ScopedRowLock&& other) noexcept {
   TakeState(&other);
 }
@@ -337,11 +445,33 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
                                           LockManager::LockMode mode,
                                           LockEntry** entry) {
   *entry = locks_->GetLockEntry(key);
+  return AcquireEntry(key, tx, *entry);
+}
+
+void LockManager::LockBatch(const Slice* keys,
+                            size_t n,
+                            const TransactionState* tx,
+                            LockManager::LockMode mode,
+                            ScopedRowLock* locks) {
+  std::vector<LockEntry*> entries(n);
+  std::vector<size_t> order;
+  locks_->GetLockEntries(keys, n, entries.data(), &order);
+
+  // Acquire the locks in the same order for every batch, so that concurrent
+  // batches which lock overlapping sets of rows can't deadlock.
+  for (size_t idx : order) {
+    LockStatus ls = AcquireEntry(keys[idx], tx, entries[idx]);
+    locks[idx] = ScopedRowLock(this, entries[idx], ls);
+  }
+}
 
+LockManager::LockStatus LockManager::AcquireEntry(const Slice& key,
+                                                  const TransactionState* tx,
+                                                  LockEntry* entry) {
   // We expect low contention, so just try to try_lock first. This is faster
   // than a timed_lock, since we don't have to do a syscall to get the current
   // time.
-  if (!(*entry)->sem.TryAcquire()) {
+  if (!entry->sem.TryAcquire()) {
     // If the current holder of this lock is the same transaction just return
     // a LOCK_ALREADY_ACQUIRED status without actually acquiring the mutex.
     //
@@ -351,8 +481,8 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     // obtained and released at the same time). If at any time in the future
     // we opt to perform more fine grained locking, possibly letting transactions
     // release a portion of the locks they no longer need, this no longer is OK.
-    if (ANNOTATE_UNPROTECTED_READ((*entry)->holder_) == tx) {
-      (*entry)->recursion_++;
+    if (ANNOTATE_UNPROTECTED_READ(entry->holder_) == tx) {
+      entry->recursion_++;
       return LOCK_ACQUIRED;
     }
 
@@ -360,11 +490,14 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     // warn if it takes a long time.
     // TODO: would be nice to hook in some histogram metric about lock acquisition
     // time. For now we just associate with per-request metrics.
+    if (before_wait_cb_) {
+      before_wait_cb_();
+    }
     TRACE_COUNTER_INCREMENT("row_lock_wait_count", 1);
     MicrosecondsInt64 start_wait_us = GetMonoTimeMicros();
     int waited_seconds = 0;
-    while (!(*entry)->sem.TimedAcquire(MonoDelta::FromSeconds(1))) {
-      const TransactionState* cur_holder = ANNOTATE_UNPROTECTED_READ((*entry)->holder_);
+    while (!entry->sem.TimedAcquire(MonoDelta::FromSeconds(1))) {
+      const TransactionState* cur_holder = ANNOTATE_UNPROTECTED_READ(entry->holder_);
       LOG(WARNING) << "Waited " << (++waited_seconds) << " seconds to obtain row lock on key "
                    << KUDU_REDACT(key.ToDebugString()) << " cur holder: " << cur_holder;
       // TODO(unknown): would be nice to also include some info about the blocking transaction,
@@ -378,7 +511,7 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     }
   }
 
-  (*entry)->holder_ = tx;
+  entry->holder_ = tx;
   return LOCK_ACQUIRED;
 }
 
@@ -18,6 +18,8 @@
 #define KUDU_TABLET_LOCK_MANAGER_H
 
 #include <cstddef>
+#include <functional>
+#include <utility>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/util/slice.h"
@@ -26,6 +28,7 @@ namespace kudu { namespace tablet {
 
 class LockTable;
 class LockEntry;
+class ScopedRowLock;
 class TransactionState;
 
 // Super-simple lock manager implementation. This only supports exclusive
@@ -49,18 +52,43 @@ class LockManager {
     LOCK_EXCLUSIVE
   };
 
+  // Lock the rows of the 'n' 'keys' on behalf of 'tx', waiting for the locks
+  // which are held by other transactions, and set 'locks[i]' to hold the lock
+  // on 'keys[i]'. The keys must remain valid and un-changed for as long as
+  // the locks are held.
+  //
+  // This is equivalent to constructing a ScopedRowLock for each key, except
+  // that each shard of the lock table is only visited once, and that the
+  // locks are acquired in a consistent order, so that batches which lock
+  // overlapping sets of rows don't deadlock each other.
+  void LockBatch(const Slice* keys, size_t n, const TransactionState* tx,
+                 LockMode mode, ScopedRowLock* locks);
+
+  // Sets a function to call before waiting for a lock which is held by
+  // another transaction, e.g. to let go of what the holder may be waiting
+  // for. It must not take row locks itself. An empty function unsets it.
+  //
+  // Not thread-safe: this must not be called while locks are being taken.
+  void set_before_wait_callback(std::function<void()> cb) {
+    before_wait_cb_ = std::move(cb);
+  }
+
  private:
   friend class ScopedRowLock;
   friend class LockManagerTest;
 
   LockStatus Lock(const Slice& key, const TransactionState* tx,
                   LockMode mode, LockEntry **entry);
+  // Acquire 'entry', which was obtained from the lock table for 'key'.
+  LockStatus AcquireEntry(const Slice& key, const TransactionState* tx, LockEntry* entry);
   LockStatus TryLock(const Slice& key, const TransactionState* tx,
                      LockMode mode, LockEntry **entry);
   void Release(LockEntry *lock, LockStatus ls);
 
   LockTable *locks_;
 
+  std::function<void()> before_wait_cb_;
+
   DISALLOW_COPY_AND_ASSIGN(LockManager);
 };
 
@@ -116,6 +144,12 @@ class ScopedRowLock {
   ~ScopedRowLock();
 
  private:
+  friend class LockManager;
+
+  // Hold 'entry', which was locked by LockManager::LockBatch() with the
+  // status 'ls'.
+  ScopedRowLock(LockManager *manager, LockEntry *entry, LockManager::LockStatus ls);
+
   void TakeState(ScopedRowLock* other);
 
   LockManager *manager_;
@@ -31,10 +31,13 @@
 
 #include "kudu/clock/clock.h"
 #include "kudu/clock/logical_clock.h"
+#include "kudu/codegen/compilation_manager.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/consensus/log_anchor_registry.h"
@@ -287,6 +290,41 @@ TEST_F(TestMemRowSet, TestInsertAndIterate) {
   ASSERT_FALSE(iter->HasNext());
 }
 
+// Test that the insertion timestamps of the rows, which are stored relative to
+// the first row's, come back intact, including ones older than the first.
+TEST_F(TestMemRowSet, TestInsertionTimestampDeltas) {
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+  ASSERT_EQ(0, mrs->memory_footprint_per_row());
+
+  const vector<Timestamp> timestamps = {
+    Timestamp(1000000), Timestamp(999990), Timestamp(1000001), Timestamp(1ULL << 50)
+  };
+  for (int i = 0; i < timestamps.size(); i++) {
+    RowBuilder rb(schema_);
+    string key = StringPrintf("row%d", i);
+    rb.AddString(Slice(key));
+    rb.AddUint32(i);
+    ASSERT_OK(mrs->Insert(timestamps[i], rb.row(), op_id_));
+  }
+  ASSERT_EQ(timestamps[0], mrs->base_timestamp());
+  ASSERT_GT(mrs->memory_footprint_per_row(), 0);
+
+  gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator());
+  ASSERT_OK(iter->Init(nullptr));
+  for (int i = 0; i < timestamps.size(); i++) {
+    SCOPED_TRACE(i);
+    ASSERT_TRUE(iter->HasNext());
+    MRSRow row = iter->GetCurrentRow();
+    EXPECT_EQ(timestamps[i], row.insertion_timestamp());
+    EXPECT_EQ(StringPrintf(R"((string key="row%d", uint32 val=%d))", i, i),
+              schema_.DebugRow(row));
+    iter->Next();
+  }
+  ASSERT_FALSE(iter->HasNext());
+}
+
 TEST_F(TestMemRowSet, TestInsertAndIterateCompoundKey) {
 
   SchemaBuilder builder;
@@ -773,5 +811,67 @@ TEST_F(TestMemRowSet, TestScanVirtualColumnIsDeleted) {
   }
 }
 
+// Test that scans with a projection that doesn't include all of the columns
+// apply only the updated values of the projected columns.
+TEST_F(TestMemRowSet, TestScanPartialProjectionWithMutations) {
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+  ASSERT_OK(GenerateTestData(mrs.get()));
+
+  RowIteratorOptions opts;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+
+  Schema val_projection;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "val" }, &val_projection));
+  opts.projection = &val_projection;
+  vector<string> rows;
+  ASSERT_OK(DumpRowSet(*mrs, opts, &rows));
+  ASSERT_EQ((vector<string>{ "(uint32 val=0)", "(uint32 val=1)",
+                             "(uint32 val=2)", "(uint32 val=3)" }),
+            rows);
+
+  opts.projection = &key_schema_;
+  ASSERT_OK(DumpRowSet(*mrs, opts, &rows));
+  ASSERT_EQ((vector<string>{ R"((string key="row 0"))", R"((string key="row 1"))",
+                             R"((string key="row 4"))", R"((string key="row 5"))" }),
+            rows);
+}
+
+// Test that the iterator takes over the evaluation of the scan's predicates
+// once generated code is available for them, with the same results as the
+// caller's evaluation.
+TEST_F(TestMemRowSet, TestScanWithCodegennedPredicates) {
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+  ASSERT_OK(GenerateTestData(mrs.get()));
+
+  RowIteratorOptions opts;
+  opts.projection = &schema_;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  const uint32_t lower = 1;
+  const uint32_t upper = 3;
+  for (int i = 0; i < 2; i++) {
+    SCOPED_TRACE(i);
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, &upper));
+    gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator(opts));
+    ASSERT_OK(iter->Init(&spec));
+    if (i == 0) {
+      // The first scan requests the compilation, and leaves the predicates to
+      // the caller in the meantime unless the code was already cached.
+      codegen::CompilationManager::GetSingleton()->Wait();
+      continue;
+    }
+    ASSERT_TRUE(spec.predicates().empty());
+    vector<string> rows;
+    ASSERT_OK(IterateToStringList(iter.get(), &rows));
+    ASSERT_EQ((vector<string>{ R"((string key="row 1", uint32 val=1))",
+                               R"((string key="row 4", uint32 val=2))" }),
+              rows);
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
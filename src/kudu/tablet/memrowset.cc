@@ -27,7 +27,9 @@
 #include <glog/logging.h>
 
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
@@ -45,6 +47,7 @@
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.pb.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/memory.h"
@@ -103,8 +106,17 @@ Status MemRowSet::Create(int64_t id,
                          LogAnchorRegistry* log_anchor_registry,
                          shared_ptr<MemTracker> parent_tracker,
                          shared_ptr<MemRowSet>* mrs) {
+  return Create(id, schema, log_anchor_registry, std::move(parent_tracker), -1, mrs);
+}
+
+Status MemRowSet::Create(int64_t id,
+                         const Schema &schema,
+                         LogAnchorRegistry* log_anchor_registry,
+                         shared_ptr<MemTracker> parent_tracker,
+                         int numa_node,
+                         shared_ptr<MemRowSet>* mrs) {
   shared_ptr<MemRowSet> local_mrs(new MemRowSet(
-      id, schema, log_anchor_registry, std::move(parent_tracker)));
+      id, schema, log_anchor_registry, std::move(parent_tracker), numa_node));
 
   mrs->swap(local_mrs);
   return Status::OK();
@@ -113,19 +125,29 @@ Status MemRowSet::Create(int64_t id,
 MemRowSet::MemRowSet(int64_t id,
                      const Schema &schema,
                      LogAnchorRegistry* log_anchor_registry,
-                     shared_ptr<MemTracker> parent_tracker)
+                     shared_ptr<MemTracker> parent_tracker,
+                     int numa_node)
   : id_(id),
     schema_(schema),
+    numa_allocator_(numa_node < 0 ? nullptr :
+                    new NumaBufferAllocator(ArenaComponentAllocator::Get(), numa_node)),
     allocator_(new MemoryTrackingBufferAllocator(
-        HeapBufferAllocator::Get(),
+        numa_allocator_ ? static_cast<BufferAllocator*>(numa_allocator_.get()) :
+                          ArenaComponentAllocator::Get(),
         CreateMemTrackerForMemRowSet(id, std::move(parent_tracker)))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
     tree_(arena_),
     debug_insert_count_(0),
     debug_update_count_(0),
+    num_rows_(0),
+    base_timestamp_(Timestamp::kInvalidTimestamp.value()),
     anchorer_(log_anchor_registry, Substitute("MemRowSet-$0", id_)),
     has_been_compacted_(false) {
   CHECK(schema.has_column_ids());
+  if (ArenaComponentAllocator::Get()->huge_pages_enabled()) {
+    // Let the arena grow into components that are backed by huge pages.
+    arena_->SetMaxBufferSize(ArenaComponentAllocator::kHugePageSize);
+  }
   ANNOTATE_BENIGN_RACE(&debug_insert_count_, "insert count isnt accurate");
   ANNOTATE_BENIGN_RACE(&debug_update_count_, "update count isnt accurate");
 }
@@ -153,14 +175,19 @@ Status MemRowSet::DebugDump(vector<string> *lines) {
 Status MemRowSet::Insert(Timestamp timestamp,
                          const ConstContiguousRow& row,
                          const OpId& op_id) {
+  faststring enc_key_buf;
+  schema_.EncodeComparableKey(row, &enc_key_buf);
+  return Insert(timestamp, row, Slice(enc_key_buf), op_id);
+}
+
+Status MemRowSet::Insert(Timestamp timestamp,
+                         const ConstContiguousRow& row,
+                         const Slice& enc_key,
+                         const OpId& op_id) {
   CHECK(row.schema()->has_column_ids());
   DCHECK_SCHEMA_EQ(schema_, *row.schema());
 
   {
-    faststring enc_key_buf;
-    schema_.EncodeComparableKey(row, &enc_key_buf);
-    Slice enc_key(enc_key_buf);
-
     btree::PreparedMutation<MSBTreeTraits> mutation(enc_key);
     mutation.Prepare(&tree_);
 
@@ -181,11 +208,24 @@ Status MemRowSet::Insert(Timestamp timestamp,
       return Reinsert(timestamp, row, &ms_row);
     }
 
+    // The first row's timestamp becomes the base of the others'. Concurrent
+    // first inserts race to set it, and all of them use the winner's.
+    uint64_t base = Timestamp::kInvalidTimestamp.value();
+    base_timestamp_.compare_exchange_strong(base, timestamp.value());
+    uint64_t encoded_delta = MRSRow::EncodeTimestampDelta(base_timestamp(), timestamp);
+
     // Copy the non-encoded key onto the stack since we need
     // to mutate it when we relocate its Slices into our arena.
-    DEFINE_MRSROW_ON_STACK(this, mrsrow, mrsrow_slice);
-    mrsrow.header_->insertion_timestamp = timestamp;
-    mrsrow.header_->redo_head = nullptr;
+    const size_t row_size = ContiguousRowHelper::row_size(schema_);
+    alignas(MRSRow::Header) uint8_t storage[sizeof(MRSRow::Header) + row_size +
+                                            MRSRow::kMaxTimestampDeltaSize];
+    reinterpret_cast<MRSRow::Header*>(storage)->redo_head = nullptr;
+    uint8_t* row_data = storage + sizeof(MRSRow::Header);
+    Slice row_slice(row_data, row_size);
+    ContiguousRowHelper::InitNullsBitmap(schema_, row_slice);
+    uint8_t* end = EncodeVarint64(row_data + row_size, encoded_delta);
+    Slice mrsrow_slice(storage, end - storage);
+    MRSRow mrsrow(this, mrsrow_slice);
     RETURN_NOT_OK(mrsrow.CopyRow(row, arena_.get()));
 
     CHECK(mutation.Insert(mrsrow_slice))
@@ -194,6 +234,7 @@ Status MemRowSet::Insert(Timestamp timestamp,
   }
 
   anchorer_.AnchorIfMinimum(op_id.index());
+  num_rows_.fetch_add(1, std::memory_order_relaxed);
 
   debug_insert_count_++;
   return Status::OK();
@@ -427,6 +468,12 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
   RETURN_NOT_OK(projector_->Init());
   RETURN_NOT_OK(delta_projector_.Init());
 
+  projection_idx_by_base_idx_.assign(memrowset_->schema_nonvirtual().num_columns(),
+                                     Schema::kColumnNotFound);
+  for (const auto& mapping : projector_->base_cols_mapping()) {
+    projection_idx_by_base_idx_[mapping.second] = mapping.first;
+  }
+
   if (spec && spec->lower_bound_key()) {
     bool exact;
     const Slice &lower_bound = spec->lower_bound_key()->encoded_key();
@@ -443,6 +490,26 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
     exclusive_upper_bound_.reset(upper_bound);
   }
 
+  // If the predicates can be evaluated by generated code, take them over from
+  // the caller. Otherwise, e.g. while the code is being compiled, they're left
+  // in 'spec' to be evaluated by the caller.
+  if (FLAGS_mrs_use_codegen && spec && !spec->predicates().empty()) {
+    vector<ColumnPredicate> predicates;
+    bool all_projected = true;
+    for (const auto& col_pred : spec->predicates()) {
+      if (opts_.projection->find_column(col_pred.first) == Schema::kColumnNotFound) {
+        all_projected = false;
+        break;
+      }
+      predicates.push_back(col_pred.second);
+    }
+    if (all_projected &&
+        codegen::CompilationManager::GetSingleton()->RequestPredicateEvaluator(
+            opts_.projection, predicates, &predicate_evaluator_)) {
+      spec->RemovePredicates();
+    }
+  }
+
   state_ = kScanning;
   return Status::OK();
 }
@@ -500,6 +567,9 @@ Status MemRowSet::Iterator::NextBlock(RowBlock *dst) {
   // Clear unreached bits by resizing
   dst->Resize(fetched);
 
+  if (predicate_evaluator_) {
+    predicate_evaluator_->Evaluate(*dst, dst->selection_vector());
+  }
   return Status::OK();
 }
 
@@ -618,15 +688,30 @@ Status MemRowSet::Iterator::ApplyMutationsToProjectedRow(
         decoder.TwiddleDeleteStatus(&is_deleted);
       }
 
-      // TODO(todd): this is slow, since it makes multiple passes through the rowchangelist.
-      // Instead, we should keep the backwards mapping of columns.
-      for (const RowProjector::ProjectionIdxMapping& mapping : projector_->base_cols_mapping()) {
-        RowChangeListDecoder decoder(mut->changelist());
-        RETURN_NOT_OK(decoder.Init());
-        ColumnBlock dst_col = dst_row->column_block(mapping.first);
-        RETURN_NOT_OK(decoder.ApplyToOneColumn(dst_row->row_index(), &dst_col,
-                                               memrowset_->schema_nonvirtual(),
-                                               mapping.second, dst_arena));
+      // Decode the changelist once, applying only the updates to columns in
+      // the projection. Updates to other columns are skipped without being
+      // validated or copied.
+      if (projector_->base_cols_mapping().empty()) {
+        continue;
+      }
+      const Schema& base_schema = memrowset_->schema_nonvirtual();
+      while (decoder.HasNext()) {
+        RowChangeListDecoder::DecodedUpdate dec;
+        RETURN_NOT_OK(decoder.DecodeNext(&dec));
+        int base_idx = base_schema.find_column_by_id(dec.col_id);
+        if (base_idx == Schema::kColumnNotFound) {
+          continue;
+        }
+        int proj_idx = projection_idx_by_base_idx_[base_idx];
+        if (proj_idx == Schema::kColumnNotFound) {
+          continue;
+        }
+        const ColumnSchema& col_schema = base_schema.column(base_idx);
+        const void* new_val;
+        RETURN_NOT_OK(dec.ValidateColumn(col_schema, &new_val));
+        SimpleConstCell src(&col_schema, new_val);
+        ColumnBlock::Cell dst_cell = dst_row->cell(proj_idx);
+        RETURN_NOT_OK(CopyCell(src, &dst_cell, dst_arena));
       }
     }
   }
@@ -40,6 +40,7 @@
 #include "kudu/tablet/concurrent_btree.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
@@ -50,12 +51,17 @@ namespace kudu {
 
 class MemTracker;
 class MemoryTrackingBufferAllocator;
+class NumaBufferAllocator;
 class RowBlock;
 class RowBlockRow;
 class RowChangeList;
 class ScanSpec;
 struct IteratorStats;
 
+namespace codegen {
+class PredicateEvaluator;
+}  // namespace codegen
+
 namespace fs {
 struct IOContext;
 }  // namespace fs
@@ -94,17 +100,11 @@ class MRSRow {
  public:
   typedef ContiguousRowCell<MRSRow> Cell;
 
-  MRSRow(const MemRowSet *memrowset, const Slice &s) {
-    DCHECK_GE(s.size(), sizeof(Header));
-    row_slice_ = s;
-    header_ = reinterpret_cast<Header *>(row_slice_.mutable_data());
-    row_slice_.remove_prefix(sizeof(Header));
-    memrowset_ = memrowset;
-  }
+  MRSRow(const MemRowSet *memrowset, const Slice &s);
 
   const Schema* schema() const;
 
-  Timestamp insertion_timestamp() const { return header_->insertion_timestamp; }
+  Timestamp insertion_timestamp() const { return insertion_timestamp_; }
 
   Mutation* redo_head() { return header_->redo_head; }
 
@@ -166,19 +166,44 @@ class MRSRow {
     return kudu::RelocateIndirectDataToArena(this, arena);
   }
 
+  // The row's header. It is followed by the row data and then by the varint
+  // encoding of the row's insertion timestamp, relative to the MemRowSet's
+  // base timestamp (see EncodeTimestampDelta()). The timestamp comes last so
+  // that the row data stays word-aligned.
+  //
+  // The delta of a row inserted within a few minutes of the first row of its
+  // MemRowSet takes 5 or 6 bytes rather than the 8 bytes of a full timestamp.
+  // Together with the arena's 8-byte alignment of the rows, a narrow row
+  // usually saves a word.
   struct Header {
-    // Timestamp for the transaction which inserted this row. If a scanner with an
-    // older snapshot sees this row, it will be ignored.
-    Timestamp insertion_timestamp;
-
     // Pointer to the first mutation which has been applied to this row. Each
     // mutation is an instance of the Mutation class, making up a singly-linked
     // list for any mutations applied to the row.
     Mutation* redo_head;
   };
 
+  // The longest encoding of a timestamp delta.
+  static const int kMaxTimestampDeltaSize = 10;
+
+  // Return the zigzag encoding of the difference between 'timestamp' and
+  // 'base', so that timestamps slightly older than the base, which concurrent
+  // inserts may have, encode as short as the newer ones.
+  static uint64_t EncodeTimestampDelta(Timestamp base, Timestamp timestamp) {
+    int64_t delta = static_cast<int64_t>(timestamp.value() - base.value());
+    return (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+  }
+
+  static Timestamp DecodeTimestampDelta(Timestamp base, uint64_t encoded) {
+    uint64_t delta = (encoded >> 1) ^ -(encoded & 1);
+    return Timestamp(base.value() + delta);
+  }
+
   Header *header_;
 
+  // Timestamp for the transaction which inserted this row. If a scanner with an
+  // older snapshot sees this row, it will be ignored.
+  Timestamp insertion_timestamp_;
+
   // Actual row data.
   Slice row_slice_;
 
@@ -186,21 +211,19 @@ class MRSRow {
 };
 
 struct MSBTreeTraits : public btree::BTreeTraits {
+  enum TraitConstants {
+    // Encoded keys of up to 15 bytes, e.g. a single BIGINT key or two INT32
+    // keys, are stored inline in the nodes. Longer keys keep their first 8
+    // bytes inline, so that searching a node rarely follows the keys'
+    // pointers. The nodes are twice as large as the default ones to hold
+    // the larger keys with a somewhat larger fanout.
+    kInternalNodeSize = 8 * CACHELINE_SIZE,
+    kLeafNodeSize = 8 * CACHELINE_SIZE,
+    kKeySliceSize = 2 * sizeof(void*)
+  };
   typedef ThreadSafeMemoryTrackingArena ArenaType;
 };
 
-// Define an MRSRow instance using on-stack storage.
-// This defines an array on the stack which is sized correctly for an MRSRow::Header
-// plus a single row of the given schema, then constructs an MRSRow object which
-// points into that stack storage.
-#define DEFINE_MRSROW_ON_STACK(memrowset, varname, slice_name) \
-  size_t varname##_size = sizeof(MRSRow::Header) + \
-                           ContiguousRowHelper::row_size((memrowset)->schema_nonvirtual()); \
-  uint8_t varname##_storage[varname##_size]; \
-  Slice slice_name(varname##_storage, varname##_size); \
-  ContiguousRowHelper::InitNullsBitmap((memrowset)->schema_nonvirtual(), slice_name); \
-  MRSRow varname(memrowset, slice_name);
-
 
 // In-memory storage for data currently being written to the tablet.
 // This is a holding area for inserts, currently held in row form
@@ -218,6 +241,15 @@ class MemRowSet : public RowSet,
                        std::shared_ptr<MemTracker> parent_tracker,
                        std::shared_ptr<MemRowSet>* mrs);
 
+  // Like the above, but asks the kernel to place the memory of the MemRowSet
+  // on NUMA node 'numa_node', unless it is -1.
+  static Status Create(int64_t id,
+                       const Schema &schema,
+                       log::LogAnchorRegistry* log_anchor_registry,
+                       std::shared_ptr<MemTracker> parent_tracker,
+                       int numa_node,
+                       std::shared_ptr<MemRowSet>* mrs);
+
   ~MemRowSet();
 
   // Insert a new row into the memrowset.
@@ -234,6 +266,13 @@ class MemRowSet : public RowSet,
                 const ConstContiguousRow& row,
                 const consensus::OpId& op_id);
 
+  // Like the above, but uses 'encoded_key', which must be the encoded
+  // primary key of 'row', rather than encoding it again.
+  Status Insert(Timestamp timestamp,
+                const ConstContiguousRow& row,
+                const Slice& encoded_key,
+                const consensus::OpId& op_id);
+
 
   // Update or delete an existing row in the memrowset.
   //
@@ -312,6 +351,14 @@ class MemRowSet : public RowSet,
     return arena_->memory_footprint();
   }
 
+  // Return the memory footprint of this memrowset divided by the number of
+  // rows inserted into it, or 0 if it has no rows. This includes the tree,
+  // the copies of the rows and their mutations.
+  size_t memory_footprint_per_row() const {
+    int64_t num_rows = num_rows_.load(std::memory_order_relaxed);
+    return num_rows > 0 ? memory_footprint() / num_rows : 0;
+  }
+
   // Return an iterator over the items in this memrowset.
   //
   // NOTE: for this function to work, there must be a shared_ptr
@@ -346,6 +393,13 @@ class MemRowSet : public RowSet,
     return id_;
   }
 
+  // Return the timestamp that the insertion timestamps of the rows are
+  // encoded relative to. This is the timestamp of the first inserted row,
+  // or Timestamp::kInvalidTimestamp if no row has been inserted yet.
+  Timestamp base_timestamp() const {
+    return Timestamp(base_timestamp_.load(std::memory_order_acquire));
+  }
+
   std::shared_ptr<RowSetMetadata> metadata() override {
     return std::shared_ptr<RowSetMetadata>(
         reinterpret_cast<RowSetMetadata *>(NULL));
@@ -422,7 +476,8 @@ class MemRowSet : public RowSet,
   MemRowSet(int64_t id,
             const Schema &schema,
             log::LogAnchorRegistry* log_anchor_registry,
-            std::shared_ptr<MemTracker> parent_tracker);
+            std::shared_ptr<MemTracker> parent_tracker,
+            int numa_node);
 
   // Perform a "Reinsert" -- handle an insertion into a row which was previously
   // inserted and deleted, but still has an entry in the MemRowSet.
@@ -435,6 +490,8 @@ class MemRowSet : public RowSet,
   int64_t id_;
 
   const Schema schema_;
+  // Places the arena's buffers on a NUMA node; null if they aren't placed.
+  std::unique_ptr<NumaBufferAllocator> numa_allocator_;
   std::shared_ptr<MemoryTrackingBufferAllocator> allocator_;
   std::shared_ptr<ThreadSafeMemoryTrackingArena> arena_;
 
@@ -448,6 +505,13 @@ class MemRowSet : public RowSet,
   volatile uint64_t debug_insert_count_;
   volatile uint64_t debug_update_count_;
 
+  // The number of rows inserted into the memrowset. Unlike the count above,
+  // this is accurate, but it doesn't count reinsertions of deleted rows.
+  std::atomic<int64_t> num_rows_;
+
+  // See base_timestamp().
+  std::atomic<uint64_t> base_timestamp_;
+
   std::mutex compact_flush_lock_;
 
   log::MinLogIndexAnchorer anchorer_;
@@ -593,6 +657,11 @@ class MemRowSet::Iterator : public RowwiseIterator {
   const gscoped_ptr<MRSRowProjector> projector_;
   DeltaProjector delta_projector_;
 
+  // Mapping from memrowset column index to projected column index, or
+  // kColumnNotFound for columns which aren't projected. Used to apply the
+  // updates of a mutation in a single pass over its changelist.
+  std::vector<int> projection_idx_by_base_idx_;
+
   // The index of the first IS_DELETED virtual column in the projection schema,
   // or kColumnNotFound if one doesn't exist.
   //
@@ -600,6 +669,10 @@ class MemRowSet::Iterator : public RowwiseIterator {
   // The process will crash if these constraints are not met.
   int projection_vc_is_deleted_idx_;
 
+  // The evaluator of the scan's predicates, if they could be code generated.
+  // The predicates are then evaluated here rather than by the caller.
+  gscoped_ptr<codegen::PredicateEvaluator> predicate_evaluator_;
+
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
 
@@ -616,6 +689,20 @@ class MemRowSet::Iterator : public RowwiseIterator {
   boost::optional<const Slice &> exclusive_upper_bound_;
 };
 
+inline MRSRow::MRSRow(const MemRowSet *memrowset, const Slice &s) {
+  const size_t row_size = ContiguousRowHelper::row_size(memrowset->schema_nonvirtual());
+  DCHECK_GT(s.size(), sizeof(Header) + row_size);
+  header_ = reinterpret_cast<Header *>(const_cast<uint8_t*>(s.data()));
+  row_slice_ = Slice(s.data() + sizeof(Header), row_size);
+  uint64_t encoded_delta;
+  const uint8_t* end = GetVarint64Ptr(row_slice_.data() + row_size,
+                                      s.data() + s.size(),
+                                      &encoded_delta);
+  DCHECK(end != nullptr) << "bad timestamp delta in MRSRow";
+  insertion_timestamp_ = DecodeTimestampDelta(memrowset->base_timestamp(), encoded_delta);
+  memrowset_ = memrowset;
+}
+
 inline const Schema* MRSRow::schema() const {
   return &memrowset_->schema_nonvirtual();
 }
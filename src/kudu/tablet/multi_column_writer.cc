@@ -17,11 +17,18 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include <gflags/gflags.h>
+
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/columnblock.h"
@@ -30,25 +37,142 @@
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/tablet/secondary_index.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(tablet_column_write_parallelism, 1,
+             "Number of threads on which the columns of each rowset written by "
+             "a flush or a compaction are encoded and compressed. If 1, all "
+             "columns are written by the thread doing the flush or compaction.");
+TAG_FLAG(tablet_column_write_parallelism, experimental);
+TAG_FLAG(tablet_column_write_parallelism, runtime);
+
+DEFINE_int32(tablet_column_write_threads, 16,
+             "Maximum number of threads, shared by all tablets, which write "
+             "columns when --tablet_column_write_parallelism is greater than 1.");
+TAG_FLAG(tablet_column_write_threads, experimental);
+
+// The number of rows of read defaults appended to a cfile at a time.
+static const size_t kReadDefaultsBatchSize = 1024;
 
 namespace kudu {
 namespace tablet {
 
 using cfile::CFileWriter;
 using fs::BlockCreationTransaction;
+using fs::BlockManager;
 using fs::CreateBlockOptions;
 using fs::WritableBlock;
+using std::string;
 using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+
+// Returns the thread pool, shared by all tablets, on which columns are
+// written in parallel.
+static ThreadPool* ColumnWritePool() {
+  static ThreadPool* pool = [] {
+    gscoped_ptr<ThreadPool> pool;
+    CHECK_OK(ThreadPoolBuilder("column-write")
+             .set_max_threads(FLAGS_tablet_column_write_threads)
+             .Build(&pool));
+    return pool.release();
+  }();
+  return pool;
+}
+
+namespace {
+
+// A block which keeps the cfile of a column of a column group in memory
+// until the cfile is appended to the group's block.
+class BufferedWritableBlock : public WritableBlock {
+ public:
+  explicit BufferedWritableBlock(const WritableBlock* group_block)
+      : group_block_(group_block),
+        state_(CLEAN) {
+  }
+
+  const BlockId& id() const override {
+    return group_block_->id();
+  }
+
+  Status Close() override {
+    state_ = CLOSED;
+    return Status::OK();
+  }
+
+  Status Abort() override {
+    state_ = CLOSED;
+    return Status::OK();
+  }
+
+  BlockManager* block_manager() const override {
+    return group_block_->block_manager();
+  }
+
+  Status Append(const Slice& data) override {
+    return AppendV(ArrayView<const Slice>(&data, 1));
+  }
+
+  Status AppendV(ArrayView<const Slice> data) override {
+    DCHECK(state_ == CLEAN || state_ == DIRTY);
+    for (const Slice& s : data) {
+      data_.append(s.data(), s.size());
+    }
+    state_ = DIRTY;
+    return Status::OK();
+  }
+
+  Status Finalize() override {
+    state_ = FINALIZED;
+    return Status::OK();
+  }
+
+  size_t BytesAppended() const override {
+    return data_.size();
+  }
+
+  State state() const override {
+    return state_;
+  }
+
+  const faststring& data() const {
+    return data_;
+  }
+
+ private:
+  const WritableBlock* const group_block_;
+  State state_;
+  faststring data_;
+};
+
+} // anonymous namespace
 
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
                                      const Schema* schema,
-                                     std::string tablet_id)
+                                     std::string tablet_id,
+                                     std::string table_id,
+                                     bool prefer_fast_tier,
+                                     bool skip_default_only_columns)
   : fs_(fs),
     schema_(schema),
     finished_(false),
-    tablet_id_(std::move(tablet_id)) {
+    parallelism_(1),
+    tablet_id_(std::move(tablet_id)),
+    table_id_(std::move(table_id)),
+    prefer_fast_tier_(prefer_fast_tier),
+    skip_default_only_columns_(skip_default_only_columns),
+    written_count_(0) {
 }
 
 MultiColumnWriter::~MultiColumnWriter() {
@@ -57,9 +181,37 @@ MultiColumnWriter::~MultiColumnWriter() {
 
 Status MultiColumnWriter::Open() {
   CHECK(cfile_writers_.empty());
+  parallelism_ = std::max(1, std::min<int>(FLAGS_tablet_column_write_parallelism,
+                                           schema_->num_columns()));
+
+  const CreateBlockOptions block_opts({ tablet_id_, prefer_fast_tier_ });
+
+  // Find the column groups with several columns, and create their blocks.
+  unordered_map<string, vector<int>> cols_by_group;
+  for (int i = schema_->num_key_columns(); i < schema_->num_columns(); i++) {
+    const string& group = schema_->column(i).attributes().column_group;
+    if (!group.empty()) {
+      cols_by_group[group].push_back(i);
+    }
+  }
+  group_idx_.assign(schema_->num_columns(), -1);
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    const string& group = schema_->column(i).attributes().column_group;
+    const vector<int>* cols = group.empty() ? nullptr : FindOrNull(cols_by_group, group);
+    if (cols == nullptr || cols->size() < 2 || cols->front() != i) {
+      continue;
+    }
+    unique_ptr<WritableBlock> block;
+    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(block_opts, &block),
+                          "Unable to open output file for column group " + group);
+    for (int col_idx : *cols) {
+      group_idx_[col_idx] = group_blocks_.size();
+    }
+    group_blocks_.emplace_back(std::move(block));
+  }
+  ranges_.resize(schema_->num_columns());
 
   // Open columns.
-  const CreateBlockOptions block_opts({ tablet_id_ });
   for (int i = 0; i < schema_->num_columns(); i++) {
     const ColumnSchema &col = schema_->column(i);
 
@@ -71,16 +223,29 @@ Status MultiColumnWriter::Open() {
 
     /// Set the column storage attributes.
     opts.storage_attributes = col.attributes();
+    opts.table_id = table_id_;
 
     // If the schema has a single PK and this is the PK col
     if (i == 0 && schema_->num_key_columns() == 1) {
       opts.write_validx = true;
     }
 
-    // Open file for write.
+    // Key columns are already indexed, so only keep per-block statistics
+    // and bloom filters for the other columns.
+    if (i >= schema_->num_key_columns()) {
+      opts.write_zone_map = true;
+      opts.write_bloom_filter = col.attributes().bloom_filter;
+    }
+
+    // Open file for write. The cfiles of a column group are buffered until
+    // they're appended to the group's block.
     unique_ptr<WritableBlock> block;
-    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(block_opts, &block),
-                          "Unable to open output file for column " + col.ToString());
+    if (group_idx_[i] >= 0) {
+      block.reset(new BufferedWritableBlock(group_blocks_[group_idx_[i]].get()));
+    } else {
+      RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(block_opts, &block),
+                            "Unable to open output file for column " + col.ToString());
+    }
     BlockId block_id(block->id());
 
     // Create the CFile writer itself.
@@ -89,42 +254,199 @@ Status MultiColumnWriter::Open() {
         col.type_info(),
         col.is_nullable(),
         std::move(block)));
+    if (group_idx_[i] >= 0) {
+      writer->AddMetadataPair(cfile::kSharedBlockMetaEntryName, col.attributes().column_group);
+    }
     RETURN_NOT_OK_PREPEND(writer->Start(),
                           "Unable to Start() writer for column " + col.ToString());
 
     cfile_writers_.push_back(writer.release());
     block_ids_.push_back(block_id);
+
+    unique_ptr<SecondaryIndexBuilder> index_builder;
+    if (i >= schema_->num_key_columns() && col.attributes().secondary_index) {
+      index_builder.reset(new SecondaryIndexBuilder(col.type_info()));
+    }
+    index_builders_.emplace_back(std::move(index_builder));
+  }
+  index_block_ids_.resize(schema_->num_columns());
+
+  default_only_.assign(schema_->num_columns(), false);
+  if (skip_default_only_columns_) {
+    for (int i = schema_->num_key_columns(); i < schema_->num_columns(); i++) {
+      const ColumnSchema& col = schema_->column(i);
+      default_only_[i] = group_idx_[i] < 0 && !index_builders_[i] &&
+                         (col.has_read_default() || col.is_nullable());
+    }
   }
   LOG(INFO) << "Opened CFile writers for " << cfile_writers_.size() << " column(s)";
 
   return Status::OK();
 }
 
-Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
-  for (int i = 0; i < schema_->num_columns(); i++) {
-    ColumnBlock column = block.column_block(i);
-    if (column.is_nullable()) {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
-          column.data(), column.nrows()));
+Status MultiColumnWriter::ForEachColumn(const std::function<Status(int)>& f) {
+  const int num_columns = schema_->num_columns();
+  if (parallelism_ <= 1) {
+    for (int i = 0; i < num_columns; i++) {
+      RETURN_NOT_OK(f(i));
+    }
+    return Status::OK();
+  }
+
+  // Group 'g' writes the columns whose index modulo 'parallelism_' is 'g'.
+  vector<Status> statuses(parallelism_);
+  auto write_group = [&](int g) {
+    for (int i = g; i < num_columns; i += parallelism_) {
+      statuses[g] = f(i);
+      if (!statuses[g].ok()) {
+        return;
+      }
+    }
+  };
+  CountDownLatch latch(parallelism_ - 1);
+  for (int g = 1; g < parallelism_; g++) {
+    Status s = ColumnWritePool()->SubmitFunc([&, g]() {
+        write_group(g);
+        latch.CountDown();
+      });
+    if (PREDICT_FALSE(!s.ok())) {
+      write_group(g);
+      latch.CountDown();
+    }
+  }
+  write_group(0);
+  latch.Wait();
+
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  return Status::OK();
+}
+
+bool MultiColumnWriter::AllCellsAreReadDefault(int i, const ColumnBlock& column) const {
+  const ColumnSchema& col = schema_->column(i);
+  const void* read_default = col.has_read_default() ? col.read_default_value() : nullptr;
+  for (size_t row = 0; row < column.nrows(); row++) {
+    bool is_null = column.is_nullable() && column.is_null(row);
+    if (read_default == nullptr) {
+      if (!is_null) {
+        return false;
+      }
+    } else if (is_null || col.type_info()->Compare(column.cell_ptr(row), read_default) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status MultiColumnWriter::AppendReadDefaults(int i, rowid_t count) {
+  const ColumnSchema& col = schema_->column(i);
+  const size_t size = col.type_info()->size();
+  const size_t batch = std::min<size_t>(count, kReadDefaultsBatchSize);
+  faststring data;
+  data.resize(batch * size);
+  faststring non_null_bitmap;
+  non_null_bitmap.resize(BitmapSize(batch));
+  if (col.has_read_default()) {
+    // A copy of a Slice default refers to the default's data, which outlives
+    // the writer.
+    for (size_t row = 0; row < batch; row++) {
+      memcpy(data.data() + row * size, col.read_default_value(), size);
+    }
+    BitmapChangeBits(non_null_bitmap.data(), 0, batch, true);
+  } else {
+    memset(data.data(), 0, data.size());
+    BitmapChangeBits(non_null_bitmap.data(), 0, batch, false);
+  }
+  while (count > 0) {
+    size_t n = std::min<size_t>(count, batch);
+    if (col.is_nullable()) {
+      RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(non_null_bitmap.data(),
+                                                               data.data(), n));
     } else {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
+      RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(data.data(), n));
     }
+    count -= n;
   }
   return Status::OK();
 }
 
+Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
+  RETURN_NOT_OK(ForEachColumn([&](int i) {
+      ColumnBlock column = block.column_block(i);
+      if (default_only_[i]) {
+        if (AllCellsAreReadDefault(i, column)) {
+          return Status::OK();
+        }
+        // Write out the defaults skipped so far, and the column from now on.
+        default_only_[i] = false;
+        RETURN_NOT_OK(AppendReadDefaults(i, written_count_));
+      }
+      if (index_builders_[i]) {
+        index_builders_[i]->AddCells(column, written_count_);
+      }
+      if (column.is_nullable()) {
+        return cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
+            column.data(), column.nrows());
+      }
+      return cfile_writers_[i]->AppendEntries(column.data(), column.nrows());
+    }));
+  written_count_ += block.nrows();
+  return Status::OK();
+}
+
 Status MultiColumnWriter::FinishAndReleaseBlocks(
     BlockCreationTransaction* transaction) {
   CHECK(!finished_);
   for (int i = 0; i < schema_->num_columns(); i++) {
     CFileWriter *writer = cfile_writers_[i];
-    Status s = writer->FinishAndReleaseBlock(transaction);
+    Status s;
+    if (default_only_[i]) {
+      // Nothing was appended to the cfile, so drop its block.
+      unique_ptr<WritableBlock> block;
+      s = writer->FinishAndReleaseBlock(&block);
+      if (s.ok()) {
+        s = block->Abort();
+      }
+    } else if (group_idx_[i] >= 0) {
+      // Move the buffered cfile to the end of the group's block.
+      unique_ptr<WritableBlock> buffered;
+      s = writer->FinishAndReleaseBlock(&buffered);
+      if (s.ok()) {
+        const faststring& data = down_cast<BufferedWritableBlock*>(buffered.get())->data();
+        WritableBlock* group_block = group_blocks_[group_idx_[i]].get();
+        ranges_[i] = { group_block->BytesAppended(), data.size() };
+        s = group_block->Append(Slice(data));
+      }
+    } else {
+      s = writer->FinishAndReleaseBlock(transaction);
+    }
     if (!s.ok()) {
       LOG(WARNING) << "Unable to Finish writer for column " <<
         schema_->column(i).ToString() << ": " << s.ToString();
       return s;
     }
   }
+  for (auto& block : group_blocks_) {
+    RETURN_NOT_OK(block->Finalize());
+    transaction->AddCreatedBlock(std::move(block));
+  }
+  group_blocks_.clear();
+
+  const CreateBlockOptions block_opts({ tablet_id_, prefer_fast_tier_ });
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    if (!index_builders_[i]) {
+      continue;
+    }
+    const ColumnSchema& col = schema_->column(i);
+    unique_ptr<WritableBlock> block;
+    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(block_opts, &block),
+                          "Unable to open secondary index file for column " + col.ToString());
+    index_block_ids_[i] = block->id();
+    RETURN_NOT_OK_PREPEND(index_builders_[i]->FinishAndReleaseBlock(std::move(block),
+                                                                    transaction),
+                          "Unable to write secondary index for column " + col.ToString());
+  }
   finished_ = true;
   return Status::OK();
 }
@@ -133,7 +455,43 @@ void MultiColumnWriter::GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>*
   CHECK(finished_);
   ret->clear();
   for (int i = 0; i < schema_->num_columns(); i++) {
-    (*ret)[schema_->column_id(i)] = block_ids_[i];
+    if (!default_only_[i]) {
+      (*ret)[schema_->column_id(i)] = block_ids_[i];
+    }
+  }
+}
+
+void MultiColumnWriter::GetFlushedColumnStatsByColumnId(
+    std::map<ColumnId, cfile::ZoneMapEntryPB>* ret) const {
+  CHECK(finished_);
+  ret->clear();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    cfile::ZoneMapEntryPB stats;
+    if (!default_only_[i] && cfile_writers_[i]->GetZoneMapSummary(&stats)) {
+      (*ret)[schema_->column_id(i)] = std::move(stats);
+    }
+  }
+}
+
+void MultiColumnWriter::GetFlushedIndexBlocksByColumnId(
+    std::map<ColumnId, BlockId>* ret) const {
+  CHECK(finished_);
+  ret->clear();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    if (index_builders_[i]) {
+      (*ret)[schema_->column_id(i)] = index_block_ids_[i];
+    }
+  }
+}
+
+void MultiColumnWriter::GetFlushedBlockRangesByColumnId(
+    std::map<ColumnId, ColumnBlockRange>* ret) const {
+  CHECK(finished_);
+  ret->clear();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    if (group_idx_[i] >= 0) {
+      (*ret)[schema_->column_id(i)] = ranges_[i];
+    }
   }
 }
 
@@ -18,18 +18,24 @@
 #define KUDU_TABLET_MULTI_COLUMN_WRITER_H
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <glog/logging.h>
 
+#include "kudu/common/rowid.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/tablet/rowset_metadata.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+class ColumnBlock;
 class FsManager;
 class RowBlock;
 class Schema;
@@ -37,21 +43,55 @@ struct ColumnId;
 
 namespace cfile {
 class CFileWriter;
+class ZoneMapEntryPB;
 } // namespace cfile
 
 namespace fs {
 class BlockCreationTransaction;
+class WritableBlock;
 } // namespace fs
 
 namespace tablet {
 
+class SecondaryIndexBuilder;
+
 // Wrapper which writes several columns in parallel corresponding to some
 // Schema. Written blocks will fall in the tablet_id's data dir group.
+//
+// If --tablet_column_write_parallelism is greater than 1, the columns are
+// split into that many groups, which AppendBlock() encodes and compresses
+// concurrently, one group on the calling thread and the others on a thread
+// pool shared by all tablets. Each block is written in full before
+// AppendBlock() returns, so this doesn't buffer any more data than writing
+// the columns serially.
+//
+// The non-key columns with the secondary_index storage attribute also get
+// a secondary index (see secondary_index.h), built from the appended blocks
+// and written by FinishAndReleaseBlocks().
+//
+// The non-key columns which share the column_group storage attribute with
+// other columns of the schema are written to a single block: the cfile of
+// each is buffered in memory, and FinishAndReleaseBlocks() appends them to
+// the group's block one after another.
+//
+// If 'skip_default_only_columns' is true, the non-key columns whose values
+// all equal their read default (or are all null, for a nullable column
+// without a read default) aren't written at all: readers fill in the read
+// default for the columns a rowset has no data for, just like for the
+// columns added after the rowset was written. The values of such a column
+// are only encoded once a value other than the default is appended. The
+// columns of column groups and the columns with a secondary index are always
+// written.
 class MultiColumnWriter {
  public:
+  // If 'prefer_fast_tier' is true, the column blocks are placed in the fast
+  // storage tier if there is one.
   MultiColumnWriter(FsManager* fs,
                     const Schema* schema,
-                    std::string tablet_id);
+                    std::string tablet_id,
+                    std::string table_id,
+                    bool prefer_fast_tier = false,
+                    bool skip_default_only_columns = false);
 
   virtual ~MultiColumnWriter();
 
@@ -75,22 +115,84 @@ class MultiColumnWriter {
     return cfile_writers_[i];
   }
 
-  // Return the block IDs of the written columns, keyed by column ID.
+  // Return the block IDs of the written columns, keyed by column ID. The
+  // default-only columns which were skipped aren't included.
   //
   // REQUIRES: Finish() already called.
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
+  // Return the statistics of the written columns which keep a zone map,
+  // keyed by column ID. See CFileWriter::GetZoneMapSummary().
+  //
+  // REQUIRES: Finish() already called.
+  void GetFlushedColumnStatsByColumnId(
+      std::map<ColumnId, cfile::ZoneMapEntryPB>* ret) const;
+
+  // Return the block IDs of the secondary indexes of the written columns
+  // which have one, keyed by column ID.
+  //
+  // REQUIRES: Finish() already called.
+  void GetFlushedIndexBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
+
+  // Return the ranges of the blocks holding the cfiles of the written
+  // columns which share a block with the rest of their column group, keyed
+  // by column ID.
+  //
+  // REQUIRES: Finish() already called.
+  void GetFlushedBlockRangesByColumnId(std::map<ColumnId, ColumnBlockRange>* ret) const;
+
  private:
+  // Call 'f' with the index of each column, spreading the columns over up to
+  // 'parallelism_' threads. Returns the first non-OK status returned by 'f',
+  // if any, once all the calls returned.
+  Status ForEachColumn(const std::function<Status(int)>& f);
+
+  // Returns whether all the cells of 'column', the 'i'-th column of the
+  // schema, hold the column's read default.
+  bool AllCellsAreReadDefault(int i, const ColumnBlock& column) const;
+
+  // Appends 'count' copies of the read default of the 'i'-th column to its
+  // cfile.
+  Status AppendReadDefaults(int i, rowid_t count);
+
   FsManager* const fs_;
   const Schema* const schema_;
 
   bool finished_;
 
+  // The number of threads which write the columns, set by Open().
+  int parallelism_;
+
   const std::string tablet_id_;
+  const std::string table_id_;
+  const bool prefer_fast_tier_;
+  const bool skip_default_only_columns_;
 
   std::vector<cfile::CFileWriter *> cfile_writers_;
   std::vector<BlockId> block_ids_;
 
+  // The secondary index builder of each column, or null if the column has
+  // no secondary index, and the blocks the indexes were written to.
+  std::vector<std::unique_ptr<SecondaryIndexBuilder>> index_builders_;
+  std::vector<BlockId> index_block_ids_;
+
+  // The block of each column group with several columns, and for each
+  // column, the index of its group in 'group_blocks_' or -1 if its cfile
+  // has its own block. The ranges of the group blocks holding the cfiles
+  // are set by FinishAndReleaseBlocks().
+  std::vector<std::unique_ptr<fs::WritableBlock>> group_blocks_;
+  std::vector<int> group_idx_;
+  std::vector<ColumnBlockRange> ranges_;
+
+  // For each column, whether nothing but its read default was appended to it
+  // so far and it may thus be skipped. Nothing is written to the cfiles of
+  // those columns until a different value shows up. Not a vector<bool>, as
+  // the columns are updated concurrently.
+  std::vector<uint8_t> default_only_;
+
+  // The number of rows appended so far.
+  rowid_t written_count_;
+
   DISALLOW_COPY_AND_ASSIGN(MultiColumnWriter);
 };
 
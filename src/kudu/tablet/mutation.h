@@ -18,6 +18,7 @@
 #ifndef KUDU_TABLET_MUTATION_H
 #define KUDU_TABLET_MUTATION_H
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <new>
@@ -121,7 +122,9 @@ inline Mutation *Mutation::CreateInArena(
   ArenaType *arena, Timestamp timestamp, const RowChangeList &rcl) {
   DCHECK(!rcl.is_null());
 
-  size_t size = sizeof(Mutation) + rcl.slice().size();
+  // The changelist starts right after 'changelist_size_' rather than after
+  // the padding at the end of the class.
+  size_t size = offsetof(Mutation, changelist_data_) + rcl.slice().size();
   void *storage = arena->AllocateBytesAligned(size, BASE_PORT_H_ALIGN_OF(Mutation));
   CHECK(storage) << "failed to allocate storage from arena";
   auto ret = new (storage) Mutation();
@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <atomic>
 #include <mutex>
 #include <ostream>
 #include <string>
@@ -38,6 +39,7 @@
 #include "kudu/util/test_util.h"
 
 using std::thread;
+using std::vector;
 
 namespace kudu {
 namespace tablet {
@@ -782,5 +784,77 @@ TEST_F(MvccTest, TestCorrectInitWithNoTxns) {
   EXPECT_EQ(snap2.committed_timestamps_.size(), 0);
 }
 
+// Test that snapshots taken concurrently with commits, some of which are
+// copied from the published snapshot, always include the transactions which
+// committed before they were taken.
+TEST_F(MvccTest, TestConcurrentSnapshotsAndCommits) {
+  MvccManager mgr;
+  const int kNumTxns = AllowSlowTests() ? 20000 : 2000;
+  const int kNumReaders = 4;
+  std::atomic<int64_t> last_committed(0);
+  std::atomic<bool> done(false);
+
+  vector<thread> readers;
+  for (int i = 0; i < kNumReaders; i++) {
+    readers.emplace_back([&]() {
+      Timestamp prev_clean_time = Timestamp::kMin;
+      while (!done) {
+        int64_t committed = last_committed.load();
+        MvccSnapshot snap;
+        mgr.TakeSnapshot(&snap);
+        if (committed > 0) {
+          CHECK(snap.IsCommitted(Timestamp(committed))) << snap.ToString();
+        }
+        CHECK(!snap.IsCommitted(Timestamp(kNumTxns + 1))) << snap.ToString();
+        CHECK_GE(snap.all_committed_before_, prev_clean_time);
+        prev_clean_time = snap.all_committed_before_;
+      }
+    });
+  }
+
+  for (int i = 1; i <= kNumTxns; i++) {
+    Timestamp ts(i);
+    mgr.StartTransaction(ts);
+    mgr.StartApplyingTransaction(ts);
+    mgr.AdjustSafeTime(ts);
+    mgr.CommitTransaction(ts);
+    last_committed = i;
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  MvccSnapshot snap;
+  mgr.TakeSnapshot(&snap);
+  ASSERT_TRUE(snap.IsCommitted(Timestamp(kNumTxns)));
+  ASSERT_EQ(Timestamp(kNumTxns), mgr.GetCleanTimestamp());
+}
+
+// Snapshots taken while nothing changes are the same, and a commit is seen
+// by the next snapshot.
+TEST_F(MvccTest, TestRepeatedSnapshots) {
+  MvccManager mgr;
+  Timestamp t1 = clock_->Now();
+  Timestamp t2 = clock_->Now();
+  mgr.StartTransaction(t1);
+  mgr.StartTransaction(t2);
+  mgr.StartApplyingTransaction(t2);
+  mgr.CommitTransaction(t2);
+
+  MvccSnapshot snap1(mgr);
+  MvccSnapshot snap2(mgr);
+  ASSERT_EQ(snap1.ToString(), snap2.ToString());
+  ASSERT_FALSE(snap2.IsCommitted(t1));
+  ASSERT_TRUE(snap2.IsCommitted(t2));
+
+  mgr.StartApplyingTransaction(t1);
+  mgr.CommitTransaction(t1);
+  MvccSnapshot snap3(mgr);
+  ASSERT_TRUE(snap3.IsCommitted(t1));
+  ASSERT_TRUE(snap3.IsCommitted(t2));
+  ASSERT_FALSE(snap1.IsCommitted(t1));
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -48,7 +48,10 @@ namespace tablet {
 using strings::Substitute;
 
 MvccManager::MvccManager()
-  : safe_time_(Timestamp::kMin),
+  : cur_snap_epoch_(1),
+    published_snap_epoch_(0),
+    clean_time_(Timestamp::kInitialTimestamp.value()),
+    safe_time_(Timestamp::kMin),
     earliest_in_flight_(Timestamp::kMax),
     open_(true) {
   cur_snap_.all_committed_before_ = Timestamp::kInitialTimestamp;
@@ -171,6 +174,7 @@ void MvccManager::CommitTransactionUnlocked(Timestamp timestamp,
 
   // Add to snapshot's committed list
   cur_snap_.AddCommittedTimestamp(timestamp);
+  BumpSnapshotEpochUnlocked();
 
   // If we're committing the earliest transaction that was in flight,
   // update our cached value.
@@ -183,8 +187,7 @@ void MvccManager::AdvanceEarliestInFlightTimestamp() {
   if (timestamps_in_flight_.empty()) {
     earliest_in_flight_ = Timestamp::kMax;
   } else {
-    earliest_in_flight_ = Timestamp(std::min_element(timestamps_in_flight_.begin(),
-                                                     timestamps_in_flight_.end())->first);
+    earliest_in_flight_ = Timestamp(timestamps_in_flight_.begin()->first);
   }
 }
 
@@ -263,6 +266,8 @@ void MvccManager::AdjustCleanTime() {
   if (cur_snap_.committed_timestamps_.empty()) {
     cur_snap_.none_committed_at_or_after_ = cur_snap_.all_committed_before_;
   }
+  BumpSnapshotEpochUnlocked();
+  clean_time_.store(cur_snap_.all_committed_before_.value(), std::memory_order_release);
 
   // it may also have unblocked some waiters.
   // Check if someone is waiting for transactions to be committed.
@@ -347,17 +352,40 @@ bool MvccManager::AreAllTransactionsCommittedUnlocked(Timestamp ts) const {
 bool MvccManager::AnyApplyingAtOrBeforeUnlocked(Timestamp ts) const {
   // TODO(todd) this is not actually checking on the applying txns, it's checking on
   // _all in-flight_. Is this a bug?
-  for (const InFlightMap::value_type entry : timestamps_in_flight_) {
-    if (entry.first <= ts.value()) {
-      return true;
-    }
-  }
-  return false;
+  return !timestamps_in_flight_.empty() && timestamps_in_flight_.begin()->first <= ts.value();
 }
 
 void MvccManager::TakeSnapshot(MvccSnapshot *snap) const {
-  std::lock_guard<LockType> l(lock_);
-  *snap = cur_snap_;
+  // If the current snapshot hasn't changed since it was last published, copy
+  // the published one. Since the epoch is advanced after 'cur_snap_' changes,
+  // the published snapshot reflects at least all the transactions which had
+  // committed when the epoch was read.
+  uint64_t epoch = cur_snap_epoch_.load(std::memory_order_acquire);
+  std::shared_ptr<const MvccSnapshot> published;
+  {
+    std::lock_guard<simple_spinlock> l(published_snap_lock_);
+    if (published_snap_epoch_ == epoch) {
+      published = published_snap_;
+    }
+  }
+
+  if (!published) {
+    // Otherwise, copy the current snapshot and publish it for the next
+    // callers, unless a more recent one was published in the meantime.
+    auto fresh = std::make_shared<MvccSnapshot>();
+    {
+      std::lock_guard<LockType> l(lock_);
+      *fresh = cur_snap_;
+      epoch = cur_snap_epoch_.load(std::memory_order_relaxed);
+    }
+    published = fresh;
+    std::lock_guard<simple_spinlock> l(published_snap_lock_);
+    if (epoch > published_snap_epoch_) {
+      published_snap_epoch_ = epoch;
+      published_snap_ = std::move(fresh);
+    }
+  }
+  *snap = *published;
 }
 
 Status MvccManager::WaitForSnapshotWithAllCommitted(Timestamp timestamp,
@@ -407,8 +435,7 @@ int MvccManager::CountTransactionsInFlight() const {
 }
 
 Timestamp MvccManager::GetCleanTimestamp() const {
-  std::lock_guard<LockType> l(lock_);
-  return cur_snap_.all_committed_before_;
+  return Timestamp(clean_time_.load(std::memory_order_acquire));
 }
 
 void MvccManager::GetApplyingTransactionsTimestamps(std::vector<Timestamp>* timestamps) const {
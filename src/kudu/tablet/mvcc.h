@@ -18,9 +18,11 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
@@ -117,6 +119,7 @@ class MvccSnapshot {
   FRIEND_TEST(MvccTest, TestMayHaveUncommittedTransactionsBefore);
   FRIEND_TEST(MvccTest, TestWaitUntilAllCommitted_SnapAtTimestampWithInFlights);
   FRIEND_TEST(MvccTest, TestCorrectInitWithNoTxns);
+  FRIEND_TEST(MvccTest, TestConcurrentSnapshotsAndCommits);
 
   bool IsCommittedFallback(const Timestamp& timestamp) const;
 
@@ -237,6 +240,9 @@ class MvccManager {
 
   // Take a snapshot of the current MVCC state, which indicates which
   // transactions have been committed at the time of this call.
+  //
+  // Snapshots taken while the state doesn't change are copied from a shared
+  // immutable snapshot, without taking the lock used by transactions.
   void TakeSnapshot(MvccSnapshot *snapshot) const;
 
   // Take a snapshot of the MVCC state at 'timestamp' (i.e which includes
@@ -350,6 +356,12 @@ class MvccManager {
   // Returns its state.
   TxnState RemoveInFlightAndGetStateUnlocked(Timestamp ts);
 
+  // Advances 'cur_snap_epoch_' after a change to 'cur_snap_'.
+  void BumpSnapshotEpochUnlocked() {
+    cur_snap_epoch_.store(cur_snap_epoch_.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+  }
+
   // Adjusts the clean time, i.e. the timestamp such that all transactions with
   // lower timestamps are committed or aborted, based on which transactions are
   // currently in flight and on what is the latest value of 'safe_time_'.
@@ -370,8 +382,23 @@ class MvccManager {
 
   MvccSnapshot cur_snap_;
 
-  // The set of timestamps corresponding to currently in-flight transactions.
-  typedef std::unordered_map<Timestamp::val_type, TxnState> InFlightMap;
+  // Incremented, with 'lock_' held, whenever 'cur_snap_' changes.
+  std::atomic<uint64_t> cur_snap_epoch_;
+
+  // An immutable copy of 'cur_snap_' as of 'published_snap_epoch_', published
+  // by TakeSnapshot() so that the snapshots taken until 'cur_snap_' changes
+  // again can be copied from it without taking 'lock_'. Protected by
+  // 'published_snap_lock_', which is only held to copy the pointer.
+  mutable simple_spinlock published_snap_lock_;
+  mutable std::shared_ptr<const MvccSnapshot> published_snap_;
+  mutable uint64_t published_snap_epoch_;
+
+  // 'cur_snap_.all_committed_before_', which can be read without 'lock_'.
+  std::atomic<Timestamp::val_type> clean_time_;
+
+  // The set of timestamps corresponding to currently in-flight transactions,
+  // ordered so that the earliest one can be found in constant time.
+  typedef std::map<Timestamp::val_type, TxnState> InFlightMap;
   InFlightMap timestamps_in_flight_;
 
   // A transaction timestamp below which all transactions are either committed or in-flight,
@@ -380,8 +407,7 @@ class MvccManager {
   Timestamp safe_time_;
 
   // The minimum timestamp in timestamps_in_flight_, or Timestamp::kMax
-  // if that set is empty. This is cached in order to avoid having to iterate
-  // over timestamps_in_flight_ on every commit.
+  // if that set is empty.
   Timestamp earliest_in_flight_;
 
   mutable std::vector<WaitingState*> waiters_;
@@ -0,0 +1,138 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/row_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+namespace tablet {
+
+class RowCacheTest : public KuduTest {
+ public:
+  RowCacheTest()
+      : cache_(1024 * 1024, "row_cache-test"),
+        arena_(1024) {
+    SchemaBuilder builder;
+    CHECK_OK(builder.AddKeyColumn("key", INT32));
+    CHECK_OK(builder.AddNullableColumn("val", STRING));
+    schema_ = builder.Build();
+  }
+
+ protected:
+  // Caches the row ('key', 'val') as of 'valid_from', or ('key', NULL) if
+  // 'val' is null, unless the key was invalidated since 'seq' was taken.
+  void InsertRow(int32_t key, const char* val, uint64_t seq, Timestamp valid_from) {
+    RowBlock block(schema_, 1, &arena_);
+    RowBlockRow row = block.row(0);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = key;
+    row.column_block(1).SetCellIsNull(0, val == nullptr);
+    if (val != nullptr) {
+      Slice val_slice(val);
+      ASSERT_TRUE(arena_.RelocateSlice(val_slice, &val_slice));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = val_slice;
+    }
+    cache_.Insert(EncodeKey(key), seq, valid_from, &schema_, row);
+  }
+
+  static string EncodeKey(int32_t key) {
+    return string(reinterpret_cast<const char*>(&key), sizeof(key));
+  }
+
+  RowCache cache_;
+  Arena arena_;
+  Schema schema_;
+};
+
+TEST_F(RowCacheTest, TestLookup) {
+  const string key = EncodeKey(1);
+  ASSERT_EQ(nullptr, cache_.Lookup(key, &schema_, MvccSnapshot(Timestamp(10))));
+  NO_FATALS(InsertRow(1, "hello", cache_.InvalidationSeq(key), Timestamp(10)));
+
+  unique_ptr<RowCache::RowHandle> row = cache_.Lookup(key, &schema_, MvccSnapshot(Timestamp(10)));
+  ASSERT_NE(nullptr, row);
+  ASSERT_EQ(1, *reinterpret_cast<const int32_t*>(row->row().cell_ptr(0)));
+  ASSERT_FALSE(row->row().is_null(1));
+  ASSERT_EQ("hello", reinterpret_cast<const Slice*>(row->row().cell_ptr(1))->ToString());
+  row.reset();
+
+  // A later snapshot sees the same row, but an earlier one may not.
+  ASSERT_NE(nullptr, cache_.Lookup(key, &schema_, MvccSnapshot(Timestamp(20))));
+  ASSERT_EQ(nullptr, cache_.Lookup(key, &schema_, MvccSnapshot(Timestamp(5))));
+
+  // Neither does a lookup with another schema, as after an alter.
+  Schema other_schema(schema_);
+  ASSERT_EQ(nullptr, cache_.Lookup(key, &other_schema, MvccSnapshot(Timestamp(10))));
+}
+
+TEST_F(RowCacheTest, TestInvalidate) {
+  const string key = EncodeKey(1);
+  NO_FATALS(InsertRow(1, "hello", cache_.InvalidationSeq(key), Timestamp(10)));
+  cache_.Invalidate(key);
+  ASSERT_EQ(nullptr, cache_.Lookup(key, &schema_, MvccSnapshot(Timestamp(20))));
+
+  // A row read before a write to its key was applied isn't cached.
+  uint64_t seq = cache_.InvalidationSeq(key);
+  cache_.Invalidate(key);
+  NO_FATALS(InsertRow(1, "stale", seq, Timestamp(10)));
+  ASSERT_EQ(nullptr, cache_.Lookup(key, &schema_, MvccSnapshot(Timestamp(20))));
+
+  // Other keys are unaffected.
+  const string other_key = EncodeKey(2);
+  NO_FATALS(InsertRow(2, "other", cache_.InvalidationSeq(other_key), Timestamp(10)));
+  ASSERT_NE(nullptr, cache_.Lookup(other_key, &schema_, MvccSnapshot(Timestamp(20))));
+}
+
+TEST_F(RowCacheTest, TestCachedRowIterator) {
+  const string key = EncodeKey(1);
+  NO_FATALS(InsertRow(1, nullptr, cache_.InvalidationSeq(key), Timestamp(10)));
+
+  Schema projection;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "val" }, &projection));
+  CachedRowIterator iter(&projection,
+                         cache_.Lookup(key, &schema_, MvccSnapshot(Timestamp(10))));
+  ASSERT_OK(iter.Init(nullptr));
+  ASSERT_TRUE(iter.HasNext());
+  Arena arena(1024);
+  RowBlock block(projection, 10, &arena);
+  ASSERT_OK(iter.NextBlock(&block));
+  ASSERT_EQ(1, block.nrows());
+  ASSERT_TRUE(block.selection_vector()->IsRowSelected(0));
+  ASSERT_TRUE(block.row(0).is_null(0));
+  ASSERT_FALSE(iter.HasNext());
+}
+
+} // namespace tablet
+} // namespace kudu
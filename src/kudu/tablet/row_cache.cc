@@ -0,0 +1,184 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/row_cache.h"
+
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/hash_util.h"
+#include "kudu/util/memory/arena.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// The invalidation sequence numbers are tracked per stripe rather than per
+// key: a write to any key of the stripe keeps a racing lookup from caching its
+// row, which is rare enough to be harmless.
+const int kNumStripes = 256;
+
+// Each cached row is preceded by the timestamp its snapshot saw all the
+// transactions before, and by the schema of the row.
+const int kHeaderSize = sizeof(uint64_t) + sizeof(const Schema*);
+
+} // anonymous namespace
+
+RowCache::RowCache(size_t capacity, const string& id)
+    : cache_(NewLRUCache(DRAM_CACHE, capacity, id)),
+      stripes_(new Stripe[kNumStripes]) {
+}
+
+RowCache::~RowCache() {}
+
+RowCache::Stripe* RowCache::StripeFor(const Slice& key) const {
+  return &stripes_[HashUtil::MurmurHash2_64(key.data(), key.size(), 0) % kNumStripes];
+}
+
+uint64_t RowCache::InvalidationSeq(const Slice& key) const {
+  Stripe* stripe = StripeFor(key);
+  std::lock_guard<simple_spinlock> l(stripe->lock);
+  return stripe->seq;
+}
+
+void RowCache::Invalidate(const Slice& key) {
+  Stripe* stripe = StripeFor(key);
+  std::lock_guard<simple_spinlock> l(stripe->lock);
+  stripe->seq++;
+  cache_->Erase(key);
+}
+
+void RowCache::Insert(const Slice& key, uint64_t seq, Timestamp valid_from,
+                      const Schema* schema, const RowBlockRow& row) {
+  // The row is laid out as a contiguous row, followed by the data of its
+  // string cells, which the cells point to.
+  const size_t row_size = ContiguousRowHelper::row_size(*schema);
+  size_t indirect_size = 0;
+  for (int i = 0; i < schema->num_columns(); i++) {
+    const ColumnSchema& col = schema->column(i);
+    if (col.type_info()->physical_type() == BINARY &&
+        !(col.is_nullable() && row.is_null(i))) {
+      indirect_size += reinterpret_cast<const Slice*>(row.cell_ptr(i))->size();
+    }
+  }
+  Cache::PendingHandle* pending = cache_->Allocate(key, kHeaderSize + row_size + indirect_size);
+  if (PREDICT_FALSE(!pending)) {
+    return;
+  }
+  uint8_t* dst = cache_->MutableValue(pending);
+  EncodeFixed64(dst, valid_from.ToUint64());
+  memcpy(dst + sizeof(uint64_t), &schema, sizeof(schema));
+
+  uint8_t* row_data = dst + kHeaderSize;
+  ContiguousRowHelper::InitNullsBitmap(*schema, row_data,
+                                       ContiguousRowHelper::null_bitmap_size(*schema));
+  ContiguousRow dst_row(schema, row_data);
+  uint8_t* indirect = row_data + row_size;
+  for (int i = 0; i < schema->num_columns(); i++) {
+    const ColumnSchema& col = schema->column(i);
+    if (col.is_nullable() && row.is_null(i)) {
+      dst_row.set_null(i, true);
+      continue;
+    }
+    uint8_t* cell = dst_row.mutable_cell_ptr(i);
+    if (col.type_info()->physical_type() == BINARY) {
+      const Slice* src = reinterpret_cast<const Slice*>(row.cell_ptr(i));
+      memcpy(indirect, src->data(), src->size());
+      const Slice copy(indirect, src->size());
+      memcpy(cell, &copy, sizeof(copy));
+      indirect += src->size();
+    } else {
+      memcpy(cell, row.cell_ptr(i), col.type_info()->size());
+    }
+  }
+
+  Stripe* stripe = StripeFor(key);
+  std::lock_guard<simple_spinlock> l(stripe->lock);
+  if (stripe->seq != seq) {
+    // A write to the key may have been applied after the row was read.
+    cache_->Free(pending);
+    return;
+  }
+  cache_->Release(cache_->Insert(pending, nullptr));
+}
+
+unique_ptr<RowCache::RowHandle> RowCache::Lookup(const Slice& key, const Schema* schema,
+                                                 const MvccSnapshot& snap) {
+  Cache::UniqueHandle h(cache_->Lookup(key, Cache::EXPECT_IN_CACHE),
+                        Cache::HandleDeleter(cache_.get()));
+  if (!h) {
+    return nullptr;
+  }
+  Slice value = cache_->Value(h.get());
+  DCHECK_GE(value.size(), kHeaderSize);
+  const Schema* row_schema;
+  memcpy(&row_schema, value.data() + sizeof(uint64_t), sizeof(row_schema));
+  if (row_schema != schema) {
+    // Cached before the schema was altered.
+    return nullptr;
+  }
+  const Timestamp valid_from(DecodeFixed64(value.data()));
+  if (valid_from > Timestamp::kMin &&
+      snap.MayHaveUncommittedTransactionsAtOrBefore(Timestamp(valid_from.value() - 1))) {
+    return nullptr;
+  }
+  return unique_ptr<RowHandle>(new RowHandle(std::move(h), schema, value.data() + kHeaderSize));
+}
+
+CachedRowIterator::CachedRowIterator(const Schema* projection,
+                                     unique_ptr<RowCache::RowHandle> row)
+    : projection_(projection),
+      row_(std::move(row)),
+      projector_(row_->schema(), projection_),
+      done_(false) {
+}
+
+Status CachedRowIterator::Init(ScanSpec* /*spec*/) {
+  return projector_.Init();
+}
+
+Status CachedRowIterator::NextBlock(RowBlock* dst) {
+  DCHECK(!done_);
+  dst->Resize(1);
+  dst->selection_vector()->SetAllTrue();
+  RowBlockRow dst_row = dst->row(0);
+  RETURN_NOT_OK(projector_.ProjectRowForRead(row_->row(), &dst_row, dst->arena()));
+  done_ = true;
+  return Status::OK();
+}
+
+void CachedRowIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  stats->assign(projection_->num_columns(), IteratorStats());
+}
+
+} // namespace tablet
+} // namespace kudu
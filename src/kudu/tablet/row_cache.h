@@ -0,0 +1,153 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kudu/common/iterator.h"
+#include "kudu/common/row.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ScanSpec;
+
+namespace tablet {
+
+class MvccSnapshot;
+
+// A cache of the most recently looked up rows of a tablet, keyed by their
+// encoded primary keys, so that repeated point lookups of the same rows are
+// answered without reading the rowsets.
+//
+// A cached row is only served to snapshots which see every transaction the
+// snapshot it was read in saw, and it is erased as soon as a write to its key
+// is applied. To keep a write racing with a lookup from leaving a stale row
+// behind, each key maps to an invalidation sequence number which is bumped by
+// every write: a row read by a lookup is only cached if the sequence number
+// of its key didn't change while it was being read.
+//
+// This class is thread-safe.
+class RowCache {
+ public:
+  RowCache(size_t capacity, const std::string& id);
+  ~RowCache();
+
+  // Returns the invalidation sequence number of 'key', to be passed to
+  // Insert() once the row has been read.
+  uint64_t InvalidationSeq(const Slice& key) const;
+
+  // Erases the row with encoded key 'key', if cached, and bumps the
+  // invalidation sequence number of the key.
+  void Invalidate(const Slice& key);
+
+  // Caches 'row' of 'schema' as the row with encoded key 'key', unless the key
+  // was invalidated after InvalidationSeq() returned 'seq'.
+  //
+  // The row must have been read in a clean snapshot which saw all the
+  // transactions before 'valid_from', and only those. 'schema' must outlive
+  // the cache.
+  void Insert(const Slice& key, uint64_t seq, Timestamp valid_from,
+              const Schema* schema, const RowBlockRow& row);
+
+  // A row of the cache, which stays valid as long as the handle is held.
+  class RowHandle {
+   public:
+    const Schema* schema() const { return schema_; }
+    ConstContiguousRow row() const { return ConstContiguousRow(schema_, row_data_); }
+
+   private:
+    friend class RowCache;
+    RowHandle(Cache::UniqueHandle handle, const Schema* schema, const uint8_t* row_data)
+        : handle_(std::move(handle)),
+          schema_(schema),
+          row_data_(row_data) {
+    }
+
+    Cache::UniqueHandle handle_;
+    const Schema* schema_;
+    const uint8_t* row_data_;
+  };
+
+  // Looks up the row with encoded key 'key' as of 'snap'. Returns null if the
+  // row isn't cached, was cached with a schema other than 'schema', or if
+  // 'snap' might not see all the transactions the row was read after.
+  std::unique_ptr<RowHandle> Lookup(const Slice& key, const Schema* schema,
+                                    const MvccSnapshot& snap);
+
+ private:
+  struct Stripe {
+    mutable simple_spinlock lock;
+    uint64_t seq = 0;
+  };
+
+  Stripe* StripeFor(const Slice& key) const;
+
+  const std::unique_ptr<Cache> cache_;
+
+  // The invalidation sequence numbers, shared by the keys hashing to the
+  // same stripe.
+  std::unique_ptr<Stripe[]> stripes_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowCache);
+};
+
+// Iterates over a single row of a RowCache, projected to 'projection'.
+class CachedRowIterator : public RowwiseIterator {
+ public:
+  CachedRowIterator(const Schema* projection, std::unique_ptr<RowCache::RowHandle> row);
+
+  Status Init(ScanSpec* spec) OVERRIDE;
+
+  bool HasNext() const OVERRIDE {
+    return !done_;
+  }
+
+  Status NextBlock(RowBlock* dst) OVERRIDE;
+
+  std::string ToString() const OVERRIDE {
+    return "cached row";
+  }
+
+  const Schema& schema() const OVERRIDE {
+    return *projection_;
+  }
+
+  void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
+
+ private:
+  const Schema* projection_;
+  const std::unique_ptr<RowCache::RowHandle> row_;
+  RowProjector projector_;
+  bool done_;
+
+  DISALLOW_COPY_AND_ASSIGN(CachedRowIterator);
+};
+
+} // namespace tablet
+} // namespace kudu
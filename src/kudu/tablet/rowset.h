@@ -17,12 +17,14 @@
 #ifndef KUDU_TABLET_ROWSET_H
 #define KUDU_TABLET_ROWSET_H
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -46,10 +48,15 @@ namespace kudu {
 class MonoTime; // IWYU pragma: keep
 class RowChangeList;
 class RowwiseIterator;
+class ScanSpec;
 class Schema;
 class Slice;
 struct ColumnId;
 
+namespace cfile {
+class ZoneMapEntryPB;
+}
+
 namespace consensus {
 class OpId;
 }
@@ -121,6 +128,22 @@ class RowSet {
   virtual Status CheckRowPresent(const RowSetKeyProbe &probe, const fs::IOContext* io_context,
                                  bool *present, ProbeStats* stats) const = 0;
 
+  // Quickly rule out which of the 'n' keys of 'probes', which must be sorted,
+  // are present in this rowset, e.g. using bloom filters. Sets
+  // 'maybe_present[i]' to false if the key of 'probes[i]' is definitely not
+  // present, in which case 'stats[i]' accounts for the work done. The keys
+  // which may be present must still be checked with CheckRowPresent().
+  //
+  // By default, none of the keys are ruled out.
+  virtual Status CheckRowsMayBePresent(const RowSetKeyProbe* const* /*probes*/,
+                                       size_t n,
+                                       const fs::IOContext* /*io_context*/,
+                                       bool* maybe_present,
+                                       ProbeStats* const* /*stats*/) const {
+    std::fill(maybe_present, maybe_present + n, true);
+    return Status::OK();
+  }
+
   // Update/delete a row in this rowset.
   // The 'update_schema' is the client schema used to encode the 'update' RowChangeList.
   //
@@ -145,6 +168,36 @@ class RowSet {
   virtual Status NewRowIterator(const RowIteratorOptions& opts,
                                 gscoped_ptr<RowwiseIterator>* out) const = 0;
 
+  // Returns false if no row of this rowset, as of the snapshot in 'opts', can
+  // satisfy the predicates of 'spec', according to statistics which are kept
+  // in memory. A scan may skip a rowset for which this returns false without
+  // creating an iterator for it.
+  //
+  // The predicates' columns which are not in the projection of 'opts' are
+  // ignored.
+  virtual bool MayMatchScanSpec(const RowIteratorOptions& /*opts*/,
+                                const ScanSpec& /*spec*/) const {
+    return true;
+  }
+
+  // Sets 'stats' to the statistics of the column at index 'col_idx' of the
+  // projection of 'opts', which hold for the rows of this rowset as of the
+  // snapshot in 'opts'. Returns false if no such statistics are kept in
+  // memory.
+  virtual bool GetColumnStatsForScan(const RowIteratorOptions& /*opts*/,
+                                     int /*col_idx*/,
+                                     cfile::ZoneMapEntryPB* /*stats*/) const {
+    return false;
+  }
+
+  // Returns false if no row of this rowset was inserted, updated or deleted
+  // by a transaction committed in 'opts.snap_to_include' but not in
+  // 'opts.snap_to_exclude', which must be set. A diff scan may skip a rowset
+  // for which this returns false.
+  virtual bool MayHaveChangesInDiffScan(const RowIteratorOptions& /*opts*/) const {
+    return true;
+  }
+
   // Create the input to be used for a compaction.
   //
   // The provided 'projection' is for the compaction output. Each row
@@ -157,6 +210,17 @@ class RowSet {
   // Count the number of rows in this rowset.
   virtual Status CountRows(const fs::IOContext* io_context, rowid_t *count) const = 0;
 
+  // Count the number of live rows in this rowset, i.e. those which are not
+  // deleted as of the latest committed state, if that's possible without
+  // scanning the rowset. If so, sets '*count' and sets '*known' to true.
+  // Otherwise, sets '*known' to false.
+  virtual Status CountLiveRowsFromMetadata(const fs::IOContext* /*io_context*/,
+                                           bool* known,
+                                           rowid_t* /*count*/) const {
+    *known = false;
+    return Status::OK();
+  }
+
   // Return the bounds for this RowSet. 'min_encoded_key' and 'max_encoded_key'
   // are set to the first and last encoded keys for this RowSet.
   //
@@ -264,6 +328,37 @@ class RowSet {
                                          int64_t* blocks_deleted,
                                          int64_t* bytes_deleted) = 0;
 
+  // Estimate the number of ancient bytes in the initialized undo delta
+  // blocks which hold both ancient and non-ancient deltas, counting only the
+  // blocks whose estimated ancient fraction is at least 'min_ancient_ratio'.
+  // These are the blocks rewritten by RewritePartiallyAncientUndoDeltas().
+  virtual int64_t EstimateBytesInPartiallyAncientUndoDeltas(Timestamp /*ancient_history_mark*/,
+                                                            double /*min_ancient_ratio*/) {
+    return 0;
+  }
+
+  // Rewrite the initialized undo delta blocks which hold both ancient and
+  // non-ancient deltas, oldest first, without their ancient deltas. Only
+  // the blocks whose estimated ancient fraction is at least
+  // 'min_ancient_ratio' are rewritten, and no block is started once
+  // 'max_bytes' bytes of blocks were rewritten.
+  //
+  // As with DeleteAncientUndoDeltas(), the caller is responsible for
+  // flushing the rowset metadata if this method returns OK.
+  //
+  // The out-parameters, 'blocks_rewritten' and 'bytes_rewritten' (the size
+  // of the replaced blocks), may be passed in as nullptr.
+  virtual Status RewritePartiallyAncientUndoDeltas(Timestamp /*ancient_history_mark*/,
+                                                   double /*min_ancient_ratio*/,
+                                                   int64_t /*max_bytes*/,
+                                                   const fs::IOContext* /*io_context*/,
+                                                   int64_t* blocks_rewritten,
+                                                   int64_t* bytes_rewritten) {
+    if (blocks_rewritten) *blocks_rewritten = 0;
+    if (bytes_rewritten) *bytes_rewritten = 0;
+    return Status::OK();
+  }
+
   virtual ~RowSet() {}
 
   // Return true if this RowSet is available for compaction, based on
@@ -308,14 +403,26 @@ class RowSetKeyProbe {
     bloom_probe_ = BloomKeyProbe(encoded_key_slice());
   }
 
+  // Like the above, but uses 'encoded_key', which must be the encoding of
+  // 'row_key', rather than encoding it again. On the write path the key is
+  // encoded once per operation (see EncodedKey::FromContiguousRow()) and
+  // then shared by the row lock, the rowset lookups and the MemRowSet
+  // insertion.
+  RowSetKeyProbe(ConstContiguousRow row_key, gscoped_ptr<EncodedKey> encoded_key)
+      : row_key_(row_key),
+        encoded_key_(std::move(encoded_key)) {
+    bloom_probe_ = BloomKeyProbe(encoded_key_slice());
+  }
+
   // RowSetKeyProbes are usually allocated on the stack, which means that we
   // must copy it if we require it later (e.g. Table::Mutate()).
   //
   // Still, the ConstContiguousRow row_key_ remains a reference to the data
-  // underlying the original RowsetKeyProbe and is not copied.
+  // underlying the original RowsetKeyProbe and is not copied. The encoded
+  // key is copied rather than computed again.
   explicit RowSetKeyProbe(const RowSetKeyProbe& probe)
-  : row_key_(probe.row_key_) {
-    encoded_key_ = EncodedKey::FromContiguousRow(row_key_);
+  : row_key_(probe.row_key_),
+    encoded_key_(probe.encoded_key_->Copy()) {
     bloom_probe_ = BloomKeyProbe(encoded_key_slice());
   }
 
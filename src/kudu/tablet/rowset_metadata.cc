@@ -98,11 +98,25 @@ void RowSetMetadata::LoadFromPB(const RowSetDataPB& pb) {
     adhoc_index_block_ = BlockId::FromPB(pb.adhoc_index_block());
   }
 
+  on_fast_tier_ = pb.on_fast_tier();
+
   // Load Column Files.
   blocks_by_col_id_.clear();
+  stats_by_col_id_.clear();
+  index_blocks_by_col_id_.clear();
+  ranges_by_col_id_.clear();
   for (const ColumnDataPB& col_pb : pb.columns()) {
     ColumnId col_id = ColumnId(col_pb.column_id());
     blocks_by_col_id_[col_id] = BlockId::FromPB(col_pb.block());
+    if (col_pb.has_stats()) {
+      stats_by_col_id_[col_id] = col_pb.stats();
+    }
+    if (col_pb.has_secondary_index()) {
+      index_blocks_by_col_id_[col_id] = BlockId::FromPB(col_pb.secondary_index());
+    }
+    if (col_pb.has_block_length()) {
+      ranges_by_col_id_[col_id] = { col_pb.block_offset(), col_pb.block_length() };
+    }
   }
 
   // Load redo delta files.
@@ -133,6 +147,19 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
     ColumnDataPB *col_data = pb->add_columns();
     block_id.CopyToPB(col_data->mutable_block());
     col_data->set_column_id(col_id);
+    const cfile::ZoneMapEntryPB* stats = FindOrNull(stats_by_col_id_, col_id);
+    if (stats != nullptr) {
+      *col_data->mutable_stats() = *stats;
+    }
+    const BlockId* index_block = FindOrNull(index_blocks_by_col_id_, col_id);
+    if (index_block != nullptr) {
+      index_block->CopyToPB(col_data->mutable_secondary_index());
+    }
+    const ColumnBlockRange* range = FindOrNull(ranges_by_col_id_, col_id);
+    if (range != nullptr) {
+      col_data->set_block_offset(range->offset);
+      col_data->set_block_length(range->length);
+    }
   }
 
   // Write Delta Files
@@ -158,6 +185,10 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
     adhoc_index_block_.CopyToPB(pb->mutable_adhoc_index_block());
   }
 
+  if (on_fast_tier_) {
+    pb->set_on_fast_tier(true);
+  }
+
   // Write the min/max keys.
   if (has_encoded_keys_unlocked()) {
     pb->set_min_encoded_key(*min_encoded_key_);
@@ -176,6 +207,29 @@ void RowSetMetadata::SetColumnDataBlocks(const std::map<ColumnId, BlockId>& bloc
   blocks_by_col_id_ = std::move(new_map);
 }
 
+void RowSetMetadata::SetColumnStats(
+    const std::map<ColumnId, cfile::ZoneMapEntryPB>& stats_by_col_id) {
+  ColumnIdToStatsMap new_map(stats_by_col_id.begin(), stats_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  stats_by_col_id_ = std::move(new_map);
+}
+
+void RowSetMetadata::SetColumnIndexBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id) {
+  ColumnIdToBlockIdMap new_map(blocks_by_col_id.begin(), blocks_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  index_blocks_by_col_id_ = std::move(new_map);
+}
+
+void RowSetMetadata::SetColumnBlockRanges(
+    const std::map<ColumnId, ColumnBlockRange>& ranges_by_col_id) {
+  ColumnIdToRangeMap new_map(ranges_by_col_id.begin(), ranges_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  ranges_by_col_id_ = std::move(new_map);
+}
+
 Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
                                                 const BlockId& block_id) {
   std::lock_guard<LockType> l(lock_);
@@ -190,6 +244,34 @@ Status RowSetMetadata::CommitUndoDeltaDataBlock(const BlockId& block_id) {
   return Status::OK();
 }
 
+namespace {
+
+// Replaces the contiguous subsequence 'to_remove' of 'blocks' with 'to_add',
+// appending the replaced blocks to 'removed'.
+void ReplaceDeltaBlockSubsequence(const vector<BlockId>& to_remove,
+                                  const vector<BlockId>& to_add,
+                                  vector<BlockId>* blocks,
+                                  vector<BlockId>* removed) {
+  CHECK(!to_remove.empty());
+
+  auto start_it = std::find(blocks->begin(), blocks->end(), to_remove[0]);
+
+  auto end_it = start_it;
+  for (const BlockId& b : to_remove) {
+    CHECK(end_it != blocks->end() && *end_it == b) <<
+        Substitute("Cannot find subsequence <$0> in <$1>",
+                   BlockId::JoinStrings(to_remove),
+                   BlockId::JoinStrings(*blocks));
+    ++end_it;
+  }
+
+  removed->insert(removed->end(), start_it, end_it);
+  start_it = blocks->erase(start_it, end_it);
+  blocks->insert(start_it, to_add.begin(), to_add.end());
+}
+
+} // anonymous namespace
+
 void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
                                   vector<BlockId>* removed) {
   removed->clear();
@@ -198,23 +280,10 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
 
     // Find the exact sequence of blocks to remove.
     for (const auto& rep : update.replace_redo_blocks_) {
-      CHECK(!rep.to_remove.empty());
-
-      auto start_it = std::find(redo_delta_blocks_.begin(),
-                                redo_delta_blocks_.end(), rep.to_remove[0]);
-
-      auto end_it = start_it;
-      for (const BlockId& b : rep.to_remove) {
-        CHECK(end_it != redo_delta_blocks_.end() && *end_it == b) <<
-            Substitute("Cannot find subsequence <$0> in <$1>",
-                       BlockId::JoinStrings(rep.to_remove),
-                       BlockId::JoinStrings(redo_delta_blocks_));
-        ++end_it;
-      }
-
-      removed->insert(removed->end(), start_it, end_it);
-      redo_delta_blocks_.erase(start_it, end_it);
-      redo_delta_blocks_.insert(start_it, rep.to_add.begin(), rep.to_add.end());
+      ReplaceDeltaBlockSubsequence(rep.to_remove, rep.to_add, &redo_delta_blocks_, removed);
+    }
+    for (const auto& rep : update.replace_undo_blocks_) {
+      ReplaceDeltaBlockSubsequence(rep.to_remove, rep.to_add, &undo_delta_blocks_, removed);
     }
 
     // Add new redo blocks
@@ -248,24 +317,69 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
       undo_delta_blocks_.insert(undo_delta_blocks_.begin(), update.new_undo_block_);
     }
 
+    // The column blocks which were replaced or removed. A block shared by a
+    // column group is only removed once none of the group's columns refer
+    // to it anymore.
+    vector<BlockId> old_col_blocks;
     for (const ColumnIdToBlockIdMap::value_type& e : update.cols_to_replace_) {
       // If we are major-compacting deltas into a column which previously had no
       // base-data (e.g. because it was newly added), then there will be no original
       // block there to replace.
       BlockId old_block_id;
       if (UpdateReturnCopy(&blocks_by_col_id_, e.first, e.second, &old_block_id)) {
-        removed->push_back(old_block_id);
+        old_col_blocks.push_back(old_block_id);
+      }
+      const ColumnBlockRange* range = FindOrNull(update.replaced_col_ranges_, e.first);
+      if (range != nullptr) {
+        ranges_by_col_id_[e.first] = *range;
+      } else {
+        ranges_by_col_id_.erase(e.first);
+      }
+      const cfile::ZoneMapEntryPB* stats = FindOrNull(update.replaced_col_stats_, e.first);
+      if (stats != nullptr) {
+        stats_by_col_id_[e.first] = *stats;
+      } else {
+        stats_by_col_id_.erase(e.first);
+      }
+      BlockId old_index_block;
+      if (FindCopy(index_blocks_by_col_id_, e.first, &old_index_block)) {
+        removed->push_back(old_index_block);
+        index_blocks_by_col_id_.erase(e.first);
+      }
+      const BlockId* index_block = FindOrNull(update.replaced_col_indexes_, e.first);
+      if (index_block != nullptr) {
+        index_blocks_by_col_id_[e.first] = *index_block;
       }
     }
 
     for (const ColumnId& col_id : update.col_ids_to_remove_) {
       BlockId old = FindOrDie(blocks_by_col_id_, col_id);
       CHECK_EQ(1, blocks_by_col_id_.erase(col_id));
-      removed->push_back(old);
+      stats_by_col_id_.erase(col_id);
+      ranges_by_col_id_.erase(col_id);
+      old_col_blocks.push_back(old);
+      BlockId old_index_block;
+      if (FindCopy(index_blocks_by_col_id_, col_id, &old_index_block)) {
+        removed->push_back(old_index_block);
+        index_blocks_by_col_id_.erase(col_id);
+      }
+    }
+
+    BlockIdSet referenced;
+    for (const ColumnIdToBlockIdMap::value_type& e : blocks_by_col_id_) {
+      referenced.insert(e.second);
+    }
+    for (const BlockId& b : old_col_blocks) {
+      if (InsertIfNotPresent(&referenced, b)) {
+        removed->push_back(b);
+      }
     }
   }
 
   blocks_by_col_id_.shrink_to_fit();
+  stats_by_col_id_.shrink_to_fit();
+  index_blocks_by_col_id_.shrink_to_fit();
+  ranges_by_col_id_.shrink_to_fit();
 }
 
 vector<BlockId> RowSetMetadata::GetAllBlocks() {
@@ -277,7 +391,14 @@ vector<BlockId> RowSetMetadata::GetAllBlocks() {
   if (!bloom_block_.IsNull()) {
     blocks.push_back(bloom_block_);
   }
-  AppendValuesFromMap(blocks_by_col_id_, &blocks);
+  // The columns of a column group share their block.
+  BlockIdSet col_blocks;
+  for (const ColumnIdToBlockIdMap::value_type& e : blocks_by_col_id_) {
+    if (InsertIfNotPresent(&col_blocks, e.second)) {
+      blocks.push_back(e.second);
+    }
+  }
+  AppendValuesFromMap(index_blocks_by_col_id_, &blocks);
 
   blocks.insert(blocks.end(),
                 undo_delta_blocks_.begin(), undo_delta_blocks_.end());
@@ -298,6 +419,24 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::ReplaceColumnId(ColumnId col_id,
   return *this;
 }
 
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetReplacedColumnRange(
+    ColumnId col_id, const ColumnBlockRange& range) {
+  InsertOrDie(&replaced_col_ranges_, col_id, range);
+  return *this;
+}
+
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetReplacedColumnStats(
+    ColumnId col_id, const cfile::ZoneMapEntryPB& stats) {
+  InsertOrDie(&replaced_col_stats_, col_id, stats);
+  return *this;
+}
+
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetReplacedColumnIndex(ColumnId col_id,
+                                                                   const BlockId& block_id) {
+  InsertOrDie(&replaced_col_indexes_, col_id, block_id);
+  return *this;
+}
+
 RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveColumnId(ColumnId col_id) {
   col_ids_to_remove_.push_back(col_id);
   return *this;
@@ -312,6 +451,15 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::ReplaceRedoDeltaBlocks(
   return *this;
 }
 
+RowSetMetadataUpdate& RowSetMetadataUpdate::ReplaceUndoDeltaBlocks(
+    const std::vector<BlockId>& to_remove,
+    const std::vector<BlockId>& to_add) {
+
+  ReplaceDeltaBlocks rdb = { to_remove, to_add };
+  replace_undo_blocks_.push_back(rdb);
+  return *this;
+}
+
 RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveUndoDeltaBlocks(
     const std::vector<BlockId>& to_remove) {
   remove_undo_blocks_.insert(remove_undo_blocks_.end(), to_remove.begin(), to_remove.end());
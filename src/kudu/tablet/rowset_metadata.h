@@ -30,6 +30,7 @@
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
 
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/fs_manager.h"
@@ -46,6 +47,13 @@ namespace tablet {
 class RowSetDataPB;
 class RowSetMetadataUpdate;
 
+// The range of a block holding the cfile of a column, for a column which
+// shares its block with the other columns of its column group.
+struct ColumnBlockRange {
+  uint64_t offset;
+  uint64_t length;
+};
+
 // Keeps track of the RowSet data blocks.
 //
 // On each tablet MemRowSet flush, a new RowSetMetadata is created,
@@ -73,6 +81,8 @@ class RowSetMetadata {
   // We use a flat_map to save memory, since there are lots of these metadata
   // objects.
   typedef boost::container::flat_map<ColumnId, BlockId> ColumnIdToBlockIdMap;
+  typedef boost::container::flat_map<ColumnId, cfile::ZoneMapEntryPB> ColumnIdToStatsMap;
+  typedef boost::container::flat_map<ColumnId, ColumnBlockRange> ColumnIdToRangeMap;
 
   // Create a new RowSetMetadata
   static Status CreateNew(TabletMetadata* tablet_metadata,
@@ -115,8 +125,34 @@ class RowSetMetadata {
     adhoc_index_block_ = block_id;
   }
 
+  // Whether the rowset's base data was written to the fast storage tier.
+  bool on_fast_tier() const {
+    std::lock_guard<LockType> l(lock_);
+    return on_fast_tier_;
+  }
+
+  void set_on_fast_tier(bool on_fast_tier) {
+    std::lock_guard<LockType> l(lock_);
+    on_fast_tier_ = on_fast_tier;
+  }
+
   void SetColumnDataBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
 
+  // Set the statistics of the column data blocks, replacing any previous
+  // ones. Columns without an entry in 'stats_by_col_id' have no statistics.
+  void SetColumnStats(const std::map<ColumnId, cfile::ZoneMapEntryPB>& stats_by_col_id);
+
+  // Set the secondary index blocks of the column data blocks, replacing any
+  // previous ones. Columns without an entry in 'blocks_by_col_id' have no
+  // secondary index.
+  void SetColumnIndexBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
+
+  // Set the ranges of the column data blocks which hold the cfiles of the
+  // columns in column groups, replacing any previous ones. The cfiles of
+  // the columns without an entry in 'ranges_by_col_id' take up their whole
+  // block.
+  void SetColumnBlockRanges(const std::map<ColumnId, ColumnBlockRange>& ranges_by_col_id);
+
   Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id);
 
   Status CommitUndoDeltaDataBlock(const BlockId& block_id);
@@ -177,6 +213,33 @@ class RowSetMetadata {
     return blocks_by_col_id_;
   }
 
+  // Copy the statistics of the column data block of 'col_id' into 'stats'.
+  // Returns false if the block has no statistics.
+  bool GetColumnStats(const ColumnId& col_id, cfile::ZoneMapEntryPB* stats) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(stats_by_col_id_, col_id, stats);
+  }
+
+  // Copy the block ID of the secondary index of 'col_id' into 'block_id'.
+  // Returns false if the column has no secondary index.
+  bool GetColumnIndexBlock(const ColumnId& col_id, BlockId* block_id) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(index_blocks_by_col_id_, col_id, block_id);
+  }
+
+  ColumnIdToBlockIdMap GetColumnIndexBlocksById() const {
+    std::lock_guard<LockType> l(lock_);
+    return index_blocks_by_col_id_;
+  }
+
+  // Copy the range of the column data block of 'col_id' which holds the
+  // column's cfile into 'range'. Returns false if the cfile takes up the
+  // whole block.
+  bool GetColumnBlockRange(const ColumnId& col_id, ColumnBlockRange* range) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(ranges_by_col_id_, col_id, range);
+  }
+
   std::vector<BlockId> redo_delta_blocks() const {
     std::lock_guard<LockType> l(lock_);
     return redo_delta_blocks_;
@@ -232,6 +295,7 @@ class RowSetMetadata {
   explicit RowSetMetadata(TabletMetadata *tablet_metadata)
     : tablet_metadata_(tablet_metadata),
       initted_(false),
+      on_fast_tier_(false),
       last_durable_redo_dms_id_(kNoDurableMemStore) {
   }
 
@@ -240,6 +304,7 @@ class RowSetMetadata {
     : tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       initted_(true),
       id_(id),
+      on_fast_tier_(false),
       last_durable_redo_dms_id_(kNoDurableMemStore) {
   }
 
@@ -259,8 +324,24 @@ class RowSetMetadata {
   BlockId bloom_block_;
   BlockId adhoc_index_block_;
 
+  bool on_fast_tier_;
+
   // Map of column ID to block ID.
   ColumnIdToBlockIdMap blocks_by_col_id_;
+
+  // Map of column ID to the statistics of its block. These are dropped
+  // whenever the block is replaced or removed, unless the update provides
+  // new ones.
+  ColumnIdToStatsMap stats_by_col_id_;
+
+  // Map of column ID to the block of its secondary index. Like the
+  // statistics, an index is removed along with its column's block.
+  ColumnIdToBlockIdMap index_blocks_by_col_id_;
+
+  // Map of column ID to the range of its block holding its cfile, for the
+  // columns sharing a block with the rest of their column group. A shared
+  // block is only removed once no column refers to it.
+  ColumnIdToRangeMap ranges_by_col_id_;
   std::vector<BlockId> redo_delta_blocks_;
   std::vector<BlockId> undo_delta_blocks_;
 
@@ -288,9 +369,28 @@ class RowSetMetadataUpdate {
   // Remove the specified undo delta blocks.
   RowSetMetadataUpdate& RemoveUndoDeltaBlocks(const std::vector<BlockId>& to_remove);
 
+  // Replace the subsequence of undo delta blocks with the new (rewritten)
+  // delta blocks, which take their place in the list. As with
+  // ReplaceRedoDeltaBlocks(), the replaced blocks must be contiguous.
+  RowSetMetadataUpdate& ReplaceUndoDeltaBlocks(const std::vector<BlockId>& to_remove,
+                                               const std::vector<BlockId>& to_add);
+
   // Replace the CFile for the given column ID.
   RowSetMetadataUpdate& ReplaceColumnId(ColumnId col_id, const BlockId& block_id);
 
+  // Set the statistics of the CFile which replaces the one for the given
+  // column ID. Without this, the replaced column has no statistics.
+  RowSetMetadataUpdate& SetReplacedColumnStats(ColumnId col_id,
+                                               const cfile::ZoneMapEntryPB& stats);
+
+  // Set the secondary index of the CFile which replaces the one for the
+  // given column ID. Without this, the replaced column has no index.
+  RowSetMetadataUpdate& SetReplacedColumnIndex(ColumnId col_id, const BlockId& block_id);
+
+  // Set the range of the block holding the CFile which replaces the one for
+  // the given column ID, if that block is shared with other columns.
+  RowSetMetadataUpdate& SetReplacedColumnRange(ColumnId col_id, const ColumnBlockRange& range);
+
   // Remove the CFile for the given column ID.
   RowSetMetadataUpdate& RemoveColumnId(ColumnId col_id);
 
@@ -301,6 +401,9 @@ class RowSetMetadataUpdate {
  private:
   friend class RowSetMetadata;
   RowSetMetadata::ColumnIdToBlockIdMap cols_to_replace_;
+  RowSetMetadata::ColumnIdToStatsMap replaced_col_stats_;
+  RowSetMetadata::ColumnIdToBlockIdMap replaced_col_indexes_;
+  RowSetMetadata::ColumnIdToRangeMap replaced_col_ranges_;
   std::vector<ColumnId> col_ids_to_remove_;
   std::vector<BlockId> new_redo_blocks_;
 
@@ -309,6 +412,7 @@ class RowSetMetadataUpdate {
     std::vector<BlockId> to_add;
   };
   std::vector<ReplaceDeltaBlocks> replace_redo_blocks_;
+  std::vector<ReplaceDeltaBlocks> replace_undo_blocks_;
 
   std::vector<BlockId> remove_undo_blocks_;
   BlockId new_undo_block_;
@@ -35,12 +35,14 @@
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_tree.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
 using strings::Substitute;
@@ -208,6 +210,33 @@ TEST_F(TestRowSetTree, TestTree) {
   ASSERT_EQ(vec[2].get(), out[3]);
 }
 
+TEST_F(TestRowSetTree, TestKeysAboveBoundedRowSets) {
+  RowSetTree empty_tree;
+  ASSERT_OK(empty_tree.Reset(RowSetVector()));
+  ASSERT_TRUE(empty_tree.IsAboveBoundedRowSets(""));
+  ASSERT_FALSE(empty_tree.has_unbounded_rowsets());
+
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("0", "7")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("3", "5")));
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  ASSERT_FALSE(tree.has_unbounded_rowsets());
+  ASSERT_FALSE(tree.IsAboveBoundedRowSets("4"));
+  ASSERT_FALSE(tree.IsAboveBoundedRowSets("7"));
+  ASSERT_TRUE(tree.IsAboveBoundedRowSets("70"));
+  ASSERT_TRUE(tree.IsAboveBoundedRowSets("8"));
+
+  // The max key is kept up to date when the tree is rebuilt from another.
+  vec.erase(vec.begin());
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  RowSetTree new_tree;
+  ASSERT_OK(new_tree.Reset(tree, vec));
+  ASSERT_TRUE(new_tree.has_unbounded_rowsets());
+  ASSERT_FALSE(new_tree.IsAboveBoundedRowSets("5"));
+  ASSERT_TRUE(new_tree.IsAboveBoundedRowSets("6"));
+}
+
 TEST_F(TestRowSetTree, TestTreeRandomized) {
   enum BoundOperator {
     BOUND_LESS_THAN,
@@ -352,6 +381,117 @@ TEST_P(TestRowSetTreePerformance, TestPerformance) {
                             batch_total ? (oat_total / batch_total) : 0);
 }
 
+// Test the tree's queries against a brute-force search, with keys that share
+// prefixes longer than the prefixes the tree compares inline, and with trees
+// which are built from a previous tree after removing and adding rowsets.
+TEST_F(TestRowSetTree, TestQueriesMatchBruteForce) {
+  SeedRandom();
+  const auto& RandomKey = [] () {
+    int v = rand() % 200;
+    return rand() % 2 == 0 ? StringPrintf("shared_prefix_%03d", v) : StringPrintf("%d", v);
+  };
+  // The MemRowSet, whose bounds are unknown, may contain any key.
+  const auto& Contains = [] (RowSet* rs, const string& key) {
+    string min, max;
+    Status s = rs->GetBounds(&min, &max);
+    return s.IsNotSupported() || (min <= key && key <= max);
+  };
+
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  unique_ptr<RowSetTree> tree(new RowSetTree());
+  ASSERT_OK(tree->Reset(vec));
+  for (int round = 0; round < 20; round++) {
+    // Remove a few rowsets and add a few new ones, keeping the MemRowSet.
+    RowSetVector next;
+    for (const auto& rs : vec) {
+      if (rs == vec[0] || rand() % 4 != 0) {
+        next.push_back(rs);
+      }
+    }
+    for (int i = 0; i < 10; i++) {
+      string min = RandomKey();
+      string max = RandomKey();
+      if (max < min) std::swap(min, max);
+      next.push_back(shared_ptr<RowSet>(new MockDiskRowSet(min, max)));
+    }
+    unique_ptr<RowSetTree> next_tree(new RowSetTree());
+    ASSERT_OK(next_tree->Reset(*tree, next));
+    RowSetTree full_tree;
+    ASSERT_OK(full_tree.Reset(next));
+    tree = std::move(next_tree);
+    vec = std::move(next);
+
+    // The incrementally built tree has the same endpoints as one built from
+    // scratch.
+    ASSERT_EQ(full_tree.key_endpoints().size(), tree->key_endpoints().size());
+    for (int i = 0; i < tree->key_endpoints().size(); i++) {
+      const auto& a = full_tree.key_endpoints()[i];
+      const auto& b = tree->key_endpoints()[i];
+      ASSERT_EQ(a.rowset_, b.rowset_);
+      ASSERT_EQ(a.endpoint_, b.endpoint_);
+      ASSERT_EQ(a.slice_, b.slice_);
+    }
+
+    vector<string> keys;
+    for (int i = 0; i < 50; i++) {
+      keys.push_back(RandomKey());
+    }
+    std::sort(keys.begin(), keys.end());
+    for (const auto& key : keys) {
+      vector<RowSet*> out;
+      tree->FindRowSetsWithKeyInRange(key, &out);
+      unordered_set<RowSet*> expected;
+      for (const auto& rs : vec) {
+        if (Contains(rs.get(), key)) expected.insert(rs.get());
+      }
+      ASSERT_EQ(expected, unordered_set<RowSet*>(out.begin(), out.end())) << key;
+      ASSERT_EQ(expected.size(), out.size()) << key;
+    }
+
+    // Batch queries yield the same matches, grouped by rowset.
+    vector<Slice> key_slices(keys.begin(), keys.end());
+    vector<std::pair<RowSet*, int>> matches;
+    tree->ForEachRowSetContainingKeys(key_slices, [&](RowSet* rs, int idx) {
+      matches.emplace_back(rs, idx);
+    });
+    int expected_matches = 0;
+    for (const auto& rs : vec) {
+      for (const auto& key : keys) {
+        if (Contains(rs.get(), key)) expected_matches++;
+      }
+    }
+    ASSERT_EQ(expected_matches, matches.size());
+    unordered_set<RowSet*> finished_groups;
+    for (int i = 0; i < matches.size(); i++) {
+      ASSERT_TRUE(Contains(matches[i].first, keys[matches[i].second]));
+      if (i > 0 && matches[i].first == matches[i - 1].first) {
+        ASSERT_LT(matches[i - 1].second, matches[i].second);
+      } else {
+        ASSERT_TRUE(InsertIfNotPresent(&finished_groups, matches[i].first));
+      }
+    }
+
+    for (int i = 0; i < 50; i++) {
+      string lower = RandomKey();
+      string upper = RandomKey();
+      vector<RowSet*> out;
+      tree->FindRowSetsIntersectingInterval(Slice(lower), Slice(upper), &out);
+      unordered_set<RowSet*> expected;
+      for (const auto& rs : vec) {
+        string min, max;
+        Status s = rs->GetBounds(&min, &max);
+        if (s.IsNotSupported() || (max >= lower && min < upper)) {
+          expected.insert(rs.get());
+        }
+      }
+      ASSERT_EQ(expected, unordered_set<RowSet*>(out.begin(), out.end()))
+          << lower << " " << upper;
+      ASSERT_EQ(expected.size(), out.size());
+    }
+  }
+}
+
 TEST_F(TestRowSetTree, TestEndpointsConsistency) {
   const int kNumRowSets = 1000;
   RowSetVector vec = GenerateRandomRowSets(kNumRowSets);
@@ -19,24 +19,31 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
-#include <ostream>
 
 #include <glog/logging.h>
 
-#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/endian.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
-#include "kudu/util/interval_tree-inl.h"
-#include "kudu/util/interval_tree.h"
 #include "kudu/util/slice.h"
 
-using std::vector;
+using std::pair;
 using std::shared_ptr;
 using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
 
 namespace kudu {
 namespace tablet {
@@ -54,17 +61,35 @@ bool RSEndpointBySliceCompare(const RowSetTree::RSEndpoint& a,
   return false;
 }
 
-// Wrapper used when making batch queries into the interval tree.
-struct QueryStruct {
-  // The slice of the operation performing the query.
-  Slice slice;
-  // The original index of this slice in the incoming batch.
-  int idx;
+// A key along with its first 8 bytes, zero-padded and loaded as a big-endian
+// integer. Since encoded keys compare as byte strings, comparing the prefixes
+// orders most pairs of keys without touching the keys themselves, which live
+// elsewhere on the heap; only keys with equal prefixes need a full comparison.
+struct PrefixedKey {
+  PrefixedKey() : prefix(0) {}
+
+  explicit PrefixedKey(const Slice& k)
+      : prefix(0),
+        key(k) {
+    uint8_t buf[8] = { 0 };
+    memcpy(buf, key.data(), std::min<size_t>(key.size(), sizeof(buf)));
+    prefix = BigEndian::ToHost64(UNALIGNED_LOAD64(buf));
+  }
+
+  int compare(const PrefixedKey& other) const {
+    if (prefix != other.prefix) {
+      return prefix < other.prefix ? -1 : 1;
+    }
+    return key.compare(other.key);
+  }
+
+  uint64_t prefix;
+  Slice key;
 };
 
 } // anonymous namespace
 
-// Entry for use in the interval tree.
+// Entry for a rowset with known bounds.
 struct RowSetWithBounds {
   string min_key;
   string max_key;
@@ -76,75 +101,233 @@ struct RowSetWithBounds {
   RowSet *rowset;
 };
 
-// Traits struct for IntervalTree.
-struct RowSetIntervalTraits {
-  typedef Slice point_type;
-  typedef RowSetWithBounds *interval_type;
-
-  static Slice get_left(const RowSetWithBounds *rs) {
-    return Slice(rs->min_key);
+// A static interval index over the rowsets with known bounds, laid out as an
+// implicit augmented binary search tree in a single array sorted by min key
+// (as in the 'cgranges' library). Every element is a node: leaves are at even
+// indexes, and the node at index 'i' is at level 'k' of the tree if the lowest
+// zero bit of 'i' is bit 'k'. Each node stores the largest max key in its
+// subtree, which lets a query skip the subtrees which end before it. Searches
+// walk the array with an explicit stack rather than chasing child pointers,
+// and compare key prefixes stored inline in the nodes before comparing the
+// keys themselves.
+class RowSetIntervalIndex {
+ public:
+  // Builds the index over 'entries', which must be sorted by min key.
+  explicit RowSetIntervalIndex(const vector<shared_ptr<RowSetWithBounds>>& entries);
+
+  // Appends the rowsets whose bounds contain 'key' to 'rowsets', in order of
+  // their min keys.
+  void FindContainingPoint(const Slice& key, vector<RowSet*>* rowsets) const {
+    PrefixedKey k(key);
+    Search(&k, &k, true, [&](int i) { rowsets->push_back(nodes_[i].rowset); });
   }
 
-  static Slice get_right(const RowSetWithBounds *rs) {
-    return Slice(rs->max_key);
+  // Appends the rowsets whose bounds intersect [lower_bound, upper_bound) to
+  // 'rowsets', in order of their min keys. boost::none means negative infinity
+  // as the lower bound and positive infinity as the upper bound.
+  void FindIntersectingInterval(const boost::optional<Slice>& lower_bound,
+                                const boost::optional<Slice>& upper_bound,
+                                vector<RowSet*>* rowsets) const {
+    PrefixedKey lower;
+    PrefixedKey upper;
+    if (lower_bound) lower = PrefixedKey(*lower_bound);
+    if (upper_bound) upper = PrefixedKey(*upper_bound);
+    Search(lower_bound ? &lower : nullptr, upper_bound ? &upper : nullptr, false,
+           [&](int i) { rowsets->push_back(nodes_[i].rowset); });
   }
 
-  static int compare(const Slice &a, const Slice &b) {
-    return a.compare(b);
-  }
+  // Calls 'cb(rowset, index)' for each (rowset, index) pair such that
+  // 'keys[index]' is within the bounds of 'rowset', grouped by rowset and in
+  // increasing order of 'index' within each group.
+  void ForEachIntervalContainingPoints(const vector<Slice>& keys,
+                                       const std::function<void(RowSet*, int)>& cb) const;
+
+ private:
+  struct Node {
+    PrefixedKey min_key;
+    PrefixedKey max_key;
+    // The largest max key of the rowsets in this node's subtree.
+    PrefixedKey subtree_max_key;
+    RowSet* rowset;
+  };
+
+  // Calls 'emit(i)', in increasing order of 'i', for each node 'i' whose
+  // interval ends at or after 'lower' and starts before 'upper' (or at
+  // 'upper', if 'upper_inclusive'). A null bound is unbounded.
+  template<class EmitFunc>
+  void Search(const PrefixedKey* lower, const PrefixedKey* upper, bool upper_inclusive,
+              const EmitFunc& emit) const;
+
+  vector<Node> nodes_;
+
+  // The level of the root of the implicit tree.
+  int root_level_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowSetIntervalIndex);
+};
 
-  static int compare(const Slice &a, const QueryStruct &b) {
-    return a.compare(b.slice);
+RowSetIntervalIndex::RowSetIntervalIndex(const vector<shared_ptr<RowSetWithBounds>>& entries)
+    : root_level_(-1) {
+  const int64_t n = entries.size();
+  nodes_.resize(n);
+  for (int64_t i = 0; i < n; i++) {
+    Node* node = &nodes_[i];
+    node->min_key = PrefixedKey(entries[i]->min_key);
+    node->max_key = PrefixedKey(entries[i]->max_key);
+    node->subtree_max_key = node->max_key;
+    node->rowset = entries[i]->rowset;
+    DCHECK(i == 0 || nodes_[i - 1].min_key.compare(node->min_key) <= 0);
   }
-
-  static int compare(const QueryStruct &a, const Slice &b) {
-    return -compare(b, a);
+  if (n == 0) {
+    return;
   }
 
-  // When 'a' is boost::none:
-  //  (1)'a' is +OO when 'positive_direction' is true;
-  //  (2)'a' is -OO when 'positive_direction' is false.
-  static int compare(const boost::optional<Slice>& a,
-                     const Slice& b,
-                     const EndpointIfNone& type) {
-    if (a == boost::none) {
-      return ((POSITIVE_INFINITY == type) ? 1 : -1);
+  // Compute the subtree maximums bottom-up, a level at a time. 'last_i' is
+  // the rightmost node at the current level and 'last' its subtree's max key,
+  // which stands in for right children beyond the end of the array.
+  int64_t last_i = 0;
+  PrefixedKey last;
+  for (int64_t i = 0; i < n; i += 2) {
+    last_i = i;
+    last = nodes_[i].max_key;
+  }
+  int k;
+  for (k = 1; (1LL << k) <= n; k++) {
+    const int64_t x = 1LL << (k - 1);
+    for (int64_t i = (x << 1) - 1; i < n; i += x << 2) {
+      const PrefixedKey& left = nodes_[i - x].subtree_max_key;
+      const PrefixedKey& right = i + x < n ? nodes_[i + x].subtree_max_key : last;
+      PrefixedKey* max = &nodes_[i].subtree_max_key;
+      if (left.compare(*max) > 0) *max = left;
+      if (right.compare(*max) > 0) *max = right;
+    }
+    last_i = (last_i >> k & 1) ? last_i - x : last_i + x;
+    if (last_i < n && nodes_[last_i].subtree_max_key.compare(last) > 0) {
+      last = nodes_[last_i].subtree_max_key;
     }
+  }
+  root_level_ = k - 1;
+}
 
-    return compare(*a, b);
+template<class EmitFunc>
+void RowSetIntervalIndex::Search(const PrefixedKey* lower, const PrefixedKey* upper,
+                                 bool upper_inclusive, const EmitFunc& emit) const {
+  if (nodes_.empty()) {
+    return;
   }
+  const int64_t n = nodes_.size();
+  const auto ends_at_or_after_lower = [&](const PrefixedKey& max_key) {
+    return lower == nullptr || max_key.compare(*lower) >= 0;
+  };
+  const auto starts_before_upper = [&](const PrefixedKey& min_key) {
+    if (upper == nullptr) return true;
+    int cmp = min_key.compare(*upper);
+    return upper_inclusive ? cmp <= 0 : cmp < 0;
+  };
+
+  // Subtrees of at most this level are scanned linearly rather than walked.
+  const int kLinearScanLevel = 3;
+  struct StackEntry {
+    int64_t x;      // The index of the node.
+    int k;          // The level of the node.
+    bool left_done; // Whether the node's left subtree has been searched.
+  };
+  StackEntry stack[64];
+  int t = 0;
+  stack[t++] = { (1LL << root_level_) - 1, root_level_, false };
+  while (t > 0) {
+    const StackEntry z = stack[--t];
+    if (z.k <= kLinearScanLevel) {
+      const int64_t i0 = z.x >> z.k << z.k;
+      const int64_t i1 = std::min<int64_t>(i0 + (1LL << (z.k + 1)) - 1, n);
+      for (int64_t i = i0; i < i1 && starts_before_upper(nodes_[i].min_key); i++) {
+        if (ends_at_or_after_lower(nodes_[i].max_key)) {
+          emit(i);
+        }
+      }
+    } else if (!z.left_done) {
+      // Revisit this node after its left subtree, which is searched unless
+      // all of its intervals end before 'lower'. The left child may be beyond
+      // the end of the array while some of its descendants aren't.
+      const int64_t y = z.x - (1LL << (z.k - 1));
+      stack[t++] = { z.x, z.k, true };
+      if (y >= n || ends_at_or_after_lower(nodes_[y].subtree_max_key)) {
+        stack[t++] = { y, z.k - 1, false };
+      }
+    } else if (z.x < n && starts_before_upper(nodes_[z.x].min_key)) {
+      if (ends_at_or_after_lower(nodes_[z.x].max_key)) {
+        emit(z.x);
+      }
+      stack[t++] = { z.x + (1LL << (z.k - 1)), z.k - 1, false };
+    }
+  }
+}
 
-  static int compare(const Slice& a,
-                     const boost::optional<Slice>& b,
-                     const EndpointIfNone& type) {
-    return -compare(b, a, type);
+void RowSetIntervalIndex::ForEachIntervalContainingPoints(
+    const vector<Slice>& keys,
+    const std::function<void(RowSet*, int)>& cb) const {
+  // Query the keys one at a time, then group the matches by rowset. Each
+  // key's matches come out in increasing node order, and the keys are
+  // visited in increasing order, so sorting the (node, key index) pairs
+  // yields the groups with their keys already in order.
+  vector<pair<int64_t, int>> matches;
+  for (int idx = 0; idx < keys.size(); idx++) {
+    PrefixedKey k(keys[idx]);
+    Search(&k, &k, true, [&](int64_t i) { matches.emplace_back(i, idx); });
   }
-};
+  std::sort(matches.begin(), matches.end());
+  for (const auto& m : matches) {
+    cb(nodes_[m.first].rowset, m.second);
+  }
+}
 
 RowSetTree::RowSetTree()
   : initted_(false) {
 }
 
 Status RowSetTree::Reset(const RowSetVector &rowsets) {
+  return ResetInternal(nullptr, rowsets);
+}
+
+Status RowSetTree::Reset(const RowSetTree& old_tree, const RowSetVector& rowsets) {
+  DCHECK(old_tree.initted_);
+  return ResetInternal(&old_tree, rowsets);
+}
+
+Status RowSetTree::ResetInternal(const RowSetTree* old_tree, const RowSetVector& rowsets) {
   CHECK(!initted_);
-  std::vector<RowSetWithBounds *> entries;
-  RowSetVector unbounded;
-  ElementDeleter deleter(&entries);
-  entries.reserve(rowsets.size());
-  std::vector<RSEndpoint> endpoints;
-  endpoints.reserve(rowsets.size()*2);
+  const auto by_min_key = [](const shared_ptr<RowSetWithBounds>& a,
+                             const shared_ptr<RowSetWithBounds>& b) {
+    return a->min_key < b->min_key;
+  };
+
+  // The entries of 'old_tree' for the rowsets which are in 'rowsets', by rowset.
+  unordered_map<RowSet*, const shared_ptr<RowSetWithBounds>*> old_entries;
+  if (old_tree) {
+    old_entries.reserve(old_tree->entries_.size());
+    for (const auto& e : old_tree->entries_) {
+      old_entries.emplace(e->rowset, &e);
+    }
+  }
 
-  // Iterate over each of the provided RowSets, fetching their
-  // bounds and adding them to the local vectors.
+  // Iterate over each of the provided RowSets, fetching the bounds of those
+  // which aren't in 'old_tree'.
+  vector<shared_ptr<RowSetWithBounds>> new_entries;
+  unordered_set<RowSet*> kept;
+  RowSetVector unbounded;
   for (const shared_ptr<RowSet> &rs : rowsets) {
-    gscoped_ptr<RowSetWithBounds> rsit(new RowSetWithBounds());
+    if (ContainsKey(old_entries, rs.get())) {
+      kept.insert(rs.get());
+      continue;
+    }
+    shared_ptr<RowSetWithBounds> rsit(new RowSetWithBounds());
     rsit->rowset = rs.get();
     string min_key, max_key;
     Status s = rs->GetBounds(&min_key, &max_key);
     if (s.IsNotSupported()) {
       // This rowset is a MemRowSet, for which the bounds change as more
       // data gets inserted. Therefore we can't put it in the static
-      // interval tree -- instead put it on the list which is consulted
+      // interval index -- instead put it on the list which is consulted
       // on every access.
       unbounded.push_back(rs);
       continue;
@@ -160,21 +343,58 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
     // Load bounds and save entry
     rsit->min_key = std::move(min_key);
     rsit->max_key = std::move(max_key);
+    new_entries.emplace_back(std::move(rsit));
+  }
 
-    // Load into key endpoints.
-    endpoints.emplace_back(rsit->rowset, START, rsit->min_key);
-    endpoints.emplace_back(rsit->rowset, STOP, rsit->max_key);
-
-    entries.push_back(rsit.release());
+  // Sort the new entries and their endpoints, and merge them with the kept
+  // entries and endpoints of 'old_tree', which are already sorted.
+  std::stable_sort(new_entries.begin(), new_entries.end(), by_min_key);
+  vector<RSEndpoint> new_endpoints;
+  new_endpoints.reserve(new_entries.size() * 2);
+  for (const auto& e : new_entries) {
+    new_endpoints.emplace_back(e->rowset, START, e->min_key);
+    new_endpoints.emplace_back(e->rowset, STOP, e->max_key);
+  }
+  std::sort(new_endpoints.begin(), new_endpoints.end(), RSEndpointBySliceCompare);
+
+  vector<shared_ptr<RowSetWithBounds>> kept_entries;
+  vector<RSEndpoint> kept_endpoints;
+  if (old_tree) {
+    kept_entries.reserve(kept.size());
+    for (const auto& e : old_tree->entries_) {
+      if (ContainsKey(kept, e->rowset)) {
+        kept_entries.push_back(e);
+      }
+    }
+    kept_endpoints.reserve(kept.size() * 2);
+    for (const auto& rse : old_tree->key_endpoints_) {
+      if (ContainsKey(kept, rse.rowset_)) {
+        kept_endpoints.push_back(rse);
+      }
+    }
   }
 
-  // Sort endpoints
-  std::sort(endpoints.begin(), endpoints.end(), RSEndpointBySliceCompare);
+  vector<shared_ptr<RowSetWithBounds>> entries;
+  entries.reserve(kept_entries.size() + new_entries.size());
+  std::merge(kept_entries.begin(), kept_entries.end(),
+             new_entries.begin(), new_entries.end(),
+             std::back_inserter(entries), by_min_key);
+  vector<RSEndpoint> endpoints;
+  endpoints.reserve(kept_endpoints.size() + new_endpoints.size());
+  std::merge(kept_endpoints.begin(), kept_endpoints.end(),
+             new_endpoints.begin(), new_endpoints.end(),
+             std::back_inserter(endpoints), RSEndpointBySliceCompare);
 
   // Install the vectors into the object.
   entries_.swap(entries);
+  max_bounded_key_ = Slice();
+  for (const auto& e : entries_) {
+    if (max_bounded_key_.compare(e->max_key) < 0) {
+      max_bounded_key_ = e->max_key;
+    }
+  }
   unbounded_rowsets_.swap(unbounded);
-  tree_.reset(new IntervalTree<RowSetIntervalTraits>(entries_));
+  index_.reset(new RowSetIntervalIndex(entries_));
   key_endpoints_.swap(endpoints);
   all_rowsets_.assign(rowsets.begin(), rowsets.end());
 
@@ -201,13 +421,7 @@ void RowSetTree::FindRowSetsIntersectingInterval(const boost::optional<Slice>& l
     rowsets->push_back(rs.get());
   }
 
-  vector<RowSetWithBounds *> from_tree;
-  from_tree.reserve(all_rowsets_.size());
-  tree_->FindIntersectingInterval(lower_bound, upper_bound, &from_tree);
-  rowsets->reserve(rowsets->size() + from_tree.size());
-  for (RowSetWithBounds *rs : from_tree) {
-    rowsets->push_back(rs->rowset);
-  }
+  index_->FindIntersectingInterval(lower_bound, upper_bound, rowsets);
 }
 
 void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
@@ -219,15 +433,9 @@ void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
     rowsets->push_back(rs.get());
   }
 
-  // Query the interval tree to efficiently find rowsets with known bounds
+  // Query the interval index to efficiently find rowsets with known bounds
   // whose ranges overlap the probe key.
-  vector<RowSetWithBounds *> from_tree;
-  from_tree.reserve(all_rowsets_.size());
-  tree_->FindContainingPoint(encoded_key, &from_tree);
-  rowsets->reserve(rowsets->size() + from_tree.size());
-  for (RowSetWithBounds *rs : from_tree) {
-    rowsets->push_back(rs->rowset);
-  }
+  index_->FindContainingPoint(encoded_key, rowsets);
 }
 
 void RowSetTree::ForEachRowSetContainingKeys(
@@ -243,26 +451,11 @@ void RowSetTree::ForEachRowSetContainingKeys(
     }
   }
 
-  // The interval tree batch query callback would naturally just give us back
-  // the matching Slices, but that won't allow us to easily tell the caller
-  // which specific operation _index_ matched the RowSet. So, we make a vector
-  // of QueryStructs to pair the Slice with its original index.
-  vector<QueryStruct> queries;
-  queries.resize(encoded_keys.size());
-  for (int i = 0; i < encoded_keys.size(); i++) {
-    queries[i] = {encoded_keys[i], i};
-  }
-
-  tree_->ForEachIntervalContainingPoints(
-      queries,
-      [&](const QueryStruct& qs, RowSetWithBounds* rs) {
-        cb(rs->rowset, qs.idx);
-      });
+  index_->ForEachIntervalContainingPoints(encoded_keys, cb);
 }
 
 
 RowSetTree::~RowSetTree() {
-  STLDeleteElements(&entries_);
 }
 
 } // namespace tablet
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -31,13 +32,9 @@
 #include "kudu/util/status.h"
 
 namespace kudu {
-
-template<class Traits>
-class IntervalTree;
-
 namespace tablet {
 
-struct RowSetIntervalTraits;
+class RowSetIntervalIndex;
 struct RowSetWithBounds;
 
 // Class which encapsulates the set of rowsets which are active for a given
@@ -68,6 +65,13 @@ class RowSetTree {
 
   RowSetTree();
   Status Reset(const RowSetVector &rowsets);
+
+  // Like Reset(const RowSetVector&), but reuses what 'old_tree' already knows
+  // about the rowsets that are in both trees: their bounds, and their order by
+  // key. Only the rowsets that are new to this tree are queried for their
+  // bounds and sorted, and then merged with the others. Used when swapping
+  // rowsets after a flush or compaction, which only changes a few of them.
+  Status Reset(const RowSetTree& old_tree, const RowSetVector& rowsets);
   ~RowSetTree();
 
   // Return all RowSets whose range may contain the given encoded key.
@@ -80,8 +84,8 @@ class RowSetTree {
   // Call 'cb(rowset, index)' for each (rowset, index) pair such that
   // 'encoded_keys[index]' may be within the bounds of 'rowset'.
   //
-  // See IntervalTree::ForEachIntervalContainingPoints for additional
-  // information on the particular order in which the callback will be called.
+  // The calls for each rowset are grouped together, and within each group
+  // are made in increasing order of 'index'.
   //
   // REQUIRES: 'encoded_keys' must be in sorted order.
   void ForEachRowSetContainingKeys(const std::vector<Slice>& encoded_keys,
@@ -98,6 +102,18 @@ class RowSetTree {
                                        const boost::optional<Slice>& upper_bound,
                                        std::vector<RowSet*>* rowsets) const;
 
+  // Returns true if 'encoded_key' is greater than the max key of every rowset
+  // with known bounds, so that only the rowsets with unknown bounds may hold
+  // it. This is the case for most inserts into tables whose keys increase
+  // monotonically.
+  bool IsAboveBoundedRowSets(const Slice& encoded_key) const {
+    return entries_.empty() || encoded_key.compare(max_bounded_key_) > 0;
+  }
+
+  // Returns true if this tree holds rowsets with unknown bounds, e.g. a
+  // MemRowSet being flushed.
+  bool has_unbounded_rowsets() const { return !unbounded_rowsets_.empty(); }
+
   const RowSetVector &all_rowsets() const { return all_rowsets_; }
 
   RowSet* drs_by_id(int64_t drs_id) const {
@@ -110,19 +126,24 @@ class RowSetTree {
   const std::vector<RSEndpoint>& key_endpoints() const { return key_endpoints_; }
 
  private:
-  // Interval tree of the rowsets. Used to efficiently find rowsets which might contain
-  // a probe row.
-  gscoped_ptr<IntervalTree<RowSetIntervalTraits> > tree_;
+  Status ResetInternal(const RowSetTree* old_tree, const RowSetVector& rowsets);
+
+  // Flattened interval index of the rowsets in 'entries_'. Used to efficiently
+  // find rowsets which might contain a probe row.
+  gscoped_ptr<RowSetIntervalIndex> index_;
 
   // Ordered map of all the interval endpoints, holding the implicit contiguous
   // intervals
   // TODO map to usage statistics as well. See KUDU-???
   std::vector<RSEndpoint> key_endpoints_;
 
-  // Container for all of the entries in tree_. IntervalTree does
-  // not itself manage memory, so this provides a simple way to enumerate
-  // all the entry structs and free them in the destructor.
-  std::vector<RowSetWithBounds *> entries_;
+  // The rowsets with known bounds, sorted by their min keys. Entries are
+  // shared with the trees built from this one by Reset(old_tree, rowsets),
+  // which keeps the slices in 'index_' and 'key_endpoints_' valid.
+  std::vector<std::shared_ptr<RowSetWithBounds>> entries_;
+
+  // The greatest max key of the rowsets in 'entries_'. Points into them.
+  Slice max_bounded_key_;
 
   // All of the rowsets which were put in this RowSetTree.
   RowSetVector all_rowsets_;
@@ -134,7 +155,7 @@ class RowSetTree {
   // are mutable (MemRowSets).
   //
   // These have to be consulted for every access, so are not
-  // stored in the interval tree.
+  // stored in the interval index.
   RowSetVector unbounded_rowsets_;
 
   bool initted_;
@@ -0,0 +1,181 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/secondary_index.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/gutil/endian.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/logging.h"
+
+namespace kudu {
+namespace tablet {
+
+using cfile::CFileIterator;
+using cfile::CFileReader;
+using cfile::CFileWriter;
+using fs::BlockCreationTransaction;
+using fs::IOContext;
+using fs::WritableBlock;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace {
+
+// The number of index entries read at a time by a lookup.
+constexpr size_t kLookupBatchSize = 256;
+
+} // anonymous namespace
+
+SecondaryIndexBuilder::SecondaryIndexBuilder(const TypeInfo* typeinfo)
+    : typeinfo_(typeinfo),
+      arena_(32 * 1024) {
+}
+
+void SecondaryIndexBuilder::AddCells(const ColumnBlock& column, rowid_t first_rowid) {
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(typeinfo_);
+  for (size_t i = 0; i < column.nrows(); i++) {
+    if (column.is_nullable() && column.is_null(i)) {
+      continue;
+    }
+    // The separators keep a BINARY value from prefixing the entries of the
+    // longer values it is itself a prefix of.
+    encode_buf_.clear();
+    encoder.Encode(column.cell_ptr(i), /*is_last=*/false, &encode_buf_);
+    uint8_t rowid_buf[sizeof(rowid_t)];
+    BigEndian::Store32(rowid_buf, first_rowid + i);
+    encode_buf_.append(rowid_buf, sizeof(rowid_buf));
+
+    Slice entry;
+    CHECK(arena_.RelocateSlice(Slice(encode_buf_), &entry));
+    entries_.push_back(entry);
+  }
+}
+
+Status SecondaryIndexBuilder::FinishAndReleaseBlock(unique_ptr<WritableBlock> block,
+                                                    BlockCreationTransaction* transaction) {
+  std::sort(entries_.begin(), entries_.end(),
+            [](const Slice& a, const Slice& b) { return a.compare(b) < 0; });
+
+  cfile::WriterOptions opts;
+  opts.write_validx = true;
+  opts.write_posidx = false;
+  opts.storage_attributes.encoding = PREFIX_ENCODING;
+  opts.storage_attributes.compression = LZ4;
+  CFileWriter writer(std::move(opts), GetTypeInfo(BINARY), false, std::move(block));
+  RETURN_NOT_OK(writer.Start());
+  RETURN_NOT_OK(writer.AppendEntries(entries_.data(), entries_.size()));
+  RETURN_NOT_OK(writer.FinishAndReleaseBlock(transaction));
+
+  entries_.clear();
+  entries_.shrink_to_fit();
+  arena_.Reset();
+  return Status::OK();
+}
+
+bool SecondaryIndexSupportsPredicate(const ColumnPredicate& pred) {
+  return pred.predicate_type() == PredicateType::Equality ||
+      pred.predicate_type() == PredicateType::InList;
+}
+
+Status SecondaryIndexLookup(CFileReader* reader,
+                            const ColumnPredicate& pred,
+                            const IOContext* io_context,
+                            vector<rowid_t>* rowids) {
+  DCHECK(SecondaryIndexSupportsPredicate(pred));
+  rowids->clear();
+
+  RETURN_NOT_OK(reader->Init(io_context));
+  CFileIterator* iter_ptr;
+  RETURN_NOT_OK(reader->NewIterator(&iter_ptr, CFileReader::CACHE_BLOCK, io_context));
+  unique_ptr<CFileIterator> iter(iter_ptr);
+
+  vector<const void*> values;
+  if (pred.predicate_type() == PredicateType::Equality) {
+    values.push_back(pred.raw_lower());
+  } else {
+    values = pred.raw_values();
+  }
+
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(pred.column().type_info());
+  faststring prefix_buf;
+  Arena arena(16 * 1024);
+  Slice cells[kLookupBatchSize];
+  ColumnBlock block(GetTypeInfo(BINARY), nullptr, cells, kLookupBatchSize, &arena);
+  SelectionVector sel(kLookupBatchSize);
+  for (const void* value : values) {
+    prefix_buf.clear();
+    encoder.Encode(value, /*is_last=*/false, &prefix_buf);
+    Slice prefix(prefix_buf);
+
+    vector<const void*> raw_keys = { &prefix };
+    EncodedKey key(prefix, &raw_keys, 1);
+    bool exact;
+    Status s = iter->SeekAtOrAfter(key, &exact);
+    if (s.IsNotFound()) {
+      // Every entry sorts before the value.
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    // Read the entries which the value's encoding prefixes.
+    bool done = false;
+    while (!done && iter->HasNext()) {
+      size_t n = kLookupBatchSize;
+      ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+      RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+      for (size_t i = 0; i < n; i++) {
+        const Slice& entry = cells[i];
+        if (!entry.starts_with(prefix)) {
+          done = true;
+          break;
+        }
+        if (PREDICT_FALSE(entry.size() != prefix.size() + sizeof(rowid_t))) {
+          return Status::Corruption(Substitute("secondary index entry $0 has an invalid size",
+                                               KUDU_REDACT(entry.ToDebugString())));
+        }
+        rowids->push_back(BigEndian::Load32(entry.data() + prefix.size()));
+      }
+      arena.Reset();
+    }
+  }
+
+  // The values of an InList predicate are distinct, so are their rows.
+  std::sort(rowids->begin(), rowids->end());
+  return Status::OK();
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,104 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "kudu/common/rowid.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class ColumnPredicate;
+class TypeInfo;
+
+namespace cfile {
+class CFileReader;
+} // namespace cfile
+
+namespace fs {
+class BlockCreationTransaction;
+class WritableBlock;
+struct IOContext;
+} // namespace fs
+
+namespace tablet {
+
+// A secondary index maps the values of a non-key column of a rowset to the
+// ordinals of the rows holding them. It is stored as a cfile of BINARY
+// entries, indexed by value, each entry being a non-null cell of the column
+// in its composite key encoding followed by the big-endian ordinal of its
+// row. The entries are sorted, so the rows holding a value are found by
+// seeking to the value's encoding and reading the entries it prefixes.
+//
+// The index covers the base data of the rowset as it was written; it is up
+// to the caller to make sure that the column has no updates in the delta
+// stores visible to a scan before trusting the index.
+
+// Accumulates the entries of a secondary index while a rowset is written,
+// and writes them out in sorted order when it is finished. The entries are
+// buffered in memory until then.
+class SecondaryIndexBuilder {
+ public:
+  explicit SecondaryIndexBuilder(const TypeInfo* typeinfo);
+
+  // Add the cells of 'column', which are those of the rows starting at
+  // ordinal 'first_rowid'. Null cells aren't indexed.
+  void AddCells(const ColumnBlock& column, rowid_t first_rowid);
+
+  // Sort the entries and write them as a cfile to 'block', which is then
+  // finalized and released to 'transaction'.
+  Status FinishAndReleaseBlock(std::unique_ptr<fs::WritableBlock> block,
+                               fs::BlockCreationTransaction* transaction);
+
+  // The number of entries added so far.
+  size_t num_entries() const { return entries_.size(); }
+
+ private:
+  const TypeInfo* const typeinfo_;
+
+  // Holds the data of 'entries_'.
+  Arena arena_;
+  std::vector<Slice> entries_;
+
+  faststring encode_buf_;
+
+  DISALLOW_COPY_AND_ASSIGN(SecondaryIndexBuilder);
+};
+
+// Returns true if the rows satisfying 'pred' can be looked up in a
+// secondary index over its column, which is the case for Equality and
+// InList predicates.
+bool SecondaryIndexSupportsPredicate(const ColumnPredicate& pred);
+
+// Look up the rows whose value satisfies 'pred', an Equality or InList
+// predicate, in 'reader', the secondary index of 'pred''s column. Sets
+// 'rowids' to the ordinals of these rows, in increasing order.
+Status SecondaryIndexLookup(cfile::CFileReader* reader,
+                            const ColumnPredicate& pred,
+                            const fs::IOContext* io_context,
+                            std::vector<rowid_t>* rowids);
+
+} // namespace tablet
+} // namespace kudu
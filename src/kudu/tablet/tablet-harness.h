@@ -76,6 +76,8 @@ class TabletHarness {
     std::string root_dir;
     bool enable_metrics;
     ClockType clock_type;
+    // Data roots to use alongside 'root_dir'.
+    std::vector<std::string> extra_data_roots;
   };
 
   TabletHarness(const Schema& schema, Options options)
@@ -85,7 +87,11 @@ class TabletHarness {
     std::pair<PartitionSchema, Partition> partition(CreateDefaultPartition(schema_));
 
     // Build the Tablet
-    fs_manager_.reset(new FsManager(options_.env, options_.root_dir));
+    FsManagerOpts fs_opts(options_.root_dir);
+    fs_opts.data_roots.insert(fs_opts.data_roots.end(),
+                              options_.extra_data_roots.begin(),
+                              options_.extra_data_roots.end());
+    fs_manager_.reset(new FsManager(options_.env, std::move(fs_opts)));
     if (first_time) {
       RETURN_NOT_OK(fs_manager_->CreateInitialFileSystemLayout());
     }
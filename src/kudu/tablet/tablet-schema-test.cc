@@ -32,6 +32,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
@@ -177,6 +178,41 @@ TEST_F(TestTabletSchema, TestWrite) {
   VerifyTabletRows(s2, keys);
 }
 
+// Verify that compactions don't write the columns added with a read default
+// to the rowsets whose rows all hold the default, and that the rows still read
+// back the default.
+TEST_F(TestTabletSchema, TestSkipDefaultOnlyColumns) {
+  const size_t kNumBaseRows = 10;
+  InsertRows(client_schema_, 0, kNumBaseRows);
+  ASSERT_OK(tablet()->Flush());
+
+  const int32_t c2_default = 7;
+  SchemaBuilder builder(tablet()->metadata()->schema());
+  ASSERT_OK(builder.AddColumn("c2", INT32, false, &c2_default, &c2_default));
+  AlterSchema(builder.Build());
+  Schema s2 = builder.BuildWithoutIds();
+  const ColumnId c2_id = tablet()->metadata()->schema().column_id(2);
+
+  // Rewrite the rows with the new schema: c2 only holds its default.
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(1, tablet()->metadata()->rowsets().size());
+  ASSERT_FALSE(tablet()->metadata()->rowsets()[0]->HasDataForColumnIdForTests(c2_id));
+  std::vector<std::pair<string, string> > keys;
+  keys.emplace_back("", Substitute("c2=$0", c2_default));
+  VerifyTabletRows(s2, keys);
+
+  // Once a row holds another value, the column is written.
+  size_t s2Key = kNumBaseRows + 1;
+  InsertRow(client_schema_, s2Key);
+  MutateRow(s2, s2Key, /* col_idx= */ 2, /* new_val= */ 9);
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(1, tablet()->metadata()->rowsets().size());
+  ASSERT_TRUE(tablet()->metadata()->rowsets()[0]->HasDataForColumnIdForTests(c2_id));
+  keys.insert(keys.begin(), { Substitute("key=$0", s2Key), "c2=9" });
+  VerifyTabletRows(s2, keys);
+}
+
 // Verify that the RowChangeList projection works for reinsert mutation
 TEST_F(TestTabletSchema, TestReInsert) {
   // Insert some rows with the base schema
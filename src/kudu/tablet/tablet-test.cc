@@ -40,8 +40,11 @@
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
+#include "kudu/common/wire_protocol.pb.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -56,11 +59,14 @@
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/rowset_tree.h"
+#include "kudu/tablet/tablet-harness.h"
 #include "kudu/tablet/tablet-test-base.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_metrics.h" // IWYU pragma: keep
+#include "kudu/tablet/transactions/ingest_rowset_transaction.h"
+#include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/memory/arena.h"
@@ -69,6 +75,11 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(tablet_apply_ops_in_key_order);
+DECLARE_int32(tablet_cold_rowset_secs);
+DECLARE_string(fs_fast_tier_data_dirs);
+DECLARE_int32(tablet_scan_parallelism);
+
 DEFINE_int32(testflush_num_inserts, 1000,
              "Number of rows inserted in TestFlush");
 DEFINE_int32(testiterator_num_inserts, 1000,
@@ -270,6 +281,24 @@ TYPED_TEST(TestTablet, TestInsertDuplicateKey) {
   ASSERT_EQ(1, this->TabletCount());
 }
 
+// Inserts whose keys lie above all flushed rows skip the rowsets' presence
+// checks; make sure that duplicates of flushed rows are still caught.
+TYPED_TEST(TestTablet, TestInsertsAboveFlushedKeys) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  this->InsertTestRows(0, 100, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(100, 100, 0);
+  ASSERT_EQ(200, this->TabletCount());
+  ASSERT_OK(this->tablet()->Flush());
+
+  for (int64_t key : { 0, 99, 100, 199 }) {
+    Status s = this->InsertTestRow(&writer, key, 0);
+    ASSERT_STR_CONTAINS(s.ToString(), "key already present");
+  }
+  ASSERT_OK(this->InsertTestRow(&writer, 200, 0));
+  ASSERT_EQ(201, this->TabletCount());
+}
+
 // Tests that we are able to handle reinserts properly.
 //
 // Namely tests that:
@@ -334,6 +363,76 @@ TYPED_TEST(TestTablet, TestReinserts) {
   STLDeleteElements(&expected_rows);
 }
 
+// Test diff scans over rows whose changes are in UNDO and REDO delta files,
+// a DMS and the MRS.
+TYPED_TEST(TestTablet, TestDiffScan) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  vector<MvccSnapshot> snaps;
+  snaps.emplace_back(*this->tablet()->mvcc_manager());
+  this->InsertTestRows(0, 10, 0);
+  snaps.emplace_back(*this->tablet()->mvcc_manager());
+  ASSERT_OK(this->tablet()->Flush());
+
+  ASSERT_OK(this->UpdateTestRow(&writer, 1, 1));
+  snaps.emplace_back(*this->tablet()->mvcc_manager());
+  ASSERT_OK(this->tablet()->FlushBiggestDMS());
+
+  ASSERT_OK(this->DeleteTestRow(&writer, 2));
+  snaps.emplace_back(*this->tablet()->mvcc_manager());
+
+  this->InsertTestRows(10, 5, 0);
+  snaps.emplace_back(*this->tablet()->mvcc_manager());
+
+  SchemaBuilder builder(this->client_schema_);
+  const bool kFalse = false;
+  ASSERT_OK(builder.AddColumn("deleted", IS_DELETED, /*is_nullable=*/false,
+                              &kFalse, /*write_default=*/nullptr));
+  const Schema projection_with_deleted = builder.BuildWithoutIds();
+
+  // Returns the rows changed between 'snaps[start]' and 'snaps[end]'.
+  auto diff_scan = [&](int start, int end, bool include_deleted_rows, vector<string>* rows) {
+    RowIteratorOptions opts;
+    opts.projection = include_deleted_rows ? &projection_with_deleted : &this->client_schema_;
+    opts.snap_to_exclude = snaps[start];
+    opts.snap_to_include = snaps[end];
+    opts.include_deleted_rows = include_deleted_rows;
+    gscoped_ptr<RowwiseIterator> iter;
+    RETURN_NOT_OK(this->tablet()->NewRowIterator(std::move(opts), &iter));
+    RETURN_NOT_OK(iter->Init(nullptr));
+    return IterateToStringList(iter.get(), rows);
+  };
+
+  auto check = [&]() {
+    vector<string> rows;
+    for (int i = 0; i < static_cast<int>(snaps.size()); i++) {
+      ASSERT_OK(diff_scan(i, i, false, &rows));
+      ASSERT_TRUE(rows.empty());
+    }
+    ASSERT_OK(diff_scan(0, 1, false, &rows));
+    ASSERT_EQ(10, rows.size());
+    ASSERT_OK(diff_scan(1, 2, false, &rows));
+    ASSERT_EQ(1, rows.size());
+    ASSERT_EQ(this->setup_.FormatDebugRow(1, 1, false), rows[0]);
+    ASSERT_OK(diff_scan(2, 3, false, &rows));
+    ASSERT_TRUE(rows.empty());
+    ASSERT_OK(diff_scan(2, 3, true, &rows));
+    ASSERT_EQ(1, rows.size());
+    ASSERT_STR_CONTAINS(rows[0], "deleted=true");
+    ASSERT_OK(diff_scan(3, 4, false, &rows));
+    ASSERT_EQ(5, rows.size());
+    ASSERT_OK(diff_scan(1, 4, false, &rows));
+    ASSERT_EQ(6, rows.size());
+    ASSERT_OK(diff_scan(1, 4, true, &rows));
+    ASSERT_EQ(7, rows.size());
+  };
+  NO_FATALS(check());
+
+  // The changes are the same once they're all on disk.
+  ASSERT_OK(this->tablet()->Flush());
+  ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  NO_FATALS(check());
+}
+
 // Test flushes and compactions dealing with deleted rows.
 TYPED_TEST(TestTablet, TestDeleteWithFlushAndCompact) {
   LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
@@ -394,6 +493,91 @@ TYPED_TEST(TestTablet, TestDeleteWithFlushAndCompact) {
   EXPECT_EQ(this->setup_.FormatDebugRow(0, 2, false), rows[0]);
 }
 
+// Test counting the live rows of a tablet, from the metadata of the rowsets
+// without deletes, and by scanning the other rowsets.
+TYPED_TEST(TestTablet, TestCountLiveRows) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  const auto check_count = [&](uint64_t expected) {
+    uint64_t count;
+    ASSERT_OK(this->tablet()->CountLiveRows(&count));
+    ASSERT_EQ(expected, count);
+    vector<string> rows;
+    ASSERT_OK(this->IterateToStringList(&rows));
+    ASSERT_EQ(expected, rows.size());
+  };
+  NO_FATALS(check_count(0));
+
+  // Two rowsets without deletes.
+  this->InsertTestRows(0, 40, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  NO_FATALS(check_count(40));
+  this->InsertTestRows(40, 30, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  NO_FATALS(check_count(70));
+
+  // Deletes in a DeltaMemStore, then in a delta file.
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(this->DeleteTestRow(&writer, i));
+  }
+  NO_FATALS(check_count(60));
+  ASSERT_OK(this->tablet()->FlushAllDMSForTests());
+  NO_FATALS(check_count(60));
+
+  // Inserts and deletes in the MemRowSet.
+  this->InsertTestRows(70, 20, 0);
+  for (int i = 70; i < 75; i++) {
+    ASSERT_OK(this->DeleteTestRow(&writer, i));
+  }
+  NO_FATALS(check_count(75));
+
+  ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  NO_FATALS(check_count(75));
+  ASSERT_OK(this->tablet()->Flush());
+  NO_FATALS(check_count(75));
+}
+
+// Test looking up rows by key in the MemRowSet and in several flushed rowsets
+// at once.
+TYPED_TEST(TestTablet, TestMultiGet) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  this->InsertTestRows(0, 20, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(20, 20, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(40, 10, 0);
+  ASSERT_OK(this->DeleteTestRow(&writer, 5));
+  ASSERT_OK(this->DeleteTestRow(&writer, 45));
+  ASSERT_OK(this->UpdateTestRow(&writer, 12, 7));
+
+  // The keys are out of order, with a duplicate, deleted rows, an updated row
+  // and a row which was never inserted. Several keys fall in each rowset, so
+  // that each rowset's iterator is seeked more than once.
+  const vector<int64_t> key_idxs = { 30, 2, 45, 5, 49, 30, 55, 0, 13, 12, 31, 3 };
+  vector<string> encoded_keys(key_idxs.size());
+  vector<Slice> keys;
+  for (int i = 0; i < key_idxs.size(); i++) {
+    KuduPartialRow row(&this->client_schema_);
+    this->setup_.BuildRowKey(&row, key_idxs[i]);
+    ASSERT_OK(row.EncodeRowKey(&encoded_keys[i]));
+    keys.emplace_back(encoded_keys[i]);
+  }
+  Arena arena(1024);
+  RowBlock rows(this->client_schema_, keys.size(), &arena);
+  ASSERT_OK(this->tablet()->MultiGet(this->client_schema_,
+                                     MvccSnapshot(*this->tablet()->mvcc_manager()),
+                                     keys, &rows));
+  for (int i = 0; i < key_idxs.size(); i++) {
+    const int64_t key_idx = key_idxs[i];
+    const bool exists = key_idx < 50 && key_idx != 5 && key_idx != 45;
+    ASSERT_EQ(exists, rows.selection_vector()->IsRowSelected(i)) << key_idx;
+    if (exists) {
+      const bool updated = key_idx == 12;
+      ASSERT_EQ(this->setup_.FormatDebugRow(key_idx, updated ? 7 : 0, updated),
+                this->client_schema_.DebugRow(rows.row(i)));
+    }
+  }
+}
+
 // Test flushes dealing with REINSERT mutations in the MemRowSet.
 TYPED_TEST(TestTablet, TestFlushWithReinsert) {
   LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
@@ -698,6 +882,42 @@ TYPED_TEST(TestTablet, TestRowIteratorComplex) {
     << "expected to see all inserted data through iterator.";
 }
 
+// Test that an UNORDERED scan reading the rowsets concurrently returns every
+// row exactly once.
+TYPED_TEST(TestTablet, TestParallelRowIterator) {
+  FLAGS_tablet_scan_parallelism = 4;
+  uint64_t max_rows = this->ClampRowCount(FLAGS_testiterator_num_inserts);
+
+  // Spread the rows over several disk rowsets and the memrowset.
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  for (int32_t i = 0; i < max_rows; i++) {
+    ASSERT_OK_FAST(this->InsertTestRow(&writer, i, 0));
+    if (i % 100 == 0) {
+      ASSERT_OK(this->tablet()->Flush());
+    }
+  }
+
+  gscoped_ptr<RowwiseIterator> iter;
+  const Schema& schema = this->client_schema_;
+  ASSERT_OK(this->tablet()->NewRowIterator(schema, &iter));
+  ASSERT_OK(iter->Init(nullptr));
+
+  vector<bool> seen(max_rows, false);
+  int seen_count = 0;
+  RowBlock block(schema, 100, &this->arena_);
+  while (iter->HasNext()) {
+    this->arena_.Reset();
+    ASSERT_OK(iter->NextBlock(&block));
+    for (size_t i = 0; i < block.nrows(); i++) {
+      int32_t key_idx = *schema.ExtractColumnFromRow<INT32>(block.row(i), 1);
+      ASSERT_FALSE(seen[key_idx]) << "Saw row " << key_idx << " multiple times";
+      seen[key_idx] = true;
+      seen_count++;
+    }
+  }
+  ASSERT_EQ(max_rows, seen_count);
+}
+
 // Test that, when a tablet has flushed data and is
 // reopened, that the data persists
 TYPED_TEST(TestTablet, TestInsertsPersist) {
@@ -754,6 +974,48 @@ TYPED_TEST(TestTablet, TestUpsert) {
 }
 
 
+// Test that a batch whose keys aren't sorted, and which has several ops on
+// the same key, is applied as if its ops ran in the order they were sent,
+// whether or not the ops are applied in key order.
+TYPED_TEST(TestTablet, TestUnsortedBatchWithRepeatedKeys) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  int expected_count = 0;
+  for (bool in_key_order : { false, true }) {
+    SCOPED_TRACE(in_key_order);
+    FLAGS_tablet_apply_ops_in_key_order = in_key_order;
+    const int base = in_key_order ? 10 : 0;
+
+    vector<unique_ptr<KuduPartialRow>> rows;
+    vector<LocalTabletWriter::Op> ops;
+    auto add_op = [&](RowOperationsPB::Type type, int key, int val) {
+      rows.emplace_back(new KuduPartialRow(&this->client_schema_));
+      if (type == RowOperationsPB::DELETE) {
+        this->setup_.BuildRowKey(rows.back().get(), base + key);
+      } else {
+        this->setup_.BuildRow(rows.back().get(), base + key, val);
+      }
+      ops.emplace_back(type, rows.back().get());
+    };
+    add_op(RowOperationsPB::INSERT, 5, 0);
+    add_op(RowOperationsPB::INSERT, 1, 0);
+    add_op(RowOperationsPB::INSERT, 3, 0);
+    add_op(RowOperationsPB::INSERT, 1, 1);   // Duplicate of the second op.
+    add_op(RowOperationsPB::DELETE, 3, 0);
+    add_op(RowOperationsPB::INSERT, 3, 2);   // Reinsert after the delete.
+    add_op(RowOperationsPB::DELETE, 5, 0);
+
+    Status s = writer.WriteBatch(ops);
+    ASSERT_STR_CONTAINS(s.ToString(), "key already present");
+    const TxResultPB& result = writer.result();
+    ASSERT_EQ(ops.size(), result.ops_size());
+    for (int i = 0; i < result.ops_size(); i++) {
+      EXPECT_EQ(i == 3, result.ops(i).has_failed_status()) << "op " << i;
+    }
+    expected_count += 2;
+    ASSERT_EQ(expected_count, this->TabletCount());
+  }
+}
+
 // Test that when a row has been updated many times, it always yields
 // the most recent value.
 TYPED_TEST(TestTablet, TestMultipleUpdates) {
@@ -1109,6 +1371,165 @@ TYPED_TEST(TestTablet, TestMetricsInit) {
   ASSERT_OK(registry->WriteAsJson(&writer, { "*" }, MetricJsonOptions()));
 }
 
+// Test ingesting a rowset flushed by the test tablet into a tablet in another
+// file system.
+TYPED_TEST(TestTablet, TestIngestRowSet) {
+  this->InsertTestRows(0, 100, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  ASSERT_EQ(1, this->tablet()->metadata()->rowsets().size());
+
+  const uint32_t schema_version = this->tablet()->metadata()->schema_version();
+  RowSetDataPB source;
+  this->tablet()->metadata()->rowsets()[0]->ToProtobuf(&source);
+  const string source_root = this->GetTestPath("fs_root");
+
+  tserver::IngestRowSetRequestPB req;
+  req.set_tablet_id(this->tablet()->tablet_id());
+  req.set_schema_version(schema_version);
+  req.set_ingest_id("ingest-1");
+
+  const string dest_root = this->GetTestPath("dest_fs_root");
+  {
+    TabletHarness dest(this->schema(), TabletHarness::Options(dest_root));
+    ASSERT_OK(dest.Create(/*first_time=*/true));
+    ASSERT_OK(dest.Open());
+
+    // Nothing is staged yet.
+    IngestRowSetTransactionState missing_state(nullptr, &req, nullptr);
+    dest.tablet()->CreatePreparedIngestRowSet(&missing_state);
+    Status s = dest.tablet()->CheckPreparedIngestRowSet(&missing_state);
+    ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+    missing_state.ReleaseSchemaLock();
+
+    ASSERT_OK(dest.tablet()->StageRowSetForIngest("ingest-1", schema_version, source_root,
+                                                  source));
+    ASSERT_NE(nullptr, dest.tablet()->metadata()->GetStagedRowSet("ingest-1"));
+    MvccSnapshot snap_before(*dest.tablet()->mvcc_manager());
+    IngestRowSetTransactionState tx_state(nullptr, &req, nullptr);
+    tx_state.set_timestamp(dest.tablet()->clock()->Now());
+    dest.tablet()->StartTransaction(&tx_state);
+    dest.tablet()->CreatePreparedIngestRowSet(&tx_state);
+    ASSERT_OK(dest.tablet()->CheckPreparedIngestRowSet(&tx_state));
+    ASSERT_OK(dest.tablet()->IngestRowSet(&tx_state, 10));
+    tx_state.ReleaseMvccTxn(Transaction::COMMITTED);
+    tx_state.ReleaseSchemaLock();
+    ASSERT_EQ(nullptr, dest.tablet()->metadata()->GetStagedRowSet("ingest-1"));
+
+    // The ingested rows are inserted as of the op: a snapshot from before it
+    // doesn't see them.
+    gscoped_ptr<RowwiseIterator> iter;
+    ASSERT_OK(dest.tablet()->NewRowIterator(this->client_schema_, snap_before, UNORDERED,
+                                            &iter));
+    ASSERT_OK(iter->Init(nullptr));
+    vector<string> rows;
+    ASSERT_OK(IterateToStringList(iter.get(), &rows));
+    ASSERT_TRUE(rows.empty()) << rows.size() << " rows visible before the ingest";
+  }
+
+  // The ingested rowset survives a restart, and another copy of it can't be
+  // ingested. Staged rowsets survive restarts too, until they're discarded.
+  TabletHarness dest(this->schema(), TabletHarness::Options(dest_root));
+  ASSERT_OK(dest.Create(/*first_time=*/false));
+  ASSERT_OK(dest.Open());
+  ASSERT_EQ(10, dest.tablet()->metadata()->last_ingested_rowset_op_index());
+  uint64_t count;
+  ASSERT_OK(dest.tablet()->CountRows(&count));
+  ASSERT_EQ(100, count);
+  ASSERT_EQ(nullptr, dest.tablet()->metadata()->GetStagedRowSet("ingest-1"));
+  ASSERT_OK(dest.tablet()->StageRowSetForIngest("ingest-2", schema_version, source_root,
+                                                source));
+  req.set_ingest_id("ingest-2");
+  {
+    IngestRowSetTransactionState tx_state(nullptr, &req, nullptr);
+    dest.tablet()->CreatePreparedIngestRowSet(&tx_state);
+    Status s = dest.tablet()->CheckPreparedIngestRowSet(&tx_state);
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  }
+
+  // Neither can it once the rows are deleted, since older snapshots still see
+  // them.
+  LocalTabletWriter writer(dest.tablet().get(), &this->client_schema_);
+  for (int64_t i = 0; i < 100; i++) {
+    ASSERT_OK(this->DeleteTestRow(&writer, i));
+  }
+  ASSERT_OK(dest.tablet()->CountRows(&count));
+  ASSERT_EQ(0, count);
+  {
+    IngestRowSetTransactionState tx_state(nullptr, &req, nullptr);
+    dest.tablet()->CreatePreparedIngestRowSet(&tx_state);
+    Status s = dest.tablet()->CheckPreparedIngestRowSet(&tx_state);
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  }
+  ASSERT_OK(dest.tablet()->DiscardStagedRowSet("ingest-2"));
+  ASSERT_EQ(nullptr, dest.tablet()->metadata()->GetStagedRowSet("ingest-2"));
+  Status s = dest.tablet()->DiscardStagedRowSet("ingest-2");
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+
+  // A rowset written with another schema version is rejected, both when
+  // staging it and when preparing the op.
+  s = this->tablet()->StageRowSetForIngest("ingest-3", schema_version + 1, source_root, source);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  req.set_schema_version(schema_version + 1);
+  IngestRowSetTransactionState bad_version_state(nullptr, &req, nullptr);
+  this->tablet()->CreatePreparedIngestRowSet(&bad_version_state);
+  s = this->tablet()->CheckPreparedIngestRowSet(&bad_version_state);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+// Test that flushed rowsets land on the fast storage tier, and that cold ones
+// are migrated off of it without losing rows.
+TYPED_TEST(TestTablet, TestMigrateColdRowSets) {
+  const string fast_root = this->GetTestPath("tiered_fast");
+  TabletHarness::Options opts(fast_root);
+  opts.extra_data_roots = { this->GetTestPath("tiered_slow") };
+  FLAGS_fs_fast_tier_data_dirs = fast_root;
+  TabletHarness harness(this->schema(), opts);
+  ASSERT_OK(harness.Create(/*first_time=*/true));
+  ASSERT_OK(harness.Open());
+  Tablet* tablet = harness.tablet().get();
+  ASSERT_TRUE(harness.fs_manager()->dd_manager()->has_fast_tier());
+
+  LocalTabletWriter writer(tablet, &this->client_schema_);
+  KuduPartialRow row(&this->client_schema_);
+  for (int64_t i = 0; i < 100; i++) {
+    this->setup_.BuildRow(&row, i, 0);
+    ASSERT_OK(writer.Insert(row));
+  }
+  ASSERT_OK(tablet->Flush());
+  ASSERT_EQ(1, tablet->metadata()->rowsets().size());
+  ASSERT_TRUE(tablet->metadata()->rowsets()[0]->on_fast_tier());
+
+  // The rowset was just written, so it isn't cold yet.
+  int64_t rowsets_migrated;
+  int64_t bytes_migrated;
+  ASSERT_OK(tablet->MigrateColdRowSets(&rowsets_migrated, &bytes_migrated));
+  ASSERT_EQ(0, rowsets_migrated);
+
+  FLAGS_tablet_cold_rowset_secs = 0;
+  ASSERT_OK(tablet->MigrateColdRowSets(&rowsets_migrated, &bytes_migrated));
+  ASSERT_EQ(1, rowsets_migrated);
+  ASSERT_GT(bytes_migrated, 0);
+  ASSERT_EQ(1, tablet->metadata()->rowsets().size());
+  ASSERT_FALSE(tablet->metadata()->rowsets()[0]->on_fast_tier());
+
+  // Compacting the migrated rowset with a new flush doesn't bring it back to
+  // the fast tier.
+  FLAGS_tablet_cold_rowset_secs = 3600;
+  for (int64_t i = 100; i < 200; i++) {
+    this->setup_.BuildRow(&row, i, 0);
+    ASSERT_OK(writer.Insert(row));
+  }
+  ASSERT_OK(tablet->Flush());
+  ASSERT_EQ(2, tablet->metadata()->rowsets().size());
+  ASSERT_OK(tablet->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(1, tablet->metadata()->rowsets().size());
+  ASSERT_FALSE(tablet->metadata()->rowsets()[0]->on_fast_tier());
+
+  uint64_t count;
+  ASSERT_OK(tablet->CountRows(&count));
+  ASSERT_EQ(200, count);
+}
+
 // Test that we find the correct log segment size for different indexes.
 TEST(TestTablet, TestGetReplaySizeForIndex) {
   std::map<int64_t, int64_t> replay_size_map;
@@ -20,7 +20,9 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -34,37 +36,58 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/codegen/compilation_manager.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/key_range.h"
+#include "kudu/common/key_util.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
+#include "kudu/common/top_n_threshold.h"
 #include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/fs/io_context.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/hash/city.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/human_readable.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/threading/thread_collision_warner.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/compaction_policy.h"
+#include "kudu/tablet/delta_applier.h"
+#include "kudu/tablet/delta_key.h"
+#include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/delta_tracker.h"
+#include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/diskrowset.h"
+#include "kudu/tablet/hot_key_tracker.h"
 #include "kudu/tablet/memrowset.h"
+#include "kudu/tablet/row_cache.h"
 #include "kudu/tablet/row_op.h"
 #include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/rowset_metadata.h"
@@ -74,8 +97,11 @@
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_mm_ops.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/ingest_rowset_transaction.h"
+#include "kudu/tablet/transactions/transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/debug/trace_event.h"
@@ -85,11 +111,14 @@
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/numa.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/throttler.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/url-coding.h"
@@ -98,6 +127,73 @@ DEFINE_int32(tablet_compaction_budget_mb, 128,
              "Budget for a single compaction");
 TAG_FLAG(tablet_compaction_budget_mb, experimental);
 
+DEFINE_int32(tablet_fast_tier_max_compaction_input_mb, 64,
+             "Compactions whose input rowsets total at most this many MB write "
+             "their output to the fast storage tier, like flushes do. Larger "
+             "compactions write to the slow tier. Only relevant if "
+             "--fs_fast_tier_data_dirs is set.");
+TAG_FLAG(tablet_fast_tier_max_compaction_input_mb, experimental);
+TAG_FLAG(tablet_fast_tier_max_compaction_input_mb, runtime);
+
+DEFINE_int32(tablet_cold_rowset_secs, 6 * 60 * 60,
+             "Rowsets in the fast storage tier that haven't been scanned for "
+             "this many seconds are rewritten to the slow tier. Only relevant "
+             "if --fs_fast_tier_data_dirs is set.");
+TAG_FLAG(tablet_cold_rowset_secs, experimental);
+TAG_FLAG(tablet_cold_rowset_secs, runtime);
+
+DEFINE_string(tablet_time_window_compaction_tables, "",
+              "Comma-separated list of the names of tables whose tablets use the "
+              "time-window compaction policy, which only compacts rowsets whose "
+              "first keys fall in the same time window, instead of the default "
+              "budgeted policy. The first primary key column of these tables must "
+              "be of type UNIXTIME_MICROS. Applies to tablets opened after it's set.");
+TAG_FLAG(tablet_time_window_compaction_tables, experimental);
+
+DEFINE_int64(tablet_time_window_compaction_window_secs, 24 * 60 * 60,
+             "Width of the time windows of the time-window compaction policy.");
+TAG_FLAG(tablet_time_window_compaction_window_secs, experimental);
+
+DEFINE_int64(tablet_time_window_compaction_seal_age_secs, 24 * 60 * 60,
+             "Time after the end of a time window after which the time-window "
+             "compaction policy no longer compacts its rowsets. If 0, windows "
+             "are never sealed.");
+TAG_FLAG(tablet_time_window_compaction_seal_age_secs, experimental);
+
+// The time-window flags are converted to microseconds when a tablet is opened.
+static const int64_t kMaxTimeWindowSecs = std::numeric_limits<int64_t>::max() / 1000000;
+
+static bool ValidateTimeWindowSecs(const char* flagname, int64_t value) {
+  if (value <= 0 || value > kMaxTimeWindowSecs) {
+    LOG(ERROR) << "Invalid value for " << flagname << ": " << value
+               << " (must be between 1 and " << kMaxTimeWindowSecs << ")";
+    return false;
+  }
+  return true;
+}
+DEFINE_validator(tablet_time_window_compaction_window_secs, &ValidateTimeWindowSecs);
+
+static bool ValidateTimeWindowSealAgeSecs(const char* flagname, int64_t value) {
+  if (value < 0 || value > kMaxTimeWindowSecs) {
+    LOG(ERROR) << "Invalid value for " << flagname << ": " << value
+               << " (must be between 0 and " << kMaxTimeWindowSecs << ")";
+    return false;
+  }
+  return true;
+}
+DEFINE_validator(tablet_time_window_compaction_seal_age_secs, &ValidateTimeWindowSealAgeSecs);
+
+DEFINE_string(tablet_row_ttl_tables, "",
+              "Comma-separated list of <table name>=<seconds> entries setting the "
+              "time to live of the rows of the listed tables. A row expires once the "
+              "value of its first primary key column, which must be of type "
+              "UNIXTIME_MICROS, is that many seconds in the past. Expired rows are "
+              "hidden from scans, can no longer be updated or deleted, and are "
+              "dropped by flushes and compactions. Rowsets all of whose rows have "
+              "expired are deleted without being rewritten. Applies to tablets "
+              "opened after it's set.");
+TAG_FLAG(tablet_row_ttl_tables, experimental);
+
 DEFINE_int32(tablet_bloom_block_size, 4096,
              "Block size of the bloom filters used for tablet keys.");
 TAG_FLAG(tablet_bloom_block_size, advanced);
@@ -157,20 +253,124 @@ DEFINE_int32(max_encoded_key_size_bytes, 16 * 1024,
              "result in an error.");
 TAG_FLAG(max_encoded_key_size_bytes, unsafe);
 
+DEFINE_int64(scan_read_ahead_budget_bytes, 16 * 1024 * 1024,
+             "The maximum number of bytes of CFile data blocks that a single scan "
+             "may have read ahead of its current position. Only relevant if "
+             "--cfile_read_ahead_blocks is positive.");
+TAG_FLAG(scan_read_ahead_budget_bytes, experimental);
+TAG_FLAG(scan_read_ahead_budget_bytes, runtime);
+
+DEFINE_int32(tablet_scan_parallelism, 1,
+             "The maximum number of rowsets that an UNORDERED scan of a single tablet "
+             "reads concurrently, on the threads of the pool sized by "
+             "--tablet_scan_threads. If 1, the rowsets are read one after the other "
+             "by the thread doing the scan.");
+TAG_FLAG(tablet_scan_parallelism, experimental);
+TAG_FLAG(tablet_scan_parallelism, runtime);
+
+DEFINE_int32(tablet_scan_threads, 16,
+             "The number of threads, shared by all tablets, on which UNORDERED scans "
+             "read rowsets concurrently. Only relevant if --tablet_scan_parallelism "
+             "is greater than 1.");
+TAG_FLAG(tablet_scan_threads, experimental);
+
+DEFINE_int32(tablet_scan_queued_blocks_per_rowset, 2,
+             "The number of blocks of rows read ahead by a parallel scan of a tablet, "
+             "per rowset read concurrently, that may be buffered before the scan's "
+             "results are consumed. Only relevant if --tablet_scan_parallelism is "
+             "greater than 1.");
+TAG_FLAG(tablet_scan_queued_blocks_per_rowset, experimental);
+TAG_FLAG(tablet_scan_queued_blocks_per_rowset, runtime);
+
+DEFINE_bool(tablet_apply_ops_in_key_order, true,
+            "Whether the row operations of a write are applied in the order of "
+            "their primary keys rather than in the order they were sent. Inserts "
+            "into the MemRowSet then touch neighbouring tree nodes one after "
+            "another. Operations on the same key keep their relative order.");
+TAG_FLAG(tablet_apply_ops_in_key_order, advanced);
+TAG_FLAG(tablet_apply_ops_in_key_order, runtime);
+
+DEFINE_double(undo_delta_block_gc_rewrite_min_ancient_ratio, 0.3,
+              "Minimum estimated fraction of ancient deltas an UNDO delta block "
+              "must hold before undo delta block GC rewrites it without them. "
+              "Blocks lying entirely before the ancient history mark are always "
+              "deleted regardless of this setting.");
+TAG_FLAG(undo_delta_block_gc_rewrite_min_ancient_ratio, advanced);
+TAG_FLAG(undo_delta_block_gc_rewrite_min_ancient_ratio, experimental);
+TAG_FLAG(undo_delta_block_gc_rewrite_min_ancient_ratio, runtime);
+
+DEFINE_int32(tablet_hot_key_sample_rate, 16,
+             "One in how many written rows and point lookups the tablets sample "
+             "to track their most accessed keys. 0 disables the tracking.");
+TAG_FLAG(tablet_hot_key_sample_rate, advanced);
+TAG_FLAG(tablet_hot_key_sample_rate, experimental);
+
+DEFINE_int32(tablet_hot_key_capacity, 32,
+             "How many keys each tablet tracks the accesses of, for writes and "
+             "for point lookups. Keys receiving more than 1/capacity of the "
+             "accesses are guaranteed to be tracked.");
+TAG_FLAG(tablet_hot_key_capacity, advanced);
+TAG_FLAG(tablet_hot_key_capacity, experimental);
+
+DEFINE_int32(tablet_hot_key_decay_interval_sec, 60,
+             "How often, in seconds, the access counts of the hot keys of the "
+             "tablets are halved, so that they reflect the recent load.");
+TAG_FLAG(tablet_hot_key_decay_interval_sec, advanced);
+TAG_FLAG(tablet_hot_key_decay_interval_sec, experimental);
+
+DEFINE_bool(tablet_numa_placement, false,
+            "Whether to assign each tablet to a NUMA node, by a hash of its id, "
+            "and to ask the kernel to place the memory of the tablet's "
+            "MemRowSets on that node. Combined with "
+            "--rpc_service_thread_numa_affinity and --cache_numa_local_shards, "
+            "this spreads the tablets' in-memory data over the nodes rather than "
+            "on whichever node happened to first touch it. Has no effect on "
+            "machines with fewer than two NUMA nodes.");
+TAG_FLAG(tablet_numa_placement, experimental);
+
+DEFINE_int64(tablet_row_cache_capacity_mb, 0,
+             "Capacity of the cache each tablet keeps of the rows most recently "
+             "looked up by their full primary keys, in MiB. Repeated point "
+             "lookups of these rows are answered without reading the rowsets, "
+             "until the rows are written to. 0 disables the caches.");
+TAG_FLAG(tablet_row_cache_capacity_mb, advanced);
+TAG_FLAG(tablet_row_cache_capacity_mb, experimental);
+
 METRIC_DEFINE_entity(tablet);
 METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
                          kudu::MetricUnit::kBytes,
                          "Size of this tablet's memrowset");
+METRIC_DEFINE_gauge_size(tablet, memrowset_bytes_per_row, "MemRowSet Memory Usage Per Row",
+                         kudu::MetricUnit::kBytes,
+                         "Memory used by this tablet's memrowset divided by the number of "
+                         "rows inserted into it, including the overhead of its tree and of "
+                         "the rows' mutations. 0 if the memrowset is empty.");
 METRIC_DEFINE_gauge_size(tablet, on_disk_data_size, "Tablet Data Size On Disk",
                          kudu::MetricUnit::kBytes,
                          "Space used by this tablet's data blocks.");
 METRIC_DEFINE_gauge_size(tablet, num_rowsets_on_disk, "Tablet Number of Rowsets on Disk",
                          kudu::MetricUnit::kUnits,
                          "Number of diskrowsets in this tablet");
+METRIC_DEFINE_gauge_double(tablet, hot_write_key_share, "Hottest Written Key Share",
+                           kudu::MetricUnit::kUnits,
+                           "Share, between 0 and 1, of the recently written rows of this "
+                           "tablet which had its most written key. See the tablet's web "
+                           "page for the hottest keys.");
+METRIC_DEFINE_gauge_double(tablet, hot_point_read_key_share, "Hottest Looked Up Key Share",
+                           kudu::MetricUnit::kUnits,
+                           "Share, between 0 and 1, of the recent point lookups of this "
+                           "tablet which were of its most looked up key. See the tablet's "
+                           "web page for the hottest keys.");
+
+DECLARE_bool(mrs_use_codegen);
 
 using kudu::MaintenanceManager;
 using kudu::clock::HybridClock;
+using kudu::fs::BlockCreationTransaction;
+using kudu::fs::CreateBlockOptions;
 using kudu::fs::IOContext;
+using kudu::fs::ReadableBlock;
+using kudu::fs::WritableBlock;
 using kudu::log::LogAnchorRegistry;
 using std::endl;
 using std::ostream;
@@ -178,6 +378,7 @@ using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unordered_set;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -188,10 +389,166 @@ struct IteratorStats;
 
 namespace tablet {
 
-static CompactionPolicy *CreateCompactionPolicy() {
+static CompactionPolicy *CreateCompactionPolicy(const TabletMetadata& metadata) {
+  const vector<string> tables = strings::Split(FLAGS_tablet_time_window_compaction_tables,
+                                               ",", strings::SkipEmpty());
+  if (std::find(tables.begin(), tables.end(), metadata.table_name()) != tables.end()) {
+    const Schema& schema = metadata.schema();
+    if (schema.column(0).type_info()->type() == UNIXTIME_MICROS) {
+      return new TimeWindowCompactionPolicy(
+          FLAGS_tablet_compaction_budget_mb,
+          FLAGS_tablet_time_window_compaction_window_secs * 1000000,
+          FLAGS_tablet_time_window_compaction_seal_age_secs * 1000000);
+    }
+    LOG(WARNING) << "T " << metadata.tablet_id() << ": not using the time-window "
+                 << "compaction policy for table " << metadata.table_name()
+                 << ": its first key column " << schema.column(0).name()
+                 << " isn't of type UNIXTIME_MICROS";
+  }
   return new BudgetedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
 }
 
+// Returns the time to live of the rows of the tablet's table set by
+// --tablet_row_ttl_tables, or 0 if its rows don't expire.
+static int64_t GetRowTtlMicros(const TabletMetadata& metadata) {
+  const vector<string> entries = strings::Split(FLAGS_tablet_row_ttl_tables,
+                                                ",", strings::SkipEmpty());
+  for (const string& entry : entries) {
+    string::size_type sep = entry.rfind('=');
+    if (sep == string::npos || entry.compare(0, sep, metadata.table_name()) != 0) {
+      continue;
+    }
+    int64_t ttl_secs;
+    if (!safe_strto64(entry.substr(sep + 1), &ttl_secs) || ttl_secs <= 0) {
+      LOG(WARNING) << "T " << metadata.tablet_id() << ": ignoring invalid row time to live "
+                   << "for table " << metadata.table_name() << ": " << entry;
+      return 0;
+    }
+    const Schema& schema = metadata.schema();
+    if (schema.column(0).type_info()->type() != UNIXTIME_MICROS) {
+      LOG(WARNING) << "T " << metadata.tablet_id() << ": not expiring the rows of table "
+                   << metadata.table_name() << ": its first key column "
+                   << schema.column(0).name() << " isn't of type UNIXTIME_MICROS";
+      return 0;
+    }
+    return ttl_secs * 1000000;
+  }
+  return 0;
+}
+
+// Returns the NUMA node the tablet 'tablet_id' is assigned to by
+// --tablet_numa_placement, or -1 if it isn't assigned to any.
+static int GetTabletNumaNode(const string& tablet_id) {
+  if (!FLAGS_tablet_numa_placement) {
+    return -1;
+  }
+  int num_nodes = NumNumaNodes();
+  if (num_nodes < 2) {
+    return -1;
+  }
+  return util_hash::CityHash64(tablet_id.data(), tablet_id.size()) % num_nodes;
+}
+
+// Returns the thread pool, shared by all tablets, on which parallel
+// UNORDERED scans read their rowsets.
+static ThreadPool* ScanPool() {
+  static ThreadPool* pool = [] {
+    gscoped_ptr<ThreadPool> pool;
+    CHECK_OK(ThreadPoolBuilder("tablet-scan")
+             .set_max_threads(FLAGS_tablet_scan_threads)
+             .Build(&pool));
+    return pool.release();
+  }();
+  return pool;
+}
+
+namespace {
+
+// Returns the cell for the raw cell contents (or slice contents for BINARY
+// types) 'bytes' of a column of type 'typeinfo'. The cell is either copied
+// into 'buf' or, for BINARY types, points into 'bytes'.
+const void* CellFromStatsBytes(const TypeInfo* typeinfo, const string& bytes,
+                               TopNThreshold::Bound* buf) {
+  if (typeinfo->physical_type() == BINARY) {
+    Slice slice(bytes);
+    memcpy(buf->cell, &slice, sizeof(slice));
+  } else {
+    DCHECK_EQ(bytes.size(), typeinfo->size());
+    memcpy(buf->cell, bytes.data(), typeinfo->size());
+  }
+  return buf->cell;
+}
+
+// Wraps the iterator of a rowset in a top-N scan, and ends it early once the
+// column statistics of the rowset show that none of its rows can beat the
+// scan's current threshold.
+class TopNPruningIterator : public RowwiseIterator {
+ public:
+  TopNPruningIterator(unique_ptr<RowwiseIterator> iter,
+                      shared_ptr<TopNThreshold> threshold,
+                      cfile::ZoneMapEntryPB stats)
+      : iter_(std::move(iter)),
+        threshold_(std::move(threshold)),
+        stats_(std::move(stats)),
+        checked_version_(0),
+        pruned_(false) {
+  }
+
+  Status Init(ScanSpec* spec) override {
+    return iter_->Init(spec);
+  }
+
+  bool HasNext() const override {
+    return !IsPruned() && iter_->HasNext();
+  }
+
+  Status NextBlock(RowBlock* dst) override {
+    return iter_->NextBlock(dst);
+  }
+
+  string ToString() const override {
+    return Substitute("TopNPruning($0)", iter_->ToString());
+  }
+
+  const Schema& schema() const override {
+    return iter_->schema();
+  }
+
+  void GetIteratorStats(vector<IteratorStats>* stats) const override {
+    iter_->GetIteratorStats(stats);
+  }
+
+ private:
+  bool IsPruned() const {
+    if (pruned_) {
+      return true;
+    }
+    const int64_t version = threshold_->version();
+    if (version == checked_version_) {
+      return false;
+    }
+    checked_version_ = version;
+    TopNThreshold::Bound bound;
+    boost::optional<ColumnPredicate> pred = threshold_->BeatingValuesPredicate(&bound);
+    if (pred && !cfile::ZoneMayMatch(threshold_->column().type_info(), stats_, *pred)) {
+      TRACE_COUNTER_INCREMENT("rowsets_pruned_by_top_n", 1);
+      pruned_ = true;
+    }
+    return pruned_;
+  }
+
+  const unique_ptr<RowwiseIterator> iter_;
+  const shared_ptr<TopNThreshold> threshold_;
+  const cfile::ZoneMapEntryPB stats_;
+
+  // The version of the threshold last checked against 'stats_', and whether
+  // it ruled out the rest of the rowset.
+  mutable int64_t checked_version_;
+  mutable bool pruned_;
+};
+
+} // anonymous namespace
+
 ////////////////////////////////////////////////////////////
 // TabletComponents
 ////////////////////////////////////////////////////////////
@@ -215,10 +572,12 @@ Tablet::Tablet(scoped_refptr<TabletMetadata> metadata,
     mem_trackers_(tablet_id(), std::move(parent_mem_tracker)),
     next_mrs_id_(0),
     clock_(std::move(clock)),
+    row_ttl_micros_(GetRowTtlMicros(*metadata_.get())),
+    numa_node_(GetTabletNumaNode(tablet_id())),
     rowsets_flush_sem_(1),
     state_(kInitialized) {
       CHECK(schema()->has_column_ids());
-  compaction_policy_.reset(CreateCompactionPolicy());
+  compaction_policy_.reset(CreateCompactionPolicy(*metadata_.get()));
 
   if (metric_registry) {
     MetricEntity::AttributeMap attrs;
@@ -231,6 +590,9 @@ Tablet::Tablet(scoped_refptr<TabletMetadata> metadata,
     METRIC_memrowset_size.InstantiateFunctionGauge(
       metric_entity_, Bind(&Tablet::MemRowSetSize, Unretained(this)))
       ->AutoDetach(&metric_detacher_);
+    METRIC_memrowset_bytes_per_row.InstantiateFunctionGauge(
+      metric_entity_, Bind(&Tablet::MemRowSetSizePerRow, Unretained(this)))
+      ->AutoDetach(&metric_detacher_);
     METRIC_on_disk_data_size.InstantiateFunctionGauge(
       metric_entity_, Bind(&Tablet::OnDiskDataSize, Unretained(this)))
       ->AutoDetach(&metric_detacher_);
@@ -239,6 +601,32 @@ Tablet::Tablet(scoped_refptr<TabletMetadata> metadata,
       ->AutoDetach(&metric_detacher_);
   }
 
+  if (FLAGS_tablet_hot_key_sample_rate > 0) {
+    const MonoDelta decay_interval =
+        MonoDelta::FromSeconds(FLAGS_tablet_hot_key_decay_interval_sec);
+    hot_write_keys_.reset(new HotKeyTracker(FLAGS_tablet_hot_key_capacity,
+                                            FLAGS_tablet_hot_key_sample_rate,
+                                            decay_interval));
+    hot_point_read_keys_.reset(new HotKeyTracker(FLAGS_tablet_hot_key_capacity,
+                                                 FLAGS_tablet_hot_key_sample_rate,
+                                                 decay_interval));
+    if (metric_entity_) {
+      METRIC_hot_write_key_share.InstantiateFunctionGauge(
+        metric_entity_, Bind(&HotKeyTracker::HottestKeyShare,
+                             Unretained(hot_write_keys_.get())))
+        ->AutoDetach(&metric_detacher_);
+      METRIC_hot_point_read_key_share.InstantiateFunctionGauge(
+        metric_entity_, Bind(&HotKeyTracker::HottestKeyShare,
+                             Unretained(hot_point_read_keys_.get())))
+        ->AutoDetach(&metric_detacher_);
+    }
+  }
+
+  if (FLAGS_tablet_row_cache_capacity_mb > 0) {
+    row_cache_.reset(new RowCache(FLAGS_tablet_row_cache_capacity_mb * 1024 * 1024,
+                                  "tablet-row-cache"));
+  }
+
   if (FLAGS_tablet_throttler_rpc_per_sec > 0 || FLAGS_tablet_throttler_bytes_per_sec > 0) {
     throttler_.reset(new Throttler(MonoTime::Now(),
                                    FLAGS_tablet_throttler_rpc_per_sec,
@@ -305,9 +693,16 @@ Status Tablet::Open() {
   RETURN_NOT_OK(MemRowSet::Create(next_mrs_id_++, *schema(),
                                   log_anchor_registry_.get(),
                                   mem_trackers_.tablet_tracker,
+                                  numa_node_,
                                   &new_mrs));
   components_ = new TabletComponents(new_mrs, new_rowset_tree);
 
+  // Have the first scans of the MemRowSet find compiled projectors.
+  if (FLAGS_mrs_use_codegen) {
+    codegen::CompilationManager::GetSingleton()->PrecompileRowProjectors(
+        metadata_->table_id(), *schema());
+  }
+
   {
     std::lock_guard<simple_spinlock> l(state_lock_);
     if (state_ != kInitialized) {
@@ -412,13 +807,233 @@ Status Tablet::NewRowIterator(const Schema &projection,
                               const MvccSnapshot &snap,
                               const OrderMode order,
                               gscoped_ptr<RowwiseIterator> *iter) const {
+  RowIteratorOptions opts;
+  opts.projection = &projection;
+  opts.snap_to_include = snap;
+  opts.order = order;
+  return NewRowIterator(std::move(opts), iter);
+}
+
+Status Tablet::NewRowIterator(RowIteratorOptions opts,
+                              gscoped_ptr<RowwiseIterator> *iter) const {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
   if (metrics_) {
     metrics_->scans_started->Increment();
   }
   IOContext io_context({ tablet_id() });
-  VLOG_WITH_PREFIX(2) << "Created new Iterator under snap: " << snap.ToString();
-  iter->reset(new Iterator(this, projection, snap, order, std::move(io_context)));
+  if (opts.snap_to_exclude) {
+    VLOG_WITH_PREFIX(2) << "Created new Iterator between snaps: "
+                        << opts.snap_to_exclude->ToString() << " and "
+                        << opts.snap_to_include.ToString();
+  } else {
+    VLOG_WITH_PREFIX(2) << "Created new Iterator under snap: "
+                        << opts.snap_to_include.ToString();
+  }
+  iter->reset(new Iterator(this, std::move(opts), std::move(io_context)));
+  return Status::OK();
+}
+
+Status Tablet::MultiGet(const Schema& projection,
+                        const MvccSnapshot& snap,
+                        const vector<Slice>& encoded_keys,
+                        RowBlock* rows) const {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  DCHECK_GE(rows->row_capacity(), encoded_keys.size());
+  Schema mapped_projection;
+  RETURN_NOT_OK(GetMappedReadProjection(projection, &mapped_projection));
+  rows->Resize(encoded_keys.size());
+  rows->selection_vector()->SetAllFalse();
+  if (encoded_keys.empty()) {
+    return Status::OK();
+  }
+
+  // Decode the keys, and sort them with their indexes. Each distinct key is
+  // looked up once, and its row copied to the other rows of the key at the
+  // end.
+  struct KeyLookup {
+    gscoped_ptr<EncodedKey> key;
+    gscoped_ptr<EncodedKey> upper_bound;
+    unique_ptr<RowSetKeyProbe> probe;
+    int row_idx;
+    bool found;
+  };
+  Arena arena(1024);
+  vector<KeyLookup> lookups(encoded_keys.size());
+  for (int i = 0; i < encoded_keys.size(); i++) {
+    KeyLookup* lookup = &lookups[i];
+    RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(key_schema_, &arena, encoded_keys[i],
+                                                          &lookup->key),
+                          "invalid primary key");
+    uint8_t* row_data = static_cast<uint8_t*>(arena.AllocateBytes(key_schema_.key_byte_size()));
+    ContiguousRow key_row(&key_schema_, row_data);
+    for (int col = 0; col < key_schema_.num_key_columns(); col++) {
+      memcpy(key_row.mutable_cell_ptr(col), lookup->key->raw_keys()[col],
+             key_schema_.column(col).type_info()->size());
+    }
+    lookup->probe.reset(new RowSetKeyProbe(ConstContiguousRow(key_row), lookup->key->Copy()));
+    // The greatest possible key needs no upper bound.
+    lookup->upper_bound = lookup->key->Copy();
+    Status s = EncodedKey::IncrementEncodedKey(key_schema_, &lookup->upper_bound, &arena);
+    if (s.IsIllegalState()) {
+      lookup->upper_bound.reset();
+    } else {
+      RETURN_NOT_OK(s);
+    }
+    lookup->row_idx = i;
+    lookup->found = false;
+  }
+  vector<KeyLookup*> sorted;
+  sorted.reserve(lookups.size());
+  for (KeyLookup& lookup : lookups) {
+    sorted.push_back(&lookup);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [](const KeyLookup* a, const KeyLookup* b) {
+    return a->key->encoded_key().compare(b->key->encoded_key()) < 0;
+  });
+  vector<std::pair<int, int>> duplicates;
+  vector<KeyLookup*> unique_lookups;
+  vector<Slice> keys;
+  for (KeyLookup* lookup : sorted) {
+    if (!unique_lookups.empty() &&
+        unique_lookups.back()->key->encoded_key() == lookup->key->encoded_key()) {
+      duplicates.emplace_back(unique_lookups.back()->row_idx, lookup->row_idx);
+      continue;
+    }
+    unique_lookups.push_back(lookup);
+    keys.push_back(lookup->key->encoded_key());
+  }
+
+  // As in a scan, the components are captured after the snapshot was taken,
+  // so that they hold all the writes the snapshot sees.
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  IOContext io_context({ tablet_id() });
+  RowIteratorOptions opts;
+  opts.projection = &mapped_projection;
+  opts.snap_to_include = snap;
+  opts.io_context = &io_context;
+
+  // Each row is read into 'scratch' and copied to the row of its lookup, if
+  // it's visible as of 'snap'.
+  Arena scratch_arena(1024);
+  RowBlock scratch(mapped_projection, 1, &scratch_arena);
+  auto read_row = [&](RowwiseIterator* iter, KeyLookup* lookup) {
+    scratch_arena.Reset();
+    RETURN_NOT_OK(iter->NextBlock(&scratch));
+    if (scratch.nrows() > 0 && scratch.selection_vector()->IsRowSelected(0)) {
+      RowBlockRow dst = rows->row(lookup->row_idx);
+      RETURN_NOT_OK(CopyRow(scratch.row(0), &dst, rows->arena()));
+      rows->selection_vector()->SetRowSelected(lookup->row_idx);
+      lookup->found = true;
+    }
+    return Status::OK();
+  };
+
+  // The keys are looked up in the MemRowSet first, in key order, through one
+  // iterator.
+  {
+    unique_ptr<MemRowSet::Iterator> iter(comps->memrowset->NewIterator(opts));
+    RETURN_NOT_OK(iter->Init(nullptr));
+    for (KeyLookup* lookup : unique_lookups) {
+      bool exact;
+      Status s = iter->SeekAtOrAfter(Slice(lookup->probe->row_key().row_data(),
+                                           key_schema_.key_byte_size()), &exact);
+      if (s.IsNotFound()) {
+        break;
+      }
+      RETURN_NOT_OK(s);
+      if (exact) {
+        RETURN_NOT_OK(read_row(iter.get(), lookup));
+      }
+    }
+  }
+
+  // Then in the flushed rowsets, whose keys are grouped by rowset and checked
+  // against their bloom filters in batches. Each DiskRowSet is read through a
+  // single iterator, positioned on the row of each key in key order.
+  vector<std::pair<RowSet*, int>> candidates;
+  comps->rowsets->ForEachRowSetContainingKeys(keys, [&](RowSet* rs, int i) {
+    candidates.emplace_back(rs, i);
+  });
+  vector<int> group_indexes;
+  vector<const RowSetKeyProbe*> group_probes;
+  vector<KeyLookup*> group_lookups;
+  vector<ProbeStats> group_stats;
+  vector<ProbeStats*> group_stats_ptrs;
+  for (size_t begin = 0; begin < candidates.size();) {
+    RowSet* rs = candidates[begin].first;
+    size_t end = begin;
+    group_indexes.clear();
+    for (; end < candidates.size() && candidates[end].first == rs; end++) {
+      if (!unique_lookups[candidates[end].second]->found) {
+        group_indexes.push_back(candidates[end].second);
+      }
+    }
+    begin = end;
+    if (group_indexes.empty()) {
+      continue;
+    }
+    std::sort(group_indexes.begin(), group_indexes.end());
+    group_probes.clear();
+    group_lookups.clear();
+    for (int i : group_indexes) {
+      group_probes.push_back(unique_lookups[i]->probe.get());
+      group_lookups.push_back(unique_lookups[i]);
+    }
+    group_stats.assign(group_lookups.size(), ProbeStats());
+    group_stats_ptrs.resize(group_lookups.size());
+    for (size_t i = 0; i < group_stats.size(); i++) {
+      group_stats_ptrs[i] = &group_stats[i];
+    }
+    unique_ptr<bool[]> maybe_present(new bool[group_lookups.size()]);
+    RETURN_NOT_OK(rs->CheckRowsMayBePresent(group_probes.data(), group_probes.size(),
+                                            &io_context, maybe_present.get(),
+                                            group_stats_ptrs.data()));
+
+    // Only a DiskRowSet has metadata; the rowsets being compacted are read
+    // with a scan per key.
+    if (rs->metadata()) {
+      gscoped_ptr<RowwiseIterator> iter;
+      DeltaApplier* applier;
+      RETURN_NOT_OK(down_cast<DiskRowSet*>(rs)->NewKeyLookupIterator(opts, &iter, &applier));
+      for (size_t i = 0; i < group_lookups.size(); i++) {
+        if (!maybe_present[i]) {
+          continue;
+        }
+        bool exact;
+        RETURN_NOT_OK(applier->SeekToKey(*group_lookups[i]->key, &exact));
+        if (exact) {
+          RETURN_NOT_OK(read_row(iter.get(), group_lookups[i]));
+        }
+      }
+      continue;
+    }
+    for (size_t i = 0; i < group_lookups.size(); i++) {
+      if (!maybe_present[i]) {
+        continue;
+      }
+      KeyLookup* lookup = group_lookups[i];
+      gscoped_ptr<RowwiseIterator> iter;
+      RETURN_NOT_OK(rs->NewRowIterator(opts, &iter));
+      ScanSpec spec;
+      spec.SetLowerBoundKey(lookup->key.get());
+      if (lookup->upper_bound) {
+        spec.SetExclusiveUpperBoundKey(lookup->upper_bound.get());
+      }
+      RETURN_NOT_OK(iter->Init(&spec));
+      while (iter->HasNext() && !lookup->found) {
+        RETURN_NOT_OK(read_row(iter.get(), lookup));
+      }
+    }
+  }
+
+  for (const auto& dup : duplicates) {
+    if (rows->selection_vector()->IsRowSelected(dup.first)) {
+      RowBlockRow dst = rows->row(dup.second);
+      RETURN_NOT_OK(CopyRow(rows->row(dup.first), &dst, rows->arena()));
+      rows->selection_vector()->SetRowSelected(dup.second);
+    }
+  }
   return Status::OK();
 }
 
@@ -457,38 +1072,64 @@ Status Tablet::AcquireRowLocks(WriteTransactionState* tx_state) {
   TRACE_EVENT1("tablet", "Tablet::AcquireRowLocks",
                "num_locks", tx_state->row_ops().size());
   TRACE("PREPARE: Acquiring locks for $0 operations", tx_state->row_ops().size());
-  for (RowOp* op : tx_state->row_ops()) {
-    RETURN_NOT_OK(AcquireLockForOp(tx_state, op));
+  const auto& row_ops = tx_state->row_ops();
+  vector<Slice> keys;
+  keys.reserve(row_ops.size());
+  for (RowOp* op : row_ops) {
+    RETURN_NOT_OK(PrepareKeyProbeForOp(op, tx_state->arena()));
+    keys.push_back(op->key_probe->encoded_key_slice());
+  }
+  RETURN_NOT_OK(CheckRowsInTablet(row_ops));
+  if (hot_write_keys_) {
+    hot_write_keys_->RecordBatch(keys.size(), [&](int i) { return keys[i]; });
+  }
+
+  // Lock all of the rows in one batch.
+  vector<ScopedRowLock> locks(row_ops.size());
+  lock_manager_.LockBatch(keys.data(), keys.size(), tx_state,
+                          LockManager::LOCK_EXCLUSIVE, locks.data());
+  for (size_t i = 0; i < row_ops.size(); i++) {
+    row_ops[i]->row_lock = std::move(locks[i]);
   }
   TRACE("PREPARE: locks acquired");
   return Status::OK();
 }
 
-Status Tablet::CheckRowInTablet(const ConstContiguousRow& row) const {
-  bool contains_row;
-  RETURN_NOT_OK(metadata_->partition_schema().PartitionContainsRow(metadata_->partition(),
-                                                                   row,
-                                                                   &contains_row));
+void Tablet::RecordPointRead(const Slice& encoded_key) {
+  if (hot_point_read_keys_) {
+    hot_point_read_keys_->Record(encoded_key);
+  }
+}
 
-  if (PREDICT_FALSE(!contains_row)) {
-    return Status::NotFound(
-        Substitute("Row not in tablet partition. Partition: '$0', row: '$1'.",
-                   metadata_->partition_schema().PartitionDebugString(metadata_->partition(),
-                                                                      *schema()),
-                   metadata_->partition_schema().PartitionKeyDebugString(row)));
+Status Tablet::CheckRowsInTablet(const vector<RowOp*>& row_ops) const {
+  vector<ConstContiguousRow> rows;
+  rows.reserve(row_ops.size());
+  for (const RowOp* op : row_ops) {
+    rows.emplace_back(&key_schema_, op->decoded_op.row_data);
+  }
+  unique_ptr<bool[]> contains_row(new bool[rows.size()]);
+  RETURN_NOT_OK(metadata_->partition_schema().PartitionContainsRows(metadata_->partition(),
+                                                                    rows.data(),
+                                                                    rows.size(),
+                                                                    contains_row.get()));
+
+  for (size_t i = 0; i < rows.size(); i++) {
+    if (PREDICT_FALSE(!contains_row[i])) {
+      return Status::NotFound(
+          Substitute("Row not in tablet partition. Partition: '$0', row: '$1'.",
+                     metadata_->partition_schema().PartitionDebugString(metadata_->partition(),
+                                                                        *schema()),
+                     metadata_->partition_schema().PartitionKeyDebugString(rows[i])));
+    }
   }
   return Status::OK();
 }
 
-Status Tablet::AcquireLockForOp(WriteTransactionState* tx_state, RowOp* op) {
+Status Tablet::PrepareKeyProbeForOp(RowOp* op, Arena* arena) {
   ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
-  op->key_probe.reset(new tablet::RowSetKeyProbe(row_key));
-  RETURN_NOT_OK(CheckRowInTablet(row_key));
-
-  op->row_lock = ScopedRowLock(&lock_manager_,
-                               tx_state,
-                               op->key_probe->encoded_key_slice(),
-                               LockManager::LOCK_EXCLUSIVE);
+  gscoped_ptr<EncodedKey> encoded_key;
+  RETURN_NOT_OK(EncodedKey::FromContiguousRow(row_key, arena, &encoded_key));
+  op->key_probe.reset(new tablet::RowSetKeyProbe(row_key, std::move(encoded_key)));
   return Status::OK();
 }
 
@@ -633,12 +1274,11 @@ Status Tablet::InsertOrUpsertUnlocked(const IOContext* io_context,
   Timestamp ts = tx_state->timestamp();
   ConstContiguousRow row(schema(), op->decoded_op.row_data);
 
-  // TODO: the Insert() call below will re-encode the key, which is a
-  // waste. Should pass through the KeyProbe structure perhaps.
-
   // Now try to op into memrowset. The memrowset itself will return
-  // AlreadyPresent if it has already been oped there.
-  Status s = comps->memrowset->Insert(ts, row, tx_state->op_id());
+  // AlreadyPresent if it has already been oped there. The key was encoded
+  // when the op was prepared.
+  Status s = comps->memrowset->Insert(ts, row, op->key_probe->encoded_key_slice(),
+                                      tx_state->op_id());
   if (s.ok()) {
     op->SetInsertSucceeded(comps->memrowset->mrs_id());
   } else {
@@ -660,6 +1300,13 @@ Status Tablet::ApplyUpsertAsUpdate(const IOContext* io_context,
                                    RowOp* upsert,
                                    RowSet* rowset,
                                    ProbeStats* stats) {
+  // See MutateRowUnlocked().
+  if (PREDICT_FALSE(IsRowOpExpired(*upsert))) {
+    Status s = Status::NotFound("key not found", "row has expired");
+    upsert->SetFailed(s);
+    return s;
+  }
+
   const auto* schema = this->schema();
   ConstContiguousRow row(schema, upsert->decoded_op.row_data);
   faststring buf;
@@ -758,6 +1405,14 @@ Status Tablet::MutateRowUnlocked(const IOContext* io_context,
   const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
   Timestamp ts = tx_state->timestamp();
 
+  // Expired rows may no longer be in the output of a concurrent flush or
+  // compaction, so they must not be mutated.
+  if (PREDICT_FALSE(IsRowOpExpired(*mutate))) {
+    Status s = Status::NotFound("key not found", "row has expired");
+    mutate->SetFailed(s);
+    return s;
+  }
+
   // If we found the row in any existing RowSet, mutate it there. Otherwise
   // attempt to mutate in the MRS.
   RowSet* rs_to_attempt = mutate->present_in_rowset ?
@@ -797,7 +1452,16 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
   // so load it up top.
   RowOp* const * row_ops_base = tx_state->row_ops().data();
 
-  // Run all of the ops through the RowSetTree.
+  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
+
+  // Keys above the max key of every flushed rowset, as inserted into tables
+  // with monotonically increasing keys, can't be present in any of them. If
+  // no rowset has unknown bounds either, those ops are checked right away:
+  // only the MemRowSet may hold them, which the insert itself checks.
+  const RowSetTree& rowsets = *comps->rowsets;
+  const bool skip_keys_above_bounds = !rowsets.has_unbounded_rowsets();
+
+  // Run all of the other ops through the RowSetTree.
   vector<pair<Slice, int>> keys_and_indexes;
   keys_and_indexes.reserve(num_ops);
   for (int i = 0; i < num_ops; i++) {
@@ -805,8 +1469,16 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
     // If the op already failed in validation, or if we've got the original result
     // filled in already during replay, then we don't need to consult the RowSetTree.
     if (op->has_result() || op->orig_result_from_log_) continue;
-    keys_and_indexes.emplace_back(op->key_probe->encoded_key_slice(), i);
+    const Slice& key = op->key_probe->encoded_key_slice();
+    if (skip_keys_above_bounds && rowsets.IsAboveBoundedRowSets(key)) {
+      // Earlier ops in the batch for the same key can't have put it in a
+      // flushed rowset either, so this holds even for duplicate keys.
+      op->checked_present = true;
+      continue;
+    }
+    keys_and_indexes.emplace_back(key, i);
   }
+  if (keys_and_indexes.empty()) return Status::OK();
 
   // Sort the query points by their probe keys, retaining the equivalent indexes.
   //
@@ -852,6 +1524,10 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
   // 'pending_group' and then calls 'ProcessPendingGroup' when the next group
   // begins.
   vector<pair<RowSet*, int>> pending_group;
+  vector<const RowSetKeyProbe*> group_probes;
+  vector<ProbeStats*> group_stats;
+  vector<int> group_op_idxs;
+  unique_ptr<bool[]> group_maybe_present(new bool[keys.size()]);
   Status s;
   const auto& ProcessPendingGroup = [&]() {
     if (pending_group.empty() || !s.ok()) return;
@@ -865,6 +1541,9 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
                             return s_a.compare(s_b) < 0;
                           }));
     RowSet* rs = pending_group[0].first;
+    group_probes.clear();
+    group_stats.clear();
+    group_op_idxs.clear();
     for (auto it = pending_group.begin();
          it != pending_group.end();
          ++it) {
@@ -875,6 +1554,26 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
         // Already found this op present somewhere.
         continue;
       }
+      group_probes.push_back(op->key_probe.get());
+      group_stats.push_back(tx_state->mutable_op_stats(op_idx));
+      group_op_idxs.push_back(op_idx);
+    }
+
+    // Rule out as many of the keys as possible in one batch (e.g. with the
+    // rowset's bloom filter) before checking the others one by one.
+    s = rs->CheckRowsMayBePresent(group_probes.data(), group_probes.size(), io_context,
+                                  group_maybe_present.get(), group_stats.data());
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << Substitute("Tablet $0 failed to check row presence: $1",
+                                 tablet_id(), s.ToString());
+      return;
+    }
+    for (size_t i = 0; i < group_op_idxs.size(); i++) {
+      if (!group_maybe_present[i]) {
+        continue;
+      }
+      int op_idx = group_op_idxs[i];
+      RowOp* op = row_ops_base[op_idx];
 
       bool present = false;
       s = rs->CheckRowPresent(*op->key_probe, io_context,
@@ -891,8 +1590,7 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
     pending_group.clear();
   };
 
-  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
-  comps->rowsets->ForEachRowSetContainingKeys(
+  rowsets.ForEachRowSetContainingKeys(
       keys,
       [&](RowSet* rs, int i) {
         if (!pending_group.empty() && rs != pending_group.back().first) {
@@ -937,16 +1635,70 @@ Status Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
   }
 
   IOContext io_context({ tablet_id() });
+  TransactionMetrics* tx_metrics = tx_state->mutable_metrics();
+  MonoTime phase_start = MonoTime::Now();
   RETURN_NOT_OK(BulkCheckPresence(&io_context, tx_state));
-
-  // Actually apply the ops.
+  MonoTime now = MonoTime::Now();
+  tx_metrics->presence_check_duration_usec += (now - phase_start).ToMicroseconds();
+
+  // Collect the ops which still need to be applied. Each op's result is kept
+  // with the op itself, so the order in which they're applied doesn't change
+  // the response. Applying them in key order means consecutive MemRowSet
+  // inserts and mutations descend to the same or neighbouring leaves, whose
+  // nodes are then still in cache. The sort is stable so that ops on the same
+  // key are applied in the order they were sent.
+  const auto& row_ops = tx_state->row_ops();
+  vector<int> apply_order;
+  apply_order.reserve(num_ops);
   for (int op_idx = 0; op_idx < num_ops; op_idx++) {
-    RowOp* row_op = tx_state->row_ops()[op_idx];
-    if (row_op->has_result()) continue;
+    if (!row_ops[op_idx]->has_result()) {
+      apply_order.push_back(op_idx);
+    }
+  }
+  if (FLAGS_tablet_apply_ops_in_key_order) {
+    auto key_less = [&](int a, int b) {
+      return row_ops[a]->key_probe->encoded_key_slice().compare(
+          row_ops[b]->key_probe->encoded_key_slice()) < 0;
+    };
+    if (!std::is_sorted(apply_order.begin(), apply_order.end(), key_less)) {
+      std::stable_sort(apply_order.begin(), apply_order.end(), key_less);
+    }
+  }
 
-    RETURN_NOT_OK(ApplyRowOperation(&io_context, tx_state, row_op,
-                                    tx_state->mutable_op_stats(op_idx)));
+  // Check the tablet's state once for the whole batch rather than once per
+  // op: 'state_lock_' is shared by all of the transactions being applied to
+  // this tablet concurrently.
+  RETURN_NOT_OK(CheckCanApply(tx_state));
+
+  // Actually apply the ops, prefetching the row data of an op a few ops ahead
+  // of the one being applied.
+  const int kPrefetchDistance = 4;
+  const int num_to_apply = apply_order.size();
+  int num_inserts = 0;
+  phase_start = MonoTime::Now();
+  for (int i = 0; i < num_to_apply; i++) {
+    if (i + kPrefetchDistance < num_to_apply) {
+      const RowOp* ahead = row_ops[apply_order[i + kPrefetchDistance]];
+      prefetch(reinterpret_cast<const char*>(ahead->decoded_op.row_data), PREFETCH_HINT_T0);
+    }
+    int op_idx = apply_order[i];
+    RowOp* row_op = row_ops[op_idx];
+    RETURN_NOT_OK(ApplyRowOperationNoStateCheck(&io_context, tx_state, row_op,
+                                                tx_state->mutable_op_stats(op_idx)));
     DCHECK(row_op->has_result());
+    const RowOperationsPB::Type type = row_op->decoded_op.type;
+    if (type == RowOperationsPB::INSERT || type == RowOperationsPB::UPSERT) {
+      num_inserts++;
+    }
+  }
+  // The loop is timed as a whole rather than op by op, and its time is split
+  // between inserting and mutating rows in proportion to the number of ops of
+  // each kind. That's exact for the usual batches of a single kind.
+  if (num_to_apply > 0) {
+    const int64_t apply_usec = (MonoTime::Now() - phase_start).ToMicroseconds();
+    const int64_t insert_usec = apply_usec * num_inserts / num_to_apply;
+    tx_metrics->mrs_insert_duration_usec += insert_usec;
+    tx_metrics->mutate_duration_usec += apply_usec - insert_usec;
   }
 
   if (metrics_ && num_ops > 0) {
@@ -955,16 +1707,26 @@ Status Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
   return Status::OK();
 }
 
+Status Tablet::CheckCanApply(const WriteTransactionState* tx_state) const {
+  std::lock_guard<simple_spinlock> l(state_lock_);
+  RETURN_NOT_OK_PREPEND(CheckHasNotBeenStoppedUnlocked(),
+      Substitute("Apply of $0 exited early", tx_state->ToString()));
+  CHECK(state_ == kOpen || state_ == kBootstrapping);
+  return Status::OK();
+}
+
 Status Tablet::ApplyRowOperation(const IOContext* io_context,
                                  WriteTransactionState* tx_state,
                                  RowOp* row_op,
                                  ProbeStats* stats) {
-  {
-    std::lock_guard<simple_spinlock> l(state_lock_);
-    RETURN_NOT_OK_PREPEND(CheckHasNotBeenStoppedUnlocked(),
-        Substitute("Apply of $0 exited early", tx_state->ToString()));
-    CHECK(state_ == kOpen || state_ == kBootstrapping);
-  }
+  RETURN_NOT_OK(CheckCanApply(tx_state));
+  return ApplyRowOperationNoStateCheck(io_context, tx_state, row_op, stats);
+}
+
+Status Tablet::ApplyRowOperationNoStateCheck(const IOContext* io_context,
+                                             WriteTransactionState* tx_state,
+                                             RowOp* row_op,
+                                             ProbeStats* stats) {
   DCHECK(row_op->has_row_lock()) << "RowOp must hold the row lock.";
   DCHECK(tx_state != nullptr) << "must have a WriteTransactionState";
   DCHECK(tx_state->op_id().IsInitialized()) << "TransactionState OpId needed for anchoring";
@@ -973,6 +1735,9 @@ Status Tablet::ApplyRowOperation(const IOContext* io_context,
   if (!ValidateOpOrMarkFailed(row_op)) {
     return Status::OK();
   }
+  if (row_cache_) {
+    row_cache_->Invalidate(row_op->key_probe->encoded_key_slice());
+  }
 
   // If we were unable to check rowset presence in batch (e.g. because we are processing
   // a batch which contains some duplicate keys) we need to do so now.
@@ -1048,7 +1813,7 @@ void Tablet::ModifyRowSetTree(const RowSetTree& old_tree,
             std::back_inserter(post_swap));
 
 
-  CHECK_OK(new_tree->Reset(post_swap));
+  CHECK_OK(new_tree->Reset(old_tree, post_swap));
 }
 
 void Tablet::AtomicSwapRowSets(const RowSetVector &old_rowsets,
@@ -1113,10 +1878,35 @@ bool Tablet::GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const
 
 HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   Timestamp ancient_history_mark;
-  if (GetTabletAncientHistoryMark(&ancient_history_mark)) {
-    return HistoryGcOpts::Enabled(ancient_history_mark);
+  HistoryGcOpts opts = GetTabletAncientHistoryMark(&ancient_history_mark) ?
+      HistoryGcOpts::Enabled(ancient_history_mark) : HistoryGcOpts::Disabled();
+  int64_t expiry_cutoff_micros;
+  if (GetRowExpiryCutoff(&expiry_cutoff_micros)) {
+    return opts.WithRowExpiry(expiry_cutoff_micros);
   }
-  return HistoryGcOpts::Disabled();
+  return opts;
+}
+
+bool Tablet::GetRowExpiryCutoff(int64_t* cutoff_micros) const {
+  // Like history GC, row expiry requires the HybridClock. Its Now() never
+  // goes backwards, so neither does the cutoff.
+  if (row_ttl_micros_ == 0 || !clock_->HasPhysicalComponent()) {
+    return false;
+  }
+  int64_t now_micros = HybridClock::GetPhysicalValueMicros(clock_->Now());
+  *cutoff_micros = now_micros - row_ttl_micros_;
+  return true;
+}
+
+bool Tablet::IsRowOpExpired(const RowOp& op) const {
+  // Operations replayed during bootstrap had already been applied, and there
+  // are no concurrent compactions to race with.
+  int64_t cutoff_micros;
+  if (PREDICT_TRUE(row_ttl_micros_ == 0) || op.orig_result_from_log_ ||
+      !GetRowExpiryCutoff(&cutoff_micros)) {
+    return false;
+  }
+  return *reinterpret_cast<const int64_t*>(op.key_probe->row_key().cell_ptr(0)) < cutoff_micros;
 }
 
 Status Tablet::Flush() {
@@ -1161,6 +1951,7 @@ Status Tablet::ReplaceMemRowSetUnlocked(RowSetsInCompaction *compaction,
   RETURN_NOT_OK(MemRowSet::Create(next_mrs_id_++, *schema(),
                                   log_anchor_registry_.get(),
                                   mem_trackers_.tablet_tracker,
+                                  numa_node_,
                                   &new_mrs));
   shared_ptr<RowSetTree> new_rst(new RowSetTree());
   ModifyRowSetTree(*components_->rowsets,
@@ -1215,7 +2006,8 @@ Status Tablet::FlushInternal(const RowSetsInCompaction& input,
   input.DumpToLog();
   LOG_WITH_PREFIX(INFO) << "Memstore in-memory size: " << old_ms->memory_footprint() << " bytes";
 
-  RETURN_NOT_OK(DoMergeCompactionOrFlush(input, mrs_being_flushed));
+  RETURN_NOT_OK(DoMergeCompactionOrFlush(input, mrs_being_flushed, /*prefer_fast_tier=*/true,
+                                         /*should_abort=*/nullptr));
 
   // Sanity check that no insertions happened during our flush.
   CHECK_EQ(start_insert_count, old_ms->debug_insert_count())
@@ -1277,9 +2069,303 @@ Status Tablet::AlterSchema(AlterSchemaTransactionState *tx_state) {
     return metadata_->Flush();
   }
 
+  // The MemRowSet flushed below is replaced by one with the new schema, which
+  // no compiled projector fits yet.
+  if (FLAGS_mrs_use_codegen) {
+    codegen::CompilationManager::GetSingleton()->PrecompileRowProjectors(
+        metadata_->table_id(), *tx_state->schema());
+  }
+
   return FlushUnlocked();
 }
 
+Status Tablet::StageRowSetForIngest(const string& ingest_id,
+                                    uint32_t schema_version,
+                                    const string& source_fs_root,
+                                    const RowSetDataPB& source) {
+  if (source.redo_deltas_size() > 0) {
+    return Status::InvalidArgument("ingested rowsets may not have REDO delta blocks");
+  }
+  RETURN_NOT_OK(CheckIngestSchemaVersion(schema_version));
+
+  shared_ptr<DiskRowSet> rowset;
+  RETURN_NOT_OK_PREPEND(CopyRowSetForIngest(source_fs_root, source, &rowset),
+                        "Unable to copy the rowset to ingest");
+  const shared_ptr<RowSetMetadata>& meta = rowset->metadata();
+  Status s = CheckIngestedRowSetColumns(*meta);
+  if (s.ok()) {
+    // Each ingested row gets an UNDO delta, which an empty rowset has no use
+    // for.
+    IOContext io_context({ tablet_id() });
+    rowid_t num_rows;
+    s = rowset->CountRows(&io_context, &num_rows);
+    if (s.ok() && num_rows == 0) {
+      s = Status::InvalidArgument("the rowset has no rows");
+    }
+  }
+  if (s.ok()) {
+    // Record the key bounds read back from the copy, so that the key range
+    // can be checked without opening the rowset again.
+    string min_key;
+    string max_key;
+    s = rowset->GetBounds(&min_key, &max_key);
+    if (s.ok()) {
+      meta->set_min_encoded_key(min_key);
+      meta->set_max_encoded_key(max_key);
+    }
+  }
+  if (!s.ok()) {
+    metadata_->AddOrphanedBlocks(meta->GetAllBlocks());
+    return s;
+  }
+  RETURN_NOT_OK(metadata_->StageRowSetAndFlush(ingest_id, meta));
+  LOG_WITH_PREFIX(INFO) << "Staged rowset " << meta->ToString() << " for ingest id "
+                        << ingest_id << " ("
+                        << HumanReadableNumBytes::ToString(rowset->OnDiskSize()) << ")";
+  return Status::OK();
+}
+
+Status Tablet::DiscardStagedRowSet(const string& ingest_id) {
+  return metadata_->DiscardStagedRowSetAndFlush(ingest_id);
+}
+
+void Tablet::StartTransaction(IngestRowSetTransactionState* tx_state) {
+  gscoped_ptr<ScopedTransaction> mvcc_tx;
+  DCHECK(tx_state->has_timestamp());
+  mvcc_tx.reset(new ScopedTransaction(&mvcc_, tx_state->timestamp()));
+  tx_state->SetMvccTx(std::move(mvcc_tx));
+}
+
+void Tablet::CreatePreparedIngestRowSet(IngestRowSetTransactionState* tx_state) {
+  // Like alter schema, ingestion must run when no writes are in progress, so
+  // that the key range check and the addition of the rowset are ordered with
+  // respect to writes the same way on every replica.
+  tx_state->AcquireSchemaLock(&schema_lock_);
+}
+
+Status Tablet::CheckPreparedIngestRowSet(const IngestRowSetTransactionState* tx_state) const {
+  DCHECK(schema_lock_.is_write_locked());
+  const tserver::IngestRowSetRequestPB* req = tx_state->request();
+  RETURN_NOT_OK(CheckIngestSchemaVersion(req->schema_version()));
+  shared_ptr<RowSetMetadata> meta = metadata_->GetStagedRowSet(req->ingest_id());
+  if (!meta) {
+    return Status::NotFound("no rowset staged under ingest id", req->ingest_id());
+  }
+  // The schema may have been altered since the rowset was staged.
+  RETURN_NOT_OK(CheckIngestedRowSetColumns(*meta));
+  return CheckNoRowsInRange(meta->min_encoded_key(), meta->max_encoded_key());
+}
+
+Status Tablet::IngestRowSet(IngestRowSetTransactionState* tx_state, int64_t op_index) {
+  DCHECK(schema_lock_.is_locked());
+  const string& ingest_id = tx_state->request()->ingest_id();
+  shared_ptr<RowSetMetadata> meta = metadata_->GetStagedRowSet(ingest_id);
+  if (!meta) {
+    return Status::NotFound("no rowset staged under ingest id", ingest_id);
+  }
+  BlockId undo_block;
+  RETURN_NOT_OK_PREPEND(WriteIngestUndoDeltas(meta, tx_state->timestamp(), &undo_block),
+                        "Unable to write the UNDO deltas of the staged rowset");
+
+  // Persist the rowset and its UNDO deltas along with the index of this
+  // operation, so that it isn't ingested again when replaying the WAL.
+  RETURN_NOT_OK(metadata_->AddIngestedRowSetAndFlush(ingest_id, undo_block, op_index));
+  IOContext io_context({ tablet_id() });
+  shared_ptr<DiskRowSet> rowset;
+  RETURN_NOT_OK_PREPEND(DiskRowSet::Open(meta, log_anchor_registry_.get(), mem_trackers_,
+                                         &io_context, &rowset),
+                        "Unable to open the ingested rowset");
+  tx_state->StartApplying();
+  AtomicSwapRowSets({}, { rowset });
+  LOG_WITH_PREFIX(INFO) << "Ingested rowset " << meta->ToString()
+                        << " (" << HumanReadableNumBytes::ToString(rowset->OnDiskSize())
+                        << ")";
+  return Status::OK();
+}
+
+Status Tablet::WriteIngestUndoDeltas(const shared_ptr<RowSetMetadata>& meta,
+                                     Timestamp timestamp,
+                                     BlockId* undo_block) {
+  IOContext io_context({ tablet_id() });
+  shared_ptr<DiskRowSet> rowset;
+  RETURN_NOT_OK(DiskRowSet::Open(meta, log_anchor_registry_.get(), mem_trackers_,
+                                 &io_context, &rowset));
+  rowid_t num_rows;
+  RETURN_NOT_OK(rowset->CountRows(&io_context, &num_rows));
+  DCHECK_GT(num_rows, 0);
+
+  // The UNDO of an insert is a DELETE at the insert's timestamp, as written
+  // by flushes.
+  unique_ptr<WritableBlock> block;
+  RETURN_NOT_OK(metadata_->fs_manager()->CreateNewBlock(CreateBlockOptions({ tablet_id() }),
+                                                        &block));
+  *undo_block = block->id();
+  DeltaFileWriter writer(std::move(block));
+  RETURN_NOT_OK(writer.Start());
+  faststring buf;
+  RowChangeListEncoder encoder(&buf);
+  encoder.SetToDelete();
+  const RowChangeList undo_delete = encoder.as_changelist();
+  DeltaStats stats;
+  for (rowid_t row_idx = 0; row_idx < num_rows; row_idx++) {
+    RETURN_NOT_OK(writer.AppendDelta<UNDO>(DeltaKey(row_idx, timestamp), undo_delete));
+    RETURN_NOT_OK(stats.UpdateStats(timestamp, undo_delete));
+  }
+  writer.WriteDeltaStats(stats);
+  return writer.Finish();
+}
+
+Status Tablet::CheckIngestSchemaVersion(uint32_t schema_version) const {
+  uint32_t cur_version = metadata_->schema_version();
+  if (schema_version != cur_version) {
+    return Status::InvalidArgument(
+        Substitute("rowset was written with schema version $0, tablet is at version $1",
+                   schema_version, cur_version));
+  }
+  return Status::OK();
+}
+
+Status Tablet::CheckIngestedRowSetColumns(const RowSetMetadata& meta) const {
+  const Schema* cur_schema = schema();
+  RowSetMetadata::ColumnIdToBlockIdMap blocks = meta.GetColumnBlocksById();
+  if (blocks.size() != cur_schema->num_columns()) {
+    return Status::InvalidArgument(
+        Substitute("rowset has $0 columns, tablet schema has $1",
+                   blocks.size(), cur_schema->num_columns()));
+  }
+  for (const auto& e : blocks) {
+    if (cur_schema->find_column_by_id(e.first) == Schema::kColumnNotFound) {
+      return Status::InvalidArgument(
+          Substitute("rowset has a column with id $0, not in the tablet schema",
+                     e.first));
+    }
+  }
+  return Status::OK();
+}
+
+Status Tablet::CopyRowSetForIngest(const string& source_fs_root,
+                                   const RowSetDataPB& source,
+                                   shared_ptr<DiskRowSet>* rowset) {
+  FsManager* fs_manager = metadata_->fs_manager();
+  FsManagerOpts opts(source_fs_root);
+  opts.read_only = true;
+  FsManager source_fs(fs_manager->env(), opts);
+  RETURN_NOT_OK_PREPEND(source_fs.Open(), "Unable to open the source file system");
+
+  // Copy each block, pointing the new rowset's metadata at the copies. UNDO
+  // deltas aren't copied: their timestamps are meaningless in this tablet, so
+  // the ingested rows have no history and are visible in every snapshot.
+  // The copies are placed in the slow storage tier.
+  RowSetDataPB pb(source);
+  pb.clear_undo_deltas();
+  pb.clear_on_fast_tier();
+  vector<BlockIdPB*> block_pbs;
+  for (ColumnDataPB& column : *pb.mutable_columns()) {
+    block_pbs.push_back(column.mutable_block());
+    if (column.has_secondary_index()) {
+      block_pbs.push_back(column.mutable_secondary_index());
+    }
+  }
+  if (pb.has_bloom_block()) {
+    block_pbs.push_back(pb.mutable_bloom_block());
+  }
+  if (pb.has_adhoc_index_block()) {
+    block_pbs.push_back(pb.mutable_adhoc_index_block());
+  }
+  unique_ptr<BlockCreationTransaction> transaction =
+      fs_manager->block_manager()->NewCreationTransaction();
+  faststring buf;
+  buf.resize(1024 * 1024);
+  // The columns of a column group share their block, which is copied once.
+  std::unordered_map<BlockId, BlockId, BlockIdHash, BlockIdEqual> copies;
+  for (BlockIdPB* block_pb : block_pbs) {
+    const BlockId src_id = BlockId::FromPB(*block_pb);
+    const BlockId* copy = FindOrNull(copies, src_id);
+    if (copy != nullptr) {
+      copy->CopyToPB(block_pb);
+      continue;
+    }
+    unique_ptr<ReadableBlock> src;
+    RETURN_NOT_OK(source_fs.OpenBlock(src_id, &src));
+    uint64_t size;
+    RETURN_NOT_OK(src->Size(&size));
+    unique_ptr<WritableBlock> dst;
+    RETURN_NOT_OK(fs_manager->CreateNewBlock(CreateBlockOptions({ tablet_id() }), &dst));
+    for (uint64_t offset = 0; offset < size; offset += buf.size()) {
+      Slice chunk(buf.data(), std::min<uint64_t>(buf.size(), size - offset));
+      RETURN_NOT_OK(src->Read(offset, chunk));
+      RETURN_NOT_OK(dst->Append(chunk));
+    }
+    dst->id().CopyToPB(block_pb);
+    InsertOrDie(&copies, src_id, dst->id());
+    transaction->AddCreatedBlock(std::move(dst));
+  }
+  RETURN_NOT_OK(transaction->CommitCreatedBlocks());
+
+  shared_ptr<RowSetMetadata> meta;
+  RETURN_NOT_OK(metadata_->CreateRowSet(&meta));
+  pb.set_id(meta->id());
+  pb.set_last_durable_dms_id(kNoDurableMemStore);
+  // Don't trust the key bounds of the request: have them read back from the
+  // copied key index when opening the rowset.
+  pb.clear_min_encoded_key();
+  pb.clear_max_encoded_key();
+  meta->LoadFromPB(pb);
+
+  IOContext io_context({ tablet_id() });
+  Status s = DiskRowSet::Open(meta, log_anchor_registry_.get(), mem_trackers_,
+                              &io_context, rowset);
+  if (!s.ok()) {
+    metadata_->AddOrphanedBlocks(meta->GetAllBlocks());
+    return s.CloneAndPrepend("Unable to open the copied rowset");
+  }
+  return Status::OK();
+}
+
+Status Tablet::CheckNoRowsInRange(const string& min_encoded_key,
+                                  const string& max_encoded_key) const {
+  Arena arena(1024);
+  gscoped_ptr<EncodedKey> lower;
+  gscoped_ptr<EncodedKey> upper;
+  RETURN_NOT_OK(EncodedKey::DecodeEncodedString(key_schema_, &arena, min_encoded_key, &lower));
+  RETURN_NOT_OK(EncodedKey::DecodeEncodedString(key_schema_, &arena, max_encoded_key, &upper));
+  ScanSpec spec;
+  spec.SetLowerBoundKey(lower.get());
+  Status s = EncodedKey::IncrementEncodedKey(key_schema_, &upper, &arena);
+  if (s.ok()) {
+    spec.SetExclusiveUpperBoundKey(upper.get());
+  } else if (!s.IsIllegalState()) {
+    // IllegalState means the max key is the largest possible one, in which
+    // case the range has no upper bound.
+    return s;
+  }
+
+  // Scan the keys of all the rows, including the deleted ones: an ingested
+  // row mustn't share its key with an older version of another row, since
+  // the snapshots before the deletion would see both, and compactions
+  // couldn't order their histories. Only the deleted rows whose history was
+  // garbage collected are missed, and no valid snapshot can see those.
+  RowIteratorOptions opts;
+  opts.projection = &key_schema_;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  opts.include_deleted_rows = true;
+  gscoped_ptr<RowwiseIterator> iter(
+      new Iterator(this, std::move(opts), IOContext({ tablet_id() })));
+  RETURN_NOT_OK(iter->Init(&spec));
+  RowBlock block(iter->schema(), 512, &arena);
+  while (iter->HasNext()) {
+    RETURN_NOT_OK(iter->NextBlock(&block));
+    if (block.selection_vector()->AnySelected()) {
+      return Status::AlreadyPresent("the tablet has rows in the key range of the rowset",
+                                    EncodedKey::RangeToStringWithSchema(lower.get(),
+                                                                        s.ok() ? upper.get()
+                                                                               : nullptr,
+                                                                        key_schema_));
+    }
+  }
+  return Status::OK();
+}
+
 Status Tablet::RewindSchemaForBootstrap(const Schema& new_schema,
                                         int64_t schema_version) {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kBootstrapping);
@@ -1301,6 +2387,7 @@ Status Tablet::RewindSchemaForBootstrap(const Schema& new_schema,
     RETURN_NOT_OK(MemRowSet::Create(old_mrs->mrs_id(), new_schema,
                                     log_anchor_registry_.get(),
                                     mem_trackers_.tablet_tracker,
+                                    numa_node_,
                                     &new_mrs));
     components_ = new TabletComponents(new_mrs, old_rowsets);
   }
@@ -1413,7 +2500,7 @@ void Tablet::GetRowSetsForTests(RowSetVector* out) {
   }
 }
 
-void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
+void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr, double perf_weight) {
   // This method must be externally synchronized to not coincide with other
   // calls to it or to UnregisterMaintenanceOps.
   DFAKE_SCOPED_LOCK(maintenance_registration_fake_lock_);
@@ -1429,21 +2516,39 @@ void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
 
   vector<MaintenanceOp*> maintenance_ops;
   gscoped_ptr<MaintenanceOp> rs_compact_op(new CompactRowSetsOp(this));
+  rs_compact_op->set_perf_weight(perf_weight);
   maint_mgr->RegisterOp(rs_compact_op.get());
   maintenance_ops.push_back(rs_compact_op.release());
 
   gscoped_ptr<MaintenanceOp> minor_delta_compact_op(new MinorDeltaCompactionOp(this));
+  minor_delta_compact_op->set_perf_weight(perf_weight);
   maint_mgr->RegisterOp(minor_delta_compact_op.get());
   maintenance_ops.push_back(minor_delta_compact_op.release());
 
   gscoped_ptr<MaintenanceOp> major_delta_compact_op(new MajorDeltaCompactionOp(this));
+  major_delta_compact_op->set_perf_weight(perf_weight);
   maint_mgr->RegisterOp(major_delta_compact_op.get());
   maintenance_ops.push_back(major_delta_compact_op.release());
 
   gscoped_ptr<MaintenanceOp> undo_delta_block_gc_op(new UndoDeltaBlockGCOp(this));
+  undo_delta_block_gc_op->set_perf_weight(perf_weight);
   maint_mgr->RegisterOp(undo_delta_block_gc_op.get());
   maintenance_ops.push_back(undo_delta_block_gc_op.release());
 
+  if (has_row_ttl()) {
+    gscoped_ptr<MaintenanceOp> expired_rowset_gc_op(new ExpiredRowSetGCOp(this));
+    expired_rowset_gc_op->set_perf_weight(perf_weight);
+    maint_mgr->RegisterOp(expired_rowset_gc_op.get());
+    maintenance_ops.push_back(expired_rowset_gc_op.release());
+  }
+
+  if (metadata_->fs_manager()->dd_manager()->has_fast_tier()) {
+    gscoped_ptr<MaintenanceOp> cold_rowset_migration_op(new MigrateColdRowSetsOp(this));
+    cold_rowset_migration_op->set_perf_weight(perf_weight);
+    maint_mgr->RegisterOp(cold_rowset_migration_op.get());
+    maintenance_ops.push_back(cold_rowset_migration_op.release());
+  }
+
   std::lock_guard<simple_spinlock> l(state_lock_);
   maintenance_ops_.swap(maintenance_ops);
 }
@@ -1492,7 +2597,9 @@ Status Tablet::FlushMetadata(const RowSetVector& to_remove,
 }
 
 Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
-                                        int64_t mrs_being_flushed) {
+                                        int64_t mrs_being_flushed,
+                                        bool prefer_fast_tier,
+                                        const std::function<bool()>& should_abort) {
   const char *op_name =
         (mrs_being_flushed == TabletMetadata::kNoMrsFlushed) ? "Compaction" : "Flush";
   TRACE_EVENT2("tablet", "Tablet::DoMergeCompactionOrFlush",
@@ -1514,11 +2621,12 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &io_context, &merge));
 
   RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), DefaultBloomSizing(),
-                               compaction_policy_->target_rowset_size());
+                               compaction_policy_->target_rowset_size(), prefer_fast_tier);
   RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
 
   HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
-  RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), flush_snap, history_gc_opts, &drsw),
+  RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), flush_snap, history_gc_opts, &drsw,
+                                             should_abort),
                         "Flush to disk failed");
   RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
 
@@ -1719,7 +2827,7 @@ Status Tablet::HandleEmptyCompactionOrFlush(const RowSetVector& rowsets,
   return Status::OK();
 }
 
-Status Tablet::Compact(CompactFlags flags) {
+Status Tablet::Compact(CompactFlags flags, const std::function<bool()>& should_abort) {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
 
   RowSetsInCompaction input;
@@ -1735,7 +2843,22 @@ Status Tablet::Compact(CompactFlags flags) {
 
   input.DumpToLog();
 
-  return DoMergeCompactionOrFlush(input, TabletMetadata::kNoMrsFlushed);
+  // Small compactions of rowsets which are all on the fast tier and still
+  // being scanned keep their output there, with the flushes they're likely
+  // made of. Any input which was migrated to the slow tier, or which is cold,
+  // sends the output to the slow tier, so compactions don't undo migrations.
+  int64_t input_bytes = 0;
+  bool inputs_hot = true;
+  for (const auto& rs : input.rowsets()) {
+    input_bytes += rs->OnDiskSize();
+    if (rs->metadata() && (!rs->metadata()->on_fast_tier() || RowSetIsCold(rs))) {
+      inputs_hot = false;
+    }
+  }
+  const bool prefer_fast_tier = inputs_hot &&
+      input_bytes <= FLAGS_tablet_fast_tier_max_compaction_input_mb * 1024LL * 1024LL;
+  return DoMergeCompactionOrFlush(input, TabletMetadata::kNoMrsFlushed, prefer_fast_tier,
+                                  should_abort);
 }
 
 void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
@@ -1790,11 +2913,8 @@ Status Tablet::DebugDump(vector<string> *lines) {
 }
 
 Status Tablet::CaptureConsistentIterators(
-    const Schema* projection,
-    const MvccSnapshot& snap,
+    const RowIteratorOptions& opts,
     const ScanSpec* spec,
-    OrderMode order,
-    const IOContext* io_context,
     vector<shared_ptr<RowwiseIterator>>* iters) const {
 
   shared_lock<rw_spinlock> l(component_lock_);
@@ -1804,17 +2924,66 @@ Status Tablet::CaptureConsistentIterators(
   // in the middle, we don't modify the output arguments.
   vector<shared_ptr<RowwiseIterator>> ret;
 
-  RowIteratorOptions opts;
-  opts.projection = projection;
-  opts.snap_to_include = snap;
-  opts.order = order;
+  const Schema* projection = opts.projection;
 
   // Grab the memrowset iterator.
   gscoped_ptr<RowwiseIterator> ms_iter;
   RETURN_NOT_OK(components_->memrowset->NewRowIterator(opts, &ms_iter));
   ret.emplace_back(ms_iter.release());
 
-  opts.io_context = io_context;
+  // Skip the rowsets whose column statistics show that none of their rows
+  // can satisfy the scan's predicates and, in diff scans, the rowsets with
+  // no changes between the two snapshots.
+  int64_t num_pruned = 0;
+  int64_t num_unchanged = 0;
+  auto may_match = [&](const RowSet* rs) {
+    if (opts.snap_to_exclude && !rs->MayHaveChangesInDiffScan(opts)) {
+      num_unchanged++;
+      return false;
+    }
+    if (spec == nullptr || rs->MayMatchScanSpec(opts, *spec)) {
+      return true;
+    }
+    num_pruned++;
+    return false;
+  };
+
+  // In a top-N scan, wrap the iterators of the rowsets which have statistics
+  // for the column so that they end once the threshold rules out their rows,
+  // and read the most promising rowsets first so that the threshold gets good
+  // early. Rowsets without statistics are read last.
+  const shared_ptr<TopNThreshold> top_n = spec != nullptr ? spec->top_n_threshold() : nullptr;
+  const int top_n_col_idx = top_n ? projection->find_column(top_n->column().name()) : -1;
+  struct TopNCandidate {
+    shared_ptr<RowwiseIterator> iter;
+    // The raw contents of the best value in the rowset, if known.
+    boost::optional<string> best;
+  };
+  vector<TopNCandidate> top_n_candidates;
+
+  auto add_iter = [&](const RowSet* rs) {
+    gscoped_ptr<RowwiseIterator> row_it;
+    RETURN_NOT_OK_PREPEND(rs->NewRowIterator(opts, &row_it),
+                          Substitute("Could not create iterator for rowset $0",
+                                     rs->ToString()));
+    if (top_n_col_idx == Schema::kColumnNotFound) {
+      ret.emplace_back(row_it.release());
+      return Status::OK();
+    }
+    TopNCandidate candidate;
+    cfile::ZoneMapEntryPB stats;
+    if (rs->GetColumnStatsForScan(opts, top_n_col_idx, &stats)) {
+      if (top_n->descending() ? stats.has_max_value() : stats.has_min_value()) {
+        candidate.best = top_n->descending() ? stats.max_value() : stats.min_value();
+      }
+      candidate.iter.reset(new TopNPruningIterator(
+          unique_ptr<RowwiseIterator>(row_it.release()), top_n, std::move(stats)));
+    } else {
+      candidate.iter.reset(row_it.release());
+    }
+    top_n_candidates.emplace_back(std::move(candidate));
+    return Status::OK();
+  };
 
   // Cull row-sets in the case of key-range queries.
   if (spec != nullptr && (spec->lower_bound_key() || spec->exclusive_upper_bound_key())) {
@@ -1825,24 +2994,41 @@ Status Tablet::CaptureConsistentIterators(
     vector<RowSet*> interval_sets;
     components_->rowsets->FindRowSetsIntersectingInterval(lower_bound, upper_bound, &interval_sets);
     for (const RowSet *rs : interval_sets) {
-      gscoped_ptr<RowwiseIterator> row_it;
-      RETURN_NOT_OK_PREPEND(rs->NewRowIterator(opts, &row_it),
-                            Substitute("Could not create iterator for rowset $0",
-                                       rs->ToString()));
-      ret.emplace_back(row_it.release());
+      if (!may_match(rs)) {
+        continue;
+      }
+      RETURN_NOT_OK(add_iter(rs));
+    }
+  } else {
+    // If there are no encoded predicates of the primary keys, then
+    // fall back to grabbing all rowset iterators.
+    for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
+      if (!may_match(rs.get())) {
+        continue;
+      }
+      RETURN_NOT_OK(add_iter(rs.get()));
     }
-    ret.swap(*iters);
-    return Status::OK();
   }
-
-  // If there are no encoded predicates of the primary keys, then
-  // fall back to grabbing all rowset iterators.
-  for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
-    gscoped_ptr<RowwiseIterator> row_it;
-    RETURN_NOT_OK_PREPEND(rs->NewRowIterator(opts, &row_it),
-                          Substitute("Could not create iterator for rowset $0",
-                                     rs->ToString()));
-    ret.emplace_back(row_it.release());
+  TRACE_COUNTER_INCREMENT("rowsets_pruned_by_column_stats", num_pruned);
+  TRACE_COUNTER_INCREMENT("rowsets_unchanged_in_diff_scan", num_unchanged);
+
+  if (!top_n_candidates.empty()) {
+    const TypeInfo* type_info = top_n->column().type_info();
+    const bool descending = top_n->descending();
+    std::stable_sort(top_n_candidates.begin(), top_n_candidates.end(),
+                     [&](const TopNCandidate& a, const TopNCandidate& b) {
+      if (!a.best || !b.best) {
+        return a.best && !b.best;
+      }
+      TopNThreshold::Bound a_buf;
+      TopNThreshold::Bound b_buf;
+      int cmp = type_info->Compare(CellFromStatsBytes(type_info, *a.best, &a_buf),
+                                   CellFromStatsBytes(type_info, *b.best, &b_buf));
+      return descending ? cmp > 0 : cmp < 0;
+    });
+    for (auto& candidate : top_n_candidates) {
+      ret.emplace_back(std::move(candidate.iter));
+    }
   }
 
   // Swap results into the parameters.
@@ -1867,6 +3053,60 @@ Status Tablet::CountRows(uint64_t *count) const {
   return Status::OK();
 }
 
+Status Tablet::CountLiveRows(uint64_t* count) const {
+  // Grab the components before taking the snapshot: the rows of the flushed
+  // rowsets are then all committed as of the snapshot.
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  if (!comps) {
+    return Status::IllegalState("Tablet is not open");
+  }
+
+  const Schema empty_projection(vector<ColumnSchema>(), 0);
+  IOContext io_context({ tablet_id() });
+  RowIteratorOptions opts;
+  opts.projection = &empty_projection;
+  mvcc_.TakeSnapshot(&opts.snap_to_include);
+  opts.io_context = &io_context;
+
+  // Returns the number of rows the rowset's iterator yields.
+  const auto scan_rows = [&](const RowSet& rs, uint64_t* rs_count) {
+    gscoped_ptr<RowwiseIterator> iter;
+    RETURN_NOT_OK_PREPEND(rs.NewRowIterator(opts, &iter),
+                          Substitute("Could not create iterator for rowset $0", rs.ToString()));
+    RETURN_NOT_OK(iter->Init(nullptr));
+    Arena arena(1024);
+    RowBlock block(iter->schema(), 1024, &arena);
+    *rs_count = 0;
+    while (iter->HasNext()) {
+      RETURN_NOT_OK(iter->NextBlock(&block));
+      *rs_count += block.selection_vector()->CountSelected();
+    }
+    return Status::OK();
+  };
+
+  uint64_t total;
+  RETURN_NOT_OK(scan_rows(*comps->memrowset, &total));
+  int num_scanned = 1;
+  for (const shared_ptr<RowSet>& rs : comps->rowsets->all_rowsets()) {
+    bool known;
+    rowid_t rs_count;
+    RETURN_NOT_OK(rs->CountLiveRowsFromMetadata(&io_context, &known, &rs_count));
+    if (known) {
+      total += rs_count;
+      continue;
+    }
+    uint64_t scanned_count;
+    RETURN_NOT_OK(scan_rows(*rs, &scanned_count));
+    total += scanned_count;
+    num_scanned++;
+  }
+  VLOG_WITH_PREFIX(2) << Substitute("Counted $0 live rows, scanning $1 of $2 rowsets",
+                                    total, num_scanned, comps->rowsets->all_rowsets().size() + 1);
+  *count = total;
+  return Status::OK();
+}
+
 size_t Tablet::MemRowSetSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1877,6 +3117,16 @@ size_t Tablet::MemRowSetSize() const {
   return 0;
 }
 
+size_t Tablet::MemRowSetSizePerRow() const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  if (comps) {
+    return comps->memrowset->memory_footprint_per_row();
+  }
+  return 0;
+}
+
 bool Tablet::MemRowSetEmpty() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1918,6 +3168,10 @@ size_t Tablet::OnDiskDataSize() const {
   return ret;
 }
 
+vector<int> Tablet::DataDirs() const {
+  return metadata_->fs_manager()->dd_manager()->FindDataDirsByTabletId(tablet_id());
+}
+
 size_t Tablet::DeltaMemStoresSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -2264,6 +3518,261 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
   return Status::OK();
 }
 
+int64_t Tablet::EstimateBytesInPartiallyAncientUndoDeltas() {
+  Timestamp ancient_history_mark;
+  if (!Tablet::GetTabletAncientHistoryMark(&ancient_history_mark)) return 0;
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  int64_t tablet_bytes = 0;
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    tablet_bytes += rowset->EstimateBytesInPartiallyAncientUndoDeltas(
+        ancient_history_mark, FLAGS_undo_delta_block_gc_rewrite_min_ancient_ratio);
+  }
+  return tablet_bytes;
+}
+
+Status Tablet::RewritePartiallyAncientUndoDeltas(int64_t max_bytes,
+                                                 int64_t* blocks_rewritten,
+                                                 int64_t* bytes_rewritten) {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  MonoTime tablet_rewrite_start = MonoTime::Now();
+  if (blocks_rewritten) *blocks_rewritten = 0;
+  if (bytes_rewritten) *bytes_rewritten = 0;
+
+  Timestamp ancient_history_mark;
+  if (!Tablet::GetTabletAncientHistoryMark(&ancient_history_mark)) return Status::OK();
+  const double min_ancient_ratio = FLAGS_undo_delta_block_gc_rewrite_min_ancient_ratio;
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // Rewrite the worst offenders first.
+  vector<pair<int64_t, shared_ptr<RowSet>>> rowsets_by_ancient_bytes;
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    int64_t bytes = rowset->EstimateBytesInPartiallyAncientUndoDeltas(ancient_history_mark,
+                                                                      min_ancient_ratio);
+    if (bytes > 0) {
+      rowsets_by_ancient_bytes.emplace_back(bytes, rowset);
+    }
+  }
+  std::sort(rowsets_by_ancient_bytes.begin(), rowsets_by_ancient_bytes.end(),
+            [](const pair<int64_t, shared_ptr<RowSet>>& a,
+               const pair<int64_t, shared_ptr<RowSet>>& b) {
+              return a.first > b.first; // Descending order.
+            });
+
+  int64_t tablet_blocks_rewritten = 0;
+  int64_t tablet_bytes_rewritten = 0;
+  fs::IOContext io_context({ tablet_id() });
+  for (const auto& e : rowsets_by_ancient_bytes) {
+    if (tablet_bytes_rewritten >= max_bytes) break;
+    const shared_ptr<RowSet>& rowset = e.second;
+
+    // As in DeleteAncientUndoDeltas(), we need to hold the rowset's
+    // compact_flush_lock, but only for the rowset being rewritten, since
+    // rewriting may take a while.
+    std::unique_lock<std::mutex> lock;
+    {
+      std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+      if (!rowset->IsAvailableForCompaction()) {
+        continue;
+      }
+      lock = std::unique_lock<std::mutex>(*rowset->compact_flush_lock(), std::try_to_lock);
+      CHECK(lock.owns_lock()) << rowset->ToString() << " unable to lock compact_flush_lock";
+    }
+
+    int64_t rowset_blocks_rewritten;
+    int64_t rowset_bytes_rewritten;
+    RETURN_NOT_OK(rowset->RewritePartiallyAncientUndoDeltas(
+        ancient_history_mark, min_ancient_ratio, max_bytes - tablet_bytes_rewritten,
+        &io_context, &rowset_blocks_rewritten, &rowset_bytes_rewritten));
+    tablet_blocks_rewritten += rowset_blocks_rewritten;
+    tablet_bytes_rewritten += rowset_bytes_rewritten;
+  }
+  // As with DeleteAncientUndoDeltas(), we flush the tablet metadata once at
+  // the end.
+  if (tablet_blocks_rewritten > 0) {
+    RETURN_NOT_OK(metadata_->Flush());
+  }
+
+  MonoDelta tablet_rewrite_duration = MonoTime::Now() - tablet_rewrite_start;
+  metrics_->undo_delta_block_gc_bytes_rewritten->IncrementBy(tablet_bytes_rewritten);
+  VLOG_WITH_PREFIX(2) << Substitute("Rewrote $0 partially ancient undo delta blocks ($1) in $2",
+                                    tablet_blocks_rewritten,
+                                    HumanReadableNumBytes::ToString(tablet_bytes_rewritten),
+                                    tablet_rewrite_duration.ToString());
+
+  if (blocks_rewritten) *blocks_rewritten = tablet_blocks_rewritten;
+  if (bytes_rewritten) *bytes_rewritten = tablet_bytes_rewritten;
+  return Status::OK();
+}
+
+Status Tablet::RowSetHasExpired(const RowSet& rowset, int64_t cutoff_micros,
+                                bool* expired) const {
+  string min_encoded_key;
+  string max_encoded_key;
+  RETURN_NOT_OK(rowset.GetBounds(&min_encoded_key, &max_encoded_key));
+  Arena arena(256);
+  uint8_t* row_data = static_cast<uint8_t*>(arena.AllocateBytes(key_schema_.key_byte_size()));
+  RETURN_NOT_OK(key_schema_.DecodeRowKey(max_encoded_key, row_data, &arena));
+  int64_t max_micros;
+  memcpy(&max_micros, row_data + key_schema_.column_offset(0), sizeof(max_micros));
+  *expired = max_micros < cutoff_micros;
+  return Status::OK();
+}
+
+int64_t Tablet::EstimateBytesInExpiredRowSets() {
+  int64_t cutoff_micros;
+  if (!GetRowExpiryCutoff(&cutoff_micros)) return 0;
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  int64_t bytes = 0;
+  std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    bool expired;
+    if (!rowset->IsAvailableForCompaction() ||
+        !RowSetHasExpired(*rowset, cutoff_micros, &expired).ok() || !expired) {
+      continue;
+    }
+    bytes += rowset->OnDiskSize();
+  }
+  return bytes;
+}
+
+Status Tablet::DeleteExpiredRowSets(int64_t* rowsets_deleted, int64_t* bytes_deleted) {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  if (rowsets_deleted) *rowsets_deleted = 0;
+  if (bytes_deleted) *bytes_deleted = 0;
+
+  int64_t cutoff_micros;
+  if (!GetRowExpiryCutoff(&cutoff_micros)) return Status::OK();
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // As in a compaction, we hold the compact_flush_lock of each rowset we
+  // delete until it's been swapped out.
+  RowSetVector to_delete;
+  vector<std::unique_lock<std::mutex>> rowset_locks;
+  int64_t tablet_bytes_deleted = 0;
+  {
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    for (const auto& rowset : comps->rowsets->all_rowsets()) {
+      if (!rowset->IsAvailableForCompaction()) {
+        continue;
+      }
+      bool expired;
+      RETURN_NOT_OK(RowSetHasExpired(*rowset, cutoff_micros, &expired));
+      if (!expired) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(*rowset->compact_flush_lock(), std::try_to_lock);
+      CHECK(lock.owns_lock()) << rowset->ToString() << " unable to lock compact_flush_lock";
+      tablet_bytes_deleted += rowset->OnDiskSize();
+      to_delete.push_back(rowset);
+      rowset_locks.push_back(std::move(lock));
+    }
+  }
+  if (to_delete.empty()) return Status::OK();
+
+  // Writes racing with the deletion can only target expired rows, which
+  // MutateRowUnlocked() refuses or whose mutations are moot.
+  for (const auto& rowset : to_delete) {
+    LOG_WITH_PREFIX(INFO) << "Deleting expired rowset " << rowset->ToString();
+  }
+  RETURN_NOT_OK_PREPEND(FlushMetadata(to_delete, RowSetMetadataVector(),
+                                      TabletMetadata::kNoMrsFlushed),
+                        "Failed to flush new tablet metadata");
+  AtomicSwapRowSets(to_delete, RowSetVector());
+
+  metrics_->expired_rowset_gc_bytes_deleted->IncrementBy(tablet_bytes_deleted);
+  if (rowsets_deleted) *rowsets_deleted = to_delete.size();
+  if (bytes_deleted) *bytes_deleted = tablet_bytes_deleted;
+  return Status::OK();
+}
+
+bool Tablet::RowSetIsCold(const shared_ptr<RowSet>& rowset) const {
+  if (!rowset->metadata() || !rowset->metadata()->on_fast_tier()) {
+    return false;
+  }
+  const MonoDelta unscanned = down_cast<DiskRowSet*>(rowset.get())->TimeSinceLastScan();
+  return unscanned >= MonoDelta::FromSeconds(FLAGS_tablet_cold_rowset_secs);
+}
+
+int64_t Tablet::EstimateBytesInColdRowSets() {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  int64_t bytes = 0;
+  // Rowsets' availability for compaction may only be checked under the
+  // selection lock.
+  std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    if (rowset->IsAvailableForCompaction() && RowSetIsCold(rowset)) {
+      bytes += rowset->OnDiskSize();
+    }
+  }
+  return bytes;
+}
+
+Status Tablet::MigrateColdRowSets(int64_t* rowsets_migrated, int64_t* bytes_migrated) {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  if (rowsets_migrated) *rowsets_migrated = 0;
+  if (bytes_migrated) *bytes_migrated = 0;
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // Pick the coldest rowsets, up to a compaction's worth.
+  RowSetsInCompaction input;
+  int64_t input_bytes = 0;
+  {
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    vector<pair<MonoDelta, shared_ptr<RowSet>>> cold_rowsets;
+    for (const auto& rowset : comps->rowsets->all_rowsets()) {
+      if (rowset->IsAvailableForCompaction() && RowSetIsCold(rowset)) {
+        cold_rowsets.emplace_back(
+            down_cast<DiskRowSet*>(rowset.get())->TimeSinceLastScan(), rowset);
+      }
+    }
+    std::sort(cold_rowsets.begin(), cold_rowsets.end(),
+              [](const pair<MonoDelta, shared_ptr<RowSet>>& a,
+                 const pair<MonoDelta, shared_ptr<RowSet>>& b) {
+                return a.first > b.first;
+              });
+    const int64_t budget_bytes = FLAGS_tablet_compaction_budget_mb * 1024LL * 1024LL;
+    for (const auto& e : cold_rowsets) {
+      const shared_ptr<RowSet>& rowset = e.second;
+      int64_t size = rowset->OnDiskSize();
+      if (input.num_rowsets() > 0 && input_bytes + size > budget_bytes) {
+        break;
+      }
+      std::unique_lock<std::mutex> lock(*rowset->compact_flush_lock(), std::try_to_lock);
+      CHECK(lock.owns_lock()) << rowset->ToString() << " unable to lock compact_flush_lock";
+      input_bytes += size;
+      input.AddRowSet(rowset, std::move(lock));
+    }
+  }
+  if (input.num_rowsets() == 0) return Status::OK();
+
+  // Rewriting the rowsets like a compaction lets them keep taking updates
+  // while their data is copied.
+  LOG_WITH_PREFIX(INFO) << "Migrating " << input.num_rowsets() << " cold rowsets ("
+                        << HumanReadableNumBytes::ToString(input_bytes)
+                        << ") to the slow storage tier";
+  input.DumpToLog();
+  RETURN_NOT_OK(DoMergeCompactionOrFlush(input, TabletMetadata::kNoMrsFlushed,
+                                         /*prefer_fast_tier=*/false,
+                                         /*should_abort=*/nullptr));
+
+  metrics_->cold_rowset_migration_bytes->IncrementBy(input_bytes);
+  if (rowsets_migrated) *rowsets_migrated = input.num_rowsets();
+  if (bytes_migrated) *bytes_migrated = input_bytes;
+  return Status::OK();
+}
+
 int64_t Tablet::CountUndoDeltasForTests() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -2407,14 +3916,43 @@ string Tablet::LogPrefix() const {
 // Tablet::Iterator
 ////////////////////////////////////////////////////////////
 
-Tablet::Iterator::Iterator(const Tablet* tablet, const Schema& projection,
-                           MvccSnapshot snap, OrderMode order,
+namespace {
+
+// Returns whether the primary key bounds of 'spec' let a single key through,
+// as they do once the equality predicates of a point lookup are pushed into
+// them.
+bool IsSingleRowScan(const Schema& key_schema, const ScanSpec& spec) {
+  const EncodedKey* lower = spec.lower_bound_key();
+  const EncodedKey* upper = spec.exclusive_upper_bound_key();
+  if (lower == nullptr || upper == nullptr ||
+      lower->raw_keys().size() != key_schema.num_key_columns()) {
+    return false;
+  }
+  Arena arena(256);
+  uint8_t* row_data = static_cast<uint8_t*>(arena.AllocateBytes(key_schema.key_byte_size()));
+  ContiguousRow row(&key_schema, row_data);
+  for (int i = 0; i < key_schema.num_key_columns(); i++) {
+    memcpy(row.mutable_cell_ptr(i), lower->raw_keys()[i], key_schema.column(i).type_info()->size());
+  }
+  if (!key_util::IncrementPrimaryKey(&row, &arena)) {
+    return false;
+  }
+  return EncodedKey::FromContiguousRow(ConstContiguousRow(row))->encoded_key() ==
+      upper->encoded_key();
+}
+
+} // anonymous namespace
+
+Tablet::Iterator::Iterator(const Tablet* tablet, RowIteratorOptions opts,
                            IOContext io_context)
     : tablet_(tablet),
-      projection_(projection),
-      snap_(std::move(snap)),
-      order_(order),
-      io_context_(std::move(io_context)) {}
+      projection_(*opts.projection),
+      opts_(std::move(opts)),
+      read_ahead_budget_(new fs::ReadAheadBudget(FLAGS_scan_read_ahead_budget_bytes)),
+      io_context_({ std::move(io_context.tablet_id), read_ahead_budget_.get() }) {
+  opts_.projection = &projection_;
+  opts_.io_context = &io_context_;
+}
 
 Tablet::Iterator::~Iterator() {}
 
@@ -2422,27 +3960,137 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
   RETURN_NOT_OK(tablet_->CheckHasNotBeenStopped());
   DCHECK(iter_.get() == nullptr);
 
+  if (FLAGS_mrs_use_codegen) {
+    codegen::CompilationManager::GetSingleton()->RecordProjection(
+        tablet_->metadata()->table_id(), projection_);
+  }
   RETURN_NOT_OK(tablet_->GetMappedReadProjection(projection_, &projection_));
 
+  // Exclude the expired rows by raising the scan's lower bound key to the
+  // smallest unexpired key.
+  int64_t expiry_cutoff_micros;
+  if (tablet_->GetRowExpiryCutoff(&expiry_cutoff_micros)) {
+    if (spec == nullptr) {
+      expiry_spec_.reset(new ScanSpec());
+      spec = expiry_spec_.get();
+    }
+    const Schema& key_schema = tablet_->key_schema();
+    expiry_lower_bound_row_.reset(new uint8_t[key_schema.key_byte_size()]);
+    uint8_t* row_data = expiry_lower_bound_row_.get();
+    memcpy(row_data + key_schema.column_offset(0), &expiry_cutoff_micros,
+           sizeof(expiry_cutoff_micros));
+    for (int i = 1; i < key_schema.num_key_columns(); i++) {
+      key_schema.column(i).type_info()->CopyMinValue(row_data + key_schema.column_offset(i));
+    }
+    expiry_lower_bound_key_.reset(
+        EncodedKey::FromContiguousRow(ConstContiguousRow(&key_schema, row_data)).release());
+    spec->SetLowerBoundKey(expiry_lower_bound_key_.get());
+  } else if (tablet_->row_cache_ && spec != nullptr) {
+    // The cached rows aren't checked for expiry, so rows which expire are
+    // never cached.
+    bool served;
+    RETURN_NOT_OK(InitFromRowCache(spec, &served));
+    if (served) {
+      return Status::OK();
+    }
+  }
+
   vector<shared_ptr<RowwiseIterator>> iters;
-  RETURN_NOT_OK(tablet_->CaptureConsistentIterators(&projection_, snap_, spec, order_,
-                                                    &io_context_, &iters));
+  RETURN_NOT_OK(tablet_->CaptureConsistentIterators(opts_, spec, &iters));
   TRACE_COUNTER_INCREMENT("rowset_iterators", iters.size());
 
-  switch (order_) {
+  switch (opts_.order) {
     case ORDERED:
       iter_.reset(new MergeIterator(projection_, std::move(iters)));
       break;
     case UNORDERED:
-    default:
-      iter_.reset(new UnionIterator(std::move(iters)));
+    default: {
+      const int parallelism = std::min<int>(FLAGS_tablet_scan_parallelism, iters.size());
+      if (parallelism > 1) {
+        iter_.reset(new ParallelUnionIterator(
+            std::move(iters), ScanPool(), parallelism,
+            parallelism * std::max(FLAGS_tablet_scan_queued_blocks_per_rowset, 1)));
+      } else {
+        iter_.reset(new UnionIterator(std::move(iters)));
+      }
       break;
+    }
   }
 
   RETURN_NOT_OK(iter_->Init(spec));
   return Status::OK();
 }
 
+Status Tablet::Iterator::InitFromRowCache(ScanSpec* spec, bool* served) {
+  *served = false;
+  // Diff scans and scans of deleted rows see more than the latest version of
+  // the rows.
+  if (opts_.snap_to_exclude || opts_.include_deleted_rows ||
+      !spec->predicates().empty() || !IsSingleRowScan(tablet_->key_schema(), *spec)) {
+    return Status::OK();
+  }
+  RowCache* cache = tablet_->row_cache_.get();
+  const Schema* schema = tablet_->schema();
+  const Slice key = spec->lower_bound_key()->encoded_key();
+  unique_ptr<RowCache::RowHandle> row = cache->Lookup(key, schema, opts_.snap_to_include);
+  if (!row) {
+    RETURN_NOT_OK(FillRowCache(spec));
+    row = cache->Lookup(key, schema, opts_.snap_to_include);
+  }
+  if (tablet_->metrics_) {
+    (row ? tablet_->metrics_->row_cache_hits : tablet_->metrics_->row_cache_misses)->Increment();
+  }
+  if (!row) {
+    return Status::OK();
+  }
+  iter_.reset(new CachedRowIterator(&projection_, std::move(row)));
+  RETURN_NOT_OK(iter_->Init(spec));
+  *served = true;
+  return Status::OK();
+}
+
+Status Tablet::Iterator::FillRowCache(ScanSpec* spec) {
+  RowCache* cache = tablet_->row_cache_.get();
+  const Schema* schema = tablet_->schema();
+  const Slice key = spec->lower_bound_key()->encoded_key();
+
+  // The snapshot the row is read in must see every write to the key applied
+  // before the invalidation sequence number is taken, since those don't
+  // change it. That holds if no transaction is in flight once it's taken:
+  // the writes which were applied have all committed by then.
+  const uint64_t seq = cache->InvalidationSeq(key);
+  if (tablet_->mvcc_.CountTransactionsInFlight() > 0) {
+    return Status::OK();
+  }
+  MvccSnapshot snap(tablet_->mvcc_);
+  if (!snap.is_clean()) {
+    return Status::OK();
+  }
+  // The clean timestamp is at least the one 'snap' saw all the transactions
+  // before, and no transaction between the two may write the key without
+  // changing its sequence number.
+  const Timestamp valid_from = tablet_->mvcc_.GetCleanTimestamp();
+
+  RowIteratorOptions opts = opts_;
+  opts.projection = schema;
+  opts.snap_to_include = snap;
+  vector<shared_ptr<RowwiseIterator>> iters;
+  RETURN_NOT_OK(tablet_->CaptureConsistentIterators(opts, spec, &iters));
+  UnionIterator iter(std::move(iters));
+  RETURN_NOT_OK(iter.Init(spec));
+
+  Arena arena(1024);
+  RowBlock block(*schema, 1, &arena);
+  while (iter.HasNext()) {
+    RETURN_NOT_OK(iter.NextBlock(&block));
+    if (block.nrows() > 0 && block.selection_vector()->IsRowSelected(0)) {
+      cache->Insert(key, seq, valid_from, schema, block.row(0));
+      break;
+    }
+  }
+  return Status::OK();
+}
+
 bool Tablet::Iterator::HasNext() const {
   DCHECK(iter_.get() != nullptr) << "Not initialized!";
   return iter_->HasNext();
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -55,7 +56,8 @@
 
 namespace kudu {
 
-class ConstContiguousRow;
+class Arena;
+class BlockId;
 class EncodedKey;
 class KeyRange;
 class MaintenanceManager;
@@ -65,6 +67,7 @@ class MemTracker;
 class MonoDelta;
 class RowBlock;
 class ScanSpec;
+class Slice;
 class Throttler;
 class Timestamp;
 struct IteratorStats;
@@ -77,8 +80,12 @@ namespace tablet {
 
 class AlterSchemaTransactionState;
 class CompactionPolicy;
+class DiskRowSet;
 class HistoryGcOpts;
+class HotKeyTracker;
+class IngestRowSetTransactionState;
 class MemRowSet;
+class RowCache;
 class RowSetTree;
 class RowSetsInCompaction;
 class WriteTransactionState;
@@ -141,12 +148,11 @@ class Tablet {
   Status DecodeWriteOperations(const Schema* client_schema,
                                WriteTransactionState* tx_state);
 
-  // Acquire locks for each of the operations in the given txn.
+  // Acquire locks for each of the operations in the given txn, in one
+  // batch (see LockManager::LockBatch()).
   //
-  // Note that, if this fails, it's still possible that the transaction
-  // state holds _some_ of the locks. In that case, we expect that
-  // the transaction will still clean them up when it is aborted (or
-  // otherwise destructed).
+  // This fails before taking any of the locks if one of the operations is
+  // for a row which doesn't belong to this tablet.
   Status AcquireRowLocks(WriteTransactionState* tx_state);
 
   // Starts an MVCC transaction which must have a pre-assigned timestamp.
@@ -172,10 +178,11 @@ class Tablet {
   // present in the tablet.
   // Returns Status::OK unless allocation fails.
   //
-  // Acquires the row lock for the given operation, setting it in the
-  // RowOp struct. This also sets the row op's RowSetKeyProbe.
-  Status AcquireLockForOp(WriteTransactionState* tx_state,
-                          RowOp* op);
+  // Sets the row op's RowSetKeyProbe. AcquireRowLocks() then checks that the
+  // rows belong to this tablet and acquires the row locks for all the ops at
+  // once. The encoded key is allocated from 'arena', which must outlive the
+  // op.
+  Status PrepareKeyProbeForOp(RowOp* op, Arena* arena);
 
   // Signal that the given transaction is about to Apply.
   void StartApplying(WriteTransactionState* tx_state);
@@ -202,6 +209,32 @@ class Tablet {
                         const OrderMode order,
                         gscoped_ptr<RowwiseIterator> *iter) const;
 
+  // Create a new row iterator with the given options. The projection in
+  // 'opts' is copied, and the IO context is set by the tablet.
+  //
+  // If 'opts.snap_to_exclude' is set, the iterator yields the rows which
+  // were inserted, updated or deleted by the transactions committed in
+  // 'opts.snap_to_include' but not in 'opts.snap_to_exclude' (a "diff
+  // scan"), as of 'opts.snap_to_include'. Rows deleted as of then are only
+  // yielded if 'opts.include_deleted_rows' is set, in which case an
+  // IS_DELETED virtual column in the projection tells them apart.
+  Status NewRowIterator(RowIteratorOptions opts,
+                        gscoped_ptr<RowwiseIterator> *iter) const;
+
+  // Looks up the rows with the encoded primary keys 'encoded_keys' as of
+  // 'snap', projected to 'projection'. The row of 'encoded_keys[i]' is copied
+  // to row i of 'rows', which must have room for a row per key and the
+  // projection's schema, and row i is selected iff the row was found.
+  //
+  // The keys are resolved rowset by rowset in key order: those of a rowset
+  // are checked against its bloom filters in one batch, and the rows which
+  // may be present are read through a single iterator of the rowset, seeked
+  // from key to key.
+  Status MultiGet(const Schema& projection,
+                  const MvccSnapshot& snap,
+                  const std::vector<Slice>& encoded_keys,
+                  RowBlock* rows) const;
+
   // Flush the current MemRowSet for this tablet to disk. This swaps
   // in a new (initially empty) MemRowSet in its place.
   //
@@ -219,6 +252,49 @@ class Tablet {
   // This operation will trigger a flush on the current MemRowSet.
   Status AlterSchema(AlterSchemaTransactionState* tx_state);
 
+  // Copies the blocks of 'source', a rowset in the file system rooted at
+  // 'source_fs_root' written with schema version 'schema_version', into this
+  // tablet's block manager, checks the copy against the tablet schema and
+  // stages it under 'ingest_id' in the tablet metadata, for an
+  // INGEST_ROWSET_OP to add it to the tablet later. Every replica stages the
+  // rowset before the op is replicated, so that applying it does no I/O
+  // which may fail on a follower.
+  //
+  // Returns Status::InvalidArgument if the rowset doesn't match the schema or
+  // is empty.
+  Status StageRowSetForIngest(const std::string& ingest_id,
+                              uint32_t schema_version,
+                              const std::string& source_fs_root,
+                              const RowSetDataPB& source);
+
+  // Drops the rowset staged under 'ingest_id', if the ingestion was given up.
+  Status DiscardStagedRowSet(const std::string& ingest_id);
+
+  // Starts an MVCC transaction for the ingest rowset operation, once it has
+  // a timestamp.
+  void StartTransaction(IngestRowSetTransactionState* tx_state);
+
+  // Prepares the transaction context for the ingest rowset operation by
+  // acquiring the schema lock. This can't fail, so that followers always
+  // prepare the replicated op.
+  void CreatePreparedIngestRowSet(IngestRowSetTransactionState* tx_state);
+
+  // Checks, on the leader, that the rowset staged for the prepared ingest
+  // rowset operation can be added to the tablet: that it matches the current
+  // schema and that its key range contains no version of any row of the
+  // tablet, live or deleted.
+  //
+  // Returns Status::InvalidArgument if the schema doesn't match,
+  // Status::NotFound if no rowset is staged and Status::AlreadyPresent if the
+  // key range isn't empty.
+  Status CheckPreparedIngestRowSet(const IngestRowSetTransactionState* tx_state) const;
+
+  // Adds the rowset staged for the ingest rowset operation to the tablet, on
+  // behalf of the INGEST_ROWSET_OP with index 'op_index'. The ingested rows
+  // are inserted as of the op's timestamp: the snapshots which don't include
+  // the op don't see them.
+  Status IngestRowSet(IngestRowSetTransactionState* tx_state, int64_t op_index);
+
   // Rewind the schema to an earlier version than is written in the on-disk
   // metadata. This is done during bootstrap to roll the schema back to the
   // point in time where the logs-to-be-replayed begin, so we can then decode
@@ -244,7 +320,11 @@ class Tablet {
   };
   typedef int CompactFlags;
 
-  Status Compact(CompactFlags flags);
+  // Compacts the rowsets picked by the compaction policy. If 'should_abort' is
+  // set, it is polled while the output is written, and the compaction is
+  // abandoned, leaving the input rowsets in place, once it returns true.
+  Status Compact(CompactFlags flags,
+                 const std::function<bool()>& should_abort = nullptr);
 
   // Update the statistics for performing a compaction.
   void UpdateCompactionStats(MaintenanceOpStats* stats);
@@ -254,6 +334,11 @@ class Tablet {
   // This method takes a read lock on component_lock_ and is thread-safe.
   size_t MemRowSetSize() const;
 
+  // Returns the size of the MRS divided by the number of rows inserted into it,
+  // or 0 if it has no rows. This method takes a read lock on component_lock_
+  // and is thread-safe.
+  size_t MemRowSetSizePerRow() const;
+
   // Returns true if the MRS is empty, else false. Doesn't rely on size and
   // actually verifies that the MRS has no elements.
   // This method takes a read lock on component_lock_ and is thread-safe.
@@ -271,6 +356,10 @@ class Tablet {
   // Excludes all metadata (both tablet metadata and the metadata of this tablet's rowsets).
   size_t OnDiskDataSize() const;
 
+  // Returns the uuid indexes of the data directories this tablet's data is
+  // placed on.
+  std::vector<int> DataDirs() const;
+
   // Get the total size of all the DMS
   size_t DeltaMemStoresSize() const;
 
@@ -327,6 +416,47 @@ class Tablet {
   Status DeleteAncientUndoDeltas(int64_t* blocks_deleted = nullptr,
                                  int64_t* bytes_deleted = nullptr);
 
+  // Estimate the number of ancient bytes in the undo delta blocks which
+  // RewritePartiallyAncientUndoDeltas() may rewrite.
+  int64_t EstimateBytesInPartiallyAncientUndoDeltas();
+
+  // Rewrite the initialized undo delta blocks which hold both ancient and
+  // non-ancient deltas without their ancient deltas, starting with the
+  // rowsets with the most ancient bytes in them. No block is started once
+  // 'max_bytes' bytes of blocks were rewritten. If this method returns OK,
+  // the number of blocks rewritten and their size are returned in the
+  // out-parameters.
+  Status RewritePartiallyAncientUndoDeltas(int64_t max_bytes,
+                                           int64_t* blocks_rewritten = nullptr,
+                                           int64_t* bytes_rewritten = nullptr);
+
+  // Returns true if the rows of this tablet expire (see
+  // --tablet_row_ttl_tables).
+  bool has_row_ttl() const { return row_ttl_micros_ > 0; }
+
+  // Returns the NUMA node this tablet is assigned to by
+  // --tablet_numa_placement, or -1 if it isn't assigned to any.
+  int numa_node() const { return numa_node_; }
+
+  // Estimate the on-disk size of the rowsets all of whose rows have expired.
+  int64_t EstimateBytesInExpiredRowSets();
+
+  // Delete the rowsets all of whose rows have expired, without rewriting
+  // them. If this method returns OK, the number of rowsets and bytes deleted
+  // are returned in the out-parameters.
+  Status DeleteExpiredRowSets(int64_t* rowsets_deleted = nullptr,
+                              int64_t* bytes_deleted = nullptr);
+
+  // Estimate the on-disk size of the rowsets in the fast storage tier that
+  // haven't been scanned for --tablet_cold_rowset_secs.
+  int64_t EstimateBytesInColdRowSets();
+
+  // Rewrite the coldest such rowsets, up to a compaction's worth, to the
+  // slow storage tier. If this method returns OK, the number of rowsets and
+  // bytes migrated are returned in the out-parameters.
+  Status MigrateColdRowSets(int64_t* rowsets_migrated = nullptr,
+                            int64_t* bytes_migrated = nullptr);
+
   // Count the number of deltas in the tablet. Only used for tests.
   int64_t CountUndoDeltasForTests() const;
   int64_t CountRedoDeltasForTests() const;
@@ -339,6 +469,13 @@ class Tablet {
   // memrowset in the current implementation.
   Status CountRows(uint64_t *count) const;
 
+  // Count the number of live rows in the tablet as of the latest committed
+  // state, i.e. the result of a full COUNT(*) scan at READ_LATEST.
+  //
+  // Where possible, rowsets are counted from their metadata and delta stats
+  // instead of being scanned. The other rowsets, e.g. those with REDO deltas
+  // which delete rows and the MemRowSet, are scanned with an empty projection.
+  Status CountLiveRows(uint64_t* count) const;
 
   // Verbosely dump this entire tablet to the logs. This is only
   // really useful when debugging unit tests failures where the tablet
@@ -388,13 +525,33 @@ class Tablet {
   // Calculates history GC options based on properties of the Clock implementation.
   HistoryGcOpts GetHistoryGcOpts() const;
 
+  // Returns true if the row the write operation 'op' mutates has expired.
+  bool IsRowOpExpired(const RowOp& op) const;
+
+  // Sets 'expired' to whether all of the rows of 'rowset' have expired
+  // according to 'cutoff_micros'.
+  Status RowSetHasExpired(const RowSet& rowset, int64_t cutoff_micros, bool* expired) const;
+
+  // Calculates the row expiry cutoff and returns true iff the rows of this
+  // tablet expire, which requires the use of a HybridClock. Rows whose first
+  // key column is below the cutoff have expired. Otherwise, returns false.
+  //
+  // The cutoff never decreases: a row found unexpired by a later call is
+  // also unexpired according to any earlier cutoff.
+  bool GetRowExpiryCutoff(int64_t* cutoff_micros) const WARN_UNUSED_RESULT;
+
+  // Returns whether 'rowset' is in the fast storage tier and hasn't been
+  // scanned for --tablet_cold_rowset_secs.
+  bool RowSetIsCold(const std::shared_ptr<RowSet>& rowset) const;
+
   // Method used by tests to retrieve all rowsets of this table. This
   // will be removed once code for selecting the appropriate RowSet is
   // finished and delta files is finished is part of Tablet class.
   void GetRowSetsForTests(std::vector<std::shared_ptr<RowSet> >* out);
 
-  // Register the maintenance ops associated with this tablet
-  void RegisterMaintenanceOps(MaintenanceManager* maint_mgr);
+  // Register the maintenance ops associated with this tablet, with their perf
+  // improvement weighted by 'perf_weight'.
+  void RegisterMaintenanceOps(MaintenanceManager* maint_mgr, double perf_weight = 1.0);
 
   // Unregister the maintenance ops associated with this tablet. This will wait
   // for all ops to finish before returning.
@@ -415,6 +572,15 @@ class Tablet {
   // May be NULL in unit tests, etc.
   TabletMetrics* metrics() { return metrics_.get(); }
 
+  // Return the trackers of the keys of this tablet which are written and
+  // looked up the most, or NULL if the tracking is disabled.
+  const HotKeyTracker* hot_write_keys() const { return hot_write_keys_.get(); }
+  const HotKeyTracker* hot_point_read_keys() const { return hot_point_read_keys_.get(); }
+
+  // Records a scan of this tablet which looks up the row with the encoded
+  // primary key 'encoded_key'.
+  void RecordPointRead(const Slice& encoded_key);
+
   // Return handle to the metric entity of this tablet.
   const scoped_refptr<MetricEntity>& GetMetricEntity() const {
     return metric_entity_;
@@ -513,6 +679,17 @@ class Tablet {
 
   Status FlushUnlocked();
 
+  // Returns an error if the tablet has been stopped, in which case the row
+  // operations of 'tx_state' must not be applied.
+  Status CheckCanApply(const WriteTransactionState* tx_state) const;
+
+  // Like ApplyRowOperation(), but without checking whether the tablet has
+  // been stopped. Used by ApplyRowOperations(), which checks once per batch.
+  Status ApplyRowOperationNoStateCheck(const fs::IOContext* io_context,
+                                       WriteTransactionState* tx_state,
+                                       RowOp* row_op,
+                                       ProbeStats* stats) WARN_UNUSED_RESULT;
+
   // Validate the contents of 'op' and return a bad Status if it is invalid.
   Status ValidateOp(const RowOp& op) const;
 
@@ -572,19 +749,20 @@ class Tablet {
   //
   // The returned iterators are not Init()ed.
   // 'projection' must remain valid and unchanged for the lifetime of the returned iterators.
-  Status CaptureConsistentIterators(const Schema* projection,
-                                    const MvccSnapshot& snap,
+  Status CaptureConsistentIterators(const RowIteratorOptions& opts,
                                     const ScanSpec* spec,
-                                    OrderMode order,
-                                    const fs::IOContext* io_context,
                                     std::vector<std::shared_ptr<RowwiseIterator> >* iters) const;
 
   Status PickRowSetsToCompact(RowSetsInCompaction *picked,
                               CompactFlags flags) const;
 
-  // Performs a merge compaction or a flush.
+  // Performs a merge compaction or a flush. The output is written to the fast
+  // storage tier if 'prefer_fast_tier' is true and there is one. See
+  // FlushCompactionInput() for 'should_abort'.
   Status DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
-                                  int64_t mrs_being_flushed);
+                                  int64_t mrs_being_flushed,
+                                  bool prefer_fast_tier,
+                                  const std::function<bool()>& should_abort);
 
   // Handle the case in which a compaction or flush yielded no output rows.
   // In this case, we just need to remove the rowsets in 'rowsets' from the
@@ -592,6 +770,34 @@ class Tablet {
   Status HandleEmptyCompactionOrFlush(const RowSetVector& rowsets,
                                       int mrs_being_flushed);
 
+  // Copies the blocks of 'source', a rowset in the file system rooted at
+  // 'source_fs_root', into this tablet's block manager, and opens the copy as
+  // a new rowset without adding it to the tablet.
+  Status CopyRowSetForIngest(const std::string& source_fs_root,
+                             const RowSetDataPB& source,
+                             std::shared_ptr<DiskRowSet>* rowset);
+
+  // Returns Status::InvalidArgument if 'schema_version' isn't the current
+  // version of the tablet schema.
+  Status CheckIngestSchemaVersion(uint32_t schema_version) const;
+
+  // Returns Status::InvalidArgument if the columns of the rowset 'meta' aren't
+  // those of the tablet schema.
+  Status CheckIngestedRowSetColumns(const RowSetMetadata& meta) const;
+
+  // Returns Status::AlreadyPresent if the tablet has any version of a row,
+  // live or deleted, with a key between the encoded keys 'min_encoded_key'
+  // and 'max_encoded_key', inclusive.
+  Status CheckNoRowsInRange(const std::string& min_encoded_key,
+                            const std::string& max_encoded_key) const;
+
+  // Writes an UNDO delta block deleting each row of the staged rowset 'meta'
+  // at 'timestamp', so that the ingested rows have a history starting at the
+  // ingest op. Returns the ID of the block in 'undo_block'.
+  Status WriteIngestUndoDeltas(const std::shared_ptr<RowSetMetadata>& meta,
+                               Timestamp timestamp,
+                               BlockId* undo_block);
+
   Status FlushMetadata(const RowSetVector& to_remove,
                        const RowSetMetadataVector& to_add,
                        int64_t mrs_being_flushed);
@@ -633,7 +839,8 @@ class Tablet {
   Status GetMappedReadProjection(const Schema& projection,
                                  Schema *mapped_projection) const;
 
-  Status CheckRowInTablet(const ConstContiguousRow& row) const;
+  // Checks that the rows of all of the ops belong to this tablet's partition.
+  Status CheckRowsInTablet(const std::vector<RowOp*>& row_ops) const;
 
   // Helper method to find the rowset that has the DMS with the highest retention.
   std::shared_ptr<RowSet> FindBestDMSToFlush(const ReplaySizeMap& replay_size_map) const;
@@ -697,11 +904,27 @@ class Tablet {
 
   std::unique_ptr<Throttler> throttler_;
 
+  // The most written and most looked up keys. Null if the tracking is
+  // disabled with --tablet_hot_key_sample_rate.
+  std::unique_ptr<HotKeyTracker> hot_write_keys_;
+  std::unique_ptr<HotKeyTracker> hot_point_read_keys_;
+
+  // The most recently looked up rows. Null unless
+  // --tablet_row_cache_capacity_mb is set.
+  std::unique_ptr<RowCache> row_cache_;
+
   int64_t next_mrs_id_;
 
   // A pointer to the server's clock.
   scoped_refptr<clock::Clock> clock_;
 
+  // The time to live of the rows of this tablet, or 0 if they never expire.
+  const int64_t row_ttl_micros_;
+
+  // The NUMA node the memory of this tablet's MemRowSets is placed on, or -1
+  // if it isn't placed (see --tablet_numa_placement).
+  const int numa_node_;
+
   MvccManager mvcc_;
   LockManager lock_manager_;
 
@@ -789,15 +1012,36 @@ class Tablet::Iterator : public RowwiseIterator {
 
   DISALLOW_COPY_AND_ASSIGN(Iterator);
 
-  Iterator(const Tablet* tablet, const Schema& projection, MvccSnapshot snap,
-           OrderMode order, fs::IOContext io_context);
+  Iterator(const Tablet* tablet, RowIteratorOptions opts, fs::IOContext io_context);
+
+  // If 'spec' looks up a single row, points 'iter_' to the row in the
+  // tablet's row cache, reading the row into the cache first if it's missing.
+  // Sets 'served' to whether it did.
+  Status InitFromRowCache(ScanSpec* spec, bool* served);
+
+  // Reads the row looked up by 'spec' in a snapshot of the latest committed
+  // state of the tablet, and caches it if no write to its key raced with the
+  // read.
+  Status FillRowCache(ScanSpec* spec);
 
   const Tablet *tablet_;
   Schema projection_;
-  const MvccSnapshot snap_;
-  const OrderMode order_;
+
+  // The options of the rowset iterators. The projection and IO context
+  // point to 'projection_' and 'io_context_'.
+  RowIteratorOptions opts_;
+
+  // Bounds the data that this iterator's CFile iterators may read ahead.
+  // Referenced by io_context_, so must be declared before it.
+  const std::unique_ptr<fs::ReadAheadBudget> read_ahead_budget_;
   const fs::IOContext io_context_;
   gscoped_ptr<RowwiseIterator> iter_;
+
+  // If the tablet's rows expire, the scan spec used when Init() is passed
+  // none, and the lower bound key which excludes the expired rows.
+  gscoped_ptr<ScanSpec> expiry_spec_;
+  gscoped_ptr<uint8_t[]> expiry_lower_bound_row_;
+  gscoped_ptr<EncodedKey> expiry_lower_bound_key_;
 };
 
 // Structure which represents the components of the tablet's storage.
@@ -18,6 +18,7 @@
 #include "kudu/tablet/tablet_bootstrap.h"
 
 #include <cstdint>
+#include <deque>
 #include <iterator>
 #include <map>
 #include <memory>
@@ -74,10 +75,12 @@
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/ingest_rowset_transaction.h"
 #include "kudu/tablet/transactions/transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -86,10 +89,12 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
 
 DECLARE_int32(group_commit_queue_size_bytes);
 
@@ -99,10 +104,18 @@ DEFINE_double(fault_crash_during_log_replay, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_during_log_replay, unsafe);
 
+DEFINE_int64(tablet_bootstrap_read_ahead_bytes, 64 * 1024 * 1024,
+             "Number of bytes of WAL entries that may be read and decoded ahead of "
+             "the entry being replayed during tablet bootstrap. Entries are read on "
+             "a separate thread so that reading and decoding the log overlaps with "
+             "replaying it. If 0, entries are read by the replaying thread.");
+TAG_FLAG(tablet_bootstrap_read_ahead_bytes, experimental);
+
 DECLARE_int32(max_clock_sync_error_usec);
 
 using kudu::clock::Clock;
 using kudu::consensus::ALTER_SCHEMA_OP;
+using kudu::consensus::INGEST_ROWSET_OP;
 using kudu::consensus::CHANGE_CONFIG_OP;
 using kudu::consensus::CommitMsg;
 using kudu::consensus::ConsensusBootstrapInfo;
@@ -128,6 +141,7 @@ using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
 using kudu::rpc::ResultTracker;
 using kudu::tserver::AlterSchemaRequestPB;
+using kudu::tserver::IngestRowSetRequestPB;
 using kudu::tserver::WriteRequestPB;
 using kudu::tserver::WriteResponsePB;
 using std::map;
@@ -176,6 +190,152 @@ class FlushedStoresSnapshot {
   DISALLOW_COPY_AND_ASSIGN(FlushedStoresSnapshot);
 };
 
+// Reads the entries of a sequence of log segments in order, optionally on a
+// separate thread which reads and decodes up to 'read_ahead_bytes' of entries
+// ahead of the caller.
+class LogEntryReadAhead {
+ public:
+  struct Entry {
+    // The entry, or nullptr at the end of a segment or on error.
+    unique_ptr<LogEntryPB> entry;
+
+    // EndOfFile after the last entry of each segment.
+    Status status;
+
+    // The segment reader's offsets after reading the entry.
+    int64_t offset;
+    int64_t read_up_to_offset;
+
+    // The number of bytes of the segment read for this entry.
+    int64_t bytes;
+  };
+
+  // 'segments' must outlive this object.
+  LogEntryReadAhead(const log::SegmentSequence* segments, int64_t read_ahead_bytes);
+
+  // Stops the read-ahead thread, if any.
+  ~LogEntryReadAhead();
+
+  // Starts the read-ahead thread, if read-ahead is enabled.
+  Status Start();
+
+  // Returns the next entry of the segments. Every segment's entries are
+  // followed by an Entry whose status is EndOfFile. After an Entry with any
+  // other bad status, Next() must not be called again.
+  void Next(Entry* e);
+
+ private:
+  // Reads the next entry from the current segment, moving on to the next
+  // segment after the current one's EndOfFile.
+  void ReadEntry(Entry* e);
+
+  void RunThread();
+
+  const log::SegmentSequence& segments_;
+  const int64_t read_ahead_bytes_;
+
+  // The segment being read and its reader. Only accessed by the read-ahead
+  // thread, if there is one.
+  size_t cur_segment_;
+  unique_ptr<log::LogEntryReader> reader_;
+
+  // Protects the members below.
+  Mutex lock_;
+  // Signalled whenever 'queue_' or 'shutdown_' changes.
+  ConditionVariable cond_;
+  std::deque<Entry> queue_;
+  int64_t queued_bytes_;
+  bool shutdown_;
+
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogEntryReadAhead);
+};
+
+LogEntryReadAhead::LogEntryReadAhead(const log::SegmentSequence* segments,
+                                     int64_t read_ahead_bytes)
+    : segments_(*segments),
+      read_ahead_bytes_(read_ahead_bytes),
+      cur_segment_(0),
+      cond_(&lock_),
+      queued_bytes_(0),
+      shutdown_(false) {
+}
+
+LogEntryReadAhead::~LogEntryReadAhead() {
+  if (thread_) {
+    {
+      MutexLock l(lock_);
+      shutdown_ = true;
+      cond_.Broadcast();
+    }
+    thread_->Join();
+  }
+}
+
+Status LogEntryReadAhead::Start() {
+  if (read_ahead_bytes_ <= 0 || segments_.empty()) {
+    return Status::OK();
+  }
+  return Thread::Create("tablet", "bootstrap-read-ahead",
+                        &LogEntryReadAhead::RunThread, this, &thread_);
+}
+
+void LogEntryReadAhead::ReadEntry(Entry* e) {
+  DCHECK_LT(cur_segment_, segments_.size());
+  if (!reader_) {
+    reader_.reset(new log::LogEntryReader(segments_[cur_segment_].get()));
+  }
+  int64_t start_offset = reader_->offset();
+  e->entry.reset();
+  e->status = reader_->ReadNextEntry(&e->entry);
+  e->offset = reader_->offset();
+  e->read_up_to_offset = reader_->read_up_to_offset();
+  e->bytes = e->offset - start_offset;
+  if (e->status.IsEndOfFile()) {
+    reader_.reset();
+    cur_segment_++;
+  }
+}
+
+void LogEntryReadAhead::RunThread() {
+  while (cur_segment_ < segments_.size()) {
+    Entry e;
+    ReadEntry(&e);
+    bool failed = !e.status.ok() && !e.status.IsEndOfFile();
+
+    MutexLock l(lock_);
+    // Always allow one entry to be queued, however large it is.
+    while (!shutdown_ && !queue_.empty() && queued_bytes_ >= read_ahead_bytes_) {
+      cond_.Wait();
+    }
+    if (shutdown_) {
+      return;
+    }
+    queued_bytes_ += e.bytes;
+    queue_.emplace_back(std::move(e));
+    cond_.Broadcast();
+    if (failed) {
+      return;
+    }
+  }
+}
+
+void LogEntryReadAhead::Next(Entry* e) {
+  if (!thread_) {
+    ReadEntry(e);
+    return;
+  }
+  MutexLock l(lock_);
+  while (queue_.empty()) {
+    cond_.Wait();
+  }
+  *e = std::move(queue_.front());
+  queue_.pop_front();
+  queued_bytes_ -= e->bytes;
+  cond_.Broadcast();
+}
+
 // Bootstraps an existing tablet by opening the metadata from disk, and rebuilding soft
 // state by playing log segments. A bootstrapped tablet can then be added to an existing
 // consensus configuration as a LEARNER, which will bring its state up to date with the
@@ -271,6 +431,9 @@ class TabletBootstrap {
   Status PlayChangeConfigRequest(const IOContext* io_context, ReplicateMsg* replicate_msg,
                                  const CommitMsg& commit_msg);
 
+  Status PlayIngestRowSetRequest(const IOContext* io_context, ReplicateMsg* replicate_msg,
+                                 const CommitMsg& commit_msg);
+
   Status PlayNoOpRequest(const IOContext* io_context, ReplicateMsg* replicate_msg,
                          const CommitMsg& commit_msg);
 
@@ -1082,6 +1245,10 @@ Status TabletBootstrap::HandleEntryPair(const IOContext* io_context, LogEntryPB*
       RETURN_NOT_OK_REPLAY(PlayChangeConfigRequest, io_context, replicate, commit);
       break;
 
+    case INGEST_ROWSET_OP:
+      RETURN_NOT_OK_REPLAY(PlayIngestRowSetRequest, io_context, replicate, commit);
+      break;
+
     case NO_OP:
       RETURN_NOT_OK_REPLAY(PlayNoOpRequest, io_context, replicate, commit);
       break;
@@ -1183,14 +1350,18 @@ Status TabletBootstrap::PlaySegments(const IOContext* io_context,
   const auto kStatusUpdateInterval = MonoDelta::FromSeconds(5);
   int segment_count = 0;
 
-  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
-    log::LogEntryReader reader(segment.get());
+  // Entries are read and decoded ahead on a separate thread, while this thread
+  // replays them in order.
+  LogEntryReadAhead read_ahead(&segments, FLAGS_tablet_bootstrap_read_ahead_bytes);
+  RETURN_NOT_OK_PREPEND(read_ahead.Start(), "Failed to start reading the log");
 
+  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
     int entry_count = 0;
     while (true) {
+      LogEntryReadAhead::Entry next;
       {
-        unique_ptr<LogEntryPB> entry;
-        Status s = reader.ReadNextEntry(&entry);
+        read_ahead.Next(&next);
+        Status s = next.status;
         if (PREDICT_FALSE(!s.ok())) {
           if (s.IsEndOfFile()) {
             break;
@@ -1207,7 +1378,7 @@ Status TabletBootstrap::PlaySegments(const IOContext* io_context,
         entry_count++;
 
         string entry_debug_info;
-        s = HandleEntry(io_context, &state, std::move(entry), &entry_debug_info);
+        s = HandleEntry(io_context, &state, std::move(next.entry), &entry_debug_info);
         if (!s.ok()) {
           DumpReplayStateToLog(state);
           RETURN_NOT_OK_PREPEND(s, DebugInfo(tablet_->tablet_id(),
@@ -1222,8 +1393,8 @@ Status TabletBootstrap::PlaySegments(const IOContext* io_context,
         SetStatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
                                     "($2/$3 this segment, stats: $4)",
                                     segment_count + 1, log_reader_->num_segments(),
-                                    HumanReadableNumBytes::ToString(reader.offset()),
-                                    HumanReadableNumBytes::ToString(reader.read_up_to_offset()),
+                                    HumanReadableNumBytes::ToString(next.offset),
+                                    HumanReadableNumBytes::ToString(next.read_up_to_offset),
                                     stats_.ToString()));
         last_status_update = now;
       }
@@ -1472,6 +1643,28 @@ Status TabletBootstrap::PlayAlterSchemaRequest(const IOContext* /*io_context*/,
   return AppendCommitMsg(commit_msg);
 }
 
+Status TabletBootstrap::PlayIngestRowSetRequest(const IOContext* /*io_context*/,
+                                                ReplicateMsg* replicate_msg,
+                                                const CommitMsg& commit_msg) {
+  // The ingested rowset is flushed to the tablet metadata along with the
+  // index of the op that added it; don't add it a second time.
+  if (replicate_msg->id().index() <= tablet_->metadata()->last_ingested_rowset_op_index()) {
+    VLOG_WITH_PREFIX(1) << "Skipping already ingested rowset at op "
+                        << OpIdToString(replicate_msg->id());
+    return AppendCommitMsg(commit_msg);
+  }
+
+  IngestRowSetRequestPB* ingest = replicate_msg->mutable_ingest_rowset_request();
+  IngestRowSetTransactionState tx_state(nullptr, ingest, nullptr);
+  tx_state.set_timestamp(Timestamp(replicate_msg->timestamp()));
+  tablet_->StartTransaction(&tx_state);
+  tablet_->CreatePreparedIngestRowSet(&tx_state);
+  RETURN_NOT_OK_PREPEND(tablet_->IngestRowSet(&tx_state, replicate_msg->id().index()),
+                        "Failed to IngestRowSet:");
+  tx_state.ReleaseMvccTxn(Transaction::COMMITTED);
+  return AppendCommitMsg(commit_msg);
+}
+
 Status TabletBootstrap::PlayChangeConfigRequest(const IOContext* /*io_context*/,
                                                 ReplicateMsg* replicate_msg,
                                                 const CommitMsg& commit_msg) {
@@ -19,6 +19,7 @@
 #include <atomic>
 
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -49,6 +50,7 @@
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet-harness.h"
 #include "kudu/tablet/tablet-test-base.h"
+#include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_metrics.h"
@@ -59,6 +61,7 @@
 
 DECLARE_bool(enable_maintenance_manager);
 DECLARE_int32(tablet_history_max_age_sec);
+DECLARE_string(tablet_row_ttl_tables);
 DECLARE_string(time_source);
 
 using kudu::clock::HybridClock;
@@ -642,5 +645,151 @@ TEST_F(TabletHistoryGcNoMaintMgrTest, TestUndoDeltaBlockGc) {
   ASSERT_EQ(1, tablet()->metrics()->undo_delta_block_gc_delete_duration->TotalCount());
 }
 
+// Test that undo delta blocks straddling the AHM are rewritten without their
+// ancient deltas, and that history at or after the AHM survives the rewrite.
+TEST_F(TabletHistoryGcNoMaintMgrTest, TestRewritePartiallyAncientUndoDeltas) {
+  FLAGS_tablet_history_max_age_sec = 100;
+
+  NO_FATALS(InsertOriginalRows(num_rowsets_, rows_per_rowset_));
+
+  // Update the rows every 10 seconds and compact all of the redos of a rowset
+  // into a single undo delta block spanning 40 seconds of history.
+  constexpr int kNumMutationsPerRow = 5;
+  Timestamp after_third_update;
+  for (int i = 0; i < kNumMutationsPerRow; i++) {
+    NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(10)));
+    NO_FATALS(UpdateOriginalRows(num_rowsets_, rows_per_rowset_, i));
+    if (i == 2) after_third_update = clock()->Now();
+  }
+  ASSERT_OK(tablet()->MajorCompactAllDeltaStoresForTests());
+  const int expected_undo_blocks = 2 * num_rowsets_;
+  ASSERT_EQ(expected_undo_blocks, tablet()->CountUndoDeltasForTests());
+
+  ASSERT_EQ(0, tablet()->EstimateBytesInPartiallyAncientUndoDeltas());
+
+  // Move the AHM between the second and the third update. Initializing the
+  // undos covers the block of the inserts, which is now ancient, and the
+  // block straddling the AHM.
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(FLAGS_tablet_history_max_age_sec - 25)));
+  int64_t bytes_in_ancient_undos = 0;
+  const MonoDelta kNoTimeLimit = MonoDelta();
+  ASSERT_OK(tablet()->InitAncientUndoDeltas(kNoTimeLimit, &bytes_in_ancient_undos));
+  ASSERT_GT(bytes_in_ancient_undos, 0);
+  ASSERT_GT(tablet()->EstimateBytesInPartiallyAncientUndoDeltas(), 0);
+
+  int64_t blocks_rewritten;
+  int64_t bytes_rewritten;
+  ASSERT_OK(tablet()->RewritePartiallyAncientUndoDeltas(std::numeric_limits<int64_t>::max(),
+                                                        &blocks_rewritten, &bytes_rewritten));
+  ASSERT_EQ(num_rowsets_, blocks_rewritten);
+  ASSERT_GT(bytes_rewritten, 0);
+  ASSERT_EQ(bytes_rewritten,
+            tablet()->metrics()->undo_delta_block_gc_bytes_rewritten->value());
+  ASSERT_EQ(expected_undo_blocks, tablet()->CountUndoDeltasForTests());
+  ASSERT_EQ(0, tablet()->EstimateBytesInPartiallyAncientUndoDeltas());
+
+  // History from after the AHM is still readable.
+  NO_FATALS(VerifyTestRowsWithTimestampAndVerifier(kStartRow, TotalNumRows(), after_third_update,
+                                                   kRowsEqual2));
+
+  // With a zero budget nothing is rewritten.
+  ASSERT_OK(tablet()->RewritePartiallyAncientUndoDeltas(0, &blocks_rewritten, &bytes_rewritten));
+  ASSERT_EQ(0, blocks_rewritten);
+
+  // The fully ancient undo blocks of the inserts are still left for deletion.
+  int64_t blocks_deleted;
+  ASSERT_OK(tablet()->InitAncientUndoDeltas(kNoTimeLimit, &bytes_in_ancient_undos));
+  ASSERT_OK(tablet()->DeleteAncientUndoDeltas(&blocks_deleted, nullptr));
+  ASSERT_EQ(num_rowsets_, blocks_deleted);
+  ASSERT_EQ(num_rowsets_, tablet()->CountUndoDeltasForTests());
+}
+
+// A tablet whose rows expire 100 seconds after the time in their first key
+// column.
+class TabletRowTtlTest : public KuduTabletTest {
+ public:
+  TabletRowTtlTest()
+      : KuduTabletTest(Schema({ ColumnSchema("ts", UNIXTIME_MICROS),
+                                ColumnSchema("val", INT32) }, 1),
+                       TabletHarness::Options::HYBRID_CLOCK) {
+    FLAGS_time_source = "mock";
+    FLAGS_tablet_row_ttl_tables = "KuduTableTest=100";
+  }
+
+  void SetUp() override {
+    NO_FATALS(KuduTabletTest::SetUp());
+    SetMockTime(GetCurrentTimeMicros());
+  }
+
+ protected:
+  static constexpr int64_t kTtlMicros = 100 * 1000000L;
+
+  void SetMockTime(int64_t micros) {
+    auto* hybrid_clock = down_cast<HybridClock*>(clock());
+    auto* ntp = down_cast<clock::MockNtp*>(hybrid_clock->time_service());
+    ntp->SetMockClockWallTimeForTests(micros);
+  }
+
+  int64_t NowMicros() {
+    return HybridClock::GetPhysicalValueMicros(clock()->Now());
+  }
+
+  Status InsertRows(int64_t first_ts, int num_rows) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    for (int i = 0; i < num_rows; i++) {
+      RETURN_NOT_OK(row.SetUnixTimeMicros(0, first_ts + i));
+      RETURN_NOT_OK(row.SetInt32(1, i));
+      RETURN_NOT_OK(writer.Insert(row));
+    }
+    return Status::OK();
+  }
+
+  int CountScannedRows() {
+    vector<string> rows;
+    CHECK_OK(DumpTablet(*tablet(), client_schema_, &rows));
+    return rows.size();
+  }
+};
+
+TEST_F(TabletRowTtlTest, TestExpiredRows) {
+  ASSERT_TRUE(tablet()->has_row_ttl());
+  const int64_t now = NowMicros();
+
+  // Expired rows are hidden from scans right away.
+  ASSERT_OK(InsertRows(now - 2 * kTtlMicros, 10));
+  ASSERT_OK(InsertRows(now - kTtlMicros / 2, 10));
+  ASSERT_EQ(10, CountScannedRows());
+
+  // They can no longer be mutated either.
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  KuduPartialRow row(&client_schema_);
+  ASSERT_OK(row.SetUnixTimeMicros(0, now - 2 * kTtlMicros));
+  ASSERT_OK(row.SetInt32(1, 100));
+  Status s = writer.Update(row);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+
+  // Flushing drops the expired rows.
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  uint64_t num_rows;
+  ASSERT_OK(tablet()->CountRows(&num_rows));
+  ASSERT_EQ(10, num_rows);
+  ASSERT_EQ(10, CountScannedRows());
+  ASSERT_EQ(0, tablet()->EstimateBytesInExpiredRowSets());
+
+  // Once all of its rows have expired, the rowset is deleted as a whole.
+  SetMockTime(now + kTtlMicros);
+  ASSERT_EQ(0, CountScannedRows());
+  ASSERT_GT(tablet()->EstimateBytesInExpiredRowSets(), 0);
+  int64_t rowsets_deleted;
+  int64_t bytes_deleted;
+  ASSERT_OK(tablet()->DeleteExpiredRowSets(&rowsets_deleted, &bytes_deleted));
+  ASSERT_EQ(1, rowsets_deleted);
+  ASSERT_GT(bytes_deleted, 0);
+  ASSERT_EQ(0, tablet()->num_rowsets());
+  ASSERT_EQ(bytes_deleted, tablet()->metrics()->expired_rowset_gc_bytes_deleted->value());
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -19,12 +19,15 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/common/partial_row.h"
 #include "kudu/common/wire_protocol-test-util.h"
+#include "kudu/gutil/bind.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/local_tablet_writer.h"
@@ -33,10 +36,15 @@
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+using std::thread;
+using std::vector;
+
 namespace kudu {
 namespace tablet {
 
@@ -106,6 +114,45 @@ TEST_F(TestTabletMetadata, TestLoadFromSuperBlock) {
             << pb_util::SecureDebugString(superblock_pb_1);
 }
 
+static Status BlockFlush(CountDownLatch* flush_started, CountDownLatch* flush_continue) {
+  flush_started->CountDown();
+  flush_continue->Wait();
+  return Status::OK();
+}
+
+// Test that flushes which wait for another flush to finish are coalesced into
+// a single write of the superblock.
+TEST_F(TestTabletMetadata, TestConcurrentFlushesAreCoalesced) {
+  TabletMetadata* meta = harness_->tablet()->metadata();
+  CountDownLatch flush_started(1);
+  CountDownLatch flush_continue(1);
+  meta->SetPreFlushCallback(Bind(&BlockFlush, &flush_started, &flush_continue));
+  int initial_count = meta->flush_count_for_tests();
+
+  // Block a flush while it holds the flush lock, and queue more flushes
+  // behind it.
+  const int kNumWaitingFlushes = 4;
+  vector<thread> threads;
+  threads.emplace_back([&]() { CHECK_OK(meta->Flush()); });
+  flush_started.Wait();
+  for (int i = 0; i < kNumWaitingFlushes; i++) {
+    threads.emplace_back([&]() { CHECK_OK(meta->Flush()); });
+  }
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  flush_continue.CountDown();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // The waiting flushes were written together, by whichever got the lock
+  // first.
+  ASSERT_EQ(initial_count + 2, meta->flush_count_for_tests());
+
+  // A flush which doesn't wait for another one is written.
+  ASSERT_OK(meta->Flush());
+  ASSERT_EQ(initial_count + 3, meta->flush_count_for_tests());
+}
+
 TEST_F(TestTabletMetadata, TestOnDiskSize) {
   TabletMetadata* meta = harness_->tablet()->metadata();
 
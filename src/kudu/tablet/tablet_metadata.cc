@@ -157,8 +157,15 @@ Status TabletMetadata::LoadOrCreate(FsManager* fs_manager,
 vector<BlockIdPB> TabletMetadata::CollectBlockIdPBs(const TabletSuperBlockPB& superblock) {
   vector<BlockIdPB> block_ids;
   for (const RowSetDataPB& rowset : superblock.rowsets()) {
+    // The columns of a column group share their block.
+    BlockIdSet col_blocks;
     for (const ColumnDataPB& column : rowset.columns()) {
-      block_ids.push_back(column.block());
+      if (InsertIfNotPresent(&col_blocks, BlockId::FromPB(column.block()))) {
+        block_ids.push_back(column.block());
+      }
+      if (column.has_secondary_index()) {
+        block_ids.push_back(column.secondary_index());
+      }
     }
     for (const DeltaDataPB& redo : rowset.redo_deltas()) {
       block_ids.push_back(redo.block());
@@ -184,6 +191,12 @@ vector<BlockId> TabletMetadata::CollectBlockIds() {
                      rowset_block_ids.begin(),
                      rowset_block_ids.end());
   }
+  for (const auto& e : staged_rowsets_) {
+    vector<BlockId> rowset_block_ids = e.second->GetAllBlocks();
+    block_ids.insert(block_ids.begin(),
+                     rowset_block_ids.begin(),
+                     rowset_block_ids.end());
+  }
   return block_ids;
 }
 
@@ -208,6 +221,10 @@ Status TabletMetadata::DeleteTabletData(TabletDataState delete_type,
       AddOrphanedBlocksUnlocked(rsmd->GetAllBlocks());
     }
     rowsets_.clear();
+    for (const auto& e : staged_rowsets_) {
+      AddOrphanedBlocksUnlocked(e.second->GetAllBlocks());
+    }
+    staged_rowsets_.clear();
     tablet_data_state_ = delete_type;
     if (last_logged_opid) {
       tombstone_last_logged_opid_ = last_logged_opid;
@@ -235,6 +252,7 @@ bool TabletMetadata::IsTombstonedWithNoBlocks() const {
   std::lock_guard<LockType> l(data_lock_);
   return tablet_data_state_ == TABLET_DATA_TOMBSTONED &&
       rowsets_.empty() &&
+      staged_rowsets_.empty() &&
       orphaned_blocks_.empty();
 }
 
@@ -274,6 +292,7 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
       fs_manager_(fs_manager),
       next_rowset_idx_(0),
       last_durable_mrs_id_(kNoDurableMemStore),
+      last_ingested_rowset_op_index_(-1),
       schema_(new Schema(schema)),
       schema_version_(0),
       table_name_(std::move(table_name)),
@@ -282,6 +301,8 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
       tombstone_last_logged_opid_(std::move(tombstone_last_logged_opid)),
       num_flush_pins_(0),
       needs_flush_(false),
+      flush_requests_(0),
+      flushed_requests_(0),
       flush_count_for_tests_(0),
       pre_flush_callback_(Bind(DoNothingStatusClosure)) {
   CHECK(schema_->has_column_ids());
@@ -298,9 +319,12 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id)
       tablet_id_(std::move(tablet_id)),
       fs_manager_(fs_manager),
       next_rowset_idx_(0),
+      last_ingested_rowset_op_index_(-1),
       schema_(nullptr),
       num_flush_pins_(0),
       needs_flush_(false),
+      flush_requests_(0),
+      flushed_requests_(0),
       flush_count_for_tests_(0),
       pre_flush_callback_(Bind(DoNothingStatusClosure)) {}
 
@@ -344,6 +368,7 @@ Status TabletMetadata::LoadFromSuperBlock(const TabletSuperBlockPB& superblock)
     }
 
     last_durable_mrs_id_ = superblock.last_durable_mrs_id();
+    last_ingested_rowset_op_index_ = superblock.last_ingested_rowset_op_index();
 
     table_name_ = superblock.table_name();
 
@@ -394,6 +419,14 @@ Status TabletMetadata::LoadFromSuperBlock(const TabletSuperBlockPB& superblock)
       rowsets_.push_back(shared_ptr<RowSetMetadata>(rowset_meta.release()));
     }
 
+    staged_rowsets_.clear();
+    for (const StagedRowSetPB& staged_pb : superblock.staged_rowsets()) {
+      unique_ptr<RowSetMetadata> rowset_meta;
+      RETURN_NOT_OK(RowSetMetadata::Load(this, staged_pb.rowset(), &rowset_meta));
+      next_rowset_idx_ = std::max(next_rowset_idx_, rowset_meta->id() + 1);
+      staged_rowsets_[staged_pb.ingest_id()] = shared_ptr<RowSetMetadata>(rowset_meta.release());
+    }
+
     // Determine the largest block ID known to the tablet metadata so we can
     // notify the block manager of blocks it may have missed (e.g. if a data
     // directory failed and the blocks on it were not read).
@@ -462,6 +495,60 @@ Status TabletMetadata::UpdateAndFlush(const RowSetMetadataIds& to_remove,
   return Flush();
 }
 
+Status TabletMetadata::StageRowSetAndFlush(const string& ingest_id,
+                                           const shared_ptr<RowSetMetadata>& rowset) {
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    shared_ptr<RowSetMetadata>& staged = staged_rowsets_[ingest_id];
+    if (staged) {
+      AddOrphanedBlocksUnlocked(staged->GetAllBlocks());
+    }
+    staged = rowset;
+  }
+  return Flush();
+}
+
+Status TabletMetadata::DiscardStagedRowSetAndFlush(const string& ingest_id) {
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    auto it = staged_rowsets_.find(ingest_id);
+    if (it == staged_rowsets_.end()) {
+      return Status::NotFound("no rowset staged under ingest id", ingest_id);
+    }
+    AddOrphanedBlocksUnlocked(it->second->GetAllBlocks());
+    staged_rowsets_.erase(it);
+  }
+  return Flush();
+}
+
+shared_ptr<RowSetMetadata> TabletMetadata::GetStagedRowSet(const string& ingest_id) const {
+  std::lock_guard<LockType> l(data_lock_);
+  return FindWithDefault(staged_rowsets_, ingest_id, nullptr);
+}
+
+Status TabletMetadata::AddIngestedRowSetAndFlush(const string& ingest_id,
+                                                 const BlockId& undo_block,
+                                                 int64_t op_index) {
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    DCHECK_GT(op_index, last_ingested_rowset_op_index_);
+    auto it = staged_rowsets_.find(ingest_id);
+    if (it == staged_rowsets_.end()) {
+      return Status::NotFound("no rowset staged under ingest id", ingest_id);
+    }
+    RETURN_NOT_OK(it->second->CommitUndoDeltaDataBlock(undo_block));
+    RETURN_NOT_OK(UpdateUnlocked({}, { it->second }, kNoMrsFlushed));
+    staged_rowsets_.erase(it);
+    last_ingested_rowset_op_index_ = op_index;
+  }
+  return Flush();
+}
+
+int64_t TabletMetadata::last_ingested_rowset_op_index() const {
+  std::lock_guard<LockType> l(data_lock_);
+  return last_ingested_rowset_op_index_;
+}
+
 void TabletMetadata::AddOrphanedBlocks(const vector<BlockId>& blocks) {
   std::lock_guard<LockType> l(data_lock_);
   AddOrphanedBlocksUnlocked(blocks);
@@ -520,9 +607,22 @@ Status TabletMetadata::Flush() {
   TRACE_EVENT1("tablet", "TabletMetadata::Flush",
                "tablet_id", tablet_id_);
 
+  int64_t request;
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    request = ++flush_requests_;
+  }
+
   MutexLock l_flush(flush_lock_);
+  if (flushed_requests_ >= request) {
+    // A flush which started after this call wrote its changes (and deleted the
+    // blocks they orphaned) while this call waited for 'flush_lock_'.
+    TRACE("Metadata flush coalesced with another flush");
+    return Status::OK();
+  }
   vector<BlockId> orphaned;
   TabletSuperBlockPB pb;
+  int64_t covered_requests;
   {
     std::lock_guard<LockType> l(data_lock_);
     CHECK_GE(num_flush_pins_, 0);
@@ -532,6 +632,9 @@ Status TabletMetadata::Flush() {
       return Status::OK();
     }
     needs_flush_ = false;
+    // The superblock snapshotted here includes the changes of every call
+    // made so far, including those still waiting for 'flush_lock_'.
+    covered_requests = flush_requests_;
 
     RETURN_NOT_OK(ToSuperBlockUnlocked(&pb, rowsets_));
 
@@ -545,6 +648,7 @@ Status TabletMetadata::Flush() {
   }
   pre_flush_callback_.Run();
   RETURN_NOT_OK(ReplaceSuperBlockUnlocked(pb));
+  flushed_requests_ = covered_requests;
   TRACE("Metadata flushed");
   l_flush.Unlock();
 
@@ -648,6 +752,9 @@ Status TabletMetadata::ToSuperBlockUnlocked(TabletSuperBlockPB* super_block,
   pb.set_tablet_id(tablet_id_);
   partition_.ToPB(pb.mutable_partition());
   pb.set_last_durable_mrs_id(last_durable_mrs_id_);
+  if (last_ingested_rowset_op_index_ >= 0) {
+    pb.set_last_ingested_rowset_op_index(last_ingested_rowset_op_index_);
+  }
   pb.set_schema_version(schema_version_);
   partition_schema_.ToPB(pb.mutable_partition_schema());
   pb.set_table_name(table_name_);
@@ -655,6 +762,11 @@ Status TabletMetadata::ToSuperBlockUnlocked(TabletSuperBlockPB* super_block,
   for (const shared_ptr<RowSetMetadata>& meta : rowsets) {
     meta->ToProtobuf(pb.add_rowsets());
   }
+  for (const auto& e : staged_rowsets_) {
+    StagedRowSetPB* staged_pb = pb.add_staged_rowsets();
+    staged_pb->set_ingest_id(e.first);
+    e.second->ToProtobuf(staged_pb->mutable_rowset());
+  }
 
   DCHECK(schema_->has_column_ids());
   RETURN_NOT_OK_PREPEND(SchemaToPB(*schema_, pb.mutable_schema()),
@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -162,6 +163,12 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // this method.
   Status UnPinFlush();
 
+  // Writes the superblock to disk, including every change made before the
+  // call.
+  //
+  // Concurrent calls are coalesced: a call which finds another flush in
+  // progress waits for it, and then only writes the superblock if it wasn't
+  // already written by a flush which started after the call.
   Status Flush();
 
   // Updates the metadata in the following ways:
@@ -175,6 +182,27 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
                         const RowSetMetadataVector& to_add,
                         int64_t last_durable_mrs_id);
 
+  // Stages 'rowset', whose blocks were copied for an INGEST_ROWSET_OP, under
+  // 'ingest_id' and flushes the metadata. The blocks of the rowset previously
+  // staged under the same ID, if any, are orphaned.
+  Status StageRowSetAndFlush(const std::string& ingest_id,
+                             const std::shared_ptr<RowSetMetadata>& rowset);
+
+  // Drops the rowset staged under 'ingest_id', orphaning its blocks, and
+  // flushes the metadata. Returns Status::NotFound if there is none.
+  Status DiscardStagedRowSetAndFlush(const std::string& ingest_id);
+
+  // Returns the rowset staged under 'ingest_id', or null if there is none.
+  std::shared_ptr<RowSetMetadata> GetStagedRowSet(const std::string& ingest_id) const;
+
+  // Moves the rowset staged under 'ingest_id' to the tablet's rowsets, with
+  // the UNDO delta block 'undo_block', on behalf of the INGEST_ROWSET_OP with
+  // index 'op_index', and flushes the metadata. Returns Status::NotFound if
+  // there is no such rowset.
+  Status AddIngestedRowSetAndFlush(const std::string& ingest_id,
+                                   const BlockId& undo_block,
+                                   int64_t op_index);
+
   // Adds the blocks referenced by 'block_ids' to 'orphaned_blocks_'.
   //
   // This set will be written to the on-disk metadata in any subsequent
@@ -226,6 +254,10 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
 
   int64_t last_durable_mrs_id() const { return last_durable_mrs_id_; }
 
+  // Returns the index of the latest INGEST_ROWSET_OP whose rowset was added to
+  // the metadata, or -1 if there is none.
+  int64_t last_ingested_rowset_op_index() const;
+
   void SetLastDurableMrsIdForTests(int64_t mrs_id) { last_durable_mrs_id_ = mrs_id; }
 
   void SetPreFlushCallback(StatusClosure callback);
@@ -342,6 +374,12 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
 
   int64_t last_durable_mrs_id_;
 
+  // See last_ingested_rowset_op_index().
+  int64_t last_ingested_rowset_op_index_;
+
+  // The rowsets staged for INGEST_ROWSET_OPs, by ingest ID.
+  std::map<std::string, std::shared_ptr<RowSetMetadata>> staged_rowsets_;
+
   // The current schema version. This is owned by this class.
   // We don't use gscoped_ptr so that we can do an atomic swap.
   Schema* schema_;
@@ -376,6 +414,12 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // metadata is persisted.
   bool needs_flush_;
 
+  // The number of calls to Flush(), and the number of them whose changes
+  // are known to have been written by a flush, which may have been another
+  // call's. Protected by 'data_lock_' and 'flush_lock_' respectively.
+  int64_t flush_requests_;
+  int64_t flushed_requests_;
+
   // The number of times metadata has been flushed to disk
   int flush_count_for_tests_;
 
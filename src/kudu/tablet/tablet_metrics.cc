@@ -101,6 +101,13 @@ METRIC_DEFINE_counter(tablet, scanner_bytes_scanned_from_disk, "Scanner Bytes Sc
 METRIC_DEFINE_counter(tablet, scans_started, "Scans Started",
                       kudu::MetricUnit::kScanners,
                       "Number of scanners which have been started on this tablet");
+METRIC_DEFINE_counter(tablet, row_cache_hits, "Row Cache Hits",
+                      kudu::MetricUnit::kCacheHits,
+                      "Number of point lookups answered from the tablet's row cache");
+METRIC_DEFINE_counter(tablet, row_cache_misses, "Row Cache Misses",
+                      kudu::MetricUnit::kCacheQueries,
+                      "Number of point lookups which found no usable row in the "
+                      "tablet's row cache");
 METRIC_DEFINE_gauge_size(tablet, tablet_active_scanners, "Active Scanners",
                          kudu::MetricUnit::kScanners,
                          "Number of scanners that are currently active on this tablet");
@@ -128,6 +135,27 @@ METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_deleted,
                       "on this tablet since this server was restarted. "
                       "Does not include bytes garbage collected during compactions.");
 
+METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_rewritten,
+                      "Undo Delta Block GC Bytes Rewritten",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of partially ancient UNDO delta blocks rewritten "
+                      "without their ancient deltas on this tablet since this server was "
+                      "restarted.");
+
+METRIC_DEFINE_counter(tablet, expired_rowset_gc_bytes_deleted,
+                      "Expired RowSet GC Bytes Deleted",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes deleted by dropping rowsets all of whose rows had "
+                      "expired on this tablet since this server was restarted. Does not "
+                      "include expired rows dropped during flushes and compactions.");
+
+METRIC_DEFINE_counter(tablet, cold_rowset_migration_bytes,
+                      "Cold RowSet Migration Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of rowsets that went unscanned rewritten from the "
+                      "fast to the slow storage tier on this tablet since this server was "
+                      "restarted.");
+
 METRIC_DEFINE_histogram(tablet, bloom_lookups_per_op, "Bloom Lookups per Operation",
                         kudu::MetricUnit::kProbes,
                         "Tracks the number of bloom filter lookups performed by each "
@@ -162,6 +190,75 @@ METRIC_DEFINE_histogram(tablet, write_op_duration_commit_wait_consistency,
   "Duration of writes to this tablet with external consistency set to COMMIT_WAIT.",
   60000000LU, 2);
 
+METRIC_DEFINE_histogram(tablet, write_op_rpc_queue_duration,
+  "Write Op RPC Queue Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time writes to this tablet spent between their RPC being received and "
+  "being submitted. Only recorded on the leader.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_prepare_duration,
+  "Write Op Prepare Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent preparing writes to this tablet, including decoding their "
+  "rows and waiting for their row locks.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_decode_duration,
+  "Write Op Decode Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent decoding the rows of writes to this tablet.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_row_locking_duration,
+  "Write Op Row Locking Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time writes to this tablet spent locking their rows, including encoding "
+  "their keys and waiting for the locks held by other writes.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_replication_duration,
+  "Write Op Replication Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time writes to this tablet spent waiting for a majority of the "
+  "replicas to have them in their WAL. Only recorded on the leader.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_local_wal_append_duration,
+  "Write Op Local WAL Append Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time the leader spent durably appending writes to this tablet to its "
+  "own WAL. Only recorded on the leader.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_apply_duration,
+  "Write Op Apply Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent applying writes to this tablet, including checking whether "
+  "their rows exist, inserting new rows and mutating existing ones.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_presence_check_duration,
+  "Write Op Presence Check Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent applying writes to this tablet checking whether their rows "
+  "exist, in the bloom filters and keys of the rowsets.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_mrs_insert_duration,
+  "Write Op MemRowSet Insert Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent applying writes to this tablet inserting new rows into the "
+  "MemRowSet.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_mutate_duration,
+  "Write Op Mutate Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent applying writes to this tablet updating and deleting "
+  "existing rows.",
+  60000000LU, 2);
+
 METRIC_DEFINE_histogram(tablet, commit_wait_duration,
   "Commit-Wait Duration",
   kudu::MetricUnit::kMicroseconds,
@@ -204,6 +301,16 @@ METRIC_DEFINE_gauge_uint32(tablet, undo_delta_block_gc_running,
   kudu::MetricUnit::kMaintenanceOperations,
   "Number of UNDO delta block GC operations currently running.");
 
+METRIC_DEFINE_gauge_uint32(tablet, expired_rowset_gc_running,
+  "Expired RowSet GC Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of expired rowset GC operations currently running.");
+
+METRIC_DEFINE_gauge_uint32(tablet, cold_rowset_migration_running,
+  "Cold RowSet Migrations Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of cold rowset migration operations currently running.");
+
 METRIC_DEFINE_gauge_int64(tablet, undo_delta_block_estimated_retained_bytes,
   "Estimated Deletable Bytes Retained in Undo Delta Blocks",
   kudu::MetricUnit::kBytes,
@@ -250,6 +357,18 @@ METRIC_DEFINE_histogram(tablet, undo_delta_block_gc_perform_duration,
   kudu::MetricUnit::kMilliseconds,
   "Time spent running the maintenance operation to GC ancient UNDO delta blocks.", 60000LU, 1);
 
+METRIC_DEFINE_histogram(tablet, expired_rowset_gc_duration,
+  "Expired RowSet GC Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent running the maintenance operation to delete rowsets all of whose "
+  "rows have expired.", 60000LU, 1);
+
+METRIC_DEFINE_histogram(tablet, cold_rowset_migration_duration,
+  "Cold RowSet Migration Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent running the maintenance operation to rewrite rowsets that went "
+  "unscanned from the fast to the slow storage tier.", 60000LU, 1);
+
 METRIC_DEFINE_counter(tablet, leader_memory_pressure_rejections,
   "Leader Memory Pressure Rejections",
   kudu::MetricUnit::kRequests,
@@ -283,6 +402,8 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(scanner_cells_scanned_from_disk),
     MINIT(scanner_bytes_scanned_from_disk),
     MINIT(scans_started),
+    MINIT(row_cache_hits),
+    MINIT(row_cache_misses),
     GINIT(tablet_active_scanners),
     MINIT(bloom_lookups),
     MINIT(key_file_lookups),
@@ -290,6 +411,9 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(mrs_lookups),
     MINIT(bytes_flushed),
     MINIT(undo_delta_block_gc_bytes_deleted),
+    MINIT(undo_delta_block_gc_bytes_rewritten),
+    MINIT(expired_rowset_gc_bytes_deleted),
+    MINIT(cold_rowset_migration_bytes),
     MINIT(bloom_lookups_per_op),
     MINIT(key_file_lookups_per_op),
     MINIT(delta_file_lookups_per_op),
@@ -297,12 +421,24 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(snapshot_read_inflight_wait_duration),
     MINIT(write_op_duration_client_propagated_consistency),
     MINIT(write_op_duration_commit_wait_consistency),
+    MINIT(write_op_rpc_queue_duration),
+    MINIT(write_op_prepare_duration),
+    MINIT(write_op_decode_duration),
+    MINIT(write_op_row_locking_duration),
+    MINIT(write_op_replication_duration),
+    MINIT(write_op_local_wal_append_duration),
+    MINIT(write_op_apply_duration),
+    MINIT(write_op_presence_check_duration),
+    MINIT(write_op_mrs_insert_duration),
+    MINIT(write_op_mutate_duration),
     GINIT(flush_dms_running),
     GINIT(flush_mrs_running),
     GINIT(compact_rs_running),
     GINIT(delta_minor_compact_rs_running),
     GINIT(delta_major_compact_rs_running),
     GINIT(undo_delta_block_gc_running),
+    GINIT(expired_rowset_gc_running),
+    GINIT(cold_rowset_migration_running),
     GINIT(undo_delta_block_estimated_retained_bytes),
     MINIT(flush_dms_duration),
     MINIT(flush_mrs_duration),
@@ -312,6 +448,8 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(undo_delta_block_gc_init_duration),
     MINIT(undo_delta_block_gc_delete_duration),
     MINIT(undo_delta_block_gc_perform_duration),
+    MINIT(expired_rowset_gc_duration),
+    MINIT(cold_rowset_migration_duration),
     MINIT(leader_memory_pressure_rejections),
     GINIT(average_diskrowset_height) {
 }
@@ -59,6 +59,8 @@ struct TabletMetrics {
   scoped_refptr<Counter> scanner_cells_scanned_from_disk;
   scoped_refptr<Counter> scanner_bytes_scanned_from_disk;
   scoped_refptr<Counter> scans_started;
+  scoped_refptr<Counter> row_cache_hits;
+  scoped_refptr<Counter> row_cache_misses;
   scoped_refptr<AtomicGauge<size_t>> tablet_active_scanners;
 
   // Probe stats.
@@ -70,6 +72,9 @@ struct TabletMetrics {
   // Operation stats.
   scoped_refptr<Counter> bytes_flushed;
   scoped_refptr<Counter> undo_delta_block_gc_bytes_deleted;
+  scoped_refptr<Counter> undo_delta_block_gc_bytes_rewritten;
+  scoped_refptr<Counter> expired_rowset_gc_bytes_deleted;
+  scoped_refptr<Counter> cold_rowset_migration_bytes;
 
   scoped_refptr<Histogram> bloom_lookups_per_op;
   scoped_refptr<Histogram> key_file_lookups_per_op;
@@ -80,12 +85,26 @@ struct TabletMetrics {
   scoped_refptr<Histogram> write_op_duration_client_propagated_consistency;
   scoped_refptr<Histogram> write_op_duration_commit_wait_consistency;
 
+  // The time spent in each phase of a write. See TransactionMetrics.
+  scoped_refptr<Histogram> write_op_rpc_queue_duration;
+  scoped_refptr<Histogram> write_op_prepare_duration;
+  scoped_refptr<Histogram> write_op_decode_duration;
+  scoped_refptr<Histogram> write_op_row_locking_duration;
+  scoped_refptr<Histogram> write_op_replication_duration;
+  scoped_refptr<Histogram> write_op_local_wal_append_duration;
+  scoped_refptr<Histogram> write_op_apply_duration;
+  scoped_refptr<Histogram> write_op_presence_check_duration;
+  scoped_refptr<Histogram> write_op_mrs_insert_duration;
+  scoped_refptr<Histogram> write_op_mutate_duration;
+
   scoped_refptr<AtomicGauge<uint32_t> > flush_dms_running;
   scoped_refptr<AtomicGauge<uint32_t> > flush_mrs_running;
   scoped_refptr<AtomicGauge<uint32_t> > compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > delta_minor_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > delta_major_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > undo_delta_block_gc_running;
+  scoped_refptr<AtomicGauge<uint32_t> > expired_rowset_gc_running;
+  scoped_refptr<AtomicGauge<uint32_t> > cold_rowset_migration_running;
   scoped_refptr<AtomicGauge<int64_t> > undo_delta_block_estimated_retained_bytes;
 
   scoped_refptr<Histogram> flush_dms_duration;
@@ -96,6 +115,8 @@ struct TabletMetrics {
   scoped_refptr<Histogram> undo_delta_block_gc_init_duration;
   scoped_refptr<Histogram> undo_delta_block_gc_delete_duration;
   scoped_refptr<Histogram> undo_delta_block_gc_perform_duration;
+  scoped_refptr<Histogram> expired_rowset_gc_duration;
+  scoped_refptr<Histogram> cold_rowset_migration_duration;
 
   scoped_refptr<Counter> leader_memory_pressure_rejections;
 
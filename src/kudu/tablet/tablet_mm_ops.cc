@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/tablet_mm_ops.h"
 
+#include <algorithm>
 #include <mutex>
 #include <ostream>
 #include <utility>
@@ -72,7 +73,19 @@ DEFINE_bool(enable_undo_delta_block_gc, true,
 TAG_FLAG(enable_undo_delta_block_gc, runtime);
 TAG_FLAG(enable_undo_delta_block_gc, unsafe);
 
+DEFINE_int32(undo_delta_block_gc_rewrite_rate_mb_per_sec, 8,
+    "The rate, in MB per second per tablet, at which undo delta block GC "
+    "rewrites UNDO delta blocks holding both ancient and non-ancient deltas "
+    "without their ancient deltas. Set to 0 to only delete blocks that are "
+    "ancient in their entirety.");
+TAG_FLAG(undo_delta_block_gc_rewrite_rate_mb_per_sec, advanced);
+TAG_FLAG(undo_delta_block_gc_rewrite_rate_mb_per_sec, experimental);
+TAG_FLAG(undo_delta_block_gc_rewrite_rate_mb_per_sec, runtime);
+
+DECLARE_int32(tablet_compaction_budget_mb);
+
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -87,6 +100,10 @@ string TabletOpBase::LogPrefix() const {
   return tablet_->LogPrefix();
 }
 
+vector<int> TabletOpBase::DataDirs() const {
+  return tablet_->DataDirs();
+}
+
 ////////////////////////////////////////////////////////////
 // CompactRowSetsOp
 ////////////////////////////////////////////////////////////
@@ -143,9 +160,15 @@ bool CompactRowSetsOp::Prepare() {
 }
 
 void CompactRowSetsOp::Perform() {
-  WARN_NOT_OK(tablet_->Compact(Tablet::COMPACT_NO_FLAGS),
-              Substitute("$0Compaction failed on $1",
-                         LogPrefix(), tablet_->tablet_id()));
+  Status s = tablet_->Compact(Tablet::COMPACT_NO_FLAGS,
+                              [this]() { return preemption_requested(); });
+  if (!s.ok() && preemption_requested()) {
+    LOG_WITH_PREFIX(INFO) << "Compaction stopped early to make room for more urgent work: "
+                          << s.ToString();
+    return;
+  }
+  WARN_NOT_OK(s, Substitute("$0Compaction failed on $1",
+                            LogPrefix(), tablet_->tablet_id()));
 }
 
 scoped_refptr<Histogram> CompactRowSetsOp::DurationHistogram() const {
@@ -323,7 +346,25 @@ scoped_refptr<AtomicGauge<uint32_t> > MajorDeltaCompactionOp::RunningGauge() con
 
 UndoDeltaBlockGCOp::UndoDeltaBlockGCOp(Tablet* tablet)
   : TabletOpBase(Substitute("UndoDeltaBlockGCOp($0)", tablet->tablet_id()),
-                 MaintenanceOp::HIGH_IO_USAGE, tablet) {
+                 MaintenanceOp::HIGH_IO_USAGE, tablet),
+    rewrite_budget_bytes_(0),
+    rewrite_budget_refilled_(MonoTime::Now()) {
+}
+
+double UndoDeltaBlockGCOp::RefillRewriteBudget() {
+  const double rate_bytes_per_sec =
+      static_cast<double>(FLAGS_undo_delta_block_gc_rewrite_rate_mb_per_sec) * 1024 * 1024;
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  double elapsed_sec = (now - rewrite_budget_refilled_).ToSeconds();
+  rewrite_budget_refilled_ = now;
+  if (rate_bytes_per_sec <= 0) {
+    rewrite_budget_bytes_ = 0;
+  } else {
+    rewrite_budget_bytes_ = std::min(rate_bytes_per_sec,
+                                     rewrite_budget_bytes_ + elapsed_sec * rate_bytes_per_sec);
+  }
+  return rewrite_budget_bytes_;
 }
 
 void UndoDeltaBlockGCOp::UpdateStats(MaintenanceOpStats* stats) {
@@ -337,8 +378,17 @@ void UndoDeltaBlockGCOp::UpdateStats(MaintenanceOpStats* stats) {
   int64_t max_estimated_retained_bytes = 0;
   WARN_NOT_OK(tablet_->EstimateBytesInPotentiallyAncientUndoDeltas(&max_estimated_retained_bytes),
               "Unable to count bytes in potentially ancient undo deltas");
-  stats->set_data_retained_bytes(max_estimated_retained_bytes);
-  stats->set_runnable(max_estimated_retained_bytes > 0);
+
+  // Blocks which are only partially ancient are only worth running for once
+  // the rewrite rate limit allows some rewriting.
+  int64_t partially_ancient_bytes = 0;
+  if (FLAGS_undo_delta_block_gc_rewrite_rate_mb_per_sec > 0) {
+    partially_ancient_bytes = tablet_->EstimateBytesInPartiallyAncientUndoDeltas();
+  }
+  bool can_rewrite = partially_ancient_bytes > 0 && RefillRewriteBudget() > 0;
+
+  stats->set_data_retained_bytes(max_estimated_retained_bytes + partially_ancient_bytes);
+  stats->set_runnable(max_estimated_retained_bytes > 0 || can_rewrite);
 }
 
 bool UndoDeltaBlockGCOp::Prepare() {
@@ -355,11 +405,22 @@ void UndoDeltaBlockGCOp::Perform() {
     return;
   }
 
-  // Return early if it turns out that we have nothing to GC.
-  if (bytes_in_ancient_undos == 0) return;
+  if (bytes_in_ancient_undos > 0) {
+    CHECK_OK_PREPEND(tablet_->DeleteAncientUndoDeltas(),
+                     Substitute("$0GC of undo delta blocks failed", LogPrefix()));
+  }
+
+  if (FLAGS_undo_delta_block_gc_rewrite_rate_mb_per_sec <= 0) return;
+  double budget = RefillRewriteBudget();
+  if (budget <= 0) return;
 
-  CHECK_OK_PREPEND(tablet_->DeleteAncientUndoDeltas(),
-                   Substitute("$0GC of undo delta blocks failed", LogPrefix()));
+  int64_t bytes_rewritten = 0;
+  CHECK_OK_PREPEND(tablet_->RewritePartiallyAncientUndoDeltas(static_cast<int64_t>(budget),
+                                                              nullptr, &bytes_rewritten),
+                   Substitute("$0Rewrite of partially ancient undo delta blocks failed",
+                              LogPrefix()));
+  std::lock_guard<simple_spinlock> l(lock_);
+  rewrite_budget_bytes_ -= bytes_rewritten;
 }
 
 scoped_refptr<Histogram> UndoDeltaBlockGCOp::DurationHistogram() const {
@@ -374,5 +435,85 @@ std::string UndoDeltaBlockGCOp::LogPrefix() const {
   return tablet_->LogPrefix();
 }
 
+////////////////////////////////////////////////////////////
+// ExpiredRowSetGCOp
+////////////////////////////////////////////////////////////
+
+ExpiredRowSetGCOp::ExpiredRowSetGCOp(Tablet* tablet)
+  : TabletOpBase(Substitute("ExpiredRowSetGCOp($0)", tablet->tablet_id()),
+                 MaintenanceOp::LOW_IO_USAGE, tablet) {
+}
+
+void ExpiredRowSetGCOp::UpdateStats(MaintenanceOpStats* stats) {
+  int64_t expired_bytes = tablet_->EstimateBytesInExpiredRowSets();
+  stats->set_data_retained_bytes(expired_bytes);
+  stats->set_runnable(expired_bytes > 0);
+}
+
+bool ExpiredRowSetGCOp::Prepare() {
+  // Nothing for us to do.
+  return true;
+}
+
+void ExpiredRowSetGCOp::Perform() {
+  CHECK_OK_PREPEND(tablet_->DeleteExpiredRowSets(),
+                   Substitute("$0Deletion of expired rowsets failed", LogPrefix()));
+}
+
+scoped_refptr<Histogram> ExpiredRowSetGCOp::DurationHistogram() const {
+  return tablet_->metrics()->expired_rowset_gc_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t>> ExpiredRowSetGCOp::RunningGauge() const {
+  return tablet_->metrics()->expired_rowset_gc_running;
+}
+
+std::string ExpiredRowSetGCOp::LogPrefix() const {
+  return tablet_->LogPrefix();
+}
+
+////////////////////////////////////////////////////////////
+// MigrateColdRowSetsOp
+////////////////////////////////////////////////////////////
+
+MigrateColdRowSetsOp::MigrateColdRowSetsOp(Tablet* tablet)
+  : TabletOpBase(Substitute("MigrateColdRowSetsOp($0)", tablet->tablet_id()),
+                 MaintenanceOp::HIGH_IO_USAGE, tablet) {
+}
+
+void MigrateColdRowSetsOp::UpdateStats(MaintenanceOpStats* stats) {
+  // The migration is a compaction, so it's disabled along with them.
+  if (PREDICT_FALSE(!FLAGS_enable_rowset_compaction)) {
+    stats->set_runnable(false);
+    return;
+  }
+  int64_t cold_bytes = tablet_->EstimateBytesInColdRowSets();
+  double budget_bytes = FLAGS_tablet_compaction_budget_mb * 1024.0 * 1024.0;
+  stats->set_perf_improvement(std::min(1.0, cold_bytes / budget_bytes));
+  stats->set_runnable(cold_bytes > 0);
+}
+
+bool MigrateColdRowSetsOp::Prepare() {
+  // Nothing for us to do.
+  return true;
+}
+
+void MigrateColdRowSetsOp::Perform() {
+  WARN_NOT_OK(tablet_->MigrateColdRowSets(),
+              Substitute("$0Migration of cold rowsets failed", LogPrefix()));
+}
+
+scoped_refptr<Histogram> MigrateColdRowSetsOp::DurationHistogram() const {
+  return tablet_->metrics()->cold_rowset_migration_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t>> MigrateColdRowSetsOp::RunningGauge() const {
+  return tablet_->metrics()->cold_rowset_migration_running;
+}
+
+std::string MigrateColdRowSetsOp::LogPrefix() const {
+  return tablet_->LogPrefix();
+}
+
 } // namespace tablet
 } // namespace kudu
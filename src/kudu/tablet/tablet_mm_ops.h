@@ -20,12 +20,14 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/monotime.h"
 
 namespace kudu {
 
@@ -42,6 +44,8 @@ class TabletOpBase : public MaintenanceOp {
   TabletOpBase(std::string name, IOUsage io_usage, Tablet* tablet);
   std::string LogPrefix() const;
 
+  virtual std::vector<int> DataDirs() const OVERRIDE;
+
  protected:
   Tablet* const tablet_;
 };
@@ -136,8 +140,9 @@ class UndoDeltaBlockGCOp : public TabletOpBase {
   explicit UndoDeltaBlockGCOp(Tablet* tablet);
 
   // Estimates the number of bytes that may potentially be in ancient delta
-  // undo blocks. Over time, as Perform() is invoked, this estimate gets more
-  // accurate.
+  // undo blocks, including the ancient part of blocks which also hold
+  // non-ancient deltas. Over time, as Perform() is invoked, this estimate
+  // gets more accurate.
   void UpdateStats(MaintenanceOpStats* stats) override;
 
   bool Prepare() override;
@@ -145,7 +150,9 @@ class UndoDeltaBlockGCOp : public TabletOpBase {
   // Deletes ancient history data from disk. This also initializes undo delta
   // blocks greedily (in a budgeted manner controlled by the
   // --undo_delta_block_gc_init_budget_millis gflag) that makes the estimate
-  // performed in UpdateStats() more accurate.
+  // performed in UpdateStats() more accurate. Undo delta blocks which are
+  // only partially ancient are rewritten without their ancient deltas at the
+  // rate set by --undo_delta_block_gc_rewrite_rate_mb_per_sec.
   void Perform() override;
 
   scoped_refptr<Histogram> DurationHistogram() const override;
@@ -155,9 +162,71 @@ class UndoDeltaBlockGCOp : public TabletOpBase {
  private:
   std::string LogPrefix() const;
 
+  // Adds the bytes accrued since the last refill to the rewrite budget and
+  // returns the new budget. The budget is capped at one second's worth of
+  // rewriting so that an idle op does not save up for a large burst.
+  double RefillRewriteBudget();
+
+  // Protects the rewrite budget members below.
+  mutable simple_spinlock lock_;
+
+  // Number of bytes of partially ancient undo delta blocks that may be
+  // rewritten. Rewriting a block is all-or-nothing, so this may go negative;
+  // nothing is rewritten again until it has been paid back.
+  double rewrite_budget_bytes_;
+  MonoTime rewrite_budget_refilled_;
+
   DISALLOW_COPY_AND_ASSIGN(UndoDeltaBlockGCOp);
 };
 
+// MaintenanceOp to delete the rowsets all of whose rows have expired (see
+// --tablet_row_ttl_tables) without rewriting them. Only registered for
+// tablets whose rows expire.
+class ExpiredRowSetGCOp : public TabletOpBase {
+ public:
+  explicit ExpiredRowSetGCOp(Tablet* tablet);
+
+  // Reports the on-disk size of the expired rowsets as retained data.
+  void UpdateStats(MaintenanceOpStats* stats) override;
+
+  bool Prepare() override;
+
+  void Perform() override;
+
+  scoped_refptr<Histogram> DurationHistogram() const override;
+
+  scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const override;
+
+ private:
+  std::string LogPrefix() const;
+
+  DISALLOW_COPY_AND_ASSIGN(ExpiredRowSetGCOp);
+};
+
+// Rewrites rowsets in the fast storage tier that haven't been scanned for a
+// while to the slow tier.
+class MigrateColdRowSetsOp : public TabletOpBase {
+ public:
+  explicit MigrateColdRowSetsOp(Tablet* tablet);
+
+  // Reports the on-disk size of the cold rowsets, relative to a compaction's
+  // worth, as the performance improvement.
+  void UpdateStats(MaintenanceOpStats* stats) override;
+
+  bool Prepare() override;
+
+  void Perform() override;
+
+  scoped_refptr<Histogram> DurationHistogram() const override;
+
+  scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const override;
+
+ private:
+  std::string LogPrefix() const;
+
+  DISALLOW_COPY_AND_ASSIGN(MigrateColdRowSetsOp);
+};
+
 
 } // namespace tablet
 } // namespace kudu
@@ -20,6 +20,7 @@
 #include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
@@ -76,6 +77,7 @@
 METRIC_DECLARE_entity(tablet);
 
 DECLARE_int32(flush_threshold_mb);
+DECLARE_int32(max_replicate_batch_transactions);
 
 namespace kudu {
 namespace tablet {
@@ -96,6 +98,7 @@ using rpc::Messenger;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
 
@@ -561,6 +564,53 @@ TEST_F(TabletReplicaTest, TestActiveTransactionPreventsLogGC) {
   ASSERT_EQ(2, segments.size());
 }
 
+// Test that writes which are submitted back to back are replicated in batches,
+// including when they wait for the row locks of writes in the same batch.
+TEST_F(TabletReplicaTest, TestBatchedReplicationOfConcurrentWrites) {
+  FLAGS_max_replicate_batch_transactions = 8;
+  ConsensusBootstrapInfo info;
+  ASSERT_OK(StartReplicaAndWaitUntilLeader(info));
+
+  // Every key is inserted several times, so most writes conflict with earlier
+  // writes which may still be waiting to be replicated.
+  const int kNumKeys = 10;
+  const int kNumWrites = 100;
+  Schema schema(GetTestSchema());
+  vector<unique_ptr<WriteRequestPB>> reqs;
+  vector<unique_ptr<WriteResponsePB>> resps;
+  CountDownLatch rpc_latch(kNumWrites);
+  for (int i = 0; i < kNumWrites; i++) {
+    unique_ptr<WriteRequestPB> req(new WriteRequestPB());
+    req->set_tablet_id(tablet()->tablet_id());
+    ASSERT_OK(SchemaToPB(schema, req->mutable_schema()));
+    KuduPartialRow row(&schema);
+    ASSERT_OK(row.SetInt32("key", i % kNumKeys));
+    RowOperationsPBEncoder enc(req->mutable_row_operations());
+    enc.Add(RowOperationsPB::INSERT, row);
+
+    unique_ptr<WriteResponsePB> resp(new WriteResponsePB());
+    unique_ptr<WriteTransactionState> tx_state(
+        new WriteTransactionState(tablet_replica_.get(), req.get(), nullptr, resp.get()));
+    tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+        new LatchTransactionCompletionCallback<WriteResponsePB>(&rpc_latch, resp.get())));
+    ASSERT_OK(tablet_replica_->SubmitWrite(std::move(tx_state)));
+    reqs.emplace_back(std::move(req));
+    resps.emplace_back(std::move(resp));
+  }
+  rpc_latch.Wait();
+
+  // Each write got its own response: the first insert of each key succeeded,
+  // and the others failed on the row alone.
+  for (int i = 0; i < kNumWrites; i++) {
+    SCOPED_TRACE(i);
+    ASSERT_FALSE(resps[i]->has_error()) << SecureDebugString(*resps[i]);
+    ASSERT_EQ(i < kNumKeys ? 0 : 1, resps[i]->per_row_errors_size());
+  }
+  uint64_t num_rows;
+  ASSERT_OK(tablet()->CountRows(&num_rows));
+  ASSERT_EQ(kNumKeys, num_rows);
+}
+
 TEST_F(TabletReplicaTest, TestGCEmptyLog) {
   ConsensusBootstrapInfo info;
   ASSERT_OK(StartReplica(info));
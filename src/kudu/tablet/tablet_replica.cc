@@ -26,6 +26,8 @@
 #include <type_traits>
 #include <vector>
 
+#include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/clock/clock.h"
@@ -38,6 +40,9 @@
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/raft_consensus.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs.pb.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/port.h"
@@ -48,8 +53,11 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_replica_mm_ops.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/ingest_rowset_transaction.h"
+#include "kudu/tablet/transactions/replicate_batcher.h"
 #include "kudu/tablet/transactions/transaction_driver.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/metrics.h"
@@ -59,6 +67,13 @@
 #include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
+DEFINE_int32(max_replicate_batch_transactions, 1,
+             "The maximum number of leader write transactions of a tablet which are "
+             "replicated together when they're prepared back to back. Batching them "
+             "lets small writes share appends to the Raft queue and the WAL. "
+             "With 1, each transaction is replicated as soon as it's prepared.");
+TAG_FLAG(max_replicate_batch_transactions, experimental);
+
 METRIC_DEFINE_histogram(tablet, op_prepare_queue_length, "Operation Prepare Queue Length",
                         kudu::MetricUnit::kTasks,
                         "Number of operations waiting to be prepared within this tablet. "
@@ -102,6 +117,7 @@ using consensus::RaftConsensus;
 using consensus::RpcPeerProxyFactory;
 using consensus::TimeManager;
 using consensus::ALTER_SCHEMA_OP;
+using consensus::INGEST_ROWSET_OP;
 using consensus::WRITE_OP;
 using log::Log;
 using log::LogAnchorRegistry;
@@ -191,6 +207,13 @@ Status TabletReplica::Start(const ConsensusBootstrapInfo& bootstrap_info,
               METRIC_op_prepare_queue_time.Instantiate(metric_entity),
               METRIC_op_prepare_run_time.Instantiate(metric_entity)
           });
+      if (FLAGS_max_replicate_batch_transactions > 1) {
+        replicate_batcher_.reset(new ReplicateBatcher(consensus_.get(),
+                                                      FLAGS_max_replicate_batch_transactions));
+        ReplicateBatcher* batcher = replicate_batcher_.get();
+        tablet_->lock_manager()->set_before_wait_callback(
+            [batcher]() { batcher->NotifyBeforeWait(); });
+      }
 
       if (tablet_->metrics() != nullptr) {
         TRACE("Starting instrumentation");
@@ -209,7 +232,7 @@ Status TabletReplica::Start(const ConsensusBootstrapInfo& bootstrap_info,
       VLOG(2) << "T " << tablet_id() << " P " << consensus_->peer_uuid() << ": Peer starting";
       VLOG(2) << "RaftConfig before starting: " << SecureDebugString(consensus_->CommittedConfig());
 
-      peer_proxy_factory.reset(new RpcPeerProxyFactory(messenger_));
+      peer_proxy_factory.reset(new RpcPeerProxyFactory(messenger_, consensus_->peer_uuid()));
       time_manager.reset(new TimeManager(clock_, tablet_->mvcc_manager()->GetCleanTimestamp()));
     }
 
@@ -283,6 +306,10 @@ void TabletReplica::Stop() {
   if (prepare_pool_token_) {
     prepare_pool_token_->Shutdown();
   }
+  if (replicate_batcher_) {
+    replicate_batcher_->Flush();
+    tablet_->lock_manager()->set_before_wait_callback(nullptr);
+  }
 
   if (log_) {
     WARN_NOT_OK(log_->Close(), "Error closing the Log.");
@@ -429,18 +456,43 @@ Status TabletReplica::SubmitAlterSchema(unique_ptr<AlterSchemaTransactionState>
   return driver->ExecuteAsync();
 }
 
+Status TabletReplica::SubmitIngestRowSet(unique_ptr<IngestRowSetTransactionState> state) {
+  RETURN_NOT_OK(CheckRunning());
+
+  gscoped_ptr<IngestRowSetTransaction> transaction(
+      new IngestRowSetTransaction(std::move(state), consensus::LEADER));
+  scoped_refptr<TransactionDriver> driver;
+  RETURN_NOT_OK(NewLeaderTransactionDriver(transaction.PassAs<Transaction>(), &driver));
+  return driver->ExecuteAsync();
+}
+
 void TabletReplica::GetTabletStatusPB(TabletStatusPB* status_pb_out) const {
   DCHECK(status_pb_out != nullptr);
+  shared_ptr<RaftConsensus> consensus;
   {
     std::lock_guard<simple_spinlock> lock(lock_);
     status_pb_out->set_state(state_);
     status_pb_out->set_last_status(last_status_);
+    consensus = consensus_;
   }
   status_pb_out->set_tablet_id(meta_->tablet_id());
   status_pb_out->set_table_name(meta_->table_name());
   meta_->partition().ToPB(status_pb_out->mutable_partition());
   status_pb_out->set_tablet_data_state(meta_->tablet_data_state());
   status_pb_out->set_estimated_on_disk_size(OnDiskSize());
+  DataDirGroupPB data_dir_group;
+  if (meta_->fs_manager()->dd_manager()->GetDataDirGroupPB(meta_->tablet_id(),
+                                                           &data_dir_group).ok()) {
+    for (const auto& uuid : data_dir_group.uuids()) {
+      status_pb_out->add_data_dir_uuids(uuid);
+    }
+  }
+  if (consensus) {
+    boost::optional<OpId> committed = consensus->GetLastOpId(consensus::COMMITTED_OPID);
+    if (committed) {
+      status_pb_out->set_last_committed_op_index(committed->index());
+    }
+  }
 }
 
 Status TabletReplica::RunLogGC() {
@@ -512,6 +564,9 @@ void TabletReplica::GetInFlightTransactions(Transaction::TraceType trace_type,
         case Transaction::ALTER_SCHEMA_TXN:
           status_pb.set_tx_type(consensus::ALTER_SCHEMA_OP);
           break;
+        case Transaction::INGEST_ROWSET_TXN:
+          status_pb.set_tx_type(consensus::INGEST_ROWSET_OP);
+          break;
       }
       status_pb.set_description(driver->ToString());
       int64_t running_for_micros =
@@ -616,6 +671,17 @@ Status TabletReplica::StartFollowerTransaction(const scoped_refptr<ConsensusRoun
           new AlterSchemaTransaction(std::move(tx_state), consensus::REPLICA));
       break;
     }
+    case INGEST_ROWSET_OP:
+    {
+      DCHECK(replicate_msg->has_ingest_rowset_request()) << "INGEST_ROWSET_OP replica"
+          " transaction must receive an IngestRowSetRequestPB";
+      unique_ptr<IngestRowSetTransactionState> tx_state(
+          new IngestRowSetTransactionState(this, &replicate_msg->ingest_rowset_request(),
+                                           nullptr));
+      transaction.reset(
+          new IngestRowSetTransaction(std::move(tx_state), consensus::REPLICA));
+      break;
+    }
     default:
       LOG(FATAL) << "Unsupported Operation Type";
   }
@@ -682,7 +748,8 @@ Status TabletReplica::NewLeaderTransactionDriver(gscoped_ptr<Transaction> transa
     log_.get(),
     prepare_pool_token_.get(),
     apply_pool_,
-    &txn_order_verifier_);
+    &txn_order_verifier_,
+    replicate_batcher_.get());
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::LEADER));
   driver->swap(tx_driver);
 
@@ -697,14 +764,15 @@ Status TabletReplica::NewReplicaTransactionDriver(gscoped_ptr<Transaction> trans
     log_.get(),
     prepare_pool_token_.get(),
     apply_pool_,
-    &txn_order_verifier_);
+    &txn_order_verifier_,
+    replicate_batcher_.get());
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::REPLICA));
   driver->swap(tx_driver);
 
   return Status::OK();
 }
 
-void TabletReplica::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
+void TabletReplica::RegisterMaintenanceOps(MaintenanceManager* maint_mgr, double perf_weight) {
   // Taking state_change_lock_ ensures that we don't shut down concurrently with
   // this last start-up task.
   std::lock_guard<simple_spinlock> state_change_lock(state_change_lock_);
@@ -718,14 +786,17 @@ void TabletReplica::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
   vector<MaintenanceOp*> maintenance_ops;
 
   gscoped_ptr<MaintenanceOp> mrs_flush_op(new FlushMRSOp(this));
+  mrs_flush_op->set_perf_weight(perf_weight);
   maint_mgr->RegisterOp(mrs_flush_op.get());
   maintenance_ops.push_back(mrs_flush_op.release());
 
   gscoped_ptr<MaintenanceOp> dms_flush_op(new FlushDeltaMemStoresOp(this));
+  dms_flush_op->set_perf_weight(perf_weight);
   maint_mgr->RegisterOp(dms_flush_op.get());
   maintenance_ops.push_back(dms_flush_op.release());
 
   gscoped_ptr<MaintenanceOp> log_gc(new LogGCOp(this));
+  log_gc->set_perf_weight(perf_weight);
   maint_mgr->RegisterOp(log_gc.get());
   maintenance_ops.push_back(log_gc.release());
 
@@ -736,7 +807,7 @@ void TabletReplica::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
     maintenance_ops_.swap(maintenance_ops);
     tablet = tablet_;
   }
-  tablet->RegisterMaintenanceOps(maint_mgr);
+  tablet->RegisterMaintenanceOps(maint_mgr, perf_weight);
 }
 
 void TabletReplica::CancelMaintenanceOpsForTests() {
@@ -75,6 +75,8 @@ class ResultTracker;
 
 namespace tablet {
 class AlterSchemaTransactionState;
+class IngestRowSetTransactionState;
+class ReplicateBatcher;
 class TabletStatusPB;
 class TransactionDriver;
 class WriteTransactionState;
@@ -149,6 +151,12 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   // AlterSchema is in progress.
   Status SubmitAlterSchema(std::unique_ptr<AlterSchemaTransactionState> tx_state);
 
+  // Called by the tablet service to start an ingest rowset transaction.
+  //
+  // Like AlterSchema, the IngestRowSet operation takes the tablet component
+  // lock in exclusive mode while it checks and adds the rowset.
+  Status SubmitIngestRowSet(std::unique_ptr<IngestRowSetTransactionState> tx_state);
+
   void GetTabletStatusPB(TabletStatusPB* status_pb_out) const;
 
   // Used by consensus to create and start a new ReplicaTransaction.
@@ -272,8 +280,9 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   Status RunLogGC();
 
   // Register the maintenance ops associated with this peer's tablet, also invokes
-  // Tablet::RegisterMaintenanceOps().
-  void RegisterMaintenanceOps(MaintenanceManager* maint_mgr);
+  // Tablet::RegisterMaintenanceOps(). The perf improvement of the ops is
+  // weighted by 'perf_weight' (see MaintenanceOp::set_perf_weight()).
+  void RegisterMaintenanceOps(MaintenanceManager* maint_mgr, double perf_weight = 1.0);
 
   // Unregister the maintenance ops associated with this replica's tablet.
   void UnregisterMaintenanceOps();
@@ -366,6 +375,10 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   // Token for serial task submission to the server-wide transaction prepare pool.
   std::unique_ptr<ThreadPoolToken> prepare_pool_token_;
 
+  // Batches the replication of the leader writes, or null if each is
+  // replicated on its own.
+  std::unique_ptr<ReplicateBatcher> replicate_batcher_;
+
   scoped_refptr<clock::Clock> clock_;
 
   // List of maintenance operations for the tablet that need information that only the peer
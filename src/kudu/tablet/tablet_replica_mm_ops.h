@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -67,6 +68,14 @@ class FlushMRSOp : public MaintenanceOp {
 
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
 
+  virtual std::vector<int> DataDirs() const OVERRIDE {
+    return tablet_replica_->tablet()->DataDirs();
+  }
+
+  virtual PriorityClass priority_class() const OVERRIDE {
+    return MEMORY_CRITICAL;
+  }
+
  private:
   // Lock protecting time_since_flush_.
   mutable simple_spinlock lock_;
@@ -99,6 +108,14 @@ class FlushDeltaMemStoresOp : public MaintenanceOp {
 
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
 
+  virtual std::vector<int> DataDirs() const OVERRIDE {
+    return tablet_replica_->tablet()->DataDirs();
+  }
+
+  virtual PriorityClass priority_class() const OVERRIDE {
+    return MEMORY_CRITICAL;
+  }
+
  private:
   // Lock protecting time_since_flush_
   mutable simple_spinlock lock_;
@@ -125,6 +142,10 @@ class LogGCOp : public MaintenanceOp {
 
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
 
+  virtual PriorityClass priority_class() const OVERRIDE {
+    return ANCHOR_RELEASING;
+  }
+
  private:
   TabletReplica *const tablet_replica_;
   scoped_refptr<Histogram> log_gc_duration_;
@@ -0,0 +1,187 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tablet/transactions/ingest_rowset_transaction.h"
+
+#include <memory>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/consensus/opid.pb.h"
+#include "kudu/consensus/raft_consensus.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/error_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_replica.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/rw_semaphore.h"
+#include "kudu/util/trace.h"
+
+namespace kudu {
+namespace tablet {
+
+using consensus::CommitMsg;
+using consensus::DriverType;
+using consensus::INGEST_ROWSET_OP;
+using consensus::ReplicateMsg;
+using pb_util::SecureShortDebugString;
+using std::string;
+using std::unique_ptr;
+using strings::Substitute;
+using tserver::TabletServerErrorPB;
+
+IngestRowSetTransactionState::~IngestRowSetTransactionState() {
+}
+
+string IngestRowSetTransactionState::ToString() const {
+  return Substitute("IngestRowSetTransactionState "
+                    "[timestamp=$0, request=$1]",
+                    has_timestamp() ? timestamp().ToString() : "<unassigned>",
+                    request_ == nullptr ? "(none)" : SecureShortDebugString(*request_));
+}
+
+void IngestRowSetTransactionState::SetMvccTx(gscoped_ptr<ScopedTransaction> mvcc_tx) {
+  DCHECK(!mvcc_tx_) << "Mvcc transaction already started/set.";
+  mvcc_tx_ = std::move(mvcc_tx);
+}
+
+void IngestRowSetTransactionState::StartApplying() {
+  CHECK_NOTNULL(mvcc_tx_.get())->StartApplying();
+}
+
+void IngestRowSetTransactionState::ReleaseMvccTxn(Transaction::TransactionResult result) {
+  if (mvcc_tx_) {
+    switch (result) {
+      case Transaction::COMMITTED:
+        mvcc_tx_->Commit();
+        break;
+      case Transaction::ABORTED:
+        mvcc_tx_->Abort();
+        break;
+    }
+  }
+  mvcc_tx_.reset();
+}
+
+void IngestRowSetTransactionState::AcquireSchemaLock(rw_semaphore* l) {
+  TRACE("Acquiring schema lock in exclusive mode");
+  schema_lock_ = std::unique_lock<rw_semaphore>(*l);
+  TRACE("Acquired schema lock");
+}
+
+void IngestRowSetTransactionState::ReleaseSchemaLock() {
+  CHECK(schema_lock_.owns_lock());
+  schema_lock_ = std::unique_lock<rw_semaphore>();
+  TRACE("Released schema lock");
+}
+
+IngestRowSetTransaction::IngestRowSetTransaction(unique_ptr<IngestRowSetTransactionState> state,
+                                                 DriverType type)
+    : Transaction(state.get(), type, Transaction::INGEST_ROWSET_TXN),
+      state_(std::move(state)) {
+}
+
+void IngestRowSetTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg) {
+  replicate_msg->reset(new ReplicateMsg);
+  (*replicate_msg)->set_op_type(INGEST_ROWSET_OP);
+  (*replicate_msg)->mutable_ingest_rowset_request()->CopyFrom(*state()->request());
+}
+
+Status IngestRowSetTransaction::Prepare() {
+  TRACE("PREPARE INGEST-ROWSET: Starting");
+
+  Tablet* tablet = state_->tablet_replica()->tablet();
+  tablet->CreatePreparedIngestRowSet(state());
+
+  // Only the leader checks the op, before it's replicated: the schema lock
+  // orders it with respect to writes, so the outcome holds on every replica.
+  if (type() == consensus::LEADER) {
+    Status s = tablet->CheckPreparedIngestRowSet(state());
+    if (!s.ok()) {
+      if (s.IsInvalidArgument()) {
+        state_->completion_callback()->set_error(s, TabletServerErrorPB::MISMATCHED_SCHEMA);
+      } else {
+        state_->completion_callback()->set_error(s);
+      }
+      return s;
+    }
+  }
+
+  TRACE("PREPARE INGEST-ROWSET: finished");
+  return Status::OK();
+}
+
+Status IngestRowSetTransaction::Start() {
+  DCHECK(!state_->has_timestamp());
+  DCHECK(state_->consensus_round()->replicate_msg()->has_timestamp());
+  state_->set_timestamp(Timestamp(state_->consensus_round()->replicate_msg()->timestamp()));
+  state_->tablet_replica()->tablet()->StartTransaction(state());
+  TRACE("START. Timestamp: $0", clock::HybridClock::GetPhysicalValueMicros(state_->timestamp()));
+  return Status::OK();
+}
+
+Status IngestRowSetTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
+  TRACE("APPLY INGEST-ROWSET: Starting");
+
+  Tablet* tablet = state_->tablet_replica()->tablet();
+  Status s = tablet->IngestRowSet(state(), state_->op_id().index());
+  if (PREDICT_FALSE(!s.ok())) {
+    // The op is replicated: rather than crash the server, stop the tablet,
+    // which leaves this replica to be replaced.
+    LOG(ERROR) << Substitute("T $0: unable to ingest rowset: $1",
+                             tablet->tablet_id(), s.ToString());
+    tablet->metadata()->fs_manager()->block_manager()->error_manager()->RunErrorNotificationCb(
+        ErrorHandlerType::TABLET_FAILURE, tablet->tablet_id());
+    return s;
+  }
+
+  commit_msg->reset(new CommitMsg());
+  (*commit_msg)->set_op_type(INGEST_ROWSET_OP);
+  return Status::OK();
+}
+
+void IngestRowSetTransaction::Finish(TransactionResult result) {
+  if (PREDICT_FALSE(result == Transaction::ABORTED)) {
+    TRACE("IngestRowSetCommitCallback: transaction aborted");
+    state()->ReleaseMvccTxn(result);
+    state()->Finish();
+    return;
+  }
+
+  // The schema lock was acquired by Tablet::CreatePreparedIngestRowSet. As
+  // with alter schema, it's released only once the COMMIT message is logged.
+  state()->ReleaseMvccTxn(result);
+  state()->ReleaseSchemaLock();
+
+  DCHECK_EQ(result, Transaction::COMMITTED);
+  TRACE("IngestRowSetCommitCallback: ingested rowset is visible");
+  state()->Finish();
+}
+
+string IngestRowSetTransaction::ToString() const {
+  return Substitute("IngestRowSetTransaction [state=$0]", state_->ToString());
+}
+
+}  // namespace tablet
+}  // namespace kudu
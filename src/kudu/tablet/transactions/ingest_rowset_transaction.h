@@ -0,0 +1,139 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_INGEST_ROWSET_TRANSACTION_H_
+#define KUDU_TABLET_INGEST_ROWSET_TRANSACTION_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/tablet/transactions/transaction.h"
+#include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class rw_semaphore;
+
+namespace tablet {
+
+class ScopedTransaction;
+class TabletReplica;
+
+// Transaction Context for the IngestRowSet operation.
+// Keeps track of the Transaction states (request, result, ...)
+class IngestRowSetTransactionState : public TransactionState {
+ public:
+  ~IngestRowSetTransactionState();
+
+  IngestRowSetTransactionState(TabletReplica* tablet_replica,
+                               const tserver::IngestRowSetRequestPB* request,
+                               tserver::IngestRowSetResponsePB* response)
+      : TransactionState(tablet_replica),
+        request_(request),
+        response_(response) {
+  }
+
+  const tserver::IngestRowSetRequestPB* request() const OVERRIDE { return request_; }
+  tserver::IngestRowSetResponsePB* response() const OVERRIDE { return response_; }
+
+  // Sets the MVCC transaction of the op, started by Tablet::StartTransaction().
+  void SetMvccTx(gscoped_ptr<ScopedTransaction> mvcc_tx);
+
+  // Marks the MVCC transaction as applying.
+  void StartApplying();
+
+  // Commits or aborts the MVCC transaction, depending on 'result'.
+  void ReleaseMvccTxn(Transaction::TransactionResult result);
+
+  void AcquireSchemaLock(rw_semaphore* l);
+
+  // Release the acquired schema lock.
+  // Crashes if the lock was not already acquired.
+  void ReleaseSchemaLock();
+
+  // Note: request_ and response_ are set to NULL after this method returns.
+  void Finish() {
+    // Make the request NULL since after this transaction commits
+    // the request may be deleted at any moment.
+    request_ = NULL;
+    response_ = NULL;
+  }
+
+  virtual std::string ToString() const OVERRIDE;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(IngestRowSetTransactionState);
+
+  // The original RPC request and response.
+  const tserver::IngestRowSetRequestPB *request_;
+  tserver::IngestRowSetResponsePB *response_;
+
+  // The MVCC transaction of the op, which makes the ingested rows visible to
+  // the snapshots which include its timestamp.
+  gscoped_ptr<ScopedTransaction> mvcc_tx_;
+
+  // The lock held on the tablet's schema_lock_.
+  std::unique_lock<rw_semaphore> schema_lock_;
+};
+
+// Executes the ingest rowset transaction, which adds the rowset staged on every
+// replica with Tablet::StageRowSetForIngest() to the tablet.
+//
+// Like alter schema, it holds the tablet's schema lock in exclusive mode from
+// the end of its prepare phase until it finishes, so that it is ordered with
+// respect to writes the same way on every replica.
+class IngestRowSetTransaction : public Transaction {
+ public:
+  IngestRowSetTransaction(std::unique_ptr<IngestRowSetTransactionState> tx_state,
+                          consensus::DriverType type);
+
+  virtual IngestRowSetTransactionState* state() OVERRIDE { return state_.get(); }
+  virtual const IngestRowSetTransactionState* state() const OVERRIDE { return state_.get(); }
+
+  void NewReplicateMsg(gscoped_ptr<consensus::ReplicateMsg>* replicate_msg) OVERRIDE;
+
+  // Acquires the schema lock and, on the leader, checks that the staged
+  // rowset can be added to the tablet.
+  virtual Status Prepare() OVERRIDE;
+
+  // Starts the IngestRowSetTransaction by assigning it a timestamp and
+  // starting its MVCC transaction.
+  virtual Status Start() OVERRIDE;
+
+  // Executes an Apply for the ingest rowset transaction. If the staged rowset
+  // can't be added, the tablet replica is failed.
+  virtual Status Apply(gscoped_ptr<consensus::CommitMsg>* commit_msg) OVERRIDE;
+
+  // Actually commits the transaction.
+  virtual void Finish(TransactionResult result) OVERRIDE;
+
+  virtual std::string ToString() const OVERRIDE;
+
+ private:
+  std::unique_ptr<IngestRowSetTransactionState> state_;
+  DISALLOW_COPY_AND_ASSIGN(IngestRowSetTransaction);
+};
+
+}  // namespace tablet
+}  // namespace kudu
+
+#endif /* KUDU_TABLET_INGEST_ROWSET_TRANSACTION_H_ */
@@ -0,0 +1,97 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tablet/transactions/replicate_batcher.h"
+
+#include <glog/logging.h>
+
+#include "kudu/consensus/raft_consensus.h"
+#include "kudu/tablet/transactions/transaction_driver.h"
+#include "kudu/util/trace.h"
+
+using kudu::consensus::ConsensusRound;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+ReplicateBatcher::ReplicateBatcher(consensus::RaftConsensus* consensus, int max_batch_size)
+    : consensus_(consensus),
+      max_batch_size_(max_batch_size),
+      num_pending_prepares_(0) {
+  CHECK_GT(max_batch_size_, 0);
+}
+
+ReplicateBatcher::~ReplicateBatcher() {
+  DCHECK(batch_.empty());
+}
+
+void ReplicateBatcher::PrepareSubmitted() {
+  std::lock_guard<simple_spinlock> l(lock_);
+  num_pending_prepares_++;
+}
+
+void ReplicateBatcher::PrepareSubmitFailed() {
+  // The prepare task which failed to be submitted may have been the one the
+  // batch was waiting for.
+  PrepareFinished();
+}
+
+void ReplicateBatcher::PrepareFinished() {
+  bool flush;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    DCHECK_GT(num_pending_prepares_, 0);
+    num_pending_prepares_--;
+    flush = !batch_.empty() &&
+        (num_pending_prepares_ == 0 || batch_.size() >= static_cast<size_t>(max_batch_size_));
+  }
+  if (flush) {
+    Flush();
+  }
+}
+
+void ReplicateBatcher::Add(const scoped_refptr<TransactionDriver>& driver) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  batch_.push_back(driver);
+}
+
+void ReplicateBatcher::Flush() {
+  std::lock_guard<std::mutex> flush_lock(flush_lock_);
+  vector<scoped_refptr<TransactionDriver>> drivers;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (batch_.empty()) {
+      return;
+    }
+    drivers.swap(batch_);
+  }
+
+  vector<scoped_refptr<ConsensusRound>> rounds;
+  rounds.reserve(drivers.size());
+  for (const auto& driver : drivers) {
+    rounds.push_back(driver->mutable_state()->consensus_round());
+  }
+  TRACE("Replicating a batch of $0 transactions", rounds.size());
+  int num_replicated;
+  Status s = consensus_->ReplicateBatch(rounds, &num_replicated);
+  for (size_t i = num_replicated; i < drivers.size(); i++) {
+    drivers[i]->HandleReplicateFailure(s);
+  }
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+
+namespace kudu {
+
+namespace consensus {
+class RaftConsensus;
+}
+
+namespace tablet {
+class TransactionDriver;
+
+// Replicates the leader write transactions of a tablet which are prepared back
+// to back in batches, so that many small writes share one append to the
+// consensus queue and the WAL instead of paying for one each.
+//
+// The prepare tasks of a tablet run one at a time. Each leader write
+// transaction adds itself to the batch once it's prepared, and the batch is
+// replicated as soon as no more prepare tasks are queued, or once it reaches
+// the maximum batch size. A transaction thus never waits for a transaction
+// which arrives after it has been prepared.
+//
+// The transactions of a batch hold their row locks until they're applied, so
+// the batch is replicated before a prepare which has to wait on anything:
+// before another row lock is waited for (see NotifyBeforeWait()), and
+// before a transaction other than a leader write is prepared.
+//
+// This class is thread-safe.
+class ReplicateBatcher {
+ public:
+  ReplicateBatcher(consensus::RaftConsensus* consensus, int max_batch_size);
+  ~ReplicateBatcher();
+
+  // Counts a prepare task which is about to be submitted. Each call must be
+  // followed by one of PrepareFinished() or PrepareSubmitFailed().
+  void PrepareSubmitted();
+
+  // Stops counting a prepare task which couldn't be submitted.
+  void PrepareSubmitFailed();
+
+  // Called at the end of a counted prepare task, after its transaction was
+  // added to the batch, if at all. Replicates the batch if no more prepare
+  // tasks are queued, or if the batch is full.
+  void PrepareFinished();
+
+  // Adds the prepared and started leader transaction of 'driver' to the batch.
+  void Add(const scoped_refptr<TransactionDriver>& driver);
+
+  // Replicates the transactions of the batch, if any. The transactions which
+  // can't be replicated are failed.
+  void Flush();
+
+  // Called on an operation's prepare thread before it waits on something
+  // which may be held by a transaction of the batch.
+  void NotifyBeforeWait() { Flush(); }
+
+ private:
+  consensus::RaftConsensus* const consensus_;
+  const int max_batch_size_;
+
+  // Protects 'num_pending_prepares_' and 'batch_'.
+  simple_spinlock lock_;
+
+  // The number of counted prepare tasks which haven't finished yet.
+  int num_pending_prepares_;
+
+  // The transactions which were prepared but not replicated yet, in the
+  // order they were prepared.
+  std::vector<scoped_refptr<TransactionDriver>> batch_;
+
+  // Serializes the replication of the batches, so that they are appended to
+  // the queue in the order their transactions were assigned timestamps.
+  std::mutex flush_lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReplicateBatcher);
+};
+
+} // namespace tablet
+} // namespace kudu
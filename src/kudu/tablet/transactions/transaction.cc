@@ -76,7 +76,17 @@ TransactionMetrics::TransactionMetrics()
     successful_upserts(0),
     successful_updates(0),
     successful_deletes(0),
-    commit_wait_duration_usec(0) {
+    commit_wait_duration_usec(0),
+    rpc_queue_duration_usec(0),
+    prepare_duration_usec(0),
+    decode_duration_usec(0),
+    row_locking_duration_usec(0),
+    replication_duration_usec(0),
+    local_wal_append_duration_usec(0),
+    apply_duration_usec(0),
+    presence_check_duration_usec(0),
+    mrs_insert_duration_usec(0),
+    mutate_duration_usec(0) {
 }
 
 void TransactionMetrics::Reset() {
@@ -84,6 +94,16 @@ void TransactionMetrics::Reset() {
   successful_updates = 0;
   successful_deletes = 0;
   commit_wait_duration_usec = 0;
+  rpc_queue_duration_usec = 0;
+  prepare_duration_usec = 0;
+  decode_duration_usec = 0;
+  row_locking_duration_usec = 0;
+  replication_duration_usec = 0;
+  local_wal_append_duration_usec = 0;
+  apply_duration_usec = 0;
+  presence_check_duration_usec = 0;
+  mrs_insert_duration_usec = 0;
+  mutate_duration_usec = 0;
 }
 
 
@@ -64,6 +64,32 @@ struct TransactionMetrics {
   int successful_updates;
   int successful_deletes;
   uint64_t commit_wait_duration_usec;
+
+  // The wall time, in microseconds, a write spent in each of its phases:
+  //
+  // - rpc_queue: between the RPC being received and the write being
+  //   submitted. Only set on the leader.
+  // - prepare: preparing the write, which includes decoding its rows
+  //   ('decode') and locking them ('row_locking', which includes encoding
+  //   their keys and waiting for the locks held by other writes).
+  // - replication: between the write being submitted to consensus and a
+  //   majority of the replicas having it in their WAL, and local_wal_append,
+  //   the part of it the leader took to append it to its own WAL. Only set
+  //   on the leader.
+  // - apply: applying the write to the tablet, which includes checking the
+  //   presence of the rows' keys ('presence_check', the bloom filter and key
+  //   probes), inserting the new rows in the MemRowSet ('mrs_insert') and
+  //   mutating existing rows ('mutate', mostly DeltaMemStore updates).
+  uint64_t rpc_queue_duration_usec;
+  uint64_t prepare_duration_usec;
+  uint64_t decode_duration_usec;
+  uint64_t row_locking_duration_usec;
+  uint64_t replication_duration_usec;
+  uint64_t local_wal_append_duration_usec;
+  uint64_t apply_duration_usec;
+  uint64_t presence_check_duration_usec;
+  uint64_t mrs_insert_duration_usec;
+  uint64_t mutate_duration_usec;
 };
 
 // Base class for transactions.
@@ -76,6 +102,7 @@ class Transaction {
   enum TransactionType {
     WRITE_TXN,
     ALTER_SCHEMA_TXN,
+    INGEST_ROWSET_TXN,
   };
 
   enum TraceType {
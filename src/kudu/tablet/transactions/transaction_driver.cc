@@ -45,6 +45,7 @@
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tablet/transaction_order_verifier.h"
+#include "kudu/tablet/transactions/replicate_batcher.h"
 #include "kudu/tablet/transactions/transaction_tracker.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/logging.h"
@@ -108,14 +109,17 @@ TransactionDriver::TransactionDriver(TransactionTracker *txn_tracker,
                                      Log* log,
                                      ThreadPoolToken* prepare_pool_token,
                                      ThreadPool* apply_pool,
-                                     TransactionOrderVerifier* order_verifier)
+                                     TransactionOrderVerifier* order_verifier,
+                                     ReplicateBatcher* replicate_batcher)
     : txn_tracker_(txn_tracker),
       consensus_(consensus),
       log_(log),
       prepare_pool_token_(prepare_pool_token),
       apply_pool_(apply_pool),
       order_verifier_(order_verifier),
-      trace_(new Trace()),
+      replicate_batcher_(replicate_batcher),
+      // Follow the sampling of the trace of the request, if any.
+      trace_(new Trace(!Trace::CurrentTrace() || Trace::CurrentTrace()->sampled())),
       start_time_(MonoTime::Now()),
       replication_state_(NOT_REPLICATING),
       prepare_state_(NOT_PREPARED) {
@@ -226,8 +230,15 @@ Status TransactionDriver::ExecuteAsync() {
   }
 
   if (s.ok()) {
+    bool batched = IsReplicatedInBatch();
+    if (batched) {
+      replicate_batcher_->PrepareSubmitted();
+    }
     s = prepare_pool_token_->SubmitClosure(
       Bind(&TransactionDriver::PrepareTask, Unretained(this)));
+    if (batched && !s.ok()) {
+      replicate_batcher_->PrepareSubmitFailed();
+    }
   }
 
   if (!s.ok()) {
@@ -240,10 +251,22 @@ Status TransactionDriver::ExecuteAsync() {
 
 void TransactionDriver::PrepareTask() {
   TRACE_EVENT_FLOW_END0("txn", "PrepareTask", this);
+  // Once prepared, a batched transaction may be replicated and finished by
+  // another thread at any time, so this must not be accessed after Prepare().
+  ReplicateBatcher* batcher = IsReplicatedInBatch() ? replicate_batcher_ : nullptr;
   Status prepare_status = Prepare();
   if (PREDICT_FALSE(!prepare_status.ok())) {
     HandleFailure(prepare_status);
   }
+  if (batcher) {
+    batcher->PrepareFinished();
+  }
+}
+
+bool TransactionDriver::IsReplicatedInBatch() const {
+  return replicate_batcher_ != nullptr &&
+      transaction_->type() == consensus::LEADER &&
+      transaction_->tx_type() == Transaction::WRITE_TXN;
 }
 
 void TransactionDriver::RegisterFollowerTransactionOnResultTracker() {
@@ -278,6 +301,12 @@ Status TransactionDriver::Prepare() {
   TRACE_EVENT1("txn", "Prepare", "txn", this);
   VLOG_WITH_PREFIX(4) << "Prepare()";
 
+  // The transactions waiting to be replicated in a batch hold their row locks
+  // and the schema lock, which other kinds of transactions may wait for.
+  if (replicate_batcher_ && !IsReplicatedInBatch()) {
+    replicate_batcher_->Flush();
+  }
+
   // Actually prepare and start the transaction.
   prepare_physical_timestamp_ = GetMonoTimeMicros();
 
@@ -329,6 +358,10 @@ Status TransactionDriver::Prepare() {
         replication_start_time_ = MonoTime::Now();
       }
 
+      if (IsReplicatedInBatch()) {
+        replicate_batcher_->Add(this);
+        break;
+      }
       Status s = consensus_->Replicate(mutable_state()->consensus_round());
       if (PREDICT_FALSE(!s.ok())) {
         std::lock_guard<simple_spinlock> lock(lock_);
@@ -359,6 +392,17 @@ Status TransactionDriver::Prepare() {
   return Status::OK();
 }
 
+void TransactionDriver::HandleReplicateFailure(const Status& s) {
+  ADOPT_TRACE(trace());
+  {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    CHECK_EQ(replication_state_, REPLICATING);
+    transaction_status_ = s;
+    replication_state_ = REPLICATION_FAILED;
+  }
+  HandleFailure(s);
+}
+
 void TransactionDriver::HandleFailure(const Status& s) {
   VLOG_WITH_PREFIX(2) << "Failed transaction: " << s.ToString();
   CHECK(!s.ok());
@@ -434,6 +478,10 @@ void TransactionDriver::ReplicationFinished(const Status& status) {
   }
 
   TRACE_COUNTER_INCREMENT("replication_time_us", replication_duration.ToMicroseconds());
+  if (transaction_->type() == consensus::LEADER) {
+    mutable_state()->mutable_metrics()->replication_duration_usec =
+        replication_duration.ToMicroseconds();
+  }
 
   // If we have prepared and replicated, we're ready
   // to move ahead and apply this operation.
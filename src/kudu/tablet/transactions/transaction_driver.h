@@ -47,6 +47,7 @@ class RaftConsensus;
 }
 
 namespace tablet {
+class ReplicateBatcher;
 class TransactionOrderVerifier;
 class TransactionTracker;
 
@@ -88,6 +89,12 @@ class TransactionTracker;
 //  5 - ApplyAsync() submits ApplyTask() to the apply_pool_.
 //      ApplyTask() calls transaction_->Apply().
 //
+//      Unlike prepares, applies are not serialized per tablet: the apply_pool_
+//      is shared by all tablets and its tasks aren't submitted through a token,
+//      so transactions of the same tablet (which hold their row locks until
+//      they are finalized) are applied concurrently. MVCC tracks each one's
+//      commit separately, so they may finish in any order.
+//
 //      When Apply() is called, changes are made to the in-memory data structures. These
 //      changes are not visible to clients yet. After Apply() completes, a CommitMsg
 //      is enqueued to the WAL in order to store information about the operation result
@@ -108,7 +115,7 @@ class TransactionTracker;
 //
 // On the leader side, starting the mvcc transaction for writes
 // (calling tablet_->StartTransaction()) must always be done _after_ any relevant row locks are
-// acquired (using AcquireLockForOp). This ensures that, within each row, timestamps only move
+// acquired (using AcquireRowLocks). This ensures that, within each row, timestamps only move
 // forward. If we took a timestamp before getting the row lock, we could have the following
 // situation:
 //
@@ -230,7 +237,8 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
                     log::Log* log,
                     ThreadPoolToken* prepare_pool_token,
                     ThreadPool* apply_pool,
-                    TransactionOrderVerifier* order_verifier);
+                    TransactionOrderVerifier* order_verifier,
+                    ReplicateBatcher* replicate_batcher);
 
   // Perform any non-constructor initialization. Sets the transaction
   // that will be executed.
@@ -280,6 +288,7 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
  private:
   FRIEND_TEST(TabletReplicaTest, TestShuttingDownMVCC);
   friend class RefCountedThreadSafe<TransactionDriver>;
+  friend class ReplicateBatcher;
   enum ReplicationState {
     // The operation has not yet been sent to consensus for replication
     NOT_REPLICATING,
@@ -311,6 +320,14 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   // Actually prepare.
   Status Prepare();
 
+  // Whether the transaction is replicated by 'replicate_batcher_' once it's
+  // prepared, rather than on its own.
+  bool IsReplicatedInBatch() const;
+
+  // Handles a failure to submit the transaction for replication, once it was
+  // marked as REPLICATING.
+  void HandleReplicateFailure(const Status& s);
+
   // Submits ApplyTask to the apply pool.
   Status ApplyAsync();
 
@@ -356,6 +373,9 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   ThreadPoolToken* const prepare_pool_token_;
   ThreadPool* const apply_pool_;
   TransactionOrderVerifier* const order_verifier_;
+  // May be null, in which case every leader transaction is replicated as
+  // soon as it's prepared.
+  ReplicateBatcher* const replicate_batcher_;
 
   Status transaction_status_;
 
@@ -61,6 +61,10 @@ METRIC_DEFINE_gauge_uint64(tablet, alter_schema_transactions_inflight,
                            "Alter Schema Transactions In Flight",
                            kudu::MetricUnit::kTransactions,
                            "Number of alter schema transactions currently in-flight");
+METRIC_DEFINE_gauge_uint64(tablet, ingest_rowset_transactions_inflight,
+                           "Ingest RowSet Transactions In Flight",
+                           kudu::MetricUnit::kTransactions,
+                           "Number of ingest rowset transactions currently in-flight");
 
 METRIC_DEFINE_counter(tablet, transaction_memory_pressure_rejections,
                       "Transaction Memory Pressure Rejections",
@@ -83,6 +87,7 @@ TransactionTracker::Metrics::Metrics(const scoped_refptr<MetricEntity>& entity)
     : GINIT(all_transactions_inflight),
       GINIT(write_transactions_inflight),
       GINIT(alter_schema_transactions_inflight),
+      GINIT(ingest_rowset_transactions_inflight),
       MINIT(transaction_memory_pressure_rejections) {
 }
 #undef GINIT
@@ -147,6 +152,9 @@ void TransactionTracker::IncrementCounters(const TransactionDriver& driver) cons
     case Transaction::ALTER_SCHEMA_TXN:
       metrics_->alter_schema_transactions_inflight->Increment();
       break;
+    case Transaction::INGEST_ROWSET_TXN:
+      metrics_->ingest_rowset_transactions_inflight->Increment();
+      break;
   }
 }
 
@@ -166,6 +174,10 @@ void TransactionTracker::DecrementCounters(const TransactionDriver& driver) cons
       DCHECK_GT(metrics_->alter_schema_transactions_inflight->value(), 0);
       metrics_->alter_schema_transactions_inflight->Decrement();
       break;
+    case Transaction::INGEST_ROWSET_TXN:
+      DCHECK_GT(metrics_->ingest_rowset_transactions_inflight->value(), 0);
+      metrics_->ingest_rowset_transactions_inflight->Decrement();
+      break;
   }
 }
 
@@ -53,6 +53,7 @@
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/rw_semaphore.h"
 #include "kudu/util/trace.h"
@@ -77,9 +78,28 @@ using consensus::DriverType;
 using consensus::ReplicateMsg;
 using consensus::WRITE_OP;
 using tserver::TabletServerErrorPB;
+using tserver::WriteLatencyBreakdownPB;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
 
+namespace {
+
+void ToLatencyBreakdownPB(const TransactionMetrics& metrics, WriteLatencyBreakdownPB* pb) {
+  pb->set_rpc_queue_micros(metrics.rpc_queue_duration_usec);
+  pb->set_prepare_micros(metrics.prepare_duration_usec);
+  pb->set_decode_micros(metrics.decode_duration_usec);
+  pb->set_row_locking_micros(metrics.row_locking_duration_usec);
+  pb->set_replication_micros(metrics.replication_duration_usec);
+  pb->set_local_wal_append_micros(metrics.local_wal_append_duration_usec);
+  pb->set_apply_micros(metrics.apply_duration_usec);
+  pb->set_presence_check_micros(metrics.presence_check_duration_usec);
+  pb->set_mrs_insert_micros(metrics.mrs_insert_duration_usec);
+  pb->set_mutate_micros(metrics.mutate_duration_usec);
+  pb->set_commit_wait_micros(metrics.commit_wait_duration_usec);
+}
+
+} // anonymous namespace
+
 WriteTransaction::WriteTransaction(unique_ptr<WriteTransactionState> state, DriverType type)
   : Transaction(state.get(), type, Transaction::WRITE_TXN),
   state_(std::move(state)) {
@@ -98,6 +118,8 @@ void WriteTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg)
 Status WriteTransaction::Prepare() {
   TRACE_EVENT0("txn", "WriteTransaction::Prepare");
   TRACE("PREPARE: Starting");
+  const MonoTime prepare_start = MonoTime::Now();
+  TransactionMetrics* tx_metrics = state_->mutable_metrics();
   // Decode everything first so that we give up if something major is wrong.
   Schema client_schema;
   RETURN_NOT_OK_PREPEND(SchemaFromPB(state_->request()->schema(), &client_schema),
@@ -118,9 +140,14 @@ Status WriteTransaction::Prepare() {
     state()->completion_callback()->set_error(s, TabletServerErrorPB::MISMATCHED_SCHEMA);
     return s;
   }
+  const MonoTime decoded = MonoTime::Now();
+  tx_metrics->decode_duration_usec = (decoded - prepare_start).ToMicroseconds();
 
   // Now acquire row locks and prepare everything for apply
   RETURN_NOT_OK(tablet->AcquireRowLocks(state()));
+  const MonoTime prepared = MonoTime::Now();
+  tx_metrics->row_locking_duration_usec = (prepared - decoded).ToMicroseconds();
+  tx_metrics->prepare_duration_usec = (prepared - prepare_start).ToMicroseconds();
 
   TRACE("PREPARE: finished.");
   return Status::OK();
@@ -154,6 +181,7 @@ Status WriteTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
     SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_inject_latency_on_apply_write_txn_ms));
   }
 
+  const MonoTime apply_start = MonoTime::Now();
   Tablet* tablet = state()->tablet_replica()->tablet();
   RETURN_NOT_OK(tablet->ApplyRowOperations(state()));
 
@@ -177,12 +205,27 @@ Status WriteTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
   state()->ReleaseTxResultPB((*commit_msg)->mutable_result());
   (*commit_msg)->set_op_type(WRITE_OP);
 
+  state_->mutable_metrics()->apply_duration_usec =
+      (MonoTime::Now() - apply_start).ToMicroseconds();
+
   return Status::OK();
 }
 
 void WriteTransaction::Finish(TransactionResult result) {
   TRACE_EVENT0("txn", "WriteTransaction::Finish");
 
+  // The request and response are detached from the transaction when it
+  // commits, so the latency breakdown is set in the response beforehand.
+  if (result == Transaction::COMMITTED && type() == consensus::LEADER) {
+    MonoDelta local_append = state_->consensus_round()->local_append_duration();
+    if (local_append.Initialized()) {
+      state_->mutable_metrics()->local_wal_append_duration_usec = local_append.ToMicroseconds();
+    }
+    if (state_->request()->report_latency_breakdown()) {
+      ToLatencyBreakdownPB(state_->metrics(), state_->response()->mutable_latency_breakdown());
+    }
+  }
+
   state()->CommitOrAbort(result);
 
   if (PREDICT_FALSE(result == Transaction::ABORTED)) {
@@ -203,7 +246,21 @@ void WriteTransaction::Finish(TransactionResult result) {
     metrics->rows_updated->IncrementBy(state_->metrics().successful_updates);
     metrics->rows_deleted->IncrementBy(state_->metrics().successful_deletes);
 
+    const TransactionMetrics& tx_metrics = state_->metrics();
+    metrics->write_op_prepare_duration->Increment(tx_metrics.prepare_duration_usec);
+    metrics->write_op_decode_duration->Increment(tx_metrics.decode_duration_usec);
+    metrics->write_op_row_locking_duration->Increment(tx_metrics.row_locking_duration_usec);
+    metrics->write_op_apply_duration->Increment(tx_metrics.apply_duration_usec);
+    metrics->write_op_presence_check_duration->Increment(
+        tx_metrics.presence_check_duration_usec);
+    metrics->write_op_mrs_insert_duration->Increment(tx_metrics.mrs_insert_duration_usec);
+    metrics->write_op_mutate_duration->Increment(tx_metrics.mutate_duration_usec);
+
     if (type() == consensus::LEADER) {
+      metrics->write_op_rpc_queue_duration->Increment(tx_metrics.rpc_queue_duration_usec);
+      metrics->write_op_replication_duration->Increment(tx_metrics.replication_duration_usec);
+      metrics->write_op_local_wal_append_duration->Increment(
+          tx_metrics.local_wal_append_duration_usec);
       if (state()->external_consistency_mode() == COMMIT_WAIT) {
         metrics->commit_wait_duration->Increment(state_->metrics().commit_wait_duration_usec);
       }
@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -81,6 +82,11 @@ TEST(DiagLogParserTest, TestParseLine) {
     ASSERT_OK(pl.Parse(line));
     ASSERT_EQ(RecordType::kSymbols, pl.type());
 
+    line = "I0220 17:38:09.950546 cpu_profile 1519177089950546 {\"foo\" : \"bar\"}";
+    ASSERT_OK(pl.Parse(line));
+    ASSERT_EQ(RecordType::kCpuProfile, pl.type());
+    ASSERT_EQ(1519177089950546, pl.timestamp_us());
+
     line = "I0220 17:38:09.950546 metrics 1519177089950546 {\"foo\" : \"bar\"}";
     ASSERT_OK(pl.Parse(line));
     ASSERT_EQ(RecordType::kUnknown, pl.type());
@@ -122,6 +128,8 @@ class TestSymbolsLogVisitor : public LogVisitor {
 
   void VisitStacksRecord(const StacksRecord& /*sr*/) override {}
 
+  void VisitCpuProfileRecord(const CpuProfileRecord& /*cpr*/) override {}
+
   string addr_;
   string symbol_;
 };
@@ -150,6 +158,7 @@ class NoopLogVisitor : public LogVisitor {
  public:
   void VisitSymbol(const string& /*addr*/, const string& /*symbol*/) override {}
   void VisitStacksRecord(const StacksRecord& /*sr*/) override {}
+  void VisitCpuProfileRecord(const CpuProfileRecord& /*cpr*/) override {}
 };
 
 // For parsing stacks, we'll check for success or error only. The parse_stacks
@@ -232,5 +241,61 @@ TEST(DiagLogParserTest, TestParseStacks) {
   ASSERT_OK(lp.ParseLine(line));
 }
 
+TEST(DiagLogParserTest, TestParseCpuProfile) {
+  NoopLogVisitor lv;
+  LogParser lp(&lv);
+
+  string line = "I0220 17:38:09.950546 cpu_profile 1519177089950546 "
+                "{\"end_us\" : 2, \"samples\" : 0, \"stacks\" : []}";
+  Status s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected cpu_profile 'start_us' field to be an integer");
+
+  line = "I0220 17:38:09.950546 cpu_profile 1519177089950546 "
+         "{\"start_us\" : 1, \"end_us\" : 2, \"samples\" : 0}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected cpu_profile 'stacks' field to be an array");
+
+  line = "I0220 17:38:09.950546 cpu_profile 1519177089950546 "
+         "{\"start_us\" : 1, \"end_us\" : 2, \"samples\" : 1, "
+         "\"stacks\" : [{\"stack\" : []}]}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected cpu_profile stacks to have counts and frames");
+
+  line = "I0220 17:38:09.950546 cpu_profile 1519177089950546 "
+         "{\"start_us\" : 1, \"end_us\" : 2, \"samples\" : 1, "
+         "\"stacks\" : [{\"count\" : 1, \"stack\" : [5]}]}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected 'stack' elements to be strings");
+}
+
+// The flame graph visitor folds the stacks of the profiles within its time
+// window, root first, symbolizing the frames it has symbols for.
+TEST(DiagLogParserTest, TestFlameGraph) {
+  FlameGraphLogVisitor lv(100, 200);
+  LogParser lp(&lv);
+  ASSERT_OK(lp.ParseLine("I0220 17:38:09.950546 symbols 1519177089950546 "
+                         "{\"0x1\" : \"inner\", \"0x3\" : \"main\"}"));
+  // Overlaps the window: included.
+  ASSERT_OK(lp.ParseLine("I0220 17:38:09.950546 cpu_profile 1519177089950546 "
+                         "{\"start_us\" : 50, \"end_us\" : 150, \"samples\" : 5, "
+                         "\"stacks\" : [{\"count\" : 3, \"stack\" : [\"0x1\", \"0x2\", \"0x3\"]},"
+                         "               {\"count\" : 2, \"stack\" : [\"0x3\"]}]}"));
+  ASSERT_OK(lp.ParseLine("I0220 17:38:09.950546 cpu_profile 1519177089950546 "
+                         "{\"start_us\" : 150, \"end_us\" : 250, \"samples\" : 1, "
+                         "\"stacks\" : [{\"count\" : 1, \"stack\" : [\"0x3\"]}]}"));
+  // After the window: excluded.
+  ASSERT_OK(lp.ParseLine("I0220 17:38:09.950546 cpu_profile 1519177089950546 "
+                         "{\"start_us\" : 250, \"end_us\" : 350, \"samples\" : 1, "
+                         "\"stacks\" : [{\"count\" : 7, \"stack\" : [\"0x1\"]}]}"));
+  std::ostringstream out;
+  lv.DumpFoldedStacks(&out);
+  ASSERT_EQ("main 3\n"
+            "main;0x2;inner 3\n", out.str());
+}
+
 } // namespace tools
 } // namespace kudu
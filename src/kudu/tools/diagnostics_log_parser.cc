@@ -17,10 +17,12 @@
 
 #include "kudu/tools/diagnostics_log_parser.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <string>
 #include <utility>
 
@@ -52,6 +54,7 @@ const char* RecordTypeToString(RecordType r) {
   switch (r) {
     case RecordType::kStacks: return "stacks"; break;
     case RecordType::kSymbols: return "symbols"; break;
+    case RecordType::kCpuProfile: return "cpu_profile"; break;
     case RecordType::kUnknown: return "<unknown>"; break;
   }
   return "<unreachable>";
@@ -85,6 +88,39 @@ void StackDumpingLogVisitor::VisitStacksRecord(const StacksRecord& sr) {
   }
 }
 
+void FlameGraphLogVisitor::VisitSymbol(const string& addr, const string& symbol) {
+  InsertIfNotPresent(&symbols_, addr, symbol);
+}
+
+void FlameGraphLogVisitor::VisitCpuProfileRecord(const CpuProfileRecord& cpr) {
+  if (cpr.end_us < start_us_ || cpr.start_us > end_us_) {
+    return;
+  }
+  for (const auto& stack : cpr.stacks) {
+    // The frames are logged innermost first, but folded stacks start from
+    // the root. Unknown symbols are left as addresses so that distinct
+    // frames aren't merged.
+    string folded;
+    for (auto it = stack.frame_addrs.rbegin(); it != stack.frame_addrs.rend(); ++it) {
+      if (!folded.empty()) {
+        folded.push_back(';');
+      }
+      const string* sym = FindOrNull(symbols_, *it);
+      // Semicolons separate the frames, so they can't appear in the symbols.
+      string frame = sym ? *sym : *it;
+      std::replace(frame.begin(), frame.end(), ';', ':');
+      folded.append(frame);
+    }
+    folded_stacks_[folded] += stack.count;
+  }
+}
+
+void FlameGraphLogVisitor::DumpFoldedStacks(std::ostream* out) const {
+  for (const auto& e : folded_stacks_) {
+    *out << e.first << " " << e.second << endl;
+  }
+}
+
 Status ParsedLine::Parse(string line) {
   // Take ownership of the line to avoid copying substrings.
   line_ = std::move(line);
@@ -101,9 +137,7 @@ Status ParsedLine::Parse(string line) {
       line_, strings::delimiter::Limit(" ", 4));
   fields[0].remove_prefix(1); // Remove the 'I'.
   // Sanity check the microsecond timestamp.
-  // Eventually, it should be used when processing metrics records.
-  int64_t time_us;
-  if (!safe_strto64(fields[3].data(), fields[3].size(), &time_us)) {
+  if (!safe_strto64(fields[3].data(), fields[3].size(), &timestamp_us_)) {
     return Status::InvalidArgument("invalid timestamp", fields[3]);
   }
   // TODO(todd) JsonReader should be able to parse from a StringPiece
@@ -120,6 +154,8 @@ Status ParsedLine::Parse(string line) {
     type_ = RecordType::kSymbols;
   } else if (fields[2] == "stacks") {
     type_ = RecordType::kStacks;
+  } else if (fields[2] == "cpu_profile") {
+    type_ = RecordType::kCpuProfile;
   } else {
     type_ = RecordType::kUnknown;
   }
@@ -145,6 +181,9 @@ Status LogParser::ParseLine(string line) {
       RETURN_NOT_OK(ParseStacks(pl));
       break;
     }
+    case RecordType::kCpuProfile:
+      RETURN_NOT_OK(ParseCpuProfile(pl));
+      break;
     default:
       break;
   }
@@ -248,6 +287,60 @@ Status LogParser::ParseStacks(const ParsedLine& pl) {
   return Status::OK();
 }
 
+Status LogParser::ParseCpuProfile(const ParsedLine& pl) {
+  CpuProfileRecord cpr;
+  cpr.date_time = pl.date_time();
+
+  const rapidjson::Value& json = *pl.json();
+  if (!json.IsObject()) {
+    return Status::InvalidArgument("expected cpu_profile data to be a JSON object");
+  }
+  for (const char* field : { "start_us", "end_us", "samples" }) {
+    if (PREDICT_FALSE(!json.HasMember(field) || !json[field].IsInt64())) {
+      return Status::InvalidArgument(
+          Substitute("expected cpu_profile '$0' field to be an integer", field));
+    }
+  }
+  cpr.start_us = json["start_us"].GetInt64();
+  cpr.end_us = json["end_us"].GetInt64();
+  cpr.num_samples = json["samples"].GetInt64();
+
+  if (PREDICT_FALSE(!json.HasMember("stacks") || !json["stacks"].IsArray())) {
+    return Status::InvalidArgument("expected cpu_profile 'stacks' field to be an array");
+  }
+  const auto& stacks = json["stacks"];
+  cpr.stacks.reserve(stacks.Size());
+  for (const auto* stack_json = stacks.Begin();
+       stack_json != stacks.End();
+       ++stack_json) {
+    if (PREDICT_FALSE(!stack_json->IsObject() ||
+                      !stack_json->HasMember("count") ||
+                      !stack_json->HasMember("stack"))) {
+      return Status::InvalidArgument("expected cpu_profile stacks to have counts and frames");
+    }
+    const auto& count = (*stack_json)["count"];
+    const auto& frames = (*stack_json)["stack"];
+    if (PREDICT_FALSE(!count.IsInt64() || !frames.IsArray())) {
+      return Status::InvalidArgument(
+          "expected cpu_profile 'count' to be an integer and 'stack' an array");
+    }
+    CpuProfileRecord::Stack stack;
+    stack.count = count.GetInt64();
+    stack.frame_addrs.reserve(frames.Size());
+    for (const auto* frame = frames.Begin();
+         frame != frames.End();
+         ++frame) {
+      if (PREDICT_FALSE(!frame->IsString())) {
+        return Status::InvalidArgument("expected 'stack' elements to be strings");
+      }
+      stack.frame_addrs.emplace_back(frame->GetString());
+    }
+    cpr.stacks.emplace_back(std::move(stack));
+  }
+  visitor_->VisitCpuProfileRecord(cpr);
+  return Status::OK();
+}
+
 } // namespace tools
 } // namespace kudu
 
@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -38,6 +40,7 @@ namespace tools {
 enum class RecordType {
   kSymbols,
   kStacks,
+  kCpuProfile,
   kUnknown
 };
 
@@ -65,12 +68,37 @@ struct StacksRecord {
   std::vector<Group> groups;
 };
 
+// A CPU profile from the log: the stack traces of the threads which were
+// sampled while on CPU, aggregated over a period of time.
+struct CpuProfileRecord {
+  struct Stack {
+    // The number of samples with this stack trace.
+    int64_t count;
+    // The non-symbolized addresses forming the stack trace, innermost first.
+    std::vector<std::string> frame_addrs;
+  };
+
+  // The time the profile was logged.
+  std::string date_time;
+
+  // The period over which the samples were collected, in microseconds since
+  // the Unix epoch.
+  int64_t start_us;
+  int64_t end_us;
+
+  // The total number of samples.
+  int64_t num_samples;
+
+  std::vector<Stack> stacks;
+};
+
 // Interface for consuming the parsed records from a diagnostics log.
 class LogVisitor {
  public:
   virtual ~LogVisitor() {}
   virtual void VisitSymbol(const std::string& addr, const std::string& symbol) = 0;
   virtual void VisitStacksRecord(const StacksRecord& sr) = 0;
+  virtual void VisitCpuProfileRecord(const CpuProfileRecord& cpr) = 0;
 };
 
 // LogVisitor implementation which dumps the parsed stack records to cout.
@@ -80,6 +108,8 @@ class StackDumpingLogVisitor : public LogVisitor {
 
   void VisitStacksRecord(const StacksRecord& sr) override;
 
+  void VisitCpuProfileRecord(const CpuProfileRecord& /*cpr*/) override {}
+
  private:
   // True when we have not yet output any data.
   bool first_ = true;
@@ -89,6 +119,41 @@ class StackDumpingLogVisitor : public LogVisitor {
   const std::string kUnknownSymbol = "<unknown>";
 };
 
+// LogVisitor implementation which aggregates the CPU profiles collected
+// within a time window into "folded" stacks: one line per distinct stack
+// trace, with the symbolized frames from the outermost to the innermost
+// separated by semicolons, followed by the number of samples. This is the
+// input format of the common flame graph tools, e.g. flamegraph.pl.
+class FlameGraphLogVisitor : public LogVisitor {
+ public:
+  // Only the profiles which overlap [start_us, end_us] are included. Since
+  // the samples of a profile are not timestamped individually, the window is
+  // effectively widened to the boundaries of the profiles.
+  FlameGraphLogVisitor(int64_t start_us, int64_t end_us)
+      : start_us_(start_us),
+        end_us_(end_us) {
+  }
+
+  void VisitSymbol(const std::string& addr, const std::string& symbol) override;
+
+  void VisitStacksRecord(const StacksRecord& /*sr*/) override {}
+
+  void VisitCpuProfileRecord(const CpuProfileRecord& cpr) override;
+
+  // Writes the folded stacks aggregated so far to 'out'.
+  void DumpFoldedStacks(std::ostream* out) const;
+
+ private:
+  const int64_t start_us_;
+  const int64_t end_us_;
+
+  // Map from symbols to name.
+  std::unordered_map<std::string, std::string> symbols_;
+
+  // Map from folded stacks to their number of samples.
+  std::map<std::string, int64_t> folded_stacks_;
+};
+
 // A parsed line from the diagnostics log.
 //
 // Each line contains a timestamp, a record type, and some JSON data.
@@ -106,10 +171,15 @@ class ParsedLine {
 
   std::string date_time() const;
 
+  int64_t timestamp_us() const { return timestamp_us_; }
+
  private:
   std::string line_;
   RecordType type_;
 
+  // The microsecond timestamp of the line.
+  int64_t timestamp_us_;
+
   // date_ and time_ point to substrings of line_.
   StringPiece date_;
   StringPiece time_;
@@ -141,6 +211,8 @@ class LogParser {
 
   Status ParseStacks(const ParsedLine& lf);
 
+  Status ParseCpuProfile(const ParsedLine& pl);
+
   LogVisitor* visitor_;
 };
 
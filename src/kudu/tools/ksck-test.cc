@@ -46,6 +46,7 @@
 #include "kudu/tools/ksck_checksum.h"
 #include "kudu/tools/ksck_results.h"
 #include "kudu/util/jsonreader.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
@@ -53,6 +54,9 @@
 
 DECLARE_bool(checksum_scan);
 DECLARE_int32(checksum_idle_timeout_sec);
+DECLARE_int32(checksum_scan_concurrency);
+DECLARE_int32(checksum_scan_concurrency_per_data_dir);
+DECLARE_string(checksum_checkpoint_file);
 DECLARE_int32(max_progress_report_wait_ms);
 DECLARE_string(color);
 DECLARE_string(ksck_format);
@@ -155,6 +159,7 @@ class MockKsckTabletServer : public KsckTabletServer {
       const Schema& /*schema*/,
       const KsckChecksumOptions& /*options*/,
       shared_ptr<KsckChecksumManager> manager) override {
+    checksum_scans_started_++;
     manager->ReportProgress(checksum_progress_, 2 * checksum_progress_);
     if (checksum_progress_ > 0) {
       manager->ReportResult(tablet_id, uuid_, Status::OK(), checksum_);
@@ -173,8 +178,11 @@ class MockKsckTabletServer : public KsckTabletServer {
   // The fake progress amount for this mock server, used to mock checksum
   // progress for this server.
   int64_t checksum_progress_ = 10;
+  // The number of checksum scans started on this mock server.
+  int checksum_scans_started_ = 0;
   using KsckTabletServer::flags_;
   using KsckTabletServer::location_;
+  using KsckTabletServer::tablet_status_map_;
   using KsckTabletServer::version_;
 
  private:
@@ -1540,6 +1548,85 @@ TEST_F(KsckTest, TestChecksumScanMismatch) {
                       "checksum mismatches");
 }
 
+// Test that tablets whose replicas haven't committed any operation since they
+// were last verified aren't checksummed again.
+TEST_F(KsckTest, TestChecksumScanCheckpoint) {
+  CreateOneSmallReplicatedTable();
+  FLAGS_checksum_scan = true;
+  FLAGS_checksum_checkpoint_file = JoinPathSegments(test_dir_, "checkpoint");
+
+  vector<shared_ptr<MockKsckTabletServer>> tservers;
+  for (const auto& entry : cluster_->tablet_servers_) {
+    auto ts = static_pointer_cast<MockKsckTabletServer>(entry.second);
+    for (auto& status : ts->tablet_status_map_) {
+      status.second.set_last_committed_op_index(10);
+    }
+    tservers.push_back(std::move(ts));
+  }
+  const auto scans_started = [&]() {
+    int num_scans = 0;
+    for (auto& ts : tservers) {
+      num_scans += ts->checksum_scans_started_;
+      ts->checksum_scans_started_ = 0;
+    }
+    return num_scans;
+  };
+
+  // The first checksum scans every replica and records the results.
+  ASSERT_OK(RunKsck());
+  ASSERT_EQ(9, scans_started());
+
+  // Nothing changed, so nothing is scanned, and the recorded checksums are
+  // reported.
+  ASSERT_OK(RunKsck());
+  ASSERT_EQ(0, scans_started());
+  ASSERT_STR_CONTAINS(err_stream_.str(),
+                      "Skipping checksums of 3 tablet(s) unchanged since their "
+                      "replicas were last verified");
+  ASSERT_EQ(3, ksck_->results().checksum_results.tables.at("test").size());
+
+  // Once a replica commits an operation its tablet is checksummed again.
+  auto& status = FindOrDie(tservers[0]->tablet_status_map_, "tablet-id-0");
+  status.set_last_committed_op_index(11);
+  ASSERT_OK(RunKsck());
+  ASSERT_EQ(3, scans_started());
+
+  // Tablets whose replicas mismatch aren't recorded, so they're checksummed
+  // every time.
+  status.set_last_committed_op_index(12);
+  tservers[0]->checksum_ = 1;
+  ASSERT_TRUE(RunKsck().IsRuntimeError());
+  ASSERT_EQ(3, scans_started());
+  ASSERT_TRUE(RunKsck().IsRuntimeError());
+  ASSERT_EQ(3, scans_started());
+}
+
+// Test that a checksum scan limited per data directory checksums every replica.
+TEST_F(KsckTest, TestChecksumScanConcurrencyPerDataDir) {
+  CreateOneSmallReplicatedTable();
+  FLAGS_checksum_scan = true;
+  FLAGS_checksum_scan_concurrency = 1;
+  FLAGS_checksum_scan_concurrency_per_data_dir = 1;
+
+  // Spread the replicas of each tablet server across two data directories.
+  int num_replicas = 0;
+  for (const auto& entry : cluster_->tablet_servers_) {
+    auto ts = static_pointer_cast<MockKsckTabletServer>(entry.second);
+    int i = 0;
+    for (auto& status : ts->tablet_status_map_) {
+      status.second.add_data_dir_uuids(Substitute("dir-$0", i++ % 2));
+    }
+    num_replicas += ts->tablet_status_map_.size();
+  }
+
+  ASSERT_OK(RunKsck());
+  int num_scans = 0;
+  for (const auto& entry : cluster_->tablet_servers_) {
+    num_scans += static_pointer_cast<MockKsckTabletServer>(entry.second)->checksum_scans_started_;
+  }
+  ASSERT_EQ(num_replicas, num_scans);
+}
+
 TEST_F(KsckTest, TestChecksumScanIdleTimeout) {
   CreateOneTableOneTablet();
   FLAGS_checksum_scan = true;
@@ -36,18 +36,24 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/periodic.h"
 #include "kudu/tools/ksck.h"
+#include "kudu/tablet/tablet.pb.h"
 #include "kudu/tools/tool_action_common.h"
+#include "kudu/util/env.h"
 #include "kudu/util/fault_injection.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/threadpool.h"
 
 using std::endl;
+using std::map;
 using std::ostream;
 using std::shared_ptr;
 using std::string;
@@ -63,6 +69,20 @@ DEFINE_int32(checksum_timeout_sec, 24 * 60 * 60,
              "before timing out.");
 DEFINE_int32(checksum_scan_concurrency, 4,
              "Number of concurrent checksum scans to execute per tablet server.");
+DEFINE_int32(checksum_scan_concurrency_per_data_dir, 0,
+             "If positive, the number of concurrent checksum scans to execute "
+             "per data directory of a tablet server. Each tablet server then "
+             "executes up to this many scans for each of its data directories, "
+             "or --checksum_scan_concurrency scans if that is more, and no data "
+             "directory is read by more than this many scans at once.");
+TAG_FLAG(checksum_scan_concurrency_per_data_dir, advanced);
+DEFINE_string(checksum_checkpoint_file, "",
+              "Path of a file in which to record the tablets whose replicas were "
+              "verified to match. A tablet recorded there is not checksummed "
+              "again unless one of its replicas committed an operation since, "
+              "so that an interrupted checksum resumes where it left off and "
+              "repeated checksums only scan the tablets that changed. Not used "
+              "when --checksum_snapshot_timestamp is set.");
 DEFINE_int32(max_progress_report_wait_ms, 5000,
              "Maximum number of milliseconds to wait between progress reports. "
              "Used to speed up tests.");
@@ -162,32 +182,121 @@ KsckChecksumOptions::KsckChecksumOptions(MonoDelta timeout,
     : timeout(timeout),
       idle_timeout(idle_timeout),
       scan_concurrency(scan_concurrency),
+      scan_concurrency_per_data_dir(FLAGS_checksum_scan_concurrency_per_data_dir),
       use_snapshot(use_snapshot),
       snapshot_timestamp(snapshot_timestamp),
       table_filters(std::move(table_filters)),
-      tablet_id_filters(std::move(tablet_id_filters)) {}
+      tablet_id_filters(std::move(tablet_id_filters)),
+      checkpoint_path(FLAGS_checksum_checkpoint_file) {}
+
+Status ReadChecksumCheckpoint(Env* env, const string& path,
+                              ChecksumCheckpoint* checkpoint) {
+  CHECK(checkpoint);
+  checkpoint->clear();
+  if (!env->FileExists(path)) {
+    return Status::OK();
+  }
+  faststring contents;
+  RETURN_NOT_OK(ReadFileToString(env, path, &contents));
+
+  // Each line is of the form
+  //   <tablet id> <checksum> <replica uuid>:<op index> [<replica uuid>:<op index>...]
+  ChecksumCheckpoint checkpoint_tmp;
+  vector<string> lines = strings::Split(contents.ToString(), "\n", strings::SkipEmpty());
+  for (const auto& line : lines) {
+    if (line[0] == '#') continue;
+    const auto corruption = [&]() {
+      return Status::Corruption(Substitute("malformed line in checksum checkpoint $0", path),
+                                line);
+    };
+    vector<string> fields = strings::Split(line, " ", strings::SkipEmpty());
+    ChecksumCheckpointEntry entry;
+    if (fields.size() < 3 || !safe_strtou64(fields[1], &entry.checksum)) {
+      return corruption();
+    }
+    for (size_t i = 2; i < fields.size(); i++) {
+      vector<string> replica = strings::Split(fields[i], ":");
+      int64_t op_index;
+      if (replica.size() != 2 || !safe_strto64(replica[1], &op_index) ||
+          !InsertIfNotPresent(&entry.op_indexes, replica[0], op_index)) {
+        return corruption();
+      }
+    }
+    if (!InsertIfNotPresent(&checkpoint_tmp, fields[0], std::move(entry))) {
+      return corruption();
+    }
+  }
+  *checkpoint = std::move(checkpoint_tmp);
+  return Status::OK();
+}
+
+Status WriteChecksumCheckpoint(Env* env, const string& path,
+                               const ChecksumCheckpoint& checkpoint) {
+  string contents = "# tablet_id checksum replica_uuid:last_committed_op_index...\n";
+  for (const auto& entry : checkpoint) {
+    contents.append(Substitute("$0 $1", entry.first, entry.second.checksum));
+    for (const auto& replica : entry.second.op_indexes) {
+      contents.append(Substitute(" $0:$1", replica.first, replica.second));
+    }
+    contents.append("\n");
+  }
+  // Write to a temporary file first so that an interrupted write doesn't lose
+  // the previous checkpoint.
+  const string tmp_path = path + ".tmp";
+  RETURN_NOT_OK(WriteStringToFile(env, contents, tmp_path));
+  return env->RenameFile(tmp_path, path);
+}
 
 void KsckChecksumManager::InitializeTsSlotsMap() {
   for (const auto& tserver : tservers_) {
-    EmplaceIfNotPresent(&ts_slots_open_map_,
-                        tserver->uuid(),
-                        opts_.scan_concurrency);
+    int capacity = opts_.scan_concurrency;
+    if (opts_.scan_concurrency_per_data_dir > 0 && tserver->is_healthy()) {
+      std::set<string> data_dirs;
+      for (const auto& entry : tserver->tablet_status_map()) {
+        const auto& tablet_id = entry.first;
+        const auto& uuids = entry.second.data_dir_uuids();
+        if (!ContainsKey(tablet_infos_, tablet_id) || uuids.empty()) continue;
+        vector<string> replica_dirs(uuids.begin(), uuids.end());
+        for (const auto& dir : replica_dirs) {
+          if (InsertIfNotPresent(&data_dirs, dir)) {
+            data_dir_slots_open_map_[std::make_pair(tserver->uuid(), dir)] =
+                opts_.scan_concurrency_per_data_dir;
+          }
+        }
+        replica_data_dirs_[std::make_pair(tablet_id, tserver->uuid())] =
+            std::move(replica_dirs);
+      }
+      capacity = std::max<int>(capacity,
+                               opts_.scan_concurrency_per_data_dir * data_dirs.size());
+    }
+    EmplaceIfNotPresent(&ts_slots_open_map_, tserver->uuid(), capacity);
+    EmplaceIfNotPresent(&ts_slots_capacity_map_, tserver->uuid(), capacity);
   }
 }
 
-void KsckChecksumManager::ReleaseTsSlotsUnlocked(const vector<string>& ts_uuids) {
+void KsckChecksumManager::ReleaseTsSlotsUnlocked(const string& tablet_id,
+                                                 const vector<string>& ts_uuids) {
   for (const auto& uuid : ts_uuids) {
     auto& slots_open = FindOrDie(ts_slots_open_map_, uuid);
     DCHECK_GE(slots_open, 0);
-    DCHECK_LT(slots_open, opts_.scan_concurrency);
+    DCHECK_LT(slots_open, FindOrDie(ts_slots_capacity_map_, uuid));
     slots_open++;
+    const auto* dirs = FindOrNull(replica_data_dirs_, std::make_pair(tablet_id, uuid));
+    if (dirs) {
+      for (const auto& dir : *dirs) {
+        auto* dir_slots_open = FindOrNull(data_dir_slots_open_map_, std::make_pair(uuid, dir));
+        DCHECK(dir_slots_open);
+        DCHECK_LT(*dir_slots_open, opts_.scan_concurrency_per_data_dir);
+        (*dir_slots_open)++;
+      }
+    }
   }
 }
 
 bool KsckChecksumManager::HasOpenTsSlotsUnlocked() const {
   for (const auto& entry : ts_slots_open_map_) {
     DCHECK_GE(entry.second, 0);
-    DCHECK_LE(entry.second, opts_.scan_concurrency);
+    DCHECK_LE(entry.second, FindOrDie(ts_slots_capacity_map_, entry.first));
     if (entry.second > 0) {
       return true;
     }
@@ -202,7 +311,7 @@ string KsckChecksumManager::OpenTsSlotSummaryString() const {
     summary.append(Substitute("\n$0 : $1 / $2",
                               entry.first,
                               entry.second,
-                              opts_.scan_concurrency));
+                              FindOrDie(ts_slots_capacity_map_, entry.first)));
   }
   return summary;
 }
@@ -277,7 +386,7 @@ void KsckChecksumManager::ReportResult(const string& tablet_id,
                                           tablet_id,
                                           TabletChecksumResult());
     EmplaceOrDie(&tablet_result, replica_uuid, std::make_pair(status, checksum));
-    ReleaseTsSlotsUnlocked({ replica_uuid });
+    ReleaseTsSlotsUnlocked(tablet_id, { replica_uuid });
   }
 
   responses_.CountDown();
@@ -346,11 +455,27 @@ bool KsckChecksumManager::ReserveSlotsToChecksumUnlocked(
     auto* slots_open = FindOrNull(ts_slots_open_map_, replica->ts_uuid());
     DCHECK(slots_open);
     DCHECK_GE(*slots_open, 0);
-    DCHECK_LE(*slots_open, opts_.scan_concurrency);
+    DCHECK_LE(*slots_open, FindOrDie(ts_slots_capacity_map_, replica->ts_uuid()));
     if (*slots_open == 0) {
       return false;
     }
     slot_counts_to_decrement.push_back(slots_open);
+
+    // The scan of a replica reads from all the data directories it's spread
+    // across.
+    const auto* dirs = FindOrNull(replica_data_dirs_,
+                                  std::make_pair(tablet->id(), replica->ts_uuid()));
+    if (!dirs) continue;
+    for (const auto& dir : *dirs) {
+      auto* dir_slots_open = FindOrNull(data_dir_slots_open_map_,
+                                        std::make_pair(replica->ts_uuid(), dir));
+      DCHECK(dir_slots_open);
+      DCHECK_GE(*dir_slots_open, 0);
+      if (*dir_slots_open == 0) {
+        return false;
+      }
+      slot_counts_to_decrement.push_back(dir_slots_open);
+    }
   }
   for (auto* slots_open : slot_counts_to_decrement) {
     (*slots_open)--;
@@ -587,6 +712,74 @@ Status KsckChecksummer::CollateChecksumResults(
   return Status::OK();
 }
 
+bool KsckChecksummer::GetReplicaOpIndexes(const KsckTablet& tablet,
+                                          map<string, int64_t>* op_indexes) const {
+  CHECK(op_indexes);
+  op_indexes->clear();
+  for (const auto& replica : tablet.replicas()) {
+    const auto* ts = FindOrNull(cluster_->tablet_servers(), replica->ts_uuid());
+    if (!ts || !(*ts)->is_healthy()) {
+      return false;
+    }
+    const auto* status = FindOrNull((*ts)->tablet_status_map(), tablet.id());
+    if (!status || !status->has_last_committed_op_index()) {
+      return false;
+    }
+    EmplaceOrDie(op_indexes, replica->ts_uuid(), status->last_committed_op_index());
+  }
+  return !op_indexes->empty();
+}
+
+void KsckChecksummer::SkipCheckpointedTablets(const ChecksumCheckpoint& checkpoint,
+                                              TabletInfoMap* tablet_infos,
+                                              TabletChecksumResultsMap* skipped) const {
+  for (auto it = tablet_infos->begin(); it != tablet_infos->end();) {
+    const auto& tablet = *it->second.tablet;
+    const auto* entry = FindOrNull(checkpoint, tablet.id());
+    map<string, int64_t> op_indexes;
+    if (!entry ||
+        !GetReplicaOpIndexes(tablet, &op_indexes) ||
+        op_indexes != entry->op_indexes) {
+      ++it;
+      continue;
+    }
+    VLOG(1) << LogPrefix(tablet.id()) << "Unchanged since last verified, skipping checksum";
+    auto& results = LookupOrEmplace(skipped, tablet.id(), TabletChecksumResult());
+    for (const auto& replica : op_indexes) {
+      EmplaceOrDie(&results, replica.first, std::make_pair(Status::OK(), entry->checksum));
+    }
+    it = tablet_infos->erase(it);
+  }
+}
+
+void KsckChecksummer::UpdateCheckpoint(
+    const TabletChecksumResultsMap& checksums,
+    const map<string, map<string, int64_t>>& op_indexes,
+    ChecksumCheckpoint* checkpoint) const {
+  for (const auto& entry : checksums) {
+    const auto& tablet_id = entry.first;
+    const auto* indexes = FindOrNull(op_indexes, tablet_id);
+    bool verified = indexes && indexes->size() == entry.second.size();
+    boost::optional<uint64_t> checksum;
+    for (const auto& replica : entry.second) {
+      if (!verified) break;
+      const ReplicaChecksumResult& result = replica.second;
+      verified = result.first.ok() &&
+          (!checksum || *checksum == result.second) &&
+          ContainsKey(*indexes, replica.first);
+      checksum = result.second;
+    }
+    if (verified) {
+      ChecksumCheckpointEntry checkpoint_entry;
+      checkpoint_entry.checksum = *checksum;
+      checkpoint_entry.op_indexes = *indexes;
+      (*checkpoint)[tablet_id] = std::move(checkpoint_entry);
+    } else {
+      checkpoint->erase(tablet_id);
+    }
+  }
+}
+
 Status KsckChecksummer::ChecksumData(const KsckChecksumOptions& opts,
                                      KsckChecksumResults* checksum_results,
                                      ostream* out_for_progress_updates) {
@@ -633,6 +826,37 @@ Status KsckChecksummer::ChecksumData(const KsckChecksumOptions& opts,
     }
   }
 
+  // Checksums at a fixed snapshot timestamp may not reflect the data that
+  // the replicas hold now, so they're neither skipped nor checkpointed.
+  const bool use_checkpoint = !opts.checkpoint_path.empty() &&
+      (!opts.use_snapshot ||
+       opts.snapshot_timestamp == KsckChecksumOptions::kCurrentTimestamp);
+  ChecksumCheckpoint checkpoint;
+  TabletChecksumResultsMap skipped;
+  map<string, map<string, int64_t>> op_indexes;
+  if (use_checkpoint) {
+    RETURN_NOT_OK_PREPEND(ReadChecksumCheckpoint(Env::Default(),
+                                                 opts.checkpoint_path,
+                                                 &checkpoint),
+                          "unable to read checksum checkpoint");
+    SkipCheckpointedTablets(checkpoint, &tablet_infos, &skipped);
+    if (out_for_progress_updates && !skipped.empty()) {
+      (*out_for_progress_updates)
+          << Substitute("Skipping checksums of $0 tablet(s) unchanged since "
+                        "their replicas were last verified", skipped.size())
+          << endl;
+    }
+    // Record the op indexes from before the checksums start: a replica that
+    // commits more operations before its scan reports a different op index
+    // the next time, and is checksummed again.
+    for (const auto& entry : tablet_infos) {
+      map<string, int64_t> indexes;
+      if (GetReplicaOpIndexes(*entry.second.tablet, &indexes)) {
+        EmplaceOrDie(&op_indexes, entry.first, std::move(indexes));
+      }
+    }
+  }
+
   shared_ptr<KsckChecksumManager> manager;
   RETURN_NOT_OK(KsckChecksumManager::New(opts,
                                          tablet_infos,
@@ -643,10 +867,20 @@ Status KsckChecksummer::ChecksumData(const KsckChecksumOptions& opts,
 
   auto final_status = manager->WaitFor(out_for_progress_updates);
 
-  // Even if we timed out, collate the checksum results that we did get.
+  // Even if we timed out, checkpoint and collate the checksum results that we
+  // did get, so that the next checksum picks up where this one left off.
+  TabletChecksumResultsMap checksums = manager->checksums();
+  if (use_checkpoint) {
+    UpdateCheckpoint(checksums, op_indexes, &checkpoint);
+    WARN_NOT_OK(WriteChecksumCheckpoint(Env::Default(), opts.checkpoint_path, checkpoint),
+                "unable to write checksum checkpoint");
+  }
+  for (auto& entry : skipped) {
+    EmplaceOrDie(&checksums, entry.first, std::move(entry.second));
+  }
   KsckTableChecksumMap checksum_table_map;
   int num_results;
-  const Status s = CollateChecksumResults(manager->checksums(),
+  const Status s = CollateChecksumResults(checksums,
                                           &checksum_table_map,
                                           &num_results);
   checksum_results->tables = std::move(checksum_table_map);
@@ -20,6 +20,7 @@
 #include <atomic>
 #include <cstdint>
 #include <iosfwd>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -40,6 +41,8 @@
 
 namespace kudu {
 
+class Env;
+
 namespace rpc {
 class PeriodicTimer;
 class Messenger;
@@ -87,6 +90,12 @@ struct KsckChecksumOptions {
   // The maximum number of concurrent checksum scans to run per tablet server.
   int scan_concurrency;
 
+  // If positive, the maximum number of concurrent checksum scans reading from
+  // each data directory of a tablet server. A tablet server then runs up to
+  // this many scans per data directory it has, or 'scan_concurrency' scans if
+  // that is more, and scans are spread across its data directories.
+  int scan_concurrency_per_data_dir;
+
   // Whether to use a snapshot checksum scanner.
   bool use_snapshot;
 
@@ -97,12 +106,39 @@ struct KsckChecksumOptions {
   // checksummed.
   std::vector<std::string> table_filters;
   std::vector<std::string> tablet_id_filters;
+
+  // If non-empty, the path of a checkpoint file recording the tablets whose
+  // replicas were verified to match. Tablets none of whose replicas committed
+  // an operation since they were verified are not checksummed again, and the
+  // file is updated with the results of the checksums.
+  std::string checkpoint_path;
 };
 
 typedef std::pair<Status, uint64_t> ReplicaChecksumResult;
 typedef std::unordered_map<std::string, ReplicaChecksumResult> TabletChecksumResult;
 typedef std::unordered_map<std::string, TabletChecksumResult> TabletChecksumResultsMap;
 
+// The checksum of a tablet whose replicas were verified to match, along with
+// the index of the last operation committed by each replica then.
+struct ChecksumCheckpointEntry {
+  uint64_t checksum = 0;
+
+  // Map (replica UUID -> last committed op index).
+  std::map<std::string, int64_t> op_indexes;
+};
+
+// Map (tablet id -> checkpoint entry).
+typedef std::map<std::string, ChecksumCheckpointEntry> ChecksumCheckpoint;
+
+// Reads the checkpoint at 'path' into 'checkpoint'. A missing file is read as
+// an empty checkpoint.
+Status ReadChecksumCheckpoint(Env* env, const std::string& path,
+                              ChecksumCheckpoint* checkpoint);
+
+// Atomically replaces the checkpoint at 'path' with 'checkpoint'.
+Status WriteChecksumCheckpoint(Env* env, const std::string& path,
+                               const ChecksumCheckpoint& checkpoint);
+
 // A convenience struct containing info needed to checksum a particular tablet.
 struct TabletChecksumInfo {
   TabletChecksumInfo(std::shared_ptr<KsckTablet> tablet, Schema schema)
@@ -210,11 +246,15 @@ class KsckChecksumManager : public std::enable_shared_from_this<KsckChecksumMana
   // Begin the checksum on the tablet named in 'tablet_info'.
   void BeginTabletChecksum(const TabletChecksumInfo& tablet_info);
 
-  // Initialize 'ts_open_slots_map_'.
+  // Initialize 'ts_slots_open_map_', 'ts_slots_capacity_map_' and, when
+  // scans are limited per data directory, 'data_dir_slots_open_map_' and
+  // 'replica_data_dirs_'.
   void InitializeTsSlotsMap();
 
-  // Release a checksum scan slot on each tserver in 'tserver_uuids'.
-  void ReleaseTsSlotsUnlocked(const std::vector<std::string>& ts_uuids);
+  // Release the checksum scan slots held by the replicas of 'tablet_id' on
+  // each tserver in 'ts_uuids'.
+  void ReleaseTsSlotsUnlocked(const std::string& tablet_id,
+                              const std::vector<std::string>& ts_uuids);
 
   // Are there any open slots at all?
   bool HasOpenTsSlotsUnlocked() const;
@@ -235,10 +275,22 @@ class KsckChecksumManager : public std::enable_shared_from_this<KsckChecksumMana
   // tablets in 'tablet_infos_'.
   TabletServerChecksumScanSlotsMap ts_slots_open_map_;
 
+  // The total number of slots of each tablet server.
+  TabletServerChecksumScanSlotsMap ts_slots_capacity_map_;
+
+  // Tracks the open slots for each (tablet server UUID, data dir UUID) pair
+  // when scans are limited per data directory.
+  std::map<std::pair<std::string, std::string>, int> data_dir_slots_open_map_;
+
+  // The data directories of each (tablet id, tablet server UUID) replica when
+  // scans are limited per data directory. Replicas whose data directories
+  // are unknown aren't limited.
+  std::map<std::pair<std::string, std::string>, std::vector<std::string>> replica_data_dirs_;
+
   // checksums_ is an unordered_map of { tablet_id : { replica_uuid : checksum } }.
   TabletChecksumResultsMap checksums_;
 
-  // Protects 'tablet_infos_', 'ts_slots_map_', and 'checksums_'.
+  // Protects 'tablet_infos_', the slot maps, and 'checksums_'.
   mutable simple_spinlock lock_;
 
   // The list of tablet servers that checksum scans will be run on. Every
@@ -301,6 +353,28 @@ class KsckChecksummer {
       KsckTableChecksumMap* table_checksum_map,
       int* num_results) const;
 
+  // Returns in 'op_indexes' the index of the last operation committed by each
+  // replica of 'tablet', as reported by the tablet servers when ksck fetched
+  // their info. Returns false if any of them is unknown.
+  bool GetReplicaOpIndexes(const KsckTablet& tablet,
+                           std::map<std::string, int64_t>* op_indexes) const;
+
+  // Moves the tablets of 'tablet_infos' which are unchanged since they were
+  // recorded in 'checkpoint' into 'skipped', with their recorded checksums
+  // as the results of their replicas.
+  void SkipCheckpointedTablets(const ChecksumCheckpoint& checkpoint,
+                               TabletInfoMap* tablet_infos,
+                               TabletChecksumResultsMap* skipped) const;
+
+  // Updates 'checkpoint' with the tablets in 'checksums' whose replicas all
+  // reported the same checksum, and drops the tablets whose replicas didn't.
+  // 'op_indexes' holds the op indexes of the replicas of the tablets which
+  // were checksummed.
+  void UpdateCheckpoint(
+      const TabletChecksumResultsMap& checksums,
+      const std::map<std::string, std::map<std::string, int64_t>>& op_indexes,
+      ChecksumCheckpoint* checkpoint) const;
+
   KsckCluster* cluster_;
 
   DISALLOW_COPY_AND_ASSIGN(KsckChecksummer);
@@ -501,6 +501,7 @@ TEST_F(ToolTest, TestModeHelp) {
   {
     const vector<string> kLocalReplicaModeRegexes = {
         "cmeta.*Operate on a local tablet replica's consensus",
+        "compact.*Fully compact the rowsets",
         "data_size.*Summarize the data size",
         "dump.*Dump a Kudu filesystem",
         "copy_from_remote.*Copy a tablet replica",
@@ -546,6 +547,7 @@ TEST_F(ToolTest, TestModeHelp) {
   }
   {
     const vector<string> kDiagnoseModeRegexes = {
+        "parse_cpu_profile.*Parse sampled CPU profiles",
         "parse_stacks.*Parse sampled stack traces",
     };
     NO_FATALS(RunTestHelp("diagnose", kDiagnoseModeRegexes));
@@ -568,6 +570,9 @@ TEST_F(ToolTest, TestModeHelp) {
   {
     const vector<string> kPerfRegexes = {
         "loadgen.*Run load generation with optional scan afterwards",
+        "ycsb.*Run a YCSB-style workload of mixed operations",
+        "table_scan.*Scan a table and break down where the time went",
+        "wal.*Measure the throughput and latency of WAL appends",
     };
     NO_FATALS(RunTestHelp("perf", kPerfRegexes));
   }
@@ -1550,6 +1555,18 @@ TEST_F(ToolTest, TestLoadgenManualFlush) {
       "bench_manual_flush"));
 }
 
+// Run the loadgen benchmark writing the rows with UPSERT operations.
+TEST_F(ToolTest, TestLoadgenUpsert) {
+  NO_FATALS(RunLoadgen(1,
+      {
+        "--num_rows_per_thread=1024",
+        "--num_threads=2",
+        "--run_scan",
+        "--use_upsert",
+      },
+      "bench_upsert"));
+}
+
 TEST_F(ToolTest, TestLoadgenServerSideDefaultNumReplicas) {
   NO_FATALS(RunLoadgen(3, { "--table_num_replicas=0" }));
 }
@@ -1571,6 +1588,81 @@ TEST_F(ToolTest, TestLoadgenHmsEnabled) {
       HostPort::ToCommaSeparatedString(cluster_->master_rpc_addrs())), &out));
 }
 
+// Run a small YCSB-style workload of every type of operation, in open loop.
+TEST_F(ToolTest, TestYcsb) {
+  NO_FATALS(StartExternalMiniCluster());
+  const string master_addrs =
+      HostPort::ToCommaSeparatedString(cluster_->master_rpc_addrs());
+  string out;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf ycsb $0 --num_threads=2 --ycsb_record_count=200 "
+      "--ycsb_operation_count=500 --ycsb_field_count=3 --ycsb_field_length=16 "
+      "--ycsb_field_length_distribution=uniform --ycsb_read_proportion=0.2 "
+      "--ycsb_update_proportion=0.2 --ycsb_insert_proportion=0.2 "
+      "--ycsb_scan_proportion=0.2 --ycsb_read_modify_write_proportion=0.2 "
+      "--ycsb_request_distribution=latest --ycsb_target_ops_per_sec=1000",
+      master_addrs), &out));
+  ASSERT_STR_CONTAINS(out, "operations  : 500");
+  for (const auto& op : { "READ", "UPDATE", "INSERT", "SCAN", "READ_MODIFY_WRITE" }) {
+    ASSERT_STR_CONTAINS(out, Substitute("  $0\n    operations  : ", op));
+  }
+
+  // Bad flags are rejected.
+  string stderr;
+  Status s = RunActionStderrString(Substitute(
+      "perf ycsb $0 --ycsb_request_distribution=foo", master_addrs), &stderr);
+  ASSERT_TRUE(s.IsRuntimeError());
+  ASSERT_STR_CONTAINS(stderr, "unknown request distribution");
+}
+
+TEST_F(ToolTest, TestPerfTableScan) {
+  NO_FATALS(StartExternalMiniCluster());
+  const string kTableName = "kudu.perf.table_scan";
+  TestWorkload workload(cluster_.get());
+  workload.set_table_name(kTableName);
+  workload.set_num_replicas(1);
+  workload.set_num_tablets(3);
+  workload.Setup();
+  workload.Start();
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_GE(workload.rows_inserted(), 100);
+  });
+  workload.StopAndJoin();
+
+  const string master_addrs =
+      HostPort::ToCommaSeparatedString(cluster_->master_rpc_addrs());
+  string out;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf table_scan $0 $1 --num_threads=2 --scan_columns=key,string_val --format=csv",
+      master_addrs, kTableName), &out));
+  ASSERT_STR_MATCHES(out, "Tablet ID,Rows,Wall \\(ms\\),Server \\(ms\\),");
+  ASSERT_STR_MATCHES(out, "\nkey,[0-9]+,[0-9]+,");
+  ASSERT_STR_MATCHES(out, "\nstring_val,[0-9]+,[0-9]+,");
+  ASSERT_STR_NOT_CONTAINS(out, "int_val");
+  ASSERT_STR_CONTAINS(out, Substitute("Scanned $0 rows of 3 tablets",
+                                      workload.rows_inserted()));
+}
+
+TEST_F(ToolTest, TestPerfWal) {
+  const string kWalDir = GetTestPath("wal");
+  ASSERT_OK(env_->CreateDir(kWalDir));
+  string out;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf wal $0 --wal_entries_per_tablet=100 --wal_entry_sizes=128 "
+      "--wal_group_commit_max_waits_us=0 --wal_compression_codecs=none,LZ4 "
+      "--wal_num_tablets=1,2 --wal_fsync=false --format=csv", kWalDir), &out));
+  ASSERT_STR_MATCHES(out, "Entry bytes,Group commit wait \\(us\\),Codec,Tablets,");
+  ASSERT_STR_MATCHES(out, "\n128,0,none,1,[0-9]+,");
+  ASSERT_STR_MATCHES(out, "\n128,0,none,2,[0-9]+,");
+  ASSERT_STR_MATCHES(out, "\n128,0,LZ4,1,[0-9]+,");
+  ASSERT_STR_MATCHES(out, "\n128,0,LZ4,2,[0-9]+,");
+
+  // The WALs are deleted once done.
+  vector<string> children;
+  ASSERT_OK(env_->GetChildren(kWalDir, &children));
+  ASSERT_EQ(2, children.size()) << JoinStrings(children, ",");
+}
+
 // Run the loadgen, generating a few different partitioning schemas.
 TEST_F(ToolTest, TestLoadgenAutoGenTablePartitioning) {
   {
@@ -1961,6 +2053,59 @@ TEST_F(ToolTest, TestLocalReplicaTombstoneDelete) {
   }
 }
 
+// Test 'kudu local_replica compact' merging the rowsets of a tablet, including
+// data that was only in its WAL.
+TEST_F(ToolTest, TestLocalReplicaCompact) {
+  NO_FATALS(StartMiniCluster());
+
+  TestWorkload workload(mini_cluster_.get());
+  workload.set_num_replicas(1);
+  workload.Setup();
+
+  ASSERT_OK(mini_cluster_->WaitForTabletServerCount(1));
+  MiniTabletServer* ts = mini_cluster_->mini_tablet_server(0);
+  vector<scoped_refptr<TabletReplica>> tablet_replicas;
+  ts->server()->tablet_manager()->GetTabletReplicas(&tablet_replicas);
+  ASSERT_EQ(1, tablet_replicas.size());
+  const string tablet_id = tablet_replicas[0]->tablet_id();
+
+  // Write several batches of rows, flushing all but the last one, so that the
+  // tablet has several rowsets as well as rows that are only in its WAL.
+  for (int i = 1; i <= 4; i++) {
+    workload.Start();
+    while (workload.rows_inserted() < i * 1000) {
+      SleepFor(MonoDelta::FromMilliseconds(10));
+    }
+    workload.StopAndJoin();
+    if (i < 4) {
+      ASSERT_OK(tablet_replicas[0]->tablet()->Flush());
+    }
+  }
+  ASSERT_GT(tablet_replicas[0]->tablet()->num_rowsets(), 1);
+  uint64_t rows_before;
+  ASSERT_OK(tablet_replicas[0]->tablet()->CountRows(&rows_before));
+  tablet_replicas.clear();
+
+  const string& tserver_dir = ts->options()->fs_opts.wal_root;
+  ts->Shutdown();
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute("local_replica compact $0 --fs_wal_dir=$1 "
+                                             "--fs_data_dirs=$1",
+                                             tablet_id, tserver_dir), &stdout));
+  ASSERT_STR_MATCHES(stdout, Substitute("Compacted tablet $0 from [0-9]+ to 1 rowset", tablet_id));
+
+  // The tablet server finds a single rowset holding all the rows.
+  ASSERT_OK(ts->Start());
+  ASSERT_OK(ts->WaitStarted());
+  ASSERT_OK(ts->server()->tablet_manager()->WaitForAllBootstrapsToFinish());
+  ts->server()->tablet_manager()->GetTabletReplicas(&tablet_replicas);
+  ASSERT_EQ(1, tablet_replicas.size());
+  ASSERT_EQ(1, tablet_replicas[0]->tablet()->num_rowsets());
+  uint64_t rows_after;
+  ASSERT_OK(tablet_replicas[0]->tablet()->CountRows(&rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+}
+
 // Test for 'local_replica cmeta' functionality.
 TEST_F(ToolTest, TestLocalReplicaCMetaOps) {
   NO_FATALS(StartMiniCluster());
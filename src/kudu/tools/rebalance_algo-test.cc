@@ -572,6 +572,30 @@ TEST(RebalanceAlgoUnitTest, OneMoveNoCycling) {
   VERIFY_MOVES(kConfigs);
 }
 
+// Among tablet servers with the same replica counts, replicas should be moved
+// off the server storing the most data onto the server storing the least.
+TEST(RebalanceAlgoUnitTest, PreferServersByOnDiskSize) {
+  const TestClusterConfig kConfig = {
+    kNoLocations,
+    { "0", "1", "2", "3", },
+    {
+      { "A", { 2, 2, 0, 0, } },
+    },
+    {}
+  };
+  ClusterInfo ci;
+  ClusterConfigToClusterInfo(kConfig, &ci);
+  ci.load.on_disk_size_by_ts_id = {
+    { "0", 100 }, { "1", 10 }, { "2", 50 }, { "3", 5 },
+  };
+  TwoDimensionalGreedyAlgo algo(
+      TwoDimensionalGreedyAlgo::EqualSkewOption::PICK_FIRST);
+  vector<TableReplicaMove> moves;
+  ASSERT_OK(algo.GetNextMoves(ci, 1, &moves));
+  const vector<TableReplicaMove> expected_moves = { { "A", "0", "3" }, };
+  EXPECT_EQ(expected_moves, moves);
+}
+
 // Set of scenarios where the distribution of table replicas is cluster-wise
 // balanced, but not table-wise balanced, requiring just few moves to make it
 // both table- and cluster-wise balanced.
@@ -45,6 +45,7 @@ using std::ostringstream;
 using std::set_intersection;
 using std::shuffle;
 using std::sort;
+using std::stable_sort;
 using std::string;
 using std::unordered_map;
 using std::vector;
@@ -316,6 +317,21 @@ Status TwoDimensionalGreedyAlgo::GetNextMove(
       shuffle(max_loaded_intersection.begin(), max_loaded_intersection.end(),
               generator_);
     }
+    // Among the candidates, prefer moving data off the servers storing the
+    // most onto the servers storing the least. The sort is stable, so
+    // the remaining ties are still broken per 'equal_skew_opt_'.
+    const auto& on_disk_sizes = cluster_info.load.on_disk_size_by_ts_id;
+    if (!on_disk_sizes.empty()) {
+      const auto by_on_disk_size = [&on_disk_sizes](const string& lhs,
+                                                    const string& rhs) {
+        return FindWithDefault(on_disk_sizes, lhs, 0) <
+            FindWithDefault(on_disk_sizes, rhs, 0);
+      };
+      for (auto* uuids : { &min_loaded, &min_loaded_intersection,
+                           &max_loaded, &max_loaded_intersection }) {
+        stable_sort(uuids->begin(), uuids->end(), by_on_disk_size);
+      }
+    }
     const auto& min_loaded_uuid = min_loaded_intersection.empty()
         ? min_loaded.front() : min_loaded_intersection.front();
     const auto& max_loaded_uuid = max_loaded_intersection.empty()
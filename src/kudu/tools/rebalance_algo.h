@@ -80,10 +80,19 @@ struct ClusterLocalityInfo {
   std::unordered_map<std::string, std::string> location_by_ts_id;
 };
 
+// Resource usage information for a cluster.
+struct ClusterLoadInfo {
+  // Mapping 'tablet server identifier' --> 'estimated total on-disk size of
+  // the replicas hosted by the tablet server, in bytes'. Empty if there is no
+  // such information.
+  std::unordered_map<std::string, int64_t> on_disk_size_by_ts_id;
+};
+
 // Information on a cluster as input for various rebalancing algorithms.
 struct ClusterInfo {
   ClusterBalanceInfo balance;
   ClusterLocalityInfo locality;
+  ClusterLoadInfo load;
 };
 
 // A directive to move some replica of a table between two tablet servers.
@@ -136,6 +145,12 @@ class RebalancingAlgo {
 // The skew of the cluster is defined as the difference between the maximum
 // total replica count over all tablet servers and the minimum total replica
 // count over all tablet servers.
+//
+// If the on-disk size of the replicas at the tablet servers is known, then
+// among the servers which are equally good choices in terms of replica counts,
+// the algorithm moves replicas from the server storing the most data to the
+// server storing the least. That evens out disk usage across servers whose
+// replicas differ in size, without giving up on the balance of replica counts.
 class TwoDimensionalGreedyAlgo : public RebalancingAlgo {
  public:
   // Policies for picking one element from equal-skew choices.
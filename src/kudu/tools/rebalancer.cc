@@ -42,6 +42,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/tablet.pb.h"
 #include "kudu/tools/ksck.h"
 #include "kudu/tools/ksck_remote.h"
 #include "kudu/tools/ksck_results.h"
@@ -75,6 +76,19 @@ using strings::Substitute;
 namespace kudu {
 namespace tools {
 
+namespace {
+
+// Returns the estimated on-disk size of the replica as reported by its tablet
+// server, or 0 if unknown.
+int64_t ReplicaOnDiskSize(const KsckReplicaSummary& replica) {
+  if (replica.status_pb && replica.status_pb->has_estimated_on_disk_size()) {
+    return replica.status_pb->estimated_on_disk_size();
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
 Rebalancer::Config::Config(
     std::vector<std::string> master_addresses,
     std::vector<std::string> table_filters,
@@ -375,6 +389,7 @@ Status Rebalancer::BuildClusterInfo(const ClusterRawInfo& raw_info,
 
   unordered_map<string, int32_t> tserver_replicas_count;
   unordered_map<string, TableReplicasAtServer> table_replicas_info;
+  auto& on_disk_size_by_ts_id = result_info.load.on_disk_size_by_ts_id;
 
   // Build a set of tables with RF=1 (single replica tables).
   unordered_set<string> rf1_tables;
@@ -447,6 +462,7 @@ Status Rebalancer::BuildClusterInfo(const ClusterRawInfo& raw_info,
       }
       if (do_count_replica) {
         it->second++;
+        on_disk_size_by_ts_id[ri.ts_uuid] += ReplicaOnDiskSize(ri);
       }
 
       auto table_ins = table_replicas_info.emplace(
@@ -890,18 +906,37 @@ Status Rebalancer::AlgoBasedRunner::GetNextMovesImpl(
                  [](const MovesInProgress::value_type& elem) {
                    return elem.first;
                  });
+  // Tablet server identifier --> tablet identifier --> estimated on-disk size
+  // of the tablet's replica at the tablet server.
+  unordered_map<string, unordered_map<string, int64_t>> replica_sizes;
+  for (const auto& tablet : raw_info.tablet_summaries) {
+    for (const auto& ri : tablet.replicas) {
+      replica_sizes[ri.ts_uuid][tablet.id] = ReplicaOnDiskSize(ri);
+    }
+  }
+  const auto& on_disk_size_by_ts_id = cluster_info.load.on_disk_size_by_ts_id;
   for (const auto& move : moves) {
     vector<string> tablet_ids;
     RETURN_NOT_OK(FindReplicas(move, raw_info, &tablet_ids));
     // Shuffle the set of the tablet identifiers: that's to achieve even spread
     // of moves across tables with the same skew.
     std::shuffle(tablet_ids.begin(), tablet_ids.end(), random_generator_);
+    // If the source server stores more data than the destination server, move
+    // the largest replica to even out their disk usage, and the smallest one
+    // otherwise. Ties are left in the shuffled order.
+    const auto& sizes_at_src = replica_sizes[move.from];
+    const bool move_largest = FindWithDefault(on_disk_size_by_ts_id, move.from, 0) >
+        FindWithDefault(on_disk_size_by_ts_id, move.to, 0);
+    std::stable_sort(tablet_ids.begin(), tablet_ids.end(),
+                     [&](const string& lhs, const string& rhs) {
+                       const auto lhs_size = FindWithDefault(sizes_at_src, lhs, 0);
+                       const auto rhs_size = FindWithDefault(sizes_at_src, rhs, 0);
+                       return move_largest ? lhs_size > rhs_size : lhs_size < rhs_size;
+                     });
     string move_tablet_id;
     for (const auto& tablet_id : tablet_ids) {
       if (tablets_in_move.find(tablet_id) == tablets_in_move.end()) {
-        // For now, choose the very first tablet that does not have replicas
-        // in move. Later on, additional logic might be added to find
-        // the best candidate.
+        // Choose the very first tablet that does not have replicas in move.
         move_tablet_id = tablet_id;
         break;
       }
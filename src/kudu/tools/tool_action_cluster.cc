@@ -320,8 +320,10 @@ unique_ptr<Mode> BuildClusterMode() {
         .ExtraDescription(extra_desc)
         .AddRequiredParameter({ kMasterAddressesArg, kMasterAddressesArgDesc })
         .AddOptionalParameter("checksum_cache_blocks")
+        .AddOptionalParameter("checksum_checkpoint_file")
         .AddOptionalParameter("checksum_scan")
         .AddOptionalParameter("checksum_scan_concurrency")
+        .AddOptionalParameter("checksum_scan_concurrency_per_data_dir")
         .AddOptionalParameter("checksum_snapshot")
         .AddOptionalParameter("checksum_timeout_sec")
         .AddOptionalParameter("color")
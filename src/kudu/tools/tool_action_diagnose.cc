@@ -18,22 +18,35 @@
 #include <algorithm>
 #include <array>
 #include <cerrno>
+#include <cstdint>
 #include <fstream> // IWYU pragma: keep
+#include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <gflags/gflags.h>
+
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tools/diagnostics_log_parser.h"
 #include "kudu/tools/tool_action.h"
 #include "kudu/util/errno.h"
 #include "kudu/util/status.h"
 
+DEFINE_int64(start_unix_time, 0,
+             "Only include the CPU profiles collected at or after this time, "
+             "in seconds since the Unix epoch. If 0, there is no lower bound.");
+DEFINE_int64(end_unix_time, 0,
+             "Only include the CPU profiles collected at or before this time, "
+             "in seconds since the Unix epoch. If 0, there is no upper bound.");
+
 namespace kudu {
 namespace tools {
 
 using std::array;
+using std::cout;
 using std::ifstream;
 using std::string;
 using std::unique_ptr;
@@ -45,14 +58,13 @@ const char* kLogPathArg = "path";
 
 namespace {
 
-Status ParseStacksFromPath(const string& path) {
+Status ParseLogFromPath(const string& path, LogVisitor* visitor) {
   errno = 0;
   ifstream in(path);
   if (!in.is_open()) {
     return Status::IOError(ErrnoToString(errno));
   }
-  StackDumpingLogVisitor dlv;
-  LogParser lp(&dlv);
+  LogParser lp(visitor);
   string line;
   int line_number = 0;
   while (std::getline(in, line)) {
@@ -69,13 +81,30 @@ Status ParseStacks(const RunnerContext& context) {
   // The file names are such that lexicographic sorting reflects
   // timestamp-based sorting.
   std::sort(paths.begin(), paths.end());
+  StackDumpingLogVisitor dlv;
   for (const auto& path : paths) {
-    RETURN_NOT_OK_PREPEND(ParseStacksFromPath(path),
+    RETURN_NOT_OK_PREPEND(ParseLogFromPath(path, &dlv),
                           Substitute("failed to parse stacks from $0", path));
   }
   return Status::OK();
 }
 
+Status ParseCpuProfile(const RunnerContext& context) {
+  vector<string> paths = context.variadic_args;
+  std::sort(paths.begin(), paths.end());
+  const int64_t kMicrosPerSecond = 1000000;
+  FlameGraphLogVisitor fglv(
+      FLAGS_start_unix_time * kMicrosPerSecond,
+      FLAGS_end_unix_time > 0 ? FLAGS_end_unix_time * kMicrosPerSecond
+                              : std::numeric_limits<int64_t>::max());
+  for (const auto& path : paths) {
+    RETURN_NOT_OK_PREPEND(ParseLogFromPath(path, &fglv),
+                          Substitute("failed to parse CPU profiles from $0", path));
+  }
+  fglv.DumpFoldedStacks(&cout);
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildDiagnoseMode() {
@@ -85,8 +114,22 @@ unique_ptr<Mode> BuildDiagnoseMode() {
       .AddRequiredVariadicParameter({ kLogPathArg, "path to log file(s) to parse" })
       .Build();
 
+  unique_ptr<Action> parse_cpu_profile =
+      ActionBuilder("parse_cpu_profile", &ParseCpuProfile)
+      .Description("Parse sampled CPU profiles out of a diagnostics log into folded "
+                   "stacks for flame graphs")
+      .ExtraDescription("The samples collected within the time window given by "
+                        "--start_unix_time and --end_unix_time are aggregated by "
+                        "stack trace, and output one stack per line, in the format "
+                        "expected by flame graph tools such as flamegraph.pl.")
+      .AddRequiredVariadicParameter({ kLogPathArg, "path to log file(s) to parse" })
+      .AddOptionalParameter("start_unix_time")
+      .AddOptionalParameter("end_unix_time")
+      .Build();
+
   return ModeBuilder("diagnose")
       .Description("Diagnostic tools for Kudu servers and clusters")
+      .AddAction(std::move(parse_cpu_profile))
       .AddAction(std::move(parse_stacks))
       .Build();
 }
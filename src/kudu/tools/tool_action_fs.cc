@@ -119,6 +119,7 @@ using std::unique_ptr;
 using std::unordered_map;
 using std::vector;
 using strings::Substitute;
+using tablet::ColumnBlockRange;
 using tablet::RowSetMetadata;
 using tablet::TabletMetadata;
 
@@ -686,7 +687,14 @@ Status AddBlockInfoRow(DataTable* table,
     unique_ptr<CFileReader> cfile;
     unique_ptr<ReadableBlock> readable_block;
     RETURN_NOT_OK(fs_manager->OpenBlock(block, &readable_block));
-    RETURN_NOT_OK(CFileReader::Open(std::move(readable_block), ReaderOptions(), &cfile));
+    ReaderOptions opts;
+    ColumnBlockRange range;
+    if (column_id && rowset.GetColumnBlockRange(*column_id, &range)) {
+      // The column shares the block with the rest of its column group.
+      opts.block_offset = range.offset;
+      opts.block_length = range.length;
+    }
+    RETURN_NOT_OK(CFileReader::Open(std::move(readable_block), std::move(opts), &cfile));
     table->AddRow(BuildInfoRow(CFileInfo, fields, tablet, rowset, block_kind,
                                column_id, block, *cfile));
 
@@ -15,11 +15,14 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -30,13 +33,17 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/clock/clock.h"
+#include "kudu/clock/logical_clock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/consensus_meta.h"
 #include "kudu/consensus/consensus_meta_manager.h"
+#include "kudu/consensus/log.h"
 #include "kudu/consensus/log.pb.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/log_index.h"
@@ -46,7 +53,10 @@
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/human_readable.h"
@@ -57,9 +67,12 @@
 #include "kudu/gutil/strings/util.h"
 #include "kudu/master/sys_catalog.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/result_tracker.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_mem_trackers.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
@@ -69,10 +82,15 @@
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_bool(dump_data, false,
             "Dump the data for each column in the rowset.");
@@ -89,16 +107,23 @@ DEFINE_bool(clean_unsafe, false,
             "This is not guaranteed to be safe because it also removes the "
             "consensus metadata (including Raft voting record) for the "
             "specified tablet, which violates the Raft vote durability requirements.");
+DEFINE_int32(compaction_parallelism, 0,
+             "Number of tablets to compact at the same time. Defaults to 0, "
+             "which compacts as many tablets at a time as there are data "
+             "directories.");
 
 namespace kudu {
 namespace tools {
 
+using consensus::ConsensusBootstrapInfo;
 using consensus::ConsensusMetadata;
 using consensus::ConsensusMetadataManager;
 using consensus::OpId;
 using consensus::RaftConfigPB;
 using consensus::RaftPeerPB;
 using fs::ReadableBlock;
+using log::Log;
+using log::LogAnchorRegistry;
 using log::LogEntryPB;
 using log::LogEntryReader;
 using log::LogIndex;
@@ -116,8 +141,10 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
+using tablet::ColumnBlockRange;
 using tablet::DiskRowSet;
 using tablet::RowSetMetadata;
+using tablet::Tablet;
 using tablet::TabletMetadata;
 using tablet::TabletDataState;
 using tserver::TabletCopyClient;
@@ -482,6 +509,12 @@ Status SummarizeDataSize(const RunnerContext& context) {
             "c$0 ($1)", col_id,
             (col_idx != Schema::kColumnNotFound) ?
                 meta->schema().column(col_idx).name() : "?");
+        ColumnBlockRange range;
+        if (rs_meta->GetColumnBlockRange(col_id, &range)) {
+          // The column shares the block with the rest of its column group.
+          rowset_stats.column_bytes[col_key] += range.length;
+          continue;
+        }
         RETURN_NOT_OK(SummarizeSize(
             fs.get(), { block }, col_key, &rowset_stats.column_bytes[col_key]));
       }
@@ -500,6 +533,138 @@ Status SummarizeDataSize(const RunnerContext& context) {
   return Status::OK();
 }
 
+// Fully compacts the local replica whose metadata is 'meta', returning its
+// number of rowsets before and after in 'rowsets_before' and 'rowsets_after'.
+//
+// The replica is bootstrapped first, so that the operations in its WAL which
+// were not flushed yet are part of the compaction instead of being lost when
+// the rowsets they apply to are replaced.
+Status CompactLocalReplica(const scoped_refptr<ConsensusMetadataManager>& cmeta_manager,
+                           const scoped_refptr<TabletMetadata>& meta,
+                           size_t* rowsets_before,
+                           size_t* rowsets_after) {
+  scoped_refptr<ConsensusMetadata> cmeta;
+  RETURN_NOT_OK(cmeta_manager->Load(meta->tablet_id(), &cmeta));
+
+  // Without a clock with a physical component the tablet doesn't compute an
+  // ancient history mark, so no history is removed: the tool has no way to
+  // tell what the tablet server's notion of time is.
+  scoped_refptr<clock::Clock> clock(
+      clock::LogicalClock::CreateStartingAt(Timestamp::kInitialTimestamp));
+  shared_ptr<Tablet> tablet;
+  scoped_refptr<Log> log;
+  ConsensusBootstrapInfo bootstrap_info;
+  RETURN_NOT_OK_PREPEND(tablet::BootstrapTablet(meta,
+                                                cmeta->CommittedConfig(),
+                                                clock,
+                                                shared_ptr<MemTracker>(),
+                                                scoped_refptr<rpc::ResultTracker>(),
+                                                nullptr,
+                                                nullptr,
+                                                &tablet,
+                                                &log,
+                                                scoped_refptr<LogAnchorRegistry>(
+                                                    new LogAnchorRegistry()),
+                                                &bootstrap_info),
+                        "could not bootstrap tablet");
+  SCOPED_CLEANUP({
+    tablet->Shutdown();
+    WARN_NOT_OK(log->Close(), "could not close log");
+  });
+
+  *rowsets_before = tablet->num_rowsets();
+  RETURN_NOT_OK_PREPEND(tablet->Flush(), "could not flush tablet");
+  RETURN_NOT_OK_PREPEND(tablet->Compact(Tablet::FORCE_COMPACT_ALL),
+                        "could not compact tablet");
+  *rowsets_after = tablet->num_rowsets();
+  return Status::OK();
+}
+
+Status CompactLocalReplicas(const RunnerContext& context) {
+  const string& tablet_id_pattern = FindOrDie(context.required_args, kTabletIdGlobArg);
+  FsManager fs_manager(Env::Default(), FsManagerOpts());
+  RETURN_NOT_OK(fs_manager.Open());
+  scoped_refptr<ConsensusMetadataManager> cmeta_manager(
+      new ConsensusMetadataManager(&fs_manager));
+
+  vector<string> tablet_ids;
+  RETURN_NOT_OK(fs_manager.ListTabletIds(&tablet_ids));
+
+  // Order the tablets so that consecutive ones are on different data
+  // directories, spreading the concurrent compactions across the disks.
+  map<string, vector<scoped_refptr<TabletMetadata>>> metas_by_data_dir;
+  for (const auto& tablet_id : tablet_ids) {
+    if (!MatchPattern(tablet_id, tablet_id_pattern)) continue;
+    scoped_refptr<TabletMetadata> meta;
+    RETURN_NOT_OK_PREPEND(TabletMetadata::Load(&fs_manager, tablet_id, &meta),
+                          Substitute("could not load tablet metadata for $0", tablet_id));
+    if (meta->tablet_data_state() != TabletDataState::TABLET_DATA_READY) {
+      cout << Substitute("Skipping tablet $0 in state $1", tablet_id,
+                         TabletDataState_Name(meta->tablet_data_state())) << endl;
+      continue;
+    }
+    DataDirGroupPB data_dir_group;
+    string data_dir;
+    if (fs_manager.dd_manager()->GetDataDirGroupPB(tablet_id, &data_dir_group).ok() &&
+        data_dir_group.uuids_size() > 0) {
+      data_dir = data_dir_group.uuids(0);
+    }
+    metas_by_data_dir[data_dir].emplace_back(std::move(meta));
+  }
+  vector<scoped_refptr<TabletMetadata>> metas;
+  for (size_t i = 0;; i++) {
+    bool added = false;
+    for (const auto& e : metas_by_data_dir) {
+      if (i < e.second.size()) {
+        metas.push_back(e.second[i]);
+        added = true;
+      }
+    }
+    if (!added) break;
+  }
+
+  int parallelism = FLAGS_compaction_parallelism;
+  if (parallelism <= 0) {
+    parallelism = std::max<int>(1, fs_manager.dd_manager()->GetDataDirs().size());
+  }
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("compact")
+                .set_max_threads(parallelism)
+                .Build(&pool));
+
+  simple_spinlock lock;
+  vector<Status> statuses(metas.size());
+  for (size_t i = 0; i < metas.size(); i++) {
+    RETURN_NOT_OK(pool->SubmitFunc([&, i]() {
+      const auto& tablet_id = metas[i]->tablet_id();
+      MonoTime start = MonoTime::Now();
+      size_t rowsets_before = 0;
+      size_t rowsets_after = 0;
+      Status s = CompactLocalReplica(cmeta_manager, metas[i], &rowsets_before, &rowsets_after);
+      std::lock_guard<simple_spinlock> l(lock);
+      if (s.ok()) {
+        cout << Substitute("Compacted tablet $0 from $1 to $2 rowset(s) in $3",
+                           tablet_id, rowsets_before, rowsets_after,
+                           (MonoTime::Now() - start).ToString()) << endl;
+      } else {
+        cout << Substitute("Failed to compact tablet $0: $1", tablet_id, s.ToString()) << endl;
+      }
+      statuses[i] = std::move(s);
+    }));
+  }
+  pool->Wait();
+
+  int num_failed = 0;
+  for (const auto& s : statuses) {
+    if (!s.ok()) num_failed++;
+  }
+  if (num_failed > 0) {
+    return Status::RuntimeError(Substitute("failed to compact $0 of $1 tablet(s)",
+                                           num_failed, metas.size()));
+  }
+  return Status::OK();
+}
+
 Status DumpWals(const RunnerContext& context) {
   unique_ptr<FsManager> fs_manager;
   RETURN_NOT_OK(FsInit(&fs_manager));
@@ -795,6 +960,21 @@ unique_ptr<Mode> BuildLocalReplicaMode() {
       .AddOptionalParameter("fs_wal_dir")
       .Build();
 
+  unique_ptr<Action> compact =
+      ActionBuilder("compact", &CompactLocalReplicas)
+      .Description("Fully compact the rowsets of the given local replica(s)")
+      .ExtraDescription("Each replica is bootstrapped from its WAL, its "
+          "in-memory data is flushed, and all of its rowsets are merged into "
+          "as few rowsets as possible, regardless of the compaction policy's "
+          "budget. Replicas are compacted in parallel, spread across the data "
+          "directories. The tablet server must be shut down.")
+      .AddRequiredParameter({ kTabletIdGlobArg, kTabletIdGlobArgDesc })
+      .AddOptionalParameter("compaction_parallelism")
+      .AddOptionalParameter("fs_data_dirs")
+      .AddOptionalParameter("fs_metadata_dir")
+      .AddOptionalParameter("fs_wal_dir")
+      .Build();
+
   unique_ptr<Action> list =
       ActionBuilder("list", &ListLocalReplicas)
       .Description("Show list of tablet replicas in the local filesystem")
@@ -828,6 +1008,7 @@ unique_ptr<Mode> BuildLocalReplicaMode() {
   return ModeBuilder("local_replica")
       .Description("Operate on local tablet replicas via the local filesystem")
       .AddMode(std::move(cmeta))
+      .AddAction(std::move(compact))
       .AddAction(std::move(copy_from_remote))
       .AddAction(std::move(data_size))
       .AddAction(std::move(delete_local_replica))
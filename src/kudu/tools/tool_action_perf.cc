@@ -162,16 +162,67 @@
 //      |  | thread2 +---------+
 //      |  |         | tabletC |
 //      v  +---------+         v
+//
+//
+// The 'ycsb' action runs workloads modeled after the YCSB benchmark: it
+// loads a table, then runs a mix of reads, updates, inserts, scans and
+// read-modify-writes, and reports the latency percentiles of each type of
+// operation. For example, to run YCSB workload A (50% reads, 50% updates,
+// zipfian distribution) on 1M rows with 16 threads at 20000 operations per
+// second:
+//
+//   kudu perf ycsb 127.0.0.1 \
+//     --num_threads=16 \
+//     --ycsb_record_count=1000000 \
+//     --ycsb_operation_count=1000000 \
+//     --ycsb_read_proportion=0.5 \
+//     --ycsb_update_proportion=0.5 \
+//     --ycsb_request_distribution=zipfian \
+//     --ycsb_target_ops_per_sec=20000
+//
+// With a target throughput, operations are issued on a fixed schedule and
+// their latencies include the time they were delayed by slower previous
+// operations, so that the results aren't skewed by coordinated omission.
+//
+// The 'table_scan' action scans a table, one scan token per tablet, and
+// breaks down the time spent scanning each tablet and reading each column
+// into the phases reported by the tablet servers: I/O, decompression,
+// decoding, delta application, predicate evaluation and serialization. The
+// difference between the wall time of the client and the time the servers
+// spent serving its requests is the time spent queued or in the network:
+//
+//   kudu perf table_scan 127.0.0.1 my_table \
+//     --num_threads=4 \
+//     --scan_columns=key,string_val
+//
+// The 'wal' action appends entries to the write-ahead logs of tablets in a
+// new file system under the given directory, using the same Log class as the
+// tablet servers, and reports the append throughput and the latency
+// percentiles of the appends until they're durable. It sweeps every
+// combination of entry size, group commit wait, compression codec and number
+// of concurrently appending tablets, which makes it suitable for qualifying
+// the disks and file systems the WALs are to be placed on:
+//
+//   kudu perf wal /data/wal \
+//     --wal_entry_sizes=256,4096,65536 \
+//     --wal_group_commit_max_waits_us=0,1000 \
+//     --wal_compression_codecs=none,LZ4 \
+//     --wal_num_tablets=1,16
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <set>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -183,30 +234,52 @@
 #include <glog/logging.h>
 
 #include "kudu/client/client.h"
+#include "kudu/client/resource_metrics.h"
 #include "kudu/client/scan_batch.h"
 #include "kudu/client/schema.h"
+#include "kudu/client/scan_predicate.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/value.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/log.h"
+#include "kudu/consensus/log_util.h"
+#include "kudu/consensus/opid.pb.h"
+#include "kudu/consensus/ref_counted_replicate.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/strcat.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tools/tool_action.h"
 #include "kudu/tools/tool_action_common.h"
 #include "kudu/util/decimal_util.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_validators.h"
+#include "kudu/util/hdr_histogram.h"
 #include "kudu/util/int128.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/oid_generator.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
+#include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/semaphore.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 
 using kudu::ColumnSchema;
+using kudu::HdrHistogram;
 using kudu::KuduPartialRow;
 using kudu::Stopwatch;
 using kudu::TypeInfo;
@@ -215,20 +288,30 @@ using kudu::client::KuduClientBuilder;
 using kudu::client::KuduColumnSchema;
 using kudu::client::KuduError;
 using kudu::client::KuduInsert;
+using kudu::client::KuduPredicate;
 using kudu::client::KuduScanBatch;
+using kudu::client::KuduScanToken;
+using kudu::client::KuduScanTokenBuilder;
 using kudu::client::KuduScanner;
 using kudu::client::KuduSchema;
 using kudu::client::KuduSchemaBuilder;
 using kudu::client::KuduSession;
 using kudu::client::KuduTable;
 using kudu::client::KuduTableCreator;
+using kudu::client::KuduUpdate;
+using kudu::client::KuduValue;
+using kudu::client::KuduWriteOperation;
 using kudu::client::sp::shared_ptr;
+using kudu::consensus::ReplicateRefPtr;
+using kudu::log::Log;
+using kudu::log::LogOptions;
 using std::accumulate;
 using std::cerr;
 using std::cout;
 using std::endl;
 using std::lock_guard;
 using std::mutex;
+using std::map;
 using std::numeric_limits;
 using std::ostringstream;
 using std::string;
@@ -300,6 +383,8 @@ DEFINE_string(auto_database, "default",
               "not created. This flag is useful primarily when the Hive Metastore "
               "integration is enabled in the cluster. If empty, no database is "
               "used.");
+DECLARE_string(log_compression_codec);
+DECLARE_int32(log_group_commit_max_wait_us);
 DECLARE_string(table_name);
 DEFINE_int32(table_num_hash_partitions, 8,
              "The number of hash partitions to create when this tool creates "
@@ -319,12 +404,105 @@ DEFINE_bool(use_random, false,
             "Whether to use random numbers instead of sequential ones. "
             "In case of using random numbers collisions are possible over "
             "the data for columns with unique constraint (e.g. primary key).");
+DEFINE_bool(use_upsert, false,
+            "Whether to write the generated rows with UPSERT operations instead "
+            "of INSERT. Running again with the same '--seq_start' and "
+            "'--num_rows_per_thread' then updates the rows written by the "
+            "previous run instead of failing on duplicate keys.");
+
+DEFINE_uint64(ycsb_record_count, 100000,
+              "Number of rows 'perf ycsb' inserts into the table before "
+              "running the workload. The workload reads, updates and scans "
+              "these rows, as well as the rows it inserts itself.");
+DEFINE_bool(ycsb_skip_load, false,
+            "Whether 'perf ycsb' skips inserting the initial rows, e.g. to "
+            "run another workload against a table kept from a previous run "
+            "with the same '--ycsb_record_count'.");
+DEFINE_uint64(ycsb_operation_count, 100000,
+              "Number of operations 'perf ycsb' runs, in total across all "
+              "the threads.");
+DEFINE_double(ycsb_read_proportion, 0.5,
+              "Proportion of 'perf ycsb' operations which read a single row.");
+DEFINE_double(ycsb_update_proportion, 0.5,
+              "Proportion of 'perf ycsb' operations which update a field of "
+              "a single row.");
+DEFINE_double(ycsb_insert_proportion, 0.0,
+              "Proportion of 'perf ycsb' operations which insert a new row.");
+DEFINE_double(ycsb_scan_proportion, 0.0,
+              "Proportion of 'perf ycsb' operations which scan a range of rows.");
+DEFINE_double(ycsb_read_modify_write_proportion, 0.0,
+              "Proportion of 'perf ycsb' operations which read a single row "
+              "and then update a field of it.");
+DEFINE_string(ycsb_request_distribution, "zipfian",
+              "How 'perf ycsb' picks the rows that operations access: "
+              "'uniform' picks all rows equally often; 'zipfian' picks a few "
+              "popular rows, scattered across the key space, most of the "
+              "time; 'latest' is like 'zipfian' with the most recently "
+              "inserted rows being the most popular.");
+DEFINE_double(ycsb_zipfian_constant, 0.99,
+              "The skew of the 'zipfian' and 'latest' request distributions "
+              "of 'perf ycsb', in (0, 1). The larger, the more skewed.");
+DEFINE_int32(ycsb_field_count, 10,
+             "Number of string fields in the rows of the table that "
+             "'perf ycsb' creates.");
+DEFINE_int32(ycsb_field_length, 100,
+             "Length of the values 'perf ycsb' writes into the fields, or "
+             "with '--ycsb_field_length_distribution=uniform' their maximum "
+             "length.");
+DEFINE_string(ycsb_field_length_distribution, "constant",
+              "The distribution of the lengths of the values 'perf ycsb' "
+              "writes into the fields: 'constant' or 'uniform'.");
+DEFINE_int32(ycsb_max_scan_length, 100,
+             "Maximum number of rows a 'perf ycsb' scan reads. The length of "
+             "each scan is picked uniformly at random.");
+DEFINE_double(ycsb_target_ops_per_sec, 0,
+              "Throughput, in operations per second across all the threads, "
+              "at which 'perf ycsb' issues operations. If set, operations are "
+              "issued on a fixed schedule regardless of how long the previous "
+              "ones took, and their latencies are measured from their "
+              "scheduled start, so that stalls of the cluster are fully "
+              "accounted for. If 0, each thread issues its next operation as "
+              "soon as the previous one completes.");
+
+DEFINE_string(scan_columns, "",
+              "Comma-separated list of the columns 'perf table_scan' reads. "
+              "If empty, all the columns are read.");
+DEFINE_bool(scan_fill_cache, true,
+            "Whether the blocks read by 'perf table_scan' are put into the "
+            "block cache of the tablet servers. Disable it to measure scans "
+            "which miss the cache, once the cache doesn't hold the table "
+            "anymore.");
+
+DEFINE_string(wal_entry_sizes, "256,4096,65536",
+              "Comma-separated list of the sizes, in bytes, of the payloads "
+              "of the entries 'perf wal' appends.");
+DEFINE_string(wal_group_commit_max_waits_us, "0,1000",
+              "Comma-separated list of the values of "
+              "--log_group_commit_max_wait_us 'perf wal' runs with.");
+DEFINE_string(wal_compression_codecs, "none,LZ4",
+              "Comma-separated list of the codecs 'perf wal' compresses the "
+              "WAL segments with.");
+DEFINE_string(wal_num_tablets, "1,8",
+              "Comma-separated list of the numbers of tablets whose WALs "
+              "'perf wal' appends to concurrently, each from its own thread.");
+DEFINE_int32(wal_entries_per_tablet, 5000,
+             "Number of entries 'perf wal' appends to the WAL of each tablet.");
+DEFINE_int32(wal_max_outstanding_appends, 8,
+             "Maximum number of appends to the WAL of each tablet which "
+             "'perf wal' keeps in flight, as the leader of a busy tablet does.");
+DEFINE_bool(wal_fsync, true,
+            "Whether 'perf wal' syncs the WALs after every group of entries, "
+            "as with --log_force_fsync_all. Disable it to measure appends "
+            "which are only written to the page cache, as with the default "
+            "configuration of the tablet servers.");
 
 namespace kudu {
 namespace tools {
 
 namespace {
 
+const char* const kTableNameArg = "table_name";
+
 bool ValidatePartitionFlags() {
   int num_tablets = FLAGS_table_num_hash_partitions * FLAGS_table_num_range_partitions;
   if (num_tablets <= 1) {
@@ -505,10 +683,15 @@ void GeneratorThread(
     const int64_t gen_seed = gen_idx * gen_span + gen_seq_start;
     Generator gen(gen_mode, gen_seed, FLAGS_string_len);
     for (; num_rows_per_gen == 0 || idx < num_rows_per_gen; ++idx) {
-      unique_ptr<KuduInsert> insert_op(table->NewInsert());
-      RETURN_NOT_OK(GenerateRowData(&gen, insert_op->mutable_row(),
+      unique_ptr<KuduWriteOperation> write_op;
+      if (FLAGS_use_upsert) {
+        write_op.reset(table->NewUpsert());
+      } else {
+        write_op.reset(table->NewInsert());
+      }
+      RETURN_NOT_OK(GenerateRowData(&gen, write_op->mutable_row(),
                                    FLAGS_string_fixed));
-      RETURN_NOT_OK(session->Apply(insert_op.release()));
+      RETURN_NOT_OK(session->Apply(write_op.release()));
       if (flush_per_n_rows != 0 && idx != 0 && idx % flush_per_n_rows == 0) {
         session->FlushAsync(nullptr);
       }
@@ -744,6 +927,978 @@ Status TestLoadGenerator(const RunnerContext& context) {
   return Status::OK();
 }
 
+// The operations of a 'perf ycsb' workload.
+enum class YcsbOp {
+  READ,
+  UPDATE,
+  INSERT,
+  SCAN,
+  READ_MODIFY_WRITE,
+};
+constexpr int kNumYcsbOps = 5;
+
+const char* YcsbOpToString(YcsbOp op) {
+  switch (op) {
+    case YcsbOp::READ: return "READ";
+    case YcsbOp::UPDATE: return "UPDATE";
+    case YcsbOp::INSERT: return "INSERT";
+    case YcsbOp::SCAN: return "SCAN";
+    case YcsbOp::READ_MODIFY_WRITE: return "READ_MODIFY_WRITE";
+  }
+  LOG(FATAL) << "unknown op";
+  return nullptr;
+}
+
+// Generates integers in [0, num_items) where the probability of 'i' is
+// proportional to 1 / (i + 1)^theta, with the algorithm of "Quickly
+// Generating Billion-Record Synthetic Databases" by Gray et al., as YCSB does.
+//
+// Setting up the generator takes time linear in the number of items, so it is
+// done once and copied into each thread. The number of items may grow, which
+// only costs the time to account for the new items.
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(uint64_t num_items, double theta)
+      : theta_(theta),
+        alpha_(1.0 / (1.0 - theta)),
+        zeta2_(Zeta(0, 2, 0)),
+        num_items_(0),
+        zetan_(0),
+        eta_(0) {
+    SetNumItems(num_items);
+  }
+
+  void SetNumItems(uint64_t num_items) {
+    DCHECK_GE(num_items, num_items_);
+    if (num_items == num_items_) {
+      return;
+    }
+    zetan_ = Zeta(num_items_, num_items, zetan_);
+    num_items_ = num_items;
+    eta_ = (1 - pow(2.0 / num_items_, 1 - theta_)) / (1 - zeta2_ / zetan_);
+  }
+
+  uint64_t Next(Random* random) {
+    const double u = random->NextDoubleFraction();
+    const double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + pow(0.5, theta_)) {
+      return 1;
+    }
+    return std::min(num_items_ - 1,
+                    static_cast<uint64_t>(num_items_ * pow(eta_ * u - eta_ + 1, alpha_)));
+  }
+
+ private:
+  // Returns 'base' plus the sum of 1 / i^theta for 'i' in (from, to].
+  double Zeta(uint64_t from, uint64_t to, double base) const {
+    for (uint64_t i = from + 1; i <= to; i++) {
+      base += 1.0 / pow(static_cast<double>(i), theta_);
+    }
+    return base;
+  }
+
+  const double theta_;
+  const double alpha_;
+  const double zeta2_;
+  uint64_t num_items_;
+  double zetan_;
+  double eta_;
+};
+
+// Returns the 64-bit FNV-1a hash of 'val', used to scatter the popular items
+// of the 'zipfian' distribution across the key space.
+uint64_t FnvHash64(uint64_t val) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (int i = 0; i < 8; i++) {
+    hash ^= val & 0xff;
+    hash *= 1099511628211ULL;
+    val >>= 8;
+  }
+  return hash;
+}
+
+// The latency histograms and error counts of each operation type of a
+// 'perf ycsb' workload, shared by all its threads.
+class YcsbStats {
+ public:
+  // The highest latency the histograms track; higher ones are recorded as
+  // this value.
+  static constexpr uint64_t kMaxLatencyUs = 60 * 1000 * 1000;
+
+  YcsbStats() {
+    for (int i = 0; i < kNumYcsbOps; i++) {
+      latencies_[i].reset(new HdrHistogram(kMaxLatencyUs, 3));
+      errors_[i] = 0;
+    }
+  }
+
+  void Record(YcsbOp op, const MonoDelta& latency, const Status& s) {
+    const int idx = static_cast<int>(op);
+    latencies_[idx]->Increment(
+        std::min<uint64_t>(std::max<int64_t>(latency.ToMicroseconds(), 0), kMaxLatencyUs));
+    if (PREDICT_FALSE(!s.ok())) {
+      if (errors_[idx]++ < static_cast<uint64_t>(std::max(FLAGS_show_first_n_errors, 0))) {
+        lock_guard<mutex> lock(cerr_lock);
+        cerr << YcsbOpToString(op) << " error: " << s.ToString() << endl;
+      }
+    }
+  }
+
+  uint64_t total_errors() const {
+    uint64_t total = 0;
+    for (int i = 0; i < kNumYcsbOps; i++) {
+      total += errors_[i];
+    }
+    return total;
+  }
+
+  void Report(double wall_secs) const {
+    uint64_t total_ops = 0;
+    for (int i = 0; i < kNumYcsbOps; i++) {
+      total_ops += latencies_[i]->TotalCount();
+    }
+    cout << endl << "Workload report" << endl
+         << "  time total  : " << wall_secs * 1000 << " ms" << endl
+         << "  operations  : " << total_ops << endl;
+    if (wall_secs > 0) {
+      cout << "  throughput  : " << total_ops / wall_secs << " ops/sec" << endl;
+    }
+    for (int i = 0; i < kNumYcsbOps; i++) {
+      const HdrHistogram& h = *latencies_[i];
+      if (h.TotalCount() == 0) {
+        continue;
+      }
+      cout << "  " << YcsbOpToString(static_cast<YcsbOp>(i)) << endl
+           << "    operations  : " << h.TotalCount() << endl
+           << "    errors      : " << errors_[i] << endl
+           << "    latency (us): mean " << h.MeanValue()
+           << ", min " << h.MinValue()
+           << ", p50 " << h.ValueAtPercentile(50)
+           << ", p95 " << h.ValueAtPercentile(95)
+           << ", p99 " << h.ValueAtPercentile(99)
+           << ", p99.9 " << h.ValueAtPercentile(99.9)
+           << ", max " << h.MaxValue() << endl;
+    }
+  }
+
+ private:
+  unique_ptr<HdrHistogram> latencies_[kNumYcsbOps];
+  std::atomic<uint64_t> errors_[kNumYcsbOps];
+};
+
+constexpr uint64_t YcsbStats::kMaxLatencyUs;
+
+// The parameters and the shared state of a 'perf ycsb' workload.
+struct YcsbWorkload {
+  YcsbWorkload(string table_name, uint64_t record_count)
+      : table_name(std::move(table_name)),
+        zipfian(std::max<uint64_t>(record_count, 1), FLAGS_ycsb_zipfian_constant),
+        record_count(record_count),
+        next_insert_key(record_count),
+        num_inserted(record_count) {
+  }
+
+  const string table_name;
+
+  // The names of the key column and of the fields of the table.
+  string key_column;
+  vector<string> fields;
+
+  // The cumulative proportions of the operations, indexed by YcsbOp.
+  double cumulative_proportions[kNumYcsbOps];
+
+  // The generator which each thread copies to pick the rows to access with
+  // the 'zipfian' and 'latest' distributions.
+  ZipfianGenerator zipfian;
+
+  // The number of rows inserted by the load phase.
+  const uint64_t record_count;
+
+  // Records that the insert of the row with 'key' completed. Inserts may
+  // complete out of order, so the rows whose keys are below 'num_inserted'
+  // only grow once all the inserts of lower keys completed.
+  void AcknowledgeInsert(uint64_t key) {
+    lock_guard<mutex> l(insert_lock);
+    if (key != num_inserted) {
+      acknowledged_keys.insert(key);
+      return;
+    }
+    uint64_t limit = key + 1;
+    while (!acknowledged_keys.empty() && *acknowledged_keys.begin() == limit) {
+      acknowledged_keys.erase(acknowledged_keys.begin());
+      limit++;
+    }
+    num_inserted = limit;
+  }
+
+  // The key of the next row to insert, and the number of rows, counted from
+  // the first one, which are known to be inserted (both by the load phase and
+  // by the workload).
+  std::atomic<uint64_t> next_insert_key;
+  std::atomic<uint64_t> num_inserted;
+
+  // The keys above 'num_inserted' whose inserts completed.
+  mutex insert_lock;
+  std::set<uint64_t> acknowledged_keys;
+};
+
+// Runs 'num_ops' operations of 'workload' and records them into 'stats'.
+class YcsbRunner {
+ public:
+  YcsbRunner(const shared_ptr<KuduClient>& client,
+             YcsbWorkload* workload,
+             int thread_idx,
+             YcsbStats* stats)
+      : client_(client),
+        workload_(workload),
+        stats_(stats),
+        random_(thread_idx + 1),
+        zipfian_(workload->zipfian) {
+    // Values are random substrings of a buffer of random characters.
+    for (int i = 0; i < FLAGS_ycsb_field_length * 2 + 1; i++) {
+      value_buf_.push_back(static_cast<char>(' ' + random_.Uniform(95)));
+    }
+  }
+
+  Status Run(uint64_t num_ops) {
+    session_ = client_->NewSession();
+    RETURN_NOT_OK(session_->SetFlushMode(KuduSession::AUTO_FLUSH_SYNC));
+    RETURN_NOT_OK(client_->OpenTable(workload_->table_name, &table_));
+
+    // In open loop, operation 'i' is scheduled 'i' intervals after the start.
+    const int64_t interval_nanos = FLAGS_ycsb_target_ops_per_sec > 0 ?
+        FLAGS_num_threads * 1e9 / FLAGS_ycsb_target_ops_per_sec : 0;
+    const MonoTime start = MonoTime::Now();
+    for (uint64_t i = 0; i < num_ops; i++) {
+      MonoTime op_start;
+      if (interval_nanos > 0) {
+        op_start = start + MonoDelta::FromNanoseconds(interval_nanos * i);
+        MonoTime now = MonoTime::Now();
+        if (now < op_start) {
+          SleepFor(op_start - now);
+        }
+      } else {
+        op_start = MonoTime::Now();
+      }
+      YcsbOp op = NextOp();
+      Status s = RunOp(op);
+      stats_->Record(op, MonoTime::Now() - op_start, s);
+    }
+    return Status::OK();
+  }
+
+ private:
+  YcsbOp NextOp() {
+    const double r = random_.NextDoubleFraction();
+    for (int i = 0; i < kNumYcsbOps - 1; i++) {
+      if (r < workload_->cumulative_proportions[i]) {
+        return static_cast<YcsbOp>(i);
+      }
+    }
+    return static_cast<YcsbOp>(kNumYcsbOps - 1);
+  }
+
+  // Returns the key of an existing row, following --ycsb_request_distribution.
+  int64_t NextKey() {
+    const uint64_t num_items = std::max<uint64_t>(workload_->num_inserted, 1);
+    if (FLAGS_ycsb_request_distribution == "uniform") {
+      return random_.Uniform64(num_items);
+    }
+    if (FLAGS_ycsb_request_distribution == "latest") {
+      zipfian_.SetNumItems(num_items);
+      return num_items - 1 - zipfian_.Next(&random_);
+    }
+    // Only the rows loaded initially are popular, as in YCSB.
+    return FnvHash64(zipfian_.Next(&random_)) % std::max<uint64_t>(workload_->record_count, 1);
+  }
+
+  Slice NextValue() {
+    int len = FLAGS_ycsb_field_length;
+    if (FLAGS_ycsb_field_length_distribution == "uniform") {
+      len = 1 + random_.Uniform(FLAGS_ycsb_field_length);
+    }
+    return Slice(&value_buf_[random_.Uniform(FLAGS_ycsb_field_length + 1)], len);
+  }
+
+  Status RunOp(YcsbOp op) {
+    switch (op) {
+      case YcsbOp::READ:
+        return Read(NextKey());
+      case YcsbOp::UPDATE:
+        return Update(NextKey());
+      case YcsbOp::INSERT: {
+        const uint64_t key = workload_->next_insert_key++;
+        Status s = Insert(key);
+        workload_->AcknowledgeInsert(key);
+        return s;
+      }
+      case YcsbOp::SCAN:
+        return Scan(NextKey(), 1 + random_.Uniform(FLAGS_ycsb_max_scan_length));
+      case YcsbOp::READ_MODIFY_WRITE: {
+        const int64_t key = NextKey();
+        RETURN_NOT_OK(Read(key));
+        return Update(key);
+      }
+    }
+    LOG(FATAL) << "unknown op";
+    return Status::OK();
+  }
+
+  Status Read(int64_t key) {
+    KuduScanner scanner(table_.get());
+    RETURN_NOT_OK(scanner.AddConjunctPredicate(table_->NewComparisonPredicate(
+        workload_->key_column, KuduPredicate::EQUAL, KuduValue::FromInt(key))));
+    return DrainScanner(&scanner);
+  }
+
+  Status Scan(int64_t start_key, int64_t length) {
+    KuduScanner scanner(table_.get());
+    RETURN_NOT_OK(scanner.AddConjunctPredicate(table_->NewComparisonPredicate(
+        workload_->key_column, KuduPredicate::GREATER_EQUAL, KuduValue::FromInt(start_key))));
+    RETURN_NOT_OK(scanner.SetLimit(length));
+    return DrainScanner(&scanner);
+  }
+
+  Status DrainScanner(KuduScanner* scanner) {
+    RETURN_NOT_OK(scanner->Open());
+    KuduScanBatch batch;
+    while (scanner->HasMoreRows()) {
+      RETURN_NOT_OK(scanner->NextBatch(&batch));
+    }
+    return Status::OK();
+  }
+
+  // Updates a random field of the row, as YCSB does by default.
+  Status Update(int64_t key) {
+    unique_ptr<KuduUpdate> update(table_->NewUpdate());
+    KuduPartialRow* row = update->mutable_row();
+    RETURN_NOT_OK(row->SetInt64(workload_->key_column, key));
+    const string& field = workload_->fields[random_.Uniform(workload_->fields.size())];
+    RETURN_NOT_OK(row->SetStringNoCopy(field, NextValue()));
+    return ApplyAndCollectError(update.release());
+  }
+
+  Status Insert(int64_t key) {
+    unique_ptr<KuduInsert> insert(table_->NewInsert());
+    KuduPartialRow* row = insert->mutable_row();
+    RETURN_NOT_OK(row->SetInt64(workload_->key_column, key));
+    for (const auto& field : workload_->fields) {
+      RETURN_NOT_OK(row->SetStringNoCopy(field, NextValue()));
+    }
+    return ApplyAndCollectError(insert.release());
+  }
+
+  // Applies 'op' to the synchronous session, returning the error of the
+  // operation if it failed.
+  Status ApplyAndCollectError(KuduWriteOperation* op) {
+    Status s = session_->Apply(op);
+    if (!s.ok()) {
+      vector<KuduError*> errors;
+      ElementDeleter d(&errors);
+      session_->GetPendingErrors(&errors, nullptr);
+      if (!errors.empty()) {
+        return errors.front()->status();
+      }
+    }
+    return s;
+  }
+
+  const shared_ptr<KuduClient> client_;
+  YcsbWorkload* const workload_;
+  YcsbStats* const stats_;
+  Random random_;
+  ZipfianGenerator zipfian_;
+  string value_buf_;
+  shared_ptr<KuduSession> session_;
+  shared_ptr<KuduTable> table_;
+};
+
+// Inserts the rows of the 'perf ycsb' load phase whose keys are in
+// [start_key, end_key).
+Status YcsbLoad(const shared_ptr<KuduClient>& client, const YcsbWorkload& workload,
+                int64_t start_key, int64_t end_key, uint64_t* err_count) {
+  shared_ptr<KuduSession> session(client->NewSession());
+  RETURN_NOT_OK(session->SetMutationBufferFlushWatermark(FLAGS_buffer_flush_watermark_pct));
+  RETURN_NOT_OK(session->SetMutationBufferSpace(FLAGS_buffer_size_bytes));
+  RETURN_NOT_OK(session->SetMutationBufferMaxNum(FLAGS_buffers_num));
+  RETURN_NOT_OK(session->SetErrorBufferSpace(FLAGS_error_buffer_size_bytes));
+  RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  shared_ptr<KuduTable> table;
+  RETURN_NOT_OK(client->OpenTable(workload.table_name, &table));
+
+  Random random(start_key);
+  string value;
+  for (int64_t key = start_key; key < end_key; key++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    KuduPartialRow* row = insert->mutable_row();
+    RETURN_NOT_OK(row->SetInt64(workload.key_column, key));
+    for (const auto& field : workload.fields) {
+      int len = FLAGS_ycsb_field_length;
+      if (FLAGS_ycsb_field_length_distribution == "uniform") {
+        len = 1 + random.Uniform(FLAGS_ycsb_field_length);
+      }
+      value.clear();
+      for (int i = 0; i < len; i++) {
+        value.push_back(static_cast<char>(' ' + random.Uniform(95)));
+      }
+      RETURN_NOT_OK(row->SetString(field, value));
+    }
+    RETURN_NOT_OK(session->Apply(insert.release()));
+  }
+  Status s = session->Flush();
+  *err_count = session->CountPendingErrors();
+  return s;
+}
+
+// Checks the 'perf ycsb' flags, and sets the cumulative proportions of the
+// operations of 'workload'.
+Status ValidateYcsbFlags(YcsbWorkload* workload) {
+  const double proportions[kNumYcsbOps] = {
+    FLAGS_ycsb_read_proportion,
+    FLAGS_ycsb_update_proportion,
+    FLAGS_ycsb_insert_proportion,
+    FLAGS_ycsb_scan_proportion,
+    FLAGS_ycsb_read_modify_write_proportion,
+  };
+  double total = 0;
+  for (double p : proportions) {
+    if (p < 0) {
+      return Status::InvalidArgument("operation proportions must not be negative");
+    }
+    total += p;
+  }
+  if (total <= 0) {
+    return Status::InvalidArgument("at least one operation proportion must be positive");
+  }
+  double cumulative = 0;
+  for (int i = 0; i < kNumYcsbOps; i++) {
+    cumulative += proportions[i] / total;
+    workload->cumulative_proportions[i] = cumulative;
+  }
+
+  if (FLAGS_ycsb_request_distribution != "uniform" &&
+      FLAGS_ycsb_request_distribution != "zipfian" &&
+      FLAGS_ycsb_request_distribution != "latest") {
+    return Status::InvalidArgument("unknown request distribution",
+                                   FLAGS_ycsb_request_distribution);
+  }
+  if (FLAGS_ycsb_zipfian_constant <= 0 || FLAGS_ycsb_zipfian_constant >= 1) {
+    return Status::InvalidArgument("the zipfian constant must be in (0, 1)");
+  }
+  if (FLAGS_ycsb_field_length_distribution != "constant" &&
+      FLAGS_ycsb_field_length_distribution != "uniform") {
+    return Status::InvalidArgument("unknown field length distribution",
+                                   FLAGS_ycsb_field_length_distribution);
+  }
+  if (FLAGS_ycsb_field_count <= 0 || FLAGS_ycsb_field_length <= 0 ||
+      FLAGS_ycsb_max_scan_length <= 0) {
+    return Status::InvalidArgument(
+        "the field count, the field length and the maximum scan length must be positive");
+  }
+  if (FLAGS_ycsb_target_ops_per_sec < 0) {
+    return Status::InvalidArgument("the target throughput must not be negative");
+  }
+  if (FLAGS_num_threads <= 0) {
+    return Status::InvalidArgument("the number of threads must be positive");
+  }
+  return Status::OK();
+}
+
+Status TestYcsb(const RunnerContext& context) {
+  const string& master_addresses_str =
+      FindOrDie(context.required_args, kMasterAddressesArg);
+  vector<string> master_addrs(strings::Split(master_addresses_str, ","));
+  shared_ptr<KuduClient> client;
+  RETURN_NOT_OK(KuduClientBuilder()
+                .master_server_addrs(master_addrs)
+                .Build(&client));
+
+  static const string kKeyColumnName = "key";
+  bool is_auto_table = false;
+  string table_name = FLAGS_table_name;
+  if (table_name.empty()) {
+    if (FLAGS_ycsb_skip_load) {
+      return Status::InvalidArgument("--ycsb_skip_load requires --table_name");
+    }
+    is_auto_table = true;
+    ObjectIdGenerator oid_generator;
+    table_name = Substitute("$0ycsb_auto_$1",
+        FLAGS_auto_database.empty() ? "" : FLAGS_auto_database + ".",
+        oid_generator.Next());
+  }
+  YcsbWorkload workload(table_name, FLAGS_ycsb_record_count);
+  RETURN_NOT_OK(ValidateYcsbFlags(&workload));
+
+  if (is_auto_table) {
+    KuduSchema schema;
+    KuduSchemaBuilder b;
+    b.AddColumn(kKeyColumnName)->Type(KuduColumnSchema::INT64)->NotNull()->PrimaryKey();
+    for (int i = 0; i < FLAGS_ycsb_field_count; i++) {
+      b.AddColumn(Substitute("field$0", i))->Type(KuduColumnSchema::STRING);
+    }
+    RETURN_NOT_OK(b.Build(&schema));
+
+    unique_ptr<KuduTableCreator> table_creator(client->NewTableCreator());
+    table_creator->table_name(table_name)
+                  .schema(&schema);
+    if (FLAGS_table_num_replicas > 0) {
+      table_creator->num_replicas(FLAGS_table_num_replicas);
+    }
+    if (FLAGS_table_num_range_partitions > 1) {
+      // Split the rows of the load phase evenly across the ranges.
+      const int64_t span_per_range =
+          std::max<int64_t>(FLAGS_ycsb_record_count / FLAGS_table_num_range_partitions, 1);
+      table_creator->set_range_partition_columns({ kKeyColumnName });
+      for (int i = 1; i < FLAGS_table_num_range_partitions; i++) {
+        unique_ptr<KuduPartialRow> split(schema.NewRow());
+        RETURN_NOT_OK(split->SetInt64(kKeyColumnName, i * span_per_range));
+        table_creator->add_range_partition_split(split.release());
+      }
+    }
+    if (FLAGS_table_num_hash_partitions > 1) {
+      table_creator->add_hash_partitions(
+          vector<string>({ kKeyColumnName }), FLAGS_table_num_hash_partitions);
+    }
+    RETURN_NOT_OK(table_creator->Create());
+  }
+  cout << "Using " << (is_auto_table ? "auto-created " : "")
+       << "table '" << table_name << "'" << endl;
+
+  // The first column is the key; all the other ones are fields.
+  {
+    shared_ptr<KuduTable> table;
+    RETURN_NOT_OK(client->OpenTable(table_name, &table));
+    const KuduSchema& schema = table->schema();
+    if (schema.num_columns() < 2 ||
+        schema.Column(0).type() != KuduColumnSchema::INT64) {
+      return Status::InvalidArgument(
+          "the table must have an INT64 key column followed by STRING columns");
+    }
+    workload.key_column = schema.Column(0).name();
+    for (int i = 1; i < schema.num_columns(); i++) {
+      if (schema.Column(i).type() != KuduColumnSchema::STRING) {
+        return Status::InvalidArgument(
+            "the table must have an INT64 key column followed by STRING columns");
+      }
+      workload.fields.push_back(schema.Column(i).name());
+    }
+  }
+
+  const int num_threads = FLAGS_num_threads;
+  if (!FLAGS_ycsb_skip_load) {
+    vector<Status> statuses(num_threads);
+    vector<uint64_t> err_counts(num_threads, 0);
+    vector<thread> threads;
+    Stopwatch sw(Stopwatch::ALL_THREADS);
+    sw.start();
+    for (int i = 0; i < num_threads; i++) {
+      const int64_t start_key = FLAGS_ycsb_record_count * i / num_threads;
+      const int64_t end_key = FLAGS_ycsb_record_count * (i + 1) / num_threads;
+      threads.emplace_back([&, i, start_key, end_key]() {
+          statuses[i] = YcsbLoad(client, workload, start_key, end_key, &err_counts[i]);
+        });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    sw.stop();
+    cout << endl << "Load report" << endl
+         << "  rows        : " << FLAGS_ycsb_record_count << endl
+         << "  time total  : " << sw.elapsed().wall_millis() << " ms" << endl;
+    for (const auto& s : statuses) {
+      RETURN_NOT_OK_PREPEND(s, "could not load the table");
+    }
+    const uint64_t total_err_count = accumulate(err_counts.begin(), err_counts.end(), 0UL);
+    if (total_err_count != 0) {
+      return Status::RuntimeError(
+          Substitute("Encountered $0 errors while loading the table", total_err_count));
+    }
+  }
+
+  YcsbStats stats;
+  vector<Status> statuses(num_threads);
+  vector<thread> threads;
+  Stopwatch sw(Stopwatch::ALL_THREADS);
+  sw.start();
+  for (int i = 0; i < num_threads; i++) {
+    const uint64_t num_ops = FLAGS_ycsb_operation_count * (i + 1) / num_threads -
+                             FLAGS_ycsb_operation_count * i / num_threads;
+    threads.emplace_back([&, i, num_ops]() {
+        YcsbRunner runner(client, &workload, i, &stats);
+        statuses[i] = runner.Run(num_ops);
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  sw.stop();
+  stats.Report(sw.elapsed().wall_seconds());
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK_PREPEND(s, "could not run the workload");
+  }
+  if (stats.total_errors() != 0) {
+    return Status::RuntimeError(
+        Substitute("Encountered $0 operation errors", stats.total_errors()));
+  }
+
+  if (is_auto_table && !FLAGS_keep_auto_table) {
+    cout << "Dropping auto-created table '" << table_name << "'" << endl;
+    RETURN_NOT_OK(client->DeleteTable(table_name));
+  }
+  return Status::OK();
+}
+
+// The phases the tablet servers break the time spent reading the rows of a
+// scan down into, by the names of their resource metrics.
+const char* const kScanPhaseMetrics[] = {
+  "io_nanos",
+  "decompress_nanos",
+  "decode_nanos",
+  "delta_apply_nanos",
+  "predicate_eval_nanos",
+};
+
+// The result of scanning a tablet with 'perf table_scan'.
+struct TabletScanResult {
+  string tablet_id;
+  uint64_t rows = 0;
+  int64_t wall_nanos = 0;
+  map<string, int64_t> metrics;
+};
+
+string NanosToMillis(int64_t nanos) {
+  return StringPrintf("%.3f", static_cast<double>(nanos) / 1000000);
+}
+
+// Scans the tablet of 'token' into 'result'.
+Status ScanTablet(KuduScanToken* token, TabletScanResult* result) {
+  KuduScanner* scanner_ptr;
+  RETURN_NOT_OK(token->IntoKuduScanner(&scanner_ptr));
+  unique_ptr<KuduScanner> scanner(scanner_ptr);
+  RETURN_NOT_OK(scanner->SetReportColumnMetrics(true));
+  result->tablet_id = token->tablet().id();
+
+  Stopwatch sw(Stopwatch::THIS_THREAD);
+  sw.start();
+  RETURN_NOT_OK(scanner->Open());
+  KuduScanBatch batch;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+    result->rows += batch.NumRows();
+  }
+  sw.stop();
+  result->wall_nanos = sw.elapsed().wall;
+  result->metrics = scanner->GetResourceMetrics().Get();
+  return Status::OK();
+}
+
+Status TableScan(const RunnerContext& context) {
+  const string& master_addresses_str =
+      FindOrDie(context.required_args, kMasterAddressesArg);
+  const string& table_name = FindOrDie(context.required_args, kTableNameArg);
+  vector<string> master_addrs(strings::Split(master_addresses_str, ","));
+  shared_ptr<KuduClient> client;
+  RETURN_NOT_OK(KuduClientBuilder()
+                .master_server_addrs(master_addrs)
+                .Build(&client));
+  shared_ptr<KuduTable> table;
+  RETURN_NOT_OK(client->OpenTable(table_name, &table));
+
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  KuduScanTokenBuilder builder(table.get());
+  if (!FLAGS_scan_columns.empty()) {
+    RETURN_NOT_OK(builder.SetProjectedColumnNames(
+        strings::Split(FLAGS_scan_columns, ",", strings::SkipEmpty())));
+  }
+  RETURN_NOT_OK(builder.SetCacheBlocks(FLAGS_scan_fill_cache));
+  RETURN_NOT_OK(builder.Build(&tokens));
+
+  // Each thread scans the next tablet nobody has scanned yet.
+  vector<TabletScanResult> results(tokens.size());
+  vector<Status> statuses(tokens.size());
+  std::atomic<size_t> next_token(0);
+  vector<thread> threads;
+  Stopwatch sw(Stopwatch::ALL_THREADS);
+  sw.start();
+  for (int i = 0; i < FLAGS_num_threads; i++) {
+    threads.emplace_back([&]() {
+        for (size_t idx = next_token++; idx < tokens.size(); idx = next_token++) {
+          statuses[idx] = ScanTablet(tokens[idx], &results[idx]);
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  sw.stop();
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK_PREPEND(s, "could not scan the table");
+  }
+
+  // The time the servers spent reading each tablet, and the time the client
+  // waited on top of it.
+  DataTable tablets({ "Tablet ID", "Rows", "Wall (ms)", "Server (ms)",
+                      "Network+queue (ms)", "I/O (ms)", "Decompress (ms)",
+                      "Decode (ms)", "Delta apply (ms)", "Predicate eval (ms)",
+                      "Serialize (ms)", "CPU user (ms)", "CPU system (ms)" });
+  // The time spent reading each column, summed over the tablets.
+  map<string, map<string, int64_t>> metrics_by_column;
+  uint64_t total_rows = 0;
+  for (const auto& result : results) {
+    const int64_t server_nanos = FindWithDefault(result.metrics, "total_duration_nanos", 0);
+    vector<string> row = { result.tablet_id,
+                           std::to_string(result.rows),
+                           NanosToMillis(result.wall_nanos),
+                           NanosToMillis(server_nanos),
+                           NanosToMillis(std::max<int64_t>(result.wall_nanos - server_nanos, 0)) };
+    for (const char* phase : kScanPhaseMetrics) {
+      row.emplace_back(NanosToMillis(FindWithDefault(result.metrics, phase, 0)));
+    }
+    for (const char* metric : { "serialize_nanos", "cpu_user_nanos", "cpu_system_nanos" }) {
+      row.emplace_back(NanosToMillis(FindWithDefault(result.metrics, metric, 0)));
+    }
+    tablets.AddRow(std::move(row));
+    total_rows += result.rows;
+
+    // Column metrics are named 'column.<column name>.<metric>'.
+    for (const auto& name_and_value : result.metrics) {
+      const string& name = name_and_value.first;
+      const size_t metric_start = name.rfind('.');
+      if (!HasPrefixString(name, "column.") || metric_start <= strlen("column.")) {
+        continue;
+      }
+      const string column = name.substr(strlen("column."), metric_start - strlen("column."));
+      metrics_by_column[column][name.substr(metric_start + 1)] += name_and_value.second;
+    }
+  }
+  RETURN_NOT_OK(tablets.PrintTo(cout));
+  cout << endl;
+
+  DataTable columns({ "Column", "Cells read", "Bytes read", "I/O (ms)",
+                      "Decompress (ms)", "Decode (ms)", "Delta apply (ms)",
+                      "Predicate eval (ms)" });
+  for (const auto& column_and_metrics : metrics_by_column) {
+    const auto& metrics = column_and_metrics.second;
+    vector<string> row = { column_and_metrics.first,
+                           std::to_string(FindWithDefault(metrics, "cells_read", 0)),
+                           std::to_string(FindWithDefault(metrics, "bytes_read", 0)) };
+    for (const char* phase : kScanPhaseMetrics) {
+      row.emplace_back(NanosToMillis(FindWithDefault(metrics, phase, 0)));
+    }
+    columns.AddRow(std::move(row));
+  }
+  RETURN_NOT_OK(columns.PrintTo(cout));
+  cout << endl;
+
+  cout << Substitute("Scanned $0 rows of $1 tablets in $2 seconds",
+                     total_rows, tokens.size(), sw.elapsed().wall_seconds()) << endl;
+  return Status::OK();
+}
+
+// Appends entries to the WAL of a tablet for 'perf wal', keeping up to
+// --wal_max_outstanding_appends of them in flight.
+class WalWriter {
+ public:
+  WalWriter(Log* log, const string* payload, HdrHistogram* latency_us)
+      : log_(log),
+        payload_(payload),
+        latency_us_(latency_us),
+        outstanding_(FLAGS_wal_max_outstanding_appends) {
+  }
+
+  void Run() {
+    for (int64_t index = 1; index <= FLAGS_wal_entries_per_tablet; index++) {
+      outstanding_.Acquire();
+      ReplicateRefPtr replicate =
+          consensus::make_scoped_refptr_replicate(new consensus::ReplicateMsg());
+      replicate->get()->mutable_id()->set_term(1);
+      replicate->get()->mutable_id()->set_index(index);
+      replicate->get()->set_op_type(consensus::NO_OP);
+      replicate->get()->set_timestamp(index);
+      replicate->get()->mutable_noop_request()->set_payload_for_tests(*payload_);
+      Status s = log_->AsyncAppendReplicates(
+          { replicate }, Bind(&WalWriter::AppendDone, Unretained(this), MonoTime::Now()));
+      if (!s.ok()) {
+        outstanding_.Release();
+        SetStatus(s);
+        break;
+      }
+    }
+    // Wait for the appends still in flight.
+    for (int i = 0; i < FLAGS_wal_max_outstanding_appends; i++) {
+      outstanding_.Acquire();
+    }
+  }
+
+  Status status() {
+    lock_guard<mutex> l(lock_);
+    return status_;
+  }
+
+ private:
+  void AppendDone(MonoTime start, const Status& s) {
+    latency_us_->Increment((MonoTime::Now() - start).ToMicroseconds());
+    if (!s.ok()) {
+      SetStatus(s);
+    }
+    outstanding_.Release();
+  }
+
+  void SetStatus(const Status& s) {
+    lock_guard<mutex> l(lock_);
+    if (status_.ok()) {
+      status_ = s;
+    }
+  }
+
+  Log* const log_;
+  const string* const payload_;
+  HdrHistogram* const latency_us_;
+  Semaphore outstanding_;
+
+  mutex lock_;
+  Status status_;
+};
+
+// Runs one configuration of 'perf wal', appending to the WALs of 'num_tablets'
+// new tablets concurrently, and adds its results to 'table'.
+Status RunWalBenchmark(FsManager* fs_manager, int entry_bytes, int max_wait_us,
+                       const string& codec, int num_tablets, DataTable* table) {
+  FLAGS_log_compression_codec = codec;
+  FLAGS_log_group_commit_max_wait_us = max_wait_us;
+  LogOptions opts;
+  opts.force_fsync_all = FLAGS_wal_fsync;
+  SchemaBuilder schema_builder;
+  RETURN_NOT_OK(schema_builder.AddKeyColumn("key", INT64));
+  const Schema schema = schema_builder.Build();
+
+  ObjectIdGenerator oid_generator;
+  vector<string> tablet_ids;
+  vector<scoped_refptr<Log>> logs;
+  SCOPED_CLEANUP({
+    for (size_t i = 0; i < logs.size(); i++) {
+      WARN_NOT_OK(logs[i]->Close(), "could not close WAL");
+      WARN_NOT_OK(Log::DeleteOnDiskData(fs_manager, tablet_ids[i]),
+                  "could not delete WAL");
+    }
+  });
+  for (int i = 0; i < num_tablets; i++) {
+    const string tablet_id = oid_generator.Next();
+    scoped_refptr<Log> log;
+    RETURN_NOT_OK(Log::Open(opts, fs_manager, tablet_id, schema, 0, nullptr, &log));
+    tablet_ids.push_back(tablet_id);
+    logs.emplace_back(std::move(log));
+  }
+
+  // Entries of random letters, which compress about as well as typical rows.
+  Random rng(entry_bytes);
+  string payload(entry_bytes, '\0');
+  for (auto& c : payload) {
+    c = static_cast<char>('a' + rng.Uniform(26));
+  }
+
+  HdrHistogram latency_us(60 * 1000 * 1000, 3);
+  vector<unique_ptr<WalWriter>> writers;
+  for (const auto& log : logs) {
+    writers.emplace_back(new WalWriter(log.get(), &payload, &latency_us));
+  }
+  vector<thread> threads;
+  Stopwatch sw;
+  sw.start();
+  for (auto& writer : writers) {
+    threads.emplace_back(&WalWriter::Run, writer.get());
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  sw.stop();
+  for (auto& writer : writers) {
+    RETURN_NOT_OK_PREPEND(writer->status(), "could not append to WAL");
+  }
+
+  const double sec = sw.elapsed().wall_seconds();
+  const int64_t num_entries = static_cast<int64_t>(num_tablets) * FLAGS_wal_entries_per_tablet;
+  table->AddRow({ std::to_string(entry_bytes),
+                  std::to_string(max_wait_us),
+                  codec,
+                  std::to_string(num_tablets),
+                  StringPrintf("%.0f", num_entries / sec),
+                  StringPrintf("%.2f", num_entries * entry_bytes / (1024.0 * 1024.0) / sec),
+                  std::to_string(latency_us.ValueAtPercentile(50)),
+                  std::to_string(latency_us.ValueAtPercentile(99)),
+                  std::to_string(latency_us.ValueAtPercentile(99.9)),
+                  std::to_string(latency_us.MaxValue()) });
+  return Status::OK();
+}
+
+// Parses a comma-separated list of positive integers from the flag named
+// 'flag_name' with value 'value' into 'out'.
+Status ParseIntList(const char* flag_name, const string& value, vector<int>* out) {
+  for (const auto& s : strings::Split(value, ",", strings::SkipEmpty())) {
+    int v;
+    if (!safe_strto32(s.data(), s.size(), &v) || v < 0) {
+      return Status::InvalidArgument(
+          Substitute("invalid value for --$0: $1", flag_name, value));
+    }
+    out->push_back(v);
+  }
+  if (out->empty()) {
+    return Status::InvalidArgument(Substitute("--$0 must not be empty", flag_name));
+  }
+  return Status::OK();
+}
+
+Status WalBenchmark(const RunnerContext& context) {
+  const string& wal_dir = FindOrDie(context.required_args, "wal_dir");
+  vector<int> entry_sizes;
+  vector<int> max_waits_us;
+  vector<int> num_tablets;
+  RETURN_NOT_OK(ParseIntList("wal_entry_sizes", FLAGS_wal_entry_sizes, &entry_sizes));
+  RETURN_NOT_OK(ParseIntList("wal_group_commit_max_waits_us",
+                             FLAGS_wal_group_commit_max_waits_us, &max_waits_us));
+  RETURN_NOT_OK(ParseIntList("wal_num_tablets", FLAGS_wal_num_tablets, &num_tablets));
+  vector<string> codecs = strings::Split(FLAGS_wal_compression_codecs, ",",
+                                         strings::SkipEmpty());
+  if (codecs.empty()) {
+    return Status::InvalidArgument("--wal_compression_codecs must not be empty");
+  }
+  if (FLAGS_wal_max_outstanding_appends < 1) {
+    return Status::InvalidArgument("--wal_max_outstanding_appends must be positive");
+  }
+
+  // Run in a new file system under the WAL directory, so as to leave alone
+  // whatever else is in there.
+  Env* env = Env::Default();
+  const string root = JoinPathSegments(wal_dir,
+                                       Substitute("kudu-perf-wal-$0", ObjectIdGenerator().Next()));
+  FsManager fs_manager(env, FsManagerOpts(root));
+  RETURN_NOT_OK(fs_manager.CreateInitialFileSystemLayout());
+  SCOPED_CLEANUP({
+    WARN_NOT_OK(env->DeleteRecursively(root), "could not delete " + root);
+  });
+  RETURN_NOT_OK(fs_manager.Open());
+
+  DataTable table({ "Entry bytes", "Group commit wait (us)", "Codec", "Tablets",
+                    "Entries/s", "MB/s", "p50 (us)", "p99 (us)", "p999 (us)", "Max (us)" });
+  for (int entry_bytes : entry_sizes) {
+    for (int max_wait_us : max_waits_us) {
+      for (const string& codec : codecs) {
+        for (int tablets : num_tablets) {
+          RETURN_NOT_OK_PREPEND(
+              RunWalBenchmark(&fs_manager, entry_bytes, max_wait_us, codec, tablets, &table),
+              Substitute("could not run with $0-byte entries, $1us group commit wait, "
+                         "codec $2 and $3 tablets", entry_bytes, max_wait_us, codec, tablets));
+        }
+      }
+    }
+  }
+  return table.PrintTo(cout);
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildPerfMode() {
@@ -790,11 +1945,105 @@ unique_ptr<Mode> BuildPerfMode() {
       .AddOptionalParameter("table_num_range_partitions")
       .AddOptionalParameter("table_num_replicas")
       .AddOptionalParameter("use_random")
+      .AddOptionalParameter("use_upsert")
+      .Build();
+
+  unique_ptr<Action> ycsb =
+      ActionBuilder("ycsb", &TestYcsb)
+      .Description("Run a YCSB-style workload of mixed operations")
+      .ExtraDescription(
+          "Load a table with rows, then run a workload mixing reads, updates, "
+          "inserts, scans and read-modify-writes of rows picked following a "
+          "uniform, zipfian or latest distribution, as the YCSB benchmark "
+          "does. Operations are issued either as fast as possible or at a "
+          "target throughput, and the latency percentiles of each type of "
+          "operation are reported.")
+      .AddRequiredParameter({ kMasterAddressesArg,
+          "Comma-separated list of master addresses to run against. "
+          "Addresses are in 'hostname:port' form where port may be omitted "
+          "if a master server listens at the default port." })
+      .AddOptionalParameter("auto_database")
+      .AddOptionalParameter("buffer_flush_watermark_pct")
+      .AddOptionalParameter("buffer_size_bytes")
+      .AddOptionalParameter("buffers_num")
+      .AddOptionalParameter("error_buffer_size_bytes")
+      .AddOptionalParameter("keep_auto_table")
+      .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("show_first_n_errors")
+      .AddOptionalParameter("table_name", boost::none, string(
+          "Name of an existing table to run the workload against. Its first "
+          "column must be an INT64 primary key and all its other columns must "
+          "be STRING columns. If left empty, the tool creates a table with "
+          "'--ycsb_field_count' fields, which is dropped upon successful "
+          "completion unless '--keep_auto_table' is set."))
+      .AddOptionalParameter("table_num_hash_partitions")
+      .AddOptionalParameter("table_num_range_partitions")
+      .AddOptionalParameter("table_num_replicas")
+      .AddOptionalParameter("ycsb_field_count")
+      .AddOptionalParameter("ycsb_field_length")
+      .AddOptionalParameter("ycsb_field_length_distribution")
+      .AddOptionalParameter("ycsb_insert_proportion")
+      .AddOptionalParameter("ycsb_max_scan_length")
+      .AddOptionalParameter("ycsb_operation_count")
+      .AddOptionalParameter("ycsb_read_modify_write_proportion")
+      .AddOptionalParameter("ycsb_read_proportion")
+      .AddOptionalParameter("ycsb_record_count")
+      .AddOptionalParameter("ycsb_request_distribution")
+      .AddOptionalParameter("ycsb_scan_proportion")
+      .AddOptionalParameter("ycsb_skip_load")
+      .AddOptionalParameter("ycsb_target_ops_per_sec")
+      .AddOptionalParameter("ycsb_update_proportion")
+      .AddOptionalParameter("ycsb_zipfian_constant")
+      .Build();
+
+  unique_ptr<Action> table_scan =
+      ActionBuilder("table_scan", &TableScan)
+      .Description("Scan a table and break down where the time went")
+      .ExtraDescription(
+          "Scan all the rows of a table, one tablet at a time per thread, and "
+          "report how the time spent scanning each tablet and reading each "
+          "column splits into I/O, decompression, decoding, delta "
+          "application, predicate evaluation and serialization at the tablet "
+          "servers, and into the time spent queued or in the network.")
+      .AddRequiredParameter({ kMasterAddressesArg,
+          "Comma-separated list of master addresses to run against. "
+          "Addresses are in 'hostname:port' form where port may be omitted "
+          "if a master server listens at the default port." })
+      .AddRequiredParameter({ kTableNameArg, "Name of the table to scan" })
+      .AddOptionalParameter("format")
+      .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("scan_columns")
+      .AddOptionalParameter("scan_fill_cache")
+      .Build();
+
+  unique_ptr<Action> wal =
+      ActionBuilder("wal", &WalBenchmark)
+      .Description("Measure the throughput and latency of WAL appends")
+      .ExtraDescription(
+          "Append entries to the write-ahead logs of tablets in a new file "
+          "system under the given directory, sweeping the combinations of "
+          "entry size, group commit wait, compression codec and number of "
+          "concurrently appending tablets, and report the append throughput "
+          "and the latency percentiles of each combination. The new file "
+          "system is deleted once done.")
+      .AddRequiredParameter({ "wal_dir",
+          "Directory, on the disk to measure, to create the WALs in" })
+      .AddOptionalParameter("format")
+      .AddOptionalParameter("wal_compression_codecs")
+      .AddOptionalParameter("wal_entries_per_tablet")
+      .AddOptionalParameter("wal_entry_sizes")
+      .AddOptionalParameter("wal_fsync")
+      .AddOptionalParameter("wal_group_commit_max_waits_us")
+      .AddOptionalParameter("wal_max_outstanding_appends")
+      .AddOptionalParameter("wal_num_tablets")
       .Build();
 
   return ModeBuilder("perf")
       .Description("Measure the performance of a Kudu cluster")
       .AddAction(std::move(insert))
+      .AddAction(std::move(ycsb))
+      .AddAction(std::move(table_scan))
+      .AddAction(std::move(wal))
       .Build();
 }
 
@@ -17,6 +17,7 @@
 
 #include "kudu/tserver/heartbeater.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <memory>
@@ -51,6 +52,7 @@
 #include "kudu/security/token_verifier.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/webserver.h"
+#include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/tablet_server_options.h"
 #include "kudu/tserver/ts_tablet_manager.h"
@@ -100,6 +102,14 @@ DEFINE_uint32(heartbeat_inject_required_feature_flag, 0,
 TAG_FLAG(heartbeat_inject_required_feature_flag, runtime);
 TAG_FLAG(heartbeat_inject_required_feature_flag, unsafe);
 
+DEFINE_int32(heartbeat_max_tablets_per_report, 1000,
+             "Maximum number of tablets reported in a single heartbeat. Tablets "
+             "beyond it, e.g. when a full report of a dense server is requested, "
+             "are reported in the following heartbeats, the ones which have "
+             "waited the longest first. 0 means no limit.");
+TAG_FLAG(heartbeat_max_tablets_per_report, advanced);
+TAG_FLAG(heartbeat_max_tablets_per_report, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 
 using kudu::consensus::ReplicaManagementInfoPB;
@@ -110,6 +120,7 @@ using kudu::master::TabletReportPB;
 using kudu::pb_util::SecureDebugString;
 using kudu::rpc::ErrorStatusPB;
 using kudu::rpc::RpcController;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -170,8 +181,18 @@ class Heartbeater::Thread {
   Status DoHeartbeat(MasterErrorPB* error, ErrorStatusPB* error_status);
   Status SetupRegistration(ServerRegistrationPB* reg);
   void SetupCommonField(master::TSToMasterCommonPB* common);
+  void SetupLoad(master::TServerLoadPB* load);
   bool IsCurrentThread() const;
 
+  // Sets 'tablet_ids' to the dirty tablets to include in the report with
+  // sequence number 'report_seq': all of them, or the
+  // --heartbeat_max_tablets_per_report which have been dirty the longest.
+  // The others are marked as changed since that report, so that
+  // acknowledging it leaves them dirty.
+  //
+  // Must be called with 'dirty_tablets_lock_' held.
+  void CollectTabletsToReportUnlocked(int32_t report_seq, vector<string>* tablet_ids);
+
   // The host and port of the master that this thread will heartbeat to.
   //
   // We keep the HostPort around rather than a Sockaddr because the
@@ -195,12 +216,24 @@ class Heartbeater::Thread {
   // This is tracked so as to back-off heartbeating.
   int consecutive_failed_heartbeats_;
 
+  // The numbers of rows written to and scanned from the live tablets as of
+  // the previous heartbeat, and the time they were collected. Used to report
+  // the load as rates over the heartbeat interval.
+  int64_t last_rows_written_;
+  int64_t last_rows_scanned_;
+  MonoTime last_load_time_;
+
   // Each tablet report is assigned a sequence number, so that subsequent
   // tablet reports only need to re-report those tablets which have
   // changed since the last report. Each tablet tracks the sequence
   // number at which it became dirty.
   struct TabletReportState {
+    // Sequence number as of the tablet's latest change.
     int32_t change_seq;
+
+    // Sequence number as of which the tablet has been dirty, used to report
+    // the tablets which have waited the longest first.
+    int32_t dirty_seq;
   };
   typedef std::unordered_map<std::string, TabletReportState> DirtyMap;
 
@@ -325,6 +358,8 @@ Heartbeater::Thread::Thread(HostPort master_address, TabletServer* server)
   : master_address_(std::move(master_address)),
     server_(server),
     consecutive_failed_heartbeats_(0),
+    last_rows_written_(0),
+    last_rows_scanned_(0),
     next_report_seq_(0),
     cond_(&mutex_),
     should_run_(false),
@@ -352,6 +387,35 @@ void Heartbeater::Thread::SetupCommonField(master::TSToMasterCommonPB* common) {
   common->mutable_ts_instance()->CopyFrom(server_->instance_pb());
 }
 
+void Heartbeater::Thread::SetupLoad(master::TServerLoadPB* load) {
+  int64_t on_disk_size;
+  int64_t rows_written;
+  int64_t rows_scanned;
+  server_->tablet_manager()->GetLiveTabletsLoad(&on_disk_size, &rows_written, &rows_scanned);
+  const MonoTime now = MonoTime::Now();
+  load->set_on_disk_size(on_disk_size);
+
+  // The totals only cover the tablets which are currently live, so they may
+  // decrease when a tablet goes away; report no activity in that case.
+  double rows_written_per_sec = 0;
+  double rows_scanned_per_sec = 0;
+  if (last_load_time_.Initialized()) {
+    const double elapsed_sec = (now - last_load_time_).ToSeconds();
+    if (elapsed_sec > 0) {
+      rows_written_per_sec =
+          std::max<int64_t>(rows_written - last_rows_written_, 0) / elapsed_sec;
+      rows_scanned_per_sec =
+          std::max<int64_t>(rows_scanned - last_rows_scanned_, 0) / elapsed_sec;
+    }
+  }
+  load->set_rows_written_per_sec(rows_written_per_sec);
+  load->set_rows_scanned_per_sec(rows_scanned_per_sec);
+
+  last_rows_written_ = rows_written;
+  last_rows_scanned_ = rows_scanned;
+  last_load_time_ = now;
+}
+
 Status Heartbeater::Thread::SetupRegistration(ServerRegistrationPB* reg) {
   reg->Clear();
 
@@ -482,6 +546,7 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
     GenerateIncrementalTabletReport(req.mutable_tablet_report());
   }
   req.set_num_live_tablets(server_->tablet_manager()->GetNumLiveTablets());
+  SetupLoad(req.mutable_load());
 
   VLOG(2) << "Sending heartbeat:\n" << SecureDebugString(req);
   master::TSHeartbeatResponsePB resp;
@@ -688,29 +753,90 @@ void Heartbeater::Thread::MarkTabletDirty(const string& tablet_id, const string&
     CHECK_GE(seqno, state->change_seq);
     state->change_seq = seqno;
   } else {
-    TabletReportState state = { seqno };
+    TabletReportState state = { seqno, seqno };
     InsertOrDie(&dirty_tablets_, tablet_id, state);
   }
 }
 
+void Heartbeater::Thread::CollectTabletsToReportUnlocked(int32_t report_seq,
+                                                         vector<string>* tablet_ids) {
+  DCHECK(dirty_tablets_lock_.is_locked());
+  tablet_ids->clear();
+  const int max_tablets = FLAGS_heartbeat_max_tablets_per_report;
+  if (max_tablets <= 0 || dirty_tablets_.size() <= static_cast<size_t>(max_tablets)) {
+    AppendKeysFromMap(dirty_tablets_, tablet_ids);
+    return;
+  }
+
+  vector<pair<const string*, TabletReportState*>> dirty;
+  dirty.reserve(dirty_tablets_.size());
+  for (auto& e : dirty_tablets_) {
+    dirty.emplace_back(&e.first, &e.second);
+  }
+  std::nth_element(dirty.begin(), dirty.begin() + max_tablets, dirty.end(),
+                   [](const pair<const string*, TabletReportState*>& a,
+                      const pair<const string*, TabletReportState*>& b) {
+                     return a.second->dirty_seq < b.second->dirty_seq;
+                   });
+  tablet_ids->reserve(max_tablets);
+  for (int i = 0; i < max_tablets; i++) {
+    tablet_ids->push_back(*dirty[i].first);
+  }
+  // A sequence number past this report's is at most 'next_report_seq_', so
+  // MarkTabletDirty() still sees change sequence numbers never go backwards.
+  for (size_t i = max_tablets; i < dirty.size(); i++) {
+    TabletReportState* state = dirty[i].second;
+    state->change_seq = std::max(state->change_seq, report_seq + 1);
+  }
+}
+
 void Heartbeater::Thread::GenerateIncrementalTabletReport(TabletReportPB* report) {
   report->Clear();
-  report->set_sequence_number(next_report_seq_.fetch_add(1));
+  std::unique_lock<simple_spinlock> l(dirty_tablets_lock_);
+  const int32_t seqno = next_report_seq_.fetch_add(1);
+  report->set_sequence_number(seqno);
   report->set_is_incremental(true);
   vector<string> dirty_tablet_ids;
-  {
-    std::lock_guard<simple_spinlock> l(dirty_tablets_lock_);
-    AppendKeysFromMap(dirty_tablets_, &dirty_tablet_ids);
-  }
+  CollectTabletsToReportUnlocked(seqno, &dirty_tablet_ids);
+  l.unlock();
   server_->tablet_manager()->PopulateIncrementalTabletReport(
       report, dirty_tablet_ids);
 }
 
 void Heartbeater::Thread::GenerateFullTabletReport(TabletReportPB* report) {
   report->Clear();
-  report->set_sequence_number(next_report_seq_.fetch_add(1));
+  const int max_tablets = FLAGS_heartbeat_max_tablets_per_report;
+  vector<scoped_refptr<tablet::TabletReplica>> replicas;
+  if (max_tablets > 0) {
+    server_->tablet_manager()->GetTabletReplicas(&replicas);
+  }
+  if (max_tablets <= 0 || replicas.size() <= static_cast<size_t>(max_tablets)) {
+    report->set_sequence_number(next_report_seq_.fetch_add(1));
+    report->set_is_incremental(false);
+    server_->tablet_manager()->PopulateFullTabletReport(report);
+    return;
+  }
+
+  // Too many tablets for a single report: spread the full report over this
+  // and the following heartbeats by marking every tablet dirty, as of this
+  // report, and reporting the dirty tablets a batch at a time.
+  std::unique_lock<simple_spinlock> l(dirty_tablets_lock_);
+  const int32_t seqno = next_report_seq_.fetch_add(1);
+  report->set_sequence_number(seqno);
   report->set_is_incremental(false);
-  server_->tablet_manager()->PopulateFullTabletReport(report);
+  for (const auto& replica : replicas) {
+    TabletReportState* state = FindOrNull(dirty_tablets_, replica->tablet_id());
+    if (state != nullptr) {
+      state->change_seq = std::max(state->change_seq, seqno);
+    } else {
+      TabletReportState state = { seqno, seqno };
+      InsertOrDie(&dirty_tablets_, replica->tablet_id(), state);
+    }
+  }
+  vector<string> tablet_ids;
+  CollectTabletsToReportUnlocked(seqno, &tablet_ids);
+  l.unlock();
+  server_->tablet_manager()->PopulateIncrementalTabletReport(report, tablet_ids);
 }
 
 } // namespace tserver
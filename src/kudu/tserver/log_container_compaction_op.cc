@@ -0,0 +1,114 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/log_container_compaction_op.h"
+
+#include <ostream>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/fs/log_block_manager.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/status.h"
+
+DEFINE_bool(enable_log_container_compaction, false,
+            "Whether to rewrite the live blocks of log block containers that "
+            "are full but mostly dead into other containers, so that the "
+            "sparse containers can be deleted. A container is considered "
+            "sparse according to --log_container_live_metadata_before_compact_ratio "
+            "and --log_container_excess_space_before_cleanup_fraction.");
+TAG_FLAG(enable_log_container_compaction, runtime);
+TAG_FLAG(enable_log_container_compaction, experimental);
+
+DEFINE_int32(log_container_compaction_budget_mb, 128,
+             "The maximum amount of live block data, in MB, that a single run "
+             "of log block container compaction will move.");
+TAG_FLAG(log_container_compaction_budget_mb, runtime);
+TAG_FLAG(log_container_compaction_budget_mb, experimental);
+
+METRIC_DEFINE_gauge_uint32(server, log_container_compaction_running,
+                           "Log Block Container Compactions Running",
+                           kudu::MetricUnit::kMaintenanceOperations,
+                           "Number of log block container compactions currently running.");
+
+METRIC_DEFINE_histogram(server, log_container_compaction_duration,
+                        "Log Block Container Compaction Duration",
+                        kudu::MetricUnit::kMilliseconds,
+                        "Time spent compacting log block containers.", 60000LU, 1);
+
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+LogContainerCompactionOp::LogContainerCompactionOp(
+    fs::LogBlockManager* block_manager,
+    const scoped_refptr<MetricEntity>& metric_entity)
+    : MaintenanceOp("LogContainerCompactionOp", MaintenanceOp::HIGH_IO_USAGE),
+      block_manager_(block_manager),
+      duration_(METRIC_log_container_compaction_duration.Instantiate(metric_entity)),
+      running_(METRIC_log_container_compaction_running.Instantiate(metric_entity, 0)) {
+}
+
+void LogContainerCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
+  if (PREDICT_FALSE(!FLAGS_enable_log_container_compaction)) {
+    stats->set_runnable(false);
+    return;
+  }
+  int64_t sparse_containers;
+  int64_t total_containers;
+  int64_t sparse_live_bytes;
+  block_manager_->GetSparseContainerStats(&sparse_containers, &total_containers,
+                                          &sparse_live_bytes);
+  stats->set_runnable(sparse_containers > 0);
+  if (sparse_containers > 0) {
+    stats->set_perf_improvement(static_cast<double>(sparse_containers) / total_containers);
+  }
+}
+
+bool LogContainerCompactionOp::Prepare() {
+  // Nothing for us to do.
+  return true;
+}
+
+void LogContainerCompactionOp::Perform() {
+  int64_t containers_compacted;
+  int64_t blocks_moved;
+  Status s = block_manager_->CompactSparseContainers(
+      FLAGS_log_container_compaction_budget_mb * 1024LL * 1024LL,
+      &containers_compacted, &blocks_moved);
+  if (containers_compacted > 0) {
+    LOG(INFO) << Substitute("Compacted $0 log block containers ($1 blocks moved)",
+                            containers_compacted, blocks_moved);
+  }
+  WARN_NOT_OK(s, "Log block container compaction failed");
+}
+
+scoped_refptr<Histogram> LogContainerCompactionOp::DurationHistogram() const {
+  return duration_;
+}
+
+scoped_refptr<AtomicGauge<uint32_t>> LogContainerCompactionOp::RunningGauge() const {
+  return running_;
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,69 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/maintenance_manager.h"
+
+namespace kudu {
+
+class Histogram;
+class MetricEntity;
+template <class T>
+class AtomicGauge;
+
+namespace fs {
+class LogBlockManager;
+} // namespace fs
+
+namespace tserver {
+
+// MaintenanceOp that rewrites the live blocks of sparse log block containers
+// into other containers, so that the sparse containers (and their many
+// extents and metadata records) can be deleted.
+//
+// The fraction of containers that are sparse is used as the performance
+// improvement.
+class LogContainerCompactionOp : public MaintenanceOp {
+ public:
+  LogContainerCompactionOp(fs::LogBlockManager* block_manager,
+                           const scoped_refptr<MetricEntity>& metric_entity);
+
+  void UpdateStats(MaintenanceOpStats* stats) override;
+
+  bool Prepare() override;
+
+  void Perform() override;
+
+  scoped_refptr<Histogram> DurationHistogram() const override;
+
+  scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const override;
+
+ private:
+  fs::LogBlockManager* const block_manager_;
+
+  scoped_refptr<Histogram> duration_;
+  scoped_refptr<AtomicGauge<uint32_t>> running_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogContainerCompactionOp);
+};
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,121 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tserver/resource_pools.h"
+
+#include <string>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/metrics.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int64(resource_pool_write_budget_bytes);
+DECLARE_string(resource_pool_assignments);
+DECLARE_string(resource_pools);
+
+using std::string;
+
+namespace kudu {
+namespace tserver {
+
+class ResourcePoolsTest : public KuduTest {
+ protected:
+  MetricRegistry metric_registry_;
+};
+
+TEST_F(ResourcePoolsTest, TestResolve) {
+  FLAGS_resource_pools = "interactive:4,etl:1";
+  FLAGS_resource_pool_assignments = "table:orders=interactive,user:loader=etl";
+  ResourcePools pools(&metric_registry_);
+  ASSERT_OK(pools.Init());
+
+  ASSERT_EQ("interactive", pools.Resolve("orders", "alice")->name);
+  ASSERT_EQ(4, pools.Resolve("orders", "alice")->weight);
+  // The user's pool takes precedence over the table's.
+  ASSERT_EQ("etl", pools.Resolve("orders", "loader")->name);
+  ASSERT_EQ("etl", pools.Resolve("other", "loader")->name);
+  // The rest goes to the default pool.
+  ASSERT_EQ(ResourcePools::kDefaultPoolName, pools.Resolve("other", "alice")->name);
+  ASSERT_EQ(1, pools.Resolve("other", "alice")->weight);
+
+  ASSERT_EQ(4.0, pools.MaintenancePerfWeight("orders"));
+  ASSERT_EQ(1.0, pools.MaintenancePerfWeight("other"));
+}
+
+TEST_F(ResourcePoolsTest, TestInvalidFlags) {
+  auto check_invalid = [&](const string& pools_flag, const string& assignments_flag) {
+    FLAGS_resource_pools = pools_flag;
+    FLAGS_resource_pool_assignments = assignments_flag;
+    ResourcePools pools(&metric_registry_);
+    Status s = pools.Init();
+    ASSERT_TRUE(s.IsInvalidArgument()) << pools_flag << " " << assignments_flag
+                                       << ": " << s.ToString();
+  };
+  NO_FATALS(check_invalid("a", ""));
+  NO_FATALS(check_invalid("a:0", ""));
+  NO_FATALS(check_invalid("a:x", ""));
+  NO_FATALS(check_invalid("a:1,a:2", ""));
+  NO_FATALS(check_invalid("a:1", "table:t"));
+  NO_FATALS(check_invalid("a:1", "column:t=a"));
+  NO_FATALS(check_invalid("a:1", "table:t=b"));
+  NO_FATALS(check_invalid("a:1,b:1", "table:t=a,table:t=b"));
+}
+
+TEST_F(ResourcePoolsTest, TestWriteBudget) {
+  FLAGS_resource_pools = "a:3,b:1";
+  FLAGS_resource_pool_assignments = "table:ta=a,table:tb=b";
+  FLAGS_resource_pool_write_budget_bytes = 100;
+  ResourcePools pools(&metric_registry_);
+  ASSERT_OK(pools.Init());
+  ResourcePool* a = pools.Resolve("ta", "");
+  ResourcePool* b = pools.Resolve("tb", "");
+
+  // Pool "a" may use the whole budget while it's alone, but not more.
+  ASSERT_TRUE(pools.AdmitWrite(a, 90));
+  ASSERT_FALSE(pools.AdmitWrite(a, 20));
+
+  // A pool without writes in flight always gets one in, even over budget.
+  ASSERT_TRUE(pools.AdmitWrite(b, 50));
+
+  // Over budget, each pool is limited to its weighted share: 75 bytes for
+  // "a" and 25 for "b".
+  ASSERT_FALSE(pools.AdmitWrite(b, 10));
+  pools.ReleaseWrite(a, 90);
+  ASSERT_TRUE(pools.AdmitWrite(a, 50));
+  ASSERT_FALSE(pools.AdmitWrite(a, 30));
+
+  // Within the budget, writes are admitted regardless of the shares.
+  pools.ReleaseWrite(b, 50);
+  ASSERT_TRUE(pools.AdmitWrite(a, 30));
+  ASSERT_TRUE(pools.AdmitWrite(b, 20));
+  pools.ReleaseWrite(a, 50);
+  pools.ReleaseWrite(a, 30);
+  pools.ReleaseWrite(b, 20);
+
+  ASSERT_EQ(3, a->writes_admitted->value());
+  ASSERT_EQ(2, a->writes_rejected->value());
+  ASSERT_EQ(2, b->writes_admitted->value());
+  ASSERT_EQ(1, b->writes_rejected->value());
+  ASSERT_EQ(0, a->inflight_write_bytes->value());
+  ASSERT_EQ(0, b->inflight_write_bytes->value());
+}
+
+} // namespace tserver
+} // namespace kudu
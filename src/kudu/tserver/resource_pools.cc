@@ -0,0 +1,237 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tserver/resource_pools.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_string(resource_pools, "",
+              "Comma-separated list of the resource pools splitting the scan threads, "
+              "write budget and maintenance threads of this server, as "
+              "<name>:<weight> entries, e.g. 'interactive:4,etl:1'. The work which "
+              "isn't assigned to any pool goes to the 'default' pool, whose weight "
+              "is 1 unless it's listed. If empty, the resources aren't split.");
+TAG_FLAG(resource_pools, advanced);
+TAG_FLAG(resource_pools, experimental);
+
+DEFINE_string(resource_pool_assignments, "",
+              "Comma-separated list of the assignments of tables and users to the "
+              "pools of --resource_pools, as table:<table name>=<pool> or "
+              "user:<user name>=<pool> entries, e.g. 'table:orders=interactive,"
+              "user:etl=etl'. The pool of a user takes precedence over the pool of "
+              "the table.");
+TAG_FLAG(resource_pool_assignments, advanced);
+TAG_FLAG(resource_pool_assignments, experimental);
+
+DEFINE_int64(resource_pool_write_budget_bytes, 0,
+             "If greater than 0 and --resource_pools is set, the number of bytes of "
+             "writes which may be in flight on this server before the writes of the "
+             "pools using more than their weighted share of it are rejected as "
+             "throttled.");
+TAG_FLAG(resource_pool_write_budget_bytes, advanced);
+TAG_FLAG(resource_pool_write_budget_bytes, experimental);
+TAG_FLAG(resource_pool_write_budget_bytes, runtime);
+
+METRIC_DEFINE_entity(resource_pool);
+
+METRIC_DEFINE_counter(resource_pool, resource_pool_scans_run,
+                      "Scans Run",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan requests of the pool run by the scan threads");
+METRIC_DEFINE_histogram(resource_pool, resource_pool_scan_queue_time,
+                        "Scan Queue Time",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time the scan requests of the pool waited for a scan thread",
+                        60000000LU, 2);
+METRIC_DEFINE_counter(resource_pool, resource_pool_writes_admitted,
+                      "Writes Admitted",
+                      kudu::MetricUnit::kRequests,
+                      "Number of write requests of the pool admitted");
+METRIC_DEFINE_counter(resource_pool, resource_pool_writes_rejected,
+                      "Writes Rejected",
+                      kudu::MetricUnit::kRequests,
+                      "Number of write requests of the pool rejected because the pool "
+                      "used more than its share of --resource_pool_write_budget_bytes");
+METRIC_DEFINE_gauge_int64(resource_pool, resource_pool_inflight_write_bytes,
+                          "In-flight Write Bytes",
+                          kudu::MetricUnit::kBytes,
+                          "Number of bytes of the writes of the pool admitted and not "
+                          "applied yet");
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+const char* const ResourcePools::kDefaultPoolName = "default";
+
+ResourcePool::ResourcePool(string name, int weight, MetricRegistry* metric_registry)
+    : name(std::move(name)),
+      weight(weight) {
+  if (metric_registry) {
+    metric_entity = METRIC_ENTITY_resource_pool.Instantiate(metric_registry, this->name);
+    scans_run = METRIC_resource_pool_scans_run.Instantiate(metric_entity);
+    scan_queue_time = METRIC_resource_pool_scan_queue_time.Instantiate(metric_entity);
+    writes_admitted = METRIC_resource_pool_writes_admitted.Instantiate(metric_entity);
+    writes_rejected = METRIC_resource_pool_writes_rejected.Instantiate(metric_entity);
+    inflight_write_bytes =
+        METRIC_resource_pool_inflight_write_bytes.Instantiate(metric_entity, 0);
+  }
+}
+
+bool ResourcePools::Enabled() {
+  return !FLAGS_resource_pools.empty();
+}
+
+ResourcePools::ResourcePools(MetricRegistry* metric_registry)
+    : metric_registry_(metric_registry),
+      default_pool_(nullptr),
+      inflight_write_bytes_(0) {
+}
+
+Status ResourcePools::Init() {
+  for (StringPiece entry : strings::Split(FLAGS_resource_pools, ",", strings::SkipEmpty())) {
+    vector<string> fields = strings::Split(entry, ":");
+    int32_t weight;
+    if (fields.size() != 2 || fields[0].empty() ||
+        !safe_strto32(fields[1], &weight) || weight <= 0) {
+      return Status::InvalidArgument(Substitute(
+          "invalid resource pool '$0': expected <name>:<positive weight>", entry.ToString()));
+    }
+    if (ContainsKey(pools_, fields[0])) {
+      return Status::InvalidArgument(Substitute("duplicate resource pool '$0'", fields[0]));
+    }
+    string name = fields[0];
+    pools_.emplace(std::move(name),
+                   std::unique_ptr<ResourcePool>(
+                       new ResourcePool(fields[0], weight, metric_registry_)));
+  }
+  if (!ContainsKey(pools_, kDefaultPoolName)) {
+    pools_.emplace(kDefaultPoolName, std::unique_ptr<ResourcePool>(
+        new ResourcePool(kDefaultPoolName, 1, metric_registry_)));
+  }
+  default_pool_ = FindOrDie(pools_, kDefaultPoolName).get();
+
+  for (StringPiece entry : strings::Split(FLAGS_resource_pool_assignments, ",",
+                                          strings::SkipEmpty())) {
+    vector<string> fields = strings::Split(entry, strings::delimiter::Limit("=", 1));
+    vector<string> target = fields.empty() ? vector<string>() :
+        strings::Split(fields[0], strings::delimiter::Limit(":", 1));
+    if (fields.size() != 2 || target.size() != 2 || target[1].empty() ||
+        (target[0] != "table" && target[0] != "user")) {
+      return Status::InvalidArgument(Substitute(
+          "invalid resource pool assignment '$0': expected table:<name>=<pool> "
+          "or user:<name>=<pool>", entry.ToString()));
+    }
+    const auto* pool = FindOrNull(pools_, fields[1]);
+    if (!pool) {
+      return Status::InvalidArgument(Substitute(
+          "resource pool assignment '$0' refers to unknown pool '$1'",
+          entry.ToString(), fields[1]));
+    }
+    auto& assignments = target[0] == "table" ? table_pools_ : user_pools_;
+    if (!InsertIfNotPresent(&assignments, target[1], pool->get())) {
+      return Status::InvalidArgument(Substitute(
+          "$0 '$1' is assigned to more than one resource pool", target[0], target[1]));
+    }
+  }
+  return Status::OK();
+}
+
+ResourcePool* ResourcePools::Resolve(const string& table_name, const string& user) const {
+  ResourcePool* pool = FindPtrOrNull(user_pools_, user);
+  if (!pool) {
+    pool = FindPtrOrNull(table_pools_, table_name);
+  }
+  return pool ? pool : default_pool_;
+}
+
+double ResourcePools::MaintenancePerfWeight(const string& table_name) const {
+  const ResourcePool* pool = FindPtrOrNull(table_pools_, table_name);
+  return pool ? static_cast<double>(pool->weight) / default_pool_->weight : 1.0;
+}
+
+bool ResourcePools::AdmitWrite(ResourcePool* pool, int64_t bytes) {
+  // Charge empty writes a byte, so that the pools with writes in flight are
+  // those with bytes in flight.
+  bytes = std::max<int64_t>(bytes, 1);
+  const int64_t budget = FLAGS_resource_pool_write_budget_bytes;
+  {
+    std::lock_guard<simple_spinlock> l(write_lock_);
+    int64_t* pool_bytes = FindOrNull(pool_inflight_write_bytes_, pool);
+    // A pool without writes in flight is always admitted one, however large,
+    // so that no pool is starved.
+    if (budget > 0 && pool_bytes && inflight_write_bytes_ + bytes > budget) {
+      int64_t total_weight = 0;
+      for (const auto& e : pool_inflight_write_bytes_) {
+        total_weight += e.first->weight;
+      }
+      const int64_t share = budget * pool->weight / total_weight;
+      if (*pool_bytes + bytes > share) {
+        if (pool->writes_rejected) {
+          pool->writes_rejected->Increment();
+        }
+        return false;
+      }
+    }
+    inflight_write_bytes_ += bytes;
+    if (pool_bytes) {
+      *pool_bytes += bytes;
+    } else {
+      pool_inflight_write_bytes_.emplace(pool, bytes);
+    }
+  }
+  if (pool->writes_admitted) {
+    pool->writes_admitted->Increment();
+    pool->inflight_write_bytes->IncrementBy(bytes);
+  }
+  return true;
+}
+
+void ResourcePools::ReleaseWrite(ResourcePool* pool, int64_t bytes) {
+  bytes = std::max<int64_t>(bytes, 1);
+  {
+    std::lock_guard<simple_spinlock> l(write_lock_);
+    auto it = pool_inflight_write_bytes_.find(pool);
+    DCHECK(it != pool_inflight_write_bytes_.end());
+    inflight_write_bytes_ -= bytes;
+    it->second -= bytes;
+    DCHECK_GE(it->second, 0);
+    if (it->second == 0) {
+      pool_inflight_write_bytes_.erase(it);
+    }
+  }
+  if (pool->inflight_write_bytes) {
+    pool->inflight_write_bytes->DecrementBy(bytes);
+  }
+}
+
+} // namespace tserver
+} // namespace kudu
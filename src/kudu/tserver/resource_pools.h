@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace tserver {
+
+// A share of the resources of a tablet server, assigned to the scans, writes
+// and maintenance of some tables or users.
+struct ResourcePool {
+  ResourcePool(std::string name, int weight,
+               MetricRegistry* metric_registry);
+
+  const std::string name;
+
+  // The share of the pool relative to the other pools.
+  const int weight;
+
+  scoped_refptr<MetricEntity> metric_entity;
+  scoped_refptr<Counter> scans_run;
+  scoped_refptr<Histogram> scan_queue_time;
+  scoped_refptr<Counter> writes_admitted;
+  scoped_refptr<Counter> writes_rejected;
+  scoped_refptr<AtomicGauge<int64_t>> inflight_write_bytes;
+};
+
+// The resource pools of a tablet server, defined by --resource_pools, and
+// the assignment of tables and users to them, defined by
+// --resource_pool_assignments. Work which isn't assigned to any pool goes to
+// the "default" pool.
+//
+// The pools share:
+// - the scan threads, which take turns between the pools with queued scans,
+//   each pool getting as many turns in a row as its weight (see
+//   ScanScheduler);
+// - the bytes of writes being applied, if --resource_pool_write_budget_bytes
+//   is set: a write is admitted if it fits in the budget, or in the pool's
+//   weighted share of the budget among the pools with writes in flight, so a
+//   pool with heavy writes can't lock the others out;
+// - the maintenance threads, as the perf improvement of the background
+//   maintenance ops of a tablet counts in proportion to its pool's weight.
+//
+// This class is thread-safe.
+class ResourcePools {
+ public:
+  static const char* const kDefaultPoolName;
+
+  // Returns true if any pool is defined, i.e. the work of the server is to be
+  // split between pools.
+  static bool Enabled();
+
+  explicit ResourcePools(MetricRegistry* metric_registry);
+
+  // Parses the pool flags. Returns InvalidArgument if they're malformed.
+  Status Init();
+
+  // Returns the pool of the work of 'user' on the table 'table_name'. The
+  // pool assigned to the user takes precedence over the table's.
+  ResourcePool* Resolve(const std::string& table_name, const std::string& user) const;
+
+  // Returns the perf weight of the maintenance ops of the tablets of the
+  // table 'table_name': the weight of its pool relative to the default pool's.
+  double MaintenancePerfWeight(const std::string& table_name) const;
+
+  // Admits a write of 'bytes' bytes in 'pool', charging them to the pool
+  // until ReleaseWrite() is called. Returns false, without charging them, if
+  // the write doesn't fit in the write budget.
+  bool AdmitWrite(ResourcePool* pool, int64_t bytes);
+
+  // Releases the bytes charged by a successful AdmitWrite() call.
+  void ReleaseWrite(ResourcePool* pool, int64_t bytes);
+
+ private:
+  MetricRegistry* const metric_registry_;
+
+  std::unordered_map<std::string, std::unique_ptr<ResourcePool>> pools_;
+  ResourcePool* default_pool_;
+
+  // The pools assigned to users and to tables, by name.
+  std::unordered_map<std::string, ResourcePool*> user_pools_;
+  std::unordered_map<std::string, ResourcePool*> table_pools_;
+
+  // Protects the write accounting below.
+  simple_spinlock write_lock_;
+
+  // The bytes of the admitted writes which aren't released yet, in total and
+  // by pool. Only the pools with writes in flight are listed.
+  int64_t inflight_write_bytes_;
+  std::unordered_map<ResourcePool*, int64_t> pool_inflight_write_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResourcePools);
+};
+
+} // namespace tserver
+} // namespace kudu
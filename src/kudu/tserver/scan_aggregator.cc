@@ -0,0 +1,257 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_aggregator.h"
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+// Returns true if SUM, MIN and MAX may be computed over columns of 'type'.
+bool IsNumericType(DataType type) {
+  switch (type) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+    case UNIXTIME_MICROS:
+    case FLOAT:
+    case DOUBLE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // anonymous namespace
+
+Status ScanAggregator::AddAggregatedColumns(const RepeatedPtrField<AggregatePB>& pbs,
+                                            const Schema& tablet_schema,
+                                            const Schema& projection,
+                                            vector<ColumnSchema>* missing_cols) {
+  for (const AggregatePB& pb : pbs) {
+    if (!pb.has_column()) {
+      continue;
+    }
+    int col_idx = tablet_schema.find_column(pb.column());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("unknown column in aggregate", pb.column());
+    }
+    if (projection.find_column(pb.column()) != Schema::kColumnNotFound ||
+        std::any_of(missing_cols->begin(), missing_cols->end(),
+                    [&](const ColumnSchema& col) { return col.name() == pb.column(); })) {
+      continue;
+    }
+    missing_cols->push_back(tablet_schema.column(col_idx));
+  }
+  return Status::OK();
+}
+
+Status ScanAggregator::ResolveAggregates(const RepeatedPtrField<AggregatePB>& pbs,
+                                         const Schema& schema,
+                                         vector<Aggregate>* aggregates) {
+  vector<Aggregate> result;
+  for (const AggregatePB& pb : pbs) {
+    Aggregate agg;
+    agg.function = pb.function();
+    agg.col_idx = -1;
+    switch (agg.function) {
+      case AggregatePB::COUNT:
+      case AggregatePB::SUM:
+      case AggregatePB::MIN:
+      case AggregatePB::MAX:
+        break;
+      default:
+        return Status::InvalidArgument("unknown aggregate function",
+                                       AggregatePB::Function_Name(agg.function));
+    }
+    if (pb.has_column()) {
+      agg.col_idx = schema.find_column(pb.column());
+      if (agg.col_idx == Schema::kColumnNotFound) {
+        return Status::InvalidArgument("unknown column in aggregate", pb.column());
+      }
+    }
+    if (agg.function != AggregatePB::COUNT) {
+      if (agg.col_idx == -1) {
+        return Status::InvalidArgument(
+            Substitute("$0 requires a column", AggregatePB::Function_Name(agg.function)));
+      }
+      const ColumnSchema& col = schema.column(agg.col_idx);
+      if (!IsNumericType(col.type_info()->type())) {
+        return Status::InvalidArgument(
+            Substitute("cannot compute $0 of column $1 of type $2",
+                       AggregatePB::Function_Name(agg.function), col.name(),
+                       col.type_info()->name()));
+      }
+    }
+    result.push_back(agg);
+  }
+  *aggregates = std::move(result);
+  return Status::OK();
+}
+
+bool ScanAggregator::CountsRowsOnly(const vector<Aggregate>& aggregates) {
+  return !aggregates.empty() &&
+      std::all_of(aggregates.begin(), aggregates.end(), [](const Aggregate& agg) {
+        return agg.function == AggregatePB::COUNT && agg.col_idx == -1;
+      });
+}
+
+ScanAggregator::ScanAggregator(vector<Aggregate> aggregates)
+    : aggregates_(std::move(aggregates)),
+      states_(aggregates_.size()) {
+}
+
+template<typename T>
+void ScanAggregator::AddValues(const Aggregate& agg, const RowBlock& block, State* state) {
+  const ColumnBlock col = block.column_block(agg.col_idx);
+  const SelectionVector* sel = block.selection_vector();
+  const T* values = reinterpret_cast<const T*>(col.data());
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (!sel->IsRowSelected(i) || (col.is_nullable() && col.is_null(i))) {
+      continue;
+    }
+    const T v = values[i];
+    switch (agg.function) {
+      case AggregatePB::COUNT:
+        state->count++;
+        break;
+      case AggregatePB::SUM:
+        if (std::is_floating_point<T>::value) {
+          state->double_value += v;
+        } else {
+          // Integer sums wrap around on overflow.
+          state->int_value = static_cast<int64_t>(
+              static_cast<uint64_t>(state->int_value) + static_cast<uint64_t>(v));
+        }
+        break;
+      case AggregatePB::MIN:
+        if (std::is_floating_point<T>::value) {
+          state->double_value = state->has_value ? std::min<double>(state->double_value, v) : v;
+        } else {
+          state->int_value = state->has_value ? std::min<int64_t>(state->int_value, v) : v;
+        }
+        break;
+      case AggregatePB::MAX:
+        if (std::is_floating_point<T>::value) {
+          state->double_value = state->has_value ? std::max<double>(state->double_value, v) : v;
+        } else {
+          state->int_value = state->has_value ? std::max<int64_t>(state->int_value, v) : v;
+        }
+        break;
+      default:
+        LOG(FATAL) << "unexpected aggregate function: " << agg.function;
+    }
+    state->has_value = true;
+  }
+  state->is_floating = std::is_floating_point<T>::value;
+}
+
+void ScanAggregator::Add(const RowBlock& block) {
+  for (int i = 0; i < aggregates_.size(); i++) {
+    const Aggregate& agg = aggregates_[i];
+    State* state = &states_[i];
+    if (agg.col_idx == -1) {
+      state->count += block.selection_vector()->CountSelected();
+      continue;
+    }
+    const TypeInfo* type_info = block.schema().column(agg.col_idx).type_info();
+    switch (type_info->physical_type()) {
+      case INT8:
+        AddValues<int8_t>(agg, block, state);
+        break;
+      case INT16:
+        AddValues<int16_t>(agg, block, state);
+        break;
+      case INT32:
+        AddValues<int32_t>(agg, block, state);
+        break;
+      case INT64:
+        AddValues<int64_t>(agg, block, state);
+        break;
+      case FLOAT:
+        AddValues<float>(agg, block, state);
+        break;
+      case DOUBLE:
+        AddValues<double>(agg, block, state);
+        break;
+      default: {
+        // Only COUNT of non-numeric columns passes ResolveAggregates(), which
+        // doesn't need the values.
+        DCHECK_EQ(AggregatePB::COUNT, agg.function);
+        const ColumnBlock col = block.column_block(agg.col_idx);
+        const SelectionVector* sel = block.selection_vector();
+        for (size_t row = 0; row < block.nrows(); row++) {
+          if (sel->IsRowSelected(row) && !(col.is_nullable() && col.is_null(row))) {
+            state->count++;
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
+void ScanAggregator::AddRowCount(int64_t num_rows) {
+  DCHECK(CountsRowsOnly(aggregates_));
+  for (State& state : states_) {
+    state.count += num_rows;
+  }
+}
+
+void ScanAggregator::ToPB(RepeatedPtrField<AggregateResultPB>* results) const {
+  for (int i = 0; i < aggregates_.size(); i++) {
+    const Aggregate& agg = aggregates_[i];
+    const State& state = states_[i];
+    AggregateResultPB* result = results->Add();
+    if (agg.function == AggregatePB::COUNT) {
+      result->set_int_value(state.count);
+      continue;
+    }
+    if (!state.has_value) {
+      continue;
+    }
+    if (state.is_floating) {
+      result->set_double_value(state.double_value);
+    } else {
+      result->set_int_value(state.int_value);
+    }
+  }
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,117 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_SCAN_AGGREGATOR_H
+#define KUDU_TSERVER_SCAN_AGGREGATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include <google/protobuf/repeated_field.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnSchema;
+class RowBlock;
+class Schema;
+
+namespace tserver {
+
+// Computes the aggregates requested by a scan (see NewScanRequestPB.aggregates)
+// over the rows of the blocks passed to Add(), instead of returning the rows.
+//
+// A ScanAggregator is used to serve a single scan request: each response
+// contains the partial results of the aggregates over the rows scanned to
+// serve it.
+class ScanAggregator {
+ public:
+  // An aggregate, resolved against the schema of the scanned rows.
+  struct Aggregate {
+    AggregatePB::Function function;
+
+    // The index of the aggregated column in the schema of the scanned rows,
+    // or -1 for COUNT(*).
+    int col_idx;
+  };
+
+  // Appends to 'missing_cols' the columns of 'tablet_schema' which are
+  // aggregated by 'pbs' but aren't in 'projection' or 'missing_cols' already.
+  // Returns InvalidArgument if an aggregated column doesn't exist.
+  static Status AddAggregatedColumns(
+      const google::protobuf::RepeatedPtrField<AggregatePB>& pbs,
+      const Schema& tablet_schema,
+      const Schema& projection,
+      std::vector<ColumnSchema>* missing_cols);
+
+  // Resolves 'pbs' against 'schema', the schema of the scanned rows, which
+  // must contain all the aggregated columns. Returns InvalidArgument if any
+  // aggregate is invalid, e.g. SUM of a string column.
+  static Status ResolveAggregates(
+      const google::protobuf::RepeatedPtrField<AggregatePB>& pbs,
+      const Schema& schema,
+      std::vector<Aggregate>* aggregates);
+
+  // Returns true if all of 'aggregates' are COUNT(*), which may then be
+  // computed from the number of rows alone.
+  static bool CountsRowsOnly(const std::vector<Aggregate>& aggregates);
+
+  explicit ScanAggregator(std::vector<Aggregate> aggregates);
+
+  // Aggregates the selected rows of 'block'.
+  void Add(const RowBlock& block);
+
+  // Aggregates 'num_rows' rows without looking at them. Only valid if the
+  // aggregates count rows only, see CountsRowsOnly().
+  void AddRowCount(int64_t num_rows);
+
+  // Appends the results of the aggregates over the rows added so far to
+  // 'results', in the order of the aggregates passed to the constructor.
+  void ToPB(google::protobuf::RepeatedPtrField<AggregateResultPB>* results) const;
+
+ private:
+  // The partial result of an aggregate.
+  struct State {
+    State() : count(0), has_value(false), is_floating(false), int_value(0), double_value(0) {}
+
+    // For COUNT.
+    int64_t count;
+
+    // For SUM, MIN and MAX: whether any non-null value was aggregated,
+    // whether the column has a floating point type, and the result for
+    // integer and floating point columns, respectively.
+    bool has_value;
+    bool is_floating;
+    int64_t int_value;
+    double double_value;
+  };
+
+  template<typename T>
+  static void AddValues(const Aggregate& agg, const RowBlock& block, State* state);
+
+  const std::vector<Aggregate> aggregates_;
+  std::vector<State> states_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanAggregator);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif
@@ -0,0 +1,116 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_buffer_pool.h"
+
+#include <cstdint>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "kudu/rpc/rpc_sidecar.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+using std::make_shared;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace kudu {
+namespace tserver {
+
+class ScanBufferPoolTest : public KuduTest {
+ protected:
+  void SetUp() override {
+    KuduTest::SetUp();
+    parent_tracker_ = MemTracker::CreateTracker(-1, "test-parent");
+  }
+
+  shared_ptr<ScanBufferPool> MakePool(int64_t capacity_bytes) {
+    return make_shared<ScanBufferPool>(capacity_bytes, parent_tracker_);
+  }
+
+  shared_ptr<MemTracker> parent_tracker_;
+};
+
+TEST_F(ScanBufferPoolTest, TestReuse) {
+  auto pool = MakePool(64 * 1024 * 1024);
+  const size_t kSize = 1024 * 1024;
+
+  unique_ptr<faststring> buf = pool->Acquire(kSize);
+  ASSERT_GE(buf->capacity(), kSize);
+  buf->append("data");
+  const uint8_t* data = buf->data();
+  const int64_t capacity = buf->capacity();
+  pool->Release(std::move(buf));
+  ASSERT_EQ(1, pool->num_idle_buffers());
+  ASSERT_EQ(capacity, pool->idle_bytes());
+  ASSERT_EQ(capacity, parent_tracker_->consumption());
+
+  // A buffer of about the same size reuses the idle one, emptied.
+  buf = pool->Acquire(kSize - 100);
+  ASSERT_EQ(data, buf->data());
+  ASSERT_EQ(0, buf->size());
+  ASSERT_EQ(0, pool->num_idle_buffers());
+  ASSERT_EQ(0, pool->idle_bytes());
+  pool->Release(std::move(buf));
+
+  // A larger one doesn't fit in it, and a much smaller one doesn't tie it up.
+  buf = pool->Acquire(kSize * 2);
+  ASSERT_NE(data, buf->data());
+  unique_ptr<faststring> small = pool->Acquire(ScanBufferPool::kMinPooledCapacity);
+  ASSERT_NE(data, small->data());
+  ASSERT_EQ(1, pool->num_idle_buffers());
+}
+
+TEST_F(ScanBufferPoolTest, TestCapacity) {
+  const size_t kSize = 1024 * 1024;
+  auto pool = MakePool(kSize * 3);
+  for (int i = 0; i < 4; i++) {
+    pool->Release(pool->Acquire(0));
+    pool->Release(unique_ptr<faststring>(new faststring(kSize)));
+  }
+  // Small buffers aren't kept, and neither are the buffers past the capacity.
+  ASSERT_EQ(3, pool->num_idle_buffers());
+  ASSERT_EQ(3 * 1024 * 1024, pool->idle_bytes());
+
+  // With no capacity, nothing is kept.
+  pool.reset();
+  auto empty_pool = MakePool(0);
+  empty_pool->Release(unique_ptr<faststring>(new faststring(kSize)));
+  ASSERT_EQ(0, empty_pool->num_idle_buffers());
+}
+
+TEST_F(ScanBufferPoolTest, TestSidecar) {
+  auto pool = MakePool(64 * 1024 * 1024);
+  unique_ptr<faststring> buf = pool->Acquire(1024 * 1024);
+  buf->append("rows");
+  const uint8_t* data = buf->data();
+  {
+    unique_ptr<rpc::RpcSidecar> sidecar = pool->ToSidecar(std::move(buf));
+    ASSERT_EQ("rows", sidecar->AsSlice().ToString());
+    ASSERT_EQ(0, pool->num_idle_buffers());
+  }
+  // Once the sidecar is destroyed, its buffer is back in the pool.
+  ASSERT_EQ(1, pool->num_idle_buffers());
+  ASSERT_EQ(data, pool->Acquire(1024 * 1024)->data());
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,134 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_buffer_pool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/bits.h"
+#include "kudu/rpc/rpc_sidecar.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/slice.h"
+
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+// Sidecar sending a buffer of a ScanBufferPool, which it releases to the pool
+// once the response is sent.
+class PooledBufferSidecar : public rpc::RpcSidecar {
+ public:
+  PooledBufferSidecar(shared_ptr<ScanBufferPool> pool, unique_ptr<faststring> data)
+      : pool_(std::move(pool)),
+        data_(std::move(data)) {
+  }
+
+  ~PooledBufferSidecar() {
+    pool_->Release(std::move(data_));
+  }
+
+  Slice AsSlice() const override { return *data_; }
+
+ private:
+  const shared_ptr<ScanBufferPool> pool_;
+  unique_ptr<faststring> data_;
+};
+
+// How many size classes above the smallest fitting one Acquire() looks into,
+// so that a small request doesn't tie up a much larger buffer.
+const int kMaxSizeClassesAbove = 2;
+
+} // anonymous namespace
+
+const size_t ScanBufferPool::kMinPooledCapacity = 64 * 1024;
+
+ScanBufferPool::ScanBufferPool(int64_t capacity_bytes,
+                               const shared_ptr<MemTracker>& parent_tracker)
+    : mem_tracker_(MemTracker::CreateTracker(capacity_bytes, "scan-buffer-pool",
+                                             parent_tracker)) {
+}
+
+ScanBufferPool::~ScanBufferPool() {
+  mem_tracker_->Release(mem_tracker_->consumption());
+}
+
+int ScanBufferPool::SizeClass(size_t capacity) {
+  return std::min(Bits::Log2Floor64(capacity), kNumSizeClasses - 1);
+}
+
+unique_ptr<faststring> ScanBufferPool::Acquire(size_t min_capacity) {
+  if (min_capacity >= kMinPooledCapacity) {
+    // Any buffer of the class of the next power of two fits.
+    const int first = std::min(Bits::Log2Ceiling64(min_capacity), kNumSizeClasses - 1);
+    const int last = std::min(first + kMaxSizeClassesAbove, kNumSizeClasses - 1);
+    unique_ptr<faststring> buf;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      for (int c = first; c <= last; c++) {
+        if (!idle_[c].empty() && idle_[c].back()->capacity() >= min_capacity) {
+          buf = std::move(idle_[c].back());
+          idle_[c].pop_back();
+          break;
+        }
+      }
+    }
+    if (buf) {
+      mem_tracker_->Release(buf->capacity());
+      return buf;
+    }
+  }
+  return unique_ptr<faststring>(new faststring(min_capacity));
+}
+
+void ScanBufferPool::Release(unique_ptr<faststring> buf) {
+  const size_t capacity = buf->capacity();
+  if (capacity < kMinPooledCapacity || !mem_tracker_->TryConsume(capacity)) {
+    return;
+  }
+  buf->clear();
+  std::lock_guard<simple_spinlock> l(lock_);
+  idle_[SizeClass(capacity)].emplace_back(std::move(buf));
+}
+
+unique_ptr<rpc::RpcSidecar> ScanBufferPool::ToSidecar(unique_ptr<faststring> buf) {
+  return unique_ptr<rpc::RpcSidecar>(new PooledBufferSidecar(shared_from_this(),
+                                                             std::move(buf)));
+}
+
+size_t ScanBufferPool::num_idle_buffers() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  size_t num = 0;
+  for (const auto& buffers : idle_) {
+    num += buffers.size();
+  }
+  return num;
+}
+
+int64_t ScanBufferPool::idle_bytes() const {
+  return mem_tracker_->consumption();
+}
+
+} // namespace tserver
+} // namespace kudu
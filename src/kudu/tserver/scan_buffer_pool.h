@@ -0,0 +1,94 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
+
+namespace kudu {
+
+class MemTracker;
+
+namespace rpc {
+class RpcSidecar;
+} // namespace rpc
+
+namespace tserver {
+
+// A pool of the buffers into which scan batches are serialized, so that long
+// scans don't allocate, grow and free MB-sized buffers for every batch.
+//
+// The idle buffers are kept in size classes of powers of two, by capacity. A
+// buffer handed out by Acquire() comes back to the pool once the RPC sidecar
+// built from it with ToSidecar() is destroyed, i.e. once the response is
+// sent. The idle buffers are charged to a child of the server's MemTracker,
+// limited to the capacity of the pool; a buffer which doesn't fit, or which
+// would bring the server over its memory limit, is freed instead.
+//
+// This class is thread-safe. It must be owned by a shared_ptr, since the
+// sidecars keep it alive until they're destroyed.
+class ScanBufferPool : public std::enable_shared_from_this<ScanBufferPool> {
+ public:
+  // Buffers smaller than this aren't pooled: they're cheap to allocate.
+  static const size_t kMinPooledCapacity;
+
+  ScanBufferPool(int64_t capacity_bytes, const std::shared_ptr<MemTracker>& parent_tracker);
+  ~ScanBufferPool();
+
+  // Returns an empty buffer with a capacity of at least 'min_capacity' bytes,
+  // taken from the pool if one of the right size is idle.
+  std::unique_ptr<faststring> Acquire(size_t min_capacity);
+
+  // Returns 'buf' to the pool, or frees it if it's too small or the pool is
+  // full.
+  void Release(std::unique_ptr<faststring> buf);
+
+  // Returns an RPC sidecar sending 'buf', which releases it to the pool once
+  // the sidecar is destroyed.
+  std::unique_ptr<rpc::RpcSidecar> ToSidecar(std::unique_ptr<faststring> buf);
+
+  // Returns the number of idle buffers and the bytes they hold.
+  size_t num_idle_buffers() const;
+  int64_t idle_bytes() const;
+
+ private:
+  // The number of size classes, the last of which holds all the buffers of
+  // 2^(kNumSizeClasses - 1) bytes or more.
+  static const int kNumSizeClasses = 40;
+
+  // Returns the size class of a buffer with the given capacity.
+  static int SizeClass(size_t capacity);
+
+  std::shared_ptr<MemTracker> mem_tracker_;
+
+  // Protects 'idle_'.
+  mutable simple_spinlock lock_;
+
+  // The idle buffers by size class.
+  std::vector<std::unique_ptr<faststring>> idle_[kNumSizeClasses];
+
+  DISALLOW_COPY_AND_ASSIGN(ScanBufferPool);
+};
+
+} // namespace tserver
+} // namespace kudu
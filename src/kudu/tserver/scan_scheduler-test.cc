@@ -0,0 +1,143 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tserver/scan_scheduler.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+// Submits a task which holds the scheduler's only thread until 'release' is
+// counted down, and waits for it to start.
+void BlockScheduler(ScanScheduler* scheduler, CountDownLatch* release) {
+  CountDownLatch started(1);
+  ASSERT_OK(scheduler->Submit("blocker", 1, [&started, release](const Status& s) {
+    CHECK_OK(s);
+    started.CountDown();
+    release->Wait();
+  }));
+  started.Wait();
+}
+
+} // anonymous namespace
+
+TEST(ScanSchedulerTest, TestTakesTurnsBetweenGroups) {
+  ScanScheduler scheduler(1, 100);
+  ASSERT_OK(scheduler.Init());
+  CountDownLatch release(1);
+  NO_FATALS(BlockScheduler(&scheduler, &release));
+
+  simple_spinlock lock;
+  vector<string> order;
+  CountDownLatch done(4);
+  auto submit = [&](const string& group, const string& name) {
+    ASSERT_OK(scheduler.Submit(group, 1, [&, name](const Status& s) {
+      CHECK_OK(s);
+      {
+        std::lock_guard<simple_spinlock> l(lock);
+        order.push_back(name);
+      }
+      done.CountDown();
+    }));
+  };
+  NO_FATALS(submit("a", "a1"));
+  NO_FATALS(submit("a", "a2"));
+  NO_FATALS(submit("a", "a3"));
+  NO_FATALS(submit("b", "b1"));
+  release.CountDown();
+  done.Wait();
+
+  // The task of group "b" doesn't wait for all of the tasks of group "a",
+  // although they were queued first.
+  ASSERT_EQ((vector<string>{ "a1", "b1", "a2", "a3" }), order);
+}
+
+TEST(ScanSchedulerTest, TestWeightedTurns) {
+  ScanScheduler scheduler(1, 100);
+  ASSERT_OK(scheduler.Init());
+  CountDownLatch release(1);
+  NO_FATALS(BlockScheduler(&scheduler, &release));
+
+  simple_spinlock lock;
+  vector<string> order;
+  CountDownLatch done(6);
+  auto submit = [&](const string& group, int weight, const string& name) {
+    ASSERT_OK(scheduler.Submit(group, weight, [&, name](const Status& s) {
+      CHECK_OK(s);
+      {
+        std::lock_guard<simple_spinlock> l(lock);
+        order.push_back(name);
+      }
+      done.CountDown();
+    }));
+  };
+  for (int i = 1; i <= 4; i++) {
+    NO_FATALS(submit("a", 2, "a" + std::to_string(i)));
+  }
+  NO_FATALS(submit("b", 1, "b1"));
+  NO_FATALS(submit("b", 1, "b2"));
+  release.CountDown();
+  done.Wait();
+
+  // Group "a" gets two turns for each turn of group "b".
+  ASSERT_EQ((vector<string>{ "a1", "a2", "b1", "a3", "a4", "b2" }), order);
+}
+
+TEST(ScanSchedulerTest, TestRejectsTasks) {
+  ScanScheduler scheduler(1, 1);
+  ASSERT_OK(scheduler.Init());
+  CountDownLatch release(1);
+  NO_FATALS(BlockScheduler(&scheduler, &release));
+
+  // The queue has room for a single task.
+  CountDownLatch done(1);
+  ASSERT_OK(scheduler.Submit("a", 1, [&done](const Status& s) {
+    CHECK_OK(s);
+    done.CountDown();
+  }));
+  Status s = scheduler.Submit("b", 1, [](const Status& /*s*/) {
+    LOG(FATAL) << "rejected task was run";
+  });
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  release.CountDown();
+  done.Wait();
+
+  // No task is accepted once the scheduler is shut down.
+  scheduler.Shutdown();
+  s = scheduler.Submit("a", 1, [](const Status& /*s*/) {
+    LOG(FATAL) << "rejected task was run";
+  });
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+}
+
+} // namespace tserver
+} // namespace kudu
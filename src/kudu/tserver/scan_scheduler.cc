@@ -0,0 +1,136 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tserver/scan_scheduler.h"
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/bind.hpp> // IWYU pragma: keep
+#include <glog/logging.h>
+
+#include "kudu/util/threadpool.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tserver {
+
+ScanScheduler::ScanScheduler(int num_threads, size_t max_queued_tasks)
+    : num_threads_(num_threads),
+      max_queued_tasks_(max_queued_tasks),
+      num_queued_tasks_(0),
+      shut_down_(false) {
+}
+
+ScanScheduler::~ScanScheduler() {
+  Shutdown();
+}
+
+Status ScanScheduler::Init() {
+  // The queue is bounded by 'max_queued_tasks_' instead, since the pool's
+  // tasks don't correspond to the scheduler's.
+  return ThreadPoolBuilder("scan")
+      .set_max_threads(num_threads_)
+      .Build(&pool_);
+}
+
+void ScanScheduler::Shutdown() {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (shut_down_) {
+      return;
+    }
+    shut_down_ = true;
+  }
+  if (pool_) {
+    pool_->Shutdown();
+  }
+
+  vector<Task> dropped;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (auto& e : queues_) {
+      for (auto& task : e.second.tasks) {
+        dropped.emplace_back(std::move(task));
+      }
+    }
+    queues_.clear();
+    turns_.clear();
+    num_queued_tasks_ = 0;
+  }
+  for (const auto& task : dropped) {
+    task(Status::ServiceUnavailable("tablet server is shutting down"));
+  }
+}
+
+Status ScanScheduler::Submit(const string& group, int weight, Task task) {
+  DCHECK_GT(weight, 0);
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (PREDICT_FALSE(shut_down_)) {
+      return Status::ServiceUnavailable("tablet server is shutting down");
+    }
+    if (PREDICT_FALSE(num_queued_tasks_ >= max_queued_tasks_)) {
+      return Status::ServiceUnavailable("scan queue is full");
+    }
+    auto& queue = queues_[group];
+    if (queue.tasks.empty()) {
+      queue.weight = weight;
+      queue.turns_left = weight;
+      turns_.push_back(group);
+    }
+    queue.tasks.emplace_back(std::move(task));
+    num_queued_tasks_++;
+  }
+
+  // Each pool task runs whichever queued task's turn it is, rather than
+  // 'task' itself. If the pool is being shut down, Shutdown() drops the
+  // queued task.
+  WARN_NOT_OK(pool_->SubmitFunc(boost::bind(&ScanScheduler::RunNextTask, this)),
+              "Could not submit scan task");
+  return Status::OK();
+}
+
+void ScanScheduler::RunNextTask() {
+  Task task;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (turns_.empty()) {
+      return;
+    }
+    auto it = queues_.find(turns_.front());
+    DCHECK(it != queues_.end());
+    GroupQueue& queue = it->second;
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    if (queue.tasks.empty()) {
+      queues_.erase(it);
+      turns_.pop_front();
+    } else if (--queue.turns_left == 0) {
+      queue.turns_left = queue.weight;
+      turns_.emplace_back(std::move(turns_.front()));
+      turns_.pop_front();
+    }
+    num_queued_tasks_--;
+  }
+  task(Status::OK());
+}
+
+} // namespace tserver
+} // namespace kudu
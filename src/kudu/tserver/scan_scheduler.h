@@ -0,0 +1,100 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ThreadPool;
+
+namespace tserver {
+
+// Runs scan tasks on a dedicated thread pool, so that the RPC service threads
+// only hand them off.
+//
+// Tasks are submitted in groups, e.g. by the table being scanned, and the
+// pool threads take turns between the groups with queued tasks: a group with
+// many queued tasks doesn't delay the tasks of the other groups, which keeps
+// the latency of short scans predictable next to heavy batch scans. A group
+// gets as many turns in a row as its weight.
+class ScanScheduler {
+ public:
+  // A task is called with Status::OK() when it runs, or with an error if it's
+  // dropped because the scheduler is shutting down.
+  typedef std::function<void(const Status&)> Task;
+
+  // Creates a scheduler running tasks on 'num_threads' threads, with at most
+  // 'max_queued_tasks' tasks waiting for a thread.
+  ScanScheduler(int num_threads, size_t max_queued_tasks);
+  ~ScanScheduler();
+
+  Status Init();
+
+  // Waits for the running tasks to finish, and calls the queued ones with an
+  // error. Tasks submitted afterwards are rejected.
+  void Shutdown();
+
+  // Queues 'task' to run in a turn of 'group', which has weight 'weight'
+  // while it has queued tasks. Returns ServiceUnavailable, without calling
+  // 'task', if the queue is full or the scheduler is shut down.
+  Status Submit(const std::string& group, int weight, Task task);
+
+ private:
+  // Runs the first queued task of the group whose turn it is, if any.
+  void RunNextTask();
+
+  const int num_threads_;
+  const size_t max_queued_tasks_;
+
+  gscoped_ptr<ThreadPool> pool_;
+
+  // Protects the members below.
+  simple_spinlock lock_;
+
+  struct GroupQueue {
+    std::deque<Task> tasks;
+    int weight;
+
+    // The number of turns the group has left before the next group's turn.
+    int turns_left;
+  };
+
+  // The queued tasks of each group which has any.
+  std::unordered_map<std::string, GroupQueue> queues_;
+
+  // The groups with queued tasks, in the order of their turns. The group at
+  // the front is having its turns.
+  std::deque<std::string> turns_;
+
+  size_t num_queued_tasks_;
+  bool shut_down_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanScheduler);
+};
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,191 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_top_n.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/top_n_threshold.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/memory/arena.h"
+
+DEFINE_uint64(scanner_max_top_n_rows, 100000,
+              "The largest number of rows a top-N scan may ask each tablet for. "
+              "The rows are kept in memory until the tablet is scanned.");
+TAG_FLAG(scanner_max_top_n_rows, advanced);
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+// The initial size of the arena holding the indirect data of the kept rows.
+const size_t kInitialArenaSize = 32 * 1024;
+
+} // anonymous namespace
+
+Status ScanTopN::AddOrderedColumn(const TopNPB& pb,
+                                  const Schema& tablet_schema,
+                                  const Schema& projection,
+                                  vector<ColumnSchema>* missing_cols) {
+  int col_idx = tablet_schema.find_column(pb.column());
+  if (col_idx == Schema::kColumnNotFound) {
+    return Status::InvalidArgument("unknown column in top-N scan", pb.column());
+  }
+  if (pb.limit() == 0 || pb.limit() > FLAGS_scanner_max_top_n_rows) {
+    return Status::InvalidArgument(
+        Substitute("top-N scans must ask for between 1 and $0 rows, not $1",
+                   FLAGS_scanner_max_top_n_rows, pb.limit()));
+  }
+  if (projection.find_column(pb.column()) != Schema::kColumnNotFound ||
+      std::any_of(missing_cols->begin(), missing_cols->end(),
+                  [&](const ColumnSchema& col) { return col.name() == pb.column(); })) {
+    return Status::OK();
+  }
+  missing_cols->push_back(tablet_schema.column(col_idx));
+  return Status::OK();
+}
+
+ScanTopN::ScanTopN(const Schema& schema, int col_idx, size_t limit,
+                   shared_ptr<TopNThreshold> threshold)
+    : schema_(schema),
+      col_idx_(col_idx),
+      descending_(threshold->descending()),
+      limit_(limit),
+      threshold_(std::move(threshold)),
+      arena_(new Arena(kInitialArenaSize)),
+      rows_(new RowBlock(schema_, limit_, arena_.get())),
+      num_replaced_(0),
+      finished_(false) {
+  DCHECK_GT(limit_, 0);
+  heap_.reserve(limit_);
+}
+
+ScanTopN::~ScanTopN() {
+}
+
+bool ScanTopN::IsBetter(const RowBlock& a, size_t a_idx,
+                        const RowBlock& b, size_t b_idx) const {
+  const ColumnSchema& col = schema_.column(col_idx_);
+  const RowBlockRow a_row = a.row(a_idx);
+  const RowBlockRow b_row = b.row(b_idx);
+  if (col.is_nullable()) {
+    const bool a_null = a_row.is_null(col_idx_);
+    const bool b_null = b_row.is_null(col_idx_);
+    if (a_null || b_null) {
+      return !a_null;
+    }
+  }
+  int cmp = col.type_info()->Compare(a_row.cell_ptr(col_idx_), b_row.cell_ptr(col_idx_));
+  return descending_ ? cmp > 0 : cmp < 0;
+}
+
+Status ScanTopN::Add(const RowBlock& block) {
+  DCHECK(!finished_);
+  const RowBlock& rows = *rows_;
+  auto worse = [&](size_t a, size_t b) { return IsBetter(rows, a, rows, b); };
+  const SelectionVector* sel = block.selection_vector();
+  bool worst_changed = false;
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (!sel->IsRowSelected(i)) {
+      continue;
+    }
+    size_t slot;
+    if (heap_.size() < limit_) {
+      slot = heap_.size();
+    } else {
+      // Ties with the worst kept row don't replace it, so the threshold may
+      // rule out rows equal to it.
+      if (!IsBetter(block, i, rows, heap_.front())) {
+        continue;
+      }
+      std::pop_heap(heap_.begin(), heap_.end(), worse);
+      slot = heap_.back();
+      heap_.pop_back();
+      num_replaced_++;
+    }
+    RowBlockRow dst = rows_->row(slot);
+    RETURN_NOT_OK(CopyRow(block.row(i), &dst, arena_.get()));
+    heap_.push_back(slot);
+    std::push_heap(heap_.begin(), heap_.end(), worse);
+    worst_changed = true;
+  }
+
+  if (heap_.size() == limit_ && worst_changed) {
+    const ColumnSchema& col = schema_.column(col_idx_);
+    const RowBlockRow worst = rows_->row(heap_.front());
+    if (!col.is_nullable() || !worst.is_null(col_idx_)) {
+      threshold_->Update(worst.cell_ptr(col_idx_));
+    }
+  }
+
+  // The indirect data of the replaced rows stays in the arena until the kept
+  // rows are compacted, which at most doubles the work of copying them.
+  if (num_replaced_ >= limit_) {
+    RETURN_NOT_OK(Compact());
+  }
+  return Status::OK();
+}
+
+Status ScanTopN::Compact() {
+  unique_ptr<Arena> arena(new Arena(kInitialArenaSize));
+  unique_ptr<RowBlock> rows(new RowBlock(schema_, limit_, arena.get()));
+  for (size_t slot : heap_) {
+    RowBlockRow dst = rows->row(slot);
+    RETURN_NOT_OK(CopyRow(rows_->row(slot), &dst, arena.get()));
+  }
+  rows_ = std::move(rows);
+  arena_ = std::move(arena);
+  num_replaced_ = 0;
+  return Status::OK();
+}
+
+const RowBlock& ScanTopN::Finish() {
+  DCHECK(!finished_);
+  finished_ = true;
+  vector<size_t> slots(heap_);
+  const RowBlock& rows = *rows_;
+  std::sort(slots.begin(), slots.end(),
+            [&](size_t a, size_t b) { return IsBetter(rows, a, rows, b); });
+
+  // The rows are copied without their indirect data, which stays in 'arena_'.
+  result_.reset(new RowBlock(schema_, std::max<size_t>(slots.size(), 1), nullptr));
+  result_->Resize(slots.size());
+  result_->selection_vector()->SetAllTrue();
+  for (size_t i = 0; i < slots.size(); i++) {
+    RowBlockRow dst = result_->row(i);
+    CHECK_OK(CopyRow(rows_->row(slots[i]), &dst, static_cast<Arena*>(nullptr)));
+  }
+  return *result_;
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,115 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_SCAN_TOP_N_H
+#define KUDU_TSERVER_SCAN_TOP_N_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Arena;
+class RowBlock;
+class TopNThreshold;
+
+namespace tserver {
+
+// Keeps the best rows by a column of the blocks passed to Add(), to serve a
+// top-N scan (see NewScanRequestPB.top_n). The rows are kept in a bounded
+// heap whose worst row is compared against each new row before the row is
+// copied, so that most rows of a long scan are rejected without a copy.
+//
+// As the kept rows get better, the value of the worst of them is published to
+// a TopNThreshold, which the iterators of the scan use to skip the rowsets
+// whose rows can't beat it.
+//
+// A ScanTopN lives as long as its scanner, across the requests which serve
+// the scan.
+class ScanTopN {
+ public:
+  // Appends the column of 'tablet_schema' named by 'pb' to 'missing_cols',
+  // unless it is in 'projection' or 'missing_cols' already. Returns
+  // InvalidArgument if 'pb' is invalid, e.g. if the column doesn't exist or
+  // 'pb.limit()' exceeds --scanner_max_top_n_rows.
+  static Status AddOrderedColumn(const TopNPB& pb,
+                                 const Schema& tablet_schema,
+                                 const Schema& projection,
+                                 std::vector<ColumnSchema>* missing_cols);
+
+  // Creates a ScanTopN keeping the best 'limit' rows of 'schema', the schema
+  // of the scanned rows, by the column with index 'col_idx'. 'threshold' is
+  // updated as the kept rows get better.
+  ScanTopN(const Schema& schema, int col_idx, size_t limit,
+           std::shared_ptr<TopNThreshold> threshold);
+  ~ScanTopN();
+
+  // Considers the selected rows of 'block' for the kept rows.
+  Status Add(const RowBlock& block);
+
+  // Sorts the kept rows, best first, into a block which remains valid as long
+  // as this object. Add() may not be called afterwards.
+  const RowBlock& Finish();
+
+  // Whether Finish() was called.
+  bool finished() const {
+    return finished_;
+  }
+
+ private:
+  // Returns whether the row of 'a' at 'a_idx' is better than the row of 'b'
+  // at 'b_idx'.
+  bool IsBetter(const RowBlock& a, size_t a_idx, const RowBlock& b, size_t b_idx) const;
+
+  // Copies the kept rows into a new arena, releasing the indirect data of the
+  // rows they replaced.
+  Status Compact();
+
+  const Schema schema_;
+  const int col_idx_;
+  const bool descending_;
+  const size_t limit_;
+  const std::shared_ptr<TopNThreshold> threshold_;
+
+  // The kept rows, in the first heap_.size() slots of 'rows_', and the arena
+  // holding their indirect data.
+  std::unique_ptr<Arena> arena_;
+  std::unique_ptr<RowBlock> rows_;
+
+  // The slots of 'rows_' holding rows, arranged as a heap whose front is the
+  // worst row.
+  std::vector<size_t> heap_;
+
+  // The number of rows replaced since the last compaction.
+  size_t num_replaced_;
+
+  // The kept rows, best first, once Finish() was called.
+  std::unique_ptr<RowBlock> result_;
+  bool finished_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanTopN);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif
@@ -16,20 +16,35 @@
 // under the License.
 #include "kudu/tserver/scanners.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
 
+DECLARE_int32(scanner_shared_scan_max_buffered_blocks);
 DECLARE_int32(scanner_ttl_ms);
 
 namespace kudu {
@@ -38,6 +53,7 @@ using tablet::TabletReplica;
 
 namespace tserver {
 
+using std::string;
 using std::vector;
 
 TEST(ScannersTest, TestManager) {
@@ -87,5 +103,177 @@ TEST(ScannerTest, TestExpire) {
   ASSERT_EQ(s2->id(), active_scanners[0]->id());
 }
 
+// Test that a scanner which was accessed since it was put in the expiry wheel
+// survives the check of its bucket, and still expires later.
+TEST(ScannerTest, TestExpireAfterAccess) {
+  scoped_refptr<TabletReplica> null_replica(nullptr);
+  FLAGS_scanner_ttl_ms = 100;
+  MetricRegistry registry;
+  ScannerManager mgr(METRIC_ENTITY_server.Instantiate(&registry, "test"));
+  SharedScanner s;
+  mgr.NewScanner(null_replica, "", RowFormatFlags::NO_FLAGS, &s);
+  SleepFor(MonoDelta::FromMilliseconds(80));
+  s->UpdateAccessTime();
+  SleepFor(MonoDelta::FromMilliseconds(80));
+  mgr.RemoveExpiredScanners();
+  ASSERT_EQ(1, mgr.CountActiveScanners());
+  ASSERT_EQ(0, mgr.metrics_->scanners_expired->value());
+
+  SleepFor(MonoDelta::FromMilliseconds(200));
+  mgr.RemoveExpiredScanners();
+  ASSERT_EQ(0, mgr.CountActiveScanners());
+  ASSERT_EQ(1, mgr.metrics_->scanners_expired->value());
+
+  // An unregistered scanner is dropped from the wheel without expiring.
+  mgr.NewScanner(null_replica, "", RowFormatFlags::NO_FLAGS, &s);
+  ASSERT_TRUE(mgr.UnregisterScanner(s->id()));
+  SleepFor(MonoDelta::FromMilliseconds(200));
+  mgr.RemoveExpiredScanners();
+  ASSERT_EQ(1, mgr.metrics_->scanners_expired->value());
+}
+
+namespace {
+
+// An iterator returning the integers [0, num_rows) in a single INT32 column.
+class IntIterator : public RowwiseIterator {
+ public:
+  IntIterator(const Schema* schema, int32_t num_rows)
+      : schema_(schema),
+        num_rows_(num_rows),
+        next_(0) {
+  }
+
+  Status Init(ScanSpec* /*spec*/) OVERRIDE {
+    return Status::OK();
+  }
+
+  bool HasNext() const OVERRIDE {
+    return next_ < num_rows_;
+  }
+
+  Status NextBlock(RowBlock* dst) OVERRIDE {
+    size_t nrows = std::min<size_t>(dst->row_capacity(), num_rows_ - next_);
+    dst->Resize(nrows);
+    for (size_t i = 0; i < nrows; i++) {
+      *reinterpret_cast<int32_t*>(dst->row(i).mutable_cell_ptr(0)) = next_++;
+    }
+    dst->selection_vector()->SetAllTrue();
+    return Status::OK();
+  }
+
+  string ToString() const OVERRIDE {
+    return "IntIterator";
+  }
+
+  const Schema& schema() const OVERRIDE {
+    return *schema_;
+  }
+
+  void GetIteratorStats(vector<IteratorStats>* stats) const OVERRIDE {
+    stats->assign(schema_->num_columns(), IteratorStats());
+    (*stats)[0].cells_read = next_;
+  }
+
+ private:
+  const Schema* const schema_;
+  const int32_t num_rows_;
+  int32_t next_;
+};
+
+// Reads the next block of 'iter', appending its selected values to 'values'.
+void ReadBlock(RowwiseIterator* iter, vector<int32_t>* values) {
+  Arena arena(1024);
+  RowBlock block(iter->schema(), 30, &arena);
+  ASSERT_OK(iter->NextBlock(&block));
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (!block.selection_vector()->IsRowSelected(i)) {
+      continue;
+    }
+    values->push_back(*reinterpret_cast<const int32_t*>(block.row(i).cell_ptr(0)));
+  }
+}
+
+} // anonymous namespace
+
+TEST(ScannerTest, TestSharedScan) {
+  FLAGS_scanner_shared_scan_max_buffered_blocks = 2;
+  const Schema schema({ ColumnSchema("key", INT32) }, 1);
+  const int32_t kNumRows = 1000;
+  const scoped_refptr<tablet::TabletComponents> components;
+  ScannerManager mgr(nullptr);
+  gscoped_ptr<RowwiseIterator> iter2(new IntIterator(&schema, kNumRows));
+  ASSERT_FALSE(mgr.JoinSharedScan("a", components, &iter2));
+
+  gscoped_ptr<RowwiseIterator> iter1(new IntIterator(&schema, kNumRows));
+  mgr.StartSharedScan("a", components,
+                      &iter1, gscoped_ptr<RowwiseIterator>(new IntIterator(&schema, kNumRows)));
+  ASSERT_TRUE(mgr.JoinSharedScan("a", components, &iter2));
+  gscoped_ptr<RowwiseIterator> iter3(new IntIterator(&schema, kNumRows));
+  ASSERT_FALSE(mgr.JoinSharedScan("b", components, &iter3));
+
+  // Both readers see every row, although they consume them at different
+  // times, as long as neither gets more than the buffer ahead of the other.
+  vector<int32_t> values1;
+  vector<int32_t> values2;
+  NO_FATALS(ReadBlock(iter1.get(), &values1));
+  NO_FATALS(ReadBlock(iter1.get(), &values1));
+  while (iter1->HasNext()) {
+    NO_FATALS(ReadBlock(iter1.get(), &values1));
+    NO_FATALS(ReadBlock(iter2.get(), &values2));
+  }
+  while (iter2->HasNext()) {
+    NO_FATALS(ReadBlock(iter2.get(), &values2));
+  }
+  ASSERT_EQ(kNumRows, values1.size());
+  ASSERT_EQ(values1, values2);
+  for (int32_t i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(i, values1[i]);
+  }
+
+  // Once the first block has been dropped, scanners can no longer join.
+  ASSERT_FALSE(mgr.JoinSharedScan("a", components, &iter3));
+
+  // Only the reader which started the shared scan reports its stats.
+  vector<IteratorStats> stats;
+  iter1->GetIteratorStats(&stats);
+  ASSERT_EQ(1, stats.size());
+  ASSERT_EQ(kNumRows, stats[0].cells_read);
+  iter2->GetIteratorStats(&stats);
+  ASSERT_EQ(1, stats.size());
+  ASSERT_EQ(0, stats[0].cells_read);
+}
+
+TEST(ScannerTest, TestSharedScanFallsBackForSlowReaders) {
+  FLAGS_scanner_shared_scan_max_buffered_blocks = 2;
+  const Schema schema({ ColumnSchema("key", INT32) }, 1);
+  const int32_t kNumRows = 1000;
+  ScannerManager mgr(nullptr);
+
+  // Scanners only join shared scans of the same components.
+  scoped_refptr<tablet::TabletComponents> components(
+      new tablet::TabletComponents(nullptr, nullptr));
+  gscoped_ptr<RowwiseIterator> iter1(new IntIterator(&schema, kNumRows));
+  mgr.StartSharedScan("a", components,
+                      &iter1, gscoped_ptr<RowwiseIterator>(new IntIterator(&schema, kNumRows)));
+  gscoped_ptr<RowwiseIterator> iter2(new IntIterator(&schema, kNumRows));
+  ASSERT_FALSE(mgr.JoinSharedScan("a", scoped_refptr<tablet::TabletComponents>(), &iter2));
+  ASSERT_TRUE(mgr.JoinSharedScan("a", components, &iter2));
+
+  // The second reader consumes a block, then falls behind: the first one
+  // doesn't wait for it, and it goes on with its own iterator, skipping the
+  // rows it already got.
+  vector<int32_t> values1;
+  vector<int32_t> values2;
+  NO_FATALS(ReadBlock(iter2.get(), &values2));
+  while (iter1->HasNext()) {
+    NO_FATALS(ReadBlock(iter1.get(), &values1));
+  }
+  while (iter2->HasNext()) {
+    NO_FATALS(ReadBlock(iter2.get(), &values2));
+  }
+  ASSERT_EQ(kNumRows, values1.size());
+  ASSERT_EQ(values1, values2);
+}
+
 } // namespace tserver
 } // namespace kudu
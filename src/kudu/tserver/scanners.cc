@@ -18,6 +18,9 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
 #include <mutex>
 #include <ostream>
 
@@ -26,6 +29,8 @@
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/bind.h"
@@ -57,12 +62,28 @@ DEFINE_int32(scan_history_count, 20,
              "scans will be shown on the tablet server's scans dashboard.");
 TAG_FLAG(scan_history_count, experimental);
 
+DEFINE_int32(scan_history_sample_rate, 1,
+             "Only one in this many completed scans is kept in the scan history. "
+             "Raising it spares servers running many short scans the cost of "
+             "recording each of them.");
+TAG_FLAG(scan_history_sample_rate, experimental);
+TAG_FLAG(scan_history_sample_rate, runtime);
+
+DEFINE_int32(scanner_shared_scan_max_buffered_blocks, 256,
+             "Maximum number of row blocks a shared scan buffers for the scanners "
+             "reading from it which are behind the others. Scanners which fall "
+             "further behind go on reading on their own.");
+TAG_FLAG(scanner_shared_scan_max_buffered_blocks, experimental);
+TAG_FLAG(scanner_shared_scan_max_buffered_blocks, runtime);
+
 METRIC_DEFINE_gauge_size(server, active_scanners,
                          "Active Scanners",
                          kudu::MetricUnit::kScanners,
                          "Number of scanners that are currently active");
 
+using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -75,7 +96,9 @@ namespace tserver {
 ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
     : shutdown_(false),
       shutdown_cv_(&shutdown_lock_),
-      completed_scans_offset_(0) {
+      completed_scans_offset_(0),
+      num_completed_scans_(0),
+      wheel_epoch_(MonoTime::Now()) {
   if (metric_entity) {
     metrics_.reset(new ScannerMetrics(metric_entity));
     METRIC_active_scanners.InstantiateFunctionGauge(
@@ -149,38 +172,36 @@ void ScannerManager::NewScanner(const scoped_refptr<TabletReplica>& tablet_repli
                                row_format_flags));
 
     ScannerMapStripe& stripe = GetStripeByScannerId(id);
-    std::lock_guard<RWMutex> l(stripe.lock_);
+    std::lock_guard<rw_spinlock> l(stripe.lock_);
     success = InsertIfNotPresent(&stripe.scanners_by_id_, id, *scanner);
   }
+  AddToExpiryWheel((*scanner)->id(), MonoTime::Now());
 }
 
 bool ScannerManager::LookupScanner(const string& scanner_id, SharedScanner* scanner) {
   ScannerMapStripe& stripe = GetStripeByScannerId(scanner_id);
-  shared_lock<RWMutex> l(stripe.lock_);
+  shared_lock<rw_spinlock> l(stripe.lock_);
   return FindCopy(stripe.scanners_by_id_, scanner_id, scanner);
 }
 
 bool ScannerManager::UnregisterScanner(const string& scanner_id) {
-  ScanDescriptor descriptor;
+  SharedScanner scanner;
   ScannerMapStripe& stripe = GetStripeByScannerId(scanner_id);
   {
-    std::lock_guard<RWMutex> l(stripe.lock_);
+    std::lock_guard<rw_spinlock> l(stripe.lock_);
     auto it = stripe.scanners_by_id_.find(scanner_id);
     if (it == stripe.scanners_by_id_.end()) {
       return false;
     }
-
-    bool is_initialized = it->second->IsInitialized();
-    if (is_initialized) {
-      descriptor = it->second->descriptor();
-      descriptor.state = it->second->iter()->HasNext() ? ScanState::kFailed : ScanState::kComplete;
-    }
+    scanner = std::move(it->second);
     stripe.scanners_by_id_.erase(it);
-    if (!is_initialized) {
-      return true;
-    }
   }
 
+  if (!scanner->IsInitialized() || !ShouldRecordCompletedScan()) {
+    return true;
+  }
+  ScanDescriptor descriptor = scanner->descriptor();
+  descriptor.state = scanner->iter()->HasNext() ? ScanState::kFailed : ScanState::kComplete;
   std::lock_guard<RWMutex> l(completed_scans_lock_);
   RecordCompletedScanUnlocked(std::move(descriptor));
   return true;
@@ -189,7 +210,7 @@ bool ScannerManager::UnregisterScanner(const string& scanner_id) {
 size_t ScannerManager::CountActiveScanners() const {
   size_t total = 0;
   for (const ScannerMapStripe* e : scanner_maps_) {
-    shared_lock<RWMutex> l(e->lock_);
+    shared_lock<rw_spinlock> l(e->lock_);
     total += e->scanners_by_id_.size();
   }
   return total;
@@ -197,7 +218,7 @@ size_t ScannerManager::CountActiveScanners() const {
 
 void ScannerManager::ListScanners(std::vector<SharedScanner>* scanners) const {
   for (const ScannerMapStripe* stripe : scanner_maps_) {
-    shared_lock<RWMutex> l(stripe->lock_);
+    shared_lock<rw_spinlock> l(stripe->lock_);
     for (const auto& se : stripe->scanners_by_id_) {
       scanners->push_back(se.second);
     }
@@ -205,14 +226,13 @@ void ScannerManager::ListScanners(std::vector<SharedScanner>* scanners) const {
 }
 
 vector<ScanDescriptor> ScannerManager::ListScans() const {
+  vector<SharedScanner> scanners;
+  ListScanners(&scanners);
   vector<ScanDescriptor> scans;
-  for (const ScannerMapStripe* stripe : scanner_maps_) {
-    shared_lock<RWMutex> l(stripe->lock_);
-    for (const auto& se : stripe->scanners_by_id_) {
-      if (se.second->IsInitialized()) {
-        scans.emplace_back(se.second->descriptor());
-        scans.back().state = ScanState::kActive;
-      }
+  for (const SharedScanner& scanner : scanners) {
+    if (scanner->IsInitialized()) {
+      scans.emplace_back(scanner->descriptor());
+      scans.back().state = ScanState::kActive;
     }
   }
 
@@ -232,37 +252,76 @@ vector<ScanDescriptor> ScannerManager::ListScans() const {
   return scans;
 }
 
+void ScannerManager::AddToExpiryWheel(string scanner_id, MonoTime last_access) {
+  const int64_t tick_us = std::max(1, FLAGS_scanner_gc_check_interval_us);
+  int64_t bucket_us = (last_access - wheel_epoch_).ToMicroseconds();
+  bucket_us -= bucket_us % tick_us;
+  std::lock_guard<simple_spinlock> l(expiry_wheel_lock_);
+  expiry_wheel_[bucket_us].emplace_back(std::move(scanner_id));
+}
+
 void ScannerManager::RemoveExpiredScanners() {
   MonoDelta scanner_ttl = MonoDelta::FromMilliseconds(FLAGS_scanner_ttl_ms);
   const MonoTime now = MonoTime::Now();
 
-  vector<ScanDescriptor> descriptors;
-  for (ScannerMapStripe* stripe : scanner_maps_) {
-    std::lock_guard<RWMutex> l(stripe->lock_);
-    for (auto it = stripe->scanners_by_id_.begin(); it != stripe->scanners_by_id_.end();) {
-      const SharedScanner& scanner = it->second;
-      MonoDelta idle_time = scanner->TimeSinceLastAccess(now);
-      if (idle_time <= scanner_ttl) {
-        ++it;
-        continue;
+  // Take the buckets of the scanners which may have expired. Those accessed
+  // since they were bucketed go back in the wheel under their new access time.
+  vector<string> candidate_ids;
+  {
+    const int64_t oldest_live_us = (now - scanner_ttl - wheel_epoch_).ToMicroseconds();
+    std::lock_guard<simple_spinlock> l(expiry_wheel_lock_);
+    auto it = expiry_wheel_.begin();
+    for (; it != expiry_wheel_.end() && it->first < oldest_live_us; ++it) {
+      if (candidate_ids.empty()) {
+        candidate_ids.swap(it->second);
+      } else {
+        std::move(it->second.begin(), it->second.end(), std::back_inserter(candidate_ids));
       }
+    }
+    expiry_wheel_.erase(expiry_wheel_.begin(), it);
+  }
 
-      // The scanner has expired because of inactivity.
-      LOG(INFO) << Substitute(
-          "Expiring scanner id: $0, of tablet $1, "
-          "after $2 ms of inactivity, which is > TTL ($3 ms).",
-          it->first,
-          scanner->tablet_id(),
-          idle_time.ToMilliseconds(),
-          scanner_ttl.ToMilliseconds());
-      if (scanner->IsInitialized()) {
-        descriptors.emplace_back(scanner->descriptor());
+  vector<SharedScanner> expired;
+  for (string& id : candidate_ids) {
+    ScannerMapStripe& stripe = GetStripeByScannerId(id);
+    SharedScanner scanner;
+    {
+      std::lock_guard<rw_spinlock> l(stripe.lock_);
+      auto it = stripe.scanners_by_id_.find(id);
+      if (it == stripe.scanners_by_id_.end()) {
+        // Unregistered since it was bucketed.
+        continue;
       }
-      it = stripe->scanners_by_id_.erase(it);
-      if (metrics_) {
-        metrics_->scanners_expired->Increment();
+      if (it->second->TimeSinceLastAccess(now) <= scanner_ttl) {
+        scanner = it->second;
+      } else {
+        expired.emplace_back(std::move(it->second));
+        stripe.scanners_by_id_.erase(it);
+        continue;
       }
     }
+    AddToExpiryWheel(std::move(id), now - scanner->TimeSinceLastAccess(now));
+  }
+
+  vector<ScanDescriptor> descriptors;
+  for (const SharedScanner& scanner : expired) {
+    // The scanner has expired because of inactivity.
+    LOG(INFO) << Substitute(
+        "Expiring scanner id: $0, of tablet $1, "
+        "after $2 ms of inactivity, which is > TTL ($3 ms).",
+        scanner->id(),
+        scanner->tablet_id(),
+        scanner->TimeSinceLastAccess(now).ToMilliseconds(),
+        scanner_ttl.ToMilliseconds());
+    if (scanner->IsInitialized() && ShouldRecordCompletedScan()) {
+      descriptors.emplace_back(scanner->descriptor());
+    }
+    if (metrics_) {
+      metrics_->scanners_expired->Increment();
+    }
+  }
+  if (descriptors.empty()) {
+    return;
   }
 
   std::lock_guard<RWMutex> l(completed_scans_lock_);
@@ -273,6 +332,14 @@ void ScannerManager::RemoveExpiredScanners() {
   }
 }
 
+bool ScannerManager::ShouldRecordCompletedScan() {
+  if (completed_scans_.capacity() == 0) {
+    return false;
+  }
+  int sample_rate = FLAGS_scan_history_sample_rate;
+  return sample_rate <= 1 || num_completed_scans_++ % sample_rate == 0;
+}
+
 void ScannerManager::RecordCompletedScanUnlocked(ScanDescriptor descriptor) {
   if (completed_scans_.capacity() == 0) {
     return;
@@ -287,6 +354,382 @@ void ScannerManager::RecordCompletedScanUnlocked(ScanDescriptor descriptor) {
   }
 }
 
+namespace {
+
+// The number of rows in each block read by a shared scan.
+const int kSharedScanRowsPerBlock = 100;
+
+} // anonymous namespace
+
+// A single pass of an initialized iterator, shared by the concurrent scanners
+// of the same tablet, rowsets, snapshot, projection and scan spec. Each block
+// read by the pass is buffered until every attached reader has consumed it,
+// so the blocks are decoded once for all the readers, while each reader still
+// consumes the rows at its own pace.
+//
+// A reader may attach only while the first block of the pass is buffered.
+// When the buffer is full and a reader needs a new block, the slowest readers
+// are evicted from the pass rather than waited for; they go on reading from
+// their own iterators (see SharedScanIterator).
+class SharedScan {
+ public:
+  SharedScan(gscoped_ptr<RowwiseIterator> iter,
+             scoped_refptr<tablet::TabletComponents> components)
+      : iter_(std::move(iter)),
+        components_(std::move(components)),
+        first_block_seq_(0),
+        next_reader_id_(0) {
+  }
+
+  const RowwiseIterator& iter() const {
+    return *iter_;
+  }
+
+  // The rowsets the pass reads.
+  const scoped_refptr<tablet::TabletComponents>& components() const {
+    return components_;
+  }
+
+  // Attaches a new reader at the start of the pass, returning its ID, or -1
+  // if the first block of the pass is no longer buffered.
+  int Attach() {
+    MutexLock l(lock_);
+    if (first_block_seq_ != 0) {
+      return -1;
+    }
+    int reader_id = next_reader_id_++;
+    InsertOrDie(&readers_, reader_id, Reader());
+    return reader_id;
+  }
+
+  void Detach(int reader_id) {
+    MutexLock l(lock_);
+    CHECK_EQ(1, readers_.erase(reader_id));
+    DropConsumedBlocksUnlocked();
+  }
+
+  bool HasNext(int reader_id) const {
+    MutexLock l(lock_);
+    const Reader& reader = FindOrDie(readers_, reader_id);
+    // An evicted reader or a failed pass reports it from NextBlock().
+    if (reader.evicted || !status_.ok()) {
+      return true;
+    }
+    return reader.block_seq < first_block_seq_ + static_cast<int64_t>(blocks_.size()) ||
+        iter_->HasNext();
+  }
+
+  // Copies the next rows of the pass for the reader into 'dst', or sets
+  // '*evicted' if the reader was evicted from the pass, in which case it
+  // should detach.
+  Status NextBlock(int reader_id, RowBlock* dst, bool* evicted) {
+    if (dst->arena()) {
+      dst->arena()->Reset();
+    }
+    MutexLock l(lock_);
+    Reader* reader = &FindOrDie(readers_, reader_id);
+    *evicted = reader->evicted;
+    if (reader->evicted) {
+      return Status::OK();
+    }
+    const Block* block;
+    RETURN_NOT_OK(FetchBlockUnlocked(reader, &block));
+    if (!block) {
+      dst->Resize(0);
+      return Status::OK();
+    }
+
+    // Copy the selected rows of the block, as many as fit.
+    const RowBlock& src = block->block;
+    const SelectionVector* src_sel = src.selection_vector();
+    dst->Resize(dst->row_capacity());
+    size_t dst_row_idx = 0;
+    for (; reader->row_idx < src.nrows() && dst_row_idx < dst->nrows(); reader->row_idx++) {
+      if (!src_sel->IsRowSelected(reader->row_idx)) {
+        continue;
+      }
+      RowBlockRow dst_row = dst->row(dst_row_idx++);
+      RETURN_NOT_OK(CopyRow(src.row(reader->row_idx), &dst_row, dst->arena()));
+    }
+    dst->Resize(dst_row_idx);
+    dst->selection_vector()->SetAllTrue();
+    reader->rows_consumed += dst_row_idx;
+
+    while (reader->row_idx < src.nrows() && !src_sel->IsRowSelected(reader->row_idx)) {
+      reader->row_idx++;
+    }
+    if (reader->row_idx == src.nrows()) {
+      reader->block_seq++;
+      reader->row_idx = 0;
+      DropConsumedBlocksUnlocked();
+    }
+    return Status::OK();
+  }
+
+  // Returns the number of rows of the pass the reader consumed.
+  int64_t RowsConsumed(int reader_id) const {
+    MutexLock l(lock_);
+    return FindOrDie(readers_, reader_id).rows_consumed;
+  }
+
+  void GetIteratorStats(vector<IteratorStats>* stats) const {
+    MutexLock l(lock_);
+    iter_->GetIteratorStats(stats);
+  }
+
+ private:
+  struct Block {
+    explicit Block(const Schema& schema)
+        : arena(32 * 1024),
+          block(schema, kSharedScanRowsPerBlock, &arena) {
+    }
+
+    Arena arena;
+    RowBlock block;
+  };
+
+  struct Reader {
+    // The sequence number of the block being consumed, and the position of
+    // the next row of it to consume.
+    int64_t block_seq = 0;
+    size_t row_idx = 0;
+
+    // The number of selected rows the reader consumed.
+    int64_t rows_consumed = 0;
+
+    // Set if the reader fell too far behind the other readers.
+    bool evicted = false;
+  };
+
+  // Sets '*block' to the block 'reader' is consuming, reading it from the
+  // iterator if no other reader has gotten to it yet, or to null if the pass
+  // is complete. 'lock_' must be held.
+  Status FetchBlockUnlocked(Reader* reader, const Block** block) {
+    RETURN_NOT_OK(status_);
+    const int64_t idx = reader->block_seq - first_block_seq_;
+    DCHECK_GE(idx, 0);
+    if (idx < static_cast<int64_t>(blocks_.size())) {
+      *block = blocks_[idx].get();
+      return Status::OK();
+    }
+    if (!iter_->HasNext()) {
+      *block = nullptr;
+      return Status::OK();
+    }
+    // If the buffer is full, evict the slowest readers, which are still on
+    // its oldest block, rather than making this one wait for them.
+    const size_t max_blocks = std::max(1, FLAGS_scanner_shared_scan_max_buffered_blocks);
+    while (blocks_.size() >= max_blocks) {
+      for (auto& e : readers_) {
+        if (e.second.block_seq == first_block_seq_) {
+          e.second.evicted = true;
+        }
+      }
+      DropConsumedBlocksUnlocked();
+    }
+
+    unique_ptr<Block> new_block(new Block(iter_->schema()));
+    Status s = iter_->NextBlock(&new_block->block);
+    if (PREDICT_FALSE(!s.ok())) {
+      status_ = s;
+      return s;
+    }
+    blocks_.emplace_back(std::move(new_block));
+    *block = blocks_.back().get();
+    return Status::OK();
+  }
+
+  // Drops the buffered blocks which every remaining reader has consumed.
+  // 'lock_' must be held.
+  void DropConsumedBlocksUnlocked() {
+    int64_t min_seq = first_block_seq_ + blocks_.size();
+    for (const auto& e : readers_) {
+      if (!e.second.evicted) {
+        min_seq = std::min(min_seq, e.second.block_seq);
+      }
+    }
+    while (first_block_seq_ < min_seq) {
+      blocks_.pop_front();
+      first_block_seq_++;
+    }
+  }
+
+  const gscoped_ptr<RowwiseIterator> iter_;
+  const scoped_refptr<tablet::TabletComponents> components_;
+
+  // Protects the members below, as well as 'iter_' once it's shared.
+  mutable Mutex lock_;
+
+  // The buffered blocks, the first of which has sequence number
+  // 'first_block_seq_'.
+  std::deque<unique_ptr<Block>> blocks_;
+  int64_t first_block_seq_;
+
+  // The readers attached to the pass, keyed by their IDs.
+  std::unordered_map<int, Reader> readers_;
+  int next_reader_id_;
+
+  // The error hit reading the iterator, if any.
+  Status status_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedScan);
+};
+
+namespace {
+
+// An iterator reading the rows of a shared scan. The pass is decoded once for
+// all of its readers, so only the reader which started it reports the
+// iterator stats, which keeps the scan metrics from overcounting.
+//
+// Each reader also owns an initialized iterator of its own, over the same
+// rowsets at the same snapshot, so that it yields the same rows in the same
+// order as the pass. If the reader is evicted from the pass, it goes on
+// reading from that iterator, skipping the rows it already consumed.
+class SharedScanIterator : public RowwiseIterator {
+ public:
+  SharedScanIterator(shared_ptr<SharedScan> scan, int reader_id, bool reports_stats,
+                     gscoped_ptr<RowwiseIterator> fallback)
+      : scan_(std::move(scan)),
+        reader_id_(reader_id),
+        reports_stats_(reports_stats),
+        fallback_(std::move(fallback)),
+        rows_to_skip_(0) {
+  }
+
+  ~SharedScanIterator() {
+    if (scan_) {
+      scan_->Detach(reader_id_);
+    }
+  }
+
+  // The shared scan and the fallback iterator were initialized with an
+  // identical spec.
+  Status Init(ScanSpec* /*spec*/) OVERRIDE {
+    return Status::OK();
+  }
+
+  bool HasNext() const OVERRIDE {
+    return scan_ ? scan_->HasNext(reader_id_) : fallback_->HasNext();
+  }
+
+  Status NextBlock(RowBlock* dst) OVERRIDE {
+    if (scan_) {
+      bool evicted;
+      RETURN_NOT_OK(scan_->NextBlock(reader_id_, dst, &evicted));
+      if (!evicted) {
+        return Status::OK();
+      }
+      VLOG(1) << "Scanner fell behind its shared scan, reading on its own";
+      rows_to_skip_ = scan_->RowsConsumed(reader_id_);
+      if (reports_stats_) {
+        scan_->GetIteratorStats(&pass_stats_);
+      }
+      scan_->Detach(reader_id_);
+      scan_.reset();
+    }
+
+    RETURN_NOT_OK(fallback_->NextBlock(dst));
+    SelectionVector* sel = dst->selection_vector();
+    for (size_t i = 0; i < dst->nrows() && rows_to_skip_ > 0; i++) {
+      if (sel->IsRowSelected(i)) {
+        sel->SetRowUnselected(i);
+        rows_to_skip_--;
+      }
+    }
+    return Status::OK();
+  }
+
+  string ToString() const OVERRIDE {
+    return scan_ ? Substitute("SharedScan($0)", scan_->iter().ToString()) :
+        fallback_->ToString();
+  }
+
+  const Schema& schema() const OVERRIDE {
+    return fallback_->schema();
+  }
+
+  void GetIteratorStats(vector<IteratorStats>* stats) const OVERRIDE {
+    if (scan_) {
+      if (reports_stats_) {
+        scan_->GetIteratorStats(stats);
+      } else {
+        stats->assign(schema().num_columns(), IteratorStats());
+      }
+      return;
+    }
+    fallback_->GetIteratorStats(stats);
+    for (size_t i = 0; i < pass_stats_.size() && i < stats->size(); i++) {
+      (*stats)[i] += pass_stats_[i];
+    }
+  }
+
+ private:
+  shared_ptr<SharedScan> scan_;
+  const int reader_id_;
+  const bool reports_stats_;
+  const gscoped_ptr<RowwiseIterator> fallback_;
+
+  // The number of rows of the fallback iterator still to skip, as they were
+  // consumed from the pass.
+  int64_t rows_to_skip_;
+
+  // The stats of the pass, if the reader reported them and was evicted.
+  vector<IteratorStats> pass_stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedScanIterator);
+};
+
+} // anonymous namespace
+
+bool ScannerManager::JoinSharedScan(const string& key,
+                                    const scoped_refptr<tablet::TabletComponents>& components,
+                                    gscoped_ptr<RowwiseIterator>* iter) {
+  shared_ptr<SharedScan> scan;
+  {
+    std::lock_guard<simple_spinlock> l(shared_scans_lock_);
+    auto it = shared_scans_.find(key);
+    if (it == shared_scans_.end()) {
+      return false;
+    }
+    scan = it->second.lock();
+    if (!scan) {
+      shared_scans_.erase(it);
+      return false;
+    }
+  }
+  if (scan->components() != components) {
+    return false;
+  }
+  int reader_id = scan->Attach();
+  if (reader_id < 0) {
+    return false;
+  }
+  iter->reset(new SharedScanIterator(std::move(scan), reader_id, false, std::move(*iter)));
+  return true;
+}
+
+void ScannerManager::StartSharedScan(const string& key,
+                                     scoped_refptr<tablet::TabletComponents> components,
+                                     gscoped_ptr<RowwiseIterator>* iter,
+                                     gscoped_ptr<RowwiseIterator> fallback) {
+  auto scan = std::make_shared<SharedScan>(std::move(*iter), std::move(components));
+  int reader_id = scan->Attach();
+  CHECK_GE(reader_id, 0);
+  {
+    std::lock_guard<simple_spinlock> l(shared_scans_lock_);
+    // Forget about the shared scans which are complete.
+    for (auto it = shared_scans_.begin(); it != shared_scans_.end();) {
+      if (it->second.expired()) {
+        it = shared_scans_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    shared_scans_[key] = scan;
+  }
+  iter->reset(new SharedScanIterator(std::move(scan), reader_id, true, std::move(fallback)));
+}
+
 const std::string Scanner::kNullTabletId = "null tablet";
 
 Scanner::Scanner(string id, const scoped_refptr<TabletReplica>& tablet_replica,
@@ -298,9 +741,12 @@ Scanner::Scanner(string id, const scoped_refptr<TabletReplica>& tablet_replica,
       call_seq_id_(0),
       start_time_(MonoTime::Now()),
       metrics_(metrics),
+      report_column_stats_(false),
       arena_(256),
       row_format_flags_(row_format_flags),
-      num_rows_returned_(0) {
+      num_rows_returned_(0),
+      last_batch_rows_bytes_(0),
+      last_batch_indirect_bytes_(0) {
   if (tablet_replica_) {
     auto tablet = tablet_replica->shared_tablet();
     if (tablet && tablet->metrics()) {
@@ -17,8 +17,10 @@
 #ifndef KUDU_TSERVER_SCANNERS_H
 #define KUDU_TSERVER_SCANNERS_H
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -35,6 +37,8 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/tserver/scan_aggregator.h"
+#include "kudu/tserver/scan_top_n.h"
 #include "kudu/util/auto_release_pool.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/locks.h"
@@ -52,9 +56,14 @@ class Schema;
 class Status;
 class Thread;
 
+namespace tablet {
+struct TabletComponents;
+} // namespace tablet
+
 namespace tserver {
 
 class Scanner;
+class SharedScan;
 enum class ScanState;
 struct ScanDescriptor;
 struct ScannerMetrics;
@@ -68,6 +77,9 @@ typedef std::shared_ptr<Scanner> SharedScanner;
 //
 // Since scanners keep resources on the server, the manager periodically
 // removes any scanners which have not been accessed since a configurable TTL.
+// To avoid walking every scanner each time, the scanners are kept in an
+// expiry wheel of buckets keyed by the times they were last known to be
+// accessed, and only the buckets older than the TTL are checked.
 class ScannerManager {
  public:
   explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity);
@@ -103,11 +115,31 @@ class ScannerManager {
   // List active and recently completed scans.
   std::vector<ScanDescriptor> ListScans() const;
 
-  // Iterate through scanners and remove any which are past their TTL.
+  // Remove the scanners which are past their TTL.
   void RemoveExpiredScanners();
 
+  // Joins the shared scan registered under 'key' if it reads 'components'
+  // and a new scanner can still join it from its start. If so, returns true
+  // and replaces the initialized iterator '*iter' with an iterator reading
+  // from the shared scan, which falls back to '*iter' if the scanner falls
+  // too far behind. '*iter' must read 'components'.
+  bool JoinSharedScan(const std::string& key,
+                      const scoped_refptr<tablet::TabletComponents>& components,
+                      gscoped_ptr<RowwiseIterator>* iter);
+
+  // Registers a shared scan of the initialized iterator '*iter' under 'key',
+  // for concurrent scanners with the same key and components to join, and
+  // replaces '*iter' with an iterator reading from it. 'fallback' must be an
+  // initialized iterator identical to '*iter', which the scanner falls back
+  // to if it falls too far behind the others. Both must read 'components'.
+  void StartSharedScan(const std::string& key,
+                       scoped_refptr<tablet::TabletComponents> components,
+                       gscoped_ptr<RowwiseIterator>* iter,
+                       gscoped_ptr<RowwiseIterator> fallback);
+
  private:
   FRIEND_TEST(ScannerTest, TestExpire);
+  FRIEND_TEST(ScannerTest, TestExpireAfterAccess);
 
   enum {
     kNumScannerMapStripes = 32
@@ -116,8 +148,9 @@ class ScannerManager {
   typedef std::unordered_map<std::string, SharedScanner> ScannerMap;
 
   struct ScannerMapStripe {
-    // Lock protecting the scanner map.
-    mutable RWMutex lock_;
+    // Lock protecting the scanner map. It is only held for map operations,
+    // never while calling into a scanner.
+    mutable rw_spinlock lock_;
     // Map of the currently active scanners.
     ScannerMap scanners_by_id_;
   };
@@ -130,6 +163,14 @@ class ScannerManager {
   // Adds the scan descriptor to the completed scans FIFO.
   void RecordCompletedScanUnlocked(ScanDescriptor descriptor);
 
+  // Returns whether the next completed scan should be recorded in the scan
+  // history, as decided by --scan_history_sample_rate.
+  bool ShouldRecordCompletedScan();
+
+  // Adds the scanner 'scanner_id', last accessed at 'last_access', to the
+  // expiry wheel.
+  void AddToExpiryWheel(std::string scanner_id, MonoTime last_access);
+
   // (Optional) scanner metrics for this instance.
   gscoped_ptr<ScannerMetrics> metrics_;
 
@@ -146,12 +187,29 @@ class ScannerManager {
   std::vector<ScanDescriptor> completed_scans_;
   size_t completed_scans_offset_;
 
+  // The number of completed scans, sampled or not.
+  std::atomic<int64_t> num_completed_scans_;
+
+  // The expiry wheel: the IDs of the scanners, bucketed by the times they
+  // were last known to be accessed, rounded down to
+  // --scanner_gc_check_interval_us since 'wheel_epoch_'. The IDs of the
+  // unregistered scanners are only dropped when their bucket is checked.
+  simple_spinlock expiry_wheel_lock_;
+  std::map<int64_t, std::vector<std::string>> expiry_wheel_;
+  const MonoTime wheel_epoch_;
+
   // Generator for scanner IDs.
   ObjectIdGenerator oid_generator_;
 
   // Thread to remove expired scanners.
   scoped_refptr<kudu::Thread> removal_thread_;
 
+  // The shared scans which scanners may still join, keyed by the tablet,
+  // snapshot, projection and scan spec they read. A shared scan is owned by
+  // the iterators reading from it, and is destroyed with the last of them.
+  simple_spinlock shared_scans_lock_;
+  std::unordered_map<std::string, std::weak_ptr<SharedScan>> shared_scans_;
+
   FunctionGaugeDetacher metric_detacher_;
 
   DISALLOW_COPY_AND_ASSIGN(ScannerManager);
@@ -289,10 +347,52 @@ class Scanner {
     already_reported_stats_ = stats;
   }
 
+  // Whether each response of the scan reports the stats of each column, as
+  // opposed to only their sum. Must be set before the scanner is first used.
+  bool report_column_stats() const {
+    return report_column_stats_;
+  }
+  void set_report_column_stats(bool report_column_stats) {
+    report_column_stats_ = report_column_stats;
+  }
+
+  // The per-column stats already reported to the client, if the scan reports
+  // them.
+  const std::vector<IteratorStats>& already_reported_column_stats() const {
+    return already_reported_column_stats_;
+  }
+  void set_already_reported_column_stats(std::vector<IteratorStats> stats) {
+    already_reported_column_stats_ = std::move(stats);
+  }
+
   uint64_t row_format_flags() const {
     return row_format_flags_;
   }
 
+  // Sets the aggregates computed by the scan instead of returning rows.
+  // Must be called before the scanner is first used.
+  void set_aggregates(std::vector<ScanAggregator::Aggregate> aggregates) {
+    aggregates_ = std::move(aggregates);
+  }
+
+  // Returns the aggregates computed by the scan, or an empty vector if the
+  // scan returns rows.
+  const std::vector<ScanAggregator::Aggregate>& aggregates() const {
+    return aggregates_;
+  }
+
+  // Sets the rows a top-N scan keeps until its iterator is exhausted. Must be
+  // called before the scanner is first used.
+  void set_top_n(std::unique_ptr<ScanTopN> top_n) {
+    top_n_ = std::move(top_n);
+  }
+
+  // Returns the rows kept by a top-N scan, or nullptr if the scan returns the
+  // rows as they are scanned.
+  ScanTopN* top_n() const {
+    return top_n_.get();
+  }
+
   void add_num_rows_returned(int64_t num_rows_added) {
     std::lock_guard<simple_spinlock> l(lock_);
     num_rows_returned_ += num_rows_added;
@@ -304,6 +404,22 @@ class Scanner {
     return num_rows_returned_;
   }
 
+  // Records the sizes of the row and indirect data buffers of the last batch
+  // returned by this scanner, to size the buffers of the next batch.
+  void set_last_batch_bytes(size_t rows_bytes, size_t indirect_bytes) {
+    last_batch_rows_bytes_ = rows_bytes;
+    last_batch_indirect_bytes_ = indirect_bytes;
+  }
+
+  // Returns the sizes recorded by set_last_batch_bytes(), or 0 if no batch
+  // of rows was returned yet.
+  size_t last_batch_rows_bytes() const {
+    return last_batch_rows_bytes_;
+  }
+  size_t last_batch_indirect_bytes() const {
+    return last_batch_indirect_bytes_;
+  }
+
   bool has_fulfilled_limit() const {
     std::lock_guard<simple_spinlock> l(lock_);
     return spec_ && spec_->has_limit() && num_rows_returned_ >= spec_->limit();
@@ -347,6 +463,9 @@ class Scanner {
   // as the scanner proceeds.
   IteratorStats already_reported_stats_;
 
+  bool report_column_stats_;
+  std::vector<IteratorStats> already_reported_column_stats_;
+
   // The spec used by 'iter_'
   gscoped_ptr<ScanSpec> spec_;
 
@@ -366,10 +485,21 @@ class Scanner {
   // The row format flags the client passed, if any.
   const uint64_t row_format_flags_;
 
+  // The aggregates the client asked for, if any.
+  std::vector<ScanAggregator::Aggregate> aggregates_;
+
+  // The rows kept by a top-N scan, if the client asked for one.
+  std::unique_ptr<ScanTopN> top_n_;
+
   // The number of rows that have been serialized and sent over the wire by
   // this scanner.
   int64_t num_rows_returned_;
 
+  // The sizes of the buffers of the last batch of rows. Only accessed by the
+  // request using the scanner.
+  size_t last_batch_rows_bytes_;
+  size_t last_batch_indirect_bytes_;
+
   DISALLOW_COPY_AND_ASSIGN(Scanner);
 };
 
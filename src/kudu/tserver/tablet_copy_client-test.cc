@@ -54,7 +54,9 @@
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_copy.pb.h"
+#include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_copy_client.h"
+#include "kudu/tserver/tablet_server.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -75,6 +77,8 @@ using std::vector;
 DECLARE_double(env_inject_eio);
 DECLARE_string(block_manager);
 DECLARE_string(env_inject_eio_globs);
+DECLARE_string(tablet_copy_compression_codec);
+DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
 
 METRIC_DECLARE_counter(block_manager_total_disk_sync);
 
@@ -124,7 +128,8 @@ class TabletCopyClientTest : public TabletCopyTest {
                                        fs_manager_.get(),
                                        cmeta_manager,
                                        messenger_,
-                                       nullptr /* no metrics */));
+                                       nullptr /* no metrics */,
+                                       nullptr /* no throttling */));
     RaftPeerPB* cstate_leader;
     ConsensusStatePB cstate;
     RETURN_NOT_OK(tablet_replica_->consensus()->ConsensusState(&cstate));
@@ -280,6 +285,28 @@ TEST_F(TabletCopyClientTest, TestDownloadBlock) {
   ASSERT_OK(ReadLocalBlockFile(fs_manager_.get(), new_block_id, &scratch, &slice));
 }
 
+// Test that a block downloaded with compression, over several chunks, matches
+// the remote block.
+TEST_F(TabletCopyClientTest, TestDownloadCompressedBlock) {
+  FLAGS_tablet_copy_compression_codec = "lz4";
+  FLAGS_tablet_copy_transfer_chunk_size_bytes = 16;
+  ASSERT_OK(StartCopy());
+  BlockId block_id = FirstColumnBlockId(*client_->remote_superblock_);
+
+  BlockId new_block_id;
+  ASSERT_OK(client_->DownloadBlock(block_id, &new_block_id));
+  ASSERT_OK(client_->transaction_->CommitCreatedBlocks());
+
+  Slice remote_slice;
+  faststring remote_scratch;
+  ASSERT_OK(ReadLocalBlockFile(mini_server_->server()->fs_manager(), block_id,
+                               &remote_scratch, &remote_slice));
+  Slice local_slice;
+  faststring local_scratch;
+  ASSERT_OK(ReadLocalBlockFile(fs_manager_.get(), new_block_id, &local_scratch, &local_slice));
+  ASSERT_EQ(remote_slice, local_slice);
+}
+
 // Basic WAL segment download unit test.
 TEST_F(TabletCopyClientTest, TestDownloadWalSegment) {
   ASSERT_OK(StartCopy());
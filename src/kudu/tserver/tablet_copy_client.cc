@@ -17,9 +17,13 @@
 
 #include "kudu/tserver/tablet_copy_client.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <ostream>
+#include <unordered_map>
 #include <utility>
 
 #include <boost/optional/optional.hpp>
@@ -51,9 +55,12 @@
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/tserver/tablet_copy.proxy.h"
 #include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
@@ -65,7 +72,10 @@
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
+#include "kudu/util/throttler.h"
 
 DEFINE_int32(tablet_copy_begin_session_timeout_ms, 30000,
              "Tablet server RPC client timeout for BeginTabletCopySession calls. "
@@ -97,6 +107,17 @@ DEFINE_double(tablet_copy_fault_crash_before_write_cmeta, 0.0,
 TAG_FLAG(tablet_copy_fault_crash_before_write_cmeta, unsafe);
 TAG_FLAG(tablet_copy_fault_crash_before_write_cmeta, runtime);
 
+DEFINE_int32(tablet_copy_download_threads_per_session, 4,
+             "Number of blocks a tablet copy session downloads concurrently.");
+TAG_FLAG(tablet_copy_download_threads_per_session, advanced);
+
+DEFINE_string(tablet_copy_compression_codec, "none",
+              "Codec with which the tablet copy source is asked to compress the data "
+              "it sends, e.g. 'lz4' when network bandwidth is scarcer than CPU. "
+              "'none' disables compression.");
+TAG_FLAG(tablet_copy_compression_codec, advanced);
+TAG_FLAG(tablet_copy_compression_codec, runtime);
+
 DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
 
 METRIC_DEFINE_counter(server, tablet_copy_bytes_fetched,
@@ -148,7 +169,8 @@ TabletCopyClient::TabletCopyClient(std::string tablet_id,
     FsManager* fs_manager,
     scoped_refptr<ConsensusMetadataManager> cmeta_manager,
     shared_ptr<Messenger> messenger,
-    TabletCopyClientMetrics* tablet_copy_metrics)
+    TabletCopyClientMetrics* tablet_copy_metrics,
+    Throttler* throttler)
     : tablet_id_(std::move(tablet_id)),
       fs_manager_(fs_manager),
       cmeta_manager_(std::move(cmeta_manager)),
@@ -159,7 +181,8 @@ TabletCopyClient::TabletCopyClient(std::string tablet_id,
       session_idle_timeout_millis_(FLAGS_tablet_copy_begin_session_timeout_ms),
       start_time_micros_(0),
       rng_(GetRandomSeed32()),
-      tablet_copy_metrics_(tablet_copy_metrics) {
+      tablet_copy_metrics_(tablet_copy_metrics),
+      throttler_(throttler) {
   BlockManager* bm = fs_manager->block_manager();
   transaction_ = bm->NewCreationTransaction();
   if (tablet_copy_metrics_) {
@@ -277,9 +300,12 @@ Status TabletCopyClient::Start(const HostPort& copy_source_addr,
 
   // The block ids (in active rowsets as well as from orphaned blocks) on the
   // remote have no meaning to us and could cause data loss if accidentally
-  // deleted locally. We must clear them all.
+  // deleted locally. We must clear them all. The rowsets staged for ingestion
+  // aren't copied: an ingest op replicated later without its staged rowset
+  // fails the new replica.
   superblock_->clear_rowsets();
   superblock_->clear_orphaned_blocks();
+  superblock_->clear_staged_rowsets();
 
   // The UUIDs within the DataDirGroupPB on the remote are also unique to the
   // remote and have no meaning to us.
@@ -380,7 +406,7 @@ Status TabletCopyClient::FetchAll(const scoped_refptr<TabletReplica>& tablet_rep
 
   tablet_replica_ = tablet_replica;
 
-  // Download all the files (serially, for now, but in parallel in the future).
+  // Download all the files. Blocks are downloaded in parallel, WAL segments serially.
   RETURN_NOT_OK(DownloadBlocks());
   RETURN_NOT_OK(DownloadWALs());
 
@@ -541,7 +567,16 @@ Status TabletCopyClient::DownloadWALs() {
 int TabletCopyClient::CountRemoteBlocks() const {
   int num_blocks = 0;
   for (const RowSetDataPB& rowset : remote_superblock_->rowsets()) {
-    num_blocks += rowset.columns_size();
+    // The columns of a column group share their block.
+    BlockIdSet col_blocks;
+    for (const ColumnDataPB& col : rowset.columns()) {
+      if (InsertIfNotPresent(&col_blocks, BlockId::FromPB(col.block()))) {
+        num_blocks++;
+      }
+      if (col.has_secondary_index()) {
+        num_blocks++;
+      }
+    }
     num_blocks += rowset.redo_deltas_size();
     num_blocks += rowset.undo_deltas_size();
     if (rowset.has_bloom_block()) {
@@ -557,13 +592,93 @@ int TabletCopyClient::CountRemoteBlocks() const {
 Status TabletCopyClient::DownloadBlocks() {
   CHECK_EQ(kStarted, state_);
 
-  // Count up the total number of blocks to download.
-  int num_remote_blocks = CountRemoteBlocks();
+  // List the remote blocks, in the order in which they are referenced by the
+  // new superblock below.
+  vector<const BlockIdPB*> src_block_ids;
+  for (const RowSetDataPB& src_rowset : remote_superblock_->rowsets()) {
+    // The columns of a column group share their block, which is only
+    // downloaded once.
+    BlockIdSet col_blocks;
+    for (const ColumnDataPB& src_col : src_rowset.columns()) {
+      if (InsertIfNotPresent(&col_blocks, BlockId::FromPB(src_col.block()))) {
+        src_block_ids.push_back(&src_col.block());
+      }
+      if (src_col.has_secondary_index()) {
+        src_block_ids.push_back(&src_col.secondary_index());
+      }
+    }
+    for (const DeltaDataPB& src_redo : src_rowset.redo_deltas()) {
+      src_block_ids.push_back(&src_redo.block());
+    }
+    for (const DeltaDataPB& src_undo : src_rowset.undo_deltas()) {
+      src_block_ids.push_back(&src_undo.block());
+    }
+    if (src_rowset.has_bloom_block()) {
+      src_block_ids.push_back(&src_rowset.bloom_block());
+    }
+    if (src_rowset.has_adhoc_index_block()) {
+      src_block_ids.push_back(&src_rowset.adhoc_index_block());
+    }
+  }
+  const int num_remote_blocks = src_block_ids.size();
+  DCHECK_EQ(CountRemoteBlocks(), num_remote_blocks);
+
+  // Download the blocks concurrently, each thread taking the next block to
+  // download until there are none left or a download fails.
+  const int num_threads = std::max(
+      1, std::min(FLAGS_tablet_copy_download_threads_per_session, num_remote_blocks));
+  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_remote_blocks << " data blocks "
+                        << "using " << num_threads << " threads...";
+  vector<BlockIdPB> new_block_ids(num_remote_blocks);
+  {
+    std::atomic<int> next_block(0);
+    std::atomic<int> block_count(0);
+    simple_spinlock status_lock;
+    Status status;
+    auto download = [&]() {
+      while (true) {
+        int idx = next_block++;
+        if (idx >= num_remote_blocks) {
+          return;
+        }
+        {
+          std::lock_guard<simple_spinlock> l(status_lock);
+          if (!status.ok()) {
+            return;
+          }
+        }
+        Status s = DownloadAndRewriteBlock(*src_block_ids[idx], num_remote_blocks,
+                                           &block_count, &new_block_ids[idx]);
+        if (PREDICT_FALSE(!s.ok())) {
+          std::lock_guard<simple_spinlock> l(status_lock);
+          if (status.ok()) {
+            status = s;
+          }
+          return;
+        }
+      }
+    };
+
+    gscoped_ptr<ThreadPool> pool;
+    RETURN_NOT_OK(ThreadPoolBuilder("tablet-copy-download")
+                  .set_max_threads(num_threads)
+                  .Build(&pool));
+    for (int i = 0; i < num_threads; i++) {
+      Status s = pool->SubmitFunc(download);
+      if (PREDICT_FALSE(!s.ok())) {
+        std::lock_guard<simple_spinlock> l(status_lock);
+        if (status.ok()) {
+          status = s;
+        }
+        break;
+      }
+    }
+    pool->Wait();
+    RETURN_NOT_OK(status);
+  }
 
-  // Download each block, writing the new block IDs into the new superblock
-  // as each block downloads.
-  int block_count = 0;
-  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_remote_blocks << " data blocks...";
+  // Now that every block is downloaded, reference them in the new superblock.
+  auto new_block_id = new_block_ids.begin();
   for (const RowSetDataPB& src_rowset : remote_superblock_->rowsets()) {
     // Create rowset.
     RowSetDataPB* dst_rowset = superblock_->add_rowsets();
@@ -578,46 +693,39 @@ Status TabletCopyClient::DownloadBlocks() {
     dst_rowset->clear_bloom_block();
     dst_rowset->clear_adhoc_index_block();
 
-    // We can't leave superblock_ unserializable with unset required field
-    // values in child elements, so we must download and rewrite each block
-    // before referencing it in the rowset.
+    std::unordered_map<BlockId, BlockIdPB, BlockIdHash, BlockIdEqual> new_col_blocks;
     for (const ColumnDataPB& src_col : src_rowset.columns()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_col.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
       ColumnDataPB* dst_col = dst_rowset->add_columns();
       *dst_col = src_col;
-      *dst_col->mutable_block() = new_block_id;
+      const BlockId src_block = BlockId::FromPB(src_col.block());
+      BlockIdPB* new_col_block = FindOrNull(new_col_blocks, src_block);
+      if (new_col_block == nullptr) {
+        new_col_block = &InsertKeyOrDie(&new_col_blocks, src_block);
+        *new_col_block = *new_block_id++;
+      }
+      *dst_col->mutable_block() = *new_col_block;
+      if (src_col.has_secondary_index()) {
+        *dst_col->mutable_secondary_index() = *new_block_id++;
+      }
     }
     for (const DeltaDataPB& src_redo : src_rowset.redo_deltas()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_redo.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
       DeltaDataPB* dst_redo = dst_rowset->add_redo_deltas();
       *dst_redo = src_redo;
-      *dst_redo->mutable_block() = new_block_id;
+      *dst_redo->mutable_block() = *new_block_id++;
     }
     for (const DeltaDataPB& src_undo : src_rowset.undo_deltas()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_undo.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
       DeltaDataPB* dst_undo = dst_rowset->add_undo_deltas();
       *dst_undo = src_undo;
-      *dst_undo->mutable_block() = new_block_id;
+      *dst_undo->mutable_block() = *new_block_id++;
     }
     if (src_rowset.has_bloom_block()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_rowset.bloom_block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      *dst_rowset->mutable_bloom_block() = new_block_id;
+      *dst_rowset->mutable_bloom_block() = *new_block_id++;
     }
     if (src_rowset.has_adhoc_index_block()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_rowset.adhoc_index_block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      *dst_rowset->mutable_adhoc_index_block() = new_block_id;
+      *dst_rowset->mutable_adhoc_index_block() = *new_block_id++;
     }
   }
+  DCHECK(new_block_id == new_block_ids.end());
 
   return Status::OK();
 }
@@ -670,12 +778,12 @@ Status TabletCopyClient::WriteConsensusMetadata() {
 
 Status TabletCopyClient::DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
                                                  int num_blocks,
-                                                 int* block_count,
+                                                 std::atomic<int>* block_count,
                                                  BlockIdPB* dest_block_id) {
   BlockId old_block_id(BlockId::FromPB(src_block_id));
   SetStatusMessage(Substitute("Downloading block $0 ($1/$2)",
                               old_block_id.ToString(),
-                              *block_count + 1, num_blocks));
+                              block_count->load() + 1, num_blocks));
   BlockId new_block_id;
   RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
       "Unable to download block with id " + old_block_id.ToString());
@@ -703,6 +811,7 @@ Status TabletCopyClient::DownloadBlock(const BlockId& old_block_id,
 
   *new_block_id = block->id();
   RETURN_NOT_OK_PREPEND(block->Finalize(), "Unable to finalize block");
+  std::lock_guard<simple_spinlock> l(transaction_lock_);
   transaction_->AddCreatedBlock(std::move(block));
   return Status::OK();
 }
@@ -717,11 +826,18 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
   req.set_session_id(session_id_);
   req.mutable_data_id()->CopyFrom(data_id);
   req.set_max_length(FLAGS_tablet_copy_transfer_chunk_size_bytes);
+  req.set_compression_codec(GetCompressionCodecType(FLAGS_tablet_copy_compression_codec));
 
+  faststring uncompressed;
   bool done = false;
   while (!done) {
     req.set_offset(offset);
 
+    // Wait for the server's budget to allow fetching another chunk.
+    while (throttler_ && !throttler_->Take(MonoTime::Now(), 0, req.max_length())) {
+      SleepFor(MonoDelta::FromMicroseconds(Throttler::kRefillPeriodMicros));
+    }
+
     // Request the next data chunk.
     FetchDataResponsePB resp;
     RETURN_NOT_OK_PREPEND(SendRpcWithRetry(&controller, [&] {
@@ -733,8 +849,18 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
                           Substitute("Error validating data item $0",
                                      pb_util::SecureShortDebugString(data_id)));
 
-    // Write the data.
-    RETURN_NOT_OK(appendable->Append(resp.chunk().data()));
+    // Uncompress and write the data.
+    Slice data(resp.chunk().data());
+    if (resp.chunk().compression_codec() != NO_COMPRESSION) {
+      const CompressionCodec* codec;
+      RETURN_NOT_OK(GetCompressionCodec(resp.chunk().compression_codec(), &codec));
+      uncompressed.resize(resp.chunk().uncompressed_length());
+      RETURN_NOT_OK_PREPEND(codec->Uncompress(data, uncompressed.data(), uncompressed.size()),
+                            Substitute("Unable to uncompress data item $0",
+                                       pb_util::SecureShortDebugString(data_id)));
+      data = Slice(uncompressed);
+    }
+    RETURN_NOT_OK(appendable->Append(data));
 
     if (PREDICT_FALSE(FLAGS_tablet_copy_download_file_inject_latency_ms > 0)) {
       LOG_WITH_PREFIX(INFO) << "Injecting latency into file download: " <<
@@ -742,11 +868,11 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_copy_download_file_inject_latency_ms));
     }
 
-    auto chunk_size = resp.chunk().data().size();
+    auto chunk_size = data.size();
     done = offset + chunk_size == resp.chunk().total_data_length();
     offset += chunk_size;
     if (tablet_copy_metrics_) {
-      tablet_copy_metrics_->bytes_fetched->IncrementBy(chunk_size);
+      tablet_copy_metrics_->bytes_fetched->IncrementBy(resp.chunk().data().size());
     }
   }
 
@@ -761,12 +887,14 @@ Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
   }
 
   // Verify that the chunk does not overflow the total data length.
-  if (offset + chunk.data().length() > chunk.total_data_length()) {
+  const uint64_t length = chunk.compression_codec() != NO_COMPRESSION ?
+      chunk.uncompressed_length() : chunk.data().length();
+  if (offset + length > chunk.total_data_length()) {
     return Status::InvalidArgument("Chunk exceeds total block data length",
-        Substitute("$0 vs $1", offset + chunk.data().length(), chunk.total_data_length()));
+        Substitute("$0 vs $1", offset + length, chunk.total_data_length()));
   }
 
-  // Verify the checksum.
+  // Verify the checksum, which covers the data as sent.
   uint32_t crc32 = crc::Crc32c(chunk.data().data(), chunk.data().length());
   if (PREDICT_FALSE(crc32 != chunk.crc32())) {
     return Status::Corruption(
@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -25,6 +26,7 @@
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
@@ -35,6 +37,7 @@ class BlockId;
 class BlockIdPB;
 class FsManager;
 class HostPort;
+class Throttler;
 
 namespace consensus {
 class ConsensusMetadata;
@@ -74,17 +77,20 @@ struct TabletCopyClientMetrics {
 // This class is not thread-safe.
 //
 // TODO:
-// * Parallelize download of blocks and WAL segments.
+// * Parallelize download of WAL segments.
 //
 class TabletCopyClient {
  public:
 
   // Construct the tablet copy client.
   // 'fs_manager' and 'messenger' must remain valid until this object is destroyed.
+  // If not null, 'throttler' is charged for the data fetched, and must also
+  // remain valid until this object is destroyed.
   TabletCopyClient(std::string tablet_id, FsManager* fs_manager,
                    scoped_refptr<consensus::ConsensusMetadataManager> cmeta_manager,
                    std::shared_ptr<rpc::Messenger> messenger,
-                   TabletCopyClientMetrics* tablet_copy_metrics);
+                   TabletCopyClientMetrics* tablet_copy_metrics,
+                   Throttler* throttler);
 
   // Attempt to clean up resources on the remote end by sending an
   // EndTabletCopySession() RPC
@@ -135,6 +141,7 @@ class TabletCopyClient {
   FRIEND_TEST(TabletCopyClientTest, TestVerifyData);
   FRIEND_TEST(TabletCopyClientTest, TestDownloadWalSegment);
   FRIEND_TEST(TabletCopyClientTest, TestDownloadAllBlocks);
+  FRIEND_TEST(TabletCopyClientTest, TestDownloadCompressedBlock);
   FRIEND_TEST(TabletCopyClientAbortTest, TestAbort);
 
   // State machine that guides the progression of a single tablet copy.
@@ -191,7 +198,8 @@ class TabletCopyClient {
   // Count the number of blocks on the remote (from 'remote_superblock_').
   int CountRemoteBlocks() const;
 
-  // Download all blocks belonging to a tablet sequentially. Add all
+  // Download all blocks belonging to a tablet, using up to
+  // --tablet_copy_download_threads_per_session concurrent downloads. Add all
   // downloaded blocks to the tablet copy's transaction.
   //
   // Blocks are given new IDs upon creation. On success, 'superblock_'
@@ -208,7 +216,7 @@ class TabletCopyClient {
   // - 'block_count' is incremented by 1.
   Status DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
                                  int num_blocks,
-                                 int* block_count,
+                                 std::atomic<int>* block_count,
                                  BlockIdPB* dest_block_id);
 
   // Download a single block.
@@ -269,13 +277,19 @@ class TabletCopyClient {
   std::vector<uint64_t> wal_seqnos_;
   int64_t start_time_micros_;
 
-  Random rng_;
+  // Used from the concurrent block downloads to jitter retries.
+  ThreadSafeRandom rng_;
 
   TabletCopyClientMetrics* tablet_copy_metrics_;
 
+  Throttler* const throttler_;
+
   // Block transaction for the tablet copy.
   std::unique_ptr<fs::BlockCreationTransaction> transaction_;
 
+  // Protects 'transaction_' while blocks are downloaded concurrently.
+  simple_spinlock transaction_lock_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletCopyClient);
 };
 
@@ -60,6 +60,7 @@
 
 DECLARE_bool(crash_on_eio);
 DECLARE_double(env_inject_eio);
+DECLARE_int32(tablet_copy_max_concurrent_sessions);
 DECLARE_uint64(tablet_copy_idle_timeout_sec);
 DECLARE_uint64(tablet_copy_timeout_poll_period_ms);
 
@@ -242,6 +243,23 @@ TEST_F(TabletCopyServiceTest, TestBeginTwice) {
   }
 }
 
+// Test that sessions beyond --tablet_copy_max_concurrent_sessions are rejected
+// as retriable, while the sessions already in progress carry on.
+TEST_F(TabletCopyServiceTest, TestMaxConcurrentSessions) {
+  FLAGS_tablet_copy_max_concurrent_sessions = 1;
+  string session_id;
+  ASSERT_OK(DoBeginValidTabletCopySession(&session_id));
+
+  BeginTabletCopySessionResponsePB resp;
+  RpcController controller;
+  Status s = DoBeginTabletCopySession(GetTabletId(), "other-requestor", &resp, &controller);
+  ASSERT_TRUE(s.IsRemoteError()) << s.ToString();
+  ASSERT_EQ(ErrorStatusPB::ERROR_SERVER_TOO_BUSY, controller.error_response()->code());
+
+  // Beginning the existing session again is still allowed.
+  ASSERT_OK(DoBeginValidTabletCopySession(&session_id));
+}
+
 // Regression test for KUDU-1436: race conditions if multiple requests
 // to begin the same tablet copy session arrive at more or less the
 // same time.
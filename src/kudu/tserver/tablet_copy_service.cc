@@ -16,7 +16,9 @@
 // under the License.
 #include "kudu/tserver/tablet_copy_service.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -29,16 +31,20 @@
 #include "kudu/consensus/log.pb.h"
 #include "kudu/consensus/log_util.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/quorum_util.h"
+#include "kudu/consensus/raft_consensus.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/server/server_base.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
@@ -46,6 +52,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random_util.h"
+#include "kudu/util/throttler.h"
 
 #define RPC_RETURN_NOT_OK(expr, app_err, message, context) \
   do { \
@@ -79,6 +86,17 @@ DEFINE_double(tablet_copy_early_session_timeout_prob, 0,
 TAG_FLAG(tablet_copy_early_session_timeout_prob, runtime);
 TAG_FLAG(tablet_copy_early_session_timeout_prob, unsafe);
 
+DEFINE_int32(tablet_copy_max_concurrent_sessions, 0,
+             "Maximum number of tablet copy sessions this server serves at once. "
+             "A quarter of them is reserved for the tablets left with no more than "
+             "a bare majority of healthy voters. Requests for more sessions are "
+             "rejected as if the server was too busy, and retried by the client. "
+             "0 means no limit.");
+TAG_FLAG(tablet_copy_max_concurrent_sessions, advanced);
+TAG_FLAG(tablet_copy_max_concurrent_sessions, runtime);
+
+DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
+
 using std::string;
 using std::vector;
 using strings::Substitute;
@@ -91,6 +109,11 @@ class Message;
 
 namespace kudu {
 
+using consensus::ConsensusStatePB;
+using consensus::HealthReportPB;
+using consensus::MajoritySize;
+using consensus::RaftConsensus;
+using consensus::RaftPeerPB;
 using crc::Crc32c;
 using server::ServerBase;
 using pb_util::SecureShortDebugString;
@@ -98,13 +121,47 @@ using tablet::TabletReplica;
 
 namespace tserver {
 
+namespace {
+
+// Returns whether losing one more voter would leave the tablet of 'replica'
+// without a majority of healthy voters. Only leaders know the health of the
+// other replicas, so this is false if 'replica' isn't the leader.
+bool IsAtRiskOfUnavailability(const scoped_refptr<TabletReplica>& replica) {
+  std::shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+  ConsensusStatePB cstate;
+  if (!consensus ||
+      !consensus->ConsensusState(&cstate, consensus::INCLUDE_HEALTH_REPORT).ok()) {
+    return false;
+  }
+  int num_voters = 0;
+  int num_healthy_voters = 0;
+  bool have_health = false;
+  for (const RaftPeerPB& peer : cstate.committed_config().peers()) {
+    if (peer.member_type() != RaftPeerPB::VOTER) {
+      continue;
+    }
+    num_voters++;
+    if (peer.has_health_report()) {
+      have_health = true;
+      if (peer.health_report().overall_health() == HealthReportPB::HEALTHY) {
+        num_healthy_voters++;
+      }
+    }
+  }
+  return have_health && num_healthy_voters <= MajoritySize(num_voters);
+}
+
+} // anonymous namespace
+
 TabletCopyServiceImpl::TabletCopyServiceImpl(
     ServerBase* server,
-    TabletReplicaLookupIf* tablet_replica_lookup)
+    TabletReplicaLookupIf* tablet_replica_lookup,
+    Throttler* throttler)
     : TabletCopyServiceIf(server->metric_entity(), server->result_tracker()),
       server_(server),
       fs_manager_(CHECK_NOTNULL(server->fs_manager())),
       tablet_replica_lookup_(CHECK_NOTNULL(tablet_replica_lookup)),
+      throttler_(throttler),
       rand_(GetRandomSeed32()),
       shutdown_latch_(1),
       tablet_copy_metrics_(server->metric_entity()) {
@@ -146,12 +203,30 @@ void TabletCopyServiceImpl::BeginTabletCopySession(
                     Substitute("Unable to find specified tablet: $0", tablet_id),
                     context);
 
+  // Sessions are only capped when they're requested, so a session already
+  // underway always runs to completion.
+  const int max_sessions = FLAGS_tablet_copy_max_concurrent_sessions;
+  int session_limit = max_sessions;
+  if (max_sessions > 0 && !IsAtRiskOfUnavailability(tablet_replica)) {
+    session_limit = max_sessions - max_sessions / 4;
+  }
+
   scoped_refptr<TabletCopySourceSession> session;
   bool new_session;
   {
     MutexLock l(sessions_lock_);
     const SessionEntry* session_entry = FindOrNull(sessions_, session_id);
     new_session = session_entry == nullptr;
+    if (new_session && max_sessions > 0 && sessions_.size() >= static_cast<size_t>(session_limit)) {
+      l.Unlock();
+      LOG_WITH_PREFIX(INFO) << Substitute(
+          "Rejecting tablet copy session on tablet $0 from peer $1: $2 sessions "
+          "already in progress", tablet_id, requestor_uuid, session_limit);
+      context->RespondRpcFailure(
+          rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
+          Status::ServiceUnavailable("too many tablet copy sessions in progress"));
+      return;
+    }
     if (new_session) {
       LOG_WITH_PREFIX(INFO) << Substitute(
           "Beginning new tablet copy session on tablet $0 from peer $1"
@@ -286,6 +361,21 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
   RPC_RETURN_NOT_OK(ValidateFetchRequestDataId(data_id, &error_code, session),
                     error_code, "Invalid DataId", context);
 
+  // Charge the most data the session may read for this request against the
+  // server's budget. Once it runs out, the client backs off and retries.
+  if (throttler_) {
+    int64_t max_read_length = FLAGS_tablet_copy_transfer_chunk_size_bytes;
+    if (client_maxlen > 0) {
+      max_read_length = std::min(client_maxlen, max_read_length);
+    }
+    if (!throttler_->Take(MonoTime::Now(), 0, max_read_length)) {
+      context->RespondRpcFailure(
+          rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
+          Status::ServiceUnavailable("tablet copy throughput limit reached"));
+      return;
+    }
+  }
+
   DataChunkPB* data_chunk = resp->mutable_chunk();
   string* data = data_chunk->mutable_data();
   int64_t total_data_length = 0;
@@ -306,6 +396,29 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
   data_chunk->set_total_data_length(total_data_length);
   data_chunk->set_offset(offset);
 
+  // Compress the chunk if the client asked for it, unless it doesn't get
+  // any smaller.
+  if (req->compression_codec() != NO_COMPRESSION &&
+      req->compression_codec() != DEFAULT_COMPRESSION &&
+      !data->empty()) {
+    const CompressionCodec* codec;
+    RPC_RETURN_NOT_OK(GetCompressionCodec(req->compression_codec(), &codec),
+                      TabletCopyErrorPB::INVALID_TABLET_COPY_REQUEST,
+                      "Invalid compression codec", context);
+    string compressed;
+    compressed.resize(codec->MaxCompressedLength(data->size()));
+    size_t compressed_length;
+    RPC_RETURN_NOT_OK(codec->Compress(*data, reinterpret_cast<uint8_t*>(&compressed[0]),
+                                      &compressed_length),
+                      TabletCopyErrorPB::UNKNOWN_ERROR, "Unable to compress data", context);
+    if (compressed_length < data->size()) {
+      compressed.resize(compressed_length);
+      data_chunk->set_compression_codec(req->compression_codec());
+      data_chunk->set_uncompressed_length(data->size());
+      data->swap(compressed);
+    }
+  }
+
   tablet_copy_metrics_.bytes_sent->IncrementBy(resp->chunk().data().size());
 
   // Calculate checksum.
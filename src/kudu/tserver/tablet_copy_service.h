@@ -41,6 +41,7 @@ class Message;
 namespace kudu {
 
 class FsManager;
+class Throttler;
 
 namespace server {
 class ServerBase;
@@ -56,8 +57,11 @@ class TabletReplicaLookupIf;
 
 class TabletCopyServiceImpl : public TabletCopyServiceIf {
  public:
+  // If not null, 'throttler' is charged for the data read by tablet copy
+  // sessions, and must outlive this object.
   TabletCopyServiceImpl(server::ServerBase* server,
-                        TabletReplicaLookupIf* tablet_replica_lookup);
+                        TabletReplicaLookupIf* tablet_replica_lookup,
+                        Throttler* throttler);
 
   bool AuthorizeServiceUser(const google::protobuf::Message* req,
                             google::protobuf::Message* resp,
@@ -123,6 +127,7 @@ class TabletCopyServiceImpl : public TabletCopyServiceIf {
   server::ServerBase* server_;
   FsManager* fs_manager_;
   TabletReplicaLookupIf* tablet_replica_lookup_;
+  Throttler* const throttler_;
 
   // Protects sessions_ map.
   mutable Mutex sessions_lock_;
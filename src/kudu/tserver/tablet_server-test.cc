@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <set>
 #include <sstream>
@@ -83,6 +84,7 @@
 #include "kudu/tserver/tablet_server-test-base.h"
 #include "kudu/tserver/tablet_server_options.h"
 #include "kudu/tserver/tablet_server_test_util.h"
+#include "kudu/tserver/tablet_service.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
@@ -147,6 +149,7 @@ DECLARE_bool(crash_on_eio);
 DECLARE_bool(enable_maintenance_manager);
 DECLARE_bool(fail_dns_resolution);
 DECLARE_bool(rowset_metadata_store_keys);
+DECLARE_bool(scanner_count_rows_from_metadata);
 DECLARE_double(cfile_inject_corruption);
 DECLARE_double(env_inject_eio);
 DECLARE_int32(flush_threshold_mb);
@@ -171,6 +174,8 @@ METRIC_DECLARE_counter(log_block_manager_holes_punched);
 METRIC_DECLARE_gauge_size(active_scanners);
 METRIC_DECLARE_gauge_size(tablet_active_scanners);
 METRIC_DECLARE_gauge_size(num_rowsets_on_disk);
+METRIC_DECLARE_histogram(write_op_apply_duration);
+METRIC_DECLARE_histogram(write_op_replication_duration);
 
 namespace kudu {
 
@@ -201,6 +206,21 @@ TEST_F(TabletServerTest, TestPingServer) {
   ASSERT_OK(proxy_->Ping(req, &resp, &controller));
 }
 
+// Test which writes are exempt from rejections under memory pressure.
+TEST(MemoryPressureAdmissionTest, TestHoldsSmallShareOfMemory) {
+  // A single tablet is the cause of the memory pressure, however small.
+  ASSERT_FALSE(HoldsSmallShareOfMemory(0, 0, 0));
+  ASSERT_FALSE(HoldsSmallShareOfMemory(0, 1000, 1));
+  // Four tablets holding 4000 bytes average 1000 bytes each: the tablets
+  // holding less than 500 bytes are spared.
+  ASSERT_TRUE(HoldsSmallShareOfMemory(0, 4000, 4));
+  ASSERT_TRUE(HoldsSmallShareOfMemory(499, 4000, 4));
+  ASSERT_FALSE(HoldsSmallShareOfMemory(500, 4000, 4));
+  ASSERT_FALSE(HoldsSmallShareOfMemory(3000, 4000, 4));
+  // Tablets holding the same memory are all rejected.
+  ASSERT_FALSE(HoldsSmallShareOfMemory(1000, 4000, 4));
+}
+
 TEST_F(TabletServerTest, TestStatus) {
   // Get the server's status.
   server::GetStatusRequestPB req;
@@ -506,6 +526,36 @@ TEST_F(TabletServerTest, TestFailedTabletsRejectConsensusState) {
   ASSERT_STR_CONTAINS(s.ToString(), "Tablet replica is shutdown");
 }
 
+// Test that a MultiUpdateConsensus RPC is handled per tablet, with errors
+// for one tablet not affecting the others.
+TEST_F(TabletServerTest, TestMultiUpdateConsensus) {
+  consensus::MultiUpdateConsensusRequestPB req;
+  auto add_request = [&](const string& tablet_id, const string& dest_uuid) {
+    consensus::ConsensusRequestPB* tablet_req = req.add_requests();
+    tablet_req->set_tablet_id(tablet_id);
+    tablet_req->set_dest_uuid(dest_uuid);
+    tablet_req->set_caller_uuid("fake-leader");
+    tablet_req->set_caller_term(0);
+  };
+  add_request(kTabletId, mini_server_->uuid());
+  add_request("nonexistent-tablet", mini_server_->uuid());
+  add_request(kTabletId, "wrong-uuid");
+
+  consensus::MultiUpdateConsensusResponsePB resp;
+  RpcController controller;
+  ASSERT_OK(consensus_proxy_->MultiUpdateConsensus(req, &resp, &controller));
+  ASSERT_EQ(3, resp.responses_size());
+
+  // The local replica is the leader of a later term, so it rejects the
+  // request, but in the consensus status rather than as a server error.
+  ASSERT_FALSE(resp.responses(0).has_error()) << SecureDebugString(resp);
+  ASSERT_TRUE(resp.responses(0).status().has_error()) << SecureDebugString(resp);
+  ASSERT_EQ(consensus::ConsensusErrorPB::INVALID_TERM,
+            resp.responses(0).status().error().code());
+  ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(1).error().code());
+  ASSERT_EQ(TabletServerErrorPB::WRONG_SERVER_UUID, resp.responses(2).error().code());
+}
+
 // Test that tablet replicas that get failed and deleted will eventually show
 // up as failed tombstones on the web UI.
 TEST_F(TabletServerTest, TestFailedTabletsOnWebUI) {
@@ -796,6 +846,61 @@ TEST_F(TabletServerTest, TestInsert) {
   ASSERT_GE(now_after.value(), now_before.value());
 }
 
+// Test that writes report the time spent in each of their phases, in the
+// tablet's metrics and, if asked to, in the response.
+TEST_F(TabletServerTest, TestWriteLatencyBreakdown) {
+  scoped_refptr<TabletReplica> replica;
+  ASSERT_TRUE(mini_server_->server()->tablet_manager()->LookupTablet(kTabletId, &replica));
+  scoped_refptr<Histogram> apply_duration =
+      METRIC_write_op_apply_duration.Instantiate(replica->tablet()->GetMetricEntity());
+  scoped_refptr<Histogram> replication_duration =
+      METRIC_write_op_replication_duration.Instantiate(replica->tablet()->GetMetricEntity());
+
+  WriteRequestPB req;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, req.mutable_schema()));
+  for (int i = 0; i < 100; i++) {
+    AddTestRowToPB(RowOperationsPB::INSERT, schema_, i, i, "original",
+                   req.mutable_row_operations());
+  }
+  for (int i = 0; i < 10; i++) {
+    AddTestRowToPB(RowOperationsPB::UPDATE, schema_, i, i + 1, "updated",
+                   req.mutable_row_operations());
+  }
+
+  // The breakdown is only returned on request.
+  {
+    WriteResponsePB resp;
+    RpcController controller;
+    ASSERT_OK(proxy_->Write(req, &resp, &controller));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+    ASSERT_FALSE(resp.has_latency_breakdown());
+  }
+  ASSERT_EQ(1, apply_duration->TotalCount());
+  ASSERT_EQ(1, replication_duration->TotalCount());
+
+  req.clear_row_operations();
+  for (int i = 100; i < 200; i++) {
+    AddTestRowToPB(RowOperationsPB::INSERT, schema_, i, i, "original",
+                   req.mutable_row_operations());
+  }
+  req.set_report_latency_breakdown(true);
+  WriteResponsePB resp;
+  RpcController controller;
+  ASSERT_OK(proxy_->Write(req, &resp, &controller));
+  ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+  ASSERT_TRUE(resp.has_latency_breakdown());
+  const WriteLatencyBreakdownPB& breakdown = resp.latency_breakdown();
+  ASSERT_GE(breakdown.prepare_micros(),
+            breakdown.decode_micros() + breakdown.row_locking_micros());
+  ASSERT_GE(breakdown.apply_micros(),
+            breakdown.presence_check_micros() + breakdown.mrs_insert_micros() +
+            breakdown.mutate_micros());
+  ASSERT_GT(breakdown.replication_micros(), 0);
+  ASSERT_EQ(0, breakdown.commit_wait_micros());
+  ASSERT_EQ(2, apply_duration->TotalCount());
+}
+
 TEST_F(TabletServerTest, TestExternalConsistencyModes_ClientPropagated) {
   WriteRequestPB req;
   req.set_tablet_id(kTabletId);
@@ -1436,6 +1541,51 @@ TEST_F(TabletServerTest, TestExactlyOnceForErrorsAcrossRestart) {
   }
 }
 
+// Test that the writes of a MultiTabletWrite RPC are tracked for exactly-once
+// semantics: resending one, either in another MultiTabletWrite RPC or in a
+// Write RPC of its own, returns its stored response instead of applying it
+// again.
+TEST_F(TabletServerTest, TestMultiTabletWriteIsAppliedOnce) {
+  MultiTabletWriteRequestPB req;
+  WriteRequestPB* write = req.add_writes();
+  write->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, write->mutable_schema()));
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1234, 5678, "hello world via RPC",
+                 write->mutable_row_operations());
+  rpc::RequestIdPB* req_id = req.add_request_ids();
+  req_id->set_client_id("client-id");
+  req_id->set_seq_no(1);
+  req_id->set_first_incomplete_seq_no(1);
+  req_id->set_attempt_no(0);
+
+  for (int i = 0; i < 2; i++) {
+    SCOPED_TRACE(Substitute("attempt #$0", i));
+    MultiTabletWriteResponsePB resp;
+    RpcController rpc;
+    ASSERT_OK(proxy_->MultiTabletWrite(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_EQ(1, resp.responses_size());
+    ASSERT_FALSE(resp.responses(0).has_error());
+    ASSERT_EQ(0, resp.responses(0).per_row_errors_size());
+  }
+
+  // The write resent in a Write RPC of its own, as the client does when a
+  // MultiTabletWrite RPC fails, gets the same response. The request itself
+  // is emptied: the stored response is returned without looking at it.
+  WriteRequestPB single_req;
+  single_req.set_tablet_id(kTabletId);
+  WriteResponsePB resp;
+  RpcController rpc;
+  unique_ptr<rpc::RequestIdPB> single_req_id(new rpc::RequestIdPB(*req_id));
+  single_req_id->set_attempt_no(1);
+  rpc.SetRequestIdPB(std::move(single_req_id));
+  ASSERT_OK(proxy_->Write(single_req, &resp, &rpc));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_EQ(0, resp.per_row_errors_size());
+  ANFF(VerifyRows(schema_, { KeyValue(1234, 5678) }));
+}
+
 // Regression test for KUDU-177. Ensures that after a major delta compaction,
 // rows that were in the old DRS's DMS are properly replayed.
 TEST_F(TabletServerTest, TestKUDU_177_RecoveryOfDMSEditsAfterMajorDeltaCompaction) {
@@ -1952,6 +2102,54 @@ TEST_F(TabletServerTest, TestSnapshotScan_LastRow) {
   }
 }
 
+// Test that a stateless scan resumed from the tokens of its responses returns
+// all the rows in order, without leaving scanners behind on the server.
+TEST_F(TabletServerTest, TestStatelessScan) {
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->set_stateless(true);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  req.set_batch_size_bytes(1000);
+
+  vector<string> results;
+  int num_requests = 0;
+  ScanResponsePB resp;
+  do {
+    RpcController rpc;
+    {
+      SCOPED_TRACE(SecureDebugString(req));
+      ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+      SCOPED_TRACE(SecureDebugString(resp));
+      ASSERT_FALSE(resp.has_error());
+    }
+    ASSERT_FALSE(resp.has_scanner_id());
+    ASSERT_EQ(0, mini_server_->server()->scanner_manager()->CountActiveScanners());
+    StringifyRowsFromResponse(schema_, rpc, &resp, &results);
+    ASSERT_EQ(resp.has_more_results(), resp.has_resume_token());
+    scan->set_resume_token(resp.resume_token());
+    num_requests++;
+  } while (resp.has_more_results());
+
+  ASSERT_GT(num_requests, 1);
+  ASSERT_EQ(kNumRows, results.size());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                         i, i * 2), results[i]);
+  }
+
+  // A stateless scan needs no state across requests, so it can't have a limit.
+  scan->clear_resume_token();
+  scan->set_limit(10);
+  RpcController rpc;
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+}
+
 // Tests that a read in the future succeeds if a propagated_timestamp (that is even
 // further in the future) follows along. Also tests that the clock was updated so
 // that no writes will ever have a timestamp post this snapshot.
@@ -2277,6 +2475,173 @@ TEST_F(TabletServerTest, TestScanWithPredicates) {
   ASSERT_EQ(50, results.size());
 }
 
+TEST_F(TabletServerTest, TestScanWithAggregates) {
+  const int num_rows = AllowSlowTests() ? 10000 : 1000;
+  InsertTestRowsDirect(0, num_rows);
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+
+  // Aggregate over an empty projection: the aggregated columns aren't projected.
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  req.set_batch_size_bytes(0); // so it won't return data right away
+  const auto add_aggregate = [&](AggregatePB::Function function, const string& column) {
+    AggregatePB* aggregate = scan->add_aggregates();
+    aggregate->set_function(function);
+    if (!column.empty()) {
+      aggregate->set_column(column);
+    }
+  };
+  add_aggregate(AggregatePB::COUNT, "");
+  add_aggregate(AggregatePB::SUM, "int_val");
+  add_aggregate(AggregatePB::MIN, "key");
+  add_aggregate(AggregatePB::MAX, "int_val");
+  add_aggregate(AggregatePB::COUNT, "string_val");
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.has_more_results());
+  }
+
+  // Drain the scanner, combining the partial results of each response.
+  int64_t count = 0;
+  int64_t count_strings = 0;
+  int64_t sum = 0;
+  int64_t min = std::numeric_limits<int64_t>::max();
+  int64_t max = std::numeric_limits<int64_t>::min();
+  const string scanner_id = resp.scanner_id();
+  uint32_t call_seq_id = 1;
+  while (resp.has_more_results()) {
+    req.Clear();
+    rpc.Reset();
+    req.set_scanner_id(scanner_id);
+    req.set_call_seq_id(call_seq_id++);
+    req.set_batch_size_bytes(1024);
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(0, resp.data().num_rows());
+    ASSERT_EQ(5, resp.aggregate_results_size());
+    count += resp.aggregate_results(0).int_value();
+    sum += resp.aggregate_results(1).int_value();
+    if (resp.aggregate_results(2).has_int_value()) {
+      min = std::min(min, resp.aggregate_results(2).int_value());
+    }
+    if (resp.aggregate_results(3).has_int_value()) {
+      max = std::max(max, resp.aggregate_results(3).int_value());
+    }
+    count_strings += resp.aggregate_results(4).int_value();
+  }
+  ASSERT_EQ(num_rows, count);
+  ASSERT_EQ(num_rows, count_strings);
+  ASSERT_EQ(static_cast<int64_t>(num_rows) * (num_rows - 1), sum);
+  ASSERT_EQ(0, min);
+  ASSERT_EQ((num_rows - 1) * 2, max);
+
+  // Aggregates of non-numeric columns other than COUNT are rejected.
+  req.Clear();
+  rpc.Reset();
+  scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  add_aggregate(AggregatePB::SUM, "string_val");
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  ASSERT_STR_CONTAINS(resp.error().status().message(), "cannot compute SUM");
+}
+
+// Test that COUNT(*) scans without predicates are answered without creating a
+// server-side scanner.
+TEST_F(TabletServerTest, TestScanCountRowsFromMetadata) {
+  InsertTestRowsDirect(0, 100);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(100, 10);
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->add_aggregates()->set_function(AggregatePB::COUNT);
+  req.set_batch_size_bytes(0);
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.has_more_results());
+    ASSERT_FALSE(resp.has_scanner_id());
+    ASSERT_EQ(1, resp.aggregate_results_size());
+    ASSERT_EQ(110, resp.aggregate_results(0).int_value());
+  }
+
+  // Without the fast path, the rows are scanned by a server-side scanner.
+  FLAGS_scanner_count_rows_from_metadata = false;
+  rpc.Reset();
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_TRUE(resp.has_more_results());
+  ASSERT_EQ(0, resp.aggregate_results_size());
+}
+
+// Test that top-N scans return the best rows of the tablet by a column, in
+// order, across flushed and unflushed rowsets.
+TEST_F(TabletServerTest, TestScanTopN) {
+  InsertTestRowsDirect(0, 300);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(300, 300);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(600, 100);
+
+  for (bool descending : { false, true }) {
+    SCOPED_TRACE(descending ? "descending" : "ascending");
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController rpc;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    TopNPB* top_n = scan->mutable_top_n();
+    top_n->set_column("int_val");
+    top_n->set_descending(descending);
+    top_n->set_limit(5);
+    req.set_batch_size_bytes(0);
+    {
+      SCOPED_TRACE(SecureDebugString(req));
+      ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+      SCOPED_TRACE(SecureDebugString(resp));
+      ASSERT_FALSE(resp.has_error());
+    }
+
+    vector<string> results;
+    ASSERT_NO_FATAL_FAILURE(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+    ASSERT_EQ(5, results.size());
+    for (int i = 0; i < results.size(); i++) {
+      int key = descending ? 699 - i : i;
+      ASSERT_EQ(Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                           key, key * 2), results[i]);
+    }
+  }
+
+  // Top-N scans can't have a limit.
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->mutable_top_n()->set_column("int_val");
+  scan->mutable_top_n()->set_limit(5);
+  scan->set_limit(10);
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+}
+
 TEST_F(TabletServerTest, TestScanWithEncodedPredicates) {
   InsertTestRowsDirect(0, 100);
 
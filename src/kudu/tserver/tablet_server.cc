@@ -17,31 +17,70 @@
 
 #include "kudu/tserver/tablet_server.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <ostream>
+#include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_cache_persister.h"
+#include "kudu/fs/block_id.h"
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/log_block_manager.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/service_if.h"
+#include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/heartbeater.h"
+#include "kudu/tserver/log_container_compaction_op.h"
+#include "kudu/tserver/resource_pools.h"
+#include "kudu/tserver/scan_scheduler.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_copy_service.h"
 #include "kudu/tserver/tablet_service.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver_path_handlers.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/net/net_util.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
+#include "kudu/util/throttler.h"
+
+DEFINE_int32(scan_threads, 20,
+             "Number of threads producing the batches of scans, separately from "
+             "the RPC service threads, so that heavy scans can't use up every "
+             "service thread. If 0, scans run on the RPC service threads.");
+TAG_FLAG(scan_threads, advanced);
+
+DEFINE_int32(scan_queue_length, 1000,
+             "Maximum number of scan requests waiting for a scan thread. Scan "
+             "requests beyond it are rejected as if the RPC queue was full.");
+TAG_FLAG(scan_queue_length, advanced);
+
+DEFINE_int64(tablet_copy_throughput_limit_bytes_per_sec, 0,
+             "Maximum number of bytes per second this server reads for the tablet "
+             "copies it serves and fetches for the tablet copies it runs, combined. "
+             "Keeps re-replication after a failure from starving foreground "
+             "operations of disk and network bandwidth. 0 means no limit.");
+TAG_FLAG(tablet_copy_throughput_limit_bytes_per_sec, advanced);
+
+DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
 
 using std::string;
+using std::unordered_map;
+using std::vector;
 using kudu::fs::ErrorHandlerType;
 using kudu::rpc::ServiceIf;
 
@@ -93,17 +132,62 @@ Status TabletServer::Init() {
     RETURN_NOT_OK(path_handlers_->Register(web_server_.get()));
   }
 
+  // Now that the block manager is open, warm up the block cache in the
+  // background while the tablets are bootstrapped.
+  TSTabletManager* tablet_manager = tablet_manager_.get();
+  block_cache_persister_.reset(new cfile::BlockCachePersister(
+      fs_manager_.get(), cfile::BlockCache::GetSingleton(),
+      [tablet_manager](unordered_map<uint64_t, string>* block_tablets) {
+        vector<scoped_refptr<tablet::TabletReplica>> replicas;
+        tablet_manager->GetTabletReplicas(&replicas);
+        for (const auto& replica : replicas) {
+          const string& tablet_id = replica->tablet_id();
+          for (const BlockId& block_id : replica->tablet_metadata()->CollectBlockIds()) {
+            (*block_tablets)[block_id.id()] = tablet_id;
+          }
+        }
+      }));
+  RETURN_NOT_OK_PREPEND(block_cache_persister_->Start(),
+                        "Could not start block cache persister");
+
   maintenance_manager_.reset(new MaintenanceManager(
       MaintenanceManager::kDefaultOptions, fs_manager_->uuid()));
+  auto* lbm = dynamic_cast<fs::LogBlockManager*>(fs_manager_->block_manager());
+  if (lbm && !fs_manager_->read_only()) {
+    log_container_compaction_op_.reset(new LogContainerCompactionOp(lbm, metric_entity()));
+    maintenance_manager_->RegisterOp(log_container_compaction_op_.get());
+  }
 
   heartbeater_.reset(new Heartbeater(opts_, this));
 
+  if (FLAGS_tablet_copy_throughput_limit_bytes_per_sec > 0) {
+    // Tablet copy data is charged a chunk at a time, so allow bursts of at
+    // least one chunk: a smaller bucket would never fill up enough.
+    const double refill_bytes = static_cast<double>(
+        FLAGS_tablet_copy_throughput_limit_bytes_per_sec) *
+        Throttler::kRefillPeriodMicros / MonoTime::kMicrosecondsPerSecond;
+    tablet_copy_throttler_.reset(new Throttler(
+        MonoTime::Now(), 0, FLAGS_tablet_copy_throughput_limit_bytes_per_sec,
+        std::max(1.0, FLAGS_tablet_copy_transfer_chunk_size_bytes / refill_bytes)));
+  }
+
+  // The pools must be known before any tablet is opened.
+  if (ResourcePools::Enabled()) {
+    resource_pools_.reset(new ResourcePools(metric_registry()));
+    RETURN_NOT_OK_PREPEND(resource_pools_->Init(), "Could not init resource pools");
+  }
+
   RETURN_NOT_OK_PREPEND(tablet_manager_->Init(),
                         "Could not init Tablet Manager");
 
   RETURN_NOT_OK_PREPEND(scanner_manager_->StartRemovalThread(),
                         "Could not start expired Scanner removal thread");
 
+  if (FLAGS_scan_threads > 0) {
+    scan_scheduler_.reset(new ScanScheduler(FLAGS_scan_threads, FLAGS_scan_queue_length));
+    RETURN_NOT_OK_PREPEND(scan_scheduler_->Init(), "Could not init scan scheduler");
+  }
+
   initted_ = true;
   return Status::OK();
 }
@@ -119,12 +203,14 @@ Status TabletServer::Start() {
       Bind(&TSTabletManager::FailTabletsInDataDir, Unretained(tablet_manager_.get())));
   fs_manager_->SetErrorNotificationCb(ErrorHandlerType::CFILE_CORRUPTION,
       Bind(&TSTabletManager::FailTabletAndScheduleShutdown, Unretained(tablet_manager_.get())));
+  fs_manager_->SetErrorNotificationCb(ErrorHandlerType::TABLET_FAILURE,
+      Bind(&TSTabletManager::FailTabletAndScheduleShutdown, Unretained(tablet_manager_.get())));
 
   gscoped_ptr<ServiceIf> ts_service(new TabletServiceImpl(this));
   gscoped_ptr<ServiceIf> admin_service(new TabletServiceAdminImpl(this));
   gscoped_ptr<ServiceIf> consensus_service(new ConsensusServiceImpl(this, tablet_manager_.get()));
   gscoped_ptr<ServiceIf> tablet_copy_service(new TabletCopyServiceImpl(
-      this, tablet_manager_.get()));
+      this, tablet_manager_.get(), tablet_copy_throttler_.get()));
 
   RETURN_NOT_OK(RegisterService(std::move(ts_service)));
   RETURN_NOT_OK(RegisterService(std::move(admin_service)));
@@ -145,14 +231,23 @@ void TabletServer::Shutdown() {
     string name = ToString();
     LOG(INFO) << name << " shutting down...";
 
-    // 1. Stop accepting new RPCs.
+    // 1. Stop accepting new RPCs. The scans handed off by the tablet service
+    //    are finished or dropped first, since they refer to the service.
+    if (scan_scheduler_) {
+      scan_scheduler_->Shutdown();
+    }
     UnregisterAllServices();
 
     // 2. Shut down the tserver's subsystems.
+    if (log_container_compaction_op_) {
+      log_container_compaction_op_->Unregister();
+    }
     maintenance_manager_->Shutdown();
     WARN_NOT_OK(heartbeater_->Stop(), "Failed to stop TS Heartbeat thread");
+    block_cache_persister_->Shutdown();
     fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::DISK_ERROR);
     fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::CFILE_CORRUPTION);
+    fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::TABLET_FAILURE);
     tablet_manager_->Shutdown();
 
     // 3. Shut down generic subsystems.
@@ -31,10 +31,18 @@
 namespace kudu {
 
 class MaintenanceManager;
+class Throttler;
+
+namespace cfile {
+class BlockCachePersister;
+} // namespace cfile
 
 namespace tserver {
 
 class Heartbeater;
+class LogContainerCompactionOp;
+class ResourcePools;
+class ScanScheduler;
 class ScannerManager;
 class TabletServerPathHandlers;
 class TSTabletManager;
@@ -68,6 +76,18 @@ class TabletServer : public kserver::KuduServer {
 
   ScannerManager* scanner_manager() { return scanner_manager_.get(); }
 
+  // Returns the scheduler of the scan threads, or null if scans run on the
+  // RPC service threads.
+  ScanScheduler* scan_scheduler() { return scan_scheduler_.get(); }
+
+  // Returns the resource pools splitting the work of this server, or null if
+  // it isn't split.
+  ResourcePools* resource_pools() { return resource_pools_.get(); }
+
+  // Returns the throughput budget shared by the tablet copies this server
+  // serves and the ones it runs, or null if tablet copies aren't throttled.
+  Throttler* tablet_copy_throttler() { return tablet_copy_throttler_.get(); }
+
   Heartbeater* heartbeater() { return heartbeater_.get(); }
 
   void set_fail_heartbeats_for_tests(bool fail_heartbeats_for_tests) {
@@ -103,6 +123,15 @@ class TabletServer : public kserver::KuduServer {
   // dependencies.
   gscoped_ptr<ScannerManager> scanner_manager_;
 
+  // Runs the scans handed off by the tablet service, if enabled.
+  gscoped_ptr<ScanScheduler> scan_scheduler_;
+
+  // The resource pools, if enabled.
+  gscoped_ptr<ResourcePools> resource_pools_;
+
+  // Throttles the data read for and fetched by tablet copies, if enabled.
+  gscoped_ptr<Throttler> tablet_copy_throttler_;
+
   // Thread responsible for heartbeating to the master.
   gscoped_ptr<Heartbeater> heartbeater_;
 
@@ -112,6 +141,13 @@ class TabletServer : public kserver::KuduServer {
   // The maintenance manager for this tablet server
   std::shared_ptr<MaintenanceManager> maintenance_manager_;
 
+  // Warms up the block cache on startup and persists it periodically.
+  gscoped_ptr<cfile::BlockCachePersister> block_cache_persister_;
+
+  // Compacts sparse log block containers. Null if the log block manager
+  // isn't in use.
+  gscoped_ptr<LogContainerCompactionOp> log_container_compaction_op_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletServer);
 };
 
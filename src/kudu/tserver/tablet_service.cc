@@ -44,9 +44,11 @@
 #include "kudu/common/key_range.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_checksum.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
+#include "kudu/common/top_n_threshold.h"
 #include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
@@ -54,6 +56,7 @@
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/raft_consensus.h"
 #include "kudu/consensus/replica_management.pb.h"
+#include "kudu/consensus/server_liveness.h"
 #include "kudu/consensus/time_manager.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/macros.h"
@@ -61,6 +64,8 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/remote_user.h"
+#include "kudu/rpc/result_tracker.h"
 #include "kudu/rpc/rpc_context.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_sidecar.h"
@@ -73,8 +78,14 @@
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/ingest_rowset_transaction.h"
 #include "kudu/tablet/transactions/transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/tserver/resource_pools.h"
+#include "kudu/tserver/scan_aggregator.h"
+#include "kudu/tserver/scan_buffer_pool.h"
+#include "kudu/tserver/scan_top_n.h"
+#include "kudu/tserver/scan_scheduler.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/tserver/tablet_server.h"
@@ -82,12 +93,13 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/tserver/tserver_service.pb.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/auto_release_pool.h"
-#include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -96,6 +108,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/trace_metrics.h"
 
@@ -110,6 +123,13 @@ DEFINE_int32(scanner_max_batch_size_bytes, 8 * 1024 * 1024,
 TAG_FLAG(scanner_max_batch_size_bytes, advanced);
 TAG_FLAG(scanner_max_batch_size_bytes, runtime);
 
+DEFINE_int64(scan_buffer_pool_capacity_mb, 256,
+             "The maximum number of megabytes of idle scan result buffers kept "
+             "to serialize later scan batches into, rather than allocating new "
+             "buffers for each batch. If 0, the buffers aren't kept.");
+TAG_FLAG(scan_buffer_pool_capacity_mb, advanced);
+TAG_FLAG(scan_buffer_pool_capacity_mb, experimental);
+
 DEFINE_int32(scanner_batch_size_rows, 100,
              "The number of rows to batch for servicing scan requests.");
 TAG_FLAG(scanner_batch_size_rows, advanced);
@@ -125,6 +145,33 @@ DEFINE_int32(scanner_max_wait_ms, 1000,
              "longer.");
 TAG_FLAG(scanner_max_wait_ms, advanced);
 
+DEFINE_bool(scanner_count_rows_from_metadata, true,
+            "Whether to answer COUNT(*) scans without predicates at READ_LATEST "
+            "from the rowsets' metadata where possible, instead of scanning them.");
+TAG_FLAG(scanner_count_rows_from_metadata, advanced);
+TAG_FLAG(scanner_count_rows_from_metadata, runtime);
+
+DEFINE_int32(scanner_time_slice_ms, 500,
+             "Maximum number of milliseconds a scan request spends producing its "
+             "batch, before responding with what it has so far and letting the "
+             "other scanners take their turns.");
+TAG_FLAG(scanner_time_slice_ms, advanced);
+TAG_FLAG(scanner_time_slice_ms, runtime);
+
+DEFINE_bool(scanner_shared_scans, false,
+            "Whether concurrent scans of the same tablet with the same snapshot, "
+            "projection and predicates read from a single pass over the tablet, "
+            "instead of each decoding the same data.");
+TAG_FLAG(scanner_shared_scans, experimental);
+TAG_FLAG(scanner_shared_scans, runtime);
+
+DEFINE_int32(tablet_multi_get_max_keys, 10000,
+             "Maximum number of keys a single MultiGet request may look up. "
+             "Larger requests are rejected; the client splits its lookups into "
+             "requests of fewer keys.");
+TAG_FLAG(tablet_multi_get_max_keys, advanced);
+TAG_FLAG(tablet_multi_get_max_keys, runtime);
+
 // Fault injection flags.
 DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "If set, the scanner will pause the specified number of milliesconds "
@@ -137,6 +184,15 @@ DEFINE_bool(scanner_inject_service_unavailable_on_continue_scan, false,
            "any Scan continuation RPC call. Used for tests.");
 TAG_FLAG(scanner_inject_service_unavailable_on_continue_scan, unsafe);
 
+DEFINE_bool(memory_pressure_spare_small_tablets, true,
+            "Whether writes to the tablets holding less than half of the average "
+            "memory held by this server's tablets are exempt from rejections when "
+            "the soft memory limit is exceeded, so that the rejections fall on "
+            "the tablets which consume the most memory. Writes are still rejected "
+            "for every tablet past the hard memory limit.");
+TAG_FLAG(memory_pressure_spare_small_tablets, advanced);
+TAG_FLAG(memory_pressure_spare_small_tablets, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_int32(memory_limit_warn_threshold_percentage);
 DECLARE_int32(tablet_history_max_age_sec);
@@ -153,6 +209,8 @@ using kudu::consensus::GetNodeInstanceResponsePB;
 using kudu::consensus::LeaderStepDownMode;
 using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
+using kudu::consensus::MultiUpdateConsensusRequestPB;
+using kudu::consensus::MultiUpdateConsensusResponsePB;
 using kudu::consensus::OpId;
 using kudu::consensus::RaftConsensus;
 using kudu::consensus::RunLeaderElectionRequestPB;
@@ -170,6 +228,7 @@ using kudu::rpc::RpcContext;
 using kudu::rpc::RpcSidecar;
 using kudu::server::ServerBase;
 using kudu::tablet::AlterSchemaTransactionState;
+using kudu::tablet::IngestRowSetTransactionState;
 using kudu::tablet::TABLET_DATA_COPYING;
 using kudu::tablet::TABLET_DATA_DELETED;
 using kudu::tablet::TABLET_DATA_TOMBSTONED;
@@ -177,6 +236,7 @@ using kudu::tablet::Tablet;
 using kudu::tablet::TabletReplica;
 using kudu::tablet::TransactionCompletionCallback;
 using kudu::tablet::WriteTransactionState;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -195,6 +255,24 @@ namespace tserver {
 
 namespace {
 
+// The trace metrics which break down the work done and the time spent
+// serving a scan request. See ResourceMetricsPB.
+const char* const kScanRowsScannedMetricName = "rows_scanned";
+const char* const kScanRowsReturnedMetricName = "rows_returned";
+const char* const kScanBlocksReadMetricName = "blocks_read";
+const char* const kScanBytesDecompressedMetricName = "bytes_decompressed";
+const char* const kScanDeltaUpdatesAppliedMetricName = "delta_updates_applied";
+const char* const kScanQueueNanosMetricName = "queue_nanos";
+const char* const kScanIoNanosMetricName = "io_nanos";
+const char* const kScanDecompressNanosMetricName = "decompress_nanos";
+const char* const kScanDecodeNanosMetricName = "decode_nanos";
+const char* const kScanDeltaApplyNanosMetricName = "delta_apply_nanos";
+const char* const kScanPredicateEvalNanosMetricName = "predicate_eval_nanos";
+const char* const kScanSerializeNanosMetricName = "serialize_nanos";
+const char* const kScanTotalDurationNanosMetricName = "total_duration_nanos";
+const char* const kScanCpuUserNanosMetricName = "cpu_user_nanos";
+const char* const kScanCpuSystemNanosMetricName = "cpu_system_nanos";
+
 // Lookup the given tablet, only ensuring that it exists.
 // If it does not, responds to the RPC associated with 'context' after setting
 // resp->mutable_error() to indicate the failure reason.
@@ -215,24 +293,34 @@ bool LookupTabletReplicaOrRespond(TabletReplicaLookupIf* tablet_manager,
   return true;
 }
 
-template<class RespClass>
-void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+// Returns the error for a request to 'replica', which is in the non-RUNNING
+// state 'tablet_state', and sets 'error_code' to go with it.
+Status TabletNotRunningError(const scoped_refptr<TabletReplica>& replica,
                              tablet::TabletStatePB tablet_state,
-                             RespClass* resp,
-                             rpc::RpcContext* context) {
+                             TabletServerErrorPB::Code* error_code) {
   Status s = Status::IllegalState("Tablet not RUNNING",
                                   tablet::TabletStatePB_Name(tablet_state));
-  auto error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+  *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
   if (replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_TOMBSTONED ||
       replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_DELETED) {
     // Treat tombstoned tablets as if they don't exist for most purposes.
     // This takes precedence over failed, since we don't reset the failed
     // status of a TabletReplica when deleting it. Only tablet copy does that.
-    error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
   } else if (tablet_state == tablet::FAILED) {
     s = s.CloneAndAppend(replica->error().ToString());
-    error_code = TabletServerErrorPB::TABLET_FAILED;
+    *error_code = TabletServerErrorPB::TABLET_FAILED;
   }
+  return s;
+}
+
+template<class RespClass>
+void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+                             tablet::TabletStatePB tablet_state,
+                             RespClass* resp,
+                             rpc::RpcContext* context) {
+  TabletServerErrorPB::Code error_code;
+  Status s = TabletNotRunningError(replica, tablet_state, &error_code);
   SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
 }
 
@@ -391,6 +479,48 @@ void HandleErrorResponse(const ReqType* req, RespType* resp, RpcContext* context
   }
 }
 
+// A transaction completion callback that releases the bytes a write was
+// admitted with in its resource pool, then hands the completion to another
+// callback.
+class ResourcePoolWriteCompletionCallback : public TransactionCompletionCallback {
+ public:
+  ResourcePoolWriteCompletionCallback(ResourcePools* pools,
+                                      ResourcePool* pool,
+                                      int64_t bytes,
+                                      gscoped_ptr<TransactionCompletionCallback> callback)
+      : pools_(pools),
+        pool_(pool),
+        bytes_(bytes),
+        callback_(std::move(callback)) {
+  }
+
+  ~ResourcePoolWriteCompletionCallback() {
+    // The write may be dropped without completing.
+    Release();
+  }
+
+  void TransactionCompleted() override {
+    Release();
+    if (!status_.ok()) {
+      callback_->set_error(status_, code_);
+    }
+    callback_->TransactionCompleted();
+  }
+
+ private:
+  void Release() {
+    if (pools_) {
+      pools_->ReleaseWrite(pool_, bytes_);
+      pools_ = nullptr;
+    }
+  }
+
+  ResourcePools* pools_;
+  ResourcePool* const pool_;
+  const int64_t bytes_;
+  gscoped_ptr<TransactionCompletionCallback> callback_;
+};
+
 // A transaction completion callback that responds to the client when transactions
 // complete and sets the client error if there is one to set.
 template<class Response>
@@ -420,6 +550,77 @@ class RpcTransactionCompletionCallback : public TransactionCompletionCallback {
   tablet::TransactionState* state_;
 };
 
+// Responds to a MultiTabletWrite RPC once all of its writes have completed.
+class MultiTabletWriteTracker {
+ public:
+  // 'num_writes' is the number of writes in the RPC. One more completion,
+  // signaled once all the writes have been submitted, is expected.
+  MultiTabletWriteTracker(rpc::RpcContext* context, int num_writes)
+      : context_(context),
+        num_pending_(num_writes + 1) {
+  }
+
+  void WriteCompleted() {
+    if (num_pending_.IncrementBy(-1) == 0) {
+      context_->RespondSuccess();
+    }
+  }
+
+ private:
+  rpc::RpcContext* context_;
+  AtomicInt<int32_t> num_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiTabletWriteTracker);
+};
+
+// Records the result of one of the writes of a MultiTabletWrite RPC with the
+// result tracker, if the write has a request id. A failed write's record is
+// dropped, so that the write can be retried.
+void RecordMultiTabletWriteResult(rpc::ResultTracker* result_tracker,
+                                  const rpc::RequestIdPB* request_id,
+                                  WriteResponsePB* response) {
+  if (request_id == nullptr) {
+    return;
+  }
+  if (response->has_error()) {
+    result_tracker->FailAndRespond(*request_id, response);
+  } else {
+    result_tracker->RecordCompletionAndRespond(*request_id, response);
+  }
+}
+
+// A transaction completion callback for one of the writes of a
+// MultiTabletWrite RPC: sets the write's error, if any, in its response
+// instead of failing the whole RPC, and records the write's result for
+// exactly-once semantics.
+class MultiTabletWriteCompletionCallback : public TransactionCompletionCallback {
+ public:
+  MultiTabletWriteCompletionCallback(shared_ptr<MultiTabletWriteTracker> tracker,
+                                     scoped_refptr<rpc::ResultTracker> result_tracker,
+                                     const rpc::RequestIdPB* request_id,
+                                     WriteResponsePB* response)
+      : tracker_(std::move(tracker)),
+        result_tracker_(std::move(result_tracker)),
+        request_id_(request_id),
+        response_(response) {
+  }
+
+  void TransactionCompleted() override {
+    if (!status_.ok()) {
+      StatusToPB(status_, response_->mutable_error()->mutable_status());
+      response_->mutable_error()->set_code(code_);
+    }
+    RecordMultiTabletWriteResult(result_tracker_.get(), request_id_, response_);
+    tracker_->WriteCompleted();
+  }
+
+ private:
+  const shared_ptr<MultiTabletWriteTracker> tracker_;
+  const scoped_refptr<rpc::ResultTracker> result_tracker_;
+  const rpc::RequestIdPB* request_id_;
+  WriteResponsePB* response_;
+};
+
 // Generic interface to handle scan results.
 class ScanResultCollector {
  public:
@@ -443,6 +644,31 @@ class ScanResultCollector {
   //
   // Does nothing by default.
   virtual void set_row_format_flags(uint64_t /* row_format_flags */) {}
+
+  // Sets the aggregates to compute instead of returning rows, for the same
+  // reason as 'set_row_format_flags' above.
+  //
+  // Does nothing by default.
+  virtual void set_aggregates(
+      const vector<ScanAggregator::Aggregate>& /* aggregates */) {}
+
+  // Handles 'num_rows' rows which were counted without being scanned, for
+  // scans which only count rows.
+  //
+  // Does nothing by default.
+  virtual void HandleRowCount(Scanner* /* scanner */, int64_t /* num_rows */) {}
+
+  // Returns the name and stats of each column read to serve the request, for
+  // scans which report them (see NewScanRequestPB.report_column_stats).
+  vector<pair<string, IteratorStats>>* mutable_column_stats() {
+    return &column_stats_;
+  }
+  const vector<pair<string, IteratorStats>>& column_stats() const {
+    return column_stats_;
+  }
+
+ private:
+  vector<pair<string, IteratorStats>> column_stats_;
 };
 
 namespace {
@@ -464,9 +690,43 @@ void SetLastRow(const RowBlock& row_block, faststring* last_primary_key) {
   }
 }
 
+// Moves the buffers of 'batch' into the outbound sidecars of 'context',
+// recording their indexes in 'pb'. 'batch' may be nullptr if no row was
+// returned. Empty buffers are not sent.
+void AddColumnarSidecars(ColumnarSerializedBatch* batch,
+                         ColumnarRowBlockPB* pb,
+                         RpcContext* context) {
+  if (!batch) {
+    pb->set_num_rows(0);
+    return;
+  }
+  pb->set_num_rows(batch->num_rows());
+  auto add_sidecar = [&](unique_ptr<faststring> buf) {
+    int idx;
+    CHECK_OK(context->AddOutboundSidecar(RpcSidecar::FromFaststring(std::move(buf)), &idx));
+    return idx;
+  };
+  for (auto& col : *batch->mutable_columns()) {
+    ColumnarRowBlockPB::Column* col_pb = pb->add_columns();
+    if (col.data->size() > 0) {
+      col_pb->set_data_sidecar(add_sidecar(std::move(col.data)));
+    }
+    if (col.varlen_data && col.varlen_data->size() > 0) {
+      col_pb->set_varlen_data_sidecar(add_sidecar(std::move(col.varlen_data)));
+    }
+    if (col.non_null_bitmap && col.non_null_bitmap->size() > 0) {
+      col_pb->set_non_null_bitmap_sidecar(add_sidecar(std::move(col.non_null_bitmap)));
+    }
+    if (col.dictionary_offsets) {
+      col_pb->set_dictionary_offsets_sidecar(add_sidecar(std::move(col.dictionary_offsets)));
+    }
+  }
+}
+
 }  // namespace
 
-// Copies the scan result to the given row block PB and data buffers.
+// Copies the scan result to the given row block PB and to data buffers taken
+// from 'buffer_pool', sized from the scanner's previous batch.
 //
 // This implementation is used in the common case where a client is running
 // a scan and the data needs to be returned to the client.
@@ -477,13 +737,15 @@ void SetLastRow(const RowBlock& row_block, faststring* last_primary_key) {
 class ScanResultCopier : public ScanResultCollector {
  public:
   ScanResultCopier(RowwiseRowBlockPB* rowblock_pb,
-                   faststring* rows_data,
-                   faststring* indirect_data)
+                   ScanBufferPool* buffer_pool,
+                   size_t batch_size_bytes)
       : rowblock_pb_(DCHECK_NOTNULL(rowblock_pb)),
-        rows_data_(DCHECK_NOTNULL(rows_data)),
-        indirect_data_(DCHECK_NOTNULL(indirect_data)),
+        buffer_pool_(DCHECK_NOTNULL(buffer_pool)),
+        batch_size_bytes_(batch_size_bytes),
         num_rows_returned_(0),
-        pad_unixtime_micros_to_16_bytes_(false) {}
+        pad_unixtime_micros_to_16_bytes_(false),
+        columnar_(false),
+        dictionary_encode_(false) {}
 
   void HandleRowBlock(Scanner* scanner, const RowBlock& row_block) override {
     int64_t num_selected = row_block.selection_vector()->CountSelected();
@@ -491,16 +753,45 @@ class ScanResultCopier : public ScanResultCollector {
     // all rows in the block were deleted)
     if (num_selected == 0) return;
 
+    if (aggregator_) {
+      scanner->add_num_rows_returned(num_selected);
+      aggregator_->Add(row_block);
+      SetLastRow(row_block, &last_primary_key_);
+      return;
+    }
+
     num_rows_returned_ += num_selected;
     scanner->add_num_rows_returned(num_selected);
-    SerializeRowBlock(row_block, rowblock_pb_, scanner->client_projection_schema(),
-                      rows_data_, indirect_data_, pad_unixtime_micros_to_16_bytes_);
+    if (columnar_) {
+      if (!columnar_batch_) {
+        // The scanner may be gone by the time the response is built, so keep
+        // a copy of its projection.
+        columnar_schema_ = *scanner->client_projection_schema();
+        columnar_batch_.reset(new ColumnarSerializedBatch(columnar_schema_, dictionary_encode_));
+      }
+      columnar_batch_->AddRowBlock(row_block);
+    } else {
+      if (!rows_data_) {
+        AcquireBuffers(*scanner);
+      }
+      SerializeRowBlock(row_block, rowblock_pb_, scanner->client_projection_schema(),
+                        rows_data_.get(), indirect_data_.get(),
+                        pad_unixtime_micros_to_16_bytes_);
+      scanner->set_last_batch_bytes(rows_data_->size(), indirect_data_->size());
+    }
     SetLastRow(row_block, &last_primary_key_);
   }
 
   // Returns number of bytes buffered to return.
   int64_t ResponseSize() const override {
-    return rows_data_->size() + indirect_data_->size();
+    int64_t size = 0;
+    if (rows_data_) {
+      size += rows_data_->size() + indirect_data_->size();
+    }
+    if (columnar_batch_) {
+      size += columnar_batch_->TotalSizeBytes();
+    }
+    return size;
   }
 
   const faststring& last_primary_key() const override {
@@ -515,15 +806,81 @@ class ScanResultCopier : public ScanResultCollector {
     if (row_format_flags & RowFormatFlags::PAD_UNIX_TIME_MICROS_TO_16_BYTES) {
       pad_unixtime_micros_to_16_bytes_ = true;
     }
+    if (row_format_flags & RowFormatFlags::COLUMNAR_LAYOUT) {
+      columnar_ = true;
+    }
+    if (row_format_flags & RowFormatFlags::COLUMNAR_DICTIONARY_ENCODING) {
+      dictionary_encode_ = true;
+    }
+  }
+
+  void set_aggregates(const vector<ScanAggregator::Aggregate>& aggregates) override {
+    if (!aggregates.empty()) {
+      aggregator_.reset(new ScanAggregator(aggregates));
+    }
+  }
+
+  void HandleRowCount(Scanner* scanner, int64_t num_rows) override {
+    DCHECK(aggregator_);
+    scanner->add_num_rows_returned(num_rows);
+    aggregator_->AddRowCount(num_rows);
+  }
+
+  // Returns the aggregator which computes the scan's aggregates instead of
+  // copying rows, or nullptr if the scan returns rows.
+  const ScanAggregator* aggregator() const {
+    return aggregator_.get();
+  }
+
+  // Whether the rows are returned in columnar layout.
+  bool columnar() const {
+    return columnar_;
+  }
+
+  // Returns the rows copied in columnar layout, or nullptr if no rows were
+  // copied in columnar layout.
+  ColumnarSerializedBatch* columnar_batch() const {
+    return columnar_batch_.get();
+  }
+
+  // Returns the buffers of the rows and of their indirect data. They're empty
+  // if no row was copied in row-wise layout.
+  unique_ptr<faststring> release_rows_data() {
+    return rows_data_ ? std::move(rows_data_) : buffer_pool_->Acquire(0);
+  }
+  unique_ptr<faststring> release_indirect_data() {
+    return indirect_data_ ? std::move(indirect_data_) : buffer_pool_->Acquire(0);
   }
 
  private:
+  // Takes the buffers of the batch from the pool. The batch is expected to
+  // be about as large as the scanner's previous one, or as the batch size if
+  // it's the first one, and may exceed the batch size by a row block.
+  void AcquireBuffers(const Scanner& scanner) {
+    size_t rows_bytes = batch_size_bytes_ * 11 / 10;
+    size_t indirect_bytes = rows_bytes;
+    if (scanner.last_batch_rows_bytes() > 0) {
+      rows_bytes = std::min(rows_bytes, scanner.last_batch_rows_bytes() * 11 / 10);
+      indirect_bytes = std::min(indirect_bytes,
+                                scanner.last_batch_indirect_bytes() * 11 / 10);
+    }
+    rows_data_ = buffer_pool_->Acquire(rows_bytes);
+    indirect_data_ = buffer_pool_->Acquire(indirect_bytes);
+  }
+
   RowwiseRowBlockPB* const rowblock_pb_;
-  faststring* const rows_data_;
-  faststring* const indirect_data_;
+  ScanBufferPool* const buffer_pool_;
+  const size_t batch_size_bytes_;
+  unique_ptr<faststring> rows_data_;
+  unique_ptr<faststring> indirect_data_;
   int64_t num_rows_returned_;
   faststring last_primary_key_;
   bool pad_unixtime_micros_to_16_bytes_;
+  bool columnar_;
+  bool dictionary_encode_;
+  Schema columnar_schema_;
+  unique_ptr<ColumnarSerializedBatch> columnar_batch_;
+  unique_ptr<ScanAggregator> aggregator_;
 
   DISALLOW_COPY_AND_ASSIGN(ScanResultCopier);
 };
@@ -532,8 +889,7 @@ class ScanResultCopier : public ScanResultCollector {
 class ScanResultChecksummer : public ScanResultCollector {
  public:
   ScanResultChecksummer()
-      : crc_(crc::GetCrc32cInstance()),
-        agg_checksum_(0),
+      : agg_checksum_(0),
         rows_checksummed_(0) {
   }
 
@@ -545,13 +901,9 @@ class ScanResultChecksummer : public ScanResultCollector {
       client_projection_schema = &row_block.schema();
     }
 
-    size_t nrows = row_block.nrows();
-    for (size_t i = 0; i < nrows; i++) {
-      if (!row_block.selection_vector()->IsRowSelected(i)) continue;
-      uint32_t row_crc = CalcRowCrc32(*client_projection_schema, row_block.row(i));
-      agg_checksum_ += row_crc;
-      rows_checksummed_++;
-    }
+    rows_checksummed_ += checksummer_.Checksum(row_block,
+                                               client_projection_schema->num_columns(),
+                                               &agg_checksum_);
     // Find the last selected row and save its encoded key.
     SetLastRow(row_block, &encoded_last_row_);
   }
@@ -574,35 +926,7 @@ class ScanResultChecksummer : public ScanResultCollector {
   uint64_t agg_checksum() const { return agg_checksum_; }
 
  private:
-  // Calculates a CRC32C for the given row.
-  uint32_t CalcRowCrc32(const Schema& projection, const RowBlockRow& row) {
-    tmp_buf_.clear();
-
-    for (size_t j = 0; j < projection.num_columns(); j++) {
-      uint32_t col_index = static_cast<uint32_t>(j);  // For the CRC.
-      tmp_buf_.append(&col_index, sizeof(col_index));
-      ColumnBlockCell cell = row.cell(j);
-      if (cell.is_nullable()) {
-        uint8_t is_defined = cell.is_null() ? 0 : 1;
-        tmp_buf_.append(&is_defined, sizeof(is_defined));
-        if (!is_defined) continue;
-      }
-      if (cell.typeinfo()->physical_type() == BINARY) {
-        const Slice* data = reinterpret_cast<const Slice *>(cell.ptr());
-        tmp_buf_.append(data->data(), data->size());
-      } else {
-        tmp_buf_.append(cell.ptr(), cell.size());
-      }
-    }
-
-    uint64_t row_crc = 0;
-    crc_->Compute(tmp_buf_.data(), tmp_buf_.size(), &row_crc, nullptr);
-    return static_cast<uint32_t>(row_crc); // CRC32 only uses the lower 32 bits.
-  }
-
-
-  faststring tmp_buf_;
-  crc::Crc* const crc_;
+  RowBlockChecksummer checksummer_;
   uint64_t agg_checksum_;
   int64_t rows_checksummed_;
   faststring encoded_last_row_;
@@ -610,6 +934,13 @@ class ScanResultChecksummer : public ScanResultCollector {
   DISALLOW_COPY_AND_ASSIGN(ScanResultChecksummer);
 };
 
+bool HoldsSmallShareOfMemory(int64_t tablet_bytes, int64_t all_tablets_bytes, int num_tablets) {
+  if (num_tablets <= 1) {
+    return false;
+  }
+  return tablet_bytes * 2 * num_tablets < all_tablets_bytes;
+}
+
 // Return the batch size to use for a given request, after clamping
 // the user-requested request within the server-side allowable range.
 // This is only a hint, really more of a threshold since returned bytes
@@ -625,7 +956,32 @@ static size_t GetMaxBatchSizeBytesHint(const ScanRequestPB* req) {
 
 TabletServiceImpl::TabletServiceImpl(TabletServer* server)
   : TabletServerServiceIf(server->metric_entity(), server->result_tracker()),
-    server_(server) {
+    server_(server),
+    scan_buffer_pool_(std::make_shared<ScanBufferPool>(
+        FLAGS_scan_buffer_pool_capacity_mb * 1024 * 1024, server->mem_tracker())) {
+}
+
+bool TabletServiceImpl::TabletHoldsSmallShareOfMemory(const Tablet& tablet) {
+  const MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(tablets_memory_lock_);
+  // Summing up the memory of every tablet is only worth it once in a while.
+  if (!tablets_memory_refreshed_.Initialized() ||
+      now - tablets_memory_refreshed_ > MonoDelta::FromSeconds(1)) {
+    vector<scoped_refptr<TabletReplica>> replicas;
+    server_->tablet_manager()->GetTabletReplicas(&replicas);
+    tablets_memory_bytes_ = 0;
+    num_tablets_with_memory_ = 0;
+    for (const auto& replica : replicas) {
+      shared_ptr<Tablet> t = replica->shared_tablet();
+      if (t) {
+        tablets_memory_bytes_ += t->mem_tracker()->consumption();
+        num_tablets_with_memory_++;
+      }
+    }
+    tablets_memory_refreshed_ = now;
+  }
+  return HoldsSmallShareOfMemory(tablet.mem_tracker()->consumption(),
+                                 tablets_memory_bytes_, num_tablets_with_memory_);
 }
 
 bool TabletServiceImpl::AuthorizeClientOrServiceUser(const google::protobuf::Message* /*req*/,
@@ -731,6 +1087,90 @@ void TabletServiceAdminImpl::AlterSchema(const AlterSchemaRequestPB* req,
   }
 }
 
+void TabletServiceAdminImpl::StageRowSetForIngest(const StageRowSetForIngestRequestPB* req,
+                                                  StageRowSetForIngestResponsePB* resp,
+                                                  rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "StageRowSetForIngest", req, resp,
+                               context)) {
+    return;
+  }
+  DVLOG(3) << "Received Stage RowSet For Ingest RPC: " << SecureDebugString(*req);
+
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
+                                           context, &replica)) {
+    return;
+  }
+
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(replica, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  if (req->discard()) {
+    s = tablet->DiscardStagedRowSet(req->ingest_id());
+  } else {
+    // The blocks are copied in this RPC thread: unlike the replicated op,
+    // staging holds no tablet lock while it does I/O.
+    s = tablet->StageRowSetForIngest(req->ingest_id(), req->schema_version(),
+                                     req->source_fs_root(), req->source_rowset());
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         s.IsInvalidArgument() ? TabletServerErrorPB::MISMATCHED_SCHEMA
+                                               : TabletServerErrorPB::UNKNOWN_ERROR,
+                         context);
+    return;
+  }
+  context->RespondSuccess();
+}
+
+void TabletServiceAdminImpl::IngestRowSet(const IngestRowSetRequestPB* req,
+                                          IngestRowSetResponsePB* resp,
+                                          rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "IngestRowSet", req, resp, context)) {
+    return;
+  }
+  DVLOG(3) << "Received Ingest RowSet RPC: " << SecureDebugString(*req);
+
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
+                                           context, &replica)) {
+    return;
+  }
+
+  // Reject a rowset written with the wrong schema early. The leader repeats
+  // the check when the op is prepared, since the schema may change meanwhile.
+  uint32_t schema_version = replica->tablet_metadata()->schema_version();
+  if (schema_version != req->schema_version()) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::InvalidArgument(
+                             Substitute("rowset has schema version $0, tablet has version $1",
+                                        req->schema_version(), schema_version)),
+                         TabletServerErrorPB::MISMATCHED_SCHEMA, context);
+    return;
+  }
+
+  unique_ptr<IngestRowSetTransactionState> tx_state(
+    new IngestRowSetTransactionState(replica.get(), req, resp));
+
+  tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+      new RpcTransactionCompletionCallback<IngestRowSetResponsePB>(context,
+                                                                   resp)));
+
+  // Submit the ingest op. The RPC will be responded to asynchronously.
+  Status s = replica->SubmitIngestRowSet(std::move(tx_state));
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::UNKNOWN_ERROR,
+                         context);
+    return;
+  }
+}
+
 void TabletServiceAdminImpl::CreateTablet(const CreateTabletRequestPB* req,
                                           CreateTabletResponsePB* resp,
                                           rpc::RpcContext* context) {
@@ -834,34 +1274,122 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
                "tablet_id", req->tablet_id());
   DVLOG(3) << "Received Write RPC: " << SecureDebugString(*req);
 
-  scoped_refptr<TabletReplica> replica;
-  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
-                                           context, &replica)) {
-    return;
-  }
-
-  shared_ptr<Tablet> tablet;
   TabletServerErrorPB::Code error_code;
-  Status s = GetTabletRef(replica, &tablet, &error_code);
+  Status s = SubmitWrite(req, resp,
+                         context->AreResultsTracked() ? context->request_id() : nullptr,
+                         gscoped_ptr<TransactionCompletionCallback>(
+                             new RpcTransactionCompletionCallback<WriteResponsePB>(context,
+                                                                                   resp)),
+                         context->GetTimeReceived(),
+                         context->remote_user().username(),
+                         &error_code);
   if (PREDICT_FALSE(!s.ok())) {
     SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
-    return;
   }
+}
+
+void TabletServiceImpl::MultiTabletWrite(const MultiTabletWriteRequestPB* req,
+                                         MultiTabletWriteResponsePB* resp,
+                                         rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::MultiTabletWrite",
+               "num_writes", req->writes_size());
+  DVLOG(3) << "Received MultiTabletWrite RPC with " << req->writes_size() << " writes";
+
+  // Add all the responses upfront, so that the pointers handed to the
+  // transactions stay valid.
+  for (int i = 0; i < req->writes_size(); i++) {
+    resp->add_responses();
+  }
+  shared_ptr<MultiTabletWriteTracker> tracker(
+      new MultiTabletWriteTracker(context, req->writes_size()));
+  const scoped_refptr<rpc::ResultTracker>& result_tracker = server_->result_tracker();
+  for (int i = 0; i < req->writes_size(); i++) {
+    const WriteRequestPB* write = &req->writes(i);
+    WriteResponsePB* write_resp = resp->mutable_responses(i);
+
+    // Like a Write RPC, a write with a request id is only applied once: a
+    // write which already completed gets its stored response, and one which
+    // is in progress, e.g. as a retry in a Write RPC of its own, is failed so
+    // that the client retries it with a Write RPC which waits for it.
+    const rpc::RequestIdPB* request_id = nullptr;
+    if (i < req->request_ids_size()) {
+      request_id = &req->request_ids(i);
+      Status s;
+      switch (result_tracker->TrackEmbeddedRpc(*request_id, write_resp)) {
+        case rpc::ResultTracker::RpcState::NEW:
+          break;
+        case rpc::ResultTracker::RpcState::COMPLETED:
+          tracker->WriteCompleted();
+          continue;
+        case rpc::ResultTracker::RpcState::IN_PROGRESS:
+          s = Status::ServiceUnavailable("the write is already in progress");
+          break;
+        case rpc::ResultTracker::RpcState::STALE:
+          s = Status::Incomplete("the write's request id is stale");
+          break;
+      }
+      if (PREDICT_FALSE(!s.ok())) {
+        StatusToPB(s, write_resp->mutable_error()->mutable_status());
+        write_resp->mutable_error()->set_code(TabletServerErrorPB::UNKNOWN_ERROR);
+        tracker->WriteCompleted();
+        continue;
+      }
+    }
+
+    TabletServerErrorPB::Code error_code;
+    Status s = SubmitWrite(write, write_resp, request_id,
+                           gscoped_ptr<TransactionCompletionCallback>(
+                               new MultiTabletWriteCompletionCallback(tracker, result_tracker,
+                                                                      request_id, write_resp)),
+                           context->GetTimeReceived(),
+                           context->remote_user().username(),
+                           &error_code);
+    if (PREDICT_FALSE(!s.ok())) {
+      StatusToPB(s, write_resp->mutable_error()->mutable_status());
+      write_resp->mutable_error()->set_code(error_code);
+      RecordMultiTabletWriteResult(result_tracker.get(), request_id, write_resp);
+      tracker->WriteCompleted();
+    }
+  }
+  // Release the reference held for the submission loop itself.
+  tracker->WriteCompleted();
+}
+
+Status TabletServiceImpl::SubmitWrite(const WriteRequestPB* req,
+                                      WriteResponsePB* resp,
+                                      const rpc::RequestIdPB* request_id,
+                                      gscoped_ptr<TransactionCompletionCallback> callback,
+                                      const MonoTime& time_received,
+                                      const string& user,
+                                      TabletServerErrorPB::Code* error_code) {
+  scoped_refptr<TabletReplica> replica;
+  Status s = server_->tablet_manager()->GetTabletReplica(req->tablet_id(), &replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    return s;
+  }
+  tablet::TabletStatePB state = replica->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    return TabletNotRunningError(replica, state, error_code);
+  }
+
+  shared_ptr<Tablet> tablet;
+  RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
 
   uint64_t bytes = req->row_operations().rows().size() +
       req->row_operations().indirect_data().size();
   if (!tablet->ShouldThrottleAllow(bytes)) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::ServiceUnavailable("Rejecting Write request: throttled"),
-                         TabletServerErrorPB::THROTTLED,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Write request: throttled");
   }
 
   // Check for memory pressure; don't bother doing any additional work if we've
   // exceeded the limit.
   double capacity_pct;
-  if (process_memory::SoftLimitExceeded(&capacity_pct)) {
+  if (process_memory::SoftLimitExceeded(&capacity_pct) &&
+      !(FLAGS_memory_pressure_spare_small_tablets &&
+        process_memory::CurrentConsumption() <= process_memory::HardLimit() &&
+        TabletHoldsSmallShareOfMemory(*tablet))) {
     tablet->metrics()->leader_memory_pressure_rejections->Increment();
     string msg = StringPrintf("Soft memory limit exceeded (at %.2f%% of capacity)", capacity_pct);
     if (capacity_pct >= FLAGS_memory_limit_warn_threshold_percentage) {
@@ -869,53 +1397,51 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     } else {
       KLOG_EVERY_N_SECS(INFO, 1) << "Rejecting Write request: " << msg << THROTTLE_MSG;
     }
-    SetupErrorAndRespond(resp->mutable_error(), Status::ServiceUnavailable(msg),
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return Status::ServiceUnavailable(msg);
+  }
+
+  // Charge the write to its resource pool until it completes, unless the
+  // pool already uses too much of the write budget.
+  ResourcePools* pools = server_->resource_pools();
+  if (pools) {
+    ResourcePool* pool = pools->Resolve(replica->tablet_metadata()->table_name(), user);
+    if (!pools->AdmitWrite(pool, bytes)) {
+      *error_code = TabletServerErrorPB::THROTTLED;
+      return Status::ServiceUnavailable(Substitute(
+          "Rejecting Write request: resource pool $0 is using its share of the write budget",
+          pool->name));
+    }
+    callback.reset(new ResourcePoolWriteCompletionCallback(pools, pool, bytes,
+                                                           std::move(callback)));
   }
 
+  *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
   if (!server_->clock()->SupportsExternalConsistencyMode(req->external_consistency_mode())) {
-    Status s = Status::NotSupported("The configured clock does not support the"
+    return Status::NotSupported("The configured clock does not support the"
         " required consistency mode.");
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
   }
 
   unique_ptr<WriteTransactionState> tx_state(new WriteTransactionState(
       replica.get(),
       req,
-      context->AreResultsTracked() ? context->request_id() : nullptr,
+      request_id,
       resp));
 
   // If the client sent us a timestamp, decode it and update the clock so that all future
   // timestamps are greater than the passed timestamp.
   if (req->has_propagated_timestamp()) {
     Timestamp ts(req->propagated_timestamp());
-    s = server_->clock()->Update(ts);
-  }
-  if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    RETURN_NOT_OK(server_->clock()->Update(ts));
   }
 
-  tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
-      new RpcTransactionCompletionCallback<WriteResponsePB>(context,
-                                                            resp)));
-
-  // Submit the write. The RPC will be responded to asynchronously.
-  s = replica->SubmitWrite(std::move(tx_state));
+  tx_state->set_completion_callback(std::move(callback));
+  tx_state->mutable_metrics()->rpc_queue_duration_usec =
+      (MonoTime::Now() - time_received).ToMicroseconds();
 
-  // Check that we could submit the write
-  if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-  }
+  // Submit the write. The response is completed asynchronously by the
+  // completion callback.
+  return replica->SubmitWrite(std::move(tx_state));
 }
 
 ConsensusServiceImpl::ConsensusServiceImpl(ServerBase* server,
@@ -965,6 +1491,61 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   context->RespondSuccess();
 }
 
+void ConsensusServiceImpl::MultiUpdateConsensus(const MultiUpdateConsensusRequestPB* req,
+                                                MultiUpdateConsensusResponsePB* resp,
+                                                rpc::RpcContext* context) {
+  DVLOG(3) << "Received Multi Consensus Update RPC: " << SecureDebugString(*req);
+  const string& local_uuid = tablet_manager_->NodeInstance().permanent_uuid();
+  if (req->has_caller_uuid() && req->liveness_interval_ms() > 0) {
+    consensus::ServerLivenessTracker::GetInstance()->RecordContact(
+        local_uuid, req->caller_uuid(),
+        MonoDelta::FromMilliseconds(req->liveness_interval_ms()));
+  }
+  for (const ConsensusRequestPB& tablet_req : req->requests()) {
+    ConsensusResponsePB* tablet_resp = resp->add_responses();
+    // Unlike UpdateConsensus(), errors for one tablet go in its own response
+    // rather than failing the whole RPC.
+    auto set_error = [&](const Status& s, TabletServerErrorPB::Code code) {
+      tablet_resp->Clear();
+      StatusToPB(s, tablet_resp->mutable_error()->mutable_status());
+      tablet_resp->mutable_error()->set_code(code);
+    };
+
+    if (PREDICT_FALSE(tablet_req.dest_uuid() != local_uuid)) {
+      set_error(Status::InvalidArgument(Substitute(
+                    "MultiUpdateConsensus: Wrong destination UUID requested. "
+                    "Local UUID: $0. Requested UUID: $1", local_uuid, tablet_req.dest_uuid())),
+                TabletServerErrorPB::WRONG_SERVER_UUID);
+      continue;
+    }
+    scoped_refptr<TabletReplica> replica;
+    Status s = tablet_manager_->GetTabletReplica(tablet_req.tablet_id(), &replica);
+    if (PREDICT_FALSE(!s.ok())) {
+      set_error(s, TabletServerErrorPB::TABLET_NOT_FOUND);
+      continue;
+    }
+    tablet::TabletStatePB state = replica->state();
+    if (PREDICT_FALSE(state != tablet::RUNNING)) {
+      TabletServerErrorPB::Code error_code;
+      s = TabletNotRunningError(replica, state, &error_code);
+      set_error(s, error_code);
+      continue;
+    }
+    shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+    if (PREDICT_FALSE(!consensus)) {
+      set_error(Status::ServiceUnavailable("Raft Consensus unavailable",
+                                           "Tablet replica not initialized"),
+                TabletServerErrorPB::TABLET_NOT_RUNNING);
+      continue;
+    }
+    s = consensus->Update(&tablet_req, tablet_resp);
+    if (PREDICT_FALSE(!s.ok())) {
+      set_error(s, TabletServerErrorPB::UNKNOWN_ERROR);
+    }
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
                                                 VoteResponsePB* resp,
                                                 rpc::RpcContext* context) {
@@ -1301,19 +1882,232 @@ void TabletServiceImpl::ScannerKeepAlive(const ScannerKeepAliveRequestPB *req,
   context->RespondSuccess();
 }
 
+void TabletServiceImpl::MultiGet(const MultiGetRequestPB* req,
+                                 MultiGetResponsePB* resp,
+                                 rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::MultiGet",
+               "tablet_id", req->tablet_id());
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
+                                           context, &replica)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(replica, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  Schema projection;
+  s = ColumnPBsToSchema(req->projected_columns(), &projection);
+  if (PREDICT_TRUE(s.ok()) && projection.has_column_ids()) {
+    s = Status::InvalidArgument("User requests should not have Column IDs");
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::INVALID_SCHEMA, context);
+    return;
+  }
+
+  // Like a READ_LATEST scan, the lookups need the tablet to have a clean time.
+  s = tablet->mvcc_manager()->CheckIsSafeTimeInitialized();
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::TABLET_NOT_RUNNING, context);
+    return;
+  }
+
+  // The rows of all the keys are materialized at once, so the number of keys
+  // bounds the memory a request may take.
+  if (PREDICT_FALSE(req->encoded_keys_size() > FLAGS_tablet_multi_get_max_keys)) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::InvalidArgument(Substitute(
+                             "too many keys in MultiGet request: $0 (maximum $1)",
+                             req->encoded_keys_size(), FLAGS_tablet_multi_get_max_keys)),
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+
+  vector<Slice> keys;
+  keys.reserve(req->encoded_keys_size());
+  for (const string& key : req->encoded_keys()) {
+    keys.emplace_back(key);
+  }
+  Arena arena(32 * 1024);
+  RowBlock block(projection, keys.size(), &arena);
+  s = tablet->MultiGet(projection, tablet::MvccSnapshot(*tablet->mvcc_manager()), keys, &block);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  TRACE("Looked up $0 keys", keys.size());
+
+  unique_ptr<faststring> rows_data(new faststring());
+  unique_ptr<faststring> indirect_data(new faststring());
+  if (block.nrows() > 0) {
+    SerializeRowBlock(block, resp->mutable_data(), &projection,
+                      rows_data.get(), indirect_data.get());
+  }
+  const SelectionVector* sel = block.selection_vector();
+  for (int i = 0; i < sel->nrows(); i++) {
+    if (sel->IsRowSelected(i)) {
+      resp->add_key_indexes(i);
+    }
+  }
+
+  int rows_idx;
+  CHECK_OK(context->AddOutboundSidecar(
+      RpcSidecar::FromFaststring(std::move(rows_data)), &rows_idx));
+  resp->mutable_data()->set_rows_sidecar(rows_idx);
+  if (indirect_data->size() > 0) {
+    int indirect_idx;
+    CHECK_OK(context->AddOutboundSidecar(
+        RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
+    resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+  }
+  resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
+  context->RespondSuccess();
+}
+
 namespace {
 void SetResourceMetrics(ResourceMetricsPB* metrics, rpc::RpcContext* context) {
+  const TraceMetrics* trace_metrics = context->trace()->metrics();
   metrics->set_cfile_cache_miss_bytes(
-    context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
+    trace_metrics->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
   metrics->set_cfile_cache_hit_bytes(
-    context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+    trace_metrics->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+  metrics->set_io_nanos(trace_metrics->GetMetric(kScanIoNanosMetricName));
+  metrics->set_decompress_nanos(trace_metrics->GetMetric(kScanDecompressNanosMetricName));
+  metrics->set_decode_nanos(trace_metrics->GetMetric(kScanDecodeNanosMetricName));
+  metrics->set_delta_apply_nanos(trace_metrics->GetMetric(kScanDeltaApplyNanosMetricName));
+  metrics->set_predicate_eval_nanos(
+    trace_metrics->GetMetric(kScanPredicateEvalNanosMetricName));
+  metrics->set_serialize_nanos(trace_metrics->GetMetric(kScanSerializeNanosMetricName));
+  metrics->set_total_duration_nanos(
+    trace_metrics->GetMetric(kScanTotalDurationNanosMetricName));
+  metrics->set_cpu_user_nanos(trace_metrics->GetMetric(kScanCpuUserNanosMetricName));
+  metrics->set_cpu_system_nanos(trace_metrics->GetMetric(kScanCpuSystemNanosMetricName));
+  metrics->set_rows_scanned(trace_metrics->GetMetric(kScanRowsScannedMetricName));
+  metrics->set_rows_returned(trace_metrics->GetMetric(kScanRowsReturnedMetricName));
+  metrics->set_blocks_read(trace_metrics->GetMetric(kScanBlocksReadMetricName));
+  metrics->set_bytes_decompressed(trace_metrics->GetMetric(kScanBytesDecompressedMetricName));
+  metrics->set_delta_updates_applied(
+    trace_metrics->GetMetric(kScanDeltaUpdatesAppliedMetricName));
+  metrics->set_queue_nanos(trace_metrics->GetMetric(kScanQueueNanosMetricName));
+}
+
+void SetColumnStats(const vector<pair<string, IteratorStats>>& column_stats,
+                    ScanResponsePB* resp) {
+  for (const auto& name_and_stats : column_stats) {
+    const IteratorStats& stats = name_and_stats.second;
+    ColumnScanStatsPB* pb = resp->add_column_stats();
+    pb->set_column_name(name_and_stats.first);
+    pb->set_cells_read(stats.cells_read);
+    pb->set_bytes_read(stats.bytes_read);
+    pb->set_io_nanos(stats.io_nanos);
+    pb->set_decompress_nanos(stats.decompress_nanos);
+    pb->set_decode_nanos(stats.decode_nanos);
+    pb->set_delta_apply_nanos(stats.delta_apply_nanos);
+    pb->set_predicate_eval_nanos(stats.predicate_eval_nanos);
+  }
+}
+
+// Rewrites the stateless scan request 'req' into the ORDERED snapshot scan
+// request '*ordered_req', which resumes from the request's token, if any.
+Status RewriteStatelessScanRequest(const ScanRequestPB& req, ScanRequestPB* ordered_req) {
+  const NewScanRequestPB& scan_pb = req.new_scan_request();
+  if (scan_pb.has_limit() || scan_pb.aggregates_size() > 0 || scan_pb.has_top_n()) {
+    return Status::InvalidArgument(
+        "stateless scans may not have a limit, aggregates or top-N");
+  }
+  *ordered_req = req;
+  ordered_req->clear_call_seq_id();
+  NewScanRequestPB* ordered_pb = ordered_req->mutable_new_scan_request();
+  ordered_pb->set_read_mode(READ_AT_SNAPSHOT);
+  ordered_pb->set_order_mode(ORDERED);
+  if (scan_pb.has_resume_token()) {
+    ScanResumeTokenPB token;
+    if (!token.ParseFromString(scan_pb.resume_token()) || !token.has_snap_timestamp()) {
+      return Status::InvalidArgument("invalid resume token");
+    }
+    ordered_pb->set_snap_timestamp(token.snap_timestamp());
+    if (token.has_last_primary_key()) {
+      ordered_pb->set_last_primary_key(token.last_primary_key());
+    } else {
+      ordered_pb->clear_last_primary_key();
+    }
+  }
+  return Status::OK();
 }
 } // anonymous namespace
 
 void TabletServiceImpl::Scan(const ScanRequestPB* req,
                              ScanResponsePB* resp,
                              rpc::RpcContext* context) {
+  ScanScheduler* scheduler = server_->scan_scheduler();
+  if (!scheduler) {
+    DoScan(req, resp, context);
+    return;
+  }
+
+  // Hand the scan off to the scan threads, which take turns between the
+  // resource pools if there are any, or else between the tables being
+  // scanned.
+  scoped_refptr<TabletReplica> replica = ScanReplica(*req);
+  string group;
+  int weight = 1;
+  ResourcePool* pool = nullptr;
+  if (server_->resource_pools()) {
+    pool = server_->resource_pools()->Resolve(
+        replica ? replica->tablet_metadata()->table_name() : "",
+        context->remote_user().username());
+    group = pool->name;
+    weight = pool->weight;
+  } else if (replica) {
+    group = replica->tablet_metadata()->table_id();
+  }
+  const MonoTime submitted = MonoTime::Now();
+  Status s = scheduler->Submit(group, weight, [this, req, resp, context, pool, submitted](
+      const Status& s) {
+    if (PREDICT_FALSE(!s.ok())) {
+      context->RespondRpcFailure(rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY, s);
+      return;
+    }
+    if (pool && pool->scans_run) {
+      pool->scans_run->Increment();
+      pool->scan_queue_time->Increment((MonoTime::Now() - submitted).ToMicroseconds());
+    }
+    ADOPT_TRACE(context->trace());
+    DoScan(req, resp, context);
+  });
+  if (PREDICT_FALSE(!s.ok())) {
+    context->RespondRpcFailure(rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY, s);
+  }
+}
+
+scoped_refptr<TabletReplica> TabletServiceImpl::ScanReplica(const ScanRequestPB& req) {
+  scoped_refptr<TabletReplica> replica;
+  if (req.has_new_scan_request()) {
+    server_->tablet_manager()->LookupTablet(req.new_scan_request().tablet_id(), &replica);
+  } else if (req.has_scanner_id()) {
+    SharedScanner scanner;
+    if (server_->scanner_manager()->LookupScanner(req.scanner_id(), &scanner)) {
+      replica = scanner->tablet_replica();
+    }
+  }
+  return replica;
+}
+
+void TabletServiceImpl::DoScan(const ScanRequestPB* req,
+                               ScanResponsePB* resp,
+                               rpc::RpcContext* context) {
   TRACE_EVENT0("tserver", "TabletServiceImpl::Scan");
+  // The time since the call was received was spent queued for a service
+  // thread and, if the scan scheduler is enabled, for a turn of the scan
+  // threads.
+  TRACE_COUNTER_INCREMENT(kScanQueueNanosMetricName,
+                          (MonoTime::Now() - context->GetTimeReceived()).ToNanoseconds());
   // Validate the request: user must pass a new_scan_request or
   // a scanner ID, but not both.
   if (PREDICT_FALSE(req->has_scanner_id() &&
@@ -1323,11 +2117,8 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     return;
   }
 
-  size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
-  unique_ptr<faststring> rows_data(new faststring(batch_size_bytes * 11 / 10));
-  unique_ptr<faststring> indirect_data(new faststring(batch_size_bytes * 11 / 10));
   RowwiseRowBlockPB data;
-  ScanResultCopier collector(&data, rows_data.get(), indirect_data.get());
+  ScanResultCopier collector(&data, scan_buffer_pool_.get(), GetMaxBatchSizeBytesHint(req));
 
   bool has_more_results = false;
   TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
@@ -1338,9 +2129,23 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
                                              context, &replica)) {
       return;
     }
+    // A stateless scan is served as an ORDERED snapshot scan resuming from
+    // its token, by a scanner which doesn't outlive the request.
+    const ScanRequestPB* new_req = req;
+    ScanRequestPB stateless_req;
+    if (scan_pb.stateless()) {
+      Status s = RewriteStatelessScanRequest(*req, &stateless_req);
+      if (PREDICT_FALSE(!s.ok())) {
+        SetupErrorAndRespond(resp->mutable_error(), s,
+                             TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+        return;
+      }
+      new_req = &stateless_req;
+    }
+
     string scanner_id;
     Timestamp scan_timestamp;
-    Status s = HandleNewScanRequest(replica.get(), req, context,
+    Status s = HandleNewScanRequest(replica.get(), new_req, context,
                                     &collector, &scanner_id, &scan_timestamp, &has_more_results,
                                     &error_code);
     if (PREDICT_FALSE(!s.ok())) {
@@ -1349,7 +2154,19 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     }
 
     // Only set the scanner id if we have more results.
-    if (has_more_results) {
+    if (has_more_results && scan_pb.stateless()) {
+      server_->scanner_manager()->UnregisterScanner(scanner_id);
+      ScanResumeTokenPB token;
+      token.set_snap_timestamp(scan_timestamp.ToUint64());
+      const faststring& last = collector.last_primary_key();
+      if (last.length() > 0) {
+        token.set_last_primary_key(last.ToString());
+      } else if (new_req->new_scan_request().has_last_primary_key()) {
+        // No row was returned, so resume from where this request did.
+        token.set_last_primary_key(new_req->new_scan_request().last_primary_key());
+      }
+      resp->set_resume_token(token.SerializeAsString());
+    } else if (has_more_results) {
       resp->set_scanner_id(scanner_id);
     }
     if (scan_timestamp != Timestamp::kInvalidTimestamp) {
@@ -1367,21 +2184,31 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     return;
   }
   resp->set_has_more_results(has_more_results);
+  resp->set_max_batch_size_bytes(FLAGS_scanner_max_batch_size_bytes);
+  if (collector.aggregator()) {
+    collector.aggregator()->ToPB(resp->mutable_aggregate_results());
+  }
 
-  resp->mutable_data()->CopyFrom(data);
-
-  // Add sidecar data to context and record the returned indices.
-  int rows_idx;
-  CHECK_OK(context->AddOutboundSidecar(
-      RpcSidecar::FromFaststring((std::move(rows_data))), &rows_idx));
-  resp->mutable_data()->set_rows_sidecar(rows_idx);
+  if (collector.columnar()) {
+    AddColumnarSidecars(collector.columnar_batch(), resp->mutable_columnar_data(), context);
+  } else {
+    resp->mutable_data()->CopyFrom(data);
 
-  // Add indirect data as a sidecar, if applicable.
-  if (indirect_data->size() > 0) {
-    int indirect_idx;
+    // Add sidecar data to context and record the returned indices. The
+    // buffers go back to the pool once the response is sent.
+    int rows_idx;
     CHECK_OK(context->AddOutboundSidecar(
-        RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
-    resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+        scan_buffer_pool_->ToSidecar(collector.release_rows_data()), &rows_idx));
+    resp->mutable_data()->set_rows_sidecar(rows_idx);
+
+    // Add indirect data as a sidecar, if applicable.
+    unique_ptr<faststring> indirect_data = collector.release_indirect_data();
+    if (indirect_data->size() > 0) {
+      int indirect_idx;
+      CHECK_OK(context->AddOutboundSidecar(
+          scan_buffer_pool_->ToSidecar(std::move(indirect_data)), &indirect_idx));
+      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+    }
   }
 
   // Set the last row found by the collector.
@@ -1394,6 +2221,7 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   }
   resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
   SetResourceMetrics(resp->mutable_resource_metrics(), context);
+  SetColumnStats(collector.column_stats(), resp);
   context->RespondSuccess();
 }
 
@@ -1492,8 +2320,8 @@ void TabletServiceImpl::SplitKeyRange(const SplitKeyRangeRequestPB* req,
 
   vector<ColumnId> column_ids;
   for (const ColumnSchema& column : schema.columns()) {
-    int column_id = tablet_schema.find_column(column.name());
-    if (PREDICT_FALSE(column_id == Schema::kColumnNotFound)) {
+    int column_idx = tablet_schema.find_column(column.name());
+    if (PREDICT_FALSE(column_idx == Schema::kColumnNotFound)) {
       SetupErrorAndRespond(resp->mutable_error(),
                            Status::InvalidArgument(
                                "Invalid SplitKeyRange column name", column.name()),
@@ -1501,7 +2329,7 @@ void TabletServiceImpl::SplitKeyRange(const SplitKeyRangeRequestPB* req,
                            context);
       return;
     }
-    column_ids.emplace_back(column_id);
+    column_ids.emplace_back(tablet_schema.column_id(column_idx));
   }
 
   // Validate the target chunk size are valid
@@ -1594,6 +2422,15 @@ bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
   switch (feature) {
     case TabletServerFeatures::COLUMN_PREDICATES:
     case TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES:
+    case TabletServerFeatures::AGGREGATES:
+    case TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE:
+    case TabletServerFeatures::COLUMNAR_DICTIONARY_ENCODING_FEATURE:
+    case TabletServerFeatures::MULTI_TABLET_WRITE:
+    case TabletServerFeatures::SPLIT_BLOCK_BLOOM_FILTER_PREDICATES:
+    case TabletServerFeatures::LIKE_PREDICATES:
+    case TabletServerFeatures::TOP_N:
+    case TabletServerFeatures::DIFF_SCAN:
+    case TabletServerFeatures::MULTI_GET:
       return true;
     default:
       return false;
@@ -1792,6 +2629,54 @@ Status VerifyNotAncientHistory(Tablet* tablet, ReadMode read_mode, Timestamp tim
   }
   return Status::OK();
 }
+
+// Replaces the initialized iterator '*iter' of a scan at 'snap_timestamp'
+// with one reading from a shared scan registered under 'key' in 'manager',
+// joining one or starting one. 'components' are the tablet's components
+// from before '*iter' was created: as long as they're still current, '*iter'
+// reads them, as would a new iterator, and identical iterators yield the
+// same rows in the same order, which a scanner falling behind its shared
+// scan relies on to go on with an iterator of its own.
+void MaybeShareScan(ScannerManager* manager,
+                    const string& key,
+                    const scoped_refptr<tablet::TabletComponents>& components,
+                    const ScanSpec& spec,
+                    const Schema& projection,
+                    Timestamp snap_timestamp,
+                    OrderMode order,
+                    Tablet* tablet,
+                    gscoped_ptr<RowwiseIterator>* iter) {
+  scoped_refptr<tablet::TabletComponents> current;
+  tablet->GetComponents(&current);
+  if (current != components) {
+    return;
+  }
+  if (manager->JoinSharedScan(key, components, iter)) {
+    TRACE("Joined shared scan");
+    return;
+  }
+
+  tablet::RowIteratorOptions opts;
+  opts.projection = &projection;
+  opts.snap_to_include = tablet::MvccSnapshot(snap_timestamp);
+  opts.order = order;
+  gscoped_ptr<RowwiseIterator> fallback;
+  ScanSpec fallback_spec(spec);
+  Status s = tablet->NewRowIterator(std::move(opts), &fallback);
+  if (s.ok()) {
+    s = fallback->Init(&fallback_spec);
+  }
+  if (!s.ok()) {
+    VLOG(1) << "Not sharing scan: " << s.ToString();
+    return;
+  }
+  tablet->GetComponents(&current);
+  if (current != components) {
+    return;
+  }
+  manager->StartSharedScan(key, components, iter, std::move(fallback));
+  TRACE("Started shared scan");
+}
 } // anonymous namespace
 
 // Start a new scan.
@@ -1846,6 +2731,40 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     }
   }
 
+  // A diff scan reports the rows deleted in its window through an IS_DELETED
+  // virtual column, which is false for all the other rows.
+  bool has_is_deleted_col = false;
+  for (const ColumnSchema& col : projection.columns()) {
+    if (col.type_info()->type() == IS_DELETED) {
+      has_is_deleted_col = true;
+    }
+  }
+  if (scan_pb.has_snap_start_timestamp()) {
+    if (PREDICT_FALSE(scan_pb.read_mode() != READ_AT_SNAPSHOT)) {
+      *error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
+      return Status::InvalidArgument("Cannot do a diff scan that is not a snapshot read");
+    }
+    if (PREDICT_FALSE(scan_pb.has_top_n())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument("diff scans cannot be top-N scans");
+    }
+    if (has_is_deleted_col) {
+      static const bool kFalse = false;
+      vector<ColumnSchema> cols;
+      for (const ColumnSchema& col : projection.columns()) {
+        if (col.type_info()->type() == IS_DELETED) {
+          cols.emplace_back(col.name(), IS_DELETED, /*is_nullable=*/false, &kFalse);
+        } else {
+          cols.push_back(col);
+        }
+      }
+      CHECK_OK(projection.Reset(cols, projection.num_key_columns()));
+    }
+  } else if (PREDICT_FALSE(has_is_deleted_col)) {
+    *error_code = TabletServerErrorPB::INVALID_SCHEMA;
+    return Status::InvalidArgument("IS_DELETED virtual columns are only supported in diff scans");
+  }
+
   gscoped_ptr<ScanSpec> spec(new ScanSpec);
 
   // Missing columns will contain the columns that are not mentioned in the client
@@ -1858,6 +2777,42 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return s;
   }
 
+  // Aggregated columns are scanned even if they aren't projected.
+  s = ScanAggregator::AddAggregatedColumns(scan_pb.aggregates(), tablet_schema, projection,
+                                           &missing_cols);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return s;
+  }
+
+  // So is the column a top-N scan orders by. A top-N scan returns its rows
+  // only once it has scanned the whole tablet, so it can't stop at a limit
+  // or resume from a key.
+  if (scan_pb.has_top_n()) {
+    if (PREDICT_FALSE(scan_pb.has_limit() || scan_pb.aggregates_size() > 0 ||
+                      scan_pb.order_mode() == ORDERED)) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          "top-N scans cannot have a limit or aggregates, or be ORDERED");
+    }
+    s = ScanTopN::AddOrderedColumn(scan_pb.top_n(), tablet_schema, projection, &missing_cols);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
+  // A scan with equality predicates on all the primary key columns looks up
+  // a single row, whose encoded key is then the lower bound of the scan.
+  bool is_point_lookup = true;
+  for (int i = 0; i < tablet_schema.num_key_columns(); i++) {
+    const ColumnPredicate* pred = FindOrNull(spec->predicates(), tablet_schema.column(i).name());
+    if (!pred || pred->predicate_type() != PredicateType::Equality) {
+      is_point_lookup = false;
+      break;
+    }
+  }
+
   VLOG(3) << "Before optimizing scan spec: " << spec->ToString(tablet_schema);
   spec->OptimizeScan(tablet_schema, scanner->arena(), scanner->autorelease_pool(), true);
   VLOG(3) << "After optimizing scan spec: " << spec->ToString(tablet_schema);
@@ -1884,6 +2839,43 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   }
   projection = projection_builder.BuildWithoutIds();
 
+  if (PREDICT_FALSE((scan_pb.row_format_flags() & RowFormatFlags::COLUMNAR_LAYOUT) &&
+                    (scan_pb.row_format_flags() &
+                     RowFormatFlags::PAD_UNIX_TIME_MICROS_TO_16_BYTES))) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument(
+        "Cannot pad UNIXTIME_MICROS columns of scans in columnar layout");
+  }
+  if (PREDICT_FALSE((scan_pb.row_format_flags() &
+                     RowFormatFlags::COLUMNAR_DICTIONARY_ENCODING) &&
+                    !(scan_pb.row_format_flags() & RowFormatFlags::COLUMNAR_LAYOUT))) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument(
+        "Dictionary encoding is only supported for scans in columnar layout");
+  }
+
+  if (scan_pb.aggregates_size() > 0) {
+    vector<ScanAggregator::Aggregate> aggregates;
+    s = ScanAggregator::ResolveAggregates(scan_pb.aggregates(), projection, &aggregates);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+    scanner->set_aggregates(std::move(aggregates));
+  }
+
+  if (scan_pb.has_top_n()) {
+    const TopNPB& top_n = scan_pb.top_n();
+    const int col_idx = projection.find_column(top_n.column());
+    DCHECK_NE(Schema::kColumnNotFound, col_idx);
+    auto threshold = std::make_shared<TopNThreshold>(projection.column(col_idx),
+                                                     top_n.descending());
+    spec->set_top_n_threshold(threshold);
+    scanner->set_top_n(unique_ptr<ScanTopN>(
+        new ScanTopN(projection, col_idx, top_n.limit(), std::move(threshold))));
+  }
+  scanner->set_report_column_stats(scan_pb.report_column_stats());
+
   gscoped_ptr<RowwiseIterator> iter;
   // Preset the error code for when creating the iterator on the tablet fails
   TabletServerErrorPB::Code tmp_error_code = TabletServerErrorPB::MISMATCHED_SCHEMA;
@@ -1892,6 +2884,9 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   // tablet replica's shutdown is run concurrently with the code below.
   shared_ptr<Tablet> tablet;
   RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
+  if (is_point_lookup && spec->lower_bound_key()) {
+    tablet->RecordPointRead(spec->lower_bound_key()->encoded_key());
+  }
 
   // Ensure the tablet has a valid clean time.
   s = tablet->mvcc_manager()->CheckIsSafeTimeInitialized();
@@ -1903,39 +2898,76 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
     return s;
   }
-  {
-    TRACE("Creating iterator");
-    TRACE_EVENT0("tserver", "Create iterator");
 
-    switch (scan_pb.read_mode()) {
-      case UNKNOWN_READ_MODE: {
-        *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
-        s = Status::NotSupported("Unknown read mode.");
+  // Scans which only count all the rows at READ_LATEST, of tablets whose rows
+  // never expire, are answered without a server-side scanner, using the
+  // rowsets' metadata where possible.
+  if (FLAGS_scanner_count_rows_from_metadata &&
+      ScanAggregator::CountsRowsOnly(scanner->aggregates()) &&
+      scan_pb.read_mode() == READ_LATEST &&
+      spec->predicates().empty() &&
+      !spec->lower_bound_key() && !spec->exclusive_upper_bound_key() &&
+      !spec->has_limit() && !tablet->has_row_ttl()) {
+    TRACE("Counting rows from metadata");
+    uint64_t count;
+    RETURN_NOT_OK(tablet->CountLiveRows(&count));
+    result_collector->set_aggregates(scanner->aggregates());
+    result_collector->HandleRowCount(scanner.get(), count);
+    *has_more_results = false;
+    return Status::OK();
+  }
+
+  // Concurrent scans of the same tablet, rowsets, snapshot, projection and
+  // spec read from a single pass over the tablet. Only scans at a given
+  // snapshot are shared: a scan at READ_LATEST joining a pass would read its
+  // older snapshot. Scans with a limit are cheap enough not to bother, top-N
+  // and diff scans prune the rowsets they read by their own criteria, and
+  // expired rows are excluded as of the time each scan starts.
+  string shared_scan_key;
+  scoped_refptr<tablet::TabletComponents> shared_scan_components;
+  if (FLAGS_scanner_shared_scans && !spec->has_limit() && !scan_pb.has_top_n() &&
+      !scan_pb.has_snap_start_timestamp() && !tablet->has_row_ttl() &&
+      scan_pb.read_mode() == READ_AT_SNAPSHOT && scan_pb.has_snap_timestamp()) {
+    // The key must tell apart predicates which differ only in redacted values.
+    ScopedDisableRedaction no_redaction;
+    shared_scan_key = Substitute("$0 $1 $2 $3 $4 $5",
+                                 tablet->tablet_id(), scan_pb.snap_timestamp(),
+                                 scan_pb.order_mode(), spec->cache_blocks(),
+                                 projection.ToString(), spec->ToString(tablet_schema));
+    tablet->GetComponents(&shared_scan_components);
+  }
+
+  TRACE("Creating iterator");
+  TRACE_EVENT0("tserver", "Create iterator");
+
+  switch (scan_pb.read_mode()) {
+    case UNKNOWN_READ_MODE: {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      s = Status::NotSupported("Unknown read mode.");
+      return s;
+    }
+    case READ_LATEST: {
+      s = tablet->NewRowIterator(projection, &iter);
+      break;
+    }
+    case READ_YOUR_WRITES: // Fallthrough intended
+    case READ_AT_SNAPSHOT: {
+      scoped_refptr<consensus::TimeManager> time_manager = replica->time_manager();
+      s = HandleScanAtSnapshot(scan_pb, rpc_context, projection, tablet.get(),
+                               time_manager.get(), &iter, snap_timestamp);
+      // If we got a Status::ServiceUnavailable() from HandleScanAtSnapshot() it might
+      // mean we're just behind so let the client try again.
+      if (s.IsServiceUnavailable()) {
+        *error_code = TabletServerErrorPB::THROTTLED;
         return s;
       }
-      case READ_LATEST: {
-        s = tablet->NewRowIterator(projection, &iter);
-        break;
-      }
-      case READ_YOUR_WRITES: // Fallthrough intended
-      case READ_AT_SNAPSHOT: {
-        scoped_refptr<consensus::TimeManager> time_manager = replica->time_manager();
-        s = HandleScanAtSnapshot(scan_pb, rpc_context, projection, tablet.get(),
-                                 time_manager.get(), &iter, snap_timestamp);
-        // If we got a Status::ServiceUnavailable() from HandleScanAtSnapshot() it might
-        // mean we're just behind so let the client try again.
-        if (s.IsServiceUnavailable()) {
-          *error_code = TabletServerErrorPB::THROTTLED;
-          return s;
-        }
-        if (!s.ok()) {
-          tmp_error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
-        }
-        break;
+      if (!s.ok()) {
+        tmp_error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
       }
+      break;
     }
-    TRACE("Iterator created");
   }
+  TRACE("Iterator created");
 
   // Make a copy of the optimized spec before it's passed to the iterator.
   // This copy will be given to the Scanner so it can report its predicates to
@@ -1991,6 +3023,12 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   // We have to check after we open the iterator in order to avoid a TOCTOU
   // error.
   s = VerifyNotAncientHistory(tablet.get(), scan_pb.read_mode(), *snap_timestamp);
+  if (s.ok() && scan_pb.has_snap_start_timestamp()) {
+    // The UNDOs a diff scan reads its window from are only kept after the
+    // ancient history mark.
+    s = VerifyNotAncientHistory(tablet.get(), scan_pb.read_mode(),
+                                Timestamp(scan_pb.snap_start_timestamp()));
+  }
   if (!s.ok()) {
     *error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
     return s;
@@ -2004,6 +3042,12 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return Status::OK();
   }
 
+  if (!shared_scan_key.empty()) {
+    MaybeShareScan(server_->scanner_manager(), shared_scan_key, shared_scan_components,
+                   *orig_spec, projection, *snap_timestamp, scan_pb.order_mode(),
+                   tablet.get(), &iter);
+  }
+
   scanner->Init(std::move(iter), std::move(orig_spec));
   unreg_scanner.Cancel();
   *scanner_id = scanner->id();
@@ -2036,6 +3080,8 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   DCHECK(req->has_scanner_id());
   TRACE_EVENT1("tserver", "TabletServiceImpl::HandleContinueScanRequest",
                "scanner_id", req->scanner_id());
+  Stopwatch sw(Stopwatch::THIS_THREAD);
+  sw.start();
 
   size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
 
@@ -2064,6 +3110,7 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
 
   // Set the row format flags on the ScanResultCollector.
   result_collector->set_row_format_flags(scanner->row_format_flags());
+  result_collector->set_aggregates(scanner->aggregates());
 
   // If we early-exit out of this function, automatically unregister the scanner.
   ScopedUnregisterScanner unreg_scanner(server_->scanner_manager(), scanner->id());
@@ -2094,11 +3141,12 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
                  FLAGS_scanner_batch_size_rows, &arena);
 
   // TODO(todd): in the future, use the client timeout to set a budget. For now,
-  // just use a half second, which should be plenty to amortize call overhead.
-  int budget_ms = 500;
-  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
+  // use a fixed time slice, which should be plenty to amortize call overhead
+  // while letting the other scanners take their turns.
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_scanner_time_slice_ms);
 
   int64_t rows_scanned = 0;
+  int64_t serialize_nanos = 0;
   while (iter->HasNext() && !scanner->has_fulfilled_limit()) {
     if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
@@ -2122,7 +3170,17 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
         DCHECK_GT(rows_left, 0);  // Guaranteed by has_fulfilled_limit()
         block.selection_vector()->ClearToSelectAtMost(static_cast<size_t>(rows_left));
       }
-      result_collector->HandleRowBlock(scanner.get(), block);
+      if (scanner->top_n()) {
+        s = scanner->top_n()->Add(block);
+        if (PREDICT_FALSE(!s.ok())) {
+          *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+          return s;
+        }
+      } else {
+        const MonoTime serialize_start = MonoTime::Now();
+        result_collector->HandleRowBlock(scanner.get(), block);
+        serialize_nanos += (MonoTime::Now() - serialize_start).ToNanoseconds();
+      }
     }
 
     int64_t response_size = result_collector->ResponseSize();
@@ -2143,6 +3201,18 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     }
   }
 
+  // A top-N scan returns its rows once its iterator is exhausted.
+  ScanTopN* top_n = scanner->top_n();
+  if (top_n && !top_n->finished() && !iter->HasNext()) {
+    const RowBlock& top_rows = top_n->Finish();
+    TRACE("Top-N scan kept $0 rows", top_rows.nrows());
+    if (top_rows.nrows() > 0) {
+      const MonoTime serialize_start = MonoTime::Now();
+      result_collector->HandleRowBlock(scanner.get(), top_rows);
+      serialize_nanos += (MonoTime::Now() - serialize_start).ToNanoseconds();
+    }
+  }
+
   scoped_refptr<TabletReplica> replica = scanner->tablet_replica();
   shared_ptr<Tablet> tablet;
   TabletServerErrorPB::Code tablet_ref_error_code;
@@ -2179,6 +3249,31 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
 
   IteratorStats delta_stats = total_stats - scanner->already_reported_stats();
   scanner->set_already_reported_stats(total_stats);
+  TRACE_COUNTER_INCREMENT(kScanIoNanosMetricName, delta_stats.io_nanos);
+  TRACE_COUNTER_INCREMENT(kScanDecompressNanosMetricName, delta_stats.decompress_nanos);
+  TRACE_COUNTER_INCREMENT(kScanDecodeNanosMetricName, delta_stats.decode_nanos);
+  TRACE_COUNTER_INCREMENT(kScanDeltaApplyNanosMetricName, delta_stats.delta_apply_nanos);
+  TRACE_COUNTER_INCREMENT(kScanPredicateEvalNanosMetricName, delta_stats.predicate_eval_nanos);
+  TRACE_COUNTER_INCREMENT(kScanSerializeNanosMetricName, serialize_nanos);
+  TRACE_COUNTER_INCREMENT(kScanRowsScannedMetricName, rows_scanned);
+  TRACE_COUNTER_INCREMENT(kScanRowsReturnedMetricName, result_collector->NumRowsReturned());
+  TRACE_COUNTER_INCREMENT(kScanBlocksReadMetricName, delta_stats.blocks_read);
+  TRACE_COUNTER_INCREMENT(kScanBytesDecompressedMetricName, delta_stats.bytes_decompressed);
+  TRACE_COUNTER_INCREMENT(kScanDeltaUpdatesAppliedMetricName, delta_stats.delta_updates_applied);
+
+  // Report the share of each column in this request, if asked to.
+  if (scanner->report_column_stats()) {
+    const Schema& iter_schema = iter->schema();
+    vector<IteratorStats> reported_by_col = scanner->already_reported_column_stats();
+    reported_by_col.resize(stats_by_col.size());
+    auto* column_stats = result_collector->mutable_column_stats();
+    column_stats->clear();
+    for (int i = 0; i < stats_by_col.size(); i++) {
+      column_stats->emplace_back(iter_schema.column(i).name(),
+                                 stats_by_col[i] - reported_by_col[i]);
+    }
+    scanner->set_already_reported_column_stats(std::move(stats_by_col));
+  }
 
   if (tablet) {
     tablet->metrics()->scanner_rows_scanned->IncrementBy(rows_scanned);
@@ -2187,6 +3282,10 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   }
 
   scanner->UpdateAccessTime();
+  sw.stop();
+  TRACE_COUNTER_INCREMENT(kScanTotalDurationNanosMetricName, sw.elapsed().wall);
+  TRACE_COUNTER_INCREMENT(kScanCpuUserNanosMetricName, sw.elapsed().user);
+  TRACE_COUNTER_INCREMENT(kScanCpuSystemNanosMetricName, sw.elapsed().system);
   *has_more_results = !req->close_scanner() && iter->HasNext() &&
       !scanner->has_fulfilled_limit();
   if (*has_more_results) {
@@ -2273,7 +3372,26 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   if (scan_pb.order_mode() == UNKNOWN_ORDER_MODE) {
     return Status::InvalidArgument("Unknown order mode specified");
   }
-  RETURN_NOT_OK(tablet->NewRowIterator(projection, snap, scan_pb.order_mode(), iter));
+  tablet::RowIteratorOptions opts;
+  opts.projection = &projection;
+  opts.snap_to_include = snap;
+  opts.order = scan_pb.order_mode();
+  if (scan_pb.has_snap_start_timestamp()) {
+    if (Timestamp(scan_pb.snap_start_timestamp()) > tmp_snap_timestamp) {
+      return Status::InvalidArgument(Substitute(
+          "diff scan start timestamp $0 is later than its end timestamp $1",
+          scan_pb.snap_start_timestamp(), tmp_snap_timestamp.ToString()));
+    }
+    // The window holds the changes between what a snapshot scan at the start
+    // timestamp and one at the end timestamp would see.
+    opts.snap_to_exclude = tablet::MvccSnapshot(Timestamp(scan_pb.snap_start_timestamp()));
+    for (const ColumnSchema& col : projection.columns()) {
+      if (col.type_info()->type() == IS_DELETED) {
+        opts.include_deleted_rows = true;
+      }
+    }
+  }
+  RETURN_NOT_OK(tablet->NewRowIterator(std::move(opts), iter));
 
   // Return the picked snapshot timestamp for both READ_AT_SNAPSHOT
   // and READ_YOUR_WRITES mode.
@@ -18,14 +18,18 @@
 #define KUDU_TSERVER_TABLET_SERVICE_H
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
 #include "kudu/consensus/consensus.service.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.service.h"
 #include "kudu/tserver/tserver_service.service.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 
 namespace google {
 namespace protobuf {
@@ -58,6 +62,8 @@ class GetNodeInstanceRequestPB;
 class GetNodeInstanceResponsePB;
 class LeaderStepDownRequestPB;
 class LeaderStepDownResponsePB;
+class MultiUpdateConsensusRequestPB;
+class MultiUpdateConsensusResponsePB;
 class RunLeaderElectionRequestPB;
 class RunLeaderElectionResponsePB;
 class StartTabletCopyRequestPB;
@@ -70,12 +76,14 @@ class VoteResponsePB;
 } // namespace consensus
 
 namespace rpc {
+class RequestIdPB;
 class RpcContext;
 } // namespace rpc
 
 namespace tablet {
 class Tablet;
 class TabletReplica;
+class TransactionCompletionCallback;
 } // namespace tablet
 
 namespace tserver {
@@ -88,10 +96,21 @@ class CreateTabletRequestPB;
 class CreateTabletResponsePB;
 class DeleteTabletRequestPB;
 class DeleteTabletResponsePB;
+class IngestRowSetRequestPB;
+class IngestRowSetResponsePB;
+class ScanBufferPool;
 class ScanResultCollector;
+class StageRowSetForIngestRequestPB;
+class StageRowSetForIngestResponsePB;
 class TabletReplicaLookupIf;
 class TabletServer;
 
+// Returns whether a tablet holding 'tablet_bytes' of memory holds less than
+// half of the average memory of the 'num_tablets' tablets of its server, which
+// hold 'all_tablets_bytes' in total, i.e. whether writes to it can't be the
+// cause of the memory pressure.
+bool HoldsSmallShareOfMemory(int64_t tablet_bytes, int64_t all_tablets_bytes, int num_tablets);
+
 class TabletServiceImpl : public TabletServerServiceIf {
  public:
   explicit TabletServiceImpl(TabletServer* server);
@@ -111,10 +130,18 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Write(const WriteRequestPB* req, WriteResponsePB* resp,
                    rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiTabletWrite(const MultiTabletWriteRequestPB* req,
+                                MultiTabletWriteResponsePB* resp,
+                                rpc::RpcContext* context) OVERRIDE;
+
   virtual void Scan(const ScanRequestPB* req,
                     ScanResponsePB* resp,
                     rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiGet(const MultiGetRequestPB* req,
+                        MultiGetResponsePB* resp,
+                        rpc::RpcContext* context) OVERRIDE;
+
   virtual void ScannerKeepAlive(const ScannerKeepAliveRequestPB *req,
                                 ScannerKeepAliveResponsePB *resp,
                                 rpc::RpcContext *context) OVERRIDE;
@@ -136,6 +163,30 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Shutdown() OVERRIDE;
 
  private:
+  // Checks that 'req' can be applied to its tablet and submits it as a write
+  // transaction, which fills in 'resp' and runs 'callback' once it completes.
+  // 'request_id' is the id under which to track the write's result, if any,
+  // and 'time_received' the time the RPC carrying the write was received.
+  //
+  // Returns an error and sets 'error_code' if the write could not be
+  // submitted, in which case 'callback' is not run.
+  Status SubmitWrite(const WriteRequestPB* req,
+                     WriteResponsePB* resp,
+                     const rpc::RequestIdPB* request_id,
+                     gscoped_ptr<tablet::TransactionCompletionCallback> callback,
+                     const MonoTime& time_received,
+                     const std::string& user,
+                     TabletServerErrorPB::Code* error_code);
+
+  // Produces the scan batch for the request and responds to it. Runs on the
+  // scan threads, if enabled.
+  void DoScan(const ScanRequestPB* req,
+              ScanResponsePB* resp,
+              rpc::RpcContext* context);
+
+  // Returns the replica the scan request reads, or null if it's unknown.
+  scoped_refptr<tablet::TabletReplica> ScanReplica(const ScanRequestPB& req);
+
   Status HandleNewScanRequest(tablet::TabletReplica* tablet_replica,
                               const ScanRequestPB* req,
                               const rpc::RpcContext* rpc_context,
@@ -170,7 +221,21 @@ class TabletServiceImpl : public TabletServerServiceIf {
                                 tablet::Tablet* tablet,
                                 Timestamp* snap_timestamp);
 
+  // Returns whether 'tablet' holds a small share of the memory of the
+  // server's tablets (see HoldsSmallShareOfMemory()).
+  bool TabletHoldsSmallShareOfMemory(const tablet::Tablet& tablet);
+
   TabletServer* server_;
+
+  // The memory held by the tablets of the server, as of the time it was last
+  // summed up. Protected by 'tablets_memory_lock_'.
+  simple_spinlock tablets_memory_lock_;
+  MonoTime tablets_memory_refreshed_;
+  int64_t tablets_memory_bytes_ = 0;
+  int num_tablets_with_memory_ = 0;
+
+  // The buffers into which the batches of row-wise scans are serialized.
+  std::shared_ptr<ScanBufferPool> scan_buffer_pool_;
 };
 
 class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
@@ -193,6 +258,14 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                            AlterSchemaResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
 
+  virtual void StageRowSetForIngest(const StageRowSetForIngestRequestPB* req,
+                                    StageRowSetForIngestResponsePB* resp,
+                                    rpc::RpcContext* context) OVERRIDE;
+
+  virtual void IngestRowSet(const IngestRowSetRequestPB* req,
+                            IngestRowSetResponsePB* resp,
+                            rpc::RpcContext* context) OVERRIDE;
+
  private:
   TabletServer* server_;
 };
@@ -212,6 +285,10 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
                                consensus::ConsensusResponsePB* resp,
                                rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiUpdateConsensus(const consensus::MultiUpdateConsensusRequestPB* req,
+                                    consensus::MultiUpdateConsensusResponsePB* resp,
+                                    rpc::RpcContext* context) OVERRIDE;
+
   virtual void RequestConsensusVote(const consensus::VoteRequestPB* req,
                                     consensus::VoteResponsePB* resp,
                                     rpc::RpcContext* context) OVERRIDE;
@@ -23,6 +23,7 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -36,6 +37,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/master/master.pb.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet-harness.h"
 #include "kudu/tablet/tablet_replica.h"
@@ -58,6 +60,11 @@
 using std::string;
 using std::vector;
 
+DECLARE_int32(heartbeat_max_tablets_per_report);
+DECLARE_int32(num_tablets_to_open_simultaneously);
+DECLARE_int32(tablet_open_inject_latency_ms);
+DECLARE_string(tablet_open_priority_tables);
+
 namespace kudu {
 
 class FsManager;
@@ -168,6 +175,47 @@ TEST_F(TsTabletManagerTest, TestCreateTablet) {
   ASSERT_EQ(kTabletId, replica->tablet()->tablet_id());
 }
 
+// Test that the tablets of the tables listed in --tablet_open_priority_tables
+// are opened first on startup.
+TEST_F(TsTabletManagerTest, TestOpenPriorityTablets) {
+  // The tables are named after their tablets.
+  const vector<string> kTabletIds = {
+    string(32, 'a'), string(32, 'b'), string(32, 'c'), string(32, 'd')
+  };
+  const string& kPriorityTabletId = kTabletIds[2];
+  for (const string& tablet_id : kTabletIds) {
+    ASSERT_OK(CreateNewTablet(tablet_id, schema_, nullptr));
+  }
+  mini_server_->Shutdown();
+
+  // Open the tablets one at a time, slowly enough for the order to show.
+  FLAGS_num_tablets_to_open_simultaneously = 1;
+  FLAGS_tablet_open_inject_latency_ms = 1000;
+  FLAGS_tablet_open_priority_tables = kPriorityTabletId;
+  mini_server_.reset(new MiniTabletServer(GetTestPath("TsTabletManagerTest-fsroot"),
+                                          HostPort("127.0.0.1", 0)));
+  ASSERT_OK(mini_server_->Start());
+  tablet_manager_ = mini_server_->server()->tablet_manager();
+
+  // Once the priority tablet is running, none of the others is: the next one
+  // is still being opened.
+  scoped_refptr<TabletReplica> replica;
+  ASSERT_TRUE(tablet_manager_->LookupTablet(kPriorityTabletId, &replica));
+  ASSERT_OK(replica->WaitUntilConsensusRunning(MonoDelta::FromSeconds(30)));
+  for (const string& tablet_id : kTabletIds) {
+    if (tablet_id == kPriorityTabletId) continue;
+    ASSERT_TRUE(tablet_manager_->LookupTablet(tablet_id, &replica));
+    ASSERT_NE(tablet::RUNNING, replica->state()) << tablet_id;
+  }
+
+  // The rest are opened too.
+  ASSERT_OK(mini_server_->WaitStarted());
+  for (const string& tablet_id : kTabletIds) {
+    ASSERT_TRUE(tablet_manager_->LookupTablet(tablet_id, &replica));
+    ASSERT_OK(replica->WaitUntilConsensusRunning(MonoDelta::FromSeconds(30)));
+  }
+}
+
 static void AssertMonotonicReportSeqno(int64_t* report_seqno,
                                        const TabletReportPB &report) {
   ASSERT_LT(*report_seqno, report.sequence_number());
@@ -285,6 +333,24 @@ TEST_F(TsTabletManagerTest, TestTabletReports) {
   ASSERT_REPORT_HAS_UPDATED_TABLET(report, "tablet-1");
   ASSERT_REPORT_HAS_UPDATED_TABLET(report, "tablet-2");
   ASSERT_MONOTONIC_REPORT_SEQNO(&seqno, report);
+  MarkTabletReportAcknowledged(report);
+
+  // With a single tablet per report, the full report is spread over two
+  // reports.
+  FLAGS_heartbeat_max_tablets_per_report = 1;
+  GenerateFullTabletReport(&report);
+  ASSERT_FALSE(report.is_incremental());
+  ASSERT_EQ(1, report.updated_tablets().size());
+  ASSERT_MONOTONIC_REPORT_SEQNO(&seqno, report);
+  const string first_tablet_id = report.updated_tablets(0).tablet_id();
+  MarkTabletReportAcknowledged(report);
+
+  GenerateIncrementalTabletReport(&report);
+  ASSERT_TRUE(report.is_incremental());
+  ASSERT_EQ(1, report.updated_tablets().size());
+  ASSERT_REPORT_HAS_UPDATED_TABLET(
+      report, first_tablet_id == "tablet-1" ? "tablet-2" : "tablet-1");
+  ASSERT_MONOTONIC_REPORT_SEQNO(&seqno, report);
 }
 
 } // namespace tserver
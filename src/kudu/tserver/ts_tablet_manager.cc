@@ -23,6 +23,7 @@
 #include <ostream>
 #include <set>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -51,6 +52,7 @@
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/rpc/result_tracker.h"
@@ -58,13 +60,16 @@
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/heartbeater.h"
+#include "kudu/tserver/resource_pools.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
@@ -85,6 +90,11 @@ DEFINE_int32(num_tablets_to_open_simultaneously, 0,
              "may make sense to manually tune this.");
 TAG_FLAG(num_tablets_to_open_simultaneously, advanced);
 
+DEFINE_string(tablet_open_priority_tables, "",
+              "Comma-separated list of names of the tables whose tablets are opened "
+              "first during startup, e.g. the most latency-sensitive ones.");
+TAG_FLAG(tablet_open_priority_tables, advanced);
+
 DEFINE_int32(num_tablets_to_delete_simultaneously, 0,
              "Number of threads available to delete tablets. If this is set to 0 (the "
              "default), then the number of delete threads will be set based on the number "
@@ -131,6 +141,10 @@ DEFINE_int32(delete_tablet_inject_latency_ms, 0,
              "Amount of delay in milliseconds to inject into delete tablet operations.");
 TAG_FLAG(delete_tablet_inject_latency_ms, unsafe);
 
+DEFINE_int32(tablet_open_inject_latency_ms, 0,
+             "Amount of delay in milliseconds to inject before opening a tablet.");
+TAG_FLAG(tablet_open_inject_latency_ms, unsafe);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 
 METRIC_DEFINE_gauge_int32(server, tablets_num_not_initialized,
@@ -176,6 +190,7 @@ METRIC_DEFINE_gauge_int32(server, tablets_num_shutdown,
 using std::set;
 using std::shared_ptr;
 using std::string;
+using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
@@ -334,12 +349,32 @@ Status TSTabletManager::Init() {
 
   InitLocalRaftPeerPB();
 
+  // Registers the replica of 'meta' and submits the task opening it. The
+  // open pool runs the tasks in the order they're submitted.
+  auto open_tablet = [&](const scoped_refptr<TabletMetadata>& meta) -> Status {
+    scoped_refptr<TransitionInProgressDeleter> deleter;
+    {
+      std::lock_guard<RWMutex> lock(lock_);
+      CHECK_OK(StartTabletStateTransitionUnlocked(meta->tablet_id(), "opening tablet", &deleter));
+    }
+
+    scoped_refptr<TabletReplica> replica;
+    RETURN_NOT_OK(CreateAndRegisterTabletReplica(meta, NEW_REPLICA, &replica));
+    return open_tablet_pool_->SubmitFunc(boost::bind(&TSTabletManager::OpenTablet,
+                                                     this, replica, deleter));
+  };
+
+  const unordered_set<string> priority_tables = strings::Split(
+      FLAGS_tablet_open_priority_tables, ",", strings::SkipEmpty());
   vector<scoped_refptr<TabletMetadata> > metas;
 
   // First, load all of the tablet metadata. We do this before we start
   // submitting the actual OpenTablet() tasks so that we don't have to compete
   // for disk resources, etc, with bootstrap processes and running tablets.
+  // The tablets of the tables listed in --tablet_open_priority_tables are the
+  // exception: they're opened as soon as their metadata is loaded.
   int loaded_count = 0;
+  int num_opened = 0;
   for (const string& tablet_id : tablet_ids) {
     KLOG_EVERY_N_SECS(INFO, 1) << Substitute("Loading tablet metadata ($0/$1 complete)",
                                              loaded_count, tablet_ids.size());
@@ -351,22 +386,36 @@ Status TSTabletManager::Init() {
       RETURN_NOT_OK(HandleNonReadyTabletOnStartup(meta));
       continue;
     }
+    if (ContainsKey(priority_tables, meta->table_name())) {
+      RETURN_NOT_OK(open_tablet(meta));
+      num_opened++;
+      continue;
+    }
     metas.push_back(meta);
   }
-  LOG(INFO) << Substitute("Loaded tablet metadata ($0 live tablets)", metas.size());
+  LOG(INFO) << Substitute("Loaded tablet metadata ($0 live tablets)", metas.size() + num_opened);
 
-  // Now submit the "Open" task for each.
+  // Then open the tablets whose replica last voted for itself, i.e. was likely
+  // the leader before the restart, as soon as their consensus metadata is
+  // loaded: until they're open, their tablets may have no leader at all. The
+  // consensus metadata manager caches what it loads, so opening the tablets
+  // doesn't load it again.
+  vector<scoped_refptr<TabletMetadata>> deferred_metas;
   for (const scoped_refptr<TabletMetadata>& meta : metas) {
-    scoped_refptr<TransitionInProgressDeleter> deleter;
-    {
-      std::lock_guard<RWMutex> lock(lock_);
-      CHECK_OK(StartTabletStateTransitionUnlocked(meta->tablet_id(), "opening tablet", &deleter));
+    // Failing to load the consensus metadata here is reported when opening
+    // the tablet.
+    scoped_refptr<ConsensusMetadata> cmeta;
+    if (cmeta_manager_->Load(meta->tablet_id(), &cmeta).ok() &&
+        cmeta->has_voted_for() && cmeta->voted_for() == fs_manager_->uuid()) {
+      RETURN_NOT_OK(open_tablet(meta));
+    } else {
+      deferred_metas.push_back(meta);
     }
+  }
 
-    scoped_refptr<TabletReplica> replica;
-    RETURN_NOT_OK(CreateAndRegisterTabletReplica(meta, NEW_REPLICA, &replica));
-    RETURN_NOT_OK(open_tablet_pool_->SubmitFunc(boost::bind(&TSTabletManager::OpenTablet,
-                                                            this, replica, deleter)));
+  // Finally, open the rest.
+  for (const scoped_refptr<TabletMetadata>& meta : deferred_metas) {
+    RETURN_NOT_OK(open_tablet(meta));
   }
 
   {
@@ -703,7 +752,8 @@ void TSTabletManager::RunTabletCopy(
   //
   // TODO(aserbin): make this robust and more optimal than it is now.
   TabletCopyClient tc_client(tablet_id, fs_manager_, cmeta_manager_,
-                             server_->messenger(), &tablet_copy_metrics_);
+                             server_->messenger(), &tablet_copy_metrics_,
+                             server_->tablet_copy_throttler());
 
   // Download and persist the remote superblock in TABLET_DATA_COPYING state.
   if (replacing_tablet) {
@@ -1025,6 +1075,12 @@ void TSTabletManager::OpenTablet(const scoped_refptr<TabletReplica>& replica,
   shared_ptr<Tablet> tablet;
   scoped_refptr<Log> log;
 
+  if (PREDICT_FALSE(FLAGS_tablet_open_inject_latency_ms > 0)) {
+    LOG(WARNING) << LogPrefix(tablet_id) << "Injecting " << FLAGS_tablet_open_inject_latency_ms
+                 << "ms of latency into opening the tablet";
+    SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_open_inject_latency_ms));
+  }
+
   LOG(INFO) << LogPrefix(tablet_id) << "Bootstrapping tablet";
   TRACE("Bootstrapping tablet");
 
@@ -1085,7 +1141,10 @@ void TSTabletManager::OpenTablet(const scoped_refptr<TabletReplica>& replica,
       return;
     }
 
-    replica->RegisterMaintenanceOps(server_->maintenance_manager());
+    ResourcePools* pools = server_->resource_pools();
+    replica->RegisterMaintenanceOps(
+        server_->maintenance_manager(),
+        pools ? pools->MaintenancePerfWeight(replica->tablet_metadata()->table_name()) : 1.0);
   }
 
   // Now that the tablet has successfully opened, cancel the cleanup.
@@ -1228,6 +1287,34 @@ int TSTabletManager::GetNumLiveTablets() const {
   return count;
 }
 
+void TSTabletManager::GetLiveTabletsLoad(int64_t* on_disk_size,
+                                         int64_t* rows_written,
+                                         int64_t* rows_scanned) const {
+  *on_disk_size = 0;
+  *rows_written = 0;
+  *rows_scanned = 0;
+  shared_lock<RWMutex> l(lock_);
+  for (const auto& entry : tablet_map_) {
+    const scoped_refptr<TabletReplica>& replica = entry.second;
+    tablet::TabletStatePB state = replica->state();
+    if (state != tablet::BOOTSTRAPPING &&
+        state != tablet::RUNNING) {
+      continue;
+    }
+    *on_disk_size += replica->OnDiskSize();
+    shared_ptr<Tablet> tablet = replica->shared_tablet();
+    if (!tablet || !tablet->metrics()) {
+      continue;
+    }
+    const tablet::TabletMetrics* metrics = tablet->metrics();
+    *rows_written += metrics->rows_inserted->value() +
+                     metrics->rows_upserted->value() +
+                     metrics->rows_updated->value() +
+                     metrics->rows_deleted->value();
+    *rows_scanned += metrics->scanner_rows_scanned->value();
+  }
+}
+
 void TSTabletManager::InitLocalRaftPeerPB() {
   DCHECK_EQ(state(), MANAGER_INITIALIZING);
   local_peer_pb_.set_permanent_uuid(fs_manager_->uuid());
@@ -192,6 +192,12 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // Return the number of tablets in RUNNING or BOOTSTRAPPING state.
   int GetNumLiveTablets() const;
 
+  // Sum up the estimated on-disk size and the numbers of rows written and
+  // scanned since startup over the tablets in RUNNING or BOOTSTRAPPING state.
+  void GetLiveTabletsLoad(int64_t* on_disk_size,
+                          int64_t* rows_written,
+                          int64_t* rows_scanned) const;
+
   Status RunAllLogGC();
 
   // Delete the tablet using the specified delete_type as the final metadata
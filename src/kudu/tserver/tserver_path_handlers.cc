@@ -32,6 +32,7 @@
 #include <glog/logging.h>
 
 #include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator_stats.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/wire_protocol.pb.h"
@@ -41,6 +42,7 @@
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/consensus/raft_consensus.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
@@ -49,6 +51,7 @@
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/server/webui_util.h"
+#include "kudu/tablet/hot_key_tracker.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet.pb.h"
@@ -59,10 +62,13 @@
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/easy_json.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/maintenance_manager.pb.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/url-coding.h"
 #include "kudu/util/web_callback_registry.h"
 
@@ -73,6 +79,7 @@ using kudu::consensus::RaftPeerPB;
 using kudu::consensus::TransactionStatusPB;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
+using kudu::tablet::HotKeyTracker;
 using kudu::tablet::Tablet;
 using kudu::tablet::TabletReplica;
 using kudu::tablet::TabletStatePB;
@@ -187,6 +194,27 @@ bool LoadTablet(TabletServer* tserver,
       !TabletBootstrapping(*replica, *tablet_id, resp);
 }
 
+// Adds the keys of 'tracker' to 'json' as an array, the hottest first, with
+// the keys decoded according to 'schema'.
+void HotKeysToJson(const Schema& schema, const HotKeyTracker& tracker, EasyJson* json) {
+  static const int kMaxHotKeys = 10;
+  int64_t total = tracker.total_count();
+  for (const auto& hot_key : tracker.HottestKeys(kMaxHotKeys)) {
+    EasyJson key_json = json->PushBack(EasyJson::kObject);
+    Arena arena(256);
+    gscoped_ptr<EncodedKey> key;
+    if (EncodedKey::DecodeEncodedString(schema, &arena, hot_key.key, &key).ok()) {
+      key_json["key"] = key->Stringify(schema);
+    } else {
+      key_json["key"] = KUDU_REDACT(Slice(hot_key.key).ToDebugString());
+    }
+    key_json["count"] = hot_key.count;
+    key_json["max_error"] = hot_key.max_error;
+    key_json["share"] = total == 0 ? "0.00%" : StringPrintf(
+        "%.2f%%", 100.0 * (hot_key.count - hot_key.max_error) / total);
+  }
+}
+
 } // anonymous namespace
 
 TabletServerPathHandlers::~TabletServerPathHandlers() {
@@ -415,6 +443,15 @@ void TabletServerPathHandlers::HandleTabletPage(const Webserver::WebRequest& req
   output->Set("on_disk_size", HumanReadableNumBytes::ToString(replica->OnDiskSize()));
 
   SchemaToJson(schema, output);
+
+  shared_ptr<Tablet> tablet = replica->shared_tablet();
+  if (tablet && tablet->hot_write_keys()) {
+    EasyJson hot_keys = output->Set("hot_keys", EasyJson::kObject);
+    EasyJson writes = hot_keys.Set("writes", EasyJson::kArray);
+    HotKeysToJson(schema, *tablet->hot_write_keys(), &writes);
+    EasyJson point_reads = hot_keys.Set("point_reads", EasyJson::kArray);
+    HotKeysToJson(schema, *tablet->hot_point_read_keys(), &point_reads);
+  }
 }
 
 void TabletServerPathHandlers::HandleTabletSVGPage(const Webserver::WebRequest& req,
@@ -100,6 +100,17 @@ class BitReader {
   template<typename T>
   bool GetValue(int num_bits, T* v);
 
+  // Gets up to 'batch_size' values of 'num_bits' bits each from the buffer
+  // and stores them in 'v'. Returns the number of values read, which is less
+  // than 'batch_size' only if there are not enough bytes left. num_bits must
+  // be <= 64.
+  //
+  // Byte-aligned values are unpacked in groups of 32, 16 and 8 with loops that the
+  // compiler can unroll and vectorize, which is considerably faster than
+  // calling GetValue() repeatedly.
+  template<typename T>
+  int GetBatch(int num_bits, T* v, int batch_size);
+
   // Reads a 'num_bytes'-sized value from the buffer and stores it in 'v'. T needs to be a
   // little-endian native type and big enough to store 'num_bytes'. The value is assumed
   // to be byte-aligned so the stream will be advanced to the start of the next byte
@@ -134,6 +145,17 @@ class BitReader {
   // the next word into buffer_.
   void BufferValues();
 
+  // Used by GetBatch() to unpack as many groups of 'kGroupSize' values as
+  // possible starting at the current position, which must be byte-aligned.
+  // Returns the number of values unpacked.
+  template<typename T, int kNumBits, int kGroupSize>
+  int UnpackGroups(T* v, int batch_size);
+
+  // Dispatches UnpackGroups() on 'num_bits', returning 0 for bit widths that
+  // have no unrolled implementation.
+  template<typename T, int kGroupSize>
+  int UnpackGroupsWithWidth(int num_bits, T* v, int batch_size);
+
   const uint8_t* buffer_;
   int max_bytes_;
 
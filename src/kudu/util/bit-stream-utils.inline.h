@@ -131,6 +131,103 @@ inline bool BitReader::GetValue(int num_bits, T* v) {
   return true;
 }
 
+template<typename T, int kNumBits, int kGroupSize>
+inline int BitReader::UnpackGroups(T* v, int batch_size) {
+  static_assert(kNumBits <= 32 || kNumBits % 8 == 0,
+                "values must fit in a single 8-byte load");
+  DCHECK_EQ(bit_offset_ % 8, 0);
+
+  // A group of kGroupSize values always ends on a byte boundary.
+  constexpr int kGroupBytes = kNumBits * kGroupSize / 8;
+  static_assert(kNumBits * kGroupSize % 8 == 0, "groups must be byte-aligned");
+  // Values which are not a whole number of bytes are extracted with 8-byte
+  // loads, which may read past the end of the last group.
+  constexpr int kSlopBytes = kNumBits % 8 == 0 ? 0 : 8;
+  constexpr uint64_t kMask = ~0ULL >> (64 - kNumBits);
+
+  const int start_byte = byte_offset_ + bit_offset_ / 8;
+  const int num_groups = std::min(batch_size / kGroupSize,
+                                  (max_bytes_ - start_byte - kSlopBytes) / kGroupBytes);
+  if (num_groups <= 0) {
+    return 0;
+  }
+
+  const uint8_t* in = buffer_ + start_byte;
+  for (int g = 0; g < num_groups; g++) {
+    // The bounds and shifts are all compile-time constants, so this loop is
+    // fully unrolled.
+    for (int i = 0; i < kGroupSize; i++) {
+      const int bit = i * kNumBits;
+      uint64_t word = 0;
+      if (kNumBits % 8 == 0) {
+        memcpy(&word, in + bit / 8, kNumBits / 8);
+      } else {
+        memcpy(&word, in + bit / 8, 8);
+        word >>= bit % 8;
+      }
+      v[i] = static_cast<T>(word & kMask);
+    }
+    in += kGroupBytes;
+    v += kGroupSize;
+  }
+
+  const int num_values = num_groups * kGroupSize;
+  SeekToBit(position() + num_values * kNumBits);
+  return num_values;
+}
+
+template<typename T, int kGroupSize>
+inline int BitReader::UnpackGroupsWithWidth(int num_bits, T* v, int batch_size) {
+  switch (num_bits) {
+#define UNPACK_GROUPS_CASE(w) \
+    case w: return UnpackGroups<T, w, kGroupSize>(v, batch_size)
+    UNPACK_GROUPS_CASE(1);  UNPACK_GROUPS_CASE(2);  UNPACK_GROUPS_CASE(3);
+    UNPACK_GROUPS_CASE(4);  UNPACK_GROUPS_CASE(5);  UNPACK_GROUPS_CASE(6);
+    UNPACK_GROUPS_CASE(7);  UNPACK_GROUPS_CASE(8);  UNPACK_GROUPS_CASE(9);
+    UNPACK_GROUPS_CASE(10); UNPACK_GROUPS_CASE(11); UNPACK_GROUPS_CASE(12);
+    UNPACK_GROUPS_CASE(13); UNPACK_GROUPS_CASE(14); UNPACK_GROUPS_CASE(15);
+    UNPACK_GROUPS_CASE(16); UNPACK_GROUPS_CASE(17); UNPACK_GROUPS_CASE(18);
+    UNPACK_GROUPS_CASE(19); UNPACK_GROUPS_CASE(20); UNPACK_GROUPS_CASE(21);
+    UNPACK_GROUPS_CASE(22); UNPACK_GROUPS_CASE(23); UNPACK_GROUPS_CASE(24);
+    UNPACK_GROUPS_CASE(25); UNPACK_GROUPS_CASE(26); UNPACK_GROUPS_CASE(27);
+    UNPACK_GROUPS_CASE(28); UNPACK_GROUPS_CASE(29); UNPACK_GROUPS_CASE(30);
+    UNPACK_GROUPS_CASE(31); UNPACK_GROUPS_CASE(32); UNPACK_GROUPS_CASE(40);
+    UNPACK_GROUPS_CASE(48); UNPACK_GROUPS_CASE(56); UNPACK_GROUPS_CASE(64);
+#undef UNPACK_GROUPS_CASE
+    default:
+      return 0;
+  }
+}
+
+template<typename T>
+inline int BitReader::GetBatch(int num_bits, T* v, int batch_size) {
+  DCHECK_LE(num_bits, 64);
+  DCHECK_LE(num_bits, sizeof(T) * 8);
+
+  int i = 0;
+  // Read single values until the position is byte-aligned. Any 8 values end
+  // on a byte boundary, so this only fails if the batch started at a bit
+  // offset that can never become aligned for this bit width.
+  while (i < batch_size && i < 8 && bit_offset_ % 8 != 0) {
+    if (PREDICT_FALSE(!GetValue(num_bits, &v[i]))) {
+      return i;
+    }
+    i++;
+  }
+  if (bit_offset_ % 8 == 0) {
+    i += UnpackGroupsWithWidth<T, 32>(num_bits, v + i, batch_size - i);
+    i += UnpackGroupsWithWidth<T, 16>(num_bits, v + i, batch_size - i);
+    i += UnpackGroupsWithWidth<T, 8>(num_bits, v + i, batch_size - i);
+  }
+  // Read whatever is left over, e.g. values near the end of the buffer.
+  for (; i < batch_size; i++) {
+    if (PREDICT_FALSE(!GetValue(num_bits, &v[i]))) {
+      break;
+    }
+  }
+  return i;
+}
+
 inline void BitReader::Rewind(int num_bits) {
   bit_offset_ -= num_bits;
   if (bit_offset_ >= 0) {
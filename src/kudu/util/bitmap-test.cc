@@ -74,6 +74,66 @@ TEST(TestBitMap, TestIteration2) {
   ASSERT_EQ("1", JoinElements(read_back, ","));
 }
 
+TEST(TestBitMap, TestIterationPastByteBoundaries) {
+  // Long enough to need more than 256 bytes, with a length that isn't a
+  // multiple of a word.
+  const size_t kNumBits = 5000 + 13;
+  std::vector<uint8_t> bm(BitmapSize(kNumBits) + 8, 0xff);
+  BitmapChangeBits(bm.data(), 0, kNumBits, false);
+  std::vector<size_t> expected;
+  for (size_t i = 0; i < kNumBits; i += 7) {
+    BitmapSet(bm.data(), i);
+    expected.push_back(i);
+  }
+
+  std::vector<size_t> read_back;
+  ReadBackBitmap(bm.data(), kNumBits, &read_back);
+  ASSERT_EQ(expected, read_back);
+
+  // Bits past the end of the bitmap, which are set, must be ignored.
+  read_back.clear();
+  BitmapForEachSetBit(bm.data(), kNumBits, [&](size_t idx) {
+    read_back.push_back(idx);
+  });
+  ASSERT_EQ(expected, read_back);
+  ASSERT_EQ(expected.size(), BitmapCountSet(bm.data(), kNumBits));
+}
+
+TEST(TestBitMap, TestCountAndMerge) {
+  for (size_t num_bits : { 1, 7, 64, 100, 128, 129, 255, 1000 }) {
+    SCOPED_TRACE(num_bits);
+    std::vector<uint8_t> a(BitmapSize(num_bits), 0);
+    std::vector<uint8_t> b(BitmapSize(num_bits), 0);
+    size_t num_a = 0;
+    size_t num_b = 0;
+    size_t num_both = 0;
+    size_t num_either = 0;
+    for (size_t i = 0; i < num_bits; i++) {
+      bool in_a = i % 3 == 0;
+      bool in_b = i % 5 == 0;
+      BitmapChange(a.data(), i, in_a);
+      BitmapChange(b.data(), i, in_b);
+      num_a += in_a;
+      num_b += in_b;
+      num_both += in_a && in_b;
+      num_either += in_a || in_b;
+    }
+    ASSERT_EQ(num_a, BitmapCountSet(a.data(), num_bits));
+    ASSERT_EQ(num_b, BitmapCountSet(b.data(), num_bits));
+
+    std::vector<uint8_t> merged = a;
+    BitmapMergeAnd(merged.data(), b.data(), num_bits);
+    ASSERT_EQ(num_both, BitmapCountSet(merged.data(), num_bits));
+    for (size_t i = 0; i < num_bits; i++) {
+      ASSERT_EQ(i % 15 == 0, BitmapTest(merged.data(), i));
+    }
+
+    merged = a;
+    BitmapMergeOr(merged.data(), b.data(), num_bits);
+    ASSERT_EQ(num_either, BitmapCountSet(merged.data(), num_bits));
+  }
+}
+
 TEST(TestBitMap, TestSetAndTestBits) {
   uint8_t bm[1];
   memset(bm, 0, sizeof(bm));
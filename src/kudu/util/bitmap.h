@@ -21,6 +21,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <ostream>
 #include <string>
 
@@ -59,10 +60,44 @@ inline bool BitmapTest(const uint8_t *bitmap, size_t idx) {
 
 // Merge the two bitmaps using bitwise or. Both bitmaps should have at least
 // n_bits valid bits.
-inline void BitmapMergeOr(uint8_t *dst, const uint8_t *src, size_t n_bits) {
-  size_t n_bytes = BitmapSize(n_bits);
-  for (size_t i = 0; i < n_bytes; i++) {
-    *dst++ |= *src++;
+void BitmapMergeOr(uint8_t *dst, const uint8_t *src, size_t n_bits);
+
+// Merge the two bitmaps using bitwise and. Both bitmaps should have at least
+// n_bits valid bits.
+void BitmapMergeAnd(uint8_t *dst, const uint8_t *src, size_t n_bits);
+
+// Return the number of set bits among the first 'n_bits' bits of the bitmap.
+size_t BitmapCountSet(const uint8_t *bitmap, size_t n_bits);
+
+// Load the 'word_idx'th 64-bit word of a bitmap of 'n_bits' bits, with the bits
+// beyond 'n_bits' cleared. Bit i of the word is bit (word_idx * 64 + i) of the
+// bitmap, since bitmaps are stored little-endian.
+inline uint64_t BitmapLoadWord(const uint8_t *bitmap, size_t n_bits, size_t word_idx) {
+  const uint8_t* p = bitmap + word_idx * 8;
+  size_t remaining = n_bits - word_idx * 64;
+  if (PREDICT_TRUE(remaining >= 64)) {
+    return UNALIGNED_LOAD64(p);
+  }
+  uint64_t word = 0;
+  memcpy(&word, p, BitmapSize(remaining));
+  return word & ((1ULL << remaining) - 1);
+}
+
+// Call 'func(idx)' with the index of each set bit among the first 'n_bits'
+// bits of the bitmap, in increasing order. The bitmap is scanned a word at a
+// time, so the cost depends on the number of set bits rather than on the
+// number of bits.
+//
+// 'func' may clear the bit it's called with, or any earlier bit.
+template<class F>
+inline void BitmapForEachSetBit(const uint8_t *bitmap, size_t n_bits, const F& func) {
+  size_t n_words = (n_bits + 63) / 64;
+  for (size_t w = 0; w < n_words; w++) {
+    uint64_t word = BitmapLoadWord(bitmap, n_bits, w);
+    while (word != 0) {
+      func(w * 64 + Bits::FindLSBSetNonZero64(word));
+      word &= word - 1;
+    }
   }
 }
 
@@ -168,7 +203,8 @@ class BitmapIterator {
   const uint8_t *map_;
 };
 
-// Iterator which yields the set bits in a bitmap.
+// Iterator which yields the set bits in a bitmap, a word at a time.
+// Where a callback is convenient, BitmapForEachSetBit() is a little faster.
 // Example usage:
 //   for (TrueBitIterator iter(bitmap, n_bits);
 //        !iter.done();
@@ -179,29 +215,27 @@ class TrueBitIterator {
  public:
   TrueBitIterator(const uint8_t *bitmap, size_t n_bits)
     : bitmap_(bitmap),
-      cur_byte_(0),
-      cur_byte_idx_(0),
       n_bits_(n_bits),
-      n_bytes_(BitmapSize(n_bits_)),
+      n_words_((n_bits + 63) / 64),
+      cur_word_(0),
+      cur_word_idx_(0),
       bit_idx_(0) {
-    if (n_bits_ == 0) {
-      cur_byte_idx_ = 1; // sets done
-    } else {
-      cur_byte_ = bitmap[0];
+    if (n_words_ > 0) {
+      cur_word_ = BitmapLoadWord(bitmap_, n_bits_, 0);
       AdvanceToNextOneBit();
     }
   }
 
   TrueBitIterator &operator ++() {
     DCHECK(!done());
-    DCHECK(cur_byte_ & 1);
-    cur_byte_ &= (~1);
+    DCHECK_NE(cur_word_, 0);
+    cur_word_ &= cur_word_ - 1;
     AdvanceToNextOneBit();
     return *this;
   }
 
   bool done() const {
-    return cur_byte_idx_ >= n_bytes_;
+    return cur_word_idx_ >= n_words_;
   }
 
   size_t operator *() const {
@@ -211,27 +245,21 @@ class TrueBitIterator {
 
  private:
   void AdvanceToNextOneBit() {
-    while (cur_byte_ == 0) {
-      cur_byte_idx_++;
-      if (cur_byte_idx_ >= n_bytes_) return;
-      cur_byte_ = bitmap_[cur_byte_idx_];
-      bit_idx_ = cur_byte_idx_ * 8;
+    while (cur_word_ == 0) {
+      cur_word_idx_++;
+      if (cur_word_idx_ >= n_words_) return;
+      cur_word_ = BitmapLoadWord(bitmap_, n_bits_, cur_word_idx_);
     }
-    DVLOG(2) << "Found next nonzero byte at " << cur_byte_idx_
-             << " val=" << cur_byte_;
-
-    DCHECK_NE(cur_byte_, 0);
-    int set_bit = Bits::FindLSBSetNonZero(cur_byte_);
-    bit_idx_ += set_bit;
-    cur_byte_ >>= set_bit;
+    bit_idx_ = cur_word_idx_ * 64 + Bits::FindLSBSetNonZero64(cur_word_);
   }
 
   const uint8_t *bitmap_;
-  uint8_t cur_byte_;
-  uint8_t cur_byte_idx_;
-
   const size_t n_bits_;
-  const size_t n_bytes_;
+  const size_t n_words_;
+
+  // The not yet visited set bits of the current word.
+  uint64_t cur_word_;
+  size_t cur_word_idx_;
   size_t bit_idx_;
 };
 
@@ -17,7 +17,9 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <memory>
 #include <ostream>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
@@ -89,4 +91,78 @@ TEST(TestBloomFilter, TestInsertAndProbe) {
   ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
 }
 
+TEST(TestBloomFilter, TestSplitBlockInsertAndProbe) {
+  int n_keys = 2000;
+  BloomFilterBuilder bfb(
+    BloomFilterSizing::ByCountAndFPRate(n_keys, 0.01), BloomFilterLayout::kSplitBlock);
+  ASSERT_EQ(0, bfb.n_bytes() % 32);
+  ASSERT_EQ(8, bfb.n_hashes());
+
+  // The split-block layout trades a slightly higher false positive rate for
+  // probes which touch a single cache line.
+  double expected_fp_rate = bfb.false_positive_rate();
+  ASSERT_GT(expected_fp_rate, 0.01);
+  ASSERT_LT(expected_fp_rate, 0.02);
+
+  AddRandomKeys(kRandomSeed, n_keys, &bfb);
+  BloomFilter bf(bfb.slice(), bfb.n_hashes(), BloomFilterLayout::kSplitBlock);
+  CheckRandomKeys(kRandomSeed, n_keys, bf);
+
+  // Probe a bunch of other keys in one batch, and check that the results
+  // match the results of the single probes.
+  int num_queries = 100000;
+  std::vector<uint64_t> keys(num_queries);
+  for (int i = 0; i < num_queries; i++) {
+    keys[i] = random();
+  }
+  std::vector<BloomKeyProbe> probes;
+  std::vector<const BloomKeyProbe*> probe_ptrs;
+  probes.reserve(num_queries);
+  for (int i = 0; i < num_queries; i++) {
+    probes.emplace_back(Slice(reinterpret_cast<const uint8_t *>(&keys[i]), sizeof(keys[i])));
+    probe_ptrs.push_back(&probes.back());
+  }
+  std::unique_ptr<bool[]> results(new bool[num_queries]);
+  bf.MayContainKeys(probe_ptrs.data(), num_queries, results.get());
+
+  uint32_t num_positives = 0;
+  for (int i = 0; i < num_queries; i++) {
+    ASSERT_EQ(bf.MayContainKey(probes[i]), results[i]) << "probe " << i;
+    if (results[i]) {
+      num_positives++;
+    }
+  }
+
+  double fp_rate = static_cast<double>(num_positives) / static_cast<double>(num_queries);
+  LOG(INFO) << "FP rate: " << fp_rate << " (" << num_positives << "/" << num_queries << ")";
+  LOG(INFO) << "Expected FP rate: " << expected_fp_rate;
+  ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
+}
+
+TEST(TestBloomFilter, TestBatchProbeClassic) {
+  int n_keys = 500;
+  BloomFilterBuilder bfb(BloomFilterSizing::ByCountAndFPRate(n_keys, 0.01));
+  AddRandomKeys(kRandomSeed, n_keys, &bfb);
+  BloomFilter bf(bfb.slice(), bfb.n_hashes());
+
+  // The batch API also works with the classic layout.
+  srandom(kRandomSeed);
+  std::vector<uint64_t> keys(n_keys);
+  for (int i = 0; i < n_keys; i++) {
+    keys[i] = random();
+  }
+  std::vector<BloomKeyProbe> probes;
+  std::vector<const BloomKeyProbe*> probe_ptrs;
+  probes.reserve(n_keys);
+  for (int i = 0; i < n_keys; i++) {
+    probes.emplace_back(Slice(reinterpret_cast<const uint8_t *>(&keys[i]), sizeof(keys[i])));
+    probe_ptrs.push_back(&probes.back());
+  }
+  std::unique_ptr<bool[]> results(new bool[n_keys]);
+  bf.MayContainKeys(probe_ptrs.data(), n_keys, results.get());
+  for (int i = 0; i < n_keys; i++) {
+    ASSERT_TRUE(results[i]) << "key " << i;
+  }
+}
+
 } // namespace kudu
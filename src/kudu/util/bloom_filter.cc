@@ -17,14 +17,78 @@
 
 #include "kudu/util/bloom_filter.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <ostream>
 
 #include <glog/logging.h>
 
+#include "kudu/gutil/cpu.h"
+#include "kudu/gutil/port.h"
+
+using base::CPU;
+
 namespace kudu {
 
+using bloom_internal::kSplitBlockBucketBytes;
+using bloom_internal::SplitBlockBucketContains;
+using bloom_internal::SplitBlockBucketIndex;
+
+namespace {
+
+// Whether the AVX2 version of the batched split-block probe may be used.
+// As for the predicate evaluation kernels in cfile/bshuf_block.cc, this is
+// determined once when the translation unit is initialized.
+bool g_bloom_use_avx2 = false;
+
+__attribute__((constructor))
+void SelectBloomProbeKernel() {
+#if defined(__x86_64__) && !defined(__APPLE__)
+  g_bloom_use_avx2 = CPU().has_avx2();
+#endif
+}
+
+// How many probes ahead the buckets are prefetched. Each probe touches a
+// single cache line, so this keeps a few memory loads in flight.
+constexpr size_t kPrefetchDistance = 8;
+
+// The number of buckets of a split-block filter of 'n_bits' bits.
+size_t NumSplitBlockBuckets(size_t n_bits) {
+  return n_bits / 8 / kSplitBlockBucketBytes;
+}
+
+inline void ProbeSplitBlock(const uint8_t* bitmap, size_t n_buckets,
+                            const BloomKeyProbe* const* probes, size_t n, bool* results) {
+  auto bucket = [&](size_t i) {
+    return bitmap + SplitBlockBucketIndex(*probes[i], n_buckets) * kSplitBlockBucketBytes;
+  };
+  for (size_t i = 0; i < std::min(n, kPrefetchDistance); i++) {
+    prefetch(reinterpret_cast<const char*>(bucket(i)), PREFETCH_HINT_T0);
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (i + kPrefetchDistance < n) {
+      prefetch(reinterpret_cast<const char*>(bucket(i + kPrefetchDistance)), PREFETCH_HINT_T0);
+    }
+    results[i] = SplitBlockBucketContains(bucket(i), *probes[i]);
+  }
+}
+
+void ProbeSplitBlockDefault(const uint8_t* bitmap, size_t n_buckets,
+                            const BloomKeyProbe* const* probes, size_t n, bool* results) {
+  ProbeSplitBlock(bitmap, n_buckets, probes, n, results);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+void ProbeSplitBlockAvx2(const uint8_t* bitmap, size_t n_buckets,
+                         const BloomKeyProbe* const* probes, size_t n, bool* results) {
+  ProbeSplitBlock(bitmap, n_buckets, probes, n, results);
+}
+#endif
+
+} // anonymous namespace
+
 static double kNaturalLog2 = 0.69314;
 
 static int ComputeOptimalHashCount(size_t n_bits, size_t elems) {
@@ -56,10 +120,22 @@ BloomFilterSizing BloomFilterSizing::BySizeAndFPRate(size_t n_bytes, double fp_r
 }
 
 
-BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing)
-  : n_bits_(sizing.n_bytes() * 8),
-    bitmap_(new uint8_t[sizing.n_bytes()]),
-    n_hashes_(ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
+static size_t BloomFilterBytes(const BloomFilterSizing& sizing, BloomFilterLayout layout) {
+  if (layout == BloomFilterLayout::kSplitBlock) {
+    return (sizing.n_bytes() + kSplitBlockBucketBytes - 1) /
+        kSplitBlockBucketBytes * kSplitBlockBucketBytes;
+  }
+  return sizing.n_bytes();
+}
+
+BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing,
+                                       BloomFilterLayout layout)
+  : n_bits_(BloomFilterBytes(sizing, layout) * 8),
+    bitmap_(new uint8_t[n_bits_ / 8]),
+    layout_(layout),
+    n_hashes_(layout == BloomFilterLayout::kSplitBlock ?
+              bloom_internal::kSplitBlockWordsPerBucket :
+              ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
     expected_count_(sizing.expected_count()),
     n_inserted_(0) {
   Clear();
@@ -75,14 +151,57 @@ double BloomFilterBuilder::false_positive_rate() const {
     << "expected_count_ not initialized: can't call this function on "
     << "a BloomFilter initialized from external data";
 
+  if (layout_ == BloomFilterLayout::kSplitBlock) {
+    // The number of keys in a bucket follows a Poisson distribution. A bucket
+    // with 'k' keys behaves like a classic filter of 256 bits with 'k' keys
+    // and one bit per word, so weigh the false positive rate of each load by
+    // its probability.
+    const double bucket_bits = kSplitBlockBucketBytes * 8;
+    const double word_bits = bucket_bits / n_hashes_;
+    const double lambda = static_cast<double>(expected_count_) /
+        NumSplitBlockBuckets(n_bits_);
+    double p_load = exp(-lambda);
+    double rate = 0;
+    for (int k = 0; k < 10 * (lambda + 1); k++) {
+      rate += p_load * pow(1 - pow(1 - 1 / word_bits, k), n_hashes_);
+      p_load *= lambda / (k + 1);
+    }
+    return rate;
+  }
+
   return pow(1 - exp(-static_cast<double>(n_hashes_) * expected_count_ / n_bits_), n_hashes_);
 }
 
-BloomFilter::BloomFilter(const Slice &data, size_t n_hashes)
+BloomFilter::BloomFilter(const Slice &data, size_t n_hashes, BloomFilterLayout layout)
   : n_bits_(data.size() * 8),
     bitmap_(reinterpret_cast<const uint8_t *>(data.data())),
-    n_hashes_(n_hashes)
-{}
+    n_hashes_(n_hashes),
+    layout_(layout) {
+  DCHECK(layout_ != BloomFilterLayout::kSplitBlock ||
+         data.size() % kSplitBlockBucketBytes == 0)
+      << "split-block filter of " << data.size() << " bytes";
+}
+
+void BloomFilter::MayContainKeys(const BloomKeyProbe* const* probes, size_t n,
+                                 bool* results) const {
+  if (layout_ != BloomFilterLayout::kSplitBlock) {
+    for (size_t i = 0; i < n; i++) {
+      results[i] = MayContainKey(*probes[i]);
+    }
+    return;
+  }
+
+  const size_t n_buckets = NumSplitBlockBuckets(n_bits_);
+#if defined(__x86_64__)
+  if (g_bloom_use_avx2) {
+    ProbeSplitBlockAvx2(bitmap_, n_buckets, probes, n, results);
+  } else {
+    ProbeSplitBlockDefault(bitmap_, n_buckets, probes, n, results);
+  }
+#else
+  ProbeSplitBlockDefault(bitmap_, n_buckets, probes, n, results);
+#endif
+}
 
 
 
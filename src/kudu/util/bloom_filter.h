@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -83,6 +84,11 @@ class BloomKeyProbe {
     return h_1_;
   }
 
+  // The second hash value, which MixHash() adds to its argument.
+  uint32_t second_hash() const {
+    return h_2_;
+  }
+
   // Mix the given hash function with the second calculated hash
   // value. A sequence of independent hashes can be calculated
   // by repeatedly calling MixHash() on its previous result.
@@ -99,6 +105,22 @@ class BloomKeyProbe {
   uint32_t h_2_;
 };
 
+// The layout of the bits of a bloom filter.
+enum class BloomFilterLayout {
+  // Each of the filter's hash functions picks a bit anywhere in the filter,
+  // so a probe touches as many random cache lines as there are hashes.
+  kClassic,
+
+  // The split-block layout, described in "Cache-, Hash- and Space-Efficient
+  // Bloom Filters" (Putze et al.) and also used by Impala and Parquet. The
+  // filter is an array of 32-byte buckets, each made of eight 32-bit words.
+  // A key picks one bucket, and sets one bit in each of its words. A probe
+  // only reads a single bucket, and its eight bit tests can be done at once
+  // with SIMD instructions. For the same size, the false positive rate is a
+  // little higher than with the classic layout.
+  kSplitBlock
+};
+
 // Sizing parameters for the constructor to BloomFilterBuilder.
 // This is simply to provide a nicer API than a bunch of overloaded
 // constructors.
@@ -133,7 +155,11 @@ class BloomFilterBuilder {
  public:
   // Create a bloom filter.
   // See BloomFilterSizing static methods to specify this argument.
-  explicit BloomFilterBuilder(const BloomFilterSizing &sizing);
+  //
+  // With the split-block layout, the size of the filter is rounded up to a
+  // whole number of buckets.
+  explicit BloomFilterBuilder(const BloomFilterSizing &sizing,
+                              BloomFilterLayout layout = BloomFilterLayout::kClassic);
 
   // Clear all entries, reset insertion count.
   void Clear();
@@ -162,6 +188,8 @@ class BloomFilterBuilder {
   // in the bloom filter.
   size_t n_hashes() const { return n_hashes_; }
 
+  BloomFilterLayout layout() const { return layout_; }
+
   size_t expected_count() const { return expected_count_; }
 
   // Return the number of keys inserted.
@@ -173,6 +201,8 @@ class BloomFilterBuilder {
   size_t n_bits_;
   gscoped_array<uint8_t> bitmap_;
 
+  const BloomFilterLayout layout_;
+
   // The number of hash functions to compute.
   size_t n_hashes_;
 
@@ -188,11 +218,20 @@ class BloomFilterBuilder {
 class BloomFilter {
  public:
   BloomFilter() : bitmap_(nullptr) {}
-  BloomFilter(const Slice &data, size_t n_hashes);
+  BloomFilter(const Slice &data, size_t n_hashes,
+              BloomFilterLayout layout = BloomFilterLayout::kClassic);
 
   // Return true if the filter may contain the given key.
   bool MayContainKey(const BloomKeyProbe &probe) const;
 
+  // Set 'results[i]' to whether the filter may contain the key of
+  // 'probes[i]', for each of the 'n' probes.
+  //
+  // With the split-block layout, the buckets of the following probes are
+  // prefetched while a probe is checked, and the bit tests are vectorized
+  // with AVX2 when the CPU supports it.
+  void MayContainKeys(const BloomKeyProbe* const* probes, size_t n, bool* results) const;
+
  private:
   friend class BloomFilterBuilder;
   static uint32_t PickBit(uint32_t hash, size_t n_bits);
@@ -201,8 +240,47 @@ class BloomFilter {
   const uint8_t *bitmap_;
 
   size_t n_hashes_;
+
+  BloomFilterLayout layout_;
 };
 
+namespace bloom_internal {
+
+// Constants and helpers for the split-block layout.
+//
+// The words of the bucket picked by a key are tested against the bits
+// picked by multiplying the key's second hash by a different odd constant
+// for each word, and keeping the top five bits of the products.
+constexpr size_t kSplitBlockBucketBytes = 32;
+constexpr size_t kSplitBlockWordsPerBucket = 8;
+constexpr uint32_t kSplitBlockSalts[kSplitBlockWordsPerBucket] = {
+  0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+// Return the index of the bucket picked by 'probe' in a filter of
+// 'n_buckets' buckets. This maps the hash to the range of buckets with a
+// multiplication rather than a division.
+inline size_t SplitBlockBucketIndex(const BloomKeyProbe& probe, size_t n_buckets) {
+  return (static_cast<uint64_t>(probe.initial_hash()) * n_buckets) >> 32;
+}
+
+// Return true if all the bits picked by 'probe' are set in 'bucket'. The
+// loop is written so that the compiler can turn it into a few vector
+// instructions.
+inline bool SplitBlockBucketContains(const uint8_t* bucket, const BloomKeyProbe& probe) {
+  uint32_t words[kSplitBlockWordsPerBucket];
+  memcpy(words, bucket, sizeof(words));
+  const uint32_t h = probe.second_hash();
+  uint32_t missing = 0;
+  for (size_t i = 0; i < kSplitBlockWordsPerBucket; i++) {
+    missing |= ~words[i] & (1U << ((h * kSplitBlockSalts[i]) >> 27));
+  }
+  return missing == 0;
+}
+
+} // namespace bloom_internal
+
 
 ////////////////////////////////////////////////////////////
 // Inline implementations
@@ -221,6 +299,21 @@ inline uint32_t BloomFilter::PickBit(uint32_t hash, size_t n_bits) {
 }
 
 inline void BloomFilterBuilder::AddKey(const BloomKeyProbe &probe) {
+  if (layout_ == BloomFilterLayout::kSplitBlock) {
+    using namespace bloom_internal;
+    const size_t n_buckets = n_bits_ / 8 / kSplitBlockBucketBytes;
+    uint8_t* bucket = &bitmap_[SplitBlockBucketIndex(probe, n_buckets) * kSplitBlockBucketBytes];
+    const uint32_t h = probe.second_hash();
+    for (size_t i = 0; i < kSplitBlockWordsPerBucket; i++) {
+      uint32_t word;
+      memcpy(&word, bucket + i * sizeof(word), sizeof(word));
+      word |= 1U << ((h * kSplitBlockSalts[i]) >> 27);
+      memcpy(bucket + i * sizeof(word), &word, sizeof(word));
+    }
+    n_inserted_++;
+    return;
+  }
+
   uint32_t h = probe.initial_hash();
   for (size_t i = 0; i < n_hashes_; i++) {
     uint32_t bitpos = BloomFilter::PickBit(h, n_bits_);
@@ -231,6 +324,13 @@ inline void BloomFilterBuilder::AddKey(const BloomKeyProbe &probe) {
 }
 
 inline bool BloomFilter::MayContainKey(const BloomKeyProbe &probe) const {
+  if (layout_ == BloomFilterLayout::kSplitBlock) {
+    using namespace bloom_internal;
+    const size_t n_buckets = n_bits_ / 8 / kSplitBlockBucketBytes;
+    return SplitBlockBucketContains(
+        bitmap_ + SplitBlockBucketIndex(probe, n_buckets) * kSplitBlockBucketBytes, probe);
+  }
+
   uint32_t h = probe.initial_hash();
 
   // Basic unrolling by 2s gives a small benefit here since the two bit positions
@@ -75,16 +75,36 @@ struct BenchSetup {
   // in the cache.
   double dataset_cache_ratio;
 
+  enum class Eviction {
+    LRU,
+    SLRU,
+    CLOCK
+  };
+  Eviction eviction;
+
+  // The number of threads looking up the cache, or 0 to use --num_threads.
+  int num_threads;
+
   string ToString() const {
     string ret;
     switch (pattern) {
       case Pattern::ZIPFIAN: ret += "ZIPFIAN"; break;
       case Pattern::UNIFORM: ret += "UNIFORM"; break;
     }
-    ret += StringPrintf(" ratio=%.2fx n_unique=%d", dataset_cache_ratio, max_key());
+    switch (eviction) {
+      case Eviction::LRU: ret += " LRU"; break;
+      case Eviction::SLRU: ret += " SLRU"; break;
+      case Eviction::CLOCK: ret += " CLOCK"; break;
+    }
+    ret += StringPrintf(" ratio=%.2fx n_unique=%d threads=%d",
+                        dataset_cache_ratio, max_key(), threads());
     return ret;
   }
 
+  int threads() const {
+    return num_threads > 0 ? num_threads : FLAGS_num_threads;
+  }
+
   // Return the maximum cache key to be generated for a lookup.
   uint32_t max_key() const {
     return static_cast<int64_t>(kCacheCapacity * dataset_cache_ratio) / kEntrySize;
@@ -97,7 +117,17 @@ class CacheBench : public KuduTest,
   void SetUp() override {
     KuduTest::SetUp();
 
-    cache_.reset(NewLRUCache(DRAM_CACHE, kCacheCapacity, "test-cache"));
+    switch (GetParam().eviction) {
+      case BenchSetup::Eviction::LRU:
+        cache_.reset(NewLRUCache(DRAM_CACHE, kCacheCapacity, "test-cache"));
+        break;
+      case BenchSetup::Eviction::SLRU:
+        cache_.reset(NewSLRUCache(DRAM_CACHE, kCacheCapacity, "test-cache"));
+        break;
+      case BenchSetup::Eviction::CLOCK:
+        cache_.reset(NewClockCache(DRAM_CACHE, kCacheCapacity, "test-cache"));
+        break;
+    }
   }
 
   // Run queries against the cache until '*done' becomes true.
@@ -161,10 +191,22 @@ class CacheBench : public KuduTest,
 // Test both distributions, and for each, test both the case where the data
 // fits in the cache and where it is a bit larger.
 INSTANTIATE_TEST_CASE_P(Patterns, CacheBench, testing::ValuesIn(std::vector<BenchSetup>{
-      {BenchSetup::Pattern::ZIPFIAN, 1.0},
-      {BenchSetup::Pattern::ZIPFIAN, 3.0},
-      {BenchSetup::Pattern::UNIFORM, 1.0},
-      {BenchSetup::Pattern::UNIFORM, 3.0}
+      {BenchSetup::Pattern::ZIPFIAN, 1.0, BenchSetup::Eviction::LRU, 0},
+      {BenchSetup::Pattern::ZIPFIAN, 3.0, BenchSetup::Eviction::LRU, 0},
+      {BenchSetup::Pattern::UNIFORM, 1.0, BenchSetup::Eviction::LRU, 0},
+      {BenchSetup::Pattern::UNIFORM, 3.0, BenchSetup::Eviction::LRU, 0},
+      {BenchSetup::Pattern::ZIPFIAN, 3.0, BenchSetup::Eviction::SLRU, 0},
+      {BenchSetup::Pattern::ZIPFIAN, 3.0, BenchSetup::Eviction::CLOCK, 0},
+      {BenchSetup::Pattern::UNIFORM, 3.0, BenchSetup::Eviction::CLOCK, 0}
+    }));
+
+// Hit-heavy scenarios with many threads, where the whole dataset fits in the
+// cache: the throughput is then bound by the contention on the shards' locks.
+INSTANTIATE_TEST_CASE_P(HitHeavy, CacheBench, testing::ValuesIn(std::vector<BenchSetup>{
+      {BenchSetup::Pattern::ZIPFIAN, 0.5, BenchSetup::Eviction::LRU, 64},
+      {BenchSetup::Pattern::ZIPFIAN, 0.5, BenchSetup::Eviction::CLOCK, 64},
+      {BenchSetup::Pattern::UNIFORM, 0.5, BenchSetup::Eviction::LRU, 64},
+      {BenchSetup::Pattern::UNIFORM, 0.5, BenchSetup::Eviction::CLOCK, 64}
     }));
 
 TEST_P(CacheBench, RunBench) {
@@ -174,10 +216,10 @@ TEST_P(CacheBench, RunBench) {
   // dataset is smaller than the cache capacity, we would count a bunch of misses
   // during the warm-up phase.
   LOG(INFO) << "Warming up...";
-  RunQueryThreads(FLAGS_num_threads, 1);
+  RunQueryThreads(setup.threads(), 1);
 
   LOG(INFO) << "Running benchmark...";
-  pair<int64_t, int64_t> hits_lookups = RunQueryThreads(FLAGS_num_threads, FLAGS_run_seconds);
+  pair<int64_t, int64_t> hits_lookups = RunQueryThreads(setup.threads(), FLAGS_run_seconds);
   int64_t hits = hits_lookups.first;
   int64_t lookups = hits_lookups.second;
 
@@ -6,6 +6,7 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <glog/logging.h>
@@ -13,6 +14,7 @@
 #include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -30,8 +32,12 @@
 DECLARE_string(nvm_cache_path);
 #endif // defined(__linux__)
 
+DECLARE_bool(cache_force_single_shard);
+DECLARE_bool(cache_numa_local_shards);
 DECLARE_double(cache_memtracker_approximation_ratio);
 
+METRIC_DECLARE_gauge_double(block_cache_hit_ratio);
+
 namespace kudu {
 
 // Conversions between numeric keys/values and the types expected by Cache.
@@ -60,6 +66,7 @@ class CacheTest : public KuduTest,
   std::shared_ptr<MemTracker> mem_tracker_;
   gscoped_ptr<Cache> cache_;
   MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> entity_;
 
   static const int kCacheSize = 14*1024*1024;
 
@@ -76,7 +83,7 @@ class CacheTest : public KuduTest,
     // assertions on the MemTracker in this test.
     FLAGS_cache_memtracker_approximation_ratio = 0;
 
-    cache_.reset(NewLRUCache(GetParam(), kCacheSize, "cache_test"));
+    cache_.reset(CreateCache());
 
     MemTracker::FindTracker("cache_test-sharded_lru_cache", &mem_tracker_);
     // Since nvm cache does not have memtracker due to the use of
@@ -85,9 +92,12 @@ class CacheTest : public KuduTest,
       ASSERT_TRUE(mem_tracker_.get());
     }
 
-    scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(
-        &metric_registry_, "test");
-    cache_->SetMetrics(entity);
+    entity_ = METRIC_ENTITY_server.Instantiate(&metric_registry_, "test");
+    cache_->SetMetrics(entity_);
+  }
+
+  virtual Cache* CreateCache() {
+    return NewLRUCache(GetParam(), kCacheSize, "cache_test");
   }
 
   int Lookup(int key) {
@@ -216,6 +226,15 @@ TEST_P(CacheTest, EvictionPolicy) {
   ASSERT_EQ(-1, Lookup(200));
 }
 
+TEST_P(CacheTest, HitRatio) {
+  Insert(100, 101);
+  ASSERT_EQ(-1, Lookup(200));
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_DOUBLE_EQ(2.0 / 3, down_cast<FunctionGauge<double>*>(
+      entity_->FindOrNull(METRIC_block_cache_hit_ratio).get())->value());
+}
+
 TEST_P(CacheTest, HeavyEntries) {
   // Add a bunch of light and heavy entries and then count the combined
   // size of items still in the cache, which must be approximately the
@@ -243,4 +262,195 @@ TEST_P(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize/10);
 }
 
+// Tests for the segmented LRU eviction policy. A single shard is used so that
+// the segment sizes are exact.
+class SLRUCacheTest : public CacheTest {
+ public:
+  void SetUp() override {
+    FLAGS_cache_force_single_shard = true;
+    CacheTest::SetUp();
+  }
+
+  Cache* CreateCache() override {
+    return NewSLRUCache(GetParam(), kCacheSize, "cache_test");
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(CacheTypes, SLRUCacheTest, ::testing::Values(DRAM_CACHE));
+
+TEST_P(SLRUCacheTest, HitAndMiss) {
+  ASSERT_EQ(-1, Lookup(100));
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  // Replacing an entry which was promoted to the protected segment works.
+  Insert(100, 102);
+  ASSERT_EQ(102, Lookup(100));
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+}
+
+TEST_P(SLRUCacheTest, ScanResistance) {
+  const int kNumHot = 10;
+  const int kHotSize = kCacheSize / 100;
+  const int kNumScanned = 1000;
+  const int kScannedSize = kCacheSize / 100;
+
+  // Insert a few entries and access them again, which promotes them to the
+  // protected segment.
+  for (int i = 0; i < kNumHot; i++) {
+    Insert(i, 100 + i, kHotSize);
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+
+  // Scan through ten times the capacity of the cache, inserting each entry
+  // without accessing it again. With plain LRU this would evict everything.
+  for (int i = 0; i < kNumScanned; i++) {
+    Insert(1000 + i, 2000 + i, kScannedSize);
+  }
+  for (int i = 0; i < kNumHot; i++) {
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+  // The first scanned entries were evicted, the last ones are still cached.
+  ASSERT_EQ(-1, Lookup(1000));
+  ASSERT_EQ(2000 + kNumScanned - 1, Lookup(1000 + kNumScanned - 1));
+}
+
+TEST_P(SLRUCacheTest, ProtectedSegmentIsBounded) {
+  const int kNumElems = 200;
+  const int kSizePerElem = kCacheSize / 100;
+
+  // Access twice as many entries as fit in the whole cache. The protected
+  // segment can't grow beyond its share of the capacity, so the oldest of
+  // them are demoted back to the probationary segment and evicted.
+  for (int i = 0; i < kNumElems; i++) {
+    Insert(i, 100 + i, kSizePerElem);
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+  ASSERT_EQ(-1, Lookup(0));
+  ASSERT_EQ(100 + kNumElems - 1, Lookup(kNumElems - 1));
+
+  int cached_weight = 0;
+  for (int i = 0; i < kNumElems; i++) {
+    if (Lookup(i) >= 0) {
+      cached_weight += kSizePerElem;
+    }
+  }
+  ASSERT_LE(cached_weight, kCacheSize);
+}
+
+// Tests for the CLOCK eviction policy. A single shard is used so that the
+// eviction order is exact.
+class ClockCacheTest : public CacheTest {
+ public:
+  void SetUp() override {
+    FLAGS_cache_force_single_shard = true;
+    CacheTest::SetUp();
+  }
+
+  Cache* CreateCache() override {
+    return NewClockCache(GetParam(), kCacheSize, "cache_test");
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(CacheTypes, ClockCacheTest, ::testing::Values(DRAM_CACHE));
+
+TEST_P(ClockCacheTest, HitAndMiss) {
+  ASSERT_EQ(-1, Lookup(100));
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  Insert(100, 102);
+  ASSERT_EQ(102, Lookup(100));
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+}
+
+TEST_P(ClockCacheTest, SecondChance) {
+  const int kNumElems = 100;
+  const int kSizePerElem = kCacheSize / kNumElems;
+
+  // Fill the cache, then look up every other entry.
+  for (int i = 0; i < kNumElems; i++) {
+    Insert(i, 100 + i, kSizePerElem);
+  }
+  for (int i = 0; i < kNumElems; i += 2) {
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+
+  // Inserting more entries evicts the entries which weren't looked up first,
+  // oldest first.
+  for (int i = 0; i < kNumElems / 2; i++) {
+    Insert(1000 + i, 2000 + i, kSizePerElem);
+  }
+  for (int i = 0; i < kNumElems; i++) {
+    if (i % 2 == 0) {
+      ASSERT_EQ(100 + i, Lookup(i));
+    } else {
+      ASSERT_EQ(-1, Lookup(i));
+    }
+  }
+  for (int i = 0; i < kNumElems / 2; i++) {
+    ASSERT_EQ(2000 + i, Lookup(1000 + i));
+  }
+}
+
+TEST_P(ClockCacheTest, ConcurrentLookups) {
+  const int kNumElems = 1000;
+  for (int i = 0; i < kNumElems; i++) {
+    Insert(i, 100 + i);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&]() {
+        for (int iter = 0; iter < 10; iter++) {
+          for (int i = 0; i < kNumElems; i++) {
+            CHECK_EQ(100 + i, Lookup(i));
+          }
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+// Tests for the caches with a group of shards per NUMA node. On machines
+// without NUMA nodes, these behave like the default caches.
+class NumaCacheTest : public CacheTest {
+ public:
+  void SetUp() override {
+    FLAGS_cache_numa_local_shards = true;
+    CacheTest::SetUp();
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(CacheTypes, NumaCacheTest, ::testing::Values(DRAM_CACHE));
+
+TEST_P(NumaCacheTest, HitMissAndErase) {
+  ASSERT_EQ(-1, Lookup(100));
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+
+  // An entry may be released by a thread on any NUMA node.
+  Cache::Handle* h = cache_->Lookup(EncodeInt(100), Cache::EXPECT_IN_CACHE);
+  ASSERT_NE(nullptr, h);
+  std::thread([&]() { cache_->Release(h); }).join();
+
+  // Entries inserted from other threads are erased wherever they are. The
+  // threads run one at a time since the eviction callback isn't thread-safe.
+  for (int t = 0; t < 4; t++) {
+    std::thread([&, t]() { Insert(200, 201 + t); }).join();
+  }
+  Erase(100);
+  Erase(200);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+  if (mem_tracker_) {
+    ASSERT_EQ(0, mem_tracker_->consumption());
+  }
+}
+
 }  // namespace kudu
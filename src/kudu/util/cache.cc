@@ -4,6 +4,7 @@
 
 #include "kudu/util/cache.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstring>
@@ -32,6 +33,7 @@
 #include "kudu/util/malloc.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/numa.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/test_util_prod.h"
 
@@ -49,6 +51,24 @@ DEFINE_double(cache_memtracker_approximation_ratio, 0.01,
               "this ratio to improve performance. For tests.");
 TAG_FLAG(cache_memtracker_approximation_ratio, hidden);
 
+DEFINE_int32(cache_slru_protected_percentage, 80,
+             "For caches using the SLRU eviction policy, the percentage of the "
+             "capacity which is reserved for entries that have been accessed "
+             "more than once.");
+TAG_FLAG(cache_slru_protected_percentage, advanced);
+TAG_FLAG(cache_slru_protected_percentage, experimental);
+
+DEFINE_bool(cache_numa_local_shards, false,
+            "Whether to give each NUMA node its own group of cache shards. "
+            "Entries are inserted into and looked up in the shards of the node "
+            "of the calling thread, so that the entries and the shard locks "
+            "are mostly accessed from a single node. A block read on one node "
+            "and later needed on another is cached once per node, so the "
+            "effective capacity of the cache shrinks when the accesses aren't "
+            "NUMA-local. Has no effect on machines without NUMA nodes.");
+TAG_FLAG(cache_numa_local_shards, advanced);
+TAG_FLAG(cache_numa_local_shards, experimental);
+
 using std::atomic;
 using std::shared_ptr;
 using std::string;
@@ -59,10 +79,31 @@ namespace kudu {
 Cache::~Cache() {
 }
 
+void Cache::SetMetrics(const scoped_refptr<MetricEntity>& metric_entity) {
+  SetMetrics(std::unique_ptr<CacheMetrics>(new CacheMetrics(metric_entity)));
+}
+
 namespace {
 
 typedef simple_spinlock MutexType;
 
+enum EvictionPolicy {
+  // Evict the least recently used entry.
+  LRU,
+
+  // Segmented LRU: new entries are inserted into a probationary segment and
+  // promoted to a protected segment when they are accessed again. Entries are
+  // evicted from the probationary segment first, so a large scan which touches
+  // every entry only once can't evict the frequently-accessed ones.
+  SLRU,
+
+  // CLOCK (second chance): lookups only set a reference bit on the entry
+  // instead of moving it to the head of the list, so they take the shard's
+  // lock in shared mode and don't contend with each other. Eviction skips
+  // and clears the entries whose bit is set.
+  CLOCK
+};
+
 // LRU cache implementation
 
 // An entry is a variable length heap-allocated structure.  Entries
@@ -77,6 +118,9 @@ struct LRUHandle {
   uint32_t val_length;
   std::atomic<int32_t> refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
+  uint32_t shard;     // Index of the shard the entry was inserted into
+  bool in_protected_segment;  // Only used by the SLRU policy.
+  std::atomic<bool> referenced;  // Only used by the CLOCK policy.
 
   // The storage for the key/value pair itself. The data is stored as:
   //   [key bytes ...] [padding up to 8-byte boundary] [value bytes ...]
@@ -189,12 +233,14 @@ class HandleTable {
 // A single shard of sharded cache.
 class LRUCache {
  public:
-  explicit LRUCache(MemTracker* tracker);
+  LRUCache(MemTracker* tracker, EvictionPolicy policy);
   ~LRUCache();
 
   // Separate from constructor so caller can easily make an array of LRUCache
   void SetCapacity(size_t capacity) {
     capacity_ = capacity;
+    protected_capacity_ = policy_ == SLRU ?
+        capacity / 100 * FLAGS_cache_slru_protected_percentage : 0;
     max_deferred_consumption_ = capacity * FLAGS_cache_memtracker_approximation_ratio;
   }
 
@@ -205,10 +251,16 @@ class LRUCache {
   Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
+  void VisitEntries(size_t max_entries, const Cache::EntryVisitor& visitor);
 
  private:
   void LRU_Remove(LRUHandle* e);
-  void LRU_Append(LRUHandle* e);
+  // Make 'e' the newest entry of the given list, which is either 'lru_' or
+  // 'protected_'.
+  void LRU_Append(LRUHandle* list, LRUHandle* e);
+  // Move the oldest entries of the protected segment back to the
+  // probationary one until it fits in 'protected_capacity_'.
+  void DemoteProtected();
   // Just reduce the reference count by 1.
   // Return true if last reference
   bool Unref(LRUHandle* e);
@@ -235,17 +287,27 @@ class LRUCache {
   // Positive delta indicates an increased memory consumption.
   void UpdateMemTracker(int64_t delta);
 
+  const EvictionPolicy policy_;
+
   // Initialized before use.
   size_t capacity_;
+  size_t protected_capacity_;
 
-  // mutex_ protects the following state.
-  MutexType mutex_;
+  // mutex_ protects the following state. It's only taken in shared mode by
+  // lookups with the CLOCK policy, which don't modify the lists.
+  rw_spinlock mutex_;
   size_t usage_;
+  size_t protected_usage_;
 
   // Dummy head of LRU list.
   // lru.prev is newest entry, lru.next is oldest entry.
+  // With the SLRU policy, this is the probationary segment.
   LRUHandle lru_;
 
+  // Dummy head of the protected segment of the SLRU policy, ordered like
+  // 'lru_'. Always empty with the LRU policy.
+  LRUHandle protected_;
+
   HandleTable table_;
 
   MemTracker* mem_tracker_;
@@ -258,24 +320,30 @@ class LRUCache {
   CacheMetrics* metrics_;
 };
 
-LRUCache::LRUCache(MemTracker* tracker)
- : usage_(0),
+LRUCache::LRUCache(MemTracker* tracker, EvictionPolicy policy)
+ : policy_(policy),
+   usage_(0),
+   protected_usage_(0),
    mem_tracker_(tracker),
    metrics_(nullptr) {
-  // Make empty circular linked list
+  // Make empty circular linked lists
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  protected_.next = &protected_;
+  protected_.prev = &protected_;
 }
 
 LRUCache::~LRUCache() {
-  for (LRUHandle* e = lru_.next; e != &lru_; ) {
-    LRUHandle* next = e->next;
-    DCHECK_EQ(e->refs.load(std::memory_order_relaxed), 1)
-        << "caller has an unreleased handle";
-    if (Unref(e)) {
-      FreeEntry(e);
+  for (LRUHandle* list : { &lru_, &protected_ }) {
+    for (LRUHandle* e = list->next; e != list; ) {
+      LRUHandle* next = e->next;
+      DCHECK_EQ(e->refs.load(std::memory_order_relaxed), 1)
+          << "caller has an unreleased handle";
+      if (Unref(e)) {
+        FreeEntry(e);
+      }
+      e = next;
     }
-    e = next;
   }
   mem_tracker_->Consume(deferred_consumption_);
 }
@@ -313,26 +381,56 @@ void LRUCache::LRU_Remove(LRUHandle* e) {
   e->next->prev = e->prev;
   e->prev->next = e->next;
   usage_ -= e->charge;
+  if (e->in_protected_segment) {
+    protected_usage_ -= e->charge;
+  }
 }
 
-void LRUCache::LRU_Append(LRUHandle* e) {
-  // Make "e" newest entry by inserting just before lru_
-  e->next = &lru_;
-  e->prev = lru_.prev;
+void LRUCache::LRU_Append(LRUHandle* list, LRUHandle* e) {
+  // Make "e" newest entry by inserting just before the list head
+  e->next = list;
+  e->prev = list->prev;
   e->prev->next = e;
   e->next->prev = e;
   usage_ += e->charge;
+  e->in_protected_segment = (list == &protected_);
+  if (e->in_protected_segment) {
+    protected_usage_ += e->charge;
+  }
+}
+
+void LRUCache::DemoteProtected() {
+  while (protected_usage_ > protected_capacity_ && protected_.next != &protected_) {
+    LRUHandle* e = protected_.next;
+    LRU_Remove(e);
+    LRU_Append(&lru_, e);
+  }
 }
 
 Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
   LRUHandle* e;
-  {
-    std::lock_guard<MutexType> l(mutex_);
+  if (policy_ == CLOCK) {
+    shared_lock<rw_spinlock> l(mutex_);
+    e = table_.Lookup(key, hash);
+    if (e != nullptr) {
+      e->refs.fetch_add(1, std::memory_order_relaxed);
+      // Avoid dirtying the cache line if the bit is already set.
+      if (!e->referenced.load(std::memory_order_relaxed)) {
+        e->referenced.store(true, std::memory_order_relaxed);
+      }
+    }
+  } else {
+    std::lock_guard<rw_spinlock> l(mutex_);
     e = table_.Lookup(key, hash);
     if (e != nullptr) {
       e->refs.fetch_add(1, std::memory_order_relaxed);
       LRU_Remove(e);
-      LRU_Append(e);
+      if (policy_ == SLRU) {
+        LRU_Append(&protected_, e);
+        DemoteProtected();
+      } else {
+        LRU_Append(&lru_, e);
+      }
     }
   }
 
@@ -372,6 +470,7 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
   // Allocate().
   e->eviction_callback = eviction_callback;
   e->refs.store(2, std::memory_order_relaxed);  // One from LRUCache, one for the returned handle
+  e->referenced.store(false, std::memory_order_relaxed);
   UpdateMemTracker(e->charge);
   if (PREDICT_TRUE(metrics_)) {
     metrics_->cache_usage->IncrementBy(e->charge);
@@ -380,9 +479,9 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
 
   LRUHandle* to_remove_head = nullptr;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    std::lock_guard<rw_spinlock> l(mutex_);
 
-    LRU_Append(e);
+    LRU_Append(&lru_, e);
 
     LRUHandle* old = table_.Insert(e);
     if (old != nullptr) {
@@ -393,8 +492,18 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
       }
     }
 
+    // With the SLRU policy only the probationary segment is evicted from:
+    // the protected segment never holds more than 'protected_capacity_'.
     while (usage_ > capacity_ && lru_.next != &lru_) {
       LRUHandle* old = lru_.next;
+      // With the CLOCK policy, the entries which were looked up since they
+      // were last passed over get a second chance.
+      if (policy_ == CLOCK && old->referenced.load(std::memory_order_relaxed)) {
+        old->referenced.store(false, std::memory_order_relaxed);
+        LRU_Remove(old);
+        LRU_Append(&lru_, old);
+        continue;
+      }
       LRU_Remove(old);
       table_.Remove(old->key(), old->hash);
       if (Unref(old)) {
@@ -419,7 +528,7 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
   LRUHandle* e;
   bool last_reference = false;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    std::lock_guard<rw_spinlock> l(mutex_);
     e = table_.Remove(key, hash);
     if (e != nullptr) {
       LRU_Remove(e);
@@ -433,12 +542,35 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
   }
 }
 
+void LRUCache::VisitEntries(size_t max_entries, const Cache::EntryVisitor& visitor) {
+  std::lock_guard<rw_spinlock> l(mutex_);
+  size_t visited = 0;
+  // With the SLRU policy, the entries in the protected segment are the hottest.
+  for (LRUHandle* list : { &protected_, &lru_ }) {
+    for (LRUHandle* e = list->prev; e != list && visited < max_entries; e = e->prev) {
+      visitor(e->key(), e->value());
+      visited++;
+    }
+  }
+}
+
+// Determine the number of groups of shards: one per NUMA node if
+// --cache_numa_local_shards is set, or else one.
+int DetermineNumShardGroups() {
+  if (!FLAGS_cache_numa_local_shards || PREDICT_FALSE(FLAGS_cache_force_single_shard)) {
+    return 1;
+  }
+  return std::max(1, NumNumaNodes());
+}
+
 // Determine the number of bits of the hash that should be used to determine
-// the cache shard. This, in turn, determines the number of shards.
-int DetermineShardBits() {
+// the cache shard within a group. This, in turn, determines the number of
+// shards.
+int DetermineShardBits(int num_groups) {
   int bits = PREDICT_FALSE(FLAGS_cache_force_single_shard) ?
-      0 : Bits::Log2Ceiling(base::NumCPUs());
-  VLOG(1) << "Will use " << (1 << bits) << " shards for LRU cache.";
+      0 : Bits::Log2Ceiling(std::max(1, base::NumCPUs() / num_groups));
+  VLOG(1) << "Will use " << num_groups << " groups of " << (1 << bits)
+          << " shards for LRU cache.";
   return bits;
 }
 
@@ -448,7 +580,11 @@ class ShardedLRUCache : public Cache {
   gscoped_ptr<CacheMetrics> metrics_;
   vector<LRUCache*> shards_;
 
-  // Number of bits of hash used to determine the shard.
+  // Number of groups of shards; the shards of group N are used by the threads
+  // on NUMA node N.
+  const int num_groups_;
+
+  // Number of bits of hash used to determine the shard within a group.
   const int shard_bits_;
 
   // Protects 'metrics_'. Used only when metrics are set, to ensure
@@ -461,24 +597,30 @@ class ShardedLRUCache : public Cache {
   }
 
   uint32_t Shard(uint32_t hash) {
+    uint32_t group = 0;
+    if (num_groups_ > 1) {
+      int node = CurrentNumaNode();
+      group = node >= 0 && node < num_groups_ ? node : 0;
+    }
     // Widen to uint64 before shifting, or else on a single CPU,
     // we would try to shift a uint32_t by 32 bits, which is undefined.
-    return static_cast<uint64_t>(hash) >> (32 - shard_bits_);
+    return (group << shard_bits_) + (static_cast<uint64_t>(hash) >> (32 - shard_bits_));
   }
 
  public:
-  explicit ShardedLRUCache(size_t capacity, const string& id)
-      : shard_bits_(DetermineShardBits()) {
+  ShardedLRUCache(size_t capacity, const string& id, EvictionPolicy policy)
+      : num_groups_(DetermineNumShardGroups()),
+        shard_bits_(DetermineShardBits(num_groups_)) {
     // A cache is often a singleton, so:
     // 1. We reuse its MemTracker if one already exists, and
     // 2. It is directly parented to the root MemTracker.
     mem_tracker_ = MemTracker::FindOrCreateGlobalTracker(
         -1, strings::Substitute("$0-sharded_lru_cache", id));
 
-    int num_shards = 1 << shard_bits_;
+    int num_shards = num_groups_ << shard_bits_;
     const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
     for (int s = 0; s < num_shards; s++) {
-      gscoped_ptr<LRUCache> shard(new LRUCache(mem_tracker_.get()));
+      gscoped_ptr<LRUCache> shard(new LRUCache(mem_tracker_.get(), policy));
       shard->SetCapacity(per_shard);
       shards_.push_back(shard.release());
     }
@@ -491,7 +633,9 @@ class ShardedLRUCache : public Cache {
   virtual Handle* Insert(PendingHandle* handle,
                          Cache::EvictionCallback* eviction_callback) OVERRIDE {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(DCHECK_NOTNULL(handle));
-    return shards_[Shard(h->hash)]->Insert(h, eviction_callback);
+    // Remember the shard: the entry may be released from another NUMA node.
+    h->shard = Shard(h->hash);
+    return shards_[h->shard]->Insert(h, eviction_callback);
   }
   virtual Handle* Lookup(const Slice& key, CacheBehavior caching) OVERRIDE {
     const uint32_t hash = HashSlice(key);
@@ -499,16 +643,24 @@ class ShardedLRUCache : public Cache {
   }
   virtual void Release(Handle* handle) OVERRIDE {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(handle);
-    shards_[Shard(h->hash)]->Release(handle);
+    shards_[h->shard]->Release(handle);
   }
   virtual void Erase(const Slice& key) OVERRIDE {
     const uint32_t hash = HashSlice(key);
-    shards_[Shard(hash)]->Erase(key, hash);
+    if (num_groups_ == 1) {
+      shards_[Shard(hash)]->Erase(key, hash);
+      return;
+    }
+    // The entry may have been inserted by any of the NUMA nodes.
+    const uint32_t in_group = static_cast<uint64_t>(hash) >> (32 - shard_bits_);
+    for (int group = 0; group < num_groups_; group++) {
+      shards_[(group << shard_bits_) + in_group]->Erase(key, hash);
+    }
   }
   virtual Slice Value(Handle* handle) OVERRIDE {
     return reinterpret_cast<LRUHandle*>(handle)->value();
   }
-  virtual void SetMetrics(const scoped_refptr<MetricEntity>& entity) OVERRIDE {
+  virtual void SetMetrics(std::unique_ptr<CacheMetrics> metrics) OVERRIDE {
     // TODO(KUDU-2165): reuse of the Cache singleton across multiple MiniCluster servers
     // causes TSAN errors. So, we'll ensure that metrics only get attached once, from
     // whichever server starts first. This has the downside that, in test builds, we won't
@@ -518,12 +670,19 @@ class ShardedLRUCache : public Cache {
       CHECK(IsGTest()) << "Metrics should only be set once per Cache singleton";
       return;
     }
-    metrics_.reset(new CacheMetrics(entity));
+    metrics_.reset(metrics.release());
     for (LRUCache* cache : shards_) {
       cache->SetMetrics(metrics_.get());
     }
   }
 
+  virtual void VisitEntries(size_t max_entries, const EntryVisitor& visitor) OVERRIDE {
+    const size_t per_shard = (max_entries + shards_.size() - 1) / shards_.size();
+    for (LRUCache* cache : shards_) {
+      cache->VisitEntries(per_shard, visitor);
+    }
+  }
+
   virtual PendingHandle* Allocate(Slice key, int val_len, int charge) OVERRIDE {
     int key_len = key.size();
     DCHECK_GE(key_len, 0);
@@ -559,7 +718,7 @@ class ShardedLRUCache : public Cache {
 Cache* NewLRUCache(CacheType type, size_t capacity, const string& id) {
   switch (type) {
     case DRAM_CACHE:
-      return new ShardedLRUCache(capacity, id);
+      return new ShardedLRUCache(capacity, id, LRU);
 #if defined(HAVE_LIB_VMEM)
     case NVM_CACHE:
       return NewLRUNvmCache(capacity, id);
@@ -569,4 +728,22 @@ Cache* NewLRUCache(CacheType type, size_t capacity, const string& id) {
   }
 }
 
+Cache* NewSLRUCache(CacheType type, size_t capacity, const string& id) {
+  switch (type) {
+    case DRAM_CACHE:
+      return new ShardedLRUCache(capacity, id, SLRU);
+    default:
+      LOG(FATAL) << "Unsupported SLRU cache type: " << type;
+  }
+}
+
+Cache* NewClockCache(CacheType type, size_t capacity, const string& id) {
+  switch (type) {
+    case DRAM_CACHE:
+      return new ShardedLRUCache(capacity, id, CLOCK);
+    default:
+      LOG(FATAL) << "Unsupported CLOCK cache type: " << type;
+  }
+}
+
 }  // namespace kudu
@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -31,6 +32,7 @@ namespace kudu {
 
 class Cache;
 class MetricEntity;
+struct CacheMetrics;
 
 enum CacheType {
   DRAM_CACHE,
@@ -41,6 +43,17 @@ enum CacheType {
 // of Cache uses a least-recently-used eviction policy.
 Cache* NewLRUCache(CacheType type, size_t capacity, const std::string& id);
 
+// Create a new cache with a fixed size capacity which uses a segmented LRU
+// eviction policy. Entries which are only accessed once, for example by a
+// large scan, are evicted before any entry which has been accessed again.
+// See --cache_slru_protected_percentage. Only DRAM_CACHE is supported.
+Cache* NewSLRUCache(CacheType type, size_t capacity, const std::string& id);
+
+// Create a new cache with a fixed size capacity which uses the CLOCK
+// approximation of LRU. Lookups don't reorder entries, so concurrent lookups
+// in the same shard don't serialize on its lock. Only DRAM_CACHE is supported.
+Cache* NewClockCache(CacheType type, size_t capacity, const std::string& id);
+
 class Cache {
  public:
   // Callback interface which is called when an entry is evicted from the
@@ -130,7 +143,18 @@ class Cache {
   virtual void Erase(const Slice& key) = 0;
 
   // Pass a metric entity in order to start recoding metrics.
-  virtual void SetMetrics(const scoped_refptr<MetricEntity>& metric_entity) = 0;
+  void SetMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+
+  // Like the above, but records into the given metrics, which allows
+  // several caches to be instrumented on the same entity.
+  virtual void SetMetrics(std::unique_ptr<CacheMetrics> metrics) = 0;
+
+  // Invokes 'visitor' on the key and value of up to 'max_entries' entries,
+  // starting with the most recently used ones. Entries are visited one shard
+  // at a time while holding the shard's lock, so 'visitor' must be cheap and
+  // must not call back into the cache.
+  typedef std::function<void(const Slice& key, const Slice& value)> EntryVisitor;
+  virtual void VisitEntries(size_t max_entries, const EntryVisitor& visitor) = 0;
 
   // ------------------------------------------------------------
   // Insertion path
@@ -17,6 +17,10 @@
 
 #include "kudu/util/cache_metrics.h"
 
+#include <cstdint>
+
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/bind_helpers.h"
 #include "kudu/util/metrics.h"
 
 METRIC_DEFINE_counter(server, block_cache_inserts,
@@ -49,6 +53,13 @@ METRIC_DEFINE_gauge_uint64(server, block_cache_usage, "Block Cache Memory Usage"
                            kudu::MetricUnit::kBytes,
                            "Memory consumed by the block cache");
 
+METRIC_DEFINE_gauge_double(server, block_cache_hit_ratio, "Block Cache Hit Ratio",
+                           kudu::MetricUnit::kUnits,
+                           "Fraction of the lookups expecting to find a block in "
+                           "the cache which found one. The same as block_cache_hits_caching "
+                           "divided by the sum of block_cache_hits_caching and "
+                           "block_cache_misses_caching.");
+
 namespace kudu {
 
 #define MINIT(member, x) member(METRIC_##x.Instantiate(entity))
@@ -62,8 +73,17 @@ CacheMetrics::CacheMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(cache_misses, block_cache_misses),
     MINIT(cache_misses_caching, block_cache_misses_caching),
     GINIT(cache_usage, block_cache_usage) {
+  METRIC_block_cache_hit_ratio.InstantiateFunctionGauge(
+      entity, Bind(&CacheMetrics::HitRatio, Unretained(this)))
+      ->AutoDetach(&metric_detacher_);
 }
 #undef MINIT
 #undef GINIT
 
+double CacheMetrics::HitRatio() const {
+  int64_t hits = cache_hits_caching->value();
+  int64_t lookups = hits + cache_misses_caching->value();
+  return lookups == 0 ? 0 : static_cast<double>(hits) / lookups;
+}
+
 } // namespace kudu
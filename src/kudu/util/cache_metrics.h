@@ -24,8 +24,12 @@
 
 namespace kudu {
 
+// Metrics for a Cache instance. By default these are the 'block_cache_*'
+// metrics; subclasses may instantiate a different set of prototypes into
+// the same members so that several caches can report separately.
 struct CacheMetrics {
   explicit CacheMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+  virtual ~CacheMetrics() {}
 
   scoped_refptr<Counter> inserts;
   scoped_refptr<Counter> lookups;
@@ -36,6 +40,16 @@ struct CacheMetrics {
   scoped_refptr<Counter> cache_misses_caching;
 
   scoped_refptr<AtomicGauge<uint64_t> > cache_usage;
+
+  // Returns the fraction of lookups expecting to find a block which did,
+  // or 0 if there have been no such lookups.
+  double HitRatio() const;
+
+ protected:
+  CacheMetrics() {}
+
+  // Detaches the hit ratio gauge, which is computed by HitRatio().
+  FunctionGaugeDetacher metric_detacher_;
 };
 
 } // namespace kudu
@@ -20,6 +20,7 @@
 #include <cstring>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/gscoped_ptr.h"
@@ -29,6 +30,8 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(zstd_compression_level);
+
 namespace kudu {
 
 using std::vector;
@@ -87,4 +90,22 @@ TEST_F(TestCompression, TestZlibCompressionCodec) {
   TestCompressionCodec(ZLIB);
 }
 
+TEST_F(TestCompression, TestZstdCompressionCodec) {
+  TestCompressionCodec(ZSTD);
+}
+
+TEST_F(TestCompression, TestZstdCompressionLevels) {
+  for (int level : { 1, 3, 19 }) {
+    SCOPED_TRACE(level);
+    FLAGS_zstd_compression_level = level;
+    TestCompressionCodec(ZSTD);
+  }
+}
+
+TEST_F(TestCompression, TestCodecTypeFromName) {
+  ASSERT_EQ(ZSTD, GetCompressionCodecType("zstd"));
+  ASSERT_EQ(LZ4, GetCompressionCodecType("LZ4"));
+  ASSERT_EQ(NO_COMPRESSION, GetCompressionCodecType("none"));
+}
+
 } // namespace kudu
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <algorithm> // IWYU pragma: keep
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <ostream>
@@ -91,9 +92,18 @@ class CowObject {
     lock_.UpgradeToCommitLock();
     std::swap(state_, *dirty_state_);
     dirty_state_.reset();
+    version_++;
     lock_.CommitUnlock();
   }
 
+  // Return the number of mutations committed so far, which identifies the
+  // current state. Derived data may be cached along with the version it was
+  // built from, and is valid as long as the version doesn't change.
+  int64_t version() const {
+    DCHECK(lock_.HasReaders() || lock_.HasWriteLock());
+    return version_;
+  }
+
   // Return the current state, not reflecting any in-progress mutations.
   State& state() {
     DCHECK(lock_.HasReaders() || lock_.HasWriteLock());
@@ -128,6 +138,7 @@ class CowObject {
 
   State state_;
   std::unique_ptr<State> dirty_state_;
+  int64_t version_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(CowObject);
 };
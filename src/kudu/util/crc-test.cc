@@ -19,6 +19,8 @@
 #include <cstring>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
@@ -27,6 +29,7 @@
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/crc.h"
+#include "kudu/util/random.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util.h"
 
@@ -79,8 +82,69 @@ TEST_F(CrcTest, TestCRC32C) {
   ASSERT_EQ(kExpectedCrc, data_crc3);
 }
 
-// Simple benchmark of CRC32C throughput.
-// We should expect about 8 bytes per cycle in throughput on a single core.
+// The interleaved implementation behind Crc32c() must agree with crcutil for
+// all lengths, alignments and previous CRC values.
+TEST_F(CrcTest, TestCRC32CMatchesCrcutil) {
+  Random r(SeedRandom());
+  std::string data;
+  for (int i = 0; i < 3 * 8192 * 2 + 64; i++) {
+    data.push_back(static_cast<char>(r.Next()));
+  }
+  Crc* crc32c = GetCrc32cInstance();
+  for (int i = 0; i < 1000; i++) {
+    size_t offset = r.Uniform(16);
+    // Exercise both short buffers and ones which span several long stripes.
+    size_t length = r.Uniform(i % 2 ? 1024 : data.size() - offset);
+    uint32_t prev_crc = i % 3 ? r.Next() : 0;
+    uint64_t expected = prev_crc;
+    crc32c->Compute(&data[offset], length, &expected);
+    ASSERT_EQ(static_cast<uint32_t>(expected),
+              Crc32c(&data[offset], length, prev_crc))
+        << "offset " << offset << " length " << length;
+  }
+}
+
+TEST_F(CrcTest, TestCRC32CCombine) {
+  Random r(SeedRandom());
+  std::string data;
+  for (int i = 0; i < 100000; i++) {
+    data.push_back(static_cast<char>(r.Next()));
+  }
+  const uint32_t expected = Crc32c(data.data(), data.size());
+
+  // Any split point, including empty pieces.
+  for (size_t split : { static_cast<size_t>(0), static_cast<size_t>(1),
+                        static_cast<size_t>(r.Uniform(data.size())), data.size() }) {
+    uint32_t crc1 = Crc32c(data.data(), split);
+    uint32_t crc2 = Crc32c(data.data() + split, data.size() - split);
+    ASSERT_EQ(expected, Crc32cCombine(crc1, crc2, data.size() - split))
+        << "split at " << split;
+  }
+
+  // Checksum pieces in parallel, then combine them in order.
+  const int kNumPieces = 4;
+  const size_t piece_len = data.size() / kNumPieces;
+  std::vector<uint32_t> crcs(kNumPieces);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumPieces; i++) {
+    threads.emplace_back([&, i]() {
+      size_t len = i == kNumPieces - 1 ? data.size() - piece_len * i : piece_len;
+      crcs[i] = Crc32c(data.data() + piece_len * i, len);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  uint32_t combined = crcs[0];
+  for (int i = 1; i < kNumPieces; i++) {
+    size_t len = i == kNumPieces - 1 ? data.size() - piece_len * i : piece_len;
+    combined = Crc32cCombine(combined, crcs[i], len);
+  }
+  ASSERT_EQ(expected, combined);
+}
+
+// Simple benchmark of CRC32C throughput on a single core, comparing crcutil
+// with the interleaved implementation behind Crc32c().
 TEST_F(CrcTest, BenchmarkCRC32C) {
   gscoped_ptr<const uint8_t[]> data;
   const uint8_t* buf;
@@ -93,19 +157,25 @@ TEST_F(CrcTest, BenchmarkCRC32C) {
     kNumRuns = 40000;
   }
   const uint64_t kNumBytes = kNumRuns * buflen;
-  Stopwatch sw;
-  sw.start();
-  for (int i = 0; i < kNumRuns; i++) {
-    uint64_t cksum;
-    crc32c->Compute(buf, buflen, &cksum);
+  for (bool use_crcutil : { true, false }) {
+    Stopwatch sw;
+    sw.start();
+    for (int i = 0; i < kNumRuns; i++) {
+      if (use_crcutil) {
+        uint64_t cksum;
+        crc32c->Compute(buf, buflen, &cksum);
+      } else {
+        Crc32c(buf, buflen);
+      }
+    }
+    sw.stop();
+    CpuTimes elapsed = sw.elapsed();
+    LOG(INFO) << Substitute("$0: $1 runs of CRC32C on $2 bytes of data (total: $3 bytes)"
+                            " in $4 seconds; $5 GB/s per core",
+                            use_crcutil ? "crcutil" : "Crc32c()",
+                            kNumRuns, buflen, kNumBytes, elapsed.wall_seconds(),
+                            kNumBytes / elapsed.wall_seconds() / 1e9);
   }
-  sw.stop();
-  CpuTimes elapsed = sw.elapsed();
-  LOG(INFO) << Substitute("$0 runs of CRC32C on $1 bytes of data (total: $2 bytes)"
-                          " in $3 seconds; $4 bytes per millisecond, $5 bytes per nanosecond!",
-                          kNumRuns, buflen, kNumBytes, elapsed.wall_seconds(),
-                          (kNumBytes / elapsed.wall_millis()),
-                          (kNumBytes / elapsed.wall));
 }
 
 } // namespace crc
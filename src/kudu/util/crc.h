@@ -37,6 +37,17 @@ uint32_t Crc32c(const void* data, size_t length);
 // extends it to new chunk and returns the result.
 uint32_t Crc32c(const void* data, size_t length, uint32_t prev_crc32);
 
+// Given the CRC32C values of two adjacent chunks of data, the second of which
+// is 'length2' bytes long, returns the CRC32C value of their concatenation.
+//
+// This allows the pieces of a large buffer to be checksummed independently
+// (e.g. by different threads) and their CRC values combined afterwards:
+//
+//   Crc32cCombine(Crc32c(a, len_a), Crc32c(b, len_b), len_b) == Crc32c(ab, len_a + len_b)
+//
+// Takes O(log(length2)) time.
+uint32_t Crc32cCombine(uint32_t crc1, uint32_t crc2, size_t length2);
+
 } // namespace crc
 } // namespace kudu
 
@@ -538,6 +538,68 @@ TEST_F(TestEnv, TestReadVFully) {
   ASSERT_STR_CONTAINS(status.ToString(), "EOF");
 }
 
+TEST_F(TestEnv, TestPrefetch) {
+  const string kTestPath = GetTestPath("foo");
+  const string kTestData = "abcde12345";
+  unique_ptr<RWFile> rw_file;
+  ASSERT_OK(env_->NewRWFile(kTestPath, &rw_file));
+  ASSERT_OK(rw_file->Write(0, kTestData));
+  ASSERT_OK(rw_file->Prefetch(0, kTestData.size()));
+
+  // Prefetching doesn't change what's read back.
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(kTestPath, &file));
+  ASSERT_OK(file->Prefetch(0, kTestData.size()));
+  uint8_t scratch[kTestData.size()];
+  Slice result(scratch, kTestData.size());
+  ASSERT_OK(file->Read(0, result));
+  ASSERT_EQ(kTestData, result);
+}
+
+TEST_F(TestEnv, TestReadVDirect) {
+  const string kTestPath = GetTestPath("foo");
+  // Spans several direct I/O alignment units.
+  const int kTestDataSize = 3 * 4096 + 100;
+  string test_data;
+  test_data.reserve(kTestDataSize);
+  for (int i = 0; i < kTestDataSize; i++) {
+    test_data.push_back('a' + (i % 26));
+  }
+  unique_ptr<RWFile> rw_file;
+  ASSERT_OK(env_->NewRWFile(kTestPath, &rw_file));
+  ASSERT_OK(rw_file->Write(0, test_data));
+  ASSERT_OK(rw_file->Sync());
+
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(kTestPath, &file));
+  // Unaligned reads, including ones crossing alignment boundaries and
+  // ending at the end of the file.
+  for (const auto& range : vector<pair<uint64_t, size_t>>{
+      { 0, 10 }, { 4090, 20 }, { 5000, kTestDataSize - 5000 }, { 1, 3 * 4096 } }) {
+    SCOPED_TRACE(Substitute("$0 bytes at $1", range.second, range.first));
+    unique_ptr<uint8_t[]> scratch_buf(new uint8_t[range.second]);
+    uint8_t* scratch = scratch_buf.get();
+    size_t first_size = range.second / 3;
+    Slice results_backing[] = { Slice(scratch, first_size),
+                                Slice(scratch + first_size, range.second - first_size) };
+    ArrayView<Slice> results(results_backing, 2);
+    ASSERT_OK(file->ReadVDirect(range.first, results));
+    ASSERT_EQ(test_data.substr(range.first, range.second),
+              Slice(scratch, range.second).ToString());
+
+    memset(scratch, 0, range.second);
+    ASSERT_OK(rw_file->ReadVDirect(range.first, results));
+    ASSERT_EQ(test_data.substr(range.first, range.second),
+              Slice(scratch, range.second).ToString());
+  }
+
+  // Reading past the end of the file fails.
+  uint8_t scratch[10];
+  Slice result(scratch, sizeof(scratch));
+  Status s = file->ReadVDirect(kTestDataSize - 5, ArrayView<Slice>(&result, 1));
+  ASSERT_TRUE(s.IsEndOfFile()) << s.ToString();
+}
+
 TEST_F(TestEnv, TestIOVMax) {
   Env* env = Env::Default();
   const string kTestPath = GetTestPath("test");
@@ -618,6 +680,35 @@ TEST_F(TestEnv, TestOverwrite) {
   ASSERT_TRUE(s.IsAlreadyPresent());
 }
 
+// Test that evicting synced data from the page cache doesn't affect what is
+// read back, including the partially written last page.
+TEST_F(TestEnv, TestDropCacheAfterSync) {
+  string test_path = GetTestPath("test_env_wf");
+  WritableFileOptions opts;
+  opts.drop_cache_after_sync = true;
+  shared_ptr<WritableFile> writer;
+  ASSERT_OK(env_util::OpenFileForWrite(opts, env_, test_path, &writer));
+
+  string expected;
+  for (int i = 0; i < 10; i++) {
+    string data(3000, 'a' + i);
+    ASSERT_OK(writer->Append(data));
+    ASSERT_OK(writer->Sync());
+    expected += data;
+  }
+  ASSERT_OK(writer->Close());
+
+  shared_ptr<RandomAccessFile> reader;
+  ASSERT_OK(env_util::OpenFileForRandom(env_, test_path, &reader));
+  uint64_t size;
+  ASSERT_OK(reader->Size(&size));
+  ASSERT_EQ(expected.size(), size);
+  unique_ptr<uint8_t[]> scratch(new uint8_t[size]);
+  Slice result(scratch.get(), size);
+  ASSERT_OK(reader->Read(0, result));
+  ASSERT_EQ(expected, result.ToString());
+}
+
 TEST_F(TestEnv, TestReopen) {
   LOG(INFO) << "Testing reopening behavior";
   string test_path = GetTestPath("test_env_wf");
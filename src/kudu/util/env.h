@@ -435,6 +435,22 @@ class RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Asks the operating system to start reading 'length' bytes beginning
+  // at 'offset' into its page cache, without waiting for the read to
+  // complete. Subsequent reads of the range may then be served from memory.
+  //
+  // This is only a hint: the data may be evicted before it is read.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Prefetch(uint64_t offset, size_t length) const = 0;
+
+  // Like ReadV(), but reads from the device without going through the OS
+  // page cache, where the filesystem supports it, so that data read once
+  // doesn't evict data that's read often. Falls back to ReadV() otherwise.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const = 0;
+
   // Returns the size of the file
   virtual Status Size(uint64_t *size) const = 0;
 
@@ -454,9 +470,15 @@ struct WritableFileOptions {
   // See CreateMode for details.
   Env::CreateMode mode;
 
+  // After each Sync(), advise the kernel to evict the synced data from the
+  // page cache. Useful for files that are written once and rarely read back,
+  // which would otherwise crowd more useful data out of the cache.
+  bool drop_cache_after_sync;
+
   WritableFileOptions()
     : sync_on_close(false),
-      mode(Env::CREATE_IF_NON_EXISTING_TRUNCATE) { }
+      mode(Env::CREATE_IF_NON_EXISTING_TRUNCATE),
+      drop_cache_after_sync(false) { }
 };
 
 // Options specified when a file is opened for random access.
@@ -581,6 +603,22 @@ class RWFile {
   // Safe for concurrent use by multiple threads.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Asks the operating system to start reading 'length' bytes beginning
+  // at 'offset' into its page cache, without waiting for the read to
+  // complete. Subsequent reads of the range may then be served from memory.
+  //
+  // This is only a hint: the data may be evicted before it is read.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Prefetch(uint64_t offset, size_t length) const = 0;
+
+  // Like ReadV(), but reads from the device without going through the OS
+  // page cache, where the filesystem supports it, so that data read once
+  // doesn't evict data that's read often. Falls back to ReadV() otherwise.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const = 0;
+
   // Writes 'data' to the file position given by 'offset'.
   virtual Status Write(uint64_t offset, const Slice& data) = 0;
 
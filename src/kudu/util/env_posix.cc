@@ -47,6 +47,7 @@
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
+#include "kudu/util/alignment.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
@@ -365,6 +366,28 @@ Status DoOpen(const string& filename, Env::CreateMode mode, int* fd) {
   return Status::OK();
 }
 
+Status DoPrefetch(int fd, const string& filename, uint64_t offset, size_t length) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  TRACE_EVENT1("io", "DoPrefetch", "path", filename);
+#if defined(__APPLE__)
+  struct radvisory ra;
+  ra.ra_offset = offset;
+  ra.ra_count = length;
+  int ret;
+  RETRY_ON_EINTR(ret, fcntl(fd, F_RDADVISE, &ra));
+  if (ret == -1) {
+    return IOError(filename, errno);
+  }
+#else
+  // The kernel queues the reads and returns without waiting for them.
+  int err = posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+  if (err != 0) {
+    return IOError(filename, err);
+  }
+#endif
+  return Status::OK();
+}
+
 Status DoReadV(int fd, const string& filename, uint64_t offset,
                ArrayView<Slice> results) {
   MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
@@ -542,6 +565,108 @@ const char* ResourceLimitTypeToMacosRlimit(Env::ResourceLimitType t) {
 }
 #endif
 
+// A second descriptor for a file, opened on first use, through which reads
+// bypass the page cache.
+class DirectReadFile {
+ public:
+  explicit DirectReadFile(const string* filename)
+      : filename_(filename),
+        fd_(-1) {
+  }
+
+  ~DirectReadFile() {
+    if (fd_ >= 0) {
+      int err;
+      RETRY_ON_EINTR(err, close(fd_));
+    }
+  }
+
+  // Reads like DoReadV(), with direct I/O if possible, or else through
+  // 'fallback_fd', the file's regular descriptor.
+  Status ReadV(int fallback_fd, uint64_t offset, ArrayView<Slice> results) const {
+    const string& filename = *filename_;
+    MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+    ThreadRestrictions::AssertIOAllowed();
+    once_.Init(&DirectReadFile::Open, const_cast<DirectReadFile*>(this));
+    if (fd_ < 0) {
+      return DoReadV(fallback_fd, filename, offset, results);
+    }
+
+    // Direct I/O requires the file offset, length and buffer to be aligned,
+    // so read the enclosing aligned range into a scratch buffer.
+    size_t bytes_req = 0;
+    for (const Slice& result : results) {
+      bytes_req += result.size();
+    }
+    const uint64_t aligned_begin = KUDU_ALIGN_DOWN(offset, kAlignment);
+    const uint64_t end = offset + bytes_req;
+    const size_t aligned_length = KUDU_ALIGN_UP(end, kAlignment) - aligned_begin;
+    void* buf;
+    int err = posix_memalign(&buf, kAlignment, aligned_length);
+    if (err != 0) {
+      return IOError(filename, err);
+    }
+    SCOPED_CLEANUP({ free(buf); });
+    uint8_t* scratch = static_cast<uint8_t*>(buf);
+
+    size_t done = 0;
+    while (aligned_begin + done < end) {
+      ssize_t r;
+      RETRY_ON_EINTR(r, pread(fd_, scratch + done, aligned_length - done,
+                              aligned_begin + done));
+      if (PREDICT_FALSE(r < 0)) {
+        if (errno == EINVAL) {
+          // The filesystem doesn't support direct I/O with this alignment.
+          return DoReadV(fallback_fd, filename, offset, results);
+        }
+        return IOError(filename, errno);
+      }
+      if (PREDICT_FALSE(r == 0)) {
+        return Status::EndOfFile(
+            Substitute("EOF trying to read $0 bytes at offset $1", bytes_req, offset));
+      }
+      done += r;
+    }
+
+    const uint8_t* src = scratch + (offset - aligned_begin);
+    for (Slice& result : results) {
+      memcpy(result.mutable_data(), src, result.size());
+      src += result.size();
+    }
+    return Status::OK();
+  }
+
+ private:
+  // The alignment required for direct I/O on the filesystems we run on.
+  static const size_t kAlignment = 4096;
+
+  static void Open(DirectReadFile* file) {
+    const string& filename = *file->filename_;
+    int fd;
+#if defined(__APPLE__)
+    RETRY_ON_EINTR(fd, open(filename.c_str(), O_RDONLY));
+    if (fd >= 0 && fcntl(fd, F_NOCACHE, 1) == -1) {
+      int err;
+      RETRY_ON_EINTR(err, close(fd));
+      fd = -1;
+    }
+#else
+    RETRY_ON_EINTR(fd, open(filename.c_str(), O_RDONLY | O_DIRECT));
+#endif
+    if (fd < 0) {
+      KLOG_EVERY_N_SECS(INFO, 60) << "Unable to open " << filename << " for direct I/O: "
+                                  << ErrnoToString(errno) << "; reading it through the "
+                                  << "page cache instead";
+    }
+    file->fd_ = fd;
+  }
+
+  // Owned by the file this descriptor belongs to.
+  const string* const filename_;
+  mutable GoogleOnceDynamic once_;
+  mutable int fd_;
+};
+
 class PosixSequentialFile: public SequentialFile {
  private:
   const string filename_;
@@ -595,10 +720,13 @@ class PosixRandomAccessFile: public RandomAccessFile {
  private:
   const string filename_;
   const int fd_;
+  DirectReadFile direct_file_;
 
  public:
   PosixRandomAccessFile(string fname, int fd)
-      : filename_(std::move(fname)), fd_(fd) {}
+      : filename_(std::move(fname)),
+        fd_(fd),
+        direct_file_(&filename_) {}
   virtual ~PosixRandomAccessFile() {
     int err;
     RETRY_ON_EINTR(err, close(fd_));
@@ -615,6 +743,14 @@ class PosixRandomAccessFile: public RandomAccessFile {
     return DoReadV(fd_, filename_, offset, results);
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE {
+    return DoPrefetch(fd_, filename_, offset, length);
+  }
+
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const OVERRIDE {
+    return direct_file_.ReadV(fd_, offset, results);
+  }
+
   virtual Status Size(uint64_t *size) const OVERRIDE {
     MAYBE_RETURN_EIO(filename_, IOError(Env::kInjectedFailureStatusMsg, EIO));
     TRACE_EVENT1("io", "PosixRandomAccessFile::Size", "path", filename_);
@@ -641,12 +777,14 @@ class PosixRandomAccessFile: public RandomAccessFile {
 class PosixWritableFile : public WritableFile {
  public:
   PosixWritableFile(string fname, int fd, uint64_t file_size,
-                    bool sync_on_close)
+                    bool sync_on_close, bool drop_cache_after_sync)
       : filename_(std::move(fname)),
         fd_(fd),
         sync_on_close_(sync_on_close),
+        drop_cache_after_sync_(drop_cache_after_sync),
         filesize_(file_size),
         pre_allocated_size_(0),
+        cache_dropped_size_(0),
         pending_sync_(false),
         closed_(false) {}
 
@@ -762,6 +900,9 @@ class PosixWritableFile : public WritableFile {
       if (pending_sync_) {
         pending_sync_ = false;
         RETURN_NOT_OK(DoSync(fd_, filename_));
+        if (drop_cache_after_sync_) {
+          DropSyncedPages();
+        }
       }
     }
     return Status::OK();
@@ -774,12 +915,37 @@ class PosixWritableFile : public WritableFile {
   virtual const string& filename() const OVERRIDE { return filename_; }
 
  private:
+  // Evicts the pages synced since the last call from the page cache. The
+  // last, partially written page is kept, since the next append would
+  // otherwise have to read it back in.
+  void DropSyncedPages() {
+#if defined(__linux__)
+    static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+    uint64_t end = filesize_ - filesize_ % kPageSize;
+    if (end <= cache_dropped_size_) {
+      return;
+    }
+    int err = posix_fadvise(fd_, cache_dropped_size_, end - cache_dropped_size_,
+                            POSIX_FADV_DONTNEED);
+    if (err != 0) {
+      // Only a hint; the data is already durable.
+      KLOG_EVERY_N_SECS(WARNING, 60) << "posix_fadvise() failed on " << filename_ << ": "
+                                     << ErrnoToString(err);
+      return;
+    }
+    cache_dropped_size_ = end;
+#endif
+  }
+
   const string filename_;
   const int fd_;
   const bool sync_on_close_;
+  const bool drop_cache_after_sync_;
 
   uint64_t filesize_;
   uint64_t pre_allocated_size_;
+  // Size of the prefix of the file already evicted from the page cache.
+  uint64_t cache_dropped_size_;
   bool pending_sync_;
   bool closed_;
 };
@@ -791,7 +957,8 @@ class PosixRWFile : public RWFile {
         fd_(fd),
         sync_on_close_(sync_on_close),
         is_on_xfs_(false),
-        closed_(false) {}
+        closed_(false),
+        direct_file_(&filename_) {}
 
   ~PosixRWFile() {
     WARN_NOT_OK(Close(), "Failed to close " + filename_);
@@ -805,6 +972,14 @@ class PosixRWFile : public RWFile {
     return DoReadV(fd_, filename_, offset, results);
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE {
+    return DoPrefetch(fd_, filename_, offset, length);
+  }
+
+  virtual Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const OVERRIDE {
+    return direct_file_.ReadV(fd_, offset, results);
+  }
+
   virtual Status Write(uint64_t offset, const Slice& data) OVERRIDE {
     return WriteV(offset, ArrayView<const Slice>(&data, 1));
   }
@@ -1043,6 +1218,7 @@ class PosixRWFile : public RWFile {
   GoogleOnceDynamic once_;
   bool is_on_xfs_;
   bool closed_;
+  DirectReadFile direct_file_;
 };
 
 int LockOrUnlock(int fd, bool lock) {
@@ -1790,7 +1966,8 @@ class PosixEnv : public Env {
     if (opts.mode == OPEN_EXISTING) {
       RETURN_NOT_OK(GetFileSize(fname, &file_size));
     }
-    result->reset(new PosixWritableFile(fname, fd, file_size, opts.sync_on_close));
+    result->reset(new PosixWritableFile(fname, fd, file_size, opts.sync_on_close,
+                                        opts.drop_cache_after_sync));
     return Status::OK();
   }
 
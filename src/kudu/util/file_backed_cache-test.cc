@@ -0,0 +1,141 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/file_backed_cache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/casts.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/cache_metrics.h"
+#include "kudu/util/env.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+METRIC_DECLARE_entity(server);
+METRIC_DECLARE_gauge_uint64(block_cache_usage);
+
+using std::string;
+using std::unique_ptr;
+using strings::Substitute;
+
+namespace kudu {
+
+// Each entry takes 12 bytes of header, the 8-byte key and the value.
+const size_t kValueSize = 100;
+const size_t kEntrySize = 12 + 8 + kValueSize;
+const size_t kCapacity = 10 * kEntrySize;
+
+class FileBackedCacheTest : public KuduTest {
+ protected:
+  void SetUp() override {
+    KuduTest::SetUp();
+    path_ = GetTestPath("cache");
+    ASSERT_OK(NewFileBackedCache(env_, path_, kCapacity, &cache_));
+    entity_ = METRIC_ENTITY_server.Instantiate(&registry_, "test");
+    cache_->SetMetrics(entity_);
+  }
+
+  static string Key(int i) {
+    return Substitute("key$0", 10000 + i);
+  }
+
+  void Insert(int i) {
+    string key = Key(i);
+    Cache::PendingHandle* ph = cache_->Allocate(key, kValueSize);
+    memset(cache_->MutableValue(ph), i, kValueSize);
+    cache_->Release(cache_->Insert(ph, nullptr));
+  }
+
+  // Returns the first byte of the value of entry 'i', or -1 if not found.
+  int Lookup(int i) {
+    Cache::UniqueHandle h(cache_->Lookup(Key(i), Cache::EXPECT_IN_CACHE),
+                          Cache::HandleDeleter(cache_.get()));
+    if (!h) {
+      return -1;
+    }
+    Slice value = cache_->Value(h.get());
+    CHECK_EQ(kValueSize, value.size());
+    return value[0];
+  }
+
+  string path_;
+  unique_ptr<Cache> cache_;
+  MetricRegistry registry_;
+  scoped_refptr<MetricEntity> entity_;
+};
+
+TEST_F(FileBackedCacheTest, TestInsertAndLookup) {
+  ASSERT_EQ(-1, Lookup(1));
+  Insert(1);
+  Insert(2);
+  ASSERT_EQ(1, Lookup(1));
+  ASSERT_EQ(2, Lookup(2));
+
+  uint64_t size;
+  ASSERT_OK(env_->GetFileSize(path_, &size));
+  ASSERT_EQ(2 * kEntrySize, size);
+
+  cache_->Erase(Key(1));
+  ASSERT_EQ(-1, Lookup(1));
+  ASSERT_EQ(2, Lookup(2));
+}
+
+TEST_F(FileBackedCacheTest, TestEvictionWhenWrappingAround) {
+  // The file holds 10 entries, so the 15 inserts overwrite the first 5.
+  for (int i = 0; i < 15; i++) {
+    Insert(i);
+  }
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ(-1, Lookup(i));
+  }
+  for (int i = 5; i < 15; i++) {
+    ASSERT_EQ(i, Lookup(i));
+  }
+  uint64_t size;
+  ASSERT_OK(env_->GetFileSize(path_, &size));
+  ASSERT_EQ(kCapacity, size);
+}
+
+TEST_F(FileBackedCacheTest, TestReinsert) {
+  Insert(1);
+  for (int i = 0; i < 20; i++) {
+    Insert(2);
+  }
+  // Re-inserting the same key doesn't leave stale entries behind.
+  ASSERT_EQ(-1, Lookup(1));
+  ASSERT_EQ(2, Lookup(2));
+  ASSERT_EQ(kEntrySize, down_cast<AtomicGauge<uint64_t>*>(entity_->FindOrNull(
+      METRIC_block_cache_usage).get())->value());
+}
+
+TEST_F(FileBackedCacheTest, TestDeletesFileOnDestruction) {
+  Insert(1);
+  cache_.reset();
+  ASSERT_FALSE(env_->FileExists(path_));
+}
+
+} // namespace kudu
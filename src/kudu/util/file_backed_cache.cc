@@ -0,0 +1,329 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/file_backed_cache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/cache_metrics.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/env.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/slice.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+
+namespace {
+
+// Each entry is stored in the file as this header followed by its key and its
+// value. Handles point to a heap buffer with the same layout, so that an entry
+// is written or read with a single IO.
+struct EntryHeader {
+  // CRC32C of the key and the value. Used to detect entries which were
+  // overwritten by a concurrent insert while they were being read.
+  uint32_t checksum;
+  uint32_t key_len;
+  uint32_t val_len;
+
+  uint8_t* key_ptr() {
+    return reinterpret_cast<uint8_t*>(this) + sizeof(*this);
+  }
+
+  Slice key() {
+    return Slice(key_ptr(), key_len);
+  }
+
+  uint8_t* val_ptr() {
+    return key_ptr() + key_len;
+  }
+
+  Slice value() {
+    return Slice(val_ptr(), val_len);
+  }
+
+  // The size of the entry, including this header.
+  size_t size() const {
+    return sizeof(*this) + static_cast<size_t>(key_len) + val_len;
+  }
+
+  uint32_t ComputeChecksum() {
+    return crc::Crc32c(key_ptr(), static_cast<size_t>(key_len) + val_len);
+  }
+};
+
+void FreeEntry(EntryHeader* e) {
+  delete [] reinterpret_cast<uint8_t*>(e);
+}
+
+class FileBackedCache : public Cache {
+ public:
+  FileBackedCache(Env* env, string path, size_t capacity, unique_ptr<RWFile> file)
+      : env_(env),
+        path_(std::move(path)),
+        capacity_(capacity),
+        file_(std::move(file)),
+        head_(0),
+        usage_(0) {
+  }
+
+  virtual ~FileBackedCache() {
+    WARN_NOT_OK(file_->Close(), "unable to close cache file " + path_);
+    WARN_NOT_OK(env_->DeleteFile(path_), "unable to delete cache file " + path_);
+  }
+
+  virtual PendingHandle* Allocate(Slice key, int val_len, int /* charge */) OVERRIDE {
+    DCHECK_GE(val_len, 0);
+    uint8_t* buf = new uint8_t[sizeof(EntryHeader) + key.size() + val_len];
+    EntryHeader* e = reinterpret_cast<EntryHeader*>(buf);
+    e->checksum = 0;
+    e->key_len = key.size();
+    e->val_len = val_len;
+    memcpy(e->key_ptr(), key.data(), key.size());
+    return reinterpret_cast<PendingHandle*>(e);
+  }
+
+  virtual uint8_t* MutableValue(PendingHandle* handle) OVERRIDE {
+    return reinterpret_cast<EntryHeader*>(handle)->val_ptr();
+  }
+
+  virtual Handle* Insert(PendingHandle* pending,
+                         EvictionCallback* eviction_callback) OVERRIDE {
+    DCHECK(eviction_callback == nullptr) << "eviction callbacks are not supported";
+    EntryHeader* e = reinterpret_cast<EntryHeader*>(pending);
+    e->checksum = e->ComputeChecksum();
+    if (PREDICT_TRUE(metrics_)) {
+      metrics_->inserts->Increment();
+    }
+
+    // Entries larger than the file can't be cached, but the caller still
+    // gets a handle to the value.
+    const size_t size = e->size();
+    if (PREDICT_FALSE(size > capacity_)) {
+      return reinterpret_cast<Handle*>(e);
+    }
+
+    // Reserve space at the head of the log, evicting the entries which will
+    // be overwritten, and write the entry outside of the lock.
+    uint64_t offset;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (head_ + size > capacity_) {
+        head_ = 0;
+      }
+      offset = head_;
+      head_ += size;
+      EvictRangeUnlocked(offset, size);
+    }
+    Status s = file_->Write(offset, Slice(reinterpret_cast<uint8_t*>(e), size));
+    if (PREDICT_FALSE(!s.ok())) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << "Unable to write to cache file " << path_ << ": "
+                                     << s.ToString() << THROTTLE_MSG;
+      return reinterpret_cast<Handle*>(e);
+    }
+
+    // Publish the entry. Entries which were written to the same space by
+    // concurrent inserts in the meantime (if the log wrapped around) can no
+    // longer be trusted.
+    std::lock_guard<simple_spinlock> l(lock_);
+    EvictRangeUnlocked(offset, size);
+    string key = e->key().ToString();
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      RemoveUnlocked(it);
+    }
+    auto inserted = index_.emplace(std::move(key), Location{ offset, size });
+    entries_by_offset_[offset] = &*inserted.first;
+    usage_ += size;
+    if (PREDICT_TRUE(metrics_)) {
+      metrics_->cache_usage->IncrementBy(size);
+    }
+    return reinterpret_cast<Handle*>(e);
+  }
+
+  virtual void Free(PendingHandle* pending) OVERRIDE {
+    FreeEntry(reinterpret_cast<EntryHeader*>(pending));
+  }
+
+  virtual Handle* Lookup(const Slice& key, CacheBehavior caching) OVERRIDE {
+    Location loc;
+    bool found = false;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      auto it = index_.find(key.ToString());
+      if (it != index_.end()) {
+        loc = it->second;
+        found = true;
+      }
+    }
+
+    EntryHeader* e = nullptr;
+    if (found) {
+      e = reinterpret_cast<EntryHeader*>(new uint8_t[loc.size]);
+      Status s = file_->Read(loc.offset, Slice(reinterpret_cast<uint8_t*>(e), loc.size));
+      if (PREDICT_FALSE(!s.ok() || e->size() != loc.size || e->key() != key ||
+                        e->checksum != e->ComputeChecksum())) {
+        if (!s.ok()) {
+          KLOG_EVERY_N_SECS(WARNING, 60) << "Unable to read from cache file " << path_
+                                         << ": " << s.ToString() << THROTTLE_MSG;
+        }
+        FreeEntry(e);
+        e = nullptr;
+      }
+    }
+
+    if (PREDICT_TRUE(metrics_)) {
+      metrics_->lookups->Increment();
+      bool was_caching = caching == EXPECT_IN_CACHE;
+      if (e != nullptr) {
+        if (was_caching) {
+          metrics_->cache_hits_caching->Increment();
+        } else {
+          metrics_->cache_hits->Increment();
+        }
+      } else {
+        if (was_caching) {
+          metrics_->cache_misses_caching->Increment();
+        } else {
+          metrics_->cache_misses->Increment();
+        }
+      }
+    }
+    return reinterpret_cast<Handle*>(e);
+  }
+
+  virtual void Release(Handle* handle) OVERRIDE {
+    FreeEntry(reinterpret_cast<EntryHeader*>(handle));
+  }
+
+  virtual Slice Value(Handle* handle) OVERRIDE {
+    return reinterpret_cast<EntryHeader*>(handle)->value();
+  }
+
+  virtual void Erase(const Slice& key) OVERRIDE {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto it = index_.find(key.ToString());
+    if (it != index_.end()) {
+      RemoveUnlocked(it);
+    }
+  }
+
+  virtual void SetMetrics(unique_ptr<CacheMetrics> metrics) OVERRIDE {
+    std::lock_guard<simple_spinlock> l(lock_);
+    metrics_ = std::move(metrics);
+    metrics_->cache_usage->set_value(usage_);
+  }
+
+  virtual void VisitEntries(size_t /* max_entries */,
+                            const EntryVisitor& /* visitor */) OVERRIDE {
+  }
+
+ private:
+  // The location of an entry in the file.
+  struct Location {
+    uint64_t offset;
+    size_t size;
+  };
+  typedef std::unordered_map<string, Location> IndexMap;
+
+  // Removes the entries which overlap the 'size' bytes at 'offset' from the
+  // index. 'lock_' must be held.
+  void EvictRangeUnlocked(uint64_t offset, size_t size) {
+    auto it = entries_by_offset_.lower_bound(offset);
+    // The entry before 'offset' may extend into the range.
+    if (it != entries_by_offset_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->first + prev->second->second.size > offset) {
+        it = prev;
+      }
+    }
+    while (it != entries_by_offset_.end() && it->first < offset + size) {
+      auto next = std::next(it);
+      RemoveUnlocked(index_.find(it->second->first));
+      if (PREDICT_TRUE(metrics_)) {
+        metrics_->evictions->Increment();
+      }
+      it = next;
+    }
+  }
+
+  // Removes the entry 'it' from the index. 'lock_' must be held.
+  void RemoveUnlocked(IndexMap::iterator it) {
+    DCHECK(it != index_.end());
+    usage_ -= it->second.size;
+    if (PREDICT_TRUE(metrics_)) {
+      metrics_->cache_usage->DecrementBy(it->second.size);
+    }
+    entries_by_offset_.erase(it->second.offset);
+    index_.erase(it);
+  }
+
+  Env* const env_;
+  const string path_;
+  const size_t capacity_;
+  const unique_ptr<RWFile> file_;
+
+  unique_ptr<CacheMetrics> metrics_;
+
+  // Protects the members below.
+  simple_spinlock lock_;
+
+  // The entries which may be read from the file, by key and by offset.
+  // 'entries_by_offset_' points into 'index_', whose elements are stable.
+  IndexMap index_;
+  std::map<uint64_t, const IndexMap::value_type*> entries_by_offset_;
+
+  // The offset at which the next entry is written.
+  uint64_t head_;
+
+  // The total size of the entries in 'index_'.
+  size_t usage_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileBackedCache);
+};
+
+} // anonymous namespace
+
+Status NewFileBackedCache(Env* env, const string& path, size_t capacity,
+                          unique_ptr<Cache>* cache) {
+  RWFileOptions opts;
+  opts.mode = Env::CREATE_IF_NON_EXISTING_TRUNCATE;
+  unique_ptr<RWFile> file;
+  RETURN_NOT_OK_PREPEND(env->NewRWFile(opts, path, &file),
+                        "unable to create cache file");
+  cache->reset(new FileBackedCache(env, path, capacity, std::move(file)));
+  return Status::OK();
+}
+
+}  // namespace kudu
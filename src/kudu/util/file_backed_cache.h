@@ -0,0 +1,48 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_FILE_BACKED_CACHE_H_
+#define KUDU_UTIL_FILE_BACKED_CACHE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Cache;
+class Env;
+
+// Create a cache which stores its entries in a file of at most 'capacity'
+// bytes at 'path', e.g. on a local SSD. The file is truncated if it already
+// exists, and deleted when the cache is destroyed.
+//
+// The file is written as a circular log: new entries are appended at the
+// head of the log, and the entries which are overwritten when the log wraps
+// around are evicted, so eviction is FIFO rather than LRU. Only an index of
+// the entries is kept in memory. Lookup() reads the entry from the file into
+// a heap buffer which is owned by the returned handle.
+//
+// Eviction callbacks are not supported, and VisitEntries() doesn't visit any
+// entries since their values aren't kept in memory.
+Status NewFileBackedCache(Env* env, const std::string& path, size_t capacity,
+                          std::unique_ptr<Cache>* cache);
+
+}  // namespace kudu
+
+#endif
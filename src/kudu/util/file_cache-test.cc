@@ -30,6 +30,7 @@
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/basictypes.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/debug-util.h"
@@ -45,6 +46,9 @@
 DECLARE_bool(cache_force_single_shard);
 DECLARE_int32(file_cache_expiry_period_ms);
 
+METRIC_DECLARE_counter(file_cache_opens);
+METRIC_DECLARE_counter(file_cache_reopens);
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -84,11 +88,12 @@ class FileCacheTest : public KuduTest {
   }
 
  protected:
-  Status ReinitCache(int max_open_files) {
+  Status ReinitCache(int max_open_files,
+                     const scoped_refptr<MetricEntity>& entity = nullptr) {
     cache_.reset(new FileCache<FileType>("test",
                                          env_,
                                          max_open_files,
-                                         nullptr));
+                                         entity));
     return cache_->Init();
   }
 
@@ -316,6 +321,56 @@ TYPED_TEST(FileCacheTest, TestHeavyReads) {
   }
 }
 
+TYPED_TEST(FileCacheTest, TestOpenMetrics) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity =
+      METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(this->ReinitCache(1, entity));
+  scoped_refptr<Counter> opens = METRIC_file_cache_opens.Instantiate(entity);
+  scoped_refptr<Counter> reopens = METRIC_file_cache_reopens.Instantiate(entity);
+
+  const string kFile1 = this->GetTestPath("foo");
+  const string kFile2 = this->GetTestPath("bar");
+  ASSERT_OK(this->WriteTestFile(kFile1, "test data 1"));
+  ASSERT_OK(this->WriteTestFile(kFile2, "test data 2"));
+
+  // Opening a file for the first time is not a reopen, and using it while its
+  // fd is cached doesn't open it again.
+  shared_ptr<TypeParam> f1;
+  ASSERT_OK(this->cache_->OpenExistingFile(kFile1, &f1));
+  uint64_t size;
+  ASSERT_OK(f1->Size(&size));
+  ASSERT_EQ(1, opens->value());
+  ASSERT_EQ(0, reopens->value());
+
+  // Opening a second file evicts the first file's fd, so the next use of the
+  // first file reopens it.
+  shared_ptr<TypeParam> f2;
+  ASSERT_OK(this->cache_->OpenExistingFile(kFile2, &f2));
+  ASSERT_EQ(2, opens->value());
+  ASSERT_EQ(0, reopens->value());
+  ASSERT_OK(f1->Size(&size));
+  ASSERT_EQ(3, opens->value());
+  ASSERT_EQ(1, reopens->value());
+}
+
+TYPED_TEST(FileCacheTest, TestManyFilesAcrossShards) {
+  // Descriptors for many files are spread across the descriptor map's shards,
+  // and all of them expire once dropped.
+  const int kNumFiles = 100;
+  vector<shared_ptr<TypeParam>> opened_files;
+  for (int i = 0; i < kNumFiles; i++) {
+    string filename = this->GetTestPath(Substitute("$0", i));
+    ASSERT_OK(this->WriteTestFile(filename, "test data"));
+    shared_ptr<TypeParam> f;
+    ASSERT_OK(this->cache_->OpenExistingFile(filename, &f));
+    opened_files.emplace_back(std::move(f));
+  }
+  ASSERT_EQ(kNumFiles, this->cache_->NumDescriptorsForTests());
+  opened_files.clear();
+  NO_FATALS(this->AssertFdsAndDescriptors(1, 0));
+}
+
 TYPED_TEST(FileCacheTest, TestNoRecursiveDeadlock) {
   // This test triggered a deadlock in a previous implementation, when expired
   // weak_ptrs were removed from the descriptor map in the descriptor's
@@ -20,6 +20,7 @@
 #include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -51,6 +52,17 @@ DEFINE_int32(file_cache_expiry_period_ms, 60 * 1000,
              "Period of time (in ms) between removing expired file cache descriptors");
 TAG_FLAG(file_cache_expiry_period_ms, advanced);
 
+METRIC_DEFINE_counter(server, file_cache_opens,
+                      "File Cache Opens", kudu::MetricUnit::kFiles,
+                      "Number of files opened by the file cache, including "
+                      "files reopened after their descriptor was evicted");
+METRIC_DEFINE_counter(server, file_cache_reopens,
+                      "File Cache Reopens", kudu::MetricUnit::kFiles,
+                      "Number of files reopened by the file cache because their "
+                      "descriptor had been evicted. A high rate relative to "
+                      "file_cache_opens suggests the file cache is too small "
+                      "for the working set of open files");
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -100,9 +112,10 @@ class BaseDescriptor {
   ~BaseDescriptor() {
     VLOG(2) << "Out of scope descriptor with file name: " << filename();
 
-    // The (now expired) weak_ptr remains in 'descriptors_', to be removed by
-    // the next call to RunDescriptorExpiry(). Removing it here would risk a
-    // deadlock on recursive acquisition of 'lock_'.
+    // The (now expired) weak_ptr remains in the descriptor map, to be removed
+    // by the next lookup of this file name or by RunDescriptorExpiry().
+    // Removing it here would risk a deadlock on recursive acquisition of the
+    // shard's lock.
 
     if (deleted()) {
       cache()->Erase(filename());
@@ -142,6 +155,17 @@ class BaseDescriptor {
         Cache::HandleDeleter(cache())));
   }
 
+  // Updates the file cache's metrics after the file was opened. 'reopen' is
+  // true if the file had been opened before but its fd was evicted.
+  void RecordFileOpened(bool reopen) const {
+    if (file_cache_->file_opens_) {
+      file_cache_->file_opens_->Increment();
+    }
+    if (reopen && file_cache_->file_reopens_) {
+      file_cache_->file_reopens_->Increment();
+    }
+  }
+
   // Mark this descriptor as to-be-deleted later.
   void MarkDeleted() {
     DCHECK(!deleted());
@@ -245,6 +269,18 @@ class Descriptor<RWFile> : public RWFile {
     return opened.file()->ReadV(offset, results);
   }
 
+  Status Prefetch(uint64_t offset, size_t length) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Prefetch(offset, length);
+  }
+
+  Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->ReadVDirect(offset, results);
+  }
+
   Status Write(uint64_t offset, const Slice& data) override {
     ScopedOpenedDescriptor<RWFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -335,6 +371,8 @@ class Descriptor<RWFile> : public RWFile {
     opts.mode = Env::OPEN_EXISTING;
     unique_ptr<RWFile> f;
     RETURN_NOT_OK(base_.env()->NewRWFile(opts, base_.filename(), &f));
+    // Only the first open is done through InitOnce(), without 'out'.
+    base_.RecordFileOpened(out != nullptr);
 
     // The cache will take ownership of the newly opened file.
     ScopedOpenedDescriptor<RWFile> opened(base_.InsertIntoCache(f.release()));
@@ -372,6 +410,18 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     return opened.file()->ReadV(offset, results);
   }
 
+  Status Prefetch(uint64_t offset, size_t length) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Prefetch(offset, length);
+  }
+
+  Status ReadVDirect(uint64_t offset, ArrayView<Slice> results) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->ReadVDirect(offset, results);
+  }
+
   Status Size(uint64_t *size) const override {
     ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -432,6 +482,8 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     // The file was evicted, reopen it.
     unique_ptr<RandomAccessFile> f;
     RETURN_NOT_OK(base_.env()->NewRandomAccessFile(base_.filename(), &f));
+    // Only the first open is done through InitOnce(), without 'out'.
+    base_.RecordFileOpened(out != nullptr);
 
     // The cache will take ownership of the newly opened file.
     ScopedOpenedDescriptor<RandomAccessFile> opened(
@@ -462,6 +514,8 @@ FileCache<FileType>::FileCache(const string& cache_name,
       running_(1) {
   if (entity) {
     cache_->SetMetrics(entity);
+    file_opens_ = METRIC_file_cache_opens.Instantiate(entity);
+    file_reopens_ = METRIC_file_cache_reopens.Instantiate(entity);
   }
   LOG(INFO) << Substitute("Constructed file cache $0 with capacity $1",
                           cache_name, max_open_files);
@@ -488,13 +542,14 @@ Status FileCache<FileType>::OpenExistingFile(const string& file_name,
   shared_ptr<internal::Descriptor<FileType>> desc;
   {
     // Find an existing descriptor, or create one if none exists.
-    std::lock_guard<simple_spinlock> l(lock_);
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, &desc));
     if (desc) {
       VLOG(2) << "Found existing descriptor: " << desc->filename();
     } else {
       desc = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
-      InsertOrDie(&descriptors_, file_name, desc);
+      InsertOrDie(&shard->descriptors, file_name, desc);
       VLOG(2) << "Created new descriptor: " << desc->filename();
     }
   }
@@ -509,9 +564,10 @@ Status FileCache<FileType>::OpenExistingFile(const string& file_name,
 template <class FileType>
 Status FileCache<FileType>::DeleteFile(const string& file_name) {
   {
-    std::lock_guard<simple_spinlock> l(lock_);
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<simple_spinlock> l(shard->lock);
     shared_ptr<internal::Descriptor<FileType>> desc;
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
+    RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, &desc));
 
     if (desc) {
       VLOG(2) << "Marking file for deletion: " << file_name;
@@ -534,17 +590,18 @@ void FileCache<FileType>::Invalidate(const string& file_name) {
   //
   // This ensures that any concurrent OpenExistingFile() during this method wil
   // see the invalidation and issue a CHECK failure.
+  DescriptorShard* shard = GetShard(file_name);
   shared_ptr<internal::Descriptor<FileType>> desc;
   {
     // Find an existing descriptor, or create one if none exists.
-    std::lock_guard<simple_spinlock> l(lock_);
-    auto it = descriptors_.find(file_name);
-    if (it != descriptors_.end()) {
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    auto it = shard->descriptors.find(file_name);
+    if (it != shard->descriptors.end()) {
       desc = it->second.lock();
     }
     if (!desc) {
       desc = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
-      descriptors_.emplace(file_name, desc);
+      shard->descriptors[file_name] = desc;
     }
 
     desc->base_.MarkInvalidated();
@@ -559,55 +616,70 @@ void FileCache<FileType>::Invalidate(const string& file_name) {
   // the duration of this method, and no other methods erase strong
   // references from the map.
   {
-    std::lock_guard<simple_spinlock> l(lock_);
-    CHECK_EQ(1, descriptors_.erase(file_name));
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    CHECK_EQ(1, shard->descriptors.erase(file_name));
   }
 }
 
 template <class FileType>
 int FileCache<FileType>::NumDescriptorsForTests() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  return descriptors_.size();
+  int num_descriptors = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    num_descriptors += shard.descriptors.size();
+  }
+  return num_descriptors;
 }
 
 template <class FileType>
 string FileCache<FileType>::ToDebugString() const {
-  std::lock_guard<simple_spinlock> l(lock_);
   string ret;
-  for (const auto& e : descriptors_) {
-    bool strong = false;
-    bool deleted = false;
-    bool opened = false;
-    shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
-    if (desc) {
-      strong = true;
-      if (desc->base_.deleted()) {
-        deleted = true;
+  for (const auto& shard : shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    for (const auto& e : shard.descriptors) {
+      bool strong = false;
+      bool deleted = false;
+      bool opened = false;
+      shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
+      if (desc) {
+        strong = true;
+        if (desc->base_.deleted()) {
+          deleted = true;
+        }
+        internal::ScopedOpenedDescriptor<FileType> o(
+            desc->base_.LookupFromCache());
+        if (o.opened()) {
+          opened = true;
+        }
       }
-      internal::ScopedOpenedDescriptor<FileType> o(
-          desc->base_.LookupFromCache());
-      if (o.opened()) {
-        opened = true;
+      if (strong) {
+        ret += Substitute("$0 (S$1$2)\n", e.first,
+                          deleted ? "D" : "", opened ? "O" : "");
+      } else {
+        ret += Substitute("$0\n", e.first);
       }
     }
-    if (strong) {
-      ret += Substitute("$0 (S$1$2)\n", e.first,
-                        deleted ? "D" : "", opened ? "O" : "");
-    } else {
-      ret += Substitute("$0\n", e.first);
-    }
   }
   return ret;
 }
 
+template <class FileType>
+typename FileCache<FileType>::DescriptorShard* FileCache<FileType>::GetShard(
+    const string& file_name) {
+  static_assert((kNumDescriptorShards & (kNumDescriptorShards - 1)) == 0,
+                "kNumDescriptorShards must be a power of two");
+  return &shards_[std::hash<string>()(file_name) & (kNumDescriptorShards - 1)];
+}
+
 template <class FileType>
 Status FileCache<FileType>::FindDescriptorUnlocked(
+    DescriptorShard* shard,
     const string& file_name,
     shared_ptr<internal::Descriptor<FileType>>* file) {
-  DCHECK(lock_.is_locked());
+  DCHECK(shard->lock.is_locked());
 
-  auto it = descriptors_.find(file_name);
-  if (it != descriptors_.end()) {
+  auto it = shard->descriptors.find(file_name);
+  if (it != shard->descriptors.end()) {
     // Found the descriptor. Has it expired?
     shared_ptr<internal::Descriptor<FileType>> desc = it->second.lock();
     if (desc) {
@@ -623,7 +695,7 @@ Status FileCache<FileType>::FindDescriptorUnlocked(
       return Status::OK();
     }
     // Descriptor has expired; erase it and pretend we found nothing.
-    descriptors_.erase(it);
+    shard->descriptors.erase(it);
   }
   return Status::OK();
 }
@@ -632,12 +704,16 @@ template <class FileType>
 void FileCache<FileType>::RunDescriptorExpiry() {
   while (!running_.WaitFor(MonoDelta::FromMilliseconds(
       FLAGS_file_cache_expiry_period_ms))) {
-    std::lock_guard<simple_spinlock> l(lock_);
-    for (auto it = descriptors_.begin(); it != descriptors_.end();) {
-      if (it->second.expired()) {
-        it = descriptors_.erase(it);
-      } else {
-        it++;
+    // Sweep one shard at a time so that concurrent opens only ever wait for
+    // a fraction of the descriptor map to be scanned.
+    for (auto& shard : shards_) {
+      std::lock_guard<simple_spinlock> l(shard.lock);
+      for (auto it = shard.descriptors.begin(); it != shard.descriptors.end();) {
+        if (it->second.expired()) {
+          it = shard.descriptors.erase(it);
+        } else {
+          it++;
+        }
       }
     }
   }
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -44,6 +45,7 @@ class Descriptor;
 
 } // namespace internal
 
+class Counter;
 class MetricEntity;
 class Thread;
 
@@ -69,6 +71,12 @@ class Thread;
 // The values are weak references to the descriptors so that map entries don't
 // affect the descriptor lifecycle.
 //
+// The descriptor map is split into shards by a hash of the file name, each
+// with its own lock, so that concurrent opens of different files (e.g. by a
+// scan touching many rowsets) rarely contend. Expired entries are removed
+// lazily when their file name is looked up, and by a background thread which
+// sweeps one shard at a time.
+//
 // LRU cache
 // ---------
 // The lower half of the file cache is a standard LRU cache whose keys are file
@@ -167,14 +175,33 @@ class FileCache {
   template<class FileType2>
   FRIEND_TEST(FileCacheTest, TestBasicOperations);
 
-  // Looks up a descriptor by file name.
+  // Number of shards in the descriptor map. Must be a power of two.
+  static constexpr int kNumDescriptorShards = 16;
+
+  typedef std::unordered_map<
+      std::string, std::weak_ptr<internal::Descriptor<FileType>>> DescriptorMap;
+
+  // A partition of the descriptor map.
+  struct DescriptorShard {
+    // Protects 'descriptors'.
+    mutable simple_spinlock lock;
+
+    // Maps filenames to descriptors.
+    DescriptorMap descriptors;
+  };
+
+  // Returns the descriptor map shard responsible for 'file_name'.
+  DescriptorShard* GetShard(const std::string& file_name);
+
+  // Looks up a descriptor by file name in 'shard'.
   //
-  // Must be called with 'lock_' held.
-  Status FindDescriptorUnlocked(
+  // Must be called with 'shard->lock' held.
+  static Status FindDescriptorUnlocked(
+      DescriptorShard* shard,
       const std::string& file_name,
       std::shared_ptr<internal::Descriptor<FileType>>* file);
 
-  // Periodically removes expired descriptors from 'descriptors_'.
+  // Periodically removes expired descriptors from 'shards_'.
   void RunDescriptorExpiry();
 
   // Interface to the underlying filesystem.
@@ -190,12 +217,13 @@ class FileCache {
   // Underlying cache instance. Caches opened files.
   std::unique_ptr<Cache> cache_;
 
-  // Protects the descriptor map.
-  mutable simple_spinlock lock_;
+  // The descriptor map, split into shards by file name.
+  std::array<DescriptorShard, kNumDescriptorShards> shards_;
 
-  // Maps filenames to descriptors.
-  std::unordered_map<std::string,
-                     std::weak_ptr<internal::Descriptor<FileType>>> descriptors_;
+  // Number of files opened by descriptors, and the subset of those which were
+  // reopened because their fd had been evicted. May be null.
+  scoped_refptr<Counter> file_opens_;
+  scoped_refptr<Counter> file_reopens_;
 
   // Calls RunDescriptorExpiry() in a loop until 'running_' isn't set.
   scoped_refptr<Thread> descriptor_expiry_thread_;
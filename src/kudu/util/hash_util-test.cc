@@ -15,7 +15,10 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -39,4 +42,24 @@ TEST(HashUtilTest, TestMurmur2Hash64) {
   ASSERT_EQ(3575930248840144026, hash);
 }
 
+// The batched hash must match hashing each key on its own, for every key
+// length (including the tail bytes) and for batches that aren't a multiple
+// of the interleaving factor.
+TEST(HashUtilTest, TestMurmur2Hash64Batch) {
+  for (int len = 0; len <= 20; len++) {
+    for (size_t n : { 0, 1, 3, 4, 5, 9 }) {
+      std::string keys;
+      for (size_t i = 0; i < n * len; i++) {
+        keys.push_back(static_cast<char>(i * 37 + len));
+      }
+      std::vector<uint64_t> hashes(n);
+      HashUtil::MurmurHash2_64Batch(keys.data(), len, n, 42, hashes.data());
+      for (size_t i = 0; i < n; i++) {
+        ASSERT_EQ(HashUtil::MurmurHash2_64(keys.data() + i * len, len, 42), hashes[i])
+            << "len=" << len << " n=" << n << " i=" << i;
+      }
+    }
+  }
+}
+
 } // namespace kudu
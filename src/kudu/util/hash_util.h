@@ -18,6 +18,7 @@
 #ifndef KUDU_UTIL_HASH_UTIL_H
 #define KUDU_UTIL_HASH_UTIL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "kudu/gutil/port.h"
@@ -40,23 +41,72 @@ class HashUtil {
     const uint64_t* end = data + (len / sizeof(uint64_t));
 
     while (data != end) {
-      uint64_t k = *data++;
-      k *= MURMUR_PRIME;
-      k ^= k >> MURMUR_R;
-      k *= MURMUR_PRIME;
-      h ^= k;
-      h *= MURMUR_PRIME;
+      h = MurmurHash2_64Round(h, *data++);
     }
+    return MurmurHash2_64Finish(h, reinterpret_cast<const uint8_t*>(data), len);
+  }
+
+  /// Computes MurmurHash2_64() of 'n' keys of 'len' bytes each, stored
+  /// back-to-back at 'input', into 'hashes'. Each round of Murmur2 depends on
+  /// the previous one, so hashing a single key leaves the multiplier idle
+  /// most of the time; here four keys are hashed with their rounds
+  /// interleaved, which makes batches of short keys (e.g. integer primary
+  /// keys) several times faster to hash.
+  ATTRIBUTE_NO_SANITIZE_INTEGER
+  static void MurmurHash2_64Batch(const void* input, int len, size_t n, uint64_t seed,
+                                  uint64_t* hashes) {
+    const uint8_t* keys = reinterpret_cast<const uint8_t*>(input);
+    const int body_len = len & ~7;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const uint8_t* k0 = keys + i * len;
+      const uint8_t* k1 = k0 + len;
+      const uint8_t* k2 = k1 + len;
+      const uint8_t* k3 = k2 + len;
+      uint64_t h0 = seed ^ (len * MURMUR_PRIME);
+      uint64_t h1 = h0;
+      uint64_t h2 = h0;
+      uint64_t h3 = h0;
+      for (int off = 0; off < body_len; off += 8) {
+        h0 = MurmurHash2_64Round(h0, UNALIGNED_LOAD64(k0 + off));
+        h1 = MurmurHash2_64Round(h1, UNALIGNED_LOAD64(k1 + off));
+        h2 = MurmurHash2_64Round(h2, UNALIGNED_LOAD64(k2 + off));
+        h3 = MurmurHash2_64Round(h3, UNALIGNED_LOAD64(k3 + off));
+      }
+      hashes[i] = MurmurHash2_64Finish(h0, k0 + body_len, len);
+      hashes[i + 1] = MurmurHash2_64Finish(h1, k1 + body_len, len);
+      hashes[i + 2] = MurmurHash2_64Finish(h2, k2 + body_len, len);
+      hashes[i + 3] = MurmurHash2_64Finish(h3, k3 + body_len, len);
+    }
+    for (; i < n; i++) {
+      hashes[i] = MurmurHash2_64(keys + i * len, len, seed);
+    }
+  }
 
-    const uint8_t* data2 = reinterpret_cast<const uint8_t*>(data);
+ private:
+  // Mixes the eight-byte word 'k' into the Murmur2 state 'h'.
+  ATTRIBUTE_NO_SANITIZE_INTEGER
+  static uint64_t MurmurHash2_64Round(uint64_t h, uint64_t k) {
+    k *= MURMUR_PRIME;
+    k ^= k >> MURMUR_R;
+    k *= MURMUR_PRIME;
+    h ^= k;
+    h *= MURMUR_PRIME;
+    return h;
+  }
+
+  // Mixes the last (len % 8) bytes of a key, starting at 'tail', into the
+  // Murmur2 state 'h' and returns the final hash.
+  ATTRIBUTE_NO_SANITIZE_INTEGER
+  static uint64_t MurmurHash2_64Finish(uint64_t h, const uint8_t* tail, int len) {
     switch (len & 7) {
-      case 7: h ^= static_cast<uint64_t>(data2[6]) << 48;
-      case 6: h ^= static_cast<uint64_t>(data2[5]) << 40;
-      case 5: h ^= static_cast<uint64_t>(data2[4]) << 32;
-      case 4: h ^= static_cast<uint64_t>(data2[3]) << 24;
-      case 3: h ^= static_cast<uint64_t>(data2[2]) << 16;
-      case 2: h ^= static_cast<uint64_t>(data2[1]) << 8;
-      case 1: h ^= static_cast<uint64_t>(data2[0]);
+      case 7: h ^= static_cast<uint64_t>(tail[6]) << 48;
+      case 6: h ^= static_cast<uint64_t>(tail[5]) << 40;
+      case 5: h ^= static_cast<uint64_t>(tail[4]) << 32;
+      case 4: h ^= static_cast<uint64_t>(tail[3]) << 24;
+      case 3: h ^= static_cast<uint64_t>(tail[2]) << 16;
+      case 2: h ^= static_cast<uint64_t>(tail[1]) << 8;
+      case 1: h ^= static_cast<uint64_t>(tail[0]);
               h *= MURMUR_PRIME;
     }
 
@@ -16,6 +16,8 @@
 // under the License.
 
 #include <cstdint>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -113,4 +115,35 @@ TEST_F(HdrHistogramTest, PercentileAndCopyTest) {
   ASSERT_EQ(hist.TotalSum(), copy.TotalSum());
 }
 
+// Increments the same histogram from many threads, which exercises the
+// striped totals, and checks that no increment is lost.
+TEST_F(HdrHistogramTest, ConcurrentIncrementTest) {
+  const int kNumThreads = 8;
+  const int kIncrementsPerThread = AllowSlowTests() ? 1000000 : 100000;
+  HdrHistogram hist(10000LU, kSigDigits);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&hist, t, kIncrementsPerThread]() {
+      for (int i = 0; i < kIncrementsPerThread; i++) {
+        hist.Increment(t + 1);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  ASSERT_EQ(kNumThreads * kIncrementsPerThread, hist.TotalCount());
+  ASSERT_EQ(kIncrementsPerThread * kNumThreads * (kNumThreads + 1) / 2, hist.TotalSum());
+  ASSERT_EQ(1, hist.MinValue());
+  ASSERT_EQ(kNumThreads, hist.MaxValue());
+  for (int t = 0; t < kNumThreads; t++) {
+    ASSERT_EQ(kIncrementsPerThread, hist.CountInBucketForValue(t + 1));
+  }
+
+  HdrHistogram copy(hist);
+  ASSERT_EQ(hist.TotalCount(), copy.TotalCount());
+  ASSERT_EQ(hist.TotalSum(), copy.TotalSum());
+}
+
 } // namespace kudu
@@ -26,6 +26,8 @@
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 
+using std::string;
+
 namespace kudu {
 
 template<size_t N>
@@ -46,6 +48,22 @@ static void TestRoundTrip(InlineSlice<N> *slice,
     << "ret        = " << ret.ToDebugString() << "\n"
     << "test_input = " << test_input.ToDebugString();
 
+  // Comparisons must agree with the slice's data, whether or not they can be
+  // decided from the inline prefix.
+  ASSERT_EQ(0, slice->compare(test_input));
+  if (test_size > 0) {
+    Slice shorter(buf.get(), test_size - 1);
+    ASSERT_GT(slice->compare(shorter), 0);
+    ASSERT_LT(slice->compare(Slice("\xff")), 0);
+  }
+  string longer = test_input.ToString() + "x";
+  ASSERT_LT(slice->compare(Slice(longer)), 0);
+  string greater = test_input.ToString();
+  if (test_size > 0 && buf[test_size - 1] != 0xff) {
+    greater[test_size - 1]++;
+    ASSERT_LT(slice->compare(Slice(greater)), 0);
+  }
+
   // If the data is small enough to fit inline, then
   // the returned slice should point directly into the
   // InlineSlice object.
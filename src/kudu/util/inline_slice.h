@@ -17,9 +17,13 @@
 #ifndef KUDU_UTIL_INLINE_SLICE_H
 #define KUDU_UTIL_INLINE_SLICE_H
 
+#include <algorithm>
+#include <cstring>
+
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 
@@ -38,9 +42,8 @@ namespace kudu {
 //   buf_[1..1 + buf_[0]] == inline data
 // If buf_[0] == 0xff:
 //   buf_[1..sizeof(uint8_t *)] == pointer to indirect data, minus the MSB.
-//   buf_[sizeof(uint8_t *)..] = unused
-//     TODO: we could store a prefix of the indirect data in this unused space
-//     in the future, which might be able to short-circuit some comparisons
+//   buf_[sizeof(uint8_t *)..] = a prefix of the indirect data, which allows
+//     compare() to short-circuit comparisons without following the pointer.
 //
 // The indirect data which is pointed to is stored as a 4 byte length followed by
 // the actual data.
@@ -64,7 +67,8 @@ class InlineSlice {
   enum {
     kPointerByteWidth = sizeof(uintptr_t),
     kPointerBitWidth = kPointerByteWidth * 8,
-    kMaxInlineData = STORAGE_SIZE - 1
+    kMaxInlineData = STORAGE_SIZE - 1,
+    kIndirectPrefixSize = STORAGE_SIZE - kPointerByteWidth
   };
 
   static_assert(STORAGE_SIZE >= kPointerByteWidth,
@@ -89,6 +93,36 @@ class InlineSlice {
     return Slice(&buf_[1], len);
   }
 
+  // Compare the stored data with 'other', with the same semantics as
+  // Slice::compare().
+  //
+  // If the data is stored indirectly, the prefix stored inline is compared
+  // first, and the pointer is only followed if it's equal to the prefix of
+  // 'other'.
+  inline int compare(const Slice& other) const ATTRIBUTE_ALWAYS_INLINE {
+    DiscriminatedPointer dptr = LoadValue();
+
+    if (dptr.is_indirect()) {
+      if (kIndirectPrefixSize > 0) {
+        // Indirect data is longer than kMaxInlineData, and thus than the prefix.
+        const size_t n = std::min<size_t>(kIndirectPrefixSize, other.size());
+        int r = memcmp(&buf_[kPointerByteWidth], other.data(), n);
+        if (r != 0) {
+          return r;
+        }
+        if (other.size() < kIndirectPrefixSize) {
+          // 'other' is a prefix of the stored data.
+          return 1;
+        }
+      }
+      const uint8_t *indir_data = reinterpret_cast<const uint8_t *>(dptr.pointer);
+      uint32_t len = *reinterpret_cast<const uint32_t *>(indir_data);
+      indir_data += sizeof(uint32_t);
+      return Slice(indir_data, static_cast<size_t>(len)).compare(other);
+    }
+    return Slice(&buf_[1], dptr.discriminator).compare(other);
+  }
+
   template<class ArenaType>
   void set(const Slice &src, ArenaType *alloc_arena) {
     set(src.data(), src.size(), alloc_arena);
@@ -122,6 +156,11 @@ class InlineSlice {
       void *in_arena = CHECK_NOTNULL(alloc_arena->AllocateBytes(len + sizeof(uint32_t)));
       *reinterpret_cast<uint32_t *>(in_arena) = len;
       memcpy(reinterpret_cast<uint8_t *>(in_arena) + sizeof(uint32_t), src, len);
+      // Store the prefix before the pointer, so that readers which see the
+      // pointer also see the prefix.
+      if (kIndirectPrefixSize > 0) {
+        memcpy(&buf_[kPointerByteWidth], src, kIndirectPrefixSize);
+      }
       set_ptr(in_arena);
     }
   }
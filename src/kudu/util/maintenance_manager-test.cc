@@ -56,6 +56,8 @@ METRIC_DEFINE_histogram(test, maintenance_op_duration,
                         "Maintenance Operation Duration",
                         kudu::MetricUnit::kSeconds, "", 60000000LU, 2);
 
+DECLARE_int32(maintenance_manager_max_ops_per_data_dir);
+DECLARE_int32(maintenance_manager_reserved_threads);
 DECLARE_int64(log_target_replay_size_mb);
 
 namespace kudu {
@@ -105,7 +107,8 @@ class TestMaintenanceOp : public MaintenanceOp {
       maintenance_ops_running_(METRIC_maintenance_ops_running.Instantiate(metric_entity_, 0)),
       remaining_runs_(1),
       prepared_runs_(0),
-      sleep_time_(MonoDelta::FromSeconds(0)) {
+      sleep_time_(MonoDelta::FromSeconds(0)),
+      priority_class_(BACKGROUND) {
   }
 
   virtual ~TestMaintenanceOp() {}
@@ -132,7 +135,11 @@ class TestMaintenanceOp : public MaintenanceOp {
       prepared_runs_--;
     }
 
-    SleepFor(sleep_time_);
+    // Sleep, stopping early if the manager asks us to.
+    MonoTime deadline = MonoTime::Now() + sleep_time_;
+    while (MonoTime::Now() < deadline && !preemption_requested()) {
+      SleepFor(MonoDelta::FromMilliseconds(10));
+    }
   }
 
   virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE {
@@ -176,8 +183,27 @@ class TestMaintenanceOp : public MaintenanceOp {
     return maintenance_ops_running_;
   }
 
+  virtual vector<int> DataDirs() const OVERRIDE {
+    std::lock_guard<Mutex> guard(lock_);
+    return data_dirs_;
+  }
+
+  void set_data_dirs(vector<int> data_dirs) {
+    std::lock_guard<Mutex> guard(lock_);
+    data_dirs_ = std::move(data_dirs);
+  }
+
+  virtual PriorityClass priority_class() const OVERRIDE {
+    return priority_class_;
+  }
+
+  // Must be called before the op is registered.
+  void set_priority_class(PriorityClass priority_class) {
+    priority_class_ = priority_class;
+  }
+
  private:
-  Mutex lock_;
+  mutable Mutex lock_;
 
   uint64_t ram_anchored_;
   uint64_t logs_retained_bytes_;
@@ -195,6 +221,11 @@ class TestMaintenanceOp : public MaintenanceOp {
 
   // The amount of time each op invocation will sleep.
   MonoDelta sleep_time_;
+
+  // The data directories the op claims to write to.
+  vector<int> data_dirs_;
+
+  PriorityClass priority_class_;
 };
 
 // Create an op and wait for it to start running.  Unregister it while it is
@@ -313,6 +344,123 @@ TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   manager_->UnregisterOp(&op2);
 }
 
+// Test that the perf improvement of ops is compared after weighting it.
+TEST_F(MaintenanceManagerTest, TestPerfWeight) {
+  manager_->Shutdown();
+
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE);
+  op1.set_perf_improvement(10);
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE);
+  op2.set_perf_improvement(4);
+  op2.set_perf_weight(3);
+  manager_->RegisterOp(&op1);
+  manager_->RegisterOp(&op2);
+
+  auto op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&op2, op_and_why.first);
+  EXPECT_EQ("perf score=12.000000", op_and_why.second);
+
+  manager_->UnregisterOp(&op1);
+  manager_->UnregisterOp(&op2);
+}
+
+// Test that high-IO ops sharing a data directory aren't run concurrently beyond
+// --maintenance_manager_max_ops_per_data_dir, while ops on other directories
+// can still use the free threads.
+TEST_F(MaintenanceManagerTest, TestMaxOpsPerDataDir) {
+  FLAGS_maintenance_manager_max_ops_per_data_dir = 1;
+
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE);
+  op1.set_perf_improvement(10);
+  op1.set_remaining_runs(2);
+  op1.set_sleep_time(MonoDelta::FromSeconds(1));
+  op1.set_data_dirs({ 0 });
+  manager_->RegisterOp(&op1);
+
+  // Even though there are two MM threads, only one instance may run against
+  // the directory at a time.
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(op1.RunningGauge()->value(), 1);
+    });
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(op1.RunningGauge()->value(), 1);
+
+  // A less worthwhile op writing elsewhere gets the free thread.
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE);
+  op2.set_perf_improvement(1);
+  op2.set_sleep_time(MonoDelta::FromSeconds(1));
+  op2.set_data_dirs({ 1 });
+  manager_->RegisterOp(&op2);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(op2.RunningGauge()->value(), 1);
+    });
+
+  manager_->UnregisterOp(&op2);
+  manager_->UnregisterOp(&op1);
+}
+
+// Test that background ops are kept off the reserved threads, which remain
+// available to more urgent ops.
+TEST_F(MaintenanceManagerTest, TestReservedThreads) {
+  FLAGS_maintenance_manager_reserved_threads = 1;
+
+  TestMaintenanceOp compaction("compaction", MaintenanceOp::HIGH_IO_USAGE);
+  compaction.set_perf_improvement(10);
+  compaction.set_remaining_runs(2);
+  compaction.set_sleep_time(MonoDelta::FromSeconds(1));
+  manager_->RegisterOp(&compaction);
+
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(compaction.RunningGauge()->value(), 1);
+    });
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(compaction.RunningGauge()->value(), 1);
+
+  TestMaintenanceOp flush("flush", MaintenanceOp::HIGH_IO_USAGE);
+  flush.set_priority_class(MaintenanceOp::MEMORY_CRITICAL);
+  flush.set_perf_improvement(1);
+  flush.set_sleep_time(MonoDelta::FromSeconds(1));
+  manager_->RegisterOp(&flush);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(flush.RunningGauge()->value(), 1);
+    });
+
+  manager_->UnregisterOp(&flush);
+  manager_->UnregisterOp(&compaction);
+}
+
+// Test that, under memory pressure, a running background op is asked to stop
+// early when it holds the threads a memory-critical op is waiting for.
+TEST_F(MaintenanceManagerTest, TestPreemptBackgroundOps) {
+  TestMaintenanceOp compaction("compaction", MaintenanceOp::HIGH_IO_USAGE);
+  compaction.set_perf_improvement(10);
+  compaction.set_ram_anchored(0);
+  compaction.set_remaining_runs(2);
+  compaction.set_sleep_time(MonoDelta::FromSeconds(60));
+  manager_->RegisterOp(&compaction);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(compaction.RunningGauge()->value(), 2);
+    });
+
+  TestMaintenanceOp flush("flush", MaintenanceOp::HIGH_IO_USAGE);
+  flush.set_priority_class(MaintenanceOp::MEMORY_CRITICAL);
+  flush.set_ram_anchored(1000);
+  manager_->RegisterOp(&flush);
+
+  // Nothing is urgent yet, so the compactions keep both threads.
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(0, flush.DurationHistogram()->TotalCount());
+  ASSERT_FALSE(compaction.preemption_requested());
+
+  indicate_memory_pressure_ = true;
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(flush.DurationHistogram()->TotalCount(), 1);
+    });
+
+  manager_->UnregisterOp(&flush);
+  manager_->UnregisterOp(&compaction);
+}
+
 // Test retrieving a list of an op's running instances
 TEST_F(MaintenanceManagerTest, TestRunningInstances) {
   TestMaintenanceOp op("op", MaintenanceOp::HIGH_IO_USAGE);
@@ -17,6 +17,7 @@
 
 #include "kudu/util/maintenance_manager.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstddef>
 #include <cstdint>
@@ -26,6 +27,7 @@
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <boost/bind.hpp>
 #include <gflags/gflags.h>
@@ -50,6 +52,7 @@
 
 using std::pair;
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 DEFINE_int32(maintenance_manager_num_threads, 1,
@@ -90,6 +93,32 @@ DEFINE_double(data_gc_prioritization_prob, 0.5,
              "such as delta compaction.");
 TAG_FLAG(data_gc_prioritization_prob, experimental);
 
+DEFINE_int32(maintenance_manager_max_ops_per_data_dir, 0,
+             "The maximum number of high-IO maintenance operations (e.g. flushes "
+             "and compactions) that may run concurrently against a single data "
+             "directory. Operations whose data directories are all saturated are "
+             "skipped in favor of ones that write elsewhere, which keeps the "
+             "maintenance threads spread across disks. If 0, there is no limit.");
+TAG_FLAG(maintenance_manager_max_ops_per_data_dir, advanced);
+TAG_FLAG(maintenance_manager_max_ops_per_data_dir, runtime);
+
+DEFINE_int32(maintenance_manager_reserved_threads, 0,
+             "The number of maintenance threads that background operations, such "
+             "as compactions, may not use. These threads are kept free for "
+             "memory-critical flushes and log GC, so a long compaction can't "
+             "delay them. Always leaves at least one thread for background "
+             "operations.");
+TAG_FLAG(maintenance_manager_reserved_threads, advanced);
+TAG_FLAG(maintenance_manager_reserved_threads, runtime);
+
+DEFINE_bool(maintenance_manager_preempt_background_ops, true,
+            "Whether to ask a running background maintenance operation, such as "
+            "a rowset compaction, to stop early when the server is under memory "
+            "pressure, all maintenance threads are busy, and a memory-critical "
+            "flush is waiting to run.");
+TAG_FLAG(maintenance_manager_preempt_background_ops, advanced);
+TAG_FLAG(maintenance_manager_preempt_background_ops, runtime);
+
 namespace kudu {
 
 MaintenanceOpStats::MaintenanceOpStats() {
@@ -110,7 +139,9 @@ MaintenanceOp::MaintenanceOp(std::string name, IOUsage io_usage)
     : name_(std::move(name)),
       running_(0),
       cancel_(false),
-      io_usage_(io_usage) {
+      preempt_(false),
+      io_usage_(io_usage),
+      perf_weight_(1.0) {
 }
 
 MaintenanceOp::~MaintenanceOp() {
@@ -152,6 +183,7 @@ MaintenanceManager::MaintenanceManager(const Options& options,
           FLAGS_maintenance_manager_polling_interval_ms :
           options.polling_interval_ms),
     running_ops_(0),
+    running_background_ops_(0),
     completed_ops_count_(0),
     rand_(GetRandomSeed32()),
     memory_pressure_func_(&process_memory::UnderMemoryPressure) {
@@ -264,6 +296,9 @@ void MaintenanceManager::RunSchedulerThread() {
     // However, if it's time to shut down, we want to do so immediately.
     while ((running_ops_ >= num_threads_ || prev_iter_found_no_work || disabled_for_tests()) &&
            !shutdown_) {
+      if (running_ops_ >= num_threads_) {
+        MaybePreemptBackgroundOpUnlocked();
+      }
       cond_.WaitFor(polling_interval);
       prev_iter_found_no_work = false;
     }
@@ -286,17 +321,35 @@ void MaintenanceManager::RunSchedulerThread() {
       continue;
     }
 
+    // Account the op against its data directories before dropping the lock,
+    // so that concurrent scheduling decisions see it.
+    vector<int> data_dirs;
+    if (FLAGS_maintenance_manager_max_ops_per_data_dir > 0 &&
+        op->io_usage() == MaintenanceOp::HIGH_IO_USAGE) {
+      data_dirs = op->DataDirs();
+      UpdateDataDirOpCountsUnlocked(data_dirs, 1);
+    }
+
+    const bool is_background = op->priority_class() == MaintenanceOp::BACKGROUND;
+
     // Prepare the maintenance operation.
     op->running_++;
     running_ops_++;
+    if (is_background) {
+      running_background_ops_++;
+    }
     guard.unlock();
     bool ready = op->Prepare();
     guard.lock();
     if (!ready) {
       LOG_WITH_PREFIX(INFO) << "Prepare failed for " << op->name()
                             << ".  Re-running scheduler.";
+      UpdateDataDirOpCountsUnlocked(data_dirs, -1);
       op->running_--;
       running_ops_--;
+      if (is_background) {
+        running_background_ops_--;
+      }
       op->cond_->Signal();
       continue;
     }
@@ -305,7 +358,7 @@ void MaintenanceManager::RunSchedulerThread() {
                                        << op->name() << ": " << note;
     // Run the maintenance operation.
     Status s = thread_pool_->SubmitFunc(boost::bind(
-        &MaintenanceManager::LaunchOp, this, op));
+        &MaintenanceManager::LaunchOp, this, op, std::move(data_dirs)));
     CHECK(s.ok());
   }
 }
@@ -353,6 +406,16 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
 
   double best_perf_improvement = 0;
   MaintenanceOp* best_perf_improvement_op = nullptr;
+
+  // Keep background ops off the threads reserved for more urgent ones.
+  const uint64_t reserved_threads = std::min<int64_t>(
+      std::max(FLAGS_maintenance_manager_reserved_threads, 0), num_threads_ - 1);
+  const bool background_allowed =
+      running_background_ops_ < num_threads_ - reserved_threads;
+
+  // Data directory saturation only needs checking once some op is running.
+  bool check_data_dirs = FLAGS_maintenance_manager_max_ops_per_data_dir > 0 &&
+      !running_ops_per_data_dir_.empty();
   for (OpMapTy::value_type &val : ops_) {
     MaintenanceOp* op(val.first);
     MaintenanceOpStats& stats(val.second);
@@ -363,6 +426,17 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
     if (op->cancelled() || !stats.valid() || !stats.runnable()) {
       continue;
     }
+    if (!background_allowed && op->priority_class() == MaintenanceOp::BACKGROUND) {
+      VLOG_WITH_PREFIX(3) << "Skipping MM op " << op->name()
+                          << ": the remaining threads are reserved";
+      continue;
+    }
+    if (check_data_dirs && op->io_usage() == MaintenanceOp::HIGH_IO_USAGE &&
+        DataDirsSaturatedUnlocked(*op)) {
+      VLOG_WITH_PREFIX(3) << "Skipping MM op " << op->name()
+                          << ": its data directories are saturated";
+      continue;
+    }
     if (stats.logs_retained_bytes() > low_io_most_logs_retained_bytes &&
         op->io_usage() == MaintenanceOp::LOW_IO_USAGE) {
       low_io_most_logs_retained_bytes_op = op;
@@ -393,10 +467,11 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
                                        << stats.data_retained_bytes() << " bytes of data";
     }
 
+    const double perf_improvement = stats.perf_improvement() * op->perf_weight();
     if ((!best_perf_improvement_op) ||
-        (stats.perf_improvement() > best_perf_improvement)) {
+        (perf_improvement > best_perf_improvement)) {
       best_perf_improvement_op = op;
-      best_perf_improvement = stats.perf_improvement();
+      best_perf_improvement = perf_improvement;
     }
   }
 
@@ -449,7 +524,77 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
   return {nullptr, "no ops with positive improvement"};
 }
 
-void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
+void MaintenanceManager::MaybePreemptBackgroundOpUnlocked() {
+  if (!FLAGS_maintenance_manager_preempt_background_ops || running_background_ops_ == 0) {
+    return;
+  }
+  double capacity_pct;
+  if (!memory_pressure_func_(&capacity_pct)) {
+    return;
+  }
+
+  MaintenanceOp* victim = nullptr;
+  MaintenanceOp* waiting_op = nullptr;
+  for (OpMapTy::value_type& val : ops_) {
+    MaintenanceOp* op(val.first);
+    switch (op->priority_class()) {
+      case MaintenanceOp::BACKGROUND:
+        if (op->running_ > 0) {
+          if (op->preemption_requested()) {
+            // Give the op we already asked a chance to stop.
+            return;
+          }
+          victim = op;
+        }
+        break;
+      case MaintenanceOp::MEMORY_CRITICAL: {
+        if (waiting_op || op->cancelled()) {
+          break;
+        }
+        MaintenanceOpStats& stats(val.second);
+        stats.Clear();
+        op->UpdateStats(&stats);
+        if (stats.valid() && stats.runnable() && stats.ram_anchored() > 0) {
+          waiting_op = op;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  if (victim && waiting_op) {
+    LOG_WITH_PREFIX(INFO) << Substitute(
+        "Asking $0 to stop early: under memory pressure ($1% of limit used) and $2 is waiting",
+        victim->name(), StringPrintf("%.2f", capacity_pct), waiting_op->name());
+    victim->preempt_.Store(true);
+  }
+}
+
+bool MaintenanceManager::DataDirsSaturatedUnlocked(const MaintenanceOp& op) const {
+  const int max_ops = FLAGS_maintenance_manager_max_ops_per_data_dir;
+  for (int dir : op.DataDirs()) {
+    const int* running = FindOrNull(running_ops_per_data_dir_, dir);
+    if (running && *running >= max_ops) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MaintenanceManager::UpdateDataDirOpCountsUnlocked(const vector<int>& data_dirs,
+                                                       int delta) {
+  for (int dir : data_dirs) {
+    int& running = running_ops_per_data_dir_[dir];
+    running += delta;
+    DCHECK_GE(running, 0);
+    if (running == 0) {
+      running_ops_per_data_dir_.erase(dir);
+    }
+  }
+}
+
+void MaintenanceManager::LaunchOp(MaintenanceOp* op, const vector<int>& data_dirs) {
   int64_t thread_id = Thread::CurrentThreadId();
   OpInstance op_instance;
   op_instance.thread_id = thread_id;
@@ -475,8 +620,15 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
 
     op->DurationHistogram()->Increment(op_instance.duration.ToMilliseconds());
 
+    UpdateDataDirOpCountsUnlocked(data_dirs, -1);
     running_ops_--;
+    if (op->priority_class() == MaintenanceOp::BACKGROUND) {
+      running_background_ops_--;
+    }
     op->running_--;
+    if (op->running_ == 0) {
+      op->preempt_.Store(false);
+    }
     op->cond_->Signal();
     cond_.Signal(); // wake up scheduler
   });
@@ -180,6 +180,15 @@ class MaintenanceOp {
     HIGH_IO_USAGE // Everything else.
   };
 
+  // The scheduling class of the op, from most to least urgent. Background ops
+  // may be kept off some threads (see --maintenance_manager_reserved_threads)
+  // and asked to stop early to make room for memory-critical ones.
+  enum PriorityClass {
+    MEMORY_CRITICAL,  // Frees memory, e.g. MRS and DMS flushes.
+    ANCHOR_RELEASING, // Releases WAL retention cheaply, e.g. log GC.
+    BACKGROUND        // Everything else, e.g. compactions.
+  };
+
   explicit MaintenanceOp(std::string name, IOUsage io_usage);
   virtual ~MaintenanceOp();
 
@@ -209,6 +218,20 @@ class MaintenanceOp {
   // Returns the gauge for this op that tracks when this op is running. Cannot be NULL.
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const = 0;
 
+  // Returns the op's scheduling class. This must not change while the op is
+  // registered.
+  virtual PriorityClass priority_class() const {
+    return BACKGROUND;
+  }
+
+  // Returns the indexes of the data directories this op writes to, used to
+  // cap the number of high-IO ops running against the same directory. An
+  // empty result means the op isn't tied to any data directory. This will be
+  // run under the MaintenanceManager lock, so it should be cheap.
+  virtual std::vector<int> DataDirs() const {
+    return {};
+  }
+
   uint32_t running() { return running_; }
 
   std::string name() const { return name_; }
@@ -228,6 +251,21 @@ class MaintenanceOp {
     cancel_.Store(true);
   }
 
+  // Return true if the MaintenanceManager has asked the running instances of
+  // this op to stop early to make room for more urgent work. Lengthy ops should
+  // poll this in Perform() and return at the next point where it's safe to do
+  // so. The request is cleared once no instance of the op is running.
+  bool preemption_requested() const {
+    return preempt_.Load();
+  }
+
+  // The factor the op's perf improvement is multiplied by when the ops are
+  // compared by perf improvement, e.g. to favor the tablets of a resource
+  // pool with a large share of the server. Must be set before the op is
+  // registered.
+  double perf_weight() const { return perf_weight_; }
+  void set_perf_weight(double perf_weight) { perf_weight_ = perf_weight; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(MaintenanceOp);
 
@@ -242,6 +280,10 @@ class MaintenanceOp {
   // New operations will not be scheduled when this boolean is set.
   AtomicBool cancel_;
 
+  // Set when the MaintenanceManager wants the running instances of this op to
+  // stop early. Only set on background ops.
+  AtomicBool preempt_;
+
   // Condition variable which the UnregisterOp function can wait on.
   //
   // Note: 'cond_' is used with the MaintenanceManager's mutex. As such,
@@ -253,6 +295,8 @@ class MaintenanceOp {
   std::shared_ptr<MaintenanceManager> manager_;
 
   IOUsage io_usage_;
+
+  double perf_weight_;
 };
 
 struct MaintenanceOpComparator {
@@ -316,7 +360,22 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // suitable for logging.
   std::pair<MaintenanceOp*, std::string> FindBestOp();
 
-  void LaunchOp(MaintenanceOp* op);
+  // If the server is under memory pressure, all threads are busy, and a
+  // memory-critical op is waiting to free memory, asks a running background op
+  // to stop early. Requires that lock_ is held.
+  void MaybePreemptBackgroundOpUnlocked();
+
+  // Returns true if scheduling 'op' would exceed
+  // --maintenance_manager_max_ops_per_data_dir on any of its data directories.
+  // Requires that lock_ is held.
+  bool DataDirsSaturatedUnlocked(const MaintenanceOp& op) const;
+
+  // Adds 'delta' to the running op count of each of 'data_dirs'.
+  // Requires that lock_ is held.
+  void UpdateDataDirOpCountsUnlocked(const std::vector<int>& data_dirs, int delta);
+
+  // Runs 'op', which has been accounted against 'data_dirs'.
+  void LaunchOp(MaintenanceOp* op, const std::vector<int>& data_dirs);
 
   std::string LogPrefix() const;
 
@@ -330,6 +389,13 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   bool shutdown_;
   int32_t polling_interval_ms_;
   uint64_t running_ops_;
+  // The number of running (or preparing) ops in the BACKGROUND class.
+  // Protected by lock_.
+  uint64_t running_background_ops_;
+  // The number of high-IO ops running (or being prepared) against each data
+  // directory, keyed by the data directory's index. Only tracked when
+  // --maintenance_manager_max_ops_per_data_dir is positive. Protected by lock_.
+  std::unordered_map<int, int> running_ops_per_data_dir_;
   // Vector used as a circular buffer for recently completed ops. Elements need to be added at
   // the completed_ops_count_ % the vector's size and then the count needs to be incremented.
   std::vector<OpInstance> completed_ops_;
@@ -117,6 +117,46 @@ TEST(MemTrackerTest, TrackerHierarchy) {
   c2->Release(60);
 }
 
+// Consumption of trackers without a limit is striped across CPUs. Make sure it
+// adds up when many threads update it, and that limits stay exact.
+TEST(MemTrackerTest, MultiThreadedConsumption) {
+  const int kNumThreads = 8;
+  const int kNumIterations = 10000;
+  const int64_t kLimit = kNumThreads * 10;
+  shared_ptr<MemTracker> p = MemTracker::CreateTracker(-1, "p");
+  shared_ptr<MemTracker> unlimited = MemTracker::CreateTracker(-1, "unlimited", p);
+  shared_ptr<MemTracker> limited = MemTracker::CreateTracker(kLimit, "limited", p);
+
+  std::atomic<int64_t> limited_consumed(0);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&]{
+        for (int j = 0; j < kNumIterations; j++) {
+          unlimited->Consume(j % 100 + 1);
+          unlimited->Release(j % 100);
+          if (limited->TryConsume(20)) {
+            CHECK_LE(limited->consumption(), kLimit);
+            limited->Release(20);
+          }
+        }
+        if (limited->TryConsume(10)) {
+          limited_consumed += 10;
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(kNumThreads * kNumIterations, unlimited->consumption());
+  ASSERT_GE(unlimited->peak_consumption(), unlimited->consumption());
+  ASSERT_EQ(limited_consumed.load(), limited->consumption());
+  ASSERT_EQ(unlimited->consumption() + limited->consumption(), p->consumption());
+
+  unlimited->Release(unlimited->consumption());
+  limited->Release(limited->consumption());
+  ASSERT_EQ(0, p->consumption());
+}
+
 class GcFunctionHelper {
  public:
   static const int kNumReleaseBytes = 1;
@@ -28,6 +28,7 @@
 
 #include "kudu/util/high_water_mark.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/striped64.h"
 
 namespace kudu {
 
@@ -54,6 +55,13 @@ namespace kudu {
 // Memory consumption is tracked via calls to Consume()/Release(), either to
 // the tracker itself or to one of its descendants.
 //
+// Trackers with a limit keep their consumption in a single counter, so that
+// limit checks are exact. Trackers without one, including the root and most
+// intermediate trackers, which every allocation in the process goes through,
+// spread it over per-CPU cells when they're updated concurrently (see
+// LongAdder), summing the cells when the consumption is read. Their peak
+// consumption is only sampled when their consumption is read.
+//
 // This class is thread-safe.
 class MemTracker : public std::enable_shared_from_this<MemTracker> {
  public:
@@ -137,10 +145,20 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
 
   // Returns the memory consumed in bytes.
   int64_t consumption() const {
-    return consumption_.current_value();
+    if (has_limit()) {
+      return consumption_.current_value();
+    }
+    int64_t value = unlimited_consumption_.Value();
+    consumption_.set_value(value);
+    return value;
   }
 
-  int64_t peak_consumption() const { return consumption_.max_value(); }
+  int64_t peak_consumption() const {
+    if (!has_limit()) {
+      consumption();
+    }
+    return consumption_.max_value();
+  }
 
   // Retrieve the parent tracker, or NULL If one is not set.
   std::shared_ptr<MemTracker> parent() const { return parent_; }
@@ -169,12 +187,28 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // Creates the root tracker.
   static void CreateRootTracker();
 
+  // Adds 'bytes', which may be negative, to the consumption of this tracker
+  // alone, without checking its limit.
+  void IncrementConsumptionBy(int64_t bytes) {
+    if (has_limit()) {
+      consumption_.IncrementBy(bytes);
+    } else {
+      unlimited_consumption_.IncrementBy(bytes);
+    }
+  }
+
   int64_t limit_;
   const std::string id_;
   const std::string descr_;
   std::shared_ptr<MemTracker> parent_;
 
-  HighWaterMark consumption_;
+  // The consumption of a tracker with a limit. For a tracker without one, this
+  // holds the consumption last read from 'unlimited_consumption_', and the peak
+  // of those reads.
+  mutable HighWaterMark consumption_;
+
+  // The consumption of a tracker without a limit.
+  LongAdder unlimited_consumption_;
 
   // this tracker plus all of its ancestors
   std::vector<MemTracker*> all_trackers_;
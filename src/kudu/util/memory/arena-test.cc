@@ -40,6 +40,7 @@ namespace kudu {
 using std::shared_ptr;
 using std::string;
 using std::thread;
+using std::unique_ptr;
 using std::vector;
 
 template<class ArenaType>
@@ -202,4 +203,98 @@ TEST(TestArena, TestSTLAllocator) {
   }
 }
 
+TEST(TestArena, TestRetain) {
+  Arena a(256);
+  std::shared_ptr<int> obj = std::make_shared<int>(1);
+  std::weak_ptr<int> weak(obj);
+  a.Retain(std::move(obj));
+  ASSERT_FALSE(weak.expired());
+
+  // The retained objects are released on Reset().
+  a.Reset();
+  ASSERT_TRUE(weak.expired());
+
+  // ... and when the arena is destroyed.
+  {
+    Arena b(256);
+    obj = std::make_shared<int>(2);
+    weak = obj;
+    b.Retain(std::move(obj));
+    ASSERT_FALSE(weak.expired());
+  }
+  ASSERT_TRUE(weak.expired());
+}
+
+TEST(TestArena, TestComponentAllocatorPool) {
+  const size_t kBlockSize = 64 * 1024;
+  ArenaComponentAllocator allocator(kBlockSize, ArenaComponentAllocator::NO_HUGE_PAGES);
+
+  unique_ptr<Buffer> buffer(allocator.Allocate(kBlockSize));
+  ASSERT_TRUE(buffer);
+  void* data = buffer->data();
+  buffer.reset();
+  ASSERT_EQ(kBlockSize, allocator.pooled_bytes());
+
+  // A smaller request of the same size class reuses the block, but the buffer
+  // has the requested size.
+  buffer.reset(allocator.Allocate(kBlockSize - 1000));
+  ASSERT_EQ(data, buffer->data());
+  ASSERT_EQ(kBlockSize - 1000, buffer->size());
+  ASSERT_EQ(0, allocator.pooled_bytes());
+
+  // Once the pool is full, freed blocks go back to the heap.
+  unique_ptr<Buffer> other(allocator.Allocate(kBlockSize));
+  buffer.reset();
+  other.reset();
+  ASSERT_EQ(kBlockSize, allocator.pooled_bytes());
+
+  // Blocks outside the pooled sizes aren't pooled at all.
+  buffer.reset(allocator.Allocate(ArenaComponentAllocator::kMinPooledSize - 1));
+  buffer.reset(allocator.Allocate(ArenaComponentAllocator::kMaxPooledSize + 1));
+  buffer.reset();
+  ASSERT_EQ(kBlockSize, allocator.pooled_bytes());
+}
+
+TEST(TestArena, TestComponentAllocatorThreadCache) {
+  ArenaComponentAllocator* allocator = ArenaComponentAllocator::Get();
+  unique_ptr<Buffer> buffer(allocator->Allocate(128 * 1024));
+  void* data = buffer->data();
+  size_t pooled_bytes = allocator->pooled_bytes();
+  buffer.reset();
+
+  // The block is cached by this thread rather than given to the shared pool.
+  ASSERT_EQ(pooled_bytes, allocator->pooled_bytes());
+  buffer.reset(allocator->Allocate(128 * 1024));
+  ASSERT_EQ(data, buffer->data());
+
+  // When a thread exits, its cached blocks go to the shared pool.
+  thread t([&]() {
+      delete allocator->Allocate(256 * 1024);
+    });
+  t.join();
+  ASSERT_EQ(pooled_bytes + 256 * 1024, allocator->pooled_bytes());
+}
+
+#if defined(__linux__)
+TEST(TestArena, TestHugePageComponents) {
+  ArenaComponentAllocator allocator(0, ArenaComponentAllocator::TRANSPARENT_HUGE_PAGES);
+  ASSERT_TRUE(allocator.huge_pages_enabled());
+
+  const size_t kSize = ArenaComponentAllocator::kHugePageSize + 1000;
+  unique_ptr<Buffer> buffer(allocator.Allocate(kSize));
+  ASSERT_TRUE(buffer);
+  ASSERT_EQ(kSize, buffer->size());
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(buffer->data()) %
+            ArenaComponentAllocator::kHugePageSize);
+  memset(buffer->data(), 0xff, buffer->size());
+
+  // Arenas may grow their components up to a huge page.
+  ThreadSafeArena arena(1024);
+  arena.SetMaxBufferSize(ArenaComponentAllocator::kHugePageSize);
+  for (int i = 0; i < 4096; i++) {
+    ASSERT_TRUE(arena.AllocateBytes(1024));
+  }
+}
+#endif
+
 } // namespace kudu
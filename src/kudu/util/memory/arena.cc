@@ -22,6 +22,8 @@
 #include <algorithm>
 #include <memory>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 using std::min;
 using std::unique_ptr;
@@ -53,13 +55,16 @@ ArenaBase<THREADSAFE>::ArenaBase(BufferAllocator* buffer_allocator,
 
 template <bool THREADSAFE>
 ArenaBase<THREADSAFE>::ArenaBase(size_t initial_buffer_size)
-    : ArenaBase<THREADSAFE>(HeapBufferAllocator::Get(),
+    : ArenaBase<THREADSAFE>(ArenaComponentAllocator::Get(),
                             initial_buffer_size) {
 }
 
 template <bool THREADSAFE>
 void ArenaBase<THREADSAFE>::SetMaxBufferSize(size_t size) {
-  DCHECK_LE(size, kMaxTcmallocFastAllocation);
+  // Huge page components don't come from tcmalloc, so the limit doesn't
+  // apply to them.
+  DCHECK_LE(size, std::max<size_t>(kMaxTcmallocFastAllocation,
+                                   ArenaComponentAllocator::kHugePageSize));
   max_buffer_size_ = size;
 }
 
@@ -130,9 +135,19 @@ void ArenaBase<THREADSAFE>::AddComponent(ArenaBase::Component *component) {
   arena_footprint_ += component->size();
 }
 
+template <bool THREADSAFE>
+void ArenaBase<THREADSAFE>::Retain(std::shared_ptr<void> obj) {
+  std::lock_guard<mutex_type> lock(component_lock_);
+  retained_.emplace_back(std::move(obj));
+}
+
 template <bool THREADSAFE>
 void ArenaBase<THREADSAFE>::Reset() {
+  // Release the retained objects outside of the lock, since their
+  // destructors may be arbitrarily expensive.
+  std::vector<std::shared_ptr<void>> retained;
   std::lock_guard<mutex_type> lock(component_lock_);
+  retained.swap(retained_);
 
   if (PREDICT_FALSE(arena_.size() > 1)) {
     unique_ptr<Component> last = std::move(arena_.back());
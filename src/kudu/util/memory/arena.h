@@ -95,11 +95,14 @@ class ArenaBase {
   ArenaBase(BufferAllocator* buffer_allocator,
             size_t initial_buffer_size);
 
-  // Creates an arena using a default (heap) allocator.
+  // Creates an arena using the default allocator, which recycles components
+  // across arenas (see ArenaComponentAllocator).
   explicit ArenaBase(size_t initial_buffer_size);
 
   // Set the maximum buffer size allocated for this arena.
-  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes).
+  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes),
+  // or a huge page for arenas whose components may be mapped on huge pages (see
+  // ArenaComponentAllocator).
   //
   // Consider the following pros/cons of large buffer sizes:
   //
@@ -166,8 +169,15 @@ class ArenaBase {
   // NOTE: alignment MUST be a power of two, or else this will break.
   void* AllocateBytesAligned(const size_t size, const size_t alignment);
 
+  // Keeps 'obj' alive until the arena is reset or destroyed. This lets data
+  // which lives outside of the arena, such as a pinned block cache entry, be
+  // referenced by slices handed out along with the arena's own data, without
+  // copying it into the arena.
+  void Retain(std::shared_ptr<void> obj);
+
   // Removes all data from the arena. (Invalidates all pointers returned by
-  // AddSlice and AllocateBytes). Does not cause memory allocation.
+  // AddSlice and AllocateBytes, and releases the objects passed to Retain).
+  // Does not cause memory allocation.
   // May reduce memory footprint, as it discards all allocated buffers but
   // the last one.
   // Unless allocations exceed max_buffer_size, repetitive filling up and
@@ -222,6 +232,9 @@ class ArenaBase {
   size_t max_buffer_size_;
   size_t arena_footprint_;
 
+  // The objects passed to Retain() since the last Reset().
+  std::vector<std::shared_ptr<void>> retained_;
+
   // Lock covering 'slow path' allocation, when new components are
   // allocated and added to the arena's list. Also covers any other
   // mutation of the component data structure (eg Reset).
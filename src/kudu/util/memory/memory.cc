@@ -21,20 +21,32 @@
 #include "kudu/util/memory/memory.h"
 
 #include <mm_malloc.h>
+#include <sys/mman.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <string>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <gflags/gflags.h>
 
+#include "kudu/gutil/bits.h"
 #include "kudu/util/alignment.h"
+#include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/numa.h"
+#include "kudu/util/status.h"
+#include "kudu/util/threadlocal.h"
 
 using std::copy;
 using std::min;
+using std::string;
 
 // TODO(onufry) - test whether the code still tests OK if we set this to true,
 // or remove this code and add a test that Google allocator does not change it's
@@ -44,6 +56,32 @@ DEFINE_bool(allocator_aligned_mode, false,
             "unless explicitly specified otherwise - to boost SIMD");
 TAG_FLAG(allocator_aligned_mode, hidden);
 
+DEFINE_int32(arena_component_pool_mb, 64,
+             "The maximum amount of memory, in MiB, that freed arena components "
+             "are kept in for reuse by other arenas, rather than being returned "
+             "to the heap. Each thread also caches up to 1 MiB of "
+             "components on top of this. If 0, components aren't pooled.");
+TAG_FLAG(arena_component_pool_mb, advanced);
+
+DEFINE_string(arena_huge_pages, "none",
+              "Whether to back large arena components, such as those of "
+              "MemRowSets, with huge pages. One of 'none', 'thp' (transparent "
+              "huge pages, requested with madvise()) or 'hugetlb' (MAP_HUGETLB "
+              "mappings from the kernel's reserved huge pages, falling back to "
+              "'thp' when none are available). Only supported on Linux.");
+TAG_FLAG(arena_huge_pages, advanced);
+TAG_FLAG(arena_huge_pages, experimental);
+
+static bool ValidateArenaHugePages(const char* flagname, const string& value) {
+  if (boost::iequals(value, "none") || boost::iequals(value, "thp") ||
+      boost::iequals(value, "hugetlb")) {
+    return true;
+  }
+  LOG(ERROR) << "Invalid value for " << flagname << ": " << value;
+  return false;
+}
+DEFINE_validator(arena_huge_pages, &ValidateArenaHugePages);
+
 namespace kudu {
 
 namespace {
@@ -168,6 +206,266 @@ void* HeapBufferAllocator::Realloc(void* previous_data, size_t previous_size,
   }
 }
 
+namespace {
+
+constexpr size_t kMinPooledSizeBytes = 4 * 1024;
+constexpr int kNumSizeClasses = 9;
+constexpr size_t kMaxPooledSizeBytes = kMinPooledSizeBytes << (kNumSizeClasses - 1);
+constexpr size_t kHugePageSizeBytes = 2 * 1024 * 1024;
+
+// The most each thread keeps cached, across all size classes.
+constexpr size_t kThreadCacheCapacity = 1024 * 1024;
+
+// Returns the size class of the smallest pooled block that can hold 'size'
+// bytes, or -1 if such buffers aren't pooled.
+int SizeClassOf(size_t size) {
+  if (size < kMinPooledSizeBytes || size > kMaxPooledSizeBytes) {
+    return -1;
+  }
+  return Bits::Log2Ceiling64(size) - Bits::Log2Floor64(kMinPooledSizeBytes);
+}
+
+size_t BlockSizeOfClass(int size_class) {
+  return kMinPooledSizeBytes << size_class;
+}
+
+ArenaComponentAllocator::HugePageMode HugePageModeFromFlags() {
+#if defined(__linux__)
+  if (boost::iequals(FLAGS_arena_huge_pages, "thp")) {
+    return ArenaComponentAllocator::TRANSPARENT_HUGE_PAGES;
+  }
+  if (boost::iequals(FLAGS_arena_huge_pages, "hugetlb")) {
+    return ArenaComponentAllocator::HUGETLB_PAGES;
+  }
+#endif
+  return ArenaComponentAllocator::NO_HUGE_PAGES;
+}
+
+} // anonymous namespace
+
+const size_t ArenaComponentAllocator::kMinPooledSize = kMinPooledSizeBytes;
+const size_t ArenaComponentAllocator::kMaxPooledSize = kMaxPooledSizeBytes;
+const size_t ArenaComponentAllocator::kHugePageSize = kHugePageSizeBytes;
+
+// Blocks freed by a thread, kept for that thread's next allocations so that
+// the common case of an arena being created and destroyed over and over on the
+// same thread doesn't touch the shared pool.
+struct ArenaComponentAllocator::ThreadCache {
+  ~ThreadCache() {
+    ArenaComponentAllocator* allocator = ArenaComponentAllocator::Get();
+    for (int c = 0; c < kNumSizeClasses; c++) {
+      for (void* block : blocks[c]) {
+        if (!allocator->ReturnToPool(c, block)) {
+          free(block);
+        }
+      }
+    }
+  }
+
+  std::vector<void*> blocks[kNumSizeClasses];
+  size_t bytes = 0;
+};
+
+__thread ArenaComponentAllocator::ThreadCache* ArenaComponentAllocator::tls_cache_ = nullptr;
+__thread bool ArenaComponentAllocator::tls_cache_destroyed_ = false;
+
+void ArenaComponentAllocator::DestroyThreadCache(void* cache) {
+  tls_cache_ = nullptr;
+  tls_cache_destroyed_ = true;
+  delete static_cast<ThreadCache*>(cache);
+}
+
+ArenaComponentAllocator::ArenaComponentAllocator()
+    : pool_capacity_(std::max(FLAGS_arena_component_pool_mb, 0) * 1024LL * 1024LL),
+      huge_page_mode_(HugePageModeFromFlags()),
+      use_thread_cache_(pool_capacity_ > 0),
+      pool_(kNumSizeClasses),
+      pooled_bytes_(0) {
+}
+
+ArenaComponentAllocator::ArenaComponentAllocator(size_t pool_capacity,
+                                                 HugePageMode huge_page_mode)
+    : pool_capacity_(pool_capacity),
+#if defined(__linux__)
+      huge_page_mode_(huge_page_mode),
+#else
+      huge_page_mode_(NO_HUGE_PAGES),
+#endif
+      use_thread_cache_(false),
+      pool_(kNumSizeClasses),
+      pooled_bytes_(0) {
+}
+
+ArenaComponentAllocator::~ArenaComponentAllocator() {
+  for (const auto& blocks : pool_) {
+    for (void* block : blocks) {
+      free(block);
+    }
+  }
+}
+
+size_t ArenaComponentAllocator::pooled_bytes() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return pooled_bytes_;
+}
+
+Buffer* ArenaComponentAllocator::AllocateInternal(size_t requested,
+                                                  size_t minimal,
+                                                  BufferAllocator* originator) {
+  DCHECK_LE(minimal, requested);
+  if (requested == 0) {
+    return CreateBuffer(&dummy_buffer[0], 0, originator);
+  }
+  void* data = AllocateBlock(requested);
+  if (data != nullptr) {
+    return CreateBuffer(data, requested, originator);
+  }
+  if (minimal == requested) {
+    return nullptr;
+  }
+  return AllocateInternal(minimal, minimal, originator);
+}
+
+bool ArenaComponentAllocator::ReallocateInternal(size_t requested,
+                                                 size_t minimal,
+                                                 Buffer* buffer,
+                                                 BufferAllocator* originator) {
+  DCHECK_LE(minimal, requested);
+  size_t attempted = requested;
+  while (true) {
+    void* data = attempted == 0 ? &dummy_buffer[0] : AllocateBlock(attempted);
+    if (data != nullptr) {
+      memcpy(data, buffer->data(), min(buffer->size(), attempted));
+      FreeBlock(buffer->data(), buffer->size());
+      UpdateBuffer(data, attempted, buffer);
+      return true;
+    }
+    if (attempted == minimal) return false;
+    attempted = minimal + (attempted - minimal - 1) / 2;
+  }
+}
+
+void ArenaComponentAllocator::FreeInternal(Buffer* buffer) {
+  FreeBlock(buffer->data(), buffer->size());
+}
+
+void* ArenaComponentAllocator::AllocateBlock(size_t size) {
+  if (huge_pages_enabled() && size >= kHugePageSizeBytes) {
+    return MapHugePages(size);
+  }
+  int size_class = SizeClassOf(size);
+  if (size_class < 0) {
+    return malloc(size);
+  }
+  if (use_thread_cache_ && tls_cache_) {
+    auto& blocks = tls_cache_->blocks[size_class];
+    if (!blocks.empty()) {
+      void* block = blocks.back();
+      blocks.pop_back();
+      tls_cache_->bytes -= BlockSizeOfClass(size_class);
+      return block;
+    }
+  }
+  void* block = TakeFromPool(size_class);
+  return block ? block : malloc(BlockSizeOfClass(size_class));
+}
+
+void ArenaComponentAllocator::FreeBlock(void* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (huge_pages_enabled() && size >= kHugePageSizeBytes) {
+    PCHECK(munmap(data, KUDU_ALIGN_UP(size, kHugePageSizeBytes)) == 0);
+    return;
+  }
+  int size_class = SizeClassOf(size);
+  if (size_class < 0) {
+    free(data);
+    return;
+  }
+  if (use_thread_cache_ && !tls_cache_destroyed_) {
+    if (PREDICT_FALSE(tls_cache_ == nullptr)) {
+      tls_cache_ = new ThreadCache();
+      threadlocal::internal::AddDestructor(&DestroyThreadCache, tls_cache_);
+    }
+    const size_t block_size = BlockSizeOfClass(size_class);
+    if (tls_cache_->bytes + block_size <= kThreadCacheCapacity) {
+      tls_cache_->blocks[size_class].push_back(data);
+      tls_cache_->bytes += block_size;
+      return;
+    }
+  }
+  if (!ReturnToPool(size_class, data)) {
+    free(data);
+  }
+}
+
+void* ArenaComponentAllocator::MapHugePages(size_t size) {
+#if defined(__linux__)
+  const size_t length = KUDU_ALIGN_UP(size, kHugePageSizeBytes);
+  if (huge_page_mode_ == HUGETLB_PAGES) {
+    void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      return data;
+    }
+    KLOG_FIRST_N(WARNING, 1) << "Unable to map arena component on reserved huge pages, "
+                             << "falling back to transparent huge pages: "
+                             << ErrnoToString(errno);
+  }
+
+  // Over-map by a huge page so that the component can be aligned to one,
+  // which the kernel needs in order to back it with huge pages.
+  const size_t mapped_length = length + kHugePageSizeBytes;
+  void* mapped = mmap(nullptr, mapped_length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  uint8_t* start = reinterpret_cast<uint8_t*>(mapped);
+  uint8_t* data = reinterpret_cast<uint8_t*>(
+      KUDU_ALIGN_UP(reinterpret_cast<uintptr_t>(start), kHugePageSizeBytes));
+  if (data > start) {
+    PCHECK(munmap(start, data - start) == 0);
+  }
+  uint8_t* end = start + mapped_length;
+  if (end > data + length) {
+    PCHECK(munmap(data + length, end - (data + length)) == 0);
+  }
+  if (madvise(data, length, MADV_HUGEPAGE) != 0) {
+    KLOG_FIRST_N(WARNING, 1) << "Unable to request transparent huge pages for arena "
+                             << "component: " << ErrnoToString(errno);
+  }
+  return data;
+#else
+  LOG(FATAL) << "Huge pages are only supported on Linux";
+  return nullptr;
+#endif
+}
+
+void* ArenaComponentAllocator::TakeFromPool(int size_class) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  auto& blocks = pool_[size_class];
+  if (blocks.empty()) {
+    return nullptr;
+  }
+  void* block = blocks.back();
+  blocks.pop_back();
+  pooled_bytes_ -= BlockSizeOfClass(size_class);
+  return block;
+}
+
+bool ArenaComponentAllocator::ReturnToPool(int size_class, void* block) {
+  const size_t block_size = BlockSizeOfClass(size_class);
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (pooled_bytes_ + block_size > pool_capacity_) {
+    return false;
+  }
+  pool_[size_class].push_back(block);
+  pooled_bytes_ += block_size;
+  return true;
+}
+
 Buffer* ClearingBufferAllocator::AllocateInternal(size_t requested,
                                                   size_t minimal,
                                                   BufferAllocator* originator) {
@@ -336,4 +634,33 @@ void MemoryTrackingBufferAllocator::FreeInternal(Buffer* buffer) {
   mem_tracker_->Release(buffer->size());
 }
 
+Buffer* NumaBufferAllocator::AllocateInternal(size_t requested,
+                                              size_t minimal,
+                                              BufferAllocator* originator) {
+  Buffer* buffer = DelegateAllocate(delegate_, requested, minimal, originator);
+  if (buffer != nullptr) {
+    Place(buffer);
+  }
+  return buffer;
+}
+
+bool NumaBufferAllocator::ReallocateInternal(size_t requested,
+                                             size_t minimal,
+                                             Buffer* buffer,
+                                             BufferAllocator* originator) {
+  if (!DelegateReallocate(delegate_, requested, minimal, buffer, originator)) {
+    return false;
+  }
+  Place(buffer);
+  return true;
+}
+
+void NumaBufferAllocator::Place(Buffer* buffer) {
+  Status s = PreferNumaNodeForMemory(buffer->data(), buffer->size(), numa_node_);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 60) << "unable to place memory on NUMA node "
+                                   << numa_node_ << ": " << s.ToString();
+  }
+}
+
 }  // namespace kudu
@@ -43,6 +43,7 @@
 #include <glog/logging.h>
 
 #include "kudu/util/boost_mutex_utils.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mutex.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -285,6 +286,108 @@ class HeapBufferAllocator : public BufferAllocator {
   DISALLOW_COPY_AND_ASSIGN(HeapBufferAllocator);
 };
 
+// Allocates the components of arenas. Rather than being returned to the heap
+// when an arena goes away, blocks of kMinPooledSize to kMaxPooledSize bytes
+// are kept in a small per-thread cache backed by a process-wide pool, and handed
+// out again to the next arena that asks for the same size class (sizes are
+// rounded up to a power of two internally; the returned buffer still has the
+// requested size). Blocks of at least kHugePageSize bytes may be mapped on huge
+// pages instead of being allocated from the heap; see --arena_huge_pages.
+// Everything else is allocated as by HeapBufferAllocator.
+//
+// This class is thread-safe.
+class ArenaComponentAllocator : public BufferAllocator {
+ public:
+  enum HugePageMode {
+    NO_HUGE_PAGES,
+    // Anonymous mappings with transparent huge pages requested via madvise().
+    TRANSPARENT_HUGE_PAGES,
+    // MAP_HUGETLB mappings, falling back to TRANSPARENT_HUGE_PAGES when the
+    // kernel has no huge pages reserved.
+    HUGETLB_PAGES
+  };
+
+  static const size_t kMinPooledSize;
+  static const size_t kMaxPooledSize;
+  static const size_t kHugePageSize;
+
+  // Returns the process-wide instance, configured from --arena_component_pool_mb
+  // and --arena_huge_pages.
+  static ArenaComponentAllocator* Get() {
+    return Singleton<ArenaComponentAllocator>::get();
+  }
+
+  // Creates an allocator pooling up to 'pool_capacity' bytes. Unlike the
+  // process-wide instance, it doesn't use the per-thread caches.
+  ArenaComponentAllocator(size_t pool_capacity, HugePageMode huge_page_mode);
+
+  virtual ~ArenaComponentAllocator();
+
+  virtual size_t Available() const OVERRIDE {
+    return std::numeric_limits<size_t>::max();
+  }
+
+  // Returns true if large components are mapped on huge pages.
+  bool huge_pages_enabled() const { return huge_page_mode_ != NO_HUGE_PAGES; }
+
+  // Returns the number of bytes currently held in the process-wide pool,
+  // excluding per-thread caches.
+  size_t pooled_bytes() const;
+
+ private:
+  friend class Singleton<ArenaComponentAllocator>;
+  struct ThreadCache;
+
+  ArenaComponentAllocator();
+
+  // Registered as the thread-local destructor of 'tls_cache_'.
+  static void DestroyThreadCache(void* cache);
+
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  // Allocates a block for a buffer of 'size' bytes, or returns null on OOM.
+  void* AllocateBlock(size_t size);
+
+  // Frees or pools the block of a buffer of 'size' bytes.
+  void FreeBlock(void* data, size_t size);
+
+  void* MapHugePages(size_t size);
+
+  // Takes a block of size class 'size_class' from the pool, or returns null.
+  void* TakeFromPool(int size_class);
+
+  // Gives a block of size class 'size_class' to the pool. Returns false if the
+  // pool is full, in which case the caller keeps the block.
+  bool ReturnToPool(int size_class, void* block);
+
+  // The calling thread's cache, created when it first frees a component.
+  static __thread ThreadCache* tls_cache_;
+  // Set once the thread's cache has been destroyed, so that components freed
+  // afterwards by other thread-local destructors bypass it.
+  static __thread bool tls_cache_destroyed_;
+
+  const size_t pool_capacity_;
+  const HugePageMode huge_page_mode_;
+  const bool use_thread_cache_;
+
+  mutable simple_spinlock lock_;
+  // Free blocks, indexed by size class. Protected by lock_.
+  std::vector<std::vector<void*>> pool_;
+  // Total size of the blocks in 'pool_'. Protected by lock_.
+  size_t pooled_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArenaComponentAllocator);
+};
+
 // Wrapper around the delegate allocator, that clears all newly allocated
 // (and reallocated) memory.
 class ClearingBufferAllocator : public BufferAllocator {
@@ -703,6 +806,46 @@ class MemoryTrackingBufferAllocator : public BufferAllocator {
   bool enforce_limit_;
 };
 
+// BufferAllocator which asks the kernel to place the buffers allocated by its
+// delegate on a NUMA node, so that the tablets whose data is accessed from a
+// node keep their in-memory stores local to it. Placing a buffer is only a
+// hint; if it fails, the buffer is returned where it is.
+class NumaBufferAllocator : public BufferAllocator {
+ public:
+  // Does not take ownership of the delegate. The delegate must remain
+  // valid for the lifetime of this allocator.
+  NumaBufferAllocator(BufferAllocator* const delegate, int numa_node)
+      : delegate_(delegate),
+        numa_node_(numa_node) {}
+
+  virtual ~NumaBufferAllocator() {}
+
+  virtual size_t Available() const OVERRIDE {
+    return delegate_->Available();
+  }
+
+  int numa_node() const { return numa_node_; }
+
+ private:
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE {
+    DelegateFree(delegate_, buffer);
+  }
+
+  void Place(Buffer* buffer);
+
+  BufferAllocator* delegate_;
+  const int numa_node_;
+};
+
 // Synchronizes access to AllocateInternal and FreeInternal, and exposes the
 // mutex for use by subclasses. Allocation requests performed through this
 // allocator are atomic end-to-end. Template parameter DelegateAllocatorType
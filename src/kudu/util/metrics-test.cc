@@ -17,6 +17,7 @@
 
 #include <cstdint>
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -31,6 +32,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/hdr_histogram.h"
 #include "kudu/util/jsonreader.h"
 #include "kudu/util/jsonwriter.h"
@@ -385,4 +387,71 @@ TEST_F(MetricsTest, TestDontDumpUntouched) {
   ASSERT_STR_CONTAINS(out.str(), "test_gauge");
 }
 
+METRIC_DEFINE_entity(tablet);
+METRIC_DEFINE_counter(tablet, test_tablet_counter, "Test Tablet Counter",
+                      MetricUnit::kRequests, "Description of test tablet counter");
+
+TEST_F(MetricsTest, PrometheusPrintTest) {
+  scoped_refptr<Counter> test_counter = METRIC_test_counter.Instantiate(entity_);
+  test_counter->IncrementBy(3);
+  scoped_refptr<Histogram> hist = METRIC_test_hist.Instantiate(entity_);
+  hist->Increment(2);
+  hist->Increment(4);
+  entity_->SetAttribute("test_attr", "attr \"val\"");
+
+  vector<scoped_refptr<MetricEntity>> tablets;
+  vector<scoped_refptr<Counter>> tablet_counters;
+  for (int i = 0; i < 3; i++) {
+    tablets.emplace_back(METRIC_ENTITY_tablet.Instantiate(
+        &registry_, strings::Substitute("tablet-$0", i),
+        { { "table_id", i < 2 ? "id-1" : "id-2" },
+          { "table_name", i < 2 ? "table-1" : "table-2" } }));
+    tablet_counters.emplace_back(METRIC_test_tablet_counter.Instantiate(tablets.back()));
+    tablet_counters.back()->IncrementBy(i + 1);
+  }
+
+  std::ostringstream out;
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, MetricPrometheusOptions()));
+  string output = out.str();
+  ASSERT_STR_CONTAINS(output, "# HELP kudu_test_entity_test_counter Description of test counter\n"
+                              "# TYPE kudu_test_entity_test_counter counter\n"
+                              "kudu_test_entity_test_counter{test_entity_id=\"my-test\","
+                              "test_attr=\"attr \\\"val\\\"\"} 3\n");
+  ASSERT_STR_CONTAINS(output, "# TYPE kudu_test_entity_test_hist summary\n");
+  ASSERT_STR_CONTAINS(output, "kudu_test_entity_test_hist_sum{test_entity_id=\"my-test\","
+                              "test_attr=\"attr \\\"val\\\"\"} 6\n");
+  ASSERT_STR_CONTAINS(output, "kudu_test_entity_test_hist_count{test_entity_id=\"my-test\","
+                              "test_attr=\"attr \\\"val\\\"\"} 2\n");
+  ASSERT_STR_CONTAINS(output, "kudu_tablet_test_tablet_counter{tablet_id=\"tablet-2\","
+                              "table_id=\"id-2\",table_name=\"table-2\"} 3\n");
+
+  // Filter by entity type and metric name.
+  MetricPrometheusOptions opts;
+  opts.requested_entity_types = { "tablet" };
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, opts));
+  ASSERT_STR_NOT_CONTAINS(out.str(), "test_entity");
+  ASSERT_STR_CONTAINS(out.str(), "tablet-0");
+
+  opts.requested_entity_types.clear();
+  opts.requested_metrics = { "TEST_HIST" };
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, opts));
+  ASSERT_STR_CONTAINS(out.str(), "kudu_test_entity_test_hist");
+  ASSERT_STR_NOT_CONTAINS(out.str(), "counter");
+
+  // Merge the tablets by table: the counters are summed.
+  opts.requested_metrics.clear();
+  opts.merge_tablets_by_table = true;
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, opts));
+  output = out.str();
+  ASSERT_STR_NOT_CONTAINS(output, "tablet_id");
+  ASSERT_STR_CONTAINS(output, "# TYPE kudu_tablet_test_tablet_counter counter\n"
+                              "kudu_tablet_test_tablet_counter{table_id=\"id-1\","
+                              "table_name=\"table-1\"} 3\n"
+                              "kudu_tablet_test_tablet_counter{table_id=\"id-2\","
+                              "table_name=\"table-2\"} 3\n");
+}
+
 } // namespace kudu
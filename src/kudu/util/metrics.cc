@@ -16,8 +16,11 @@
 // under the License.
 #include "kudu/util/metrics.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <utility>
 
 #include <gflags/gflags.h>
@@ -25,6 +28,7 @@
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/singleton.h"
+#include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/hdr_histogram.h"
@@ -44,6 +48,7 @@ METRIC_DEFINE_entity(server);
 
 namespace kudu {
 
+using std::pair;
 using std::string;
 using std::vector;
 using strings::Substitute;
@@ -112,6 +117,8 @@ const char* MetricUnit::Name(Type unit) {
       return "sessions";
     case kTablets:
       return "tablets";
+    case kFiles:
+      return "files";
     default:
       DCHECK(false) << "Unknown unit with type = " << unit;
       return "UNKNOWN UNIT";
@@ -368,6 +375,244 @@ Status MetricRegistry::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+namespace {
+
+// Escapes 's' for use as a Prometheus label value or help string.
+string EscapeForPrometheus(const string& s, bool escape_quotes) {
+  string ret;
+  ret.reserve(s.size());
+  for (char c : s) {
+    switch (c) {
+      case '\\': ret.append("\\\\"); break;
+      case '\n': ret.append("\\n"); break;
+      case '"':
+        if (escape_quotes) {
+          ret.append("\\\"");
+          break;
+        }
+        FALLTHROUGH_INTENDED;
+      default: ret.push_back(c); break;
+    }
+  }
+  return ret;
+}
+
+// Turns 's' into a valid Prometheus label name.
+string SanitizePrometheusLabelName(const string& s) {
+  string ret = s;
+  for (char& c : ret) {
+    if (!isalnum(static_cast<unsigned char>(c)) && c != '_') {
+      c = '_';
+    }
+  }
+  if (ret.empty() || isdigit(static_cast<unsigned char>(ret[0]))) {
+    ret.insert(0, "_");
+  }
+  return ret;
+}
+
+string FormatPrometheusValue(double v) {
+  if (std::isnan(v)) return "NaN";
+  if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+  return SimpleDtoa(v);
+}
+
+const char* PrometheusType(MetricType::Type type) {
+  switch (type) {
+    case MetricType::kCounter: return "counter";
+    case MetricType::kGauge: return "gauge";
+    case MetricType::kHistogram: return "summary";
+  }
+  LOG(FATAL) << "unknown metric type: " << type;
+  return "untyped";
+}
+
+// Writes a single sample. 'labels' is the comma-separated list of the labels
+// of the series, and 'extra_label' an additional label, either of which may
+// be empty.
+void WritePrometheusSample(std::ostream* out,
+                           const string& name,
+                           const char* suffix,
+                           const string& labels,
+                           const string& extra_label,
+                           double value) {
+  *out << name << suffix;
+  if (!labels.empty() || !extra_label.empty()) {
+    *out << "{" << labels;
+    if (!labels.empty() && !extra_label.empty()) {
+      *out << ",";
+    }
+    *out << extra_label << "}";
+  }
+  *out << " " << FormatPrometheusValue(value) << "\n";
+}
+
+// The percentiles of the histograms, as in the JSON output.
+const double kPrometheusPercentiles[] = { 75, 95, 99, 99.9, 99.99 };
+
+// The merged value of a metric across the tablets of a table.
+struct MergedPrometheusValue {
+  double value = 0;
+  double sum = 0;
+};
+
+} // anonymous namespace
+
+Status MetricRegistry::WriteAsPrometheus(std::ostream* out,
+                                         const MetricPrometheusOptions& opts) const {
+  EntityMap entities;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    entities = entities_;
+  }
+
+  // The samples of a metric must all be written together, but the metrics
+  // are held by their entities: first snapshot the selected metrics of each
+  // entity, grouped by prototype and ordered by name.
+  //
+  // Each sample refers to the labels of its entity by index. The merged
+  // tablets of a table share the same labels.
+  vector<string> labels;
+  vector<bool> merged;
+  typedef vector<pair<int, scoped_refptr<Metric>>> Samples;
+  std::unordered_map<const MetricPrototype*, Samples> samples_by_prototype;
+  std::unordered_map<string, int> merged_labels_index;
+  for (const auto& e : entities) {
+    const MetricEntity* entity = e.second.get();
+    const string entity_type = entity->prototype_->name();
+    if (!opts.requested_entity_types.empty() &&
+        std::find(opts.requested_entity_types.begin(), opts.requested_entity_types.end(),
+                  entity_type) == opts.requested_entity_types.end()) {
+      continue;
+    }
+    bool select_all = opts.requested_metrics.empty() ||
+        MatchMetricInList(entity->id(), opts.requested_metrics);
+
+    MetricEntity::AttributeMap attrs;
+    vector<pair<const MetricPrototype*, scoped_refptr<Metric>>> metrics;
+    {
+      std::lock_guard<simple_spinlock> l(entity->lock_);
+      attrs = entity->attributes_;
+      for (const auto& val : entity->metric_map_) {
+        if (select_all || MatchMetricInList(val.first->name(), opts.requested_metrics)) {
+          metrics.emplace_back(val.first, val.second);
+        }
+      }
+    }
+    if (metrics.empty()) {
+      continue;
+    }
+
+    int labels_index;
+    bool merge = opts.merge_tablets_by_table && entity_type == "tablet";
+    if (merge) {
+      const string* table_id = FindOrNull(attrs, "table_id");
+      const string* table_name = FindOrNull(attrs, "table_name");
+      string l = Substitute("table_id=\"$0\",table_name=\"$1\"",
+                            EscapeForPrometheus(table_id ? *table_id : "", true),
+                            EscapeForPrometheus(table_name ? *table_name : "", true));
+      auto p = merged_labels_index.emplace(std::move(l), labels.size());
+      if (p.second) {
+        labels.push_back(p.first->first);
+        merged.push_back(true);
+      }
+      labels_index = p.first->second;
+    } else {
+      // The attributes are ordered so that the series are stable.
+      std::map<string, string> ordered_attrs(attrs.begin(), attrs.end());
+      string l = Substitute("$0_id=\"$1\"", SanitizePrometheusLabelName(entity_type),
+                            EscapeForPrometheus(entity->id(), true));
+      for (const auto& attr : ordered_attrs) {
+        l.append(Substitute(",$0=\"$1\"", SanitizePrometheusLabelName(attr.first),
+                            EscapeForPrometheus(attr.second, true)));
+      }
+      labels_index = labels.size();
+      labels.emplace_back(std::move(l));
+      merged.push_back(false);
+    }
+
+    for (auto& m : metrics) {
+      samples_by_prototype[m.first].emplace_back(labels_index, std::move(m.second));
+    }
+  }
+  entities.clear();
+
+  std::map<string, const MetricPrototype*> families;
+  for (const auto& e : samples_by_prototype) {
+    families.emplace(Substitute("kudu_$0_$1", e.first->entity_type(), e.first->name()),
+                     e.first);
+  }
+  for (const auto& f : families) {
+    const string& name = f.first;
+    const MetricPrototype* prototype = f.second;
+    const Samples& samples = FindOrDie(samples_by_prototype, prototype);
+    const MetricType::Type type = prototype->type();
+    bool is_histogram = type == MetricType::kHistogram;
+
+    // Ordered by labels, so that the output is stable.
+    std::map<string, MergedPrometheusValue> merged_values;
+    bool header_written = false;
+    auto write_header = [&]() {
+      if (!header_written) {
+        *out << "# HELP " << name << " "
+             << EscapeForPrometheus(prototype->description(), false) << "\n";
+        *out << "# TYPE " << name << " " << PrometheusType(type) << "\n";
+        header_written = true;
+      }
+    };
+    for (const auto& sample : samples) {
+      const string& l = labels[sample.first];
+      if (is_histogram) {
+        HdrHistogram snapshot(*down_cast<Histogram*>(sample.second.get())->histogram());
+        if (merged[sample.first]) {
+          auto& v = merged_values[l];
+          v.value += snapshot.TotalCount();
+          v.sum += snapshot.TotalSum();
+          continue;
+        }
+        write_header();
+        bool empty = snapshot.TotalCount() == 0;
+        for (double percentile : kPrometheusPercentiles) {
+          WritePrometheusSample(out, name, "", l,
+                                Substitute("quantile=\"$0\"", SimpleDtoa(percentile / 100)),
+                                empty ? 0 : snapshot.ValueAtPercentile(percentile));
+        }
+        WritePrometheusSample(out, name, "_sum", l, "", snapshot.TotalSum());
+        WritePrometheusSample(out, name, "_count", l, "", snapshot.TotalCount());
+        continue;
+      }
+
+      double value;
+      if (!sample.second->NumericValue(&value)) {
+        continue;
+      }
+      if (merged[sample.first]) {
+        merged_values[l].value += value;
+        continue;
+      }
+      write_header();
+      WritePrometheusSample(out, name, "", l, "", value);
+    }
+
+    for (const auto& mv : merged_values) {
+      write_header();
+      const string& l = mv.first;
+      if (is_histogram) {
+        WritePrometheusSample(out, name, "_sum", l, "", mv.second.sum);
+        WritePrometheusSample(out, name, "_count", l, "", mv.second.value);
+      } else {
+        WritePrometheusSample(out, name, "", l, "", mv.second.value);
+      }
+    }
+  }
+
+  // As with the JSON output, retire the old metrics now that they've been
+  // dumped.
+  samples_by_prototype.clear();
+  const_cast<MetricRegistry*>(this)->RetireOldMetrics();
+  return Status::OK();
+}
+
 void MetricRegistry::RetireOldMetrics() {
   std::lock_guard<simple_spinlock> l(lock_);
   for (auto it = entities_.begin(); it != entities_.end();) {
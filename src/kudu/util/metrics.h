@@ -221,14 +221,34 @@
 //      ...
 // ]
 //
+// =================
+// Prometheus output
+// =================
+//
+// The metrics may also be written in the Prometheus text exposition format,
+// which is much cheaper to produce and consume when there are many entities.
+// Each metric is named after its entity type and name, and each entity's ID
+// and attributes become labels:
+//
+// # HELP kudu_tablet_rows_inserted Number of rows inserted into this tablet since service start
+// # TYPE kudu_tablet_rows_inserted counter
+// kudu_tablet_rows_inserted{tablet_id="e95e57ba8d4d...",table_id="12345",table_name="my_table"} 42
+//
+// Histograms are written as summaries, with the same percentiles as in the
+// JSON output. The metrics of the tablets may also be merged by table, in
+// which case counters and gauges are summed and histograms only keep their
+// count and sum.
+//
 /////////////////////////////////////////////////////
 
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <iosfwd>
 #include <limits>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -392,6 +412,7 @@ struct MetricUnit {
     kState,
     kSessions,
     kTablets,
+    kFiles,
   };
   static const char* Name(Type unit);
 };
@@ -440,6 +461,21 @@ struct MetricJsonOptions {
   bool include_entity_attributes = true;
 };
 
+struct MetricPrometheusOptions {
+  // Case-insensitive substrings to match against the entity IDs and metric
+  // names, as for MetricRegistry::WriteAsJson(). If empty, all of the
+  // metrics are included.
+  std::vector<std::string> requested_metrics;
+
+  // The types of the entities to include, e.g. "server" or "tablet". If
+  // empty, the entities of all types are included.
+  std::vector<std::string> requested_entity_types;
+
+  // Whether to merge the metrics of the tablets of each table into a single
+  // series per table, rather than one per tablet.
+  bool merge_tablets_by_table = false;
+};
+
 class MetricEntityPrototype {
  public:
   explicit MetricEntityPrototype(const char* name);
@@ -576,6 +612,13 @@ class Metric : public RefCountedThreadSafe<Metric> {
   // Return true if this metric has never been touched.
   virtual bool IsUntouched() const = 0;
 
+  // Sets 'value' to the current value of this metric, for output formats
+  // which only support numbers. Returns false if the metric doesn't have a
+  // single numeric value, e.g. histograms and string gauges.
+  virtual bool NumericValue(double* /*value*/) const {
+    return false;
+  }
+
   // Return true if this metric has changed in or after the given metrics epoch.
   bool ModifiedInOrAfterEpoch(int64_t epoch) {
     return m_epoch_ >= epoch;
@@ -659,6 +702,12 @@ class MetricRegistry {
                      const std::vector<std::string>& requested_metrics,
                      const MetricJsonOptions& opts) const;
 
+  // Writes metrics in this registry to 'out' in the Prometheus text format.
+  //
+  // See the MetricPrometheusOptions struct definition above for the options
+  // selecting the metrics to output.
+  Status WriteAsPrometheus(std::ostream* out, const MetricPrometheusOptions& opts) const;
+
   // For each registered entity, retires orphaned metrics. If an entity has no more
   // metrics and there are no external references, entities are removed as well.
   //
@@ -821,6 +870,18 @@ class Gauge : public Metric {
 
  protected:
   virtual void WriteValue(JsonWriter* writer) const = 0;
+
+  // Helpers for NumericValue() implementations which are templated on the
+  // type of the gauge.
+  template<typename T>
+  static bool ToNumericValue(const T& v, double* value) {
+    *value = static_cast<double>(v);
+    return true;
+  }
+  static bool ToNumericValue(const std::string& /*v*/, double* /*value*/) {
+    return false;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Gauge);
 };
@@ -875,6 +936,9 @@ class AtomicGauge : public Gauge {
   virtual bool IsUntouched() const override {
     return false;
   }
+  virtual bool NumericValue(double* value) const override {
+    return ToNumericValue(this->value(), value);
+  }
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE {
     writer->Value(value());
@@ -994,6 +1058,14 @@ class FunctionGauge : public Gauge {
     return false;
   }
 
+  virtual bool NumericValue(double* value) const override {
+    if (!std::is_arithmetic<T>::value) {
+      // Don't bother running the function.
+      return false;
+    }
+    return ToNumericValue(this->value(), value);
+  }
+
  private:
   friend class MetricEntity;
 
@@ -1045,6 +1117,11 @@ class Counter : public Metric {
     return value() == 0;
   }
 
+  virtual bool NumericValue(double* value) const override {
+    *value = static_cast<double>(this->value());
+    return true;
+  }
+
  private:
   FRIEND_TEST(MetricsTest, SimpleCounterTest);
   FRIEND_TEST(MultiThreadedMetricsTest, CounterIncrementTest);
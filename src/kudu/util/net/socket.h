@@ -72,6 +72,12 @@ class Socket {
   // Set or clear TCP_CORK
   Status SetTcpCork(bool enabled);
 
+  // Set SO_ZEROCOPY, allowing WritevZeroCopy() to be used. Returns
+  // NotSupported if the platform or the kernel doesn't support zero-copy
+  // sends. It is virtual so that sockets which transform the data before
+  // sending it can refuse.
+  virtual Status EnableZeroCopy();
+
   // Set or clear O_NONBLOCK
   Status SetNonBlocking(bool enabled);
   Status IsNonBlocking(bool* is_nonblock) const;
@@ -136,6 +142,22 @@ class Socket {
   // bytes must be retried. See writev(2) for more information.
   virtual Status Writev(const struct ::iovec *iov, int iov_len, int64_t *nwritten);
 
+  // Like Writev(), but with MSG_ZEROCOPY: the kernel sends the data straight
+  // from the buffers in 'iov' instead of copying it. The buffers must remain
+  // valid and unmodified until RecvZeroCopyCompletion() reports the send as
+  // complete. Every call which writes any bytes is assigned the next in a
+  // sequence of 32-bit notification IDs, starting from 0.
+  //
+  // Requires a successful call to EnableZeroCopy().
+  Status WritevZeroCopy(const struct ::iovec *iov, int iov_len, int64_t *nwritten);
+
+  // Reads one zero-copy completion notification from the socket's error
+  // queue without blocking. If there was one, sets 'found' to true and
+  // reports that the sends with notification IDs from 'lo' through 'hi'
+  // (inclusive) are complete; 'copied' is set if the kernel fell back to
+  // copying their data. Otherwise sets 'found' to false.
+  Status RecvZeroCopyCompletion(bool* found, uint32_t* lo, uint32_t* hi, bool* copied);
+
   // Blocking Write call, returns IOError unless full buffer is sent.
   // Underlying Socket expected to be in blocking mode. Fails if any Write() sends 0 bytes.
   // Returns OK if buflen bytes were sent, otherwise IOError.
@@ -0,0 +1,75 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/numa.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/basictypes.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+TEST(NumaTest, TestParseCpuList) {
+  vector<int> cpus;
+  ASSERT_OK(ParseCpuList("0-3,8,10-11", &cpus));
+  ASSERT_EQ(vector<int>({ 0, 1, 2, 3, 8, 10, 11 }), cpus);
+
+  ASSERT_OK(ParseCpuList("", &cpus));
+  ASSERT_TRUE(cpus.empty());
+
+  for (const string& invalid : { "a", "3-1", "1-2-3", "-1", "0,x-2" }) {
+    SCOPED_TRACE(invalid);
+    ASSERT_TRUE(ParseCpuList(invalid, &cpus).IsCorruption());
+  }
+}
+
+// The topology depends on the machine, so only check that it is consistent.
+TEST(NumaTest, TestTopology) {
+  int num_nodes = NumNumaNodes();
+  if (num_nodes == 0) {
+    ASSERT_EQ(-1, CurrentNumaNode());
+    return;
+  }
+  for (int node = 0; node < num_nodes; node++) {
+    vector<int> cpus;
+    ASSERT_OK(GetNumaNodeCpus(node, &cpus));
+    ASSERT_FALSE(cpus.empty());
+  }
+  ASSERT_OK(BindCurrentThreadToNumaNode(0));
+  ASSERT_EQ(0, CurrentNumaNode());
+
+  // Placing a buffer smaller than a page is a no-op.
+  char buf[16];
+  ASSERT_OK(PreferNumaNodeForMemory(buf, sizeof(buf), 0));
+  // A large buffer is bound; on machines which forbid mbind() the call fails
+  // but must not crash.
+  const size_t kSize = 1024 * 1024;
+  void* data = malloc(kSize);
+  ignore_result(PreferNumaNodeForMemory(data, kSize, 0));
+  free(data);
+}
+
+} // namespace kudu
@@ -0,0 +1,200 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/numa.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+
+#include "kudu/gutil/once.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/strip.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
+#include "kudu/util/env.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/faststring.h"
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+#if defined(__linux__)
+const char* const kSysfsNumaNodeDir = "/sys/devices/system/node";
+
+// From <numaif.h>, which is only available along with libnuma.
+const int kMpolPreferred = 1;
+const unsigned kMpolMfMove = 1 << 1;
+#endif
+
+// The NUMA topology of the machine, read once from sysfs.
+struct NumaTopology {
+  int num_nodes = 0;
+
+  // The node of each CPU, indexed by CPU id, or -1 for the CPUs sysfs didn't
+  // list under any node.
+  vector<int> cpu_nodes;
+};
+
+GoogleOnceType topology_once = GOOGLE_ONCE_INIT;
+NumaTopology* topology = nullptr;
+
+void InitTopology() {
+  topology = new NumaTopology();
+#if defined(__linux__)
+  vector<string> children;
+  if (!Env::Default()->GetChildren(kSysfsNumaNodeDir, &children).ok()) {
+    return;
+  }
+  for (const string& child : children) {
+    if (HasPrefixString(child, "node") && child.size() > 4 && isdigit(child[4])) {
+      topology->num_nodes++;
+    }
+  }
+  for (int node = 0; node < topology->num_nodes; node++) {
+    vector<int> cpus;
+    if (!GetNumaNodeCpus(node, &cpus).ok()) {
+      continue;
+    }
+    for (int cpu : cpus) {
+      if (cpu >= static_cast<int>(topology->cpu_nodes.size())) {
+        topology->cpu_nodes.resize(cpu + 1, -1);
+      }
+      topology->cpu_nodes[cpu] = node;
+    }
+  }
+#endif
+}
+
+const NumaTopology& GetTopology() {
+  GoogleOnceInit(&topology_once, &InitTopology);
+  return *topology;
+}
+
+} // anonymous namespace
+
+Status ParseCpuList(const string& cpulist, vector<int>* cpus) {
+  cpus->clear();
+  for (StringPiece range : strings::Split(cpulist, ",", strings::SkipEmpty())) {
+    vector<string> bounds = strings::Split(range, "-");
+    int32_t lo;
+    int32_t hi;
+    if (bounds.size() > 2 ||
+        !safe_strto32(bounds[0], &lo) ||
+        !safe_strto32(bounds.back(), &hi) ||
+        lo < 0 || hi < lo) {
+      return Status::Corruption(Substitute("invalid CPU range '$0'", range.ToString()));
+    }
+    for (int cpu = lo; cpu <= hi; cpu++) {
+      cpus->push_back(cpu);
+    }
+  }
+  return Status::OK();
+}
+
+int NumNumaNodes() {
+  return GetTopology().num_nodes;
+}
+
+Status GetNumaNodeCpus(int node, vector<int>* cpus) {
+#if defined(__linux__)
+  const string path = Substitute("$0/node$1/cpulist", kSysfsNumaNodeDir, node);
+  faststring contents;
+  RETURN_NOT_OK(ReadFileToString(Env::Default(), path, &contents));
+  string cpulist = contents.ToString();
+  StripTrailingNewline(&cpulist);
+  RETURN_NOT_OK_PREPEND(ParseCpuList(cpulist, cpus), path);
+  if (cpus->empty()) {
+    return Status::NotFound(Substitute("no CPUs listed in $0", path));
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("NUMA nodes are only supported on Linux");
+#endif
+}
+
+int CurrentNumaNode() {
+#if defined(__linux__)
+  const NumaTopology& t = GetTopology();
+  int cpu = sched_getcpu();
+  if (cpu < 0 || cpu >= static_cast<int>(t.cpu_nodes.size())) {
+    return -1;
+  }
+  return t.cpu_nodes[cpu];
+#else
+  return -1;
+#endif
+}
+
+Status BindCurrentThreadToNumaNode(int node) {
+#if defined(__linux__)
+  vector<int> node_cpus;
+  RETURN_NOT_OK(GetNumaNodeCpus(node, &node_cpus));
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for (int cpu : node_cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpus);
+    }
+  }
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  if (err != 0) {
+    return Status::RuntimeError("pthread_setaffinity_np() failed", ErrnoToString(err), err);
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("pinning threads to NUMA nodes is only supported on Linux");
+#endif
+}
+
+Status PreferNumaNodeForMemory(void* data, size_t size, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  if (node < 0 || node >= static_cast<int>(8 * sizeof(unsigned long))) { // NOLINT(runtime/int)
+    return Status::InvalidArgument(Substitute("unsupported NUMA node $0", node));
+  }
+  const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + page_size - 1) & ~(page_size - 1);
+  uintptr_t end = (reinterpret_cast<uintptr_t>(data) + size) & ~(page_size - 1);
+  if (begin >= end) {
+    return Status::OK();
+  }
+  unsigned long nodemask = 1UL << node; // NOLINT(runtime/int)
+  if (syscall(SYS_mbind, begin, end - begin, kMpolPreferred, &nodemask,
+              8 * sizeof(nodemask), kMpolMfMove) != 0) {
+    int err = errno;
+    return Status::RuntimeError("mbind() failed", ErrnoToString(err), err);
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("placing memory on NUMA nodes is only supported on Linux");
+#endif
+}
+
+} // namespace kudu
@@ -0,0 +1,58 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+// Utilities to find the NUMA topology of the machine from sysfs, and to place
+// threads and memory on NUMA nodes. None of them depend on libnuma; on
+// platforms other than Linux the machine is treated as having no NUMA nodes.
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+// Parses a list of CPU ranges in the format sysfs publishes them in, e.g.
+// "0-7,16-23", into the ids of the CPUs it lists.
+Status ParseCpuList(const std::string& cpulist, std::vector<int>* cpus);
+
+// Returns the number of NUMA nodes listed in sysfs, or 0 if there are none.
+// The result is computed once and cached.
+int NumNumaNodes();
+
+// Returns the ids of the CPUs of NUMA node 'node'.
+Status GetNumaNodeCpus(int node, std::vector<int>* cpus);
+
+// Returns the NUMA node of the CPU the calling thread is running on, or -1
+// if it is unknown.
+int CurrentNumaNode();
+
+// Pins the calling thread to the CPUs of NUMA node 'node'.
+Status BindCurrentThreadToNumaNode(int node);
+
+// Asks the kernel to place the pages of the 'size' bytes at 'data' on NUMA
+// node 'node', moving the pages which were already touched. Only the pages
+// entirely within the buffer are affected, so that a small buffer sharing
+// pages with other memory is left alone.
+//
+// This is a hint: the kernel falls back to other nodes when 'node' is out of
+// memory.
+Status PreferNumaNodeForMemory(void* data, size_t size, int node);
+
+} // namespace kudu
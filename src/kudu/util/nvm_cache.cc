@@ -208,6 +208,7 @@ class NvmLRUCache {
   Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
+  void VisitEntries(size_t max_entries, const Cache::EntryVisitor& visitor);
   void* AllocateAndRetry(size_t size);
 
  private:
@@ -456,6 +457,16 @@ void NvmLRUCache::Erase(const Slice& key, uint32_t hash) {
     FreeEntry(e);
   }
 }
+
+void NvmLRUCache::VisitEntries(size_t max_entries, const Cache::EntryVisitor& visitor) {
+  std::lock_guard<MutexType> l(mutex_);
+  size_t visited = 0;
+  for (LRUHandle* e = lru_.prev; e != &lru_ && visited < max_entries; e = e->prev) {
+    visitor(e->key(), e->value());
+    visited++;
+  }
+}
+
 static const int kNumShardBits = 4;
 static const int kNumShards = 1 << kNumShardBits;
 
@@ -518,12 +529,19 @@ class ShardedLRUCache : public Cache {
     return reinterpret_cast<LRUHandle*>(handle)->val_ptr();
   }
 
-  virtual void SetMetrics(const scoped_refptr<MetricEntity>& entity) OVERRIDE {
-    metrics_.reset(new CacheMetrics(entity));
+  virtual void SetMetrics(std::unique_ptr<CacheMetrics> metrics) OVERRIDE {
+    metrics_.reset(metrics.release());
     for (NvmLRUCache* cache : shards_) {
       cache->SetMetrics(metrics_.get());
     }
   }
+
+  virtual void VisitEntries(size_t max_entries, const EntryVisitor& visitor) OVERRIDE {
+    const size_t per_shard = (max_entries + kNumShards - 1) / kNumShards;
+    for (NvmLRUCache* cache : shards_) {
+      cache->VisitEntries(per_shard, visitor);
+    }
+  }
   virtual PendingHandle* Allocate(Slice key, int val_len, int charge) OVERRIDE {
     int key_len = key.size();
     DCHECK_GE(key_len, 0);
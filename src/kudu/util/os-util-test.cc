@@ -42,6 +42,7 @@ void RunTest(const string& name, int user_ticks, int kernel_ticks, int io_wait)
   string extracted_name;
   ASSERT_OK(ParseStat(buf, &extracted_name, &stats));
   ASSERT_EQ(name, extracted_name);
+  ASSERT_EQ('S', stats.state);
   ASSERT_EQ(user_ticks * (1e9 / sysconf(_SC_CLK_TCK)), stats.user_ns);
   ASSERT_EQ(kernel_ticks * (1e9 / sysconf(_SC_CLK_TCK)), stats.kernel_ns);
   ASSERT_EQ(io_wait * (1e9 / sysconf(_SC_CLK_TCK)), stats.iowait_ns);
@@ -68,6 +68,7 @@ static const int64_t kTicksPerSec = sysconf(_SC_CLK_TCK);
 //
 // They are themselves offset by two because the pid and comm fields of the
 // file are parsed separately.
+static const int64_t kState = 2 - 2;
 static const int64_t kUserTicks = 13 - 2;
 static const int64_t kKernelTicks = 14 - 2;
 static const int64_t kIoWait = 41 - 2;
@@ -95,6 +96,9 @@ Status ParseStat(const std::string& buffer, std::string* name, ThreadStats* stat
     return Status::IOError("Unrecognised /proc format");
   }
 
+  if (splits[kState].size() == 1) {
+    stats->state = splits[kState][0];
+  }
   int64_t tmp;
   if (safe_strto64(splits[kUserTicks], &tmp)) {
     stats->user_ns = tmp * (1e9 / kTicksPerSec);
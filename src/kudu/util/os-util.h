@@ -40,9 +40,13 @@ struct ThreadStats {
   int64_t kernel_ns;
   int64_t iowait_ns;
 
+  // The scheduling state of the thread, e.g. 'R' if it is running or
+  // runnable, or 'S' if it is sleeping.
+  char state;
+
   // Default constructor zeroes all members in case structure can't be filled by
   // GetThreadStats.
-  ThreadStats() : user_ns(0), kernel_ns(0), iowait_ns(0) { }
+  ThreadStats() : user_ns(0), kernel_ns(0), iowait_ns(0), state('\0') { }
 };
 
 // Populates ThreadStats object using a given buffer. The buffer is expected to
@@ -58,7 +58,10 @@ namespace pb_util {
 
 enum SyncMode {
   SYNC,
-  NO_SYNC
+  NO_SYNC,
+  // Like SYNC, but doesn't sync the parent directory of the file, leaving it
+  // to the caller. Useful to share a directory sync among several files.
+  SYNC_FILE_ONLY
 };
 
 enum CreateMode {
@@ -17,6 +17,8 @@
 #ifndef IMPALA_RLE_ENCODING_H
 #define IMPALA_RLE_ENCODING_H
 
+#include <algorithm>
+
 #include <glog/logging.h>
 
 #include "kudu/gutil/port.h"
@@ -111,6 +113,17 @@ class RleDecoder {
   // GetNextRun will return more from the same run.
   size_t GetNextRun(T* val, size_t max_run);
 
+  // Gets up to 'max_values' values from the current run into 'vals'. Returns
+  // 0 if there is no more data to be decoded. Sets 'is_repeated' to whether
+  // the values all came from a repeated run, in which case they are all equal.
+  // Values from literal runs are unpacked in batches, which is much faster
+  // than calling Get() for each of them.
+  size_t GetNextBatch(T* vals, size_t max_values, bool* is_repeated);
+
+  // Gets up to 'max_values' values into 'vals'. Returns the number of values
+  // read, which is less than 'max_values' only if there is no more data.
+  size_t GetBatch(T* vals, size_t max_values);
+
  private:
   bool ReadHeader();
 
@@ -341,6 +354,46 @@ inline size_t RleDecoder<T>::GetNextRun(T* val, size_t max_run) {
   return ret;
  }
 
+template<typename T>
+inline size_t RleDecoder<T>::GetNextBatch(T* vals, size_t max_values, bool* is_repeated) {
+  DCHECK(bit_reader_.is_initialized());
+  DCHECK_GT(max_values, 0);
+  if (PREDICT_FALSE(!ReadHeader())) {
+    return 0;
+  }
+  rewind_state_ = CANT_REWIND;
+
+  if (PREDICT_TRUE(repeat_count_ > 0)) {
+    size_t n = std::min<size_t>(repeat_count_, max_values);
+    std::fill(vals, vals + n, static_cast<T>(current_value_));
+    repeat_count_ -= n;
+    *is_repeated = true;
+    return n;
+  }
+
+  DCHECK(literal_count_ > 0);
+  size_t n = std::min<size_t>(literal_count_, max_values);
+  size_t num_read = bit_reader_.GetBatch(bit_width_, vals, static_cast<int>(n));
+  DCHECK_EQ(n, num_read);
+  literal_count_ -= num_read;
+  *is_repeated = false;
+  return num_read;
+}
+
+template<typename T>
+inline size_t RleDecoder<T>::GetBatch(T* vals, size_t max_values) {
+  size_t ret = 0;
+  while (ret < max_values) {
+    bool is_repeated;
+    size_t n = GetNextBatch(vals + ret, max_values - ret, &is_repeated);
+    if (n == 0) {
+      break;
+    }
+    ret += n;
+  }
+  return ret;
+}
+
 template<typename T>
 inline size_t RleDecoder<T>::Skip(size_t to_skip) {
   DCHECK(bit_reader_.is_initialized());
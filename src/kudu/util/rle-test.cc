@@ -37,6 +37,7 @@
 #include "kudu/util/hexdump.h"
 #include "kudu/util/rle-encoding.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::string;
@@ -141,6 +142,53 @@ TEST(BitArray, TestValues) {
   }
 }
 
+// Writes 'num_vals' values with width 'bit_width', skips the first 'skip'
+// of them with GetValue() and reads the rest back with GetBatch() in batches
+// of varying sizes.
+void TestBitArrayBatches(int bit_width, int num_vals, int skip) {
+  const uint64_t mask = ~0ULL >> (64 - bit_width);
+
+  faststring buffer;
+  BitWriter writer(&buffer);
+  vector<uint64_t> expected;
+  for (int i = 0; i < num_vals; ++i) {
+    uint64_t v = (static_cast<uint64_t>(random()) * 0x9E3779B97F4A7C15ULL + i) & mask;
+    writer.PutValue(v, bit_width);
+    expected.push_back(v);
+  }
+  writer.Flush();
+
+  BitReader reader(buffer.data(), writer.bytes_written());
+  for (int i = 0; i < skip; ++i) {
+    uint64_t val;
+    ASSERT_TRUE(reader.GetValue(bit_width, &val));
+  }
+  vector<uint64_t> decoded(num_vals);
+  int pos = skip;
+  while (pos < num_vals) {
+    int batch_size = std::min<int>(random() % 100 + 1, num_vals - pos);
+    ASSERT_EQ(batch_size, reader.GetBatch(bit_width, &decoded[pos], batch_size));
+    pos += batch_size;
+  }
+  for (int i = skip; i < num_vals; ++i) {
+    ASSERT_EQ(expected[i], decoded[i]) << "width " << bit_width << ", value " << i;
+  }
+  // Nothing past the end is returned.
+  uint64_t val;
+  ASSERT_EQ(0, reader.GetBatch(bit_width, &val, 1));
+}
+
+TEST(BitArray, TestGetBatch) {
+  SeedRandom();
+  for (int width = 1; width <= kMaxWidth; ++width) {
+    SCOPED_TRACE(width);
+    for (int skip : { 0, 1, 3 }) {
+      NO_FATALS(TestBitArrayBatches(width, 1000, skip));
+      NO_FATALS(TestBitArrayBatches(width, 40, skip));
+    }
+  }
+}
+
 // Test some mixed values
 TEST(BitArray, TestMixed) {
   const int kTestLenBits = 1024;
@@ -487,6 +535,51 @@ TEST_F(TestRle, TestRoundTripRandomSequencesWithRuns) {
     ASSERT_EQ(string_rep, roundtrip_str);
   }
 }
+// Test that GetBatch() and GetNextBatch() decode the same values as Get()
+// for sequences with a mix of literal and repeated runs.
+TEST_F(TestRle, TestGetBatch) {
+  SeedRandom();
+  for (int bit_width : { 1, 3, 8, 16, 32 }) {
+    SCOPED_TRACE(bit_width);
+    faststring buffer;
+    RleEncoder<uint32_t> encoder(&buffer, bit_width);
+    vector<uint32_t> values;
+    const uint32_t mod = bit_width == 32 ? 0 : (1U << bit_width);
+    for (int i = 0; i < 200; i++) {
+      uint32_t value = mod == 0 ? random() : random() % mod;
+      // Alternate between short runs, which end up in literal runs, and long
+      // repeated runs.
+      int run_length = (i % 3 == 0) ? random() % 50 + 8 : random() % 3 + 1;
+      encoder.Put(value, run_length);
+      values.insert(values.end(), run_length, value);
+    }
+    encoder.Flush();
+
+    RleDecoder<uint32_t> decoder(buffer.data(), encoder.len(), bit_width);
+    vector<uint32_t> decoded(values.size());
+    size_t pos = 0;
+    while (pos < values.size()) {
+      size_t batch_size = std::min<size_t>(random() % 70 + 1, values.size() - pos);
+      if (random() % 2) {
+        ASSERT_EQ(batch_size, decoder.GetBatch(&decoded[pos], batch_size));
+        pos += batch_size;
+      } else {
+        bool is_repeated;
+        size_t n = decoder.GetNextBatch(&decoded[pos], batch_size, &is_repeated);
+        ASSERT_GT(n, 0);
+        ASSERT_LE(n, batch_size);
+        if (is_repeated) {
+          for (size_t i = 1; i < n; i++) {
+            ASSERT_EQ(decoded[pos], decoded[pos + i]);
+          }
+        }
+        pos += n;
+      }
+    }
+    ASSERT_EQ(values, decoded);
+  }
+}
+
 TEST_F(TestRle, TestSkip) {
   faststring buffer(1);
   RleEncoder<bool> encoder(&buffer, 1);
@@ -26,9 +26,11 @@
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/walltime.h"
 #ifdef RW_SEMAPHORE_TRACK_HOLDER
 #include "kudu/util/debug-util.h"
 #endif
+#include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/thread.h"
 
 namespace kudu {
@@ -55,6 +57,9 @@ namespace kudu {
 // If the semaphore is expected to always be released from the same thread
 // that acquired it, use rw_spinlock instead.
 //
+// Time spent spinning for the lock is reported to the lock contention profiler
+// (see spinlock_profiling.h).
+//
 // In order to support easier debugging of leaked locks, this class can track
 // the stack trace of the last thread to lock it in write mode. To do so,
 // uncomment the definition of RW_SEMAPHORE_TRACK_HOLDER at the top of this
@@ -68,6 +73,7 @@ class rw_semaphore {
 
   void lock_shared() {
     int loop_count = 0;
+    int64_t wait_start = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect no write lock
@@ -76,8 +82,10 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      StartWaiting(&wait_start);
       boost::detail::yield(loop_count++);
     }
+    RecordContention(wait_start);
   }
 
   void unlock_shared() {
@@ -100,6 +108,7 @@ class rw_semaphore {
   // This function retries on CAS failure and waits for readers to complete.
   bool try_lock() {
     int loop_count = 0;
+    int64_t wait_start = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       // someone else has already the write lock
@@ -112,16 +121,19 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      StartWaiting(&wait_start);
       boost::detail::yield(loop_count++);
     }
 
-    WaitPendingReaders();
+    WaitPendingReaders(&wait_start);
+    RecordContention(wait_start);
     RecordLockHolderStack();
     return true;
   }
 
   void lock() {
     int loop_count = 0;
+    int64_t wait_start = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect some 0+ readers
@@ -132,10 +144,12 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      StartWaiting(&wait_start);
       boost::detail::yield(loop_count++);
     }
 
-    WaitPendingReaders();
+    WaitPendingReaders(&wait_start);
+    RecordContention(wait_start);
 
 #ifndef NDEBUG
     writer_tid_ = Thread::CurrentThreadId();
@@ -188,13 +202,29 @@ class rw_semaphore {
   }
 #endif
 
-  void WaitPendingReaders() {
+  void WaitPendingReaders(int64_t* wait_start) {
     int loop_count = 0;
     while ((base::subtle::Acquire_Load(&state_) & kNumReadersMask) > 0) {
+      StartWaiting(wait_start);
       boost::detail::yield(loop_count++);
     }
   }
 
+  // Notes the time at which we started to wait for the lock, unless we were
+  // already waiting.
+  static void StartWaiting(int64_t* wait_start) {
+    if (*wait_start == 0) {
+      *wait_start = CycleClock::Now();
+    }
+  }
+
+  // Reports the time spent waiting for the lock, if we had to wait.
+  void RecordContention(int64_t wait_start) {
+    if (PREDICT_FALSE(wait_start != 0)) {
+      SubmitLockContention(LockType::RW_SEMAPHORE, this, CycleClock::Now() - wait_start);
+    }
+  }
+
  private:
   volatile Atomic32 state_;
 #ifndef NDEBUG
@@ -15,9 +15,13 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <cstdint>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <glog/logging.h>
@@ -25,6 +29,9 @@
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/spinlock.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -78,4 +85,45 @@ TEST_F(SpinLockProfilingTest, TestStackCollection) {
   ASSERT_EQ(0, dropped);
 }
 
+// Hold a lock of type 'L' on one thread while another tries to take it, and
+// return the types of lock seen by the contention profiler.
+template<class L>
+static std::vector<LockType> ProfileContendedLock() {
+  StartSynchronizationProfiling();
+  L lock;
+  {
+    std::unique_lock<L> l(lock);
+    std::thread t([&]() {
+      std::lock_guard<L> l(lock);
+    });
+    SleepFor(MonoDelta::FromMilliseconds(100));
+    l.unlock();
+    t.join();
+  }
+  StopSynchronizationProfiling();
+
+  std::vector<LockContentionSample> samples;
+  int64_t dropped = 0;
+  FlushSynchronizationProfile(&samples, &dropped);
+  std::vector<LockType> types;
+  for (const auto& s : samples) {
+    CHECK_GT(s.wait_cycles, 0);
+    types.push_back(s.lock_type);
+  }
+  return types;
+}
+
+TEST_F(SpinLockProfilingTest, TestLockTypes) {
+  std::vector<LockType> types = ProfileContendedLock<Mutex>();
+  ASSERT_NE(types.end(), std::find(types.begin(), types.end(), LockType::MUTEX));
+
+  types = ProfileContendedLock<rw_spinlock>();
+  ASSERT_NE(types.end(), std::find(types.begin(), types.end(), LockType::RW_SEMAPHORE));
+
+  LockType type;
+  ASSERT_TRUE(ParseLockType("mutex", &type));
+  ASSERT_EQ(LockType::MUTEX, type);
+  ASSERT_FALSE(ParseLockType("futex", &type));
+}
+
 } // namespace kudu
@@ -19,6 +19,7 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gflags/gflags.h>
@@ -41,7 +42,7 @@
 
 DEFINE_int32(lock_contention_trace_threshold_cycles,
              2000000, // 2M cycles should be about 1ms
-             "If acquiring a spinlock takes more than this number of "
+             "If acquiring a lock takes more than this number of "
              "cycles, and a Trace is currently active, then the current "
              "stack trace is logged to the trace buffer.");
 TAG_FLAG(lock_contention_trace_threshold_cycles, hidden);
@@ -56,6 +57,8 @@ METRIC_DEFINE_gauge_uint64(server, spinlock_contention_time,
 
 using base::SpinLock;
 using base::SpinLockHolder;
+using std::string;
+using std::vector;
 
 namespace kudu {
 
@@ -81,8 +84,8 @@ class ContentionStacks {
     : dropped_samples_(0) {
   }
 
-  // Add a stack trace to the table.
-  void AddStack(const StackTrace& s, int64_t cycles);
+  // Add a stack trace at which a lock of type 'type' was contended to the table.
+  void AddStack(LockType type, const StackTrace& s, int64_t cycles);
 
   // Flush stacks from the buffer to 'out'. See the docs for FlushSynchronizationProfile()
   // in spinlock_profiling.h for details on format.
@@ -91,6 +94,9 @@ class ContentionStacks {
   // the call have been flushed. However, new stacks can be added concurrently with this call.
   void Flush(std::ostringstream* out, int64_t* dropped);
 
+  // Like the above, but appends the flushed samples to 'samples'.
+  void Flush(vector<LockContentionSample>* samples, int64_t* dropped);
+
  private:
 
   // Collect the next sample from the underlying buffer, and set it back to 0 count
@@ -99,7 +105,7 @@ class ContentionStacks {
   // 'iterator' serves as a way to keep track of the current position in the buffer.
   // Callers should initially set it to 0, and then pass the same pointer to each
   // call to CollectSample. This serves to loop through the collected samples.
-  bool CollectSample(uint64_t* iterator, StackTrace* s, int64_t* trip_count, int64_t* cycles);
+  bool CollectSample(uint64_t* iterator, LockContentionSample* sample);
 
   // Hashtable entry.
   struct Entry {
@@ -110,6 +116,9 @@ class ContentionStacks {
     // Protects all other entries.
     SpinLock lock;
 
+    // The type of lock which was contended.
+    LockType lock_type;
+
     // The number of times we've experienced contention with a stack trace equal
     // to 'trace'.
     //
@@ -141,7 +150,7 @@ class ContentionStacks {
 Atomic32 g_profiling_enabled = 0;
 ContentionStacks* g_contention_stacks = nullptr;
 
-void ContentionStacks::AddStack(const StackTrace& s, int64_t cycles) {
+void ContentionStacks::AddStack(LockType type, const StackTrace& s, int64_t cycles) {
   uint64_t hash = s.HashCode();
 
   // Linear probe up to 4 attempts before giving up
@@ -156,10 +165,11 @@ void ContentionStacks::AddStack(const StackTrace& s, int64_t cycles) {
 
     if (e->trip_count == 0) {
       // It's an un-claimed slot. Claim it.
+      e->lock_type = type;
       e->hash = hash;
       e->trace.CopyFrom(s);
-    } else if (e->hash != hash || !e->trace.Equals(s)) {
-      // It's claimed by a different stack trace.
+    } else if (e->lock_type != type || e->hash != hash || !e->trace.Equals(s)) {
+      // It's claimed by a different stack trace or type of lock.
       e->lock.Unlock();
       continue;
     }
@@ -178,29 +188,37 @@ void ContentionStacks::AddStack(const StackTrace& s, int64_t cycles) {
 
 void ContentionStacks::Flush(std::ostringstream* out, int64_t* dropped) {
   uint64_t iterator = 0;
-  StackTrace t;
-  int64_t cycles;
-  int64_t count;
-  while (g_contention_stacks->CollectSample(&iterator, &t, &count, &cycles)) {
-    *out << cycles << " " << count
-         << " @ " << t.ToHexString(StackTrace::NO_FIX_CALLER_ADDRESSES |
-                                   StackTrace::HEX_0X_PREFIX)
+  LockContentionSample sample;
+  while (CollectSample(&iterator, &sample)) {
+    *out << sample.wait_cycles << " " << sample.trip_count
+         << " @ " << sample.stack.ToHexString(StackTrace::NO_FIX_CALLER_ADDRESSES |
+                                              StackTrace::HEX_0X_PREFIX)
          << std::endl;
   }
 
   *dropped += dropped_samples_.Exchange(0);
 }
 
-bool ContentionStacks::CollectSample(uint64_t* iterator, StackTrace* s, int64_t* trip_count,
-                                     int64_t* cycles) {
+void ContentionStacks::Flush(vector<LockContentionSample>* samples, int64_t* dropped) {
+  uint64_t iterator = 0;
+  LockContentionSample sample;
+  while (CollectSample(&iterator, &sample)) {
+    samples->push_back(sample);
+  }
+
+  *dropped += dropped_samples_.Exchange(0);
+}
+
+bool ContentionStacks::CollectSample(uint64_t* iterator, LockContentionSample* sample) {
   while (*iterator < kNumEntries) {
     Entry* e = &entries_[(*iterator)++];
     SpinLockHolder l(&e->lock);
     if (e->trip_count == 0) continue;
 
-    *trip_count = e->trip_count;
-    *cycles = e->cycle_count;
-    s->CopyFrom(e->trace);
+    sample->lock_type = e->lock_type;
+    sample->trip_count = e->trip_count;
+    sample->wait_cycles = e->cycle_count;
+    sample->stack.CopyFrom(e->trace);
 
     e->trip_count = 0;
     e->cycle_count = 0;
@@ -212,8 +230,39 @@ bool ContentionStacks::CollectSample(uint64_t* iterator, StackTrace* s, int64_t*
 }
 
 
-void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
-  TRACE_COUNTER_INCREMENT("spinlock_wait_cycles", wait_cycles);
+} // anonymous namespace
+
+const char* LockTypeToString(LockType type) {
+  switch (type) {
+    case LockType::SPINLOCK: return "spinlock";
+    case LockType::MUTEX: return "mutex";
+    case LockType::RW_SEMAPHORE: return "rw_semaphore";
+  }
+  LOG(FATAL) << "unknown lock type: " << static_cast<int>(type);
+  return nullptr;
+}
+
+bool ParseLockType(const string& name, LockType* type) {
+  for (LockType t : { LockType::SPINLOCK, LockType::MUTEX, LockType::RW_SEMAPHORE }) {
+    if (name == LockTypeToString(t)) {
+      *type = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+void SubmitLockContention(LockType type, const void* contendedlock, int64_t wait_cycles) {
+  switch (type) {
+    case LockType::SPINLOCK:
+      TRACE_COUNTER_INCREMENT("spinlock_wait_cycles", wait_cycles);
+      break;
+    case LockType::RW_SEMAPHORE:
+      TRACE_COUNTER_INCREMENT("rw_semaphore_wait_cycles", wait_cycles);
+      break;
+    default:
+      break;
+  }
   bool profiling_enabled = base::subtle::Acquire_Load(&g_profiling_enabled);
   bool long_wait_time = wait_cycles > FLAGS_lock_contention_trace_threshold_cycles;
   // Short circuit this function quickly in the common case.
@@ -229,7 +278,7 @@ void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
   stack.Collect();
 
   if (profiling_enabled) {
-    DCHECK_NOTNULL(g_contention_stacks)->AddStack(stack, wait_cycles);
+    DCHECK_NOTNULL(g_contention_stacks)->AddStack(type, stack, wait_cycles);
   }
 
   if (PREDICT_FALSE(long_wait_time)) {
@@ -238,21 +287,26 @@ void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
       double seconds = static_cast<double>(wait_cycles) / base::CyclesPerSecond();
       char backtrace_buffer[1024];
       stack.StringifyToHex(backtrace_buffer, arraysize(backtrace_buffer));
-      TRACE_TO(t, "Waited $0 on lock $1. stack: $2",
+      TRACE_TO(t, "Waited $0 on lock $1 ($2). stack: $3",
                HumanReadableElapsedTime::ToShortString(seconds), contendedlock,
-               backtrace_buffer);
+               LockTypeToString(type), backtrace_buffer);
     }
   }
 
-  LongAdder* la = reinterpret_cast<LongAdder*>(
-      base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&g_contended_cycles)));
-  if (la) {
-    la->IncrementBy(wait_cycles);
+  // The spinlock contention metric only covers spinlocks, as its name says.
+  if (type == LockType::SPINLOCK) {
+    LongAdder* la = reinterpret_cast<LongAdder*>(
+        base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&g_contended_cycles)));
+    if (la) {
+      la->IncrementBy(wait_cycles);
+    }
   }
 
   in_func = false;
 }
 
+namespace {
+
 void DoInit() {
   base::subtle::Release_Store(reinterpret_cast<AtomicWord*>(&g_contention_stacks),
                               reinterpret_cast<uintptr_t>(new ContentionStacks()));
@@ -292,6 +346,11 @@ void FlushSynchronizationProfile(std::ostringstream* out,
   CHECK_NOTNULL(g_contention_stacks)->Flush(out, drop_count);
 }
 
+void FlushSynchronizationProfile(vector<LockContentionSample>* samples,
+                                 int64_t* drop_count) {
+  CHECK_NOTNULL(g_contention_stacks)->Flush(samples, drop_count);
+}
+
 void StopSynchronizationProfiling() {
   InitSpinLockContentionProfiling();
   CHECK_GE(base::subtle::Barrier_AtomicIncrement(&g_profiling_enabled, -1), 0);
@@ -303,6 +362,6 @@ void StopSynchronizationProfiling() {
 // kudu namespace so we don't need to qualify everything.
 namespace gutil {
 void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
-  kudu::SubmitSpinLockProfileData(contendedlock, wait_cycles);
+  kudu::SubmitLockContention(kudu::LockType::SPINLOCK, contendedlock, wait_cycles);
 }
 } // namespace gutil
@@ -19,13 +19,44 @@
 
 #include <cstdint>
 #include <iosfwd>
+#include <string>
+#include <vector>
 
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/debug-util.h"
 
 namespace kudu {
 
 class MetricEntity;
 
+// The kinds of lock whose contention is profiled.
+enum class LockType {
+  // base::SpinLock, and so simple_spinlock.
+  SPINLOCK,
+  // Mutex.
+  MUTEX,
+  // rw_semaphore, and so rw_spinlock and percpu_rwlock.
+  RW_SEMAPHORE,
+};
+
+// Returns a short name for 'type', e.g. "mutex".
+const char* LockTypeToString(LockType type);
+
+// Parses the name returned by LockTypeToString() into 'type'. Returns false
+// if 'name' isn't the name of a lock type.
+bool ParseLockType(const std::string& name, LockType* type);
+
+// Records that acquiring 'lock', a lock of the given type, had to wait for
+// 'wait_cycles' CPU cycles. Lock implementations call this from their
+// contended paths only.
+//
+// The wait is added to the current trace's metrics (for spinlocks and
+// rw_semaphores; Mutex keeps its own 'mutex_wait_us' trace metric), logged to
+// the current trace if it exceeds --lock_contention_trace_threshold_cycles,
+// and, while synchronization profiling is enabled, recorded along with the
+// current stack trace.
+void SubmitLockContention(LockType type, const void* lock, int64_t wait_cycles);
+
 // Enable instrumentation of spinlock contention.
 //
 // Calling this method currently does nothing, except for ensuring
@@ -65,6 +96,19 @@ void StartSynchronizationProfiling();
 // returned samples.
 void FlushSynchronizationProfile(std::ostringstream* out, int64_t* drop_count);
 
+// The contention recorded at one stack trace for one type of lock.
+struct LockContentionSample {
+  LockType lock_type;
+  int64_t trip_count;
+  int64_t wait_cycles;
+  StackTrace stack;
+};
+
+// Like the above, but appends the samples to 'samples' instead of formatting
+// them, e.g. to aggregate them by lock type or symbolize their stacks.
+void FlushSynchronizationProfile(std::vector<LockContentionSample>* samples,
+                                 int64_t* drop_count);
+
 // Stop collecting contention profiles.
 void StopSynchronizationProfiling();
 
@@ -556,6 +556,37 @@ TEST_F(ThreadPoolTest, TestTokenSubmitsProcessedSerially) {
   ASSERT_EQ("abcde", result);
 }
 
+// Tasks submitted from a worker thread are queued to that worker. Test that
+// they're stolen by other workers while it's busy, and that a SERIAL token's
+// tasks still run in order when they pass through the per-worker queues.
+TEST_F(ThreadPoolTest, TestWorkStealing) {
+  ASSERT_OK(RebuildPoolWithMinMax(4, 4));
+
+  // The inner task can only run if another worker steals it.
+  CountDownLatch latch(1);
+  ASSERT_OK(pool_->SubmitFunc([&]() {
+    CHECK_OK(pool_->SubmitFunc([&]() { latch.CountDown(); }));
+    latch.Wait();
+  }));
+  pool_->Wait();
+  ASSERT_EQ(0, latch.count());
+
+  unique_ptr<ThreadPoolToken> t = pool_->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  string result;
+  ASSERT_OK(pool_->SubmitFunc([&]() {
+    Random r(SeedRandom());
+    for (char c = 'a'; c < 'f'; c++) {
+      int sleep_ms = r.Next() % 5;
+      CHECK_OK(t->SubmitFunc([&result, c, sleep_ms]() {
+        SleepFor(MonoDelta::FromMilliseconds(sleep_ms));
+        result += c;
+      }));
+    }
+  }));
+  pool_->Wait();
+  ASSERT_EQ("abcde", result);
+}
+
 TEST_P(ThreadPoolTestTokenTypes, TestTokenSubmitsProcessedConcurrently) {
   const int kNumTokens = 5;
   ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
@@ -187,13 +187,7 @@ void ThreadPoolToken::Shutdown() {
       // Plus doing it this way (rather than switching to QUIESCING and waiting
       // for a worker thread to process the queue entry) helps retain state
       // transition symmetry with ThreadPool::Shutdown.
-      for (auto it = pool_->queue_.begin(); it != pool_->queue_.end();) {
-        if (*it == this) {
-          it = pool_->queue_.erase(it);
-        } else {
-          it++;
-        }
-      }
+      pool_->RemoveQueuedTokenUnlocked(this);
 
       if (active_threads_ == 0) {
         Transition(State::QUIESCED);
@@ -307,6 +301,8 @@ const char* ThreadPoolToken::StateToString(State s) {
 // ThreadPool
 ////////////////////////////////////////////////////////
 
+__thread ThreadPool::Worker* ThreadPool::current_worker_;
+
 ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
   : name_(builder.name_),
     min_threads_(builder.min_threads_),
@@ -320,6 +316,8 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
     num_threads_pending_start_(0),
     active_threads_(0),
     total_queued_tasks_(0),
+    num_queued_tokens_(0),
+    next_queue_seq_(0),
     tokenless_(NewToken(ExecutionMode::CONCURRENT)),
     metrics_(builder.metrics_) {
   string prefix = !builder.trace_metric_prefix_.empty() ?
@@ -371,7 +369,7 @@ void ThreadPool::Shutdown() {
   // of the tasks outside the lock, in case there are concurrent threads
   // wanting to access the ThreadPool. The task's destructors may acquire
   // locks, etc, so this also prevents lock inversions.
-  queue_.clear();
+  ClearQueuesUnlocked();
   std::deque<std::deque<Task>> to_release;
   for (auto* t : tokens_) {
     if (!t->entries_.empty()) {
@@ -500,7 +498,7 @@ Status ThreadPool::DoSubmit(shared_ptr<Runnable> r, ThreadPoolToken* token) {
   int threads_from_this_submit =
       token->IsActive() && token->mode() == ExecutionMode::SERIAL ? 0 : 1;
   int inactive_threads = num_threads_ + num_threads_pending_start_ - active_threads_;
-  int additional_threads = static_cast<int>(queue_.size())
+  int additional_threads = num_queued_tokens_
                          + threads_from_this_submit
                          - inactive_threads;
   bool need_a_thread = false;
@@ -526,7 +524,7 @@ Status ThreadPool::DoSubmit(shared_ptr<Runnable> r, ThreadPoolToken* token) {
   token->entries_.emplace_back(std::move(task));
   if (state == ThreadPoolToken::State::IDLE ||
       token->mode() == ExecutionMode::CONCURRENT) {
-    queue_.emplace_back(token);
+    QueueTokenUnlocked(token);
     if (state == ThreadPoolToken::State::IDLE) {
       token->Transition(ThreadPoolToken::State::RUNNING);
     }
@@ -535,6 +533,7 @@ Status ThreadPool::DoSubmit(shared_ptr<Runnable> r, ThreadPoolToken* token) {
 
   // Wake up an idle thread for this task. Choosing the thread at the front of
   // the list ensures LIFO semantics as idling threads are also added to the front.
+  // If the task was queued to a busy worker, the idle thread steals it.
   //
   // If there are no idle threads, the new task remains on the queue and is
   // processed by an active thread (or a thread we're about to create) at some
@@ -608,6 +607,11 @@ void ThreadPool::DispatchThread() {
   // Owned by this worker thread and added/removed from idle_threads_ as needed.
   IdleThread me(&lock_);
 
+  // Owned by this worker thread and registered in workers_ while it runs.
+  Worker worker(this);
+  InsertOrDie(&workers_, &worker);
+  current_worker_ = &worker;
+
   while (true) {
     // Note: Status::Aborted() is used to indicate normal shutdown.
     if (!pool_status_.ok()) {
@@ -615,7 +619,7 @@ void ThreadPool::DispatchThread() {
       break;
     }
 
-    if (queue_.empty()) {
+    if (num_queued_tokens_ == 0) {
       // There's no work to do, let's go idle.
       //
       // Note: if FIFO behavior is desired, it's as simple as changing this to push_back().
@@ -638,7 +642,7 @@ void ThreadPool::DispatchThread() {
           // brief period during which another thread may actually grab the internal mutex
           // protecting the state, signal, and release again before we get the mutex. So,
           // we'll recheck the empty queue case regardless.
-          if (queue_.empty()) {
+          if (num_queued_tokens_ == 0) {
             VLOG(3) << "Releasing worker thread from pool " << name_ << " after "
                     << idle_timeout_.ToMilliseconds() << "ms of idle time.";
             break;
@@ -649,8 +653,7 @@ void ThreadPool::DispatchThread() {
     }
 
     // Get the next token and task to execute.
-    ThreadPoolToken* token = queue_.front();
-    queue_.pop_front();
+    ThreadPoolToken* token = DequeueTokenUnlocked(&worker);
     DCHECK_EQ(ThreadPoolToken::State::RUNNING, token->state());
     DCHECK(!token->entries_.empty());
     Task task = std::move(token->entries_.front());
@@ -720,7 +723,7 @@ void ThreadPool::DispatchThread() {
       } else if (token->entries_.empty()) {
         token->Transition(ThreadPoolToken::State::IDLE);
       } else if (token->mode() == ExecutionMode::SERIAL) {
-        queue_.emplace_back(token);
+        QueueTokenUnlocked(token);
       }
     }
     if (--active_threads_ == 0) {
@@ -733,6 +736,12 @@ void ThreadPool::DispatchThread() {
   // and add a new task just as the last running thread is about to exit.
   CHECK(unique_lock.OwnsLock());
 
+  // A worker only exits once there's nothing left to run, including in its
+  // own queue.
+  DCHECK(worker.queue.empty());
+  CHECK_EQ(workers_.erase(&worker), 1);
+  current_worker_ = nullptr;
+
   CHECK_EQ(threads_.erase(Thread::current_thread()), 1);
   num_threads_--;
   if (num_threads_ + num_threads_pending_start_ == 0) {
@@ -740,11 +749,79 @@ void ThreadPool::DispatchThread() {
 
     // Sanity check: if we're the last thread exiting, the queue ought to be
     // empty. Otherwise it will never get processed.
-    CHECK(queue_.empty());
+    CHECK_EQ(0, num_queued_tokens_);
     DCHECK_EQ(0, total_queued_tasks_);
   }
 }
 
+void ThreadPool::QueueTokenUnlocked(ThreadPoolToken* token) {
+  QueuedToken entry = { token, next_queue_seq_++ };
+  Worker* w = current_worker_;
+  if (w && w->pool == this) {
+    w->queue.emplace_back(entry);
+  } else {
+    queue_.emplace_back(entry);
+  }
+  num_queued_tokens_++;
+}
+
+ThreadPoolToken* ThreadPool::DequeueTokenUnlocked(Worker* me) {
+  DCHECK_GT(num_queued_tokens_, 0);
+
+  // Prefer whichever of our own and the shared queue's fronts was queued
+  // first, so that neither can starve the other.
+  deque<QueuedToken>* source = nullptr;
+  if (!me->queue.empty()) {
+    source = &me->queue;
+  }
+  if (!queue_.empty() &&
+      (source == nullptr || queue_.front().seq < source->front().seq)) {
+    source = &queue_;
+  }
+
+  // Otherwise, steal the oldest entry queued to another worker. Stealing from
+  // the front rather than the back keeps the pool close to FIFO order.
+  if (source == nullptr) {
+    for (Worker* w : workers_) {
+      if (!w->queue.empty() &&
+          (source == nullptr || w->queue.front().seq < source->front().seq)) {
+        source = &w->queue;
+      }
+    }
+  }
+  DCHECK(source);
+
+  ThreadPoolToken* token = source->front().token;
+  source->pop_front();
+  num_queued_tokens_--;
+  return token;
+}
+
+void ThreadPool::RemoveQueuedTokenUnlocked(ThreadPoolToken* token) {
+  auto remove_from = [&](deque<QueuedToken>* q) {
+    for (auto it = q->begin(); it != q->end();) {
+      if (it->token == token) {
+        it = q->erase(it);
+        num_queued_tokens_--;
+      } else {
+        it++;
+      }
+    }
+  };
+  remove_from(&queue_);
+  for (Worker* w : workers_) {
+    remove_from(&w->queue);
+  }
+}
+
+void ThreadPool::ClearQueuesUnlocked() {
+  queue_.clear();
+  for (Worker* w : workers_) {
+    w->queue.clear();
+  }
+  num_queued_tokens_ = 0;
+}
+
 Status ThreadPool::CreateThread() {
   return kudu::Thread::Create("thread pool", strings::Substitute("$0 [worker]", name_),
                               &ThreadPool::DispatchThread, this, nullptr);
@@ -17,6 +17,7 @@
 #ifndef KUDU_UTIL_THREAD_POOL_H
 #define KUDU_UTIL_THREAD_POOL_H
 
+#include <cstdint>
 #include <deque>
 #include <iosfwd>
 #include <memory>
@@ -164,6 +165,15 @@ class ThreadPoolBuilder {
 // from starving one another. However, tokenless (and CONCURRENT token-based)
 // tasks can starve SERIAL token-based tasks.
 //
+// Work is queued on a per-worker basis: tasks submitted by a worker thread of
+// the pool, and the next task of a SERIAL token whose previous task a worker
+// just ran, are queued to that worker, so they tend to run on a core whose
+// caches are already warm. Tasks submitted from outside the pool are queued
+// to a shared queue. A worker runs whichever of its own and the shared queue's
+// oldest entries was queued first. When both are empty, it steals the oldest
+// entry queued to another worker, so the FIFO order described above holds
+// approximately across the whole pool.
+//
 // Usage Example:
 //    static void Func(int n) { ... }
 //    class Task : public Runnable { ... }
@@ -276,6 +286,31 @@ class ThreadPool {
   // Releases token 't' and invalidates it.
   void ReleaseToken(ThreadPoolToken* t);
 
+  // Per-worker state, owned by the worker thread's DispatchThread() frame.
+  struct Worker;
+
+  // Queues 'token' to be run: to the current thread's own queue if it's a
+  // worker of this pool, and to the shared queue otherwise.
+  //
+  // REQUIRES: lock_ is held.
+  void QueueTokenUnlocked(ThreadPoolToken* token);
+
+  // Dequeues the next token to run on worker 'me', stealing it from another
+  // worker if there's nothing in 'me's queue or the shared one.
+  //
+  // REQUIRES: lock_ is held and num_queued_tokens_ > 0.
+  ThreadPoolToken* DequeueTokenUnlocked(Worker* me);
+
+  // Removes every queued entry of 'token'.
+  //
+  // REQUIRES: lock_ is held.
+  void RemoveQueuedTokenUnlocked(ThreadPoolToken* token);
+
+  // Removes every queued entry of every token.
+  //
+  // REQUIRES: lock_ is held.
+  void ClearQueuesUnlocked();
+
   const std::string name_;
   const int min_threads_;
   const int max_threads_;
@@ -327,11 +362,52 @@ class ThreadPool {
   // Protected by lock_.
   std::unordered_set<ThreadPoolToken*> tokens_;
 
-  // FIFO of tokens from which tasks should be executed. Does not own the
-  // tokens; they are owned by clients and are removed from the FIFO on shutdown.
+  // A token from which a task should be executed, stamped with the order in
+  // which it was queued.
+  struct QueuedToken {
+    ThreadPoolToken* token;
+    int64_t seq;
+  };
+
+  // Per-worker state. Only the owning worker queues to 'queue', but any worker
+  // may dequeue from it.
+  //
+  // Protected by lock_.
+  struct Worker {
+    explicit Worker(ThreadPool* p) : pool(p) {}
+
+    ThreadPool* const pool;
+
+    // FIFO of tokens queued by this worker.
+    std::deque<QueuedToken> queue;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+  };
+
+  // The worker state of the current thread, if it's a thread pool worker.
+  static __thread Worker* current_worker_;
+
+  // FIFO of tokens queued from outside the pool. Like the per-worker queues,
+  // does not own the tokens; they are owned by clients and are removed from
+  // the queues on shutdown.
+  //
+  // Protected by lock_.
+  std::deque<QueuedToken> queue_;
+
+  // The per-worker state of all running threads.
+  //
+  // Protected by lock_.
+  std::unordered_set<Worker*> workers_;
+
+  // Total number of entries in queue_ and in the per-worker queues.
+  //
+  // Protected by lock_.
+  int num_queued_tokens_;
+
+  // Sequence number for the next queued token.
   //
   // Protected by lock_.
-  std::deque<ThreadPoolToken*> queue_;
+  int64_t next_queue_seq_;
 
   // Pointers to all running threads. Raw pointers are safe because a Thread
   // may only go out of scope after being removed from threads_.
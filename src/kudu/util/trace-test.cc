@@ -24,6 +24,7 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <rapidjson/document.h>
@@ -49,6 +50,8 @@
 #include "kudu/util/trace_metrics.h"
 #include "kudu/util/trace.h"
 
+DECLARE_double(trace_sample_rate);
+
 using kudu::debug::TraceLog;
 using kudu::debug::TraceResultBuffer;
 using kudu::debug::CategoryFilter;
@@ -88,6 +91,38 @@ TEST_F(TraceTest, TestBasic) {
             result);
 }
 
+TEST_F(TraceTest, TestUnsampled) {
+  scoped_refptr<Trace> t(new Trace(false));
+  ASSERT_FALSE(t->sampled());
+  TRACE_TO(t, "hello $0, $1", "world", 12345);
+  {
+    ADOPT_TRACE(t.get());
+    TRACE("goodbye $0, $1", "cruel world", 54321);
+    TRACE_COUNTER_INCREMENT("test_counter", 1);
+  }
+
+  // Only the time and location of the messages are recorded, but the
+  // metrics are recorded in full.
+  string result = XOutDigits(t->DumpToString(Trace::INCLUDE_METRICS));
+  ASSERT_EQ("XXXX XX:XX:XX.XXXXXX trace-test.cc:XX] (trace not sampled)\n"
+            "XXXX XX:XX:XX.XXXXXX trace-test.cc:XX] (trace not sampled)\n"
+            "Metrics: {\"test_counter\":X}",
+            result);
+
+  // Messages beyond the first few are only counted.
+  for (int i = 0; i < 100; i++) {
+    TRACE_TO(t, "message $0", i);
+  }
+  ASSERT_STR_CONTAINS(t->DumpToString(Trace::NO_FLAGS), "70 more trace messages not recorded");
+}
+
+TEST_F(TraceTest, TestSampleRate) {
+  FLAGS_trace_sample_rate = 0;
+  ASSERT_FALSE(Trace::NewSampled()->sampled());
+  FLAGS_trace_sample_rate = 1;
+  ASSERT_TRUE(Trace::NewSampled()->sampled());
+}
+
 TEST_F(TraceTest, TestAttach) {
   scoped_refptr<Trace> traceA(new Trace);
   scoped_refptr<Trace> traceB(new Trace);
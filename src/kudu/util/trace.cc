@@ -17,6 +17,7 @@
 
 #include "kudu/util/trace.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <iomanip>
@@ -27,13 +28,37 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/threadlocal.h"
+
+DEFINE_double(trace_sample_rate, 1.0,
+              "Fraction of request traces which record their messages in full. "
+              "The traces of the remaining requests only record when and where "
+              "their messages were traced, along with their trace metrics. "
+              "This is much cheaper, and is still enough to tell where a slow "
+              "request spent its time.");
+TAG_FLAG(trace_sample_rate, advanced);
+TAG_FLAG(trace_sample_rate, runtime);
+
+static bool ValidateTraceSampleRate(const char* flagname, double value) {
+  if (value >= 0 && value <= 1) {
+    return true;
+  }
+  LOG(ERROR) << strings::Substitute("$0 must be between 0 and 1, value $1 is invalid",
+                                    flagname, value);
+  return false;
+}
+DEFINE_validator(trace_sample_rate, &ValidateTraceSampleRate);
 
 using std::pair;
 using std::string;
@@ -44,19 +69,48 @@ namespace kudu {
 
 __thread Trace* Trace::threadlocal_trace_;
 
-Trace::Trace()
-    : arena_(new ThreadSafeArena(1024)),
-      entries_head_(nullptr),
-      entries_tail_(nullptr) {
+namespace {
+
+ThreadSafeArena* NewTraceArena() {
+  ThreadSafeArena* arena = new ThreadSafeArena(1024);
   // We expect small allocations from our Arena so no need to have
   // a large arena component. Small allocations are more likely to
   // come out of thread cache and be fast.
-  arena_->SetMaxBufferSize(4096);
+  arena->SetMaxBufferSize(4096);
+  return arena;
+}
+
+} // anonymous namespace
+
+// A message recorded by an unsampled trace.
+struct TraceTimestamp {
+  MicrosecondsInt64 timestamp_micros;
+  const char* file_path;
+  int line_number;
+};
+
+Trace::Trace(bool sampled)
+    : sampled_(sampled),
+      arena_(sampled ? NewTraceArena() : nullptr),
+      entries_head_(nullptr),
+      entries_tail_(nullptr),
+      timestamps_(sampled ? nullptr : new TraceTimestamp[kMaxTimestamps]),
+      num_timestamps_(0) {
 }
 
 Trace::~Trace() {
 }
 
+scoped_refptr<Trace> Trace::NewSampled() {
+  double rate = FLAGS_trace_sample_rate;
+  bool sampled = true;
+  if (rate < 1) {
+    BLOCK_STATIC_THREAD_LOCAL(Random, rng, GetRandomSeed32());
+    sampled = rng->NextDoubleFraction() < rate;
+  }
+  return make_scoped_refptr(new Trace(sampled));
+}
+
 // Struct which precedes each entry in the trace.
 struct TraceEntry {
   MicrosecondsInt64 timestamp_micros;
@@ -95,6 +149,10 @@ void Trace::SubstituteAndTrace(const char* file_path,
                                const SubstituteArg& arg4, const SubstituteArg& arg5,
                                const SubstituteArg& arg6, const SubstituteArg& arg7,
                                const SubstituteArg& arg8, const SubstituteArg& arg9) {
+  if (!sampled_) {
+    AddTimestamp(file_path, line_number);
+    return;
+  }
   const SubstituteArg* const args_array[] = {
     &arg0, &arg1, &arg2, &arg3, &arg4, &arg5, &arg6, &arg7, &arg8, &arg9, nullptr
   };
@@ -105,6 +163,19 @@ void Trace::SubstituteAndTrace(const char* file_path,
   AddEntry(entry);
 }
 
+void Trace::AddTimestamp(const char* file_path, int line_number) {
+  DCHECK(!sampled_);
+  MicrosecondsInt64 now = GetCurrentTimeMicros();
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (num_timestamps_ < kMaxTimestamps) {
+    TraceTimestamp* ts = &timestamps_[num_timestamps_];
+    ts->timestamp_micros = now;
+    ts->file_path = file_path;
+    ts->line_number = line_number;
+  }
+  num_timestamps_++;
+}
+
 TraceEntry* Trace::NewEntry(int msg_len, const char* file_path, int line_number) {
   int size = sizeof(TraceEntry) + msg_len;
   uint8_t* dst = reinterpret_cast<uint8_t*>(arena_->AllocateBytes(size));
@@ -130,6 +201,11 @@ void Trace::AddEntry(TraceEntry* entry) {
 }
 
 void Trace::Dump(std::ostream* out, int flags) const {
+  if (!sampled_) {
+    DumpTimestamps(out, flags);
+    return;
+  }
+
   // Gather a copy of the list of entries under the lock. This is fast
   // enough that we aren't worried about stalling concurrent tracers
   // (whereas doing the logging itself while holding the lock might be
@@ -187,6 +263,56 @@ void Trace::Dump(std::ostream* out, int flags) const {
   out->flags(save_flags);
 }
 
+void Trace::DumpTimestamps(std::ostream* out, int flags) const {
+  vector<TraceTimestamp> timestamps;
+  int num_timestamps;
+  vector<pair<StringPiece, scoped_refptr<Trace>>> child_traces;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    num_timestamps = num_timestamps_;
+    timestamps.assign(timestamps_.get(),
+                      timestamps_.get() + std::min(num_timestamps_, kMaxTimestamps));
+    child_traces = child_traces_;
+  }
+
+  std::ios::fmtflags save_flags(out->flags());
+
+  int64_t prev_usecs = 0;
+  for (const TraceTimestamp& ts : timestamps) {
+    int64_t usecs_since_prev = 0;
+    if (prev_usecs != 0) {
+      usecs_since_prev = ts.timestamp_micros - prev_usecs;
+    }
+    prev_usecs = ts.timestamp_micros;
+
+    using std::setw;
+    *out << FormatTimestampForLog(ts.timestamp_micros);
+    *out << ' ';
+    if (flags & INCLUDE_TIME_DELTAS) {
+      out->fill(' ');
+      *out << "(+" << setw(6) << usecs_since_prev << "us) ";
+    }
+    *out << const_basename(ts.file_path) << ':' << ts.line_number
+         << "] (trace not sampled)" << std::endl;
+  }
+  if (num_timestamps > kMaxTimestamps) {
+    *out << (num_timestamps - kMaxTimestamps) << " more trace messages not recorded"
+         << std::endl;
+  }
+
+  for (const auto& entry : child_traces) {
+    const auto& t = entry.second;
+    *out << "Related trace '" << entry.first << "':" << std::endl;
+    *out << t->DumpToString(flags & (~INCLUDE_METRICS));
+  }
+
+  if (flags & INCLUDE_METRICS) {
+    *out << "Metrics: " << MetricsAsJSON();
+  }
+
+  out->flags(save_flags);
+}
+
 string Trace::DumpToString(int flags) const {
   std::ostringstream s;
   Dump(&s, flags);
@@ -244,9 +370,11 @@ void Trace::DumpCurrentTrace() {
 }
 
 void Trace::AddChildTrace(StringPiece label, Trace* child_trace) {
-  CHECK(arena_->RelocateStringPiece(label, &label));
-
   std::lock_guard<simple_spinlock> l(lock_);
+  if (!arena_) {
+    arena_.reset(NewTraceArena());
+  }
+  CHECK(arena_->RelocateStringPiece(label, &label));
   scoped_refptr<Trace> ptr(child_trace);
   child_traces_.emplace_back(label, ptr);
 }
@@ -46,12 +46,18 @@ class Trace;
 // See Trace::SubstituteAndTrace for arguments.
 // Example:
 //  TRACE("Acquired timestamp $0", timestamp);
+//
+// If the current trace isn't sampled, the substitutions aren't evaluated.
 #define TRACE(format, substitutions...) \
   do { \
     kudu::Trace* _trace = Trace::CurrentTrace(); \
     if (_trace) { \
-      _trace->SubstituteAndTrace(__FILE__, __LINE__, (format),  \
-        ##substitutions); \
+      if (_trace->sampled()) { \
+        _trace->SubstituteAndTrace(__FILE__, __LINE__, (format),  \
+          ##substitutions); \
+      } else { \
+        _trace->AddTimestamp(__FILE__, __LINE__); \
+      } \
     } \
   } while (0);
 
@@ -117,6 +123,7 @@ namespace kudu {
 class JsonWriter;
 class ThreadSafeArena;
 struct TraceEntry;
+struct TraceTimestamp;
 
 // A trace for a request or other process. This supports collecting trace entries
 // from a number of threads, and later dumping the results to a stream.
@@ -125,10 +132,26 @@ struct TraceEntry;
 // methods of this class. Rather, the TRACE(...) macros defined above should
 // be used such that file/line numbers are automatically included, etc.
 //
+// A trace is either sampled, in which case it records every message in full,
+// or unsampled, in which case it only records when and where each of its
+// first few messages was traced, without formatting or allocating anything.
+// Trace metrics are recorded either way. Unsampled traces are meant for
+// requests which are traced on the off chance that they turn out to be slow:
+// the timestamps still show where such a request spent its time.
+//
 // This class is thread-safe.
 class Trace : public RefCountedThreadSafe<Trace> {
  public:
-  Trace();
+  explicit Trace(bool sampled = true);
+
+  // Returns a new trace which is sampled with probability
+  // --trace_sample_rate, and unsampled otherwise.
+  static scoped_refptr<Trace> NewSampled();
+
+  // Whether this trace records messages in full.
+  bool sampled() const {
+    return sampled_;
+  }
 
   // Logs a message into the trace buffer.
   //
@@ -159,6 +182,10 @@ class Trace : public RefCountedThreadSafe<Trace> {
                           const strings::internal::SubstituteArg& arg9 =
                             strings::internal::SubstituteArg::kNoArg);
 
+  // Records the time and source location of a message without its contents.
+  // This is how messages are recorded by unsampled traces.
+  void AddTimestamp(const char* filepath, int line_number);
+
   // Dump the trace buffer to the given output stream.
   //
   enum {
@@ -224,6 +251,17 @@ class Trace : public RefCountedThreadSafe<Trace> {
 
   void MetricsToJSON(JsonWriter* jw) const;
 
+  // Dump the timestamps recorded by an unsampled trace.
+  void DumpTimestamps(std::ostream* out, int flags) const;
+
+  // The number of timestamps an unsampled trace records. Further messages
+  // are only counted.
+  static const int kMaxTimestamps = 32;
+
+  const bool sampled_;
+
+  // Allocated up front for sampled traces, and on demand for unsampled ones,
+  // which only need it to hold the labels of their child traces.
   gscoped_ptr<ThreadSafeArena> arena_;
 
   // Lock protecting the entries linked list.
@@ -233,6 +271,11 @@ class Trace : public RefCountedThreadSafe<Trace> {
   // The tail of the linked list of entries (allocated inside arena_)
   TraceEntry* entries_tail_;
 
+  // The timestamps recorded by an unsampled trace, and the number of messages
+  // traced, which may exceed kMaxTimestamps. Protected by lock_.
+  gscoped_array<TraceTimestamp> timestamps_;
+  int num_timestamps_;
+
   std::vector<std::pair<StringPiece, scoped_refptr<Trace>>> child_traces_;
 
   TraceMetrics metrics_;
@@ -537,6 +537,21 @@ build_zlib() {
   popd
 }
 
+build_zstd() {
+  ZSTD_BDIR=$TP_BUILD_DIR/$ZSTD_NAME$MODE_SUFFIX
+  mkdir -p $ZSTD_BDIR
+  pushd $ZSTD_BDIR
+
+  # Like zlib, zstd's Makefile builds in its source tree, so prepopulate the
+  # build directory using the source directory.
+  rsync -av --delete $ZSTD_SOURCE/ .
+
+  CFLAGS="$EXTRA_CFLAGS -fPIC" \
+    make -C lib -j$PARALLEL $EXTRA_MAKEFLAGS libzstd.a
+  make -C lib PREFIX=$PREFIX install-static install-includes
+  popd
+}
+
 build_lz4() {
   LZ4_BDIR=$TP_BUILD_DIR/$LZ4_NAME$MODE_SUFFIX
   mkdir -p $LZ4_BDIR
@@ -81,6 +81,7 @@ else
       "rapidjson")    F_RAPIDJSON=1 ;;
       "snappy")       F_SNAPPY=1 ;;
       "zlib")         F_ZLIB=1 ;;
+      "zstd")         F_ZSTD=1 ;;
       "squeasel")     F_SQUEASEL=1 ;;
       "mustache")     F_MUSTACHE=1 ;;
       "gsg")          F_GSG=1 ;;
@@ -281,6 +282,10 @@ if [ -n "$F_UNINSTRUMENTED" -o -n "$F_ZLIB" ]; then
   build_zlib
 fi
 
+if [ -n "$F_UNINSTRUMENTED" -o -n "$F_ZSTD" ]; then
+  build_zstd
+fi
+
 if [ -n "$F_UNINSTRUMENTED" -o -n "$F_LZ4" ]; then
   build_lz4
 fi
@@ -432,6 +437,10 @@ if [ -n "$F_TSAN" -o -n "$F_ZLIB" ]; then
   build_zlib
 fi
 
+if [ -n "$F_TSAN" -o -n "$F_ZSTD" ]; then
+  build_zstd
+fi
+
 if [ -n "$F_TSAN" -o -n "$F_LZ4" ]; then
   build_lz4
 fi
@@ -252,6 +252,12 @@ fetch_and_patch \
  $ZLIB_SOURCE \
  $ZLIB_PATCHLEVEL
 
+ZSTD_PATCHLEVEL=0
+fetch_and_patch \
+ zstd-${ZSTD_VERSION}.tar.gz \
+ $ZSTD_SOURCE \
+ $ZSTD_PATCHLEVEL
+
 LIBEV_PATCHLEVEL=0
 fetch_and_patch \
  libev-${LIBEV_VERSION}.tar.gz \